@@ -0,0 +1,228 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analysis_batch.h"
+
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <list>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+
+#include "frontend.h"
+#include "json/json.h"
+#include "util/memory_usage.h"
+#include "util/stats.h"
+#include "util/thread_pool.h"
+
+namespace morphie {
+namespace frontend {
+
+namespace {
+
+const char kBatchJobErr[] =
+    "A batch job cannot set trace_file or profile_allocations.";
+const char kOkStatus[] = "OK";
+
+const double kBytesPerMiB = 1 << 20;
+// The fraction of the physical memory that is the default memory budget.
+const double kDefaultMemoryFraction = 0.8;
+
+// Returns the sum of the sizes of the files that match the glob pattern
+// 'pattern'. Files that cannot be read count as empty, so that the job that
+// reads them fails as it would on its own.
+int64_t MatchingFileBytes(const string& pattern) {
+  int64_t num_bytes = 0;
+  glob_t matches;
+  if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+    for (size_t i = 0; i < matches.gl_pathc; ++i) {
+      struct stat file_status;
+      if (stat(matches.gl_pathv[i], &file_status) == 0) {
+        num_bytes += file_status.st_size;
+      }
+    }
+  }
+  globfree(&matches);
+  return num_bytes;
+}
+
+// Returns the bytes of the input files of 'options', including a graph file
+// that is appended to, which is loaded before events are added.
+int64_t InputBytes(const AnalysisOptions& options) {
+  int64_t num_bytes = 0;
+  for (const string& pattern :
+       {options.csv_file(), options.json_file(), options.json_stream_file(),
+        options.graph_file(), options.merge_graph_files(),
+        options.plasoevent_stream_file(), options.append_graph_file()}) {
+    if (!pattern.empty()) {
+      num_bytes += MatchingFileBytes(pattern);
+    }
+  }
+  return num_bytes;
+}
+
+// Returns the memory budget of 'batch' in bytes.
+double MemoryBudget(const AnalysisBatch& batch) {
+  if (batch.memory_budget_mib() > 0) {
+    return batch.memory_budget_mib() * kBytesPerMiB;
+  }
+  return kDefaultMemoryFraction * sysconf(_SC_PHYS_PAGES) *
+         sysconf(_SC_PAGESIZE);
+}
+
+// Runs 'options' with a session of its own and records its status, run time
+// and statistics in 'result'.
+void RunJob(const AnalysisOptions& options, JobResult* result) {
+  util::Stats stats;
+  Session session;
+  {
+    util::ScopedTimer timer(&result->run_seconds);
+    result->status = session.Run(options, &stats);
+  }
+  result->phase_seconds = stats.Times();
+  result->counters = stats.Counts();
+}
+
+}  // namespace
+
+BatchEnvironment DefaultBatchEnvironment() {
+  BatchEnvironment environment;
+  environment.resident_set_size_mib = util::ResidentSetSizeMiB;
+  environment.input_bytes = InputBytes;
+  environment.run_job = RunJob;
+  return environment;
+}
+
+std::vector<JobResult> RunBatch(const AnalysisBatch& batch) {
+  return RunBatch(batch, DefaultBatchEnvironment());
+}
+
+std::vector<JobResult> RunBatch(const AnalysisBatch& batch,
+                                const BatchEnvironment& environment) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<JobResult> results(batch.jobs_size());
+  std::list<int> pending;
+  for (int job = 0; job < batch.jobs_size(); ++job) {
+    const AnalysisOptions& options = batch.jobs(job);
+    if (options.has_trace_file() || options.profile_allocations()) {
+      results[job].status = util::Status(Code::INVALID_ARGUMENT, kBatchJobErr);
+      continue;
+    }
+    results[job].input_bytes = environment.input_bytes(options);
+    pending.push_back(job);
+  }
+  const int max_jobs =
+      batch.max_concurrent_jobs() > 0
+          ? batch.max_concurrent_jobs()
+          : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  const double budget = MemoryBudget(batch);
+  const double baseline_bytes =
+      environment.resident_set_size_mib() * kBytesPerMiB;
+
+  // The state below is guarded by 'mutex' and is updated by the jobs as they
+  // finish.
+  std::mutex mutex;
+  std::condition_variable job_finished;
+  double memory_per_input_byte = batch.memory_per_input_byte();
+  double reserved_bytes = 0;
+  int num_running = 0;
+
+  util::ThreadPool pool(max_jobs);
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!pending.empty()) {
+    auto job_it = pending.end();
+    if (num_running < max_jobs) {
+      const double used_bytes =
+          std::max(reserved_bytes,
+                   environment.resident_set_size_mib() * kBytesPerMiB -
+                       baseline_bytes);
+      job_it = std::find_if(
+          pending.begin(), pending.end(), [&](int job) {
+            return num_running == 0 ||
+                   used_bytes + results[job].input_bytes *
+                                    memory_per_input_byte <=
+                       budget;
+          });
+    }
+    if (job_it == pending.end()) {
+      job_finished.wait(lock);
+      continue;
+    }
+    const int job = *job_it;
+    pending.erase(job_it);
+    JobResult* result = &results[job];
+    result->estimated_bytes =
+        static_cast<int64_t>(result->input_bytes * memory_per_input_byte);
+    result->wait_seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    reserved_bytes += result->estimated_bytes;
+    ++num_running;
+    pool.Schedule([&batch, &environment, &mutex, &job_finished,
+                   &memory_per_input_byte, &reserved_bytes, &num_running, job,
+                   result]() {
+      environment.run_job(batch.jobs(job), result);
+      std::lock_guard<std::mutex> guard(mutex);
+      reserved_bytes -= result->estimated_bytes;
+      --num_running;
+      auto memory_it = result->counters.find("memory_bytes");
+      if (memory_it != result->counters.end() && result->input_bytes > 0) {
+        memory_per_input_byte =
+            std::max(memory_per_input_byte,
+                     static_cast<double>(memory_it->second) /
+                         result->input_bytes);
+      }
+      job_finished.notify_one();
+    });
+  }
+  lock.unlock();
+  pool.Wait();
+  return results;
+}
+
+void WriteBatchReport(const std::vector<JobResult>& results,
+                      std::ostream* out) {
+  Json::Value report(Json::arrayValue);
+  for (const JobResult& result : results) {
+    Json::Value job(Json::objectValue);
+    job["status"] = result.status.ok() ? kOkStatus : result.status.message();
+    job["input_bytes"] = Json::Value(Json::Int64(result.input_bytes));
+    job["estimated_memory_bytes"] =
+        Json::Value(Json::Int64(result.estimated_bytes));
+    job["wait_seconds"] = result.wait_seconds;
+    job["run_seconds"] = result.run_seconds;
+    Json::Value& phase_seconds = job["phase_seconds"];
+    phase_seconds = Json::Value(Json::objectValue);
+    for (const auto& phase : result.phase_seconds) {
+      phase_seconds[phase.first] = phase.second;
+    }
+    Json::Value& counters = job["counters"];
+    counters = Json::Value(Json::objectValue);
+    for (const auto& counter : result.counters) {
+      counters[counter.first] = Json::Value(Json::Int64(counter.second));
+    }
+    report.append(job);
+  }
+  Json::StreamWriterBuilder builder;
+  *out << Json::writeString(builder, report) << "\n";
+}
+
+}  // namespace frontend
+}  // namespace morphie
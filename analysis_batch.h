@@ -0,0 +1,113 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A batch runs the analyses of an AnalysisBatch proto in one process, such as
+// the analyses of the timelines of the hundreds of hosts of an incident, so
+// that they share the machine without exhausting its memory. The jobs run on
+// a thread pool with one worker per concurrent job, and each job runs with a
+// frontend::Session of its own.
+//
+// A job is admitted when its estimated memory fits in the memory budget of the
+// batch. The estimated memory of a job is the size of its input files times
+// the memory per input byte. The memory in use is the larger of the estimates
+// of the running jobs and the growth of the resident set size of the process
+// since the batch started, so memory that the estimates miss delays later
+// jobs. A job that does not fit lets later jobs that fit start first, and a
+// job is always admitted if no job is running, so that a job larger than the
+// budget runs alone. When a job that reports the memory of its graph finishes,
+// as the Plaso analyzer does with the counter "memory_bytes", the memory per
+// input byte is raised to the ratio of that memory to the input size of the
+// job if the ratio is larger. The input size of a compressed file is its size
+// on disk.
+//
+// The report of a batch is a JSON array with one object for each job, in the
+// order of the jobs, with the members
+// - "status", which is "OK" or the error message of the job,
+// - "input_bytes" and "estimated_memory_bytes", as described above,
+// - "wait_seconds", the time from the start of the batch to the start of the
+//   job, and "run_seconds", the time that the job ran, and
+// - "phase_seconds" and "counters", as in the stats file of an analysis.
+//
+// Example, with the batch options of 'morphie --batch_options=...'.
+//   jobs { analyzer: "plaso" json_stream_file: "/evidence/host1.jsonl"
+//          output_pb_file: "/out/host1.pb" }
+//   jobs { analyzer: "plaso" json_stream_file: "/evidence/host2.jsonl"
+//          output_pb_file: "/out/host2.pb" }
+//   memory_budget_mib: 32768
+#ifndef LOGLE_ANALYSIS_BATCH_H_
+#define LOGLE_ANALYSIS_BATCH_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "analysis_options.pb.h"
+#include "base/string.h"
+#include "util/status.h"
+
+namespace morphie {
+namespace frontend {
+
+// The outcome and statistics of a job of a batch.
+struct JobResult {
+  JobResult()
+      : input_bytes(0),
+        estimated_bytes(0),
+        wait_seconds(0),
+        run_seconds(0) {}
+
+  util::Status status;
+  int64_t input_bytes;
+  int64_t estimated_bytes;
+  double wait_seconds;
+  double run_seconds;
+  std::map<string, double> phase_seconds;
+  std::map<string, int64_t> counters;
+};
+
+// The sources of the measurements that a batch admits jobs by, and the
+// function that runs a job. The functions are called concurrently from the
+// threads of the batch.
+struct BatchEnvironment {
+  // Returns the resident set size of the process in MiB.
+  std::function<double()> resident_set_size_mib;
+  // Returns the size in bytes of the input files of a job.
+  std::function<int64_t(const AnalysisOptions&)> input_bytes;
+  // Runs a job and records its status and statistics in the result. The
+  // input and estimated bytes and the wait time are set by the batch.
+  std::function<void(const AnalysisOptions&, JobResult*)> run_job;
+};
+
+// Returns the environment that measures the process and the input files, and
+// runs each job with a session of its own.
+BatchEnvironment DefaultBatchEnvironment();
+
+// Runs the jobs of 'batch' and returns their results in the order of the
+// jobs. A job that sets trace_file or profile_allocations is not run and its
+// status is Status::INVALID_ARGUMENT.
+std::vector<JobResult> RunBatch(const AnalysisBatch& batch);
+// Same as above, but measures memory and runs jobs with 'environment'.
+std::vector<JobResult> RunBatch(const AnalysisBatch& batch,
+                                const BatchEnvironment& environment);
+
+// Writes the report of 'results' described above to 'out'.
+void WriteBatchReport(const std::vector<JobResult>& results,
+                      std::ostream* out);
+
+}  // namespace frontend
+}  // namespace morphie
+
+#endif  // LOGLE_ANALYSIS_BATCH_H_
@@ -0,0 +1,179 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analysis_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <map>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace frontend {
+namespace {
+
+const int64_t kBytesPerMiB = 1 << 20;
+
+// Runs the jobs of a batch without analyses. Each job is named by its
+// csv_file, has the input size given to AddJob, and records how many jobs
+// were running and how many had finished when it started. A job waits until
+// 'num_to_wait_for' jobs have started, or for at most 200 milliseconds, so
+// that jobs that are admitted together overlap.
+class FakeJobs {
+ public:
+  FakeJobs() : num_to_wait_for(1), num_running_(0), max_running_(0) {}
+
+  void AddJob(const string& name, int64_t input_mib, AnalysisBatch* batch) {
+    batch->add_jobs()->set_csv_file(name);
+    input_bytes_[name] = input_mib * kBytesPerMiB;
+  }
+
+  BatchEnvironment Environment() {
+    BatchEnvironment environment;
+    environment.resident_set_size_mib = [] { return 0.0; };
+    environment.input_bytes = [this](const AnalysisOptions& options) {
+      return input_bytes_.at(options.csv_file());
+    };
+    environment.run_job = [this](const AnalysisOptions& options,
+                                 JobResult* result) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++num_running_;
+      max_running_ = std::max(max_running_, num_running_);
+      finished_before_start_[options.csv_file()] =
+          static_cast<int>(finished_.size());
+      running_changed_.notify_all();
+      running_changed_.wait_for(lock, std::chrono::milliseconds(200), [this] {
+        return num_running_ + static_cast<int>(finished_.size()) >=
+               num_to_wait_for;
+      });
+      --num_running_;
+      finished_.push_back(options.csv_file());
+      result->status = util::Status::OK;
+    };
+    return environment;
+  }
+
+  int MaxRunning() const { return max_running_; }
+  int FinishedBeforeStart(const string& name) const {
+    return finished_before_start_.at(name);
+  }
+
+  int num_to_wait_for;
+
+ private:
+  std::map<string, int64_t> input_bytes_;
+  std::mutex mutex_;
+  std::condition_variable running_changed_;
+  int num_running_;
+  int max_running_;
+  std::vector<string> finished_;
+  std::map<string, int> finished_before_start_;
+};
+
+TEST(AnalysisBatchTest, AdmitsJobsUnderBudget) {
+  FakeJobs jobs;
+  AnalysisBatch batch;
+  jobs.AddJob("a", 10, &batch);
+  jobs.AddJob("b", 10, &batch);
+  jobs.AddJob("c", 10, &batch);
+  batch.set_memory_budget_mib(100);
+  batch.set_memory_per_input_byte(2);
+  batch.set_max_concurrent_jobs(3);
+  jobs.num_to_wait_for = 3;
+  std::vector<JobResult> results = RunBatch(batch, jobs.Environment());
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ(3, jobs.MaxRunning());
+  for (const JobResult& result : results) {
+    EXPECT_TRUE(result.status.ok());
+    EXPECT_EQ(10 * kBytesPerMiB, result.input_bytes);
+    EXPECT_EQ(20 * kBytesPerMiB, result.estimated_bytes);
+  }
+}
+
+TEST(AnalysisBatchTest, DefersJobsOverBudget) {
+  FakeJobs jobs;
+  AnalysisBatch batch;
+  jobs.AddJob("a", 10, &batch);
+  jobs.AddJob("b", 10, &batch);
+  jobs.AddJob("c", 10, &batch);
+  batch.set_memory_budget_mib(25);
+  batch.set_memory_per_input_byte(1);
+  batch.set_max_concurrent_jobs(3);
+  jobs.num_to_wait_for = 2;
+  std::vector<JobResult> results = RunBatch(batch, jobs.Environment());
+  ASSERT_EQ(3, results.size());
+  // Two jobs fit in the budget and the third waits for one of them.
+  EXPECT_EQ(2, jobs.MaxRunning());
+  EXPECT_EQ(0, jobs.FinishedBeforeStart("a"));
+  EXPECT_EQ(0, jobs.FinishedBeforeStart("b"));
+  EXPECT_LE(1, jobs.FinishedBeforeStart("c"));
+}
+
+TEST(AnalysisBatchTest, DefersJobsWhenResidentSetGrows) {
+  FakeJobs jobs;
+  AnalysisBatch batch;
+  jobs.AddJob("a", 10, &batch);
+  jobs.AddJob("b", 10, &batch);
+  batch.set_memory_budget_mib(100);
+  batch.set_memory_per_input_byte(1);
+  batch.set_max_concurrent_jobs(2);
+  BatchEnvironment environment = jobs.Environment();
+  // The resident set grows by 95 MiB after the batch starts, until the first
+  // job finishes, which is more than the estimates of the running jobs.
+  std::atomic<int> num_calls(0);
+  std::atomic<bool> is_first_job_done(false);
+  environment.resident_set_size_mib = [&num_calls, &is_first_job_done] {
+    return num_calls++ == 0 || is_first_job_done ? 0.0 : 95.0;
+  };
+  const auto run_job = environment.run_job;
+  environment.run_job = [&run_job, &is_first_job_done](
+                            const AnalysisOptions& options,
+                            JobResult* result) {
+    run_job(options, result);
+    if (options.csv_file() == "a") {
+      is_first_job_done = true;
+    }
+  };
+  std::vector<JobResult> results = RunBatch(batch, environment);
+  ASSERT_EQ(2, results.size());
+  EXPECT_EQ(1, jobs.MaxRunning());
+  EXPECT_EQ(1, jobs.FinishedBeforeStart("b"));
+}
+
+TEST(AnalysisBatchTest, RunsJobLargerThanBudgetAlone) {
+  FakeJobs jobs;
+  AnalysisBatch batch;
+  jobs.AddJob("large", 50, &batch);
+  jobs.AddJob("small", 5, &batch);
+  batch.set_memory_budget_mib(10);
+  batch.set_memory_per_input_byte(1);
+  batch.set_max_concurrent_jobs(2);
+  jobs.num_to_wait_for = 2;
+  std::vector<JobResult> results = RunBatch(batch, jobs.Environment());
+  ASSERT_EQ(2, results.size());
+  EXPECT_TRUE(results[0].status.ok());
+  EXPECT_EQ(50 * kBytesPerMiB, results[0].estimated_bytes);
+  EXPECT_EQ(1, jobs.MaxRunning());
+  EXPECT_EQ(0, jobs.FinishedBeforeStart("large"));
+  EXPECT_EQ(1, jobs.FinishedBeforeStart("small"));
+}
+
+}  // namespace
+}  // namespace frontend
+}  // namespace morphie
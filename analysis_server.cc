@@ -0,0 +1,168 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analysis_server.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <google/protobuf/text_format.h>
+
+#include "analysis_options.pb.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+namespace frontend {
+
+namespace {
+
+const char kQuitRequest[] = "quit";
+const char kOkReply[] = "OK";
+const char kRequestErr[] =
+    "The request must have the format of an AnalysisOptions proto.";
+const char kReadErr[] = "Error reading the request.";
+const char kSocketPathErr[] = "The socket path is too long: ";
+const char kSocketErr[] = "Error creating socket: ";
+
+// The number of connections that may wait while a request is answered.
+const int kBacklog = 16;
+const int kReadBufferSize = 4096;
+
+// Reads from 'fd' into 'contents' until the peer shuts down its side of the
+// connection. Returns false if reading fails.
+bool ReadAll(int fd, string* contents) {
+  char buffer[kReadBufferSize];
+  while (true) {
+    ssize_t num_read = read(fd, buffer, sizeof(buffer));
+    if (num_read == 0) {
+      return true;
+    }
+    if (num_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    contents->append(buffer, num_read);
+  }
+}
+
+// Writes 'contents' to 'fd'. A reply that cannot be written is dropped, since
+// the client that would read it is gone, and MSG_NOSIGNAL keeps a closed
+// connection from killing the server with SIGPIPE.
+void WriteAll(int fd, const string& contents) {
+  size_t num_written = 0;
+  while (num_written < contents.size()) {
+    ssize_t num_bytes = send(fd, contents.data() + num_written,
+                             contents.size() - num_written, MSG_NOSIGNAL);
+    if (num_bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    num_written += num_bytes;
+  }
+}
+
+// Returns true if 'request' is "quit", surrounded by any whitespace.
+bool IsQuitRequest(const string& request) {
+  const char kWhitespace[] = " \t\r\n";
+  size_t begin = request.find_first_not_of(kWhitespace);
+  if (begin == string::npos) {
+    return false;
+  }
+  size_t end = request.find_last_not_of(kWhitespace);
+  return request.compare(begin, end + 1 - begin, kQuitRequest) == 0;
+}
+
+util::Status SocketError(const string& socket_path) {
+  return util::Status(Code::EXTERNAL,
+                      util::StrCat(kSocketErr, socket_path, ": ",
+                                   std::strerror(errno)));
+}
+
+}  // namespace
+
+string HandleRequest(const string& request, Session* session, bool* quit) {
+  *quit = IsQuitRequest(request);
+  if (*quit) {
+    return util::StrCat(kOkReply, "\n");
+  }
+  AnalysisOptions options;
+  if (!google::protobuf::TextFormat::ParseFromString(request, &options)) {
+    return util::StrCat(kRequestErr, "\n");
+  }
+  util::Status status = session->Run(options);
+  return util::StrCat(status.ok() ? kOkReply : status.message(), "\n");
+}
+
+util::Status Serve(const string& socket_path, Session* session) {
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kSocketPathErr, socket_path));
+  }
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+  int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server_fd < 0) {
+    return SocketError(socket_path);
+  }
+  // A socket left behind by a server that did not stop cleanly would make
+  // bind() fail. Other files are left alone and bind() fails on them.
+  struct stat file_status;
+  if (stat(socket_path.c_str(), &file_status) == 0 &&
+      S_ISSOCK(file_status.st_mode)) {
+    unlink(socket_path.c_str());
+  }
+  if (bind(server_fd, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) < 0 ||
+      listen(server_fd, kBacklog) < 0) {
+    util::Status status = SocketError(socket_path);
+    close(server_fd);
+    return status;
+  }
+  util::Status status = util::Status::OK;
+  bool quit = false;
+  while (!quit) {
+    int client_fd = accept(server_fd, nullptr, nullptr);
+    if (client_fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      status = SocketError(socket_path);
+      break;
+    }
+    string request;
+    string reply = ReadAll(client_fd, &request)
+                       ? HandleRequest(request, session, &quit)
+                       : util::StrCat(kReadErr, "\n");
+    WriteAll(client_fd, reply);
+    close(client_fd);
+  }
+  close(server_fd);
+  unlink(socket_path.c_str());
+  return status;
+}
+
+}  // namespace frontend
+}  // namespace morphie
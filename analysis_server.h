@@ -0,0 +1,56 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// An analysis server answers analysis requests on a local socket with one
+// frontend::Session, so that the graph built for a timeline stays in memory
+// between requests. A request is an AnalysisOptions proto in the text format,
+// which the client writes to a new connection before shutting down its side of
+// the connection. The server replies with "OK" or with the error message of
+// the analysis, followed by a newline, and closes the connection. Output files
+// are written by the server as they are by a single analysis. The request
+// "quit" stops the server. Requests are answered one at a time.
+//
+// Example, with the server started by 'morphie --server_socket=/tmp/morphie'.
+//   echo 'analyzer: "plaso" json_stream_file: "/evidence/events.jsonl"
+//         output_dot_file: "/tmp/a.dot"
+//         neighborhood { seed_tags: "URL" max_hops: 1 }' |
+//       nc -N -U /tmp/morphie
+#ifndef LOGLE_ANALYSIS_SERVER_H_
+#define LOGLE_ANALYSIS_SERVER_H_
+
+#include "base/string.h"
+#include "frontend.h"
+#include "util/status.h"
+
+namespace morphie {
+namespace frontend {
+
+// Runs the analysis in 'request' with 'session' and returns the reply to the
+// request. Sets 'quit' to true if the request stops the server and to false
+// otherwise.
+string HandleRequest(const string& request, Session* session, bool* quit);
+
+// Listens on a Unix domain socket at 'socket_path' and answers requests with
+// 'session' until a request stops the server. A socket at 'socket_path' is
+// replaced, and the socket is removed when the server stops. Returns
+// - Status::INVALID_ARGUMENT - if 'socket_path' is too long for a socket.
+// - Status::EXTERNAL - if the socket cannot be created or accept connections,
+//   or if 'socket_path' is a file that is not a socket.
+// - Status::OK - otherwise.
+util::Status Serve(const string& socket_path, Session* session);
+
+}  // namespace frontend
+}  // namespace morphie
+
+#endif  // LOGLE_ANALYSIS_SERVER_H_
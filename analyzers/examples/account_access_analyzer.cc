@@ -19,15 +19,19 @@
 #include <algorithm>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "analyzers/examples/account_access_defs.h"
 #include "base/vector.h"
 #include "util/logging.h"
 #include "util/string_utils.h"
+#include "util/trace.h"
 
 namespace {
 
 const int kMaxMalformedLines = 1000000;
+// The number of lines read from a block CSV parser at a time.
+const size_t kBatchSize = 4096;
 const char kNullAccessGraphErr[] = "The access graph is null.";
 
 }  // namespace
@@ -42,7 +46,7 @@ util::Status AccessAnalyzer::Initialize(
   if (row_it == csv_parser_->end()) {
     return util::Status(Code::INVALID_ARGUMENT, "The input is empty.");
   }
-  util::Status status = InitializeFieldMap();
+  util::Status status = InitializeFieldMap(row_it->fields());
   if (!status.ok()) {
     return status;
   }
@@ -53,6 +57,44 @@ util::Status AccessAnalyzer::Initialize(
   return util::Status::OK;
 }
 
+// The parser is left at the first line of data, which is where graph
+// construction begins.
+util::Status AccessAnalyzer::Initialize(
+    std::unique_ptr<util::BlockCSVParser> parser) {
+  block_parser_ = std::move(parser);
+  if (!block_parser_->Next()) {
+    return util::Status(Code::INVALID_ARGUMENT, "The input is empty.");
+  }
+  std::vector<string> field_names;
+  for (util::CSVField field : block_parser_->fields()) {
+    field_names.push_back(util::ToString(field));
+  }
+  util::Status status = InitializeFieldMap(field_names);
+  if (!status.ok()) {
+    return status;
+  }
+  if (!block_parser_->Next()) {
+    return util::Status(Code::INVALID_ARGUMENT, "No data in the input.");
+  }
+  return util::Status::OK;
+}
+
+util::Status AccessAnalyzer::Initialize(
+    std::unique_ptr<util::ParallelCSVParser> parser) {
+  parallel_parser_ = std::move(parser);
+  if (!parallel_parser_->HasHeader()) {
+    return util::Status(Code::INVALID_ARGUMENT, "The input is empty.");
+  }
+  util::Status status = InitializeFieldMap(parallel_parser_->header());
+  if (!status.ok()) {
+    return status;
+  }
+  if (!parallel_parser_->HasMoreLines()) {
+    return util::Status(Code::INVALID_ARGUMENT, "No data in the input.");
+  }
+  return util::Status::OK;
+}
+
 int AccessAnalyzer::NumGraphNodes() const {
   CHECK(access_graph_ != nullptr, kNullAccessGraphErr);
   return access_graph_->NumNodes();
@@ -64,7 +106,9 @@ int AccessAnalyzer::NumGraphEdges() const {
 }
 
 util::Status AccessAnalyzer::BuildAccessGraph() {
-  if (csv_parser_ == nullptr) {
+  util::ScopedSpan span("BuildAccessGraph");
+  if (csv_parser_ == nullptr && block_parser_ == nullptr &&
+      parallel_parser_ == nullptr) {
     return util::Status(Code::INVALID_ARGUMENT,
                         "The CSV parser has not been initialized.");
   }
@@ -73,35 +117,110 @@ util::Status AccessAnalyzer::BuildAccessGraph() {
                         "The access graph has already been created.");
   }
   access_graph_.reset(new AccountAccessGraph);
-  util::Status status = access_graph_->Initialize();
+  util::Status status = access_graph_->Initialize(mode_);
   if (!status.ok()) {
     access_graph_.reset(nullptr);
     return status;
   }
-  for (const util::Record& record : *csv_parser_) {
-    ++num_lines_read_;
-    if (record.fields().size() != field_to_index_.size()) {
-      IncrementSkipCounter();
-      continue;
+  if (parallel_parser_ != nullptr) {
+    BuildFromParallelParser();
+  } else if (block_parser_ != nullptr) {
+    BuildFromBlockParser();
+  } else {
+    for (const util::Record& record : *csv_parser_) {
+      ++num_lines_read_;
+      const bool is_skipped =
+          record.fields().size() != field_to_index_.size();
+      if (progress_ != nullptr) {
+        progress_->AddLines(1, 0, is_skipped ? 1 : 0);
+      }
+      if (is_skipped) {
+        IncrementSkipCounter();
+        continue;
+      }
+      access_graph_->ProcessAccessData(*columns_, record.fields());
+      UpdateProgressGraphSize();
     }
-    access_graph_->ProcessAccessData(field_to_index_, record.fields());
   }
+  access_graph_->AddAggregatedEdges();
+  UpdateProgressGraphSize();
   return util::Status::OK;
 }
 
+void AccessAnalyzer::BuildFromBlockParser() {
+  // Initialize has already parsed the first line of data.
+  ++num_lines_read_;
+  util::Span<util::CSVField> fields = block_parser_->fields();
+  const bool is_skipped = fields.size() != field_to_index_.size();
+  if (progress_ != nullptr) {
+    progress_->AddLines(1, 0, is_skipped ? 1 : 0);
+  }
+  if (is_skipped) {
+    IncrementSkipCounter();
+  } else {
+    access_graph_->ProcessCSVFields(*columns_, fields);
+  }
+  util::RecordBatch batch(field_to_index_.size());
+  while (size_t num_lines = block_parser_->NextBatch(kBatchSize, &batch)) {
+    num_lines_read_ += static_cast<int>(num_lines);
+    if (progress_ != nullptr) {
+      progress_->AddLines(num_lines, 0, batch.NumSkipped());
+    }
+    for (size_t i = 0; i < batch.NumSkipped(); ++i) {
+      IncrementSkipCounter();
+    }
+    access_graph_->ProcessAccessBatch(*columns_, batch);
+    UpdateProgressGraphSize();
+  }
+}
+
+// The threads of the parser tokenize chunks of the file in parallel, and the
+// batches are added to the graph on this thread in file order, so that nodes
+// and edges are numbered as with the other parsers.
+void AccessAnalyzer::BuildFromParallelParser() {
+  const size_t num_columns = field_to_index_.size();
+  parallel_parser_->Start(num_columns);
+  util::RecordBatch batch(num_columns);
+  while (parallel_parser_->NextBatch(&batch)) {
+    const size_t num_lines = batch.NumRows() + batch.NumSkipped();
+    num_lines_read_ += static_cast<int>(num_lines);
+    if (progress_ != nullptr) {
+      progress_->AddLines(num_lines, 0, batch.NumSkipped());
+    }
+    for (size_t i = 0; i < batch.NumSkipped(); ++i) {
+      IncrementSkipCounter();
+    }
+    access_graph_->ProcessAccessBatch(*columns_, batch);
+    UpdateProgressGraphSize();
+  }
+}
+
 string AccessAnalyzer::AccessGraphAsDot() const {
   return (access_graph_ == nullptr) ? "" : access_graph_->ToDot();
 }
 
+void AccessAnalyzer::WriteAccessGraphDot(std::ostream* out) const {
+  if (access_graph_ != nullptr) {
+    access_graph_->WriteDot(out);
+  }
+}
+
+void AccessAnalyzer::UpdateProgressGraphSize() {
+  if (progress_ != nullptr) {
+    progress_->SetGraphSize(access_graph_->NumNodes(),
+                            access_graph_->NumEdges());
+  }
+}
+
 void AccessAnalyzer::IncrementSkipCounter() {
   ++num_lines_skipped_;
   CHECK(num_lines_skipped_ < kMaxMalformedLines,
-        util::StrCat("Over ", std::to_string(kMaxMalformedLines),
+        util::StrCat("Over ", kMaxMalformedLines,
                      " malformed lines in input. Aborting."));
 }
 
-util::Status AccessAnalyzer::InitializeFieldMap() {
-  const std::vector<string>& field_names = csv_parser_->begin()->fields();
+util::Status AccessAnalyzer::InitializeFieldMap(
+    const std::vector<string>& field_names) {
   if (field_names.empty()) {
     return util::Status(Code::INVALID_ARGUMENT, "First line has no columns.");
   }
@@ -111,8 +230,7 @@ util::Status AccessAnalyzer::InitializeFieldMap() {
     if (field_name.empty()) {
       return util::Status(
           Code::INVALID_ARGUMENT,
-          util::StrCat("Column number ", std::to_string(index + 1),
-                       " has no name."));
+          util::StrCat("Column number ", index + 1, " has no name."));
     }
     auto insert_status = field_to_index_.insert({field_name, index});
     if (!insert_status.second) {
@@ -135,6 +253,7 @@ util::Status AccessAnalyzer::InitializeFieldMap() {
         Code::INVALID_ARGUMENT,
         util::StrCat("The following required fields are missing: ", fields));
   }
+  columns_.reset(new AccessColumns(field_to_index_));
   return util::Status::OK;
 }
 
@@ -20,11 +20,15 @@
 #define LOGLE_ACCOUNT_ACCESS_ANALYZER_H_
 
 #include <memory>
+#include <ostream>
 #include <unordered_map>
+#include <vector>
 
 #include "analyzers/examples/account_access_graph.h"
 #include "base/string.h"
 #include "util/csv.h"
+#include "util/parallel_csv.h"
+#include "util/progress.h"
 #include "util/status.h"
 
 namespace morphie {
@@ -33,7 +37,17 @@ namespace morphie {
 // present in the CSV input are defined in account_access_defs.h.
 class AccessAnalyzer {
  public:
-  AccessAnalyzer() : num_lines_read_(0), num_lines_skipped_(0) {}
+  AccessAnalyzer()
+      : mode_(AccessEdgeMode::kPerCount),
+        num_lines_read_(0),
+        num_lines_skipped_(0),
+        progress_(nullptr) {}
+  // Creates an analyzer whose access graph creates edges in the mode 'mode'.
+  explicit AccessAnalyzer(AccessEdgeMode mode)
+      : mode_(mode),
+        num_lines_read_(0),
+        num_lines_skipped_(0),
+        progress_(nullptr) {}
 
   // Initializes the analyzer using a CSV parser. Returns
   //  * OK : if the following requirements are satisfied.
@@ -42,8 +56,24 @@ class AccessAnalyzer {
   //  * INVALID_ARGUMENT : otherwise with the error message containing the
   //  reason why initialization failed.
   util::Status Initialize(std::unique_ptr<util::CSVParser> parser);
+  // Initializes the analyzer using a block CSV parser, with the same
+  // requirements as above. Graph construction with this parser does not copy
+  // fields that are not used in the graph, which makes it the faster choice
+  // for large inputs.
+  util::Status Initialize(std::unique_ptr<util::BlockCSVParser> parser);
+  // Initializes the analyzer using a parallel CSV parser, with the same
+  // requirements as above. The file is tokenized by the threads of the parser
+  // and lines are added to the graph in file order, so the graph is the same
+  // as with the other parsers.
+  //  * Requires that 'parser' has been initialized successfully.
+  util::Status Initialize(std::unique_ptr<util::ParallelCSVParser> parser);
 
   util::Status BuildAccessGraph();
+  // If 'progress' is not null, BuildAccessGraph() adds the lines it reads and
+  // skips to 'progress' while it builds the graph. The size of the graph is
+  // set after each line or batch. Bytes are not counted. Must be called
+  // before BuildAccessGraph().
+  void SetProgress(util::ProgressCounters* progress) { progress_ = progress; }
 
   // Utilities for accounting and error checking.
   int NumLinesRead() const { return num_lines_read_; }
@@ -57,19 +87,39 @@ class AccessAnalyzer {
 
   // Returns the account access graph in GraphViz DOT format.
   string AccessGraphAsDot() const;
+  // Writes the string returned by AccessGraphAsDot() to 'out' incrementally.
+  void WriteAccessGraphDot(std::ostream* out) const;
 
  private:
   void IncrementSkipCounter();
-  // Initializes field_to_index_ using the first line of csv_parser_.
-  util::Status InitializeFieldMap();
+  // Sets the size of the access graph in the progress counters, if any.
+  void UpdateProgressGraphSize();
+  // Builds the access graph from the lines of 'block_parser_'.
+  void BuildFromBlockParser();
+  // Builds the access graph from the batches of 'parallel_parser_', in file
+  // order.
+  void BuildFromParallelParser();
+  // Initializes field_to_index_ from the names in the header of the input,
+  // and compiles the positions of the fields that occur in labels into
+  // columns_.
+  util::Status InitializeFieldMap(const std::vector<string>& field_names);
 
   // A map from input field names to the input column with that data.
   unordered_map<string, int> field_to_index_;
+  // The positions of the fields that occur in labels. Rows are processed
+  // using these positions instead of looking up field names.
+  std::unique_ptr<const AccessColumns> columns_;
   std::unique_ptr<AccountAccessGraph> access_graph_;
+  AccessEdgeMode mode_;
 
   int num_lines_read_;
   int num_lines_skipped_;
+  // Not owned. Null if progress is not reported.
+  util::ProgressCounters* progress_;
+  // At most one of the parsers below is not null.
   std::unique_ptr<util::CSVParser> csv_parser_;
+  std::unique_ptr<util::BlockCSVParser> block_parser_;
+  std::unique_ptr<util::ParallelCSVParser> parallel_parser_;
 };
 
 }  // namespace morphie
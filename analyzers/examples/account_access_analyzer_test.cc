@@ -14,10 +14,16 @@
 
 #include "analyzers/examples/account_access_analyzer.h"
 
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
 #include <sstream>
 
 #include "gtest.h"
 #include "util/csv.h"
+#include "util/parallel_csv.h"
+#include "util/progress.h"
 #include "util/status.h"
 #include "util/string_utils.h"
 
@@ -30,6 +36,11 @@ void TestCSVInitialization(const char* kInput, Code code) {
   AccessAnalyzer access_analyzer;
   util::Status s = access_analyzer.Initialize(std::move(parser));
   EXPECT_EQ(code, s.code());
+  std::unique_ptr<util::BlockCSVParser> block_parser(
+      new util::BlockCSVParser(new std::stringstream(kInput)));
+  AccessAnalyzer block_analyzer;
+  s = block_analyzer.Initialize(std::move(block_parser));
+  EXPECT_EQ(code, s.code());
 }
 
 void TestInvalidCSVInitialization(const char* kInput) {
@@ -88,6 +99,40 @@ void TestGraphConstruction(const char* kInput, int num_nodes, int num_edges) {
   EXPECT_EQ(num_edges, access_analyzer.NumGraphEdges())
       << "Error when processing :\n"
       << kInput;
+  // The block parser produces the same graph.
+  std::unique_ptr<util::BlockCSVParser> block_parser(
+      new util::BlockCSVParser(new std::stringstream(kInput)));
+  AccessAnalyzer block_analyzer;
+  ASSERT_TRUE(block_analyzer.Initialize(std::move(block_parser)).ok());
+  ASSERT_TRUE(block_analyzer.BuildAccessGraph().ok());
+  EXPECT_EQ(access_analyzer.AccessGraphAsDot(),
+            block_analyzer.AccessGraphAsDot());
+  EXPECT_EQ(access_analyzer.NumLinesSkipped(),
+            block_analyzer.NumLinesSkipped());
+  // So does the parallel parser, with chunks of a few bytes, on any number of
+  // threads.
+  char filename[] = "/tmp/account_access_analyzer_test_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  std::ofstream file(filename);
+  file << kInput;
+  file.close();
+  for (int num_threads : {1, 3}) {
+    std::unique_ptr<util::ParallelCSVParser> parallel_parser(
+        new util::ParallelCSVParser(',', num_threads, 8));
+    ASSERT_TRUE(parallel_parser->Initialize(filename).ok());
+    AccessAnalyzer parallel_analyzer;
+    ASSERT_TRUE(parallel_analyzer.Initialize(std::move(parallel_parser)).ok());
+    ASSERT_TRUE(parallel_analyzer.BuildAccessGraph().ok());
+    EXPECT_EQ(num_nodes, parallel_analyzer.NumGraphNodes());
+    EXPECT_EQ(num_edges, parallel_analyzer.NumGraphEdges());
+    EXPECT_EQ(access_analyzer.NumLinesSkipped(),
+              parallel_analyzer.NumLinesSkipped());
+    EXPECT_EQ(access_analyzer.AccessGraphAsDot(),
+              parallel_analyzer.AccessGraphAsDot());
+  }
+  unlink(filename);
 }
 
 TEST(AccessAnalyzerTest, TestGraphConstruction) {
@@ -102,5 +147,106 @@ TEST(AccessAnalyzerTest, TestGraphConstruction) {
   TestGraphConstruction(util::StrCat(header, content1, content2).c_str(), 3, 2);
 }
 
+// In the aggregated mode, repeated accesses with different counts give one
+// edge for each actor and user, with every parser.
+TEST(AccessAnalyzerTest, AggregatesRepeatedAccesses) {
+  string content = util::StrCat(
+      header, "\nabc@xyz.tuv,def@tuv.xyz,Alpha,None,1,2,3,Engineer",
+      "\nabc@xyz.tuv,def@tuv.xyz,Alpha,None,1,2,4,Engineer",
+      "\nabc@xyz.tuv,ghi@tuv.xyz,Alpha,None,1,2,5,Engineer");
+  AccessAnalyzer per_count_analyzer;
+  ASSERT_TRUE(per_count_analyzer
+                  .Initialize(std::unique_ptr<util::CSVParser>(
+                      new util::CSVParser(new std::stringstream(content))))
+                  .ok());
+  ASSERT_TRUE(per_count_analyzer.BuildAccessGraph().ok());
+  EXPECT_EQ(3, per_count_analyzer.NumGraphEdges());
+  AccessAnalyzer csv_analyzer(AccessEdgeMode::kAggregated);
+  ASSERT_TRUE(csv_analyzer
+                  .Initialize(std::unique_ptr<util::CSVParser>(
+                      new util::CSVParser(new std::stringstream(content))))
+                  .ok());
+  ASSERT_TRUE(csv_analyzer.BuildAccessGraph().ok());
+  EXPECT_EQ(3, csv_analyzer.NumGraphNodes());
+  EXPECT_EQ(2, csv_analyzer.NumGraphEdges());
+  AccessAnalyzer block_analyzer(AccessEdgeMode::kAggregated);
+  ASSERT_TRUE(block_analyzer
+                  .Initialize(std::unique_ptr<util::BlockCSVParser>(
+                      new util::BlockCSVParser(new std::stringstream(content))))
+                  .ok());
+  ASSERT_TRUE(block_analyzer.BuildAccessGraph().ok());
+  EXPECT_EQ(csv_analyzer.AccessGraphAsDot(), block_analyzer.AccessGraphAsDot());
+  char filename[] = "/tmp/account_access_analyzer_test_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  std::ofstream file(filename);
+  file << content;
+  file.close();
+  std::unique_ptr<util::ParallelCSVParser> parallel_parser(
+      new util::ParallelCSVParser(',', 3, 8));
+  ASSERT_TRUE(parallel_parser->Initialize(filename).ok());
+  AccessAnalyzer parallel_analyzer(AccessEdgeMode::kAggregated);
+  ASSERT_TRUE(parallel_analyzer.Initialize(std::move(parallel_parser)).ok());
+  ASSERT_TRUE(parallel_analyzer.BuildAccessGraph().ok());
+  EXPECT_EQ(3, parallel_analyzer.NumGraphNodes());
+  EXPECT_EQ(2, parallel_analyzer.NumGraphEdges());
+  unlink(filename);
+}
+
+// The progress counters agree with the analyzer's counters and the graph.
+TEST(AccessAnalyzerTest, CountsProgress) {
+  string content = util::StrCat(
+      header, "\nabc@xyz.tuv,def@tuv.xyz,Alpha,None,1,2,3,Engineer",
+      "\nabc@xyz.tuv,def@tuv.xyz,Alpha",
+      "\nabc@xyz.tuv,ghi@tuv.xyz,Alpha,None,1,2,5,Engineer");
+  util::ProgressCounters csv_progress;
+  AccessAnalyzer csv_analyzer;
+  ASSERT_TRUE(csv_analyzer
+                  .Initialize(std::unique_ptr<util::CSVParser>(
+                      new util::CSVParser(new std::stringstream(content))))
+                  .ok());
+  csv_analyzer.SetProgress(&csv_progress);
+  ASSERT_TRUE(csv_analyzer.BuildAccessGraph().ok());
+  EXPECT_EQ(3, csv_progress.lines_read.load());
+  EXPECT_EQ(1, csv_progress.lines_skipped.load());
+  EXPECT_EQ(csv_analyzer.NumGraphNodes(), csv_progress.nodes.load());
+  EXPECT_EQ(csv_analyzer.NumGraphEdges(), csv_progress.edges.load());
+  util::ProgressCounters block_progress;
+  AccessAnalyzer block_analyzer;
+  ASSERT_TRUE(block_analyzer
+                  .Initialize(std::unique_ptr<util::BlockCSVParser>(
+                      new util::BlockCSVParser(new std::stringstream(content))))
+                  .ok());
+  block_analyzer.SetProgress(&block_progress);
+  ASSERT_TRUE(block_analyzer.BuildAccessGraph().ok());
+  EXPECT_EQ(block_analyzer.NumLinesRead(), block_progress.lines_read.load());
+  EXPECT_EQ(block_analyzer.NumLinesSkipped(),
+            block_progress.lines_skipped.load());
+  EXPECT_EQ(block_analyzer.NumGraphEdges(), block_progress.edges.load());
+  char filename[] = "/tmp/account_access_analyzer_test_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  std::ofstream file(filename);
+  file << content;
+  file.close();
+  std::unique_ptr<util::ParallelCSVParser> parallel_parser(
+      new util::ParallelCSVParser(',', 3, 8));
+  ASSERT_TRUE(parallel_parser->Initialize(filename).ok());
+  util::ProgressCounters parallel_progress;
+  AccessAnalyzer parallel_analyzer;
+  ASSERT_TRUE(parallel_analyzer.Initialize(std::move(parallel_parser)).ok());
+  parallel_analyzer.SetProgress(&parallel_progress);
+  ASSERT_TRUE(parallel_analyzer.BuildAccessGraph().ok());
+  EXPECT_EQ(parallel_analyzer.NumLinesRead(),
+            parallel_progress.lines_read.load());
+  EXPECT_EQ(parallel_analyzer.NumLinesSkipped(),
+            parallel_progress.lines_skipped.load());
+  EXPECT_EQ(parallel_analyzer.NumGraphNodes(), parallel_progress.nodes.load());
+  EXPECT_EQ(parallel_analyzer.NumGraphEdges(), parallel_progress.edges.load());
+  unlink(filename);
+}
+
 }  // namespace
 }  // namespace morphie
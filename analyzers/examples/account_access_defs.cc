@@ -23,6 +23,8 @@ const char kActorManager[] = "attr_actor_manager";
 const char kActorTitle[] = "attr_actor_title";
 const char kNumAccesses[] = "attr_count";
 const char kUser[] = "tox";
+const char kFirstAccess[] = "attr_first_access";
+const char kLastAccess[] = "attr_last_access";
 
 }  // namespace access
 }  // namespace morphie
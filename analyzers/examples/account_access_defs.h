@@ -36,6 +36,10 @@ extern const char kActorTitle[];
 extern const char kNumAccesses[];
 // The account that is accessed.
 extern const char kUser[];
+// The optional times of the first and last access in a row, as RFC3339
+// timestamps. A row with only a first access time has accesses at one time.
+extern const char kFirstAccess[];
+extern const char kLastAccess[];
 
 }  // namespace access
 }  // namespace morphie
@@ -14,16 +14,20 @@
 
 #include "analyzers/examples/account_access_graph.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <unordered_map>
+#include <utility>
 
 #include "analyzers/examples/account_access_defs.h"
+#include "graph/ast.h"
 #include "graph/dot_printer.h"
 #include "graph/type.h"
 #include "graph/type_checker.h"
 #include "graph/value.h"
 #include "util/logging.h"
 #include "util/string_utils.h"
+#include "util/time_utils.h"
 
 namespace {
 // These declarations are required because the using declaration in
@@ -34,31 +38,35 @@ using std::unordered_map;
 // Error messages.
 const char kInitializationErr[] = "The graph is not initialized.";
 const char kNoTagErr[] = "The graph has no type tagged :";
+const char kRowSizeErr[] = "The row has too few fields.";
+const char kNullSummariesErr[] = "The access summaries are null.";
 
 // Tags and names for components of labels.
 const char kActorTag[] = "Actor";
 const char kAccessEdgeTag[] = "Access";
 const char kAccessGraphTag[] = "Access Graph";
 const char kCount[] = "Count";
+const char kFirstAccess[] = "FirstAccess";
+const char kLastAccess[] = "LastAccess";
 const char kManager[] = "Manager";
 const char kTitle[] = "Title";
 const char kUserTag[] = "User";
 
-// Returns the entry in 'fields' containing data for 'field_name'. The 'CHECK'
-// statements here are the main input validation checks.
-string GetField(const string& field_name,
+// Returns the position of 'field_name' in a row, or -1 if the field is
+// optional and absent. The 'CHECK' statements here are the main input
+// validation checks.
+int GetPosition(const string& field_name,
                 const unordered_map<string, int>& field_index,
-                const std::vector<string>& fields) {
+                bool is_required) {
   const auto field_it = field_index.find(field_name);
-  morphie::CHECK(
-      field_it != field_index.end(),
-      (morphie::util::StrCat("No field named ", field_name, " in input.")));
-  morphie::CHECK(0 <= field_it->second,
-               (morphie::util::StrCat("Index of ", field_name, " is negative.")));
-  morphie::CHECK(
-      static_cast<int>(fields.size()) > field_it->second,
-      (morphie::util::StrCat("Index of ", field_name, " exceeds bounds.")));
-  return fields[field_it->second];
+  if (field_it == field_index.end() && !is_required) {
+    return -1;
+  }
+  CHECK(field_it != field_index.end(),
+        (morphie::util::StrCat("No field named ", field_name, " in input.")));
+  CHECK(0 <= field_it->second,
+        (morphie::util::StrCat("Index of ", field_name, " is negative.")));
+  return field_it->second;
 }
 
 }  // namespace
@@ -68,21 +76,67 @@ namespace morphie {
 namespace type = ast::type;
 namespace value = ast::value;
 
+AccessColumns::AccessColumns(const unordered_map<string, int>& field_index) {
+  positions_[kActorField] = GetPosition(access::kActor, field_index, true);
+  positions_[kTitleField] =
+      GetPosition(access::kActorTitle, field_index, true);
+  positions_[kManagerField] =
+      GetPosition(access::kActorManager, field_index, false);
+  positions_[kUserField] = GetPosition(access::kUser, field_index, true);
+  positions_[kCountField] =
+      GetPosition(access::kNumAccesses, field_index, true);
+  positions_[kFirstAccessField] =
+      GetPosition(access::kFirstAccess, field_index, false);
+  positions_[kLastAccessField] =
+      GetPosition(access::kLastAccess, field_index, false);
+  min_row_size_ = *std::max_element(positions_.begin(), positions_.end()) + 1;
+}
+
+void AccessSummaries::Add(NodeId actor, NodeId user, const Summary& access) {
+  Summary& summary = summaries_[{actor, user}];
+  summary.count += access.count;
+  if (!access.has_time) {
+    return;
+  }
+  if (!summary.has_time) {
+    summary.has_time = true;
+    summary.first_access = access.first_access;
+    summary.last_access = access.last_access;
+    return;
+  }
+  summary.first_access = std::min(summary.first_access, access.first_access);
+  summary.last_access = std::max(summary.last_access, access.last_access);
+}
+
 util::Status AccountAccessGraph::Initialize() {
+  return Initialize(AccessEdgeMode::kPerCount);
+}
+
+util::Status AccountAccessGraph::Initialize(AccessEdgeMode mode) {
   // Create a unique node label of type tuple(string, string, string) for actor
   // information.
   std::vector<AST> args;
   args.emplace_back(type::MakeString(kActorTag, false));
   args.emplace_back(type::MakeString(kTitle, true));
   args.emplace_back(type::MakeString(kManager, true));
+  AST actor_type = type::MakeTuple(kActorTag, false, args);
   type::Types node_types;
-  node_types.emplace(kActorTag, type::MakeTuple(kActorTag, false, args));
+  node_types.emplace(kActorTag, actor_type);
   // Create a unique node label of type string for user names.
   node_types.emplace(kUserTag, type::MakeString(kUserTag, false));
   std::set<string> unique_nodes = {kActorTag, kUserTag};
-  // Define an access edge whose label is the number of accesses.
+  // Define an access edge whose label is the number of accesses, and in the
+  // aggregated mode, the times of the first and last access.
   type::Types edge_types;
-  edge_types.emplace(kAccessEdgeTag, type::MakeInt(kCount, false));
+  AST access_type = type::MakeInt(kCount, false);
+  if (mode == AccessEdgeMode::kAggregated) {
+    args.clear();
+    args.emplace_back(type::MakeInt(kCount, false));
+    args.emplace_back(type::MakeTimestamp(kFirstAccess, true));
+    args.emplace_back(type::MakeTimestamp(kLastAccess, true));
+    access_type = type::MakeTuple(kAccessEdgeTag, false, args);
+  }
+  edge_types.emplace(kAccessEdgeTag, access_type);
   std::set<string> unique_edges = {kAccessEdgeTag};
   // There is no graph-level label.
   AST graph_type = type::MakeNull(kAccessGraphTag);
@@ -90,6 +144,9 @@ util::Status AccountAccessGraph::Initialize() {
   util::Status s = graph_.Initialize(node_types, unique_nodes, edge_types,
                                      unique_edges, graph_type);
   if (s.ok()) {
+    actor_type_.reset(new value::ValidatedType(actor_type));
+    access_type_.reset(new value::ValidatedType(access_type));
+    mode_ = mode;
     is_initialized_ = true;
     return s;
   }
@@ -122,12 +179,135 @@ void AccountAccessGraph::ProcessAccessData(
   CHECK(is_initialized_, kInitializationErr);
   CHECK(!field_index.empty(), "The map 'field_index' is empty");
   CHECK(!fields.empty(), "The vector 'fields' is empty");
-  TaggedAST actor = MakeActorLabel(field_index, fields);
-  NodeId actor_id = graph_.FindOrAddNode(actor);
-  TaggedAST user = MakeUserLabel(field_index, fields);
-  NodeId user_id = graph_.FindOrAddNode(user);
-  TaggedAST count = MakeEdgeLabel(field_index, fields);
-  graph_.FindOrAddEdge(actor_id, user_id, count);
+  ProcessAccessData(AccessColumns(field_index), fields);
+}
+
+void AccountAccessGraph::ProcessAccessData(const AccessColumns& columns,
+                                           const std::vector<string>& fields) {
+  CHECK(fields.size() >= columns.MinRowSize(), kRowSizeErr);
+  ProcessRow(columns, [&fields](int position) { return fields[position]; },
+             &graph_, &summaries_);
+}
+
+void AccountAccessGraph::ProcessCSVFields(const AccessColumns& columns,
+                                          util::Span<util::CSVField> fields) {
+  CHECK(fields.size() >= columns.MinRowSize(), kRowSizeErr);
+  ProcessRow(columns,
+             [&fields](int position) {
+               return util::ToString(fields[position]);
+             },
+             &graph_, &summaries_);
+}
+
+// The fields of a row are read from the batch directly, so only the fields
+// that occur in labels are converted to strings.
+void AccountAccessGraph::ProcessAccessBatch(const AccessColumns& columns,
+                                            const util::RecordBatch& batch) {
+  CHECK(batch.NumColumns() >= columns.MinRowSize(), kRowSizeErr);
+  for (size_t row = 0; row < batch.NumRows(); ++row) {
+    ProcessRow(columns,
+               [&batch, row](int position) {
+                 return util::ToString(batch.Get(row, position));
+               },
+               &graph_, &summaries_);
+  }
+}
+
+std::unique_ptr<ConcurrentGraphBuilder>
+AccountAccessGraph::NewConcurrentBuilder() {
+  CHECK(is_initialized_, kInitializationErr);
+  return std::unique_ptr<ConcurrentGraphBuilder>(
+      new ConcurrentGraphBuilder(&graph_));
+}
+
+void AccountAccessGraph::ProcessAccessBatch(
+    const AccessColumns& columns, const util::RecordBatch& batch,
+    ConcurrentGraphBuilder::Writer* writer,
+    AccessSummaries* summaries) const {
+  CHECK(batch.NumColumns() >= columns.MinRowSize(), kRowSizeErr);
+  for (size_t row = 0; row < batch.NumRows(); ++row) {
+    ProcessRow(columns,
+               [&batch, row](int position) {
+                 return util::ToString(batch.Get(row, position));
+               },
+               writer, summaries);
+  }
+}
+
+void AccountAccessGraph::AddAccessSummaries(
+    const ConcurrentGraphBuilder& builder, const AccessSummaries& summaries) {
+  for (const auto& summary : summaries.Summaries()) {
+    summaries_.Add(builder.GetNodeId(summary.first.first),
+                   builder.GetNodeId(summary.first.second), summary.second);
+  }
+}
+
+// Edges are added in the order of their actors and users, so the graph does
+// not depend on the order in which summaries were collected. An edge whose
+// summary has not changed since the last call keeps its label, so replaced
+// labels only accumulate in the label store of the graph when summaries change
+// between calls.
+void AccountAccessGraph::AddAggregatedEdges() {
+  CHECK(is_initialized_, kInitializationErr);
+  std::vector<std::pair<NodeId, NodeId>> pairs;
+  pairs.reserve(summaries_.Summaries().size());
+  for (const auto& summary : summaries_.Summaries()) {
+    pairs.push_back(summary.first);
+  }
+  std::sort(pairs.begin(), pairs.end());
+  for (const std::pair<NodeId, NodeId>& nodes : pairs) {
+    TaggedAST label = MakeEdgeLabel(summaries_.Summaries().at(nodes));
+    auto edge_it = aggregated_edges_.find(nodes);
+    if (edge_it == aggregated_edges_.end()) {
+      aggregated_edges_.insert(
+          {nodes,
+           graph_.FindOrAddEdge(nodes.first, nodes.second, std::move(label))});
+    } else if (!ast::Equal(graph_.GetEdgeLabel(edge_it->second), label)) {
+      util::Status status = graph_.UpdateEdgeLabel(edge_it->second, label);
+      CHECK(status.ok(), status.message());
+    }
+  }
+}
+
+template <typename GetField, typename Builder>
+void AccountAccessGraph::ProcessRow(const AccessColumns& columns,
+                                    const GetField& get_field,
+                                    Builder* builder,
+                                    AccessSummaries* summaries) const {
+  CHECK(is_initialized_, kInitializationErr);
+  auto get_string = [&columns, &get_field](AccessColumns::Field field) {
+    int position = columns.Position(field);
+    return position < 0 ? value::MakePrimitiveNull(PrimitiveType::STRING)
+                        : value::MakeString(get_field(position));
+  };
+  NodeId actor_id = builder->FindOrAddNode(
+      MakeActorLabel(get_string(AccessColumns::kActorField),
+                     get_string(AccessColumns::kTitleField),
+                     get_string(AccessColumns::kManagerField)));
+  NodeId user_id = builder->FindOrAddNode(
+      MakeUserLabel(get_string(AccessColumns::kUserField)));
+  const string count = get_field(columns.Position(AccessColumns::kCountField));
+  if (mode_ == AccessEdgeMode::kPerCount) {
+    builder->FindOrAddEdge(actor_id, user_id, MakeEdgeLabel(count));
+    return;
+  }
+  CHECK(summaries != nullptr, kNullSummariesErr);
+  AccessSummaries::Summary access;
+  access.count = std::stoll(count);
+  int first_position = columns.Position(AccessColumns::kFirstAccessField);
+  int last_position = columns.Position(AccessColumns::kLastAccessField);
+  access.has_time =
+      first_position >= 0 &&
+      util::RFC3339ToUnixMicros(get_field(first_position),
+                                &access.first_access);
+  if (access.has_time &&
+      (last_position < 0 ||
+       !util::RFC3339ToUnixMicros(get_field(last_position),
+                                  &access.last_access) ||
+       access.last_access < access.first_access)) {
+    access.last_access = access.first_access;
+  }
+  summaries->Add(actor_id, user_id, access);
 }
 
 string AccountAccessGraph::ToDot() const {
@@ -135,47 +315,68 @@ string AccountAccessGraph::ToDot() const {
   return DotPrinter().DotGraph(graph_);
 }
 
-TaggedAST AccountAccessGraph::MakeActorLabel(
-    const unordered_map<string, int>& field_index,
-    const std::vector<string>& fields) {
+void AccountAccessGraph::WriteDot(std::ostream* out) const {
+  CHECK(is_initialized_, kInitializationErr);
+  DotPrinter().WriteDotGraph(graph_, out);
+}
+
+TaggedAST AccountAccessGraph::MakeActorLabel(AST&& actor, AST&& title,
+                                             AST&& manager) const {
   // Create a tuple consisting of the actor, title and manager.
-  AST actor_ast = value::MakeNullTuple(3);
-  std::pair<bool, AST> result = graph_.GetNodeType(kActorTag);
-  CHECK(result.first, (util::StrCat(kNoTagErr, kActorTag)));
-  string field = GetField(access::kActor, field_index, fields);
-  value::SetField(result.second, 0, value::MakeString(field), &actor_ast);
-  field = GetField(access::kActorTitle, field_index, fields);
-  value::SetField(result.second, 1, value::MakeString(field), &actor_ast);
-  field = GetField(access::kActorManager, field_index, fields);
-  value::SetField(result.second, 2, value::MakeString(field), &actor_ast);
+  DCHECK_STREAM(actor_type_ != nullptr) << kNoTagErr << kActorTag;
+  TaggedAST actor_label;
+  AST* actor_ast = actor_label.mutable_ast();
+  *actor_ast = value::MakeNullTuple(3);
+  value::SetField(*actor_type_, 0, std::move(actor), actor_ast);
+  value::SetField(*actor_type_, 1, std::move(title), actor_ast);
+  value::SetField(*actor_type_, 2, std::move(manager), actor_ast);
   // Add a tag to the tuple.
-  TaggedAST actor;
-  *actor.mutable_ast() = actor_ast;
-  actor.set_tag(kActorTag);
-  return actor;
+  actor_label.set_tag(kActorTag);
+  return actor_label;
 }
 
-TaggedAST AccountAccessGraph::MakeUserLabel(
-    const unordered_map<string, int>& field_index,
-    const std::vector<string>& fields) {
-  string user_str = GetField(access::kUser, field_index, fields);
-  AST user_ast = value::MakeString(user_str);
-  TaggedAST user;
-  *user.mutable_ast() = user_ast;
-  user.set_tag(kUserTag);
-  return user;
+TaggedAST AccountAccessGraph::MakeUserLabel(AST&& user) const {
+  TaggedAST user_label;
+  user_label.mutable_ast()->Swap(&user);
+  user_label.set_tag(kUserTag);
+  return user_label;
 }
 
-TaggedAST AccountAccessGraph::MakeEdgeLabel(
-    const unordered_map<string, int>& field_index,
-    const std::vector<string>& fields) {
-  string count_str = GetField(access::kNumAccesses, field_index, fields);
+TaggedAST AccountAccessGraph::MakeEdgeLabel(const string& count) const {
   // Convert a string to a 64 bit signed integer.
-  int64_t count_val = std::stoll(count_str);
-  TaggedAST count;
-  *count.mutable_ast() = value::MakeInt(count_val);
-  count.set_tag(kAccessEdgeTag);
-  return count;
+  int64_t count_val = std::stoll(count);
+  TaggedAST count_label;
+  *count_label.mutable_ast() = value::MakeInt(count_val);
+  count_label.set_tag(kAccessEdgeTag);
+  return count_label;
+}
+
+TaggedAST AccountAccessGraph::MakeEdgeLabel(
+    const AccessSummaries::Summary& summary) const {
+  DCHECK_STREAM(access_type_ != nullptr) << kNoTagErr << kAccessEdgeTag;
+  TaggedAST access_label;
+  AST* access_ast = access_label.mutable_ast();
+  *access_ast = value::MakeNullTuple(3);
+  AST count = value::MakePrimitiveNull(PrimitiveType::INT);
+  count.mutable_p_ast()->mutable_val()->set_int_val(summary.count);
+  value::SetField(*access_type_, 0, std::move(count), access_ast);
+  if (summary.has_time) {
+    value::SetField(*access_type_, 1,
+                    value::MakeTimestampFromUnixMicros(summary.first_access),
+                    access_ast);
+    value::SetField(*access_type_, 2,
+                    value::MakeTimestampFromUnixMicros(summary.last_access),
+                    access_ast);
+  } else {
+    value::SetField(*access_type_, 1,
+                    value::MakePrimitiveNull(PrimitiveType::TIMESTAMP),
+                    access_ast);
+    value::SetField(*access_type_, 2,
+                    value::MakePrimitiveNull(PrimitiveType::TIMESTAMP),
+                    access_ast);
+  }
+  access_label.set_tag(kAccessEdgeTag);
+  return access_label;
 }
 
 }  // namespace morphie
@@ -24,22 +24,104 @@
 #ifndef LOGLE_ACCOUNT_ACCESS_GRAPH_H_
 #define LOGLE_ACCOUNT_ACCESS_GRAPH_H_
 
+#include <stdint.h>
+
+#include <boost/functional/hash/hash.hpp>
+#include <array>
+#include <memory>
+#include <ostream>
 #include <unordered_map>
+#include <utility>
 
 #include "base/string.h"
 #include "base/vector.h"
+#include "graph/concurrent_graph_builder.h"
 #include "graph/graph_interface.h"
 #include "graph/labeled_graph.h"
+#include "graph/value.h"
+#include "util/csv.h"
 #include "util/status.h"
 
 namespace morphie {
 
+// An AccessColumns object is a projection of input rows onto the fields that
+// occur in labels. It stores the position of each of these fields in a row,
+// which is looked up once in a map from field names to positions, so that
+// rows are processed without looking up field names.
+class AccessColumns {
+ public:
+  // The fields that occur in labels.
+  enum Field {
+    kActorField,
+    kTitleField,
+    kManagerField,
+    kUserField,
+    kCountField,
+    kFirstAccessField,
+    kLastAccessField,
+    kNumFields,
+  };
+
+  // The manager of an actor and the access times are optional, and are null
+  // in the labels if 'field_index' has no position for them.
+  // - Crashes unless 'field_index' contains a non-negative position for each
+  //   of the fields in access::kRequiredFields.
+  explicit AccessColumns(const unordered_map<string, int>& field_index);
+
+  // Returns the position of 'field' in a row, or -1 if the field is absent.
+  int Position(Field field) const { return positions_[field]; }
+  // Returns the smallest number of fields that a row must have.
+  size_t MinRowSize() const { return min_row_size_; }
+
+ private:
+  std::array<int, kNumFields> positions_;
+  size_t min_row_size_;
+};  // class AccessColumns
+
+// The edges of an account access graph are created in one of two modes.
+enum class AccessEdgeMode {
+  // Each distinct number of accesses in a row for an actor and a user gives
+  // one Access edge labelled with that number.
+  kPerCount,
+  // All rows for an actor and a user are collapsed into one Access edge
+  // labelled with the total number of accesses and the times of the first and
+  // last access.
+  kAggregated,
+};
+
+// An AccessSummaries object collapses the accesses of actors to users into one
+// summary for each pair of an actor node and a user node. Adding the accesses
+// of a row takes one hash lookup.
+class AccessSummaries {
+ public:
+  // The number of accesses and, if 'has_time' is true, the times of the first
+  // and last access in microseconds since the Unix epoch.
+  struct Summary {
+    int64_t count = 0;
+    bool has_time = false;
+    int64_t first_access = 0;
+    int64_t last_access = 0;
+  };
+  using SummaryMap =
+      unordered_map<std::pair<NodeId, NodeId>, Summary,
+                    boost::hash<std::pair<NodeId, NodeId>>>;
+
+  // Adds the accesses in 'access' to the summary of 'actor' and 'user'.
+  void Add(NodeId actor, NodeId user, const Summary& access);
+  const SummaryMap& Summaries() const { return summaries_; }
+
+ private:
+  SummaryMap summaries_;
+};  // class AccessSummaries
+
 // The account access graph contains labels with the following names and types.
 // The labels are all unique, meaning there can be at most one node with each
 // label in the graph and at most one edge between two nodes with a given label.
 // * Actor : tuple(ActorId : string, Title : string, Manager : string)
 // * User : string
-// * Access Edge : Count : int
+// * Access Edge : Count : int, or in the aggregated mode
+//   Access Edge : tuple(Count : int, FirstAccess : timestamp?,
+//                       LastAccess : timestamp?)
 // As currently implemented, if an account is an actor and a user, it will
 // appear as two nodes in the graph.
 //
@@ -48,7 +130,8 @@ namespace morphie {
 // initialized.
 class AccountAccessGraph : public GraphInterface {
  public:
-  AccountAccessGraph() : is_initialized_(false) {}
+  AccountAccessGraph()
+      : is_initialized_(false), mode_(AccessEdgeMode::kPerCount) {}
 
   // Initializes the graph. This function must be called before all other
   // functions in this class. Returns
@@ -56,6 +139,10 @@ class AccountAccessGraph : public GraphInterface {
   // - Status::INTERNAL - otherwise, with the reason accessible via the
   //   Status::error_message() function of the Status object.
   util::Status Initialize();
+  // Initializes the graph to create edges in the mode 'mode'. In the
+  // aggregated mode, processing a row only adds nodes and updates the summary
+  // of its actor and user, and edges are added by AddAggregatedEdges().
+  util::Status Initialize(AccessEdgeMode mode);
 
   // Functions for statistics about nodes and edges.
   // Statistics about nodes.
@@ -80,21 +167,75 @@ class AccountAccessGraph : public GraphInterface {
   // labelled with the empty string.
   void ProcessAccessData(const unordered_map<string, int>& field_index,
                          const std::vector<string>& fields);
+  // The functions below behave like ProcessAccessData but read the fields of a
+  // row at the positions in 'columns'. Each field that occurs in a label is
+  // copied out of the input once and moved into the label.
+  // - Require that every row has at least columns.MinRowSize() fields.
+  void ProcessAccessData(const AccessColumns& columns,
+                         const std::vector<string>& fields);
+  void ProcessCSVFields(const AccessColumns& columns,
+                        util::Span<util::CSVField> fields);
+  // Processes every row of 'batch'.
+  void ProcessAccessBatch(const AccessColumns& columns,
+                          const util::RecordBatch& batch);
+
+  // Returns a builder that adds nodes and edges to this graph from several
+  // threads. No other function that modifies the graph may be called until
+  // the builder has finished.
+  std::unique_ptr<ConcurrentGraphBuilder> NewConcurrentBuilder();
+  // Same as ProcessAccessBatch but records the nodes and edges in 'writer'.
+  // This function may be called concurrently with different writers of a
+  // builder returned by NewConcurrentBuilder(). In the aggregated mode, the
+  // accesses are added to 'summaries' with the builder identifiers of their
+  // nodes, and must be added to the graph with AddAccessSummaries once the
+  // builder has finished.
+  // - Requires that 'summaries' is not null in the aggregated mode.
+  void ProcessAccessBatch(const AccessColumns& columns,
+                          const util::RecordBatch& batch,
+                          ConcurrentGraphBuilder::Writer* writer,
+                          AccessSummaries* summaries) const;
+  // Adds summaries collected by ProcessAccessBatch with a writer of 'builder'
+  // to the summaries of the graph.
+  // - Requires that Finish() has been called on 'builder'.
+  void AddAccessSummaries(const ConcurrentGraphBuilder& builder,
+                          const AccessSummaries& summaries);
+  // Adds an Access edge for each actor and user with accesses in the
+  // aggregated mode, or updates the label of the edge if it was already
+  // added. Has no effect in the other mode.
+  void AddAggregatedEdges();
 
   // Return a representation of the graph in Graphviz DOT format.
   string ToDot() const;
+  // Writes the representation returned by ToDot() to 'out' incrementally.
+  void WriteDot(std::ostream* out) const;
 
  private:
-  // The functions below create each of the three types of labels in the graph.
-  TaggedAST MakeActorLabel(const unordered_map<string, int>& field_index,
-                           const std::vector<string>& fields);
-  TaggedAST MakeUserLabel(const unordered_map<string, int>& field_index,
-                          const std::vector<string>& fields);
-  TaggedAST MakeEdgeLabel(const unordered_map<string, int>& field_index,
-                          const std::vector<string>& fields);
+  // Adds the nodes and edges for one row to 'builder', which is either
+  // 'graph_' or a writer of a concurrent builder. The call get_field(i)
+  // returns the field at position i of the row as a string.
+  // In the aggregated mode, the accesses are added to 'summaries' instead.
+  template <typename GetField, typename Builder>
+  void ProcessRow(const AccessColumns& columns, const GetField& get_field,
+                  Builder* builder, AccessSummaries* summaries) const;
+  // The functions below create each of the three types of labels in the graph
+  // and move their arguments into the labels.
+  TaggedAST MakeActorLabel(AST&& actor, AST&& title, AST&& manager) const;
+  TaggedAST MakeUserLabel(AST&& user) const;
+  TaggedAST MakeEdgeLabel(const string& count) const;
+  TaggedAST MakeEdgeLabel(const AccessSummaries::Summary& summary) const;
 
   bool is_initialized_;
+  AccessEdgeMode mode_;
   LabeledGraph graph_;
+  // The type of actor labels, which is checked once by Initialize.
+  std::unique_ptr<const ast::value::ValidatedType> actor_type_;
+  // The type of aggregated edge labels, and the summaries of the accesses and
+  // edges added for them in the aggregated mode.
+  std::unique_ptr<const ast::value::ValidatedType> access_type_;
+  AccessSummaries summaries_;
+  unordered_map<std::pair<NodeId, NodeId>, EdgeId,
+                boost::hash<std::pair<NodeId, NodeId>>>
+      aggregated_edges_;
 };  // class AccountAccessGraph
 
 }  // namespace morphie
@@ -76,5 +76,70 @@ TEST_F(AccountAccessGraphTest, ProcessSingleAccess) {
   EXPECT_EQ(3, graph_.NumEdges());
 }
 
+TEST(AccessColumnsTest, CompilesFieldPositions) {
+  AccessColumns columns(GetIndex());
+  EXPECT_EQ(0, columns.Position(AccessColumns::kActorField));
+  EXPECT_EQ(2, columns.Position(AccessColumns::kTitleField));
+  EXPECT_EQ(1, columns.Position(AccessColumns::kManagerField));
+  EXPECT_EQ(4, columns.Position(AccessColumns::kUserField));
+  EXPECT_EQ(3, columns.Position(AccessColumns::kCountField));
+  EXPECT_EQ(5, columns.MinRowSize());
+}
+
+TEST(AccessColumnsDeathTest, RequiresAllFields) {
+  unordered_map<string, int> index = GetIndex();
+  index.erase(access::kUser);
+  EXPECT_DEATH({ AccessColumns columns(index); }, ".*");
+}
+
+// Processing rows with compiled columns constructs the same graph as
+// processing them with a field index.
+TEST_F(AccountAccessGraphTest, ProcessWithColumns) {
+  AccessColumns columns(GetIndex());
+  graph_.ProcessAccessData(columns, fields1);
+  graph_.ProcessAccessData(columns, fields2);
+  graph_.ProcessAccessData(GetIndex(), fields2);
+  EXPECT_EQ(4, graph_.NumNodes());
+  EXPECT_EQ(2, graph_.NumEdges());
+  EXPECT_DEATH({ graph_.ProcessAccessData(columns, {"too", "short"}); },
+               ".*");
+}
+
+// In the aggregated mode, the rows of an actor and a user are collapsed into
+// one edge whose label sums the counts and spans the access times.
+TEST(AccountAccessGraphAggregationTest, CollapsesRepeatedAccesses) {
+  AccountAccessGraph graph;
+  ASSERT_TRUE(graph.Initialize(AccessEdgeMode::kAggregated).ok());
+  unordered_map<string, int> index = GetIndex();
+  index.insert({access::kFirstAccess, 5});
+  index.insert({access::kLastAccess, 6});
+  AccessColumns columns(index);
+  std::vector<string> fields = {"actor@logle", "manager@logle", "Actor", "3",
+                                "user@logle", "2015-01-02T00:00:00+00:00",
+                                "2015-01-03T00:00:00+00:00"};
+  graph.ProcessAccessData(columns, fields);
+  fields[3] = "4";
+  fields[5] = "2015-01-01T00:00:00+00:00";
+  fields[6] = "";
+  graph.ProcessAccessData(columns, fields);
+  EXPECT_EQ(2, graph.NumNodes());
+  EXPECT_EQ(0, graph.NumEdges());
+  graph.AddAggregatedEdges();
+  EXPECT_EQ(1, graph.NumEdges());
+  string dot = graph.ToDot();
+  EXPECT_NE(string::npos, dot.find("7")) << dot;
+  EXPECT_NE(string::npos, dot.find("2015-01-01T00:00:00")) << dot;
+  EXPECT_NE(string::npos, dot.find("2015-01-03T00:00:00")) << dot;
+  // Later accesses update the label of the edge.
+  fields[3] = "1";
+  graph.ProcessAccessData(columns, fields);
+  fields[4] = "other@logle";
+  graph.ProcessAccessData(columns, fields);
+  graph.AddAggregatedEdges();
+  EXPECT_EQ(3, graph.NumNodes());
+  EXPECT_EQ(2, graph.NumEdges());
+  EXPECT_NE(string::npos, graph.ToDot().find("8"));
+}
+
 }  // namespace
 }  // namespace morphie
@@ -15,6 +15,10 @@
 #include "analyzers/examples/curio_analyzer.h"
 
 #include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "util/logging.h"
 #include "util/status.h"
@@ -28,6 +32,8 @@ const int kMaxMalformedObjects = 1000000;
 // The clock is a special stream that is guaranteed to be present.
 const char kClockId[] = "[:clock]";
 const char kNullDocErr[] = "The pointer to the document is null.";
+const char kNotObjectErr[] = "The document must be an object.";
+const char kEmptyDocErr[] = "The input document must not be empty.";
 
 // Check if the dependency tree has the required JSON fields.
 bool HasRequiredFields(const Json::Value& json_tree) {
@@ -46,13 +52,39 @@ util::Status CurioAnalyzer::Initialize(
     return util::Status(Code::INVALID_ARGUMENT, kNullDocErr);
   }
   json_doc_ = std::move(json_doc);
+  json_input_.reset();
+  json_stream_.reset();
   if (json_doc_->empty()) {
-    return util::Status(Code::INVALID_ARGUMENT,
-                        "The input document must not be empty.");
+    return util::Status(Code::INVALID_ARGUMENT, kEmptyDocErr);
   }
   if (!json_doc_->isObject()) {
-    return util::Status(Code::INVALID_ARGUMENT,
-                        "The document must be an object.");
+    return util::Status(Code::INVALID_ARGUMENT, kNotObjectErr);
+  }
+  num_streams_processed_ = 0;
+  num_streams_skipped_ = 0;
+  return util::Status::OK;
+}
+
+// IncrementalFullJson crashes on input that does not begin with an object, so
+// the first character is checked here.
+util::Status CurioAnalyzer::Initialize(
+    std::unique_ptr<std::istream> json_stream) {
+  if (json_stream == nullptr) {
+    return util::Status(Code::INVALID_ARGUMENT, kNullDocErr);
+  }
+  json_doc_.reset();
+  json_input_.reset();
+  json_stream_ = std::move(json_stream);
+  *json_stream_ >> std::ws;
+  if (json_stream_->peek() == std::char_traits<char>::eof()) {
+    return util::Status(Code::INVALID_ARGUMENT, kEmptyDocErr);
+  }
+  if (json_stream_->peek() != '{') {
+    return util::Status(Code::INVALID_ARGUMENT, kNotObjectErr);
+  }
+  json_input_.reset(new IncrementalFullJson(json_stream_.get(), {}));
+  if (!json_input_->HasNext()) {
+    return util::Status(Code::INVALID_ARGUMENT, kEmptyDocErr);
   }
   num_streams_processed_ = 0;
   num_streams_skipped_ = 0;
@@ -60,32 +92,39 @@ util::Status CurioAnalyzer::Initialize(
 }
 
 util::Status CurioAnalyzer::BuildDependencyGraph() {
-  CHECK(json_doc_ != nullptr, kNullDocErr);
+  CHECK(json_doc_ != nullptr || json_input_ != nullptr, kNullDocErr);
   dependency_graph_.reset(new StreamDependencyGraph);
   util::Status status = dependency_graph_->Initialize();
   if (!status.ok()) {
     return status;
   }
-  for (const auto& consumer_id : json_doc_->getMemberNames()) {
-    // Every stream depends on the clock so the clock stream is not added to the
-    // dependency graph to reduce structural and visual noise.
-    if (consumer_id == kClockId) {
-      continue;
-    }
-    if (!HasRequiredFields((*json_doc_)[consumer_id])) {
-      status = IncrementSkipCounter();
-      if (!status.ok()) {
-        return status;
-      }
-      continue;
-    }
-    status = AddDependencies(consumer_id, (*json_doc_)[consumer_id]);
-    ++num_streams_processed_;
-    if (!status.ok()) {
-      return status;
+  if (json_input_ != nullptr) {
+    while (status.ok() && json_input_->HasNext()) {
+      const Json::Value* consumer_tree = json_input_->Next();
+      status = AddStream(json_input_->Name(), *consumer_tree);
     }
+    return status;
   }
-  return util::Status::OK;
+  for (auto member_it = json_doc_->begin();
+       status.ok() && member_it != json_doc_->end(); ++member_it) {
+    status = AddStream(member_it.name(), *member_it);
+  }
+  return status;
+}
+
+util::Status CurioAnalyzer::AddStream(const string& consumer_id,
+                                      const Json::Value& consumer_tree) {
+  // Every stream depends on the clock so the clock stream is not added to the
+  // dependency graph to reduce structural and visual noise.
+  if (consumer_id == kClockId) {
+    return util::Status::OK;
+  }
+  if (!HasRequiredFields(consumer_tree)) {
+    return IncrementSkipCounter();
+  }
+  util::Status status = AddDependencies(consumer_id, consumer_tree);
+  ++num_streams_processed_;
+  return status;
 }
 
 int CurioAnalyzer::NumGraphNodes() const {
@@ -97,19 +136,27 @@ int CurioAnalyzer::NumGraphEdges() const {
 }
 
 // Recursively traverse the dependency tree rooted at 'consumer_tree'. The
-// traversal skips a subtree below a node if that node is not well defined.
+// traversal skips a subtree below a node if that node is not well defined. The
+// dependencies of a consumer are added in one batch before the subtrees of its
+// producers are traversed.
 util::Status CurioAnalyzer::AddDependencies(const string& consumer_id,
                                             const Json::Value& consumer_tree) {
   util::Status status = util::Status::OK;
   string consumer_name = consumer_tree["Node"]["ID"]["Name"].asString();
-  Json::Value producer_tree;
-  for (const auto& producer_id : consumer_tree["Children"].getMemberNames()) {
+  const Json::Value& children = consumer_tree["Children"];
+  std::vector<std::pair<string, string>> producers;
+  std::vector<const Json::Value*> producer_trees;
+  producers.reserve(children.size());
+  producer_trees.reserve(children.size());
+  for (auto child_it = children.begin(); child_it != children.end();
+       ++child_it) {
+    string producer_id = child_it.name();
     // Every stream depends on the clock the clock stream is not added to the
     // dependency graph to reduce structural and visual noise.
     if (producer_id == kClockId) {
       continue;
     }
-    producer_tree = consumer_tree["Children"][producer_id];
+    const Json::Value& producer_tree = *child_it;
     if (!HasRequiredFields(producer_tree)) {
       status = IncrementSkipCounter();
       if (!status.ok()) {
@@ -117,10 +164,13 @@ util::Status CurioAnalyzer::AddDependencies(const string& consumer_id,
       }
       continue;
     }
-    string producer_name = producer_tree["Node"]["ID"]["Name"].asString();
-    dependency_graph_->AddDependency(consumer_id, consumer_name, producer_id,
-                                     producer_name);
-    status = AddDependencies(producer_id, producer_tree);
+    producers.emplace_back(std::move(producer_id),
+                           producer_tree["Node"]["ID"]["Name"].asString());
+    producer_trees.push_back(&producer_tree);
+  }
+  dependency_graph_->AddDependencies(consumer_id, consumer_name, producers);
+  for (size_t i = 0; i < producers.size(); ++i) {
+    status = AddDependencies(producers[i].first, *producer_trees[i]);
     ++num_streams_processed_;
     if (!status.ok()) {
       return status;
@@ -133,12 +183,36 @@ string CurioAnalyzer::DependencyGraphAsDot() const {
   return dependency_graph_ == nullptr ? "" : dependency_graph_->ToDot();
 }
 
+void CurioAnalyzer::WriteDependencyGraphDot(std::ostream* out) const {
+  if (dependency_graph_ != nullptr) {
+    dependency_graph_->WriteDot(out);
+  }
+}
+
+StreamComponents CurioAnalyzer::FindComponents() const {
+  return dependency_graph_ == nullptr ? StreamComponents()
+                                      : dependency_graph_->FindComponents();
+}
+
+string CurioAnalyzer::CondensationAsDot() const {
+  std::ostringstream dot_graph;
+  WriteCondensationDot(&dot_graph);
+  return dot_graph.str();
+}
+
+void CurioAnalyzer::WriteCondensationDot(std::ostream* out) const {
+  if (dependency_graph_ != nullptr) {
+    dependency_graph_->WriteCondensationDot(dependency_graph_->FindComponents(),
+                                            out);
+  }
+}
+
 util::Status CurioAnalyzer::IncrementSkipCounter() {
   ++num_streams_skipped_;
   if (num_streams_skipped_ >= kMaxMalformedObjects) {
     return util::Status(
         Code::INVALID_ARGUMENT,
-        util::StrCat("Over  ", std::to_string(kMaxMalformedObjects),
+        util::StrCat("Over  ", kMaxMalformedObjects,
                      " malformed JSON objects in input. Aborting."));
   }
   return util::Status::OK;
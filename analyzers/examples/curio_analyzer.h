@@ -18,11 +18,14 @@
 #ifndef LOGLE_CURIO_ANALYZER_H_
 #define LOGLE_CURIO_ANALYZER_H_
 
+#include <istream>
 #include <memory>
+#include <ostream>
 
 #include "analyzers/examples/stream_dependency_graph.h"
 #include "base/string.h"
 #include "json/json.h"
+#include "util/json_reader.h"
 #include "util/status.h"
 
 namespace morphie {
@@ -42,6 +45,17 @@ class CurioAnalyzer {
   //    - It must be an object.
   //  * Returns INVALID_ARGUMENT otherwise with an error message.
   util::Status Initialize(std::unique_ptr<::Json::Value> json_doc);
+  // Initializes the analyzer with a stream containing a JSON document, which
+  // BuildDependencyGraph reads one stream definition at a time, so that the
+  // document is never held in memory as a whole. Definitions are processed in
+  // the order in which they occur in the document rather than in the order of
+  // their names, which yields the same graph unless a name occurs twice.
+  //  * Returns OK if 'json_stream' is not null and the document begins with a
+  //    non-empty object.
+  //  * Returns INVALID_ARGUMENT otherwise with an error message.
+  // Graph construction crashes if the rest of the document is not well-formed
+  // JSON.
+  util::Status Initialize(std::unique_ptr<std::istream> json_stream);
 
   // Constructs a StreamDependencyGraph object from the JSON document provided
   // to Initialize.
@@ -55,6 +69,20 @@ class CurioAnalyzer {
 
   // Returns a GraphViz DOT representation of the dependency graph.
   string DependencyGraphAsDot() const;
+  // Writes the string returned by DependencyGraphAsDot() to 'out'
+  // incrementally.
+  void WriteDependencyGraphDot(std::ostream* out) const;
+
+  // Returns the strongly connected components of the dependency graph, which
+  // are the dependency cycles between streams, or no components if the graph
+  // has not been constructed.
+  StreamComponents FindComponents() const;
+  // Returns a GraphViz DOT representation of the condensation of the
+  // dependency graph, in which every component is collapsed to one node. See
+  // StreamDependencyGraph::Condensation for the labels.
+  string CondensationAsDot() const;
+  // Writes the string returned by CondensationAsDot() to 'out'.
+  void WriteCondensationDot(std::ostream* out) const;
 
  private:
   // Recursively adds nodes and edges to the dependency graph for each stream in
@@ -65,6 +93,11 @@ class CurioAnalyzer {
   //  - OK : otherwise.
   util::Status AddDependencies(const string& consumer_id,
                                const Json::Value& consumer_tree);
+  // Adds the stream 'consumer_id' defined by the top-level member
+  // 'consumer_tree' of the document, and the streams it depends on. Returns
+  // the same status as AddDependencies.
+  util::Status AddStream(const string& consumer_id,
+                         const Json::Value& consumer_tree);
 
   // Increments a global counter of the number of objects in the JSON input that
   // have been skipped. Returns
@@ -76,7 +109,11 @@ class CurioAnalyzer {
   int num_streams_processed_;
   int num_streams_skipped_;
 
+  // The input is either a parsed document or a stream that is read by
+  // 'json_input_'.
   std::unique_ptr<Json::Value> json_doc_;
+  std::unique_ptr<std::istream> json_stream_;
+  std::unique_ptr<IncrementalFullJson> json_input_;
   std::unique_ptr<StreamDependencyGraph> dependency_graph_;
 };
 
@@ -14,6 +14,8 @@
 
 #include "analyzers/examples/curio_analyzer.h"
 
+#include <sstream>
+
 #include "gtest.h"
 #include "util/status.h"
 
@@ -36,6 +38,14 @@ util::Status GetInitializationStatus(const string& input) {
   return analyzer.Initialize(std::move(doc));
 }
 
+// Returns the status obtained when the CurioAnalyzer is initialized with a
+// stream containing 'input'.
+util::Status GetStreamInitializationStatus(const string& input) {
+  std::unique_ptr<std::istream> json_stream(new std::istringstream(input));
+  CurioAnalyzer analyzer;
+  return analyzer.Initialize(std::move(json_stream));
+}
+
 // Reject an empty JSON object from the input.
 TEST(CurioAnalyzerTest, RequiresNonNullJSONDoc) {
   std::unique_ptr<::Json::Value> doc;
@@ -342,5 +352,87 @@ TEST(CurioAnalyzerTest, MalformedChainMid) {
   EXPECT_EQ(0, curio_analyzer.NumGraphEdges());
 }
 
+// Create the dependency graph below, in which stream2 and stream3 form a
+// cycle, and check its components and condensation.
+//  stream1 --> stream2 <--> stream3
+TEST(CurioAnalyzerTest, ReportsDependencyCycles) {
+  string stream = R"({"[/path/to/stream:stream1]" :
+      {"Node":{"ID":{"Package":"/path/to/stream1", "Name":"stream1"}},
+       "Children": {"[/path/to/stream:stream2]" :
+      {"Node":{"ID":{"Package":"/path/to/stream2", "Name":"stream2"}},
+        "Children": {"[/path/to/stream:stream3]" :
+      {"Node":{"ID":{"Package":"/path/to/stream3", "Name":"stream3"}},
+        "Children": {"[/path/to/stream:stream2]" :
+      {"Node":{"ID":{"Package":"/path/to/stream2", "Name":"stream2"}},
+        "Children": {}}}}}}}}})";
+  CurioAnalyzer curio_analyzer;
+  EXPECT_EQ(0, curio_analyzer.FindComponents().num_components);
+  EXPECT_EQ("", curio_analyzer.CondensationAsDot());
+  ASSERT_TRUE(curio_analyzer.Initialize(CreateJSON(stream)).ok());
+  EXPECT_TRUE(curio_analyzer.BuildDependencyGraph().ok());
+  EXPECT_EQ(3, curio_analyzer.NumGraphNodes());
+  EXPECT_EQ(3, curio_analyzer.NumGraphEdges());
+  StreamComponents components = curio_analyzer.FindComponents();
+  EXPECT_EQ(2, components.num_components);
+  EXPECT_EQ(1, components.num_cyclic_components);
+  EXPECT_EQ(2, components.largest_component_size);
+  EXPECT_EQ(2, components.depth);
+  string dot = curio_analyzer.CondensationAsDot();
+  EXPECT_EQ(0u, dot.find("digraph stream_components {"));
+  EXPECT_NE(string::npos, dot.find("[/path/to/stream:stream3]"));
+}
+
+// Test that the CurioAnalyzer can only be initialized with a stream that
+// begins with a non-empty JSON object.
+TEST(CurioAnalyzerTest, TestStreamInitialization) {
+  std::unique_ptr<std::istream> json_stream;
+  CurioAnalyzer curio_analyzer;
+  EXPECT_FALSE(curio_analyzer.Initialize(std::move(json_stream)).ok());
+  EXPECT_FALSE(GetStreamInitializationStatus("").ok());
+  EXPECT_FALSE(GetStreamInitializationStatus(" {} ").ok());
+  EXPECT_FALSE(GetStreamInitializationStatus("[]").ok());
+  EXPECT_FALSE(GetStreamInitializationStatus("abc").ok());
+  EXPECT_TRUE(GetStreamInitializationStatus(R"( {"name" : {}})").ok());
+}
+
+// Test that streaming the document constructs the same graph as parsing it,
+// including the counts of skipped streams and of the clock stream.
+TEST(CurioAnalyzerTest, StreamsDocument) {
+  string stream = R"({"[/path/to/stream:stream1]" :
+      {"Node":{"ID":{"Package":"/path/to/stream1", "Name":"stream1"}},
+       "Children": {"[/path/to/stream:stream2]" :
+      {"Node":{"ID":{"Package":"/path/to/stream2", "Name":"stream2"}},
+        "Children": {"[:clock]" : {}}},
+      "[/path/to/stream:stream3]" :
+      {"Node":{"ID":{"Package":"/path/to/stream3", "Name":"stream3"}},
+        "Children": {}}}},
+      "[:clock]" : {"Node":{"ID":{"Package":"", "Name":"clock"}}},
+      "[/path/to/stream:stream4]" : {"Node":{}},
+      "[/path/to/stream:stream\\5]" :
+      {"Node":{"ID":{"Package":"/path/to/stream5", "Name":"stream5"}},
+        "Children": {"[/path/to/stream:stream1]" :
+      {"Node":{"ID":{"Package":"/path/to/stream1", "Name":"stream1"}},
+        "Children": {}}}}})";
+  CurioAnalyzer dom_analyzer;
+  ASSERT_TRUE(dom_analyzer.Initialize(CreateJSON(stream)).ok());
+  EXPECT_TRUE(dom_analyzer.BuildDependencyGraph().ok());
+  std::unique_ptr<std::istream> json_stream(new std::istringstream(stream));
+  CurioAnalyzer stream_analyzer;
+  ASSERT_TRUE(stream_analyzer.Initialize(std::move(json_stream)).ok());
+  EXPECT_TRUE(stream_analyzer.BuildDependencyGraph().ok());
+  EXPECT_EQ(dom_analyzer.NumStreamsProcessed(),
+            stream_analyzer.NumStreamsProcessed());
+  EXPECT_EQ(dom_analyzer.NumStreamsSkipped(),
+            stream_analyzer.NumStreamsSkipped());
+  EXPECT_EQ(5, stream_analyzer.NumStreamsProcessed());
+  EXPECT_EQ(1, stream_analyzer.NumStreamsSkipped());
+  EXPECT_EQ(4, stream_analyzer.NumGraphNodes());
+  EXPECT_EQ(3, stream_analyzer.NumGraphEdges());
+  EXPECT_EQ(dom_analyzer.NumGraphNodes(), stream_analyzer.NumGraphNodes());
+  EXPECT_EQ(dom_analyzer.NumGraphEdges(), stream_analyzer.NumGraphEdges());
+  EXPECT_EQ(dom_analyzer.DependencyGraphAsDot(),
+            stream_analyzer.DependencyGraphAsDot());
+}
+
 }  // namespace
 }  // namespace morphie
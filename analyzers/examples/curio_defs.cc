@@ -23,6 +23,8 @@ const char kStreamTag[] = "Stream";
 const char kStreamIdTag[] = "Stream Id";
 const char kStreamNameTag[] = "Stream Name";
 const char kDependentTag[] = "Dependent";
+const char kComponentTag[] = "Component";
+const char kDependenciesTag[] = "Dependencies";
 
 }  // namespace curio
 }  // namespace morphie
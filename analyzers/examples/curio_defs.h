@@ -28,6 +28,9 @@ extern const char kStreamTag[];
 extern const char kStreamIdTag[];
 extern const char kStreamNameTag[];
 extern const char kDependentTag[];
+// Tags used in labels of the condensation of a stream dependency graph.
+extern const char kComponentTag[];
+extern const char kDependenciesTag[];
 
 }  // namespace curio
 }  // namespace morphie
@@ -14,12 +14,17 @@
 
 #include "analyzers/examples/stream_dependency_graph.h"
 
+#include <algorithm>
 #include <set>
+#include <sstream>
 #include <utility>
 
 #include "analyzers/examples/curio_defs.h"
 #include "base/vector.h"
 #include "graph/dot_printer.h"
+#include "graph/graph_analyzer.h"
+#include "graph/graph_transformer.h"
+#include "graph/label_aggregates.h"
 #include "graph/type.h"
 #include "graph/type_checker.h"
 #include "graph/value.h"
@@ -35,6 +40,8 @@ namespace value = ast::value;
 namespace {
 
 const char kInitializationErr[] = "The graph is not initialized.";
+const char kComponentsErr[] =
+    "The components do not have one entry for each node.";
 
 // Returns a tagged abstract syntax tree (AST) in which the tag is
 // curio::kStreamTag, and the AST represents the tuple of strings
@@ -80,6 +87,23 @@ util::Status StreamDependencyGraph::Initialize() {
   if (!s.ok()) {
     return util::Status(Code::INTERNAL, s.message());
   }
+  stream_type_id_ = graph_.GetNodeTypeId(curio::kStreamTag);
+  // A component is labelled with the set of identifiers of its streams and an
+  // edge of the condensation with the number of dependencies it represents.
+  type::Types component_types;
+  component_types.emplace(
+      curio::kComponentTag,
+      type::MakeSet(curio::kComponentTag, false /*May not be null*/,
+                    type::MakeString(curio::kStreamIdTag, false)));
+  type::Types dependency_types;
+  dependency_types.emplace(
+      curio::kDependenciesTag,
+      type::MakeInt(curio::kDependenciesTag, false /*May not be null*/));
+  s = condensation_type_.Initialize(component_types, {}, dependency_types, {},
+                                    type::MakeNull(curio::kComponentTag));
+  if (!s.ok()) {
+    return util::Status(Code::INTERNAL, s.message());
+  }
   is_initialized_ = true;
   return s;
 }
@@ -99,9 +123,9 @@ void StreamDependencyGraph::AddDependency(const string& consumer_id,
                                           const string& producer_id,
                                           const string& producer_name) {
   CHECK(is_initialized_, kInitializationErr);
-  std::pair<bool, AST> type = graph_.GetNodeType(curio::kStreamTag);
-  TaggedAST consumer = MakeNodeLabel(type.second, consumer_id, consumer_name);
-  TaggedAST producer = MakeNodeLabel(type.second, producer_id, producer_name);
+  const AST& type = graph_.GetNodeTypeById(stream_type_id_);
+  TaggedAST consumer = MakeNodeLabel(type, consumer_id, consumer_name);
+  TaggedAST producer = MakeNodeLabel(type, producer_id, producer_name);
   NodeId consumer_node = graph_.FindOrAddNode(consumer);
   NodeId producer_node = graph_.FindOrAddNode(producer);
   TaggedAST edge_label;
@@ -110,7 +134,37 @@ void StreamDependencyGraph::AddDependency(const string& consumer_id,
   graph_.FindOrAddEdge(consumer_node, producer_node, edge_label);
 }
 
+void StreamDependencyGraph::AddDependencies(
+    const string& consumer_id, const string& consumer_name,
+    const std::vector<std::pair<string, string>>& producers) {
+  CHECK(is_initialized_, kInitializationErr);
+  if (producers.empty()) {
+    return;
+  }
+  const AST& type = graph_.GetNodeTypeById(stream_type_id_);
+  TaggedAST edge_label;
+  edge_label.set_tag(curio::kDependentTag);
+  *edge_label.mutable_ast() = value::MakeNull();
+  const int num_producers = static_cast<int>(producers.size());
+  LabeledGraph::BulkLoader loader(&graph_);
+  loader.Reserve(num_producers + 1, num_producers);
+  NodeId consumer_node =
+      loader.AddNode(MakeNodeLabel(type, consumer_id, consumer_name));
+  for (const auto& producer : producers) {
+    NodeId producer_node = loader.AddNode(
+        MakeNodeLabel(type, producer.first, producer.second));
+    loader.AddEdge(consumer_node, producer_node, edge_label);
+  }
+  loader.Finish();
+}
+
 string StreamDependencyGraph::ToDot() const {
+  std::ostringstream dot_graph;
+  WriteDot(&dot_graph);
+  return dot_graph.str();
+}
+
+void StreamDependencyGraph::WriteDot(std::ostream* out) const {
   CHECK(is_initialized_, kInitializationErr);
   AttributeFn node_attribute = [](const string& tag, const AST& ast) {
     return DotPrinter::NodeAttribute(tag, ast.c_ast().arg(1));
@@ -118,9 +172,79 @@ string StreamDependencyGraph::ToDot() const {
   AttributeFn edge_attribute = DotPrinter::EdgeAttribute;
 
   DotPrinter dot_printer(node_attribute, edge_attribute);
-  string dot_graph = dot_printer.AllNodesInDot(graph_);
-  util::StrAppend(&dot_graph, dot_printer.AllEdgesInDot(graph_), "\n");
-  return util::StrCat("digraph stream_dependencies {\n", dot_graph, "}");
+  *out << "digraph stream_dependencies {\n";
+  dot_printer.WriteAllNodes(graph_, out);
+  dot_printer.WriteAllEdges(graph_, out);
+  *out << "\n}";
+}
+
+// The components are numbered so that every dependency between two components
+// leads to a smaller component. The nodes are sorted by component, and the
+// depth of each component is computed from the depths of the smaller ones.
+StreamComponents StreamDependencyGraph::FindComponents() const {
+  CHECK(is_initialized_, kInitializationErr);
+  StreamComponents components;
+  components.component = graph_analyzer::StronglyConnectedComponents(graph_);
+  const std::vector<int>& component = components.component;
+  for (int c : component) {
+    components.num_components = std::max(components.num_components, c + 1);
+  }
+  std::vector<int> offsets(components.num_components + 1, 0);
+  for (int c : component) {
+    ++offsets[c + 1];
+  }
+  for (int c = 0; c < components.num_components; ++c) {
+    components.largest_component_size =
+        std::max(components.largest_component_size, offsets[c + 1]);
+    offsets[c + 1] += offsets[c];
+  }
+  std::vector<NodeId> members(component.size());
+  std::vector<int> next = offsets;
+  for (NodeId node = 0; node < component.size(); ++node) {
+    members[next[component[node]]++] = node;
+  }
+  std::vector<int> depth(components.num_components, 1);
+  for (int c = 0; c < components.num_components; ++c) {
+    bool is_cyclic = false;
+    for (int i = offsets[c]; i < offsets[c + 1]; ++i) {
+      for (NodeId successor : graph_.GetSuccessorRange(members[i])) {
+        int successor_component = component[successor];
+        if (successor_component == c) {
+          is_cyclic = true;
+        } else {
+          depth[c] = std::max(depth[c], depth[successor_component] + 1);
+        }
+      }
+    }
+    if (is_cyclic) {
+      ++components.num_cyclic_components;
+    }
+    components.depth = std::max(components.depth, depth[c]);
+  }
+  return components;
+}
+
+std::unique_ptr<LabeledGraph> StreamDependencyGraph::Condensation(
+    const StreamComponents& components) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(components.component.size() == static_cast<size_t>(graph_.NumNodes()),
+        kComponentsErr);
+  graph::QuotientConfig config(
+      condensation_type_,
+      graph::LabelAggregate::StringSet(curio::kComponentTag, {0}),
+      graph::LabelAggregate::Count(curio::kDependenciesTag),
+      false /*No self-edges*/);
+  return graph::QuotientGraph(graph_, components.component, config);
+}
+
+void StreamDependencyGraph::WriteCondensationDot(
+    const StreamComponents& components, std::ostream* out) const {
+  std::unique_ptr<LabeledGraph> condensation = Condensation(components);
+  DotPrinter dot_printer;
+  *out << "digraph stream_components {\n";
+  dot_printer.WriteAllNodes(*condensation, out);
+  dot_printer.WriteAllEdges(*condensation, out);
+  *out << "\n}";
 }
 
 }  // namespace morphie
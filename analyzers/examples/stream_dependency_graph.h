@@ -21,9 +21,20 @@
 //
 // A stream dependency graph represents dependencies between stream definitions.
 // If 't' depends on 's', then 's' is a producer and 't' is a consumer of data.
+//
+// Streams that depend on each other, directly or through other streams, form a
+// dependency cycle and are in the same strongly connected component of the
+// graph. Collapsing each component to one node gives an acyclic graph, the
+// condensation, whose longest path is the number of stages in which the
+// streams can be computed.
 #ifndef LOGLE_STREAM_DEPENDENCY_GRAPH_H_
 #define LOGLE_STREAM_DEPENDENCY_GRAPH_H_
 
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
 #include "base/string.h"
 #include "graph/graph_interface.h"
 #include "graph/labeled_graph.h"
@@ -31,6 +42,28 @@
 
 namespace morphie {
 
+// The strongly connected components of a stream dependency graph.
+struct StreamComponents {
+  StreamComponents()
+      : num_components(0),
+        num_cyclic_components(0),
+        largest_component_size(0),
+        depth(0) {}
+
+  // The component of each node, numbered as by
+  // graph_analyzer::StronglyConnectedComponents, so a stream only depends on
+  // streams in its own component or in components with smaller numbers.
+  std::vector<int> component;
+  int num_components;
+  // The number of components with more than one stream or with a stream that
+  // depends on itself.
+  int num_cyclic_components;
+  // The number of streams in the largest component.
+  int largest_component_size;
+  // The number of components on the longest path of the condensation.
+  int depth;
+};
+
 // The StreamDependencyGraph class implements a stream dependency graph. The
 // nodes in the graph are labels represented as abstract syntax trees (see
 // ast.proto). Each node label is a pair of strings with the first string
@@ -41,7 +74,7 @@ namespace morphie {
 // The functions will crash otherwise.
 class StreamDependencyGraph : public GraphInterface {
  public:
-  StreamDependencyGraph() : is_initialized_(false) {}
+  StreamDependencyGraph() : is_initialized_(false), stream_type_id_(kNoType) {}
 
   // Initialize the graph. Returns
   // - Status::OK - if a graph with the appropriate node and edge types has
@@ -58,9 +91,36 @@ class StreamDependencyGraph : public GraphInterface {
   // Creates nodes for consumer and producer if they do not already exist.
   void AddDependency(const string& consumer_id, const string& consumer_name,
                      const string& producer_id, const string& producer_name);
+  // Adds an edge for a dependency of the consumer on each producer in
+  // 'producers', which are given as pairs of an id and a name, and creates
+  // nodes as AddDependency does. The result is the same as calling
+  // AddDependency for each producer in order, but the consumer node and the
+  // edge label are only constructed once and the nodes and edges are added in
+  // one pass.
+  void AddDependencies(
+      const string& consumer_id, const string& consumer_name,
+      const std::vector<std::pair<string, string>>& producers);
 
   // Return a representation of the graph in Graphviz DOT format.
   string ToDot() const;
+  // Writes the representation returned by ToDot() to 'out' incrementally.
+  void WriteDot(std::ostream* out) const;
+
+  // Computes the strongly connected components of the graph in time linear in
+  // the number of nodes and edges.
+  StreamComponents FindComponents() const;
+  // Returns the condensation of the graph for the components returned by
+  // FindComponents(). Each component is a node labelled with the set of
+  // identifiers of its streams, with the tag curio::kComponentTag. An edge
+  // from one component to another is labelled with the number of dependencies
+  // between their streams, with the tag curio::kDependenciesTag. Dependencies
+  // within a component are dropped, so the condensation is acyclic.
+  // - Crashes unless 'components' has one entry for each node of the graph.
+  std::unique_ptr<LabeledGraph> Condensation(
+      const StreamComponents& components) const;
+  // Writes a Graphviz DOT representation of the condensation to 'out'.
+  void WriteCondensationDot(const StreamComponents& components,
+                            std::ostream* out) const;
 
  private:
   // This variable is set to false by the constructor and is set to 'true' if
@@ -68,6 +128,10 @@ class StreamDependencyGraph : public GraphInterface {
   bool is_initialized_;
 
   LabeledGraph graph_;
+  // The id of the type of stream labels in 'graph_'.
+  TypeId stream_type_id_;
+  // A graph without nodes or edges that holds the types of the condensation.
+  LabeledGraph condensation_type_;
 };
 
 }  // namespace morphie
@@ -14,6 +14,8 @@
 
 #include "analyzers/examples/stream_dependency_graph.h"
 
+#include <sstream>
+
 #include "base/vector.h"
 
 #include "base/string.h"
@@ -28,7 +30,11 @@ TEST(PlasoEventGraphDeathTest, UninitializedCalls) {
   EXPECT_DEATH({ graph.NumNodes(); }, kInitializationRegEx);
   EXPECT_DEATH({ graph.NumEdges(); }, kInitializationRegEx);
   EXPECT_DEATH({ graph.AddDependency("", "", "", ""); }, kInitializationRegEx);
+  EXPECT_DEATH({ graph.AddDependencies("", "", {}); }, kInitializationRegEx);
   EXPECT_DEATH({ graph.ToDot(); }, kInitializationRegEx);
+  std::ostringstream dot;
+  EXPECT_DEATH({ graph.WriteDot(&dot); }, kInitializationRegEx);
+  EXPECT_DEATH({ graph.FindComponents(); }, kInitializationRegEx);
 }
 
 static const std::vector<std::pair<string, string>> streams = {
@@ -66,5 +72,87 @@ TEST(PlasoEventGraphTest, AddDependency) {
   EXPECT_EQ(3, graph.NumEdges());
 }
 
+// Adding the dependencies of a consumer in one batch gives the same graph as
+// adding them one at a time, including duplicate and self-dependencies.
+TEST(PlasoEventGraphTest, AddDependencies) {
+  StreamDependencyGraph expected;
+  ASSERT_TRUE(expected.Initialize().ok());
+  StreamDependencyGraph graph;
+  ASSERT_TRUE(graph.Initialize().ok());
+  std::vector<std::pair<string, string>> producers = {
+      streams[1], streams[2], streams[1], streams[0]};
+  for (const auto& producer : producers) {
+    expected.AddDependency(streams[0].first, streams[0].second, producer.first,
+                           producer.second);
+  }
+  graph.AddDependencies(streams[0].first, streams[0].second, producers);
+  EXPECT_EQ(3, graph.NumNodes());
+  EXPECT_EQ(3, graph.NumEdges());
+  graph.AddDependencies(streams[1].first, streams[1].second, {});
+  graph.AddDependencies(streams[1].first, streams[1].second, {streams[2]});
+  expected.AddDependency(streams[1].first, streams[1].second, streams[2].first,
+                         streams[2].second);
+  EXPECT_EQ(4, graph.NumEdges());
+  EXPECT_EQ(expected.ToDot(), graph.ToDot());
+}
+
+// Construct the dependency graph below, in which stream2 and stream3 form a
+// cycle and stream4 depends on itself, and check its components and
+// condensation.
+//
+//   stream1 --> stream2 <--> stream3 --> stream4 --+
+//                                           ^      |
+//                                           +------+
+TEST(PlasoEventGraphTest, FindsComponents) {
+  StreamDependencyGraph graph;
+  ASSERT_TRUE(graph.Initialize().ok());
+  graph.AddDependency("s1", "stream1", "s2", "stream2");
+  graph.AddDependency("s2", "stream2", "s3", "stream3");
+  graph.AddDependency("s3", "stream3", "s2", "stream2");
+  graph.AddDependency("s3", "stream3", "s4", "stream4");
+  graph.AddDependency("s4", "stream4", "s4", "stream4");
+  StreamComponents components = graph.FindComponents();
+  ASSERT_EQ(4u, components.component.size());
+  EXPECT_EQ(3, components.num_components);
+  EXPECT_EQ(2, components.num_cyclic_components);
+  EXPECT_EQ(2, components.largest_component_size);
+  EXPECT_EQ(3, components.depth);
+  // Nodes are numbered in the order in which they were added.
+  EXPECT_EQ(components.component[1], components.component[2]);
+  EXPECT_LT(components.component[3], components.component[1]);
+  EXPECT_LT(components.component[1], components.component[0]);
+  std::unique_ptr<LabeledGraph> condensation = graph.Condensation(components);
+  ASSERT_NE(nullptr, condensation);
+  EXPECT_EQ(3, condensation->NumNodes());
+  EXPECT_EQ(2, condensation->NumEdges());
+  std::ostringstream dot;
+  graph.WriteCondensationDot(components, &dot);
+  EXPECT_EQ(0u, dot.str().find("digraph stream_components {"));
+  EXPECT_NE(string::npos, dot.str().find("s3"));
+}
+
+// A graph without cycles has one component per stream, and its depth is the
+// number of streams on the longest chain of dependencies.
+TEST(PlasoEventGraphTest, AcyclicGraphComponents) {
+  StreamDependencyGraph graph;
+  ASSERT_TRUE(graph.Initialize().ok());
+  EXPECT_EQ(0, graph.FindComponents().num_components);
+  EXPECT_EQ(0, graph.FindComponents().depth);
+  graph.AddDependency(streams[0].first, streams[0].second, streams[1].first,
+                      streams[1].second);
+  graph.AddDependency(streams[0].first, streams[0].second, streams[2].first,
+                      streams[2].second);
+  graph.AddDependency(streams[1].first, streams[1].second, streams[2].first,
+                      streams[2].second);
+  StreamComponents components = graph.FindComponents();
+  EXPECT_EQ(3, components.num_components);
+  EXPECT_EQ(0, components.num_cyclic_components);
+  EXPECT_EQ(1, components.largest_component_size);
+  EXPECT_EQ(3, components.depth);
+  std::unique_ptr<LabeledGraph> condensation = graph.Condensation(components);
+  EXPECT_EQ(3, condensation->NumNodes());
+  EXPECT_EQ(3, condensation->NumEdges());
+}
+
 }  // namespace
 }  // namespace morphie
@@ -0,0 +1,143 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/directory_trie.h"
+
+#include "util/logging.h"
+
+namespace morphie {
+namespace plaso {
+
+namespace {
+
+const char kDirectoryErr[] = "The directory is not in the trie.";
+
+}  // namespace
+
+const int DirectoryTrie::kRoot;
+const int DirectoryTrie::kNotFound;
+
+DirectoryTrie::DirectoryTrie() {
+  parents_.push_back(kNotFound);
+  last_components_.push_back(kNotFound);
+  children_.emplace_back();
+}
+
+int DirectoryTrie::FindOrAdd(const Directory& directory) {
+  int dir_id = kRoot;
+  for (const string& component : directory.path()) {
+    dir_id = FindOrAddChild(dir_id, component);
+  }
+  return dir_id;
+}
+
+int DirectoryTrie::FindOrAddChild(int dir_id, const string& component) {
+  CheckDirectory(dir_id);
+  auto inserted = component_ids_.emplace(component, NumComponents());
+  if (inserted.second) {
+    components_.push_back(component);
+  }
+  const int component_id = inserted.first->second;
+  auto child = child_ids_.emplace(ChildKey(dir_id, component_id),
+                                  NumDirectories());
+  if (child.second) {
+    parents_.push_back(dir_id);
+    last_components_.push_back(component_id);
+    children_.emplace_back();
+    children_[dir_id].push_back(child.first->second);
+  }
+  return child.first->second;
+}
+
+int DirectoryTrie::Find(const Directory& directory) const {
+  int dir_id = kRoot;
+  for (const string& component : directory.path()) {
+    auto component_it = component_ids_.find(component);
+    if (component_it == component_ids_.end()) {
+      return kNotFound;
+    }
+    auto child_it = child_ids_.find(ChildKey(dir_id, component_it->second));
+    if (child_it == child_ids_.end()) {
+      return kNotFound;
+    }
+    dir_id = child_it->second;
+  }
+  return dir_id;
+}
+
+int DirectoryTrie::Parent(int dir_id) const {
+  CheckDirectory(dir_id);
+  return parents_[dir_id];
+}
+
+Directory DirectoryTrie::ToDirectory(int dir_id) const {
+  CheckDirectory(dir_id);
+  std::vector<int> path;
+  for (int id = dir_id; id != kRoot; id = parents_[id]) {
+    path.push_back(last_components_[id]);
+  }
+  Directory directory;
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    directory.add_path(components_[*it]);
+  }
+  return directory;
+}
+
+void DirectoryTrie::CollectSubtree(int dir_id, std::vector<int>* dirs) const {
+  CheckDirectory(dir_id);
+  CHECK(dirs != nullptr, "");
+  // The directories from position 'next' on have been appended but their
+  // children have not.
+  size_t next = dirs->size();
+  dirs->push_back(dir_id);
+  while (next < dirs->size()) {
+    const std::vector<int>& children = children_[(*dirs)[next]];
+    dirs->insert(dirs->end(), children.begin(), children.end());
+    ++next;
+  }
+}
+
+int64_t DirectoryTrie::ChildKey(int dir_id, int component_id) {
+  return (static_cast<int64_t>(dir_id) << 32) |
+         static_cast<uint32_t>(component_id);
+}
+
+void DirectoryTrie::CheckDirectory(int dir_id) const {
+  CHECK(dir_id >= 0 && dir_id < NumDirectories(), kDirectoryErr);
+}
+
+InternedFile InternFilename(const string& filename, DirectoryTrie* trie) {
+  CHECK(trie != nullptr, "");
+  InternedFile file;
+  const size_t last_delim = filename.rfind('/');
+  if (last_delim == string::npos) {
+    file.directory = DirectoryTrie::kNotFound;
+    file.basename = filename;
+    return file;
+  }
+  file.directory = DirectoryTrie::kRoot;
+  string component;
+  size_t begin = 0;
+  while (begin <= last_delim) {
+    size_t end = filename.find('/', begin);
+    component.assign(filename, begin, end - begin);
+    file.directory = trie->FindOrAddChild(file.directory, component);
+    begin = end + 1;
+  }
+  file.basename = filename.substr(last_delim + 1);
+  return file;
+}
+
+}  // namespace plaso
+}  // namespace morphie
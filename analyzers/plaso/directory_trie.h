@@ -0,0 +1,113 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Plaso filenames share long directory prefixes, such as the user profile
+// directories of a Windows image. A directory trie stores each distinct
+// directory once as a node that refers to its parent directory and to an
+// interned path component, so that a file can be represented by the id of its
+// directory and its basename, and the directories below a directory can be
+// enumerated without comparing paths.
+//
+// Directories are sequences of path components as in the Directory proto, so
+// the directory of "/usr/local/bin" has the components "", "usr" and "local".
+//
+// Example.
+//   DirectoryTrie trie;
+//   InternedFile file = InternFilename("/usr/local/bin", &trie);
+//   // file.directory is the id of "/usr/local" and file.basename is "bin".
+//   std::vector<int> dirs;
+//   trie.CollectSubtree(trie.Find(ParseFilename("/usr/").directory()), &dirs);
+//   // 'dirs' contains the ids of "/usr" and "/usr/local".
+#ifndef LOGLE_PLASO_DIRECTORY_TRIE_H_
+#define LOGLE_PLASO_DIRECTORY_TRIE_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "base/string.h"
+#include "plaso_event.pb.h"
+
+namespace morphie {
+namespace plaso {
+
+class DirectoryTrie {
+ public:
+  // The id of the directory with no components, which is the root of the trie.
+  static const int kRoot = 0;
+  // The id returned for a directory that is not in the trie.
+  static const int kNotFound = -1;
+
+  DirectoryTrie();
+
+  // Returns the id of the directory 'directory', which is added to the trie
+  // with its ancestors if it is not in the trie.
+  int FindOrAdd(const Directory& directory);
+  // Returns the id of the child of 'dir_id' with the last component
+  // 'component', which is added if it does not exist.
+  // - Requires that 'dir_id' is a directory in the trie.
+  int FindOrAddChild(int dir_id, const string& component);
+  // Returns the id of 'directory' or kNotFound.
+  int Find(const Directory& directory) const;
+
+  int NumDirectories() const { return static_cast<int>(parents_.size()); }
+  // The number of distinct path components.
+  int NumComponents() const { return static_cast<int>(components_.size()); }
+  // Returns the parent of 'dir_id', or kNotFound for the root.
+  // - Requires that 'dir_id' is a directory in the trie.
+  int Parent(int dir_id) const;
+  // Returns the directory with the id 'dir_id'.
+  // - Requires that 'dir_id' is a directory in the trie.
+  Directory ToDirectory(int dir_id) const;
+  // Appends 'dir_id' and the ids of all directories below it to 'dirs'.
+  // Takes time linear in the number of appended directories.
+  // - Requires that 'dir_id' is a directory in the trie.
+  void CollectSubtree(int dir_id, std::vector<int>* dirs) const;
+
+ private:
+  // Returns the key of the child of 'dir_id' with the component 'component_id'
+  // in 'children_'.
+  static int64_t ChildKey(int dir_id, int component_id);
+  // Checks that 'dir_id' is a directory in the trie.
+  void CheckDirectory(int dir_id) const;
+
+  // The interned path components and the index from components to their ids.
+  std::vector<string> components_;
+  std::unordered_map<string, int> component_ids_;
+  // The entries at position 'i' are the parent, the last component and the
+  // children of the directory with id 'i'.
+  std::vector<int> parents_;
+  std::vector<int> last_components_;
+  std::vector<std::vector<int>> children_;
+  // Maps the key of a parent and a component to the child directory.
+  std::unordered_map<int64_t, int> child_ids_;
+};
+
+// A filename represented by the id of its directory in a DirectoryTrie and its
+// basename. 'directory' is DirectoryTrie::kNotFound if the filename has no
+// directory.
+struct InternedFile {
+  int directory;
+  string basename;
+};
+
+// Parses 'filename' as ParseFilename() in plaso_event.h does and adds its
+// directory to 'trie' without constructing a File proto. The basename is empty
+// if the filename has no basename.
+InternedFile InternFilename(const string& filename, DirectoryTrie* trie);
+
+}  // namespace plaso
+}  // namespace morphie
+
+#endif  // LOGLE_PLASO_DIRECTORY_TRIE_H_
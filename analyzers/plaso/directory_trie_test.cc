@@ -0,0 +1,97 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/directory_trie.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "analyzers/plaso/plaso_event.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace plaso {
+namespace {
+
+// Returns the directory of the Plaso filename 'filename'.
+Directory GetDirectory(const string& filename) {
+  return ParseFilename(filename).directory();
+}
+
+// Directories with a common prefix share the directories of the prefix.
+TEST(DirectoryTrieTest, SharesPrefixes) {
+  DirectoryTrie trie;
+  EXPECT_EQ(1, trie.NumDirectories());
+  int local = trie.FindOrAdd(GetDirectory("/usr/local/"));
+  EXPECT_EQ(4, trie.NumDirectories());
+  int bin = trie.FindOrAdd(GetDirectory("/usr/bin/"));
+  EXPECT_EQ(5, trie.NumDirectories());
+  EXPECT_EQ(4, trie.NumComponents());
+  EXPECT_EQ(trie.Parent(local), trie.Parent(bin));
+  EXPECT_EQ(local, trie.FindOrAdd(GetDirectory("/usr/local/")));
+  EXPECT_EQ(local, trie.Find(GetDirectory("/usr/local/")));
+  EXPECT_EQ(DirectoryTrie::kNotFound, trie.Find(GetDirectory("/usr/lib/")));
+  EXPECT_EQ(DirectoryTrie::kNotFound, trie.Find(GetDirectory("/bin/")));
+  EXPECT_EQ(DirectoryTrie::kRoot, trie.Find(Directory()));
+  EXPECT_EQ(DirectoryTrie::kNotFound, trie.Parent(DirectoryTrie::kRoot));
+  Directory directory = trie.ToDirectory(local);
+  ASSERT_EQ(3, directory.path_size());
+  EXPECT_EQ("", directory.path(0));
+  EXPECT_EQ("usr", directory.path(1));
+  EXPECT_EQ("local", directory.path(2));
+}
+
+TEST(DirectoryTrieTest, CollectsSubtrees) {
+  DirectoryTrie trie;
+  int usr = trie.FindOrAdd(GetDirectory("/usr/"));
+  int local_bin = trie.FindOrAdd(GetDirectory("/usr/local/bin/"));
+  int bin = trie.FindOrAdd(GetDirectory("/usr/bin/"));
+  trie.FindOrAdd(GetDirectory("/etc/"));
+  std::vector<int> dirs;
+  trie.CollectSubtree(usr, &dirs);
+  std::sort(dirs.begin(), dirs.end());
+  EXPECT_EQ(std::vector<int>({usr, trie.Parent(local_bin), local_bin, bin}),
+            dirs);
+  dirs.clear();
+  trie.CollectSubtree(bin, &dirs);
+  EXPECT_EQ(std::vector<int>({bin}), dirs);
+}
+
+// Interned filenames have the directories and basenames of parsed filenames.
+TEST(DirectoryTrieTest, InternsFilenames) {
+  DirectoryTrie trie;
+  for (const char* filename :
+       {"", "/", "filename.txt", "/usr/local/", "/foo/bar/baz.f"}) {
+    File file = ParseFilename(filename);
+    InternedFile interned = InternFilename(filename, &trie);
+    EXPECT_EQ(file.has_filename() ? file.filename() : "", interned.basename);
+    if (file.has_directory()) {
+      EXPECT_EQ(trie.Find(file.directory()), interned.directory);
+      EXPECT_NE(DirectoryTrie::kNotFound, interned.directory);
+    } else {
+      EXPECT_EQ(DirectoryTrie::kNotFound, interned.directory);
+    }
+  }
+}
+
+TEST(DirectoryTrieDeathTest, RequiresDirectoriesInTheTrie) {
+  DirectoryTrie trie;
+  EXPECT_DEATH({ trie.Parent(1); }, "The directory is not in the trie.");
+  EXPECT_DEATH({ trie.FindOrAddChild(-1, "usr"); },
+               "The directory is not in the trie.");
+}
+
+}  // namespace
+}  // namespace plaso
+}  // namespace morphie
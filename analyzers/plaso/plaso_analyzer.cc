@@ -14,18 +14,36 @@
 
 #include "analyzers/plaso/plaso_analyzer.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <boost/algorithm/string/join.hpp>  // NOLINT
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>  // NOLINT
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "analyzers/plaso/plaso_defs.h"
 #include "analyzers/plaso/plaso_event.h"
+#include "analyzers/plaso/plaso_event_sorter.h"
 #include "base/vector.h"
+#include "graph/graph_file.h"
 #include "util/json_reader.h"
 #include "util/logging.h"
+#include "util/stats.h"
 #include "util/status.h"
 #include "util/string_utils.h"
+#include "util/thread_pool.h"
+#include "util/trace.h"
 
 namespace {
 
@@ -35,6 +53,417 @@ const int kMaxMalformedLines = 1000000;
 
 namespace morphie {
 
+namespace {
+
+// The number of lines handed to a parsing thread at a time, and the maximum
+// number of chunks per thread that are read but have not been added to the
+// graph. The latter bounds the memory used by the pipeline.
+const int kLinesPerChunk = 1024;
+const int kChunksInFlightPerThread = 4;
+
+const char kNoGraphErr[] = "The graph has not been built.";
+const char kPageSizeErr[] = "The size of a page must be positive.";
+const char kPageWriteErr[] = "A page of the graph could not be written.";
+const char kSummaryErr[] = "The number of nodes and threads of a summary must "
+    "be positive.";
+const char kTimelineGranularityErr[] = "The granularity of a timeline must "
+    "be positive.";
+const char kCheckpointInputErr[] = "Checkpoints require JSON stream input.";
+const char kCheckpointIntervalErr[] = "The number of lines between "
+    "checkpoints must be positive.";
+const char kCheckpointErr[] = "Malformed checkpoint: ";
+const char kCheckpointOtherInputErr[] = "The checkpoint is a checkpoint of "
+    "another input: ";
+const char kCheckpointReadErr[] = "Error reading checkpoint: ";
+const char kCheckpointWriteErr[] = "Error writing checkpoint: ";
+
+// The suffix of the name of the graph file of a checkpoint.
+const char kGraphFileSuffix[] = ".graph";
+const char kShardInputErr[] = "Shards require JSON stream input.";
+const char kShardErr[] = "The shard index must be at least 0 and less than "
+    "the number of shards.";
+const char kShardSeekErr[] = "Shards require JSON streams that can seek, such "
+    "as uncompressed files.";
+const char kWindowErr[] = "A window and the period of its snapshots must be "
+    "positive.";
+const char kSortRunErr[] = "The number of events of a sorted run must be "
+    "positive.";
+
+// Returns true if 'json_event' has every field in 'required_fields'.
+bool HasRequiredFields(const std::set<string>& required_fields,
+                       const Json::Value& json_event) {
+  return std::all_of(required_fields.begin(), required_fields.end(),
+                     [&json_event](const string& field) {
+                       return json_event.isMember(field);
+                     });
+}
+
+// Moves 'stream' to the byte offset 'offset'. A stream that cannot seek, such
+// as the stream of a compressed file, is read up to the offset.
+void SeekStream(std::istream* stream, int64_t offset) {
+  if (offset == 0) {
+    return;
+  }
+  stream->seekg(offset);
+  if (!stream->fail()) {
+    return;
+  }
+  stream->clear();
+  stream->ignore(offset);
+}
+
+// A chunk of consecutive lines of a JSON stream and the events parsed from
+// those lines. Lines without all required fields and dropped lines are counted
+// in 'num_skipped', and 'num_bytes' counts the bytes of the lines and of their
+// newlines. The lines are followed by the byte at offset 'stream_offset' of
+// the stream with index 'stream_index'.
+struct EventChunk {
+  std::vector<string> lines;
+  std::vector<PlasoEvent> events;
+  int num_skipped = 0;
+  int64_t num_bytes = 0;
+  int stream_index = 0;
+  int64_t stream_offset = 0;
+};
+
+// Returns the position of the first line of the concatenation of
+// 'json_streams', where the i-th stream has sizes[i] bytes, that begins at or
+// after the byte 'offset' of the concatenation, as the index of a stream and a
+// byte offset in that stream. The end of the input is the position
+// (json_streams.size(), 0). The streams are left at their beginning.
+std::pair<int, int64_t> FindLineStart(
+    const std::vector<std::istream*>& json_streams,
+    const std::vector<int64_t>& sizes, int64_t offset) {
+  size_t stream_index = 0;
+  while (stream_index < sizes.size() && offset >= sizes[stream_index]) {
+    offset -= sizes[stream_index];
+    ++stream_index;
+  }
+  if (stream_index == sizes.size() || offset == 0) {
+    return std::make_pair(static_cast<int>(stream_index), offset);
+  }
+  // The line that contains the byte before 'offset' ends at or after it.
+  std::istream* json_stream = json_streams[stream_index];
+  json_stream->seekg(offset - 1);
+  json_stream->ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  const int64_t line_start = json_stream->eof()
+                                 ? sizes[stream_index]
+                                 : static_cast<int64_t>(json_stream->tellg());
+  json_stream->clear();
+  json_stream->seekg(0);
+  if (line_start >= sizes[stream_index]) {
+    return std::make_pair(static_cast<int>(stream_index) + 1, int64_t{0});
+  }
+  return std::make_pair(static_cast<int>(stream_index), line_start);
+}
+
+// An EventPipeline reads a JSON stream in chunks of lines on one thread, parses
+// the chunks into PlasoEvent protos on several worker threads and returns the
+// parsed chunks to the caller in input order. The input is the concatenation
+// of several streams, each of which ends, like a StreamJson, at its end or at
+// an empty line. The pipeline crashes on a line that is not a JSON object. If
+// 'drop_skipped_events' is true, lines with events of type EventType::SKIP are
+// dropped, and lines that HasSkipDataType classifies as such are dropped
+// without being parsed. If 'stats' is not null, the time spent reading and
+// parsing chunks is added to its phases "read" and "parse". The input begins at
+// the byte offset 'first_offset' of the stream with index 'first_stream' and
+// ends before the first line that begins at or after the byte offset
+// 'end_offset' of the stream with index 'end_stream'.
+class EventPipeline {
+ public:
+  EventPipeline(const std::vector<std::istream*>& json_streams,
+                int num_threads, bool drop_skipped_events, util::Stats* stats,
+                int first_stream, int64_t first_offset, int end_stream,
+                int64_t end_offset);
+  // Stops the reader and the workers and waits for them to return.
+  ~EventPipeline();
+  EventPipeline(const EventPipeline&) = delete;
+  EventPipeline& operator=(const EventPipeline&) = delete;
+
+  // Moves the next chunk in input order into '*chunk'. Returns false if all
+  // chunks have been returned.
+  bool Next(EventChunk* chunk);
+
+ private:
+  void Read();
+  void Parse();
+
+  const std::vector<std::istream*> json_streams_;
+  const int first_stream_;
+  const int64_t first_offset_;
+  const size_t end_stream_;
+  const int64_t end_offset_;
+  const bool drop_skipped_events_;
+  util::Stats* const stats_;
+  const size_t max_chunks_in_flight_;
+  std::mutex mutex_;
+  std::condition_variable state_changed_;
+  // The fields below are guarded by 'mutex_'.
+  bool is_input_done_;
+  bool is_cancelled_;
+  int64_t num_chunks_read_;
+  int64_t num_chunks_returned_;
+  std::deque<std::pair<int64_t, std::unique_ptr<EventChunk>>> unparsed_;
+  std::map<int64_t, std::unique_ptr<EventChunk>> parsed_;
+  // Runs the reader and the parsing workers, each of which is a task that runs
+  // until the pipeline is done or cancelled. The tasks are scheduled last in
+  // the constructor so that they see initialized members.
+  util::ThreadPool pool_;
+};
+
+EventPipeline::EventPipeline(const std::vector<std::istream*>& json_streams,
+                             int num_threads, bool drop_skipped_events,
+                             util::Stats* stats, int first_stream,
+                             int64_t first_offset, int end_stream,
+                             int64_t end_offset)
+    : json_streams_(json_streams),
+      first_stream_(first_stream),
+      first_offset_(first_offset),
+      end_stream_(end_stream),
+      end_offset_(end_offset),
+      drop_skipped_events_(drop_skipped_events),
+      stats_(stats),
+      max_chunks_in_flight_(kChunksInFlightPerThread * num_threads),
+      is_input_done_(false),
+      is_cancelled_(false),
+      num_chunks_read_(0),
+      num_chunks_returned_(0),
+      pool_(num_threads + 1) {
+  for (int i = 0; i < num_threads; ++i) {
+    pool_.Schedule([this] { Parse(); });
+  }
+  pool_.Schedule([this] { Read(); });
+}
+
+EventPipeline::~EventPipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_cancelled_ = true;
+  }
+  state_changed_.notify_all();
+  pool_.Wait();
+}
+
+// A chunk may contain lines of consecutive streams. A line that is not the
+// last line of its stream is followed by a newline, which getline() consumes.
+void EventPipeline::Read() {
+  size_t stream_index = first_stream_;
+  int64_t stream_offset = first_offset_;
+  bool is_eof = stream_index >= json_streams_.size();
+  if (!is_eof) {
+    util::ScopedTimer timer(stats_, "read");
+    SeekStream(json_streams_[stream_index], stream_offset);
+  }
+  while (!is_eof) {
+    std::unique_ptr<EventChunk> chunk(new EventChunk);
+    chunk->lines.reserve(kLinesPerChunk);
+    {
+      util::ScopedTimer timer(stats_, "read");
+      util::ScopedSpan span("pipeline_read");
+      while (chunk->lines.size() < kLinesPerChunk) {
+        if (stream_index > end_stream_ ||
+            (stream_index == end_stream_ && stream_offset >= end_offset_)) {
+          is_eof = true;
+          break;
+        }
+        std::istream* json_stream = json_streams_[stream_index];
+        if (json_stream->peek() == '\n' || json_stream->eof()) {
+          if (stream_index + 1 == json_streams_.size()) {
+            is_eof = true;
+            break;
+          }
+          ++stream_index;
+          stream_offset = 0;
+          continue;
+        }
+        chunk->lines.emplace_back();
+        std::getline(*json_stream, chunk->lines.back());
+        int64_t num_bytes =
+            chunk->lines.back().size() + (json_stream->eof() ? 0 : 1);
+        stream_offset += num_bytes;
+        chunk->num_bytes += num_bytes;
+      }
+    }
+    chunk->stream_index = static_cast<int>(stream_index);
+    chunk->stream_offset = stream_offset;
+    std::unique_lock<std::mutex> lock(mutex_);
+    {
+      // The reader stalls while too many chunks are in flight.
+      util::ScopedSpan span("pipeline_read_stall");
+      state_changed_.wait(lock, [this] {
+        return is_cancelled_ ||
+               num_chunks_read_ - num_chunks_returned_ <
+                   static_cast<int64_t>(max_chunks_in_flight_);
+      });
+    }
+    if (is_cancelled_) {
+      return;
+    }
+    if (!chunk->lines.empty()) {
+      unparsed_.emplace_back(num_chunks_read_, std::move(chunk));
+      ++num_chunks_read_;
+    }
+    lock.unlock();
+    state_changed_.notify_all();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_input_done_ = true;
+  }
+  state_changed_.notify_all();
+}
+
+void EventPipeline::Parse() {
+  plaso::EventParser parser;
+  PlasoEvent event;
+  while (true) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    state_changed_.wait(lock, [this] {
+      return is_cancelled_ || is_input_done_ || !unparsed_.empty();
+    });
+    if (is_cancelled_ || unparsed_.empty()) {
+      return;
+    }
+    int64_t chunk_id = unparsed_.front().first;
+    std::unique_ptr<EventChunk> chunk = std::move(unparsed_.front().second);
+    unparsed_.pop_front();
+    lock.unlock();
+    {
+      util::ScopedTimer timer(stats_, "parse");
+      util::ScopedSpan span("pipeline_parse");
+      for (const string& line : chunk->lines) {
+        const char* begin = line.data();
+        const char* end = begin + line.size();
+        if ((drop_skipped_events_ && plaso::HasSkipDataType(begin, end)) ||
+            !parser.Parse(begin, end, &event) ||
+            (drop_skipped_events_ && event.type() == EventType::SKIP)) {
+          ++chunk->num_skipped;
+          continue;
+        }
+        chunk->events.push_back(std::move(event));
+      }
+      chunk->lines.clear();
+    }
+    lock.lock();
+    parsed_[chunk_id] = std::move(chunk);
+    lock.unlock();
+    state_changed_.notify_all();
+  }
+}
+
+bool EventPipeline::Next(EventChunk* chunk) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  {
+    // The builder stalls while the next chunk is read or parsed.
+    util::ScopedSpan span("pipeline_build_stall");
+    state_changed_.wait(lock, [this] {
+      return parsed_.count(num_chunks_returned_) > 0 ||
+             (is_input_done_ && num_chunks_returned_ == num_chunks_read_);
+    });
+  }
+  auto chunk_it = parsed_.find(num_chunks_returned_);
+  if (chunk_it == parsed_.end()) {
+    return false;
+  }
+  *chunk = std::move(*chunk_it->second);
+  parsed_.erase(chunk_it);
+  ++num_chunks_returned_;
+  lock.unlock();
+  state_changed_.notify_all();
+  return true;
+}
+
+// Writes 'checkpoint' to the file 'filename'. The checkpoint is written to a
+// temporary file that replaces the file, so the file always holds a complete
+// checkpoint.
+util::Status WriteCheckpointFile(const IngestCheckpoint& checkpoint,
+                                 const string& filename) {
+  const string temp_filename = util::StrCat(filename, ".tmp");
+  {
+    std::ofstream out_file(temp_filename,
+                           std::ofstream::out | std::ofstream::binary);
+    if (!out_file || !checkpoint.SerializeToOstream(&out_file)) {
+      return util::Status(Code::EXTERNAL,
+                          util::StrCat(kCheckpointWriteErr, temp_filename));
+    }
+    out_file.close();
+    if (!out_file) {
+      return util::Status(Code::EXTERNAL,
+                          util::StrCat(kCheckpointWriteErr, temp_filename));
+    }
+  }
+  if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    return util::Status(Code::EXTERNAL,
+                        util::StrCat(kCheckpointWriteErr, filename));
+  }
+  return util::Status::OK;
+}
+
+// A CheckpointWriter writes checkpoints on a pool with one worker, one at a
+// time.
+// A checkpoint is written by appending its segment to the graph file and then
+// replacing the checkpoint file, so the checkpoint file describes a prefix of
+// the graph file. After a checkpoint fails, no further checkpoints are written.
+class CheckpointWriter {
+ public:
+  CheckpointWriter(const string& checkpoint_file, const string& graph_file)
+      : checkpoint_file_(checkpoint_file),
+        graph_file_(graph_file),
+        is_writing_(false),
+        pool_(1) {}
+  // Waits until the checkpoint being written has been written.
+  ~CheckpointWriter() { Wait(); }
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  // Returns true if no checkpoint is being written.
+  bool IsIdle() const { return !is_writing_; }
+  // Starts writing the checkpoint 'checkpoint', whose graph file is the graph
+  // file of the previous checkpoint, of 'file_size' bytes, followed by
+  // 'segment'. The contents of 'segment' are unspecified afterwards.
+  // - Requires that IsIdle() is true.
+  void Write(string* segment, size_t file_size,
+             const IngestCheckpoint& checkpoint) {
+    Wait();
+    segment_.swap(*segment);
+    file_size_ = file_size;
+    checkpoint_ = checkpoint;
+    is_writing_ = true;
+    pool_.Schedule([this] { Run(); });
+  }
+  // Waits until the checkpoint being written, if any, has been written, and
+  // returns the status of the checkpoint that failed, or OK.
+  util::Status Wait() {
+    pool_.Wait();
+    return status_;
+  }
+
+ private:
+  void Run() {
+    if (status_.ok()) {
+      status_ = AppendGraphSegment(segment_, file_size_, graph_file_);
+    }
+    if (status_.ok()) {
+      status_ = WriteCheckpointFile(checkpoint_, checkpoint_file_);
+    }
+    segment_.clear();
+    is_writing_ = false;
+  }
+
+  const string checkpoint_file_;
+  const string graph_file_;
+  std::atomic<bool> is_writing_;
+  // The checkpoint being written and the status of the checkpoints, which are
+  // only accessed by the writing thread while a checkpoint is written.
+  string segment_;
+  size_t file_size_;
+  IngestCheckpoint checkpoint_;
+  util::Status status_;
+  util::ThreadPool pool_;
+};
+
+}  // namespace
+
 util::Status PlasoAnalyzer::Initialize(
     JsonDocumentIterator* doc_iterator) {
   CHECK(doc_iterator != nullptr, "The pointer to the JSON document is null.");
@@ -42,23 +471,479 @@ util::Status PlasoAnalyzer::Initialize(
   return util::Status::OK;
 }
 
+util::Status PlasoAnalyzer::Initialize(std::istream* json_stream,
+                                      int num_threads) {
+  CHECK(json_stream != nullptr, "The pointer to the JSON stream is null.");
+  return Initialize(std::vector<std::istream*>{json_stream}, num_threads);
+}
+
+util::Status PlasoAnalyzer::Initialize(
+    const std::vector<std::istream*>& json_streams, int num_threads) {
+  CHECK(!json_streams.empty(), "There are no JSON streams.");
+  for (std::istream* json_stream : json_streams) {
+    CHECK(json_stream != nullptr, "The pointer to the JSON stream is null.");
+  }
+  if (num_threads < 1) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        "The number of threads must be positive.");
+  }
+  json_streams_ = json_streams;
+  num_threads_ = num_threads;
+  return util::Status::OK;
+}
+
+util::Status PlasoAnalyzer::Initialize(PlasoEventReader* event_reader) {
+  CHECK(event_reader != nullptr, "The pointer to the event reader is null.");
+  event_reader_ = event_reader;
+  return util::Status::OK;
+}
+
+void PlasoAnalyzer::SetDropDuplicateEvents(int64_t max_fingerprints) {
+  deduplicator_.reset(new PlasoEventDeduplicator(max_fingerprints));
+}
+
+void PlasoAnalyzer::SetWindow(int64_t window, int64_t snapshot_period,
+                              const std::function<void()>& snapshot) {
+  CHECK(window > 0 && (snapshot == nullptr || snapshot_period > 0),
+        kWindowErr);
+  window_ = window;
+  snapshot_period_ = snapshot_period;
+  snapshot_ = snapshot;
+}
+
 void PlasoAnalyzer::BuildPlasoGraph() {
   plaso_graph_.reset(new PlasoEventGraph(show_all_sources_));
+  if (window_ > 0) {
+    plaso_graph_->SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE,
+                                   true /*Edges are incremental.*/);
+    plaso_graph_->SetWindow(window_);
+  }
   if (!plaso_graph_->Initialize().ok()) {
     plaso_graph_.reset(nullptr);
     return;
   }
-  return BuildPlasoGraphFromJSON();
+  has_snapshot_time_ = false;
+  if (!json_streams_.empty()) {
+    BuildPlasoGraphFromJSONStream(0, 0, json_streams_.size(), 0, nullptr);
+  } else if (event_reader_ != nullptr) {
+    BuildPlasoGraphFromEvents();
+  } else {
+    BuildPlasoGraphFromJSON();
+  }
+  if (window_ > 0) {
+    plaso_graph_->EvictExpiredEvents();
+    UpdateProgressGraphSize();
+  }
+}
+
+void PlasoAnalyzer::TriagePlasoEvents(PlasoTriage* triage) {
+  CHECK(triage != nullptr, "The pointer to the triage is null.");
+  util::ScopedSpan span("TriagePlasoEvents");
+  ReadEvents("triage", [this, triage](PlasoEvent* event) {
+    if (!IsDuplicate(*event)) {
+      triage->AddEvent(*event);
+    }
+    return true;
+  });
+}
+
+void PlasoAnalyzer::WritePlasoEvents(PlasoEventWriter* writer) {
+  CHECK(writer != nullptr, "The pointer to the event writer is null.");
+  util::ScopedSpan span("WritePlasoEvents");
+  ReadEvents("write", [this, writer](PlasoEvent* event) {
+    if (!IsDuplicate(*event)) {
+      writer->Write(*event);
+    }
+    return true;
+  });
+}
+
+// The graph is built with incremental temporal edges, which are the edges of
+// BuildPlasoGraph() because the events arrive in order of time.
+util::Status PlasoAnalyzer::BuildSortedPlasoGraph(
+    int64_t events_per_run, const string& spill_directory) {
+  if (events_per_run <= 0) {
+    return util::Status(Code::INVALID_ARGUMENT, kSortRunErr);
+  }
+  util::ScopedSpan span("BuildSortedPlasoGraph");
+  plaso_graph_.reset(new PlasoEventGraph(show_all_sources_));
+  plaso_graph_->SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE,
+                                 true /*Incremental edges*/);
+  if (window_ > 0) {
+    plaso_graph_->SetWindow(window_);
+  }
+  util::Status status = plaso_graph_->Initialize();
+  if (!status.ok()) {
+    plaso_graph_.reset(nullptr);
+    return status;
+  }
+  has_snapshot_time_ = false;
+  PlasoEventSorter sorter(events_per_run, spill_directory, stats_);
+  ReadEvents(nullptr, [&sorter, &status](PlasoEvent* event) {
+    status = sorter.Add(event);
+    return status.ok();
+  });
+  if (status.ok()) {
+    status = sorter.Merge(
+        [this](const std::vector<PlasoEvent>& events) { AddEvents(events); });
+  }
+  if (!status.ok()) {
+    plaso_graph_.reset(nullptr);
+    return status;
+  }
+  if (window_ > 0) {
+    plaso_graph_->EvictExpiredEvents();
+    UpdateProgressGraphSize();
+  }
+  return util::Status::OK;
+}
+
+// Snapshots are taken at multiples of the period, so the snapshots of two
+// streams with the same events are taken at the same times.
+bool PlasoAnalyzer::IsSnapshotDue(const PlasoEvent& event) {
+  if (snapshot_ == nullptr || !event.has_timestamp()) {
+    return false;
+  }
+  const int64_t timestamp = event.timestamp();
+  if (has_snapshot_time_ && timestamp < next_snapshot_time_) {
+    return false;
+  }
+  const bool is_due = has_snapshot_time_;
+  next_snapshot_time_ =
+      timestamp - timestamp % snapshot_period_ + snapshot_period_;
+  has_snapshot_time_ = true;
+  return is_due;
+}
+
+void PlasoAnalyzer::TakeSnapshot() {
+  util::ScopedTimer timer(stats_, "snapshot");
+  util::ScopedSpan span("TakeSnapshot");
+  plaso_graph_->EvictExpiredEvents();
+  snapshot_();
+}
+
+util::Status PlasoAnalyzer::LoadPlasoGraph(const string& filename) {
+  plaso_graph_.reset(new PlasoEventGraph(show_all_sources_));
+  util::Status status = plaso_graph_->Load(filename);
+  if (!status.ok()) {
+    plaso_graph_.reset(nullptr);
+  }
+  return status;
+}
+
+// The saved graph was built with CLIQUE edges by BuildPlasoGraph(), so new
+// events extend it with the same representation.
+util::Status PlasoAnalyzer::AppendToPlasoGraph(const string& filename) {
+  plaso_graph_.reset(new PlasoEventGraph(show_all_sources_));
+  plaso_graph_->SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE,
+                                 true /*Incremental edges*/);
+  util::Status status;
+  {
+    util::ScopedTimer timer(stats_, "graph_load");
+    status = plaso_graph_->Load(filename);
+  }
+  if (!status.ok()) {
+    plaso_graph_.reset(nullptr);
+    return status;
+  }
+  if (!json_streams_.empty()) {
+    BuildPlasoGraphFromJSONStream(0, 0, json_streams_.size(), 0, nullptr);
+  } else if (event_reader_ != nullptr) {
+    BuildPlasoGraphFromEvents();
+  } else {
+    BuildPlasoGraphFromJSON();
+  }
+  util::ScopedTimer timer(stats_, "graph_append");
+  return plaso_graph_->SaveDelta();
+}
+
+// A graph file may end with a segment that was appended after the checkpoint
+// file was last replaced, which is cut off.
+util::Status PlasoAnalyzer::ResumeFromCheckpoint(const string& checkpoint_file,
+                                                 const string& graph_file,
+                                                 const string& input_name,
+                                                 IngestCheckpoint* checkpoint) {
+  {
+    std::ifstream in_file(checkpoint_file,
+                          std::ifstream::in | std::ifstream::binary);
+    if (!checkpoint->ParseFromIstream(&in_file)) {
+      return util::Status(Code::INVALID_ARGUMENT,
+                          util::StrCat(kCheckpointErr, checkpoint_file));
+    }
+  }
+  if (checkpoint->input() != input_name) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kCheckpointOtherInputErr,
+                                     checkpoint->input()));
+  }
+  if (truncate(graph_file.c_str(), checkpoint->graph_file_size()) != 0) {
+    return util::Status(Code::EXTERNAL,
+                        util::StrCat(kCheckpointReadErr, graph_file));
+  }
+  util::Status status = plaso_graph_->Load(graph_file);
+  if (!status.ok()) {
+    return status;
+  }
+  if (plaso_graph_->NumNodes() != checkpoint->num_nodes() ||
+      plaso_graph_->NumEdges() != checkpoint->num_edges() ||
+      checkpoint->stream_index() < 0 || checkpoint->stream_offset() < 0) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kCheckpointErr, checkpoint_file));
+  }
+  num_lines_read_ = checkpoint->num_lines_read();
+  num_lines_skipped_ = checkpoint->num_lines_skipped();
+  return util::Status::OK;
+}
+
+// Every checkpoint is taken after a chunk of lines has been added to the
+// graph, so the builder collects the new nodes and edges while no events are
+// being added.
+util::Status PlasoAnalyzer::BuildPlasoGraphWithCheckpoints(
+    const string& checkpoint_file, const string& input_name,
+    int64_t lines_per_checkpoint) {
+  if (json_streams_.empty()) {
+    return util::Status(Code::INVALID_ARGUMENT, kCheckpointInputErr);
+  }
+  if (lines_per_checkpoint <= 0) {
+    return util::Status(Code::INVALID_ARGUMENT, kCheckpointIntervalErr);
+  }
+  const string graph_file = util::StrCat(checkpoint_file, kGraphFileSuffix);
+  plaso_graph_.reset(new PlasoEventGraph(show_all_sources_));
+  plaso_graph_->SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE,
+                                 true /*Incremental edges*/);
+  IngestCheckpoint checkpoint;
+  util::Status status;
+  struct stat file_stat;
+  if (stat(checkpoint_file.c_str(), &file_stat) == 0) {
+    util::ScopedTimer timer(stats_, "graph_load");
+    status = ResumeFromCheckpoint(checkpoint_file, graph_file, input_name,
+                                  &checkpoint);
+  } else {
+    status = plaso_graph_->Initialize();
+    if (status.ok()) {
+      status = plaso_graph_->Save(graph_file);
+    }
+    checkpoint.set_input(input_name);
+    if (status.ok() && stat(graph_file.c_str(), &file_stat) == 0) {
+      checkpoint.set_graph_file_size(file_stat.st_size);
+    }
+  }
+  if (!status.ok()) {
+    plaso_graph_.reset(nullptr);
+    return status;
+  }
+  CheckpointWriter writer(checkpoint_file, graph_file);
+  int64_t checkpoint_lines = num_lines_read_;
+  string segment;
+  // Records a checkpoint at the position that follows the lines added so far.
+  auto write_checkpoint = [this, &writer, &checkpoint, &checkpoint_lines,
+                           &segment, &status](int stream_index,
+                                              int64_t stream_offset) {
+    util::ScopedTimer timer(stats_, "checkpoint");
+    const size_t file_size = checkpoint.graph_file_size();
+    util::Status delta_status = plaso_graph_->TakeDelta(file_size, &segment);
+    if (!delta_status.ok()) {
+      status = delta_status;
+      return;
+    }
+    checkpoint.set_graph_file_size(file_size + segment.size());
+    checkpoint.set_num_nodes(plaso_graph_->NumNodes());
+    checkpoint.set_num_edges(plaso_graph_->NumEdges());
+    checkpoint.set_stream_index(stream_index);
+    checkpoint.set_stream_offset(stream_offset);
+    checkpoint.set_num_lines_read(num_lines_read_);
+    checkpoint.set_num_lines_skipped(num_lines_skipped_);
+    writer.Write(&segment, file_size, checkpoint);
+    checkpoint_lines = num_lines_read_;
+  };
+  int last_stream = checkpoint.stream_index();
+  int64_t last_offset = checkpoint.stream_offset();
+  BuildPlasoGraphFromJSONStream(
+      checkpoint.stream_index(), checkpoint.stream_offset(),
+      json_streams_.size(), 0, [&](int stream_index, int64_t stream_offset) {
+        last_stream = stream_index;
+        last_offset = stream_offset;
+        if (num_lines_read_ - checkpoint_lines >= lines_per_checkpoint &&
+            writer.IsIdle()) {
+          write_checkpoint(stream_index, stream_offset);
+        }
+      });
+  // The last checkpoint records the complete graph.
+  writer.Wait();
+  write_checkpoint(last_stream, last_offset);
+  util::Status write_status = writer.Wait();
+  return status.ok() ? write_status : status;
+}
+
+// A line belongs to the shard in whose byte range it begins, so every line is
+// read by exactly one shard, and a shard only reads its own range.
+util::Status PlasoAnalyzer::BuildPlasoGraphShard(int shard_index,
+                                                 int num_shards) {
+  if (json_streams_.empty()) {
+    return util::Status(Code::INVALID_ARGUMENT, kShardInputErr);
+  }
+  if (shard_index < 0 || shard_index >= num_shards) {
+    return util::Status(Code::INVALID_ARGUMENT, kShardErr);
+  }
+  std::vector<int64_t> sizes;
+  int64_t input_size = 0;
+  for (std::istream* json_stream : json_streams_) {
+    json_stream->seekg(0, std::istream::end);
+    const int64_t size = static_cast<int64_t>(json_stream->tellg());
+    if (json_stream->fail() || size < 0) {
+      json_stream->clear();
+      return util::Status(Code::INVALID_ARGUMENT, kShardSeekErr);
+    }
+    json_stream->seekg(0);
+    sizes.push_back(size);
+    input_size += size;
+  }
+  const std::pair<int, int64_t> first = FindLineStart(
+      json_streams_, sizes, input_size / num_shards * shard_index +
+                                input_size % num_shards * shard_index /
+                                    num_shards);
+  const std::pair<int, int64_t> end = FindLineStart(
+      json_streams_, sizes, input_size / num_shards * (shard_index + 1) +
+                                input_size % num_shards * (shard_index + 1) /
+                                    num_shards);
+  plaso_graph_.reset(new PlasoEventGraph(show_all_sources_));
+  util::Status status = plaso_graph_->Initialize();
+  if (!status.ok()) {
+    plaso_graph_.reset(nullptr);
+    return status;
+  }
+  BuildPlasoGraphFromJSONStream(first.first, first.second, end.first,
+                                end.second, nullptr);
+  return util::Status::OK;
+}
+
+util::Status PlasoAnalyzer::MergePlasoGraphs(
+    const std::vector<string>& filenames) {
+  plaso_graph_.reset(new PlasoEventGraph(show_all_sources_));
+  util::Status status;
+  {
+    util::ScopedTimer timer(stats_, "graph_merge");
+    status = plaso_graph_->Merge(filenames);
+  }
+  if (!status.ok()) {
+    plaso_graph_.reset(nullptr);
+  }
+  return status;
+}
+
+util::Status PlasoAnalyzer::SavePlasoGraph(const string& filename) const {
+  if (plaso_graph_ == nullptr) {
+    return util::Status(Code::INVALID_ARGUMENT, kNoGraphErr);
+  }
+  return plaso_graph_->Save(filename);
+}
+
+util::Status PlasoAnalyzer::RestrictPlasoGraph(
+    const std::vector<TaggedAST>& labels, const std::set<string>& tags,
+    int max_hops, int max_nodes, int num_threads) {
+  if (plaso_graph_ == nullptr) {
+    return util::Status(Code::INVALID_ARGUMENT, kNoGraphErr);
+  }
+  return plaso_graph_->RestrictOutput(labels, tags, max_hops, max_nodes,
+                                      num_threads);
+}
+
+util::Status PlasoAnalyzer::SummarizePlasoGraph(int max_nodes,
+                                                int num_threads) {
+  if (plaso_graph_ == nullptr) {
+    return util::Status(Code::INVALID_ARGUMENT, kNoGraphErr);
+  }
+  if (max_nodes <= 0 || num_threads <= 0) {
+    return util::Status(Code::INVALID_ARGUMENT, kSummaryErr);
+  }
+  plaso_graph_->SetMaxOutputNodes(max_nodes, num_threads);
+  return util::Status::OK;
+}
+
+util::Status PlasoAnalyzer::SetPlasoGraphTimelineGranularity(
+    int64_t granularity) {
+  if (plaso_graph_ == nullptr) {
+    return util::Status(Code::INVALID_ARGUMENT, kNoGraphErr);
+  }
+  if (granularity <= 0) {
+    return util::Status(Code::INVALID_ARGUMENT, kTimelineGranularityErr);
+  }
+  plaso_graph_->SetTimelineGranularity(granularity);
+  return util::Status::OK;
+}
+
+void PlasoAnalyzer::ClearPlasoGraphOutputOptions() {
+  if (plaso_graph_ != nullptr) {
+    plaso_graph_->ClearOutputOptions();
+  }
 }
 
 string PlasoAnalyzer::PlasoGraphDot() const {
   return (plaso_graph_ == nullptr) ? "" : plaso_graph_->ToDot();
 }
 
+void PlasoAnalyzer::WritePlasoGraphDot(std::ostream* out) const {
+  if (plaso_graph_ != nullptr) {
+    plaso_graph_->WriteDot(out);
+  }
+}
+
 string PlasoAnalyzer::PlasoGraphPbTxt() const {
   return (plaso_graph_ == nullptr) ? "" : plaso_graph_->ToPbTxt();
 }
 
+void PlasoAnalyzer::WritePlasoGraphPbTxt(std::ostream* out) const {
+  if (plaso_graph_ != nullptr) {
+    plaso_graph_->WritePbTxt(out);
+  }
+}
+
+void PlasoAnalyzer::WritePlasoGraphPb(std::ostream* out) const {
+  if (plaso_graph_ != nullptr) {
+    plaso_graph_->WritePb(out);
+  }
+}
+
+util::Status PlasoAnalyzer::WritePlasoGraphPbPages(
+    int page_size, const viz::PageWriter& write_page,
+    graph_explorer::GraphManifest* manifest) const {
+  if (plaso_graph_ == nullptr) {
+    return util::Status(Code::INVALID_ARGUMENT, kNoGraphErr);
+  }
+  if (page_size <= 0) {
+    return util::Status(Code::INVALID_ARGUMENT, kPageSizeErr);
+  }
+  bool is_written = true;
+  viz::PageWriter record_page = [&write_page, &is_written](
+      int index, const graph_explorer::GraphDef& page) {
+    is_written = write_page(index, page);
+    return is_written;
+  };
+  *manifest = plaso_graph_->WritePbPages(page_size, record_page);
+  if (!is_written) {
+    return util::Status(Code::EXTERNAL, kPageWriteErr);
+  }
+  return util::Status::OK;
+}
+
+void PlasoAnalyzer::WritePlasoEventTable(std::ostream* out) const {
+  if (plaso_graph_ != nullptr) {
+    plaso_graph_->WriteEventTable(out);
+  }
+}
+
+void PlasoAnalyzer::WritePlasoResourceTable(std::ostream* out) const {
+  if (plaso_graph_ != nullptr) {
+    plaso_graph_->WriteResourceTable(out);
+  }
+}
+
+void PlasoAnalyzer::WritePlasoEdgeTable(std::ostream* out) const {
+  if (plaso_graph_ != nullptr) {
+    plaso_graph_->WriteEdgeTable(out);
+  }
+}
+
 string PlasoAnalyzer::PlasoGraphStats() const {
   if (plaso_graph_ == nullptr) {
     return "Graph has not been created!";
@@ -66,13 +951,156 @@ string PlasoAnalyzer::PlasoGraphStats() const {
   return plaso_graph_->GetStats();
 }
 
+util::MemoryBreakdown PlasoAnalyzer::PlasoGraphMemoryUsage() const {
+  if (plaso_graph_ == nullptr) {
+    return util::MemoryBreakdown();
+  }
+  return plaso_graph_->MemoryUsage();
+}
+
+void PlasoAnalyzer::UpdateProgressGraphSize() {
+  if (progress_ != nullptr) {
+    progress_->SetGraphSize(plaso_graph_->NumNodes(), plaso_graph_->NumEdges());
+  }
+}
+
 void PlasoAnalyzer::IncrementSkipCounter() {
   ++num_lines_skipped_;
+  if (progress_ != nullptr) {
+    progress_->lines_skipped.fetch_add(1, std::memory_order_relaxed);
+  }
   CHECK(num_lines_skipped_ < kMaxMalformedLines,
         "Over a million malformed lines in input. Aborting.");
 }
 
+// The events are read as in BuildPlasoGraphFromJSON() and
+// BuildPlasoGraphFromJSONStream(), so the same lines are skipped.
+void PlasoAnalyzer::ReadEvents(
+    const char* phase, const std::function<bool(PlasoEvent*)>& add_event) {
+  util::Stats* const phase_stats = phase != nullptr ? stats_ : nullptr;
+  if (!json_streams_.empty()) {
+    EventPipeline pipeline(json_streams_, num_threads_, drop_skipped_events_,
+                           stats_, 0, 0, json_streams_.size(), 0);
+    EventChunk chunk;
+    while (pipeline.Next(&chunk)) {
+      num_lines_read_ += chunk.events.size() + chunk.num_skipped;
+      if (progress_ != nullptr) {
+        progress_->AddLines(chunk.events.size() + chunk.num_skipped,
+                            chunk.num_bytes);
+      }
+      for (int i = 0; i < chunk.num_skipped; ++i) {
+        IncrementSkipCounter();
+      }
+      util::ScopedTimer timer(phase_stats, phase);
+      for (PlasoEvent& event : chunk.events) {
+        if (!add_event(&event)) {
+          return;
+        }
+      }
+    }
+    return;
+  }
+  if (event_reader_ != nullptr) {
+    std::vector<PlasoEvent> events;
+    while (ReadEventChunk(&events)) {
+      util::ScopedTimer timer(phase_stats, phase);
+      for (PlasoEvent& event : events) {
+        if (!add_event(&event)) {
+          return;
+        }
+      }
+    }
+    return;
+  }
+  const std::set<string> required_fields =
+      util::SplitToSet(plaso::kRequiredFields, ',');
+  CHECK(!required_fields.empty(), "No required fields in input.");
+  const Json::Value* json_event;
+  PlasoEvent event_data;
+  // The times of the phases are accumulated locally because the phases
+  // alternate for every event.
+  double parse_seconds = 0;
+  double convert_seconds = 0;
+  double phase_seconds = 0;
+  const bool is_timed = stats_ != nullptr;
+  bool is_done = false;
+  while (!is_done) {
+    {
+      util::ScopedTimer timer(is_timed ? &parse_seconds : nullptr);
+      if (!doc_iterator_->HasNext()) {
+        break;
+      }
+      json_event = doc_iterator_->Next();
+    }
+    CHECK(json_event != nullptr, "json_event is null!");
+    ++num_lines_read_;
+    if (progress_ != nullptr) {
+      progress_->AddLines(1, 0);
+    }
+    if (!HasRequiredFields(required_fields, *json_event)) {
+      IncrementSkipCounter();
+      continue;
+    }
+    {
+      util::ScopedTimer timer(is_timed ? &convert_seconds : nullptr);
+      event_data = plaso::ParseJSON(*json_event);
+    }
+    if (drop_skipped_events_ && event_data.type() == EventType::SKIP) {
+      IncrementSkipCounter();
+      continue;
+    }
+    util::ScopedTimer timer(phase_stats != nullptr ? &phase_seconds : nullptr);
+    is_done = !add_event(&event_data);
+  }
+  if (is_timed) {
+    stats_->AddTime("parse", parse_seconds);
+    stats_->AddTime("convert", convert_seconds);
+  }
+  if (phase_stats != nullptr) {
+    stats_->AddTime(phase, phase_seconds);
+  }
+}
+
+bool PlasoAnalyzer::IsDuplicate(const PlasoEvent& event) {
+  return deduplicator_ != nullptr && deduplicator_->IsDuplicate(event);
+}
+
+// The events are added in batches that end before the copies that are dropped
+// and before the events at which a snapshot is due.
+void PlasoAnalyzer::AddEvents(const std::vector<PlasoEvent>& events) {
+  std::vector<bool> is_duplicate(events.size(), false);
+  if (deduplicator_ != nullptr) {
+    util::ScopedTimer timer(stats_, "dedup");
+    for (size_t i = 0; i < events.size(); ++i) {
+      is_duplicate[i] = deduplicator_->IsDuplicate(events[i]);
+    }
+  }
+  size_t begin = 0;
+  for (size_t end = 0; end <= events.size(); ++end) {
+    if (end < events.size() && !is_duplicate[end] &&
+        !IsSnapshotDue(events[end])) {
+      continue;
+    }
+    if (end > begin) {
+      util::ScopedTimer timer(stats_, "graph_build");
+      util::ScopedSpan span("pipeline_build");
+      plaso_graph_->ProcessEvents(
+          util::Span<PlasoEvent>(events.data() + begin, end - begin));
+    }
+    if (end < events.size() && is_duplicate[end]) {
+      begin = end + 1;
+      continue;
+    }
+    if (end < events.size()) {
+      TakeSnapshot();
+    }
+    begin = end;
+  }
+  UpdateProgressGraphSize();
+}
+
 void PlasoAnalyzer::BuildPlasoGraphFromJSON() {
+  util::ScopedSpan span("BuildPlasoGraphFromJSON");
   const std::set<string> required_fields =
       util::SplitToSet(plaso::kRequiredFields, ',');
   CHECK(!required_fields.empty(), "No required fields in input.");
@@ -81,23 +1109,133 @@ void PlasoAnalyzer::BuildPlasoGraphFromJSON() {
   const Json::Value* json_event;
   // This proto will contain fields extracted from '*json_event'.
   PlasoEvent event_data;
-  bool has_all_fields;
+  // The times of the phases are accumulated locally because the phases
+  // alternate for every event.
+  double parse_seconds = 0;
+  double convert_seconds = 0;
+  double dedup_seconds = 0;
+  double graph_build_seconds = 0;
+  const bool is_timed = stats_ != nullptr;
 
-  while (this->doc_iterator_->HasNext()) {
-    json_event = this->doc_iterator_->Next();
+  while (true) {
+    {
+      util::ScopedTimer timer(is_timed ? &parse_seconds : nullptr);
+      if (!this->doc_iterator_->HasNext()) {
+        break;
+      }
+      json_event = this->doc_iterator_->Next();
+    }
     CHECK(json_event != nullptr, "json_event is null!");
-    has_all_fields = std::all_of(required_fields.begin(), required_fields.end(),
-                                 [json_event](const string& field) {
-                                   return json_event->isMember(field);
-                                 });
-    if (!has_all_fields) {
+    ++num_lines_read_;
+    if (progress_ != nullptr) {
+      progress_->AddLines(1, 0);
+    }
+    if (!HasRequiredFields(required_fields, *json_event)) {
+      IncrementSkipCounter();
+      continue;
+    }
+    {
+      util::ScopedTimer timer(is_timed ? &convert_seconds : nullptr);
+      event_data = plaso::ParseJSON(*json_event);
+    }
+    if (drop_skipped_events_ && event_data.type() == EventType::SKIP) {
       IncrementSkipCounter();
       continue;
     }
-    event_data = plaso::ParseJSON(*json_event);
+    if (deduplicator_ != nullptr) {
+      util::ScopedTimer timer(is_timed ? &dedup_seconds : nullptr);
+      if (deduplicator_->IsDuplicate(event_data)) {
+        continue;
+      }
+    }
+    if (IsSnapshotDue(event_data)) {
+      TakeSnapshot();
+    }
+    util::ScopedTimer timer(is_timed ? &graph_build_seconds : nullptr);
     plaso_graph_->ProcessEvent(event_data);
+    UpdateProgressGraphSize();
+  }
+  if (is_timed) {
+    stats_->AddTime("parse", parse_seconds);
+    stats_->AddTime("convert", convert_seconds);
+    if (deduplicator_ != nullptr) {
+      stats_->AddTime("dedup", dedup_seconds);
+    }
+    stats_->AddTime("graph_build", graph_build_seconds);
+  }
+  {
+    util::ScopedTimer timer(stats_, "temporal_edges");
+    plaso_graph_->AddTemporalEdges();
+  }
+  UpdateProgressGraphSize();
+}
+
+// Events are added to the graph in input order, so node ids and skip counts
+// are the same as in BuildPlasoGraphFromJSON.
+void PlasoAnalyzer::BuildPlasoGraphFromJSONStream(
+    int first_stream, int64_t first_offset, int end_stream, int64_t end_offset,
+    const std::function<void(int, int64_t)>& chunk_done) {
+  util::ScopedSpan span("BuildPlasoGraphFromJSONStream");
+  EventPipeline pipeline(json_streams_, num_threads_, drop_skipped_events_,
+                         stats_, first_stream, first_offset, end_stream,
+                         end_offset);
+  EventChunk chunk;
+  while (pipeline.Next(&chunk)) {
+    num_lines_read_ += chunk.events.size() + chunk.num_skipped;
+    if (progress_ != nullptr) {
+      progress_->AddLines(chunk.events.size() + chunk.num_skipped,
+                          chunk.num_bytes);
+    }
+    for (int i = 0; i < chunk.num_skipped; ++i) {
+      IncrementSkipCounter();
+    }
+    AddEvents(chunk.events);
+    if (chunk_done != nullptr) {
+      chunk_done(chunk.stream_index, chunk.stream_offset);
+    }
+  }
+  {
+    util::ScopedTimer timer(stats_, "temporal_edges");
+    plaso_graph_->AddTemporalEdges();
+  }
+  UpdateProgressGraphSize();
+}
+
+// Events are added to the graph in the order of the file, which is the input
+// order of the events, so node ids are the same as in the graph built from
+// the input.
+void PlasoAnalyzer::BuildPlasoGraphFromEvents() {
+  util::ScopedSpan span("BuildPlasoGraphFromEvents");
+  std::vector<PlasoEvent> events;
+  while (ReadEventChunk(&events)) {
+    AddEvents(events);
+  }
+  {
+    util::ScopedTimer timer(stats_, "temporal_edges");
+    plaso_graph_->AddTemporalEdges();
+  }
+  UpdateProgressGraphSize();
+}
+
+bool PlasoAnalyzer::ReadEventChunk(std::vector<PlasoEvent>* events) {
+  util::ScopedTimer timer(stats_, "read");
+  events->clear();
+  const size_t begin_offset = event_reader_->offset();
+  int num_read = 0;
+  PlasoEvent event;
+  while (num_read < kLinesPerChunk && event_reader_->Next(&event)) {
+    ++num_read;
+    if (drop_skipped_events_ && event.type() == EventType::SKIP) {
+      IncrementSkipCounter();
+      continue;
+    }
+    events->push_back(std::move(event));
+  }
+  num_lines_read_ += num_read;
+  if (progress_ != nullptr) {
+    progress_->AddLines(num_read, event_reader_->offset() - begin_offset);
   }
-  plaso_graph_->AddTemporalEdges();
+  return num_read > 0;
 }
 
 }  // namespace morphie
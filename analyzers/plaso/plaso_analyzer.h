@@ -21,13 +21,26 @@
 #define LOGLE_PLASO_ANALYZER_H_
 
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <istream>
 #include <memory>
+#include <ostream>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
+#include "analyzers/plaso/plaso_event_deduplicator.h"
+#include "analyzers/plaso/plaso_event_file.h"
 #include "analyzers/plaso/plaso_event_graph.h"
+#include "analyzers/plaso/plaso_triage.h"
 #include "base/string.h"
 #include "json/json.h"
+#include "plaso_event.pb.h"
 #include "util/json_reader.h"
+#include "util/memory_usage.h"
+#include "util/stats.h"
+#include "util/progress.h"
 #include "util/status.h"
 
 namespace morphie {
@@ -40,8 +53,18 @@ class PlasoAnalyzer {
  public:
   explicit PlasoAnalyzer(bool show_all_sources)
       : show_all_sources_(show_all_sources),
+        drop_skipped_events_(false),
         num_lines_read_(0),
-        num_lines_skipped_(0) {}
+        num_lines_skipped_(0),
+        doc_iterator_(nullptr),
+        num_threads_(0),
+        event_reader_(nullptr),
+        stats_(nullptr),
+        progress_(nullptr),
+        window_(0),
+        snapshot_period_(0),
+        next_snapshot_time_(0),
+        has_snapshot_time_(false) {}
 
   // Initializes the log analyzer with a JSON document.
   //  * Requires that 'json_doc' is not null.
@@ -52,17 +75,204 @@ class PlasoAnalyzer {
   // containing event data. Additional error validation is done
   // during graph construction.
   util::Status Initialize(JsonDocumentIterator* json_doc);
+  // Initializes the log analyzer with a stream in JSON stream format, which
+  // contains one event object per line. The graph is built by a pipeline in
+  // which the calling thread adds events to the graph in input order while
+  // 'num_threads' worker threads parse lines into events and another thread
+  // reads the input. The resulting graph is the same as the graph built from
+  // StreamJson(json_stream).
+  //  * Requires that 'json_stream' is not null.
+  //  * Returns OK if 'num_threads' is positive and INVALID_ARGUMENT otherwise.
+  util::Status Initialize(std::istream* json_stream, int num_threads);
+  // Initializes the log analyzer with several streams in JSON stream format,
+  // which are processed as one stream that is the concatenation of the streams
+  // in the order in which they are given. The events of all streams are added
+  // to one graph, in which file and URL nodes are shared by events from
+  // different streams, and the graph only depends on the order of the streams.
+  //  * Requires that 'json_streams' is not empty and has no null pointers.
+  //  * Returns OK if 'num_threads' is positive and INVALID_ARGUMENT otherwise.
+  util::Status Initialize(const std::vector<std::istream*>& json_streams,
+                          int num_threads);
+  // Initializes the log analyzer with a file of events written by
+  // WritePlasoEvents(), which are added to the graph as they are decoded,
+  // without parsing JSON. Each event counts as a line. The graph is the same
+  // as the graph built from the input of the events.
+  //  * Requires that 'event_reader' is not null and has been opened.
+  //  * Returns OK.
+  util::Status Initialize(PlasoEventReader* event_reader);
+
+  // If 'drop_skipped_events' is true, events of type EventType::SKIP are not
+  // added to the graph and are counted as skipped lines. In the pipelined mode,
+  // lines are classified by a substring search before they are parsed, so most
+  // such lines are never parsed. Must be called before BuildPlasoGraph().
+  void SetDropSkippedEvents(bool drop_skipped_events) {
+    drop_skipped_events_ = drop_skipped_events;
+  }
+
+  // Makes BuildPlasoGraph() drop the events that are copies of an earlier
+  // event, as recognized by a PlasoEventDeduplicator (see
+  // plaso_event_deduplicator.h) that remembers the fingerprints of the last
+  // 'max_fingerprints' distinct events. Copies are counted by
+  // NumDuplicateEvents() and not as skipped lines, and the time spent
+  // recognizing them is the phase "dedup". The other ways of building a graph
+  // and TriagePlasoEvents() drop copies too. A sorted build drops them after
+  // sorting, when copies are adjacent. A build resumed from a checkpoint
+  // begins with no fingerprints. Must be called before BuildPlasoGraph().
+  // - Crashes unless 'max_fingerprints' is positive.
+  void SetDropDuplicateEvents(int64_t max_fingerprints);
+
+  // If 'stats' is not null, BuildPlasoGraph() adds the time it spends in each
+  // phase to 'stats'. With a JsonDocumentIterator, the phases are "parse" for
+  // reading and parsing JSON objects, "convert" for converting them to events,
+  // "graph_build" and "temporal_edges". In the pipelined mode, the phases are
+  // "read", "parse", which includes the conversion to events, "graph_build" and
+  // "temporal_edges", and the times of reading and parsing threads are summed.
+  // With a PlasoEventReader, the phases are "read", for decoding events,
+  // "graph_build" and "temporal_edges". Must be called before
+  // BuildPlasoGraph().
+  void SetStats(util::Stats* stats) { stats_ = stats; }
+  // If 'progress' is not null, BuildPlasoGraph() adds the lines it reads and
+  // skips to 'progress' as it reads them and sets the size of the graph after
+  // each event, or after each chunk of lines in the pipelined mode, so that a
+  // util::ProgressReporter can report the progress of the build while it runs.
+  // Bytes are only counted in the pipelined mode. Must be called before
+  // BuildPlasoGraph().
+  void SetProgress(util::ProgressCounters* progress) { progress_ = progress; }
+  // Makes BuildPlasoGraph() keep only the events of the last 'window'
+  // microseconds, with incremental temporal edges, as described for
+  // PlasoEventGraph::SetWindow, so that a stream of any length is analyzed in
+  // bounded memory. The expired events are evicted when the build completes.
+  // If 'snapshot' is not null, it is called before the first event at or after
+  // each multiple of 'snapshot_period' microseconds is added, once the expired
+  // events have been evicted, and may write the graph of the window with the
+  // output functions below. It must clear the output options it sets, since
+  // more events are added afterwards. The time spent in it is the phase
+  // "snapshot". The other ways of building a graph do not use a window. Must be
+  // called before BuildPlasoGraph().
+  // - Crashes unless 'window' is positive and, if 'snapshot' is not null,
+  //   'snapshot_period' is positive.
+  void SetWindow(int64_t window, int64_t snapshot_period,
+                 const std::function<void()>& snapshot);
 
   // Constructs a PlasoEventGraph (defined in plaso_event_graph.h) from the
   // input data. Requires that the analyzer has been initialized and that every
   // object in the JSON input contains the fields listed in the documentation of
   // the Initialize function above.
   void BuildPlasoGraph();
+  // Adds the events of the input to 'triage' in place of building a graph, so
+  // that the input is summarized at the speed at which it is read and parsed.
+  // Lines are parsed, skipped and counted as by BuildPlasoGraph(), and the
+  // phases are the same, with "triage" in place of "graph_build" and
+  // "temporal_edges". Requires that the analyzer has been initialized.
+  // - Crashes if 'triage' is null.
+  void TriagePlasoEvents(PlasoTriage* triage);
+  // Writes the events of the input to 'writer' in place of building a graph,
+  // so that later analyses read them with a PlasoEventReader instead of
+  // parsing JSON again. Lines are parsed, skipped and counted as by
+  // BuildPlasoGraph(), copies of earlier events are dropped if
+  // SetDropDuplicateEvents() was called, and the phases are the same, with
+  // "write" in place of "graph_build" and "temporal_edges". Requires that the
+  // analyzer has been initialized.
+  // - Crashes if 'writer' is null.
+  void WritePlasoEvents(PlasoEventWriter* writer);
+  // Builds the graph from the events of the input in order of time, so that a
+  // super-timeline whose events are not ordered, such as the concatenated
+  // output of several Plaso parsers, is analyzed as if it had been sorted by
+  // Plaso's psort. The events are sorted with a PlasoEventSorter (see
+  // plaso_event_sorter.h) in runs of 'events_per_run' events, which are
+  // spilled to the directory 'spill_directory', so the memory of the sort is
+  // bounded by the size of a run. Events with equal timestamps keep their
+  // input order. Temporal edges are added as sorted events arrive, as in
+  // AppendToPlasoGraph(), so the graph has the nodes and edges of the graph
+  // that BuildPlasoGraph() builds from the sorted input, and a window set by
+  // SetWindow() drops no events that arrive late. Lines are parsed, skipped
+  // and counted as by BuildPlasoGraph(). The phases are those of
+  // BuildPlasoGraph() and the phases "sort" and "merge" of the sorter.
+  // Requires that the analyzer has been initialized. Returns
+  // - Status::INVALID_ARGUMENT - if 'events_per_run' is not positive.
+  // - Status::EXTERNAL - if the sorted events could not be spilled or read
+  //   back, in which case no graph is built.
+  // - Status::OK - otherwise.
+  util::Status BuildSortedPlasoGraph(int64_t events_per_run,
+                                     const string& spill_directory);
+  // Loads a graph written by SavePlasoGraph() from the file 'filename' in place
+  // of building it, as described for PlasoEventGraph::Load. The analyzer need
+  // not be initialized, and no lines are read. Returns the status returned by
+  // PlasoEventGraph::Load.
+  util::Status LoadPlasoGraph(const string& filename);
+  // Writes the graph to the file 'filename', as described for
+  // PlasoEventGraph::Save. Returns
+  // - Status::INVALID_ARGUMENT - if the graph has not been built.
+  // - the status returned by PlasoEventGraph::Save otherwise.
+  util::Status SavePlasoGraph(const string& filename) const;
+  // Loads the graph in the file 'filename', adds the events of the input to it
+  // and appends the new nodes and edges to the file, as described for
+  // PlasoEventGraph::Load and PlasoEventGraph::SaveDelta, so that the cost of
+  // the update is proportional to the new events. Temporal edges are added as
+  // events arrive, so the graph is the graph built from the saved and the new
+  // events if no new event is earlier than the latest saved event. Requires
+  // that the analyzer has been initialized. Returns the status returned by
+  // PlasoEventGraph::Load if it is not OK, and the status returned by
+  // PlasoEventGraph::SaveDelta otherwise.
+  util::Status AppendToPlasoGraph(const string& filename);
+  // Builds the graph from the JSON streams passed to Initialize() and records
+  // a checkpoint of the build after about every 'lines_per_checkpoint' lines,
+  // so that a build that is interrupted can be resumed. A checkpoint consists
+  // of the graph built so far, in the graph file '<checkpoint_file>.graph',
+  // and an IngestCheckpoint in the file 'checkpoint_file' with the position in
+  // the input up to which the graph was built and the line counters. If
+  // 'checkpoint_file' exists, the build resumes from it, with the graph and
+  // counters that an uninterrupted build would have at that position. A
+  // checkpoint is recorded when the build completes, so resuming a complete
+  // build reads no lines.
+  //
+  // Checkpoints are written on a separate thread. The builder only collects
+  // the nodes and edges added since the previous checkpoint, which are
+  // appended to the graph file as a segment, and a checkpoint that is due
+  // while the previous one is being written is postponed. Temporal edges are
+  // added as events arrive, as in AppendToPlasoGraph(). Returns
+  // - Status::INVALID_ARGUMENT - if the analyzer was not initialized with JSON
+  //   streams, if 'lines_per_checkpoint' is not positive, or if the checkpoint
+  //   is malformed or is a checkpoint of an input other than 'input_name'.
+  // - Status::EXTERNAL - if a checkpoint could not be read or written. The
+  //   graph is built even if a checkpoint could not be written.
+  // - the status returned by PlasoEventGraph::Load if it is not OK.
+  // - Status::OK - otherwise.
+  util::Status BuildPlasoGraphWithCheckpoints(const string& checkpoint_file,
+                                              const string& input_name,
+                                              int64_t lines_per_checkpoint);
+
+  // Builds the graph of one of 'num_shards' shards of the JSON streams passed
+  // to Initialize(), so that the graph of a large input can be built by
+  // several workers, each of which reads a part of the input and writes its
+  // graph with SavePlasoGraph(). The input, which is the concatenation of the
+  // streams, is split into 'num_shards' byte ranges of about equal size, and
+  // the shard with index 'shard_index' consists of the lines that begin in the
+  // range with that index. The streams must be able to seek, so compressed
+  // files cannot be sharded. The graphs of the shards of an input whose events
+  // are ordered by time, such as the output of Plaso's psort, are combined by
+  // MergePlasoGraphs() in the order of their indexes into the graph built from
+  // the whole input. Returns
+  // - Status::INVALID_ARGUMENT - if the analyzer was not initialized with JSON
+  //   streams, if 'shard_index' is not at least 0 and less than 'num_shards',
+  //   or if a stream cannot seek.
+  // - Status::OK - otherwise.
+  util::Status BuildPlasoGraphShard(int shard_index, int num_shards);
+  // Merges the graphs in the graph files 'filenames', which were written by
+  // SavePlasoGraph() after BuildPlasoGraph() or BuildPlasoGraphShard(), in
+  // place of building the graph, as described for PlasoEventGraph::Merge. The
+  // analyzer need not be initialized, and no lines are read. Returns the
+  // status returned by PlasoEventGraph::Merge.
+  util::Status MergePlasoGraphs(const std::vector<string>& filenames);
 
   // Utilities for accounting and error checking.
-  int NumLinesRead() { return num_lines_read_; }
-  int NumLinesSkipped() { return num_lines_skipped_; }
-  int NumLinesProcessed() { return num_lines_read_ - num_lines_skipped_; }
+  int64_t NumLinesRead() { return num_lines_read_; }
+  int64_t NumLinesSkipped() { return num_lines_skipped_; }
+  int64_t NumLinesProcessed() { return num_lines_read_ - num_lines_skipped_; }
+  // Returns the number of events dropped as copies of earlier events.
+  int64_t NumDuplicateEvents() {
+    return (deduplicator_ == nullptr) ? 0 : deduplicator_->NumDuplicates();
+  }
 
   int NumNodes() {
     return (plaso_graph_ == nullptr) ? 0 : plaso_graph_->NumNodes();
@@ -72,25 +282,143 @@ class PlasoAnalyzer {
     return (plaso_graph_ == nullptr) ? 0 : plaso_graph_->NumEdges();
   }
 
+  // Restricts the output of the graph to the neighborhood of the nodes with a
+  // label in 'labels' or a tag in 'tags', as described for
+  // PlasoEventGraph::RestrictOutput. Returns
+  // - Status::INVALID_ARGUMENT - if the graph has not been built.
+  // - the status returned by PlasoEventGraph::RestrictOutput otherwise.
+  util::Status RestrictPlasoGraph(const std::vector<TaggedAST>& labels,
+                                  const std::set<string>& tags, int max_hops,
+                                  int max_nodes, int num_threads);
+
+  // Makes the output functions below write a summary of a graph with more
+  // than 'max_nodes' nodes, as described for
+  // PlasoEventGraph::SetMaxOutputNodes. Returns
+  // - Status::INVALID_ARGUMENT - if the graph has not been built or if
+  //   'max_nodes' or 'num_threads' is not positive.
+  // - Status::OK - otherwise.
+  util::Status SummarizePlasoGraph(int max_nodes, int num_threads);
+  // Makes the DOT output have a timeline with one timestamp for each interval
+  // of 'granularity' microseconds, as described for
+  // PlasoEventGraph::SetTimelineGranularity. Returns
+  // - Status::INVALID_ARGUMENT - if the graph has not been built or if
+  //   'granularity' is not positive.
+  // - Status::OK - otherwise.
+  util::Status SetPlasoGraphTimelineGranularity(int64_t granularity);
+  // Makes the output functions below write the whole graph again, as
+  // described for PlasoEventGraph::ClearOutputOptions.
+  void ClearPlasoGraphOutputOptions();
+
   string PlasoGraphStats() const;
+  // Returns the memory used by the graph as described for
+  // PlasoEventGraph::MemoryUsage, which is empty if the graph has not been
+  // created.
+  util::MemoryBreakdown PlasoGraphMemoryUsage() const;
   string PlasoGraphDot() const;
+  // Writes the string returned by PlasoGraphDot() to 'out' incrementally.
+  void WritePlasoGraphDot(std::ostream* out) const;
   string PlasoGraphPbTxt() const;
+  // Writes the string returned by PlasoGraphPbTxt() to 'out' incrementally.
+  void WritePlasoGraphPbTxt(std::ostream* out) const;
+  // Writes the graph to 'out' as a binary protobuf. Nothing is written if the
+  // graph has not been built.
+  void WritePlasoGraphPb(std::ostream* out) const;
+  // Writes the graph in pages of at most 'page_size' nodes or edges, as
+  // described for PlasoEventGraph::WritePbPages, into 'manifest'. Returns
+  // - Status::INVALID_ARGUMENT - if the graph has not been built or if
+  //   'page_size' is not positive.
+  // - Status::EXTERNAL - if a page could not be written.
+  // - Status::OK - otherwise.
+  util::Status WritePlasoGraphPbPages(int page_size,
+                                      const viz::PageWriter& write_page,
+                                      graph_explorer::GraphManifest* manifest)
+      const;
+  // Write the tables of the graph, as described for PlasoEventGraph. Nothing
+  // is written if the graph has not been built.
+  void WritePlasoEventTable(std::ostream* out) const;
+  void WritePlasoResourceTable(std::ostream* out) const;
+  void WritePlasoEdgeTable(std::ostream* out) const;
 
  private:
   // Constructs a Plaso graph using a JSON document.
   void BuildPlasoGraphFromJSON();
+  // Constructs a Plaso graph from 'json_streams_' using 'num_threads_' parsing
+  // threads, beginning at the byte offset 'first_offset' of the stream with
+  // index 'first_stream' and ending before the first line that begins at or
+  // after the byte offset 'end_offset' of the stream with index 'end_stream'.
+  // The end of the input is the position (json_streams_.size(), 0). If
+  // 'chunk_done' is not null, it is called with the stream index and the
+  // offset in that stream that follow the lines that have been added to the
+  // graph whenever a chunk of lines has been added.
+  void BuildPlasoGraphFromJSONStream(
+      int first_stream, int64_t first_offset, int end_stream,
+      int64_t end_offset, const std::function<void(int, int64_t)>& chunk_done);
+  // Constructs a Plaso graph from the events of 'event_reader_'.
+  void BuildPlasoGraphFromEvents();
+  // Replaces '*events' by the next events of 'event_reader_', and returns
+  // false if the reader has no more events. Events are read, skipped and
+  // counted as lines in chunks of the size of the chunks of the pipelined
+  // mode.
+  bool ReadEventChunk(std::vector<PlasoEvent>* events);
+  // Reads the events of the input and passes each event that is not skipped
+  // to 'add_event', which may move it, until the input ends or 'add_event'
+  // returns false. Lines are parsed, skipped and counted as by
+  // BuildPlasoGraph(), and the time spent in 'add_event' is added to the phase
+  // 'phase' unless it is null.
+  void ReadEvents(const char* phase,
+                  const std::function<bool(PlasoEvent*)>& add_event);
+  // Returns true if 'event' is a copy of an earlier event that is dropped.
+  bool IsDuplicate(const PlasoEvent& event);
+  // Adds 'events' to the graph in order, except copies of earlier events,
+  // takes the snapshots that are due before them and updates the progress
+  // counters.
+  void AddEvents(const std::vector<PlasoEvent>& events);
+  // Loads the graph and the counters of the checkpoint in 'checkpoint_file',
+  // which must be a checkpoint of the input 'input_name' with the graph file
+  // 'graph_file', into '*checkpoint'.
+  util::Status ResumeFromCheckpoint(const string& checkpoint_file,
+                                    const string& graph_file,
+                                    const string& input_name,
+                                    IngestCheckpoint* checkpoint);
   // The skip counter tracks the number of the serialized event objects in the
   // input that were skipped.
   void IncrementSkipCounter();
+  // Sets the size of the graph in the progress counters, if any.
+  void UpdateProgressGraphSize();
+  // Returns true if a snapshot is due before 'event' is added, and advances
+  // the time of the next snapshot past the timestamp of 'event'.
+  bool IsSnapshotDue(const PlasoEvent& event);
+  // Evicts the expired events of the graph and calls 'snapshot_'.
+  void TakeSnapshot();
 
   // Configuration options for the analyzer.
   bool show_all_sources_;
+  bool drop_skipped_events_;
 
   // Data about analyzer state.
   std::unique_ptr<PlasoEventGraph> plaso_graph_;
-  int num_lines_read_;
-  int num_lines_skipped_;
+  // Null if copies of events are kept.
+  std::unique_ptr<PlasoEventDeduplicator> deduplicator_;
+  int64_t num_lines_read_;
+  int64_t num_lines_skipped_;
   JsonDocumentIterator* doc_iterator_;
+  // The input and the number of parsing threads for the pipelined mode.
+  std::vector<std::istream*> json_streams_;
+  int num_threads_;
+  // Not owned. Null unless the input is a file of events.
+  PlasoEventReader* event_reader_;
+  // Not owned. Null if the analyzer is not instrumented.
+  util::Stats* stats_;
+  // Not owned. Null if progress is not reported.
+  util::ProgressCounters* progress_;
+  // The window of the graph, or 0 if all events are kept, and the snapshots
+  // of the window, which are taken if 'snapshot_' is not null.
+  int64_t window_;
+  int64_t snapshot_period_;
+  std::function<void()> snapshot_;
+  // The time of the next snapshot, which is set by the first event.
+  int64_t next_snapshot_time_;
+  bool has_snapshot_time_;
 };
 
 }  // namespace morphie
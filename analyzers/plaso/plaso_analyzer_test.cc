@@ -14,13 +14,23 @@
 
 #include "analyzers/plaso/plaso_analyzer.h"
 
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
 #include <sstream>
+#include <utility>
+#include <vector>
 #include "base/vector.h"
 
 #include "analyzers/plaso/plaso_defs.h"
+#include "analyzers/plaso/plaso_event.h"
 #include "base/string.h"
 #include "gtest.h"
 #include "util/json_reader.h"
+#include "util/stats.h"
 #include "util/string_utils.h"
 
 namespace morphie {
@@ -72,5 +82,443 @@ TEST(PlasoAnalyzerDeathTest, RequiresCorrectJSONDoc) {
   EXPECT_DEATH(TestInitialization(json_stream, false),
     ".*JSON*");
 }
+// Returns the DOT graph built from 'content' by the serial analyzer if
+// 'num_threads' is 0 and by the pipelined analyzer otherwise.
+string StreamToDot(const string& content, int num_threads) {
+  PlasoAnalyzer analyzer(false);
+  std::istringstream stream(content);
+  morphie::StreamJson jstream(&stream);
+  if (num_threads == 0) {
+    EXPECT_TRUE(analyzer.Initialize(&jstream).ok());
+  } else {
+    EXPECT_TRUE(analyzer.Initialize(&stream, num_threads).ok());
+  }
+  analyzer.BuildPlasoGraph();
+  return analyzer.PlasoGraphDot();
+}
+
+TEST(PlasoAnalyzerTest, RejectsNonPositiveThreadCount) {
+  PlasoAnalyzer analyzer(false);
+  std::istringstream stream(json_stream);
+  EXPECT_FALSE(analyzer.Initialize(&stream, 0).ok());
+}
+
+// The pipelined analyzer builds the same graph as the serial one, including on
+// input that spans several chunks and contains lines that are skipped.
+TEST(PlasoAnalyzerTest, PipelinedStreamMatchesSerial) {
+  EXPECT_EQ(StreamToDot(json_stream, 0), StreamToDot(json_stream, 1));
+  EXPECT_EQ(StreamToDot(json_stream, 0), StreamToDot(json_stream, 4));
+  string long_stream;
+  for (int i = 0; i < 1500; ++i) {
+    if (i % 7 == 0) {
+      util::StrAppend(&long_stream, R"({"timestamp": 1})", "\n");
+      continue;
+    }
+    util::StrAppend(&long_stream, R"({"data_type": "fs:stat", )",
+                    R"("display_name": "GZIP:/tmp/file)", std::to_string(i % 50));
+    util::StrAppend(&long_stream, R"(", "timestamp": )", std::to_string(i),
+                    R"(, "timestamp_desc": "mtime"})", "\n");
+  }
+  PlasoAnalyzer analyzer(false);
+  std::istringstream stream(long_stream);
+  ASSERT_TRUE(analyzer.Initialize(&stream, 3).ok());
+  analyzer.BuildPlasoGraph();
+  EXPECT_EQ(215, analyzer.NumLinesSkipped());
+  EXPECT_EQ(StreamToDot(long_stream, 0), analyzer.PlasoGraphDot());
+}
+
+// A window keeps the graph of the latest events, and snapshots of the window
+// are taken before the first event of each period, with the same sizes in the
+// serial and the pipelined analyzer.
+TEST(PlasoAnalyzerTest, SnapshotsWindows) {
+  string long_stream;
+  for (int i = 0; i < 1500; ++i) {
+    util::StrAppend(&long_stream, R"({"data_type": "fs:stat", )",
+                    R"("display_name": "GZIP:/tmp/file)", std::to_string(i % 50));
+    // Input timestamps are in nanoseconds, so event 'i' is at 'i'
+    // microseconds.
+    util::StrAppend(&long_stream, R"(", "timestamp": )", std::to_string(i),
+                    "000", R"(, "timestamp_desc": "mtime"})", "\n");
+  }
+  for (int num_threads : {0, 3}) {
+    PlasoAnalyzer analyzer(false);
+    std::istringstream stream(long_stream);
+    morphie::StreamJson jstream(&stream);
+    if (num_threads == 0) {
+      ASSERT_TRUE(analyzer.Initialize(&jstream).ok());
+    } else {
+      ASSERT_TRUE(analyzer.Initialize(&stream, num_threads).ok());
+    }
+    std::vector<int> sizes;
+    analyzer.SetWindow(99, 500, [&analyzer, &sizes]() {
+      sizes.push_back(analyzer.NumNodes());
+    });
+    analyzer.BuildPlasoGraph();
+    // The windows of the snapshots before the events at 500 and 1000 have the
+    // events from 400 to 499 and from 900 to 999.
+    EXPECT_EQ(std::vector<int>({100, 100}), sizes);
+    EXPECT_EQ(100, analyzer.NumNodes());
+    EXPECT_EQ(1500, analyzer.NumLinesProcessed());
+  }
+}
+
+// A triage reads and skips the same lines as a build and builds no graph, and
+// the serial and the pipelined analyzer produce the same report.
+TEST(PlasoAnalyzerTest, TriagesEventsWithoutGraph) {
+  string long_stream;
+  for (int i = 0; i < 1500; ++i) {
+    if (i % 7 == 0) {
+      util::StrAppend(&long_stream, R"({"timestamp": 1})", "\n");
+      continue;
+    }
+    util::StrAppend(&long_stream, R"({"data_type": "fs:stat", )",
+                    R"("display_name": "GZIP:/tmp/file)", std::to_string(i % 50));
+    util::StrAppend(&long_stream, R"(", "timestamp": )", std::to_string(i),
+                    "000", R"(, "timestamp_desc": "mtime"})", "\n");
+  }
+  std::vector<string> reports;
+  for (int num_threads : {0, 3}) {
+    PlasoAnalyzer analyzer(true);
+    std::istringstream stream(long_stream);
+    morphie::StreamJson jstream(&stream);
+    if (num_threads == 0) {
+      ASSERT_TRUE(analyzer.Initialize(&jstream).ok());
+    } else {
+      ASSERT_TRUE(analyzer.Initialize(&stream, num_threads).ok());
+    }
+    PlasoTriage triage(true, 500, 16);
+    analyzer.TriagePlasoEvents(&triage);
+    EXPECT_EQ(0, analyzer.NumNodes());
+    EXPECT_EQ(215, analyzer.NumLinesSkipped());
+    const Json::Value report = triage.Report();
+    EXPECT_EQ(1285, report["events"].asInt64());
+    EXPECT_EQ(3, report["buckets"].size());
+    EXPECT_NEAR(50, report["distinct_files"].asInt64(), 1);
+    const Json::Value& directory = report["busiest_directories"][0];
+    EXPECT_EQ("GZIP:/tmp/", directory["directory"].asString());
+    EXPECT_EQ(1285, directory["count"].asInt64());
+    reports.push_back(report.toStyledString());
+  }
+  EXPECT_EQ(reports[0], reports[1]);
+}
+
+// Returns a line of a JSON stream with an event at 'timestamp' seconds on the
+// file '/tmp/file<file_index>'.
+string MakeFileEventLine(int64_t timestamp, int file_index) {
+  string line;
+  util::StrAppend(&line, R"({"data_type": "fs:stat", "display_name": )",
+                  R"("GZIP:/tmp/file)", std::to_string(file_index));
+  util::StrAppend(&line, R"(", "timestamp": )", std::to_string(timestamp),
+                  R"(000000000, "timestamp_desc": "mtime"})", "\n");
+  return line;
+}
+
+// Returns the lines of 'text' in sorted order.
+std::vector<string> SortedLines(const string& text) {
+  std::vector<string> lines;
+  std::istringstream stream(text);
+  string line;
+  while (std::getline(stream, line)) {
+    lines.push_back(line);
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+// A graph built from out-of-order input with a sort, serial or pipelined and
+// with spilled runs or none, is the graph built from the stably sorted input.
+// Temporal edges are added as events arrive, so only the order of the edges in
+// the output differs.
+TEST(PlasoAnalyzerTest, BuildsSortedGraphFromOutOfOrderInput) {
+  // Pairs of events have equal timestamps.
+  std::vector<std::pair<int, string>> lines;
+  string shuffled_stream;
+  for (int i = 0; i < 60; ++i) {
+    const int index = (i * 7) % 60;
+    lines.emplace_back(index / 2, MakeFileEventLine(index / 2, index));
+    shuffled_stream += lines.back().second;
+    if (i % 10 == 0) {
+      shuffled_stream += "{\"timestamp\": 1}\n";
+    }
+  }
+  std::stable_sort(lines.begin(), lines.end(),
+                   [](const std::pair<int, string>& lhs,
+                      const std::pair<int, string>& rhs) {
+                     return lhs.first < rhs.first;
+                   });
+  string sorted_stream;
+  for (const auto& line : lines) {
+    sorted_stream += line.second;
+  }
+  string expected_dot;
+  {
+    PlasoAnalyzer analyzer(true);
+    std::istringstream stream(sorted_stream);
+    ASSERT_TRUE(analyzer.Initialize(&stream, 1).ok());
+    analyzer.BuildPlasoGraph();
+    expected_dot = analyzer.PlasoGraphDot();
+  }
+  for (int num_threads : {0, 3}) {
+    for (int64_t events_per_run : {7, 1000}) {
+      PlasoAnalyzer analyzer(true);
+      std::istringstream stream(shuffled_stream);
+      morphie::StreamJson jstream(&stream);
+      if (num_threads == 0) {
+        ASSERT_TRUE(analyzer.Initialize(&jstream).ok());
+      } else {
+        ASSERT_TRUE(analyzer.Initialize(&stream, num_threads).ok());
+      }
+      util::Stats stats;
+      analyzer.SetStats(&stats);
+      ASSERT_TRUE(analyzer.BuildSortedPlasoGraph(events_per_run, "/tmp").ok());
+      EXPECT_EQ(66, analyzer.NumLinesRead());
+      EXPECT_EQ(6, analyzer.NumLinesSkipped());
+      EXPECT_EQ(SortedLines(expected_dot),
+                SortedLines(analyzer.PlasoGraphDot()));
+    }
+  }
+  PlasoAnalyzer analyzer(true);
+  std::istringstream stream(shuffled_stream);
+  ASSERT_TRUE(analyzer.Initialize(&stream, 1).ok());
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            analyzer.BuildSortedPlasoGraph(0, "/tmp").code());
+  EXPECT_EQ(Code::EXTERNAL,
+            analyzer.BuildSortedPlasoGraph(1, "/nonexistent-logle-dir").code());
+  EXPECT_EQ(0, analyzer.NumNodes());
+}
+
+// Copies of events, which differ only in fields other than their timestamp,
+// type, files and URLs, are dropped and counted, and the graph is the graph of
+// the input without copies, serial, pipelined or sorted.
+TEST(PlasoAnalyzerTest, DropsDuplicateEvents) {
+  string stream_without_copies;
+  string stream_with_copies;
+  for (int i = 0; i < 40; ++i) {
+    const string line = MakeFileEventLine(i / 4, i % 8);
+    stream_without_copies += line;
+    stream_with_copies += line;
+    if (i % 5 == 0) {
+      // A copy from another parser, with another description.
+      string copy = line;
+      copy.replace(copy.find("mtime"), 5, "ctime");
+      stream_with_copies += copy;
+    }
+  }
+  string expected_dot;
+  {
+    PlasoAnalyzer analyzer(true);
+    std::istringstream stream(stream_without_copies);
+    ASSERT_TRUE(analyzer.Initialize(&stream, 1).ok());
+    analyzer.BuildPlasoGraph();
+    expected_dot = analyzer.PlasoGraphDot();
+  }
+  for (int num_threads : {0, 3}) {
+    for (bool is_sorted : {false, true}) {
+      PlasoAnalyzer analyzer(true);
+      std::istringstream stream(stream_with_copies);
+      morphie::StreamJson jstream(&stream);
+      if (num_threads == 0) {
+        ASSERT_TRUE(analyzer.Initialize(&jstream).ok());
+      } else {
+        ASSERT_TRUE(analyzer.Initialize(&stream, num_threads).ok());
+      }
+      analyzer.SetDropDuplicateEvents(16);
+      if (is_sorted) {
+        ASSERT_TRUE(analyzer.BuildSortedPlasoGraph(10, "/tmp").ok());
+        EXPECT_EQ(SortedLines(expected_dot),
+                  SortedLines(analyzer.PlasoGraphDot()));
+      } else {
+        analyzer.BuildPlasoGraph();
+        EXPECT_EQ(expected_dot, analyzer.PlasoGraphDot());
+      }
+      EXPECT_EQ(48, analyzer.NumLinesRead());
+      EXPECT_EQ(0, analyzer.NumLinesSkipped());
+      EXPECT_EQ(8, analyzer.NumDuplicateEvents());
+    }
+  }
+}
+
+// A reader that only extracts the fields named by plaso::JSONFieldNames()
+// produces the same graph as a reader that parses every field.
+TEST(PlasoAnalyzerTest, MappedJsonLinesMatchesStreamJson) {
+  // NOLINTNEXTLINE
+  string content = R"({"data_type": "windows:tasks:job", "application": "cron", "display_name": "/etc/crontab", "timestamp": 5000, "timestamp_desc": "mtime", "extra": {"unused": [1, 2]}}
+{"data_type": "fs:stat", "display_name": "GZIP:/usr/share/info/bc.info.gz", "timestamp": 0, "timestamp_desc": "mtime", "message": "unused"}
+)";
+  char filename[] = "/tmp/plaso_analyzer_test_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  std::ofstream file(filename);
+  file << content;
+  file.close();
+  PlasoAnalyzer analyzer(false);
+  MappedJsonLines json_lines(filename, plaso::JSONFieldNames());
+  ASSERT_TRUE(json_lines.IsOpen());
+  ASSERT_TRUE(analyzer.Initialize(&json_lines).ok());
+  analyzer.BuildPlasoGraph();
+  EXPECT_EQ(StreamToDot(content, 0), analyzer.PlasoGraphDot());
+  unlink(filename);
+}
+
+// The events written to a file build the graph of the JSON stream they were
+// converted from, in the serial and the pipelined analyzer, and lines that
+// are skipped by the conversion are not written.
+TEST(PlasoAnalyzerTest, EventFileMatchesJsonStream) {
+  string content;
+  for (int i = 0; i < 1500; ++i) {
+    if (i % 7 == 0) {
+      util::StrAppend(&content, R"({"timestamp": 1})", "\n");
+      continue;
+    }
+    util::StrAppend(&content, R"({"data_type": "fs:stat", )",
+                    R"("display_name": "GZIP:/tmp/file)", i % 50,
+                    R"(", "timestamp": )", i, R"(, "timestamp_desc": "mtime"})",
+                    "\n");
+  }
+  char filename[] = "/tmp/plaso_analyzer_test_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  for (int num_threads : {0, 2}) {
+    PlasoAnalyzer converter(false);
+    std::istringstream stream(content);
+    morphie::StreamJson jstream(&stream);
+    if (num_threads == 0) {
+      ASSERT_TRUE(converter.Initialize(&jstream).ok());
+    } else {
+      ASSERT_TRUE(converter.Initialize(&stream, num_threads).ok());
+    }
+    PlasoEventWriter writer;
+    ASSERT_TRUE(writer.Open(filename).ok());
+    converter.WritePlasoEvents(&writer);
+    ASSERT_TRUE(writer.Close().ok());
+    EXPECT_EQ(215, converter.NumLinesSkipped());
+
+    PlasoAnalyzer analyzer(false);
+    PlasoEventReader reader;
+    ASSERT_TRUE(reader.Open(filename).ok());
+    ASSERT_TRUE(analyzer.Initialize(&reader).ok());
+    analyzer.BuildPlasoGraph();
+    EXPECT_TRUE(reader.is_ok());
+    EXPECT_EQ(1500 - 215, analyzer.NumLinesRead());
+    EXPECT_EQ(0, analyzer.NumLinesSkipped());
+    EXPECT_EQ(StreamToDot(content, 0), analyzer.PlasoGraphDot());
+  }
+  unlink(filename);
+}
+
+// Several streams build the graph of their concatenation, in which events of
+// different streams share file nodes.
+TEST(PlasoAnalyzerTest, MergesStreamsInOrder) {
+  std::vector<string> contents;
+  string concatenated;
+  for (int i = 0; i < 3; ++i) {
+    string content;
+    for (int j = 0; j < 600; ++j) {
+      util::StrAppend(&content, R"({"data_type": ")",
+                      R"(windows:prefetch:execution", "display_name": "/p", )",
+                      R"("executable": "/tmp/file)", std::to_string(j % 20));
+      util::StrAppend(&content, R"(", "timestamp": )",
+                      std::to_string(i * 1000 + j),
+                      R"(, "timestamp_desc": "mtime"})", "\n");
+    }
+    concatenated += content;
+    // An empty line ends a stream.
+    contents.push_back(content + "\n" + content);
+  }
+  for (int num_threads : {1, 3}) {
+    std::vector<std::unique_ptr<std::istringstream>> streams;
+    std::vector<std::istream*> stream_ptrs;
+    for (const string& content : contents) {
+      streams.emplace_back(new std::istringstream(content));
+      stream_ptrs.push_back(streams.back().get());
+    }
+    PlasoAnalyzer analyzer(false);
+    ASSERT_TRUE(analyzer.Initialize(stream_ptrs, num_threads).ok());
+    analyzer.BuildPlasoGraph();
+    EXPECT_EQ(StreamToDot(concatenated, 0), analyzer.PlasoGraphDot());
+    // 1800 events and 20 files.
+    EXPECT_EQ(1820, analyzer.NumNodes());
+  }
+}
+
+// Skipped events are dropped by both analyzers with the same counts, whether
+// or not the substring search classifies their lines.
+TEST(PlasoAnalyzerTest, DropsSkippedEvents) {
+  string kept = R"({"data_type": "fs:stat", "display_name": "/a",)"
+                R"( "timestamp": 1, "timestamp_desc": "mtime"})"
+                "\n";
+  string content;
+  for (int i = 0; i < 3; ++i) {
+    content += kept;
+    // Classified by the substring search.
+    content += R"({"data_type": "firefox:cache:record", "display_name": "/b",)"
+               R"( "timestamp": 2, "timestamp_desc": "mtime"})"
+               "\n";
+    // An escape sequence and a nested key are only classified by parsing.
+    content += R"({"data_type": "firefox:cookie\u003aentry", "timestamp": 3,)"
+               R"( "display_name": "/c", "timestamp_desc": "mtime"})"
+               "\n";
+    content += R"({"data_type": "fs:stat", "display_name": "/d",)"
+               R"( "extra": {"data_type": "firefox:cookie:entry"},)"
+               R"( "timestamp": 4, "timestamp_desc": "mtime"})"
+               "\n";
+    content += R"({"timestamp": 5})"
+               "\n";
+  }
+  string expected;
+  for (int i = 0; i < 3; ++i) {
+    expected += kept;
+    expected += R"({"data_type": "fs:stat", "display_name": "/d",)"
+                R"( "timestamp": 4, "timestamp_desc": "mtime"})"
+                "\n";
+  }
+  for (int num_threads : {0, 2}) {
+    PlasoAnalyzer analyzer(false);
+    analyzer.SetDropSkippedEvents(true);
+    std::istringstream stream(content);
+    morphie::StreamJson jstream(&stream);
+    if (num_threads == 0) {
+      ASSERT_TRUE(analyzer.Initialize(&jstream).ok());
+    } else {
+      ASSERT_TRUE(analyzer.Initialize(&stream, num_threads).ok());
+    }
+    analyzer.BuildPlasoGraph();
+    EXPECT_EQ(9, analyzer.NumLinesSkipped());
+    EXPECT_EQ(StreamToDot(expected, 0), analyzer.PlasoGraphDot());
+  }
+  // Skipped events are kept by default.
+  EXPECT_NE(StreamToDot(expected, 0), StreamToDot(content, 2));
+}
+
+// Both analyzers count the lines they read and report the phases of graph
+// construction to a Stats object.
+TEST(PlasoAnalyzerTest, ReportsLineCountsAndPhases) {
+  string content = json_stream + "\n" + R"({"timestamp": 1})" + "\n";
+  for (int num_threads : {0, 2}) {
+    PlasoAnalyzer analyzer(false);
+    util::Stats stats;
+    analyzer.SetStats(&stats);
+    std::istringstream stream(content);
+    morphie::StreamJson jstream(&stream);
+    if (num_threads == 0) {
+      ASSERT_TRUE(analyzer.Initialize(&jstream).ok());
+    } else {
+      ASSERT_TRUE(analyzer.Initialize(&stream, num_threads).ok());
+    }
+    analyzer.BuildPlasoGraph();
+    EXPECT_EQ(4, analyzer.NumLinesRead());
+    EXPECT_EQ(1, analyzer.NumLinesSkipped());
+    EXPECT_EQ(3, analyzer.NumLinesProcessed());
+    std::map<string, double> times = stats.Times();
+    EXPECT_EQ(1, times.count("parse"));
+    EXPECT_EQ(1, times.count("graph_build"));
+    EXPECT_EQ(1, times.count("temporal_edges"));
+    EXPECT_EQ(num_threads == 0 ? 1 : 0, times.count("convert"));
+    EXPECT_EQ(num_threads == 0 ? 0 : 1, times.count("read"));
+  }
+}
+
 }  // namespace
 }  // namespace morphie
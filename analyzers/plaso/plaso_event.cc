@@ -14,22 +14,25 @@
 
 #include "analyzers/plaso/plaso_event.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <map>
+#include <utility>
 
 #include "analyzers/plaso/plaso_defs.h"
 #include "google/protobuf/message.h"
 #include "graph/type.h"
 #include "graph/value.h"
 #include "util/logging.h"
+#include "util/span.h"
 #include "util/string_utils.h"
 #include "util/time_utils.h"
 
 namespace morphie {
 namespace plaso {
 
-using std::map;
-
 namespace type = ast::type;
 namespace value = ast::value;
 
@@ -41,106 +44,226 @@ namespace proto = google::protobuf;
 // member of a JSON object provided as input.
 enum class ParseOption { kCopy, kMakeFile };
 
-// A ParseAction entry specifies the source and target fields for a parse option
-// operation. For example:
-//   { {ParseOption::kCopy, {{"url", "source_url"}}},
-//     {ParseOption::kMakeFile, {{"display_name", "data_file"},
-//                               {"download_file", "target_file"}}}  }
-// This vector specifies that 'url' should be copied to 'source_url', while the
-// JSON members 'display_name' and 'download_file' should be converted into the
-// 'File' messages 'data_file' and 'target_file', respectively.
-using ParseAction = vector<std::pair<ParseOption, map<string, string>>>;
-
-// A map that describes how to populate fields in a PlasoEvent proto based on a
-// Plaso 'data_type' value. For each Plaso 'data_type' value, the map specifies:
+// A FieldAction applies a parse option to the JSON member 'source' and the
+// PlasoEvent field 'target'. For example,
+//   {ParseOption::kCopy, "url", "source_url"}
+// copies 'url' to 'source_url', and
+//   {ParseOption::kMakeFile, "full_path", "target_file"}
+// converts 'full_path' into the 'File' message 'target_file'.
+struct FieldAction {
+  ParseOption option;
+  const char* source;
+  const char* target;
+};
+
+// The field actions of all Plaso types. The actions of a type are consecutive
+// and are listed in the order in which they are applied.
+const FieldAction kFieldActions[] = {
+    // chrome:cache:entry
+    {ParseOption::kCopy, "original_url", "source_url"},
+    // chrome:cookie:entry
+    {ParseOption::kCopy, "url", "source_url"},
+    // chrome:extension_activity:activity_log
+    {ParseOption::kCopy, "extension_id", "extension_id"},
+    {ParseOption::kCopy, "page_url", "source_url"},
+    // chrome:history:file_downloaded and firefox:downloads:download
+    {ParseOption::kCopy, "url", "source_url"},
+    {ParseOption::kMakeFile, "full_path", "target_file"},
+    // chrome:history:page_visited
+    {ParseOption::kCopy, "from_visit", "source_url"},
+    {ParseOption::kCopy, "url", "target_url"},
+    // chrome:preferences:extension_installation
+    {ParseOption::kCopy, "extension_id", "extension_id"},
+    {ParseOption::kCopy, "extension_name", "extension_name"},
+    // firefox:places:page_visited
+    {ParseOption::kCopy, "url", "source_url"},
+    // macosx:application_usage and windows:tasks:job
+    {ParseOption::kCopy, "application", "application_name"},
+    // task_scheduler:task_cache:entry
+    {ParseOption::kCopy, "task_name", "application_name"},
+    // windows:evt:record and windows:evtx:record
+    {ParseOption::kCopy, "event_identifier", "event_id"},
+    {ParseOption::kMakeFile, "source_name", "target_file"},
+    // windows:prefetch:execution
+    {ParseOption::kMakeFile, "executable", "target_file"},
+    // windows:registry:appcompatcache
+    {ParseOption::kMakeFile, "path", "target_file"},
+    // windows:shell_item:file_entry
+    {ParseOption::kMakeFile, "name", "target_file"},
+};
+
+// A TypeAction describes how to populate the fields of a PlasoEvent proto for
+// a Plaso 'data_type' value:
 //   - an EventType value. A 'data_type' determines the names and fields that
 //     occur in a JSON event object, while an EventType is a conceptual. For
 //     example, "chrome:history:file_downloaded" and
 //     "firefox:downloads:download" are two different Plaso 'data_type' values
 //     that will map to EventType::FILE_DOWNLOADED.
-//   - a ParseAction specifying how data about that event should be processed.
-const map<string, std::pair<EventType, ParseAction>> kParseActions = {
-    {"chrome:cache:entry",
-     {EventType::PAGE_VISITED,
-      {
-          {ParseOption::kCopy, {{"original_url", "source_url"}}},
-      }}},
-    {"chrome:cookie:entry",
-     {EventType::PAGE_VISITED,
-      {
-          {ParseOption::kCopy, {{"url", "source_url"}}},
-      }}},
-    {"chrome:extension_activity:activity_log",
-     {EventType::PAGE_VISITED,
-      {
-          {ParseOption::kCopy,
-           {{"page_url", "source_url"}, {"extension_id", "extension_id"}}},
-      }}},
-    {"chrome:history:file_downloaded",
-     {EventType::FILE_DOWNLOADED,
-      {{ParseOption::kCopy, {{"url", "source_url"}}},
-       {ParseOption::kMakeFile, {{"full_path", "target_file"}}}}}},
-    {"chrome:history:page_visited",
-     {EventType::PAGE_VISITED,
-      {
-          {ParseOption::kCopy,
-           {{"from_visit", "source_url"}, {"url", "target_url"}}},
-      }}},
+//   - the position and number of its actions in 'kFieldActions', which specify
+//     how data about that event should be processed.
+struct TypeAction {
+  const char* data_type;
+  EventType type;
+  int first_action;
+  int num_actions;
+};
+
+const TypeAction kTypeActions[] = {
+    {"chrome:cache:entry", EventType::PAGE_VISITED, 0, 1},
+    {"chrome:cookie:entry", EventType::PAGE_VISITED, 1, 1},
+    {"chrome:extension_activity:activity_log", EventType::PAGE_VISITED, 2, 2},
+    {"chrome:history:file_downloaded", EventType::FILE_DOWNLOADED, 4, 2},
+    {"chrome:history:page_visited", EventType::PAGE_VISITED, 6, 2},
     {"chrome:preferences:extension_installation",
-     {EventType::BROWSER_EXTENSION_INSTALLED,
-      {
-          {ParseOption::kCopy,
-           {
-               {"extension_name", "extension_name"},
-               {"extension_id", "extension_id"},
-           }},
-      }}},
-    {"firefox:cache:record", {EventType::SKIP, {}}},
-    {"firefox:cookie:entry", {EventType::SKIP, {}}},
-    {"firefox:downloads:download",
-     {EventType::FILE_DOWNLOADED,
-      {{ParseOption::kCopy, {{"url", "source_url"}}},
-       {ParseOption::kMakeFile, {{"full_path", "target_file"}}}}}},
-    {"firefox:places:bookmark", {EventType::SKIP, {}}},
-    {"firefox:places:bookmark_annotation", {EventType::SKIP, {}}},
-    {"firefox:places:bookmark_folder", {EventType::SKIP, {}}},
-    {"firefox:places:page_visited",
-     {EventType::PAGE_VISITED,
-      {
-          {ParseOption::kCopy, {{"url", "source_url"}}},
-      }}},
-    {"macosx:application_usage",
-     {EventType::APPLICATION_EXECUTED,
-      {{ParseOption::kCopy, {{"application", "application_name"}}}}}},
-    {"task_scheduler:task_cache:entry",
-     {EventType::APPLICATION_EXECUTED,
-      {{ParseOption::kCopy, {{"task_name", "application_name"}}}}}},
-    {"windows:evt:record",
-     {EventType::APPLICATION_EXECUTED,
-      {
-          {ParseOption::kCopy, {{"event_identifier", "event_id"}}},
-          {ParseOption::kMakeFile, {{"source_name", "target_file"}}},
-      }}},
-    {"windows:evtx:record",
-     {EventType::APPLICATION_EXECUTED,
-      {
-          {ParseOption::kCopy, {{"event_identifier", "event_id"}}},
-          {ParseOption::kMakeFile, {{"source_name", "target_file"}}},
-      }}},
-    {"windows:prefetch:execution",
-     {EventType::APPLICATION_EXECUTED,
-      {{ParseOption::kMakeFile, {{"executable", "target_file"}}}}}},
-    {"windows:registry:appcompatcache",
-     {EventType::APPLICATION_EXECUTED,
-      {{ParseOption::kMakeFile, {{"path", "target_file"}}}}}},
-    {"windows:shell_item:file_entry",
-     {EventType::APPLICATION_EXECUTED,
-      {{ParseOption::kMakeFile, {{"name", "target_file"}}}}}},
-    {"windows:tasks:job",
-     {EventType::APPLICATION_EXECUTED,
-      {{ParseOption::kCopy, {{"application", "application_name"}}}}}},
+     EventType::BROWSER_EXTENSION_INSTALLED, 8, 2},
+    {"firefox:cache:record", EventType::SKIP, 0, 0},
+    {"firefox:cookie:entry", EventType::SKIP, 0, 0},
+    {"firefox:downloads:download", EventType::FILE_DOWNLOADED, 4, 2},
+    {"firefox:places:bookmark", EventType::SKIP, 0, 0},
+    {"firefox:places:bookmark_annotation", EventType::SKIP, 0, 0},
+    {"firefox:places:bookmark_folder", EventType::SKIP, 0, 0},
+    {"firefox:places:page_visited", EventType::PAGE_VISITED, 10, 1},
+    {"macosx:application_usage", EventType::APPLICATION_EXECUTED, 11, 1},
+    {"task_scheduler:task_cache:entry", EventType::APPLICATION_EXECUTED, 12,
+     1},
+    {"windows:evt:record", EventType::APPLICATION_EXECUTED, 13, 2},
+    {"windows:evtx:record", EventType::APPLICATION_EXECUTED, 13, 2},
+    {"windows:prefetch:execution", EventType::APPLICATION_EXECUTED, 15, 1},
+    {"windows:registry:appcompatcache", EventType::APPLICATION_EXECUTED, 16,
+     1},
+    {"windows:shell_item:file_entry", EventType::APPLICATION_EXECUTED, 17, 1},
+    {"windows:tasks:job", EventType::APPLICATION_EXECUTED, 11, 1},
+};
+
+const int kNumFieldActions = sizeof(kFieldActions) / sizeof(kFieldActions[0]);
+const int kNumTypeActions = sizeof(kTypeActions) / sizeof(kTypeActions[0]);
+
+// Returns the sorted names of the JSON members that events are parsed from,
+// which are the fields of an EventParser's reader in order.
+std::vector<string> JSONFieldVector() {
+  const std::set<string> field_names = JSONFieldNames();
+  return std::vector<string>(field_names.begin(), field_names.end());
+}
+
+// A field action that is ready to be applied: the source is also identified
+// by its position in JSONFieldVector(), and the target by its descriptor.
+struct CompiledAction {
+  ParseOption option;
+  string source;
+  int source_id;
+  const proto::FieldDescriptor* target;
+};
+
+// An ActionTable finds the action of a Plaso type with a perfect hash of the
+// type: every type in 'kTypeActions' has a slot of its own, so a lookup hashes
+// the type once and compares it with at most one type. The hash is FNV-1a with
+// a seed that is searched for when the table is built. The field names of the
+// actions are resolved when the table is built, so that applying an action
+// does not look up names.
+class ActionTable {
+ public:
+  // Returns the table, which is built on first use.
+  static const ActionTable& Get() {
+    static const ActionTable* const table = new ActionTable;
+    return *table;
+  }
+
+  // Returns the action of the Plaso type in [begin, end), or null if the type
+  // has no action.
+  const TypeAction* Find(const char* begin, const char* end) const {
+    int index = slots_[Hash(seed_, begin, end) & mask_];
+    if (index < 0) {
+      return nullptr;
+    }
+    const TypeAction& action = kTypeActions[index];
+    const size_t length = end - begin;
+    return length == lengths_[index] &&
+                   std::equal(begin, end, action.data_type)
+               ? &action
+               : nullptr;
+  }
+  const TypeAction* Find(const string& data_type) const {
+    return Find(data_type.data(), data_type.data() + data_type.size());
+  }
+  util::Span<CompiledAction> Actions(const TypeAction& action) const {
+    return util::Span<CompiledAction>(
+        compiled_actions_.data() + action.first_action, action.num_actions);
+  }
+
+ private:
+  ActionTable();
+
+  static uint32_t Hash(uint32_t seed, const char* begin, const char* end) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (const char* pos = begin; pos != end; ++pos) {
+      hash = (hash ^ static_cast<unsigned char>(*pos)) * 16777619u;
+    }
+    return hash;
+  }
+
+  uint32_t seed_;
+  uint32_t mask_;
+  // The index in 'kTypeActions' of the type in each slot, or -1.
+  std::vector<int> slots_;
+  std::vector<size_t> lengths_;
+  std::vector<CompiledAction> compiled_actions_;
 };
 
+// The table has at least twice as many slots as types, so a seed without
+// collisions is found after a few attempts. The number of slots is doubled if
+// none is found.
+ActionTable::ActionTable() : seed_(0) {
+  for (int i = 0; i < kNumTypeActions; ++i) {
+    lengths_.push_back(std::strlen(kTypeActions[i].data_type));
+  }
+  uint32_t num_slots = 1;
+  while (num_slots < 2 * static_cast<uint32_t>(kNumTypeActions)) {
+    num_slots *= 2;
+  }
+  while (true) {
+    mask_ = num_slots - 1;
+    slots_.assign(num_slots, -1);
+    bool is_perfect = true;
+    for (int i = 0; i < kNumTypeActions && is_perfect; ++i) {
+      const char* data_type = kTypeActions[i].data_type;
+      int& slot = slots_[Hash(seed_, data_type, data_type + lengths_[i]) &
+                         mask_];
+      is_perfect = slot < 0;
+      slot = i;
+    }
+    if (is_perfect) {
+      break;
+    }
+    if (++seed_ % 64 == 0) {
+      num_slots *= 2;
+    }
+  }
+  const std::vector<string> field_names = JSONFieldVector();
+  const proto::Descriptor* descriptor = PlasoEvent::descriptor();
+  for (int i = 0; i < kNumFieldActions; ++i) {
+    const FieldAction& action = kFieldActions[i];
+    CompiledAction compiled;
+    compiled.option = action.option;
+    compiled.source = action.source;
+    compiled.source_id = static_cast<int>(
+        std::lower_bound(field_names.begin(), field_names.end(),
+                         compiled.source) -
+        field_names.begin());
+    compiled.target = descriptor->FindFieldByName(action.target);
+    CHECK(compiled.target != nullptr,
+          util::StrCat("The PlasoEvent proto has no field named ",
+                       action.target));
+    if (action.option == ParseOption::kCopy) {
+      CHECK(compiled.target->type() == proto::FieldDescriptor::TYPE_STRING,
+            util::StrCat("The field ", action.target, " is not a string."));
+    } else {
+      CHECK(compiled.target->message_type() == File::descriptor(),
+            util::StrCat("The field ", action.target, " is not a File."));
+    }
+    compiled_actions_.push_back(compiled);
+  }
+}
+
 string GetJSONField(const string& field_name, const ::Json::Value& json_event) {
   CHECK(json_event.isObject(),
         util::StrCat("GetJSONField requires an object but was ", "called on ",
@@ -159,83 +282,115 @@ void SetTimestamp(const string& timestamp_str, PlasoEvent* event) {
   }
 }
 
-// For each (key, value) pair in 'field_map', sets a field 'value' in the proto
-// 'event' to the contents of the field 'key' in 'json_event'. Crashes if
-//   * some 'key' is not a string member of 'json_event'.
-//   * some 'value' is not a string member of '*event'.
-void CopyJSONToProtoStrings(const Json::Value& json_event,
-                            const map<string, string>& field_map,
-                            PlasoEvent* event) {
-  const proto::Reflection* reflection = event->GetReflection();
-  const proto::FieldDescriptor* field;
-  for (const auto& field_pair : field_map) {
-    field = (event->GetDescriptor())->FindFieldByName(field_pair.second);
-    CHECK(field != nullptr,
-          util::StrCat("The PlasoEvent proto has no field named ",
-                       field_pair.second));
-    CHECK(field->type() == proto::FieldDescriptor::TYPE_STRING,
-          util::StrCat("The field ", field_pair.second, " is not a string."));
-    reflection->SetString(event, field,
-                          GetJSONField(field_pair.first, json_event));
+// A JSONSource provides the members of a Json::Value to the functions below.
+class JSONSource {
+ public:
+  explicit JSONSource(const Json::Value& json_event)
+      : json_event_(json_event) {}
+  string Get(const string& field_name) const {
+    return GetJSONField(field_name, json_event_);
   }
-}
+  string Get(const CompiledAction& action) const { return Get(action.source); }
 
-// For each (key, value) pair in 'field_map', set the field named 'value' in
-// 'event' to a File message derived from 'key'.  Crashes if 'value' is not a
-// string member of 'event'. Crashes if
-//   * some 'key' is not a string member of 'json_event'.
-//   * some 'value' is not a File message in '*event'.
-void SetFileFields(const Json::Value& json_event,
-                   const map<string, string>& field_map, PlasoEvent* event) {
-  const proto::Reflection* reflection = event->GetReflection();
-  const proto::FieldDescriptor* field;
-  for (const auto& field_pair : field_map) {
-    field = (event->GetDescriptor())->FindFieldByName(field_pair.second);
-    CHECK(field != nullptr,
-          util::StrCat("The PlasoEvent proto has no field named ",
-                       field_pair.second));
-    File file = ParseFilename(GetJSONField(field_pair.first, json_event));
-    proto::Message* m = reflection->MutableMessage(event, field);
-    m->CopyFrom(file);
+ private:
+  const Json::Value& json_event_;
+};
+
+// A ReaderSource provides the members extracted by a JsonFieldReader. The
+// text of a null member is the empty string, as in Json::Value::asString.
+class ReaderSource {
+ public:
+  ReaderSource(const JsonFieldReader& reader,
+               const std::unordered_map<string, int>& field_ids)
+      : reader_(reader), field_ids_(field_ids) {}
+  string Get(const string& field_name) const {
+    auto id_it = field_ids_.find(field_name);
+    CHECK(id_it != field_ids_.end() && reader_.Has(id_it->second),
+          util::StrCat("No field named ", field_name, " in the JSON object."));
+    return Text(id_it->second);
+  }
+  // The fields of the reader are those of JSONFieldVector(), so the source of
+  // an action is found by its position without a lookup.
+  string Get(const CompiledAction& action) const {
+    CHECK(reader_.Has(action.source_id),
+          util::StrCat("No field named ", action.source,
+                       " in the JSON object."));
+    return Text(action.source_id);
+  }
+  string Text(int id) const {
+    if (!reader_.IsString(id) && reader_.Text(id) == "null") {
+      return "";
+    }
+    return reader_.Text(id);
   }
-}
 
-void SetEventFields(const Json::Value& json_event, PlasoEvent* event) {
-  event->set_desc(GetJSONField(plaso::kDescriptionName, json_event));
-  string plaso_type = GetJSONField(plaso::kDataTypeName, json_event);
-  auto action_it = kParseActions.find(plaso_type);
-  if (action_it == kParseActions.end()) {
+ private:
+  const JsonFieldReader& reader_;
+  const std::unordered_map<string, int>& field_ids_;
+};
+
+// Applies the actions of the Plaso type of the event in 'source' to 'event'.
+// Crashes if the source of an action is not a string member of 'source'.
+template <typename Source>
+void SetEventFields(const Source& source, PlasoEvent* event) {
+  event->set_desc(source.Get(plaso::kDescriptionName));
+  string plaso_type = source.Get(plaso::kDataTypeName);
+  const ActionTable& table = ActionTable::Get();
+  const TypeAction* type_action = table.Find(plaso_type);
+  if (type_action == nullptr) {
     event->set_type(EventType::DEFAULT);
-  } else {
-    event->set_type((action_it->second).first);
-    if (event->type() == EventType::SKIP) {
-      return;
-    }
-    for (const auto& action : (action_it->second).second) {
-      switch (action.first) {
-        case ParseOption::kCopy:
-          CopyJSONToProtoStrings(json_event, action.second, event);
-          break;
-        case ParseOption::kMakeFile:
-          SetFileFields(json_event, action.second, event);
-          break;
+    return;
+  }
+  event->set_type(type_action->type);
+  const proto::Reflection* reflection = event->GetReflection();
+  for (const CompiledAction& action : table.Actions(*type_action)) {
+    switch (action.option) {
+      case ParseOption::kCopy:
+        reflection->SetString(event, action.target, source.Get(action));
+        break;
+      case ParseOption::kMakeFile: {
+        File file = ParseFilename(source.Get(action));
+        static_cast<File*>(reflection->MutableMessage(event, action.target))
+            ->Swap(&file);
+        break;
       }
     }
   }
 }
 
+// The key of the Plaso type of an event as it occurs in JSON text.
+const char kDataTypeKey[] = "\"data_type\"";
+
+// Returns the first position in [pos, end) that is not JSON whitespace.
+const char* SkipSpace(const char* pos, const char* end) {
+  while (pos != end &&
+         (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Returns the value of the JSON number 'text' truncated to an integer, which
+// is what Json::Value::asInt64 returns. Text that is not a number is 0.
+int64_t ParseInt64(const string& text) {
+  if (text.find_first_of(".eE") != string::npos) {
+    return static_cast<int64_t>(std::strtod(text.c_str(), nullptr));
+  }
+  return static_cast<int64_t>(std::strtoll(text.c_str(), nullptr, 10));
+}
+
 }  // namespace
 
 File ParseFilename(const string& filename) {
-  vector<string> dirs = util::SplitToVector(filename, '/');
+  vector<util::StringPiece> dirs = util::SplitToPieces(filename, '/');
   File file;
   // The result of Split will be a nonempty vector, so dirs.back() is defined.
   if (!dirs.back().empty()) {
-    file.set_filename(dirs.back());
+    file.set_filename(dirs.back().data(), dirs.back().size());
   }
   dirs.pop_back();
-  for (const auto& dir : dirs) {
-    file.mutable_directory()->add_path(dir);
+  for (util::StringPiece dir : dirs) {
+    file.mutable_directory()->add_path(dir.data(), dir.size());
   }
   return file;
 }
@@ -249,27 +404,112 @@ PlasoEvent ParseJSON(const ::Json::Value& json_event) {
       static_cast<int64_t>(unix_nanos / static_cast<::Json::Int64>(1000)));
   string filename = GetJSONField(plaso::kSourceFileName, json_event);
   *event.mutable_event_source_file() = ParseFilename(filename);
-  SetEventFields(json_event, &event);
+  SetEventFields(JSONSource(json_event), &event);
   return event;
 }
 
+EventParser::EventParser() : reader_(JSONFieldVector()) {
+  const std::vector<string> field_names = JSONFieldVector();
+  for (size_t i = 0; i < field_names.size(); ++i) {
+    field_ids_[field_names[i]] = static_cast<int>(i);
+  }
+  for (const string& field_name :
+       util::SplitToSet(plaso::kRequiredFields, ',')) {
+    required_ids_.push_back(field_ids_.at(field_name));
+  }
+}
+
+bool EventParser::Parse(const char* begin, const char* end,
+                        PlasoEvent* event) {
+  bool success = reader_.Parse(begin, end);
+  CHECK(success, "Line is not in JSON format");
+  for (int id : required_ids_) {
+    if (!reader_.Has(id)) {
+      return false;
+    }
+  }
+  ReaderSource source(reader_, field_ids_);
+  event->Clear();
+  // Convert the nanosecond timestamp to a microsecond timestamp as ParseJSON
+  // does.
+  int64_t unix_nanos =
+      ParseInt64(source.Text(field_ids_.at(plaso::kTimestampName)));
+  event->set_timestamp(unix_nanos / 1000);
+  *event->mutable_event_source_file() =
+      ParseFilename(source.Get(plaso::kSourceFileName));
+  SetEventFields(source, event);
+  return true;
+}
+
+// The key must occur exactly once, since another occurrence may be the key of
+// a member of a nested object or the contents of a string. Any escape sequence
+// in the value makes the search fail rather than being decoded.
+bool HasSkipDataType(const char* begin, const char* end) {
+  const char* key_end = kDataTypeKey + sizeof(kDataTypeKey) - 1;
+  const char* key = std::search(begin, end, kDataTypeKey, key_end);
+  if (key == end) {
+    return false;
+  }
+  const char* pos = key + (key_end - kDataTypeKey);
+  if (std::search(pos, end, kDataTypeKey, key_end) != end) {
+    return false;
+  }
+  pos = SkipSpace(pos, end);
+  if (pos == end || *pos != ':') {
+    return false;
+  }
+  pos = SkipSpace(pos + 1, end);
+  if (pos == end || *pos != '"') {
+    return false;
+  }
+  const char* value_begin = pos + 1;
+  const char* value_end = std::find_if(
+      value_begin, end, [](char c) { return c == '"' || c == '\\'; });
+  if (value_end == end || *value_end != '"') {
+    return false;
+  }
+  const TypeAction* type_action =
+      ActionTable::Get().Find(value_begin, value_end);
+  return type_action != nullptr && type_action->type == EventType::SKIP;
+}
+
+std::set<string> JSONFieldNames() {
+  std::set<string> field_names = util::SplitToSet(plaso::kRequiredFields, ',');
+  field_names.insert({plaso::kDataTypeName, plaso::kDescriptionName,
+                      plaso::kSourceFileName, plaso::kTimestampName});
+  for (const FieldAction& action : kFieldActions) {
+    field_names.insert(action.source);
+  }
+  return field_names;
+}
+
 AST ToAST(const File& file) {
-  AST file_ast = value::MakeNullTuple(2);
-  AST path_type = type::MakeDirectory();
-  AST file_type = type::MakeFile();
-  AST path_ast = value::MakeEmptyList();
+  google::protobuf::Arena arena;
+  return *ToAST(file, &arena);
+}
+
+// The parts of the AST are constructed on 'arena' and moved into place.
+AST* ToAST(const File& file, google::protobuf::Arena* arena) {
+  // The types are checked once and shared by every file of every event.
+  static const value::ValidatedType* const path_type =
+      new value::ValidatedType(type::MakeDirectory());
+  static const value::ValidatedType* const file_type =
+      new value::ValidatedType(type::MakeFile());
+  AST* file_ast = value::MakeNullTuple(2, arena);
+  AST* path_ast = value::MakeEmptyList(arena);
   if (file.has_directory()) {
     for (const string& dir : file.directory().path()) {
-      value::Append(path_type, value::MakeString(dir), &path_ast);
+      value::Append(*path_type, std::move(*value::MakeString(dir, arena)),
+                    path_ast);
     }
   }
-  value::SetField(file_type, 0, path_ast, &file_ast);
-  AST filename_ast = value::MakePrimitiveNull(PrimitiveType::STRING);
+  value::SetField(*file_type, 0, std::move(*path_ast), file_ast);
+  AST* filename_ast = value::MakePrimitiveNull(PrimitiveType::STRING, arena);
   if (file.has_filename()) {
-    filename_ast.mutable_p_ast()->mutable_val()->set_string_val(
+    filename_ast->mutable_p_ast()->mutable_val()->set_string_val(
         file.filename());
   }
-  value::SetField(file_type, 1, filename_ast, &file_ast);
+  value::SetField(*file_type, 1, std::move(*filename_ast), file_ast);
   return file_ast;
 }
 
@@ -18,8 +18,15 @@
 #ifndef LOGLE_PLASO_EVENT_H_
 #define LOGLE_PLASO_EVENT_H_
 
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <google/protobuf/arena.h>
+
 #include "base/string.h"
 #include "json/json.h"
+#include "util/json_reader.h"
 #include "plaso_event.pb.h"
 #include "ast.pb.h"
 
@@ -45,8 +52,57 @@ File ParseFilename(const string& filename);
 // Constructs an event proto from a JSON object generated by Timesketch.
 PlasoEvent ParseJSON(const ::Json::Value& json_event);
 
+// An EventParser constructs event protos directly from the text of JSON
+// objects generated by Timesketch. Only the members named by JSONFieldNames()
+// are extracted and all other members are skipped without being parsed into a
+// Json::Value, so parsing a line is much faster than with Json::Reader and
+// ParseJSON. An EventParser reuses its buffers across lines and is not thread
+// safe, so each thread should use its own parser.
+// Example:
+//   plaso::EventParser parser;
+//   PlasoEvent event;
+//   if (parser.Parse(line.data(), line.data() + line.size(), &event)) {
+//     ...
+//   }
+class EventParser {
+ public:
+  EventParser();
+
+  // Sets '*event' to the event that ParseJSON constructs from the JSON object
+  // in the range [begin, end). Returns false if the object does not have every
+  // field in kRequiredFields. Numbers that are not integers are copied to
+  // string fields as they are written in the input.
+  // - Crashes if the range is not a JSON object, or if a field that ParseJSON
+  //   requires is missing.
+  bool Parse(const char* begin, const char* end, PlasoEvent* event);
+
+ private:
+  JsonFieldReader reader_;
+  std::unordered_map<string, int> field_ids_;
+  std::vector<int> required_ids_;
+};
+
+// Returns true if a substring search of the JSON object in the range
+// [begin, end) finds that ParseJSON would construct an event of type
+// EventType::SKIP from it, which is much cheaper than parsing the object. The
+// search only succeeds if the key "data_type" occurs exactly once in the range
+// and is followed by a string without escape sequences whose value is a Plaso
+// type that is skipped. If false is returned, the object may still construct a
+// skipped event. The object is not validated, so a malformed object may be
+// classified as skipped.
+bool HasSkipDataType(const char* begin, const char* end);
+
+// Returns the names of all fields of a JSON event that ParseJSON may read. A
+// reader that only extracts these fields, such as MappedJsonLines, produces
+// objects from which ParseJSON constructs the same event.
+std::set<string> JSONFieldNames();
+
 // Return a PlasoEventGraph AST representing a file.
 AST ToAST(const File& file);
+// Behaves like the function above but constructs the AST on 'arena', which
+// owns the returned AST.
+// - Requires that 'arena' is not null.
+AST* ToAST(const File& file, google::protobuf::Arena* arena);
 
 // Return a string with the full path and filename of the file in 'file'.
 string ToString(const File& file);
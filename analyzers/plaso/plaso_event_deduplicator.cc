@@ -0,0 +1,97 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_event_deduplicator.h"
+
+#include "util/logging.h"
+#include "util/memory_usage.h"
+#include "util/sketches.h"
+
+namespace morphie {
+
+namespace {
+
+const char kFingerprintsErr[] =
+    "The number of fingerprints of a deduplicator must be positive.";
+
+// Appends the bytes of 'value' to 'key'.
+void AppendInt(int64_t value, string* key) {
+  key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Appends 'field' to 'key', preceded by its size so that the fields of two
+// events with different fields never concatenate to the same key.
+void AppendField(const string& field, string* key) {
+  AppendInt(static_cast<int64_t>(field.size()), key);
+  key->append(field);
+}
+
+}  // namespace
+
+PlasoEventDeduplicator::PlasoEventDeduplicator(int64_t max_fingerprints)
+    : max_fingerprints_(static_cast<size_t>(max_fingerprints)),
+      num_duplicates_(0),
+      oldest_(0) {
+  CHECK(max_fingerprints > 0, kFingerprintsErr);
+}
+
+// A missing timestamp or file is a field of size -1, which differs from every
+// present field. A file is hashed in its serialized form, which is the same
+// for files with equal fields.
+uint64_t PlasoEventDeduplicator::Fingerprint(const PlasoEvent& event) {
+  key_.clear();
+  if (event.has_timestamp()) {
+    AppendInt(event.timestamp(), &key_);
+  } else {
+    AppendInt(-1, &key_);
+  }
+  AppendInt(event.type(), &key_);
+  const File* files[] = {
+      event.has_event_source_file() ? &event.event_source_file() : nullptr,
+      event.has_source_file() ? &event.source_file() : nullptr,
+      event.has_target_file() ? &event.target_file() : nullptr};
+  for (const File* file : files) {
+    if (file == nullptr) {
+      AppendInt(-1, &key_);
+      continue;
+    }
+    AppendField(file->SerializeAsString(), &key_);
+  }
+  AppendField(event.source_url(), &key_);
+  AppendField(event.target_url(), &key_);
+  return util::SketchHash(key_);
+}
+
+bool PlasoEventDeduplicator::IsDuplicate(const PlasoEvent& event) {
+  const uint64_t fingerprint = Fingerprint(event);
+  if (!fingerprints_.insert(fingerprint).second) {
+    ++num_duplicates_;
+    return true;
+  }
+  if (recent_.size() < max_fingerprints_) {
+    recent_.push_back(fingerprint);
+    return false;
+  }
+  fingerprints_.erase(recent_[oldest_]);
+  recent_[oldest_] = fingerprint;
+  oldest_ = (oldest_ + 1) % max_fingerprints_;
+  return false;
+}
+
+size_t PlasoEventDeduplicator::MemoryUsage() const {
+  return fingerprints_.bucket_count() * (sizeof(uint64_t) + 1) +
+         util::VectorBytes(recent_);
+}
+
+}  // namespace morphie
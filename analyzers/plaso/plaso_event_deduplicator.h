@@ -0,0 +1,86 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A PlasoEventDeduplicator recognizes Plaso events that have been seen before,
+// such as the copies of an event that several Plaso parsers, or overlapping
+// evidence images, emit. Every copy of an event would otherwise be a separate
+// event node of a PlasoEventGraph with the same edges to the same files. Two
+// events are duplicates if they have the same fingerprint, which is a 64-bit
+// hash of their timestamp, type, files and URLs. The files of an event include
+// the file from which Plaso extracted it even if a graph does not show it, so
+// that events of distinct files, such as file system events that only have
+// that file, are never duplicates. Distinct events collide with a probability
+// of about n^2 / 2^65 for n events, which is negligible.
+//
+// The deduplicator remembers the fingerprints of a bounded number of the most
+// recent distinct events, so a copy is only recognized if fewer distinct
+// events separate it from the first copy. Copies of an event have the same
+// timestamp, so in input that is ordered by time, such as the output of
+// Plaso's psort or of PlasoEventSorter, they are close to each other.
+//
+// Example.
+//   PlasoEventDeduplicator deduplicator(1 << 20);
+//   for (const PlasoEvent& event : events) {
+//     if (!deduplicator.IsDuplicate(event)) {
+//       graph.ProcessEvent(event);
+//     }
+//   }
+#ifndef LOGLE_PLASO_EVENT_DEDUPLICATOR_H_
+#define LOGLE_PLASO_EVENT_DEDUPLICATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/string.h"
+#include "plaso_event.pb.h"
+#include "util/flat_hash_map.h"
+
+namespace morphie {
+
+class PlasoEventDeduplicator {
+ public:
+  // Constructs a deduplicator that remembers the fingerprints of the last
+  // 'max_fingerprints' distinct events.
+  // - Crashes unless 'max_fingerprints' is positive.
+  explicit PlasoEventDeduplicator(int64_t max_fingerprints);
+  PlasoEventDeduplicator(const PlasoEventDeduplicator&) = delete;
+  PlasoEventDeduplicator& operator=(const PlasoEventDeduplicator&) = delete;
+
+  // Returns true if 'event' has the fingerprint of a remembered event.
+  // Otherwise, remembers the fingerprint of 'event', forgetting the oldest
+  // fingerprint if the deduplicator is full, and returns false.
+  bool IsDuplicate(const PlasoEvent& event);
+  // Returns the fingerprint of 'event'.
+  uint64_t Fingerprint(const PlasoEvent& event);
+
+  int64_t NumDuplicates() const { return num_duplicates_; }
+  // Returns the estimated memory of the fingerprints in bytes.
+  size_t MemoryUsage() const;
+
+ private:
+  const size_t max_fingerprints_;
+  int64_t num_duplicates_;
+  util::FlatHashSet<uint64_t> fingerprints_;
+  // The remembered fingerprints in a ring buffer, in which 'oldest_' is the
+  // index of the oldest fingerprint once the buffer is full.
+  std::vector<uint64_t> recent_;
+  size_t oldest_;
+  // The buffer in which the fields of an event are hashed.
+  string key_;
+};
+
+}  // namespace morphie
+
+#endif  // LOGLE_PLASO_EVENT_DEDUPLICATOR_H_
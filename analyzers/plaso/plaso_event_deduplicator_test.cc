@@ -0,0 +1,92 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_event_deduplicator.h"
+
+#include "analyzers/plaso/plaso_event.h"
+#include "analyzers/plaso/plaso_test_util.h"
+#include "gtest.h"
+#include "plaso_event.pb.h"
+
+namespace morphie {
+namespace {
+
+using test::MakeEvent;
+
+// Events that differ in their timestamp, type, files or URLs are distinct, and
+// events that differ in other fields, such as their description, are not.
+TEST(PlasoEventDeduplicatorTest, RecognizesCopies) {
+  PlasoEventDeduplicator deduplicator(100);
+  PlasoEvent event = MakeEvent(10, EventType::FILE_CREATED, "/tmp/a");
+  EXPECT_FALSE(deduplicator.IsDuplicate(event));
+  event.set_desc("crtime");
+  EXPECT_TRUE(deduplicator.IsDuplicate(event));
+  EXPECT_FALSE(deduplicator.IsDuplicate(
+      MakeEvent(11, EventType::FILE_CREATED, "/tmp/a")));
+  EXPECT_FALSE(deduplicator.IsDuplicate(
+      MakeEvent(10, EventType::FILE_ACCESSED, "/tmp/a")));
+  EXPECT_FALSE(deduplicator.IsDuplicate(
+      MakeEvent(10, EventType::FILE_CREATED, "/tmp/b")));
+  event.set_target_url("http://example.com");
+  EXPECT_FALSE(deduplicator.IsDuplicate(event));
+  event.clear_timestamp();
+  EXPECT_FALSE(deduplicator.IsDuplicate(event));
+  EXPECT_TRUE(deduplicator.IsDuplicate(event));
+  EXPECT_EQ(2, deduplicator.NumDuplicates());
+}
+
+// Events of distinct source files are distinct.
+TEST(PlasoEventDeduplicatorTest, HashesSourceFiles) {
+  PlasoEvent event;
+  event.set_timestamp(10);
+  event.set_type(EventType::DEFAULT);
+  PlasoEvent other_event = event;
+  *event.mutable_event_source_file() = plaso::ParseFilename("/tmp/a");
+  *other_event.mutable_event_source_file() = plaso::ParseFilename("/tmp/b");
+  PlasoEventDeduplicator deduplicator(100);
+  EXPECT_NE(deduplicator.Fingerprint(event),
+            deduplicator.Fingerprint(other_event));
+  EXPECT_FALSE(deduplicator.IsDuplicate(event));
+  EXPECT_FALSE(deduplicator.IsDuplicate(other_event));
+}
+
+// Only the fingerprints of the most recent distinct events are remembered.
+TEST(PlasoEventDeduplicatorTest, ForgetsOldestFingerprints) {
+  PlasoEventDeduplicator deduplicator(3);
+  for (int64_t timestamp = 0; timestamp < 4; ++timestamp) {
+    EXPECT_FALSE(deduplicator.IsDuplicate(
+        MakeEvent(timestamp, EventType::FILE_CREATED, "/tmp/a")));
+  }
+  const size_t memory = deduplicator.MemoryUsage();
+  EXPECT_TRUE(deduplicator.IsDuplicate(
+      MakeEvent(3, EventType::FILE_CREATED, "/tmp/a")));
+  EXPECT_TRUE(deduplicator.IsDuplicate(
+      MakeEvent(1, EventType::FILE_CREATED, "/tmp/a")));
+  EXPECT_FALSE(deduplicator.IsDuplicate(
+      MakeEvent(0, EventType::FILE_CREATED, "/tmp/a")));
+  for (int64_t timestamp = 4; timestamp < 100; ++timestamp) {
+    deduplicator.IsDuplicate(
+        MakeEvent(timestamp, EventType::FILE_CREATED, "/tmp/a"));
+  }
+  EXPECT_EQ(memory, deduplicator.MemoryUsage());
+}
+
+TEST(PlasoEventDeduplicatorDeathTest, RequiresPositiveFingerprints) {
+  EXPECT_DEATH({ PlasoEventDeduplicator deduplicator(0); },
+               "The number of fingerprints of a deduplicator must be "
+               "positive.");
+}
+
+}  // namespace
+}  // namespace morphie
@@ -0,0 +1,149 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_event_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "util/logging.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+
+namespace {
+
+namespace io = ::google::protobuf::io;
+
+const char kOpenErr[] = "Error opening event file: ";
+const char kWriteErr[] = "Error writing event file: ";
+const char kNotOpenErr[] = "The event file is not open.";
+
+}  // namespace
+
+PlasoEventWriter::~PlasoEventWriter() {
+  if (fd_ >= 0) {
+    Close();
+  }
+}
+
+util::Status PlasoEventWriter::Open(const string& filename) {
+  if (fd_ >= 0) {
+    Close();
+  }
+  fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenErr, filename));
+  }
+  filename_ = filename;
+  stream_.reset(new io::FileOutputStream(fd_));
+  coded_out_.reset(new io::CodedOutputStream(stream_.get()));
+  return util::Status::OK;
+}
+
+void PlasoEventWriter::Write(const PlasoEvent& event) {
+  CHECK(coded_out_ != nullptr, kNotOpenErr);
+  coded_out_->WriteVarint32(static_cast<uint32_t>(event.ByteSizeLong()));
+  event.SerializeWithCachedSizes(coded_out_.get());
+}
+
+// The coded stream is destroyed first, so that it hands the bytes it has
+// buffered back to the file stream before that is closed.
+util::Status PlasoEventWriter::Close() {
+  if (fd_ < 0) {
+    return util::Status(Code::EXTERNAL, kNotOpenErr);
+  }
+  const bool has_error = coded_out_->HadError();
+  coded_out_.reset();
+  const bool is_closed = stream_->Close();
+  stream_.reset();
+  fd_ = -1;
+  if (has_error || !is_closed) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kWriteErr, filename_));
+  }
+  return util::Status::OK;
+}
+
+PlasoEventReader::~PlasoEventReader() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, size_);
+  }
+}
+
+util::Status PlasoEventReader::Open(const string& filename) {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, size_);
+    mapping_ = nullptr;
+    data_ = nullptr;
+  }
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenErr, filename));
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenErr, filename));
+  }
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ > 0) {
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      size_ = 0;
+      return util::Status(Code::EXTERNAL, util::StrCat(kOpenErr, filename));
+    }
+    madvise(mapping, size_, MADV_SEQUENTIAL);
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t*>(mapping_);
+  }
+  close(fd);
+  offset_ = 0;
+  is_ok_ = true;
+  return util::Status::OK;
+}
+
+// A coded stream reads at most INT_MAX bytes, so one is constructed per event
+// over the rest of the file, which costs no allocation.
+bool PlasoEventReader::Next(PlasoEvent* event) {
+  if (!is_ok_ || offset_ == size_) {
+    return false;
+  }
+  const size_t remaining = std::min<size_t>(
+      size_ - offset_, std::numeric_limits<int>::max());
+  io::CodedInputStream coded_in(data_ + offset_, static_cast<int>(remaining));
+  uint32_t event_size = 0;
+  if (!coded_in.ReadVarint32(&event_size)) {
+    is_ok_ = false;
+    return false;
+  }
+  const io::CodedInputStream::Limit limit = coded_in.PushLimit(event_size);
+  // Events are parsed as they were written, even if they lack required
+  // fields. An event that ends before its size is truncated.
+  if (!event->ParsePartialFromCodedStream(&coded_in) ||
+      !coded_in.ConsumedEntireMessage() || coded_in.BytesUntilLimit() != 0) {
+    is_ok_ = false;
+    return false;
+  }
+  coded_in.PopLimit(limit);
+  offset_ += coded_in.CurrentPosition();
+  return true;
+}
+
+}  // namespace morphie
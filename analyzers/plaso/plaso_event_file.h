@@ -0,0 +1,114 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A Plaso event file holds a sequence of PlasoEvent messages in the binary
+// wire format, each preceded by its size as a varint, which is the format of
+// the runs of a PlasoEventSorter. Events are converted from JSON once, with
+// the classification of plaso::ParseJSON, and the file is read back at the
+// speed at which messages are decoded, so repeated analyses of the same
+// evidence do not parse JSON again. A file is read by mapping it into memory,
+// so event files are never compressed.
+//
+// Example.
+//   PlasoEventWriter writer;
+//   util::Status status = writer.Open("events.pb");
+//   for (const PlasoEvent& event : events) {
+//     writer.Write(event);
+//   }
+//   status = writer.Close();
+//
+//   PlasoEventReader reader;
+//   status = reader.Open("events.pb");
+//   PlasoEvent event;
+//   while (reader.Next(&event)) { ... }
+//   if (!reader.is_ok()) { ... }
+#ifndef LOGLE_PLASO_EVENT_FILE_H_
+#define LOGLE_PLASO_EVENT_FILE_H_
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include <cstddef>
+#include <memory>
+
+#include "base/string.h"
+#include "plaso_event.pb.h"
+#include "util/status.h"
+
+namespace morphie {
+
+class PlasoEventWriter {
+ public:
+  PlasoEventWriter() : fd_(-1) {}
+  // Closes the file if it is open. Use Close() to learn if the file was
+  // written.
+  ~PlasoEventWriter();
+  PlasoEventWriter(const PlasoEventWriter&) = delete;
+  PlasoEventWriter& operator=(const PlasoEventWriter&) = delete;
+
+  // Creates or truncates the file 'filename'. Returns
+  // - Status::EXTERNAL - if the file could not be opened.
+  // - Status::OK - otherwise.
+  util::Status Open(const string& filename);
+  // Appends 'event' to the file.
+  // - Crashes if the file is not open.
+  void Write(const PlasoEvent& event);
+  // Writes the buffered events and closes the file. Returns
+  // - Status::EXTERNAL - if the file is not open or an event could not be
+  //   written.
+  // - Status::OK - otherwise.
+  util::Status Close();
+
+ private:
+  string filename_;
+  int fd_;
+  std::unique_ptr<google::protobuf::io::FileOutputStream> stream_;
+  std::unique_ptr<google::protobuf::io::CodedOutputStream> coded_out_;
+};
+
+class PlasoEventReader {
+ public:
+  PlasoEventReader()
+      : mapping_(nullptr), data_(nullptr), size_(0), offset_(0),
+        is_ok_(true) {}
+  ~PlasoEventReader();
+  PlasoEventReader(const PlasoEventReader&) = delete;
+  PlasoEventReader& operator=(const PlasoEventReader&) = delete;
+
+  // Maps the file 'filename' into memory. Returns
+  // - Status::EXTERNAL - if the file could not be opened or mapped.
+  // - Status::OK - otherwise.
+  util::Status Open(const string& filename);
+  // Parses the next event of the file into '*event' and returns true. Returns
+  // false at the end of the file, or if the next event is truncated or
+  // malformed, in which case is_ok() becomes false and no more events are
+  // read.
+  // - Requires that 'event' is not null.
+  bool Next(PlasoEvent* event);
+  bool is_ok() const { return is_ok_; }
+  // Returns the number of bytes read so far and the size of the file.
+  size_t offset() const { return offset_; }
+  size_t size() const { return size_; }
+
+ private:
+  void* mapping_;
+  const uint8_t* data_;
+  size_t size_;
+  size_t offset_;
+  bool is_ok_;
+};
+
+}  // namespace morphie
+
+#endif  // LOGLE_PLASO_EVENT_FILE_H_
@@ -0,0 +1,112 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_event_file.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/string.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace {
+
+class PlasoEventFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char filename[] = "/tmp/plaso_event_file_test_XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    filename_ = filename;
+  }
+
+  void TearDown() override { unlink(filename_.c_str()); }
+
+  string filename_;
+};
+
+// Events of different sizes, including an empty one, are read in the order in
+// which they were written.
+TEST_F(PlasoEventFileTest, ReadsWrittenEvents) {
+  std::vector<PlasoEvent> events(3);
+  events[0].set_timestamp(5);
+  events[0].set_type(EventType::FILE_CREATED);
+  events[2].set_timestamp(-7);
+  events[2].set_desc(string(300, 'a'));
+  PlasoEventWriter writer;
+  ASSERT_TRUE(writer.Open(filename_).ok());
+  for (const PlasoEvent& event : events) {
+    writer.Write(event);
+  }
+  ASSERT_TRUE(writer.Close().ok());
+  EXPECT_FALSE(writer.Close().ok());
+
+  PlasoEventReader reader;
+  ASSERT_TRUE(reader.Open(filename_).ok());
+  PlasoEvent event;
+  for (const PlasoEvent& expected : events) {
+    ASSERT_TRUE(reader.Next(&event));
+    EXPECT_EQ(expected.SerializePartialAsString(),
+              event.SerializePartialAsString());
+  }
+  EXPECT_FALSE(reader.Next(&event));
+  EXPECT_TRUE(reader.is_ok());
+  EXPECT_EQ(reader.size(), reader.offset());
+}
+
+TEST_F(PlasoEventFileTest, ReadsEmptyFile) {
+  PlasoEventReader reader;
+  ASSERT_TRUE(reader.Open(filename_).ok());
+  PlasoEvent event;
+  EXPECT_FALSE(reader.Next(&event));
+  EXPECT_TRUE(reader.is_ok());
+}
+
+// A file that ends in the middle of an event is read up to that event.
+TEST_F(PlasoEventFileTest, RejectsTruncatedEvents) {
+  PlasoEvent event;
+  event.set_timestamp(5);
+  event.set_desc("description");
+  PlasoEventWriter writer;
+  ASSERT_TRUE(writer.Open(filename_).ok());
+  writer.Write(event);
+  writer.Write(event);
+  ASSERT_TRUE(writer.Close().ok());
+  const size_t event_size = event.ByteSizeLong() + 1;
+  ASSERT_EQ(0, truncate(filename_.c_str(), 2 * event_size - 3));
+
+  PlasoEventReader reader;
+  ASSERT_TRUE(reader.Open(filename_).ok());
+  EXPECT_TRUE(reader.Next(&event));
+  EXPECT_EQ(event_size, reader.offset());
+  EXPECT_FALSE(reader.Next(&event));
+  EXPECT_FALSE(reader.is_ok());
+  EXPECT_FALSE(reader.Next(&event));
+}
+
+TEST(PlasoEventReaderTest, RequiresExistingFile) {
+  PlasoEventReader reader;
+  EXPECT_EQ(Code::EXTERNAL,
+            reader.Open("/nonexistent-logle-dir/events").code());
+  PlasoEventWriter writer;
+  EXPECT_EQ(Code::EXTERNAL,
+            writer.Open("/nonexistent-logle-dir/events").code());
+}
+
+}  // namespace
+}  // namespace morphie
@@ -17,14 +17,28 @@
 // (ASTs) representing either types for labels or values for labels.
 #include "analyzers/plaso/plaso_event_graph.h"
 
-#include <boost/algorithm/string/join.hpp>  // NOLINT
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <random>
 #include <sstream>
+#include <unordered_set>
 #include <utility>
 
 #include "analyzers/plaso/plaso_event.h"
 #include "graph/ast.h"
 #include "graph/dot_printer.h"
+#include "graph/graph_file.h"
+#include "graph/graph_sampler.h"
 #include "graph/graph_exporter.h"
+#include "graph/graph_summary.h"
+#include "graph/graph_transformer.h"
+#include "graph/graph_traversal.h"
+#include "graph/schema.h"
+#include "graph/table_writer.h"
 #include "graph/type.h"
 #include "graph/type_checker.h"
 #include "graph/value.h"
@@ -32,6 +46,7 @@
 #include "util/logging.h"
 #include "util/string_utils.h"
 #include "util/time_utils.h"
+#include "util/trace.h"
 
 namespace morphie {
 
@@ -42,97 +57,624 @@ namespace {
 
 const char kInitializationErr[] = "The graph is not initialized.";
 const char kGraphNodeErr[] = "Error adding node to graph.";
-const char kGraphTypeErr[] = "Could not retrieve type information.";
 const char kTemporalEdgesErr[] = "AddTemporalEdges() can be called at most "
     "once. Events cannot be added after it is called.";
+const char kTemporalModeErr[] = "The representation of temporal edges must be "
+    "set before the graph is initialized.";
+const char kBatchErr[] = "Events cannot be processed while a batch is being "
+    "processed.";
+const char kTimeIndexErr[] = "Events can only be found by time after temporal "
+    "edges have been added.";
+const char kNeighborhoodSizeErr[] = "The number of hops and nodes of a "
+    "neighborhood must not be negative.";
+const char kNoSeedsErr[] = "No node has a label or tag of the neighborhood.";
+const char kSummarySizeErr[] = "The number of nodes and threads of a summary "
+    "must be positive.";
+const char kGranularityErr[] = "The granularity of a timeline or of a "
+    "coarsening must be positive.";
+const char kSampleSizeErr[] = "The number of events sampled from an interval "
+    "must be positive.";
+const char kCoarseTypeErr[] = "The types of the coarsened graph are invalid.";
+const char kLoadErr[] = "A loaded graph cannot be initialized again.";
+const char kGraphFileTypeErr[] = "The graph file does not contain an event "
+    "graph: ";
+const char kNotLoadedErr[] = "Only a graph that was loaded from a file can be "
+    "appended to the file.";
+const char kNoShardsErr[] = "There are no shards to merge.";
+const char kWindowErr[] = "A window must be positive and requires "
+    "incremental temporal edges.";
+const char kWindowModeErr[] = "The window must be set before the graph is "
+    "initialized.";
+const char kNoWindowErr[] = "The graph has no window.";
+const char kWindowDeltaErr[] = "A graph with a window cannot be saved as "
+    "deltas.";
+const char kRebuildErr[] = "Error rebuilding the graph.";
+const char kCopyErr[] = "Error copying the graph.";
+const char kNotEventErr[] = "The node is not an event.";
+const char kShardOrderErr[] = "The events of a shard must not be earlier than "
+    "the events of the shards before it: ";
 
 // Tags for data annotating nodes.
 const char kDescTag[] = "Description";
 const char kEventTag[] = "Event";
+const char kEventBlockTag[] = "EventBlock";
+const char kStartTag[] = "Start";
+const char kEndTag[] = "End";
+const char kCountTag[] = "Count";
 const char kSystemTag[] = "System";
+const char kTimeBucketTag[] = "TimeBucket";
+
+// The label types of an event graph, which are described in
+// plaso_event_graph.h.
+using EventLabel = schema::Label<
+    kEventTag,
+    schema::Field<kEventTag,
+                  schema::Tuple<schema::Field<ast::kTimeTag, schema::Timestamp,
+                                              true /*May be null*/>,
+                                schema::Field<kDescTag, schema::String,
+                                              true /*May be null*/>>>>;
+// The type of a file label is type::MakeFile().
+using FileLabel = schema::Label<
+    ast::kFileTag,
+    schema::Field<
+        ast::kFileTag,
+        schema::Tuple<
+            schema::Field<ast::kDirectory,
+                          schema::List<schema::Field<ast::kFilePathPart,
+                                                     schema::String>>,
+                          true /*May be null*/>,
+            schema::Field<ast::kFilename, schema::String,
+                          true /*May be null*/>>,
+        true /*May be null*/>,
+    true /*Is unique*/>;
+using IPAddressLabel = schema::Label<
+    ast::kIPAddressTag, schema::Field<ast::kIPAddressTag, schema::String>,
+    true /*Is unique*/>;
+using URLLabel =
+    schema::Label<ast::kURLTag, schema::Field<ast::kURLTag, schema::String>,
+                  true /*Is unique*/>;
+using TimeBucketLabel = schema::Label<
+    kTimeBucketTag, schema::Field<kTimeBucketTag, schema::Timestamp>,
+    true /*Is unique*/>;
+// The label of a block of events in the graph returned by CoarsenByTime().
+using EventBlockLabel = schema::Label<
+    kEventBlockTag,
+    schema::Field<kEventBlockTag,
+                  schema::Tuple<schema::Field<kStartTag, schema::Timestamp>,
+                                schema::Field<kEndTag, schema::Timestamp>,
+                                schema::Field<kCountTag, schema::Int>>>>;
+using PrecedesLabel = schema::Label<
+    ast::kPrecedesTag, schema::Field<ast::kPrecedesTag, schema::Null>,
+    true /*Is unique*/>;
+using UsesLabel =
+    schema::Label<ast::kUsesTag, schema::Field<ast::kUsesTag, schema::Null>,
+                  true /*Is unique*/>;
+using NodeLabels =
+    schema::LabelSet<EventLabel, FileLabel, IPAddressLabel, URLLabel,
+                     TimeBucketLabel>;
+using EdgeLabels = schema::LabelSet<PrecedesLabel, UsesLabel>;
+
+// The size of the stack buffer that is the first block of the arena on which
+// the labels of an event are constructed. The labels of most events fit into
+// this buffer, so constructing them does not allocate memory.
+const size_t kEventArenaSize = 4096;
+
+// The size at which rows of implicit temporal edges are flushed to a table.
+const size_t kTableBufferSize = 1 << 16;
+
+// Sets '*first' and '*last' to the earliest and the latest timestamp of an
+// event of 'graph'. Returns false if no event of 'graph' has a timestamp.
+bool GetEventTimes(const LabeledGraph& graph, int64_t* first, int64_t* last) {
+  bool has_events = false;
+  for (LabelId label_id = 0;
+       label_id < static_cast<LabelId>(graph.NumDistinctLabels());
+       ++label_id) {
+    const TaggedAST& label = graph.GetLabel(label_id);
+    if (label.tag() != kEventTag) {
+      continue;
+    }
+    const AST& time = label.ast().c_ast().arg(0);
+    if (!ast::IsTimestamp(time) || !time.p_ast().has_val()) {
+      continue;
+    }
+    const int64_t timestamp = time.p_ast().val().time_val();
+    *first = has_events ? std::min(*first, timestamp) : timestamp;
+    *last = has_events ? std::max(*last, timestamp) : timestamp;
+    has_events = true;
+  }
+  return has_events;
+}
+
+// Returns true if 'types' and 'expected' have the same tags and types.
+bool HasTypes(const type::Types& types, const type::Types& expected) {
+  if (types.size() != expected.size()) {
+    return false;
+  }
+  for (const auto& tag_type : expected) {
+    auto type_it = types.find(tag_type.first);
+    if (type_it == types.end() ||
+        type_it->second.SerializeAsString() !=
+            tag_type.second.SerializeAsString()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the start of the interval of 'granularity' microseconds, counted
+// from the Unix epoch, that contains 'timestamp'.
+int64_t IntervalStart(int64_t timestamp, int64_t granularity) {
+  int64_t interval = timestamp / granularity;
+  if (timestamp % granularity < 0) {
+    --interval;
+  }
+  return interval * granularity;
+}
 
 // A timeline for the Dot output is a vertical line annotated with timestamps in
 // order with the earliest timestamp at the top.  Events are displayed at the
-// same horizontal level as their timestamp in the timeline.
-string GetTimeline(const std::map<int64_t, std::set<NodeId>>& time_index) {
-  string timeline = "// Sub-graph showing timeline\n{\n";
-  std::vector<string> timestamps;
-  string node_name;
-  string time_aligned_nodes;
-  for (const auto& timed_events : time_index) {
-    node_name = util::StrCat("T", std::to_string(timed_events.first));
-    util::StrAppend(&timeline, "  ", node_name, " [shape=plaintext, ",
-                    R"(label=")", util::UnixMicrosToRFC3339(timed_events.first),
-                    "\"];\n");
-    timestamps.emplace_back(node_name);
-    util::StrAppend(&time_aligned_nodes, "  {rank=same; ", node_name, "; ",
-                    util::SetJoin(timed_events.second, "; "), "}\n");
-  }
-  util::StrAppend(&timeline, "  ", boost::algorithm::join(timestamps, " -> "),
-                  ";\n");
-  util::StrAppend(&timeline, time_aligned_nodes);
-  util::StrAppend(&timeline, "}  // subgraph for timeline \n");
-  return timeline;
+// same horizontal level as their timestamp in the timeline. The entries of the
+// timeline are sorted by timestamp. If 'granularity' is positive, the events
+// in an interval of 'granularity' microseconds are displayed at the start of
+// the interval.
+void WriteTimeline(util::Span<TimedNode> entries, int64_t granularity,
+                   std::ostream* out) {
+  *out << "// Sub-graph showing timeline\n{\n";
+  char time_buf[util::kRFC3339BufferSize];
+  // The first entry of each timestamp, or of each interval, and its time are
+  // found by scanning the sorted entries.
+  std::vector<size_t> firsts;
+  std::vector<int64_t> times;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const int64_t time =
+        granularity > 0 ? IntervalStart(entries[i].timestamp, granularity)
+                        : entries[i].timestamp;
+    if (i == 0 || time != times.back()) {
+      firsts.push_back(i);
+      times.push_back(time);
+    }
+  }
+  for (int64_t time : times) {
+    *out << "  T" << time << R"( [shape=plaintext, label=")";
+    out->write(time_buf, util::UnixMicrosToRFC3339(time, time_buf));
+    *out << "\"];\n";
+  }
+  *out << "  ";
+  for (size_t i = 0; i < times.size(); ++i) {
+    *out << (i == 0 ? "T" : " -> T") << times[i];
+  }
+  *out << ";\n";
+  for (size_t i = 0; i < firsts.size(); ++i) {
+    const size_t end = i + 1 < firsts.size() ? firsts[i + 1] : entries.size();
+    *out << "  {rank=same; T" << times[i] << "; ";
+    for (size_t j = firsts[i]; j < end; ++j) {
+      *out << (j == firsts[i] ? "" : "; ") << entries[j].node_id;
+    }
+    *out << "}\n";
+  }
+  *out << "}  // subgraph for timeline \n";
+}
+
+// Calls 'add_edge' with the source and the target of an edge from every event
+// in 'index' to every event with the next timestamp, which are the 'Precedes'
+// edges of the CLIQUE representation.
+void ForEachTemporalEdge(
+    const TimeIndex& index,
+    const std::function<void(NodeId, NodeId)>& add_edge) {
+  if (index.Empty()) {
+    return;
+  }
+  util::Span<TimedNode> bucket = index.NodesAt(index.Entries()[0].timestamp);
+  while (!bucket.empty()) {
+    util::Span<TimedNode> next_bucket = index.NodesAfter(bucket[0].timestamp);
+    for (const TimedNode& current : bucket) {
+      for (const TimedNode& next : next_bucket) {
+        add_edge(current.node_id, next.node_id);
+      }
+    }
+    bucket = next_bucket;
+  }
+}
+
+// Appends the events of 'index' with the smallest timestamp greater than (or
+// the largest timestamp less than) that of 'node_id' to '*events', which are
+// the targets (or sources) of the 'Precedes' edges of 'node_id' in the CLIQUE
+// representation. Appends nothing if 'node_id' is not an event with a
+// timestamp.
+void AppendAdjacentEvents(const LabeledGraph& graph, const TimeIndex& index,
+                          NodeId node_id, bool is_next,
+                          std::vector<NodeId>* events) {
+  const TaggedAST& label = graph.GetNodeLabel(node_id);
+  if (label.tag() != kEventTag) {
+    return;
+  }
+  const AST& time = label.ast().c_ast().arg(0);
+  if (!ast::IsTimestamp(time) || !time.p_ast().has_val()) {
+    return;
+  }
+  const int64_t timestamp = time.p_ast().val().time_val();
+  for (const TimedNode& entry : is_next ? index.NodesAfter(timestamp)
+                                        : index.NodesBefore(timestamp)) {
+    events->push_back(entry.node_id);
+  }
+}
+
+// Returns the neighborhood of 'seeds' in both directions as
+// GraphTraversal::Neighborhood() does, for a graph whose 'Precedes' edges are
+// those of the CLIQUE representation of 'index'. The search is a sequential
+// breadth-first search that finds the events adjacent to an event in 'index'.
+NodeSet ImplicitNeighborhood(const LabeledGraph& graph, const TimeIndex& index,
+                             const std::vector<NodeId>& seeds, int max_hops,
+                             int max_nodes) {
+  auto append_neighbors = [&graph, &index](NodeId node_id,
+                                           std::vector<NodeId>* nodes) {
+    OutEdgeIterator out_edge_end = graph.OutEdgeEnd(node_id);
+    for (OutEdgeIterator edge_it = graph.OutEdgeBegin(node_id);
+         edge_it != out_edge_end; ++edge_it) {
+      nodes->push_back(graph.Target(*edge_it));
+    }
+    InEdgeIterator in_edge_end = graph.InEdgeEnd(node_id);
+    for (InEdgeIterator edge_it = graph.InEdgeBegin(node_id);
+         edge_it != in_edge_end; ++edge_it) {
+      nodes->push_back(graph.Source(*edge_it));
+    }
+    AppendAdjacentEvents(graph, index, node_id, true, nodes);
+    AppendAdjacentEvents(graph, index, node_id, false, nodes);
+  };
+  // The nodes of 'reached' are ordered by distance, and those from
+  // 'level_begin' on are at distance 'hop' - 1.
+  std::vector<int> distances(graph.NumNodeIds(), -1);
+  std::vector<NodeId> reached;
+  for (NodeId seed : seeds) {
+    if (distances[seed] < 0) {
+      distances[seed] = 0;
+      reached.push_back(seed);
+    }
+  }
+  std::vector<NodeId> neighbors;
+  size_t level_begin = 0;
+  for (int hop = 1; hop <= max_hops && level_begin < reached.size(); ++hop) {
+    const size_t level_end = reached.size();
+    for (size_t i = level_begin; i < level_end; ++i) {
+      neighbors.clear();
+      append_neighbors(reached[i], &neighbors);
+      for (NodeId neighbor : neighbors) {
+        if (distances[neighbor] < 0) {
+          distances[neighbor] = hop;
+          reached.push_back(neighbor);
+        }
+      }
+    }
+    level_begin = level_end;
+  }
+  if (reached.size() > static_cast<size_t>(max_nodes)) {
+    // The degree of a node is the number of edges that enter or leave it.
+    std::vector<size_t> degrees(graph.NumNodeIds(), 0);
+    for (NodeId node_id : reached) {
+      neighbors.clear();
+      append_neighbors(node_id, &neighbors);
+      degrees[node_id] = neighbors.size();
+    }
+    std::nth_element(reached.begin(), reached.begin() + max_nodes,
+                     reached.end(),
+                     [&distances, &degrees](NodeId node1, NodeId node2) {
+                       if (distances[node1] != distances[node2]) {
+                         return distances[node1] < distances[node2];
+                       }
+                       if (degrees[node1] != degrees[node2]) {
+                         return degrees[node1] > degrees[node2];
+                       }
+                       return node1 < node2;
+                     });
+    reached.resize(max_nodes);
+  }
+  NodeSet neighborhood(graph.NumNodeIds());
+  for (NodeId node_id : reached) {
+    neighborhood.Insert(node_id);
+  }
+  return neighborhood;
+}
+
+// Appends the size of 'part' and 'part' to 'key', so that the keys of
+// different sequences of parts are different.
+void AppendKeyPart(const string& part, string* key) {
+  key->append(std::to_string(part.size()));
+  key->push_back(':');
+  key->append(part);
+}
+
+// Appends a key to 'key' that identifies the label of 'file'. Files with the
+// same key have the same label, and the key is cheaper to compute than the
+// label.
+void AppendFileKey(const File& file, string* key) {
+  if (file.has_directory()) {
+    key->push_back('D');
+    for (const string& dir : file.directory().path()) {
+      AppendKeyPart(dir, key);
+    }
+  }
+  if (file.has_filename()) {
+    key->push_back('F');
+    AppendKeyPart(file.filename(), key);
+  }
 }
 
 }  // namespace
 
-util::Status PlasoEventGraph::Initialize() {
-  // Create a non-unique node label of type tuple(timestamp, string) for events.
-  std::vector<AST> args;
-  args.emplace_back(type::MakeTimestamp(ast::kTimeTag, true));
-  args.emplace_back(type::MakeString(kDescTag, true));
-  type::Types node_types;
-  node_types.emplace(kEventTag, type::MakeTuple(kEventTag, false, args));
-  // Create a unique node label of type list(string) for files.
-  node_types.emplace(ast::kFileTag, type::MakeFile());
-  std::set<string> unique_nodes = {ast::kFileTag};
-  // Create a unique node label of type string for IP Addresses.
-  node_types.emplace(ast::kIPAddressTag, type::MakeIPAddress());
-  unique_nodes.insert(ast::kIPAddressTag);
-  // Create a unique node label of type string for URLs.
-  node_types.emplace(ast::kURLTag, type::MakeURL());
-  unique_nodes.insert(ast::kURLTag);
-  // Create an unlabelled edge.
-  type::Types edge_types;
-  edge_types.emplace(ast::kPrecedesTag, type::MakeNull(ast::kPrecedesTag));
-  edge_types.emplace(ast::kUsesTag, type::MakeNull(ast::kUsesTag));
-  std::set<string> unique_edges = {ast::kPrecedesTag, ast::kUsesTag};
+void PlasoEventGraph::SetTemporalEdges(TemporalEdges temporal_edges,
+                                       bool is_incremental) {
+  CHECK(!is_initialized_, kTemporalModeErr);
+  temporal_edges_ = temporal_edges;
+  is_incremental_ = is_incremental;
+}
+
+void PlasoEventGraph::SetWindow(int64_t window) {
+  CHECK(!is_initialized_, kWindowModeErr);
+  CHECK(window > 0 && is_incremental_, kWindowErr);
+  window_ = window;
+}
+
+util::Status PlasoEventGraph::InitializeGraph(LabeledGraph* graph) {
   // The graph is labelled by a string.
   AST graph_type = type::MakeString(kSystemTag, false);
-  // Initialize graph_ with the node types above but no edge label types.
-  util::Status s = graph_.Initialize(node_types, unique_nodes, edge_types,
-                                     unique_edges, graph_type);
+  return graph->Initialize(NodeLabels::Types(), NodeLabels::UniqueTags(),
+                           EdgeLabels::Types(), EdgeLabels::UniqueTags(),
+                           graph_type);
+}
+
+util::Status PlasoEventGraph::Initialize() {
+  util::Status s = InitializeGraph(graph_.get());
   if (s.ok()) {
+    uses_label_ = UsesLabel::Make(nullptr);
+    precedes_label_ = PrecedesLabel::Make(nullptr);
     is_initialized_ = true;
     return s;
   }
   return util::Status(Code::INTERNAL, s.message());
 }
 
+util::Status PlasoEventGraph::Save(const string& filename) const {
+  CHECK(is_initialized_, kInitializationErr);
+  return WriteGraphFile(*graph_, filename);
+}
+
+util::Status PlasoEventGraph::SaveDelta() {
+  CHECK(!graph_file_.empty(), kNotLoadedErr);
+  CHECK(window_ == 0, kWindowDeltaErr);
+  util::Status status = AppendGraphFile(*graph_, num_saved_nodes_,
+                                        num_saved_edges_, graph_file_);
+  if (status.ok()) {
+    num_saved_nodes_ = graph_->NumNodes();
+    num_saved_edges_ = graph_->NumEdges();
+  }
+  return status;
+}
+
+util::Status PlasoEventGraph::TakeDelta(size_t file_size, string* segment) {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(window_ == 0, kWindowDeltaErr);
+  util::Status status = MakeGraphSegment(*graph_, num_saved_nodes_,
+                                         num_saved_edges_, file_size, segment);
+  if (status.ok()) {
+    num_saved_nodes_ = graph_->NumNodes();
+    num_saved_edges_ = graph_->NumEdges();
+  }
+  return status;
+}
+
+// The time indexes are rebuilt from the labels of the events and from the
+// 'Uses' edges between events and files or URLs, which connect an event to
+// every file and URL that it uses. The timestamp of an event is read once for
+// each distinct label. The directories of files are rebuilt from the labels
+// of files. The caches of file and resource nodes start empty, and AddFile()
+// and AddResource() fill them with the nodes of the saved graph as new events
+// use them.
+util::Status PlasoEventGraph::Load(const string& filename) {
+  CHECK(!is_initialized_, kLoadErr);
+  util::Status status = ReadEventGraph(filename, graph_.get());
+  if (!status.ok()) {
+    return status;
+  }
+  IndexGraph();
+  graph_file_ = filename;
+  return util::Status::OK;
+}
+
+// Merging a shard into the graph finds the unique nodes of earlier shards by
+// their labels. A shard only lacks the temporal edges that a graph of all
+// events has between its first bucket and the bucket before it, and between
+// its first bucket and the bucket after it if that bucket is shared with the
+// shard before it, so only the edges of these buckets are added after the
+// shards have been indexed.
+util::Status PlasoEventGraph::Merge(const std::vector<string>& filenames) {
+  CHECK(!is_initialized_, kLoadErr);
+  if (filenames.empty()) {
+    return util::Status(Code::INVALID_ARGUMENT, kNoShardsErr);
+  }
+  util::Status status = ReadEventGraph(filenames[0], graph_.get());
+  if (!status.ok()) {
+    return status;
+  }
+  int64_t first_time = 0;
+  int64_t last_time = 0;
+  bool has_events = GetEventTimes(*graph_, &first_time, &last_time);
+  std::vector<int64_t> boundaries;
+  for (size_t i = 1; i < filenames.size(); ++i) {
+    LabeledGraph shard;
+    status = ReadEventGraph(filenames[i], &shard);
+    if (!status.ok()) {
+      return status;
+    }
+    int64_t shard_first = 0;
+    int64_t shard_last = 0;
+    if (GetEventTimes(shard, &shard_first, &shard_last)) {
+      if (has_events && shard_first < last_time) {
+        return util::Status(Code::INVALID_ARGUMENT,
+                            util::StrCat(kShardOrderErr, filenames[i]));
+      }
+      if (has_events) {
+        boundaries.push_back(shard_first);
+      }
+      has_events = true;
+      last_time = shard_last;
+    }
+    graph_->Merge(shard);
+  }
+  IndexGraph();
+  for (int64_t timestamp : boundaries) {
+    util::Span<TimedNode> bucket = time_index_.NodesAt(timestamp);
+    util::Span<TimedNode> earlier = time_index_.NodesBefore(timestamp);
+    if (!earlier.empty()) {
+      AddBucketEdges(earlier[0].timestamp, earlier, bucket);
+    }
+    AddBucketEdges(timestamp, bucket, time_index_.NodesAfter(timestamp));
+  }
+  num_saved_nodes_ = graph_->NumNodes();
+  num_saved_edges_ = graph_->NumEdges();
+  return util::Status::OK;
+}
+
+util::Status PlasoEventGraph::ReadEventGraph(const string& filename,
+                                             LabeledGraph* graph) const {
+  util::Status status = ReadGraphFile(filename, graph);
+  if (!status.ok()) {
+    return status;
+  }
+  if (!HasTypes(graph->GetNodeTypes(), NodeLabels::Types()) ||
+      !HasTypes(graph->GetEdgeTypes(), EdgeLabels::Types())) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kGraphFileTypeErr, filename));
+  }
+  return util::Status::OK;
+}
+
+void PlasoEventGraph::IndexGraph() {
+  uses_label_ = UsesLabel::Make(nullptr);
+  precedes_label_ = PrecedesLabel::Make(nullptr);
+  is_initialized_ = true;
+  has_temporal_edges_ = !is_incremental_;
+  num_saved_nodes_ = graph_->NumNodes();
+  num_saved_edges_ = graph_->NumEdges();
+  // The timestamp of each event label, or -1 for other labels and for events
+  // without a timestamp, and whether a label is that of a file or a URL.
+  const LabelId num_labels = graph_->NumDistinctLabels();
+  std::vector<int64_t> label_times(num_labels, -1);
+  std::vector<char> is_event(num_labels, 0);
+  std::vector<char> is_file(num_labels, 0);
+  std::vector<char> is_url(num_labels, 0);
+  for (LabelId label_id = 0; label_id < num_labels; ++label_id) {
+    const TaggedAST& label = graph_->GetLabel(label_id);
+    if (label.tag() == kEventTag) {
+      const AST& time = label.ast().c_ast().arg(0);
+      if (ast::IsTimestamp(time) && time.p_ast().has_val()) {
+        is_event[label_id] = 1;
+        label_times[label_id] = time.p_ast().val().time_val();
+      }
+    } else {
+      is_file[label_id] = label.tag() == ast::kFileTag;
+      is_url[label_id] = label.tag() == ast::kURLTag;
+    }
+  }
+  for (auto node_it = graph_->NodeSetBegin(); node_it != graph_->NodeSetEnd();
+       ++node_it) {
+    LabelId label_id = graph_->GetNodeLabelId(*node_it);
+    if (is_event[label_id] != 0) {
+      time_index_.Add(label_times[label_id], *node_it);
+    } else if (is_file[label_id] != 0) {
+      IndexDirectory(graph_->GetLabel(label_id).ast(), *node_it);
+    }
+  }
+  for (EdgeId edge_id : graph_->GetEdges(uses_label_)) {
+    LabelId source_label = graph_->GetNodeLabelId(graph_->Source(edge_id));
+    LabelId target_label = graph_->GetNodeLabelId(graph_->Target(edge_id));
+    NodeId event_id = graph_->Source(edge_id);
+    NodeId resource_id = graph_->Target(edge_id);
+    if (is_event[source_label] == 0) {
+      std::swap(source_label, target_label);
+      std::swap(event_id, resource_id);
+    }
+    if (is_event[source_label] == 0) {
+      continue;
+    }
+    if (is_file[target_label] != 0) {
+      file_index_.Add(label_times[source_label], resource_id);
+    } else if (is_url[target_label] != 0) {
+      url_index_.Add(label_times[source_label], resource_id);
+    }
+  }
+  time_index_.Sort();
+  file_index_.Sort();
+  url_index_.Sort();
+  if (!time_index_.Empty()) {
+    latest_time_ = time_index_.Entries()[time_index_.Size() - 1].timestamp;
+  }
+}
+
 int PlasoEventGraph::NumNodes() const {
   CHECK(is_initialized_, kInitializationErr);
-  return graph_.NumNodes();
+  return graph_->NumNodes();
 }
 
 int PlasoEventGraph::NumLabeledNodes(const TaggedAST& label) const {
   CHECK(is_initialized_, kInitializationErr);
-  return graph_.NumLabeledNodes(label);
+  return graph_->NumLabeledNodes(label);
 }
 
 int PlasoEventGraph::NumEdges() const {
   CHECK(is_initialized_, kInitializationErr);
-  return graph_.NumEdges();
+  return graph_->NumEdges();
 }
 
 int PlasoEventGraph::NumLabeledEdges(const TaggedAST& label) const {
   CHECK(is_initialized_, kInitializationErr);
-  return graph_.NumLabeledEdges(label);
+  return graph_->NumLabeledEdges(label);
+}
+
+// The characters of a key of a cache are counted if they are too many to be
+// stored in the string object itself, which is what an empty string holds.
+util::MemoryBreakdown PlasoEventGraph::MemoryUsage() const {
+  CHECK(is_initialized_, kInitializationErr);
+  util::MemoryBreakdown usage;
+  util::AddMemoryBreakdown("graph", graph_->MemoryUsage(), &usage);
+  usage["time_index"] = time_index_.MemoryBytes();
+  usage["file_index"] = file_index_.MemoryBytes();
+  usage["url_index"] = url_index_.MemoryBytes();
+  const size_t inline_capacity = string().capacity();
+  auto key_bytes = [inline_capacity](const string& key) {
+    return key.capacity() > inline_capacity ? key.capacity() + 1 : 0;
+  };
+  size_t bytes = util::UnorderedMapBytes(file_nodes_);
+  for (const auto& file_node : file_nodes_) {
+    bytes += key_bytes(file_node.first);
+  }
+  usage["file_nodes"] = bytes;
+  bytes = util::UnorderedMapBytes(resource_nodes_);
+  for (const auto& tagged_nodes : resource_nodes_) {
+    bytes += util::UnorderedMapBytes(tagged_nodes.second);
+    for (const auto& resource_node : tagged_nodes.second) {
+      bytes += key_bytes(resource_node.first);
+    }
+  }
+  usage["resource_nodes"] = bytes;
+  bytes = util::VectorBytes(directory_files_);
+  for (const std::vector<NodeId>& files : directory_files_) {
+    bytes += util::VectorBytes(files);
+  }
+  usage["directory_files"] = bytes;
+  return usage;
 }
 
 string PlasoEventGraph::GetStats() const {
-  return util::StrCat("Number of Nodes : ", std::to_string(NumNodes()), "\n",
-                      "Number of Edges : ", std::to_string(NumEdges()), "\n");
+  util::MemoryBreakdown usage = MemoryUsage();
+  string stats =
+      util::StrCat("Number of Nodes : ", NumNodes(), "\n",
+                   "Number of Edges : ", NumEdges(), "\n");
+  stats += util::StrCat("Memory (bytes) : ", util::TotalBytes(usage), "\n");
+  for (const auto& component : usage) {
+    stats +=
+        util::StrCat("  ", component.first, " : ", component.second, "\n");
+  }
+  return stats;
 }
 
 void PlasoEventGraph::ProcessEvent(const PlasoEvent& event_data) {
@@ -140,24 +682,207 @@ void PlasoEventGraph::ProcessEvent(const PlasoEvent& event_data) {
   // See the documentation of AddTemporalEdges() in this file for the reason
   // behind the check for temporal edges.
   CHECK(!has_temporal_edges_, kTemporalEdgesErr);
-  AST timestamp =
-      (event_data.has_timestamp())
-          ? value::MakeTimestampFromUnixMicros(event_data.timestamp())
-          : value::MakeTimestampFromRFC3339("");
-  AST source = (event_data.has_desc()) ? value::MakeString(event_data.desc())
-                                       : value::MakeString("");
-  NodeId event_id = graph_.FindOrAddNode(MakeEventLabel(timestamp, source));
+  if (window_ > 0) {
+    if (!event_data.has_timestamp() ||
+        (!time_index_.Empty() &&
+         event_data.timestamp() < latest_time_ - window_)) {
+      return;
+    }
+    if (time_index_.Empty() || event_data.timestamp() > latest_time_) {
+      latest_time_ = event_data.timestamp();
+    }
+  }
+  // The labels of the event are constructed on an arena that is freed when the
+  // event has been added. The graph copies new labels out of the arena.
+  alignas(8) char arena_block[kEventArenaSize];
+  google::protobuf::Arena arena(arena_block, sizeof(arena_block));
+  // Event labels are typed by construction and are not type checked again.
+  TaggedAST* event = google::protobuf::Arena::CreateMessage<TaggedAST>(&arena);
+  EventLabel::Build(
+      EventLabel::Value(event_data.has_timestamp()
+                            ? boost::optional<int64_t>(event_data.timestamp())
+                            : boost::none,
+                        event_data.desc()),
+      event);
+  NodeId event_id = AddTypedNode(std::move(*event));
+  DCHECK(event_id >= 0, "");
   if (event_data.has_timestamp()) {
-    time_index_[event_data.timestamp()].insert(event_id);
+    if (is_incremental_) {
+      time_index_.Insert(event_data.timestamp(), event_id);
+      AddIncrementalEdges(event_id, event_data.timestamp());
+    } else {
+      time_index_.Add(event_data.timestamp(), event_id);
+    }
+  }
+  AddEventData(event_id, event_data, &arena);
+  // Nodes cannot be removed while a batch is loaded, so ProcessEvents()
+  // evicts events when the batch is complete.
+  if (window_ > 0 && loader_ == nullptr) {
+    const int64_t cutoff = latest_time_ - window_;
+    if (4 * time_index_.EntriesBefore(cutoff).size() >= time_index_.Size()) {
+      EvictEventsBefore(cutoff);
+    }
   }
-  CHECK(event_id >= 0, "");
-  AddEventData(event_id, event_data);
+}
+
+// The events are processed as by ProcessEvent, so node and edge ids are the
+// same, but they are added through a bulk loader, which defers indexing
+// non-unique labels until the batch is complete.
+void PlasoEventGraph::ProcessEvents(util::Span<PlasoEvent> events) {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(loader_ == nullptr, kBatchErr);
+  LabeledGraph::BulkLoader loader(graph_.get());
+  // Most events use one or two resources.
+  loader.Reserve(2 * events.size(), 2 * events.size());
+  loader_ = &loader;
+  for (const PlasoEvent& event_data : events) {
+    ProcessEvent(event_data);
+  }
+  loader_ = nullptr;
+  loader.Finish();
+  if (window_ > 0) {
+    const int64_t cutoff = latest_time_ - window_;
+    if (4 * time_index_.EntriesBefore(cutoff).size() >= time_index_.Size()) {
+      EvictEventsBefore(cutoff);
+    }
+  }
+}
+
+void PlasoEventGraph::EvictExpiredEvents() {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(window_ > 0, kNoWindowErr);
+  CHECK(loader_ == nullptr, kBatchErr);
+  EvictEventsBefore(latest_time_ - window_);
+  if (graph_->HasRemovedNodes()) {
+    RebuildGraph();
+  }
+}
+
+// Files and resources are only connected to events, so the candidates for
+// collection are the neighbours of the evicted events that are neither events
+// nor TimeBucket nodes, and a candidate is unused once the evicted events have
+// been removed if it has no edges left. The caches are then swept for removed
+// nodes, which takes time linear in their size, as does removing the edges of
+// evicted events from the index of their label. Since a quarter of the events
+// are evicted at once, eviction takes constant amortized time per event.
+void PlasoEventGraph::EvictEventsBefore(int64_t cutoff) {
+  util::Span<TimedNode> expired = time_index_.EntriesBefore(cutoff);
+  if (expired.empty()) {
+    return;
+  }
+  std::vector<NodeId> evicted;
+  std::vector<NodeId> candidates;
+  for (size_t i = 0; i < expired.size(); ++i) {
+    const NodeId event_id = expired[i].node_id;
+    evicted.push_back(event_id);
+    if (temporal_edges_ == TemporalEdges::HUB &&
+        (i == 0 || expired[i].timestamp != expired[i - 1].timestamp)) {
+      for (NodeId hub : graph_->GetNodes(
+               TimeBucketLabel::Make(expired[i].timestamp))) {
+        evicted.push_back(hub);
+      }
+    }
+    for (NodeId node_id : graph_->GetPredecessorRange(event_id)) {
+      candidates.push_back(node_id);
+    }
+    for (NodeId node_id : graph_->GetSuccessorRange(event_id)) {
+      candidates.push_back(node_id);
+    }
+  }
+  time_index_.RemoveBefore(cutoff);
+  file_index_.RemoveBefore(cutoff);
+  url_index_.RemoveBefore(cutoff);
+  graph_->RemoveNodes(evicted);
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+  std::vector<NodeId> unused;
+  for (NodeId node_id : candidates) {
+    if (!graph_->HasNode(node_id)) {
+      continue;
+    }
+    const string& tag = graph_->GetNodeLabel(node_id).tag();
+    if (tag != kEventTag && tag != kTimeBucketTag &&
+        graph_->InEdgeBegin(node_id) == graph_->InEdgeEnd(node_id) &&
+        graph_->OutEdgeBegin(node_id) == graph_->OutEdgeEnd(node_id)) {
+      unused.push_back(node_id);
+    }
+  }
+  if (!unused.empty()) {
+    graph_->RemoveNodes(unused);
+    for (auto file_it = file_nodes_.begin(); file_it != file_nodes_.end();) {
+      file_it = graph_->HasNode(file_it->second) ? std::next(file_it)
+                                                 : file_nodes_.erase(file_it);
+    }
+    for (auto& tag_nodes : resource_nodes_) {
+      std::unordered_map<string, NodeId>& nodes = tag_nodes.second;
+      for (auto node_it = nodes.begin(); node_it != nodes.end();) {
+        node_it = graph_->HasNode(node_it->second) ? std::next(node_it)
+                                                   : nodes.erase(node_it);
+      }
+    }
+    for (std::vector<NodeId>& files : directory_files_) {
+      files.erase(std::remove_if(files.begin(), files.end(),
+                                 [this](NodeId file_id) {
+                                   return !graph_->HasNode(file_id);
+                                 }),
+                  files.end());
+    }
+  }
+  if (graph_->NumNodeIds() - graph_->NumNodes() > graph_->NumNodes()) {
+    RebuildGraph();
+  }
+}
+
+// Merging the graph into an empty graph copies the nodes that remain in the
+// order of their ids, so the caches and indexes keep their order, and interns
+// only the labels of these nodes and their edges, which releases the labels
+// of evicted nodes. Compact() would keep these labels.
+void PlasoEventGraph::RebuildGraph() {
+  std::unique_ptr<LabeledGraph> graph(new LabeledGraph);
+  CHECK(InitializeGraph(graph.get()).ok(), kRebuildErr);
+  const std::vector<NodeId> node_map = graph->Merge(*graph_);
+  graph_ = std::move(graph);
+  for (auto& file_node : file_nodes_) {
+    file_node.second = node_map[file_node.second];
+  }
+  for (auto& tag_nodes : resource_nodes_) {
+    for (auto& resource_node : tag_nodes.second) {
+      resource_node.second = node_map[resource_node.second];
+    }
+  }
+  for (std::vector<NodeId>& files : directory_files_) {
+    for (NodeId& file_id : files) {
+      file_id = node_map[file_id];
+    }
+  }
+  time_index_.Renumber(node_map);
+  file_index_.Renumber(node_map);
+  url_index_.Renumber(node_map);
+}
+
+NodeId PlasoEventGraph::AddNode(TaggedAST&& label) {
+  return loader_ == nullptr ? graph_->FindOrAddNode(std::move(label))
+                            : loader_->AddNode(std::move(label));
+}
+
+NodeId PlasoEventGraph::AddTypedNode(TaggedAST&& label) {
+  return loader_ == nullptr ? graph_->FindOrAddTypedNode(std::move(label))
+                            : loader_->AddTypedNode(std::move(label));
+}
+
+EdgeId PlasoEventGraph::AddEdge(NodeId source, NodeId target,
+                                const TaggedAST& label) {
+  return loader_ == nullptr ? graph_->FindOrAddEdge(source, target, label)
+                            : loader_->AddEdge(source, target, label);
 }
 
 // A PlasoEventGraph uses edges to represent temporal relationships. This allows
 // questions about the relationship between events in time and time-based
-// manipulation to be reduced to graph algorithms. For instance, finding all
-// events between two timestamps can be implemented using breadth first search.
+// manipulation to be reduced to graph algorithms. For instance, the events
+// that can lead to an event are the events from which it is reachable. Queries
+// about time windows do not need temporal edges and are answered from the time
+// indexes by GetEventsBetween(), GetFilesBetween() and GetURLsBetween().
 // To prevent the number of edges in the graph from exploding, only edges
 // between events that immediately follow each other (meaning there are no other
 // events in between) are added to the graph. To maintain this property,
@@ -178,115 +903,749 @@ void PlasoEventGraph::ProcessEvent(const PlasoEvent& event_data) {
 //   This graph now contains the edge (e1, e4), which is unnecessary. If
 //   AddTemporalEdges can be called multiple times, edges would have to be
 //   deleted from the graph and the implementation would be more complicated.
+//
+// Incremental temporal edges avoid this problem when events arrive in order,
+// which is the case for the output of Plaso's psort. An event that arrives out
+// of order and has a new timestamp between two existing timestamps leaves the
+// unnecessary edges between the events at those timestamps in the graph.
 void PlasoEventGraph::AddTemporalEdges() {
+  util::ScopedSpan span("AddTemporalEdges");
   CHECK(is_initialized_, kInitializationErr);
   CHECK(!has_temporal_edges_, kTemporalEdgesErr);
-  // There must be at least two different timestamps to add temporal edges,
-  // hence the check below.
-  if (time_index_.size() < 2) {
+  if (is_incremental_) {
     return;
   }
-  auto current_time_it = time_index_.begin();
-  auto next_time_it = time_index_.begin();
-  ++next_time_it;
-  TaggedAST edge_label;
-  edge_label.set_tag(ast::kPrecedesTag);
-  *edge_label.mutable_ast() = value::MakeNull();
-  while (next_time_it != time_index_.end()) {
-    for (NodeId current_node : current_time_it->second) {
-      for (NodeId next_node : next_time_it->second) {
-        graph_.FindOrAddEdge(current_node, next_node, edge_label);
+  has_temporal_edges_ = true;
+  time_index_.Sort();
+  file_index_.Sort();
+  url_index_.Sort();
+  if (time_index_.Empty()) {
+    return;
+  }
+  // Each bucket is connected to the next. In the HUB representation, the events
+  // in the last bucket are also connected to their hub.
+  util::Span<TimedNode> bucket =
+      time_index_.NodesAt(time_index_.Entries()[0].timestamp);
+  while (!bucket.empty()) {
+    const int64_t timestamp = bucket[0].timestamp;
+    util::Span<TimedNode> next_bucket = time_index_.NodesAfter(timestamp);
+    AddBucketEdges(timestamp, bucket, next_bucket);
+    bucket = next_bucket;
+  }
+}
+
+NodeId PlasoEventGraph::FindOrAddHub(int64_t timestamp) {
+  return AddTypedNode(TimeBucketLabel::Make(timestamp));
+}
+
+void PlasoEventGraph::AddBucketEdges(int64_t timestamp,
+                                     util::Span<TimedNode> earlier,
+                                     util::Span<TimedNode> later) {
+  if (temporal_edges_ == TemporalEdges::IMPLICIT) {
+    return;
+  }
+  if (temporal_edges_ == TemporalEdges::CLIQUE) {
+    for (const TimedNode& current : earlier) {
+      for (const TimedNode& next : later) {
+        AddEdge(current.node_id, next.node_id, precedes_label_);
       }
     }
-    ++current_time_it;
-    ++next_time_it;
+    return;
+  }
+  NodeId hub = FindOrAddHub(timestamp);
+  for (const TimedNode& current : earlier) {
+    AddEdge(current.node_id, hub, precedes_label_);
+  }
+  for (const TimedNode& next : later) {
+    AddEdge(hub, next.node_id, precedes_label_);
   }
 }
 
-void PlasoEventGraph::AddFile(NodeId node_id, const File& file,
-                              bool is_source) {
-  // Create a node for the file.
-  TaggedAST label;
-  label.set_tag(ast::kFileTag);
-  *label.mutable_ast() = plaso::ToAST(file);
-  NodeId file_id = graph_.FindOrAddNode(label);
+// The buckets of the timestamps before and after the timestamp of the event are
+// its neighbours in 'time_index_'. An event that joins an existing bucket only
+// needs edges to and from the events in the neighbouring buckets, or in the
+// HUB representation, to its own hub and from the hub of the earlier bucket.
+// The edges from a hub to the events in the later bucket exist unless the
+// bucket is new.
+void PlasoEventGraph::AddIncrementalEdges(NodeId event_id, int64_t timestamp) {
+  if (temporal_edges_ == TemporalEdges::IMPLICIT) {
+    return;
+  }
+  util::Span<TimedNode> earlier = time_index_.NodesBefore(timestamp);
+  util::Span<TimedNode> later = time_index_.NodesAfter(timestamp);
+  if (temporal_edges_ == TemporalEdges::CLIQUE) {
+    for (const TimedNode& earlier_node : earlier) {
+      AddEdge(earlier_node.node_id, event_id, precedes_label_);
+    }
+    for (const TimedNode& later_node : later) {
+      AddEdge(event_id, later_node.node_id, precedes_label_);
+    }
+    return;
+  }
+  NodeId hub = FindOrAddHub(timestamp);
+  AddEdge(event_id, hub, precedes_label_);
+  if (!earlier.empty()) {
+    AddEdge(FindOrAddHub(earlier[0].timestamp), event_id, precedes_label_);
+  }
+  const bool is_new_bucket = time_index_.NodesAt(timestamp).size() == 1;
+  if (is_new_bucket) {
+    for (const TimedNode& later_node : later) {
+      AddEdge(hub, later_node.node_id, precedes_label_);
+    }
+  }
+}
+
+std::vector<NodeId> PlasoEventGraph::GetEventsBetween(int64_t first,
+                                                      int64_t last) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(time_index_.IsSorted(), kTimeIndexErr);
+  std::vector<NodeId> events;
+  for (const TimedNode& entry : time_index_.NodesBetween(first, last)) {
+    events.push_back(entry.node_id);
+  }
+  return events;
+}
+
+std::vector<NodeId> PlasoEventGraph::GetNextEvents(NodeId event_id) const {
+  return GetAdjacentEvents(event_id, true /*Later events.*/);
+}
+
+std::vector<NodeId> PlasoEventGraph::GetPreviousEvents(NodeId event_id) const {
+  return GetAdjacentEvents(event_id, false /*Earlier events.*/);
+}
+
+std::vector<NodeId> PlasoEventGraph::GetAdjacentEvents(NodeId event_id,
+                                                       bool is_next) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(time_index_.IsSorted(), kTimeIndexErr);
+  const TaggedAST& label = graph_->GetNodeLabel(event_id);
+  CHECK(label.tag() == kEventTag, kNotEventErr);
+  std::vector<NodeId> events;
+  AppendAdjacentEvents(*graph_, time_index_, event_id, is_next, &events);
+  return events;
+}
+
+NodeId PlasoEventGraph::AddFile(NodeId node_id, const File& file,
+                                bool is_source,
+                                google::protobuf::Arena* arena) {
+  // Find the node of the file in the cache, or create a node for the file.
+  file_key_.clear();
+  AppendFileKey(file, &file_key_);
+  auto cached = file_nodes_.find(file_key_);
+  NodeId file_id;
+  if (cached != file_nodes_.end()) {
+    file_id = cached->second;
+  } else {
+    TaggedAST* label =
+        google::protobuf::Arena::CreateMessage<TaggedAST>(arena);
+    label->set_tag(ast::kFileTag);
+    label->mutable_ast()->Swap(plaso::ToAST(file, arena));
+    // The file is not in the cache but may be in a loaded graph, whose files
+    // are already in their directories.
+    const NodeId num_node_ids = graph_->NumNodeIds();
+    file_id = AddNode(std::move(*label));
+    file_nodes_.emplace(file_key_, file_id);
+    if (file.has_directory() && file_id >= num_node_ids) {
+      AddToDirectory(directories_.FindOrAdd(file.directory()), file_id);
+    }
+  }
   // Create an edge between the event and the file.
-  TaggedAST edge_label;
-  edge_label.set_tag(ast::kUsesTag);
-  *edge_label.mutable_ast() = value::MakeNull();
   if (is_source) {
-    graph_.FindOrAddEdge(file_id, node_id, edge_label);
+    AddEdge(file_id, node_id, uses_label_);
   } else {
-    graph_.FindOrAddEdge(node_id, file_id, edge_label);
+    AddEdge(node_id, file_id, uses_label_);
+  }
+  return file_id;
+}
+
+void PlasoEventGraph::AddToDirectory(int dir_id, NodeId file_id) {
+  if (dir_id >= static_cast<int>(directory_files_.size())) {
+    directory_files_.resize(directories_.NumDirectories());
   }
+  directory_files_[dir_id].push_back(file_id);
 }
 
-void PlasoEventGraph::AddResource(NodeId node_id, const string& tag,
-                                  const string& resource, bool is_source) {
-  // Create a node for the resource.
-  TaggedAST label;
-  label.set_tag(tag);
-  *label.mutable_ast() = value::MakeString(resource);
-  NodeId resource_id = graph_.FindOrAddNode(label);
+// The directory of a file label is a list of path components, which is empty
+// both for files without a directory and for files in the root directory.
+// Neither is added to a directory, as with files without a directory in
+// AddFile().
+void PlasoEventGraph::IndexDirectory(const AST& file, NodeId file_id) {
+  if (!file.has_c_ast() || file.c_ast().arg_size() == 0 ||
+      !file.c_ast().arg(0).has_c_ast() ||
+      file.c_ast().arg(0).c_ast().arg_size() == 0) {
+    return;
+  }
+  int dir_id = plaso::DirectoryTrie::kRoot;
+  for (const AST& component : file.c_ast().arg(0).c_ast().arg()) {
+    dir_id = directories_.FindOrAddChild(dir_id,
+                                         component.p_ast().val().string_val());
+  }
+  AddToDirectory(dir_id, file_id);
+}
+
+std::vector<NodeId> PlasoEventGraph::GetFilesUnder(const string& path) const {
+  CHECK(is_initialized_, kInitializationErr);
+  std::vector<NodeId> files;
+  const bool has_delim = !path.empty() && path.back() == '/';
+  const int dir_id = directories_.Find(
+      plaso::ParseFilename(has_delim ? path : path + "/").directory());
+  if (dir_id == plaso::DirectoryTrie::kNotFound) {
+    return files;
+  }
+  std::vector<int> dirs;
+  directories_.CollectSubtree(dir_id, &dirs);
+  for (int dir : dirs) {
+    if (dir < static_cast<int>(directory_files_.size())) {
+      files.insert(files.end(), directory_files_[dir].begin(),
+                   directory_files_[dir].end());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+// Events are numbered by block in the order of the time index, in which the
+// events of an interval are contiguous, and the other nodes are numbered after
+// them. The labels of the blocks are computed during the scan, so the label
+// function only looks them up.
+std::unique_ptr<LabeledGraph> PlasoEventGraph::CoarsenByTime(
+    int64_t granularity) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(granularity > 0, kGranularityErr);
+  std::unique_ptr<LabeledGraph> materialized;
+  std::unique_ptr<LabeledGraphView> whole_graph;
+  std::vector<NodeId> node_map;
+  const LabeledGraphView* view =
+      OutputView(&materialized, &whole_graph, &node_map);
+  if (view == nullptr) {
+    whole_graph.reset(new LabeledGraphView(*graph_));
+    view = whole_graph.get();
+  }
+  const NodeId num_node_ids = static_cast<NodeId>(view->NumNodeIds());
+  std::vector<int> partition(num_node_ids, -1);
+  std::vector<TaggedAST> block_labels;
+  TimeIndex sorted_index;
+  util::Span<TimedNode> entries = SortedTimeIndex(&sorted_index).Entries();
+  int64_t interval = 0;
+  int64_t start = 0;
+  int64_t end = 0;
+  int count = 0;
+  for (const TimedNode& entry : entries) {
+    const NodeId node_id =
+        node_map.empty() ? entry.node_id : node_map[entry.node_id];
+    if (!view->HasNode(node_id)) {
+      continue;
+    }
+    const int64_t entry_interval =
+        IntervalStart(entry.timestamp, granularity);
+    if (count > 0 && entry_interval != interval) {
+      block_labels.push_back(EventBlockLabel::Make(
+          EventBlockLabel::Value(start, end, count)));
+      count = 0;
+    }
+    if (count == 0) {
+      interval = entry_interval;
+      start = entry.timestamp;
+    }
+    end = entry.timestamp;
+    ++count;
+    partition[node_id] = static_cast<int>(block_labels.size());
+  }
+  if (count > 0) {
+    block_labels.push_back(
+        EventBlockLabel::Make(EventBlockLabel::Value(start, end, count)));
+  }
+  const int num_blocks = static_cast<int>(block_labels.size());
+  int next_block = num_blocks;
+  for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+    if (partition[node_id] < 0) {
+      partition[node_id] = view->HasNode(node_id) ? next_block++ : 0;
+    }
+  }
+
+  type::Types node_types = NodeLabels::Types();
+  node_types.emplace(EventBlockLabel::Tag(), EventBlockLabel::Type());
+  LabeledGraph output_type;
+  util::Status status = output_type.Initialize(
+      node_types, NodeLabels::UniqueTags(), EdgeLabels::Types(),
+      EdgeLabels::UniqueTags(), type::MakeString(kSystemTag, false));
+  CHECK(status.ok(), kCoarseTypeErr);
+  graph::NodeSpanLabelFn node_label_fn =
+      [&partition, &block_labels, num_blocks](const LabeledGraph& graph,
+                                              util::Span<NodeId> nodes) {
+        const int block = partition[nodes[0]];
+        return block < num_blocks ? block_labels[block]
+                                  : graph.GetNodeLabel(nodes[0]);
+      };
+  // The edge labels of an event graph have no values, so labels with the same
+  // tag are equal.
+  graph::EdgeSpanLabelFn edge_label_fn = [](const LabeledGraph& graph,
+                                            util::Span<EdgeId> edges) {
+    std::vector<TaggedAST> labels;
+    for (EdgeId edge_id : edges) {
+      const TaggedAST& label = graph.GetEdgeLabel(edge_id);
+      if (std::none_of(labels.begin(), labels.end(),
+                       [&label](const TaggedAST& other) {
+                         return other.tag() == label.tag();
+                       })) {
+        labels.push_back(label);
+      }
+    }
+    return labels;
+  };
+  graph::QuotientConfig config(output_type, node_label_fn, edge_label_fn,
+                               false /*No self-edges*/);
+  return graph::QuotientGraph(*view, partition, config);
+}
+
+std::unique_ptr<graph::Morphism> PlasoEventGraph::SampleEvents(
+    int64_t granularity, int events_per_interval, uint64_t seed) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(granularity > 0, kGranularityErr);
+  CHECK(events_per_interval > 0, kSampleSizeErr);
+  TimeIndex sorted_index;
+  util::Span<TimedNode> entries = SortedTimeIndex(&sorted_index).Entries();
+  std::mt19937_64 generator(seed);
+  std::vector<NodeId> nodes;
+  util::Span<TimedNode>::const_iterator begin = entries.begin();
+  while (begin != entries.end()) {
+    // The events of the interval of 'begin' are those before the first entry
+    // of the next interval.
+    const int64_t interval = IntervalStart(begin->timestamp, granularity);
+    util::Span<TimedNode>::const_iterator end = entries.end();
+    if (interval <= std::numeric_limits<int64_t>::max() - granularity) {
+      end = std::lower_bound(begin, entries.end(), interval + granularity,
+                             [](const TimedNode& entry, int64_t timestamp) {
+                               return entry.timestamp < timestamp;
+                             });
+    }
+    for (size_t index :
+         graph::SampleIndices(end - begin, events_per_interval, &generator)) {
+      const NodeId event_id = begin[index].node_id;
+      if (graph_->HasNode(event_id)) {
+        nodes.push_back(event_id);
+      }
+    }
+    begin = end;
+  }
+  // The resources of the events, which are their neighbors that are neither
+  // events nor time buckets, are appended after the events.
+  const size_t num_events = nodes.size();
+  std::unordered_set<NodeId> resources;
+  auto add_resource = [this, &nodes, &resources](NodeId neighbor) {
+    const string& tag = graph_->GetNodeLabel(neighbor).tag();
+    if (tag != kEventTag && tag != kTimeBucketTag &&
+        resources.insert(neighbor).second) {
+      nodes.push_back(neighbor);
+    }
+  };
+  for (size_t i = 0; i < num_events; ++i) {
+    for (NodeId neighbor : graph_->GetPredecessorRange(nodes[i])) {
+      add_resource(neighbor);
+    }
+    for (NodeId neighbor : graph_->GetSuccessorRange(nodes[i])) {
+      add_resource(neighbor);
+    }
+  }
+  return graph::InducedSubgraph(*graph_, nodes);
+}
+
+NodeId PlasoEventGraph::AddResource(NodeId node_id, const string& tag,
+                                    const string& resource, bool is_source,
+                                    google::protobuf::Arena* arena) {
+  // Find the node of the resource in the cache, or create a node for the
+  // resource.
+  std::unordered_map<string, NodeId>& tag_nodes = resource_nodes_[tag];
+  auto cached = tag_nodes.find(resource);
+  NodeId resource_id;
+  if (cached != tag_nodes.end()) {
+    resource_id = cached->second;
+  } else {
+    TaggedAST* label =
+        google::protobuf::Arena::CreateMessage<TaggedAST>(arena);
+    label->set_tag(tag);
+    label->mutable_ast()->Swap(value::MakeString(resource, arena));
+    resource_id = AddNode(std::move(*label));
+    tag_nodes.emplace(resource, resource_id);
+  }
   // Create an edge between the event and the file.
-  TaggedAST edge_label;
-  edge_label.set_tag(ast::kUsesTag);
-  *edge_label.mutable_ast() = value::MakeNull();
   if (is_source) {
-    graph_.FindOrAddEdge(node_id, resource_id, edge_label);
+    AddEdge(node_id, resource_id, uses_label_);
   } else {
-    graph_.FindOrAddEdge(resource_id, node_id, edge_label);
+    AddEdge(resource_id, node_id, uses_label_);
   }
+  return resource_id;
 }
 
 void PlasoEventGraph::AddEventData(NodeId node_id,
-                                   const PlasoEvent& event_data) {
+                                   const PlasoEvent& event_data,
+                                   google::protobuf::Arena* arena) {
+  // The files and URLs used by the event, which are indexed by the timestamp
+  // of the event.
+  std::vector<NodeId> files;
+  std::vector<NodeId> urls;
   if (has_all_sources_ && event_data.has_event_source_file()) {
-    AddFile(node_id, event_data.event_source_file(),
-            true /*The file is a source.*/);
+    files.push_back(AddFile(node_id, event_data.event_source_file(),
+                            true /*The file is a source.*/, arena));
   }
   if (event_data.has_source_file()) {
-    AddFile(node_id, event_data.source_file(), true /*The file is a source.*/);
+    files.push_back(AddFile(node_id, event_data.source_file(),
+                            true /*The file is a source.*/, arena));
   }
   if (event_data.has_target_file()) {
-    AddFile(node_id, event_data.target_file(), false /*The file is a target.*/);
+    files.push_back(AddFile(node_id, event_data.target_file(),
+                            false /*The file is a target.*/, arena));
   }
   if (event_data.has_source_url()) {
-    AddResource(node_id, ast::kURLTag, event_data.source_url(),
-                true /*The URL is a source.*/);
+    urls.push_back(AddResource(node_id, ast::kURLTag, event_data.source_url(),
+                               true /*The URL is a source.*/, arena));
   }
   if (event_data.has_target_url()) {
-    AddResource(node_id, ast::kURLTag, event_data.target_url(),
-                true /*The URL is a target.*/);
+    urls.push_back(AddResource(node_id, ast::kURLTag, event_data.target_url(),
+                               true /*The URL is a target.*/, arena));
+  }
+  if (event_data.has_timestamp()) {
+    IndexResources(event_data.timestamp(), files, &file_index_);
+    IndexResources(event_data.timestamp(), urls, &url_index_);
+  }
+}
+
+void PlasoEventGraph::IndexResources(int64_t timestamp,
+                                     const std::vector<NodeId>& resources,
+                                     TimeIndex* index) {
+  for (NodeId resource_id : resources) {
+    if (is_incremental_) {
+      index->Insert(timestamp, resource_id);
+    } else {
+      index->Add(timestamp, resource_id);
+    }
   }
 }
 
-TaggedAST PlasoEventGraph::MakeEventLabel(const AST& timestamp,
-                                          const AST& source) {
-  AST event_ast = value::MakeNullTuple(2);
-  std::pair<bool, AST> result = graph_.GetNodeType(kEventTag);
-  CHECK(result.first, kGraphTypeErr);
-  value::SetField(result.second, 0, timestamp, &event_ast);
-  value::SetField(result.second, 1, source, &event_ast);
-  TaggedAST event;
-  *event.mutable_ast() = event_ast;
-  event.set_tag(kEventTag);
-  return event;
+std::vector<NodeId> PlasoEventGraph::GetResourcesBetween(
+    const TimeIndex& index, int64_t first, int64_t last) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(index.IsSorted(), kTimeIndexErr);
+  std::vector<NodeId> resources;
+  for (const TimedNode& entry : index.NodesBetween(first, last)) {
+    resources.push_back(entry.node_id);
+  }
+  std::sort(resources.begin(), resources.end());
+  resources.erase(std::unique(resources.begin(), resources.end()),
+                  resources.end());
+  return resources;
+}
+
+std::vector<NodeId> PlasoEventGraph::GetFilesBetween(int64_t first,
+                                                     int64_t last) const {
+  return GetResourcesBetween(file_index_, first, last);
+}
+
+std::vector<NodeId> PlasoEventGraph::GetURLsBetween(int64_t first,
+                                                    int64_t last) const {
+  return GetResourcesBetween(url_index_, first, last);
+}
+
+util::Status PlasoEventGraph::RestrictOutput(
+    const std::vector<TaggedAST>& labels, const std::set<string>& tags,
+    int max_hops, int max_nodes, int num_threads) {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(loader_ == nullptr, kBatchErr);
+  if (max_hops < 0 || max_nodes < 0) {
+    return util::Status(Code::INVALID_ARGUMENT, kNeighborhoodSizeErr);
+  }
+  std::vector<NodeId> seeds = FindNodes(*graph_, labels, tags);
+  if (seeds.empty()) {
+    return util::Status(Code::INVALID_ARGUMENT, kNoSeedsErr);
+  }
+  // In the IMPLICIT representation, the search finds temporal edges in the
+  // time index.
+  if (temporal_edges_ == TemporalEdges::IMPLICIT) {
+    TimeIndex sorted_index;
+    NodeSet neighborhood =
+        ImplicitNeighborhood(*graph_, SortedTimeIndex(&sorted_index), seeds,
+                             max_hops, max_nodes);
+    output_view_.reset(new LabeledGraphView(*graph_));
+    HideNodesNotIn(neighborhood, output_view_.get());
+    return util::Status::OK;
+  }
+  GraphTraversal traversal(*graph_, num_threads);
+  NodeSet neighborhood = traversal.Neighborhood(
+      seeds, max_hops, max_nodes, TraversalDirection::kBoth);
+  output_view_.reset(new LabeledGraphView(*graph_));
+  HideNodesNotIn(neighborhood, output_view_.get());
+  return util::Status::OK;
+}
+
+void PlasoEventGraph::SetMaxOutputNodes(int max_nodes, int num_threads) {
+  CHECK(max_nodes > 0 && num_threads > 0, kSummarySizeErr);
+  max_output_nodes_ = max_nodes;
+  summary_threads_ = num_threads;
+}
+
+void PlasoEventGraph::SetTimelineGranularity(int64_t granularity) {
+  CHECK(granularity > 0, kGranularityErr);
+  timeline_granularity_ = granularity;
+}
+
+void PlasoEventGraph::ClearOutputOptions() {
+  output_view_.reset();
+  max_output_nodes_ = 0;
+  summary_threads_ = 1;
+  timeline_granularity_ = 0;
+}
+
+std::unique_ptr<LabeledGraph> PlasoEventGraph::OutputSummary() const {
+  const int num_output_nodes = output_view_ != nullptr
+                                   ? output_view_->NumNodes()
+                                   : graph_->NumNodes();
+  if (max_output_nodes_ == 0 || num_output_nodes <= max_output_nodes_) {
+    return nullptr;
+  }
+  std::unique_ptr<LabeledGraph> materialized;
+  std::unique_ptr<LabeledGraphView> whole_graph;
+  std::vector<NodeId> node_map;
+  const LabeledGraphView* view =
+      OutputView(&materialized, &whole_graph, &node_map);
+  if (view == nullptr) {
+    whole_graph.reset(new LabeledGraphView(*graph_));
+    view = whole_graph.get();
+  }
+  graph::SummaryConfig config(max_output_nodes_);
+  config.num_threads = summary_threads_;
+  return std::move(graph::SummarizeGraph(*view, config).graph);
+}
+
+// Merging the graph into an empty graph copies it in time linear in its size,
+// as in RebuildGraph(), and the temporal edges are added in one pass over the
+// time index. The copy only lives while an output is written.
+std::unique_ptr<LabeledGraph> PlasoEventGraph::MaterializeTemporalEdges(
+    std::vector<NodeId>* node_map) const {
+  std::unique_ptr<LabeledGraph> graph(new LabeledGraph);
+  CHECK(InitializeGraph(graph.get()).ok(), kCopyErr);
+  *node_map = graph->Merge(*graph_);
+  TimeIndex sorted_index;
+  LabeledGraph::BulkLoader loader(graph.get());
+  ForEachTemporalEdge(SortedTimeIndex(&sorted_index),
+                      [this, node_map, &loader](NodeId source, NodeId target) {
+                        loader.AddEdge((*node_map)[source], (*node_map)[target],
+                                       precedes_label_);
+                      });
+  loader.Finish();
+  return graph;
+}
+
+// The view of the copy hides the nodes hidden by 'output_view_', so the
+// temporal edges between the events that are output are those of a view of a
+// graph with CLIQUE edges.
+const LabeledGraphView* PlasoEventGraph::OutputView(
+    std::unique_ptr<LabeledGraph>* materialized,
+    std::unique_ptr<LabeledGraphView>* owned_view,
+    std::vector<NodeId>* node_map) const {
+  if (temporal_edges_ != TemporalEdges::IMPLICIT) {
+    return output_view_.get();
+  }
+  *materialized = MaterializeTemporalEdges(node_map);
+  owned_view->reset(new LabeledGraphView(**materialized));
+  if (output_view_ != nullptr) {
+    for (NodeId node_id = 0; node_id < node_map->size(); ++node_id) {
+      if ((*node_map)[node_id] != LabeledGraph::kRemovedNode &&
+          !output_view_->HasNode(node_id)) {
+        (*owned_view)->HideNode((*node_map)[node_id]);
+      }
+    }
+  }
+  return owned_view->get();
+}
+
+void PlasoEventGraph::AddImplicitEdges(TimeIndex* sorted_index,
+                                       viz::GraphExporter* exporter) const {
+  if (temporal_edges_ != TemporalEdges::IMPLICIT) {
+    return;
+  }
+  const TimeIndex& index = SortedTimeIndex(sorted_index);
+  const LabeledGraph& graph = *graph_;
+  exporter->SetVirtualEdges(
+      [&graph, &index](NodeId node_id, std::vector<NodeId>* nodes) {
+        AppendAdjacentEvents(graph, index, node_id, false, nodes);
+      },
+      [&graph, &index](NodeId node_id, std::vector<NodeId>* nodes) {
+        AppendAdjacentEvents(graph, index, node_id, true, nodes);
+      });
+}
+
+// The time index is only sorted once all events have been added, so the
+// output of a graph that is still being built is computed from a copy.
+const TimeIndex& PlasoEventGraph::SortedTimeIndex(
+    TimeIndex* sorted_index) const {
+  if (time_index_.IsSorted()) {
+    return time_index_;
+  }
+  *sorted_index = time_index_;
+  sorted_index->Sort();
+  return *sorted_index;
 }
 
 string PlasoEventGraph::ToDot() const {
+  std::ostringstream dot_graph;
+  WriteDot(&dot_graph);
+  return dot_graph.str();
+}
+
+// DotPrinter requires a graph without tombstones, so a graph from which
+// events have been evicted is written through a view, which skips them.
+// Implicit temporal edges are written from the time index after the stored
+// edges.
+void PlasoEventGraph::WriteDot(std::ostream* out) const {
   CHECK(is_initialized_, kInitializationErr);
   DotPrinter dot_printer;
-  string dot_graph = dot_printer.AllNodesInDot(graph_);
-  util::StrAppend(&dot_graph, GetTimeline(time_index_), "\n");
-  util::StrAppend(&dot_graph, dot_printer.AllEdgesInDot(graph_), "\n");
-  return util::StrCat("digraph logle_graph {\n", dot_graph, "}");
+  *out << "digraph logle_graph {\n";
+  std::unique_ptr<LabeledGraph> summary = OutputSummary();
+  if (summary != nullptr) {
+    dot_printer.WriteAllNodes(*summary, out);
+    *out << "\n";
+    dot_printer.WriteAllEdges(*summary, out);
+    *out << "\n}";
+    return;
+  }
+  std::unique_ptr<LabeledGraphView> whole_graph;
+  const LabeledGraphView* view = output_view_.get();
+  if (view == nullptr && graph_->HasRemovedNodes()) {
+    whole_graph.reset(new LabeledGraphView(*graph_));
+    view = whole_graph.get();
+  }
+  if (view == nullptr) {
+    dot_printer.WriteAllNodes(*graph_, out);
+  } else {
+    dot_printer.WriteAllNodes(*view, out);
+  }
+  TimeIndex sorted_index;
+  const TimeIndex& time_index = SortedTimeIndex(&sorted_index);
+  if (output_view_ == nullptr) {
+    WriteTimeline(time_index.Entries(), timeline_granularity_, out);
+  } else {
+    std::vector<TimedNode> entries;
+    for (const TimedNode& entry : time_index.Entries()) {
+      if (output_view_->HasNode(entry.node_id)) {
+        entries.push_back(entry);
+      }
+    }
+    WriteTimeline(entries, timeline_granularity_, out);
+  }
+  *out << "\n";
+  if (view == nullptr) {
+    dot_printer.WriteAllEdges(*graph_, out);
+  } else {
+    dot_printer.WriteAllEdges(*view, out);
+  }
+  if (temporal_edges_ == TemporalEdges::IMPLICIT) {
+    ForEachTemporalEdge(time_index, [this, view, &dot_printer, out](
+                                        NodeId source, NodeId target) {
+      if (view == nullptr || (view->HasNode(source) && view->HasNode(target))) {
+        dot_printer.WriteEdge(source, target, precedes_label_, out);
+      }
+    });
+  }
+  *out << "\n}";
 }
 
 string PlasoEventGraph::ToPbTxt() const {
+  std::ostringstream pbtxt;
+  WritePbTxt(&pbtxt);
+  return pbtxt.str();
+}
+
+void PlasoEventGraph::WritePbTxt(std::ostream* out) const {
+  CHECK(is_initialized_, kInitializationErr);
+  std::unique_ptr<LabeledGraph> summary = OutputSummary();
+  if (summary != nullptr) {
+    viz::GraphExporter exporter(*summary);
+    exporter.WriteGraphText(out);
+    return;
+  }
+  TimeIndex sorted_index;
+  if (output_view_ != nullptr) {
+    viz::GraphExporter exporter(*output_view_);
+    AddImplicitEdges(&sorted_index, &exporter);
+    exporter.WriteGraphText(out);
+    return;
+  }
+  viz::GraphExporter exporter(*graph_);
+  AddImplicitEdges(&sorted_index, &exporter);
+  exporter.WriteGraphText(out);
+}
+
+void PlasoEventGraph::WritePb(std::ostream* out) const {
   CHECK(is_initialized_, kInitializationErr);
-  viz::GraphExporter exporter(graph_);
-  return exporter.GraphAsString();
+  std::unique_ptr<LabeledGraph> summary = OutputSummary();
+  if (summary != nullptr) {
+    viz::GraphExporter exporter(*summary);
+    exporter.WriteGraph(out);
+    return;
+  }
+  TimeIndex sorted_index;
+  if (output_view_ != nullptr) {
+    viz::GraphExporter exporter(*output_view_);
+    AddImplicitEdges(&sorted_index, &exporter);
+    exporter.WriteGraph(out);
+    return;
+  }
+  viz::GraphExporter exporter(*graph_);
+  AddImplicitEdges(&sorted_index, &exporter);
+  exporter.WriteGraph(out);
+}
+
+graph_explorer::GraphManifest PlasoEventGraph::WritePbPages(
+    int page_size, const viz::PageWriter& write_page) const {
+  CHECK(is_initialized_, kInitializationErr);
+  std::unique_ptr<LabeledGraph> summary = OutputSummary();
+  if (summary != nullptr) {
+    viz::GraphExporter exporter(*summary);
+    return exporter.WritePages(page_size, page_size, write_page);
+  }
+  TimeIndex sorted_index;
+  if (output_view_ != nullptr) {
+    viz::GraphExporter exporter(*output_view_);
+    AddImplicitEdges(&sorted_index, &exporter);
+    return exporter.WritePages(page_size, page_size, write_page);
+  }
+  viz::GraphExporter exporter(*graph_);
+  AddImplicitEdges(&sorted_index, &exporter);
+  return exporter.WritePages(page_size, page_size, write_page);
+}
+
+void PlasoEventGraph::WriteEventTable(std::ostream* out) const {
+  CHECK(is_initialized_, kInitializationErr);
+  WriteNodeTable(*graph_, kEventTag, out);
+}
+
+void PlasoEventGraph::WriteResourceTable(std::ostream* out) const {
+  CHECK(is_initialized_, kInitializationErr);
+  WriteLabelTable(*graph_, {kEventTag, kTimeBucketTag}, out);
+}
+
+// Implicit temporal edges are written from the time index after the stored
+// edges, so the table has the rows of the CLIQUE edges without materializing
+// them.
+void PlasoEventGraph::WriteEdgeTable(std::ostream* out) const {
+  CHECK(is_initialized_, kInitializationErr);
+  morphie::WriteEdgeTable(*graph_, out);
+  if (temporal_edges_ != TemporalEdges::IMPLICIT) {
+    return;
+  }
+  TimeIndex sorted_index;
+  string buffer;
+  ForEachTemporalEdge(
+      SortedTimeIndex(&sorted_index),
+      [&buffer, out](NodeId source, NodeId target) {
+        util::StrAppend(&buffer, source, ",", target, ",", ast::kPrecedesTag,
+                        "\n");
+        if (buffer.size() >= kTableBufferSize) {
+          out->write(buffer.data(), buffer.size());
+          buffer.clear();
+        }
+      });
+  out->write(buffer.data(), buffer.size());
 }
 
 }  // namespace morphie
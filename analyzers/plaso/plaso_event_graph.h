@@ -28,15 +28,27 @@
 #define LOGLE_PLASO_EVENT_GRAPH_H_
 
 #include <cstdint>
+#include <memory>
+#include <ostream>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
+#include <google/protobuf/arena.h>
+
+#include "analyzers/plaso/directory_trie.h"
 #include "base/string.h"
+#include "graph/graph_exporter.h"
 #include "graph/graph_interface.h"
 #include "graph/labeled_graph.h"
+#include "graph/labeled_graph_view.h"
+#include "graph/morphism.h"
+#include "graph/time_index.h"
 #include "json/json.h"
 #include "plaso_event.pb.h"
 #include "ast.pb.h"
+#include "util/memory_usage.h"
+#include "util/span.h"
 #include "util/status.h"
 
 namespace morphie {
@@ -51,19 +63,84 @@ namespace morphie {
 //   - (Unique) URL : string
 //   - (Unique) IP Address : string
 //   - Event : tuple(Timestamp : timestamp, EventType: string)
+//   - (Unique) TimeBucket : timestamp
 // * The edge types are:
 //   - (Unique) Precedes : null
 //   - (Unique) Uses : null
 //
 // A filename is represented as a list of strings with every element of the list
 // representing the name of one sub-directory on the path. An edge label either
-// a 'Precedes' tag or a 'Uses' tag.
+// a 'Precedes' tag or a 'Uses' tag. TimeBucket nodes only occur in graphs with
+// the TemporalEdges::HUB representation described below.
 class PlasoEventGraph : public GraphInterface {
  public:
+  // The representations of the order between events with consecutive
+  // timestamps A and B.
+  // - CLIQUE: a 'Precedes' edge from every event at A to every event at B, so
+  //   there are |A|x|B| edges.
+  // - HUB: a 'TimeBucket' node for each timestamp, a 'Precedes' edge from
+  //   every event to the node of its timestamp, and a 'Precedes' edge from the
+  //   node of A to every event at B, so there are |A|+|B| edges. An event 'e'
+  //   precedes an event 'f' if there is a path of length two from 'e' to 'f'.
+  // - IMPLICIT: no 'Precedes' edges are stored, since the CLIQUE edges are
+  //   determined by the time index. GetNextEvents() and GetPreviousEvents()
+  //   answer temporal adjacency from the index. The outputs below contain the
+  //   CLIQUE edges, which are written from the index after the stored edges,
+  //   and RestrictOutput() follows them in the index. Only a summary of the
+  //   output and CoarsenByTime(), which compute quotients, copy the graph
+  //   with the CLIQUE edges materialized. NumEdges() and NumLabeledEdges()
+  //   count the stored edges only.
+  enum class TemporalEdges { CLIQUE, HUB, IMPLICIT };
+
   PlasoEventGraph(bool has_all_sources)
       : is_initialized_(false),
         has_temporal_edges_(false),
-        has_all_sources_(has_all_sources) {}
+        has_all_sources_(has_all_sources),
+        temporal_edges_(TemporalEdges::CLIQUE),
+        is_incremental_(false),
+        window_(0),
+        latest_time_(0),
+        graph_(new LabeledGraph),
+        max_output_nodes_(0),
+        summary_threads_(1),
+        timeline_granularity_(0),
+        loader_(nullptr),
+        num_saved_nodes_(0),
+        num_saved_edges_(0) {}
+
+  // Sets the representation of temporal edges and whether they are added by
+  // ProcessEvent as events arrive instead of by AddTemporalEdges. The default
+  // is the CLIQUE representation added by AddTemporalEdges.
+  //
+  // Incremental edges are the same as the edges added by AddTemporalEdges if
+  // every event either has the latest timestamp seen so far, has the earliest
+  // timestamp seen so far, or has the timestamp of an event that has already
+  // been added. An event with a new timestamp between two existing timestamps
+  // A and B is spliced between them by adding edges from A to the event and
+  // from the event to B. The graph is append-only, so the edges from A to B
+  // remain. They are implied by the new edges, so the events that precede an
+  // event in the transitive closure of 'Precedes' are the same in both modes.
+  // - Crashes if called after Initialize().
+  void SetTemporalEdges(TemporalEdges temporal_edges, bool is_incremental);
+  // Makes the graph keep only the events of a sliding window, which are the
+  // events whose timestamps are at most 'window' microseconds before the
+  // latest timestamp added, so that the graph of an unbounded stream of events
+  // fits in bounded memory. Events without a timestamp, and events that are
+  // outside the window when they arrive, are not added. Expired events are
+  // evicted in batches, when they are a quarter of the events in the graph,
+  // and the files, URLs and other resources that no remaining event uses are
+  // removed with them. Evicted nodes leave tombstones, as described in
+  // graph/labeled_graph.h, and the graph is rebuilt without tombstones and
+  // without the labels of evicted nodes once tombstones outnumber nodes, which
+  // changes node ids. A graph with a window cannot be saved as deltas.
+  // - Crashes if called after Initialize(), if 'window' is not positive or if
+  //   temporal edges are not incremental.
+  void SetWindow(int64_t window);
+  // Evicts every expired event, so that the graph holds exactly the events of
+  // the window, for instance before it is output, and rebuilds the graph if it
+  // has tombstones, which Save() rejects.
+  // - Requires that a window was set.
+  void EvictExpiredEvents();
 
   // Initialize the graph. This function must be called before all other
   // functions in this class. Returns
@@ -73,6 +150,59 @@ class PlasoEventGraph : public GraphInterface {
   //   Status::error_message() function of the Status object.
   util::Status Initialize();
 
+  // Writes the graph to 'filename' in the format of graph/graph_file.h. The
+  // output options, such as a neighborhood, do not apply, so the whole graph is
+  // written. Returns the status returned by WriteGraphFile.
+  util::Status Save(const string& filename) const;
+  // Initializes the graph with the graph in the file 'filename', which was
+  // written by Save(), instead of with Initialize(). The events, files and URLs
+  // are indexed by time, so the graph is output and queried as the graph that
+  // was saved. If temporal edges are incremental, events can be added to the
+  // graph, with the representation of temporal edges that was set, which
+  // should be that of the saved graph. Files and URLs of new events that are
+  // in the saved graph are found by their unique labels. Otherwise, the graph
+  // is complete: events cannot be added to it. Returns
+  // - Status::INVALID_ARGUMENT - if the file does not contain an event graph,
+  //   or the status returned by ReadGraphFile if that is not OK.
+  // - Status::OK - otherwise.
+  // - Crashes if the graph is initialized.
+  util::Status Load(const string& filename);
+  // Initializes the graph, instead of with Initialize(), with the union of
+  // the graphs in the graph files 'filenames', which are shards of one input
+  // built by workers that each read a part of the input, such as a time range
+  // or a byte range of the output of Plaso's psort, and wrote their graph with
+  // Save(). The events of a shard must not be earlier than the events of the
+  // shards before it, and the shards must have been built with the
+  // representation of temporal edges that was set. Events are distinct in
+  // every shard, while files, URLs and other unique nodes are shared by the
+  // shards that contain them. The temporal edges across the boundaries of
+  // shards are added to the temporal edges of the shards, which gives the
+  // temporal edges of a graph built from all events. The graph is indexed and
+  // can be extended as described for Load(). Takes time linear in the size of
+  // the shards. Returns
+  // - Status::INVALID_ARGUMENT - if 'filenames' is empty, if a file does not
+  //   contain an event graph, if a shard has an event that is earlier than an
+  //   event of a shard before it, or the status returned by ReadGraphFile if
+  //   that is not OK.
+  // - Status::OK - otherwise.
+  // - Crashes if the graph is initialized.
+  util::Status Merge(const std::vector<string>& filenames);
+  // Appends the nodes and edges added since the graph was loaded, or since
+  // this function was last called, to the file from which the graph was
+  // loaded, as a segment described in graph/graph_file.h. Takes time linear in
+  // the number of new nodes and edges. Returns the status returned by
+  // AppendGraphFile.
+  // - Crashes unless the graph was loaded by Load(), or if a window was set.
+  util::Status SaveDelta();
+  // Sets '*segment' to the nodes and edges added since the graph was
+  // initialized or loaded, or since the last delta was taken or saved, as a
+  // segment made by MakeGraphSegment for a graph file of 'file_size' bytes. A
+  // graph file that holds the graph as it was then holds the current graph
+  // once the segment is appended to it, which may be done while events are
+  // added. Returns the status returned by MakeGraphSegment.
+  // - Crashes if a window was set.
+  util::Status TakeDelta(size_t file_size, string* segment);
+
   // Functions for statistics about nodes and edges.
   // Statistics about nodes.
   int NumNodes() const;
@@ -80,17 +210,32 @@ class PlasoEventGraph : public GraphInterface {
   // Statistics about edges.
   int NumEdges() const;
   int NumLabeledEdges(const TaggedAST& label) const;
-  // Return graph statistics as a string.
+  // Returns an estimate of the bytes used by the event graph, as described in
+  // util/memory_usage.h. The components of the labelled graph are prefixed by
+  // "graph/", and the other components are "time_index", "file_index" and
+  // "url_index", the time indexes of events, files and URLs, "file_nodes" and
+  // "resource_nodes", the caches of nodes by name, and "directory_files", the
+  // file nodes of each directory.
+  util::MemoryBreakdown MemoryUsage() const;
+  // Return graph statistics as a string, which includes the memory used by
+  // each component of the graph.
   string GetStats() const;
 
   // Adds nodes and edges to the event graph using data from a PlasoEvent proto.
   void ProcessEvent(const PlasoEvent& event_data);
+  // Adds the events in 'events' in order, with the same result as calling
+  // ProcessEvent on each of them, and indexes the labels of the batch in one
+  // pass at the end. The label queries of the graph, such as
+  // NumLabeledNodes(), do not reflect the batch until this function returns.
+  void ProcessEvents(util::Span<PlasoEvent> events);
 
   // Adds an edge to the graph from each event 'e' to every event 'f' that
   // occurs after 'e' such that no events occurring between 'e' and 'f'. This
   // function can be called at most once and will crash if called multiple
   // times. No events can be added to the graph after this function is called.
-  // See the implementation notes for a discussion on why this is the case.
+  // See the implementation notes for a discussion on why this is the case. If
+  // temporal edges are incremental, they have already been added and this
+  // function does nothing.
   //
   // Example. Suppose the following four events with the timestamps (hh:mm:ss)
   // shown have been added to the graph.
@@ -101,43 +246,287 @@ class PlasoEventGraph : public GraphInterface {
   // before 'e4'.
   void AddTemporalEdges();
 
+  // Returns the event nodes with timestamps at least 'first' and at most
+  // 'last' in chronological order. Events with the same timestamp are ordered
+  // by node id.
+  // - Requires that AddTemporalEdges() has been called or that temporal edges
+  //   are incremental.
+  std::vector<NodeId> GetEventsBetween(int64_t first, int64_t last) const;
+  // Return the events with the smallest timestamp greater than (or the largest
+  // timestamp less than) that of the event 'event_id', which are the targets
+  // (or sources) of its 'Precedes' edges in the CLIQUE representation. The
+  // events are ordered by node id, and there are none if 'event_id' has no
+  // timestamp. These functions answer queries in every representation, in
+  // time logarithmic in the number of events.
+  // - Require that AddTemporalEdges() has been called or that temporal edges
+  //   are incremental.
+  // - Crash if 'event_id' is not an event.
+  std::vector<NodeId> GetNextEvents(NodeId event_id) const;
+  std::vector<NodeId> GetPreviousEvents(NodeId event_id) const;
+  // Return the file nodes and URL nodes, respectively, used by the events with
+  // timestamps at least 'first' and at most 'last'. Each node occurs once and
+  // nodes are ordered by node id. These functions only visit the index entries
+  // of the resources used in the window and not the graph.
+  // - Require that AddTemporalEdges() has been called or that temporal edges
+  //   are incremental.
+  std::vector<NodeId> GetFilesBetween(int64_t first, int64_t last) const;
+  std::vector<NodeId> GetURLsBetween(int64_t first, int64_t last) const;
+
+  // Returns the file nodes in the directory 'path' or in a directory below it,
+  // ordered by node id. A trailing '/' in 'path' is optional, so "/usr" and
+  // "/usr/" are the same directory. Takes time linear in the number of
+  // directories below 'path' and the number of files returned.
+  std::vector<NodeId> GetFilesUnder(const string& path) const;
+
+  // Returns the quotient of the output in which the events whose timestamps
+  // are in the same interval of 'granularity' microseconds, counted from the
+  // Unix epoch, are one node. Grouping events by the minute or hour gives an
+  // overview of when activity occurred and which resources it used. The node
+  // of a block of events is labelled 'EventBlock', a tuple of the earliest and
+  // latest timestamps of its events and their number. Every other node,
+  // including an event without a timestamp, is a node of its own and keeps its
+  // label. The edges between two nodes of the quotient are bundled into one
+  // edge for each of their labels, and edges within a block are dropped. The
+  // blocks are found in one scan of the sorted time index, so the quotient
+  // takes time linear in the size of the output.
+  // - Crashes unless 'granularity' is positive.
+  std::unique_ptr<LabeledGraph> CoarsenByTime(int64_t granularity) const;
+  // Returns a morphism from the graph to a sample of its events that is
+  // stratified by time, as described in graph/graph_sampler.h. At most
+  // 'events_per_interval' events, chosen uniformly at random, are sampled from
+  // each interval of 'granularity' microseconds, counted from the Unix epoch,
+  // so that bursts of events do not crowd out the rest of the timeline. The
+  // sample also has the files, URLs and IP addresses of the sampled events,
+  // and the edges of the graph between its nodes, which do not include the
+  // edges of time buckets or implicit temporal edges. Events without a
+  // timestamp are not sampled. The intervals are found by binary search in the
+  // time index, so the sample takes time proportional to its size and the
+  // number of intervals it spans.
+  // - Crashes unless 'granularity' and 'events_per_interval' are positive.
+  std::unique_ptr<graph::Morphism> SampleEvents(int64_t granularity,
+                                                int events_per_interval,
+                                                uint64_t seed) const;
+
+  // Restricts the output of the functions below to the subgraph induced by the
+  // nodes within 'max_hops' edges, in either direction, of a node that has a
+  // label in 'labels' or a tag in 'tags'. At most 'max_nodes' nodes are kept,
+  // and those closest to these seed nodes are preferred as described for
+  // GraphTraversal::Neighborhood. The neighborhood is found on 'num_threads'
+  // threads. Returns
+  // - Status::OK - if the output was restricted.
+  // - Status::INVALID_ARGUMENT - if 'max_hops' or 'max_nodes' is negative, or
+  //   if no node has one of the labels or tags.
+  // - Requires that no events are processed afterwards.
+  // - Crashes if 'num_threads' is not positive.
+  util::Status RestrictOutput(const std::vector<TaggedAST>& labels,
+                              const std::set<string>& tags, int max_hops,
+                              int max_nodes, int num_threads);
+
+  // Makes the functions below output a summary of the graph, as constructed by
+  // graph::SummarizeGraph on 'num_threads' threads, if the output has more
+  // than 'max_nodes' nodes. The summary of a restricted output summarizes the
+  // restricted graph. The DOT representation of a summary has no timeline
+  // because the events at a timestamp may be merged.
+  // - Crashes unless 'max_nodes' and 'num_threads' are positive.
+  void SetMaxOutputNodes(int max_nodes, int num_threads);
+  // Makes the timeline of the DOT representation have one timestamp for each
+  // interval of 'granularity' microseconds that contains an event, which is
+  // the start of the interval, instead of one for each distinct timestamp.
+  // The timeline of events with millions of distinct timestamps is then small
+  // enough for Graphviz to lay out.
+  // - Crashes unless 'granularity' is positive.
+  void SetTimelineGranularity(int64_t granularity);
+  // Undoes RestrictOutput(), SetMaxOutputNodes() and
+  // SetTimelineGranularity(), so that the functions below output the whole
+  // graph again.
+  void ClearOutputOptions();
+
   // Returns a representation of the graph in Graphviz DOT format.
   string ToDot() const;
+  // Writes the representation returned by ToDot() to 'out' incrementally.
+  void WriteDot(std::ostream* out) const;
 
   // Returns a human-readable, protobuf representation of the graph.
   string ToPbTxt() const;
+  // Writes the representation returned by ToPbTxt() to 'out' incrementally.
+  void WritePbTxt(std::ostream* out) const;
+  // Writes the protobuf represented by ToPbTxt() to 'out' in the binary wire
+  // format.
+  void WritePb(std::ostream* out) const;
+  // Writes the graph written by WritePb() as pages of at most 'page_size'
+  // nodes or edges, as described for viz::GraphExporter::WritePages, and
+  // returns their manifest.
+  // - Crashes unless 'page_size' is positive.
+  graph_explorer::GraphManifest WritePbPages(
+      int page_size, const viz::PageWriter& write_page) const;
+
+  // The functions below write the whole graph as tables, as described in
+  // graph/table_writer.h, for analytics engines. The output options do not
+  // apply to the tables.
+  // Writes the events to 'out' with the columns "id", "Time" and
+  // "Description".
+  void WriteEventTable(std::ostream* out) const;
+  // Writes the files, URLs and IP addresses to 'out' with the columns "id",
+  // "tag" and "value".
+  void WriteResourceTable(std::ostream* out) const;
+  // Writes the edges to 'out' with the columns "source", "target" and "tag".
+  void WriteEdgeTable(std::ostream* out) const;
 
  private:
+  // Initializes 'graph' with the types of an event graph.
+  static util::Status InitializeGraph(LabeledGraph* graph);
+  // Evicts the events with timestamps less than 'cutoff', the TimeBucket
+  // nodes of their timestamps, and the files and resources that only they
+  // used, and rebuilds the graph if tombstones outnumber nodes.
+  void EvictEventsBefore(int64_t cutoff);
+  // Replaces 'graph_' by a graph with the nodes and edges of 'graph_' and no
+  // tombstones, and renumbers the nodes in the caches and indexes.
+  void RebuildGraph();
+
+  // Add a node or an edge to the graph, or to 'loader_' while a batch is
+  // processed.
+  NodeId AddNode(TaggedAST&& label);
+  NodeId AddTypedNode(TaggedAST&& label);
+  EdgeId AddEdge(NodeId source, NodeId target, const TaggedAST& label);
+
   // Adds 'file' as a node to the graph if it does not already exist. If
   // 'is_source' is true, adds an edge from the file to the event at 'node_id',
   // and otherwise, adds an edge from the file to that event.
-  void AddFile(NodeId node_id, const File& file, bool is_source);
+  // The label of the file is constructed on 'arena'.
+  // Returns the id of the node of the file.
+  NodeId AddFile(NodeId node_id, const File& file, bool is_source,
+                 google::protobuf::Arena* arena);
+
+  // Adds the file 'file_id' to the files in the directory 'dir_id'.
+  void AddToDirectory(int dir_id, NodeId file_id);
+  // Adds the file 'file_id' of a loaded graph, whose label has the AST 'file',
+  // to the files in its directory.
+  void IndexDirectory(const AST& file, NodeId file_id);
 
   // Every entity that is not a file or an event is a resource.  Adds a node to
   // the graph with the provided tag and label 'resource' if such a node does
   // not already exist. If 'is_source' is true, adds an edge from the resource
   // to the event at 'node_id', and otherwise, adds an edge from that event to
-  // the resource.
-  void AddResource(NodeId node_id, const string& tag, const string& resource,
-                   bool is_source);
+  // the resource. Returns the id of the node of the resource.
+  NodeId AddResource(NodeId node_id, const string& tag, const string& resource,
+                     bool is_source, google::protobuf::Arena* arena);
 
-  // Adds nodes and edges for the files and resources involved in an event.
-  void AddEventData(NodeId node_id, const PlasoEvent& event_data);
+  // Adds nodes and edges for the files and resources involved in an event. The
+  // labels are constructed on 'arena'.
+  void AddEventData(NodeId node_id, const PlasoEvent& event_data,
+                    google::protobuf::Arena* arena);
+  // Adds the resources used by an event at 'timestamp' to 'index'.
+  void IndexResources(int64_t timestamp, const std::vector<NodeId>& resources,
+                      TimeIndex* index);
+  // Returns the distinct resources in 'index' between 'first' and 'last'.
+  std::vector<NodeId> GetResourcesBetween(const TimeIndex& index,
+                                          int64_t first, int64_t last) const;
 
-  // Returns an event label with the timestamp and source ASTs set to the
-  // arguments provided.
-  TaggedAST MakeEventLabel(const AST& timestamp, const AST& source);
+  // Returns the TimeBucket node with the timestamp 'timestamp', which is added
+  // if it does not exist.
+  NodeId FindOrAddHub(int64_t timestamp);
+  // Adds the temporal edges from the events in 'earlier', which have the
+  // timestamp 'timestamp', to the events in 'later'.
+  void AddBucketEdges(int64_t timestamp, util::Span<TimedNode> earlier,
+                      util::Span<TimedNode> later);
+  // Returns the events adjacent to 'event_id' in time, which are after it if
+  // 'is_next' is true and before it otherwise.
+  std::vector<NodeId> GetAdjacentEvents(NodeId event_id, bool is_next) const;
+  // Returns a copy of 'graph_' with a 'Precedes' edge from every event to
+  // every event with the next timestamp, and sets '*node_map' to the map from
+  // the nodes of 'graph_' to the nodes of the copy.
+  std::unique_ptr<LabeledGraph> MaterializeTemporalEdges(
+      std::vector<NodeId>* node_map) const;
+  // Returns the view that is output, or null if the whole of 'graph_' is. In
+  // the IMPLICIT representation, the view is of a copy of 'graph_' made by
+  // MaterializeTemporalEdges(), which is stored in '*materialized' with the
+  // view in '*owned_view', and '*node_map' is set as described there.
+  // Otherwise, the view is 'output_view_' and 'node_map' is left empty. Only
+  // the quotients of OutputSummary() and CoarsenByTime() use this copy.
+  const LabeledGraphView* OutputView(
+      std::unique_ptr<LabeledGraph>* materialized,
+      std::unique_ptr<LabeledGraphView>* owned_view,
+      std::vector<NodeId>* node_map) const;
+  // In the IMPLICIT representation, makes 'exporter' export the CLIQUE edges,
+  // which it finds in the time index as it exports each node. An unsorted
+  // time index is sorted into '*sorted_index', which must outlive the export.
+  void AddImplicitEdges(TimeIndex* sorted_index,
+                        viz::GraphExporter* exporter) const;
+  // Returns the summary of the output, or null if the output is not
+  // summarized.
+  std::unique_ptr<LabeledGraph> OutputSummary() const;
+  // Returns 'time_index_' if it is sorted, and otherwise sorts a copy of it
+  // into '*sorted_index' and returns the copy.
+  const TimeIndex& SortedTimeIndex(TimeIndex* sorted_index) const;
+  // Reads the graph file 'filename' into 'graph' and checks that it contains
+  // an event graph.
+  util::Status ReadEventGraph(const string& filename,
+                              LabeledGraph* graph) const;
+  // Marks the graph read by Load() or Merge() as initialized and indexes its
+  // events, files and URLs by time and its files by directory.
+  void IndexGraph();
+  // Adds the temporal edges of the event 'event_id' with the timestamp
+  // 'timestamp', which has just been inserted into 'time_index_'.
+  void AddIncrementalEdges(NodeId event_id, int64_t timestamp);
 
   bool is_initialized_;
   // True if temporal edges have been added to 'graph_'.
   bool has_temporal_edges_;
   // True if all event sources are included in the graph.
   bool has_all_sources_;
+  TemporalEdges temporal_edges_;
+  // True if ProcessEvent adds temporal edges.
+  bool is_incremental_;
+  // The length of the window of events, or 0 if all events are kept, and the
+  // latest timestamp added to a graph with a window.
+  int64_t window_;
+  int64_t latest_time_;
 
-  LabeledGraph graph_;
-  // Maps from a timestamp to the set of event nodes with that timestamp. This
-  // index allows for conveniently processing events in chronological order.
-  std::map<int64_t, std::set<NodeId>> time_index_;
+  // The graph, which is replaced by RebuildGraph().
+  std::unique_ptr<LabeledGraph> graph_;
+  // The part of 'graph_' that is output, or null if the whole graph is.
+  std::unique_ptr<LabeledGraphView> output_view_;
+  // The largest output that is not summarized, or 0 if no output is, and the
+  // number of threads that construct a summary.
+  int max_output_nodes_;
+  int summary_threads_;
+  // The length of the intervals of the timeline, or 0 if the timeline has
+  // every distinct timestamp.
+  int64_t timeline_granularity_;
+  // The loader of the batch of events being processed, or null.
+  LabeledGraph::BulkLoader* loader_;
+  // The file from which the graph was loaded, or empty, and the number of
+  // nodes and edges of the graph when it was initialized or loaded or when
+  // the last delta was taken or saved.
+  string graph_file_;
+  int num_saved_nodes_;
+  int num_saved_edges_;
+  // The label of 'Uses' edges, which is shared by all events.
+  TaggedAST uses_label_;
+  // The label of 'Precedes' edges.
+  TaggedAST precedes_label_;
+  // Caches of the nodes of files and resources, which allow the nodes of files
+  // and resources that have already been added to be found without
+  // constructing and interning their labels. Files are keyed by the key
+  // computed in the implementation, which is stored in 'file_key_' to reuse
+  // its memory. Resources are keyed by their tag and their name.
+  std::unordered_map<string, NodeId> file_nodes_;
+  string file_key_;
+  std::unordered_map<string, std::unordered_map<string, NodeId>>
+      resource_nodes_;
+  // The directories of files and, at position 'i', the file nodes in the
+  // directory with id 'i'.
+  plaso::DirectoryTrie directories_;
+  std::vector<std::vector<NodeId>> directory_files_;
+  // The event nodes in chronological order. This index allows for
+  // conveniently processing events in chronological order. Events are
+  // appended and the index is sorted by AddTemporalEdges(), unless temporal
+  // edges are incremental, in which case events are inserted in order.
+  TimeIndex time_index_;
+  // The posting lists of files and URLs, which contain an entry with the
+  // timestamp of an event for every file or URL that the event uses.
+  TimeIndex file_index_;
+  TimeIndex url_index_;
 };
 
 }  // namespace morphie
@@ -14,13 +14,21 @@
 
 #include "analyzers/plaso/plaso_event_graph.h"
 
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
 #include <memory>  // for __alloc_traits<>::value_type
+#include <sstream>
+#include <vector>
 
 #include "analyzers/plaso/plaso_event.h"
 #include "graph/value.h"
 #include "gtest.h"
 #include "plaso_event.pb.h"
 #include "util/status.h"
+#include "util/string_utils.h"
 #include "util/time_utils.h"
 
 namespace morphie {
@@ -77,6 +85,22 @@ TEST_F(PlasoEventGraphTest, ProcessResourceslessEvents) {
   EXPECT_EQ(0, graph_.NumEdges());
 }
 
+// The memory of the time index grows with the events, and the statistics list
+// the memory of each component.
+TEST_F(PlasoEventGraphTest, ReportsMemoryUsage) {
+  util::MemoryBreakdown empty_usage = graph_.MemoryUsage();
+  PlasoEvent event = GetProto();
+  graph_.ProcessEvent(event);
+  graph_.ProcessEvent(event);
+  util::MemoryBreakdown usage = graph_.MemoryUsage();
+  EXPECT_LT(empty_usage["time_index"], usage["time_index"]);
+  EXPECT_LT(empty_usage["graph/vertices"], usage["graph/vertices"]);
+  string stats = graph_.GetStats();
+  EXPECT_NE(string::npos, stats.find("Memory (bytes) : "));
+  EXPECT_NE(string::npos, stats.find("  graph/labels : "));
+  EXPECT_NE(string::npos, stats.find("  time_index : "));
+}
+
 // There are no temporal edges between event with the same timestamp.
 TEST_F(PlasoEventGraphTest, NoEdgesBetweenConcurrentEvents) {
   PlasoEvent event = GetProto();
@@ -101,6 +125,427 @@ TEST_F(PlasoEventGraphTest, TemporalEdgesBetweenEvents) {
   EXPECT_EQ(2, graph_.NumEdges());
 }
 
+// Adds 'num_events' events at each of the timestamps, which are offsets in
+// seconds from the timestamp of GetProto(), to 'graph'.
+void AddEvents(const std::vector<int>& offsets, int num_events,
+               PlasoEventGraph* graph) {
+  PlasoEvent event = GetProto();
+  const int64_t timestamp = event.timestamp();
+  for (int offset : offsets) {
+    event.set_timestamp(timestamp + offset * int64_t{1000000});
+    for (int i = 0; i < num_events; ++i) {
+      graph->ProcessEvent(event);
+    }
+  }
+}
+
+// A hub replaces the edges between four events at each of two timestamps by
+// edges to and from one node per timestamp.
+TEST(PlasoEventGraphTemporalTest, HubsReplaceCliques) {
+  PlasoEventGraph clique_graph(false);
+  ASSERT_TRUE(clique_graph.Initialize().ok());
+  AddEvents({0, 5}, 4, &clique_graph);
+  clique_graph.AddTemporalEdges();
+  EXPECT_EQ(8, clique_graph.NumNodes());
+  EXPECT_EQ(16, clique_graph.NumEdges());
+
+  PlasoEventGraph hub_graph(false);
+  hub_graph.SetTemporalEdges(PlasoEventGraph::TemporalEdges::HUB, false);
+  ASSERT_TRUE(hub_graph.Initialize().ok());
+  AddEvents({0, 5}, 4, &hub_graph);
+  hub_graph.AddTemporalEdges();
+  EXPECT_EQ(10, hub_graph.NumNodes());
+  EXPECT_EQ(12, hub_graph.NumEdges());
+}
+
+// Incremental edges are the same as batch edges if every event has a new
+// earliest or latest timestamp or an existing timestamp.
+TEST(PlasoEventGraphTemporalTest, IncrementalEdgesMatchBatchEdges) {
+  for (auto temporal_edges : {PlasoEventGraph::TemporalEdges::CLIQUE,
+                              PlasoEventGraph::TemporalEdges::HUB}) {
+    PlasoEventGraph batch_graph(false);
+    batch_graph.SetTemporalEdges(temporal_edges, false);
+    ASSERT_TRUE(batch_graph.Initialize().ok());
+    PlasoEventGraph incremental_graph(false);
+    incremental_graph.SetTemporalEdges(temporal_edges, true);
+    ASSERT_TRUE(incremental_graph.Initialize().ok());
+    for (PlasoEventGraph* graph : {&batch_graph, &incremental_graph}) {
+      AddEvents({10, 20, 20, 30, 0, 20, 10, 40}, 2, graph);
+    }
+    batch_graph.AddTemporalEdges();
+    EXPECT_EQ(batch_graph.NumNodes(), incremental_graph.NumNodes());
+    EXPECT_EQ(batch_graph.NumEdges(), incremental_graph.NumEdges());
+    // Incremental edges do not prevent adding more events.
+    incremental_graph.AddTemporalEdges();
+    AddEvents({50}, 1, &incremental_graph);
+    EXPECT_EQ(batch_graph.NumNodes() +
+                  (temporal_edges == PlasoEventGraph::TemporalEdges::HUB ? 2
+                                                                         : 1),
+              incremental_graph.NumNodes());
+  }
+}
+
+// An event between two existing timestamps is spliced between their events,
+// and the edge between those events remains.
+TEST(PlasoEventGraphTemporalTest, SplicesOutOfOrderEvents) {
+  PlasoEventGraph graph(false);
+  graph.SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE, true);
+  ASSERT_TRUE(graph.Initialize().ok());
+  AddEvents({0, 10}, 1, &graph);
+  EXPECT_EQ(1, graph.NumEdges());
+  AddEvents({5}, 1, &graph);
+  EXPECT_EQ(3, graph.NumEdges());
+}
+
+// Implicit temporal edges are not stored, but adjacent events are found from
+// the time index and the outputs are those of the CLIQUE representation.
+TEST(PlasoEventGraphTemporalTest, ImplicitEdgesMatchCliqueEdges) {
+  PlasoEventGraph clique_graph(false);
+  ASSERT_TRUE(clique_graph.Initialize().ok());
+  PlasoEventGraph implicit_graph(false);
+  implicit_graph.SetTemporalEdges(PlasoEventGraph::TemporalEdges::IMPLICIT,
+                                  false);
+  ASSERT_TRUE(implicit_graph.Initialize().ok());
+  for (PlasoEventGraph* graph : {&clique_graph, &implicit_graph}) {
+    AddEvents({0, 5, 10}, 2, graph);
+    graph->AddTemporalEdges();
+  }
+  EXPECT_EQ(8, clique_graph.NumEdges());
+  EXPECT_EQ(0, implicit_graph.NumEdges());
+  EXPECT_EQ(std::vector<NodeId>({2, 3}), implicit_graph.GetNextEvents(0));
+  EXPECT_EQ(std::vector<NodeId>({0, 1}), implicit_graph.GetPreviousEvents(3));
+  EXPECT_TRUE(implicit_graph.GetNextEvents(5).empty());
+  EXPECT_EQ(clique_graph.GetNextEvents(2), implicit_graph.GetNextEvents(2));
+  EXPECT_EQ(clique_graph.ToDot(), implicit_graph.ToDot());
+  EXPECT_EQ(clique_graph.ToPbTxt(), implicit_graph.ToPbTxt());
+  std::ostringstream clique_edges;
+  clique_graph.WriteEdgeTable(&clique_edges);
+  std::ostringstream implicit_edges;
+  implicit_graph.WriteEdgeTable(&implicit_edges);
+  EXPECT_EQ(clique_edges.str(), implicit_edges.str());
+  // Neighborhoods follow implicit edges.
+  for (PlasoEventGraph* graph : {&clique_graph, &implicit_graph}) {
+    ASSERT_TRUE(graph->RestrictOutput({}, {"Event"}, 1, 3, 1).ok());
+  }
+  EXPECT_EQ(clique_graph.ToPbTxt(), implicit_graph.ToPbTxt());
+  EXPECT_EQ(clique_graph.ToDot(), implicit_graph.ToDot());
+  // Pages list the implicit edges of the nodes of each page.
+  std::vector<string> clique_pages;
+  std::vector<string> implicit_pages;
+  for (auto graph_pages : {std::make_pair(&clique_graph, &clique_pages),
+                           std::make_pair(&implicit_graph, &implicit_pages)}) {
+    std::vector<string>* pages = graph_pages.second;
+    graph_pages.first->WritePbPages(
+        2, [pages](int, const graph_explorer::GraphDef& page) {
+          pages->push_back(page.DebugString());
+          return true;
+        });
+  }
+  EXPECT_EQ(clique_pages, implicit_pages);
+}
+
+// Events between two timestamps are found in chronological order once
+// temporal edges have been added.
+TEST(PlasoEventGraphTemporalTest, FindsEventsBetweenTimestamps) {
+  PlasoEventGraph graph(false);
+  ASSERT_TRUE(graph.Initialize().ok());
+  AddEvents({30, 10, 20, 10}, 1, &graph);
+  EXPECT_DEATH({ graph.GetEventsBetween(0, 100); },
+               "Events can only be found by time after temporal edges have "
+               "been added.");
+  graph.AddTemporalEdges();
+  const int64_t timestamp = GetProto().timestamp();
+  EXPECT_EQ(std::vector<NodeId>({1, 3, 2}),
+            graph.GetEventsBetween(timestamp + 10000000,
+                                   timestamp + 20000000));
+  EXPECT_TRUE(graph.GetEventsBetween(timestamp, timestamp + 9999999).empty());
+}
+
+// Files and URLs used in a window are found once each, and resources used
+// outside the window are not found.
+TEST(PlasoEventGraphTemporalTest, FindsResourcesBetweenTimestamps) {
+  PlasoEventGraph graph(false);
+  ASSERT_TRUE(graph.Initialize().ok());
+  PlasoEvent event = GetProto();
+  const int64_t timestamp = event.timestamp();
+  *event.mutable_source_file() = plaso::ParseFilename("a.txt");
+  event.set_source_url("www.google.com");
+  graph.ProcessEvent(event);  // Adds nodes 0, 1 and 2.
+  event.set_timestamp(timestamp + 10);
+  graph.ProcessEvent(event);  // Adds node 3.
+  event.set_timestamp(timestamp + 20);
+  *event.mutable_source_file() = plaso::ParseFilename("b.txt");
+  event.clear_source_url();
+  graph.ProcessEvent(event);  // Adds nodes 4 and 5.
+  graph.AddTemporalEdges();
+  EXPECT_EQ(std::vector<NodeId>({1}),
+            graph.GetFilesBetween(timestamp, timestamp + 10));
+  EXPECT_EQ(std::vector<NodeId>({1, 5}),
+            graph.GetFilesBetween(timestamp, timestamp + 20));
+  EXPECT_EQ(std::vector<NodeId>({5}),
+            graph.GetFilesBetween(timestamp + 15, timestamp + 20));
+  EXPECT_EQ(std::vector<NodeId>({2}),
+            graph.GetURLsBetween(timestamp, timestamp + 20));
+  EXPECT_TRUE(graph.GetURLsBetween(timestamp + 15, timestamp + 20).empty());
+}
+
+// A loaded graph is output as the saved graph is, and its events, files and
+// URLs are found by time.
+TEST(PlasoEventGraphTemporalTest, LoadsSavedGraphs) {
+  PlasoEventGraph graph(false);
+  ASSERT_TRUE(graph.Initialize().ok());
+  PlasoEvent event = GetProto();
+  const int64_t timestamp = event.timestamp();
+  *event.mutable_source_file() = plaso::ParseFilename("a.txt");
+  event.set_source_url("www.google.com");
+  graph.ProcessEvent(event);
+  event.set_timestamp(timestamp + 20);
+  *event.mutable_source_file() = plaso::ParseFilename("b.txt");
+  event.clear_source_url();
+  graph.ProcessEvent(event);
+  event.clear_timestamp();
+  graph.ProcessEvent(event);
+  graph.AddTemporalEdges();
+  char filename[] = "/tmp/plaso_event_graph_test_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(graph.Save(filename).ok());
+  PlasoEventGraph loaded(false);
+  ASSERT_TRUE(loaded.Load(filename).ok());
+  std::remove(filename);
+  EXPECT_EQ(graph.NumNodes(), loaded.NumNodes());
+  EXPECT_EQ(graph.NumEdges(), loaded.NumEdges());
+  EXPECT_EQ(graph.ToDot(), loaded.ToDot());
+  EXPECT_EQ(graph.GetEventsBetween(timestamp, timestamp + 20),
+            loaded.GetEventsBetween(timestamp, timestamp + 20));
+  EXPECT_EQ(graph.GetFilesBetween(timestamp + 15, timestamp + 20),
+            loaded.GetFilesBetween(timestamp + 15, timestamp + 20));
+  EXPECT_EQ(graph.GetURLsBetween(timestamp, timestamp + 20),
+            loaded.GetURLsBetween(timestamp, timestamp + 20));
+  EXPECT_DEATH({ loaded.ProcessEvent(event); }, "AddTemporalEdges");
+  EXPECT_DEATH({ loaded.Load(filename); }, "initialized again");
+  PlasoEventGraph missing(false);
+  EXPECT_FALSE(missing.Load(filename).ok());
+}
+
+// Events appended to a loaded graph, some of which use files and URLs of the
+// saved graph, give the graph that is built from all events, and the file
+// with the appended segment is loaded as that graph.
+TEST(PlasoEventGraphTemporalTest, AppendsEventsToSavedGraphs) {
+  PlasoEvent event = GetProto();
+  const int64_t timestamp = event.timestamp();
+  std::vector<PlasoEvent> events;
+  for (const char* filename : {"/usr/a.txt", "/tmp/b.txt", "/usr/a.txt",
+                               "/usr/lib/c.so"}) {
+    *event.mutable_source_file() = plaso::ParseFilename(filename);
+    event.set_source_url(filename);
+    event.set_timestamp(timestamp + 10 * events.size());
+    events.push_back(event);
+  }
+  PlasoEventGraph graph(false);
+  graph.SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE, true);
+  ASSERT_TRUE(graph.Initialize().ok());
+  graph.ProcessEvent(events[0]);
+  graph.ProcessEvent(events[1]);
+  char filename[] = "/tmp/plaso_event_graph_test_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(graph.Save(filename).ok());
+  graph.ProcessEvent(events[2]);
+  graph.ProcessEvent(events[3]);
+
+  PlasoEventGraph appended(false);
+  appended.SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE, true);
+  ASSERT_TRUE(appended.Load(filename).ok());
+  appended.ProcessEvent(events[2]);
+  ASSERT_TRUE(appended.SaveDelta().ok());
+  appended.ProcessEvents(util::Span<PlasoEvent>(&events[3], 1));
+  ASSERT_TRUE(appended.SaveDelta().ok());
+  EXPECT_EQ(graph.ToDot(), appended.ToDot());
+  EXPECT_EQ(graph.GetFilesUnder("/usr"), appended.GetFilesUnder("/usr"));
+  EXPECT_EQ(graph.GetURLsBetween(timestamp, timestamp + 30),
+            appended.GetURLsBetween(timestamp, timestamp + 30));
+
+  PlasoEventGraph loaded(false);
+  ASSERT_TRUE(loaded.Load(filename).ok());
+  std::remove(filename);
+  EXPECT_EQ(graph.ToDot(), loaded.ToDot());
+  EXPECT_EQ(graph.GetFilesUnder("/usr"), loaded.GetFilesUnder("/usr"));
+  EXPECT_EQ(graph.GetEventsBetween(timestamp + 10, timestamp + 30),
+            loaded.GetEventsBetween(timestamp + 10, timestamp + 30));
+  EXPECT_EQ(graph.GetFilesBetween(timestamp + 20, timestamp + 30),
+            loaded.GetFilesBetween(timestamp + 20, timestamp + 30));
+  EXPECT_DEATH({ graph.SaveDelta(); }, "loaded from a file");
+}
+
+// Shards of a list of events ordered by time, one of which begins with the
+// timestamp that ends the shard before it, merge into the graph built from all
+// events, and shards that are not ordered by time are rejected.
+TEST(PlasoEventGraphTemporalTest, MergesShards) {
+  PlasoEvent event = GetProto();
+  const int64_t timestamp = event.timestamp();
+  const std::vector<std::vector<int64_t>> shard_times = {
+      {0, 10, 10}, {10, 20}, {30, 30, 40}};
+  const std::vector<const char*> filenames = {"/usr/a.txt", "/tmp/b.txt",
+                                              "/usr/lib/c.so"};
+  for (auto temporal_edges : {PlasoEventGraph::TemporalEdges::CLIQUE,
+                              PlasoEventGraph::TemporalEdges::HUB}) {
+    PlasoEventGraph graph(false);
+    graph.SetTemporalEdges(temporal_edges, false);
+    ASSERT_TRUE(graph.Initialize().ok());
+    std::vector<string> shard_files;
+    int num_events = 0;
+    for (const std::vector<int64_t>& times : shard_times) {
+      PlasoEventGraph shard(false);
+      shard.SetTemporalEdges(temporal_edges, false);
+      ASSERT_TRUE(shard.Initialize().ok());
+      for (int64_t time : times) {
+        *event.mutable_source_file() =
+            plaso::ParseFilename(filenames[num_events % filenames.size()]);
+        event.set_timestamp(timestamp + time);
+        graph.ProcessEvent(event);
+        shard.ProcessEvent(event);
+        ++num_events;
+      }
+      shard.AddTemporalEdges();
+      char filename[] = "/tmp/plaso_event_graph_test_XXXXXX";
+      int fd = mkstemp(filename);
+      ASSERT_GE(fd, 0);
+      close(fd);
+      ASSERT_TRUE(shard.Save(filename).ok());
+      shard_files.push_back(filename);
+    }
+    graph.AddTemporalEdges();
+
+    PlasoEventGraph merged(false);
+    merged.SetTemporalEdges(temporal_edges, false);
+    ASSERT_TRUE(merged.Merge(shard_files).ok());
+    EXPECT_EQ(graph.NumNodes(), merged.NumNodes());
+    EXPECT_EQ(graph.NumEdges(), merged.NumEdges());
+    EXPECT_EQ(graph.GetEventsBetween(timestamp + 10, timestamp + 30).size(),
+              merged.GetEventsBetween(timestamp + 10, timestamp + 30).size());
+    EXPECT_EQ(graph.GetFilesUnder("/usr").size(),
+              merged.GetFilesUnder("/usr").size());
+
+    PlasoEventGraph unordered(false);
+    unordered.SetTemporalEdges(temporal_edges, false);
+    EXPECT_FALSE(unordered.Merge({shard_files[1], shard_files[0]}).ok());
+    PlasoEventGraph empty(false);
+    EXPECT_FALSE(empty.Merge({}).ok());
+    for (const string& filename : shard_files) {
+      std::remove(filename.c_str());
+    }
+  }
+}
+
+// Adds an event at each offset in seconds from the timestamp of GetProto()
+// to 'graph'. The event uses the file 'f<i % 3>' and the URL 'u<i>', where 'i'
+// is the offset.
+void AddWindowEvents(int first, int last, PlasoEventGraph* graph) {
+  PlasoEvent event = GetProto();
+  const int64_t timestamp = event.timestamp();
+  for (int offset = first; offset <= last; ++offset) {
+    event.set_timestamp(timestamp + offset * int64_t{1000000});
+    *event.mutable_source_file() =
+        plaso::ParseFilename(util::StrCat("/f", std::to_string(offset % 3)));
+    event.set_source_url(util::StrCat("u", std::to_string(offset)));
+    graph->ProcessEvent(event);
+  }
+}
+
+// A graph with a window holds the nodes and edges of a graph of the events in
+// the window, and its size stays bounded as events arrive.
+TEST(PlasoEventGraphWindowTest, KeepsEventsOfWindow) {
+  for (auto temporal_edges : {PlasoEventGraph::TemporalEdges::CLIQUE,
+                              PlasoEventGraph::TemporalEdges::HUB}) {
+    PlasoEventGraph graph(false);
+    graph.SetTemporalEdges(temporal_edges, true);
+    graph.SetWindow(10 * int64_t{1000000});
+    ASSERT_TRUE(graph.Initialize().ok());
+    int max_nodes = 0;
+    for (int offset = 0; offset < 1000; ++offset) {
+      AddWindowEvents(offset, offset, &graph);
+      max_nodes = std::max(max_nodes, graph.NumNodes());
+    }
+    // A graph with tombstones is written without them.
+    EXPECT_NE(string::npos, graph.ToDot().find("digraph"));
+    graph.EvictExpiredEvents();
+    PlasoEventGraph window_graph(false);
+    window_graph.SetTemporalEdges(temporal_edges, true);
+    ASSERT_TRUE(window_graph.Initialize().ok());
+    AddWindowEvents(989, 999, &window_graph);
+    EXPECT_EQ(window_graph.NumNodes(), graph.NumNodes());
+    EXPECT_EQ(window_graph.NumEdges(), graph.NumEdges());
+    const int64_t timestamp = GetProto().timestamp();
+    EXPECT_EQ(11, graph.GetEventsBetween(timestamp, timestamp + 1000000000)
+                      .size());
+    EXPECT_EQ(3, graph.GetFilesUnder("/").size());
+    EXPECT_EQ(11, graph.GetURLsBetween(timestamp, timestamp + 1000000000)
+                      .size());
+    // Expired events are evicted when they are a quarter of the events.
+    EXPECT_GT(2 * window_graph.NumNodes(), max_nodes);
+    // The graph has no tombstones, so it can be written as a graph file.
+    char filename[] = "/tmp/plaso_window_XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    EXPECT_TRUE(graph.Save(filename).ok());
+    std::remove(filename);
+  }
+}
+
+// Events without a timestamp and events that are older than the window when
+// they arrive are not added.
+TEST(PlasoEventGraphWindowTest, SkipsEventsOutsideWindow) {
+  PlasoEventGraph graph(false);
+  graph.SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE, true);
+  graph.SetWindow(10 * int64_t{1000000});
+  ASSERT_TRUE(graph.Initialize().ok());
+  AddEvents({20, 10, 5}, 1, &graph);
+  EXPECT_EQ(2, graph.NumNodes());
+  PlasoEvent event = GetProto();
+  event.clear_timestamp();
+  graph.ProcessEvent(event);
+  EXPECT_EQ(2, graph.NumNodes());
+  // The events at 25 and 31 use the file '/f1', which is kept when the event
+  // at 25 is evicted, while its URL is removed. The graph is then rebuilt,
+  // which leaves the file '/f1' (node 0), the event at 31 (node 1) and its
+  // URL, and the event at 36 (node 3), its file and its URL.
+  AddWindowEvents(25, 25, &graph);
+  AddWindowEvents(31, 31, &graph);
+  AddWindowEvents(36, 36, &graph);
+  graph.EvictExpiredEvents();
+  EXPECT_EQ(std::vector<NodeId>({1, 3}),
+            graph.GetEventsBetween(0, GetProto().timestamp() + 100000000));
+  EXPECT_EQ(6, graph.NumNodes());
+  EXPECT_EQ(std::vector<NodeId>({0, 4}), graph.GetFilesUnder("/"));
+}
+
+TEST(PlasoEventGraphDeathTest, WindowsRequireIncrementalEdges) {
+  PlasoEventGraph graph(false);
+  EXPECT_DEATH({ graph.SetWindow(10); },
+               "A window must be positive and requires incremental temporal "
+               "edges.");
+  graph.SetTemporalEdges(PlasoEventGraph::TemporalEdges::CLIQUE, true);
+  EXPECT_DEATH({ graph.SetWindow(0); }, "A window must be positive");
+  graph.SetWindow(10);
+  ASSERT_TRUE(graph.Initialize().ok());
+  string segment;
+  EXPECT_DEATH({ graph.TakeDelta(0, &segment); },
+               "A graph with a window cannot be saved as deltas.");
+}
+
+TEST(PlasoEventGraphDeathTest, TemporalEdgesAreSetBeforeInitialization) {
+  PlasoEventGraph graph(false);
+  ASSERT_TRUE(graph.Initialize().ok());
+  EXPECT_DEATH(
+      { graph.SetTemporalEdges(PlasoEventGraph::TemporalEdges::HUB, true); },
+      "The representation of temporal edges must be set before the graph is "
+      "initialized.");
+}
+
 TEST_F(PlasoEventGraphTest, ProcessEventsWithFiles) {
   PlasoEvent event = GetProto();
   File file = plaso::ParseFilename("example.txt");
@@ -119,6 +564,271 @@ TEST_F(PlasoEventGraphTest, ProcessEventsWithFiles) {
   EXPECT_EQ(3, graph_.NumEdges());
 }
 
+// Files are found in the node cache only if they have the same directory and
+// filename, and URLs only if they have the same name.
+TEST_F(PlasoEventGraphTest, CachesFileAndURLNodes) {
+  PlasoEvent event = GetProto();
+  for (const char* filename : {"/ab/c", "/a/bc", "/ab/c", "/abc", "abc"}) {
+    *event.mutable_source_file() = plaso::ParseFilename(filename);
+    event.set_source_url(filename);
+    graph_.ProcessEvent(event);
+  }
+  // There are five events, four files and four URLs.
+  EXPECT_EQ(13, graph_.NumNodes());
+  EXPECT_EQ(10, graph_.NumEdges());
+}
+
+TEST_F(PlasoEventGraphTest, FindsFilesUnderDirectories) {
+  PlasoEvent event = GetProto();
+  for (const char* filename :
+       {"/usr/bin/ls", "/usr/local/bin/ls", "/etc/hosts", "/usr/bin/ls"}) {
+    *event.mutable_source_file() = plaso::ParseFilename(filename);
+    graph_.ProcessEvent(event);
+  }
+  // The files are nodes 1, 3 and 5.
+  EXPECT_EQ(std::vector<NodeId>({1, 3}), graph_.GetFilesUnder("/usr"));
+  EXPECT_EQ(std::vector<NodeId>({1, 3}), graph_.GetFilesUnder("/usr/"));
+  EXPECT_EQ(std::vector<NodeId>({3}), graph_.GetFilesUnder("/usr/local"));
+  EXPECT_EQ(std::vector<NodeId>({1, 3, 5}), graph_.GetFilesUnder("/"));
+  EXPECT_TRUE(graph_.GetFilesUnder("/usr/lib").empty());
+  EXPECT_TRUE(graph_.GetFilesUnder("/usr/bin/ls").empty());
+}
+
+// Construct a graph in which the URL 'a' (node 1) is used by the events 0 and
+// 2, and the URL 'b' (node 4) by the event 3. The output is restricted to the
+// URLs and the event with the smallest identifier that uses one of them.
+TEST_F(PlasoEventGraphTest, RestrictsOutputToNeighborhoods) {
+  PlasoEvent event = GetProto();
+  for (const char* url : {"a", "a", "b"}) {
+    event.set_source_url(url);
+    graph_.ProcessEvent(event);
+  }
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            graph_.RestrictOutput({}, {"File"}, 1, 3, 1).code());
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            graph_.RestrictOutput({}, {"URL"}, -1, 3, 1).code());
+  ASSERT_TRUE(graph_.RestrictOutput({}, {"URL"}, 1, 3, 2).ok());
+  string dot = graph_.ToDot();
+  EXPECT_NE(string::npos, dot.find("  0 -> 1 "));
+  EXPECT_EQ(string::npos, dot.find("  2 -> 1 "));
+  EXPECT_EQ(string::npos, dot.find("  3 -> 4 "));
+  EXPECT_EQ(string::npos, dot.find("  2 ["));
+  EXPECT_NE(string::npos, dot.find("{rank=same; T" +
+                                   std::to_string(event.timestamp()) +
+                                   "; 0}"));
+}
+
+// Ten events use one file. With a budget of two nodes, the events are leaves of
+// the file that are collapsed into one node, and the timeline is omitted.
+TEST_F(PlasoEventGraphTest, SummarizesLargeOutputs) {
+  PlasoEvent event = GetProto();
+  *event.mutable_source_file() = plaso::ParseFilename("/etc/hosts");
+  for (int i = 0; i < 10; ++i) {
+    graph_.ProcessEvent(event);
+  }
+  graph_.SetMaxOutputNodes(20, 1);
+  EXPECT_NE(string::npos, graph_.ToDot().find("timeline"));
+  graph_.SetMaxOutputNodes(2, 1);
+  string dot = graph_.ToDot();
+  EXPECT_EQ(string::npos, dot.find("timeline"));
+  EXPECT_NE(string::npos, dot.find("  1 -> 0 "));
+  EXPECT_EQ(string::npos, dot.find("  2 ["));
+  EXPECT_DEATH({ graph_.SetMaxOutputNodes(0, 1); }, "positive");
+  graph_.ClearOutputOptions();
+  EXPECT_NE(string::npos, graph_.ToDot().find("timeline"));
+}
+
+// Returns the start, end and count of the EventBlock labels of 'graph' in the
+// order of their nodes.
+std::vector<std::vector<int64_t>> GetEventBlocks(const LabeledGraph& graph) {
+  std::vector<std::vector<int64_t>> blocks;
+  for (auto node_it = graph.NodeSetBegin(); node_it != graph.NodeSetEnd();
+       ++node_it) {
+    const TaggedAST& label = graph.GetNodeLabel(*node_it);
+    if (label.tag() != "EventBlock") {
+      continue;
+    }
+    const CompositeAST& tuple = label.ast().c_ast();
+    blocks.push_back({tuple.arg(0).p_ast().val().time_val(),
+                      tuple.arg(1).p_ast().val().time_val(),
+                      tuple.arg(2).p_ast().val().int_val()});
+  }
+  return blocks;
+}
+
+// Events at 22s, 32s, 62s and 67s past a minute use one file. By the minute,
+// the first two and the last two events are blocks, which have one temporal
+// edge between them and one edge from the file each.
+TEST_F(PlasoEventGraphTest, CoarsensEventsByTime) {
+  PlasoEvent event = GetProto();
+  const int64_t time = event.timestamp();
+  *event.mutable_source_file() = plaso::ParseFilename("/etc/hosts");
+  for (int64_t offset : {0, 10, 40, 45}) {
+    event.set_timestamp(time + offset * 1000000);
+    graph_.ProcessEvent(event);
+  }
+  graph_.AddTemporalEdges();
+  std::unique_ptr<LabeledGraph> coarse = graph_.CoarsenByTime(60000000);
+  EXPECT_EQ(3, coarse->NumNodes());
+  EXPECT_EQ(3, coarse->NumEdges());
+  EXPECT_EQ((std::vector<std::vector<int64_t>>{
+                {time, time + 10000000, 2},
+                {time + 40000000, time + 45000000, 2}}),
+            GetEventBlocks(*coarse));
+  // A granularity of one microsecond keeps every timestamp apart.
+  coarse = graph_.CoarsenByTime(1);
+  EXPECT_EQ(5, coarse->NumNodes());
+  EXPECT_EQ(7, coarse->NumEdges());
+  EXPECT_DEATH({ graph_.CoarsenByTime(0); }, "positive");
+}
+
+// Ten events in the minute of GetProto() and five in the next minute use one
+// file. A sample of two events a minute has two events of each minute, the
+// file and the edges between the file and the events.
+TEST_F(PlasoEventGraphTest, SamplesEventsByTime) {
+  PlasoEvent event = GetProto();
+  const int64_t time = event.timestamp();
+  *event.mutable_source_file() = plaso::ParseFilename("/etc/hosts");
+  for (int64_t offset : {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 60, 60, 61, 62, 63}) {
+    event.set_timestamp(time + offset * 1000000);
+    graph_.ProcessEvent(event);
+  }
+  graph_.AddTemporalEdges();
+  std::unique_ptr<graph::Morphism> sample =
+      graph_.SampleEvents(60000000, 2, 5 /* seed */);
+  const LabeledGraph& output = sample->Output();
+  EXPECT_EQ(5, output.NumNodes());
+  // The next minute starts 38 seconds after GetProto().
+  std::vector<int> num_events(2, 0);
+  for (auto node_it = output.NodeSetBegin(); node_it != output.NodeSetEnd();
+       ++node_it) {
+    const TaggedAST& label = output.GetNodeLabel(*node_it);
+    EXPECT_EQ(1, sample->GetNodePreimage(*node_it).size());
+    if (label.tag() == "Event") {
+      const int64_t timestamp =
+          label.ast().c_ast().arg(0).p_ast().val().time_val();
+      ++num_events[timestamp >= time + 38000000 ? 1 : 0];
+    }
+  }
+  EXPECT_EQ(std::vector<int>({2, 2}), num_events);
+  int num_uses = 0;
+  for (auto edge_it = output.EdgeSetBegin(); edge_it != output.EdgeSetEnd();
+       ++edge_it) {
+    num_uses += output.GetEdgeLabel(*edge_it).tag() == ast::kUsesTag ? 1 : 0;
+  }
+  EXPECT_EQ(4, num_uses);
+  EXPECT_EQ(16, graph_.SampleEvents(60000000, 10, 5)->Output().NumNodes());
+  EXPECT_DEATH({ graph_.SampleEvents(60000000, 0, 5); }, "positive");
+}
+
+// With a granularity of a minute, the timeline has one timestamp for the first
+// two events and one for the third.
+TEST_F(PlasoEventGraphTest, WritesCoarseTimelines) {
+  PlasoEvent event = GetProto();
+  const int64_t time = event.timestamp();
+  for (int64_t offset : {0, 10, 40}) {
+    event.set_timestamp(time + offset * 1000000);
+    graph_.ProcessEvent(event);
+  }
+  graph_.SetTimelineGranularity(60000000);
+  const int64_t minute = time - time % 60000000;
+  string dot = graph_.ToDot();
+  EXPECT_NE(string::npos, dot.find("{rank=same; T" + std::to_string(minute) +
+                                   "; 0; 1}"));
+  EXPECT_NE(string::npos,
+            dot.find("{rank=same; T" + std::to_string(minute + 60000000) +
+                     "; 2}"));
+  EXPECT_DEATH({ graph_.SetTimelineGranularity(0); }, "positive");
+  graph_.ClearOutputOptions();
+  EXPECT_NE(string::npos, graph_.ToDot().find(
+                              "{rank=same; T" + std::to_string(time) + "; 0}"));
+}
+
+// Ten events use one file. The pages of the graph hold its eleven nodes and ten
+// edges, and the pages of a summary hold the two nodes and one edge of the
+// summary.
+TEST_F(PlasoEventGraphTest, WritesPbPages) {
+  PlasoEvent event = GetProto();
+  *event.mutable_source_file() = plaso::ParseFilename("/etc/hosts");
+  for (int i = 0; i < 10; ++i) {
+    graph_.ProcessEvent(event);
+  }
+  int num_pages = 0;
+  viz::PageWriter write_page = [&num_pages](
+      int index, const graph_explorer::GraphDef& page) {
+    EXPECT_LE(page.node_size(), 4);
+    ++num_pages;
+    return true;
+  };
+  graph_explorer::GraphManifest manifest = graph_.WritePbPages(4, write_page);
+  EXPECT_EQ(num_pages, manifest.page_size());
+  EXPECT_EQ(graph_.NumNodes(), manifest.num_nodes());
+  EXPECT_EQ(10, manifest.num_edges());
+  graph_.SetMaxOutputNodes(2, 1);
+  manifest = graph_.WritePbPages(4, write_page);
+  EXPECT_EQ(2, manifest.num_nodes());
+  EXPECT_EQ(1, manifest.num_edges());
+}
+
+// Three events use one file. The tables hold the three events, the file and
+// the edges between them, and ignore the output options.
+TEST_F(PlasoEventGraphTest, WritesTables) {
+  PlasoEvent event = GetProto();
+  *event.mutable_source_file() = plaso::ParseFilename("/etc/hosts");
+  for (int i = 0; i < 3; ++i) {
+    event.set_timestamp(event.timestamp() + 1);
+    graph_.ProcessEvent(event);
+  }
+  graph_.SetMaxOutputNodes(2, 1);
+  std::ostringstream events;
+  graph_.WriteEventTable(&events);
+  std::vector<string> lines = util::SplitToVector(events.str(), '\n');
+  ASSERT_EQ(5, lines.size());
+  EXPECT_EQ("id,Time,Description", lines[0]);
+  EXPECT_NE(string::npos,
+            lines[1].find(util::StrCat(",", event.timestamp() - 2, ",")));
+  std::ostringstream resources;
+  graph_.WriteResourceTable(&resources);
+  lines = util::SplitToVector(resources.str(), '\n');
+  ASSERT_EQ(3, lines.size());
+  EXPECT_EQ("id,tag,value", lines[0]);
+  std::ostringstream edges;
+  graph_.WriteEdgeTable(&edges);
+  lines = util::SplitToVector(edges.str(), '\n');
+  EXPECT_EQ(graph_.NumEdges() + 2, static_cast<int>(lines.size()));
+  EXPECT_EQ("source,target,tag", lines[0]);
+}
+
+// Processing a batch of events has the same result as processing the events
+// one at a time.
+TEST(PlasoEventGraphBatchTest, BatchesMatchSingleEvents) {
+  PlasoEventGraph graph(false);
+  ASSERT_TRUE(graph.Initialize().ok());
+  PlasoEventGraph batch_graph(false);
+  ASSERT_TRUE(batch_graph.Initialize().ok());
+  std::vector<PlasoEvent> events;
+  PlasoEvent event = GetProto();
+  for (const char* filename : {"/a/b", "/a/c", "/a/b", "d"}) {
+    event.set_timestamp(event.timestamp() + 1);
+    *event.mutable_source_file() = plaso::ParseFilename(filename);
+    event.set_target_url(filename);
+    events.push_back(event);
+    graph.ProcessEvent(event);
+  }
+  batch_graph.ProcessEvents(events);
+  batch_graph.ProcessEvents(events);
+  for (const PlasoEvent& event_data : events) {
+    graph.ProcessEvent(event_data);
+  }
+  graph.AddTemporalEdges();
+  batch_graph.AddTemporalEdges();
+  EXPECT_EQ(graph.ToDot(), batch_graph.ToDot());
+  TaggedAST url;
+  url.set_tag(ast::kURLTag);
+  *url.mutable_ast() = value::MakeString("/a/b");
+  EXPECT_EQ(1, batch_graph.NumLabeledNodes(url));
+}
+
 TEST_F(PlasoEventGraphTest, ProcessEventsWithURLs) {
   PlasoEvent event = GetProto();
   event.set_source_url("www.google.com");
@@ -0,0 +1,226 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_event_sorter.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <utility>
+
+#include "util/logging.h"
+#include "util/string_utils.h"
+#include "util/trace.h"
+
+namespace morphie {
+
+namespace {
+
+namespace io = ::google::protobuf::io;
+
+const char kRunSizeErr[] = "The number of events of a run must be positive.";
+const char kSpillErr[] = "Error spilling sorted events to: ";
+const char kReadErr[] = "Error reading sorted events from: ";
+
+// The number of sorted events passed to the consumer at a time.
+const size_t kEventsPerBatch = 1024;
+
+// Returns the timestamp by which 'event' is sorted. Events without a timestamp
+// precede all others.
+int64_t SortKey(const PlasoEvent& event) {
+  return event.has_timestamp() ? event.timestamp()
+                               : std::numeric_limits<int64_t>::min();
+}
+
+// Sorts 'events' stably by their sort keys.
+void SortEvents(std::vector<PlasoEvent>* events) {
+  std::stable_sort(events->begin(), events->end(),
+                   [](const PlasoEvent& lhs, const PlasoEvent& rhs) {
+                     return SortKey(lhs) < SortKey(rhs);
+                   });
+}
+
+// A RunReader reads the events of a spilled run one at a time. A run is a
+// sequence of events, each preceded by its size as a varint.
+class RunReader {
+ public:
+  explicit RunReader(int fd) : stream_(fd), has_event_(false), is_ok_(true) {}
+
+  // Reads the next event of the run into 'event()'. Sets 'has_event()' to
+  // false at the end of the run or if the run could not be read.
+  void Next() {
+    // A coded stream backs up the bytes it has buffered but not read when it
+    // is destroyed, so one is constructed per event.
+    io::CodedInputStream coded_in(&stream_);
+    uint32_t size = 0;
+    if (!coded_in.ReadVarint32(&size)) {
+      has_event_ = false;
+      is_ok_ = stream_.GetErrno() == 0;
+      return;
+    }
+    const io::CodedInputStream::Limit limit = coded_in.PushLimit(size);
+    // Events are parsed as they were written, even if they lack required
+    // fields.
+    has_event_ = event_.ParsePartialFromCodedStream(&coded_in) &&
+                 coded_in.ConsumedEntireMessage();
+    is_ok_ = has_event_;
+    coded_in.PopLimit(limit);
+  }
+
+  bool has_event() const { return has_event_; }
+  bool is_ok() const { return is_ok_; }
+  PlasoEvent* event() { return &event_; }
+
+ private:
+  io::FileInputStream stream_;
+  PlasoEvent event_;
+  bool has_event_;
+  bool is_ok_;
+};
+
+}  // namespace
+
+PlasoEventSorter::PlasoEventSorter(int64_t events_per_run,
+                                   const string& spill_directory,
+                                   util::Stats* stats)
+    : events_per_run_(events_per_run),
+      spill_directory_(spill_directory),
+      stats_(stats) {
+  CHECK(events_per_run > 0, kRunSizeErr);
+}
+
+PlasoEventSorter::~PlasoEventSorter() {
+  for (int fd : run_files_) {
+    close(fd);
+  }
+}
+
+util::Status PlasoEventSorter::Add(PlasoEvent* event) {
+  run_.push_back(std::move(*event));
+  if (static_cast<int64_t>(run_.size()) < events_per_run_) {
+    return util::Status::OK;
+  }
+  return SpillRun();
+}
+
+// The file of a run is unlinked as soon as it is created, so the kernel
+// removes it when its descriptor is closed, even if the process crashes.
+util::Status PlasoEventSorter::SpillRun() {
+  util::ScopedTimer timer(stats_, "sort");
+  util::ScopedSpan span("PlasoEventSorter::SpillRun");
+  SortEvents(&run_);
+  string filename = util::StrCat(spill_directory_, "/logle-sort-XXXXXX");
+  const int fd = mkstemp(&filename[0]);
+  if (fd < 0) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kSpillErr, filename));
+  }
+  unlink(filename.c_str());
+  run_files_.push_back(fd);
+  io::FileOutputStream stream(fd);
+  {
+    io::CodedOutputStream coded_out(&stream);
+    for (const PlasoEvent& event : run_) {
+      coded_out.WriteVarint32(static_cast<uint32_t>(event.ByteSizeLong()));
+      event.SerializeWithCachedSizes(&coded_out);
+    }
+  }
+  if (!stream.Flush() || lseek(fd, 0, SEEK_SET) != 0) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kSpillErr, filename));
+  }
+  run_.clear();
+  return util::Status::OK;
+}
+
+// The runs are merged with a heap of the next event of each run, ordered by
+// sort key and then by run, which keeps the order of events with equal
+// timestamps.
+util::Status PlasoEventSorter::Merge(
+    const std::function<void(const std::vector<PlasoEvent>&)>& consume) {
+  util::ScopedSpan span("PlasoEventSorter::Merge");
+  std::vector<PlasoEvent> batch;
+  if (run_files_.empty()) {
+    {
+      util::ScopedTimer timer(stats_, "sort");
+      SortEvents(&run_);
+    }
+    for (size_t begin = 0; begin < run_.size(); begin += kEventsPerBatch) {
+      const size_t end = std::min(run_.size(), begin + kEventsPerBatch);
+      batch.assign(std::make_move_iterator(run_.begin() + begin),
+                   std::make_move_iterator(run_.begin() + end));
+      consume(batch);
+    }
+    run_.clear();
+    return util::Status::OK;
+  }
+  if (!run_.empty()) {
+    util::Status status = SpillRun();
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  double merge_seconds = 0;
+  std::vector<std::unique_ptr<RunReader>> readers;
+  using HeapEntry = std::pair<int64_t, size_t>;
+  std::priority_queue<HeapEntry, std::vector<HeapEntry>,
+                      std::greater<HeapEntry>> heap;
+  {
+    util::ScopedTimer timer(&merge_seconds);
+    for (int fd : run_files_) {
+      readers.emplace_back(new RunReader(fd));
+      readers.back()->Next();
+      if (readers.back()->has_event()) {
+        heap.emplace(SortKey(*readers.back()->event()), readers.size() - 1);
+      }
+    }
+  }
+  while (!heap.empty()) {
+    {
+      util::ScopedTimer timer(&merge_seconds);
+      while (!heap.empty() && batch.size() < kEventsPerBatch) {
+        RunReader* reader = readers[heap.top().second].get();
+        const size_t run_index = heap.top().second;
+        heap.pop();
+        batch.push_back(std::move(*reader->event()));
+        reader->Next();
+        if (reader->has_event()) {
+          heap.emplace(SortKey(*reader->event()), run_index);
+        }
+      }
+    }
+    consume(batch);
+    batch.clear();
+  }
+  bool is_ok = true;
+  for (const std::unique_ptr<RunReader>& reader : readers) {
+    is_ok = is_ok && reader->is_ok();
+  }
+  if (stats_ != nullptr) {
+    stats_->AddTime("merge", merge_seconds);
+  }
+  if (!is_ok) {
+    return util::Status(Code::EXTERNAL,
+                        util::StrCat(kReadErr, spill_directory_));
+  }
+  return util::Status::OK;
+}
+
+}  // namespace morphie
@@ -0,0 +1,98 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A PlasoEventSorter sorts a stream of Plaso events by timestamp with an
+// external merge sort, so that a super-timeline whose events are not ordered,
+// such as the output of several Plaso parsers, can be added to a graph in
+// order of time in bounded memory. Events are collected in runs of a fixed
+// number of events. A full run is sorted and spilled to a temporary file, and
+// the runs are merged when all events have been added. If all events fit in
+// one run, nothing is spilled.
+//
+// The order is stable: events without a timestamp come first, and events with
+// equal timestamps keep the order in which they were added.
+//
+// Example.
+//   PlasoEventSorter sorter(1000000, "/tmp", nullptr);
+//   for (PlasoEvent& event : events) {
+//     util::Status status = sorter.Add(&event);
+//     ...
+//   }
+//   util::Status status = sorter.Merge(
+//       [&graph](const std::vector<PlasoEvent>& sorted_events) {
+//         graph.ProcessEvents(sorted_events);
+//       });
+#ifndef LOGLE_PLASO_EVENT_SORTER_H_
+#define LOGLE_PLASO_EVENT_SORTER_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "base/string.h"
+#include "plaso_event.pb.h"
+#include "util/stats.h"
+#include "util/status.h"
+
+namespace morphie {
+
+class PlasoEventSorter {
+ public:
+  // Constructs a sorter that holds at most 'events_per_run' events in memory
+  // while events are added and spills runs to temporary files in the
+  // directory 'spill_directory'. A spilled file is removed from the directory
+  // when it is created and is kept open until the sorter is destroyed, so
+  // that no file outlives the sorter and one file descriptor is used per run.
+  // If 'stats' is not null, the time spent sorting and spilling runs is added
+  // to its phase "sort", and the time spent merging runs, which does not
+  // include the time of the function passed to Merge(), to its phase "merge".
+  // - Crashes unless 'events_per_run' is positive.
+  PlasoEventSorter(int64_t events_per_run, const string& spill_directory,
+                   util::Stats* stats);
+  ~PlasoEventSorter();
+  PlasoEventSorter(const PlasoEventSorter&) = delete;
+  PlasoEventSorter& operator=(const PlasoEventSorter&) = delete;
+
+  // Moves '*event' into the current run, which is spilled if it is full.
+  // Returns
+  // - Status::EXTERNAL - if a run could not be spilled, in which case the
+  //   sorter is unusable.
+  // - Status::OK - otherwise.
+  util::Status Add(PlasoEvent* event);
+
+  // Calls 'consume' with consecutive batches of the added events in sorted
+  // order, and leaves the sorter empty. Returns
+  // - Status::EXTERNAL - if a run could not be spilled or read back.
+  // - Status::OK - otherwise.
+  util::Status Merge(
+      const std::function<void(const std::vector<PlasoEvent>&)>& consume);
+
+  // Returns the number of runs that have been spilled.
+  int NumSpilledRuns() const { return static_cast<int>(run_files_.size()); }
+
+ private:
+  // Sorts the current run and writes it to a new temporary file.
+  util::Status SpillRun();
+
+  const int64_t events_per_run_;
+  const string spill_directory_;
+  util::Stats* const stats_;
+  std::vector<PlasoEvent> run_;
+  // The file descriptors of the spilled runs, in the order of the runs.
+  std::vector<int> run_files_;
+};
+
+}  // namespace morphie
+
+#endif  // LOGLE_PLASO_EVENT_SORTER_H_
@@ -0,0 +1,106 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_event_sorter.h"
+
+#include <utility>
+#include <vector>
+
+#include "gtest.h"
+#include "plaso_event.pb.h"
+
+namespace morphie {
+namespace {
+
+// Sorts events with the timestamps 'timestamps', where a negative timestamp
+// stands for an event without one, in runs of 'events_per_run' events. Returns
+// the pairs of the timestamp and the input position of the sorted events, and
+// sets '*num_spilled_runs'.
+std::vector<std::pair<int64_t, int>> Sort(
+    const std::vector<int64_t>& timestamps, int64_t events_per_run,
+    int* num_spilled_runs) {
+  util::Stats stats;
+  PlasoEventSorter sorter(events_per_run, "/tmp", &stats);
+  for (size_t i = 0; i < timestamps.size(); ++i) {
+    PlasoEvent event;
+    if (timestamps[i] >= 0) {
+      event.set_timestamp(timestamps[i]);
+    }
+    event.set_desc(std::to_string(i));
+    EXPECT_TRUE(sorter.Add(&event).ok());
+  }
+  *num_spilled_runs = sorter.NumSpilledRuns();
+  std::vector<std::pair<int64_t, int>> sorted;
+  util::Status status =
+      sorter.Merge([&sorted](const std::vector<PlasoEvent>& events) {
+        for (const PlasoEvent& event : events) {
+          sorted.emplace_back(event.has_timestamp() ? event.timestamp() : -1,
+                              std::stoi(event.desc()));
+        }
+      });
+  EXPECT_TRUE(status.ok());
+  return sorted;
+}
+
+TEST(PlasoEventSorterTest, SortsEventsInMemory) {
+  int num_spilled_runs = 0;
+  EXPECT_EQ((std::vector<std::pair<int64_t, int>>{
+                {-1, 3}, {1, 2}, {2, 0}, {2, 4}, {3, 1}}),
+            Sort({2, 3, 1, -1, 2}, 10, &num_spilled_runs));
+  EXPECT_EQ(0, num_spilled_runs);
+}
+
+// Events with equal timestamps keep their order across runs.
+TEST(PlasoEventSorterTest, MergesSpilledRuns) {
+  int num_spilled_runs = 0;
+  EXPECT_EQ((std::vector<std::pair<int64_t, int>>{{-1, 5},
+                                                   {1, 2},
+                                                   {2, 0},
+                                                   {2, 4},
+                                                   {2, 6},
+                                                   {3, 1},
+                                                   {5, 3}}),
+            Sort({2, 3, 1, 5, 2, -1, 2}, 2, &num_spilled_runs));
+  EXPECT_EQ(3, num_spilled_runs);
+}
+
+// The consumer is called with batches of bounded size.
+TEST(PlasoEventSorterTest, MergesManyEvents) {
+  std::vector<int64_t> timestamps;
+  for (int i = 0; i < 5000; ++i) {
+    timestamps.push_back((i * 7919) % 5000);
+  }
+  int num_spilled_runs = 0;
+  std::vector<std::pair<int64_t, int>> sorted =
+      Sort(timestamps, 1000, &num_spilled_runs);
+  EXPECT_EQ(5, num_spilled_runs);
+  ASSERT_EQ(5000, sorted.size());
+  for (int i = 0; i < 5000; ++i) {
+    EXPECT_EQ(i, sorted[i].first);
+  }
+}
+
+TEST(PlasoEventSorterTest, ReportsSpillErrors) {
+  PlasoEventSorter sorter(1, "/nonexistent-logle-directory", nullptr);
+  PlasoEvent event;
+  EXPECT_EQ(Code::EXTERNAL, sorter.Add(&event).code());
+}
+
+TEST(PlasoEventSorterDeathTest, RequiresPositiveRuns) {
+  EXPECT_DEATH({ PlasoEventSorter sorter(0, "/tmp", nullptr); },
+               "The number of events of a run must be positive.");
+}
+
+}  // namespace
+}  // namespace morphie
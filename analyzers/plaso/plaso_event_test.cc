@@ -16,9 +16,11 @@
 
 #include <cstdint>
 #include <map>
+#include <vector>
 
 #include "analyzers/plaso/plaso_defs.h"
 #include "base/string.h"
+#include "graph/ast.h"
 #include "graph/type.h"
 #include "graph/type_checker.h"
 #include "gtest.h"
@@ -462,5 +464,90 @@ TEST_F(PlasoEventTest, FileMessageToAST) {
             file_ast.c_ast().arg(0).c_ast().arg(1).p_ast().val().string_val());
 }
 
+TEST_F(PlasoEventTest, FileMessageToASTOnArena) {
+  File file;
+  google::protobuf::Arena arena;
+  EXPECT_TRUE(ast::Equal(plaso::ToAST(file), *plaso::ToAST(file, &arena)));
+  file.set_filename("foo.txt");
+  file.mutable_directory()->add_path("/");
+  file.mutable_directory()->add_path("usr");
+  AST* file_ast = plaso::ToAST(file, &arena);
+  EXPECT_EQ(&arena, file_ast->GetArena());
+  EXPECT_TRUE(ast::Equal(plaso::ToAST(file), *file_ast));
+}
+
+// The parser constructs the events that ParseJSON constructs, for events of
+// every kind of processing, and skips events without the required fields.
+TEST_F(PlasoEventTest, EventParserMatchesParseJSON) {
+  const std::vector<string> lines = {
+      R"({"timestamp": 1333412795000000, "timestamp_desc": "Chrome History",)"
+      R"( "data_type": "chrome:history:file_downloaded", "ignored": [{}],)"
+      R"( "url": "http://a.org/f.txt", "full_path": "/target/f.txt",)"
+      R"( "display_name": "/some/chrome/history/file"})",
+      R"({"timestamp": 1.5e9, "timestamp_desc": "Last Visited Time",)"
+      R"( "data_type": "chrome:history:page_visited", "from_visit": null,)"
+      R"( "url": "http://b.org/\u00e9", "display_name": "C:/history"})",
+      R"({"timestamp": -1000, "timestamp_desc": "Event Time",)"
+      R"( "data_type": "windows:evtx:record", "event_identifier": 4624,)"
+      R"( "source_name": "C:/Windows/System32/lsass.exe",)"
+      R"( "display_name": "Security.evtx"})",
+      R"({"timestamp": 5, "timestamp_desc": "Bookmark",)"
+      R"( "data_type": "firefox:places:bookmark", "display_name": "/"})",
+      R"({"timestamp": 5, "timestamp_desc": "Other", "data_type": "other",)"
+      R"( "display_name": "/f", "data_type": "macosx:application_usage",)"
+      R"( "application": "Finder"})"};
+  plaso::EventParser parser;
+  PlasoEvent parsed;
+  for (const string& line : lines) {
+    ASSERT_TRUE(reader.parse(line, json_doc)) << line;
+    ASSERT_TRUE(parser.Parse(line.data(), line.data() + line.size(), &parsed))
+        << line;
+    EXPECT_EQ(plaso::ParseJSON(json_doc).SerializeAsString(),
+              parsed.SerializeAsString())
+        << line;
+  }
+  EXPECT_EQ(EventType::APPLICATION_EXECUTED, parsed.type());
+  EXPECT_EQ("Finder", parsed.application_name());
+  string line = R"({"timestamp": 5, "data_type": "other", "display_name": ""})";
+  EXPECT_FALSE(parser.Parse(line.data(), line.data() + line.size(), &parsed));
+}
+
+TEST_F(PlasoEventTest, SubstringSearchFindsSkippedTypes) {
+  for (const string& line :
+       {string(R"({"timestamp": 1, "data_type" : "firefox:cache:record"})"),
+        string("{\"data_type\":\t\"firefox:places:bookmark\"}")}) {
+    EXPECT_TRUE(plaso::HasSkipDataType(line.data(), line.data() + line.size()))
+        << line;
+  }
+  for (const string& line :
+       {string(R"({"data_type": "fs:stat"})"),
+        string(R"({"data_type": "firefox:cache\u003arecord"})"),
+        string(R"({"data_type": "firefox:cache:record")"
+               R"(, "extra": {"data_type": "fs:stat"}})"),
+        string(R"({"message": "data_type", "type": "firefox:cache:record"})"),
+        string(R"({"data_type": 1})"), string(R"({"data_type": "firefox)"),
+        string(R"({"data_type": "firefox:cache:recor"})"),
+        string(R"({"data_type": "firefox:cache:records"})"),
+        string(R"({"data_type": ""})")}) {
+    EXPECT_FALSE(plaso::HasSkipDataType(line.data(), line.data() + line.size()))
+        << line;
+  }
+}
+
+TEST(PlasoEventDeathTest, EventParserRequiresJSONObject) {
+  plaso::EventParser parser;
+  PlasoEvent event;
+  string line = "{\"timestamp\": 5";
+  EXPECT_DEATH(
+      { parser.Parse(line.data(), line.data() + line.size(), &event); },
+      "Line is not in JSON format");
+  line = R"({"timestamp": 5, "timestamp_desc": "Download",)"
+         R"( "data_type": "chrome:history:file_downloaded",)"
+         R"( "display_name": "/f", "url": "http://a.org"})";
+  EXPECT_DEATH(
+      { parser.Parse(line.data(), line.data() + line.size(), &event); },
+      "No field named full_path");
+}
+
 }  // namespace
 }  // namespace morphie
@@ -0,0 +1,282 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A benchmark of the stages in which Plaso input is turned into a graph. The
+// benchmark generates a synthetic corpus of Plaso events in JSON stream format
+// and runs each stage on the output of the previous one:
+//  - StreamJson: reading the lines of the corpus into Json::Value objects.
+//  - ParseJSON: converting the objects into PlasoEvent protos.
+//  - EventParser: converting the lines directly into PlasoEvent protos, which
+//    is the alternative to the two stages above used by the JSON stream
+//    pipeline.
+//  - ProcessEvent: adding the events to a PlasoEventGraph.
+//  - AddTemporalEdges: adding the temporal edges to the graph.
+// For each stage, the benchmark reports the running time, the number of
+// events per second, the number of heap allocations and of allocated bytes per
+// event and the peak resident set size of the process during the stage. The
+// peak is reset before each stage where the kernel supports it, and is the
+// peak since the start of the process otherwise. Allocations are counted by
+// the hooks of util/alloc_hooks.cc, which the benchmark links.
+//
+// The events of the corpus use files and URLs drawn from pools whose size is
+// set by --num_files. The n-th most frequent resource is used with a
+// probability proportional to 1/n^s, where s is --file_skew, so a skew of 0
+// draws resources uniformly and a larger skew reuses a few resources more.
+//
+// Example.
+//   plaso_ingest_benchmark --num_events=1000000 --file_skew=1.1
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "analyzers/plaso/plaso_event.h"
+#include "analyzers/plaso/plaso_event_graph.h"
+#include "base/string.h"
+#include "gflags/gflags.h"
+#include "json/json.h"
+#include "plaso_event.pb.h"
+#include "util/alloc_profile.h"
+#include "util/json_reader.h"
+#include "util/memory_usage.h"
+#include "util/string_utils.h"
+
+DEFINE_int64(num_events, 1000000, "The number of events in the corpus.");
+DEFINE_int64(num_files, 10000, "The number of distinct files and of URLs.");
+DEFINE_double(file_skew, 1.0,
+              "The exponent of the Zipf distribution of file and URL uses.");
+DEFINE_int64(seed, 1, "The seed of the corpus generator.");
+DEFINE_string(corpus_file, "",
+              "If not empty, the corpus is also written to this file.");
+
+namespace morphie {
+namespace {
+
+// The Plaso types of the generated events and the names of the members with a
+// file and with URLs that each type requires, or null if a type requires no
+// such member. The values of these members are drawn from the pools.
+struct EventKind {
+  const char* data_type;
+  const char* file_field;
+  const char* url_field;
+  const char* referrer_field;
+};
+
+const EventKind kEventKinds[] = {
+    {"chrome:history:file_downloaded", "full_path", "url", nullptr},
+    {"chrome:history:page_visited", nullptr, "url", "from_visit"},
+    {"firefox:places:page_visited", nullptr, "url", nullptr},
+    {"windows:prefetch:execution", "executable", nullptr, nullptr},
+    {"windows:registry:appcompatcache", "path", nullptr, nullptr},
+    {"fs:stat", nullptr, nullptr, nullptr},
+    {"firefox:cache:record", nullptr, nullptr, nullptr},
+};
+
+// Draws integers in [0, n) where i has a probability proportional to
+// 1/(i+1)^skew.
+class ZipfDistribution {
+ public:
+  ZipfDistribution(int64_t n, double skew) : cdf_(n) {
+    double sum = 0;
+    for (int64_t i = 0; i < n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+      cdf_[i] = sum;
+    }
+    for (double& p : cdf_) {
+      p /= sum;
+    }
+  }
+
+  int64_t operator()(std::mt19937_64* generator) {
+    double p = std::uniform_real_distribution<double>(0, 1)(*generator);
+    auto it = std::lower_bound(cdf_.begin(), cdf_.end(), p);
+    return std::min<int64_t>(it - cdf_.begin(), cdf_.size() - 1);
+  }
+
+ private:
+  std::vector<double> cdf_;
+};
+
+// Returns a corpus of 'num_events' lines. Timestamps are in nanoseconds and
+// mostly increase, with some events out of order as in merged Plaso output.
+std::vector<string> GenerateCorpus(int64_t num_events, int64_t num_files,
+                                   double skew, int64_t seed) {
+  std::mt19937_64 generator(seed);
+  ZipfDistribution resource(num_files, skew);
+  std::uniform_int_distribution<size_t> kind(
+      0, sizeof(kEventKinds) / sizeof(kEventKinds[0]) - 1);
+  std::uniform_int_distribution<int64_t> jitter(-5000000000, 5000000000);
+  std::vector<string> corpus;
+  corpus.reserve(num_events);
+  int64_t timestamp = 1400000000000000000;
+  for (int64_t i = 0; i < num_events; ++i) {
+    const EventKind& event_kind = kEventKinds[kind(generator)];
+    timestamp += 1000000000;
+    string line = util::StrCat(R"({"data_type": ")", event_kind.data_type,
+                               R"(", "timestamp": )");
+    util::StrAppend(&line, timestamp + jitter(generator),
+                    R"(, "timestamp_desc": "Last Access Time", )");
+    util::StrAppend(&line, R"("display_name": "OS:/Users/user/Library/db)",
+                    i % 16, R"(", )");
+    if (event_kind.file_field != nullptr) {
+      util::StrAppend(&line, "\"", event_kind.file_field,
+                      R"(": "/Users/user/Downloads/dir)");
+      int64_t file = resource(&generator);
+      util::StrAppend(&line, file % 97, "/file", file, R"(.dat", )");
+    }
+    for (const char* url_field :
+         {event_kind.url_field, event_kind.referrer_field}) {
+      if (url_field != nullptr) {
+        util::StrAppend(&line, "\"", url_field,
+                        R"(": "https://site.example/page)",
+                        std::to_string(resource(&generator)), R"(", )");
+      }
+    }
+    util::StrAppend(&line, R"("message": "Synthetic event )",
+                    std::to_string(i), R"(", "parser": "benchmark"})");
+    corpus.push_back(std::move(line));
+  }
+  return corpus;
+}
+
+// Measures the stages that are run between the construction of a Stage and
+// the call to Finish.
+class Stage {
+ public:
+  explicit Stage(const string& name)
+      : name_(name), is_peak_reset_(util::ResetPeakResidentSetSize()) {
+    start_allocations_ = util::ThreadAllocationCounts();
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  // Prints the measurements of the stage, which processed 'num_events'.
+  void Finish(int64_t num_events) {
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start_;
+    util::AllocationCounts allocations =
+        util::ThreadAllocationCounts() - start_allocations_;
+    const double events = static_cast<double>(std::max<int64_t>(num_events, 1));
+    std::cout << std::left << std::setw(18) << name_ << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10)
+              << seconds.count() << " s" << std::setprecision(0)
+              << std::setw(14)
+              << (seconds.count() > 0 ? num_events / seconds.count() : 0)
+              << " events/s" << std::setprecision(1) << std::setw(8)
+              << allocations.allocations / events << " allocs/event"
+              << std::setprecision(0) << std::setw(8)
+              << allocations.bytes / events << " B/event"
+              << std::setprecision(1) << std::setw(10)
+              << util::PeakResidentSetSizeMiB() << " MiB peak RSS"
+              << (is_peak_reset_ ? "" : " since start") << std::endl;
+  }
+
+ private:
+  const string name_;
+  const bool is_peak_reset_;
+  util::AllocationCounts start_allocations_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+int RunBenchmark() {
+  util::SetAllocationProfiling(true);
+  std::vector<string> corpus = GenerateCorpus(
+      FLAGS_num_events, std::max<int64_t>(FLAGS_num_files, 1),
+      FLAGS_file_skew, FLAGS_seed);
+  string text;
+  for (const string& line : corpus) {
+    util::StrAppend(&text, line, "\n");
+  }
+  if (!FLAGS_corpus_file.empty()) {
+    std::ofstream corpus_file(FLAGS_corpus_file);
+    corpus_file << text;
+  }
+  std::cout << "Corpus: " << corpus.size() << " events, " << text.size()
+            << " bytes" << std::endl;
+
+  std::vector<Json::Value> json_events;
+  json_events.reserve(corpus.size());
+  {
+    Stage stage("StreamJson");
+    std::istringstream stream(text);
+    StreamJson json_stream(&stream);
+    while (json_stream.HasNext()) {
+      json_events.push_back(*json_stream.Next());
+    }
+    stage.Finish(json_events.size());
+  }
+  text.clear();
+  text.shrink_to_fit();
+
+  std::vector<PlasoEvent> events;
+  events.reserve(json_events.size());
+  {
+    Stage stage("ParseJSON");
+    for (const Json::Value& json_event : json_events) {
+      events.push_back(plaso::ParseJSON(json_event));
+    }
+    stage.Finish(events.size());
+  }
+  json_events.clear();
+  json_events.shrink_to_fit();
+
+  {
+    Stage stage("EventParser");
+    plaso::EventParser parser;
+    PlasoEvent event;
+    int64_t num_parsed = 0;
+    for (const string& line : corpus) {
+      if (parser.Parse(line.data(), line.data() + line.size(), &event)) {
+        ++num_parsed;
+      }
+    }
+    stage.Finish(num_parsed);
+  }
+  corpus.clear();
+  corpus.shrink_to_fit();
+
+  PlasoEventGraph graph(false /*Do not add event source files.*/);
+  if (!graph.Initialize().ok()) {
+    std::cerr << "The graph could not be initialized.";
+    return -1;
+  }
+  {
+    Stage stage("ProcessEvent");
+    for (const PlasoEvent& event : events) {
+      graph.ProcessEvent(event);
+    }
+    stage.Finish(events.size());
+  }
+  {
+    Stage stage("AddTemporalEdges");
+    graph.AddTemporalEdges();
+    stage.Finish(events.size());
+  }
+  std::cout << "Graph: " << graph.NumNodes() << " nodes, " << graph.NumEdges()
+            << " edges" << std::endl;
+  return 0;
+}
+
+}  // namespace
+}  // namespace morphie
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return morphie::RunBenchmark();
+}
@@ -0,0 +1,34 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_test_util.h"
+
+#include "analyzers/plaso/plaso_event.h"
+
+namespace morphie {
+namespace test {
+
+PlasoEvent MakeEvent(int64_t timestamp, EventType type,
+                     const string& filename) {
+  PlasoEvent event;
+  event.set_timestamp(timestamp);
+  event.set_type(type);
+  if (!filename.empty()) {
+    *event.mutable_target_file() = plaso::ParseFilename(filename);
+  }
+  return event;
+}
+
+}  // namespace test
+}  // namespace morphie
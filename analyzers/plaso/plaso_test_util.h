@@ -0,0 +1,35 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains functions that construct Plaso events for use in tests.
+#ifndef LOGLE_ANALYZERS_PLASO_PLASO_TEST_UTIL_H_
+#define LOGLE_ANALYZERS_PLASO_PLASO_TEST_UTIL_H_
+
+#include <cstdint>
+
+#include "base/string.h"
+#include "plaso_event.pb.h"
+
+namespace morphie {
+namespace test {
+
+// Returns an event of type 'type' at 'timestamp' with the target file
+// 'filename', or no file if 'filename' is empty.
+PlasoEvent MakeEvent(int64_t timestamp, EventType type,
+                     const string& filename);
+
+}  // namespace test
+}  // namespace morphie
+
+#endif  // LOGLE_ANALYZERS_PLASO_PLASO_TEST_UTIL_H_
@@ -0,0 +1,214 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_triage.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "analyzers/plaso/plaso_event.h"
+#include "util/logging.h"
+#include "util/string_utils.h"
+#include "util/time_utils.h"
+
+namespace morphie {
+
+namespace {
+
+const char kTriageErr[] = "The length of the buckets of a triage must be "
+                          "positive and there must be at least 4 buckets.";
+
+// The precision of the distinct counts of the whole input and of a bucket,
+// whose relative standard errors are about 0.8% and 3.3%.
+const int kTotalPrecision = 14;
+const int kBucketPrecision = 10;
+// The number of entries reported for the most frequent files and the busiest
+// directories. More directories are counted than reported, which makes the
+// counts of the reported directories more accurate.
+const int kNumTopEntries = 20;
+const int kNumDirectoryCounters = 4 * kNumTopEntries;
+// The size of the count-min sketch of the most frequent files, which
+// overestimates a count by at most 0.13% of the file events with probability
+// 1 - exp(-4).
+const int kSketchWidth = 2048;
+const int kSketchDepth = 4;
+
+// Returns the index of the bucket of length 'bucket_length' that contains
+// 'timestamp', which is rounded towards negative infinity.
+int64_t BucketIndex(int64_t timestamp, int64_t bucket_length) {
+  const int64_t index = timestamp / bucket_length;
+  return timestamp % bucket_length < 0 ? index - 1 : index;
+}
+
+// Returns 'estimate' rounded to the nearest count.
+Json::Value ToCount(double estimate) {
+  return Json::Value(Json::Int64(std::llround(estimate)));
+}
+
+// Appends the entries 'entries' to the JSON array 'array', at most
+// kNumTopEntries, with the item of each entry as the member 'item_name'. If
+// 'has_type' is true, the item begins with an event type and a space, which
+// are the member "type".
+void AppendEntries(const std::vector<util::SketchEntry>& entries,
+                   const char* item_name, bool has_type, Json::Value* array) {
+  for (const util::SketchEntry& entry : entries) {
+    if (array->size() == kNumTopEntries) {
+      break;
+    }
+    Json::Value json_entry(Json::objectValue);
+    if (has_type) {
+      const size_t separator = entry.item.find(' ');
+      json_entry["type"] = entry.item.substr(0, separator);
+      json_entry[item_name] = entry.item.substr(separator + 1);
+    } else {
+      json_entry[item_name] = entry.item;
+    }
+    json_entry["count"] = Json::Value(Json::Int64(entry.count));
+    json_entry["error"] = Json::Value(Json::Int64(entry.error));
+    array->append(json_entry);
+  }
+}
+
+}  // namespace
+
+PlasoTriage::Bucket::Bucket()
+    : num_events(0), files(kBucketPrecision), urls(kBucketPrecision) {}
+
+// With at least 4 buckets, the length of the buckets never overflows: once it
+// exceeds 2^62, every timestamp falls into one of 4 buckets.
+PlasoTriage::PlasoTriage(bool show_all_sources, int64_t bucket_length,
+                         int max_buckets)
+    : show_all_sources_(show_all_sources),
+      max_buckets_(max_buckets),
+      bucket_length_(bucket_length),
+      num_events_(0),
+      num_untimed_events_(0),
+      files_(kTotalPrecision),
+      urls_(kTotalPrecision),
+      frequent_files_(kNumTopEntries, kSketchWidth, kSketchDepth),
+      directories_(kNumDirectoryCounters) {
+  CHECK(bucket_length > 0 && max_buckets >= 4, kTriageErr);
+}
+
+// A path is hashed once for the distinct counts of the whole input and of the
+// bucket. The directory of a file is the prefix of its path that precedes the
+// filename.
+void PlasoTriage::AddEvent(const PlasoEvent& event) {
+  ++num_events_;
+  Bucket* bucket = nullptr;
+  if (event.has_timestamp()) {
+    int64_t index = BucketIndex(event.timestamp(), bucket_length_);
+    while (buckets_.count(index) == 0 && NumBuckets() >= max_buckets_) {
+      MergeBuckets();
+      index = BucketIndex(event.timestamp(), bucket_length_);
+    }
+    bucket = &buckets_[index];
+    ++bucket->num_events;
+  } else {
+    ++num_untimed_events_;
+  }
+  std::vector<const File*> files;
+  if (show_all_sources_ && event.has_event_source_file()) {
+    files.push_back(&event.event_source_file());
+  }
+  if (event.has_source_file()) {
+    files.push_back(&event.source_file());
+  }
+  if (event.has_target_file()) {
+    files.push_back(&event.target_file());
+  }
+  const string& type = EventType_Name(event.type());
+  for (const File* file : files) {
+    const string path = plaso::ToString(*file);
+    const uint64_t hash = util::SketchHash(path);
+    files_.AddHash(hash);
+    if (bucket != nullptr) {
+      bucket->files.AddHash(hash);
+    }
+    frequent_files_.Add(util::StrCat(type, " ", path));
+    if (file->has_directory()) {
+      directories_.Add(path.substr(0, path.size() - file->filename().size()));
+    }
+  }
+  for (const string* url : {&event.source_url(), &event.target_url()}) {
+    if (url->empty()) {
+      continue;
+    }
+    const uint64_t hash = util::SketchHash(*url);
+    urls_.AddHash(hash);
+    if (bucket != nullptr) {
+      bucket->urls.AddHash(hash);
+    }
+  }
+}
+
+void PlasoTriage::MergeBuckets() {
+  bucket_length_ *= 2;
+  std::map<int64_t, Bucket> buckets;
+  for (auto& bucket : buckets_) {
+    const int64_t index = BucketIndex(bucket.first, 2);
+    auto merged_it = buckets.find(index);
+    if (merged_it == buckets.end()) {
+      buckets.emplace(index, std::move(bucket.second));
+      continue;
+    }
+    Bucket& merged = merged_it->second;
+    merged.num_events += bucket.second.num_events;
+    merged.files.Merge(bucket.second.files);
+    merged.urls.Merge(bucket.second.urls);
+  }
+  buckets_.swap(buckets);
+}
+
+Json::Value PlasoTriage::Report() const {
+  Json::Value report(Json::objectValue);
+  report["events"] = Json::Value(Json::Int64(num_events_));
+  report["events_without_timestamp"] =
+      Json::Value(Json::Int64(num_untimed_events_));
+  report["distinct_files"] = ToCount(files_.Estimate());
+  report["distinct_urls"] = ToCount(urls_.Estimate());
+  report["bucket_micros"] = Json::Value(Json::Int64(bucket_length_));
+  Json::Value& buckets = report["buckets"];
+  buckets = Json::Value(Json::arrayValue);
+  for (const auto& bucket : buckets_) {
+    const int64_t start = bucket.first * bucket_length_;
+    Json::Value json_bucket(Json::objectValue);
+    json_bucket["start"] = util::UnixMicrosToRFC3339(start);
+    json_bucket["start_micros"] = Json::Value(Json::Int64(start));
+    json_bucket["events"] = Json::Value(Json::Int64(bucket.second.num_events));
+    json_bucket["distinct_files"] = ToCount(bucket.second.files.Estimate());
+    json_bucket["distinct_urls"] = ToCount(bucket.second.urls.Estimate());
+    buckets.append(json_bucket);
+  }
+  Json::Value& frequent_files = report["frequent_files"];
+  frequent_files = Json::Value(Json::arrayValue);
+  AppendEntries(frequent_files_.Top(), "file", true, &frequent_files);
+  Json::Value& directories = report["busiest_directories"];
+  directories = Json::Value(Json::arrayValue);
+  AppendEntries(directories_.Top(), "directory", false, &directories);
+  return report;
+}
+
+size_t PlasoTriage::MemoryUsage() const {
+  size_t bytes = files_.MemoryUsage() + urls_.MemoryUsage() +
+                 frequent_files_.MemoryUsage() + directories_.MemoryUsage();
+  for (const auto& bucket : buckets_) {
+    bytes += sizeof(bucket) + bucket.second.files.MemoryUsage() +
+             bucket.second.urls.MemoryUsage();
+  }
+  return bytes;
+}
+
+}  // namespace morphie
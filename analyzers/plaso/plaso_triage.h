@@ -0,0 +1,119 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A PlasoTriage summarizes a stream of Plaso events without building a graph,
+// so that the time windows of a large super-timeline that are worth a graph
+// can be chosen before one is built. The summary consists of probabilistic
+// sketches (see util/sketches.h), which use memory that does not depend on the
+// number of events:
+//  - the estimated number of distinct files and URLs, in total and in each
+//    bucket of time,
+//  - the most frequent pairs of an event type and a file, and
+//  - the directories with the most file events.
+// The files of an event are the files that PlasoEventGraph adds for it.
+//
+// Example.
+//   PlasoTriage triage(false, 3600 * 1000000LL, 1024);
+//   for (const PlasoEvent& event : events) {
+//     triage.AddEvent(event);
+//   }
+//   Json::Value report = triage.Report();
+#ifndef LOGLE_PLASO_TRIAGE_H_
+#define LOGLE_PLASO_TRIAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+#include "base/string.h"
+#include "json/json.h"
+#include "plaso_event.pb.h"
+#include "util/sketches.h"
+
+namespace morphie {
+
+class PlasoTriage {
+ public:
+  // Constructs a triage that summarizes events in buckets of 'bucket_length'
+  // microseconds, and keeps at most 'max_buckets' buckets. When an event
+  // falls into a bucket that would exceed that number, the length of the
+  // buckets is doubled and pairs of adjacent buckets are merged until it does
+  // not. If 'show_all_sources' is true, the source file of an event is one of
+  // its files, as in a PlasoEventGraph.
+  // - Crashes unless 'bucket_length' is positive and 'max_buckets' is at
+  //   least 4.
+  PlasoTriage(bool show_all_sources, int64_t bucket_length, int max_buckets);
+  PlasoTriage(const PlasoTriage&) = delete;
+  PlasoTriage& operator=(const PlasoTriage&) = delete;
+
+  // Adds 'event' to the summary. An event without a timestamp is summarized
+  // in the totals only.
+  void AddEvent(const PlasoEvent& event);
+
+  int64_t NumEvents() const { return num_events_; }
+  int64_t BucketLength() const { return bucket_length_; }
+  int NumBuckets() const { return static_cast<int>(buckets_.size()); }
+
+  // Returns the summary as a JSON object with the members
+  //  - "events" and "events_without_timestamp", the numbers of events,
+  //  - "distinct_files" and "distinct_urls", the estimated numbers of
+  //    distinct files and URLs,
+  //  - "bucket_micros", the length of the buckets,
+  //  - "buckets", an array of the buckets with events in order of time, each
+  //    with the members "start", its first time in RFC 3339 format,
+  //    "start_micros", "events", "distinct_files" and "distinct_urls",
+  //  - "frequent_files", an array of the most frequent pairs of an event type
+  //    and a file by decreasing count, each with the members "type", "file",
+  //    "count" and "error", and
+  //  - "busiest_directories", an array of the directories with the most file
+  //    events by decreasing count, each with the members "directory", "count"
+  //    and "error".
+  // A count exceeds the true count by at most its error, which for frequent
+  // files holds with high probability.
+  Json::Value Report() const;
+
+  // Returns the estimated memory of the summary in bytes.
+  size_t MemoryUsage() const;
+
+ private:
+  // The number of events in a bucket of time and the sketches of their
+  // distinct files and URLs.
+  struct Bucket {
+    Bucket();
+
+    int64_t num_events;
+    util::HyperLogLog files;
+    util::HyperLogLog urls;
+  };
+
+  // Doubles the length of the buckets and merges adjacent buckets.
+  void MergeBuckets();
+
+  const bool show_all_sources_;
+  const int max_buckets_;
+  int64_t bucket_length_;
+  int64_t num_events_;
+  int64_t num_untimed_events_;
+  util::HyperLogLog files_;
+  util::HyperLogLog urls_;
+  util::HeavyHitters frequent_files_;
+  util::TopK directories_;
+  // The buckets with events by their index, which is the floor of the
+  // quotient of their start time and the length of the buckets.
+  std::map<int64_t, Bucket> buckets_;
+};
+
+}  // namespace morphie
+
+#endif  // LOGLE_PLASO_TRIAGE_H_
@@ -0,0 +1,128 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "analyzers/plaso/plaso_triage.h"
+
+#include <vector>
+
+#include "analyzers/plaso/plaso_event.h"
+#include "analyzers/plaso/plaso_test_util.h"
+#include "gtest.h"
+#include "plaso_event.pb.h"
+
+namespace morphie {
+namespace {
+
+using test::MakeEvent;
+
+// Returns the members 'member' of the objects in the JSON array 'array'.
+std::vector<string> Members(const Json::Value& array, const char* member) {
+  std::vector<string> members;
+  for (const Json::Value& element : array) {
+    members.push_back(element[member].asString());
+  }
+  return members;
+}
+
+// With few distinct files and URLs, the distinct counts are exact.
+TEST(PlasoTriageTest, SummarizesEventsInBuckets) {
+  PlasoTriage triage(false, 100, 16);
+  for (int i = 0; i < 30; ++i) {
+    triage.AddEvent(MakeEvent(i * 10, EventType::FILE_ACCESSED,
+                              i % 3 == 0 ? "/tmp/a.txt" : "/var/log/b.log"));
+  }
+  triage.AddEvent(MakeEvent(5, EventType::FILE_CREATED, "/tmp/c.txt"));
+  PlasoEvent visit = MakeEvent(250, EventType::PAGE_VISITED, "");
+  visit.set_source_url("http://example.com");
+  triage.AddEvent(visit);
+  visit.clear_timestamp();
+  triage.AddEvent(visit);
+  EXPECT_EQ(33, triage.NumEvents());
+  EXPECT_EQ(3, triage.NumBuckets());
+  const Json::Value report = triage.Report();
+  EXPECT_EQ(33, report["events"].asInt64());
+  EXPECT_EQ(1, report["events_without_timestamp"].asInt64());
+  EXPECT_EQ(3, report["distinct_files"].asInt64());
+  EXPECT_EQ(1, report["distinct_urls"].asInt64());
+  EXPECT_EQ(100, report["bucket_micros"].asInt64());
+  const Json::Value& buckets = report["buckets"];
+  ASSERT_EQ(3, buckets.size());
+  EXPECT_EQ(100, buckets[1]["start_micros"].asInt64());
+  EXPECT_EQ("1970-01-01T00:00:00+00:00", buckets[1]["start"].asString());
+  EXPECT_EQ(11, buckets[0]["events"].asInt64());
+  EXPECT_EQ(3, buckets[0]["distinct_files"].asInt64());
+  EXPECT_EQ(0, buckets[0]["distinct_urls"].asInt64());
+  EXPECT_EQ(11, buckets[2]["events"].asInt64());
+  EXPECT_EQ(1, buckets[2]["distinct_urls"].asInt64());
+  const Json::Value& frequent_files = report["frequent_files"];
+  EXPECT_EQ(
+      std::vector<string>({"/var/log/b.log", "/tmp/a.txt", "/tmp/c.txt"}),
+      Members(frequent_files, "file"));
+  EXPECT_EQ("FILE_ACCESSED", frequent_files[0]["type"].asString());
+  EXPECT_EQ(20, frequent_files[0]["count"].asInt64());
+  EXPECT_EQ("FILE_CREATED", frequent_files[2]["type"].asString());
+  const Json::Value& directories = report["busiest_directories"];
+  EXPECT_EQ(std::vector<string>({"/var/log/", "/tmp/"}),
+            Members(directories, "directory"));
+  EXPECT_EQ(11, directories[1]["count"].asInt64());
+  EXPECT_EQ(0, directories[1]["error"].asInt64());
+}
+
+// The source file of an event is only one of its files if all sources are
+// shown.
+TEST(PlasoTriageTest, CountsSourceFilesOfAllSources) {
+  PlasoEvent event = MakeEvent(0, EventType::DEFAULT, "");
+  *event.mutable_event_source_file() = plaso::ParseFilename("/tmp/source");
+  PlasoTriage triage(false, 100, 16);
+  triage.AddEvent(event);
+  EXPECT_EQ(0, triage.Report()["distinct_files"].asInt64());
+  PlasoTriage all_sources_triage(true, 100, 16);
+  all_sources_triage.AddEvent(event);
+  EXPECT_EQ(1, all_sources_triage.Report()["distinct_files"].asInt64());
+}
+
+// Buckets are merged in pairs when an event would exceed the maximum number of
+// buckets, which keeps the memory of the summary bounded, and buckets of
+// negative timestamps begin at a multiple of their length.
+TEST(PlasoTriageTest, MergesBuckets) {
+  PlasoTriage triage(false, 10, 4);
+  for (int64_t timestamp = 0; timestamp < 40; timestamp += 10) {
+    triage.AddEvent(MakeEvent(timestamp, EventType::FILE_CREATED, "/tmp/a"));
+  }
+  const size_t memory = triage.MemoryUsage();
+  for (int64_t timestamp = 40; timestamp < 100; timestamp += 10) {
+    triage.AddEvent(MakeEvent(timestamp, EventType::FILE_CREATED, "/tmp/a"));
+  }
+  EXPECT_EQ(40, triage.BucketLength());
+  EXPECT_EQ(3, triage.NumBuckets());
+  EXPECT_GE(memory, triage.MemoryUsage());
+  triage.AddEvent(MakeEvent(-5, EventType::FILE_CREATED, "/tmp/a"));
+  const Json::Value buckets = triage.Report()["buckets"];
+  ASSERT_EQ(4, buckets.size());
+  EXPECT_EQ(-40, buckets[0]["start_micros"].asInt64());
+  EXPECT_EQ(1, buckets[0]["events"].asInt64());
+  EXPECT_EQ(4, buckets[1]["events"].asInt64());
+  EXPECT_EQ(4, buckets[2]["events"].asInt64());
+  EXPECT_EQ(2, buckets[3]["events"].asInt64());
+}
+
+TEST(PlasoTriageDeathTest, RequiresPositiveBuckets) {
+  EXPECT_DEATH({ PlasoTriage triage(false, 0, 16); },
+               "The length of the buckets of a triage must be positive");
+  EXPECT_DEATH({ PlasoTriage triage(false, 10, 3); },
+               "there must be at least 4 buckets.");
+}
+
+}  // namespace
+}  // namespace morphie
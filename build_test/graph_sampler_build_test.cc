@@ -0,0 +1,39 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Samples the nodes of a small graph and prints the size of the sample.
+#include <iostream>
+
+#include "ast.pb.h"
+#include "graph_sampler.h"
+#include "labeled_graph.h"
+#include "morphism.h"
+#include "type.h"
+#include "value.h"
+
+int main(int argc, char **argv) {
+  morphie::LabeledGraph graph;
+  morphie::AST ast = morphie::ast::type::MakeInt("int label", false);
+  morphie::TaggedAST tast;
+  tast.set_tag("num");
+  graph.Initialize({{"num", ast}}, {}, {}, {}, ast);
+  for (int i = 0; i < 10; ++i) {
+    *tast.mutable_ast() = morphie::ast::value::MakeInt(i);
+    graph.FindOrAddNode(tast);
+  }
+  std::unique_ptr<morphie::graph::Morphism> sample =
+      morphie::graph::SampleNodes(graph, 3, 1 /* seed */);
+  std::cout << "Sampled " << sample->Output().NumNodes() << " of "
+            << graph.NumNodes() << " nodes." << std::endl;
+}
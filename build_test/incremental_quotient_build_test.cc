@@ -0,0 +1,73 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Maintains the quotient of a graph that grows by one node and prints it.
+#include <iostream>
+#include <vector>
+
+#include "ast.pb.h"
+#include "dot_printer.h"
+#include "graph_transformer.h"
+#include "incremental_quotient.h"
+#include "labeled_graph.h"
+#include "type.h"
+#include "util/span.h"
+#include "value.h"
+
+namespace {
+
+morphie::TaggedAST CountLabel(int count) {
+  morphie::TaggedAST tast;
+  tast.set_tag("num");
+  *tast.mutable_ast() = morphie::ast::value::MakeInt(count);
+  return tast;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  morphie::LabeledGraph graph;
+  morphie::AST ast = morphie::ast::type::MakeInt("int label", false);
+  graph.Initialize({{"num", ast}}, {}, {}, {}, ast);
+  graph.FindOrAddNode(CountLabel(0));
+  morphie::graph::QuotientConfig config(
+      graph,
+      [](const morphie::LabeledGraph&, morphie::util::Span<morphie::NodeId>
+             nodes) { return CountLabel(static_cast<int>(nodes.size())); },
+      [](const morphie::LabeledGraph&, morphie::util::Span<morphie::EdgeId>) {
+        return std::vector<morphie::TaggedAST>();
+      },
+      false);
+  morphie::graph::IncrementalQuotient quotient(
+      graph, config,
+      [](const morphie::LabeledGraph&, const morphie::TaggedAST& label,
+         morphie::util::Span<morphie::NodeId> nodes) {
+        return CountLabel(label.ast().p_ast().val().int_val() +
+                          static_cast<int>(nodes.size()));
+      },
+      [](const morphie::LabeledGraph&,
+         const std::vector<morphie::TaggedAST>& labels,
+         morphie::util::Span<morphie::EdgeId>) { return labels; });
+  if (!quotient.Initialize({0}).ok()) {
+    return 1;
+  }
+  graph.FindOrAddNode(CountLabel(1));
+  if (!quotient.Update({0}, {}).ok()) {
+    return 1;
+  }
+  morphie::DotPrinter printer;
+  std::cout << "Output graph." << std::endl
+            << printer.DotGraph(quotient.Output()) << std::endl;
+  return 0;
+}
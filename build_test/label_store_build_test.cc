@@ -0,0 +1,27 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Construct a label store and intern a label.
+#include <iostream>
+
+#include "ast.pb.h"
+#include "label_store.h"
+
+int main(int argc, char **argv) {
+  morphie::LabelStore store;
+  morphie::TaggedAST label;
+  label.set_tag("label");
+  store.Intern(label);
+  std::cout << "Interned " << store.Size() << " label." << std::endl;
+}
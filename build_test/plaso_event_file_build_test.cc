@@ -0,0 +1,33 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+// Write an event to a file and read it back.
+#include <iostream>
+
+#include "plaso_event_file.h"
+
+int main(int argc, char **argv) {
+  morphie::PlasoEvent event;
+  event.set_timestamp(1);
+  morphie::PlasoEventWriter writer;
+  if (!writer.Open("/tmp/plaso_event_file_build_test").ok()) {
+    return 1;
+  }
+  writer.Write(event);
+  writer.Close();
+  morphie::PlasoEventReader reader;
+  reader.Open("/tmp/plaso_event_file_build_test");
+  if (reader.Next(&event)) {
+    std::cout << "The event is at " << event.timestamp() << "." << std::endl;
+  }
+}
@@ -0,0 +1,33 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Sort two events and print the timestamp of the first.
+#include <iostream>
+#include <vector>
+
+#include "plaso_event_sorter.h"
+
+int main(int argc, char **argv) {
+  morphie::PlasoEventSorter sorter(16, "/tmp", nullptr);
+  for (int64_t timestamp : {2, 1}) {
+    morphie::PlasoEvent event;
+    event.set_timestamp(timestamp);
+    event.set_type(morphie::EventType::FILE_CREATED);
+    sorter.Add(&event);
+  }
+  sorter.Merge([](const std::vector<morphie::PlasoEvent>& events) {
+    std::cout << "The first event is at " << events[0].timestamp() << "."
+              << std::endl;
+  });
+}
@@ -0,0 +1,28 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+// Triage one event and print the number of buckets of the summary.
+#include <iostream>
+
+#include "plaso_triage.h"
+
+int main(int argc, char **argv) {
+  morphie::PlasoTriage triage(false, 1000000, 16);
+  morphie::PlasoEvent event;
+  event.set_timestamp(0);
+  event.set_type(morphie::EventType::FILE_CREATED);
+  event.mutable_target_file()->set_filename("file.txt");
+  triage.AddEvent(event);
+  std::cout << "The triage has " << triage.NumBuckets() << " bucket."
+            << std::endl;
+}
@@ -0,0 +1,31 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Declare a label with a schema and construct a label with it.
+#include <iostream>
+
+#include "ast.pb.h"
+#include "schema.h"
+
+namespace {
+const char kCountTag[] = "Count";
+}  // namespace
+
+int main(int argc, char **argv) {
+  using CountLabel = morphie::schema::Label<
+      kCountTag, morphie::schema::Field<kCountTag, morphie::schema::Int>>;
+  morphie::TaggedAST label = CountLabel::Make(1);
+  std::cout << "Constructed a label tagged " << label.tag() << "."
+            << std::endl;
+}
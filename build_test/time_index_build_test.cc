@@ -0,0 +1,26 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+// Sort a time index and query the nodes in a range of timestamps.
+#include <iostream>
+
+#include "time_index.h"
+
+int main(int argc, char **argv) {
+  morphie::TimeIndex index;
+  index.Add(20, 1);
+  index.Add(10, 0);
+  index.Sort();
+  std::cout << "The index has " << index.NodesBetween(0, 15).size()
+            << " node before timestamp 15." << std::endl;
+}
@@ -0,0 +1,397 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// An end-to-end benchmark of the analyzers, which runs frontend::Run on
+// generated corpora. For each scale in --scales, the benchmark generates a
+// Plaso JSON stream, a mail access CSV file and a Curio JSON document in
+// --output_dir and runs the scenarios below on them. A scenario is an
+// AnalysisOptions proto, so a scenario can be rerun with the morphie tool.
+//  - plaso_dot, plaso_pbtxt: the graph of the Plaso events as DOT and as a
+//    text proto.
+//  - plaso_summary: the graph summarized to at most 1000 nodes, as DOT.
+//  - mail_dot: the access graph with an edge per access count, as DOT.
+//  - mail_aggregated_pbtxt: the access graph with aggregated edges, with the
+//    DOT graph rendered in memory and written by the frontend.
+//  - curio_dot: the stream dependency graph, as DOT.
+//  - curio_condensed_pbtxt: the graph with its cycles condensed, rendered in
+//    memory and written by the frontend.
+// For each scenario, the benchmark records the wall time, the CPU time of the
+// process, its peak resident set size, the size of the output file and the
+// phase times and counters of the stats file of the frontend. The results are
+// printed and written as JSON to --results_file, so that the results of two
+// commits can be compared. The peak resident set size is reset before each
+// scenario where the kernel supports it, and 'peak_rss_reset' is false in the
+// results otherwise. The corpora are the same for the same --seed.
+//
+// Example.
+//   end_to_end_benchmark --output_dir=/tmp/e2e --results_file=/tmp/e2e/r.json
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <google/protobuf/text_format.h>
+
+#include "analysis_options.pb.h"
+#include "base/string.h"
+#include "frontend.h"
+#include "gflags/gflags.h"
+#include "json/json.h"
+#include "util/memory_usage.h"
+#include "util/status.h"
+#include "util/string_utils.h"
+
+DEFINE_string(output_dir, "/tmp",
+              "The directory of the corpora, outputs and stats files.");
+DEFINE_string(results_file, "",
+              "If not empty, the results are written to this file as JSON.");
+DEFINE_string(scales, "small,medium,large",
+              "A comma-separated list of the scales to run: small, medium or "
+              "large.");
+DEFINE_int64(seed, 1, "The seed of the corpus generators.");
+
+namespace morphie {
+namespace {
+
+// The sizes of the corpora of a scale.
+struct Scale {
+  const char* name;
+  int64_t num_events;
+  int64_t num_accesses;
+  int64_t num_streams;
+};
+
+const Scale kScales[] = {
+    {"small", 10000, 10000, 1000},
+    {"medium", 100000, 100000, 10000},
+    {"large", 1000000, 1000000, 100000},
+};
+
+// The Plaso types of the generated events and the members with a file and
+// with URLs that each type requires, or null if it requires no such member.
+struct EventKind {
+  const char* data_type;
+  const char* file_field;
+  const char* url_field;
+  const char* referrer_field;
+};
+
+const EventKind kEventKinds[] = {
+    {"chrome:history:file_downloaded", "full_path", "url", nullptr},
+    {"chrome:history:page_visited", nullptr, "url", "from_visit"},
+    {"windows:prefetch:execution", "executable", nullptr, nullptr},
+    {"windows:registry:appcompatcache", "path", nullptr, nullptr},
+    {"fs:stat", nullptr, nullptr, nullptr},
+};
+
+// Writes 'num_events' Plaso events in JSON stream format to 'out'. The events
+// use one of num_events/10 files and URLs, so that events share nodes.
+void GeneratePlasoCorpus(int64_t num_events, int64_t seed, std::ostream* out) {
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<size_t> kind(
+      0, sizeof(kEventKinds) / sizeof(kEventKinds[0]) - 1);
+  std::uniform_int_distribution<int64_t> resource(
+      0, std::max<int64_t>(num_events / 10, 1) - 1);
+  int64_t timestamp = 1400000000000000000;
+  for (int64_t i = 0; i < num_events; ++i) {
+    const EventKind& event_kind = kEventKinds[kind(generator)];
+    timestamp += 1000000000;
+    *out << R"({"data_type": ")" << event_kind.data_type
+         << R"(", "timestamp": )" << timestamp
+         << R"(, "timestamp_desc": "Last Access Time", )"
+         << R"("display_name": "OS:/Users/user/Library/db)" << i % 16
+         << R"(", )";
+    if (event_kind.file_field != nullptr) {
+      *out << "\"" << event_kind.file_field << R"(": "/Users/user/dir)"
+           << resource(generator) % 97 << "/file" << resource(generator)
+           << R"(.dat", )";
+    }
+    for (const char* url_field :
+         {event_kind.url_field, event_kind.referrer_field}) {
+      if (url_field != nullptr) {
+        *out << "\"" << url_field << R"(": "https://site.example/page)"
+             << resource(generator) << R"(", )";
+      }
+    }
+    *out << R"("message": "Synthetic event )" << i
+         << R"(", "parser": "benchmark"})" << "\n";
+  }
+}
+
+// Writes 'num_accesses' rows of mail access logs in CSV format to 'out'. The
+// actors and accounts are drawn from pools of num_accesses/20 and
+// num_accesses/5 elements.
+void GenerateMailCorpus(int64_t num_accesses, int64_t seed,
+                        std::ostream* out) {
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<int64_t> actor(
+      0, std::max<int64_t>(num_accesses / 20, 1) - 1);
+  std::uniform_int_distribution<int64_t> account(
+      0, std::max<int64_t>(num_accesses / 5, 1) - 1);
+  std::uniform_int_distribution<int> day(1, 28);
+  std::uniform_int_distribution<int> count(1, 50);
+  *out << "fromx,tox,attr_actor_manager,attr_actor_cost_center,"
+          "attr_first_access,attr_last_access,attr_count,attr_actor_title\n";
+  for (int64_t i = 0; i < num_accesses; ++i) {
+    int64_t actor_id = actor(generator);
+    int first_day = day(generator);
+    int last_day = std::max(first_day, day(generator));
+    *out << "actor" << actor_id << "@corp.example,account"
+         << account(generator) << "@corp.example,manager" << actor_id % 50
+         << ",cc" << actor_id % 7 << ",2015-03-" << std::setw(2)
+         << std::setfill('0') << first_day << "T10:00:00Z,2015-03-"
+         << std::setw(2) << last_day << std::setfill(' ')
+         << "T18:00:00Z," << count(generator) << ",title" << actor_id % 11
+         << "\n";
+  }
+}
+
+// Writes a Curio stream to 'out' with the key and the node of the stream with
+// index 'stream' and the opening brace of its children.
+void OpenCurioStream(int64_t stream, std::ostream* out) {
+  *out << "\"[/streams/s" << stream << ":s" << stream
+       << R"(]": {"Node": {"ID": {"Package": "/streams/s)" << stream
+       << R"(", "Name": "s)" << stream << R"("}}, "Children": {)";
+}
+
+// Writes a Curio JSON document with about 'num_streams' stream trees to
+// 'out'. Each top-level stream has three producers, each of which has three
+// producers with no children, and depends on the clock. Streams are drawn
+// from a pool of num_streams/4 streams, so trees share streams and some
+// dependencies are cyclic.
+void GenerateCurioCorpus(int64_t num_streams, int64_t seed,
+                         std::ostream* out) {
+  const int kFanout = 3;
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<int64_t> stream(
+      0, std::max<int64_t>(num_streams / 4, 1) - 1);
+  const int64_t num_roots =
+      std::max<int64_t>(num_streams / (1 + kFanout + kFanout * kFanout), 1);
+  *out << "{";
+  for (int64_t root = 0; root < num_roots; ++root) {
+    *out << (root == 0 ? "\n" : ",\n");
+    OpenCurioStream(stream(generator), out);
+    *out << R"("[:clock]": {}, )";
+    for (int i = 0; i < kFanout; ++i) {
+      *out << (i == 0 ? "" : ", ");
+      OpenCurioStream(stream(generator), out);
+      for (int j = 0; j < kFanout; ++j) {
+        *out << (j == 0 ? "" : ", ");
+        OpenCurioStream(stream(generator), out);
+        *out << "}}";
+      }
+      *out << "}}";
+    }
+    *out << "}}";
+  }
+  *out << "\n}\n";
+}
+
+// Returns the size of 'filename' in bytes, or 0 if it does not exist.
+int64_t FileSize(const string& filename) {
+  struct stat file_status;
+  return stat(filename.c_str(), &file_status) == 0 ? file_status.st_size : 0;
+}
+
+// Returns the user and system CPU time of the process in seconds.
+double CPUSeconds() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Returns the scenarios of a scale, whose corpora are 'plaso_file',
+// 'mail_file' and 'curio_file'. The output and stats files of a scenario are
+// in --output_dir and named after the scenario and the scale.
+std::vector<std::pair<string, AnalysisOptions>> Scenarios(
+    const string& scale, const string& plaso_file, const string& mail_file,
+    const string& curio_file) {
+  std::vector<std::pair<string, AnalysisOptions>> scenarios;
+  auto add_scenario = [&scale, &scenarios](const string& name,
+                                           const string& analyzer) {
+    scenarios.emplace_back(name, AnalysisOptions());
+    AnalysisOptions* options = &scenarios.back().second;
+    options->set_analyzer(analyzer);
+    options->set_stats_file(
+        util::StrCat(FLAGS_output_dir, "/", name, "_", scale, ".stats.json"));
+    return options;
+  };
+  auto output_file = [&scale](const string& name, const string& extension) {
+    return util::StrCat(FLAGS_output_dir, "/", name, "_", scale, extension);
+  };
+  AnalysisOptions* options = add_scenario("plaso_dot", "plaso");
+  options->set_json_stream_file(plaso_file);
+  options->set_output_dot_file(output_file("plaso_dot", ".dot"));
+  options = add_scenario("plaso_pbtxt", "plaso");
+  options->set_json_stream_file(plaso_file);
+  options->set_output_pbtxt_file(output_file("plaso_pbtxt", ".pbtxt"));
+  options = add_scenario("plaso_summary", "plaso");
+  options->set_json_stream_file(plaso_file);
+  options->set_max_output_nodes(1000);
+  options->set_output_dot_file(output_file("plaso_summary", ".dot"));
+  options = add_scenario("mail_dot", "mail");
+  options->set_csv_file(mail_file);
+  options->set_output_dot_file(output_file("mail_dot", ".dot"));
+  options = add_scenario("mail_aggregated_pbtxt", "mail");
+  options->set_csv_file(mail_file);
+  options->mutable_mail_options()->set_aggregate_accesses(true);
+  options->set_output_pbtxt_file(
+      output_file("mail_aggregated_pbtxt", ".pbtxt"));
+  options = add_scenario("curio_dot", "curio");
+  options->set_json_file(curio_file);
+  options->set_output_dot_file(output_file("curio_dot", ".dot"));
+  options = add_scenario("curio_condensed_pbtxt", "curio");
+  options->set_json_file(curio_file);
+  options->mutable_curio_options()->set_condense_cycles(true);
+  options->set_output_pbtxt_file(
+      output_file("curio_condensed_pbtxt", ".pbtxt"));
+  return scenarios;
+}
+
+// Returns the name of the output file of 'options'.
+string OutputFile(const AnalysisOptions& options) {
+  switch (options.output_file_case()) {
+    case AnalysisOptions::kOutputDotFile:
+      return options.output_dot_file();
+    case AnalysisOptions::kOutputPbtxtFile:
+      return options.output_pbtxt_file();
+    case AnalysisOptions::kOutputPbFile:
+      return options.output_pb_file();
+    case AnalysisOptions::kOutputGraphFile:
+      return options.output_graph_file();
+    default:
+      return "";
+  }
+}
+
+// Runs the scenario 'name' with 'options' at 'scale' and returns its results.
+// The results of a failed scenario have its error message.
+Json::Value RunScenario(const string& name, const string& scale,
+                        const AnalysisOptions& options) {
+  Json::Value result(Json::objectValue);
+  result["scenario"] = name;
+  result["scale"] = scale;
+  string options_text;
+  google::protobuf::TextFormat::PrintToString(options, &options_text);
+  result["options"] = options_text;
+  const bool is_peak_reset = util::ResetPeakResidentSetSize();
+  const double start_cpu_seconds = CPUSeconds();
+  const auto start = std::chrono::steady_clock::now();
+  util::Status status = frontend::Run(options);
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+  result["ok"] = status.ok();
+  if (!status.ok()) {
+    result["error"] = status.message();
+  }
+  result["wall_seconds"] = seconds.count();
+  result["cpu_seconds"] = CPUSeconds() - start_cpu_seconds;
+  result["peak_rss_mib"] = util::PeakResidentSetSizeMiB();
+  result["peak_rss_reset"] = is_peak_reset;
+  const int64_t output_bytes = FileSize(OutputFile(options));
+  result["output_bytes"] = Json::Int64(output_bytes);
+  std::ifstream stats_file(options.stats_file());
+  Json::Value stats;
+  Json::CharReaderBuilder builder;
+  string errors;
+  if (stats_file && Json::parseFromStream(builder, stats_file, &stats,
+                                          &errors)) {
+    result["stats"] = stats;
+  }
+  std::cout << std::left << std::setw(24) << name << std::setw(8) << scale
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << seconds.count() << " s wall"
+            << std::setw(10) << result["cpu_seconds"].asDouble() << " s CPU"
+            << std::setprecision(1) << std::setw(10)
+            << result["peak_rss_mib"].asDouble() << " MiB peak RSS"
+            << std::setw(14) << output_bytes << " B output"
+            << (status.ok() ? "" : util::StrCat("  ", status.message()))
+            << std::endl;
+  return result;
+}
+
+int RunBenchmark() {
+  Json::Value results(Json::objectValue);
+  results["seed"] = Json::Int64(FLAGS_seed);
+  Json::Value& scenario_results = results["scenarios"];
+  scenario_results = Json::Value(Json::arrayValue);
+  bool all_ok = true;
+  std::vector<string> scale_names = util::SplitToVector(FLAGS_scales, ',');
+  for (const string& scale_name : scale_names) {
+    const Scale* scale =
+        std::find_if(std::begin(kScales), std::end(kScales),
+                     [&scale_name](const Scale& candidate) {
+                       return scale_name == candidate.name;
+                     });
+    if (scale == std::end(kScales)) {
+      std::cerr << "Unknown scale: " << scale_name << std::endl;
+      return -1;
+    }
+    const string prefix =
+        util::StrCat(FLAGS_output_dir, "/corpus_", scale->name);
+    const string plaso_file = util::StrCat(prefix, ".jsonl");
+    const string mail_file = util::StrCat(prefix, ".csv");
+    const string curio_file = util::StrCat(prefix, ".json");
+    {
+      std::ofstream plaso_out(plaso_file);
+      GeneratePlasoCorpus(scale->num_events, FLAGS_seed, &plaso_out);
+      std::ofstream mail_out(mail_file);
+      GenerateMailCorpus(scale->num_accesses, FLAGS_seed, &mail_out);
+      std::ofstream curio_out(curio_file);
+      GenerateCurioCorpus(scale->num_streams, FLAGS_seed, &curio_out);
+      if (!plaso_out || !mail_out || !curio_out) {
+        std::cerr << "The corpora could not be written to " << FLAGS_output_dir
+                  << std::endl;
+        return -1;
+      }
+    }
+    for (const auto& scenario :
+         Scenarios(scale->name, plaso_file, mail_file, curio_file)) {
+      Json::Value result =
+          RunScenario(scenario.first, scale->name, scenario.second);
+      all_ok = all_ok && result["ok"].asBool();
+      scenario_results.append(result);
+    }
+  }
+  if (!FLAGS_results_file.empty()) {
+    std::ofstream results_file(FLAGS_results_file);
+    Json::StreamWriterBuilder builder;
+    results_file << Json::writeString(builder, results) << "\n";
+    if (!results_file) {
+      std::cerr << "The results could not be written to "
+                << FLAGS_results_file << std::endl;
+      return -1;
+    }
+  }
+  return all_ok ? 0 : -1;
+}
+
+}  // namespace
+}  // namespace morphie
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return morphie::RunBenchmark();
+}
@@ -18,21 +18,42 @@
 // an analyzer.
 #include "frontend.h"
 
+#include <glob.h>
+
+#include <algorithm>
 #include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
 #include <memory>
+#include <set>
+#include <thread>  // NOLINT
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+#include <google/protobuf/text_format.h>
 
 #include "analyzers/examples/account_access_analyzer.h"
 #include "analyzers/examples/curio_analyzer.h"
 #include "analyzers/plaso/plaso_analyzer.h"
+#include "analyzers/plaso/plaso_event.h"
+#include "analyzers/plaso/plaso_event_file.h"
+#include "analyzers/plaso/plaso_triage.h"
 #include "base/string.h"
 #include "json/json.h"
+#include "util/alloc_profile.h"
+#include "util/compressed_file.h"
 #include "util/csv.h"
 #include "util/json_reader.h"
 #include "util/logging.h"
+#include "util/memory_usage.h"
+#include "util/parallel_csv.h"
+#include "util/progress.h"
+#include "util/stats.h"
 #include "util/status.h"
 #include "util/string_utils.h"
+#include "util/trace.h"
 
 namespace {
 
@@ -43,12 +64,84 @@ const char kInvalidAnalyzerErr[] =
     "Invalid analysis. The analysis must be one of 'curio', 'mail', or "
     "'plaso'.";
 const char kOpenFileErr[] = "Error opening file: ";
+const char kPbOutputErr[] =
+    "Unsupported output parameter. Only the Plaso analyzer supports "
+    "output_pb_file.";
 const char kInvalidPlasoOption[] =
-    "Unsupported input parameter. Plaso analyzer supports only json_file and "
-    "json_stream_file.";
+    "Unsupported input parameter. Plaso analyzer supports only json_file, "
+    "json_stream_file, plasoevent_stream_file, graph_file and "
+    "merge_graph_files.";
+const char kNeighborhoodErr[] =
+    "Unsupported parameter. Only the Plaso analyzer supports neighborhood.";
+const char kInvalidSeedLabelErr[] = "Invalid seed label: ";
+const char kSummaryErr[] =
+    "Unsupported parameter. Only the Plaso analyzer supports "
+    "max_output_nodes.";
+const char kGraphFileErr[] =
+    "Unsupported parameter. Only the Plaso analyzer supports graph_file, "
+    "merge_graph_files and output_graph_file.";
+const char kAppendGraphFileErr[] =
+    "Unsupported parameter. append_graph_file requires the Plaso analyzer and "
+    "json_file or json_stream_file.";
+const char kCheckpointErr[] =
+    "Unsupported parameter. checkpoint_file requires the Plaso analyzer and "
+    "json_stream_file, and cannot be combined with append_graph_file.";
+const char kShardErr[] =
+    "Unsupported parameter. Shards require the Plaso analyzer and "
+    "json_stream_file, and cannot be combined with append_graph_file or "
+    "checkpoint_file.";
+const char kPageSizeErr[] =
+    "Unsupported parameter. page_size requires output_pb_file or a binary "
+    "additional output.";
+const char kAdditionalOutputsErr[] =
+    "Unsupported parameter. Only the Plaso analyzer supports "
+    "additional_outputs.";
+const char kEmptyOutputErr[] =
+    "Unsupported parameter. Every additional output must name a file.";
+const char kWindowErr[] =
+    "Unsupported parameter. window_seconds must be positive and requires the "
+    "Plaso analyzer and json_file, json_stream_file or plasoevent_stream_file, "
+    "and cannot be combined with append_graph_file, checkpoint_file or "
+    "shards.";
+const char kSnapshotErr[] =
+    "Unsupported parameter. snapshot_seconds must be positive and requires "
+    "window_seconds.";
+const char kTriageErr[] =
+    "Unsupported parameter. triage_report_file requires the Plaso analyzer "
+    "and json_file, json_stream_file or plasoevent_stream_file and a positive "
+    "triage_bucket_seconds, and cannot be combined with output files, "
+    "append_graph_file, checkpoint_file, shards or window_seconds.";
+const char kSortErr[] =
+    "Unsupported parameter. sort_events_per_run must be positive and requires "
+    "the Plaso analyzer and json_file, json_stream_file or "
+    "plasoevent_stream_file, and cannot be combined with append_graph_file, "
+    "checkpoint_file, shards or triage_report_file.";
+const char kDuplicateErr[] =
+    "Unsupported parameter. drop_duplicate_events requires the Plaso analyzer "
+    "and json_file, json_stream_file or plasoevent_stream_file and a positive "
+    "max_duplicate_fingerprints, and cannot be combined with checkpoint_file.";
+const char kConversionErr[] =
+    "Unsupported parameter. plasoevent_stream_output_file requires the Plaso "
+    "analyzer and json_file or json_stream_file, and cannot be combined with "
+    "output files, append_graph_file, checkpoint_file, shards, "
+    "window_seconds, triage_report_file or sort_events_per_run.";
+const char kEventFileErr[] = "Malformed PlasoEvent stream file: ";
+const char kTimelineBucketErr[] =
+    "Unsupported parameter. timeline_bucket_seconds must be positive and "
+    "requires the Plaso analyzer.";
+const char kAllocationProfileErr[] =
+    "Unsupported parameter. profile_allocations requires stats_file and a "
+    "binary that is linked with util/alloc_hooks.cc.";
+const char kProgressErr[] =
+    "Unsupported parameter. progress_interval_seconds must not be negative.";
 
-// Returns a pair consisting of a status object and a CSV parser for 'filename'.
-// The return value is:
+// The names of the tables written for AnalysisOutput::tables_prefix.
+const char kEventTableName[] = "events.csv";
+const char kResourceTableName[] = "resources.csv";
+const char kEdgeTableName[] = "edges.csv";
+
+// Returns a pair consisting of a status object and a block CSV parser for
+// 'filename'. The return value is:
 //  - OK if 'filename' could be opened successfully. In this case, the second
 //    element of the returned pair is a CSV parser and the input 'file_ptr'
 //    points to the open file.
@@ -58,16 +151,17 @@ const char kInvalidPlasoOption[] =
 // The file pointer is taken as a separate input to ensure it has a longer
 // lifetime than the parser so that the file can be closed after parsing is
 // complete.
-std::pair<util::Status, std::unique_ptr<util::CSVParser>> GetCSVParser(
+std::pair<util::Status, std::unique_ptr<util::BlockCSVParser>> GetCSVParser(
     const std::string& filename) {
-  std::ifstream* csv_stream = new std::ifstream(filename);
-  if (csv_stream == nullptr || !*csv_stream) {
-    return {util::Status(morphie::Code::EXTERNAL,
-                         util::StrCat(kOpenFileErr, filename)), nullptr};
+  std::unique_ptr<std::istream> csv_stream;
+  util::Status status = util::OpenInputFile(filename, &csv_stream);
+  if (!status.ok()) {
+    return {status, nullptr};
   }
   // The CSV parser takes ownership of the csv_stream and will close the file
   // once parsing is done.
-  std::unique_ptr<util::CSVParser> parser(new util::CSVParser(csv_stream));
+  std::unique_ptr<util::BlockCSVParser> parser(
+      new util::BlockCSVParser(csv_stream.release()));
   return {util::Status::OK, std::move(parser)};
 }
 
@@ -76,98 +170,330 @@ std::pair<util::Status, std::unique_ptr<util::CSVParser>> GetCSVParser(
 std::unique_ptr<Json::Value> GetJsonDoc(const std::string& filename) {
   Json::Reader json_reader;
   std::unique_ptr<Json::Value> json_doc(new Json::Value);
-  std::ifstream json_stream(filename);
-  json_reader.parse(json_stream, *json_doc, false /*Do not parse comments*/);
+  std::unique_ptr<std::istream> json_stream;
+  if (util::OpenInputFile(filename, &json_stream).ok()) {
+    json_reader.parse(*json_stream, *json_doc,
+                      false /*Do not parse comments*/);
+  }
   return json_doc;
 }
 
-// Writes the string 'contents' to 'filename'. Returns
+// Returns the names of the files that match the glob pattern 'pattern' in
+// lexicographic order. If no file matches, 'pattern' itself is returned, so a
+// missing file is reported when it is opened.
+std::vector<std::string> GetMatchingFiles(const std::string& pattern) {
+  glob_t matches;
+  std::vector<std::string> filenames;
+  if (glob(pattern.c_str(), GLOB_NOCHECK, nullptr, &matches) == 0) {
+    filenames.assign(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+  } else {
+    filenames.push_back(pattern);
+  }
+  globfree(&matches);
+  return filenames;
+}
+
+// Opens 'filename' as an output file and calls 'write' to write the contents of
+// the file, so the contents need not be in memory at once. The contents are
+// compressed if the name of the file ends in ".gz" or ".zst" and written on a
+// separate thread while 'write' renders them, as described in
+// util/compressed_file.h. Returns
 //  - OK if 'filename' could be opened for writing, written to, and closed
 //    successfully.
 //  - an error code with explanation otherwise.
+util::Status WriteStreamToFile(
+    const std::string& filename,
+    const std::function<void(std::ostream*)>& write) {
+  std::unique_ptr<util::OutputFileStream> out_file;
+  util::Status status = util::OpenOutputFile(filename, &out_file);
+  if (!status.ok()) {
+    return status;
+  }
+  write(out_file.get());
+  return out_file->Close();
+}
+
+// Writes the string 'contents' to 'filename'. Returns the same status as
+// WriteStreamToFile.
 util::Status WriteToFile(const std::string& filename,
                          const std::string& contents) {
-  std::ofstream out_file;
-  out_file.open(filename, std::ofstream::out);
-  // An ofstream automatically closes a file when it goes out of scope, so the
-  // early returns will not leave the file open. The file is nonetheless
-  // explicitly closed only to be able to detect errors.
-  if (!out_file) {
-    return util::Status(morphie::Code::EXTERNAL,
-                       util::StrCat("Error opening file: ", filename));
-  }
-  out_file << contents;
-
-  if (!out_file) {
-    return util::Status(morphie::Code::INTERNAL,
-                       util::StrCat("Error writing to file: ", filename));
-  }
-  out_file.close();
-  if (!out_file) {
-    return util::Status(morphie::Code::EXTERNAL,
-                       util::StrCat("Error closing file: ", filename));
+  return WriteStreamToFile(
+      filename, [&contents](std::ostream* out) { *out << contents; });
+}
+
+// Writes the phase times and counters in 'stats' to 'filename' as a JSON
+// object. If input lines were counted and allocations were profiled, the
+// allocations and allocated bytes of each phase per input line are written as
+// the member "allocations_per_event". Returns the same status as
+// WriteStreamToFile.
+util::Status WriteStatsToFile(const std::string& filename,
+                              const util::Stats& stats) {
+  Json::Value json_stats(Json::objectValue);
+  Json::Value& phase_seconds = json_stats["phase_seconds"];
+  phase_seconds = Json::Value(Json::objectValue);
+  for (const auto& phase : stats.Times()) {
+    phase_seconds[phase.first] = phase.second;
   }
-  return util::Status::OK;
+  Json::Value& counters = json_stats["counters"];
+  counters = Json::Value(Json::objectValue);
+  const std::map<std::string, int64_t> counts = stats.Counts();
+  for (const auto& counter : counts) {
+    counters[counter.first] = Json::Value(Json::Int64(counter.second));
+  }
+  const auto lines_it = counts.find("lines_read");
+  if (lines_it != counts.end() && lines_it->second > 0) {
+    Json::Value per_event(Json::objectValue);
+    for (const auto& counter : counts) {
+      if (counter.first.compare(0, 12, "allocations/") == 0 ||
+          counter.first.compare(0, 16, "allocated_bytes/") == 0) {
+        per_event[counter.first] =
+            static_cast<double>(counter.second) / lines_it->second;
+      }
+    }
+    if (!per_event.empty()) {
+      json_stats["allocations_per_event"] = per_event;
+    }
+  }
+  Json::StreamWriterBuilder builder;
+  return WriteToFile(filename, Json::writeString(builder, json_stats) + "\n");
 }
 
+// Reports the progress of an ingest while it exists, if the progress interval
+// of the options is positive. Progress lines are appended to the progress file
+// of the options, or written to stderr if there is none or if it cannot be
+// opened, since progress is only a diagnostic.
+class ScopedProgress {
+ public:
+  explicit ScopedProgress(const morphie::AnalysisOptions& options) {
+    if (options.progress_interval_seconds() <= 0) {
+      return;
+    }
+    std::ostream* out = &std::cerr;
+    if (options.has_progress_file()) {
+      file_.open(options.progress_file(), std::ios::app);
+      if (file_.is_open()) {
+        out = &file_;
+      }
+    }
+    reporter_.reset(new util::ProgressReporter(
+        &counters_, options.progress_interval_seconds(), out));
+  }
+  ScopedProgress(const ScopedProgress&) = delete;
+  ScopedProgress& operator=(const ScopedProgress&) = delete;
+
+  // Returns the counters to update, or null if progress is not reported.
+  util::ProgressCounters* counters() {
+    return reporter_ == nullptr ? nullptr : &counters_;
+  }
+
+ private:
+  util::ProgressCounters counters_;
+  std::ofstream file_;
+  // Declared last so that the reporter writes its last line before the file
+  // is closed.
+  std::unique_ptr<util::ProgressReporter> reporter_;
+};
+
 }  // namespace
 
 namespace morphie {
 namespace frontend {
 
 // Runs the Curio analyzer in curio_analyzer.h on the input. Returns an error
-// code if the input is not in JSON format.
+// code if the input is not in JSON format. If 'stats' is not null, the phases
+// of the analysis are timed in 'stats' and the streams, the size of the graph
+// and its dependency cycles are counted.
 util::Status RunCurioAnalyzer(const AnalysisOptions& options,
-                              string* output_graph) {
+                              string* output_graph, util::Stats* stats) {
   if (!options.has_json_file()) {
     return util::Status(morphie::Code::INVALID_ARGUMENT,
                         "The Curio analyzer requires a JSON input file.");
   }
-  std::unique_ptr<Json::Value> json_doc = GetJsonDoc(options.json_file());
   CurioAnalyzer curio_analyzer;
-  util::Status status = curio_analyzer.Initialize(std::move(json_doc));
+  util::Status status;
+  if (options.curio_options().incremental_json()) {
+    std::unique_ptr<std::istream> json_stream;
+    status = util::OpenInputFile(options.json_file(), &json_stream);
+    if (!status.ok()) {
+      return status;
+    }
+    status = curio_analyzer.Initialize(std::move(json_stream));
+  } else {
+    std::unique_ptr<Json::Value> json_doc;
+    {
+      util::ScopedTimer timer(stats, "read");
+      json_doc = GetJsonDoc(options.json_file());
+    }
+    status = curio_analyzer.Initialize(std::move(json_doc));
+  }
   if (!status.ok()) {
     return status;
   }
-  status = curio_analyzer.BuildDependencyGraph();
+  {
+    util::ScopedTimer timer(stats, "graph_build");
+    status = curio_analyzer.BuildDependencyGraph();
+  }
   if (!status.ok()) {
     return status;
   }
-  *output_graph = curio_analyzer.DependencyGraphAsDot();
+  if (stats != nullptr) {
+    StreamComponents components;
+    {
+      util::ScopedTimer timer(stats, "components");
+      components = curio_analyzer.FindComponents();
+    }
+    stats->AddCount("streams_processed", curio_analyzer.NumStreamsProcessed());
+    stats->AddCount("streams_skipped", curio_analyzer.NumStreamsSkipped());
+    stats->AddCount("nodes", curio_analyzer.NumGraphNodes());
+    stats->AddCount("edges", curio_analyzer.NumGraphEdges());
+    stats->AddCount("components", components.num_components);
+    stats->AddCount("cyclic_components", components.num_cyclic_components);
+    stats->AddCount("largest_component", components.largest_component_size);
+    stats->AddCount("dependency_depth", components.depth);
+  }
+  bool condense_cycles = options.curio_options().condense_cycles();
+  if (options.output_dot_file() != "") {
+    util::ScopedTimer timer(stats, "write");
+    return WriteStreamToFile(
+        options.output_dot_file(),
+        [&curio_analyzer, condense_cycles](std::ostream* out) {
+          if (condense_cycles) {
+            curio_analyzer.WriteCondensationDot(out);
+          } else {
+            curio_analyzer.WriteDependencyGraphDot(out);
+          }
+        });
+  }
+  util::ScopedTimer timer(stats, "render");
+  *output_graph = condense_cycles ? curio_analyzer.CondensationAsDot()
+                                  : curio_analyzer.DependencyGraphAsDot();
   return status;
 }
 
-// Runs the Plaso analyzer in plaso_analyzer.h on the input. The input can be in
-// JSON or JSON stream format. Returns an error code if file I/O fails. If the
-// analyzer is run successfully, a GraphViz DOT representation of the
-// constructed graph is returned in 'output_graph'.
-util::Status RunPlasoAnalyzer(const AnalysisOptions& options,
-                              string* output_graph) {
-  util::Status status;
+// A Plaso analyzer and the inputs from which it builds its graph, which must
+// outlive the analyzer. Compressed files are decompressed while they are read.
+struct Session::PlasoGraph {
+  std::vector<std::unique_ptr<std::istream>> input_streams;
+  std::unique_ptr<morphie::JsonDocumentIterator> json_docs;
+  std::unique_ptr<PlasoEventReader> event_reader;
+  std::unique_ptr<PlasoAnalyzer> analyzer;
+};
 
+// Defined below.
+util::Status WritePlasoSnapshot(const AnalysisOptions& options, int index,
+                                PlasoAnalyzer* plaso_analyzer);
+
+// Creates the Plaso analyzer of 'plaso_graph' with the Plaso options of
+// 'options'.
+void CreatePlasoAnalyzer(const AnalysisOptions& options,
+                         Session::PlasoGraph* plaso_graph) {
   bool show_all_sources = options.has_plaso_options()
                               ? options.plaso_options().show_all_sources()
                               : false;
-  PlasoAnalyzer plaso_analyzer(show_all_sources);
-  std::ifstream* input_stream = nullptr;
+  plaso_graph->analyzer.reset(new PlasoAnalyzer(show_all_sources));
+  plaso_graph->analyzer->SetDropSkippedEvents(
+      options.plaso_options().drop_skipped_events());
+  if (options.plaso_options().drop_duplicate_events()) {
+    plaso_graph->analyzer->SetDropDuplicateEvents(
+        options.plaso_options().max_duplicate_fingerprints());
+  }
+}
+
+// Initializes the analyzer of 'plaso_graph', which CreatePlasoAnalyzer()
+// created, with the JSON, JSON stream or PlasoEvent stream input of 'options',
+// whose files are opened in 'plaso_graph'. Returns an error code
+// if the input is in another format or if file I/O fails. If 'stats' is not
+// null, the time to read a JSON file that is loaded as a whole is added to it.
+util::Status InitializePlasoInput(const AnalysisOptions& options,
+                                  util::Stats* stats,
+                                  Session::PlasoGraph* plaso_graph) {
+  util::Status status;
+  PlasoAnalyzer& plaso_analyzer = *plaso_graph->analyzer;
+  std::vector<std::unique_ptr<std::istream>>& input_streams =
+      plaso_graph->input_streams;
+  std::unique_ptr<morphie::JsonDocumentIterator>& json_docs =
+      plaso_graph->json_docs;
   switch (options.input_file_case()) {
     case AnalysisOptions::InputFileCase::kJsonFile:{
-      input_stream = new std::ifstream(options.json_file());
-      if (!input_stream->is_open()){
-        return util::Status(morphie::Code::EXTERNAL,
-                            util::StrCat(kOpenFileErr, options.json_file()));
+      input_streams.emplace_back();
+      status = util::OpenInputFile(options.json_file(), &input_streams.back());
+      if (!status.ok()) {
+        return status;
+      }
+      std::istream* input_stream = input_streams.back().get();
+      if (options.plaso_options().incremental_json()) {
+        json_docs.reset(new morphie::IncrementalFullJson(
+            input_stream, plaso::JSONFieldNames()));
+      } else {
+        // A FullJson iterator reads its whole input when it is constructed,
+        // and the other inputs are read while the graph is built.
+        util::ScopedTimer timer(stats, "read");
+        json_docs.reset(new morphie::FullJson(input_stream));
       }
-      status = plaso_analyzer.Initialize(new morphie::FullJson(input_stream));
+      status = plaso_analyzer.Initialize(json_docs.get());
       break;
     }
     case AnalysisOptions::InputFileCase::kJsonStreamFile:{
-      input_stream = new std::ifstream(options.json_stream_file());
-      if (!input_stream->is_open()){
-        return util::Status(morphie::Code::EXTERNAL,
-                            util::StrCat(kOpenFileErr,
-                            options.json_stream_file()));
+      // The files that match the pattern are read in lexicographic order as
+      // one stream, so the graph does not depend on the order of the
+      // directory entries.
+      std::vector<std::string> filenames =
+          GetMatchingFiles(options.json_stream_file());
+      int num_threads = options.plaso_options().has_num_threads()
+                            ? options.plaso_options().num_threads()
+                            : options.num_threads();
+      // Checkpoints and shards are positions in the input streams, which only
+      // the stream reader keeps track of.
+      const bool is_sharded = options.plaso_options().num_shards() > 1;
+      if (num_threads > 1 || options.has_checkpoint_file() || is_sharded) {
+        std::vector<std::istream*> streams;
+        for (const std::string& filename : filenames) {
+          input_streams.emplace_back();
+          status = util::OpenInputFile(filename, &input_streams.back());
+          if (!status.ok()) {
+            return status;
+          }
+          streams.push_back(input_streams.back().get());
+        }
+        status = plaso_analyzer.Initialize(streams, std::max(num_threads, 1));
+      } else {
+        // The serial reader maps uncompressed files and only extracts the
+        // fields that are used to construct events. Compressed files cannot be
+        // mapped and are read as streams.
+        std::vector<std::unique_ptr<morphie::JsonDocumentIterator>> inputs;
+        for (const std::string& filename : filenames) {
+          if (util::GetCompression(filename) != util::Compression::NONE) {
+            input_streams.emplace_back();
+            status = util::OpenInputFile(filename, &input_streams.back());
+            if (!status.ok()) {
+              return status;
+            }
+            inputs.emplace_back(
+                new morphie::StreamJson(input_streams.back().get()));
+            continue;
+          }
+          morphie::MappedJsonLines* json_lines =
+              new morphie::MappedJsonLines(filename, plaso::JSONFieldNames());
+          inputs.emplace_back(json_lines);
+          if (!json_lines->IsOpen()) {
+            return util::Status(morphie::Code::EXTERNAL,
+                                util::StrCat(kOpenFileErr, filename));
+          }
+        }
+        json_docs.reset(new morphie::ChainedJson(std::move(inputs)));
+        status = plaso_analyzer.Initialize(json_docs.get());
+      }
+      break;
+    }
+    case AnalysisOptions::InputFileCase::kPlasoeventStreamFile:{
+      std::unique_ptr<PlasoEventReader>& event_reader =
+          plaso_graph->event_reader;
+      event_reader.reset(new PlasoEventReader);
+      status = event_reader->Open(options.plasoevent_stream_file());
+      if (!status.ok()) {
+        return status;
       }
-      status = plaso_analyzer.Initialize(new morphie::StreamJson(input_stream));
+      status = plaso_analyzer.Initialize(event_reader.get());
       break;
     }
     default:{
@@ -175,78 +501,761 @@ util::Status RunPlasoAnalyzer(const AnalysisOptions& options,
       break;
     }
   }
+  return status;
+}
+
+// Returns an error if the PlasoEvent stream input of 'plaso_graph', if any,
+// ended with a malformed event, so that an analysis of a damaged file fails
+// instead of showing part of its events.
+util::Status CheckEventInput(const AnalysisOptions& options,
+                             const Session::PlasoGraph& plaso_graph) {
+  if (plaso_graph.event_reader != nullptr &&
+      !plaso_graph.event_reader->is_ok()) {
+    return util::Status(
+        Code::EXTERNAL,
+        util::StrCat(kEventFileErr, options.plasoevent_stream_file()));
+  }
+  return util::Status::OK;
+}
+
+// Builds the graph of the Plaso analyzer in plaso_analyzer.h from the input
+// into 'plaso_graph'. The input can be in JSON, JSON stream or PlasoEvent
+// stream format, or graph files. Returns an error code if file I/O fails. If
+// 'stats' is not null, the phases of the construction are timed in 'stats' and
+// the input lines are counted.
+util::Status BuildPlasoGraph(const AnalysisOptions& options, util::Stats* stats,
+                             Session::PlasoGraph* plaso_graph) {
+  CreatePlasoAnalyzer(options, plaso_graph);
+  PlasoAnalyzer& plaso_analyzer = *plaso_graph->analyzer;
+  switch (options.input_file_case()) {
+    case AnalysisOptions::InputFileCase::kGraphFile:{
+      // A saved graph is complete, so there is nothing to build.
+      util::ScopedTimer timer(stats, "read");
+      return plaso_analyzer.LoadPlasoGraph(options.graph_file());
+    }
+    case AnalysisOptions::InputFileCase::kMergeGraphFiles:{
+      util::ScopedTimer timer(stats, "read");
+      return plaso_analyzer.MergePlasoGraphs(
+          GetMatchingFiles(options.merge_graph_files()));
+    }
+    default:
+      break;
+  }
+  util::Status status = InitializePlasoInput(options, stats, plaso_graph);
   if (!status.ok()) {
     return status;
   }
-  plaso_analyzer.BuildPlasoGraph();
-  input_stream->close();
-  if (options.has_output_dot_file()) {
-    *output_graph = plaso_analyzer.PlasoGraphDot();
-  } else if (options.has_output_pbtxt_file()) {
-    *output_graph = plaso_analyzer.PlasoGraphPbTxt();
+  // The first snapshot that cannot be written fails the analysis once the
+  // graph is built.
+  util::Status snapshot_status;
+  if (options.plaso_options().has_window_seconds()) {
+    const int64_t kMicrosPerSecond = 1000000;
+    std::function<void()> snapshot;
+    if (options.plaso_options().has_snapshot_seconds()) {
+      int index = 0;
+      snapshot = [&options, &plaso_analyzer, &snapshot_status,
+                  index]() mutable {
+        util::Status status =
+            WritePlasoSnapshot(options, index++, &plaso_analyzer);
+        if (snapshot_status.ok()) {
+          snapshot_status = status;
+        }
+      };
+    }
+    plaso_analyzer.SetWindow(
+        options.plaso_options().window_seconds() * kMicrosPerSecond,
+        options.plaso_options().snapshot_seconds() * kMicrosPerSecond,
+        snapshot);
+  }
+  {
+    ScopedProgress progress(options);
+    plaso_analyzer.SetStats(stats);
+    plaso_analyzer.SetProgress(progress.counters());
+    if (options.has_append_graph_file()) {
+      status = plaso_analyzer.AppendToPlasoGraph(options.append_graph_file());
+    } else if (options.has_checkpoint_file()) {
+      status = plaso_analyzer.BuildPlasoGraphWithCheckpoints(
+          options.checkpoint_file(), options.json_stream_file(),
+          options.lines_per_checkpoint());
+    } else if (options.plaso_options().num_shards() > 1) {
+      status = plaso_analyzer.BuildPlasoGraphShard(
+          options.plaso_options().shard_index(),
+          options.plaso_options().num_shards());
+    } else if (options.plaso_options().has_sort_events_per_run()) {
+      status = plaso_analyzer.BuildSortedPlasoGraph(
+          options.plaso_options().sort_events_per_run(),
+          options.plaso_options().sort_spill_directory());
+    } else {
+      plaso_analyzer.BuildPlasoGraph();
+    }
+    // The analyzer would otherwise add the times of later phases to
+    // statistics, and lines to counters, that are freed when the analysis
+    // ends.
+    plaso_analyzer.SetStats(nullptr);
+    plaso_analyzer.SetProgress(nullptr);
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  if (!snapshot_status.ok()) {
+    return snapshot_status;
+  }
+  status = CheckEventInput(options, *plaso_graph);
+  if (!status.ok()) {
+    return status;
+  }
+  if (stats != nullptr) {
+    stats->AddCount("lines_read", plaso_analyzer.NumLinesRead());
+    stats->AddCount("lines_skipped", plaso_analyzer.NumLinesSkipped());
+    if (options.plaso_options().drop_duplicate_events()) {
+      stats->AddCount("duplicate_events", plaso_analyzer.NumDuplicateEvents());
+    }
+    // The memory of the graph is reported as counters named "memory_bytes"
+    // for the total and "memory_bytes/<component>" for each component.
+    util::MemoryBreakdown usage = plaso_analyzer.PlasoGraphMemoryUsage();
+    stats->AddCount("memory_bytes", util::TotalBytes(usage));
+    for (const auto& component : usage) {
+      stats->AddCount(util::StrCat("memory_bytes/", component.first),
+                      component.second);
+    }
   }
   return util::Status::OK;
 }
 
+// Summarizes the JSON or JSON stream input of 'options' with a PlasoTriage
+// without building a graph, and writes the report of the triage to the
+// triage report file of 'options'. Returns an error code if file I/O fails.
+// If 'stats' is not null, the phases of the triage are timed in 'stats' and
+// the input lines and the memory of the triage are counted.
+util::Status TriagePlasoInput(const AnalysisOptions& options,
+                              util::Stats* stats) {
+  const int64_t kMicrosPerSecond = 1000000;
+  const int kMaxTriageBuckets = 1024;
+  Session::PlasoGraph plaso_graph;
+  CreatePlasoAnalyzer(options, &plaso_graph);
+  util::Status status = InitializePlasoInput(options, stats, &plaso_graph);
+  if (!status.ok()) {
+    return status;
+  }
+  PlasoAnalyzer& plaso_analyzer = *plaso_graph.analyzer;
+  PlasoTriage triage(
+      options.plaso_options().show_all_sources(),
+      options.plaso_options().triage_bucket_seconds() * kMicrosPerSecond,
+      kMaxTriageBuckets);
+  {
+    ScopedProgress progress(options);
+    plaso_analyzer.SetStats(stats);
+    plaso_analyzer.SetProgress(progress.counters());
+    plaso_analyzer.TriagePlasoEvents(&triage);
+    plaso_analyzer.SetStats(nullptr);
+    plaso_analyzer.SetProgress(nullptr);
+  }
+  status = CheckEventInput(options, plaso_graph);
+  if (!status.ok()) {
+    return status;
+  }
+  if (stats != nullptr) {
+    stats->AddCount("lines_read", plaso_analyzer.NumLinesRead());
+    stats->AddCount("lines_skipped", plaso_analyzer.NumLinesSkipped());
+    if (options.plaso_options().drop_duplicate_events()) {
+      stats->AddCount("duplicate_events", plaso_analyzer.NumDuplicateEvents());
+    }
+    stats->AddCount("memory_bytes", triage.MemoryUsage());
+  }
+  util::ScopedTimer timer(stats, "write");
+  Json::StreamWriterBuilder builder;
+  return WriteToFile(options.plaso_options().triage_report_file(),
+                     Json::writeString(builder, triage.Report()) + "\n");
+}
+
+// Writes the events of the JSON or JSON stream input of 'options' to the
+// PlasoEvent stream output file of 'options' without building a graph.
+// Returns an error code if file I/O fails. If 'stats' is not null, the phases
+// of the conversion are timed in 'stats' and the input lines are counted.
+util::Status ConvertPlasoInput(const AnalysisOptions& options,
+                               util::Stats* stats) {
+  Session::PlasoGraph plaso_graph;
+  CreatePlasoAnalyzer(options, &plaso_graph);
+  util::Status status = InitializePlasoInput(options, stats, &plaso_graph);
+  if (!status.ok()) {
+    return status;
+  }
+  PlasoEventWriter writer;
+  status = writer.Open(options.plaso_options().plasoevent_stream_output_file());
+  if (!status.ok()) {
+    return status;
+  }
+  PlasoAnalyzer& plaso_analyzer = *plaso_graph.analyzer;
+  {
+    ScopedProgress progress(options);
+    plaso_analyzer.SetStats(stats);
+    plaso_analyzer.SetProgress(progress.counters());
+    plaso_analyzer.WritePlasoEvents(&writer);
+    plaso_analyzer.SetStats(nullptr);
+    plaso_analyzer.SetProgress(nullptr);
+  }
+  if (stats != nullptr) {
+    stats->AddCount("lines_read", plaso_analyzer.NumLinesRead());
+    stats->AddCount("lines_skipped", plaso_analyzer.NumLinesSkipped());
+    if (options.plaso_options().drop_duplicate_events()) {
+      stats->AddCount("duplicate_events", plaso_analyzer.NumDuplicateEvents());
+    }
+  }
+  util::ScopedTimer timer(stats, "write");
+  return writer.Close();
+}
+
+// Returns true if the input of 'options' is a file of Plaso events, as JSON or
+// as PlasoEvent messages, rather than a graph.
+bool HasEventInput(const AnalysisOptions& options) {
+  return options.has_json_file() || options.has_json_stream_file() ||
+         options.has_plasoevent_stream_file();
+}
+
+// Returns true if 'options' has a binary output file.
+bool HasBinaryOutput(const AnalysisOptions& options) {
+  return options.has_output_pb_file() ||
+         std::any_of(options.additional_outputs().begin(),
+                     options.additional_outputs().end(),
+                     [](const AnalysisOutput& output) {
+                       return output.has_pb_file();
+                     });
+}
+
+// Returns true if an additional output of 'options' has no file.
+bool HasEmptyOutput(const AnalysisOptions& options) {
+  return std::any_of(options.additional_outputs().begin(),
+                     options.additional_outputs().end(),
+                     [](const AnalysisOutput& output) {
+                       return output.output_file_case() ==
+                              AnalysisOutput::OUTPUT_FILE_NOT_SET;
+                     });
+}
+
+// Returns the output files of 'options', which are output_file, if it is set,
+// followed by the additional outputs.
+std::vector<AnalysisOutput> OutputFiles(const AnalysisOptions& options) {
+  std::vector<AnalysisOutput> outputs;
+  AnalysisOutput output;
+  switch (options.output_file_case()) {
+    case AnalysisOptions::kOutputDotFile:
+      output.set_dot_file(options.output_dot_file());
+      break;
+    case AnalysisOptions::kOutputPbtxtFile:
+      output.set_pbtxt_file(options.output_pbtxt_file());
+      break;
+    case AnalysisOptions::kOutputPbFile:
+      output.set_pb_file(options.output_pb_file());
+      break;
+    case AnalysisOptions::kOutputGraphFile:
+      output.set_graph_file(options.output_graph_file());
+      break;
+    default:
+      break;
+  }
+  if (output.output_file_case() != AnalysisOutput::OUTPUT_FILE_NOT_SET) {
+    outputs.push_back(output);
+  }
+  outputs.insert(outputs.end(), options.additional_outputs().begin(),
+                 options.additional_outputs().end());
+  return outputs;
+}
+
+// Writes the tables of the graph of 'plaso_analyzer' to the files with the
+// prefix 'prefix' described in analysis_options.proto. Returns the status of
+// the first file that could not be written, if any.
+util::Status WritePlasoTables(const string& prefix,
+                              const PlasoAnalyzer& plaso_analyzer) {
+  util::Status status = WriteStreamToFile(
+      util::StrCat(prefix, kEventTableName),
+      [&plaso_analyzer](std::ostream* out) {
+        plaso_analyzer.WritePlasoEventTable(out);
+      });
+  if (!status.ok()) {
+    return status;
+  }
+  status = WriteStreamToFile(util::StrCat(prefix, kResourceTableName),
+                             [&plaso_analyzer](std::ostream* out) {
+                               plaso_analyzer.WritePlasoResourceTable(out);
+                             });
+  if (!status.ok()) {
+    return status;
+  }
+  return WriteStreamToFile(util::StrCat(prefix, kEdgeTableName),
+                           [&plaso_analyzer](std::ostream* out) {
+                             plaso_analyzer.WritePlasoEdgeTable(out);
+                           });
+}
+
+// Streams the graph of 'plaso_analyzer' to the file of 'output'. A binary
+// output is written in pages if 'options' has a page size.
+util::Status WritePlasoOutput(const AnalysisOptions& options,
+                              const AnalysisOutput& output,
+                              const PlasoAnalyzer& plaso_analyzer) {
+  util::ScopedSpan span("WritePlasoOutput");
+  switch (output.output_file_case()) {
+    case AnalysisOutput::kDotFile:
+      return WriteStreamToFile(output.dot_file(),
+                               [&plaso_analyzer](std::ostream* out) {
+                                 plaso_analyzer.WritePlasoGraphDot(out);
+                               });
+    case AnalysisOutput::kPbtxtFile:
+      return WriteStreamToFile(output.pbtxt_file(),
+                               [&plaso_analyzer](std::ostream* out) {
+                                 plaso_analyzer.WritePlasoGraphPbTxt(out);
+                               });
+    case AnalysisOutput::kGraphFile:
+      return plaso_analyzer.SavePlasoGraph(output.graph_file());
+    case AnalysisOutput::kTablesPrefix:
+      return WritePlasoTables(output.tables_prefix(), plaso_analyzer);
+    case AnalysisOutput::kPbFile:
+      break;
+    default:
+      return util::Status::OK;
+  }
+  const string& filename = output.pb_file();
+  if (!options.has_page_size()) {
+    return WriteStreamToFile(filename, [&plaso_analyzer](std::ostream* out) {
+      plaso_analyzer.WritePlasoGraphPb(out);
+    });
+  }
+  util::Status page_status;
+  viz::PageWriter write_page = [&filename, &page_status](
+      int index, const graph_explorer::GraphDef& page) {
+    page_status = WriteStreamToFile(
+        util::StrCat(filename, ".page-", index),
+        [&page](std::ostream* out) { page.SerializeToOstream(out); });
+    return page_status.ok();
+  };
+  graph_explorer::GraphManifest manifest;
+  util::Status status = plaso_analyzer.WritePlasoGraphPbPages(
+      options.page_size(), write_page, &manifest);
+  if (!page_status.ok()) {
+    return page_status;
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  return WriteStreamToFile(filename, [&manifest](std::ostream* out) {
+    manifest.SerializeToOstream(out);
+  });
+}
+
+// Writes the graph built by 'plaso_analyzer' with the output options, such as
+// a neighborhood or a summary, of 'options' to every output file of 'options'.
+// The outputs only read the graph, so each output after the first is written
+// on a thread of its own while the first is written on the calling thread.
+// The output options of earlier analyses of the graph are discarded. If
+// 'stats' is not null, the phases of the output are timed in 'stats' and the
+// size of the graph is counted. Returns the status of the first output that
+// fails, if any.
+util::Status WritePlasoGraph(const AnalysisOptions& options,
+                             PlasoAnalyzer* analyzer, util::Stats* stats) {
+  util::Status status;
+  PlasoAnalyzer& plaso_analyzer = *analyzer;
+  plaso_analyzer.ClearPlasoGraphOutputOptions();
+  if (stats != nullptr) {
+    stats->AddCount("nodes", plaso_analyzer.NumNodes());
+    stats->AddCount("edges", plaso_analyzer.NumEdges());
+  }
+  if (options.has_neighborhood()) {
+    const NeighborhoodOptions& neighborhood = options.neighborhood();
+    std::vector<TaggedAST> seed_labels(neighborhood.seed_labels_size());
+    for (int i = 0; i < neighborhood.seed_labels_size(); ++i) {
+      if (!google::protobuf::TextFormat::ParseFromString(
+              neighborhood.seed_labels(i), &seed_labels[i])) {
+        return util::Status(Code::INVALID_ARGUMENT,
+                            kInvalidSeedLabelErr + neighborhood.seed_labels(i));
+      }
+    }
+    util::ScopedTimer timer(stats, "neighborhood");
+    status = plaso_analyzer.RestrictPlasoGraph(
+        seed_labels, std::set<string>(neighborhood.seed_tags().begin(),
+                                      neighborhood.seed_tags().end()),
+        neighborhood.max_hops(), neighborhood.max_nodes(),
+        std::max(options.num_threads(), 1));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (options.has_max_output_nodes()) {
+    status = plaso_analyzer.SummarizePlasoGraph(
+        options.max_output_nodes(), std::max(options.num_threads(), 1));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (options.plaso_options().has_timeline_bucket_seconds()) {
+    const int64_t kMicrosPerSecond = 1000000;
+    status = plaso_analyzer.SetPlasoGraphTimelineGranularity(
+        options.plaso_options().timeline_bucket_seconds() * kMicrosPerSecond);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  std::vector<AnalysisOutput> outputs = OutputFiles(options);
+  if (outputs.empty()) {
+    return util::Status::OK;
+  }
+  util::ScopedTimer timer(stats, "write");
+  std::vector<util::Status> statuses(outputs.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < outputs.size(); ++i) {
+    threads.emplace_back([&options, &outputs, &plaso_analyzer, &statuses, i] {
+      statuses[i] = WritePlasoOutput(options, outputs[i], plaso_analyzer);
+    });
+  }
+  statuses[0] = WritePlasoOutput(options, outputs[0], plaso_analyzer);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const util::Status& output_status : statuses) {
+    if (!output_status.ok()) {
+      return output_status;
+    }
+  }
+  return util::Status::OK;
+}
+
+// Returns 'filename' with "-<index>" inserted before the extensions of its
+// base name, which keeps its format and compression.
+std::string SnapshotFilename(const std::string& filename, int index) {
+  size_t base = filename.rfind('/');
+  base = base == std::string::npos ? 0 : base + 1;
+  size_t extension = filename.find('.', base);
+  if (extension == std::string::npos) {
+    extension = filename.size();
+  }
+  return util::StrCat(filename.substr(0, extension), "-",
+                      index, filename.substr(extension));
+}
+
+// Writes the snapshot with index 'index' of the window of 'plaso_analyzer' to
+// the output files of 'options' renamed by SnapshotFilename(), with the output
+// options of 'options'. The output options are cleared afterwards, since more
+// events are added to the graph.
+util::Status WritePlasoSnapshot(const AnalysisOptions& options, int index,
+                                PlasoAnalyzer* plaso_analyzer) {
+  AnalysisOptions snapshot_options = options;
+  snapshot_options.clear_output_file();
+  snapshot_options.clear_additional_outputs();
+  for (AnalysisOutput output : OutputFiles(options)) {
+    switch (output.output_file_case()) {
+      case AnalysisOutput::kDotFile:
+        output.set_dot_file(SnapshotFilename(output.dot_file(), index));
+        break;
+      case AnalysisOutput::kPbtxtFile:
+        output.set_pbtxt_file(SnapshotFilename(output.pbtxt_file(), index));
+        break;
+      case AnalysisOutput::kPbFile:
+        output.set_pb_file(SnapshotFilename(output.pb_file(), index));
+        break;
+      case AnalysisOutput::kGraphFile:
+        output.set_graph_file(SnapshotFilename(output.graph_file(), index));
+        break;
+      case AnalysisOutput::kTablesPrefix:
+        output.set_tables_prefix(
+            util::StrCat(output.tables_prefix(), index, "-"));
+        break;
+      default:
+        break;
+    }
+    *snapshot_options.add_additional_outputs() = output;
+  }
+  util::Status status =
+      WritePlasoGraph(snapshot_options, plaso_analyzer, nullptr);
+  plaso_analyzer->ClearPlasoGraphOutputOptions();
+  return status;
+}
+
 // Runs the analyzer in account_access_analyzer.h on the input. Returns
 //  - INVALID_ARGUMENT if the input is not in CSV format or if
 //    file I/O causes an error or if graph initialization or construction fails.
 //  - OK otherwise.
-// If OK is returned, 'output_graph' contains a GraphViz DOT graph.
+// If OK is returned, a GraphViz DOT graph is streamed to the DOT output file if
+// one is given, and is returned in 'output_graph' otherwise. If 'stats' is not
+// null, the phases of the analysis are timed in 'stats' and the input lines
+// are counted.
 util::Status RunMailAccessAnalyzer(const AnalysisOptions& options,
-                                   string* output_graph) {
+                                   string* output_graph, util::Stats* stats) {
   if (!options.has_csv_file()) {
     return util::Status(morphie::Code::INVALID_ARGUMENT,
                         "The access analyzer requires a CSV input file.");
   }
-  AccessAnalyzer access_analyzer;
-  std::pair<util::Status, std::unique_ptr<util::CSVParser>> result =
-      GetCSVParser(options.csv_file());
-
-  util::Status status = result.first;
-  if (!status.ok()) {
-    return status;
+  AccessAnalyzer access_analyzer(options.mail_options().aggregate_accesses()
+                                     ? AccessEdgeMode::kAggregated
+                                     : AccessEdgeMode::kPerCount);
+  util::Status status;
+  int num_threads = options.mail_options().has_num_threads()
+                        ? options.mail_options().num_threads()
+                        : options.num_threads();
+  // The parallel parser splits a mapped file into byte ranges, so compressed
+  // files are parsed on one thread.
+  if (num_threads > 1 &&
+      util::GetCompression(options.csv_file()) == util::Compression::NONE) {
+    std::unique_ptr<util::ParallelCSVParser> parser(
+        new util::ParallelCSVParser(',', num_threads));
+    status = parser->Initialize(options.csv_file());
+    if (!status.ok()) {
+      return status;
+    }
+    status = access_analyzer.Initialize(std::move(parser));
+  } else {
+    std::pair<util::Status, std::unique_ptr<util::BlockCSVParser>> result =
+        GetCSVParser(options.csv_file());
+    status = result.first;
+    if (!status.ok()) {
+      return status;
+    }
+    status = access_analyzer.Initialize(std::move(result.second));
   }
-  status = access_analyzer.Initialize(std::move(result.second));
   if (!status.ok()) {
     return status;
   }
-  status = access_analyzer.BuildAccessGraph();
+  {
+    // The input is parsed while the graph is built.
+    util::ScopedTimer timer(stats, "graph_build");
+    ScopedProgress progress(options);
+    access_analyzer.SetProgress(progress.counters());
+    status = access_analyzer.BuildAccessGraph();
+    access_analyzer.SetProgress(nullptr);
+  }
   if (!status.ok()) {
     return status;
   }
+  if (stats != nullptr) {
+    stats->AddCount("lines_read", access_analyzer.NumLinesRead());
+    stats->AddCount("lines_skipped", access_analyzer.NumLinesSkipped());
+  }
+  if (options.output_dot_file() != "") {
+    util::ScopedTimer timer(stats, "write");
+    return WriteStreamToFile(options.output_dot_file(),
+                             [&access_analyzer](std::ostream* out) {
+                               access_analyzer.WriteAccessGraphDot(out);
+                             });
+  }
+  util::ScopedTimer timer(stats, "render");
   *output_graph = access_analyzer.AccessGraphAsDot();
   return util::Status::OK;
 }
 
+Session::Session() : reused_graph_(false) {}
+
+Session::~Session() {}
+
+// The input options of an analysis are its options without the output options,
+// which are the options that WritePlasoGraph() reads.
+AnalysisOptions Session::InputOptions(const AnalysisOptions& options) {
+  AnalysisOptions input = options;
+  input.clear_output_file();
+  input.clear_additional_outputs();
+  input.clear_neighborhood();
+  input.clear_max_output_nodes();
+  input.clear_page_size();
+  input.clear_stats_file();
+  input.clear_progress_interval_seconds();
+  input.clear_progress_file();
+  input.clear_trace_file();
+  input.clear_profile_allocations();
+  return input;
+}
+
+// A graph that fails to build is discarded, so the next analysis of the same
+// input builds it again.
+util::Status Session::RunPlasoAnalyzer(const AnalysisOptions& options,
+                                       util::Stats* stats) {
+  // A triage or a conversion builds no graph, so the graph of the session is
+  // kept.
+  if (options.plaso_options().has_triage_report_file()) {
+    return TriagePlasoInput(options, stats);
+  }
+  if (options.plaso_options().has_plasoevent_stream_output_file()) {
+    return ConvertPlasoInput(options, stats);
+  }
+  AnalysisOptions input = InputOptions(options);
+  // Appending changes the graph file, so a graph that is appended to is never
+  // reused.
+  reused_graph_ = !options.has_append_graph_file() && plaso_graph_ != nullptr &&
+                  input.SerializeAsString() == plaso_input_.SerializeAsString();
+  if (!reused_graph_) {
+    plaso_graph_.reset();
+    std::unique_ptr<PlasoGraph> plaso_graph(new PlasoGraph);
+    util::Status status = BuildPlasoGraph(options, stats, plaso_graph.get());
+    if (!status.ok()) {
+      return status;
+    }
+    plaso_graph_ = std::move(plaso_graph);
+    plaso_input_ = input;
+  }
+  if (stats != nullptr) {
+    stats->AddCount("graph_reused", reused_graph_ ? 1 : 0);
+  }
+  return WritePlasoGraph(options, plaso_graph_->analyzer.get(), stats);
+}
+
+// Tracing is process-wide, so the spans of the analysis are those recorded
+// from the start of the analysis to its end. The trace is written even if the
+// analysis fails, since a trace is most useful to understand a failure.
+// Allocations are only profiled during the analysis too.
+util::Status Session::Run(const AnalysisOptions& options) {
+  return Run(options, nullptr);
+}
+
+util::Status Session::Run(const AnalysisOptions& options, util::Stats* stats) {
+  if (options.profile_allocations() &&
+      (!options.has_stats_file() || !util::AllocationHooksInstalled())) {
+    return util::Status(Code::INVALID_ARGUMENT, kAllocationProfileErr);
+  }
+  if (options.has_trace_file()) {
+    util::StartTracing();
+  }
+  util::SetAllocationProfiling(options.profile_allocations());
+  util::Status status = RunAnalysis(options, stats);
+  util::SetAllocationProfiling(false);
+  if (!options.has_trace_file()) {
+    return status;
+  }
+  util::StopTracing();
+  util::Status trace_status = WriteStreamToFile(
+      options.trace_file(),
+      [](std::ostream* out) { util::WriteChromeTrace(out); });
+  return status.ok() ? trace_status : status;
+}
+
 // Invokes the specified analyzer on an input data source and after analysis,
-// writes a graph to a file if required.
-util::Status Run(const AnalysisOptions& options) {
+// writes a graph to a file if required. The output of the Plaso analyzer and
+// DOT output are streamed to their files by the analyzers, so only a text
+// graph returned in 'output_graph' remains to be written here. If a stats file
+// is given and the analysis succeeds, the statistics of the analysis are
+// written last, with the wall time of the whole analysis as the phase "total".
+util::Status Session::RunAnalysis(const AnalysisOptions& options,
+                                  util::Stats* stats) {
+  util::ScopedSpan span("Session::Run");
+  reused_graph_ = false;
   util::Status status = util::Status::OK;
   string output_graph;
-  // Invoke an analyzer.
-  if (!options.has_analyzer()) {
-    return util::Status(Code::INVALID_ARGUMENT, kInvalidAnalyzerErr);
-  } else if (options.analyzer() == "curio") {
-    status = RunCurioAnalyzer(options, &output_graph);
-  } else if (options.analyzer() == "mail") {
-    status = RunMailAccessAnalyzer(options, &output_graph);
-  } else if (options.analyzer() == "plaso") {
-    status = RunPlasoAnalyzer(options, &output_graph);
-  } else {
-    return util::Status(Code::INVALID_ARGUMENT, kInvalidAnalyzerErr);
-  }
-  // Write the output of the analysis and return.
-  if (!status.ok() || output_graph == "") {
-    return status;
+  std::unique_ptr<util::Stats> owned_stats;
+  if (stats == nullptr && options.has_stats_file()) {
+    owned_stats.reset(new util::Stats);
+    stats = owned_stats.get();
   }
-  if (options.output_dot_file() != "") {
-    status = WriteToFile(options.output_dot_file(), output_graph);
+  {
+    util::ScopedTimer timer(stats, "total");
+    // Invoke an analyzer.
+    if (!options.has_analyzer()) {
+      return util::Status(Code::INVALID_ARGUMENT, kInvalidAnalyzerErr);
+    } else if (options.has_output_pb_file() && options.analyzer() != "plaso") {
+      return util::Status(Code::INVALID_ARGUMENT, kPbOutputErr);
+    } else if (options.has_neighborhood() && options.analyzer() != "plaso") {
+      return util::Status(Code::INVALID_ARGUMENT, kNeighborhoodErr);
+    } else if (options.has_max_output_nodes() &&
+               options.analyzer() != "plaso") {
+      return util::Status(Code::INVALID_ARGUMENT, kSummaryErr);
+    } else if ((options.has_graph_file() || options.has_merge_graph_files() ||
+                options.has_output_graph_file()) &&
+               options.analyzer() != "plaso") {
+      return util::Status(Code::INVALID_ARGUMENT, kGraphFileErr);
+    } else if (options.has_append_graph_file() &&
+               (options.analyzer() != "plaso" || options.has_graph_file() ||
+                options.has_merge_graph_files())) {
+      return util::Status(Code::INVALID_ARGUMENT, kAppendGraphFileErr);
+    } else if (options.has_checkpoint_file() &&
+               (options.analyzer() != "plaso" ||
+                !options.has_json_stream_file() ||
+                options.has_append_graph_file())) {
+      return util::Status(Code::INVALID_ARGUMENT, kCheckpointErr);
+    } else if (options.plaso_options().num_shards() > 1 &&
+               (options.analyzer() != "plaso" ||
+                !options.has_json_stream_file() ||
+                options.has_append_graph_file() ||
+                options.has_checkpoint_file())) {
+      return util::Status(Code::INVALID_ARGUMENT, kShardErr);
+    } else if (options.plaso_options().has_window_seconds() &&
+               (options.plaso_options().window_seconds() <= 0 ||
+                options.analyzer() != "plaso" ||
+                !HasEventInput(options) ||
+                options.has_append_graph_file() ||
+                options.has_checkpoint_file() ||
+                options.plaso_options().num_shards() > 1)) {
+      return util::Status(Code::INVALID_ARGUMENT, kWindowErr);
+    } else if (options.plaso_options().has_snapshot_seconds() &&
+               (options.plaso_options().snapshot_seconds() <= 0 ||
+                !options.plaso_options().has_window_seconds())) {
+      return util::Status(Code::INVALID_ARGUMENT, kSnapshotErr);
+    } else if (options.plaso_options().has_triage_report_file() &&
+               (options.plaso_options().triage_bucket_seconds() <= 0 ||
+                options.analyzer() != "plaso" ||
+                !HasEventInput(options) ||
+                !OutputFiles(options).empty() ||
+                options.has_append_graph_file() ||
+                options.has_checkpoint_file() ||
+                options.plaso_options().num_shards() > 1 ||
+                options.plaso_options().has_window_seconds())) {
+      return util::Status(Code::INVALID_ARGUMENT, kTriageErr);
+    } else if (options.plaso_options().has_sort_events_per_run() &&
+               (options.plaso_options().sort_events_per_run() <= 0 ||
+                options.analyzer() != "plaso" ||
+                !HasEventInput(options) ||
+                options.has_append_graph_file() ||
+                options.has_checkpoint_file() ||
+                options.plaso_options().num_shards() > 1 ||
+                options.plaso_options().has_triage_report_file())) {
+      return util::Status(Code::INVALID_ARGUMENT, kSortErr);
+    } else if (options.plaso_options().drop_duplicate_events() &&
+               (options.plaso_options().max_duplicate_fingerprints() <= 0 ||
+                options.analyzer() != "plaso" ||
+                !HasEventInput(options) ||
+                options.has_checkpoint_file())) {
+      return util::Status(Code::INVALID_ARGUMENT, kDuplicateErr);
+    } else if (options.plaso_options().has_plasoevent_stream_output_file() &&
+               (options.analyzer() != "plaso" ||
+                !(options.has_json_file() || options.has_json_stream_file()) ||
+                !OutputFiles(options).empty() ||
+                options.has_append_graph_file() ||
+                options.has_checkpoint_file() ||
+                options.plaso_options().num_shards() > 1 ||
+                options.plaso_options().has_window_seconds() ||
+                options.plaso_options().has_triage_report_file() ||
+                options.plaso_options().has_sort_events_per_run())) {
+      return util::Status(Code::INVALID_ARGUMENT, kConversionErr);
+    } else if (options.plaso_options().has_timeline_bucket_seconds() &&
+               (options.plaso_options().timeline_bucket_seconds() <= 0 ||
+                options.analyzer() != "plaso")) {
+      return util::Status(Code::INVALID_ARGUMENT, kTimelineBucketErr);
+    } else if (options.additional_outputs_size() > 0 &&
+               options.analyzer() != "plaso") {
+      return util::Status(Code::INVALID_ARGUMENT, kAdditionalOutputsErr);
+    } else if (HasEmptyOutput(options)) {
+      return util::Status(Code::INVALID_ARGUMENT, kEmptyOutputErr);
+    } else if (options.has_page_size() && !HasBinaryOutput(options)) {
+      return util::Status(Code::INVALID_ARGUMENT, kPageSizeErr);
+    } else if (options.progress_interval_seconds() < 0) {
+      return util::Status(Code::INVALID_ARGUMENT, kProgressErr);
+    } else if (options.analyzer() == "curio") {
+      status = RunCurioAnalyzer(options, &output_graph, stats);
+    } else if (options.analyzer() == "mail") {
+      status = RunMailAccessAnalyzer(options, &output_graph, stats);
+    } else if (options.analyzer() == "plaso") {
+      status = RunPlasoAnalyzer(options, stats);
+    } else {
+      return util::Status(Code::INVALID_ARGUMENT, kInvalidAnalyzerErr);
+    }
+    // Write the output of the analysis.
+    if (status.ok() && output_graph != "" &&
+        options.output_pbtxt_file() != "") {
+      util::ScopedTimer write_timer(stats, "write");
+      status = WriteToFile(options.output_pbtxt_file(), output_graph);
+    }
   }
-  if (options.output_pbtxt_file() != "") {
-    status = WriteToFile(options.output_pbtxt_file(), output_graph);
+  if (!status.ok() || !options.has_stats_file()) {
+    return status;
   }
-  return status;
+  return WriteStatsToFile(options.stats_file(), *stats);
+}
+
+util::Status Run(const AnalysisOptions& options) {
+  Session session;
+  return session.Run(options);
 }
 
 }  // namespace frontend
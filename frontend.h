@@ -16,7 +16,11 @@
 #ifndef LOGLE_FRONTEND_H_
 #define LOGLE_FRONTEND_H_
 
+#include <memory>
+
 #include "analysis_options.pb.h"
+#include "base/string.h"
+#include "util/stats.h"
 #include "util/status.h"
 
 namespace morphie {
@@ -35,6 +39,52 @@ enum class Analyzer { kCurio, kMailAccess, kPlaso };
 //   for situations in which the analyzers return errors.
 util::Status Run(const AnalysisOptions& options);
 
+// A session runs analyses as Run() does, but keeps the graph built by the Plaso
+// analyzer in memory. An analysis whose input options are those of the graph
+// reuses it instead of reading the input again, so that a sequence of
+// analyses of one timeline with different output options, such as another
+// neighborhood, summary or output file, only pays for the output. The input
+// options are all options except output_file, additional_outputs,
+// neighborhood, max_output_nodes, page_size and stats_file. Changes to the
+// input files after the graph is built are not seen by later analyses with the
+// same options. The graphs of the other analyzers are not kept. A session is
+// not thread-safe.
+class Session {
+ public:
+  Session();
+  ~Session();
+  Session(const Session&) = delete;
+  Session& operator=(const Session&) = delete;
+
+  // Returns the status returned by Run() for 'options'.
+  util::Status Run(const AnalysisOptions& options);
+  // Runs the analysis as Run() does and adds its phase times and counters,
+  // which are those written to the stats file of 'options', to '*stats', even
+  // if 'options' has no stats file.
+  util::Status Run(const AnalysisOptions& options, util::Stats* stats);
+  // Returns true if the last call to Run() reused the graph of an earlier
+  // analysis.
+  bool ReusedGraph() const { return reused_graph_; }
+
+  // The Plaso analyzer and its inputs, defined in frontend.cc.
+  struct PlasoGraph;
+
+ private:
+  static AnalysisOptions InputOptions(const AnalysisOptions& options);
+  // Runs the analysis of Run() without tracing it or profiling allocations.
+  // The analysis is instrumented with 'stats' if it is not null, and with
+  // stats of its own if it is null and 'options' has a stats file.
+  util::Status RunAnalysis(const AnalysisOptions& options,
+                           util::Stats* stats);
+  util::Status RunPlasoAnalyzer(const AnalysisOptions& options,
+                                util::Stats* stats);
+
+  // The input options of 'plaso_graph_', which is null if no graph is kept.
+  AnalysisOptions plaso_input_;
+  std::unique_ptr<PlasoGraph> plaso_graph_;
+  bool reused_graph_;
+};  // class Session
+
 }  // namespace frontend
 }  // namespace morphie
 #endif  // LOGLE_FRONTEND_H_
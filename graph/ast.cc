@@ -19,10 +19,9 @@
 // argument is true.
 #include "ast.h"
 
-#include <boost/algorithm/string/join.hpp>  // NOLINT
+#include <boost/functional/hash/hash.hpp>
 
 #include "base/vector.h"
-#include "util/string_utils.h"
 #include "util/time_utils.h"
 
 namespace morphie {
@@ -34,6 +33,92 @@ const char kNullStr[] = "null";
 const char kNullOpStr[] = "?";
 const char kTagStr[] = "tag";
 
+bool EqualPrimitive(const PrimitiveAST& p_ast1, const PrimitiveAST& p_ast2) {
+  if (p_ast1.has_type() != p_ast2.has_type() ||
+      p_ast1.type() != p_ast2.type() ||
+      p_ast1.has_val() != p_ast2.has_val()) {
+    return false;
+  }
+  if (!p_ast1.has_val()) {
+    return true;
+  }
+  const PrimitiveValue& val1 = p_ast1.val();
+  const PrimitiveValue& val2 = p_ast2.val();
+  if (val1.val_case() != val2.val_case()) {
+    return false;
+  }
+  switch (val1.val_case()) {
+    case PrimitiveValue::kBoolVal:
+      return val1.bool_val() == val2.bool_val();
+    case PrimitiveValue::kIntVal:
+      return val1.int_val() == val2.int_val();
+    case PrimitiveValue::kStringVal:
+      return val1.string_val() == val2.string_val();
+    case PrimitiveValue::kTimeVal:
+      return val1.time_val() == val2.time_val();
+    case PrimitiveValue::VAL_NOT_SET:
+      return true;
+  }
+  return false;
+}
+
+bool EqualComposite(const CompositeAST& c_ast1, const CompositeAST& c_ast2) {
+  if (c_ast1.has_op() != c_ast2.has_op() || c_ast1.op() != c_ast2.op() ||
+      c_ast1.arg_size() != c_ast2.arg_size()) {
+    return false;
+  }
+  for (int i = 0; i < c_ast1.arg_size(); ++i) {
+    if (!Equal(c_ast1.arg(i), c_ast2.arg(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void HashPrimitive(const PrimitiveAST& p_ast, size_t* seed) {
+  boost::hash_combine(*seed, static_cast<int>(p_ast.type()));
+  if (!p_ast.has_val()) {
+    return;
+  }
+  const PrimitiveValue& val = p_ast.val();
+  boost::hash_combine(*seed, static_cast<int>(val.val_case()));
+  switch (val.val_case()) {
+    case PrimitiveValue::kBoolVal:
+      boost::hash_combine(*seed, val.bool_val());
+      break;
+    case PrimitiveValue::kIntVal:
+      boost::hash_combine(*seed, val.int_val());
+      break;
+    case PrimitiveValue::kStringVal:
+      boost::hash_combine(*seed, val.string_val());
+      break;
+    case PrimitiveValue::kTimeVal:
+      boost::hash_combine(*seed, val.time_val());
+      break;
+    case PrimitiveValue::VAL_NOT_SET:
+      break;
+  }
+}
+
+void HashAST(const AST& ast, size_t* seed) {
+  boost::hash_combine(*seed, static_cast<int>(ast.node_case()));
+  if (ast.has_is_nullable()) {
+    boost::hash_combine(*seed, ast.is_nullable());
+  }
+  if (ast.has_name()) {
+    boost::hash_combine(*seed, ast.name());
+  }
+  if (ast.has_p_ast()) {
+    HashPrimitive(ast.p_ast(), seed);
+  } else if (ast.has_c_ast()) {
+    boost::hash_combine(*seed, static_cast<int>(ast.c_ast().op()));
+    boost::hash_combine(*seed, ast.c_ast().arg_size());
+    for (const AST& arg : ast.c_ast().arg()) {
+      HashAST(arg, seed);
+    }
+  }
+}
+
 // Returns 'true' if 'b' includes all options in 'a'.
 bool Includes(PrintOption a, PrintOption b) {
   return (static_cast<int>(a) & static_cast<int>(b)) == static_cast<int>(a);
@@ -44,47 +129,92 @@ bool IsPrimitive(const AST& ast, PrimitiveType type) {
   return ast.has_p_ast() && (ast.p_ast().type() == type);
 }
 
-// Returns a single whitespace string if the name and remaining output will be
+// Appends a single whitespace to 'out' if the name and remaining output will be
 // non-empty. The remaining output will be non-empty if it includes a type or a
 // value because empty types and values serialize as "null".
-string GetNameSeparator(const string& name, PrintOption opt) {
+void AppendNameSeparator(const string& name, PrintOption opt, string* out) {
   if (name != "" && (Includes(PrintOption::kNameAndType, opt) ||
                      Includes(PrintOption::kNameAndValue, opt))) {
-    return " ";
+    out->push_back(' ');
+  }
+}
+
+const char* PrimitiveTypeName(const PrimitiveType& type) {
+  switch (type) {
+    case PrimitiveType::BOOL:
+      return "bool";
+    case PrimitiveType::INT:
+      return "int";
+    case PrimitiveType::STRING:
+      return "string";
+    case PrimitiveType::TIMESTAMP:
+      return "timestamp";
   }
   return "";
 }
 
-// Returns the type of an AST.
-string ToTypeString(const AST& ast, PrintOption opt) {
+const char* OperatorName(const Operator& op) {
+  switch (op) {
+    case Operator::INTERVAL:
+      return "interval";
+    case Operator::LIST:
+      return "list";
+    case Operator::SET:
+      return "set";
+    case Operator::TUPLE:
+      return "tuple";
+  }
+  return "";
+}
+
+void AppendPrimitiveValue(const PrimitiveValue& val, string* out) {
+  switch (val.val_case()) {
+    case PrimitiveValue::ValCase::kBoolVal:
+      out->append(val.bool_val() ? "true" : "false");
+      break;
+    case PrimitiveValue::ValCase::kIntVal:
+      out->append(std::to_string(val.int_val()));
+      break;
+    case PrimitiveValue::ValCase::kStringVal:
+      out->append(val.string_val());
+      break;
+    case PrimitiveValue::ValCase::kTimeVal:
+      out->append(util::UnixMicrosToRFC3339(val.time_val()));
+      break;
+    case PrimitiveValue::ValCase::VAL_NOT_SET:
+      out->append(kNullStr);
+      break;
+  }
+}
+
+// Appends the type of an AST to 'out'.
+void AppendType(const AST& ast, PrintOption opt, string* out) {
   if (!Includes(PrintOption::kType, opt)) {
-    return "";
+    return;
   }
   if (IsNull(ast)) {
-    return kNullStr;
+    out->append(kNullStr);
   } else if (ast.has_p_ast()) {
-    return ToString(ast.p_ast().type());
+    out->append(PrimitiveTypeName(ast.p_ast().type()));
   } else if (ast.has_c_ast()) {
-    return ToString(ast.c_ast().op());
+    out->append(OperatorName(ast.c_ast().op()));
   }
-  return "";
 }
 
-// Returns the value in an AST.
-string ToValueString(const AST& ast, PrintOption opt) {
+// Appends the value in an AST to 'out'.
+void AppendValue(const AST& ast, PrintOption opt, string* out) {
   if (!Includes(PrintOption::kValue, opt)) {
-    return "";
+    return;
   }
   if (IsNull(ast)) {
-    return kNullStr;
+    out->append(kNullStr);
   } else if (ast.has_p_ast()) {
     if (ast.p_ast().has_val()) {
-      return ToString(ast.p_ast().val());
+      AppendPrimitiveValue(ast.p_ast().val(), out);
     } else {
-      return kNullStr;
+      out->append(kNullStr);
     }
   }
-  return "";
 }
 
 }  // namespace
@@ -140,103 +270,157 @@ bool IsTuple(const AST& ast) {
 // as a prefix when pretty printing 'ast.ast()'.
 // If Includes(PrintOption::kType, opt) is true, the output should include type
 // information.
-string ToString(const TaggedAST& ast, const PrintConfig& config) {
-  string type_str = Includes(PrintOption::kType, config.opt()) ? kTagStr : "";
-  string type_sep = Includes(PrintOption::kValue, config.opt()) ? " : " : "";
-  string tag_str = ast.has_tag() ? ast.tag() : "";
-  string ast_str = ast.has_ast() ? ToString(ast.ast(), config) : kNullStr;
-  return util::StrCat(type_str, type_sep, tag_str, " :: ", ast_str);
+void AppendToString(const TaggedAST& ast, const PrintConfig& config,
+                    string* out) {
+  if (Includes(PrintOption::kType, config.opt())) {
+    out->append(kTagStr);
+  }
+  if (Includes(PrintOption::kValue, config.opt())) {
+    out->append(" : ");
+  }
+  if (ast.has_tag()) {
+    out->append(ast.tag());
+  }
+  out->append(" :: ");
+  if (ast.has_ast()) {
+    AppendToString(ast.ast(), config, out);
+  } else {
+    out->append(kNullStr);
+  }
 }
 
-string ToString(const AST& ast, const PrintConfig& config) {
-  string root = ToStringRoot(ast, config.opt());
+void AppendToString(const AST& ast, const PrintConfig& config, string* out) {
+  AppendToStringRoot(ast, config.opt(), out);
   if (Includes(config.opt(), PrintOption::kName) || !ast.has_c_ast()) {
-    return root;
+    return;
   }
-  std::vector<string> arg_str;
+  out->append(config.open());
   if (ast.c_ast().arg_size() == 0) {
-    arg_str.emplace_back(kNullStr);
-  } else {
-    arg_str.emplace_back(ToString(ast.c_ast().arg(0), config));
+    out->append(kNullStr);
   }
-  for (int i = 1; i < ast.c_ast().arg_size(); ++i) {
-    arg_str.emplace_back(ToString(ast.c_ast().arg(i), config));
+  for (int i = 0; i < ast.c_ast().arg_size(); ++i) {
+    if (i > 0) {
+      out->append(config.sep());
+    }
+    AppendToString(ast.c_ast().arg(i), config, out);
   }
-  return util::StrCat(root, config.open(),
-                      boost::algorithm::join(arg_str, config.sep()),
-                      config.close());
+  out->append(config.close());
 }
 
-string ToString(const PrimitiveAST& p_ast, const PrintConfig& config) {
-  AST ast;
-  *ast.mutable_p_ast() = p_ast;
-  return ToStringRoot(ast, config.opt());
-}
-
-string ToString(const PrimitiveValue& val) {
-  switch (val.val_case()) {
-    case PrimitiveValue::ValCase::kBoolVal:
-      return val.bool_val() ? "true" : "false";
-    case PrimitiveValue::ValCase::kIntVal:
-      return std::to_string(val.int_val());
-    case PrimitiveValue::ValCase::kStringVal:
-      return val.string_val();
-    case PrimitiveValue::ValCase::kTimeVal:
-      return util::UnixMicrosToRFC3339(val.time_val());
-    case PrimitiveValue::ValCase::VAL_NOT_SET:
-      return kNullStr;
+// A PrimitiveAST has no name and is not nullable, so its serialization is the
+// root serialization of an AST containing only 'p_ast'.
+void AppendToString(const PrimitiveAST& p_ast, const PrintConfig& config,
+                    string* out) {
+  if (Includes(PrintOption::kType, config.opt())) {
+    out->append(PrimitiveTypeName(p_ast.type()));
   }
-}
-
-string ToString(const PrimitiveType& type) {
-  switch (type) {
-    case PrimitiveType::BOOL:
-      return "bool";
-    case PrimitiveType::INT:
-      return "int";
-    case PrimitiveType::STRING:
-      return "string";
-    case PrimitiveType::TIMESTAMP:
-      return "timestamp";
+  if (Includes(PrintOption::kTypeAndValue, config.opt())) {
+    out->append(" : ");
   }
-}
-
-string ToString(const Operator& op) {
-  switch (op) {
-    case Operator::INTERVAL:
-      return "interval";
-    case Operator::LIST:
-      return "list";
-    case Operator::SET:
-      return "set";
-    case Operator::TUPLE:
-      return "tuple";
+  if (!Includes(PrintOption::kValue, config.opt())) {
+    return;
+  }
+  if (p_ast.has_val()) {
+    AppendPrimitiveValue(p_ast.val(), out);
+  } else {
+    out->append(kNullStr);
   }
 }
 
-// Returns a string whose output with the print option kAll is:
+// Appends a string whose output with the print option kAll is:
 //   [name] [type] : [value] for primitive ASTs and
 //   [name] [type] for composite ASTs.
 // A subset of this output will appear depending on the options chosen. The
 // separator " : " is added if the output contains both a type and a value.
-string ToStringRoot(const AST& ast, PrintOption opt) {
-  string name = "";
+void AppendToStringRoot(const AST& ast, PrintOption opt, string* out) {
   if (Includes(PrintOption::kName, opt) && ast.has_name()) {
-    name = ast.name();
+    out->append(ast.name());
+    AppendNameSeparator(ast.name(), opt, out);
   }
-  string name_sep = GetNameSeparator(name, opt);
-  string type_str = ToTypeString(ast, opt);
-  string null_op = "";
+  AppendType(ast, opt, out);
   if (Includes(PrintOption::kType, opt) && ast.has_is_nullable() &&
       ast.is_nullable()) {
-    null_op = kNullOpStr;
+    out->append(kNullOpStr);
   }
-  string type_sep = "";
   if (!ast.has_c_ast() && Includes(PrintOption::kTypeAndValue, opt)) {
-    type_sep = " : ";
+    out->append(" : ");
+  }
+  AppendValue(ast, opt, out);
+}
+
+string ToString(const TaggedAST& ast, const PrintConfig& config) {
+  string out;
+  AppendToString(ast, config, &out);
+  return out;
+}
+
+string ToString(const AST& ast, const PrintConfig& config) {
+  string out;
+  AppendToString(ast, config, &out);
+  return out;
+}
+
+string ToString(const PrimitiveAST& p_ast, const PrintConfig& config) {
+  string out;
+  AppendToString(p_ast, config, &out);
+  return out;
+}
+
+string ToString(const PrimitiveValue& val) {
+  string out;
+  AppendPrimitiveValue(val, &out);
+  return out;
+}
+
+string ToString(const PrimitiveType& type) { return PrimitiveTypeName(type); }
+
+string ToString(const Operator& op) { return OperatorName(op); }
+
+string ToStringRoot(const AST& ast, PrintOption opt) {
+  string out;
+  AppendToStringRoot(ast, opt, &out);
+  return out;
+}
+
+bool Equal(const AST& ast1, const AST& ast2) {
+  if (ast1.has_is_nullable() != ast2.has_is_nullable() ||
+      ast1.is_nullable() != ast2.is_nullable() ||
+      ast1.has_name() != ast2.has_name() || ast1.name() != ast2.name() ||
+      ast1.node_case() != ast2.node_case()) {
+    return false;
+  }
+  if (ast1.has_p_ast()) {
+    return EqualPrimitive(ast1.p_ast(), ast2.p_ast());
+  }
+  if (ast1.has_c_ast()) {
+    return EqualComposite(ast1.c_ast(), ast2.c_ast());
+  }
+  return true;
+}
+
+bool Equal(const TaggedAST& ast1, const TaggedAST& ast2) {
+  if (ast1.tag() != ast2.tag() || ast1.has_ast() != ast2.has_ast()) {
+    return false;
+  }
+  return !ast1.has_ast() || Equal(ast1.ast(), ast2.ast());
+}
+
+size_t Hash(const AST& ast) {
+  size_t seed = 0;
+  HashAST(ast, &seed);
+  return seed;
+}
+
+// A TaggedAST without an AST hashes differently from one with an empty AST
+// because the two have different serializations.
+size_t Hash(const TaggedAST& ast) {
+  size_t seed = 0;
+  boost::hash_combine(seed, ast.tag());
+  boost::hash_combine(seed, ast.has_ast());
+  if (ast.has_ast()) {
+    HashAST(ast.ast(), &seed);
   }
-  string val_str = ToValueString(ast, opt);
-  return util::StrCat(name, name_sep, type_str, null_op, type_sep, val_str);
+  return seed;
 }
 
 }  // namespace ast
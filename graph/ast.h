@@ -35,6 +35,8 @@
 #ifndef LOGLE_AST_H_
 #define LOGLE_AST_H_
 
+#include <stddef.h>
+
 #include "base/string.h"
 #include "ast.pb.h"
 
@@ -92,13 +94,13 @@ class PrintConfig {
       : open_(open), close_(close), sep_(sep), opt_(opt) {}
 
   // Functions for retrieving and setting configuration options.
-  string open() const { return open_; }
+  const string& open() const { return open_; }
   void set_open(const string& open) { open_ = open; }
 
-  string close() const { return close_; }
+  const string& close() const { return close_; }
   void set_close(const string& close) { close_ = close; }
 
-  string sep() const { return sep_; }
+  const string& sep() const { return sep_; }
   void set_sep(const string& sep) { sep_ = sep; }
 
   PrintOption opt() const { return opt_; }
@@ -135,8 +137,6 @@ bool IsTuple(const AST& ast);
 // print config argument determines which contents of the AST to print. See the
 // example at the top of the file for how to use these methods.
 string ToString(const TaggedAST& ast, const PrintConfig& config);
-string ToString(const TaggedAST& ast, const PrintConfig& config);
-string ToString(const AST& ast, const PrintConfig& config);
 string ToString(const AST& ast, const PrintConfig& config);
 string ToString(const PrimitiveAST& p_ast, const PrintConfig& config);
 string ToString(const PrimitiveValue& val);
@@ -153,6 +153,44 @@ string ToString(const Operator& op);
 //  and returns the empty string otherwise.
 string ToStringRoot(const AST& ast, PrintOption opt);
 
+// The AppendToString methods append the string that the corresponding ToString
+// method returns to 'out', without constructing intermediate strings. Printing
+// many ASTs into one buffer that is cleared and reused avoids allocating memory
+// for every AST.
+void AppendToString(const TaggedAST& ast, const PrintConfig& config,
+                    string* out);
+void AppendToString(const AST& ast, const PrintConfig& config, string* out);
+void AppendToString(const PrimitiveAST& p_ast, const PrintConfig& config,
+                    string* out);
+void AppendToStringRoot(const AST& ast, PrintOption opt, string* out);
+
+// Structural equality and hashing of ASTs. Two ASTs are equal if they have the
+// same fields set to the same values, which is the case exactly when they have
+// the same serialization. Unlike comparing serializations, these functions do
+// not allocate memory. Equal ASTs have equal hash values.
+bool Equal(const AST& ast1, const AST& ast2);
+bool Equal(const TaggedAST& ast1, const TaggedAST& ast2);
+size_t Hash(const AST& ast);
+size_t Hash(const TaggedAST& ast);
+
+// Function objects wrapping Equal and Hash for use with unordered containers.
+struct ASTHash {
+  size_t operator()(const AST& ast) const { return Hash(ast); }
+};
+struct ASTEqual {
+  bool operator()(const AST& ast1, const AST& ast2) const {
+    return Equal(ast1, ast2);
+  }
+};
+struct TaggedASTHash {
+  size_t operator()(const TaggedAST& ast) const { return Hash(ast); }
+};
+struct TaggedASTEqual {
+  bool operator()(const TaggedAST& ast1, const TaggedAST& ast2) const {
+    return Equal(ast1, ast2);
+  }
+};
+
 }  // namespace ast
 }  // namespace morphie
 
@@ -254,6 +254,99 @@ TEST_F(ASTTest, PrintSet) {
   EXPECT_EQ("foo\nbar\nbaz", ToString(ast_, config));
 }
 
+// AppendToString appends the output of ToString to a buffer and leaves the
+// existing contents of the buffer unchanged.
+TEST_F(ASTTest, AppendToStringMatchesToString) {
+  ast_.mutable_c_ast()->set_op(Operator::LIST);
+  ast_.set_name("l");
+  AST arg;
+  arg.set_name("i");
+  arg.mutable_p_ast()->set_type(PrimitiveType::INT);
+  arg.mutable_p_ast()->mutable_val()->set_int_val(5);
+  *(ast_.mutable_c_ast()->add_arg()) = arg;
+  arg.mutable_p_ast()->clear_val();
+  *(ast_.mutable_c_ast()->add_arg()) = arg;
+  TaggedAST tagged;
+  tagged.set_tag("Count");
+  *tagged.mutable_ast() = ast_;
+
+  for (PrintOption opt :
+       {PrintOption::kName, PrintOption::kType, PrintOption::kValue,
+        PrintOption::kNameAndType, PrintOption::kTypeAndValue,
+        PrintOption::kNameAndValue, PrintOption::kAll}) {
+    PrintConfig config("[", "]", " - ", opt);
+    string out = "prefix";
+    AppendToString(ast_, config, &out);
+    EXPECT_EQ("prefix" + ToString(ast_, config), out);
+    out.clear();
+    AppendToString(tagged, config, &out);
+    EXPECT_EQ(ToString(tagged, config), out);
+    out.clear();
+    AppendToString(arg.p_ast(), config, &out);
+    EXPECT_EQ(ToString(arg.p_ast(), config), out);
+    out.clear();
+    AppendToStringRoot(ast_, opt, &out);
+    EXPECT_EQ(ToStringRoot(ast_, opt), out);
+  }
+  string out;
+  AppendToString(ast_, PrintConfig(PrintOption::kAll), &out);
+  EXPECT_EQ("l list(i int : 5, i int : null)", out);
+}
+
+// Structural equality coincides with equality of serializations.
+TEST_F(ASTTest, EqualASTs) {
+  AST other;
+  EXPECT_TRUE(Equal(ast_, other));
+  ast_.mutable_p_ast()->set_type(PrimitiveType::STRING);
+  EXPECT_FALSE(Equal(ast_, other));
+  other.mutable_p_ast()->set_type(PrimitiveType::STRING);
+  EXPECT_TRUE(Equal(ast_, other));
+  EXPECT_EQ(Hash(ast_), Hash(other));
+  ast_.mutable_p_ast()->mutable_val()->set_string_val("foo");
+  EXPECT_FALSE(Equal(ast_, other));
+  other.mutable_p_ast()->mutable_val()->set_string_val("foo");
+  EXPECT_TRUE(Equal(ast_, other));
+  EXPECT_EQ(Hash(ast_), Hash(other));
+  // The name and nullability of an AST are compared.
+  ast_.set_name("t");
+  EXPECT_FALSE(Equal(ast_, other));
+  other.set_name("t");
+  other.set_is_nullable(false);
+  EXPECT_FALSE(Equal(ast_, other));
+  ast_.set_is_nullable(false);
+  EXPECT_TRUE(Equal(ast_, other));
+  EXPECT_EQ(Hash(ast_), Hash(other));
+  // Composite ASTs are compared element-wise.
+  AST list1, list2;
+  list1.mutable_c_ast()->set_op(Operator::LIST);
+  list2.mutable_c_ast()->set_op(Operator::LIST);
+  *list1.mutable_c_ast()->add_arg() = ast_;
+  EXPECT_FALSE(Equal(list1, list2));
+  *list2.mutable_c_ast()->add_arg() = other;
+  EXPECT_TRUE(Equal(list1, list2));
+  EXPECT_EQ(Hash(list1), Hash(list2));
+  list2.mutable_c_ast()->mutable_arg(0)->mutable_p_ast()->mutable_val()
+      ->set_string_val("bar");
+  EXPECT_FALSE(Equal(list1, list2));
+  EXPECT_EQ(list1.SerializeAsString() == list2.SerializeAsString(),
+            Equal(list1, list2));
+}
+
+// A tagged AST without an AST differs from one with an empty AST.
+TEST_F(ASTTest, EqualTaggedASTs) {
+  TaggedAST other;
+  tast_.set_tag("Uses");
+  other.set_tag("Uses");
+  EXPECT_TRUE(Equal(tast_, other));
+  EXPECT_EQ(Hash(tast_), Hash(other));
+  other.mutable_ast();
+  EXPECT_FALSE(Equal(tast_, other));
+  tast_.mutable_ast();
+  EXPECT_TRUE(Equal(tast_, other));
+  other.set_tag("Precedes");
+  EXPECT_FALSE(Equal(tast_, other));
+}
+
 }  // namespace
 }  // namespace ast
 }  // namespace morphie
@@ -0,0 +1,160 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/compressed_labeled_graph.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "util/logging.h"
+
+namespace morphie {
+
+namespace {
+
+const char kInvalidNodeErr[] = "Invalid node id.";
+const char kInvalidLabelErr[] = "Invalid label id.";
+
+void WriteVarint(uint64_t value, std::vector<uint8_t>* bytes) {
+  while (value >= 0x80) {
+    bytes->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  bytes->push_back(static_cast<uint8_t>(value));
+}
+
+// Appends the list of 'neighbors' of 'node_id', which are sorted, to 'bytes'.
+// The i-th entry of 'labels' is written after the i-th neighbor unless
+// 'labels' is null.
+void WriteList(NodeId node_id, const std::vector<NodeId>& neighbors,
+               const std::vector<LabelId>* labels,
+               std::vector<uint8_t>* bytes) {
+  WriteVarint(neighbors.size(), bytes);
+  for (size_t i = 0; i < neighbors.size(); ++i) {
+    if (i == 0) {
+      const int64_t difference = static_cast<int64_t>(neighbors[0]) -
+                                 static_cast<int64_t>(node_id);
+      WriteVarint((static_cast<uint64_t>(difference) << 1) ^
+                      static_cast<uint64_t>(difference >> 63),
+                  bytes);
+    } else {
+      WriteVarint(neighbors[i] - neighbors[i - 1], bytes);
+    }
+    if (labels != nullptr) {
+      WriteVarint((*labels)[i], bytes);
+    }
+  }
+}
+
+}  // namespace
+
+CompressedLabeledGraph::CompressedLabeledGraph(const FrozenLabeledGraph& graph)
+    : graph_label_(graph.GetGraphLabel()),
+      num_edges_(graph.NumEdges()) {
+  labels_.reserve(graph.NumDistinctLabels());
+  for (int i = 0; i < graph.NumDistinctLabels(); ++i) {
+    labels_.push_back(graph.GetLabel(static_cast<LabelId>(i)));
+  }
+  const NodeId num_nodes = graph.NumNodes();
+  node_labels_.reserve(num_nodes);
+  out_offsets_.reserve(num_nodes);
+  in_offsets_.reserve(num_nodes);
+  std::vector<std::pair<NodeId, LabelId>> edges;
+  std::vector<NodeId> neighbors;
+  std::vector<LabelId> labels;
+  for (NodeId node_id = 0; node_id < num_nodes; ++node_id) {
+    node_labels_.push_back(graph.GetNodeLabelId(node_id));
+    edges.clear();
+    for (FrozenEdgeId edge_id = graph.OutEdgeBegin(node_id);
+         edge_id != graph.OutEdgeEnd(node_id); ++edge_id) {
+      edges.emplace_back(graph.Target(edge_id), graph.GetEdgeLabelId(edge_id));
+    }
+    std::sort(edges.begin(), edges.end());
+    neighbors.clear();
+    labels.clear();
+    for (const auto& edge : edges) {
+      neighbors.push_back(edge.first);
+      labels.push_back(edge.second);
+    }
+    out_offsets_.push_back(out_bytes_.size());
+    WriteList(node_id, neighbors, &labels, &out_bytes_);
+
+    util::Span<FrozenNodeId> predecessors = graph.GetPredecessorRange(node_id);
+    neighbors.assign(predecessors.begin(), predecessors.end());
+    std::sort(neighbors.begin(), neighbors.end());
+    in_offsets_.push_back(in_bytes_.size());
+    WriteList(node_id, neighbors, nullptr, &in_bytes_);
+  }
+  out_bytes_.shrink_to_fit();
+  in_bytes_.shrink_to_fit();
+}
+
+const TaggedAST& CompressedLabeledGraph::GetNodeLabel(NodeId node_id) const {
+  return GetLabel(GetNodeLabelId(node_id));
+}
+
+LabelId CompressedLabeledGraph::GetNodeLabelId(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return node_labels_[node_id];
+}
+
+const TaggedAST& CompressedLabeledGraph::GetLabel(LabelId label_id) const {
+  CHECK(label_id < labels_.size(), kInvalidLabelErr);
+  return labels_[label_id];
+}
+
+NeighborRange CompressedLabeledGraph::GetPredecessorRange(
+    NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return NeighborRange(in_bytes_.data() + in_offsets_[node_id], node_id,
+                       false);
+}
+
+NeighborRange CompressedLabeledGraph::GetSuccessorRange(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return NeighborRange(out_bytes_.data() + out_offsets_[node_id], node_id,
+                       true);
+}
+
+void CompressedLabeledGraph::CollectPredecessors(
+    NodeId node_id, NodeMarker* marker, std::vector<NodeId>* nodes) const {
+  for (NodeId predecessor : GetPredecessorRange(node_id)) {
+    if (marker->Mark(predecessor)) {
+      nodes->push_back(predecessor);
+    }
+  }
+  marker->Clear();
+}
+
+void CompressedLabeledGraph::CollectSuccessors(
+    NodeId node_id, NodeMarker* marker, std::vector<NodeId>* nodes) const {
+  for (NodeId successor : GetSuccessorRange(node_id)) {
+    if (marker->Mark(successor)) {
+      nodes->push_back(successor);
+    }
+  }
+  marker->Clear();
+}
+
+util::MemoryBreakdown CompressedLabeledGraph::MemoryUsage() const {
+  util::MemoryBreakdown usage;
+  usage["node_labels"] = util::VectorBytes(node_labels_);
+  usage["offsets"] =
+      util::VectorBytes(out_offsets_) + util::VectorBytes(in_offsets_);
+  usage["out_lists"] = util::VectorBytes(out_bytes_);
+  usage["in_lists"] = util::VectorBytes(in_bytes_);
+  return usage;
+}
+
+}  // namespace morphie
@@ -0,0 +1,220 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A compressed labeled graph is a read-only copy of a FrozenLabeledGraph whose
+// neighbor lists are compressed, for graphs that do not fit in memory as
+// arrays of 32-bit identifiers. Events are added to a graph in time order, so
+// the neighbors of a node, such as the events it precedes or the files it
+// uses, tend to have identifiers close to its own and to each other. The
+// neighbors of a node are therefore sorted and stored as the difference
+// between the first neighbor and the node, followed by the gaps between
+// consecutive neighbors, each as a variable-length integer with 7 bits per
+// byte. The label id of an out-edge follows the gap of its target in the same
+// encoding. A gap below 128 and one of the first 128 labels take one byte
+// each, so an edge takes about 3 bytes instead of the 20 bytes of the arrays
+// of a frozen graph.
+//
+// Neighbor lists are decoded sequentially as they are iterated, and a node is
+// decoded in a few instructions per byte, so traversals that scan whole lists
+// are not much slower than on a frozen graph. Neighbors are visited in
+// increasing order of their identifiers, with one entry per edge, rather than
+// in the order of the edges of the frozen graph. Edges have no identifiers.
+//
+// Example.
+//   FrozenLabeledGraph frozen(graph);
+//   CompressedLabeledGraph compressed(frozen);
+//   for (NodeId successor : compressed.GetSuccessorRange(node_id)) { ... }
+//   GraphTraversal traversal(compressed, 4);
+#ifndef LOGLE_GRAPH_COMPRESSED_LABELED_GRAPH_H_
+#define LOGLE_GRAPH_COMPRESSED_LABELED_GRAPH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "graph/frozen_labeled_graph.h"
+#include "graph/labeled_graph.h"
+#include "ast.pb.h"
+#include "util/memory_usage.h"
+
+namespace morphie {
+
+// The neighbors of a node in a CompressedLabeledGraph, which are decoded as
+// they are iterated. A range is valid for the lifetime of the graph.
+class NeighborRange {
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = NodeId;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const NodeId*;
+    using reference = NodeId;
+
+    NodeId operator*() const { return node_id_; }
+    // Returns the label id of the edge to the current neighbor.
+    // - Requires that the range was returned by GetSuccessorRange.
+    LabelId EdgeLabelId() const { return label_id_; }
+    const_iterator& operator++() {
+      if (--remaining_ > 0) {
+        node_id_ += ReadVarint(&bytes_);
+        ReadLabel();
+      }
+      return *this;
+    }
+    // Iterators of the same range are equal if they are at the same neighbor.
+    bool operator==(const const_iterator& other) const {
+      return remaining_ == other.remaining_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return remaining_ != other.remaining_;
+    }
+
+   private:
+    friend class NeighborRange;
+
+    const_iterator(const uint8_t* bytes, size_t size, NodeId node_id,
+                   bool has_labels)
+        : bytes_(bytes),
+          remaining_(size),
+          node_id_(node_id),
+          label_id_(0),
+          has_labels_(has_labels) {
+      if (remaining_ > 0) {
+        // The first neighbor is stored as a zigzag-encoded difference.
+        const uint64_t difference = ReadVarint(&bytes_);
+        node_id_ += (difference >> 1) ^ (0 - (difference & 1));
+        ReadLabel();
+      }
+    }
+
+    void ReadLabel() {
+      if (has_labels_) {
+        label_id_ = static_cast<LabelId>(ReadVarint(&bytes_));
+      }
+    }
+
+    static uint64_t ReadVarint(const uint8_t** bytes) {
+      uint64_t value = 0;
+      for (int shift = 0;; shift += 7) {
+        const uint8_t byte = *(*bytes)++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+          return value;
+        }
+      }
+    }
+
+    const uint8_t* bytes_;
+    size_t remaining_;
+    NodeId node_id_;
+    LabelId label_id_;
+    bool has_labels_;
+  };  // class const_iterator
+  using iterator = const_iterator;
+
+  // The empty range.
+  NeighborRange()
+      : bytes_(nullptr), size_(0), node_id_(0), has_labels_(false) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const_iterator begin() const {
+    return const_iterator(bytes_, size_, node_id_, has_labels_);
+  }
+  const_iterator end() const {
+    return const_iterator(nullptr, 0, node_id_, has_labels_);
+  }
+
+ private:
+  friend class CompressedLabeledGraph;
+
+  // Constructs the range of the list that starts at 'bytes' with the number of
+  // neighbors, of the node 'node_id'.
+  NeighborRange(const uint8_t* bytes, NodeId node_id, bool has_labels)
+      : bytes_(bytes), node_id_(node_id), has_labels_(has_labels) {
+    size_ = static_cast<size_t>(const_iterator::ReadVarint(&bytes_));
+  }
+
+  const uint8_t* bytes_;
+  size_t size_;
+  NodeId node_id_;
+  bool has_labels_;
+};  // class NeighborRange
+
+// The CompressedLabeledGraph class provides read-only access to the nodes,
+// labels and neighbors of a graph, with the functions of FrozenLabeledGraph
+// that do not refer to edge identifiers. Queries of nodes and labels take
+// constant time, and a neighbor range takes constant time to construct and
+// time linear in its size to iterate. The functions may be called
+// concurrently.
+class CompressedLabeledGraph {
+ public:
+  // Compresses 'graph' in time linear in its size. The labels are copied, so
+  // the labels of a mapped graph are parsed.
+  explicit CompressedLabeledGraph(const FrozenLabeledGraph& graph);
+  // Disallow copying and assignment.
+  CompressedLabeledGraph(const CompressedLabeledGraph&) = delete;
+  CompressedLabeledGraph& operator=(const CompressedLabeledGraph&) = delete;
+
+  int NumNodes() const { return static_cast<int>(node_labels_.size()); }
+  int NumEdges() const { return num_edges_; }
+  bool HasNode(NodeId node_id) const { return node_id < node_labels_.size(); }
+  // The functions below have the same semantics as the functions of the same
+  // name in FrozenLabeledGraph.
+  // - The node functions require that HasNode(node_id) is true.
+  const TaggedAST& GetNodeLabel(NodeId node_id) const;
+  LabelId GetNodeLabelId(NodeId node_id) const;
+  int NumDistinctLabels() const { return static_cast<int>(labels_.size()); }
+  // - Requires that 'label_id' is less than NumDistinctLabels().
+  const TaggedAST& GetLabel(LabelId label_id) const;
+  const AST& GetGraphLabel() const { return graph_label_; }
+
+  // Return the predecessors and successors of a node in increasing order, with
+  // one entry per edge, so a node can occur more than once. The iterators of
+  // the successor range also return the label ids of the edges.
+  //  - The functions require that HasNode(node_id) is true.
+  NeighborRange GetPredecessorRange(NodeId node_id) const;
+  NeighborRange GetSuccessorRange(NodeId node_id) const;
+  // Appends the distinct predecessors (or successors) of a node to 'nodes'. See
+  // LabeledGraph::CollectPredecessors for details.
+  //  - The functions require that HasNode(node_id) is true.
+  void CollectPredecessors(NodeId node_id, NodeMarker* marker,
+                           std::vector<NodeId>* nodes) const;
+  void CollectSuccessors(NodeId node_id, NodeMarker* marker,
+                         std::vector<NodeId>* nodes) const;
+
+  // Returns the bytes used by the graph, as a breakdown with the components
+  // "node_labels", "offsets", "out_lists" and "in_lists". The labels
+  // themselves are not counted.
+  util::MemoryBreakdown MemoryUsage() const;
+
+ private:
+  AST graph_label_;
+  std::vector<TaggedAST> labels_;
+  std::vector<LabelId> node_labels_;
+  int num_edges_;
+  // The list of successors of node 'n' starts at out_bytes_[out_offsets_[n]]
+  // with the number of successors, and the list of predecessors at
+  // in_bytes_[in_offsets_[n]].
+  std::vector<uint64_t> out_offsets_;
+  std::vector<uint8_t> out_bytes_;
+  std::vector<uint64_t> in_offsets_;
+  std::vector<uint8_t> in_bytes_;
+};  // class CompressedLabeledGraph
+
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_COMPRESSED_LABELED_GRAPH_H_
@@ -0,0 +1,82 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/compressed_labeled_graph.h"
+
+#include <utility>
+#include <vector>
+
+#include "graph/graph_test_util.h"
+#include "graph/test_graphs.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace {
+
+using test::ExpectSameGraphs;
+
+// Edges go to earlier and later nodes, with gaps that take several bytes, and
+// there are parallel edges with different labels.
+TEST(CompressedLabeledGraphTest, PreservesNodesEdgesAndLabels) {
+  test::WeightedGraph weighted_graph;
+  ASSERT_TRUE(weighted_graph.Initialize().ok());
+  for (int i = 0; i < 20000; ++i) {
+    weighted_graph.AddNode(i % 7);
+  }
+  for (const auto& edge : std::vector<std::pair<NodeId, NodeId>>(
+           {{0, 1}, {0, 1}, {0, 19999}, {0, 300}, {5000, 3}, {5000, 4999},
+            {5000, 5000}, {19999, 0}})) {
+    weighted_graph.AddEdge(edge.first, edge.second,
+                           static_cast<int>(edge.second % 3));
+  }
+  weighted_graph.AddEdge(0, 1, 9);
+  FrozenLabeledGraph frozen(*weighted_graph.GetGraph());
+  CompressedLabeledGraph compressed(frozen);
+  ExpectSameGraphs(frozen, compressed);
+  EXPECT_TRUE(compressed.GetSuccessorRange(1).empty());
+  EXPECT_EQ(3, compressed.GetPredecessorRange(1).size());
+
+  NodeMarker marker;
+  std::vector<NodeId> nodes;
+  compressed.CollectSuccessors(0, &marker, &nodes);
+  EXPECT_EQ(std::vector<NodeId>({1, 300, 19999}), nodes);
+  nodes.clear();
+  compressed.CollectPredecessors(0, &marker, &nodes);
+  EXPECT_EQ(std::vector<NodeId>({19999}), nodes);
+}
+
+// A graph of events in time order, in which each event precedes the next
+// events, takes much less memory than the arrays of the frozen graph.
+TEST(CompressedLabeledGraphTest, CompressesLocalEdges) {
+  test::WeightedGraph weighted_graph;
+  test::GetErdosRenyiGraph(300, 0.05, 3, 11, &weighted_graph);
+  FrozenLabeledGraph random_frozen(*weighted_graph.GetGraph());
+  ExpectSameGraphs(random_frozen, CompressedLabeledGraph(random_frozen));
+
+  test::WeightedGraph path;
+  test::GetPathGraph(5000, &path);
+  for (NodeId node_id = 0; node_id + 3 < 5000; ++node_id) {
+    path.AddEdge(node_id, node_id + 3, 1);
+  }
+  FrozenLabeledGraph frozen(*path.GetGraph());
+  CompressedLabeledGraph compressed(frozen);
+  ExpectSameGraphs(frozen, compressed);
+  const util::MemoryBreakdown usage = compressed.MemoryUsage();
+  // The edges take 20 bytes each in the arrays of the frozen graph.
+  EXPECT_LT(4 * (usage.at("out_lists") + usage.at("in_lists")),
+            static_cast<size_t>(20 * frozen.NumEdges()));
+}
+
+}  // namespace
+}  // namespace morphie
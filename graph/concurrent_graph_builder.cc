@@ -0,0 +1,177 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/concurrent_graph_builder.h"
+
+#include <boost/functional/hash/hash.hpp>
+
+#include <limits>
+
+#include "graph/ast.h"
+#include "util/logging.h"
+
+namespace morphie {
+
+namespace {
+
+// The default number of shards of the tables of unique labels.
+const int kNumShards = 64;
+// The number of builder identifiers that a writer claims at a time.
+const NodeId kRangeSize = 1024;
+// Marks builder identifiers that were not returned by a writer.
+const NodeId kNoNode = std::numeric_limits<NodeId>::max();
+
+const char kFinishedErr[] = "The concurrent graph builder has finished.";
+const char kInvalidNodeErr[] = "Invalid builder node id.";
+const char kNotFinishedErr[] = "The concurrent graph builder has not finished.";
+const char kShardsErr[] = "The number of shards must be positive.";
+
+}  // namespace
+
+ConcurrentGraphBuilder::Writer::Writer(ConcurrentGraphBuilder* builder)
+    : builder_(builder), next_id_(0), range_end_(0) {}
+
+NodeId ConcurrentGraphBuilder::Writer::AllocateNodeId() {
+  if (next_id_ == range_end_) {
+    next_id_ = builder_->next_range_.fetch_add(kRangeSize);
+    range_end_ = next_id_ + kRangeSize;
+    ranges_.push_back(next_id_);
+  }
+  return next_id_++;
+}
+
+// A node with a unique label is allocated while the lock of its shard is held,
+// so exactly one writer records the node.
+NodeId ConcurrentGraphBuilder::Writer::FindOrAddNode(const TaggedAST& label) {
+  CHECK(!builder_->is_finished_, kFinishedErr);
+  if (builder_->unique_node_tags_.count(label.tag()) == 0) {
+    NodeId node_id = AllocateNodeId();
+    nodes_.emplace_back(node_id, labels_.Intern(label));
+    return node_id;
+  }
+  Shard* shard = builder_->GetShard(ast::Hash(label));
+  std::lock_guard<std::mutex> lock(shard->mutex);
+  LabelId shard_label_id = shard->node_labels.Intern(label);
+  if (shard_label_id < shard->nodes.size()) {
+    return shard->nodes[shard_label_id];
+  }
+  NodeId node_id = AllocateNodeId();
+  shard->nodes.push_back(node_id);
+  nodes_.emplace_back(node_id, labels_.Intern(label));
+  return node_id;
+}
+
+void ConcurrentGraphBuilder::Writer::FindOrAddEdge(NodeId source,
+                                                   NodeId target,
+                                                   const TaggedAST& label) {
+  CHECK(!builder_->is_finished_, kFinishedErr);
+  if (builder_->unique_edge_tags_.count(label.tag()) > 0) {
+    size_t hash = ast::Hash(label);
+    boost::hash_combine(hash, source);
+    boost::hash_combine(hash, target);
+    Shard* shard = builder_->GetShard(hash);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    Edge edge(source, target, shard->edge_labels.Intern(label));
+    if (!shard->edges.insert(edge).second) {
+      return;
+    }
+  }
+  edges_.emplace_back(source, target, labels_.Intern(label));
+}
+
+ConcurrentGraphBuilder::ConcurrentGraphBuilder(LabeledGraph* graph)
+    : ConcurrentGraphBuilder(graph, kNumShards) {}
+
+ConcurrentGraphBuilder::ConcurrentGraphBuilder(LabeledGraph* graph,
+                                               int num_shards)
+    : graph_(graph),
+      unique_node_tags_(graph->GetUniqueNodeTags()),
+      unique_edge_tags_(graph->GetUniqueEdgeTags()),
+      next_range_(0),
+      is_finished_(false) {
+  CHECK(num_shards > 0, kShardsErr);
+  for (int i = 0; i < num_shards; ++i) {
+    shards_.emplace_back(new Shard);
+  }
+}
+
+ConcurrentGraphBuilder::~ConcurrentGraphBuilder() { Finish(); }
+
+ConcurrentGraphBuilder::Writer* ConcurrentGraphBuilder::NewWriter() {
+  std::lock_guard<std::mutex> lock(writers_mutex_);
+  writers_.emplace_back(new Writer(this));
+  return writers_.back().get();
+}
+
+ConcurrentGraphBuilder::Shard* ConcurrentGraphBuilder::GetShard(size_t hash) {
+  return shards_[hash % shards_.size()].get();
+}
+
+// Every range of builder identifiers belongs to exactly one writer, and the
+// nodes of a writer are sorted by builder identifier, so visiting the ranges
+// in increasing order visits all nodes in increasing order of their builder
+// identifiers.
+void ConcurrentGraphBuilder::Finish() {
+  if (is_finished_) {
+    return;
+  }
+  is_finished_ = true;
+  const NodeId num_ids = next_range_.load();
+  // The index in 'writers_' of the writer that claimed each range.
+  std::vector<int> range_owners(num_ids / kRangeSize, -1);
+  int num_nodes = 0;
+  int num_edges = 0;
+  for (size_t i = 0; i < writers_.size(); ++i) {
+    for (NodeId range : writers_[i]->ranges_) {
+      range_owners[range / kRangeSize] = static_cast<int>(i);
+    }
+    num_nodes += static_cast<int>(writers_[i]->nodes_.size());
+    num_edges += static_cast<int>(writers_[i]->edges_.size());
+  }
+  LabeledGraph::BulkLoader loader(graph_);
+  loader.Reserve(num_nodes, num_edges);
+  node_ids_.assign(num_ids, kNoNode);
+  // The position in the 'nodes_' vector of each writer of its next node.
+  std::vector<size_t> next_node(writers_.size(), 0);
+  for (size_t range = 0; range < range_owners.size(); ++range) {
+    if (range_owners[range] < 0) {
+      continue;
+    }
+    const Writer& writer = *writers_[range_owners[range]];
+    size_t* pos = &next_node[range_owners[range]];
+    const NodeId range_end = (range + 1) * kRangeSize;
+    for (; *pos < writer.nodes_.size() &&
+           writer.nodes_[*pos].first < range_end;
+         ++*pos) {
+      const auto& node = writer.nodes_[*pos];
+      node_ids_[node.first] = loader.AddNode(writer.labels_.Get(node.second));
+    }
+  }
+  for (const std::unique_ptr<Writer>& writer : writers_) {
+    for (const Edge& edge : writer->edges_) {
+      loader.AddEdge(GetNodeId(edge.source), GetNodeId(edge.target),
+                     writer->labels_.Get(edge.label));
+    }
+  }
+  loader.Finish();
+}
+
+NodeId ConcurrentGraphBuilder::GetNodeId(NodeId node_id) const {
+  CHECK(is_finished_, kNotFinishedErr);
+  CHECK(node_id < node_ids_.size() && node_ids_[node_id] != kNoNode,
+        kInvalidNodeErr);
+  return node_ids_[node_id];
+}
+
+}  // namespace morphie
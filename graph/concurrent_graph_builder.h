@@ -0,0 +1,172 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A concurrent graph builder lets several threads add nodes and edges to a
+// LabeledGraph, which is not thread safe, at the same time. Each thread adds
+// nodes and edges through its own Writer, which records them locally. Writers
+// only synchronize to deduplicate unique labels, and the tables used for this
+// are divided into shards with one lock each, so threads adding different
+// labels rarely wait for each other. The recorded nodes and edges are added to
+// the graph by a single call to Finish().
+//
+// Example.
+//   LabeledGraph graph;
+//   // Initialize 'graph'.
+//   ConcurrentGraphBuilder builder(&graph);
+//   std::vector<std::thread> threads;
+//   for (int i = 0; i < num_threads; ++i) {
+//     ConcurrentGraphBuilder::Writer* writer = builder.NewWriter();
+//     threads.emplace_back([writer, ...] {
+//       NodeId file_id = writer->FindOrAddNode(file);
+//       ...
+//     });
+//   }
+//   for (std::thread& thread : threads) {
+//     thread.join();
+//   }
+//   builder.Finish();
+#ifndef LOGLE_CONCURRENT_GRAPH_BUILDER_H_
+#define LOGLE_CONCURRENT_GRAPH_BUILDER_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "base/string.h"
+#include "graph/label_store.h"
+#include "graph/labeled_graph.h"
+#include "ast.pb.h"
+
+namespace morphie {
+
+// The ConcurrentGraphBuilder class hands out node identifiers before the nodes
+// exist in the graph. These builder node identifiers are allocated from ranges
+// of consecutive values, one range per writer at a time, so allocation does not
+// require a lock. A writer that adds a unique label that another writer has
+// already added receives the identifier allocated by the other writer.
+//
+// Finish() adds the nodes in the order of their builder identifiers and then
+// adds the edges of each writer, in the order in which writers were created.
+// With a single writer, nodes therefore receive the same identifiers in the
+// graph as in the builder, as long as the graph was empty. Labels are type
+// checked by Finish(), according to the validation mode of the graph.
+class ConcurrentGraphBuilder {
+ public:
+  // A Writer adds nodes and edges on behalf of one thread. Writers are owned by
+  // the builder and remain valid until the builder is destroyed.
+  class Writer {
+   public:
+    // Disallow copying and assignment.
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    // Returns the builder identifier of a node with the given label. As in
+    // LabeledGraph::FindOrAddNode, a new node is created unless the label is
+    // unique and a node with this label has already been added by any writer.
+    // - Requires that Finish() has not been called.
+    NodeId FindOrAddNode(const TaggedAST& label);
+    // Adds an edge with the given label between two nodes identified by
+    // builder identifiers, which may have been returned to any writer. An edge
+    // with a unique label is only added once between the same nodes.
+    // - Requires that Finish() has not been called.
+    void FindOrAddEdge(NodeId source, NodeId target, const TaggedAST& label);
+
+   private:
+    friend class ConcurrentGraphBuilder;
+    explicit Writer(ConcurrentGraphBuilder* builder);
+
+    // Returns the next identifier in the range of this writer, claiming a new
+    // range from the builder if the current one is exhausted.
+    NodeId AllocateNodeId();
+
+    ConcurrentGraphBuilder* builder_;
+    // The next identifier and the end of the range of this writer.
+    NodeId next_id_;
+    NodeId range_end_;
+    // The beginnings of the ranges claimed by this writer, in increasing order.
+    std::vector<NodeId> ranges_;
+    // The labels of the nodes and edges recorded by this writer.
+    LabelStore labels_;
+    // The nodes created by this writer, in increasing order of their builder
+    // identifiers, and the edges it added. Labels refer to 'labels_'.
+    std::vector<std::pair<NodeId, LabelId>> nodes_;
+    std::vector<Edge> edges_;
+  };  // class Writer
+
+  // Creates a builder for 'graph' with a default number of shards.
+  // - Requires that 'graph' is initialized and outlives the builder.
+  explicit ConcurrentGraphBuilder(LabeledGraph* graph);
+  // Creates a builder whose tables of unique labels are divided into
+  // 'num_shards' shards.
+  // - Crashes if 'num_shards' is less than 1.
+  ConcurrentGraphBuilder(LabeledGraph* graph, int num_shards);
+  // Calls Finish() if it has not been called.
+  ~ConcurrentGraphBuilder();
+  // Disallow copying and assignment.
+  ConcurrentGraphBuilder(const ConcurrentGraphBuilder&) = delete;
+  ConcurrentGraphBuilder& operator=(const ConcurrentGraphBuilder&) = delete;
+
+  // Returns a new writer. This function may be called concurrently with other
+  // calls to NewWriter() and with writers in use.
+  Writer* NewWriter();
+  // Adds the nodes and edges recorded by all writers to the graph. Calling
+  // Finish() more than once has no effect.
+  // - Requires that no writer is in use.
+  // - Crashes if an edge refers to a node that was not returned by a writer,
+  //   or if a label is checked and is not typed.
+  void Finish();
+  // Returns the identifier in the graph of the node with builder identifier
+  // 'node_id'. Several builder identifiers map to the same node if they have a
+  // unique label that was already in the graph.
+  // - Crashes if Finish() has not been called or if 'node_id' was not returned
+  //   by a writer.
+  NodeId GetNodeId(NodeId node_id) const;
+
+ private:
+  // A shard of the tables of unique node and edge labels. The position of a
+  // node label in 'node_labels' is the position of its builder identifier in
+  // 'nodes'. The labels of the edges in 'edges' refer to 'edge_labels'.
+  struct Shard {
+    std::mutex mutex;
+    LabelStore node_labels;
+    std::vector<NodeId> nodes;
+    LabelStore edge_labels;
+    std::unordered_set<Edge, EdgeHash> edges;
+  };
+
+  // Returns the shard responsible for a label or an edge with hash 'hash'.
+  Shard* GetShard(size_t hash);
+
+  LabeledGraph* graph_;
+  // The tags of unique node and edge labels in 'graph_'.
+  std::set<string> unique_node_tags_;
+  std::set<string> unique_edge_tags_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  // The beginning of the next range of builder identifiers.
+  std::atomic<NodeId> next_range_;
+  std::mutex writers_mutex_;
+  // Guarded by 'writers_mutex_'.
+  std::vector<std::unique_ptr<Writer>> writers_;
+  bool is_finished_;
+  // Maps builder identifiers to identifiers in the graph after Finish().
+  std::vector<NodeId> node_ids_;
+};
+
+}  // namespace morphie
+
+#endif  // LOGLE_CONCURRENT_GRAPH_BUILDER_H_
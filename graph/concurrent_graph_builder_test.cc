@@ -0,0 +1,164 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/concurrent_graph_builder.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "graph/ast.h"
+#include "graph/test_graphs.h"
+#include "graph/value.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace {
+
+using test::InitializeReadsGraph;
+using test::MakeLabel;
+using test::kCountTag;
+using test::kEventTag;
+using test::kFileTag;
+using test::kReadsTag;
+
+TaggedAST MakeReadsLabel() {
+  TaggedAST label;
+  label.set_tag(kReadsTag);
+  return label;
+}
+
+// Adds event 'event' reading the file 'file' and an edge counting the reads.
+void AddRead(int event, const string& file,
+             ConcurrentGraphBuilder::Writer* writer) {
+  NodeId event_id =
+      writer->FindOrAddNode(MakeLabel(kEventTag, ast::value::MakeInt(event)));
+  NodeId file_id =
+      writer->FindOrAddNode(MakeLabel(kFileTag, ast::value::MakeString(file)));
+  writer->FindOrAddEdge(event_id, file_id, MakeReadsLabel());
+  writer->FindOrAddEdge(file_id, event_id, MakeReadsLabel());
+  writer->FindOrAddEdge(event_id, file_id,
+                        MakeLabel(kCountTag, ast::value::MakeInt(1)));
+}
+
+// With a single writer, the graph is the one that FindOrAddNode and
+// FindOrAddEdge would construct, with the same node identifiers.
+TEST(ConcurrentGraphBuilderTest, SingleWriterMatchesLabeledGraph) {
+  LabeledGraph expected;
+  InitializeReadsGraph(&expected);
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  ConcurrentGraphBuilder builder(&graph);
+  ConcurrentGraphBuilder::Writer* writer = builder.NewWriter();
+  std::vector<NodeId> builder_ids;
+  for (int i = 0; i < 3000; ++i) {
+    TaggedAST event = MakeLabel(kEventTag, ast::value::MakeInt(i));
+    TaggedAST file = MakeLabel(kFileTag, ast::value::MakeString(
+                                             "f" + std::to_string(i % 10)));
+    NodeId event_id = expected.FindOrAddNode(event);
+    NodeId file_id = expected.FindOrAddNode(file);
+    expected.FindOrAddEdge(event_id, file_id, MakeReadsLabel());
+    builder_ids.push_back(writer->FindOrAddNode(event));
+    EXPECT_EQ(event_id, builder_ids.back());
+    EXPECT_EQ(file_id, writer->FindOrAddNode(file));
+    writer->FindOrAddEdge(event_id, file_id, MakeReadsLabel());
+  }
+  builder.Finish();
+  ASSERT_EQ(expected.NumNodes(), graph.NumNodes());
+  EXPECT_EQ(expected.NumEdges(), graph.NumEdges());
+  for (NodeId node_id = 0; node_id < static_cast<NodeId>(graph.NumNodes());
+       ++node_id) {
+    EXPECT_TRUE(ast::Equal(expected.GetNodeLabel(node_id),
+                           graph.GetNodeLabel(node_id)));
+  }
+  for (NodeId builder_id : builder_ids) {
+    EXPECT_EQ(builder_id, builder.GetNodeId(builder_id));
+  }
+}
+
+// Unique node labels and unique edges are shared by all writers, while every
+// non-unique node and edge is added once per call.
+TEST(ConcurrentGraphBuilderTest, ConcurrentWritersDeduplicateUniqueLabels) {
+  const int kNumThreads = 4;
+  const int kEventsPerThread = 2000;
+  const int kNumFiles = 50;
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  ConcurrentGraphBuilder builder(&graph, 8);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    ConcurrentGraphBuilder::Writer* writer = builder.NewWriter();
+    threads.emplace_back([writer, t, kEventsPerThread, kNumFiles] {
+      for (int i = 0; i < kEventsPerThread; ++i) {
+        AddRead(t * kEventsPerThread + i, "f" + std::to_string(i % kNumFiles),
+                writer);
+        // This edge has a unique label and is added by every thread.
+        NodeId file0 = writer->FindOrAddNode(
+            MakeLabel(kFileTag, ast::value::MakeString("f0")));
+        NodeId file1 = writer->FindOrAddNode(
+            MakeLabel(kFileTag, ast::value::MakeString("f1")));
+        writer->FindOrAddEdge(file0, file1, MakeReadsLabel());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  builder.Finish();
+  const int kNumEvents = kNumThreads * kEventsPerThread;
+  EXPECT_EQ(kNumEvents + kNumFiles, graph.NumNodes());
+  EXPECT_EQ(3 * kNumEvents + 1, graph.NumEdges());
+  for (int i = 0; i < kNumFiles; ++i) {
+    TaggedAST file =
+        MakeLabel(kFileTag, ast::value::MakeString("f" + std::to_string(i)));
+    EXPECT_EQ(1, graph.NumLabeledNodes(file));
+  }
+}
+
+// A unique label that is already in the graph refers to the existing node.
+TEST(ConcurrentGraphBuilderTest, ReusesExistingUniqueNodes) {
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  NodeId file_id =
+      graph.FindOrAddNode(MakeLabel(kFileTag, ast::value::MakeString("f")));
+  ConcurrentGraphBuilder builder(&graph);
+  ConcurrentGraphBuilder::Writer* writer = builder.NewWriter();
+  AddRead(0, "f", writer);
+  NodeId builder_id =
+      writer->FindOrAddNode(MakeLabel(kFileTag, ast::value::MakeString("f")));
+  builder.Finish();
+  EXPECT_EQ(2, graph.NumNodes());
+  EXPECT_EQ(3, graph.NumEdges());
+  EXPECT_EQ(file_id, builder.GetNodeId(builder_id));
+}
+
+TEST(ConcurrentGraphBuilderDeathTest, RequiresValidUse) {
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  EXPECT_DEATH({ ConcurrentGraphBuilder builder(&graph, 0); },
+               "The number of shards must be positive.");
+  ConcurrentGraphBuilder builder(&graph);
+  ConcurrentGraphBuilder::Writer* writer = builder.NewWriter();
+  NodeId node_id =
+      writer->FindOrAddNode(MakeLabel(kEventTag, ast::value::MakeInt(1)));
+  EXPECT_DEATH({ builder.GetNodeId(node_id); },
+               "The concurrent graph builder has not finished.");
+  builder.Finish();
+  EXPECT_DEATH({ builder.GetNodeId(node_id + 1); }, "Invalid builder node id.");
+  EXPECT_DEATH(
+      { writer->FindOrAddNode(MakeLabel(kEventTag, ast::value::MakeInt(2))); },
+      "The concurrent graph builder has finished.");
+}
+
+}  // namespace
+}  // namespace morphie
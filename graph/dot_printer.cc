@@ -14,10 +14,12 @@
 
 #include "graph/dot_printer.h"
 
-#include <boost/algorithm/string/join.hpp>  // NOLINT
-#include <boost/algorithm/string/replace.hpp>  // NOLINT
 #include <boost/graph/directed_graph.hpp>  // NOLINT
 
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
 #include "graph/ast.h"
 #include "graph/type.h"
 #include "graph/type_checker.h"
@@ -26,11 +28,25 @@
 #include "util/logging.h"
 #include "util/status.h"
 #include "util/string_utils.h"
+#include "util/thread_pool.h"
+#include "util/trace.h"
 
 namespace morphie {
 
 namespace {
 
+const char kGraphHeader[] = "digraph logle_graph {\n";
+// The indentation of node and edge declarations in a graph.
+const char kIndent[] = "  ";
+
+// The number of declarations that a thread renders into one buffer before the
+// buffers of all threads are written out.
+const size_t kDeclarationsPerBuffer = 4096;
+
+const char kThreadsErr[] = "The number of threads must be positive.";
+const char kRemovedNodesErr[] =
+    "A graph with removed nodes must be compacted before it is printed.";
+
 const char kTableHeader[] =
     R"(<table border="0"  cellborder="0" )"
     R"(cellpadding="1" bgcolor="#F8F8F8">)";
@@ -54,166 +70,541 @@ const char kDashedGrayEdge[] =
     "penwidth=.5,arrowsize=.5,arrowhead=onormal,color=gray,style=dashed";
 const char kPrecedesStyle[] = "style=invis";
 
-// Retrieve the string at position 'pos' in the list of strings represented by
-// 'ast'. If 'ast' is not a list of strings, the method GetString will crash.
-string GetListElement(const AST& ast, int pos) {
-  CHECK(pos < ast.c_ast().arg_size(), "");
-  return ast::value::GetString(ast.c_ast().arg(pos));
+// Replace '<','>' and '&' in the suffix of 's' that starts at 'pos' with their
+// corresponding escape sequences. Labels rarely contain these symbols, so the
+// suffix is only copied if it has to be changed.
+void AddEscapes(size_t pos, string* s) {
+  if (s->find_first_of("&<>", pos) == string::npos) {
+    return;
+  }
+  string escaped;
+  for (size_t i = pos; i < s->size(); ++i) {
+    switch ((*s)[i]) {
+      case '&':
+        escaped.append("&amp;");
+        break;
+      case '<':
+        escaped.append("&lt;");
+        break;
+      case '>':
+        escaped.append("&gt;");
+        break;
+      default:
+        escaped.push_back((*s)[i]);
+    }
+  }
+  s->resize(pos);
+  s->append(escaped);
 }
 
-// Replace '<','>' and '&' with their corresponding escape sequences. The '&'
-// symbol must be replaced first to avoid '&lt;' being replaced by '&amp;lt;'.
-void AddEscapes(string* s) {
-  boost::replace_all(*s, "&", "&amp;");
-  boost::replace_all(*s, "<", "&lt;");
-  boost::replace_all(*s, ">", "&gt;");
+// Appends the opening of the attributes "[style, label="label"]" to 'out', or
+// of "[style, label=<label>]" if 'is_html_like' is true. The label is appended
+// in place between OpenAttributes and CloseAttributes.
+void OpenAttributes(const char* style, bool is_html_like, string* out) {
+  out->push_back('[');
+  out->append(style);
+  out->append(is_html_like ? ", label=<" : ", label=\"");
 }
 
-// Returns a string of the form "[shape=Box, label="foo"]" that defines the
-// label and style attributes of a GraphViz node. If 'is_html_like' is true, the
-// string will be of the form "[shape=Box, label=<foo>]", where the label
-// delimiter is angluar brackets.
-string JoinAttributes(const string& style, const string& label,
-                      bool is_html_like) {
-  string quoted_label = is_html_like ? util::StrCat("label=<", label, ">")
-                                     : util::StrCat("label=\"", label, "\"");
-  return util::StrCat("[", style, ", ", quoted_label, "]");
+void CloseAttributes(bool is_html_like, string* out) {
+  out->append(is_html_like ? ">]" : "\"]");
 }
 
-// Returns an AST as an HTML-like DOT label. If the AST is a container, every
-// element in the container is a row of a table. Unlike standard HTML, the HTML
-// implemented in DOT is whitespace sensitive so indents are spaces.
-string ToDotIndent(const AST& ast, int indent) {
+// Appends an AST as an HTML-like DOT label to 'out'. If the AST is a container,
+// every element in the container is a row of a table. Unlike standard HTML, the
+// HTML implemented in DOT is whitespace sensitive so indents are spaces.
+void AppendDotIndent(const AST& ast, int indent, string* out) {
   if (ast.has_p_ast()) {
-    string label = ast::ToStringRoot(ast, ast::PrintOption::kValue);
-    AddEscapes(&label);
-    return util::StrCat(string(indent, ' '), label);
+    out->append(indent, ' ');
+    size_t label_pos = out->size();
+    ast::AppendToStringRoot(ast, ast::PrintOption::kValue, out);
+    AddEscapes(label_pos, out);
+    return;
   }
-  std::vector<string> arg_str;
-  for (const AST& arg : ast.c_ast().arg()) {
-    arg_str.emplace_back(ToDotIndent(arg, indent + 2));
+  out->append(kTableHeader);
+  out->append("\n<tr><td>");
+  for (int i = 0; i < ast.c_ast().arg_size(); ++i) {
+    if (i > 0) {
+      out->append("</td></tr>\n<tr><td>");
+    }
+    AppendDotIndent(ast.c_ast().arg(i), indent + 2, out);
   }
-  return util::StrCat(kTableHeader, "\n<tr><td>",
-                      boost::algorithm::join(arg_str, "</td></tr>\n<tr><td>"),
-                      "</td></tr>\n</table>");
+  out->append("</td></tr>\n</table>");
 }
 
-}  // namespace
-
-DotPrinter::DotPrinter()
-    : node_attribute_(NodeAttribute), edge_attribute_(EdgeAttribute) {}
+// The types of the labels with predefined attributes and the null AST, which
+// are constructed once instead of for every label that is rendered.
+struct AttributeTypes {
+  AttributeTypes()
+      : file(ast::type::MakeFile()),
+        ip_address(ast::type::MakeIPAddress()),
+        url(ast::type::MakeURL()),
+        null_value(ast::value::MakeNull()) {}
 
-DotPrinter::DotPrinter(const AttributeFn& node_attribute,
-                       const AttributeFn& edge_attribute)
-    : node_attribute_(node_attribute), edge_attribute_(edge_attribute) {}
+  const AST file;
+  const AST ip_address;
+  const AST url;
+  const AST null_value;
+};
 
-string DotPrinter::FileAttribute(const AST& ast) {
-  string err;
-  CHECK((ast::type::IsTyped(ast::type::MakeFile(), ast, &err)), "");
-  if (!ast.has_c_ast() || ast.c_ast().arg_size() != 2) {
-    return JoinAttributes(kFilenameStyle, "", false /*Do not use tags.*/);
-  }
-  const AST& path = ast.c_ast().arg(0);
-  const int num_dirs = path.c_ast().arg_size();
-  string filename = (num_dirs > 0) ? GetListElement(path, 0) : "";
-  for (int i = 1; i < num_dirs; ++i) {
-    util::StrAppend(&filename, R"(/\l)");
-    util::StrAppend(&filename, string(2 * i, ' '), "\u21b3",
-                    GetListElement(path, i));
-  }
-  const AST& filename_ast = ast.c_ast().arg(1);
-  if (filename_ast.has_p_ast() && filename_ast.p_ast().has_val()) {
-    util::StrAppend(&filename, R"(/\l)");
-    util::StrAppend(&filename, string(2 * num_dirs, ' '), "\u21b3",
-                    ast::value::GetString(filename_ast));
-  }
-  return JoinAttributes(kFilenameStyle, filename, false /*Do not use tags.*/);
+const AttributeTypes& GetAttributeTypes() {
+  static const AttributeTypes* const types = new AttributeTypes;
+  return *types;
 }
 
-string DotPrinter::IPAddressAttribute(const AST& ast) {
+void AppendFileAttribute(const AST& ast, string* out) {
   string err;
-  CHECK((ast::type::IsTyped(ast::type::MakeIPAddress(), ast, &err)), "");
-  return JoinAttributes(kRemoteAddressStyle, ast::value::GetString(ast),
-                        false /*Do not use tags.*/);
+  CHECK((ast::type::IsTyped(GetAttributeTypes().file, ast, &err)), "");
+  OpenAttributes(kFilenameStyle, false /*Do not use tags.*/, out);
+  if (ast.has_c_ast() && ast.c_ast().arg_size() == 2) {
+    const AST& path = ast.c_ast().arg(0);
+    const int num_dirs = path.c_ast().arg_size();
+    for (int i = 0; i < num_dirs; ++i) {
+      if (i > 0) {
+        out->append(R"(/\l)");
+        out->append(2 * i, ' ');
+        out->append("\u21b3");
+      }
+      out->append(ast::value::GetString(path.c_ast().arg(i)));
+    }
+    const AST& filename_ast = ast.c_ast().arg(1);
+    if (filename_ast.has_p_ast() && filename_ast.p_ast().has_val()) {
+      out->append(R"(/\l)");
+      out->append(2 * num_dirs, ' ');
+      out->append("\u21b3");
+      out->append(ast::value::GetString(filename_ast));
+    }
+  }
+  CloseAttributes(false, out);
 }
 
-string DotPrinter::URLAttribute(const AST& ast) {
+// Appends the attributes of an IP address or a URL, which have the type
+// 'type', to 'out'.
+void AppendAddressAttribute(const AST& type, const AST& ast, string* out) {
   string err;
-  CHECK((ast::type::IsTyped(ast::type::MakeURL(), ast, &err)), "");
-  return JoinAttributes(kRemoteAddressStyle, ast::value::GetString(ast),
-                        false /*Do not use tags.*/);
+  CHECK((ast::type::IsTyped(type, ast, &err)), "");
+  OpenAttributes(kRemoteAddressStyle, false /*Do not use tags.*/, out);
+  out->append(ast::value::GetString(ast));
+  CloseAttributes(false, out);
 }
 
-string DotPrinter::NodeAttribute(const string& tag, const AST& ast) {
+void AppendNodeAttribute(const string& tag, const AST& ast, string* out) {
   if (tag == ast::kFileTag) {
-    return FileAttribute(ast);
+    AppendFileAttribute(ast, out);
   } else if (tag == ast::kIPAddressTag) {
-    return IPAddressAttribute(ast);
+    AppendAddressAttribute(GetAttributeTypes().ip_address, ast, out);
   } else if (tag == ast::kURLTag) {
-    return URLAttribute(ast);
+    AppendAddressAttribute(GetAttributeTypes().url, ast, out);
   } else {
-    return JoinAttributes(kRoundedBoxStyle,
-                          ToDotIndent(ast, 0),
-                          true /*Use tags.*/);
+    OpenAttributes(kRoundedBoxStyle, true /*Use tags.*/, out);
+    AppendDotIndent(ast, 0, out);
+    CloseAttributes(true, out);
   }
 }
 
 // Display an edge label only if there is a non-null AST on an edge.
-string DotPrinter::EdgeAttribute(const string& tag, const AST& ast) {
+void AppendEdgeAttribute(const string& tag, const AST& ast, string* out) {
   if (tag == ast::kPrecedesTag) {
-    return JoinAttributes(kPrecedesStyle, "", false /*Do not use tags.*/);
+    OpenAttributes(kPrecedesStyle, false /*Do not use tags.*/, out);
+    CloseAttributes(false, out);
+  } else if (ast::value::Isomorphic(ast, GetAttributeTypes().null_value)) {
+    OpenAttributes(kDashedGrayEdge, false /*Do not use tags.*/, out);
+    CloseAttributes(false, out);
+  } else {
+    OpenAttributes(kDashedGrayEdge, true /*Use tags.*/, out);
+    AppendDotIndent(ast, 0, out);
+    CloseAttributes(true, out);
+  }
+}
+
+// An attribute policy appends the attributes of a tag and an AST to a buffer.
+// The functions below that render declarations take the policy as a template
+// parameter, so the default attributes are inlined into the loops that render
+// a graph and only client attribute functions are called through an
+// AttributeFn, whose result is copied into the buffer.
+struct DefaultNodeAttributes {
+  void operator()(const string& tag, const AST& ast, string* out) const {
+    AppendNodeAttribute(tag, ast, out);
+  }
+};
+
+struct DefaultEdgeAttributes {
+  void operator()(const string& tag, const AST& ast, string* out) const {
+    AppendEdgeAttribute(tag, ast, out);
+  }
+};
+
+class CustomAttributes {
+ public:
+  explicit CustomAttributes(const AttributeFn& attribute)
+      : attribute_(attribute) {}
+
+  void operator()(const string& tag, const AST& ast, string* out) const {
+    out->append(attribute_(tag, ast));
+  }
+
+ private:
+  const AttributeFn& attribute_;
+};
+
+// Append a node/edge declaration that is terminated with a semi-colon but not
+// a newline to 'out'. Labels without an AST have fixed attributes.
+template <typename NodeAttributes>
+void AppendNode(const NodeAttributes& attributes, NodeId node_id,
+                const TaggedAST& tast, string* out) {
+  util::StrAppend(out, node_id, " ");
+  if (tast.has_ast()) {
+    attributes(tast.tag(), tast.ast(), out);
+  } else {
+    OpenAttributes(kRoundedBoxStyle, false /*Do not use tags.*/, out);
+    out->append(tast.tag());
+    CloseAttributes(false, out);
+  }
+  out->push_back(';');
+}
+
+template <typename EdgeAttributes>
+void AppendEdge(const EdgeAttributes& attributes, NodeId source_id,
+                NodeId target_id, const TaggedAST& tast, string* out) {
+  util::StrAppend(out, source_id, " -> ", target_id, " ");
+  if (tast.has_ast()) {
+    attributes(tast.tag(), tast.ast(), out);
+  } else {
+    OpenAttributes(kSolidGrayEdge, false /*Do not use tags.*/, out);
+    CloseAttributes(false, out);
+  }
+  out->push_back(';');
+}
+
+// Writes the declarations of the items 0 to 'num_items' - 1 to 'out' in order,
+// where 'render(i, &buffer)' appends the declaration of item i to 'buffer'.
+// With more than one thread, every round renders consecutive ranges of items
+// into one buffer per thread and then writes the buffers in order, so the
+// output does not depend on the number of threads and the memory used does not
+// grow with the number of items.
+template <typename RenderFn>
+void WriteDeclarations(size_t num_items, int num_threads,
+                       const RenderFn& render, std::ostream* out) {
+  util::ScopedSpan span("WriteDeclarations");
+  std::vector<string> buffers(num_threads);
+  if (num_threads == 1) {
+    for (size_t i = 0; i < num_items; ++i) {
+      buffers[0].clear();
+      render(i, &buffers[0]);
+      *out << buffers[0];
+    }
+    return;
   }
-  if (ast::value::Isomorphic(ast, ast::value::MakeNull())) {
-    return JoinAttributes(kDashedGrayEdge, "", false /*Do not use tags.*/);
+  // The calling thread renders buffers too, so the pool has one worker less
+  // than the number of threads.
+  util::ThreadPool pool(num_threads - 1);
+  const size_t round_size = num_threads * kDeclarationsPerBuffer;
+  for (size_t round = 0; round < num_items; round += round_size) {
+    util::ParallelFor(buffers.size(), &pool, [&](size_t first, size_t last) {
+      util::ScopedSpan span("RenderDeclarations");
+      for (size_t t = first; t < last; ++t) {
+        size_t begin = std::min(num_items, round + t * kDeclarationsPerBuffer);
+        size_t end = std::min(num_items, begin + kDeclarationsPerBuffer);
+        buffers[t].clear();
+        for (size_t i = begin; i < end; ++i) {
+          render(i, &buffers[t]);
+        }
+      }
+    });
+    for (const string& buffer : buffers) {
+      out->write(buffer.data(), buffer.size());
+    }
+  }
+}
+
+// Writes the declarations of the nodes of 'graph' with identifiers below
+// 'num_node_ids' to 'out'. Identifiers for which 'graph.HasNode' is false
+// render as nothing.
+template <typename Graph, typename NodeAttributes>
+void WriteNodes(const Graph& graph, size_t num_node_ids,
+                const NodeAttributes& attributes, int num_threads,
+                std::ostream* out) {
+  WriteDeclarations(num_node_ids, num_threads,
+                    [&graph, &attributes](NodeId node_id, string* buffer) {
+                      if (graph.HasNode(node_id)) {
+                        buffer->append(kIndent);
+                        AppendNode(attributes, node_id,
+                                   graph.GetNodeLabel(node_id), buffer);
+                        buffer->push_back('\n');
+                      }
+                    },
+                    out);
+}
+
+// Writes the edges of a graph or a view in the order of 'graph.EdgeSetBegin'.
+// Edges cannot be accessed by position, so the parallel printer first collects
+// their identifiers.
+template <typename Graph, typename EdgeAttributes>
+void WriteEdgeSet(const Graph& graph, const EdgeAttributes& attributes,
+                  int num_threads, std::ostream* out) {
+  if (num_threads == 1) {
+    string buffer;
+    for (auto edge_it = graph.EdgeSetBegin(); edge_it != graph.EdgeSetEnd();
+         ++edge_it) {
+      buffer.assign(kIndent);
+      AppendEdge(attributes, graph.Source(*edge_it), graph.Target(*edge_it),
+                 graph.GetEdgeLabel(*edge_it), &buffer);
+      buffer.push_back('\n');
+      *out << buffer;
+    }
+    return;
   }
-  return JoinAttributes(kDashedGrayEdge, ToDotIndent(ast, 0),
-                        true /*Use tags.*/);
+  std::vector<EdgeId> edges(graph.EdgeSetBegin(), graph.EdgeSetEnd());
+  WriteDeclarations(edges.size(), num_threads,
+                    [&graph, &attributes, &edges](size_t i, string* buffer) {
+                      buffer->append(kIndent);
+                      AppendEdge(attributes, graph.Source(edges[i]),
+                                 graph.Target(edges[i]),
+                                 graph.GetEdgeLabel(edges[i]), buffer);
+                      buffer->push_back('\n');
+                    },
+                    out);
+}
+
+template <typename EdgeAttributes>
+void WriteFrozenEdges(const FrozenLabeledGraph& graph,
+                      const EdgeAttributes& attributes, int num_threads,
+                      std::ostream* out) {
+  WriteDeclarations(graph.NumEdges(), num_threads,
+                    [&graph, &attributes](FrozenEdgeId edge_id,
+                                          string* buffer) {
+                      buffer->append(kIndent);
+                      AppendEdge(attributes, graph.Source(edge_id),
+                                 graph.Target(edge_id),
+                                 graph.GetEdgeLabel(edge_id), buffer);
+                      buffer->push_back('\n');
+                    },
+                    out);
+}
+
+}  // namespace
+
+DotPrinter::DotPrinter()
+    : node_attribute_(NodeAttribute),
+      edge_attribute_(EdgeAttribute),
+      has_default_attributes_(true),
+      num_threads_(1) {}
+
+DotPrinter::DotPrinter(const AttributeFn& node_attribute,
+                       const AttributeFn& edge_attribute)
+    : node_attribute_(node_attribute),
+      edge_attribute_(edge_attribute),
+      has_default_attributes_(false),
+      num_threads_(1) {}
+
+void DotPrinter::SetNumThreads(int num_threads) {
+  CHECK(num_threads > 0, kThreadsErr);
+  num_threads_ = num_threads;
+}
+
+string DotPrinter::FileAttribute(const AST& ast) {
+  string attribute;
+  AppendFileAttribute(ast, &attribute);
+  return attribute;
+}
+
+string DotPrinter::IPAddressAttribute(const AST& ast) {
+  string attribute;
+  AppendAddressAttribute(GetAttributeTypes().ip_address, ast, &attribute);
+  return attribute;
+}
+
+string DotPrinter::URLAttribute(const AST& ast) {
+  string attribute;
+  AppendAddressAttribute(GetAttributeTypes().url, ast, &attribute);
+  return attribute;
+}
+
+string DotPrinter::NodeAttribute(const string& tag, const AST& ast) {
+  string attribute;
+  AppendNodeAttribute(tag, ast, &attribute);
+  return attribute;
+}
+
+string DotPrinter::EdgeAttribute(const string& tag, const AST& ast) {
+  string attribute;
+  AppendEdgeAttribute(tag, ast, &attribute);
+  return attribute;
 }
 
-string DotPrinter::DotNode(NodeId node_id, const TaggedAST& tast) {
-  string attr = tast.has_ast() ? node_attribute_(tast.tag(), tast.ast())
-                               : JoinAttributes(kRoundedBoxStyle, tast.tag(),
-                                                false /*Do not use tags.*/);
-  return util::StrCat(std::to_string(node_id), " ", attr, ";");
+string DotPrinter::DotNode(NodeId node_id, const TaggedAST& tast) const {
+  string dot_node;
+  if (has_default_attributes_) {
+    AppendNode(DefaultNodeAttributes(), node_id, tast, &dot_node);
+  } else {
+    AppendNode(CustomAttributes(node_attribute_), node_id, tast, &dot_node);
+  }
+  return dot_node;
 }
 
 string DotPrinter::DotEdge(NodeId source_id, NodeId target_id,
-                           const TaggedAST& tast) {
-  string attr = tast.has_ast() ? edge_attribute_(tast.tag(), tast.ast())
-                               : JoinAttributes(kSolidGrayEdge, "",
-                                                false /*Do not use tags.*/);
-  return util::StrCat(std::to_string(source_id), " -> ",
-                      std::to_string(target_id), " ", attr, ";");
+                           const TaggedAST& tast) const {
+  string dot_edge;
+  if (has_default_attributes_) {
+    AppendEdge(DefaultEdgeAttributes(), source_id, target_id, tast,
+               &dot_edge);
+  } else {
+    AppendEdge(CustomAttributes(edge_attribute_), source_id, target_id, tast,
+               &dot_edge);
+  }
+  return dot_edge;
 }
 
-string DotPrinter::AllNodesInDot(const LabeledGraph& graph) {
-  string dot_nodes;
-  string indent("  ");
-  for (auto node_it = graph.NodeSetBegin(); node_it != graph.NodeSetEnd();
-       ++node_it) {
-    TaggedAST tast = graph.GetNodeLabel(*node_it);
-    util::StrAppend(&dot_nodes, indent, DotNode(*node_it, tast), "\n");
+void DotPrinter::WriteEdge(NodeId source_id, NodeId target_id,
+                           const TaggedAST& ast, std::ostream* out) const {
+  string buffer = kIndent;
+  if (has_default_attributes_) {
+    AppendEdge(DefaultEdgeAttributes(), source_id, target_id, ast, &buffer);
+  } else {
+    AppendEdge(CustomAttributes(edge_attribute_), source_id, target_id, ast,
+               &buffer);
   }
-  return dot_nodes;
+  buffer.push_back('\n');
+  *out << buffer;
+}
+
+string DotPrinter::AllNodesInDot(const LabeledGraph& graph) {
+  std::ostringstream dot_nodes;
+  WriteAllNodes(graph, &dot_nodes);
+  return dot_nodes.str();
 }
 
 string DotPrinter::AllEdgesInDot(const LabeledGraph& graph) {
-  string dot_edges;
-  string indent("  ");
-  for (auto edge_it = graph.EdgeSetBegin(); edge_it != graph.EdgeSetEnd();
-       ++edge_it) {
-    TaggedAST tast = graph.GetEdgeLabel(*edge_it);
-    util::StrAppend(
-        &dot_edges, indent,
-        DotEdge(graph.Source(*edge_it), graph.Target(*edge_it), tast), "\n");
-  }
-  return dot_edges;
+  std::ostringstream dot_edges;
+  WriteAllEdges(graph, &dot_edges);
+  return dot_edges.str();
+}
+
+string DotPrinter::AllNodesInDot(const FrozenLabeledGraph& graph) {
+  std::ostringstream dot_nodes;
+  WriteAllNodes(graph, &dot_nodes);
+  return dot_nodes.str();
+}
+
+string DotPrinter::AllEdgesInDot(const FrozenLabeledGraph& graph) {
+  std::ostringstream dot_edges;
+  WriteAllEdges(graph, &dot_edges);
+  return dot_edges.str();
+}
+
+string DotPrinter::DotGraph(const FrozenLabeledGraph& graph) {
+  std::ostringstream dot_graph;
+  WriteDotGraph(graph, &dot_graph);
+  return dot_graph.str();
 }
 
 string DotPrinter::DotGraph(const LabeledGraph& graph) {
-  string dot_graph = AllNodesInDot(graph);
-  util::StrAppend(&dot_graph, AllEdgesInDot(graph));
-  return util::StrCat("digraph logle_graph {\n", dot_graph, "}");
+  std::ostringstream dot_graph;
+  WriteDotGraph(graph, &dot_graph);
+  return dot_graph.str();
+}
+
+void DotPrinter::WriteAllNodes(const LabeledGraph& graph, std::ostream* out) {
+  CHECK(!graph.HasRemovedNodes(), kRemovedNodesErr);
+  if (has_default_attributes_) {
+    WriteNodes(graph, graph.NumNodes(), DefaultNodeAttributes(), num_threads_,
+               out);
+  } else {
+    WriteNodes(graph, graph.NumNodes(), CustomAttributes(node_attribute_),
+               num_threads_, out);
+  }
+}
+
+void DotPrinter::WriteAllEdges(const LabeledGraph& graph, std::ostream* out) {
+  if (has_default_attributes_) {
+    WriteEdgeSet(graph, DefaultEdgeAttributes(), num_threads_, out);
+  } else {
+    WriteEdgeSet(graph, CustomAttributes(edge_attribute_), num_threads_, out);
+  }
+}
+
+void DotPrinter::WriteAllNodes(const FrozenLabeledGraph& graph,
+                               std::ostream* out) {
+  if (has_default_attributes_) {
+    WriteNodes(graph, graph.NumNodes(), DefaultNodeAttributes(), num_threads_,
+               out);
+  } else {
+    WriteNodes(graph, graph.NumNodes(), CustomAttributes(node_attribute_),
+               num_threads_, out);
+  }
+}
+
+void DotPrinter::WriteAllEdges(const FrozenLabeledGraph& graph,
+                               std::ostream* out) {
+  if (has_default_attributes_) {
+    WriteFrozenEdges(graph, DefaultEdgeAttributes(), num_threads_, out);
+  } else {
+    WriteFrozenEdges(graph, CustomAttributes(edge_attribute_), num_threads_,
+                     out);
+  }
+}
+
+string DotPrinter::AllNodesInDot(const LabeledGraphView& view) {
+  std::ostringstream dot_nodes;
+  WriteAllNodes(view, &dot_nodes);
+  return dot_nodes.str();
+}
+
+string DotPrinter::AllEdgesInDot(const LabeledGraphView& view) {
+  std::ostringstream dot_edges;
+  WriteAllEdges(view, &dot_edges);
+  return dot_edges.str();
+}
+
+string DotPrinter::DotGraph(const LabeledGraphView& view) {
+  std::ostringstream dot_graph;
+  WriteDotGraph(view, &dot_graph);
+  return dot_graph.str();
+}
+
+// Every node identifier of the graph is rendered, and identifiers of nodes that
+// are not in the view render as nothing.
+void DotPrinter::WriteAllNodes(const LabeledGraphView& view,
+                               std::ostream* out) {
+  if (has_default_attributes_) {
+    WriteNodes(view, view.NumNodeIds(), DefaultNodeAttributes(), num_threads_,
+               out);
+  } else {
+    WriteNodes(view, view.NumNodeIds(), CustomAttributes(node_attribute_),
+               num_threads_, out);
+  }
+}
+
+void DotPrinter::WriteAllEdges(const LabeledGraphView& view,
+                               std::ostream* out) {
+  if (has_default_attributes_) {
+    WriteEdgeSet(view, DefaultEdgeAttributes(), num_threads_, out);
+  } else {
+    WriteEdgeSet(view, CustomAttributes(edge_attribute_), num_threads_, out);
+  }
+}
+
+void DotPrinter::WriteDotGraph(const LabeledGraphView& view,
+                               std::ostream* out) {
+  *out << kGraphHeader;
+  WriteAllNodes(view, out);
+  WriteAllEdges(view, out);
+  *out << '}';
+}
+
+void DotPrinter::WriteDotGraph(const LabeledGraph& graph, std::ostream* out) {
+  *out << kGraphHeader;
+  WriteAllNodes(graph, out);
+  WriteAllEdges(graph, out);
+  *out << '}';
+}
+
+void DotPrinter::WriteDotGraph(const FrozenLabeledGraph& graph,
+                               std::ostream* out) {
+  *out << kGraphHeader;
+  WriteAllNodes(graph, out);
+  WriteAllEdges(graph, out);
+  *out << '}';
 }
 
 }  // namespace morphie
@@ -31,13 +31,27 @@
 //   ConstructGraph(&graph);
 //   DotPrinter dot_printer(CustomRenderer, DotPrinter::EdgeAttribute);
 //   string dot_graph = dot_printer.DotGraph(graph);
+//
+// Example 3. Write a large graph to a file without building its DOT
+// representation in memory.
+//   std::ofstream dot_file(filename);
+//   DotPrinter().WriteDotGraph(graph, &dot_file);
+//
+// Example 4. Render the declarations of a large graph on four threads. The
+// output is the same as with one thread.
+//   DotPrinter dot_printer;
+//   dot_printer.SetNumThreads(4);
+//   dot_printer.WriteDotGraph(graph, &dot_file);
 #ifndef LOGLE_DOT_PRINTER_H_
 #define LOGLE_DOT_PRINTER_H_
 
 #include <functional>
+#include <ostream>
 
 #include "base/string.h"
+#include "graph/frozen_labeled_graph.h"
 #include "graph/labeled_graph.h"
+#include "graph/labeled_graph_view.h"
 #include "ast.pb.h"
 
 namespace morphie {
@@ -58,7 +72,7 @@ using AttributeFn = std::function<string(const string&, const AST&)>;
 //
 // The GraphViz DOT format declares nodes and edges and their attributes.
 //
-//  Example 3. A GraphViz DOT graph. The attributes are between square-brackets.
+//  Example 5. A GraphViz DOT graph. The attributes are between square-brackets.
 //  digraph ex3 {
 //    a [shape=Box, label="Rectangle"];  // Node declaration
 //    b [shape=Circle, label="Ellipse"];
@@ -73,7 +87,9 @@ class DotPrinter {
  public:
   // The constructor below, which takes no arguments, sets the node attribute
   // function to be DotPrinter::NodeAttribute and the edge attribute function to
-  // be DotPrinter::EdgeAttribute.
+  // be DotPrinter::EdgeAttribute. This printer appends the default attributes
+  // directly to its output, without a call through an AttributeFn and a
+  // temporary string for every node and edge.
   DotPrinter();
 
   // This constructor uses the arguments to generate node and edge attributes.
@@ -97,26 +113,69 @@ class DotPrinter {
   // otherwise returns a DOT node whose label is 'ast' as a string.
   static string EdgeAttribute(const string& tag, const AST& ast);
 
+  // Sets the number of threads that render node and edge declarations in the
+  // functions below. The default is one thread. Declarations are written in
+  // the same order for any number of threads, so the output does not change.
+  // With more than one thread, the attribute functions are called concurrently
+  // and must be thread safe.
+  // - Crashes if 'num_threads' is less than 1.
+  void SetNumThreads(int num_threads);
+
   // Returns a DOT node/edge declaration that is terminated with a semi-colon
   // but not a newline. The attribute is chosen using 'ast.tag()'.
-  string DotNode(NodeId node_id, const TaggedAST& ast);
-  string DotEdge(NodeId source_id, NodeId target_id, const TaggedAST& ast);
+  string DotNode(NodeId node_id, const TaggedAST& ast) const;
+  string DotEdge(NodeId source_id, NodeId target_id,
+                 const TaggedAST& ast) const;
 
   // Returns a DOT declaration of all nodes/edges in the given graph. If the
   // graph has no nodes, AllNodesInDot returns the empty string. If the graph
   // has no edges, AllEdgesInDot returns the empty string.
   string AllNodesInDot(const LabeledGraph& graph);
   string AllEdgesInDot(const LabeledGraph& graph);
+  string AllNodesInDot(const FrozenLabeledGraph& graph);
+  string AllEdgesInDot(const FrozenLabeledGraph& graph);
+  string AllNodesInDot(const LabeledGraphView& view);
+  string AllEdgesInDot(const LabeledGraphView& view);
 
   // Returns a DOT representation of the graph. The returned string is not
-  // newline terminated.
+  // newline terminated. A graph, a frozen snapshot of it and a view of all of
+  // it have the same representation. The nodes of a view are declared with
+  // their identifiers in the graph.
   string DotGraph(const LabeledGraph& graph);
+  string DotGraph(const FrozenLabeledGraph& graph);
+  string DotGraph(const LabeledGraphView& view);
+
+  // The Write functions write the same text as AllNodesInDot, AllEdgesInDot
+  // and DotGraph to 'out' one declaration at a time, so the memory used does
+  // not grow with the size of the graph. Errors are reported through the state
+  // of 'out'.
+  void WriteAllNodes(const LabeledGraph& graph, std::ostream* out);
+  void WriteAllEdges(const LabeledGraph& graph, std::ostream* out);
+  void WriteAllNodes(const FrozenLabeledGraph& graph, std::ostream* out);
+  void WriteAllEdges(const FrozenLabeledGraph& graph, std::ostream* out);
+  void WriteDotGraph(const LabeledGraph& graph, std::ostream* out);
+  void WriteDotGraph(const FrozenLabeledGraph& graph, std::ostream* out);
+  void WriteAllNodes(const LabeledGraphView& view, std::ostream* out);
+  void WriteAllEdges(const LabeledGraphView& view, std::ostream* out);
+  void WriteDotGraph(const LabeledGraphView& view, std::ostream* out);
+  // Writes the declaration of an edge from 'source_id' to 'target_id' with
+  // the label 'ast' as the functions above write the edges of a graph, so
+  // that edges that are not stored in a graph, such as edges computed from an
+  // index, can be written after them.
+  void WriteEdge(NodeId source_id, NodeId target_id, const TaggedAST& ast,
+                 std::ostream* out) const;
 
  private:
   // The function used to generate node attributes.
   AttributeFn node_attribute_;
   // The function used to generate edge attributes.
   AttributeFn edge_attribute_;
+  // True if the printer was constructed with the default attributes, which are
+  // then appended in place instead of being called through the functions
+  // above.
+  bool has_default_attributes_;
+  // The number of threads that render declarations.
+  int num_threads_;
 };  // class DotPrinter
 
 }  // namespace morphie
@@ -17,11 +17,13 @@
 #include <algorithm>
 #include <boost/regex.hpp>
 #include <set>
+#include <sstream>
 
 #include "analyzers/plaso/plaso_event.h"
 #include "base/string.h"
 #include "base/vector.h"
 #include "graph/ast.h"
+#include "graph/frozen_labeled_graph.h"
 #include "graph/labeled_graph.h"
 #include "graph/type.h"
 #include "graph/type_checker.h"
@@ -375,5 +377,98 @@ TEST_F(LabeledGraphVisualizerTest, CompleteGraphDefaultAttributes) {
   }
 }
 
+// Writing a graph to a stream produces the same text as DotGraph, for both a
+// graph and a frozen snapshot of it.
+TEST_F(LabeledGraphVisualizerTest, WritesGraphToStream) {
+  EXPECT_TRUE(Initialize(&graph_).ok());
+  AddNode(ast::kFileTag, MakeFilename("/example/of/a/file.txt"));
+  AddNode(kRandomTag_, ast::value::MakeString(kRandomTag_));
+  // A frozen graph visits edges in order of their sources.
+  AddEdge(0, 1, ast::kPrecedesTag, ast::value::MakeBool(true));
+  AddEdge(1, 0, kEdgeTag_, ast::value::MakeString("Edge 1"));
+  std::ostringstream out;
+  dot_printer_.WriteDotGraph(graph_, &out);
+  EXPECT_EQ(dot_printer_.DotGraph(graph_), out.str());
+  EXPECT_EQ(util::StrCat("digraph logle_graph {\n",
+                         dot_printer_.AllNodesInDot(graph_),
+                         dot_printer_.AllEdgesInDot(graph_), "}"),
+            out.str());
+  FrozenLabeledGraph frozen_graph(graph_);
+  std::ostringstream frozen_out;
+  dot_printer_.WriteDotGraph(frozen_graph, &frozen_out);
+  EXPECT_EQ(out.str(), frozen_out.str());
+}
+
+// An edge written on its own is declared as the edges of a graph are.
+TEST_F(LabeledGraphVisualizerTest, WritesEdgeToStream) {
+  EXPECT_TRUE(Initialize(&graph_).ok());
+  AddNode(ast::kFileTag, MakeFilename("/example/of/a/file.txt"));
+  AddNode(kRandomTag_, ast::value::MakeString(kRandomTag_));
+  AddEdge(0, 1, ast::kPrecedesTag, ast::value::MakeBool(true));
+  std::ostringstream out;
+  dot_printer_.WriteEdge(0, 1, graph_.GetEdgeLabel(*graph_.EdgeSetBegin()),
+                         &out);
+  EXPECT_EQ(dot_printer_.AllEdgesInDot(graph_), out.str());
+}
+
+// Rendering on several threads produces the same text as rendering on one
+// thread, including for graphs with more declarations than fit in one round of
+// per-thread buffers.
+TEST_F(LabeledGraphVisualizerTest, ParallelMatchesSerialRendering) {
+  EXPECT_TRUE(Initialize(&graph_).ok());
+  const int kNumNodes = 20000;
+  for (int i = 0; i < kNumNodes; ++i) {
+    AddNode(kRandomTag_, ast::value::MakeString(std::to_string(i)));
+  }
+  for (int i = 0; i < kNumNodes; ++i) {
+    NodeId target = (i * 7919) % kNumNodes;
+    AddEdge(i, target, kEdgeTag_, ast::value::MakeString(std::to_string(i)));
+    AddEdge(target, i, ast::kPrecedesTag, ast::value::MakeBool(true));
+  }
+  FrozenLabeledGraph frozen_graph(graph_);
+  const string expected = dot_printer_.DotGraph(graph_);
+  const string frozen_expected = dot_printer_.DotGraph(frozen_graph);
+  for (int num_threads : {2, 3, 8}) {
+    DotPrinter dot_printer;
+    dot_printer.SetNumThreads(num_threads);
+    EXPECT_EQ(expected, dot_printer.DotGraph(graph_)) << num_threads;
+    EXPECT_EQ(frozen_expected, dot_printer.DotGraph(frozen_graph))
+        << num_threads;
+  }
+}
+
+// The default printer, which appends the default attributes in place, produces
+// the same text as a printer that calls them as attribute functions.
+TEST_F(LabeledGraphVisualizerTest, DefaultMatchesAttributeFunctions) {
+  EXPECT_TRUE(Initialize(&graph_).ok());
+  AddNode(ast::kFileTag, MakeFilename("/example/of/a/file.txt"));
+  AddNode(ast::kIPAddressTag, ast::value::MakeString("10.0.0.1"));
+  AddNode(ast::kURLTag, ast::value::MakeString("www.example-url.net"));
+  AddNode(kRandomTag_, ast::value::MakeString("<b>&</b>"));
+  AddEdge(3, 0, kEdgeTag_, ast::value::MakeString("Edge 1"));
+  AddEdge(0, 1, ast::kPrecedesTag, ast::value::MakeBool(true));
+  DotPrinter function_printer(DotPrinter::NodeAttribute,
+                              DotPrinter::EdgeAttribute);
+  EXPECT_EQ(function_printer.DotGraph(graph_), dot_printer_.DotGraph(graph_));
+  FrozenLabeledGraph frozen_graph(graph_);
+  EXPECT_EQ(function_printer.DotGraph(frozen_graph),
+            dot_printer_.DotGraph(frozen_graph));
+  TaggedAST untagged;
+  untagged.set_tag(kRandomTag_);
+  EXPECT_EQ(function_printer.DotNode(4, untagged),
+            dot_printer_.DotNode(4, untagged));
+  EXPECT_EQ(function_printer.DotEdge(0, 4, untagged),
+            dot_printer_.DotEdge(0, 4, untagged));
+  *untagged.mutable_ast() = ast::value::MakeNull();
+  EXPECT_EQ(function_printer.DotEdge(0, 4, untagged),
+            dot_printer_.DotEdge(0, 4, untagged));
+}
+
+TEST(DotPrinterDeathTest, RequiresPositiveNumberOfThreads) {
+  DotPrinter dot_printer;
+  EXPECT_DEATH({ dot_printer.SetNumThreads(0); },
+               "The number of threads must be positive.");
+}
+
 }  // namespace
 }  // namespace morphie
@@ -0,0 +1,224 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains the parts of the binary file formats of graph_file.h and
+// frozen_labeled_graph.h that the two formats share. It is an internal header
+// of those two files and not an interface for other code.
+//
+// A file begins with a header that consists of an 8-byte magic string, a
+// 32-bit format version and a 32-bit byte order mark. Every array begins at an
+// offset that is a multiple of kAlignment bytes, so that arrays can be read in
+// place from a file that is mapped into memory.
+#ifndef LOGLE_GRAPH_FILE_FORMAT_H_
+#define LOGLE_GRAPH_FILE_FORMAT_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include <google/protobuf/message_lite.h>
+
+#include "base/string.h"
+#include "util/span.h"
+
+namespace morphie {
+namespace file_format {
+
+// The size of a magic string.
+const size_t kMagicSize = 8;
+// Reads as a different value on a machine with a different byte order.
+const uint32_t kByteOrderMark = 0x01020304;
+// Arrays begin at offsets that are multiples of this alignment.
+const size_t kAlignment = 8;
+// The size of the buffer through which files are written.
+const size_t kWriteBufferSize = 1 << 20;
+
+// Writes the sections of a file to a stream, keeping track of the offset of
+// the next byte so that arrays can be aligned.
+class FileWriter {
+ public:
+  // The stream is at the offset 'offset' of the file.
+  FileWriter(std::ostream* out, size_t offset) : out_(out), offset_(offset) {}
+
+  void Write(const void* data, size_t size) {
+    out_->write(static_cast<const char*>(data), size);
+    offset_ += size;
+  }
+  template <typename T>
+  void WriteValue(T value) {
+    Write(&value, sizeof(T));
+  }
+  template <typename T>
+  void WriteArray(util::Span<T> values) {
+    Align();
+    Write(values.begin(), values.size() * sizeof(T));
+  }
+  template <typename T>
+  void WriteArray(const std::vector<T>& values) {
+    WriteArray(util::Span<T>(values.data(), values.size()));
+  }
+  // Writes 'message' as a 64-bit size followed by the serialized message.
+  void WriteMessage(const google::protobuf::MessageLite& message) {
+    string bytes;
+    message.SerializeToString(&bytes);
+    WriteValue<uint64_t>(bytes.size());
+    Write(bytes.data(), bytes.size());
+  }
+  // Writes the header of a file with the magic string 'magic' and the format
+  // version 'version'.
+  void WriteHeader(const char (&magic)[kMagicSize], uint32_t version) {
+    Write(magic, kMagicSize);
+    WriteValue<uint32_t>(version);
+    WriteValue<uint32_t>(kByteOrderMark);
+  }
+
+ private:
+  void Align() {
+    static const char kPadding[kAlignment] = {};
+    Write(kPadding, (kAlignment - offset_ % kAlignment) % kAlignment);
+  }
+
+  std::ostream* out_;
+  size_t offset_;
+};
+
+// Reads the sections of a file from memory. Every function returns false if
+// the data read would extend past the end of the file.
+class FileReader {
+ public:
+  FileReader(const char* data, size_t size)
+      : data_(data), size_(size), offset_(0) {}
+
+  bool AtEnd() const { return offset_ == size_; }
+  // Sets '*data' to the address of the next 'size' bytes.
+  bool Read(size_t size, const char** data) {
+    if (size > size_ - offset_) {
+      return false;
+    }
+    *data = data_ + offset_;
+    offset_ += size;
+    return true;
+  }
+  template <typename T>
+  bool ReadValue(T* value) {
+    const char* data;
+    if (!Read(sizeof(T), &data)) {
+      return false;
+    }
+    std::memcpy(value, data, sizeof(T));
+    return true;
+  }
+  // Sets '*values' to the next 'num_values' values, which are not copied. The
+  // mapping of a file begins at a page boundary, so an aligned offset is an
+  // aligned address.
+  template <typename T>
+  bool ReadArray(size_t num_values, util::Span<T>* values) {
+    offset_ = std::min(size_, (offset_ + kAlignment - 1) / kAlignment *
+                                  kAlignment);
+    const char* data;
+    if (num_values > (size_ - offset_) / sizeof(T) ||
+        !Read(num_values * sizeof(T), &data)) {
+      return false;
+    }
+    *values = util::Span<T>(reinterpret_cast<const T*>(data), num_values);
+    return true;
+  }
+  // Reads a message written by FileWriter::WriteMessage.
+  bool ReadMessage(google::protobuf::MessageLite* message) {
+    uint64_t size;
+    const char* data;
+    return ReadValue(&size) &&
+           size <= static_cast<uint64_t>(std::numeric_limits<int>::max()) &&
+           Read(size, &data) &&
+           message->ParseFromArray(data, static_cast<int>(size));
+  }
+  // Reads the header of a file. Returns false if the file does not begin with
+  // the magic string 'magic' followed by a version and a byte order mark,
+  // which are not checked.
+  bool ReadHeader(const char (&magic)[kMagicSize], uint32_t* version,
+                  uint32_t* byte_order_mark) {
+    const char* file_magic;
+    return Read(kMagicSize, &file_magic) &&
+           std::memcmp(file_magic, magic, kMagicSize) == 0 &&
+           ReadValue(version) && ReadValue(byte_order_mark);
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_;
+};
+
+// A read-only mapping of a file into memory, which is removed when the object
+// is destroyed. The kernel is advised that the mapping is read sequentially,
+// since files are checked and then mostly traversed in the order of their
+// sections.
+class MappedFile {
+ public:
+  MappedFile() : data_(nullptr), size_(0) {}
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+  }
+  // Disallow copying and assignment.
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Returns false if 'filename' could not be opened or mapped. An empty file
+  // is mapped to no data.
+  bool Map(const string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+      close(fd);
+      return false;
+    }
+    size_t size = static_cast<size_t>(file_stat.st_size);
+    if (size > 0) {
+      void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) {
+        close(fd);
+        return false;
+      }
+      madvise(mapping, size, MADV_SEQUENTIAL);
+      data_ = mapping;
+      size_ = size;
+    }
+    close(fd);
+    return true;
+  }
+  const char* data() const { return static_cast<const char*>(data_); }
+  size_t size() const { return size_; }
+
+ private:
+  void* data_;
+  size_t size_;
+};
+
+}  // namespace file_format
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_FILE_FORMAT_H_
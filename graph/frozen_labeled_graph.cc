@@ -0,0 +1,444 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A frozen graph file consists of the sections below, in order. Counts are
+// 32-bit unsigned integers and every array begins at an offset that is a
+// multiple of 8 bytes, so arrays can be read in place from a mapped file.
+//  - The magic string "MORPHIEF", the format version, a byte order mark and
+//    the size of a FrozenNodeId.
+//  - The graph label, as a 64-bit size followed by the serialized AST.
+//  - The number of nodes n, the number of edges m and the number of labels l.
+//  - The l + 1 64-bit offsets of the serialized labels, followed by the
+//    serialized labels.
+//  - The arrays of the graph, in the order in which they are declared in
+//    FrozenLabeledGraph: the node labels, the n + 1 out-edge offsets, the
+//    targets, sources and labels of the edges, the n + 1 in-edge offsets and
+//    the edges entering nodes and their sources.
+#include "graph/frozen_labeled_graph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "graph/file_format.h"
+#include "util/logging.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+
+namespace {
+const char kInvalidNodeErr[] = "Invalid node id.";
+const char kInvalidEdgeErr[] = "Invalid edge id.";
+const char kInvalidLabelErr[] = "Invalid label id.";
+const char kTooManyEdgesErr[] = "The graph has too many edges to freeze.";
+const char kTooManyNodesErr[] = "The graph has too many nodes to freeze.";
+const char kNodeIdErr[] = "Node ids of the graph are not consecutive.";
+const char kLabelParseErr[] = "Malformed label in frozen graph file.";
+
+const char kByteOrderErr[] =
+    "The frozen graph file was written with a different byte order or word "
+    "size: ";
+const char kCloseFileErr[] = "Error closing file: ";
+const char kMalformedErr[] = "Malformed frozen graph file: ";
+const char kNotFrozenFileErr[] = "Not a frozen graph file: ";
+const char kOpenFileErr[] = "Error opening file: ";
+const char kVersionErr[] = "Unsupported frozen graph file version: ";
+const char kWriteFileErr[] = "Error writing to file: ";
+
+const char kMagic[file_format::kMagicSize] = {'M', 'O', 'R', 'P',
+                                              'H', 'I', 'E', 'F'};
+const uint32_t kVersion = 2;
+
+// Returns true if the entries of 'values' are less than 'bound'.
+template <typename T>
+bool AllLessThan(util::Span<T> values, uint64_t bound) {
+  for (T value : values) {
+    if (static_cast<uint64_t>(value) >= bound) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if 'offsets' starts at 0, does not decrease and ends at 'last'.
+template <typename T>
+bool IsOffsetArray(util::Span<T> offsets, uint64_t last) {
+  if (offsets.empty() || offsets[0] != 0 ||
+      static_cast<uint64_t>(offsets[offsets.size() - 1]) != last) {
+    return false;
+  }
+  for (size_t i = 1; i < offsets.size(); ++i) {
+    if (offsets[i] < offsets[i - 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+// The out-edges are copied node by node, which also numbers the edges in the
+// order of LabeledGraph::EdgeSetBegin(). The in-edges are then bucketed by
+// target with a counting sort, so that an edge entering a node appears in the
+// order of its identifier.
+FrozenLabeledGraph::Arrays::Arrays(const util::AllocationPolicy& policy)
+    : node_labels(util::PageAllocator<LabelId>(policy)),
+      out_offsets(util::PageAllocator<FrozenEdgeId>(policy)),
+      out_targets(util::PageAllocator<FrozenNodeId>(policy)),
+      edge_sources(util::PageAllocator<FrozenNodeId>(policy)),
+      edge_labels(util::PageAllocator<LabelId>(policy)),
+      in_offsets(util::PageAllocator<FrozenEdgeId>(policy)),
+      in_edges(util::PageAllocator<FrozenEdgeId>(policy)),
+      in_sources(util::PageAllocator<FrozenNodeId>(policy)) {}
+
+FrozenLabeledGraph::FrozenLabeledGraph(const LabeledGraph& graph)
+    : FrozenLabeledGraph(graph, util::AllocationPolicy()) {}
+
+FrozenLabeledGraph::FrozenLabeledGraph(const LabeledGraph& graph,
+                                       const util::AllocationPolicy& policy)
+    : graph_label_(graph.GetGraphLabel()),
+      num_labels_(graph.NumDistinctLabels()),
+      label_bytes_(nullptr),
+      arrays_(policy) {
+  CHECK(!graph.HasRemovedNodes(), kNodeIdErr);
+  const size_t num_nodes = static_cast<size_t>(graph.NumNodes());
+  const size_t num_edges = static_cast<size_t>(graph.NumEdges());
+  CHECK(num_nodes < std::numeric_limits<FrozenNodeId>::max(),
+        kTooManyNodesErr);
+  CHECK(num_edges < std::numeric_limits<FrozenEdgeId>::max(),
+        kTooManyEdgesErr);
+  labels_.reserve(graph.NumDistinctLabels());
+  for (int i = 0; i < graph.NumDistinctLabels(); ++i) {
+    labels_.push_back(graph.GetLabel(static_cast<LabelId>(i)));
+  }
+  arrays_.node_labels.reserve(num_nodes);
+  arrays_.out_offsets.reserve(num_nodes + 1);
+  arrays_.out_targets.reserve(num_edges);
+  arrays_.edge_sources.reserve(num_edges);
+  arrays_.edge_labels.reserve(num_edges);
+  arrays_.in_offsets.assign(num_nodes + 1, 0);
+  for (auto node_it = graph.NodeSetBegin(); node_it != graph.NodeSetEnd();
+       ++node_it) {
+    NodeId node_id = *node_it;
+    CHECK(node_id == arrays_.node_labels.size(), kNodeIdErr);
+    arrays_.node_labels.push_back(graph.GetNodeLabelId(node_id));
+    arrays_.out_offsets.push_back(
+        static_cast<FrozenEdgeId>(arrays_.out_targets.size()));
+    for (auto edge_it = graph.OutEdgeBegin(node_id);
+         edge_it != graph.OutEdgeEnd(node_id); ++edge_it) {
+      NodeId target = graph.Target(*edge_it);
+      arrays_.out_targets.push_back(static_cast<FrozenNodeId>(target));
+      arrays_.edge_sources.push_back(static_cast<FrozenNodeId>(node_id));
+      arrays_.edge_labels.push_back(graph.GetEdgeLabelId(*edge_it));
+      ++arrays_.in_offsets[target + 1];
+    }
+  }
+  arrays_.out_offsets.push_back(
+      static_cast<FrozenEdgeId>(arrays_.out_targets.size()));
+  for (size_t i = 1; i <= num_nodes; ++i) {
+    arrays_.in_offsets[i] += arrays_.in_offsets[i - 1];
+  }
+  std::vector<FrozenEdgeId> next(arrays_.in_offsets.begin(),
+                                 arrays_.in_offsets.end() - 1);
+  arrays_.in_edges.resize(num_edges);
+  arrays_.in_sources.resize(num_edges);
+  for (FrozenEdgeId edge_id = 0; edge_id < num_edges; ++edge_id) {
+    FrozenEdgeId pos = next[arrays_.out_targets[edge_id]]++;
+    arrays_.in_edges[pos] = edge_id;
+    arrays_.in_sources[pos] = arrays_.edge_sources[edge_id];
+  }
+  SetArraySpans();
+}
+
+FrozenLabeledGraph::FrozenLabeledGraph()
+    : num_labels_(0),
+      label_bytes_(nullptr),
+      arrays_(util::AllocationPolicy()) {}
+
+FrozenLabeledGraph::~FrozenLabeledGraph() {
+  if (parsed_labels_ != nullptr) {
+    for (int i = 0; i < num_labels_; ++i) {
+      delete parsed_labels_[i].load();
+    }
+  }
+}
+
+void FrozenLabeledGraph::SetArraySpans() {
+  node_labels_ = arrays_.node_labels;
+  out_offsets_ = arrays_.out_offsets;
+  out_targets_ = arrays_.out_targets;
+  edge_sources_ = arrays_.edge_sources;
+  edge_labels_ = arrays_.edge_labels;
+  in_offsets_ = arrays_.in_offsets;
+  in_edges_ = arrays_.in_edges;
+  in_sources_ = arrays_.in_sources;
+}
+
+
+const TaggedAST& FrozenLabeledGraph::GetNodeLabel(NodeId node_id) const {
+  return GetLabel(GetNodeLabelId(node_id));
+}
+
+const TaggedAST& FrozenLabeledGraph::GetEdgeLabel(FrozenEdgeId edge_id) const {
+  return GetLabel(GetEdgeLabelId(edge_id));
+}
+
+LabelId FrozenLabeledGraph::GetNodeLabelId(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return node_labels_[node_id];
+}
+
+LabelId FrozenLabeledGraph::GetEdgeLabelId(FrozenEdgeId edge_id) const {
+  CHECK(HasEdge(edge_id), kInvalidEdgeErr);
+  return edge_labels_[edge_id];
+}
+
+// Threads that access a label that has not been parsed may parse it
+// concurrently, and the label parsed by the first of them is kept.
+const TaggedAST& FrozenLabeledGraph::GetLabel(LabelId label_id) const {
+  CHECK(label_id < static_cast<LabelId>(num_labels_), kInvalidLabelErr);
+  if (parsed_labels_ == nullptr) {
+    return labels_[label_id];
+  }
+  TaggedAST* label = parsed_labels_[label_id].load(std::memory_order_acquire);
+  if (label != nullptr) {
+    return *label;
+  }
+  std::unique_ptr<TaggedAST> parsed(new TaggedAST);
+  const uint64_t begin = label_offsets_[label_id];
+  CHECK(parsed->ParseFromArray(label_bytes_ + begin,
+                               static_cast<int>(label_offsets_[label_id + 1] -
+                                                begin)),
+        kLabelParseErr);
+  if (parsed_labels_[label_id].compare_exchange_strong(
+          label, parsed.get(), std::memory_order_acq_rel)) {
+    return *parsed.release();
+  }
+  return *label;
+}
+
+NodeId FrozenLabeledGraph::Source(FrozenEdgeId edge_id) const {
+  CHECK(HasEdge(edge_id), kInvalidEdgeErr);
+  return edge_sources_[edge_id];
+}
+
+NodeId FrozenLabeledGraph::Target(FrozenEdgeId edge_id) const {
+  CHECK(HasEdge(edge_id), kInvalidEdgeErr);
+  return out_targets_[edge_id];
+}
+
+util::Span<FrozenNodeId> FrozenLabeledGraph::GetPredecessorRange(
+    NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  FrozenEdgeId begin = in_offsets_[node_id];
+  return util::Span<FrozenNodeId>(in_sources_.begin() + begin,
+                                  in_offsets_[node_id + 1] - begin);
+}
+
+util::Span<FrozenNodeId> FrozenLabeledGraph::GetSuccessorRange(
+    NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  FrozenEdgeId begin = out_offsets_[node_id];
+  return util::Span<FrozenNodeId>(out_targets_.begin() + begin,
+                                  out_offsets_[node_id + 1] - begin);
+}
+
+void FrozenLabeledGraph::CollectPredecessors(NodeId node_id,
+                                             NodeMarker* marker,
+                                             std::vector<NodeId>* nodes) const {
+  for (NodeId predecessor : GetPredecessorRange(node_id)) {
+    if (marker->Mark(predecessor)) {
+      nodes->push_back(predecessor);
+    }
+  }
+  marker->Clear();
+}
+
+void FrozenLabeledGraph::CollectSuccessors(NodeId node_id, NodeMarker* marker,
+                                           std::vector<NodeId>* nodes) const {
+  for (NodeId successor : GetSuccessorRange(node_id)) {
+    if (marker->Mark(successor)) {
+      nodes->push_back(successor);
+    }
+  }
+  marker->Clear();
+}
+
+util::Span<FrozenEdgeId> FrozenLabeledGraph::GetInEdges(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  FrozenEdgeId begin = in_offsets_[node_id];
+  return util::Span<FrozenEdgeId>(in_edges_.begin() + begin,
+                                  in_offsets_[node_id + 1] - begin);
+}
+
+FrozenEdgeId FrozenLabeledGraph::OutEdgeBegin(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return out_offsets_[node_id];
+}
+
+FrozenEdgeId FrozenLabeledGraph::OutEdgeEnd(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return out_offsets_[node_id + 1];
+}
+
+// The labels of a graph that was constructed from a LabeledGraph are
+// serialized into one buffer, which is small compared to the arrays.
+util::Status WriteFrozenGraphFile(const FrozenLabeledGraph& graph,
+                                  const string& filename) {
+  std::vector<uint64_t> label_offsets;
+  string label_bytes;
+  util::Span<uint64_t> offsets = graph.label_offsets_;
+  util::Span<char> bytes;
+  if (graph.parsed_labels_ == nullptr) {
+    label_offsets.reserve(graph.labels_.size() + 1);
+    for (const TaggedAST& label : graph.labels_) {
+      label_offsets.push_back(label_bytes.size());
+      label.AppendToString(&label_bytes);
+    }
+    label_offsets.push_back(label_bytes.size());
+    offsets = label_offsets;
+    bytes = util::Span<char>(label_bytes.data(), label_bytes.size());
+  } else {
+    bytes = util::Span<char>(graph.label_bytes_,
+                             graph.label_offsets_[graph.num_labels_]);
+  }
+  std::vector<char> buffer(file_format::kWriteBufferSize);
+  std::ofstream out_file;
+  out_file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+  out_file.open(filename, std::ofstream::out | std::ofstream::binary |
+                              std::ofstream::trunc);
+  if (!out_file) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  file_format::FileWriter writer(&out_file, 0);
+  writer.WriteHeader(kMagic, kVersion);
+  writer.WriteValue<uint32_t>(sizeof(FrozenNodeId));
+  string graph_label;
+  graph.graph_label_.SerializeToString(&graph_label);
+  writer.WriteValue<uint64_t>(graph_label.size());
+  writer.Write(graph_label.data(), graph_label.size());
+  writer.WriteValue<uint32_t>(graph.NumNodes());
+  writer.WriteValue<uint32_t>(graph.NumEdges());
+  writer.WriteValue<uint32_t>(graph.num_labels_);
+  writer.WriteArray(offsets);
+  writer.WriteArray(bytes);
+  writer.WriteArray(graph.node_labels_);
+  writer.WriteArray(graph.out_offsets_);
+  writer.WriteArray(graph.out_targets_);
+  writer.WriteArray(graph.edge_sources_);
+  writer.WriteArray(graph.edge_labels_);
+  writer.WriteArray(graph.in_offsets_);
+  writer.WriteArray(graph.in_edges_);
+  writer.WriteArray(graph.in_sources_);
+  if (!out_file) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kWriteFileErr, filename));
+  }
+  out_file.close();
+  if (!out_file) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kCloseFileErr, filename));
+  }
+  return util::Status::OK;
+}
+
+// Every array is checked, so that no query reads outside the mapping, but the
+// arrays are not checked against each other, which would require random
+// accesses. A file whose arrays are in range but inconsistent yields a graph
+// whose queries return inconsistent results.
+util::Status MapFrozenGraphFile(const string& filename,
+                                std::unique_ptr<FrozenLabeledGraph>* graph) {
+  std::unique_ptr<FrozenLabeledGraph> mapped(new FrozenLabeledGraph);
+  std::unique_ptr<file_format::MappedFile> file(new file_format::MappedFile);
+  if (!file->Map(filename)) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  file_format::FileReader reader(file->data(), file->size());
+  mapped->mapping_ = std::move(file);
+  uint32_t version, byte_order_mark, node_id_size;
+  if (!reader.ReadHeader(kMagic, &version, &byte_order_mark)) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kNotFrozenFileErr, filename));
+  }
+  if (version != kVersion) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kVersionErr, filename));
+  }
+  if (byte_order_mark != file_format::kByteOrderMark ||
+      !reader.ReadValue(&node_id_size) ||
+      node_id_size != sizeof(FrozenNodeId)) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kByteOrderErr, filename));
+  }
+  const util::Status malformed(Code::INVALID_ARGUMENT,
+                               util::StrCat(kMalformedErr, filename));
+  uint64_t graph_label_size;
+  const char* graph_label;
+  uint32_t num_nodes, num_edges, num_labels;
+  if (!reader.ReadValue(&graph_label_size) ||
+      graph_label_size >
+          static_cast<uint64_t>(std::numeric_limits<int>::max()) ||
+      !reader.Read(graph_label_size, &graph_label) ||
+      !mapped->graph_label_.ParseFromArray(
+          graph_label, static_cast<int>(graph_label_size)) ||
+      !reader.ReadValue(&num_nodes) || !reader.ReadValue(&num_edges) ||
+      !reader.ReadValue(&num_labels) ||
+      num_edges == std::numeric_limits<FrozenEdgeId>::max() ||
+      num_labels >
+          static_cast<uint32_t>(std::numeric_limits<int>::max())) {
+    return malformed;
+  }
+  FrozenLabeledGraph& frozen = *mapped;
+  util::Span<char> label_bytes;
+  if (!reader.ReadArray(num_labels + size_t{1}, &frozen.label_offsets_) ||
+      !IsOffsetArray(frozen.label_offsets_,
+                     frozen.label_offsets_[num_labels]) ||
+      !reader.ReadArray(frozen.label_offsets_[num_labels], &label_bytes) ||
+      !reader.ReadArray(num_nodes, &frozen.node_labels_) ||
+      !reader.ReadArray(num_nodes + size_t{1}, &frozen.out_offsets_) ||
+      !reader.ReadArray(num_edges, &frozen.out_targets_) ||
+      !reader.ReadArray(num_edges, &frozen.edge_sources_) ||
+      !reader.ReadArray(num_edges, &frozen.edge_labels_) ||
+      !reader.ReadArray(num_nodes + size_t{1}, &frozen.in_offsets_) ||
+      !reader.ReadArray(num_edges, &frozen.in_edges_) ||
+      !reader.ReadArray(num_edges, &frozen.in_sources_) ||
+      !reader.AtEnd()) {
+    return malformed;
+  }
+  for (uint32_t label_id = 0; label_id < num_labels; ++label_id) {
+    if (frozen.label_offsets_[label_id + 1] - frozen.label_offsets_[label_id] >
+        static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+      return malformed;
+    }
+  }
+  if (!AllLessThan(frozen.node_labels_, num_labels) ||
+      !IsOffsetArray(frozen.out_offsets_, num_edges) ||
+      !AllLessThan(frozen.out_targets_, num_nodes) ||
+      !AllLessThan(frozen.edge_sources_, num_nodes) ||
+      !AllLessThan(frozen.edge_labels_, num_labels) ||
+      !IsOffsetArray(frozen.in_offsets_, num_edges) ||
+      !AllLessThan(frozen.in_edges_, num_edges) ||
+      !AllLessThan(frozen.in_sources_, num_nodes)) {
+    return malformed;
+  }
+  frozen.num_labels_ = static_cast<int>(num_labels);
+  frozen.label_bytes_ = label_bytes.begin();
+  frozen.parsed_labels_.reset(new std::atomic<TaggedAST*>[num_labels]);
+  for (uint32_t label_id = 0; label_id < num_labels; ++label_id) {
+    frozen.parsed_labels_[label_id].store(nullptr);
+  }
+  *graph = std::move(mapped);
+  return util::Status::OK;
+}
+
+}  // namespace morphie
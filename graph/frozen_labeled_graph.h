@@ -0,0 +1,233 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A frozen labeled graph is an immutable snapshot of a LabeledGraph that is
+// laid out for fast traversal. Once a graph has been constructed from a log,
+// analyses such as partition refinement and printing only read the graph. A
+// LabeledGraph stores a separate edge list for every vertex, while a frozen
+// graph stores the edges of all vertices in a few contiguous arrays, in what
+// is known as compressed sparse row (CSR) format.
+//
+// Example.
+//   LabeledGraph graph;
+//   // Code that constructs a graph.
+//   FrozenLabeledGraph frozen(graph);
+//   for (NodeId successor : frozen.GetSuccessorRange(node_id)) { ... }
+//
+// Node identifiers are the same in the frozen graph and in the graph it was
+// constructed from. Edges are identified by a FrozenEdgeId. The edges leaving a
+// node have consecutive identifiers, and edges are numbered in the order in
+// which LabeledGraph::EdgeSetBegin() enumerates them.
+//
+// A frozen graph is also the compact representation of a graph. An edge of a
+// LabeledGraph is a Boost edge descriptor, which holds its source, its target
+// and a pointer to its label, and every node keeps a separate vector of edges
+// in each direction. A frozen graph stores each edge once, as the entries with
+// its identifier in flat arrays of sources, targets and labels, and stores
+// node identifiers in these arrays as 32-bit FrozenNodeIds. Since neighbor
+// lists dominate the size of a graph, a frozen graph takes less than half the
+// memory of the LabeledGraph it was constructed from, and analyses that index
+// edges can use dense arrays indexed by FrozenEdgeId instead of sets of edge
+// descriptors.
+//
+// A frozen graph can be written to a file and mapped from it by a later
+// analysis, so that graphs larger than memory can be analyzed. The arrays of a
+// mapped graph are read in place from the file, whose pages the operating
+// system loads as they are accessed and evicts under memory pressure, and
+// every label is parsed the first time it is accessed and then kept in memory.
+// Functions that accept a FrozenLabeledGraph, such as RefinePartition and
+// DotPrinter::WriteDotGraph, work unchanged on a mapped graph. They visit nodes
+// and edges in the order of their identifiers, which is the order of the
+// arrays in the file, so the file is read sequentially.
+//   FrozenLabeledGraph frozen(graph);
+//   util::Status status = WriteFrozenGraphFile(frozen, "/tmp/events.frozen");
+//   ...
+//   std::unique_ptr<FrozenLabeledGraph> mapped;
+//   status = MapFrozenGraphFile("/tmp/events.frozen", &mapped);
+#ifndef LOGLE_FROZEN_LABELED_GRAPH_H_
+#define LOGLE_FROZEN_LABELED_GRAPH_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/string.h"
+#include "graph/label_store.h"
+#include "graph/labeled_graph.h"
+#include "ast.pb.h"
+#include "util/page_allocator.h"
+#include "util/span.h"
+#include "util/status.h"
+
+namespace morphie {
+
+namespace file_format {
+class MappedFile;
+}  // namespace file_format
+
+// Identifies an edge of a FrozenLabeledGraph. Edge identifiers are consecutive
+// integers starting from 0.
+using FrozenEdgeId = uint32_t;
+// A node identifier as it is stored in the arrays of a FrozenLabeledGraph.
+// Node identifiers of a frozen graph are less than 2^32, and the functions of
+// the class take and return them as NodeIds.
+using FrozenNodeId = uint32_t;
+
+// The FrozenLabeledGraph class provides read-only access to the nodes, edges
+// and labels of a graph. The class does not keep a reference to the graph it
+// was constructed from. Every query takes constant time, plus the time to parse
+// a label that a mapped graph has not parsed yet, and the neighbor queries
+// return spans into the internal arrays, which remain valid for the lifetime of
+// the frozen graph. The functions may be called concurrently.
+class FrozenLabeledGraph {
+ public:
+  // Takes a snapshot of 'graph'.
+  // - Requires that 'graph' has been initialized.
+  // - Crashes if 'graph' has removed nodes or has 2^32 - 1 or more nodes or
+  //   edges.
+  explicit FrozenLabeledGraph(const LabeledGraph& graph);
+  // Takes a snapshot of 'graph' whose arrays are allocated according to
+  // 'policy', such as with huge pages interleaved over the NUMA nodes of a
+  // host whose threads all traverse the graph.
+  FrozenLabeledGraph(const LabeledGraph& graph,
+                     const util::AllocationPolicy& policy);
+  ~FrozenLabeledGraph();
+  // Disallow copying and assignment.
+  FrozenLabeledGraph(const FrozenLabeledGraph&) = delete;
+  FrozenLabeledGraph& operator=(const FrozenLabeledGraph&) = delete;
+
+  int NumNodes() const { return static_cast<int>(node_labels_.size()); }
+  int NumEdges() const { return static_cast<int>(edge_labels_.size()); }
+  bool HasNode(NodeId node_id) const { return node_id < node_labels_.size(); }
+  bool HasEdge(FrozenEdgeId edge_id) const {
+    return edge_id < edge_labels_.size();
+  }
+  // The label functions have the same semantics as the functions of the same
+  // name in LabeledGraph.
+  // - The node functions require that HasNode(node_id) is true and the edge
+  //   functions require that HasEdge(edge_id) is true.
+  const TaggedAST& GetNodeLabel(NodeId node_id) const;
+  const TaggedAST& GetEdgeLabel(FrozenEdgeId edge_id) const;
+  LabelId GetNodeLabelId(NodeId node_id) const;
+  LabelId GetEdgeLabelId(FrozenEdgeId edge_id) const;
+  int NumDistinctLabels() const { return num_labels_; }
+  // - Requires that 'label_id' is less than NumDistinctLabels().
+  // - Crashes if the label of a mapped graph cannot be parsed.
+  const TaggedAST& GetLabel(LabelId label_id) const;
+  const AST& GetGraphLabel() const { return graph_label_; }
+  // - The functions require that HasEdge(edge_id) is true.
+  NodeId Source(FrozenEdgeId edge_id) const;
+  NodeId Target(FrozenEdgeId edge_id) const;
+
+  // The functions below return the predecessors and successors of a node with
+  // one entry per edge, so a node can occur more than once.
+  //  - The functions require that HasNode(node_id) is true.
+  util::Span<FrozenNodeId> GetPredecessorRange(NodeId node_id) const;
+  util::Span<FrozenNodeId> GetSuccessorRange(NodeId node_id) const;
+  // Appends the distinct predecessors (or successors) of a node to 'nodes'. See
+  // LabeledGraph::CollectPredecessors for details.
+  //  - The functions require that HasNode(node_id) is true.
+  void CollectPredecessors(NodeId node_id, NodeMarker* marker,
+                           std::vector<NodeId>* nodes) const;
+  void CollectSuccessors(NodeId node_id, NodeMarker* marker,
+                         std::vector<NodeId>* nodes) const;
+  // Returns the identifiers of the edges entering a node. The identifiers of
+  // the edges leaving a node are the integers in the range
+  // [OutEdgeBegin(node_id), OutEdgeEnd(node_id)).
+  //  - The functions require that HasNode(node_id) is true.
+  util::Span<FrozenEdgeId> GetInEdges(NodeId node_id) const;
+  FrozenEdgeId OutEdgeBegin(NodeId node_id) const;
+  FrozenEdgeId OutEdgeEnd(NodeId node_id) const;
+
+ private:
+  friend util::Status WriteFrozenGraphFile(const FrozenLabeledGraph& graph,
+                                           const string& filename);
+  friend util::Status MapFrozenGraphFile(
+      const string& filename, std::unique_ptr<FrozenLabeledGraph>* graph);
+
+  // The arrays of a graph that was constructed from a LabeledGraph.
+  struct Arrays {
+    explicit Arrays(const util::AllocationPolicy& policy);
+
+    util::PageVector<LabelId> node_labels;
+    util::PageVector<FrozenEdgeId> out_offsets;
+    util::PageVector<FrozenNodeId> out_targets;
+    util::PageVector<FrozenNodeId> edge_sources;
+    util::PageVector<LabelId> edge_labels;
+    util::PageVector<FrozenEdgeId> in_offsets;
+    util::PageVector<FrozenEdgeId> in_edges;
+    util::PageVector<FrozenNodeId> in_sources;
+  };  // struct Arrays
+
+  // Constructs a graph without nodes and labels, which MapFrozenGraphFile
+  // points at a mapped file.
+  FrozenLabeledGraph();
+  // Points the spans below at the entries of 'arrays_'.
+  void SetArraySpans();
+
+  AST graph_label_;
+  int num_labels_;
+  // The distinct labels of the graph, indexed by label id. A mapped graph
+  // stores label 'l' serialized in 'label_bytes_' from label_offsets_[l] up to
+  // label_offsets_[l + 1] and parses it into 'parsed_labels_' when it is first
+  // accessed.
+  std::vector<TaggedAST> labels_;
+  util::Span<uint64_t> label_offsets_;
+  const char* label_bytes_;
+  mutable std::unique_ptr<std::atomic<TaggedAST*>[]> parsed_labels_;
+  // The arrays of a graph that was constructed from a LabeledGraph, to which
+  // the spans below refer unless the graph was mapped from a file.
+  Arrays arrays_;
+  // The file that a mapped graph was mapped from, or null.
+  std::unique_ptr<file_format::MappedFile> mapping_;
+  util::Span<LabelId> node_labels_;
+  // The edges of node 'n' are the entries of 'edge_sources_', 'out_targets_'
+  // and 'edge_labels_' from out_offsets_[n] up to out_offsets_[n + 1].
+  util::Span<FrozenEdgeId> out_offsets_;
+  util::Span<FrozenNodeId> out_targets_;
+  util::Span<FrozenNodeId> edge_sources_;
+  util::Span<LabelId> edge_labels_;
+  // The edges entering node 'n' are the entries of 'in_edges_' from
+  // in_offsets_[n] up to in_offsets_[n + 1], and 'in_sources_' contains the
+  // sources of those edges.
+  util::Span<FrozenEdgeId> in_offsets_;
+  util::Span<FrozenEdgeId> in_edges_;
+  util::Span<FrozenNodeId> in_sources_;
+};  // class FrozenLabeledGraph
+
+// Writes 'graph' to the file 'filename' as a frozen graph file, which consists
+// of the graph label, the serialized labels and the arrays of the graph. Takes
+// time linear in the size of the graph. The labels of a mapped graph are
+// copied without being parsed. Returns
+//  - EXTERNAL if the file could not be opened, written or closed.
+//  - OK otherwise.
+util::Status WriteFrozenGraphFile(const FrozenLabeledGraph& graph,
+                                  const string& filename);
+
+// Sets '*graph' to the graph in the frozen graph file 'filename', which is
+// mapped into memory for the lifetime of the graph. The arrays of the file are
+// checked in one sequential pass, which takes time linear in the size of the
+// graph, and labels are only parsed when they are accessed. Returns
+//  - EXTERNAL if the file could not be opened or mapped into memory.
+//  - INVALID_ARGUMENT if the file is not a frozen graph file, if it was written
+//    with a different byte order, or if its arrays are malformed.
+//  - OK otherwise.
+// If an error is returned, '*graph' is not changed.
+util::Status MapFrozenGraphFile(const string& filename,
+                                std::unique_ptr<FrozenLabeledGraph>* graph);
+
+}  // namespace morphie
+
+#endif  // LOGLE_FROZEN_LABELED_GRAPH_H_
@@ -0,0 +1,229 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/frozen_labeled_graph.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <vector>
+
+#include "graph/dot_printer.h"
+#include "graph/graph_analyzer.h"
+#include "graph/graph_test_util.h"
+#include "graph/test_graphs.h"
+#include "gtest.h"
+#include "util/test_files.h"
+
+namespace morphie {
+namespace {
+
+using test::ExpectSameGraphs;
+using test::GetTempFile;
+using test::ReadFile;
+
+// Creates the graph 0 -> 1, 0 -> 1, 0 -> 2, 2 -> 1, in which the two edges from
+// 0 to 1 have different weights.
+void GetMultiGraph(test::WeightedGraph* graph) {
+  ASSERT_TRUE(graph->Initialize().ok());
+  NodeId node0 = graph->AddNode(0);
+  NodeId node1 = graph->AddNode(1);
+  NodeId node2 = graph->AddNode(2);
+  graph->AddEdge(node0, node1, 5);
+  graph->AddEdge(node0, node1, 6);
+  graph->AddEdge(node0, node2, 5);
+  graph->AddEdge(node2, node1, 5);
+}
+
+TEST(FrozenLabeledGraphTest, EmptyGraph) {
+  test::WeightedGraph graph;
+  ASSERT_TRUE(graph.Initialize().ok());
+  FrozenLabeledGraph frozen(*graph.GetGraph());
+  EXPECT_EQ(0, frozen.NumNodes());
+  EXPECT_EQ(0, frozen.NumEdges());
+  EXPECT_FALSE(frozen.HasNode(0));
+  EXPECT_FALSE(frozen.HasEdge(0));
+}
+
+TEST(FrozenLabeledGraphTest, PreservesNodesEdgesAndLabels) {
+  test::WeightedGraph weighted_graph;
+  GetMultiGraph(&weighted_graph);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+  FrozenLabeledGraph frozen(graph);
+  ASSERT_EQ(graph.NumNodes(), frozen.NumNodes());
+  ASSERT_EQ(graph.NumEdges(), frozen.NumEdges());
+  EXPECT_EQ(graph.NumDistinctLabels(), frozen.NumDistinctLabels());
+  for (NodeId node_id = 0; node_id < 3; ++node_id) {
+    EXPECT_EQ(graph.GetNodeLabelId(node_id), frozen.GetNodeLabelId(node_id));
+    EXPECT_TRUE(ast::Equal(graph.GetNodeLabel(node_id),
+                           frozen.GetNodeLabel(node_id)));
+  }
+  // Edges are numbered in the order in which the edge set is enumerated.
+  FrozenEdgeId edge_id = 0;
+  for (auto edge_it = graph.EdgeSetBegin(); edge_it != graph.EdgeSetEnd();
+       ++edge_it, ++edge_id) {
+    EXPECT_EQ(graph.Source(*edge_it), frozen.Source(edge_id));
+    EXPECT_EQ(graph.Target(*edge_it), frozen.Target(edge_id));
+    EXPECT_EQ(graph.GetEdgeLabelId(*edge_it), frozen.GetEdgeLabelId(edge_id));
+  }
+}
+
+TEST(FrozenLabeledGraphTest, NeighborQueries) {
+  test::WeightedGraph weighted_graph;
+  GetMultiGraph(&weighted_graph);
+  FrozenLabeledGraph frozen(*weighted_graph.GetGraph());
+  EXPECT_EQ(3, frozen.GetSuccessorRange(0).size());
+  EXPECT_TRUE(frozen.GetPredecessorRange(0).empty());
+  EXPECT_TRUE(frozen.GetSuccessorRange(1).empty());
+  EXPECT_EQ(0, frozen.OutEdgeBegin(0));
+  EXPECT_EQ(3, frozen.OutEdgeEnd(0));
+  EXPECT_EQ(frozen.OutEdgeEnd(1), frozen.OutEdgeBegin(1));
+  util::Span<FrozenEdgeId> in_edges = frozen.GetInEdges(1);
+  ASSERT_EQ(3, in_edges.size());
+  for (FrozenEdgeId edge_id : in_edges) {
+    EXPECT_EQ(1, frozen.Target(edge_id));
+  }
+  NodeMarker marker;
+  std::vector<NodeId> nodes;
+  frozen.CollectPredecessors(1, &marker, &nodes);
+  EXPECT_EQ(std::vector<NodeId>({0, 2}), nodes);
+  nodes.clear();
+  frozen.CollectSuccessors(0, &marker, &nodes);
+  EXPECT_EQ(std::vector<NodeId>({1, 2}), nodes);
+}
+
+TEST(FrozenLabeledGraphTest, SnapshotIsIndependentOfGraph) {
+  test::WeightedGraph weighted_graph;
+  GetMultiGraph(&weighted_graph);
+  FrozenLabeledGraph frozen(*weighted_graph.GetGraph());
+  weighted_graph.AddEdge(weighted_graph.AddNode(3), 0, 7);
+  EXPECT_EQ(3, frozen.NumNodes());
+  EXPECT_EQ(4, frozen.NumEdges());
+  EXPECT_TRUE(frozen.GetPredecessorRange(0).empty());
+}
+
+TEST(FrozenLabeledGraphTest, DotGraphMatchesLabeledGraph) {
+  test::WeightedGraph weighted_graph;
+  GetMultiGraph(&weighted_graph);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+  FrozenLabeledGraph frozen(graph);
+  EXPECT_EQ(DotPrinter().DotGraph(graph), DotPrinter().DotGraph(frozen));
+}
+
+TEST(FrozenLabeledGraphTest, RefinePartitionMatchesLabeledGraph) {
+  test::WeightedGraph path;
+  test::GetPathGraph(6, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  FrozenLabeledGraph frozen(graph);
+  std::map<NodeId, int> partition;
+  for (auto node_it = graph.NodeSetBegin(); node_it != graph.NodeSetEnd();
+       ++node_it) {
+    partition.insert({*node_it, 0});
+  }
+  EXPECT_EQ(graph_analyzer::RefinePartition(graph, partition),
+            graph_analyzer::RefinePartition(frozen, partition));
+}
+
+// A graph whose arrays are mapped with huge pages and interleaved over the
+// NUMA nodes has the same contents as a graph with the default policy.
+TEST(FrozenLabeledGraphTest, AllocatesArraysByPolicy) {
+  test::WeightedGraph path;
+  test::GetPathGraph(1000, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  util::AllocationPolicy policy;
+  policy.huge_pages = util::HugePages::kTransparent;
+  policy.placement = util::NumaPlacement::kInterleave;
+  policy.min_bytes = 0;
+  FrozenLabeledGraph frozen(graph, policy);
+  ExpectSameGraphs(FrozenLabeledGraph(graph), frozen);
+  EXPECT_EQ(DotPrinter().DotGraph(graph), DotPrinter().DotGraph(frozen));
+}
+
+TEST(FrozenLabeledGraphTest, MapsWrittenFiles) {
+  test::WeightedGraph weighted_graph;
+  GetMultiGraph(&weighted_graph);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+  FrozenLabeledGraph frozen(graph);
+  string filename = GetTempFile();
+  ASSERT_TRUE(WriteFrozenGraphFile(frozen, filename).ok());
+  std::unique_ptr<FrozenLabeledGraph> mapped;
+  ASSERT_TRUE(MapFrozenGraphFile(filename, &mapped).ok());
+  ExpectSameGraphs(frozen, *mapped);
+  EXPECT_EQ(DotPrinter().DotGraph(frozen), DotPrinter().DotGraph(*mapped));
+  // A mapped graph is written with the labels it has not parsed.
+  const string contents = ReadFile(filename);
+  std::unique_ptr<FrozenLabeledGraph> remapped;
+  ASSERT_TRUE(MapFrozenGraphFile(filename, &remapped).ok());
+  string rewritten = GetTempFile();
+  ASSERT_TRUE(WriteFrozenGraphFile(*remapped, rewritten).ok());
+  EXPECT_EQ(contents, ReadFile(rewritten));
+  unlink(rewritten.c_str());
+
+  test::WeightedGraph path;
+  test::GetPathGraph(6, &path);
+  FrozenLabeledGraph frozen_path(*path.GetGraph());
+  ASSERT_TRUE(WriteFrozenGraphFile(frozen_path, filename).ok());
+  ASSERT_TRUE(MapFrozenGraphFile(filename, &mapped).ok());
+  std::vector<int> partition(frozen_path.NumNodes(), 0);
+  EXPECT_EQ(graph_analyzer::RefinePartition(frozen_path, partition),
+            graph_analyzer::RefinePartition(*mapped, partition));
+
+  test::WeightedGraph empty;
+  ASSERT_TRUE(empty.Initialize().ok());
+  FrozenLabeledGraph frozen_empty(*empty.GetGraph());
+  ASSERT_TRUE(WriteFrozenGraphFile(frozen_empty, filename).ok());
+  ASSERT_TRUE(MapFrozenGraphFile(filename, &mapped).ok());
+  ExpectSameGraphs(frozen_empty, *mapped);
+  unlink(filename.c_str());
+}
+
+TEST(FrozenLabeledGraphTest, ReportsFileErrors) {
+  test::WeightedGraph weighted_graph;
+  GetMultiGraph(&weighted_graph);
+  FrozenLabeledGraph frozen(*weighted_graph.GetGraph());
+  EXPECT_EQ(Code::EXTERNAL,
+            WriteFrozenGraphFile(frozen, "/nonexistent/frozen").code());
+  std::unique_ptr<FrozenLabeledGraph> mapped;
+  EXPECT_EQ(Code::EXTERNAL,
+            MapFrozenGraphFile("/nonexistent/frozen", &mapped).code());
+
+  string filename = GetTempFile();
+  ASSERT_TRUE(WriteFrozenGraphFile(frozen, filename).ok());
+  const string contents = ReadFile(filename);
+  // Every proper prefix of a file is malformed.
+  for (size_t size = 0; size < contents.size(); ++size) {
+    {
+      std::ofstream file(filename, std::ofstream::binary);
+      file << contents.substr(0, size);
+    }
+    EXPECT_EQ(Code::INVALID_ARGUMENT,
+              MapFrozenGraphFile(filename, &mapped).code())
+        << "Prefix of size " << size;
+  }
+  // The last array holds the sources of the edges entering nodes, so the
+  // last byte of the file belongs to a source.
+  string corrupted = contents;
+  corrupted.back() = '\x7f';
+  {
+    std::ofstream file(filename, std::ofstream::binary);
+    file << corrupted;
+  }
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            MapFrozenGraphFile(filename, &mapped).code());
+  EXPECT_TRUE(mapped == nullptr);
+  unlink(filename.c_str());
+}
+
+}  // namespace
+}  // namespace morphie
@@ -12,15 +12,27 @@
 // License for the specific language governing permissions and limitations under
 // the License.
 
-#include <memory>
-
-#include "ast.h"
+// The refinement is computed with the Paige-Tarjan algorithm on arrays. The
+// nodes are stored in a permutation 'elements' in which every block of the
+// partition, and every super block, is a contiguous range of positions. Blocks
+// are split by moving their marked nodes to the front of their range, so no
+// per-block containers are allocated. The number of edges from a node into a
+// super block is stored in a count record that is shared by all of those edges,
+// as in the original paper.
 #include "graph_analyzer.h"
 
-using std::list;
-using std::map;
-using std::set;
-using std::shared_ptr;
+#include <boost/functional/hash/hash.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "util/logging.h"
+#include "util/span.h"
+#include "util/thread_pool.h"
+#include "util/trace.h"
 
 namespace morphie {
 
@@ -28,375 +40,1029 @@ namespace graph_analyzer {
 
 namespace {
 
-// SuperBlock is defined below.
-struct SuperBlock;
-
-// A 'Block' is a block of a partition. The block contains a set of NodeId's.
-// In addition the block maintains several records about where it is located
-// within other objects.
-// 'parent' is a weak_ptr to the SuperBlock containing it. A weak_ptr is used
-// here instead of a shared_ptr because this would cause a cycle in shared_ptr
-// dependence, leading to memory leaks.
-// 'partitn_loc' is an iterator to the block's location in 'blocks' Used for
-// quick deletion from 'blocks'.
-// 'parent_loc' is an iterator to the block's location in the parent's
-// list of children. Used for quick deletion from the parent.
-struct Block {
- public:
-  Block() : elements() {}
-  explicit Block(NodeId id) : elements({id}) {}
-  set<NodeId> elements;
-  std::weak_ptr<SuperBlock> parent;
-  list<shared_ptr<Block>>::iterator partitn_loc;
-  list<shared_ptr<Block>>::iterator parent_loc;
-};  // struct Block
-
-// This map keeps track of the 1 or 2 new blocks created during a split. After
-// splitting is done, the map is iterated over, adding all of the newly created
-// split blocks to the list.
-using SplitBlockMap = map<shared_ptr<Block>, std::pair<shared_ptr<Block>,
-                                                       shared_ptr<Block>>>;
-
-// An 'SuperBlock' is a non-empty list of pointers to 'Blocks' refered to as
-// its 'children'. Also keeps tracks of a map 'count' which records count(k, S).
-// For a given node k, and a set S, count(k, S) is the number of edges going
-// from k into the set of elements S. S in this case is the union of all the
-// elements of the children of the SuperBlock.
-struct SuperBlock {
- public:
-  explicit SuperBlock() : children(), count() {}
-  explicit SuperBlock(shared_ptr<Block> block) : children(1, block), count() {
-    block->parent_loc = children.begin();
-  }
-  list<shared_ptr<Block>> children;
-  map<NodeId, int> count;
-};  // struct SuperBlock
-
-// RefinementData keeps track of all of the main data structures used in
-// partition refinement.
-// 'blocks' is the partition we refine throughout, and eventually will output
-// (properly formatted as a map).
-// 'super_blocks' is a coarser version of 'blocks'.
-// 'compound_blocks' is a list of 'compound' blocks of super_blocks, i.e.
-// super blocks that contain multiple blocks. When compound_blocks is empty
-// the algorithm terminates.
-// Used for looking up which block a node is in.
-struct RefinementData {
- public:
-  list<shared_ptr<Block>> list_partition;
-  list<shared_ptr<SuperBlock>> super_blocks;
-  list<shared_ptr<SuperBlock>> compound_blocks;
-  map<NodeId, shared_ptr<Block>> block_map;
-};  // struct RefinementData
-
-// A Splitter keeps track of the data structures used in splitting blocks.
-// 'compound_splitter' is the compound_block used for performing a split.
-// 'block_splitter' is the Block that is picked from 'compound_splitter'.
-// 'block_splitter_parent' is the new SuperBlock that contains 'block_splitter'
-// for bookkeeping purposes.
-// 'block_splitter_preimage' is the preimage of 'block_splitter' and is
-// precomputed to make splitting efficient.
-struct Splitter {
+const char kInvalidNodeErr[] = "The partition contains an invalid node id.";
+const char kNewNodesErr[] =
+    "The new blocks do not have one entry for each new node.";
+const char kPartitionSizeErr[] =
+    "The partition does not have one entry for each node.";
+const char kThreadsErr[] = "The number of threads must be positive.";
+const char kRoundsErr[] = "The number of rounds must not be negative.";
+const char kTooManyEdgesErr[] = "The graph has too many edges to refine.";
+
+// A parallel refinement switches to the serial algorithm after a round that
+// creates fewer than one new block per this many nodes.
+const size_t kNodesPerNewBlock = 64;
+
+// Marks records and blocks that do not exist.
+const int kNone = -1;
+
+// The state of a refinement. Nodes are identified by their NodeId, which is
+// less than the number of nodes. Positions refer to 'elements'.
+//
+// A block is the range [block_begin, block_end) of positions. During
+// splitting, the marked nodes of a block occupy [block_begin, block_mark).
+// A super block is the range [super_begin, super_end) and is a union of
+// consecutive blocks. A super block is compound if it contains at least two
+// blocks.
+//
+// The edges of the graph are numbered by their position in the predecessor
+// lists 'pred_sources', which are delimited by 'pred_offsets'. Edge 'e' from x
+// into the super block S refers to the record edge_record[e], whose count is
+// the number of edges from x into S.
+class Refinement {
  public:
-  shared_ptr<SuperBlock> compound_splitter;
-  shared_ptr<Block> block_splitter;
-  shared_ptr<SuperBlock> block_splitter_parent;
-  set<NodeId> block_splitter_preimage;
-};  // struct Splitter
-
-// Takes a list of Block's and outputs a partition in map<NodeId, int> form as
-// required by graph::QuotientGraph.
-map<NodeId, int> ConvertListToMapPartition(
-    const list<shared_ptr<Block>>& list_partition) {
-  map<NodeId, int> blocks_partition;
-  int block_id = 0;
-  for (auto& block : list_partition) {
-    for (NodeId node : block->elements) {
-      blocks_partition.insert({node, block_id});
-    }
-    ++block_id;
-  }
-  return blocks_partition;
-}
-
-// Adds a new block containing 'node' to the records in 'data'.
-void AddNewBlock(const shared_ptr<SuperBlock>& whole_set,
-                 RefinementData* data, NodeId node) {
-  data->list_partition.emplace_back(std::make_shared<Block>(node));
-  shared_ptr<Block> new_block(data->list_partition.back());
-  new_block->partitn_loc = std::prev(data->list_partition.end());
-  new_block->parent = whole_set;
-  data->block_map.insert({node, new_block});
-}
-
-// Iterates through the partition and makes any necessary new blocks and marks
-// any empty blocks.
-void MakeNewAndEmpty(const LabeledGraph& graph,
-                     RefinementData* data,
-                     shared_ptr<SuperBlock> whole_set,
-                     list<shared_ptr<Block>>* new_blocks,
-                     list<shared_ptr<Block>>* empty_blocks) {
-  for (auto& block : data->list_partition) {
-    shared_ptr<Block> new_block = std::make_shared<Block>();
-    for (NodeId node : block->elements) {
-      if (graph.GetSuccessors(node).empty()) {
-        new_block->elements.insert(node);
-        data->block_map[node] = new_block;
-      }
+  // Sets up the refinement of the partition in which node i is in block
+  // blocks[i]. Requires that the entries of 'blocks' are between 0 and
+  // 'num_blocks' - 1.
+  template <typename GraphT>
+  Refinement(const GraphT& graph, const std::vector<int>& blocks,
+             int num_blocks);
+
+  // Refines the partition until it is stable.
+  void Run();
+
+  // Returns the refined partition with blocks numbered from 0 in the order of
+  // their smallest node.
+  std::vector<int> GetPartition() const;
+
+ private:
+  // Moves 'node' to the marked part of its block and records the block in
+  // 'marked_blocks_' if it had no marked nodes.
+  void Mark(NodeId node);
+  // Splits the marked part of every block in 'marked_blocks_' into a new block
+  // unless all nodes in the block are marked, and clears all marks.
+  void SplitMarkedBlocks();
+  // Adds 'super_block' to the compound super blocks if it is compound and not
+  // already among them.
+  void UpdateCompound(int super_block);
+  bool IsCompound(int super_block) const;
+  int NewRecord(int count);
+  void FreeRecord(int record);
+  // Splits the blocks with respect to a block taken from a compound super
+  // block.
+  void SplitWithCompound(int super_block);
+
+  const size_t num_nodes_;
+  std::vector<NodeId> elements_;
+  std::vector<size_t> position_;
+  std::vector<int> block_of_;
+  std::vector<size_t> block_begin_;
+  std::vector<size_t> block_end_;
+  std::vector<size_t> block_mark_;
+  std::vector<int> super_of_;
+  std::vector<size_t> super_begin_;
+  std::vector<size_t> super_end_;
+  std::vector<bool> is_queued_;
+  std::vector<int> compound_;
+  std::vector<size_t> pred_offsets_;
+  std::vector<NodeId> pred_sources_;
+  std::vector<int> edge_record_;
+  std::vector<int> record_count_;
+  std::vector<int> free_records_;
+  std::vector<int> marked_blocks_;
+  // Per-node scratch space used while splitting. For a node x in the preimage
+  // of the splitter B, splitter_count_[x] is the number of edges from x into
+  // B and super_record_[x] is the record of the edges from x into the super
+  // block that contained B.
+  std::vector<int> splitter_count_;
+  std::vector<int> super_record_;
+  std::vector<NodeId> preimage_;
+  std::vector<NodeId> splitter_nodes_;
+};
+
+// The initial blocks are laid out in the order of their identifiers with a
+// counting sort, and the partition is split into nodes with and without
+// successors, which is the split with respect to the set of all nodes.
+template <typename GraphT>
+Refinement::Refinement(const GraphT& graph, const std::vector<int>& blocks,
+                       int num_blocks)
+    : num_nodes_(blocks.size()),
+      elements_(num_nodes_),
+      position_(num_nodes_),
+      block_of_(num_nodes_),
+      block_begin_(num_blocks, 0),
+      block_end_(num_blocks, 0),
+      splitter_count_(num_nodes_, 0),
+      super_record_(num_nodes_, kNone) {
+  for (int block : blocks) {
+    ++block_end_[block];
+  }
+  size_t begin = 0;
+  for (int block = 0; block < num_blocks; ++block) {
+    size_t size = block_end_[block];
+    block_begin_[block] = begin;
+    block_end_[block] = begin;
+    begin += size;
+  }
+  for (NodeId node = 0; node < num_nodes_; ++node) {
+    int block = blocks[node];
+    elements_[block_end_[block]] = node;
+    position_[node] = block_end_[block]++;
+    block_of_[node] = block;
+  }
+  // Empty blocks are removed by renumbering the blocks in order.
+  int num_nonempty = 0;
+  for (int block = 0; block < num_blocks; ++block) {
+    if (block_begin_[block] == block_end_[block]) {
+      continue;
     }
-    for (NodeId moved_node : new_block->elements) {
-      block->elements.erase(moved_node);
+    block_begin_[num_nonempty] = block_begin_[block];
+    block_end_[num_nonempty] = block_end_[block];
+    ++num_nonempty;
+  }
+  block_begin_.resize(num_nonempty);
+  block_end_.resize(num_nonempty);
+  for (int block = 0; block < num_nonempty; ++block) {
+    for (size_t pos = block_begin_[block]; pos < block_end_[block]; ++pos) {
+      block_of_[elements_[pos]] = block;
+    }
+  }
+  block_mark_ = block_begin_;
+  super_of_.assign(num_nonempty, 0);
+  super_begin_.push_back(0);
+  super_end_.push_back(num_nodes_);
+  is_queued_.push_back(false);
+  // Build the predecessor lists and one count record per node with
+  // successors, holding its number of edges into the set of all nodes.
+  pred_offsets_.reserve(num_nodes_ + 1);
+  pred_offsets_.push_back(0);
+  std::vector<int> out_degree(num_nodes_, 0);
+  for (NodeId node = 0; node < num_nodes_; ++node) {
+    for (NodeId predecessor : graph.GetPredecessorRange(node)) {
+      pred_sources_.push_back(predecessor);
+      ++out_degree[predecessor];
     }
-    if (new_block->elements.empty()) {
+    pred_offsets_.push_back(pred_sources_.size());
+  }
+  CHECK(pred_sources_.size() <
+            static_cast<size_t>(std::numeric_limits<int>::max()),
+        kTooManyEdgesErr);
+  std::vector<int> node_record(num_nodes_, kNone);
+  for (NodeId node = 0; node < num_nodes_; ++node) {
+    if (out_degree[node] > 0) {
+      node_record[node] = NewRecord(out_degree[node]);
+      Mark(node);
+    }
+  }
+  edge_record_.resize(pred_sources_.size());
+  for (size_t edge = 0; edge < pred_sources_.size(); ++edge) {
+    edge_record_[edge] = node_record[pred_sources_[edge]];
+  }
+  SplitMarkedBlocks();
+  UpdateCompound(0);
+}
+
+void Refinement::Run() {
+  while (!compound_.empty()) {
+    int super_block = compound_.back();
+    compound_.pop_back();
+    is_queued_[super_block] = false;
+    SplitWithCompound(super_block);
+  }
+}
+
+std::vector<int> Refinement::GetPartition() const {
+  std::vector<int> block_ids(block_begin_.size(), kNone);
+  std::vector<int> partition(num_nodes_);
+  int num_blocks = 0;
+  for (NodeId node = 0; node < num_nodes_; ++node) {
+    int& block_id = block_ids[block_of_[node]];
+    if (block_id == kNone) {
+      block_id = num_blocks++;
+    }
+    partition[node] = block_id;
+  }
+  return partition;
+}
+
+void Refinement::Mark(NodeId node) {
+  int block = block_of_[node];
+  size_t mark = block_mark_[block];
+  if (mark == block_begin_[block]) {
+    marked_blocks_.push_back(block);
+  }
+  NodeId other = elements_[mark];
+  size_t pos = position_[node];
+  elements_[pos] = other;
+  position_[other] = pos;
+  elements_[mark] = node;
+  position_[node] = mark;
+  ++block_mark_[block];
+}
+
+// The marked nodes move to a new block, so the work is proportional to the
+// number of marked nodes.
+void Refinement::SplitMarkedBlocks() {
+  for (int block : marked_blocks_) {
+    size_t begin = block_begin_[block];
+    size_t mark = block_mark_[block];
+    block_mark_[block] = begin;
+    if (mark == block_end_[block]) {
       continue;
     }
-    new_block->parent = whole_set;
-    whole_set->children.push_back(new_block);
-    new_block->parent_loc = std::prev(whole_set->children.end());
-    new_blocks->push_back(new_block);
-    // If old block is now empty, mark it to be removed.
-    if (block->elements.empty()) {
-      empty_blocks->push_back(block);
-    }
-  }
-}
-
-// Splits the partition with respect to the whole set.
-void SingleBlockPartitionSplit(const LabeledGraph& graph,
-                               RefinementData* data) {
-  auto whole_set = data->super_blocks.back();
-  // List of new blocks when splitting.
-  list<shared_ptr<Block>> new_blocks;
-  // List of blocks that become empty when splitting.
-  list<shared_ptr<Block>> empty_blocks;
-
-  MakeNewAndEmpty(graph, data, whole_set, &new_blocks, &empty_blocks);
-
-  // Cleanup, adding new blocks, removing empty, old blocks.
-  for (const auto& new_block: new_blocks) {
-    data->list_partition.push_back(new_block);
-    new_block->partitn_loc = std::prev(data->list_partition.end());
-  }
-  for (const auto& block : empty_blocks) {
-    data->list_partition.erase(block->partitn_loc);
-    auto parent = block->parent.lock();
-    parent->children.erase(block->parent_loc);
-  }
-}
-
-// Intializes the data structures 'list_partition', 'super_blocks',
-// 'compound_blocks', and block_map. Converts 'partition' from a map to a list
-// and populates 'list_partition'. 'super_blocks' and 'compound_blocks' are
-// initialized to a single element containing all of the blocks.
-void InitializeDataStructures(const LabeledGraph& graph,
-                              const map<NodeId, int>& partition,
-                              RefinementData* data) {
-  map<int, shared_ptr<Block>> initializationMap;
-  data->super_blocks.emplace_back(std::make_shared<SuperBlock>());
-  shared_ptr<SuperBlock> whole_set = data->super_blocks.back();
-  for (auto& pair : partition) {
-    NodeId node = pair.first;
-    int block_id = pair.second;
-    auto init_it = initializationMap.find(block_id);
-    if (init_it == initializationMap.end()) {
-      AddNewBlock(whole_set, data, node);
-      initializationMap[block_id] = data->list_partition.back();
-    } else {
-      init_it->second->elements.insert(node);
-      data->block_map.insert({node, init_it->second});
-    }
-    whole_set->count.insert({node, graph.GetSuccessors(node).size()});
-  }
-  for (auto& block : data->list_partition) {
-    whole_set->children.push_back(block);
-    block->parent_loc = std::prev(whole_set->children.end());
-  }
-  SingleBlockPartitionSplit(graph, data);
-  if (whole_set->children.size() > 1) {
-    data->compound_blocks.push_back(whole_set);
-  }
-}
-
-// Picks a group of Blocks to use for splitting. Also picks one of blocks in
-// that group for splitting.
-void PickSplitter(RefinementData* data, Splitter* split) {
-  split->compound_splitter = data->compound_blocks.front();
-  data->compound_blocks.pop_front();
-  auto compound_it = split->compound_splitter->children.begin();
-  split->block_splitter = *compound_it;
-  ++compound_it;
-  if (split->block_splitter->elements.size() >
-      (*compound_it)->elements.size()) {
-    split->block_splitter = *compound_it;
-    split->compound_splitter->children.erase(compound_it);
-  } else {
-    split->compound_splitter->children.pop_front();
+    int new_block = static_cast<int>(block_begin_.size());
+    block_begin_.push_back(begin);
+    block_end_.push_back(mark);
+    block_mark_.push_back(begin);
+    super_of_.push_back(super_of_[block]);
+    block_begin_[block] = mark;
+    block_mark_[block] = mark;
+    for (size_t pos = begin; pos < mark; ++pos) {
+      block_of_[elements_[pos]] = new_block;
+    }
+    UpdateCompound(super_of_[block]);
   }
+  marked_blocks_.clear();
 }
 
-void UpdateCoarseCompound(RefinementData* data, Splitter* split) {
-  data->super_blocks.emplace_back(
-      std::make_shared<SuperBlock>(split->block_splitter));
-  split->block_splitter_parent = data->super_blocks.back();
-  split->block_splitter->parent = split->block_splitter_parent;
-  if (split->compound_splitter->children.size() > 1) {
-    data->compound_blocks.push_back(split->compound_splitter);
+bool Refinement::IsCompound(int super_block) const {
+  return block_of_[elements_[super_begin_[super_block]]] !=
+         block_of_[elements_[super_end_[super_block] - 1]];
+}
+
+void Refinement::UpdateCompound(int super_block) {
+  if (!is_queued_[super_block] && super_begin_[super_block] !=
+      super_end_[super_block] && IsCompound(super_block)) {
+    is_queued_[super_block] = true;
+    compound_.push_back(super_block);
   }
 }
 
-void ComputePreimage(const LabeledGraph& graph,
-                     Splitter* split) {
-  for (NodeId node : split->block_splitter->elements) {
-    set<NodeId> node_predecessors = graph.GetPredecessors(node);
-    for (NodeId predecessor : node_predecessors) {
-      split->block_splitter_preimage.insert(predecessor);
-      auto count_it = split->block_splitter_parent->count.find(predecessor);
-      if (count_it == split->block_splitter_parent->count.end()) {
-        split->block_splitter_parent->count.insert({predecessor, 1});
-      } else {
-        count_it->second += 1;
+int Refinement::NewRecord(int count) {
+  if (free_records_.empty()) {
+    record_count_.push_back(count);
+    return static_cast<int>(record_count_.size()) - 1;
+  }
+  int record = free_records_.back();
+  free_records_.pop_back();
+  record_count_[record] = count;
+  return record;
+}
+
+void Refinement::FreeRecord(int record) { free_records_.push_back(record); }
+
+// The splitter B is the smaller of the first and the last block of the
+// compound super block S, which is at most half of S. B becomes a new super
+// block. Blocks are split first by the preimage of B and then by the nodes
+// with no edge into S - B, whose edges into S all go into B.
+void Refinement::SplitWithCompound(int super_block) {
+  int first = block_of_[elements_[super_begin_[super_block]]];
+  int last = block_of_[elements_[super_end_[super_block] - 1]];
+  int splitter = first;
+  if (block_end_[last] - block_begin_[last] <
+      block_end_[first] - block_begin_[first]) {
+    splitter = last;
+    super_end_[super_block] = block_begin_[last];
+  } else {
+    super_begin_[super_block] = block_end_[first];
+  }
+  int new_super_block = static_cast<int>(super_begin_.size());
+  super_begin_.push_back(block_begin_[splitter]);
+  super_end_.push_back(block_end_[splitter]);
+  is_queued_.push_back(false);
+  super_of_[splitter] = new_super_block;
+  UpdateCompound(super_block);
+  // Count the edges from each node into B. The nodes of B are copied because
+  // splitting by the preimage may reorder them.
+  preimage_.clear();
+  splitter_nodes_.assign(elements_.begin() + block_begin_[splitter],
+                         elements_.begin() + block_end_[splitter]);
+  for (NodeId node : splitter_nodes_) {
+    for (size_t edge = pred_offsets_[node]; edge < pred_offsets_[node + 1];
+         ++edge) {
+      NodeId predecessor = pred_sources_[edge];
+      if (splitter_count_[predecessor] == 0) {
+        preimage_.push_back(predecessor);
+        super_record_[predecessor] = edge_record_[edge];
       }
+      ++splitter_count_[predecessor];
+    }
+  }
+  for (NodeId node : preimage_) {
+    Mark(node);
+  }
+  SplitMarkedBlocks();
+  for (NodeId node : preimage_) {
+    if (splitter_count_[node] == record_count_[super_record_[node]]) {
+      Mark(node);
+    }
+  }
+  SplitMarkedBlocks();
+  // Move the counts of edges into B to new records and point the edges into B
+  // at them.
+  for (NodeId node : preimage_) {
+    int record = super_record_[node];
+    record_count_[record] -= splitter_count_[node];
+    if (record_count_[record] == 0) {
+      FreeRecord(record);
     }
+    super_record_[node] = NewRecord(splitter_count_[node]);
+  }
+  for (NodeId node : splitter_nodes_) {
+    for (size_t edge = pred_offsets_[node]; edge < pred_offsets_[node + 1];
+         ++edge) {
+      edge_record_[edge] = super_record_[pred_sources_[edge]];
+    }
+  }
+  for (NodeId node : preimage_) {
+    splitter_count_[node] = 0;
+    super_record_[node] = kNone;
   }
 }
 
-void InitializeSplitter(const LabeledGraph& graph,
-                        RefinementData* data, Splitter* split) {
-  UpdateCoarseCompound(data, split);
-  ComputePreimage(graph, split);
+// Return a bound on the node identifiers of a graph. The algorithms below visit
+// every identifier below the bound, and the identifiers of the nodes of a view
+// need not be consecutive. A node that is not in a view has no edges in it.
+size_t NodeIdBound(const LabeledGraph& graph) { return graph.NumNodes(); }
+size_t NodeIdBound(const FrozenLabeledGraph& graph) { return graph.NumNodes(); }
+size_t NodeIdBound(const LabeledGraphView& view) { return view.NumNodeIds(); }
+
+// Renumbers the block identifiers of 'partition' consecutively from 0.
+std::vector<int> NormalizeBlocks(const std::vector<int>& partition,
+                                 int* num_blocks) {
+  std::unordered_map<int, int> block_ids;
+  std::vector<int> blocks;
+  blocks.reserve(partition.size());
+  for (int block : partition) {
+    auto insert_result =
+        block_ids.insert({block, static_cast<int>(block_ids.size())});
+    blocks.push_back(insert_result.first->second);
+  }
+  *num_blocks = static_cast<int>(block_ids.size());
+  return blocks;
+}
+
+template <typename GraphT>
+std::vector<int> RefineVectorPartition(const GraphT& graph,
+                                       const std::vector<int>& partition) {
+  util::ScopedSpan span("RefinePartition");
+  CHECK(partition.size() == NodeIdBound(graph), kPartitionSizeErr);
+  int num_blocks;
+  std::vector<int> blocks = NormalizeBlocks(partition, &num_blocks);
+  Refinement refinement(graph, blocks, num_blocks);
+  refinement.Run();
+  return refinement.GetPartition();
+}
+
+// Nodes missing from 'partition' are given a block identifier that no node in
+// 'partition' has.
+template <typename GraphT>
+std::map<NodeId, int> RefineMapPartition(
+    const GraphT& graph, const std::map<NodeId, int>& partition) {
+  std::unordered_map<int, int> block_ids;
+  for (const auto& node_block : partition) {
+    CHECK(graph.HasNode(node_block.first), kInvalidNodeErr);
+    block_ids.insert({node_block.second, static_cast<int>(block_ids.size())});
+  }
+  std::vector<int> blocks(NodeIdBound(graph),
+                          static_cast<int>(block_ids.size()));
+  for (const auto& node_block : partition) {
+    blocks[node_block.first] = block_ids[node_block.second];
+  }
+  std::vector<int> refinement = RefineVectorPartition(graph, blocks);
+  std::map<NodeId, int> result;
+  for (const auto& node_block : partition) {
+    result.emplace_hint(result.end(), node_block.first,
+                        refinement[node_block.first]);
+  }
+  return result;
 }
 
-void UpdateCounts(Splitter* split) {
-  auto preimage_end_it = split->block_splitter_preimage.end();
-  for (auto preimage_it = split->block_splitter_preimage.begin();
-       preimage_it != preimage_end_it; ++preimage_it) {
-    NodeId node = *preimage_it;
-    auto count_it = split->compound_splitter->count.find(node);
-    count_it->second -= split->block_splitter_parent->count.at(node);
-    if (count_it->second < 1) {
-      split->compound_splitter->count.erase(count_it);
+// The state of a parallel refinement. The signature of node x is the pair of
+// blocks[x] and the sorted, distinct blocks of its neighbors, which are stored
+// in 'signatures_' starting at neighbor_offsets_[x]. The neighbors of x are
+// its successors, its predecessors or both, depending on the direction of the
+// refinement, and the successors precede the predecessors. The block b of a
+// predecessor is stored as -1 - b, so that a block is distinguished from the
+// same block in the other direction.
+class ParallelRefinement {
+ public:
+  template <typename GraphT>
+  ParallelRefinement(const GraphT& graph, RefinementDirection direction,
+                     int num_threads);
+
+  // Replaces 'blocks' by the partition of the nodes by signature, numbered in
+  // the order of the smallest node, and returns the number of blocks.
+  int RefineBySignature(std::vector<int>* blocks);
+
+ private:
+  void ComputeSignatures(const std::vector<int>& blocks, size_t begin,
+                         size_t end);
+  bool SameSignature(const std::vector<int>& blocks, NodeId node1,
+                     NodeId node2) const;
+  // Groups the nodes of 'shard' by signature, sets group_[x] for each such
+  // node x to an identifier that is unique within the shard, and returns the
+  // number of identifiers.
+  int GroupShard(const std::vector<int>& blocks, int shard);
+
+  const size_t num_nodes_;
+  const int num_threads_;
+  // The calling thread works alongside the workers of the pool.
+  util::ThreadPool pool_;
+  std::vector<size_t> neighbor_offsets_;
+  // The position of the first predecessor of each node in 'neighbors_'.
+  std::vector<size_t> pred_begin_;
+  std::vector<NodeId> neighbors_;
+  std::vector<int> signatures_;
+  std::vector<size_t> signature_size_;
+  std::vector<size_t> signature_hash_;
+  // The nodes of each shard, in increasing order, delimited by
+  // 'shard_offsets_'. A node belongs to the shard given by its hash.
+  std::vector<NodeId> shard_nodes_;
+  std::vector<size_t> shard_offsets_;
+  std::vector<int> group_;
+};
+
+template <typename GraphT>
+ParallelRefinement::ParallelRefinement(const GraphT& graph,
+                                       RefinementDirection direction,
+                                       int num_threads)
+    : num_nodes_(NodeIdBound(graph)),
+      num_threads_(num_threads),
+      pool_(num_threads - 1),
+      neighbor_offsets_(num_nodes_ + 1, 0),
+      pred_begin_(num_nodes_),
+      signature_size_(num_nodes_),
+      signature_hash_(num_nodes_),
+      shard_nodes_(num_nodes_),
+      group_(num_nodes_) {
+  const bool has_successors = direction != RefinementDirection::kBackward;
+  const bool has_predecessors = direction != RefinementDirection::kForward;
+  std::vector<size_t> num_successors(num_nodes_, 0);
+  util::ParallelFor(num_nodes_, &pool_, [&](size_t begin, size_t end) {
+    for (NodeId node = begin; node < end; ++node) {
+      size_t degree = 0;
+      if (has_successors) {
+        for (NodeId successor : graph.GetSuccessorRange(node)) {
+          (void)successor;
+          ++degree;
+        }
+      }
+      num_successors[node] = degree;
+      if (has_predecessors) {
+        for (NodeId predecessor : graph.GetPredecessorRange(node)) {
+          (void)predecessor;
+          ++degree;
+        }
+      }
+      neighbor_offsets_[node + 1] = degree;
     }
+  });
+  for (size_t node = 0; node < num_nodes_; ++node) {
+    neighbor_offsets_[node + 1] += neighbor_offsets_[node];
+    pred_begin_[node] = neighbor_offsets_[node] + num_successors[node];
   }
+  neighbors_.resize(neighbor_offsets_[num_nodes_]);
+  signatures_.resize(neighbors_.size());
+  util::ParallelFor(num_nodes_, &pool_, [&](size_t begin, size_t end) {
+    for (NodeId node = begin; node < end; ++node) {
+      size_t pos = neighbor_offsets_[node];
+      if (has_successors) {
+        for (NodeId successor : graph.GetSuccessorRange(node)) {
+          neighbors_[pos++] = successor;
+        }
+      }
+      if (has_predecessors) {
+        for (NodeId predecessor : graph.GetPredecessorRange(node)) {
+          neighbors_[pos++] = predecessor;
+        }
+      }
+    }
+  });
 }
 
-// After splitting, cleanup and update data. Delete empty blocks, add new
-// compound blocks to compound_blocks.
-void CleanupSplit(const SplitBlockMap& split_blocks,
-                  RefinementData* data) {
-  auto split_end_it = split_blocks.end();
-  for (auto split_it = split_blocks.begin(); split_it != split_end_it;
-       ++split_it) {
-    shared_ptr<Block> D = split_it->first;
-    auto associated_pair = split_it->second;
-    int num_new_blocks = 0;
-    // Adding new blocks.
-    if (associated_pair.first) {
-      data->list_partition.push_back(associated_pair.first);
-      associated_pair.first->partitn_loc =
-          std::prev(data->list_partition.end());
-      ++num_new_blocks;
+void ParallelRefinement::ComputeSignatures(const std::vector<int>& blocks,
+                                           size_t begin, size_t end) {
+  for (NodeId node = begin; node < end; ++node) {
+    auto first = signatures_.begin() + neighbor_offsets_[node];
+    auto last = signatures_.begin() + neighbor_offsets_[node + 1];
+    for (size_t pos = neighbor_offsets_[node]; pos < pred_begin_[node];
+         ++pos) {
+      signatures_[pos] = blocks[neighbors_[pos]];
+    }
+    for (size_t pos = pred_begin_[node]; pos < neighbor_offsets_[node + 1];
+         ++pos) {
+      signatures_[pos] = -1 - blocks[neighbors_[pos]];
+    }
+    std::sort(first, last);
+    last = std::unique(first, last);
+    signature_size_[node] = last - first;
+    size_t hash = static_cast<size_t>(blocks[node]);
+    for (auto it = first; it != last; ++it) {
+      boost::hash_combine(hash, *it);
     }
-    if (associated_pair.second) {
-      data->list_partition.push_back(associated_pair.second);
-      associated_pair.second->partitn_loc =
-          std::prev(data->list_partition.end());
-      ++num_new_blocks;
+    signature_hash_[node] = hash;
+  }
+}
+
+bool ParallelRefinement::SameSignature(const std::vector<int>& blocks,
+                                       NodeId node1, NodeId node2) const {
+  if (blocks[node1] != blocks[node2] ||
+      signature_size_[node1] != signature_size_[node2]) {
+    return false;
+  }
+  return std::equal(signatures_.begin() + neighbor_offsets_[node1],
+                    signatures_.begin() + neighbor_offsets_[node1] +
+                        signature_size_[node1],
+                    signatures_.begin() + neighbor_offsets_[node2]);
+}
+
+// Groups with the same hash are chained through 'next_group' and represented
+// by their smallest node.
+int ParallelRefinement::GroupShard(const std::vector<int>& blocks, int shard) {
+  std::unordered_map<size_t, int> first_group;
+  std::vector<NodeId> representatives;
+  std::vector<int> next_group;
+  for (size_t pos = shard_offsets_[shard]; pos < shard_offsets_[shard + 1];
+       ++pos) {
+    NodeId node = shard_nodes_[pos];
+    auto insert_result = first_group.insert(
+        {signature_hash_[node], static_cast<int>(representatives.size())});
+    int group = insert_result.first->second;
+    if (!insert_result.second) {
+      while (!SameSignature(blocks, representatives[group], node) &&
+             next_group[group] != kNone) {
+        group = next_group[group];
+      }
+      if (!SameSignature(blocks, representatives[group], node)) {
+        next_group[group] = static_cast<int>(representatives.size());
+        group = next_group[group];
+      } else {
+        group_[node] = group;
+        continue;
+      }
+    }
+    representatives.push_back(node);
+    next_group.push_back(kNone);
+    group_[node] = group;
+  }
+  return static_cast<int>(representatives.size());
+}
+
+// The nodes are distributed to shards by a counting sort on the hash of their
+// signature, which keeps the nodes of a shard in increasing order. Shards are
+// grouped in parallel, and the groups are finally numbered in the order of
+// their smallest node.
+int ParallelRefinement::RefineBySignature(std::vector<int>* blocks) {
+  util::ParallelFor(num_nodes_, &pool_,
+                    [this, blocks](size_t begin, size_t end) {
+                      ComputeSignatures(*blocks, begin, end);
+                    });
+  shard_offsets_.assign(num_threads_ + 1, 0);
+  for (NodeId node = 0; node < num_nodes_; ++node) {
+    ++shard_offsets_[signature_hash_[node] % num_threads_ + 1];
+  }
+  for (int shard = 0; shard < num_threads_; ++shard) {
+    shard_offsets_[shard + 1] += shard_offsets_[shard];
+  }
+  std::vector<size_t> next_pos(shard_offsets_.begin(),
+                               shard_offsets_.end() - 1);
+  for (NodeId node = 0; node < num_nodes_; ++node) {
+    shard_nodes_[next_pos[signature_hash_[node] % num_threads_]++] = node;
+  }
+  std::vector<int> num_groups(num_threads_ + 1, 0);
+  util::ParallelFor(num_threads_, &pool_,
+                    [this, blocks, &num_groups](size_t begin, size_t end) {
+                      for (size_t shard = begin; shard < end; ++shard) {
+                        num_groups[shard + 1] = GroupShard(*blocks, shard);
+                      }
+                    });
+  for (int shard = 0; shard < num_threads_; ++shard) {
+    num_groups[shard + 1] += num_groups[shard];
+  }
+  std::vector<int> block_ids(num_groups[num_threads_], kNone);
+  int num_blocks = 0;
+  for (NodeId node = 0; node < num_nodes_; ++node) {
+    int group =
+        num_groups[signature_hash_[node] % num_threads_] + group_[node];
+    if (block_ids[group] == kNone) {
+      block_ids[group] = num_blocks++;
     }
-    // If the old block is now empty, remove it.
-    auto parent = D->parent.lock();
-    if (D->elements.empty()) {
-      data->list_partition.erase(D->partitn_loc);
-      parent->children.erase(D->parent_loc);
-      --num_new_blocks;
+    (*blocks)[node] = block_ids[group];
+  }
+  return num_blocks;
+}
+
+// Signature rounds are repeated until the partition is stable, which is the
+// case when a round creates no new block.
+template <typename GraphT>
+std::vector<int> RefineVectorPartitionInParallel(
+    const GraphT& graph, const std::vector<int>& partition, int num_threads) {
+  util::ScopedSpan span("RefinePartitionParallel");
+  CHECK(partition.size() == NodeIdBound(graph), kPartitionSizeErr);
+  CHECK(num_threads > 0, kThreadsErr);
+  int num_blocks;
+  std::vector<int> blocks = NormalizeBlocks(partition, &num_blocks);
+  ParallelRefinement refinement(graph, RefinementDirection::kForward,
+                                num_threads);
+  while (true) {
+    int num_new_blocks = refinement.RefineBySignature(&blocks) - num_blocks;
+    if (num_new_blocks == 0) {
+      return blocks;
     }
-    if (num_new_blocks > 0 && parent->children.size() - num_new_blocks == 1) {
-      data->compound_blocks.push_back(parent);
+    num_blocks += num_new_blocks;
+    if (num_new_blocks * kNodesPerNewBlock < partition.size()) {
+      return RefineVectorPartition(graph, blocks);
     }
   }
 }
 
-// Splits the blocks in 'refinement_data' into at most three parts.
-void ThreeWaySplit(RefinementData* data,
-                   Splitter* split) {
-  // Go through the preimage and split the blocks. Keep track of which blocks
-  // are split in 'split_blocks'.
-  const auto& block_splitter_count = split->block_splitter_parent->count;
-  const auto& compound_splitter_count = split->compound_splitter->count;
-  SplitBlockMap split_blocks;
-  for (NodeId node : split->block_splitter_preimage) {
-    shared_ptr<Block> D = data->block_map.at(node);
-    auto split_it = split_blocks.find(D);
-    if (split_it == split_blocks.end()) {
-      auto temp = split_blocks.emplace(
-          std::make_pair(D, std::make_pair(nullptr, nullptr)));
-      split_it = temp.first;
+// Each round splits the blocks by signature, so after k rounds two nodes are in
+// the same block exactly if they are k-step bisimilar. A round that creates no
+// new block leaves the partition stable, so the remaining rounds are skipped.
+template <typename GraphT>
+std::vector<int> RefineVectorPartitionBounded(const GraphT& graph,
+                                              const std::vector<int>& partition,
+                                              int max_rounds,
+                                              RefinementDirection direction,
+                                              int num_threads) {
+  util::ScopedSpan span("RefinePartitionBounded");
+  CHECK(partition.size() == NodeIdBound(graph), kPartitionSizeErr);
+  CHECK(max_rounds >= 0, kRoundsErr);
+  CHECK(num_threads > 0, kThreadsErr);
+  int num_blocks;
+  std::vector<int> blocks = NormalizeBlocks(partition, &num_blocks);
+  if (max_rounds == 0) {
+    return blocks;
+  }
+  ParallelRefinement refinement(graph, direction, num_threads);
+  for (int round = 0; round < max_rounds; ++round) {
+    const int num_new_blocks = refinement.RefineBySignature(&blocks);
+    if (num_new_blocks == num_blocks) {
+      break;
     }
-    shared_ptr<Block>* associated_block;
-    if (block_splitter_count.at(node) != compound_splitter_count.at(node)) {
-      associated_block = &(split_it->second.first);
-    } else {
-      associated_block = &(split_it->second.second);
+    num_blocks = num_new_blocks;
+  }
+  return blocks;
+}
+
+// A node that is not in a view has no edges in the view, so it does not affect
+// the refinement of the other nodes, whichever block it is in. Such nodes are
+// refined with the others and then dropped from the refinement, whose blocks
+// are renumbered.
+std::vector<int> DropNodesNotInView(const LabeledGraphView& view,
+                                    std::vector<int> refinement) {
+  std::vector<int> block_ids(refinement.size(), kNone);
+  int num_blocks = 0;
+  for (NodeId node = 0; node < refinement.size(); ++node) {
+    if (!view.HasNode(node)) {
+      refinement[node] = kNone;
+      continue;
     }
-    if (!(*associated_block)) {
-      auto parent = D->parent.lock();
-      parent->children.emplace_back(std::make_shared<Block>(node));
-      *associated_block = parent->children.back();
-      (*associated_block)->parent = D->parent;
-      (*associated_block)->parent_loc =
-          std::prev(parent->children.end());
-    } else {
-      (*associated_block)->elements.insert(node);
+    int& block_id = block_ids[refinement[node]];
+    if (block_id == kNone) {
+      block_id = num_blocks++;
     }
-    D->elements.erase(node);
-    data->block_map.at(node) = (*associated_block);
+    refinement[node] = block_id;
   }
-  CleanupSplit(split_blocks, data);
+  return refinement;
 }
 
-void SplitBlocks(RefinementData* data,
-                 Splitter* split) {
-  ThreeWaySplit(data, split);
-  UpdateCounts(split);
+// A graph given by a list of edges between nodes 0 to 'num_nodes' - 1, stored
+// as predecessor lists so that a Refinement can be set up on it.
+class PredecessorLists {
+ public:
+  PredecessorLists(size_t num_nodes,
+                   const std::vector<std::pair<NodeId, NodeId>>& edges);
+
+  util::Span<NodeId> GetPredecessorRange(NodeId node) const {
+    return util::Span<NodeId>(sources_.data() + offsets_[node],
+                              offsets_[node + 1] - offsets_[node]);
+  }
+
+ private:
+  std::vector<size_t> offsets_;
+  std::vector<NodeId> sources_;
+};
+
+// The edges are sorted by target with a counting sort.
+PredecessorLists::PredecessorLists(
+    size_t num_nodes, const std::vector<std::pair<NodeId, NodeId>>& edges)
+    : offsets_(num_nodes + 1, 0), sources_(edges.size()) {
+  for (const auto& edge : edges) {
+    ++offsets_[edge.second + 1];
+  }
+  for (size_t node = 0; node < num_nodes; ++node) {
+    offsets_[node + 1] += offsets_[node];
+  }
+  std::vector<size_t> next_pos(offsets_.begin(), offsets_.end() - 1);
+  for (const auto& edge : edges) {
+    sources_[next_pos[edge.second]++] = edge.first;
+  }
+}
+
+// Tarjan's algorithm assigns every node a discovery index and the smallest
+// index reachable through the search tree and one further edge, which is its
+// 'low' index. A node whose low index is its own index is the root of a
+// component, which consists of the nodes above it on the node stack. A node
+// is on the node stack exactly if it has been discovered and not yet assigned
+// a component, so no separate flag is kept. The search stack holds each node
+// that is being explored and the position of the next successor to visit.
+template <typename GraphT>
+std::vector<int> FindComponents(const GraphT& graph) {
+  using SuccessorIt = decltype(graph.GetSuccessorRange(0).begin());
+  struct Frame {
+    NodeId node;
+    SuccessorIt next;
+    SuccessorIt end;
+  };
+  const NodeId num_nodes = static_cast<NodeId>(NodeIdBound(graph));
+  std::vector<int> component(num_nodes, kNone);
+  std::vector<int> index(num_nodes, kNone);
+  std::vector<int> low(num_nodes, kNone);
+  std::vector<NodeId> node_stack;
+  std::vector<Frame> search_stack;
+  int num_discovered = 0;
+  int num_components = 0;
+  auto discover = [&](NodeId node) {
+    index[node] = num_discovered;
+    low[node] = num_discovered;
+    ++num_discovered;
+    node_stack.push_back(node);
+    auto successors = graph.GetSuccessorRange(node);
+    search_stack.push_back({node, successors.begin(), successors.end()});
+  };
+  for (NodeId root = 0; root < num_nodes; ++root) {
+    if (index[root] != kNone) {
+      continue;
+    }
+    discover(root);
+    while (!search_stack.empty()) {
+      Frame& frame = search_stack.back();
+      NodeId node = frame.node;
+      if (frame.next != frame.end) {
+        NodeId successor = *frame.next;
+        ++frame.next;
+        if (index[successor] == kNone) {
+          discover(successor);
+        } else if (component[successor] == kNone) {
+          low[node] = std::min(low[node], index[successor]);
+        }
+        continue;
+      }
+      search_stack.pop_back();
+      if (!search_stack.empty()) {
+        NodeId parent = search_stack.back().node;
+        low[parent] = std::min(low[parent], low[node]);
+      }
+      if (low[node] != index[node]) {
+        continue;
+      }
+      NodeId member;
+      do {
+        member = node_stack.back();
+        node_stack.pop_back();
+        component[member] = num_components;
+      } while (member != node);
+      ++num_components;
+    }
+  }
+  return component;
 }
 
 }  // namespace
 
-// Algorithm overiew:
-// Data structures:
-//  The algorithm maintains four data structures: 'list_partition',
-//  'super_blocks', 'compound_blocks', and 'block_map'.
-//
-//  'list_partition' maintains a list of all of the blocks currently in our
-//  refinement and can be logically though of as the 'current' refinement.
-//
-//  'super_blocks' maintains a list of groups of blocks.
-//
-//  'compound_blocks' is a subset of 'super_blocks'. A 'compound' block is a
-//  SuperBlock that contains at least 2 Blocks. These blocks will be used to
-//  refine the partition.
-//
-//  'block_map' keeps  track of which 'Block' each node belongs to at all times.
-//
-// The Paige-Tarjan algorithm for partition refinement initializes the data
-// structures of the algorithm and then proceeds as follows:
-// While compound_blocks is not empty:
-//    Pick a Splitter from compound blocks
-//    Do some pre-computation to speed up splitting
-//    Split the blocks with the Splitter
-//
-// Once this is done, blocks will have the desired partition. We then convert
-// this partition into a map<NodeId, int> and return it.
-map<NodeId, int> RefinePartition(const LabeledGraph& graph,
-                                 const map<NodeId, int>& partition) {
-  RefinementData data;
-  InitializeDataStructures(graph, partition, &data);
-  while (!data.compound_blocks.empty()) {
-    Splitter split;
-    PickSplitter(&data, &split);
-    InitializeSplitter(graph, &data, &split);
-    SplitBlocks(&data, &split);
-  }
-  return ConvertListToMapPartition(data.list_partition);
+std::map<NodeId, int> RefinePartition(const LabeledGraph& graph,
+                                      const std::map<NodeId, int>& partition) {
+  return RefineMapPartition(graph, partition);
+}
+
+std::map<NodeId, int> RefinePartition(const FrozenLabeledGraph& graph,
+                                      const std::map<NodeId, int>& partition) {
+  return RefineMapPartition(graph, partition);
+}
+
+std::vector<int> RefinePartition(const LabeledGraph& graph,
+                                 const std::vector<int>& partition) {
+  return RefineVectorPartition(graph, partition);
+}
+
+std::vector<int> RefinePartition(const FrozenLabeledGraph& graph,
+                                 const std::vector<int>& partition) {
+  return RefineVectorPartition(graph, partition);
+}
+
+std::vector<int> RefinePartitionParallel(const LabeledGraph& graph,
+                                         const std::vector<int>& partition,
+                                         int num_threads) {
+  return RefineVectorPartitionInParallel(graph, partition, num_threads);
+}
+
+std::vector<int> RefinePartitionParallel(const FrozenLabeledGraph& graph,
+                                         const std::vector<int>& partition,
+                                         int num_threads) {
+  return RefineVectorPartitionInParallel(graph, partition, num_threads);
+}
+
+std::map<NodeId, int> RefinePartition(const LabeledGraphView& view,
+                                      const std::map<NodeId, int>& partition) {
+  return RefineMapPartition(view, partition);
+}
+
+std::vector<int> RefinePartition(const LabeledGraphView& view,
+                                 const std::vector<int>& partition) {
+  return DropNodesNotInView(view, RefineVectorPartition(view, partition));
+}
+
+std::vector<int> RefinePartitionParallel(const LabeledGraphView& view,
+                                         const std::vector<int>& partition,
+                                         int num_threads) {
+  return DropNodesNotInView(
+      view, RefineVectorPartitionInParallel(view, partition, num_threads));
+}
+
+std::vector<int> RefinePartitionBounded(const LabeledGraph& graph,
+                                        const std::vector<int>& partition,
+                                        int max_rounds,
+                                        RefinementDirection direction,
+                                        int num_threads) {
+  return RefineVectorPartitionBounded(graph, partition, max_rounds, direction,
+                                      num_threads);
+}
+
+std::vector<int> RefinePartitionBounded(const FrozenLabeledGraph& graph,
+                                        const std::vector<int>& partition,
+                                        int max_rounds,
+                                        RefinementDirection direction,
+                                        int num_threads) {
+  return RefineVectorPartitionBounded(graph, partition, max_rounds, direction,
+                                      num_threads);
+}
+
+std::vector<int> RefinePartitionBounded(const LabeledGraphView& view,
+                                        const std::vector<int>& partition,
+                                        int max_rounds,
+                                        RefinementDirection direction,
+                                        int num_threads) {
+  return DropNodesNotInView(
+      view, RefineVectorPartitionBounded(view, partition, max_rounds,
+                                         direction, num_threads));
+}
+
+std::vector<int> StronglyConnectedComponents(const LabeledGraph& graph) {
+  return FindComponents(graph);
+}
+
+std::vector<int> StronglyConnectedComponents(const FrozenLabeledGraph& graph) {
+  return FindComponents(graph);
+}
+
+// The blocks of the initial refinement are numbered in the order of their
+// smallest node, which is the node that sets their successors.
+IncrementalRefinement::IncrementalRefinement(const LabeledGraph& graph,
+                                             const std::vector<int>& partition)
+    : graph_(graph),
+      initial_blocks_(partition),
+      block_of_(RefineVectorPartition(graph, partition)),
+      num_affected_nodes_(graph.NumNodes()) {
+  for (NodeId node = 0; node < block_of_.size(); ++node) {
+    int block = block_of_[node];
+    if (block == static_cast<int>(block_size_.size())) {
+      block_initial_.push_back(partition[node]);
+      block_size_.push_back(0);
+      block_successors_.emplace_back();
+      SetSuccessorBlocks(block, node);
+    }
+    ++block_size_[block];
+  }
+  partition_ = block_of_;
+}
+
+// The affected nodes are removed from their blocks, and the graph to refine
+// has the affected nodes as nodes 0 to k - 1, followed by one node for each
+// remaining block. A block of the remaining nodes is stable, so no two of
+// them are merged by the refinement, and the affected nodes that end up with
+// one of them join it. The other affected nodes form new blocks.
+void IncrementalRefinement::Update(const std::vector<int>& new_node_blocks,
+                                   const std::vector<EdgeId>& new_edges) {
+  const size_t num_old_nodes = initial_blocks_.size();
+  const size_t num_nodes = num_old_nodes + new_node_blocks.size();
+  CHECK(num_nodes == static_cast<size_t>(graph_.NumNodes()), kNewNodesErr);
+  initial_blocks_.insert(initial_blocks_.end(), new_node_blocks.begin(),
+                         new_node_blocks.end());
+  block_of_.resize(num_nodes, kNone);
+  partition_.resize(num_nodes, kNone);
+  // The affected nodes are the new nodes, the sources of new edges and their
+  // ancestors, found by a backward search.
+  std::vector<int> affected_index(num_nodes, kNone);
+  std::vector<NodeId> affected;
+  auto add_affected = [&affected_index, &affected](NodeId node) {
+    if (affected_index[node] == kNone) {
+      affected_index[node] = static_cast<int>(affected.size());
+      affected.push_back(node);
+    }
+  };
+  for (NodeId node = num_old_nodes; node < num_nodes; ++node) {
+    add_affected(node);
+  }
+  for (const EdgeId& edge : new_edges) {
+    add_affected(graph_.Source(edge));
+  }
+  for (size_t i = 0; i < affected.size(); ++i) {
+    for (NodeId predecessor : graph_.GetPredecessorRange(affected[i])) {
+      add_affected(predecessor);
+    }
+  }
+  num_affected_nodes_ = static_cast<int>(affected.size());
+  if (affected.empty()) {
+    return;
+  }
+  for (NodeId node : affected) {
+    int block = block_of_[node];
+    if (block != kNone && --block_size_[block] == 0) {
+      block_successors_[block].clear();
+      free_blocks_.push_back(block);
+    }
+  }
+  // Set up the graph to refine. The successors of a remaining node remain, so
+  // the successors of a remaining block are remaining blocks.
+  const NodeId num_affected = affected.size();
+  std::vector<int> reduced_id(block_size_.size(), kNone);
+  std::vector<int> remaining_blocks;
+  for (size_t block = 0; block < block_size_.size(); ++block) {
+    if (block_size_[block] > 0) {
+      reduced_id[block] = num_affected + remaining_blocks.size();
+      remaining_blocks.push_back(block);
+    }
+  }
+  std::vector<int> reduced_partition;
+  std::vector<std::pair<NodeId, NodeId>> edges;
+  for (NodeId i = 0; i < num_affected; ++i) {
+    reduced_partition.push_back(initial_blocks_[affected[i]]);
+    for (NodeId successor : graph_.GetSuccessorRange(affected[i])) {
+      int target = affected_index[successor];
+      if (target == kNone) {
+        target = reduced_id[block_of_[successor]];
+      }
+      edges.emplace_back(i, target);
+    }
+  }
+  for (size_t i = 0; i < remaining_blocks.size(); ++i) {
+    int block = remaining_blocks[i];
+    reduced_partition.push_back(block_initial_[block]);
+    for (int successor : block_successors_[block]) {
+      edges.emplace_back(num_affected + i, reduced_id[successor]);
+    }
+  }
+  PredecessorLists reduced_graph(reduced_partition.size(), edges);
+  int num_blocks;
+  std::vector<int> blocks = NormalizeBlocks(reduced_partition, &num_blocks);
+  Refinement refinement(reduced_graph, blocks, num_blocks);
+  refinement.Run();
+  reduced_partition = refinement.GetPartition();
+  // Assign the affected nodes to blocks. The successors of a new block are set
+  // once all affected nodes have a block.
+  std::vector<int> block_ids(reduced_partition.size(), kNone);
+  for (size_t i = 0; i < remaining_blocks.size(); ++i) {
+    block_ids[reduced_partition[num_affected + i]] = remaining_blocks[i];
+  }
+  std::vector<std::pair<int, NodeId>> new_blocks;
+  for (NodeId i = 0; i < num_affected; ++i) {
+    NodeId node = affected[i];
+    int& block = block_ids[reduced_partition[i]];
+    if (block == kNone) {
+      if (free_blocks_.empty()) {
+        block = static_cast<int>(block_size_.size());
+        block_initial_.push_back(0);
+        block_size_.push_back(0);
+        block_successors_.emplace_back();
+      } else {
+        block = free_blocks_.back();
+        free_blocks_.pop_back();
+      }
+      block_initial_[block] = initial_blocks_[node];
+      new_blocks.emplace_back(block, node);
+    }
+    block_of_[node] = block;
+    ++block_size_[block];
+  }
+  for (const auto& block_node : new_blocks) {
+    SetSuccessorBlocks(block_node.first, block_node.second);
+  }
+  UpdatePartition();
+}
+
+void IncrementalRefinement::SetSuccessorBlocks(int block, NodeId node) {
+  std::vector<int>& successors = block_successors_[block];
+  successors.clear();
+  for (NodeId successor : graph_.GetSuccessorRange(node)) {
+    successors.push_back(block_of_[successor]);
+  }
+  std::sort(successors.begin(), successors.end());
+  successors.erase(std::unique(successors.begin(), successors.end()),
+                   successors.end());
+}
+
+void IncrementalRefinement::UpdatePartition() {
+  std::vector<int> block_ids(block_size_.size(), kNone);
+  int num_blocks = 0;
+  for (NodeId node = 0; node < block_of_.size(); ++node) {
+    int& block_id = block_ids[block_of_[node]];
+    if (block_id == kNone) {
+      block_id = num_blocks++;
+    }
+    partition_[node] = block_id;
+  }
 }
 
 }  // namespace graph_analyzer
@@ -17,7 +17,11 @@
 #define LOGLE_GRAPH_ANALYZER_H_
 
 #include <map>
+#include <vector>
+
+#include "frozen_labeled_graph.h"
 #include "labeled_graph.h"
+#include "labeled_graph_view.h"
 
 namespace morphie {
 
@@ -41,8 +45,175 @@ namespace graph_analyzer {
 // from E^-1(B_2) (where E^-1(B_2) is the preimage of B_2).
 // Paige, Robert; Tarjan, Robert E. (1987), "Three partition refinement
 // algorithms", SIAM Journal on Computing 16 (6): 973–989
+//
+// The refinement takes O(m log n) time and O(n + m) space for a graph with n
+// nodes and m edges. The partition maps a node to the identifier of its block.
+// Nodes of the graph that are not in 'partition' are placed in one additional
+// block and do not occur in the result. Blocks of the result are numbered from
+// 0 in the order of the smallest node they contain.
+// - Crashes if 'partition' contains a node that is not in the graph.
 std::map<NodeId, int> RefinePartition(const LabeledGraph& graph,
                                       const std::map<NodeId, int>& partition);
+// Computes the same refinement as above on a frozen snapshot of a graph.
+std::map<NodeId, int> RefinePartition(const FrozenLabeledGraph& graph,
+                                      const std::map<NodeId, int>& partition);
+// Computes the same refinements for a partition given as a vector whose i-th
+// entry is the block of node i, and returns the refinement in the same form.
+// These functions avoid building maps, which dominates the running time on
+// large graphs.
+// - Crashes unless 'partition' has one entry for each node of the graph.
+std::vector<int> RefinePartition(const LabeledGraph& graph,
+                                 const std::vector<int>& partition);
+std::vector<int> RefinePartition(const FrozenLabeledGraph& graph,
+                                 const std::vector<int>& partition);
+
+// Computes the same refinement as the vector version of RefinePartition using
+// 'num_threads' threads, and returns an identical vector. The partition is
+// refined in rounds. In each round, every node computes a signature consisting
+// of its block and the set of blocks of its successors, in parallel, and the
+// nodes are regrouped by signature. Two nodes with different signatures are in
+// different blocks of every stable refinement, so a round never splits a block
+// that the serial algorithm keeps. When a round creates few new blocks, the
+// remaining rounds would do little work per pass over the graph, so the
+// refinement is completed by the serial algorithm.
+// - Crashes unless 'partition' has one entry for each node of the graph and
+//   'num_threads' is positive.
+std::vector<int> RefinePartitionParallel(const LabeledGraph& graph,
+                                         const std::vector<int>& partition,
+                                         int num_threads);
+std::vector<int> RefinePartitionParallel(const FrozenLabeledGraph& graph,
+                                         const std::vector<int>& partition,
+                                         int num_threads);
+
+// Compute the same refinements as above on the nodes and edges of a view. The
+// map versions crash if 'partition' contains a node that is not in the view.
+// The vector versions take a partition with one entry for each node identifier
+// below view.NumNodeIds(), ignore the entries of nodes that are not in the
+// view, and return a vector in which those entries are -1. The blocks of the
+// nodes of the view are numbered from 0 in the order of their smallest node.
+// - The vector versions crash unless 'partition' has view.NumNodeIds()
+//   entries.
+std::map<NodeId, int> RefinePartition(const LabeledGraphView& view,
+                                      const std::map<NodeId, int>& partition);
+std::vector<int> RefinePartition(const LabeledGraphView& view,
+                                 const std::vector<int>& partition);
+std::vector<int> RefinePartitionParallel(const LabeledGraphView& view,
+                                         const std::vector<int>& partition,
+                                         int num_threads);
+
+// The edges by which a bounded refinement distinguishes nodes: the blocks of
+// their successors, as in RefinePartition, of their predecessors, or both.
+enum class RefinementDirection { kForward, kBackward, kBoth };
+
+// Refines a partition for at most 'max_rounds' rounds, which is cheaper and
+// coarser than the full refinement when that splits nearly every node into a
+// block of its own. In each round, every node computes a signature consisting
+// of its block and the set of blocks of its neighbors in 'direction', in
+// parallel on 'num_threads' threads, and the nodes are regrouped by signature.
+// After k rounds, two nodes are in the same block exactly if they are k-step
+// bisimilar: their initial blocks are equal and, for k > 0, every neighbor of
+// one is (k-1)-step bisimilar to a neighbor of the other. The refinement stops
+// early once a round splits no block. Each round takes O(m log d) time for a
+// graph with m edges and largest degree d, plus O(n) for numbering the n
+// nodes. A forward refinement with enough rounds returns the same vector as
+// RefinePartition, and the blocks are numbered from 0 in the order of their
+// smallest node. The view version takes and returns partitions in the form of
+// the vector versions of RefinePartition for views.
+// - Crashes unless 'partition' has one entry for each node identifier,
+//   'max_rounds' is not negative and 'num_threads' is positive.
+std::vector<int> RefinePartitionBounded(const LabeledGraph& graph,
+                                        const std::vector<int>& partition,
+                                        int max_rounds,
+                                        RefinementDirection direction,
+                                        int num_threads);
+std::vector<int> RefinePartitionBounded(const FrozenLabeledGraph& graph,
+                                        const std::vector<int>& partition,
+                                        int max_rounds,
+                                        RefinementDirection direction,
+                                        int num_threads);
+std::vector<int> RefinePartitionBounded(const LabeledGraphView& view,
+                                        const std::vector<int>& partition,
+                                        int max_rounds,
+                                        RefinementDirection direction,
+                                        int num_threads);
+
+// Returns the strongly connected components of a graph. Two nodes are in the
+// same component if each is reachable from the other. The i-th entry of the
+// result is the component of node i. Components are numbered from 0 in reverse
+// topological order, so that if an edge leads from a node in component c to a
+// node in a different component d, then d is less than c. The components are
+// computed with Tarjan's algorithm in O(n + m) time for a graph with n nodes
+// and m edges. The depth-first search keeps an explicit stack rather than
+// recursing, so long chains of dependencies do not overflow the call stack.
+std::vector<int> StronglyConnectedComponents(const LabeledGraph& graph);
+std::vector<int> StronglyConnectedComponents(const FrozenLabeledGraph& graph);
+
+// Maintains the refinement computed by the vector version of RefinePartition
+// while nodes and edges are added to a graph, without refining the whole graph
+// again after each addition.
+//
+// The block of a node in the coarsest stable refinement only depends on the
+// nodes and edges reachable from it. Adding nodes and edges therefore only
+// affects the new nodes and the nodes that reach the source of a new edge.
+// The other nodes keep their blocks, and the current refinement is stored as a
+// quotient graph with one node per block and one edge per pair of blocks
+// connected by an edge. An update refines a graph that consists of the
+// affected nodes and the blocks of the quotient, which are merged with the
+// affected nodes that are equivalent to them. An update takes time that is
+// linear in the number of nodes of the graph, for numbering the blocks, plus
+// O(k log k) where k is the number of affected nodes and their edges plus the
+// size of the quotient.
+//
+// Example.
+//   IncrementalRefinement refinement(graph, partition);
+//   // Add two nodes and some edges to 'graph'.
+//   refinement.Update({block1, block2}, new_edges);
+//   const std::vector<int>& blocks = refinement.Partition();
+//
+// The graph must outlive the refinement, and nodes and edges must not be
+// removed from it.
+class IncrementalRefinement {
+ public:
+  // Computes the refinement of 'partition', which has one entry for each node
+  // of 'graph'.
+  // - Crashes unless 'partition' has one entry for each node of the graph.
+  IncrementalRefinement(const LabeledGraph& graph,
+                        const std::vector<int>& partition);
+
+  // Updates the refinement after nodes and edges were added to the graph. The
+  // i-th entry of 'new_node_blocks' is the initial block of the i-th node added
+  // since the last update. The edges added since the last update, which may
+  // start at any node, must be in 'new_edges'.
+  // - Crashes unless 'new_node_blocks' has one entry for each new node.
+  void Update(const std::vector<int>& new_node_blocks,
+              const std::vector<EdgeId>& new_edges);
+
+  // Returns the refinement in the form returned by RefinePartition.
+  const std::vector<int>& Partition() const { return partition_; }
+  // Returns the number of nodes whose block was recomputed by the last update.
+  int NumAffectedNodes() const { return num_affected_nodes_; }
+
+ private:
+  // Sets the successors of 'block' to the blocks of the successors of 'node'.
+  void SetSuccessorBlocks(int block, NodeId node);
+  // Numbers the blocks in the order of their smallest node.
+  void UpdatePartition();
+
+  const LabeledGraph& graph_;
+  // The initial block of each node.
+  std::vector<int> initial_blocks_;
+  // The internal block of each node, and for each block, its initial block,
+  // number of nodes and sorted successor blocks. Blocks without nodes are
+  // reused.
+  std::vector<int> block_of_;
+  std::vector<int> block_initial_;
+  std::vector<int> block_size_;
+  std::vector<std::vector<int>> block_successors_;
+  std::vector<int> free_blocks_;
+  std::vector<int> partition_;
+  int num_affected_nodes_;
+};  // class IncrementalRefinement
+
 }  // namespace graph_analyzer
 
 }  // namespace morphie
@@ -13,6 +13,12 @@
 // the License.
 #include "graph_analyzer.h"
 
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
 #include "gtest.h"
 #include "test_graphs.h"
 
@@ -148,5 +154,381 @@ TEST(GraphAnalyzerTest, CycleRefinement) {
   }
 }
 
+// Returns the coarsest stable refinement of 'blocks' computed by repeatedly
+// splitting blocks by the set of blocks of the successors of their nodes.
+std::vector<int> NaiveRefinement(const LabeledGraph& graph,
+                                 std::vector<int> blocks) {
+  size_t num_blocks = std::set<int>(blocks.begin(), blocks.end()).size();
+  while (true) {
+    std::map<std::pair<int, std::set<int>>, int> signatures;
+    std::vector<int> next_blocks;
+    for (NodeId node = 0; node < blocks.size(); ++node) {
+      std::set<int> successor_blocks;
+      for (NodeId successor : graph.GetSuccessors(node)) {
+        successor_blocks.insert(blocks[successor]);
+      }
+      auto signature = std::make_pair(blocks[node], successor_blocks);
+      next_blocks.push_back(
+          signatures.emplace(signature, signatures.size()).first->second);
+    }
+    if (signatures.size() == num_blocks) {
+      return next_blocks;
+    }
+    num_blocks = signatures.size();
+    blocks = next_blocks;
+  }
+}
+
+// Returns true if two nodes are in the same block of 'partition1' exactly when
+// they are in the same block of 'partition2'.
+bool SamePartition(const std::vector<int>& partition1,
+                   const std::vector<int>& partition2) {
+  if (partition1.size() != partition2.size()) {
+    return false;
+  }
+  std::map<int, int> forward;
+  std::map<int, int> backward;
+  for (size_t i = 0; i < partition1.size(); ++i) {
+    if (forward.emplace(partition1[i], partition2[i]).first->second !=
+            partition2[i] ||
+        backward.emplace(partition2[i], partition1[i]).first->second !=
+            partition1[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// On random graphs with multi-edges and self-loops, the refinement agrees with
+// the naive computation, and the map and vector interfaces agree.
+TEST(GraphAnalyzerTest, MatchesNaiveRefinement) {
+  std::mt19937 generator(7);
+  for (int trial = 0; trial < 50; ++trial) {
+    int num_nodes = 1 + trial % 40;
+    int num_initial_blocks = 1 + trial % 3;
+    test::WeightedGraph weighted_graph;
+    ASSERT_TRUE(weighted_graph.Initialize().ok());
+    for (int i = 0; i < num_nodes; ++i) {
+      weighted_graph.AddNode(i);
+    }
+    std::uniform_int_distribution<int> node_dist(0, num_nodes - 1);
+    int num_edges = num_nodes * (1 + trial % 2);
+    for (int i = 0; i < num_edges; ++i) {
+      weighted_graph.AddEdge(node_dist(generator), node_dist(generator), i);
+    }
+    const LabeledGraph& graph = *weighted_graph.GetGraph();
+    std::vector<int> partition;
+    std::map<NodeId, int> map_partition;
+    for (int i = 0; i < num_nodes; ++i) {
+      partition.push_back(10 * (node_dist(generator) % num_initial_blocks));
+      map_partition.insert({static_cast<NodeId>(i), partition.back()});
+    }
+    std::vector<int> refinement =
+        graph_analyzer::RefinePartition(graph, partition);
+    EXPECT_TRUE(SamePartition(NaiveRefinement(graph, partition), refinement))
+        << "trial " << trial;
+    std::map<NodeId, int> map_refinement =
+        graph_analyzer::RefinePartition(graph, map_partition);
+    ASSERT_EQ(refinement.size(), map_refinement.size());
+    for (int i = 0; i < num_nodes; ++i) {
+      EXPECT_EQ(refinement[i], map_refinement[i]);
+    }
+  }
+}
+
+// Blocks are numbered in the order of their smallest node, and nodes missing
+// from a map partition form a block of their own.
+TEST(GraphAnalyzerTest, NumbersBlocksAndHandlesMissingNodes) {
+  test::WeightedGraph path;
+  test::GetPathGraph(3, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  EXPECT_EQ(std::vector<int>({0, 1, 2}),
+            graph_analyzer::RefinePartition(graph, std::vector<int>(3, 5)));
+  test::WeightedGraph empty;
+  ASSERT_TRUE(empty.Initialize().ok());
+  EXPECT_TRUE(graph_analyzer::RefinePartition(*empty.GetGraph(),
+                                              std::vector<int>())
+                  .empty());
+  // Node 1 is not in the partition but is still a successor of node 0, which
+  // separates node 0 from node 2.
+  std::map<NodeId, int> partition = {{0, 0}, {2, 0}};
+  std::map<NodeId, int> refinement =
+      graph_analyzer::RefinePartition(graph, partition);
+  ASSERT_EQ(2, refinement.size());
+  EXPECT_NE(refinement[0], refinement[2]);
+}
+
+// Returns a graph with 'num_nodes' nodes and 'num_edges' random edges, which
+// may be multi-edges and self-loops.
+void GetRandomGraph(int num_nodes, int num_edges, std::mt19937* generator,
+                    test::WeightedGraph* graph) {
+  ASSERT_TRUE(graph->Initialize().ok());
+  for (int i = 0; i < num_nodes; ++i) {
+    graph->AddNode(i);
+  }
+  std::uniform_int_distribution<int> node_dist(0, num_nodes - 1);
+  for (int i = 0; i < num_edges; ++i) {
+    graph->AddEdge(node_dist(*generator), node_dist(*generator), i);
+  }
+}
+
+// The parallel refinement returns the same vector as the serial refinement,
+// for any number of threads and for both graph representations.
+TEST(GraphAnalyzerTest, ParallelMatchesSerialRefinement) {
+  std::vector<test::WeightedGraph> graphs(8);
+  test::GetPathGraph(300, &graphs[0]);
+  test::GetCycleGraph(300, &graphs[1]);
+  std::mt19937 generator(11);
+  GetRandomGraph(1, 0, &generator, &graphs[2]);
+  GetRandomGraph(50, 50, &generator, &graphs[3]);
+  GetRandomGraph(500, 400, &generator, &graphs[4]);
+  GetRandomGraph(500, 1000, &generator, &graphs[5]);
+  GetRandomGraph(5000, 5000, &generator, &graphs[6]);
+  ASSERT_TRUE(graphs[7].Initialize().ok());
+  for (size_t i = 0; i < graphs.size(); ++i) {
+    const LabeledGraph& graph = *graphs[i].GetGraph();
+    FrozenLabeledGraph frozen_graph(graph);
+    for (int num_initial_blocks : {1, 3}) {
+      std::vector<int> partition;
+      for (int node = 0; node < graph.NumNodes(); ++node) {
+        partition.push_back(node % num_initial_blocks);
+      }
+      std::vector<int> refinement =
+          graph_analyzer::RefinePartition(graph, partition);
+      for (int num_threads : {1, 4}) {
+        EXPECT_EQ(refinement, graph_analyzer::RefinePartitionParallel(
+                                  graph, partition, num_threads))
+            << "graph " << i << ", " << num_threads << " threads";
+        EXPECT_EQ(refinement, graph_analyzer::RefinePartitionParallel(
+                                  frozen_graph, partition, num_threads))
+            << "graph " << i << ", " << num_threads << " threads";
+      }
+    }
+  }
+}
+
+// A forward bounded refinement with as many rounds as nodes is the full
+// refinement.
+TEST(GraphAnalyzerTest, BoundedMatchesFullRefinement) {
+  std::vector<test::WeightedGraph> graphs(4);
+  test::GetCycleGraph(100, &graphs[0]);
+  std::mt19937 generator(13);
+  GetRandomGraph(50, 50, &generator, &graphs[1]);
+  GetRandomGraph(500, 1000, &generator, &graphs[2]);
+  GetRandomGraph(5000, 5000, &generator, &graphs[3]);
+  for (size_t i = 0; i < graphs.size(); ++i) {
+    const LabeledGraph& graph = *graphs[i].GetGraph();
+    FrozenLabeledGraph frozen_graph(graph);
+    std::vector<int> partition;
+    for (int node = 0; node < graph.NumNodes(); ++node) {
+      partition.push_back(node % 3);
+    }
+    std::vector<int> refinement =
+        graph_analyzer::RefinePartition(graph, partition);
+    for (int num_threads : {1, 4}) {
+      EXPECT_EQ(refinement,
+                graph_analyzer::RefinePartitionBounded(
+                    graph, partition, graph.NumNodes(),
+                    graph_analyzer::RefinementDirection::kForward,
+                    num_threads))
+          << "graph " << i << ", " << num_threads << " threads";
+      EXPECT_EQ(refinement,
+                graph_analyzer::RefinePartitionBounded(
+                    frozen_graph, partition, graph.NumNodes(),
+                    graph_analyzer::RefinementDirection::kForward,
+                    num_threads))
+          << "graph " << i << ", " << num_threads << " threads";
+    }
+  }
+}
+
+// On the path 0 -> 1 -> 2 -> 3 -> 4, each forward round separates the last
+// node that still has a successor in its block, and each backward round the
+// first node that still has a predecessor in its block.
+TEST(GraphAnalyzerTest, BoundedRefinementStopsAfterRounds) {
+  test::WeightedGraph path;
+  test::GetPathGraph(5, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  using graph_analyzer::RefinementDirection;
+  const std::vector<int> partition(5, 7);
+  EXPECT_EQ(std::vector<int>({0, 0, 0, 0, 0}),
+            graph_analyzer::RefinePartitionBounded(
+                graph, partition, 0, RefinementDirection::kBoth, 1));
+  EXPECT_EQ(std::vector<int>({0, 0, 0, 1, 2}),
+            graph_analyzer::RefinePartitionBounded(
+                graph, partition, 2, RefinementDirection::kForward, 2));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 2, 2}),
+            graph_analyzer::RefinePartitionBounded(
+                graph, partition, 2, RefinementDirection::kBackward, 2));
+  EXPECT_EQ(std::vector<int>({0, 1, 1, 1, 2}),
+            graph_analyzer::RefinePartitionBounded(
+                graph, partition, 1, RefinementDirection::kBoth, 1));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4}),
+            graph_analyzer::RefinePartitionBounded(
+                graph, partition, 10, RefinementDirection::kBoth, 1));
+}
+
+// Adding nodes and edges in rounds and updating the incremental refinement
+// gives the same vector as refining the grown graph from scratch.
+TEST(GraphAnalyzerTest, IncrementalMatchesRefinement) {
+  std::mt19937 generator(13);
+  for (int trial = 0; trial < 10; ++trial) {
+    int num_blocks = 1 + trial % 3;
+    test::WeightedGraph weighted_graph;
+    GetRandomGraph(50, 40 + 10 * trial, &generator, &weighted_graph);
+    const LabeledGraph& graph = *weighted_graph.GetGraph();
+    std::vector<int> partition;
+    for (int node = 0; node < graph.NumNodes(); ++node) {
+      partition.push_back(node % num_blocks);
+    }
+    graph_analyzer::IncrementalRefinement refinement(graph, partition);
+    EXPECT_EQ(graph_analyzer::RefinePartition(graph, partition),
+              refinement.Partition());
+    for (int round = 0; round < 5; ++round) {
+      int num_new_nodes = round % 3;
+      std::vector<int> new_node_blocks;
+      for (int i = 0; i < num_new_nodes; ++i) {
+        weighted_graph.AddNode(graph.NumNodes());
+        new_node_blocks.push_back(i % num_blocks);
+        partition.push_back(new_node_blocks.back());
+      }
+      std::uniform_int_distribution<int> node_dist(0, graph.NumNodes() - 1);
+      std::vector<EdgeId> new_edges;
+      for (int i = 0; i < 3; ++i) {
+        new_edges.push_back(weighted_graph.AddEdge(
+            node_dist(generator), node_dist(generator), 1000 + i));
+      }
+      refinement.Update(new_node_blocks, new_edges);
+      EXPECT_EQ(graph_analyzer::RefinePartition(graph, partition),
+                refinement.Partition())
+          << "trial " << trial << ", round " << round;
+    }
+  }
+}
+
+// An edge added to node 1 makes it equivalent to node 0 again, and only node 1
+// is refined.
+TEST(GraphAnalyzerTest, IncrementalMergesBlocks) {
+  test::WeightedGraph weighted_graph;
+  ASSERT_TRUE(weighted_graph.Initialize().ok());
+  for (int i = 0; i < 3; ++i) {
+    weighted_graph.AddNode(i);
+  }
+  weighted_graph.AddEdge(0, 2, 0);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+  graph_analyzer::IncrementalRefinement refinement(graph, {0, 0, 1});
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), refinement.Partition());
+  EdgeId edge = weighted_graph.AddEdge(1, 2, 1);
+  refinement.Update({}, {edge});
+  EXPECT_EQ(1, refinement.NumAffectedNodes());
+  EXPECT_EQ(std::vector<int>({0, 0, 1}), refinement.Partition());
+  refinement.Update({}, {});
+  EXPECT_EQ(0, refinement.NumAffectedNodes());
+  EXPECT_EQ(std::vector<int>({0, 0, 1}), refinement.Partition());
+}
+
+// Each node of a path is a component of its own, and the components are
+// numbered from the end of the path. A cycle is one component.
+TEST(GraphAnalyzerTest, ComponentsOfPathsAndCycles) {
+  test::WeightedGraph path;
+  test::GetPathGraph(5, &path);
+  EXPECT_EQ(std::vector<int>({4, 3, 2, 1, 0}),
+            graph_analyzer::StronglyConnectedComponents(*path.GetGraph()));
+  test::WeightedGraph cycle;
+  test::GetCycleGraph(8, &cycle);
+  EXPECT_EQ(std::vector<int>(8, 0),
+            graph_analyzer::StronglyConnectedComponents(*cycle.GetGraph()));
+  // The search does not recurse, so a long path does not exhaust the stack.
+  test::WeightedGraph long_path;
+  test::GetPathGraph(100000, &long_path);
+  std::vector<int> components =
+      graph_analyzer::StronglyConnectedComponents(*long_path.GetGraph());
+  EXPECT_EQ(99999, components.front());
+  EXPECT_EQ(0, components.back());
+}
+
+// Returns the nodes reachable from 'node' in 'graph', including 'node'.
+std::set<NodeId> ReachableNodes(const LabeledGraph& graph, NodeId node) {
+  std::set<NodeId> reachable = {node};
+  std::vector<NodeId> frontier = {node};
+  while (!frontier.empty()) {
+    NodeId next = frontier.back();
+    frontier.pop_back();
+    for (NodeId successor : graph.GetSuccessors(next)) {
+      if (reachable.insert(successor).second) {
+        frontier.push_back(successor);
+      }
+    }
+  }
+  return reachable;
+}
+
+// On random graphs with multi-edges and self-loops, two nodes are in the same
+// component exactly if they reach each other, edges between components lead to
+// smaller components, and the graph and its frozen snapshot agree.
+TEST(GraphAnalyzerTest, ComponentsMatchReachability) {
+  std::mt19937 generator(11);
+  for (int trial = 0; trial < 50; ++trial) {
+    int num_nodes = 1 + trial % 30;
+    test::WeightedGraph weighted_graph;
+    ASSERT_TRUE(weighted_graph.Initialize().ok());
+    for (int i = 0; i < num_nodes; ++i) {
+      weighted_graph.AddNode(i);
+    }
+    std::uniform_int_distribution<int> node_dist(0, num_nodes - 1);
+    int num_edges = num_nodes * (1 + trial % 2);
+    for (int i = 0; i < num_edges; ++i) {
+      weighted_graph.AddEdge(node_dist(generator), node_dist(generator), i);
+    }
+    const LabeledGraph& graph = *weighted_graph.GetGraph();
+    std::vector<int> components =
+        graph_analyzer::StronglyConnectedComponents(graph);
+    ASSERT_EQ(static_cast<size_t>(num_nodes), components.size());
+    std::vector<std::set<NodeId>> reachable;
+    for (NodeId node = 0; node < static_cast<NodeId>(num_nodes); ++node) {
+      reachable.push_back(ReachableNodes(graph, node));
+    }
+    for (NodeId node1 = 0; node1 < reachable.size(); ++node1) {
+      for (NodeId node2 = 0; node2 < reachable.size(); ++node2) {
+        bool mutual = reachable[node1].count(node2) > 0 &&
+                      reachable[node2].count(node1) > 0;
+        EXPECT_EQ(mutual, components[node1] == components[node2])
+            << "trial " << trial;
+      }
+      for (NodeId successor : graph.GetSuccessors(node1)) {
+        EXPECT_LE(components[successor], components[node1]);
+      }
+    }
+    FrozenLabeledGraph frozen_graph(graph);
+    EXPECT_EQ(components,
+              graph_analyzer::StronglyConnectedComponents(frozen_graph));
+  }
+}
+
+TEST(GraphAnalyzerDeathTest, RequiresValidPartition) {
+  test::WeightedGraph path;
+  test::GetPathGraph(3, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  EXPECT_DEATH({ graph_analyzer::RefinePartition(graph, std::vector<int>(2)); },
+               "The partition does not have one entry for each node.");
+  std::map<NodeId, int> partition = {{0, 0}, {7, 0}};
+  EXPECT_DEATH({ graph_analyzer::RefinePartition(graph, partition); },
+               "The partition contains an invalid node id.");
+  EXPECT_DEATH({
+    graph_analyzer::RefinePartitionParallel(graph, std::vector<int>(2), 2);
+  }, "The partition does not have one entry for each node.");
+  EXPECT_DEATH({
+    graph_analyzer::RefinePartitionParallel(graph, std::vector<int>(3), 0);
+  }, "The number of threads must be positive.");
+  EXPECT_DEATH({
+    graph_analyzer::RefinePartitionBounded(
+        graph, std::vector<int>(3), -1,
+        graph_analyzer::RefinementDirection::kForward, 1);
+  }, "The number of rounds must not be negative.");
+  graph_analyzer::IncrementalRefinement refinement(graph, std::vector<int>(3));
+  EXPECT_DEATH({ refinement.Update({0}, {}); },
+               "The new blocks do not have one entry for each new node.");
+}
+
 }  // namespace
 }  // namespace morphie
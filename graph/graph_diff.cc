@@ -0,0 +1,371 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Both graphs are flattened into arrays of label hashes and edge endpoints, so
+// that every round of signatures is a pass over arrays. Nodes are matched by
+// sorting the unmatched nodes of both graphs by a key, and edges by sorting
+// them by their endpoints and labels, so no hash maps are built.
+#include "graph/graph_diff.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+
+#include "util/flat_hash_map.h"
+#include "util/logging.h"
+#include "util/sketches.h"
+
+namespace morphie {
+namespace graph {
+
+namespace {
+
+const char kRoundsErr[] = "The number of rounds must not be negative.";
+
+const NodeId kNoNode = LabeledGraph::kRemovedNode;
+
+// Combines 'value' into the hash 'seed'.
+uint64_t CombineHashes(uint64_t seed, uint64_t value) {
+  return util::internal::MixHash(seed ^ (value + 0x9e3779b97f4a7c15ULL +
+                                         (seed << 6) + (seed >> 2)));
+}
+
+// A graph flattened into arrays, with the node of the other graph that each
+// node is matched with. Hashes of removed nodes are 0, and edges are in the
+// order of EdgeSetBegin().
+struct FlatGraph {
+  explicit FlatGraph(const LabeledGraph& graph);
+
+  const LabeledGraph& graph;
+  std::vector<uint64_t> node_hashes;
+  std::vector<EdgeId> edges;
+  std::vector<NodeId> sources;
+  std::vector<NodeId> targets;
+  std::vector<uint64_t> edge_hashes;
+  std::vector<NodeId> match;
+};
+
+// Every distinct label is serialized and hashed once.
+FlatGraph::FlatGraph(const LabeledGraph& graph) : graph(graph) {
+  std::vector<uint64_t> label_hashes(graph.NumDistinctLabels());
+  for (LabelId label_id = 0; label_id < label_hashes.size(); ++label_id) {
+    label_hashes[label_id] =
+        util::SketchHash(graph.GetLabel(label_id).SerializeAsString());
+  }
+  const size_t num_node_ids = graph.NumNodeIds();
+  node_hashes.assign(num_node_ids, 0);
+  for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+    if (graph.HasNode(node_id)) {
+      node_hashes[node_id] = label_hashes[graph.GetNodeLabelId(node_id)];
+    }
+  }
+  const int num_edges = graph.NumEdges();
+  edges.reserve(num_edges);
+  sources.reserve(num_edges);
+  targets.reserve(num_edges);
+  edge_hashes.reserve(num_edges);
+  for (auto edge_it = graph.EdgeSetBegin(); edge_it != graph.EdgeSetEnd();
+       ++edge_it) {
+    edges.push_back(*edge_it);
+    sources.push_back(graph.Source(*edge_it));
+    targets.push_back(graph.Target(*edge_it));
+    edge_hashes.push_back(label_hashes[graph.GetEdgeLabelId(*edge_it)]);
+  }
+  match.assign(num_node_ids, kNoNode);
+}
+
+// Sets '*signatures' to the signatures of the nodes of 'graph' after 'rounds'
+// rounds. The edges of a node are combined by summing their hashes, which does
+// not depend on the order of the edges, and the sums of outgoing and incoming
+// edges are kept apart. Removed nodes keep the signature 0.
+void ComputeSignatures(const FlatGraph& graph, int rounds,
+                       std::vector<uint64_t>* signatures) {
+  *signatures = graph.node_hashes;
+  const size_t num_nodes = signatures->size();
+  std::vector<uint64_t> out_sums;
+  std::vector<uint64_t> in_sums;
+  for (int round = 0; round < rounds; ++round) {
+    out_sums.assign(num_nodes, 0);
+    in_sums.assign(num_nodes, 0);
+    for (size_t i = 0; i < graph.edges.size(); ++i) {
+      const NodeId source = graph.sources[i];
+      const NodeId target = graph.targets[i];
+      out_sums[source] += util::internal::MixHash(
+          CombineHashes(graph.edge_hashes[i], (*signatures)[target]));
+      in_sums[target] += util::internal::MixHash(
+          CombineHashes(graph.edge_hashes[i], (*signatures)[source]));
+    }
+    for (size_t node = 0; node < num_nodes; ++node) {
+      if (graph.node_hashes[node] != 0) {
+        (*signatures)[node] = CombineHashes(
+            CombineHashes((*signatures)[node], out_sums[node]),
+            in_sums[node]);
+      }
+    }
+  }
+}
+
+// Matches the unmatched nodes of 'before' and 'after' that have equal keys,
+// where 'before_keys' and 'after_keys' are the keys of their nodes. A node
+// with the key 0 is not matched. Of the nodes with one key, the i-th node of
+// 'before' is matched with the i-th node of 'after'.
+void MatchByKey(const std::vector<uint64_t>& before_keys,
+                const std::vector<uint64_t>& after_keys, FlatGraph* before,
+                FlatGraph* after) {
+  // An entry is a key, 0 for 'before' or 1 for 'after', and a node.
+  std::vector<std::tuple<uint64_t, int, NodeId>> entries;
+  for (NodeId node_id = 0; node_id < before_keys.size(); ++node_id) {
+    if (before->match[node_id] == kNoNode && before_keys[node_id] != 0) {
+      entries.emplace_back(before_keys[node_id], 0, node_id);
+    }
+  }
+  for (NodeId node_id = 0; node_id < after_keys.size(); ++node_id) {
+    if (after->match[node_id] == kNoNode && after_keys[node_id] != 0) {
+      entries.emplace_back(after_keys[node_id], 1, node_id);
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+  size_t begin = 0;
+  while (begin < entries.size()) {
+    const uint64_t key = std::get<0>(entries[begin]);
+    size_t middle = begin;
+    while (middle < entries.size() && std::get<0>(entries[middle]) == key &&
+           std::get<1>(entries[middle]) == 0) {
+      ++middle;
+    }
+    size_t end = middle;
+    while (end < entries.size() && std::get<0>(entries[end]) == key) {
+      ++end;
+    }
+    for (size_t i = 0; begin + i < middle && middle + i < end; ++i) {
+      const NodeId before_node = std::get<2>(entries[begin + i]);
+      const NodeId after_node = std::get<2>(entries[middle + i]);
+      before->match[before_node] = after_node;
+      after->match[after_node] = before_node;
+    }
+    begin = end;
+  }
+}
+
+// Returns the keys of the nodes of 'graph' with unique labels, which are the
+// hashes of their labels, and 0 for the other nodes.
+std::vector<uint64_t> UniqueLabelKeys(const FlatGraph& graph) {
+  std::vector<uint64_t> keys(graph.node_hashes.size(), 0);
+  for (NodeId node_id = 0; node_id < keys.size(); ++node_id) {
+    if (graph.graph.HasNode(node_id) &&
+        graph.graph.IsUniqueNodeType(graph.graph.GetNodeLabel(node_id))) {
+      keys[node_id] = graph.node_hashes[node_id];
+    }
+  }
+  return keys;
+}
+
+// Returns the keys of the unmatched nodes of 'graph' for the last step of the
+// matching, which combine the tag of a node with the ids in 'before' of its
+// matched successors and predecessors. Edge labels are left out, since the
+// edges of a changed node often change as well. A node without matched
+// neighbors has the key 0. 'is_before' is true if 'graph' is the graph
+// 'before'.
+std::vector<uint64_t> NeighborKeys(const FlatGraph& graph, bool is_before) {
+  const size_t num_nodes = graph.node_hashes.size();
+  std::vector<uint64_t> out_sums(num_nodes, 0);
+  std::vector<uint64_t> in_sums(num_nodes, 0);
+  std::vector<char> has_matched_neighbor(num_nodes, 0);
+  auto before_id = [&graph, is_before](NodeId node_id) {
+    return is_before ? node_id : graph.match[node_id];
+  };
+  for (size_t i = 0; i < graph.edges.size(); ++i) {
+    const NodeId source = graph.sources[i];
+    const NodeId target = graph.targets[i];
+    if (graph.match[target] != kNoNode) {
+      out_sums[source] += util::internal::MixHash(before_id(target));
+      has_matched_neighbor[source] = 1;
+    }
+    if (graph.match[source] != kNoNode) {
+      in_sums[target] += util::internal::MixHash(before_id(source));
+      has_matched_neighbor[target] = 1;
+    }
+  }
+  std::vector<uint64_t> keys(num_nodes, 0);
+  for (NodeId node_id = 0; node_id < num_nodes; ++node_id) {
+    if (graph.match[node_id] != kNoNode || !has_matched_neighbor[node_id]) {
+      continue;
+    }
+    const uint64_t tag_hash =
+        std::hash<string>()(graph.graph.GetNodeLabel(node_id).tag());
+    keys[node_id] = CombineHashes(
+        CombineHashes(tag_hash, out_sums[node_id]), in_sums[node_id]);
+  }
+  return keys;
+}
+
+// An edge with the ids of its endpoints in 'before', the hash of its label
+// and its position in the edges of its graph.
+struct EdgeKey {
+  NodeId source;
+  NodeId target;
+  uint64_t label;
+  size_t edge;
+};
+
+// Pairs the edges in 'before' and 'after' with the same endpoints and, if
+// 'compare_labels' is true, the same label, and appends the positions of the
+// paired edges to 'pairs'. The edges that are not paired remain in 'before'
+// and 'after'.
+void MatchEdges(bool compare_labels, std::vector<EdgeKey>* before,
+                std::vector<EdgeKey>* after,
+                std::vector<std::pair<size_t, size_t>>* pairs) {
+  auto less = [compare_labels](const EdgeKey& key1, const EdgeKey& key2) {
+    if (key1.source != key2.source) {
+      return key1.source < key2.source;
+    }
+    if (key1.target != key2.target) {
+      return key1.target < key2.target;
+    }
+    return compare_labels && key1.label < key2.label;
+  };
+  auto by_position = [&less](const EdgeKey& key1, const EdgeKey& key2) {
+    return less(key1, key2) || (!less(key2, key1) && key1.edge < key2.edge);
+  };
+  std::sort(before->begin(), before->end(), by_position);
+  std::sort(after->begin(), after->end(), by_position);
+  std::vector<EdgeKey> unpaired_before;
+  std::vector<EdgeKey> unpaired_after;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < before->size() && j < after->size()) {
+    if (less((*before)[i], (*after)[j])) {
+      unpaired_before.push_back((*before)[i++]);
+    } else if (less((*after)[j], (*before)[i])) {
+      unpaired_after.push_back((*after)[j++]);
+    } else {
+      pairs->emplace_back((*before)[i++].edge, (*after)[j++].edge);
+    }
+  }
+  unpaired_before.insert(unpaired_before.end(), before->begin() + i,
+                         before->end());
+  unpaired_after.insert(unpaired_after.end(), after->begin() + j,
+                        after->end());
+  before->swap(unpaired_before);
+  after->swap(unpaired_after);
+}
+
+// Appends the edges of 'graph' at the positions of 'keys' to 'edges', in the
+// order of their positions.
+void AppendEdges(const FlatGraph& graph, std::vector<EdgeKey>* keys,
+                 std::vector<EdgeId>* edges) {
+  std::sort(keys->begin(), keys->end(),
+            [](const EdgeKey& key1, const EdgeKey& key2) {
+              return key1.edge < key2.edge;
+            });
+  for (const EdgeKey& key : *keys) {
+    edges->push_back(graph.edges[key.edge]);
+  }
+}
+
+}  // namespace
+
+bool GraphDiff::IsEmpty() const {
+  return removed_nodes.empty() && added_nodes.empty() &&
+         changed_nodes.empty() && removed_edges.empty() &&
+         added_edges.empty() && changed_edges.empty();
+}
+
+// Signatures are recomputed for every number of rounds instead of being kept
+// for all rounds, so that the diff uses memory linear in the size of the
+// graphs.
+GraphDiff DiffGraphs(const LabeledGraph& before, const LabeledGraph& after,
+                     int max_rounds) {
+  CHECK(max_rounds >= 0, kRoundsErr);
+  FlatGraph flat_before(before);
+  FlatGraph flat_after(after);
+  MatchByKey(UniqueLabelKeys(flat_before), UniqueLabelKeys(flat_after),
+             &flat_before, &flat_after);
+  std::vector<uint64_t> before_signatures;
+  std::vector<uint64_t> after_signatures;
+  for (int rounds = max_rounds; rounds >= 0; --rounds) {
+    ComputeSignatures(flat_before, rounds, &before_signatures);
+    ComputeSignatures(flat_after, rounds, &after_signatures);
+    MatchByKey(before_signatures, after_signatures, &flat_before,
+               &flat_after);
+  }
+  MatchByKey(NeighborKeys(flat_before, true), NeighborKeys(flat_after, false),
+             &flat_before, &flat_after);
+
+  GraphDiff diff;
+  for (NodeId node_id = 0; node_id < flat_before.match.size(); ++node_id) {
+    const NodeId image = flat_before.match[node_id];
+    if (!before.HasNode(node_id)) {
+      continue;
+    }
+    if (image == kNoNode) {
+      diff.removed_nodes.push_back(node_id);
+    } else if (flat_before.node_hashes[node_id] !=
+               flat_after.node_hashes[image]) {
+      diff.changed_nodes.emplace_back(node_id, image);
+    }
+  }
+  for (NodeId node_id = 0; node_id < flat_after.match.size(); ++node_id) {
+    if (after.HasNode(node_id) && flat_after.match[node_id] == kNoNode) {
+      diff.added_nodes.push_back(node_id);
+    }
+  }
+
+  // Edges with an unmatched endpoint cannot be matched.
+  std::vector<EdgeKey> before_keys;
+  std::vector<EdgeKey> after_keys;
+  std::vector<EdgeKey> removed_keys;
+  std::vector<EdgeKey> added_keys;
+  for (size_t i = 0; i < flat_before.edges.size(); ++i) {
+    const NodeId source = flat_before.sources[i];
+    const NodeId target = flat_before.targets[i];
+    EdgeKey key = {source, target, flat_before.edge_hashes[i], i};
+    if (flat_before.match[source] == kNoNode ||
+        flat_before.match[target] == kNoNode) {
+      removed_keys.push_back(key);
+    } else {
+      before_keys.push_back(key);
+    }
+  }
+  for (size_t i = 0; i < flat_after.edges.size(); ++i) {
+    const NodeId source = flat_after.match[flat_after.sources[i]];
+    const NodeId target = flat_after.match[flat_after.targets[i]];
+    EdgeKey key = {source, target, flat_after.edge_hashes[i], i};
+    if (source == kNoNode || target == kNoNode) {
+      added_keys.push_back(key);
+    } else {
+      after_keys.push_back(key);
+    }
+  }
+  std::vector<std::pair<size_t, size_t>> pairs;
+  MatchEdges(true, &before_keys, &after_keys, &pairs);
+  pairs.clear();
+  MatchEdges(false, &before_keys, &after_keys, &pairs);
+  std::sort(pairs.begin(), pairs.end());
+  for (const auto& pair : pairs) {
+    diff.changed_edges.emplace_back(flat_before.edges[pair.first],
+                                    flat_after.edges[pair.second]);
+  }
+  removed_keys.insert(removed_keys.end(), before_keys.begin(),
+                      before_keys.end());
+  added_keys.insert(added_keys.end(), after_keys.begin(), after_keys.end());
+  AppendEdges(flat_before, &removed_keys, &diff.removed_edges);
+  AppendEdges(flat_after, &added_keys, &diff.added_edges);
+  diff.node_map.swap(flat_before.match);
+  return diff;
+}
+
+}  // namespace graph
+}  // namespace morphie
@@ -0,0 +1,101 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A graph diff compares two graphs with the same types, such as the graphs of
+// the timelines of a host before and after an incident, or of a baseline and a
+// suspect machine. The nodes of the first graph are matched with nodes of the
+// second graph, and the diff reports the nodes and edges of the first graph
+// that were removed, those of the second graph that were added, and the nodes
+// and edges whose labels changed.
+//
+// Nodes are matched in three steps.
+//  1. A node with a unique label is matched with the node with the same label
+//     in the other graph, if there is one.
+//  2. The other nodes are matched by the signatures of their neighborhoods.
+//     The signature of a node after 0 rounds is the hash of its label, and its
+//     signature after k + 1 rounds combines its signature after k rounds with
+//     the labels and signatures after k rounds of the edges and neighbors on
+//     either side, like the signatures of the bounded refinement in
+//     graph_analyzer.h but with edge labels and with every edge counted. Nodes
+//     with equal signatures after k rounds have equal labels and equal
+//     neighborhoods up to distance k, up to hash collisions. Unmatched nodes
+//     are matched with signatures of the largest number of rounds first, so
+//     that a node is matched with a node in the most similar context, and
+//     nodes with the same signature are matched in increasing order of their
+//     ids.
+//  3. The remaining nodes of a tag are matched if they have a matched neighbor
+//     and the same matched successors and predecessors, whatever the labels
+//     of the edges to them. Such nodes have different labels and are reported
+//     as changed.
+// The nodes that remain unmatched are removed or added. An edge of the first
+// graph is matched with an edge of the second graph with the same label
+// between the images of its source and target, and otherwise with an edge with
+// a different label between them, which is reported as changed.
+//
+// Labels are compared by 64-bit hashes of their serializations. A diff with k
+// rounds takes O(k^2 m + n log n + m log m) time and O(n + m) space for graphs
+// with n nodes and m edges.
+//
+// Example.
+//   GraphDiff diff = DiffGraphs(baseline, suspect, 3);
+//   for (NodeId node_id : diff.added_nodes) {
+//     // 'node_id' is a node of 'suspect' that is not in 'baseline'.
+//   }
+#ifndef LOGLE_GRAPH_DIFF_H_
+#define LOGLE_GRAPH_DIFF_H_
+
+#include <utility>
+#include <vector>
+
+#include "graph/labeled_graph.h"
+
+namespace morphie {
+namespace graph {
+
+// The differences between a graph 'before' and a graph 'after'. Nodes and
+// edges of 'before' are removed or changed, and those of 'after' are added.
+// The lists are sorted by node id, or by the position of an edge in
+// EdgeSetBegin().
+struct GraphDiff {
+  // The node of 'after' that is matched with each node id of 'before', or
+  // LabeledGraph::kRemovedNode if the node was removed or is not a node of
+  // 'before'. Like the node map of a Morphism, it is a partial function from
+  // the nodes of 'before' to those of 'after', but it is also injective.
+  std::vector<NodeId> node_map;
+  std::vector<NodeId> removed_nodes;
+  std::vector<NodeId> added_nodes;
+  // The pairs of a node of 'before' and its image, if their labels differ.
+  std::vector<std::pair<NodeId, NodeId>> changed_nodes;
+  std::vector<EdgeId> removed_edges;
+  std::vector<EdgeId> added_edges;
+  // The pairs of an edge of 'before' and an edge of 'after' between the images
+  // of its source and target, if their labels differ.
+  std::vector<std::pair<EdgeId, EdgeId>> changed_edges;
+
+  // Returns true if the graphs have the same nodes and edges.
+  bool IsEmpty() const;
+};
+
+// Returns the differences between 'before' and 'after', matching nodes with
+// signatures of at most 'max_rounds' rounds. More rounds distinguish nodes
+// with equal labels by a larger part of their neighborhoods.
+// - Crashes unless both graphs are initialized and 'max_rounds' is not
+//   negative.
+GraphDiff DiffGraphs(const LabeledGraph& before, const LabeledGraph& after,
+                     int max_rounds);
+
+}  // namespace graph
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_DIFF_H_
@@ -0,0 +1,146 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_diff.h"
+
+#include <utility>
+#include <vector>
+
+#include "graph/test_graphs.h"
+#include "graph/value.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace graph {
+namespace {
+
+using test::InitializeReadsGraph;
+using test::MakeLabel;
+using test::kCountTag;
+using test::kEventTag;
+using test::kFileTag;
+using test::kReadsTag;
+
+TaggedAST EventLabel(int event) {
+  return MakeLabel(kEventTag, ast::value::MakeInt(event));
+}
+
+TaggedAST FileLabel(const string& filename) {
+  return MakeLabel(kFileTag, filename);
+}
+
+TaggedAST ReadsLabel() {
+  TaggedAST label;
+  label.set_tag(kReadsTag);
+  return label;
+}
+
+TaggedAST CountLabel(int count) {
+  return MakeLabel(kCountTag, ast::value::MakeInt(count));
+}
+
+// Adds an event with the label 'event' that reads the file 'filename'.
+NodeId AddRead(int event, const string& filename, LabeledGraph* graph) {
+  NodeId event_id = graph->FindOrAddNode(EventLabel(event));
+  NodeId file_id = graph->FindOrAddNode(FileLabel(filename));
+  graph->FindOrAddEdge(event_id, file_id, ReadsLabel());
+  return event_id;
+}
+
+// Graphs with the same nodes and edges, added in different orders, have no
+// differences, and events with the same label are matched by the files they
+// read.
+TEST(GraphDiffTest, MatchesEqualGraphs) {
+  LabeledGraph before;
+  InitializeReadsGraph(&before);
+  NodeId before_a = AddRead(1, "a", &before);
+  NodeId before_b = AddRead(1, "b", &before);
+  LabeledGraph after;
+  InitializeReadsGraph(&after);
+  NodeId after_b = AddRead(1, "b", &after);
+  NodeId after_a = AddRead(1, "a", &after);
+  GraphDiff diff = DiffGraphs(before, after, 2);
+  EXPECT_TRUE(diff.IsEmpty());
+  ASSERT_EQ(4, diff.node_map.size());
+  EXPECT_EQ(after_a, diff.node_map[before_a]);
+  EXPECT_EQ(after_b, diff.node_map[before_b]);
+  EXPECT_EQ(after.GetNodes(FileLabel("a"))[0],
+            diff.node_map[before.GetNodes(FileLabel("a"))[0]]);
+}
+
+TEST(GraphDiffTest, ReportsChanges) {
+  LabeledGraph before;
+  InitializeReadsGraph(&before);
+  AddRead(1, "a", &before);
+  NodeId removed = AddRead(2, "b", &before);
+  NodeId changed = AddRead(3, "c", &before);
+  NodeId file_a = before.GetNodes(FileLabel("a"))[0];
+  EdgeId changed_edge = before.FindOrAddEdge(file_a, changed, CountLabel(1));
+  LabeledGraph after;
+  InitializeReadsGraph(&after);
+  AddRead(1, "a", &after);
+  NodeId added = AddRead(4, "d", &after);
+  NodeId file_b = after.FindOrAddNode(FileLabel("b"));
+  NodeId changed_image = AddRead(5, "c", &after);
+  EdgeId changed_image_edge = after.FindOrAddEdge(
+      after.GetNodes(FileLabel("a"))[0], changed_image, CountLabel(2));
+
+  GraphDiff diff = DiffGraphs(before, after, 2);
+  EXPECT_FALSE(diff.IsEmpty());
+  EXPECT_EQ(std::vector<NodeId>({removed}), diff.removed_nodes);
+  ASSERT_EQ(2, diff.added_nodes.size());
+  EXPECT_EQ(added, diff.added_nodes[0]);
+  EXPECT_EQ(added + 1, diff.added_nodes[1]);
+  EXPECT_EQ(LabeledGraph::kRemovedNode, diff.node_map[removed]);
+  EXPECT_EQ(file_b, diff.node_map[before.GetNodes(FileLabel("b"))[0]]);
+  ASSERT_EQ(1, diff.changed_nodes.size());
+  EXPECT_EQ(std::make_pair(changed, changed_image), diff.changed_nodes[0]);
+  // The edge from the removed event to 'b' is removed, the edge from the added
+  // event to 'd' is added, and the edge that reads 'c' is matched even though
+  // its source changed.
+  ASSERT_EQ(1, diff.removed_edges.size());
+  EXPECT_EQ(removed, before.Source(diff.removed_edges[0]));
+  ASSERT_EQ(1, diff.added_edges.size());
+  EXPECT_EQ(added, after.Source(diff.added_edges[0]));
+  ASSERT_EQ(1, diff.changed_edges.size());
+  EXPECT_EQ(changed_edge, diff.changed_edges[0].first);
+  EXPECT_EQ(changed_image_edge, diff.changed_edges[0].second);
+}
+
+// Nodes that were removed from a graph and not compacted are not compared.
+TEST(GraphDiffTest, SkipsRemovedNodes) {
+  LabeledGraph before;
+  InitializeReadsGraph(&before);
+  NodeId removed = AddRead(1, "a", &before);
+  AddRead(2, "b", &before);
+  before.RemoveNodes({removed});
+  LabeledGraph after;
+  InitializeReadsGraph(&after);
+  AddRead(2, "b", &after);
+  after.FindOrAddNode(FileLabel("a"));
+  GraphDiff diff = DiffGraphs(before, after, 1);
+  EXPECT_TRUE(diff.IsEmpty());
+  EXPECT_EQ(LabeledGraph::kRemovedNode, diff.node_map[removed]);
+}
+
+TEST(GraphDiffDeathTest, RequiresNonNegativeRounds) {
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  EXPECT_DEATH({ DiffGraphs(graph, graph, -1); },
+               "The number of rounds must not be negative.");
+}
+
+}  // namespace
+}  // namespace graph
+}  // namespace morphie
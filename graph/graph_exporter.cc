@@ -14,28 +14,62 @@
 
 #include "graph/graph_exporter.h"
 
-#include <unordered_map>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <algorithm>
+#include <utility>
 
 #include "graph/ast.h"
+#include "util/logging.h"
 #include "util/string_utils.h"
+#include "util/thread_pool.h"
+#include "util/trace.h"
 
 namespace morphie {
 namespace viz {
 
+namespace {
+
+const char kThreadsErr[] = "The number of threads must be positive.";
+const char kPageSizeErr[] = "The size of a page must be positive.";
+
+}  // namespace
+
 GraphExporter::GraphExporter(const LabeledGraph& graph)
-    : graph_(graph), node_label_(TextLabel) {}
+    : view_(graph), node_label_(TextLabel), num_threads_(1) {}
 
 GraphExporter::GraphExporter(const LabeledGraph& graph,
                              const LabelFn& node_label)
-    : graph_(graph), node_label_(node_label) {}
+    : view_(graph), node_label_(node_label), num_threads_(1) {}
+
+GraphExporter::GraphExporter(const LabeledGraphView& view)
+    : view_(view), node_label_(TextLabel), num_threads_(1) {}
+
+GraphExporter::GraphExporter(const LabeledGraphView& view,
+                             const LabelFn& node_label)
+    : view_(view), node_label_(node_label), num_threads_(1) {}
+
+void GraphExporter::SetNumThreads(int num_threads) {
+  CHECK(num_threads > 0, kThreadsErr);
+  num_threads_ = num_threads;
+}
+
+void GraphExporter::SetVirtualEdges(const NeighborFn& predecessors,
+                                    const NeighborFn& successors) {
+  virtual_predecessors_ = predecessors;
+  virtual_successors_ = successors;
+}
 
 // Returns a serialization of 'ast' with '/' as a separator and no bounding
 // delimiters. The serialization is prefixed by "tag/".
 string GraphExporter::TextLabel(const string& tag, const AST& ast) {
   string label = tag;
   label += "/";
-  label += ast::ToString(
-      ast, ast::PrintConfig("", "", "/", ast::PrintOption::kValue));
+  ast::AppendToString(
+      ast, ast::PrintConfig("", "", "/", ast::PrintOption::kValue), &label);
   return label;
 }
 
@@ -51,8 +85,10 @@ string GraphExporter::HTMLLabel(const string& tag, const AST& ast) {
 }
 
 ge::GraphDef GraphExporter::Graph() {
+  util::ScopedSpan span("GraphExporter::Graph");
+  ComputeNodeNames();
   ge::GraphDef vis_graph;
-  for (auto node_it = graph_.NodeSetBegin(); node_it != graph_.NodeSetEnd();
+  for (auto node_it = view_.NodeSetBegin(); node_it != view_.NodeSetEnd();
        ++node_it) {
     ge::Node* vis_node = vis_graph.add_node();
     *vis_node = Node(*node_it);
@@ -62,6 +98,160 @@ ge::GraphDef GraphExporter::Graph() {
 
 string GraphExporter::GraphAsString() { return Graph().DebugString(); }
 
+// A serialized GraphDef is the concatenation of its serialized nodes, each
+// preceded by the tag of the 'node' field and the size of the node.
+void GraphExporter::WriteGraph(std::ostream* out) {
+  namespace io = ::google::protobuf::io;
+  using ::google::protobuf::internal::WireFormatLite;
+  const uint32_t node_tag =
+      WireFormatLite::MakeTag(ge::GraphDef::kNodeFieldNumber,
+                              WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  util::ScopedSpan span("GraphExporter::WriteGraph");
+  ComputeNodeNames();
+  io::OstreamOutputStream zero_copy_out(out);
+  io::CodedOutputStream coded_out(&zero_copy_out);
+  for (auto node_it = view_.NodeSetBegin(); node_it != view_.NodeSetEnd();
+       ++node_it) {
+    ge::Node vis_node = Node(*node_it);
+    coded_out.WriteTag(node_tag);
+    coded_out.WriteVarint32(static_cast<uint32_t>(vis_node.ByteSizeLong()));
+    vis_node.SerializeWithCachedSizes(&coded_out);
+  }
+}
+
+// The text of a GraphDef is the text of each node, indented by one level
+// inside a "node" block. The printer is configured as the one DebugString()
+// uses, so the text is that of GraphAsString().
+void GraphExporter::WriteGraphText(std::ostream* out) {
+  util::ScopedSpan span("GraphExporter::WriteGraphText");
+  ComputeNodeNames();
+  google::protobuf::TextFormat::Printer printer;
+  printer.SetExpandAny(true);
+  printer.SetInitialIndentLevel(1);
+  string node_text;
+  for (auto node_it = view_.NodeSetBegin(); node_it != view_.NodeSetEnd();
+       ++node_it) {
+    printer.PrintToString(Node(*node_it), &node_text);
+    *out << "node {\n" << node_text << "}\n";
+  }
+}
+
+// The node pages are written in one pass over the nodes. The edge pages of a
+// node page are written in a pass over its nodes, whose identifier range is
+// recorded in the manifest, so the nodes of a page are not kept.
+ge::GraphManifest GraphExporter::WritePages(int nodes_per_page,
+                                            int edges_per_page,
+                                            const PageWriter& write_page) {
+  CHECK(nodes_per_page > 0 && edges_per_page > 0, kPageSizeErr);
+  util::ScopedSpan span("GraphExporter::WritePages");
+  ComputeNodeNames();
+  ge::GraphManifest manifest;
+  ge::GraphDef page;
+  NodeId first_node_id = 0;
+  NodeId last_node_id = 0;
+  auto write_node_page = [&]() {
+    if (!write_page(manifest.page_size(), page)) {
+      return false;
+    }
+    ge::PageInfo* info = manifest.add_page();
+    info->set_kind(ge::PageInfo::NODES);
+    info->set_node_page(manifest.page_size() - 1);
+    info->set_first_node_id(first_node_id);
+    info->set_last_node_id(last_node_id);
+    info->set_num_nodes(page.node_size());
+    page.Clear();
+    return true;
+  };
+  for (auto node_it = view_.NodeSetBegin(); node_it != view_.NodeSetEnd();
+       ++node_it) {
+    if (page.node_size() == 0) {
+      first_node_id = *node_it;
+    }
+    last_node_id = *node_it;
+    SetNodeAttributes(*node_it, page.add_node());
+    if (page.node_size() == nodes_per_page && !write_node_page()) {
+      return manifest;
+    }
+  }
+  if (page.node_size() > 0 && !write_node_page()) {
+    return manifest;
+  }
+  manifest.set_num_nodes(view_.NumNodes());
+  const int num_node_pages = manifest.page_size();
+  std::vector<NodeId> sources;
+  for (int node_page = 0; node_page < num_node_pages; ++node_page) {
+    sources.clear();
+    const NodeId last = manifest.page(node_page).last_node_id();
+    for (NodeId node_id = manifest.page(node_page).first_node_id();
+         node_id <= last; ++node_id) {
+      if (view_.HasNode(node_id)) {
+        sources.push_back(node_id);
+      }
+    }
+    if (!WriteEdgePages(node_page, sources, edges_per_page, write_page,
+                        &manifest)) {
+      break;
+    }
+  }
+  return manifest;
+}
+
+// The edges are sorted by target and then by source, so that the entry of a
+// target lists its sources in increasing order, as in Graph().
+bool GraphExporter::WriteEdgePages(int node_page,
+                                   const std::vector<NodeId>& sources,
+                                   int edges_per_page,
+                                   const PageWriter& write_page,
+                                   ge::GraphManifest* manifest) {
+  std::vector<std::pair<NodeId, NodeId>> edges;
+  std::vector<NodeId> successors;
+  for (NodeId source : sources) {
+    successors.clear();
+    view_.CollectSuccessors(source, &marker_, &successors);
+    if (virtual_successors_) {
+      AddVirtualNeighbors(virtual_successors_, source, &successors);
+    }
+    for (NodeId target : successors) {
+      edges.emplace_back(target, source);
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  ge::GraphDef page;
+  int num_edges = 0;
+  auto write_edge_page = [&]() {
+    if (!write_page(manifest->page_size(), page)) {
+      return false;
+    }
+    ge::PageInfo* info = manifest->add_page();
+    info->set_kind(ge::PageInfo::EDGES);
+    info->set_node_page(node_page);
+    info->set_first_node_id(sources.front());
+    info->set_last_node_id(sources.back());
+    info->set_num_nodes(page.node_size());
+    info->set_num_edges(num_edges);
+    manifest->set_num_edges(manifest->num_edges() + num_edges);
+    page.Clear();
+    num_edges = 0;
+    return true;
+  };
+  ge::Node* target_node = nullptr;
+  for (size_t i = 0; i < edges.size(); ++i) {
+    if (target_node == nullptr || edges[i].first != edges[i - 1].first) {
+      target_node = page.add_node();
+      target_node->set_name(node_names_[edges[i].first]);
+    }
+    target_node->add_edge()->set_input(node_names_[edges[i].second]);
+    ++num_edges;
+    if (num_edges == edges_per_page) {
+      if (!write_edge_page()) {
+        return false;
+      }
+      target_node = nullptr;
+    }
+  }
+  return num_edges == 0 || write_edge_page();
+}
+
 string GraphExporter::NodeName(NodeId node_id, const string& tag,
                                const AST& ast) {
   string label = TextLabel(tag, ast);
@@ -70,48 +260,76 @@ string GraphExporter::NodeName(NodeId node_id, const string& tag,
   return label;
 }
 
-string GraphExporter::FindOrAddName(NodeId node_id) {
-  auto node_name_it = node_name_.find(node_id);
-  if (node_name_it != node_name_.end()) {
-    return node_name_it->second;
-  } else {
-    TaggedAST node_label = graph_.GetNodeLabel(node_id);
-    string label = NodeName(node_id, node_label.tag(), node_label.ast());
-    node_name_.emplace(node_id, label);
-    return label;
-  }
+// The names are computed in consecutive ranges of node identifiers by the
+// calling thread and a pool with one worker less than the number of threads.
+// Identifiers of nodes that are not in the view have no name.
+void GraphExporter::ComputeNodeNames() {
+  const size_t num_nodes = view_.NumNodeIds();
+  node_names_.assign(num_nodes, "");
+  auto compute_names = [this](size_t begin, size_t end) {
+    for (NodeId node_id = begin; node_id < end; ++node_id) {
+      if (!view_.HasNode(node_id)) {
+        continue;
+      }
+      const TaggedAST& node_label = view_.GetNodeLabel(node_id);
+      node_names_[node_id] =
+          NodeName(node_id, node_label.tag(), node_label.ast());
+    }
+  };
+  util::ThreadPool pool(num_threads_ - 1);
+  util::ParallelFor(num_nodes, &pool, compute_names);
 }
 
-ge::Node GraphExporter::Node(NodeId node_id) {
-  ge::Node vis_node;
-  if (!graph_.HasNode(node_id)) {
-    return vis_node;
-  }
+void GraphExporter::SetNodeAttributes(NodeId node_id, ge::Node* vis_node) {
   // The node name is an identifier for the node.
-  string node_name = FindOrAddName(node_id);
-  vis_node.set_name(node_name);
+  vis_node->set_name(node_names_[node_id]);
   // The label is the string displayed on the node.
-  TaggedAST label_ast = graph_.GetNodeLabel(node_id);
+  const TaggedAST& label_ast = view_.GetNodeLabel(node_id);
   string label_str = node_label_(label_ast.tag(), label_ast.ast());
   // vis_node.set_label(HTMLLabel(node_label.tag(), node_label.ast()));
   // Set node attributes.
-  auto& node_attr = *vis_node.mutable_node_attr();
+  auto& node_attr = *vis_node->mutable_node_attr();
   node_attr["label"] = label_str;
   // The value of this field can be used to automatically color a metanode by
   // the frequency of types of nodes within the metanode.
   node_attr["op"] = "op";
-  std::set<NodeId> in_nodes = graph_.GetPredecessors(node_id);
-  string in_node_name;
-  for (auto in_node : in_nodes) {
-    in_node_name = FindOrAddName(in_node);
-    TaggedAST in_node_label = graph_.GetNodeLabel(in_node);
-    string in_node_name =
-        NodeName(in_node, in_node_label.tag(), in_node_label.ast());
+}
+
+ge::Node GraphExporter::Node(NodeId node_id) {
+  ge::Node vis_node;
+  if (!view_.HasNode(node_id)) {
+    return vis_node;
+  }
+  SetNodeAttributes(node_id, &vis_node);
+  // Edges are added in increasing order of their source, as GetPredecessors
+  // would return them.
+  in_nodes_.clear();
+  view_.CollectPredecessors(node_id, &marker_, &in_nodes_);
+  if (virtual_predecessors_) {
+    AddVirtualNeighbors(virtual_predecessors_, node_id, &in_nodes_);
+  } else {
+    std::sort(in_nodes_.begin(), in_nodes_.end());
+  }
+  for (NodeId in_node : in_nodes_) {
     ge::Edge* edge = vis_node.add_edge();
-    edge->set_input(in_node_name);
+    edge->set_input(node_names_[in_node]);
   }
   return vis_node;
 }
 
+void GraphExporter::AddVirtualNeighbors(const NeighborFn& neighbors,
+                                        NodeId node_id,
+                                        std::vector<NodeId>* nodes) {
+  virtual_nodes_.clear();
+  neighbors(node_id, &virtual_nodes_);
+  for (NodeId neighbor : virtual_nodes_) {
+    if (view_.HasNode(neighbor)) {
+      nodes->push_back(neighbor);
+    }
+  }
+  std::sort(nodes->begin(), nodes->end());
+  nodes->erase(std::unique(nodes->begin(), nodes->end()), nodes->end());
+}
+
 }  // namespace viz
 }  // namespace morphie
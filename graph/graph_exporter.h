@@ -18,10 +18,14 @@
 #ifndef LOGLE_GRAPH_EXPORTER_H_
 #define LOGLE_GRAPH_EXPORTER_H_
 
+#include <functional>
+#include <ostream>
 #include <string>
+#include <vector>
 
 #include "base/string.h"
 #include "graph/labeled_graph.h"
+#include "graph/labeled_graph_view.h"
 #include "ast.pb.h"
 #include "graph_explorer.pb.h"
 
@@ -41,9 +45,21 @@ namespace ge = ::graph_explorer;
 // and returns a TensorFlow label. See ast.proto for more on ASTs.
 using LabelFn = std::function<string(const string&, const AST&)>;
 
-// The GraphExporter class below uses an internal map from LabeledGraph node ids
-// to GraphDef node identifiers. A separate GraphExporter object has to be
-// created for each graph that is to be exported.
+// A page writer is called with the index and contents of each page of a graph
+// that is exported in pages, in order, and returns false if the page could not
+// be written, which stops the export.
+using PageWriter = std::function<bool(int, const ge::GraphDef&)>;
+
+// A neighbor function appends to its second argument the nodes that are
+// adjacent to the node given as its first argument by edges that are not
+// stored in the graph, such as edges that are computed from an index.
+using NeighborFn = std::function<void(NodeId, std::vector<NodeId>*)>;
+
+// The GraphExporter class below computes the GraphDef node identifiers of all
+// LabeledGraph nodes in one pass before a graph is exported, so that every edge
+// refers to the identifiers of its endpoints without recomputing them. A
+// separate GraphExporter object has to be created for each graph that is to be
+// exported.
 class GraphExporter {
  public:
   // This constructor sets the default node label function, which is
@@ -56,35 +72,105 @@ class GraphExporter {
   // class-level comment.
   GraphExporter(const LabeledGraph& graph, const LabelFn& node_label);
 
+  // These constructors export the nodes and edges of a view. The nodes are
+  // named with their identifiers in the graph. The exporter keeps a copy of
+  // the view, which refers to the graph.
+  explicit GraphExporter(const LabeledGraphView& view);
+  GraphExporter(const LabeledGraphView& view, const LabelFn& node_label);
+
   // Returns the tag and contents of the AST as a slash-delimited string.
   static string TextLabel(const string& tag, const AST& ast);
   // Returns the AST as an HTML string. Primary AST values are treated as plain
   // strings and composite values are represented as a table.
   static string HTMLLabel(const string& tag, const AST& ast);
 
+  // Sets the number of threads that compute node identifiers before a graph is
+  // exported. The default is one thread. With more than one thread, the
+  // identifiers of different nodes are computed concurrently, which requires
+  // the graph not to be modified during the export.
+  // - Crashes if 'num_threads' is less than 1.
+  void SetNumThreads(int num_threads);
+
+  // Sets the edges that are exported in addition to the edges of the graph.
+  // 'predecessors' appends the sources of the edges that enter a node and
+  // 'successors' the targets of the edges that leave it, so they must
+  // describe the same edges. Nodes that are not in the view are skipped, and
+  // an edge that is also in the graph is exported once.
+  void SetVirtualEdges(const NeighborFn& predecessors,
+                       const NeighborFn& successors);
+
   // Returns the TensorFlow graph for the internally stored LabeledGraph.
   ge::GraphDef Graph();
 
   // Returns a human-readable serialization of the GraphDef proto above.
   string GraphAsString();
 
+  // Writes the GraphDef returned by Graph() to 'out' in the binary wire format.
+  // The nodes are serialized one at a time, so the GraphDef is never
+  // constructed in memory, and the bytes written are those of
+  // Graph().SerializeToOstream(out). Errors are reported through the state of
+  // 'out'.
+  void WriteGraph(std::ostream* out);
+
+  // Writes the string returned by GraphAsString() to 'out'. The nodes are
+  // printed one at a time, so neither the GraphDef nor its text are
+  // constructed in memory. Errors are reported through the state of 'out'.
+  void WriteGraphText(std::ostream* out);
+
+  // Exports the graph as a sequence of pages, described in
+  // graph_explorer.proto, with at most 'nodes_per_page' nodes on a node page
+  // and at most 'edges_per_page' edges on an edge page, and passes each page
+  // to 'write_page'. The edges are those of Graph(), and a viewer that loads
+  // every page has the same graph. Only one page is in memory at a time, so
+  // the memory used is bounded by the page sizes and the number of distinct
+  // successors of the nodes of one node page. Returns the manifest of the
+  // pages, or of the pages written before 'write_page' failed.
+  // - Crashes unless 'nodes_per_page' and 'edges_per_page' are positive.
+  ge::GraphManifest WritePages(int nodes_per_page, int edges_per_page,
+                               const PageWriter& write_page);
+
  private:
   // Returns the node label as a text string followed by the node identifier
   // from the internal representation of the graph.
-  string NodeName(NodeId node_id, const string& tag, const AST& ast);
-  // Returns the label string for 'node_id' in 'graph'. Returns a cached string
-  // if this label has been computed previously and generates a new label
-  // otherwise.
-  string FindOrAddName(NodeId node_id);
+  static string NodeName(NodeId node_id, const string& tag, const AST& ast);
+  // Computes the names of all nodes of the graph into 'node_names_'.
+  void ComputeNodeNames();
+  // Sets the name and attributes of 'vis_node' to those of 'node_id'.
+  // - Requires that 'node_id' is in the view and that ComputeNodeNames() has
+  //   been called since the last change to the graph.
+  void SetNodeAttributes(NodeId node_id, ge::Node* vis_node);
+  // Appends the nodes of the view that 'neighbors' returns for 'node_id' to
+  // '*nodes', and then sorts '*nodes' and removes duplicates.
+  void AddVirtualNeighbors(const NeighborFn& neighbors, NodeId node_id,
+                           std::vector<NodeId>* nodes);
   // Returns a representation of 'node_id' and its predecessors for
   // visualization.
+  // - Requires that ComputeNodeNames() has been called since the last change
+  //   to the graph.
   ge::Node Node(NodeId node_id);
+  // Writes the edge pages of the node page 'node_page', whose nodes are
+  // 'sources', and adds them to 'manifest'. Returns false if 'write_page'
+  // failed.
+  bool WriteEdgePages(int node_page, const std::vector<NodeId>& sources,
+                      int edges_per_page, const PageWriter& write_page,
+                      ge::GraphManifest* manifest);
 
-  const LabeledGraph& graph_;
+  // A LabeledGraph is exported through a view of all of it.
+  const LabeledGraphView view_;
   // The function used to generate node labels.
   LabelFn node_label_;
-  // The map from LabeledGraph node identifiers to TensorFlow NodeDef names.
-  unordered_map<NodeId, string> node_name_;
+  // The number of threads that compute node names.
+  int num_threads_;
+  // The TensorFlow NodeDef names of the nodes of the view, indexed by node
+  // identifier.
+  std::vector<string> node_names_;
+  // The functions set by SetVirtualEdges(), which are empty by default.
+  NeighborFn virtual_predecessors_;
+  NeighborFn virtual_successors_;
+  std::vector<NodeId> virtual_nodes_;
+  // Used to collect the distinct predecessors of a node.
+  NodeMarker marker_;
+  std::vector<NodeId> in_nodes_;
 };  // class GraphExporter
 
 }  // namespace viz
@@ -0,0 +1,259 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_exporter.h"
+
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "graph/type.h"
+#include "graph/value.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace viz {
+namespace {
+
+const char kFileTag[] = "File";
+const char kUsesTag[] = "Uses";
+
+TaggedAST MakeFileLabel(const string& name) {
+  TaggedAST label;
+  label.set_tag(kFileTag);
+  *label.mutable_ast() = ast::value::MakeString(name);
+  return label;
+}
+
+// Initializes a graph with three files, in which file 0 uses files 1 and 2 and
+// file 1 uses file 2.
+void InitializeGraph(LabeledGraph* graph) {
+  ast::type::Types node_types;
+  node_types.emplace(kFileTag, ast::type::MakeString(kFileTag, false));
+  ast::type::Types edge_types;
+  edge_types.emplace(kUsesTag, ast::type::MakeNull(kUsesTag));
+  ASSERT_TRUE(graph
+                  ->Initialize(node_types, {kFileTag}, edge_types, {kUsesTag},
+                               ast::type::MakeString("Graph", false))
+                  .ok());
+  TaggedAST uses;
+  uses.set_tag(kUsesTag);
+  for (int i = 0; i < 3; ++i) {
+    graph->FindOrAddNode(MakeFileLabel("f" + std::to_string(i)));
+  }
+  graph->FindOrAddEdge(0, 1, uses);
+  graph->FindOrAddEdge(0, 2, uses);
+  graph->FindOrAddEdge(1, 2, uses);
+}
+
+// The streamed binary graph parses to the GraphDef returned by Graph().
+TEST(GraphExporterTest, WriteGraphMatchesGraph) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  GraphExporter exporter(graph);
+  ge::GraphDef expected = exporter.Graph();
+  std::ostringstream out;
+  exporter.WriteGraph(&out);
+  ge::GraphDef written;
+  ASSERT_TRUE(written.ParseFromString(out.str()));
+  ASSERT_EQ(expected.node_size(), written.node_size());
+  for (int i = 0; i < expected.node_size(); ++i) {
+    const ge::Node& expected_node = expected.node(i);
+    const ge::Node& written_node = written.node(i);
+    EXPECT_EQ(expected_node.name(), written_node.name());
+    EXPECT_EQ(expected_node.node_attr().at("label"),
+              written_node.node_attr().at("label"));
+    EXPECT_EQ(expected_node.node_attr_size(), written_node.node_attr_size());
+    ASSERT_EQ(expected_node.edge_size(), written_node.edge_size());
+    for (int j = 0; j < expected_node.edge_size(); ++j) {
+      EXPECT_EQ(expected_node.edge(j).input(), written_node.edge(j).input());
+    }
+  }
+  EXPECT_EQ(2, written.node(2).edge_size());
+}
+
+// The streamed text is the text of the GraphDef returned by Graph().
+TEST(GraphExporterTest, WriteGraphTextMatchesGraphAsString) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  GraphExporter exporter(graph);
+  std::ostringstream out;
+  exporter.WriteGraphText(&out);
+  EXPECT_EQ(exporter.GraphAsString(), out.str());
+  EXPECT_NE("", out.str());
+}
+
+// Every edge refers to the name of its source, and names do not depend on the
+// number of threads that compute them.
+TEST(GraphExporterTest, EdgesUseNodeNames) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  GraphExporter exporter(graph);
+  ge::GraphDef expected = exporter.Graph();
+  ASSERT_EQ(3, expected.node_size());
+  EXPECT_EQ("File/f0/0", expected.node(0).name());
+  EXPECT_EQ(0, expected.node(0).edge_size());
+  ASSERT_EQ(2, expected.node(2).edge_size());
+  EXPECT_EQ(expected.node(0).name(), expected.node(2).edge(0).input());
+  EXPECT_EQ(expected.node(1).name(), expected.node(2).edge(1).input());
+  for (int num_threads : {2, 5}) {
+    GraphExporter parallel_exporter(graph);
+    parallel_exporter.SetNumThreads(num_threads);
+    ge::GraphDef vis_graph = parallel_exporter.Graph();
+    ASSERT_EQ(expected.node_size(), vis_graph.node_size());
+    for (int i = 0; i < expected.node_size(); ++i) {
+      EXPECT_EQ(expected.node(i).name(), vis_graph.node(i).name());
+      EXPECT_EQ(expected.node(i).edge_size(), vis_graph.node(i).edge_size());
+    }
+  }
+}
+
+// Virtual edges are exported with the edges of the graph. An edge that is
+// also in the graph and an edge to a hidden node are skipped.
+TEST(GraphExporterTest, ExportsVirtualEdges) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  LabeledGraphView view(graph);
+  view.HideNode(0);
+  GraphExporter exporter(view);
+  // The virtual edges are (0, 2), (1, 2) and (2, 1).
+  exporter.SetVirtualEdges(
+      [](NodeId node_id, std::vector<NodeId>* nodes) {
+        if (node_id == 1) {
+          nodes->push_back(2);
+        } else if (node_id == 2) {
+          nodes->insert(nodes->end(), {1, 0});
+        }
+      },
+      [](NodeId node_id, std::vector<NodeId>* nodes) {
+        if (node_id == 0) {
+          nodes->push_back(2);
+        } else if (node_id == 1) {
+          nodes->push_back(2);
+        } else if (node_id == 2) {
+          nodes->push_back(1);
+        }
+      });
+  ge::GraphDef vis_graph = exporter.Graph();
+  ASSERT_EQ(2, vis_graph.node_size());
+  ASSERT_EQ(1, vis_graph.node(0).edge_size());
+  EXPECT_EQ("File/f2/2", vis_graph.node(0).edge(0).input());
+  ASSERT_EQ(1, vis_graph.node(1).edge_size());
+  EXPECT_EQ("File/f1/1", vis_graph.node(1).edge(0).input());
+  int num_edges = 0;
+  ge::GraphManifest manifest = exporter.WritePages(
+      1, 1, [&num_edges](int, const ge::GraphDef& page) {
+        for (const ge::Node& node : page.node()) {
+          num_edges += node.edge_size();
+        }
+        return true;
+      });
+  EXPECT_EQ(2, manifest.num_edges());
+  EXPECT_EQ(2, num_edges);
+}
+
+// Merging the pages by node name gives the nodes and edges of Graph(), and no
+// page exceeds its size.
+TEST(GraphExporterTest, PagesMergeToGraph) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  GraphExporter exporter(graph);
+  ge::GraphDef expected = exporter.Graph();
+  std::vector<ge::GraphDef> pages;
+  ge::GraphManifest manifest = exporter.WritePages(
+      2, 1, [&pages](int index, const ge::GraphDef& page) {
+        EXPECT_EQ(static_cast<int>(pages.size()), index);
+        pages.push_back(page);
+        return true;
+      });
+  EXPECT_EQ(3, manifest.num_nodes());
+  EXPECT_EQ(3, manifest.num_edges());
+  // Two node pages and one edge page for each edge from the first node page.
+  ASSERT_EQ(5, manifest.page_size());
+  ASSERT_EQ(5, static_cast<int>(pages.size()));
+  EXPECT_EQ(ge::PageInfo::NODES, manifest.page(1).kind());
+  EXPECT_EQ(2, manifest.page(1).first_node_id());
+  EXPECT_EQ(1, manifest.page(1).num_nodes());
+  std::map<string, std::vector<string>> inputs;
+  int num_nodes = 0;
+  for (int i = 0; i < manifest.page_size(); ++i) {
+    const ge::PageInfo& info = manifest.page(i);
+    ASSERT_EQ(info.num_nodes(), pages[i].node_size());
+    if (info.kind() == ge::PageInfo::NODES) {
+      EXPECT_LE(info.num_nodes(), 2);
+      num_nodes += info.num_nodes();
+      for (const ge::Node& node : pages[i].node()) {
+        EXPECT_EQ(0, node.edge_size());
+        EXPECT_EQ(1, node.node_attr().count("label"));
+      }
+      continue;
+    }
+    EXPECT_EQ(0, info.node_page());
+    EXPECT_EQ(1, info.num_edges());
+    for (const ge::Node& node : pages[i].node()) {
+      for (const auto& edge : node.edge()) {
+        inputs[node.name()].push_back(edge.input());
+      }
+    }
+  }
+  EXPECT_EQ(expected.node_size(), num_nodes);
+  for (const ge::Node& node : expected.node()) {
+    std::vector<string> expected_inputs;
+    for (const auto& edge : node.edge()) {
+      expected_inputs.push_back(edge.input());
+    }
+    EXPECT_EQ(expected_inputs, inputs[node.name()]);
+  }
+}
+
+// The export stops at the first page that is not written, and the manifest
+// only describes the pages before it.
+TEST(GraphExporterTest, StopsAtFailedPage) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  GraphExporter exporter(graph);
+  int num_calls = 0;
+  ge::GraphManifest manifest = exporter.WritePages(
+      1, 1, [&num_calls](int index, const ge::GraphDef& page) {
+        ++num_calls;
+        return index < 4;
+      });
+  EXPECT_EQ(5, num_calls);
+  ASSERT_EQ(4, manifest.page_size());
+  EXPECT_EQ(ge::PageInfo::EDGES, manifest.page(3).kind());
+  EXPECT_EQ(1, manifest.num_edges());
+}
+
+TEST(GraphExporterDeathTest, RequiresPositivePageSizes) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  GraphExporter exporter(graph);
+  auto write_page = [](int index, const ge::GraphDef& page) { return true; };
+  EXPECT_DEATH({ exporter.WritePages(0, 1, write_page); },
+               "The size of a page must be positive.");
+  EXPECT_DEATH({ exporter.WritePages(1, 0, write_page); },
+               "The size of a page must be positive.");
+}
+
+TEST(GraphExporterDeathTest, RequiresPositiveNumberOfThreads) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  GraphExporter exporter(graph);
+  EXPECT_DEATH({ exporter.SetNumThreads(0); },
+               "The number of threads must be positive.");
+}
+
+}  // namespace
+}  // namespace viz
+}  // namespace morphie
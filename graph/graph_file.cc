@@ -0,0 +1,552 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A graph file consists of the sections below, in order. Counts and label
+// identifiers are 32-bit unsigned integers, except for the number of labels,
+// and every array begins at an offset that is a multiple of 8 bytes, so arrays
+// can be read in place from a mapped file.
+//  - The magic string "MORPHIEG", the format version and a byte order mark.
+//  - The node types and then the edge types. Each group consists of a count
+//    followed by, for each type, a byte that is 1 if the type is unique and a
+//    TaggedAST whose tag is the tag of the type and whose AST is the type.
+//  - The graph type and the graph label.
+//  - A 64-bit count of labels followed by the labels.
+//  - The number of nodes n and the number of edges m.
+//  - The label ids of the n nodes.
+//  - The sources, then the targets and then the label ids of the m edges, in
+//    the order in which LabeledGraph::EdgeSetBegin() enumerates them. This is
+//    the order in which the edges were added, so adding the edges in this
+//    order also preserves the order of the edges entering and leaving a node.
+// The file may be followed by segments appended by AppendGraphFile, each of
+// which adds nodes and edges to the graph in the file before it.
+//  - The magic string "MORPHIES" and the number of nodes and edges of the
+//    graph that the segment extends.
+//  - A 64-bit count of labels followed by the labels used by the new nodes and
+//    edges, and the arrays of the new nodes and edges as above, in which
+//    sources and targets may be nodes of the graph that the segment extends.
+// Every protocol buffer is stored as a 64-bit size followed by the serialized
+// message.
+#include "graph/graph_file.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "graph/file_format.h"
+#include "graph/type_checker.h"
+#include "ast.pb.h"
+#include "util/span.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+
+namespace type = ast::type;
+
+namespace {
+
+const char kMagic[file_format::kMagicSize] = {'M', 'O', 'R', 'P',
+                                              'H', 'I', 'E', 'G'};
+const char kSegmentMagic[file_format::kMagicSize] = {'M', 'O', 'R', 'P',
+                                                     'H', 'I', 'E', 'S'};
+const uint32_t kVersion = 1;
+
+const char kByteOrderErr[] =
+    "The graph file was written with a different byte order: ";
+const char kCloseFileErr[] = "Error closing file: ";
+const char kFileSizeErr[] =
+    "The size of the file is not the size for which the segment was made: ";
+const char kDuplicateNodeErr[] =
+    "The graph file has two nodes with the same unique label: ";
+const char kMalformedErr[] = "Malformed graph file: ";
+const char kNotGraphFileErr[] = "Not a graph file: ";
+const char kOpenFileErr[] = "Error opening file: ";
+const char kRemovedNodesErr[] =
+    "A graph with removed nodes must be compacted before it is written.";
+const char kSegmentBaseErr[] =
+    "The graph does not extend a graph with the given number of nodes and "
+    "edges.";
+const char kUntypedLabelErr[] =
+    "The graph file has a label that is not typed: ";
+const char kVersionErr[] = "Unsupported graph file version: ";
+const char kWriteFileErr[] = "Error writing to file: ";
+
+// Writes the types in 'types' as a count followed by, for each type, a byte
+// that is 1 if its tag is in 'unique' and the type as a TaggedAST.
+void WriteTypes(const type::Types& types, const std::set<string>& unique,
+                file_format::FileWriter* writer) {
+  writer->WriteValue<uint32_t>(types.size());
+  TaggedAST tagged_type;
+  for (const auto& tag_and_type : types) {
+    writer->WriteValue<uint8_t>(unique.count(tag_and_type.first) > 0 ? 1 : 0);
+    tagged_type.set_tag(tag_and_type.first);
+    *tagged_type.mutable_ast() = tag_and_type.second;
+    writer->WriteMessage(tagged_type);
+  }
+}
+
+// Reads types written by WriteTypes into '*types' and their unique tags into
+// '*unique'. Returns false if they are malformed.
+bool ReadTypes(file_format::FileReader* reader, type::Types* types,
+               std::set<string>* unique) {
+  uint32_t num_types;
+  if (!reader->ReadValue(&num_types)) {
+    return false;
+  }
+  TaggedAST tagged_type;
+  for (uint32_t i = 0; i < num_types; ++i) {
+    uint8_t is_unique;
+    if (!reader->ReadValue(&is_unique) || !reader->ReadMessage(&tagged_type)) {
+      return false;
+    }
+    if (is_unique != 0) {
+      unique->insert(tagged_type.tag());
+    }
+    (*types)[tagged_type.tag()].Swap(tagged_type.mutable_ast());
+  }
+  return true;
+}
+
+// The labels of a graph file and the arrays that refer to them. The labels are
+// the labels of the nodes and edges of a graph in the order in which nodes and
+// then edges first use them, which is the order in which reading the file
+// interns them, so a graph that is read and written again yields the same file.
+// Labels that are no longer used by the graph are not included.
+struct GraphArrays {
+  std::vector<LabelId> labels;
+  std::vector<LabelId> node_labels;
+  std::vector<uint32_t> sources;
+  std::vector<uint32_t> targets;
+  std::vector<LabelId> edge_labels;
+};
+
+// Returns the position of the label with id 'label_id' of a graph in
+// 'arrays->labels', adding it if necessary. The entry of 'file_ids' at
+// position 'label_id' is the position of the label, or the number of labels in
+// the graph if the label has not been added.
+LabelId AddLabel(LabelId label_id, std::vector<LabelId>* file_ids,
+                 GraphArrays* arrays) {
+  LabelId* file_id = &(*file_ids)[label_id];
+  if (*file_id == file_ids->size()) {
+    *file_id = static_cast<LabelId>(arrays->labels.size());
+    arrays->labels.push_back(label_id);
+  }
+  return *file_id;
+}
+
+// Behaves like the function above for a segment, which uses few of the labels
+// of the graph, so the positions of its labels are kept in a map.
+LabelId AddLabel(LabelId label_id,
+                 std::unordered_map<LabelId, LabelId>* file_ids,
+                 GraphArrays* arrays) {
+  auto inserted = file_ids->emplace(
+      label_id, static_cast<LabelId>(arrays->labels.size()));
+  if (inserted.second) {
+    arrays->labels.push_back(label_id);
+  }
+  return inserted.first->second;
+}
+
+// Adds the nodes of 'graph' with ids at least 'first_node' and the
+// 'num_edges' edges that EdgeSetBegin() enumerates from 'first_edge' on to
+// 'arrays', with the positions of their labels in 'file_ids'.
+template <typename FileIds>
+void GetArrays(const LabeledGraph& graph, NodeId first_node,
+               EdgeIterator first_edge, int num_edges, FileIds* file_ids,
+               GraphArrays* arrays) {
+  const NodeId num_nodes = graph.NumNodes();
+  arrays->node_labels.reserve(num_nodes - first_node);
+  for (NodeId node_id = first_node; node_id < num_nodes; ++node_id) {
+    arrays->node_labels.push_back(
+        AddLabel(graph.GetNodeLabelId(node_id), file_ids, arrays));
+  }
+  arrays->sources.reserve(num_edges);
+  arrays->targets.reserve(num_edges);
+  arrays->edge_labels.reserve(num_edges);
+  for (auto edge_it = first_edge; edge_it != graph.EdgeSetEnd(); ++edge_it) {
+    arrays->sources.push_back(static_cast<uint32_t>(graph.Source(*edge_it)));
+    arrays->targets.push_back(static_cast<uint32_t>(graph.Target(*edge_it)));
+    arrays->edge_labels.push_back(
+        AddLabel(graph.GetEdgeLabelId(*edge_it), file_ids, arrays));
+  }
+}
+
+// Writes the labels in 'arrays' followed by the arrays.
+void WriteArrays(const LabeledGraph& graph, const GraphArrays& arrays,
+                 file_format::FileWriter* writer) {
+  writer->WriteValue<uint64_t>(arrays.labels.size());
+  for (LabelId label_id : arrays.labels) {
+    writer->WriteMessage(graph.GetLabel(label_id));
+  }
+  writer->WriteValue<uint32_t>(arrays.node_labels.size());
+  writer->WriteValue<uint32_t>(arrays.targets.size());
+  writer->WriteArray(arrays.node_labels);
+  writer->WriteArray(arrays.sources);
+  writer->WriteArray(arrays.targets);
+  writer->WriteArray(arrays.edge_labels);
+}
+
+util::Status MalformedFile(const string& filename) {
+  return util::Status(Code::INVALID_ARGUMENT,
+                      util::StrCat(kMalformedErr, filename));
+}
+
+// Returns true if the arrays describe edges between 'num_nodes' nodes and
+// refer to labels with ids less than 'num_labels'.
+bool AreValidArrays(size_t num_labels, size_t num_nodes,
+                    util::Span<LabelId> node_labels,
+                    util::Span<uint32_t> sources, util::Span<uint32_t> targets,
+                    util::Span<LabelId> edge_labels) {
+  for (LabelId label_id : node_labels) {
+    if (label_id >= num_labels) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < edge_labels.size(); ++i) {
+    if (sources[i] >= num_nodes || targets[i] >= num_nodes ||
+        edge_labels[i] >= num_labels) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The labels and arrays of a graph or of a segment, as read from a file. The
+// arrays are not copied out of the file.
+struct FileArrays {
+  std::vector<TaggedAST> labels;
+  uint32_t num_nodes;
+  uint32_t num_edges;
+  util::Span<LabelId> node_labels;
+  util::Span<uint32_t> sources;
+  util::Span<uint32_t> targets;
+  util::Span<LabelId> edge_labels;
+};
+
+// Reads the labels and arrays of a graph or of a segment that extends a graph
+// with 'num_base_nodes' nodes. Returns false if they are malformed.
+bool ReadArrays(uint32_t num_base_nodes, file_format::FileReader* reader,
+                FileArrays* arrays) {
+  uint64_t num_labels;
+  if (!reader->ReadValue(&num_labels) ||
+      num_labels > std::numeric_limits<LabelId>::max()) {
+    return false;
+  }
+  for (uint64_t i = 0; i < num_labels; ++i) {
+    arrays->labels.emplace_back();
+    if (!reader->ReadMessage(&arrays->labels.back())) {
+      return false;
+    }
+  }
+  const uint32_t kMaxSize =
+      static_cast<uint32_t>(std::numeric_limits<int>::max());
+  return reader->ReadValue(&arrays->num_nodes) &&
+         reader->ReadValue(&arrays->num_edges) &&
+         arrays->num_nodes <= kMaxSize - num_base_nodes &&
+         arrays->num_edges <= kMaxSize &&
+         reader->ReadArray(arrays->num_nodes, &arrays->node_labels) &&
+         reader->ReadArray(arrays->num_edges, &arrays->sources) &&
+         reader->ReadArray(arrays->num_edges, &arrays->targets) &&
+         reader->ReadArray(arrays->num_edges, &arrays->edge_labels) &&
+         AreValidArrays(arrays->labels.size(),
+                        num_base_nodes + arrays->num_nodes,
+                        arrays->node_labels, arrays->sources, arrays->targets,
+                        arrays->edge_labels);
+}
+
+// Returns true if every label that is used by a node (or an edge) is of a node
+// (or an edge) type. Otherwise, returns false and sets '*err' to the reason.
+bool AreTypedLabels(const type::Types& node_types,
+                    const type::Types& edge_types,
+                    const std::vector<TaggedAST>& labels,
+                    util::Span<LabelId> node_labels,
+                    util::Span<LabelId> edge_labels, string* err) {
+  std::vector<bool> is_node_label(labels.size(), false);
+  std::vector<bool> is_edge_label(labels.size(), false);
+  for (LabelId label_id : node_labels) {
+    is_node_label[label_id] = true;
+  }
+  for (LabelId label_id : edge_labels) {
+    is_edge_label[label_id] = true;
+  }
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if ((is_node_label[i] && !type::IsTyped(node_types, labels[i], err)) ||
+        (is_edge_label[i] && !type::IsTyped(edge_types, labels[i], err))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if no two nodes have the same label with a tag in 'unique'.
+bool HasDistinctUniqueNodes(const std::set<string>& unique,
+                            const std::vector<TaggedAST>& labels,
+                            util::Span<LabelId> node_labels) {
+  std::vector<bool> is_used(labels.size(), false);
+  for (LabelId label_id : node_labels) {
+    if (unique.count(labels[label_id].tag()) == 0) {
+      continue;
+    }
+    if (is_used[label_id]) {
+      return false;
+    }
+    is_used[label_id] = true;
+  }
+  return true;
+}
+
+// Reads the segment that begins at the position of 'reader' and adds its
+// nodes and edges to 'graph' with 'loader'. Returns INVALID_ARGUMENT if the
+// segment is malformed or does not extend 'graph'.
+util::Status ReadSegment(const string& filename,
+                         file_format::FileReader* reader, LabeledGraph* graph,
+                         LabeledGraph::BulkLoader* loader) {
+  const char* magic;
+  uint32_t num_base_nodes;
+  uint32_t num_base_edges;
+  FileArrays arrays;
+  if (!reader->Read(sizeof(kSegmentMagic), &magic) ||
+      std::memcmp(magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 ||
+      !reader->ReadValue(&num_base_nodes) ||
+      !reader->ReadValue(&num_base_edges) ||
+      num_base_nodes != static_cast<uint32_t>(graph->NumNodes()) ||
+      num_base_edges != static_cast<uint32_t>(graph->NumEdges()) ||
+      !ReadArrays(num_base_nodes, reader, &arrays)) {
+    return MalformedFile(filename);
+  }
+  string err;
+  if (!AreTypedLabels(graph->GetNodeTypes(), graph->GetEdgeTypes(),
+                      arrays.labels, arrays.node_labels, arrays.edge_labels,
+                      &err)) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kUntypedLabelErr, err));
+  }
+  loader->Reserve(arrays.num_nodes, arrays.num_edges);
+  // A new node with the unique label of an existing node would be that node.
+  for (uint32_t i = 0; i < arrays.num_nodes; ++i) {
+    if (loader->AddNode(arrays.labels[arrays.node_labels[i]]) !=
+        num_base_nodes + i) {
+      return util::Status(Code::INVALID_ARGUMENT,
+                          util::StrCat(kDuplicateNodeErr, filename));
+    }
+  }
+  for (uint32_t i = 0; i < arrays.num_edges; ++i) {
+    loader->AddEdge(arrays.sources[i], arrays.targets[i],
+                    arrays.labels[arrays.edge_labels[i]]);
+  }
+  return util::Status::OK;
+}
+
+}  // namespace
+
+util::Status WriteGraphFile(const LabeledGraph& graph, const string& filename) {
+  if (graph.HasRemovedNodes()) {
+    return util::Status(Code::INVALID_ARGUMENT, kRemovedNodesErr);
+  }
+  std::unique_ptr<char[]> buffer(new char[file_format::kWriteBufferSize]);
+  std::ofstream out_file;
+  // The buffer must be installed before the file is opened to take effect.
+  out_file.rdbuf()->pubsetbuf(buffer.get(), file_format::kWriteBufferSize);
+  out_file.open(filename, std::ofstream::out | std::ofstream::binary);
+  if (!out_file) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  file_format::FileWriter writer(&out_file, 0);
+  writer.WriteHeader(kMagic, kVersion);
+  WriteTypes(graph.GetNodeTypes(), graph.GetUniqueNodeTags(), &writer);
+  WriteTypes(graph.GetEdgeTypes(), graph.GetUniqueEdgeTags(), &writer);
+  writer.WriteMessage(graph.GetGraphType());
+  writer.WriteMessage(graph.GetGraphLabel());
+  GraphArrays arrays;
+  std::vector<LabelId> file_ids(graph.NumDistinctLabels(),
+                                graph.NumDistinctLabels());
+  GetArrays(graph, 0, graph.EdgeSetBegin(), graph.NumEdges(), &file_ids,
+            &arrays);
+  WriteArrays(graph, arrays, &writer);
+  out_file.flush();
+  if (!out_file) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kWriteFileErr, filename));
+  }
+  out_file.close();
+  if (!out_file) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kCloseFileErr, filename));
+  }
+  return util::Status::OK;
+}
+
+util::Status ReadGraphFile(const string& filename, LabeledGraph* graph) {
+  file_format::MappedFile file;
+  if (!file.Map(filename)) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  file_format::FileReader reader(file.data(), file.size());
+  uint32_t version;
+  uint32_t byte_order_mark;
+  if (!reader.ReadHeader(kMagic, &version, &byte_order_mark)) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kNotGraphFileErr, filename));
+  }
+  if (byte_order_mark != file_format::kByteOrderMark) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kByteOrderErr, filename));
+  }
+  if (version != kVersion) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kVersionErr, filename));
+  }
+  type::Types node_types;
+  std::set<string> unique_nodes;
+  type::Types edge_types;
+  std::set<string> unique_edges;
+  AST graph_type;
+  AST graph_label;
+  if (!ReadTypes(&reader, &node_types, &unique_nodes) ||
+      !ReadTypes(&reader, &edge_types, &unique_edges) ||
+      !reader.ReadMessage(&graph_type) || !reader.ReadMessage(&graph_label)) {
+    return MalformedFile(filename);
+  }
+  FileArrays arrays;
+  if (!ReadArrays(0, &reader, &arrays)) {
+    return MalformedFile(filename);
+  }
+  util::Status status = graph->Initialize(node_types, unique_nodes, edge_types,
+                                          unique_edges, graph_type);
+  if (!status.ok()) {
+    return status;
+  }
+  string err;
+  if (!AreTypedLabels(node_types, edge_types, arrays.labels,
+                      arrays.node_labels, arrays.edge_labels, &err)) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kUntypedLabelErr, err));
+  }
+  if (!HasDistinctUniqueNodes(unique_nodes, arrays.labels,
+                              arrays.node_labels)) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kDuplicateNodeErr, filename));
+  }
+  if (graph_label.ByteSizeLong() > 0) {
+    if (!type::IsTyped(graph_type, graph_label, &err)) {
+      return util::Status(Code::INVALID_ARGUMENT,
+                          util::StrCat(kUntypedLabelErr, err));
+    }
+    graph->SetGraphLabel(graph_label);
+  }
+  LabeledGraph::BulkLoader loader(graph);
+  loader.Reserve(arrays.num_nodes, arrays.num_edges);
+  for (uint32_t node_id = 0; node_id < arrays.num_nodes; ++node_id) {
+    loader.AddNode(arrays.labels[arrays.node_labels[node_id]]);
+  }
+  for (uint32_t i = 0; i < arrays.num_edges; ++i) {
+    loader.AddEdge(arrays.sources[i], arrays.targets[i],
+                   arrays.labels[arrays.edge_labels[i]]);
+  }
+  while (!reader.AtEnd()) {
+    status = ReadSegment(filename, &reader, graph, &loader);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  loader.Finish();
+  return util::Status::OK;
+}
+
+util::Status MakeGraphSegment(const LabeledGraph& graph, int num_nodes,
+                              int num_edges, size_t file_size,
+                              string* segment) {
+  if (graph.HasRemovedNodes()) {
+    return util::Status(Code::INVALID_ARGUMENT, kRemovedNodesErr);
+  }
+  if (num_nodes < 0 || num_nodes > graph.NumNodes() || num_edges < 0 ||
+      num_edges > graph.NumEdges()) {
+    return util::Status(Code::INVALID_ARGUMENT, kSegmentBaseErr);
+  }
+  // The new edges are the last ones that EdgeSetBegin() enumerates, so they
+  // are found from the end of the edge set without visiting the other edges.
+  const int num_new_edges = graph.NumEdges() - num_edges;
+  EdgeIterator first_edge = graph.EdgeSetEnd();
+  for (int i = 0; i < num_new_edges; ++i) {
+    --first_edge;
+  }
+  GraphArrays arrays;
+  std::unordered_map<LabelId, LabelId> file_ids;
+  GetArrays(graph, num_nodes, first_edge, num_new_edges, &file_ids, &arrays);
+  std::ostringstream out;
+  file_format::FileWriter writer(&out, file_size);
+  writer.Write(kSegmentMagic, sizeof(kSegmentMagic));
+  writer.WriteValue<uint32_t>(num_nodes);
+  writer.WriteValue<uint32_t>(num_edges);
+  WriteArrays(graph, arrays, &writer);
+  *segment = out.str();
+  return util::Status::OK;
+}
+
+// A failed write leaves a partial segment at the end of the file, which is
+// truncated so that the file contains the graph it contained before.
+util::Status AppendGraphSegment(const string& segment, size_t file_size,
+                                const string& filename) {
+  struct stat file_stat;
+  if (stat(filename.c_str(), &file_stat) != 0) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  if (static_cast<size_t>(file_stat.st_size) != file_size) {
+    return util::Status(Code::INVALID_ARGUMENT,
+                        util::StrCat(kFileSizeErr, filename));
+  }
+  std::ofstream out_file(filename, std::ofstream::out | std::ofstream::binary |
+                                       std::ofstream::app);
+  if (!out_file) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  out_file.write(segment.data(), segment.size());
+  out_file.flush();
+  if (!out_file) {
+    out_file.close();
+    truncate(filename.c_str(), file_size);
+    return util::Status(Code::EXTERNAL, util::StrCat(kWriteFileErr, filename));
+  }
+  out_file.close();
+  if (!out_file) {
+    truncate(filename.c_str(), file_size);
+    return util::Status(Code::EXTERNAL, util::StrCat(kCloseFileErr, filename));
+  }
+  return util::Status::OK;
+}
+
+util::Status AppendGraphFile(const LabeledGraph& graph, int num_nodes,
+                             int num_edges, const string& filename) {
+  struct stat file_stat;
+  if (stat(filename.c_str(), &file_stat) != 0) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  const size_t file_size = static_cast<size_t>(file_stat.st_size);
+  string segment;
+  util::Status status =
+      MakeGraphSegment(graph, num_nodes, num_edges, file_size, &segment);
+  if (!status.ok()) {
+    return status;
+  }
+  return AppendGraphSegment(segment, file_size, filename);
+}
+
+}  // namespace morphie
@@ -0,0 +1,116 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A graph file stores a LabeledGraph in a compact binary format, so that a
+// graph constructed from a large log can be analyzed many times without
+// parsing the log again. The file contains the label types of the graph, a
+// table with every distinct label, and flat arrays with the labels of the nodes
+// and the sources, targets and labels of the edges, in which labels are
+// referred to by their position in the table. Reading a file maps it into
+// memory, parses every distinct label once, and loads the nodes and edges in
+// bulk directly from the mapped arrays.
+//
+// Example.
+//   LabeledGraph graph;
+//   // Code that constructs a graph.
+//   util::Status status = WriteGraphFile(graph, "/tmp/events.graph");
+//   ...
+//   LabeledGraph loaded;
+//   status = ReadGraphFile("/tmp/events.graph", &loaded);
+//
+// A graph that is read from a file has the same types, graph label, node
+// identifiers and node labels as the graph that was written, and its edges have
+// the same sources, targets and labels and are enumerated in the same order by
+// every edge iterator. The format uses the byte order of the machine that wrote
+// the file, and files written on a machine with a different byte order are
+// rejected.
+//
+// Nodes and edges added to a graph after it was written or read can be
+// appended to its file as a segment, without writing the graph again. Reading
+// the file yields the graph with the appended nodes and edges.
+//   LabeledGraph graph;
+//   util::Status status = ReadGraphFile("/tmp/events.graph", &graph);
+//   const int num_nodes = graph.NumNodes();
+//   const int num_edges = graph.NumEdges();
+//   // Code that adds nodes and edges to 'graph'.
+//   status = AppendGraphFile(graph, num_nodes, num_edges, "/tmp/events.graph");
+#ifndef LOGLE_GRAPH_FILE_H_
+#define LOGLE_GRAPH_FILE_H_
+
+#include "base/string.h"
+#include "graph/labeled_graph.h"
+#include "util/status.h"
+
+namespace morphie {
+
+// Writes 'graph' to the file 'filename'. Returns
+//  - INVALID_ARGUMENT if 'graph' has removed nodes that were not compacted.
+//  - EXTERNAL if the file could not be opened, written or closed.
+//  - OK otherwise.
+// - Requires that 'graph' is initialized.
+util::Status WriteGraphFile(const LabeledGraph& graph, const string& filename);
+
+// Initializes 'graph' with the types in the file 'filename' and adds the nodes
+// and edges in the file to it. Returns
+//  - EXTERNAL if the file could not be opened or mapped into memory.
+//  - INVALID_ARGUMENT if the file is not a graph file, if it was written with a
+//    different byte order, or if it is malformed, for example because a label
+//    does not have the type declared for its tag. If an error is returned after
+//    'graph' was initialized, the contents of 'graph' are unspecified.
+//  - OK otherwise.
+// Every distinct label is type checked before nodes are added to the graph, so
+// a malformed label results in an error and not in a crash.
+// - Requires that 'graph' is not initialized.
+util::Status ReadGraphFile(const string& filename, LabeledGraph* graph);
+
+// Appends the nodes and edges that were added to 'graph' after the file
+// 'filename' was written or last appended to, when the graph had 'num_nodes'
+// nodes and 'num_edges' edges, to the file. The new nodes are the nodes with
+// ids at least 'num_nodes' and the new edges are those that EdgeSetBegin()
+// enumerates after the first 'num_edges' edges. Takes time linear in the
+// number of new nodes and edges. Returns
+//  - INVALID_ARGUMENT if 'graph' has removed nodes that were not compacted, or
+//    if it has fewer than 'num_nodes' nodes or 'num_edges' edges.
+//  - EXTERNAL if the file could not be opened or written, in which case the
+//    file is left as it was.
+//  - OK otherwise.
+// The file is not read, so a file that does not contain the graph with the
+// first 'num_nodes' nodes and 'num_edges' edges of 'graph' is only detected by
+// ReadGraphFile, which rejects the file as malformed.
+// - Requires that 'graph' is initialized and that the labels of its first
+//   'num_nodes' nodes and 'num_edges' edges have not been changed.
+util::Status AppendGraphFile(const LabeledGraph& graph, int num_nodes,
+                             int num_edges, const string& filename);
+
+// The two steps of AppendGraphFile, which allow a segment to be made while the
+// graph is not modified and to be written later, for example on another
+// thread while nodes and edges are added to the graph. MakeGraphSegment sets
+// '*segment' to the segment that AppendGraphFile would append to a file of
+// 'file_size' bytes, and returns INVALID_ARGUMENT under the same conditions.
+// Takes time linear in the number of new nodes and edges.
+util::Status MakeGraphSegment(const LabeledGraph& graph, int num_nodes,
+                              int num_edges, size_t file_size,
+                              string* segment);
+// Appends 'segment', which was made for a file of 'file_size' bytes, to the
+// file 'filename'. Returns
+//  - INVALID_ARGUMENT if the file does not have 'file_size' bytes.
+//  - EXTERNAL if the file could not be opened or written, in which case the
+//    file is left as it was.
+//  - OK otherwise.
+util::Status AppendGraphSegment(const string& segment, size_t file_size,
+                                const string& filename);
+
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_FILE_H_
@@ -0,0 +1,239 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_file.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <vector>
+
+#include "graph/ast.h"
+#include "graph/graph_test_util.h"
+#include "graph/test_graphs.h"
+#include "graph/value.h"
+#include "gtest.h"
+#include "util/test_files.h"
+
+namespace morphie {
+namespace {
+
+using test::ExpectSameGraphs;
+using test::GetTempFile;
+using test::InitializeReadsGraph;
+using test::MakeLabel;
+using test::ReadFile;
+using test::kCountTag;
+using test::kEventTag;
+using test::kFileTag;
+using test::kReadsTag;
+
+TEST(GraphFileTest, RoundTripsEmptyGraph) {
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  string filename = GetTempFile();
+  ASSERT_TRUE(WriteGraphFile(graph, filename).ok());
+  LabeledGraph loaded;
+  ASSERT_TRUE(ReadGraphFile(filename, &loaded).ok());
+  ExpectSameGraphs(graph, loaded);
+  unlink(filename.c_str());
+}
+
+// Nodes and edges are added in an order in which the edges leaving a node are
+// not added consecutively, and several labels are shared.
+TEST(GraphFileTest, RoundTripsGraph) {
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  graph.SetGraphLabel(ast::value::MakeString("machine"));
+  std::vector<NodeId> files;
+  for (int i = 0; i < 10; ++i) {
+    files.push_back(graph.FindOrAddNode(
+        MakeLabel(kFileTag, ast::value::MakeString("f" + std::to_string(i)))));
+  }
+  TaggedAST reads;
+  reads.set_tag(kReadsTag);
+  for (int i = 0; i < 500; ++i) {
+    NodeId event =
+        graph.FindOrAddNode(MakeLabel(kEventTag, ast::value::MakeInt(i % 7)));
+    NodeId file = files[(i * 3) % files.size()];
+    graph.FindOrAddEdge(event, file, reads);
+    graph.FindOrAddEdge(file, event,
+                        MakeLabel(kCountTag, ast::value::MakeInt(i % 5)));
+    graph.FindOrAddEdge(files[i % files.size()], file, reads);
+  }
+  string filename = GetTempFile();
+  ASSERT_TRUE(WriteGraphFile(graph, filename).ok());
+  LabeledGraph loaded;
+  ASSERT_TRUE(ReadGraphFile(filename, &loaded).ok());
+  ExpectSameGraphs(graph, loaded);
+  // The label indexes of the loaded graph are complete.
+  EXPECT_EQ(graph.NumLabeledNodes(
+                MakeLabel(kEventTag, ast::value::MakeInt(3))),
+            loaded.NumLabeledNodes(
+                MakeLabel(kEventTag, ast::value::MakeInt(3))));
+  EXPECT_EQ(graph.NumLabeledEdges(reads), loaded.NumLabeledEdges(reads));
+  // Writing the loaded graph produces the same file.
+  string loaded_filename = GetTempFile();
+  ASSERT_TRUE(WriteGraphFile(loaded, loaded_filename).ok());
+  EXPECT_EQ(ReadFile(filename), ReadFile(loaded_filename));
+  unlink(filename.c_str());
+  unlink(loaded_filename.c_str());
+}
+
+// Adds 'num_events' events that read files, some of which are new.
+void AddEvents(int first_event, int num_events, LabeledGraph* graph) {
+  TaggedAST reads;
+  reads.set_tag(kReadsTag);
+  for (int i = first_event; i < first_event + num_events; ++i) {
+    NodeId event = graph->FindOrAddNode(
+        MakeLabel(kEventTag, ast::value::MakeInt(i % 7)));
+    NodeId file = graph->FindOrAddNode(MakeLabel(
+        kFileTag, ast::value::MakeString("f" + std::to_string(i % 13))));
+    graph->FindOrAddEdge(event, file, reads);
+    graph->FindOrAddEdge(file, event,
+                         MakeLabel(kCountTag, ast::value::MakeInt(i % 5)));
+  }
+}
+
+TEST(GraphFileTest, AppendsSegments) {
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  AddEvents(0, 10, &graph);
+  string filename = GetTempFile();
+  ASSERT_TRUE(WriteGraphFile(graph, filename).ok());
+  // Two segments, the second of which only adds edges between nodes of the
+  // first, and an empty segment.
+  int num_nodes = graph.NumNodes();
+  int num_edges = graph.NumEdges();
+  AddEvents(10, 20, &graph);
+  ASSERT_TRUE(AppendGraphFile(graph, num_nodes, num_edges, filename).ok());
+  num_nodes = graph.NumNodes();
+  num_edges = graph.NumEdges();
+  graph.FindOrAddEdge(num_nodes - 1, 0,
+                      MakeLabel(kCountTag, ast::value::MakeInt(9)));
+  ASSERT_TRUE(AppendGraphFile(graph, num_nodes, num_edges, filename).ok());
+  ASSERT_TRUE(AppendGraphFile(graph, graph.NumNodes(), graph.NumEdges(),
+                              filename)
+                  .ok());
+  LabeledGraph loaded;
+  ASSERT_TRUE(ReadGraphFile(filename, &loaded).ok());
+  ExpectSameGraphs(graph, loaded);
+
+  // A loaded graph is extended in the same way.
+  num_nodes = loaded.NumNodes();
+  num_edges = loaded.NumEdges();
+  AddEvents(30, 5, &graph);
+  AddEvents(30, 5, &loaded);
+  ASSERT_TRUE(AppendGraphFile(loaded, num_nodes, num_edges, filename).ok());
+  LabeledGraph reloaded;
+  ASSERT_TRUE(ReadGraphFile(filename, &reloaded).ok());
+  ExpectSameGraphs(graph, reloaded);
+
+  // A segment that does not extend the graph in the file is malformed.
+  ASSERT_TRUE(AppendGraphFile(graph, 1, 1, filename).ok());
+  LabeledGraph mismatched;
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            ReadGraphFile(filename, &mismatched).code());
+  unlink(filename.c_str());
+}
+
+// A segment made before more nodes and edges are added holds the graph at the
+// time it was made.
+TEST(GraphFileTest, AppendsSegmentsMadeEarlier) {
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  AddEvents(0, 10, &graph);
+  string filename = GetTempFile();
+  ASSERT_TRUE(WriteGraphFile(graph, filename).ok());
+  const size_t file_size = ReadFile(filename).size();
+  LabeledGraph expected;
+  ASSERT_TRUE(ReadGraphFile(filename, &expected).ok());
+  AddEvents(10, 10, &expected);
+  const int num_nodes = graph.NumNodes();
+  const int num_edges = graph.NumEdges();
+  AddEvents(10, 10, &graph);
+  string segment;
+  ASSERT_TRUE(MakeGraphSegment(graph, num_nodes, num_edges, file_size,
+                               &segment)
+                  .ok());
+  AddEvents(20, 10, &graph);
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            AppendGraphSegment(segment, file_size + 1, filename).code());
+  ASSERT_TRUE(AppendGraphSegment(segment, file_size, filename).ok());
+  LabeledGraph loaded;
+  ASSERT_TRUE(ReadGraphFile(filename, &loaded).ok());
+  ExpectSameGraphs(expected, loaded);
+  unlink(filename.c_str());
+}
+
+TEST(GraphFileTest, ReportsErrors) {
+  LabeledGraph graph;
+  InitializeReadsGraph(&graph);
+  EXPECT_EQ(Code::EXTERNAL,
+            WriteGraphFile(graph, "/nonexistent/graph_file_test").code());
+  LabeledGraph missing;
+  EXPECT_EQ(Code::EXTERNAL,
+            ReadGraphFile("/nonexistent/graph_file_test", &missing).code());
+  EXPECT_EQ(Code::EXTERNAL,
+            AppendGraphFile(graph, 0, 0, "/nonexistent/graph_file_test")
+                .code());
+
+  string filename = GetTempFile();
+  LabeledGraph empty;
+  EXPECT_EQ(Code::INVALID_ARGUMENT, ReadGraphFile(filename, &empty).code());
+  {
+    std::ofstream file(filename);
+    file << "digraph logle_graph {\n}";
+  }
+  LabeledGraph not_graph_file;
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            ReadGraphFile(filename, &not_graph_file).code());
+
+  NodeId file =
+      graph.FindOrAddNode(MakeLabel(kFileTag, ast::value::MakeString("f")));
+  NodeId event =
+      graph.FindOrAddNode(MakeLabel(kEventTag, ast::value::MakeInt(1)));
+  graph.FindOrAddEdge(event, file, MakeLabel(kCountTag,
+                                             ast::value::MakeInt(2)));
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            AppendGraphFile(graph, graph.NumNodes() + 1, 0, filename).code());
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            AppendGraphFile(graph, 0, -1, filename).code());
+  // Every proper prefix of a file with a segment, except the graph before the
+  // segment, is malformed.
+  ASSERT_TRUE(WriteGraphFile(graph, filename).ok());
+  const size_t graph_size = ReadFile(filename).size();
+  event = graph.FindOrAddNode(MakeLabel(kEventTag, ast::value::MakeInt(3)));
+  graph.FindOrAddEdge(file, event, MakeLabel(kCountTag,
+                                             ast::value::MakeInt(4)));
+  ASSERT_TRUE(AppendGraphFile(graph, 2, 1, filename).ok());
+  string contents = ReadFile(filename);
+  for (size_t size = 0; size < contents.size(); ++size) {
+    if (size == graph_size) {
+      continue;
+    }
+    {
+      std::ofstream file(filename, std::ofstream::binary);
+      file << contents.substr(0, size);
+    }
+    LabeledGraph truncated;
+    EXPECT_EQ(Code::INVALID_ARGUMENT,
+              ReadGraphFile(filename, &truncated).code())
+        << "Prefix of size " << size;
+  }
+  unlink(filename.c_str());
+}
+
+}  // namespace
+}  // namespace morphie
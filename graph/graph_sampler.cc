@@ -0,0 +1,235 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph_sampler.h"
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <utility>
+
+#include "util/flat_hash_map.h"
+#include "util/logging.h"
+
+namespace morphie {
+namespace graph {
+
+namespace {
+
+const char kNodeErr[] = "The node is not in the graph.";
+const char kProbabilityErr[] = "Burning probabilities must be in [0, 1).";
+const char kSampleSizeErr[] = "The sample size must be non-negative.";
+
+// Returns the nodes of 'graph' in increasing order.
+std::vector<NodeId> GetAllNodes(const LabeledGraph& graph) {
+  std::vector<NodeId> nodes;
+  nodes.reserve(graph.NumNodes());
+  for (NodeId node_id = 0; node_id < static_cast<NodeId>(graph.NumNodeIds());
+       ++node_id) {
+    if (graph.HasNode(node_id)) {
+      nodes.push_back(node_id);
+    }
+  }
+  return nodes;
+}
+
+// Sets fire to at most 'count' of the nodes in '*neighbors' that are not in
+// '*burned', chosen uniformly at random, and appends them to '*sample' and
+// '*fire', stopping when '*sample' has 'num_nodes' nodes. The order of
+// '*neighbors' is changed.
+void Burn(int count, size_t num_nodes, std::vector<NodeId>* neighbors,
+          util::FlatHashSet<NodeId>* burned, std::vector<NodeId>* sample,
+          std::deque<NodeId>* fire, std::mt19937_64* generator) {
+  int num_burned = 0;
+  for (size_t i = 0; i < neighbors->size() && num_burned < count &&
+                     sample->size() < num_nodes;
+       ++i) {
+    std::uniform_int_distribution<size_t> position(i, neighbors->size() - 1);
+    std::swap((*neighbors)[i], (*neighbors)[position(*generator)]);
+    const NodeId node_id = (*neighbors)[i];
+    if (burned->insert(node_id).second) {
+      sample->push_back(node_id);
+      fire->push_back(node_id);
+      ++num_burned;
+    }
+  }
+}
+
+}  // namespace
+
+std::vector<size_t> SampleIndices(size_t num_indices, size_t sample_size,
+                                  std::mt19937_64* generator) {
+  std::vector<size_t> indices;
+  if (sample_size >= num_indices) {
+    indices.reserve(num_indices);
+    for (size_t index = 0; index < num_indices; ++index) {
+      indices.push_back(index);
+    }
+    return indices;
+  }
+  // Floyd's algorithm adds one index for each of the last 'sample_size'
+  // integers j below 'num_indices': a random index up to j, or j itself if the
+  // random index is already in the sample.
+  util::FlatHashSet<size_t> sample;
+  sample.reserve(sample_size);
+  for (size_t j = num_indices - sample_size; j < num_indices; ++j) {
+    std::uniform_int_distribution<size_t> index(0, j);
+    if (!sample.insert(index(*generator)).second) {
+      sample.insert(j);
+    }
+  }
+  indices.assign(sample.begin(), sample.end());
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+std::unique_ptr<Morphism> InducedSubgraph(const LabeledGraph& graph,
+                                          const std::vector<NodeId>& nodes) {
+  std::unique_ptr<Morphism> morphism(new Morphism(&graph));
+  morphism->CopyInputType();
+  if (!morphism->HasOutputGraph()) {
+    return morphism;
+  }
+  // Edges with labels that are not unique are added again by FindOrCopyEdge,
+  // so the out-edges of each node are copied once.
+  std::vector<NodeId> distinct_nodes;
+  distinct_nodes.reserve(nodes.size());
+  for (NodeId node_id : nodes) {
+    CHECK(graph.HasNode(node_id), kNodeErr);
+    if (!morphism->FindNodeImage(node_id).first) {
+      morphism->FindOrCopyNode(node_id);
+      distinct_nodes.push_back(node_id);
+    }
+  }
+  // The nodes of the sample are exactly those with an image, so an out-edge
+  // is copied if its target has an image.
+  for (NodeId src : distinct_nodes) {
+    OutEdgeIterator out_edge_end = graph.OutEdgeEnd(src);
+    for (OutEdgeIterator edge_it = graph.OutEdgeBegin(src);
+         edge_it != out_edge_end; ++edge_it) {
+      if (morphism->FindNodeImage(graph.Target(*edge_it)).first) {
+        morphism->FindOrCopyEdge(*edge_it);
+      }
+    }
+  }
+  return morphism;
+}
+
+std::unique_ptr<Morphism> SampleNodes(const LabeledGraph& graph, int num_nodes,
+                                      uint64_t seed) {
+  CHECK(num_nodes >= 0, kSampleSizeErr);
+  std::mt19937_64 generator(seed);
+  if (!graph.HasRemovedNodes()) {
+    std::vector<size_t> indices =
+        SampleIndices(graph.NumNodeIds(), num_nodes, &generator);
+    return InducedSubgraph(graph,
+                           std::vector<NodeId>(indices.begin(), indices.end()));
+  }
+  const std::vector<NodeId> all_nodes = GetAllNodes(graph);
+  std::vector<NodeId> nodes;
+  for (size_t index : SampleIndices(all_nodes.size(), num_nodes, &generator)) {
+    nodes.push_back(all_nodes[index]);
+  }
+  return InducedSubgraph(graph, nodes);
+}
+
+std::unique_ptr<Morphism> SampleEdges(const LabeledGraph& graph, int num_edges,
+                                      uint64_t seed) {
+  CHECK(num_edges >= 0, kSampleSizeErr);
+  std::unique_ptr<Morphism> morphism(new Morphism(&graph));
+  morphism->CopyInputType();
+  if (!morphism->HasOutputGraph()) {
+    return morphism;
+  }
+  // The i-th edge is out-edge i - first_edges[n] of the last node n with
+  // first_edges[n] <= i.
+  const NodeId num_node_ids = static_cast<NodeId>(graph.NumNodeIds());
+  std::vector<size_t> first_edges(num_node_ids + 1, 0);
+  for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+    size_t out_degree = 0;
+    if (graph.HasNode(node_id)) {
+      out_degree = std::distance(graph.OutEdgeBegin(node_id),
+                                 graph.OutEdgeEnd(node_id));
+    }
+    first_edges[node_id + 1] = first_edges[node_id] + out_degree;
+  }
+  std::mt19937_64 generator(seed);
+  for (size_t index :
+       SampleIndices(first_edges.back(), num_edges, &generator)) {
+    const NodeId src = static_cast<NodeId>(
+        std::upper_bound(first_edges.begin(), first_edges.end(), index) -
+        first_edges.begin() - 1);
+    OutEdgeIterator edge_it = graph.OutEdgeBegin(src);
+    std::advance(edge_it, index - first_edges[src]);
+    morphism->FindOrCopyEdge(*edge_it);
+  }
+  return morphism;
+}
+
+std::unique_ptr<Morphism> SampleForestFire(const LabeledGraph& graph,
+                                           int num_nodes,
+                                           double forward_probability,
+                                           double backward_probability,
+                                           uint64_t seed) {
+  CHECK(num_nodes >= 0, kSampleSizeErr);
+  CHECK(forward_probability >= 0 && forward_probability < 1 &&
+            backward_probability >= 0 && backward_probability < 1,
+        kProbabilityErr);
+  if (num_nodes >= graph.NumNodes()) {
+    return InducedSubgraph(graph, GetAllNodes(graph));
+  }
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<NodeId> random_node(0, graph.NumNodeIds() - 1);
+  // A geometric distribution counts the failures before the first success,
+  // so a success probability of 1 - p gives the mean p / (1 - p).
+  std::geometric_distribution<int> num_forward(1 - forward_probability);
+  std::geometric_distribution<int> num_backward(1 - backward_probability);
+  const size_t sample_size = num_nodes;
+  util::FlatHashSet<NodeId> burned;
+  std::vector<NodeId> sample;
+  std::deque<NodeId> fire;
+  std::vector<NodeId> neighbors;
+  while (sample.size() < sample_size) {
+    if (fire.empty()) {
+      const NodeId node_id = random_node(generator);
+      if (graph.HasNode(node_id) && burned.insert(node_id).second) {
+        sample.push_back(node_id);
+        fire.push_back(node_id);
+      }
+      continue;
+    }
+    const NodeId node_id = fire.front();
+    fire.pop_front();
+    neighbors.clear();
+    OutEdgeIterator out_edge_end = graph.OutEdgeEnd(node_id);
+    for (OutEdgeIterator edge_it = graph.OutEdgeBegin(node_id);
+         edge_it != out_edge_end; ++edge_it) {
+      neighbors.push_back(graph.Target(*edge_it));
+    }
+    Burn(num_forward(generator), sample_size, &neighbors, &burned, &sample,
+         &fire, &generator);
+    neighbors.clear();
+    InEdgeIterator in_edge_end = graph.InEdgeEnd(node_id);
+    for (InEdgeIterator edge_it = graph.InEdgeBegin(node_id);
+         edge_it != in_edge_end; ++edge_it) {
+      neighbors.push_back(graph.Source(*edge_it));
+    }
+    Burn(num_backward(generator), sample_size, &neighbors, &burned, &sample,
+         &fire, &generator);
+  }
+  return InducedSubgraph(graph, sample);
+}
+
+}  // namespace graph
+}  // namespace morphie
@@ -0,0 +1,105 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A sample of a large graph is a small graph on which an analysis, such as a
+// quotient or a summary, can be tried in seconds before it is run on the whole
+// graph, or whose statistics approximate those of the whole graph. This file
+// contains functions that sample a graph. Each returns a morphism whose input
+// is the sampled graph and whose output is the sample, so that a node of the
+// sample can be traced back to the input with Morphism::GetNodePreimage.
+//
+// The samplers take a seed and return the same sample for the same graph and
+// seed. Each takes time proportional to the size of the sample and the degrees
+// of the sampled nodes, except as noted below and for the node map of the
+// morphism, which has an entry for every input node. Nodes and edges are
+// copied with Morphism::FindOrCopyNode and FindOrCopyEdge, so sampled nodes
+// with the same label are one node of the sample, as they are in the output of
+// the transformations in graph_transformer.h.
+//
+// Example.
+//   std::unique_ptr<graph::Morphism> sample =
+//       graph::SampleNodes(graph, 1000, 17 /* seed */);
+//   LabeledGraphView view(sample->Output());
+//   std::unique_ptr<graph::Morphism> quotient =
+//       graph::QuotientMorphism(view, partition, config);
+#ifndef LOGLE_GRAPH_SAMPLER_H_
+#define LOGLE_GRAPH_SAMPLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "labeled_graph.h"
+#include "morphism.h"
+
+namespace morphie {
+namespace graph {
+
+// Returns 'sample_size' distinct integers less than 'num_indices' in
+// increasing order, chosen uniformly at random with Floyd's algorithm, or
+// every integer less than 'num_indices' if 'sample_size' is not less. Takes
+// time O(k log k), where k is the size of the sample.
+std::vector<size_t> SampleIndices(size_t num_indices, size_t sample_size,
+                                  std::mt19937_64* generator);
+
+// Returns a morphism to the subgraph of 'graph' induced by 'nodes', which
+// consists of the nodes and the edges of 'graph' between them. Duplicates in
+// 'nodes' are ignored and the nodes are copied in the order in which they
+// first occur.
+// - Crashes unless HasNode is true of every node in 'nodes'.
+std::unique_ptr<Morphism> InducedSubgraph(const LabeledGraph& graph,
+                                          const std::vector<NodeId>& nodes);
+
+// Returns the subgraph induced by 'num_nodes' nodes chosen uniformly at random
+// without replacement, or by all nodes if the graph has at most 'num_nodes'
+// nodes. If nodes have been removed from the graph, finding the nodes that
+// remain takes time linear in NumNodeIds().
+// - Crashes if 'num_nodes' is negative.
+std::unique_ptr<Morphism> SampleNodes(const LabeledGraph& graph, int num_nodes,
+                                      uint64_t seed);
+
+// Returns the graph of 'num_edges' edges chosen uniformly at random without
+// replacement, or of all edges if the graph has at most 'num_edges' edges, and
+// of their sources and targets. The edges of a graph are in a list without
+// random access, so an edge is found through a table of the cumulative
+// out-degrees of the nodes, which takes time linear in NumNodeIds() to build.
+// - Crashes if 'num_edges' is negative.
+std::unique_ptr<Morphism> SampleEdges(const LabeledGraph& graph, int num_edges,
+                                      uint64_t seed);
+
+// Returns the subgraph induced by 'num_nodes' nodes chosen by forest-fire
+// sampling (Leskovec and Faloutsos, "Sampling from Large Graphs", KDD 2006),
+// or by all nodes if the graph has at most 'num_nodes' nodes. A fire starts at
+// a node chosen uniformly at random. Each burning node sets fire to x of its
+// unburned successors and y of its unburned predecessors, chosen uniformly at
+// random, where x and y are drawn from geometric distributions with means
+// p/(1 - p) and q/(1 - q), for p = 'forward_probability' and q =
+// 'backward_probability'. A new fire starts when a fire dies out. Unlike a
+// uniform sample, the sample tends to keep the clusters and the skewed degree
+// distribution of the graph. Starting a fire redraws removed nodes and burned
+// nodes, so it is slow if most node ids are of removed nodes or most nodes
+// are sampled.
+// - Crashes if 'num_nodes' is negative or if a probability is not in [0, 1).
+std::unique_ptr<Morphism> SampleForestFire(const LabeledGraph& graph,
+                                           int num_nodes,
+                                           double forward_probability,
+                                           double backward_probability,
+                                           uint64_t seed);
+
+}  // namespace graph
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_SAMPLER_H_
@@ -0,0 +1,201 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph_sampler.h"
+
+#include <memory>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "gtest.h"
+#include "morphism.h"
+#include "test_graphs.h"
+
+namespace morphie {
+namespace graph {
+namespace {
+
+// Returns the input node of each node of the output of 'morphism', in the
+// order of the output nodes, and checks that each output node has exactly one
+// input node.
+std::vector<NodeId> GetInputNodes(const Morphism& morphism) {
+  std::vector<NodeId> nodes;
+  const LabeledGraph& output = morphism.Output();
+  for (NodeIterator node_it = output.NodeSetBegin();
+       node_it != output.NodeSetEnd(); ++node_it) {
+    util::Span<NodeId> preimage = morphism.GetNodePreimage(*node_it);
+    EXPECT_EQ(1, preimage.size());
+    nodes.push_back(preimage[0]);
+  }
+  return nodes;
+}
+
+// Returns the pairs of input nodes joined by an edge of the output of
+// 'morphism', and checks that each pair is joined by an edge of the input.
+std::set<std::pair<NodeId, NodeId>> GetInputEdges(const Morphism& morphism) {
+  std::set<std::pair<NodeId, NodeId>> edges;
+  const std::vector<NodeId> input_nodes = GetInputNodes(morphism);
+  const LabeledGraph& input = morphism.Input();
+  const LabeledGraph& output = morphism.Output();
+  for (EdgeIterator edge_it = output.EdgeSetBegin();
+       edge_it != output.EdgeSetEnd(); ++edge_it) {
+    const NodeId src = input_nodes[output.Source(*edge_it)];
+    const NodeId tgt = input_nodes[output.Target(*edge_it)];
+    const std::set<NodeId> successors = input.GetSuccessors(src);
+    EXPECT_EQ(1, successors.count(tgt));
+    edges.insert({src, tgt});
+  }
+  return edges;
+}
+
+// Checks that the output of 'morphism' is the subgraph of its input induced
+// by the input nodes of the output.
+void ExpectInducedSubgraph(const Morphism& morphism) {
+  const std::vector<NodeId> input_nodes = GetInputNodes(morphism);
+  const std::set<NodeId> sample(input_nodes.begin(), input_nodes.end());
+  EXPECT_EQ(input_nodes.size(), sample.size());
+  std::set<std::pair<NodeId, NodeId>> expected;
+  const LabeledGraph& input = morphism.Input();
+  for (NodeId src : sample) {
+    for (NodeId tgt : input.GetSuccessors(src)) {
+      if (sample.count(tgt) != 0) {
+        expected.insert({src, tgt});
+      }
+    }
+  }
+  EXPECT_EQ(expected, GetInputEdges(morphism));
+  EXPECT_EQ(static_cast<int>(expected.size()), morphism.Output().NumEdges());
+}
+
+TEST(GraphSamplerTest, SamplesDistinctIndices) {
+  std::mt19937_64 generator(3);
+  std::vector<size_t> indices = SampleIndices(100, 10, &generator);
+  ASSERT_EQ(10, indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    EXPECT_LT(indices[i], 100);
+    if (i > 0) {
+      EXPECT_LT(indices[i - 1], indices[i]);
+    }
+  }
+  std::mt19937_64 same_generator(3);
+  EXPECT_EQ(indices, SampleIndices(100, 10, &same_generator));
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2}), SampleIndices(3, 5, &generator));
+  EXPECT_TRUE(SampleIndices(3, 0, &generator).empty());
+  // Every index is drawn about equally often.
+  std::vector<int> counts(10, 0);
+  for (int i = 0; i < 5000; ++i) {
+    for (size_t index : SampleIndices(10, 2, &generator)) {
+      ++counts[index];
+    }
+  }
+  for (int count : counts) {
+    EXPECT_LT(800, count);
+    EXPECT_GT(1200, count);
+  }
+}
+
+TEST(GraphSamplerTest, InducedSubgraphOfCycle) {
+  test::WeightedGraph cycle;
+  test::GetCycleGraph(10, &cycle);
+  const LabeledGraph& graph = *cycle.GetGraph();
+  std::unique_ptr<Morphism> morphism = InducedSubgraph(graph, {5, 1, 2, 1, 0});
+  ASSERT_TRUE(morphism->HasOutputGraph());
+  EXPECT_EQ(4, morphism->Output().NumNodes());
+  EXPECT_EQ(2, morphism->Output().NumEdges());
+  EXPECT_EQ(std::vector<NodeId>({5, 1, 2, 0}), GetInputNodes(*morphism));
+  const std::set<std::pair<NodeId, NodeId>> edges = {{0, 1}, {1, 2}};
+  EXPECT_EQ(edges, GetInputEdges(*morphism));
+  EXPECT_EQ(0, InducedSubgraph(graph, {})->Output().NumNodes());
+}
+
+TEST(GraphSamplerTest, SamplesNodes) {
+  test::WeightedGraph random_graph;
+  test::GetErdosRenyiGraph(200, 0.05, 200, 7, &random_graph);
+  const LabeledGraph& graph = *random_graph.GetGraph();
+  std::unique_ptr<Morphism> morphism = SampleNodes(graph, 40, 11);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+  EXPECT_EQ(40, morphism->Output().NumNodes());
+  EXPECT_LT(0, morphism->Output().NumEdges());
+  ExpectInducedSubgraph(*morphism);
+  // The same seed gives the same sample and another seed another sample.
+  EXPECT_EQ(GetInputNodes(*morphism),
+            GetInputNodes(*SampleNodes(graph, 40, 11)));
+  EXPECT_NE(GetInputNodes(*morphism),
+            GetInputNodes(*SampleNodes(graph, 40, 12)));
+  std::unique_ptr<Morphism> whole_graph = SampleNodes(graph, 300, 11);
+  EXPECT_EQ(graph.NumNodes(), whole_graph->Output().NumNodes());
+  EXPECT_EQ(graph.NumEdges(), whole_graph->Output().NumEdges());
+}
+
+TEST(GraphSamplerTest, SamplesEdges) {
+  test::WeightedGraph random_graph;
+  test::GetErdosRenyiGraph(100, 0.05, 100, 5, &random_graph);
+  const LabeledGraph& graph = *random_graph.GetGraph();
+  std::unique_ptr<Morphism> morphism = SampleEdges(graph, 30, 13);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+  EXPECT_EQ(30, morphism->Output().NumEdges());
+  EXPECT_EQ(30, GetInputEdges(*morphism).size());
+  // Every node of the sample is an endpoint of a sampled edge.
+  const LabeledGraph& output = morphism->Output();
+  for (NodeIterator node_it = output.NodeSetBegin();
+       node_it != output.NodeSetEnd(); ++node_it) {
+    EXPECT_LT(0, output.GetPredecessors(*node_it).size() +
+                     output.GetSuccessors(*node_it).size());
+  }
+  EXPECT_EQ(GetInputEdges(*morphism),
+            GetInputEdges(*SampleEdges(graph, 30, 13)));
+  EXPECT_EQ(graph.NumEdges(),
+            SampleEdges(graph, graph.NumEdges(), 13)->Output().NumEdges());
+  EXPECT_EQ(0, SampleEdges(graph, 0, 13)->Output().NumNodes());
+}
+
+TEST(GraphSamplerTest, SamplesByForestFire) {
+  test::WeightedGraph random_graph;
+  test::GetPreferentialAttachmentGraph(300, 2, 300, 3, &random_graph);
+  const LabeledGraph& graph = *random_graph.GetGraph();
+  std::unique_ptr<Morphism> morphism =
+      SampleForestFire(graph, 50, 0.7, 0.3, 17);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+  EXPECT_EQ(50, morphism->Output().NumNodes());
+  ExpectInducedSubgraph(*morphism);
+  // Burning neighbors keeps more edges than a uniform sample of nodes.
+  EXPECT_LT(SampleNodes(graph, 50, 17)->Output().NumEdges(),
+            morphism->Output().NumEdges());
+  EXPECT_EQ(GetInputNodes(*morphism),
+            GetInputNodes(*SampleForestFire(graph, 50, 0.7, 0.3, 17)));
+  // A fire that burns no neighbors restarts at a random node every time.
+  std::unique_ptr<Morphism> no_spread = SampleForestFire(graph, 50, 0, 0, 17);
+  EXPECT_EQ(50, no_spread->Output().NumNodes());
+  ExpectInducedSubgraph(*no_spread);
+  EXPECT_EQ(graph.NumNodes(),
+            SampleForestFire(graph, 300, 0.7, 0.3, 17)->Output().NumNodes());
+}
+
+TEST(GraphSamplerDeathTest, RequiresValidArguments) {
+  test::WeightedGraph path;
+  test::GetPathGraph(3, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  EXPECT_DEATH({ SampleNodes(graph, -1, 0); },
+               "The sample size must be non-negative.");
+  EXPECT_DEATH({ SampleForestFire(graph, 1, 1, 0, 0); },
+               "Burning probabilities must be in");
+  EXPECT_DEATH({ InducedSubgraph(graph, {3}); },
+               "The node is not in the graph.");
+}
+
+}  // namespace
+}  // namespace graph
+}  // namespace morphie
@@ -0,0 +1,140 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// The atomic operations use the default, sequentially consistent, ordering. A
+// reader increments the count of the replica it read from 'current_' and then
+// reads 'current_' again. If the index is unchanged, the writer either had not
+// started changing that replica, and will wait for the reader, or had already
+// made it the current replica again, and the reader sees its changes.
+#include "graph/graph_snapshots.h"
+
+#include <thread>
+
+#include "util/logging.h"
+
+namespace morphie {
+
+namespace {
+
+const char kInitializationErr[] = "The graph could not be replicated.";
+const char kRemovedNodesErr[] =
+    "Nodes and edges must not be removed from a graph with snapshots.";
+
+}  // namespace
+
+struct GraphSnapshot::Replica {
+  LabeledGraph graph;
+  // The number of snapshots of the replica that have not been destroyed.
+  mutable std::atomic<int> num_readers;
+  int64_t epoch;
+};
+
+GraphSnapshot::GraphSnapshot(GraphSnapshot&& snapshot)
+    : replica_(snapshot.replica_) {
+  snapshot.replica_ = nullptr;
+}
+
+GraphSnapshot::~GraphSnapshot() {
+  if (replica_ != nullptr) {
+    replica_->num_readers.fetch_sub(1);
+  }
+}
+
+const LabeledGraph& GraphSnapshot::Graph() const { return replica_->graph; }
+
+int64_t GraphSnapshot::Epoch() const { return replica_->epoch; }
+
+GraphSnapshots::GraphSnapshots(const LabeledGraph* graph)
+    : graph_(*graph), current_(0) {
+  for (auto& replica : replicas_) {
+    replica.reset(new GraphSnapshot::Replica);
+    util::Status status = replica->graph.Initialize(
+        graph_.GetNodeTypes(), graph_.GetUniqueNodeTags(),
+        graph_.GetEdgeTypes(), graph_.GetUniqueEdgeTags(),
+        graph_.GetGraphType());
+    CHECK(status.ok(), kInitializationErr);
+    // The labels were checked when they were added to 'graph'.
+    replica->graph.SetLabelValidation(LabelValidation::kDebugOnly, 1);
+    replica->num_readers.store(0);
+    replica->epoch = 0;
+    CatchUp(replica.get());
+  }
+}
+
+GraphSnapshots::~GraphSnapshots() {}
+
+int64_t GraphSnapshots::Commit() {
+  const int current = current_.load();
+  GraphSnapshot::Replica* stale = replicas_[1 - current].get();
+  // Wait for the snapshots of the previous epoch.
+  while (stale->num_readers.load() > 0) {
+    std::this_thread::yield();
+  }
+  CatchUp(stale);
+  stale->epoch = replicas_[current]->epoch + 1;
+  current_.store(1 - current);
+  return stale->epoch;
+}
+
+GraphSnapshot GraphSnapshots::Acquire() const {
+  while (true) {
+    const int current = current_.load();
+    const GraphSnapshot::Replica* replica = replicas_[current].get();
+    replica->num_readers.fetch_add(1);
+    if (current_.load() == current) {
+      return GraphSnapshot(replica);
+    }
+    // A commit made the other replica current, and may be changing this one.
+    replica->num_readers.fetch_sub(1);
+  }
+}
+
+// The epoch is read from a snapshot, since a replica that is not acquired may
+// be changed by two commits while it is read.
+int64_t GraphSnapshots::Epoch() const { return Acquire().Epoch(); }
+
+// Nodes and edges are only appended to the graph, so the nodes that the
+// replica lacks are those with the largest ids, and the edges it lacks are
+// the last ones that EdgeSetBegin() enumerates.
+void GraphSnapshots::CatchUp(GraphSnapshot::Replica* replica) {
+  LabeledGraph& copy = replica->graph;
+  CHECK(!graph_.HasRemovedNodes() && copy.NumNodes() <= graph_.NumNodes() &&
+            copy.NumEdges() <= graph_.NumEdges(),
+        kRemovedNodesErr);
+  EdgeIterator first_edge = graph_.EdgeSetEnd();
+  for (int i = copy.NumEdges(); i < graph_.NumEdges(); ++i) {
+    --first_edge;
+  }
+  {
+    LabeledGraph::BulkLoader loader(&copy);
+    loader.Reserve(graph_.NumNodes() - copy.NumNodes(),
+                   graph_.NumEdges() - copy.NumEdges());
+    const NodeId num_nodes = graph_.NumNodes();
+    for (NodeId node_id = copy.NumNodes(); node_id < num_nodes; ++node_id) {
+      loader.AddNode(graph_.GetNodeLabel(node_id));
+    }
+    for (auto edge_it = first_edge; edge_it != graph_.EdgeSetEnd(); ++edge_it) {
+      loader.AddEdge(graph_.Source(*edge_it), graph_.Target(*edge_it),
+                     graph_.GetEdgeLabel(*edge_it));
+    }
+  }
+  AST graph_label = graph_.GetGraphLabel();
+  if (graph_label.ByteSizeLong() > 0 &&
+      graph_label.SerializeAsString() !=
+          copy.GetGraphLabel().SerializeAsString()) {
+    copy.SetGraphLabel(graph_label);
+  }
+}
+
+}  // namespace morphie
@@ -0,0 +1,129 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// GraphSnapshots lets threads query a graph while another thread, the writer,
+// keeps adding nodes and edges to it. A LabeledGraph is not safe to read while
+// it is modified, so readers never read the graph of the writer. Instead, the
+// writer commits the graph from time to time, and a reader acquires a snapshot
+// of the graph as it was at the last commit. Each commit starts a new epoch.
+// A snapshot is a LabeledGraph that does not change while it is held, and can
+// be queried directly or through a LabeledGraphView.
+//
+// Snapshots are kept in two replicas of the graph, as in the left-right
+// technique of
+//   Ramalhete, Correia (2015), "Left-Right: A Concurrency Control Technique
+//   with Wait-Free Population Oblivious Reads".
+// Readers acquire the current replica by incrementing its count of readers,
+// without taking a lock. A commit brings the other replica up to date by
+// appending the nodes and edges added since that replica was last updated,
+// and then makes it the current replica. Before it changes the replica, a
+// commit waits until the readers that acquired it before the last commit
+// have released their snapshots, which is the grace period of read-copy-update
+// schemes. Readers therefore never wait, and the writer only waits in Commit()
+// for snapshots that are held across two commits. Each commit takes time
+// linear in the number of nodes and edges added since the commit before it,
+// and the replicas use about twice the memory of the graph.
+//
+// Example.
+//   LabeledGraph graph;
+//   // Code that initializes the graph.
+//   GraphSnapshots snapshots(&graph);
+//   // The writer.
+//   for (...) {
+//     // Code that adds nodes and edges to 'graph'.
+//     snapshots.Commit();
+//   }
+//   // A reader on another thread.
+//   GraphSnapshot snapshot = snapshots.Acquire();
+//   LabeledGraphView view(snapshot.Graph());
+//
+// Only the nodes and edges that were added to the graph are published, so the
+// graph must not have nodes or edges removed, or labels of committed nodes and
+// edges changed, while it has snapshots.
+#ifndef LOGLE_GRAPH_SNAPSHOTS_H_
+#define LOGLE_GRAPH_SNAPSHOTS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "graph/labeled_graph.h"
+
+namespace morphie {
+
+class GraphSnapshots;
+
+// A snapshot of a graph, which keeps its replica from being changed until the
+// snapshot is destroyed. A snapshot should be released soon, since the second
+// commit after it was acquired waits for it.
+class GraphSnapshot {
+ public:
+  GraphSnapshot(GraphSnapshot&& snapshot);
+  ~GraphSnapshot();
+  // Disallow copying and assignment.
+  GraphSnapshot(const GraphSnapshot&) = delete;
+  GraphSnapshot& operator=(const GraphSnapshot&) = delete;
+
+  // Returns the graph as it was when the epoch of the snapshot was committed.
+  // The reference is valid while the snapshot exists.
+  const LabeledGraph& Graph() const;
+  // Returns the epoch of the snapshot, which is 0 for the graph when the
+  // GraphSnapshots object was constructed and is incremented by every commit.
+  int64_t Epoch() const;
+
+ private:
+  friend class GraphSnapshots;
+  struct Replica;
+
+  explicit GraphSnapshot(const Replica* replica) : replica_(replica) {}
+
+  // The replica, which is null once the snapshot has been moved.
+  const Replica* replica_;
+};
+
+class GraphSnapshots {
+ public:
+  // Constructs the snapshots of 'graph', and copies the graph into both
+  // replicas as epoch 0. The graph must outlive this object.
+  // - Crashes unless 'graph' is initialized and has no removed nodes.
+  explicit GraphSnapshots(const LabeledGraph* graph);
+  ~GraphSnapshots();
+  // Disallow copying and assignment.
+  GraphSnapshots(const GraphSnapshots&) = delete;
+  GraphSnapshots& operator=(const GraphSnapshots&) = delete;
+
+  // Publishes the nodes and edges added to the graph since the last commit,
+  // and its graph label, as a new epoch, which is returned. Must only be
+  // called by the thread that modifies the graph, and while it does not.
+  // - Crashes if nodes or edges of the graph have been removed.
+  int64_t Commit();
+  // Returns a snapshot of the last epoch. May be called by any thread.
+  GraphSnapshot Acquire() const;
+  // Returns the last epoch.
+  int64_t Epoch() const;
+
+ private:
+  // Brings 'replica' up to date with the graph.
+  void CatchUp(GraphSnapshot::Replica* replica);
+
+  const LabeledGraph& graph_;
+  // Two replicas, of which 'current_' is the index of the one that readers
+  // acquire. The other one holds the previous epoch.
+  std::unique_ptr<GraphSnapshot::Replica> replicas_[2];
+  std::atomic<int> current_;
+};
+
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_SNAPSHOTS_H_
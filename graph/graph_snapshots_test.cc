@@ -0,0 +1,153 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_snapshots.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "graph/type.h"
+#include "graph/value.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace {
+
+const char kEventTag[] = "Event";
+const char kNextTag[] = "Next";
+
+// Initializes a graph with non-unique 'Event' nodes and 'Next' edges.
+void InitializeGraph(LabeledGraph* graph) {
+  ast::type::Types node_types;
+  node_types.emplace(kEventTag, ast::type::MakeInt(kEventTag, false));
+  ast::type::Types edge_types;
+  edge_types.emplace(kNextTag, ast::type::MakeNull(kNextTag));
+  ASSERT_TRUE(graph
+                  ->Initialize(node_types, {}, edge_types, {},
+                               ast::type::MakeInt("Graph", false))
+                  .ok());
+}
+
+TaggedAST EventLabel(int event) {
+  TaggedAST label;
+  label.set_tag(kEventTag);
+  *label.mutable_ast() = ast::value::MakeInt(event);
+  return label;
+}
+
+// Adds the event 'event' with an edge from the last event, if there is one.
+void AddEvent(int event, LabeledGraph* graph) {
+  NodeId node_id = graph->FindOrAddNode(EventLabel(event));
+  if (node_id > 0) {
+    TaggedAST label;
+    label.set_tag(kNextTag);
+    graph->FindOrAddEdge(node_id - 1, node_id, label);
+  }
+}
+
+// A snapshot contains the nodes and edges committed before it was acquired,
+// and is not changed by later commits.
+TEST(GraphSnapshotsTest, PublishesCommittedEpochs) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  AddEvent(0, &graph);
+  GraphSnapshots snapshots(&graph);
+  EXPECT_EQ(0, snapshots.Epoch());
+  AddEvent(1, &graph);
+  {
+    GraphSnapshot snapshot = snapshots.Acquire();
+    EXPECT_EQ(0, snapshot.Epoch());
+    EXPECT_EQ(1, snapshot.Graph().NumNodes());
+    EXPECT_EQ(0, snapshot.Graph().NumEdges());
+  }
+  EXPECT_EQ(1, snapshots.Commit());
+  GraphSnapshot first = snapshots.Acquire();
+  EXPECT_EQ(1, first.Epoch());
+  AddEvent(2, &graph);
+  graph.SetGraphLabel(ast::value::MakeInt(2));
+  EXPECT_EQ(2, snapshots.Commit());
+  GraphSnapshot second = snapshots.Acquire();
+  EXPECT_EQ(2, second.Epoch());
+  EXPECT_EQ(graph.Fingerprint(), second.Graph().Fingerprint());
+  EXPECT_EQ(2, first.Graph().NumNodes());
+  EXPECT_EQ(1, first.Graph().NumEdges());
+  EXPECT_EQ(2, second.Graph().NumEdges());
+  EXPECT_EQ(EventLabel(2).SerializeAsString(),
+            second.Graph().GetNodeLabel(2).SerializeAsString());
+
+  // A moved snapshot releases its replica once, when the new one is
+  // destroyed, so the next commits do not wait.
+  { GraphSnapshot moved(std::move(first)); }
+  EXPECT_EQ(3, snapshots.Commit());
+  { GraphSnapshot moved(std::move(second)); }
+  AddEvent(3, &graph);
+  EXPECT_EQ(4, snapshots.Commit());
+  EXPECT_EQ(graph.Fingerprint(), snapshots.Acquire().Graph().Fingerprint());
+}
+
+// Readers on other threads always see a graph that was committed.
+TEST(GraphSnapshotsTest, ReadsConcurrentlyWithWriter) {
+  const int kNumEvents = 500;
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  GraphSnapshots snapshots(&graph);
+  std::atomic<bool> done(false);
+  std::atomic<int> num_errors(0);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&snapshots, &done, &num_errors]() {
+      int64_t last_epoch = 0;
+      while (!done.load()) {
+        GraphSnapshot snapshot = snapshots.Acquire();
+        const LabeledGraph& copy = snapshot.Graph();
+        // The writer commits after every event, so the epoch is the number of
+        // events, which form a path.
+        if (snapshot.Epoch() < last_epoch ||
+            copy.NumNodes() != snapshot.Epoch() ||
+            copy.NumEdges() != std::max<int64_t>(0, snapshot.Epoch() - 1)) {
+          ++num_errors;
+        }
+        last_epoch = snapshot.Epoch();
+      }
+    });
+  }
+  for (int event = 0; event < kNumEvents; ++event) {
+    AddEvent(event, &graph);
+    snapshots.Commit();
+  }
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, num_errors.load());
+  EXPECT_EQ(kNumEvents, snapshots.Acquire().Graph().NumNodes());
+}
+
+TEST(GraphSnapshotsDeathTest, RequiresAppendOnlyGraph) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  AddEvent(0, &graph);
+  AddEvent(1, &graph);
+  GraphSnapshots snapshots(&graph);
+  graph.RemoveNodes({0});
+  EXPECT_DEATH({ snapshots.Commit(); },
+               "Nodes and edges must not be removed from a graph with "
+               "snapshots.");
+}
+
+}  // namespace
+}  // namespace morphie
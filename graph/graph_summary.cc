@@ -0,0 +1,213 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_summary.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include "base/string.h"
+#include "graph/graph_transformer.h"
+#include "graph/type.h"
+#include "graph/value.h"
+#include "util/logging.h"
+#include "util/span.h"
+
+namespace morphie {
+namespace graph {
+
+namespace type = ast::type;
+namespace value = ast::value;
+
+const char kSummaryTag[] = "Summary";
+const char kBundleTag[] = "Bundle";
+
+namespace {
+
+const char kBudgetErr[] = "The node budget of a summary must be positive.";
+const char kThreadsErr[] = "The number of threads must be positive.";
+const char kTypeErr[] = "The types of the summary are invalid.";
+
+// Returns the type of the summary of 'graph', which has the types of 'graph'
+// and the types of the labels of groups and bundles.
+std::unique_ptr<LabeledGraph> SummaryType(const LabeledGraph& graph,
+                                          const AST& summary_type) {
+  type::Types node_types = graph.GetNodeTypes();
+  node_types[kSummaryTag] = summary_type;
+  type::Types edge_types = graph.GetEdgeTypes();
+  edge_types[kBundleTag] = type::MakeInt(kBundleTag, false /*Not nullable*/);
+  std::unique_ptr<LabeledGraph> output_type(new LabeledGraph);
+  util::Status status = output_type->Initialize(
+      node_types, graph.GetUniqueNodeTags(), edge_types,
+      graph.GetUniqueEdgeTags(), graph.GetGraphType());
+  CHECK(status.ok(), kTypeErr);
+  return output_type;
+}
+
+// Numbers the groups of the nodes of 'view' from 0 in the order of their
+// smallest node, where nodes with the same entry in 'key' are in the same
+// group, and sets the group of the other node identifiers to -1. Returns the
+// number of groups.
+int NumberGroups(const LabeledGraphView& view, const std::vector<int64_t>& key,
+                 std::vector<int>* group) {
+  std::unordered_map<int64_t, int> key_groups;
+  for (NodeId node_id = 0; node_id < key.size(); ++node_id) {
+    if (!view.HasNode(node_id)) {
+      (*group)[node_id] = -1;
+      continue;
+    }
+    auto inserted = key_groups.emplace(key[node_id], key_groups.size());
+    (*group)[node_id] = inserted.first->second;
+  }
+  return static_cast<int>(key_groups.size());
+}
+
+}  // namespace
+
+// The leaves of a group share their neighbor, so a group key combines the
+// neighbor, the direction of the edge and the tag. The key of a node that is
+// not a leaf is a key that no leaf has.
+GraphSummary SummarizeGraph(const LabeledGraphView& view,
+                            const SummaryConfig& config) {
+  CHECK(config.max_nodes > 0, kBudgetErr);
+  CHECK(config.num_threads > 0, kThreadsErr);
+  const LabeledGraph& graph = view.Graph();
+  const NodeId num_node_ids = static_cast<NodeId>(view.NumNodeIds());
+  // The tags are numbered once for each distinct label instead of being
+  // looked up for each node.
+  std::map<string, int> tag_ids;
+  std::vector<int> label_tags(graph.NumDistinctLabels());
+  for (LabelId label_id = 0; label_id < label_tags.size(); ++label_id) {
+    label_tags[label_id] =
+        tag_ids.emplace(graph.GetLabel(label_id).tag(), tag_ids.size())
+            .first->second;
+  }
+  const int64_t num_tags = static_cast<int64_t>(tag_ids.size());
+  auto node_tag = [&graph, &label_tags](NodeId node_id) {
+    return label_tags[graph.GetNodeLabelId(node_id)];
+  };
+
+  std::vector<int> degree(num_node_ids, 0);
+  std::vector<NodeId> neighbor(num_node_ids, 0);
+  std::vector<char> is_source(num_node_ids, 0);
+  ViewEdgeIterator end_it = view.EdgeSetEnd();
+  for (ViewEdgeIterator edge_it = view.EdgeSetBegin(); edge_it != end_it;
+       ++edge_it) {
+    NodeId source = view.Source(*edge_it);
+    NodeId target = view.Target(*edge_it);
+    ++degree[source];
+    ++degree[target];
+    neighbor[source] = target;
+    is_source[source] = 1;
+    neighbor[target] = source;
+    is_source[target] = 0;
+  }
+
+  GraphSummary summary;
+  summary.group.resize(num_node_ids);
+  std::vector<int64_t> key(num_node_ids);
+  const bool is_large = view.NumNodes() > config.max_nodes;
+  for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+    if (is_large && degree[node_id] == 1 && degree[neighbor[node_id]] > 1) {
+      key[node_id] = (static_cast<int64_t>(neighbor[node_id]) * 2 +
+                      is_source[node_id]) * num_tags + node_tag(node_id);
+    } else {
+      key[node_id] = -1 - static_cast<int64_t>(node_id);
+    }
+  }
+  int num_groups = NumberGroups(view, key, &summary.group);
+
+  if (num_groups > config.max_nodes) {
+    // Keep the groups with the most incident edges, leaving one node of the
+    // budget for each tag, and merge the other groups by tag.
+    std::vector<int64_t> weight(num_groups, 0);
+    std::vector<int> group_tag(num_groups, 0);
+    std::vector<char> is_node_tag(num_tags, 0);
+    for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+      int group = summary.group[node_id];
+      if (group >= 0) {
+        weight[group] += degree[node_id];
+        group_tag[group] = node_tag(node_id);
+        is_node_tag[group_tag[group]] = 1;
+      }
+    }
+    const int num_node_tags = static_cast<int>(
+        std::count(is_node_tag.begin(), is_node_tag.end(), 1));
+    const int num_kept = std::max(0, config.max_nodes - num_node_tags);
+    std::vector<int> groups(num_groups);
+    for (int group = 0; group < num_groups; ++group) {
+      groups[group] = group;
+    }
+    std::nth_element(groups.begin(), groups.begin() + num_kept, groups.end(),
+                     [&weight](int group1, int group2) {
+                       return weight[group1] != weight[group2]
+                                  ? weight[group1] > weight[group2]
+                                  : group1 < group2;
+                     });
+    std::vector<char> is_kept(num_groups, 0);
+    for (int i = 0; i < num_kept; ++i) {
+      is_kept[groups[i]] = 1;
+    }
+    for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+      int group = summary.group[node_id];
+      if (group >= 0) {
+        key[node_id] =
+            is_kept[group] != 0 ? num_tags + group : group_tag[group];
+      }
+    }
+    NumberGroups(view, key, &summary.group);
+  }
+
+  const AST summary_type = type::MakeTuple(
+      kSummaryTag, false /*Not nullable*/,
+      {type::MakeString("Tag", false), type::MakeInt("Count", false)});
+  std::unique_ptr<LabeledGraph> output_type = SummaryType(graph, summary_type);
+  NodeSpanLabelFn node_label_fn = [&summary_type](
+      const LabeledGraph& graph, util::Span<NodeId> nodes) {
+    if (nodes.size() == 1) {
+      return graph.GetNodeLabel(nodes[0]);
+    }
+    TaggedAST label;
+    label.set_tag(kSummaryTag);
+    AST* tuple = label.mutable_ast();
+    *tuple = value::MakeNullTuple(2);
+    value::SetField(summary_type, 0,
+                    value::MakeString(graph.GetNodeLabel(nodes[0]).tag()),
+                    tuple);
+    value::SetField(summary_type, 1,
+                    value::MakeInt(static_cast<int>(nodes.size())), tuple);
+    return label;
+  };
+  EdgeSpanLabelFn edge_label_fn = [](const LabeledGraph& graph,
+                                     util::Span<EdgeId> edges) {
+    if (edges.size() == 1) {
+      return std::vector<TaggedAST>({graph.GetEdgeLabel(edges[0])});
+    }
+    TaggedAST label;
+    label.set_tag(kBundleTag);
+    *label.mutable_ast() = value::MakeInt(static_cast<int>(edges.size()));
+    return std::vector<TaggedAST>({label});
+  };
+  QuotientConfig quotient_config(*output_type, node_label_fn, edge_label_fn,
+                                 false /*No self-edges*/);
+  quotient_config.num_threads = config.num_threads;
+  summary.graph = QuotientGraph(view, summary.group, quotient_config);
+  return summary;
+}
+
+}  // namespace graph
+}  // namespace morphie
@@ -0,0 +1,96 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A summary of a graph is a smaller graph that gives an overview of a graph
+// that is too large to lay out. Renderers such as DotPrinter and GraphExporter
+// write a graph declaration by declaration, so their output grows with the
+// graph, and GraphViz cannot lay out graphs with millions of nodes. A summary
+// is a quotient of the graph with at most a given number of nodes, and is
+// rendered in place of the graph.
+//
+// The nodes of the graph are grouped in two steps, each of which takes time
+// linear in the size of the graph.
+// 1. Leaves, which are nodes with one incident edge, are grouped by their
+//    neighbor, the direction of their edge and their tag. A file that is used
+//    by a thousand events becomes a file with one edge to a group of events.
+// 2. If there are still more groups than the budget allows, the groups with
+//    the most incident edges are kept and the others are merged by tag, so
+//    that the summary has one node for each tag of the merged nodes.
+// A group of one node is labelled with the label of the node, so it is
+// rendered as before. A larger group is labelled with a 'Summary' label that
+// contains the tag and the number of its nodes. Edges between two groups are
+// bundled into one edge that has the label of the edge if there is only one,
+// and a 'Bundle' label with the number of edges otherwise, which renderers
+// show as the weight of the edge. Edges within a group are dropped.
+//
+// Example.
+//   if (graph.NumNodes() > 10000) {
+//     graph::GraphSummary summary = graph::SummarizeGraph(
+//         LabeledGraphView(graph), graph::SummaryConfig(10000));
+//     DotPrinter().WriteDotGraph(*summary.graph, &dot_file);
+//   }
+#ifndef LOGLE_GRAPH_SUMMARY_H_
+#define LOGLE_GRAPH_SUMMARY_H_
+
+#include <memory>
+#include <vector>
+
+#include "graph/labeled_graph.h"
+#include "graph/labeled_graph_view.h"
+
+namespace morphie {
+namespace graph {
+
+// The tags of the labels of groups and bundles. A 'Summary' label is a tuple
+// of the tag of the nodes in the group, as a string, and the number of nodes,
+// as an int. A 'Bundle' label is the number of edges, as an int.
+extern const char kSummaryTag[];
+extern const char kBundleTag[];
+
+// The options of a summary.
+// - 'max_nodes' is the number of nodes that the summary may have. A summary
+//   has at least one node for each tag of the merged nodes, so it may exceed
+//   a budget that is smaller than the number of tags.
+// - 'num_threads' is the number of threads on which the labels of the summary
+//   are computed. The summary does not depend on the number of threads.
+struct SummaryConfig {
+  explicit SummaryConfig(int max_nodes)
+      : max_nodes(max_nodes), num_threads(1) {}
+
+  int max_nodes;
+  int num_threads;
+};  // struct SummaryConfig
+
+// A summary and the group of every node identifier of the summarized graph,
+// which is the identifier of the node of the summary that represents it, or
+// -1 for an identifier that is not a node of the summarized view.
+struct GraphSummary {
+  std::unique_ptr<LabeledGraph> graph;
+  std::vector<int> group;
+};  // struct GraphSummary
+
+// Returns a summary of the nodes and edges of 'view'. The summary has the node
+// and edge types of the graph, the 'Summary' node type and the 'Bundle' edge
+// type. If the view has at most config.max_nodes nodes, every node is a group
+// of its own and the summary is a copy of the view. Takes time linear in the
+// number of node identifiers and edges of the view, plus the time of the
+// quotient.
+// - Crashes unless config.max_nodes and config.num_threads are positive.
+GraphSummary SummarizeGraph(const LabeledGraphView& view,
+                            const SummaryConfig& config);
+
+}  // namespace graph
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_SUMMARY_H_
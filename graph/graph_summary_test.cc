@@ -0,0 +1,115 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_summary.h"
+
+#include <utility>
+#include <vector>
+
+#include "graph/labeled_graph_view.h"
+#include "graph/test_graphs.h"
+#include "graph/value.h"
+#include "gtest.h"
+#include "util/span.h"
+
+namespace morphie {
+namespace graph {
+namespace {
+
+// Construct the graph below, in which node 0 has the leaves 1 to 5 and nodes
+// 6 and 7 form a cycle.
+//   7 <-> 6 -> 0 -> {1, 2, 3, 4, 5}
+class GraphSummaryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(graph_.Initialize().ok());
+    for (int i = 0; i < 8; ++i) {
+      graph_.AddNode(i);
+    }
+    for (const auto& edge : std::vector<std::pair<NodeId, NodeId>>(
+             {{0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5}, {6, 0}, {7, 6},
+              {6, 7}})) {
+      graph_.AddEdge(edge.first, edge.second, 1);
+    }
+  }
+
+  test::WeightedGraph graph_;
+};
+
+TEST_F(GraphSummaryTest, CopiesSmallGraphs) {
+  LabeledGraphView view(*graph_.GetGraph());
+  GraphSummary summary = SummarizeGraph(view, SummaryConfig(8));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7}), summary.group);
+  EXPECT_EQ(8, summary.graph->NumNodes());
+  EXPECT_EQ(8, summary.graph->NumEdges());
+  EXPECT_EQ(graph_.GetGraph()->GetNodeLabel(3).DebugString(),
+            summary.graph->GetNodeLabel(3).DebugString());
+}
+
+// The leaves of node 0 become one node with a bundle of five edges from 0.
+TEST_F(GraphSummaryTest, CollapsesLeaves) {
+  LabeledGraphView view(*graph_.GetGraph());
+  SummaryConfig config(4);
+  config.num_threads = 2;
+  GraphSummary summary = SummarizeGraph(view, config);
+  EXPECT_EQ(std::vector<int>({0, 1, 1, 1, 1, 1, 2, 3}), summary.group);
+  const LabeledGraph& output = *summary.graph;
+  EXPECT_EQ(4, output.NumNodes());
+  EXPECT_EQ(4, output.NumEdges());
+  const TaggedAST& leaves = output.GetNodeLabel(1);
+  EXPECT_EQ(kSummaryTag, leaves.tag());
+  EXPECT_EQ("Node-Weight",
+            leaves.ast().c_ast().arg(0).p_ast().val().string_val());
+  EXPECT_EQ(5, leaves.ast().c_ast().arg(1).p_ast().val().int_val());
+  TaggedAST bundle;
+  bundle.set_tag(kBundleTag);
+  *bundle.mutable_ast() = ast::value::MakeInt(5);
+  util::Span<EdgeId> bundles = output.GetEdges(bundle);
+  ASSERT_EQ(1u, bundles.size());
+  EXPECT_EQ(0, output.Source(bundles[0]));
+  EXPECT_EQ(1, output.Target(bundles[0]));
+}
+
+// With a budget of two nodes and one tag, node 0, which has the most edges,
+// is kept and the other nodes are merged.
+TEST_F(GraphSummaryTest, MergesByTag) {
+  LabeledGraphView view(*graph_.GetGraph());
+  GraphSummary summary = SummarizeGraph(view, SummaryConfig(2));
+  EXPECT_EQ(std::vector<int>({0, 1, 1, 1, 1, 1, 1, 1}), summary.group);
+  EXPECT_EQ(2, summary.graph->NumNodes());
+  // The edges within the merged nodes are dropped.
+  EXPECT_EQ(2, summary.graph->NumEdges());
+  const TaggedAST& merged = summary.graph->GetNodeLabel(1);
+  EXPECT_EQ(7, merged.ast().c_ast().arg(1).p_ast().val().int_val());
+}
+
+TEST_F(GraphSummaryTest, SummarizesViews) {
+  LabeledGraphView view(*graph_.GetGraph());
+  view.HideNode(7);
+  GraphSummary summary = SummarizeGraph(view, SummaryConfig(3));
+  EXPECT_EQ(std::vector<int>({0, 1, 1, 1, 1, 1, 2, -1}), summary.group);
+  EXPECT_EQ(3, summary.graph->NumNodes());
+  EXPECT_EQ(2, summary.graph->NumEdges());
+}
+
+TEST(GraphSummaryDeathTest, RequiresPositiveBudget) {
+  test::WeightedGraph path;
+  test::GetPathGraph(3, &path);
+  LabeledGraphView view(*path.GetGraph());
+  EXPECT_DEATH({ SummarizeGraph(view, SummaryConfig(0)); }, "budget");
+}
+
+}  // namespace
+}  // namespace graph
+}  // namespace morphie
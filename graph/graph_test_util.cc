@@ -0,0 +1,134 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_test_util.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "graph/ast.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace test {
+
+namespace {
+
+// Returns the successors of 'node_id' with the label ids of the edges to them,
+// sorted.
+std::vector<std::pair<NodeId, LabelId>> SortedSuccessors(
+    const FrozenLabeledGraph& graph, NodeId node_id) {
+  std::vector<std::pair<NodeId, LabelId>> successors;
+  for (FrozenEdgeId edge_id = graph.OutEdgeBegin(node_id);
+       edge_id != graph.OutEdgeEnd(node_id); ++edge_id) {
+    successors.emplace_back(graph.Target(edge_id),
+                            graph.GetEdgeLabelId(edge_id));
+  }
+  std::sort(successors.begin(), successors.end());
+  return successors;
+}
+
+std::vector<std::pair<NodeId, LabelId>> Successors(
+    const CompressedLabeledGraph& graph, NodeId node_id) {
+  std::vector<std::pair<NodeId, LabelId>> successors;
+  NeighborRange range = graph.GetSuccessorRange(node_id);
+  for (auto it = range.begin(); it != range.end(); ++it) {
+    successors.emplace_back(*it, it.EdgeLabelId());
+  }
+  return successors;
+}
+
+}  // namespace
+
+void ExpectSameGraphs(const LabeledGraph& graph, const LabeledGraph& loaded) {
+  EXPECT_EQ(graph.GetUniqueNodeTags(), loaded.GetUniqueNodeTags());
+  EXPECT_EQ(graph.GetUniqueEdgeTags(), loaded.GetUniqueEdgeTags());
+  EXPECT_EQ(graph.NumNodeTypes(), loaded.NumNodeTypes());
+  EXPECT_EQ(graph.NumEdgeTypes(), loaded.NumEdgeTypes());
+  EXPECT_TRUE(ast::Equal(graph.GetGraphType(), loaded.GetGraphType()));
+  EXPECT_TRUE(ast::Equal(graph.GetGraphLabel(), loaded.GetGraphLabel()));
+  ASSERT_EQ(graph.NumNodes(), loaded.NumNodes());
+  ASSERT_EQ(graph.NumEdges(), loaded.NumEdges());
+  for (NodeId node_id = 0; node_id < static_cast<NodeId>(graph.NumNodes());
+       ++node_id) {
+    EXPECT_TRUE(ast::Equal(graph.GetNodeLabel(node_id),
+                           loaded.GetNodeLabel(node_id)));
+  }
+  auto loaded_it = loaded.EdgeSetBegin();
+  for (auto edge_it = graph.EdgeSetBegin(); edge_it != graph.EdgeSetEnd();
+       ++edge_it, ++loaded_it) {
+    EXPECT_EQ(graph.Source(*edge_it), loaded.Source(*loaded_it));
+    EXPECT_EQ(graph.Target(*edge_it), loaded.Target(*loaded_it));
+    EXPECT_TRUE(ast::Equal(graph.GetEdgeLabel(*edge_it),
+                           loaded.GetEdgeLabel(*loaded_it)));
+  }
+}
+
+void ExpectSameGraphs(const FrozenLabeledGraph& frozen,
+                      const FrozenLabeledGraph& mapped) {
+  EXPECT_TRUE(ast::Equal(frozen.GetGraphLabel(), mapped.GetGraphLabel()));
+  ASSERT_EQ(frozen.NumDistinctLabels(), mapped.NumDistinctLabels());
+  const LabelId num_labels = frozen.NumDistinctLabels();
+  for (LabelId label_id = 0; label_id < num_labels; ++label_id) {
+    EXPECT_TRUE(ast::Equal(frozen.GetLabel(label_id),
+                           mapped.GetLabel(label_id)));
+  }
+  ASSERT_EQ(frozen.NumNodes(), mapped.NumNodes());
+  ASSERT_EQ(frozen.NumEdges(), mapped.NumEdges());
+  const NodeId num_nodes = frozen.NumNodes();
+  for (NodeId node_id = 0; node_id < num_nodes; ++node_id) {
+    EXPECT_EQ(frozen.GetNodeLabelId(node_id), mapped.GetNodeLabelId(node_id));
+    EXPECT_EQ(frozen.OutEdgeBegin(node_id), mapped.OutEdgeBegin(node_id));
+    EXPECT_EQ(frozen.OutEdgeEnd(node_id), mapped.OutEdgeEnd(node_id));
+    util::Span<FrozenEdgeId> in_edges = mapped.GetInEdges(node_id);
+    EXPECT_EQ(std::vector<FrozenEdgeId>(frozen.GetInEdges(node_id).begin(),
+                                        frozen.GetInEdges(node_id).end()),
+              std::vector<FrozenEdgeId>(in_edges.begin(), in_edges.end()));
+    util::Span<FrozenNodeId> predecessors = mapped.GetPredecessorRange(node_id);
+    EXPECT_EQ(std::vector<NodeId>(frozen.GetPredecessorRange(node_id).begin(),
+                                  frozen.GetPredecessorRange(node_id).end()),
+              std::vector<NodeId>(predecessors.begin(), predecessors.end()));
+  }
+  const FrozenEdgeId num_edges = frozen.NumEdges();
+  for (FrozenEdgeId edge_id = 0; edge_id < num_edges; ++edge_id) {
+    EXPECT_EQ(frozen.Source(edge_id), mapped.Source(edge_id));
+    EXPECT_EQ(frozen.Target(edge_id), mapped.Target(edge_id));
+    EXPECT_EQ(frozen.GetEdgeLabelId(edge_id), mapped.GetEdgeLabelId(edge_id));
+  }
+}
+
+void ExpectSameGraphs(const FrozenLabeledGraph& frozen,
+                      const CompressedLabeledGraph& compressed) {
+  EXPECT_TRUE(ast::Equal(frozen.GetGraphLabel(), compressed.GetGraphLabel()));
+  ASSERT_EQ(frozen.NumDistinctLabels(), compressed.NumDistinctLabels());
+  ASSERT_EQ(frozen.NumNodes(), compressed.NumNodes());
+  EXPECT_EQ(frozen.NumEdges(), compressed.NumEdges());
+  const NodeId num_nodes = frozen.NumNodes();
+  for (NodeId node_id = 0; node_id < num_nodes; ++node_id) {
+    EXPECT_EQ(frozen.GetNodeLabelId(node_id),
+              compressed.GetNodeLabelId(node_id));
+    EXPECT_EQ(SortedSuccessors(frozen, node_id),
+              Successors(compressed, node_id));
+    util::Span<FrozenNodeId> span = frozen.GetPredecessorRange(node_id);
+    std::vector<NodeId> predecessors(span.begin(), span.end());
+    std::sort(predecessors.begin(), predecessors.end());
+    NeighborRange range = compressed.GetPredecessorRange(node_id);
+    EXPECT_EQ(predecessors.size(), range.size());
+    EXPECT_EQ(predecessors, std::vector<NodeId>(range.begin(), range.end()));
+  }
+}
+
+}  // namespace test
+}  // namespace morphie
@@ -0,0 +1,43 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains gtest expectations that compare the different
+// representations of a graph in tests.
+#ifndef LOGLE_GRAPH_GRAPH_TEST_UTIL_H_
+#define LOGLE_GRAPH_GRAPH_TEST_UTIL_H_
+
+#include "graph/compressed_labeled_graph.h"
+#include "graph/frozen_labeled_graph.h"
+#include "graph/labeled_graph.h"
+
+namespace morphie {
+namespace test {
+
+// Expects 'graph' and 'loaded' to have the same types, graph label, nodes and
+// edges, with edges enumerated in the same order.
+void ExpectSameGraphs(const LabeledGraph& graph, const LabeledGraph& loaded);
+
+// Expects 'frozen' and 'mapped' to have the same graph label, labels, nodes and
+// edges.
+void ExpectSameGraphs(const FrozenLabeledGraph& frozen,
+                      const FrozenLabeledGraph& mapped);
+
+// Expects 'compressed' to have the nodes, labels and neighbors of 'frozen'.
+void ExpectSameGraphs(const FrozenLabeledGraph& frozen,
+                      const CompressedLabeledGraph& compressed);
+
+}  // namespace test
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_GRAPH_TEST_UTIL_H_
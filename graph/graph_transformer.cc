@@ -14,12 +14,16 @@
 
 #include "graph_transformer.h"
 
-#include <queue>
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
 
 #include "type.h"
 #include "util/logging.h"
 #include "util/status.h"
 #include "util/string_utils.h"
+#include "util/thread_pool.h"
+#include "util/trace.h"
 #include "value.h"
 
 namespace morphie {
@@ -29,322 +33,344 @@ namespace type = ast::type;
 
 namespace {
 
-using QuotientEdgeMap = std::map<std::pair<NodeId, NodeId>, std::set<EdgeId>>;
+const char kBlockErr[] = "The partition contains a negative block.";
+const char kPartitionSizeErr[] =
+    "The partition does not have one entry for each node.";
+const char kThreadsErr[] = "The number of threads must be positive.";
+const char kFoldNodeErr[] = "The folded nodes must be nodes of the graph.";
+const char kMergeGraphErr[] = "The graph to merge into is null.";
 
-// This map keeps track of all of the predecessors and successors for each node
-// that is being folded. The ordering in the pair is predecessors then
-// successors.
-using AdjMap = std::map<NodeId, std::pair<std::set<NodeId>, std::set<NodeId>>>;
+// The block of a node that is in no block of a partition.
+const int kNoBlock = -1;
 
-// A Transformation consists of a reference to an input graph, an output graph
-// and a map between the nodes of the input and the output graph. A
-// transformation is used for implementation convenience to encapsulate the data
-// accessed by helper functions used by graph transformations. A transformation
-// is represented as a struct and not a class because a function implementing a
-// transformation needs full access to the API of the input graph, the node map
-// and the output graph.
-//
-// TODO(vijaydsilva): Revisit whether transformation should be upgraded to a
-// class with member functions or eliminated entirely after implementing more
-// transformations.
-struct Transformation {
- public:
-  explicit Transformation(const LabeledGraph& graph) : input(graph) {}
+// The number of nodes and edges from which the output of a transformation is
+// shrunk to fit once it is complete.
+const int kMinShrinkSize = 1 << 16;
 
-  const LabeledGraph& input;
-  std::map<NodeId, NodeId> node_map;
-  std::unique_ptr<LabeledGraph> output;
-};  // struct Transformation
+// An edge of the input graph of a quotient together with the blocks of its
+// source and target, given as node identifiers in the output graph.
+struct QuotientEdge {
+  NodeId source;
+  NodeId target;
+  EdgeId edge;
+};
 
-// The type of a graph is defined by the type of node and edge labels the graph
-// can have and the type of the graph label.
-//
-// Returns a pointer to a graph whose type is the same as the input graph.
-// Returns a nullptr if a new graph could not be created. The returned graph
-// will be empty (no nodes and no edges) because only the type of the graph is
-// copied, not the contents of the graph.
-std::unique_ptr<LabeledGraph> CloneGraphType(const LabeledGraph& graph) {
-  std::unique_ptr<LabeledGraph> new_graph(new LabeledGraph());
-  util::Status status = new_graph->Initialize(
-      graph.GetNodeTypes(), graph.GetUniqueNodeTags(), graph.GetEdgeTypes(),
-      graph.GetUniqueEdgeTags(), graph.GetGraphType());
-  if (!status.ok()) {
-    new_graph.reset(nullptr);
-  }
-  return new_graph;
+// Sets 'sorted' to the elements of 'items' sorted by 'key(item)', which must be
+// less than 'num_keys'. The sort is a stable counting sort.
+template <typename T, typename KeyFn>
+void CountingSort(const std::vector<T>& items, size_t num_keys,
+                  const KeyFn& key, std::vector<T>* sorted) {
+  std::vector<size_t> offsets(num_keys + 1, 0);
+  for (const T& item : items) {
+    ++offsets[key(item) + 1];
+  }
+  for (size_t i = 0; i < num_keys; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+  sorted->resize(items.size());
+  for (const T& item : items) {
+    (*sorted)[offsets[key(item)]++] = item;
+  }
 }
 
-// The graph transformer maintains a map from node identifiers in the input
-// graph to identifiers in the transformed graph. This function returns the
-// identifier in the transformed graph corresponding to the argument 'node_id'
-// if an entry exists in the map. If no such entry exists, a node corresponding
-// to 'node_id' is created in the transformed graph with the label 'new_label'
-// and the identifier of this new node is returned.
-NodeId FindOrRelabelNode(NodeId node_id, TaggedAST new_label,
-                         Transformation* transform) {
-  NodeId new_node;
-  std::map<NodeId, NodeId>& node_map = transform->node_map;
-  auto map_it = node_map.find(node_id);
-  if (map_it == node_map.end()) {
-    new_node = transform->output->FindOrAddNode(new_label);
-    node_map.insert({node_id, new_node});
-  } else {
-    new_node = map_it->second;
-  }
-  return new_node;
+// Adds one node per non-empty block to 'output' and sets 'block_nodes[b]' to
+// the node created for block b. The nodes of the input view are distributed
+// to blocks by a counting sort, which lists the members of each block in
+// increasing order. All labels are computed, possibly in parallel, before
+// they are moved into 'output' in the order of the blocks. A built-in
+// aggregate is computed from a column of the input labels, which is shared by
+// the threads.
+void AddQuotientNodes(const LabeledGraphView& input_view,
+                      const std::vector<int>& partition, size_t num_blocks,
+                      const graph::QuotientConfig& config,
+                      std::vector<NodeId>* block_nodes, LabeledGraph* output) {
+  std::vector<size_t> offsets(num_blocks + 1, 0);
+  for (NodeId node = 0; node < partition.size(); ++node) {
+    if (input_view.HasNode(node)) {
+      ++offsets[partition[node] + 1];
+    }
+  }
+  for (size_t block = 0; block < num_blocks; ++block) {
+    offsets[block + 1] += offsets[block];
+  }
+  std::vector<NodeId> members(offsets[num_blocks]);
+  std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+  for (NodeId node = 0; node < partition.size(); ++node) {
+    if (input_view.HasNode(node)) {
+      members[next[partition[node]]++] = node;
+    }
+  }
+  std::vector<size_t> blocks;
+  for (size_t block = 0; block < num_blocks; ++block) {
+    if (offsets[block] < offsets[block + 1]) {
+      blocks.push_back(block);
+    }
+  }
+  std::unique_ptr<graph::AggregateColumn> column;
+  if (config.node_aggregate != nullptr) {
+    column.reset(new graph::AggregateColumn(*config.node_aggregate,
+                                            input_view.Graph()));
+  }
+  std::vector<TaggedAST> labels(blocks.size());
+  // The calling thread computes labels too, so the pool has one worker less
+  // than the number of threads.
+  util::ThreadPool pool(config.num_threads - 1);
+  util::ParallelFor(blocks.size(), &pool, [&](size_t begin, size_t end) {
+    std::vector<LabelId> label_ids;
+    for (size_t i = begin; i < end; ++i) {
+      size_t block = blocks[i];
+      util::Span<NodeId> block_members(members.data() + offsets[block],
+                                       offsets[block + 1] - offsets[block]);
+      if (column == nullptr) {
+        labels[i] = config.node_label_fn(input_view.Graph(), block_members);
+        continue;
+      }
+      label_ids.clear();
+      for (NodeId node : block_members) {
+        label_ids.push_back(input_view.Graph().GetNodeLabelId(node));
+      }
+      labels[i] = column->Aggregate(label_ids);
+    }
+  });
+  block_nodes->resize(num_blocks);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    (*block_nodes)[blocks[i]] = output->FindOrAddNode(std::move(labels[i]));
+  }
 }
 
-void BuildQuotientEdgeMap(const graph::QuotientConfig& config,
-                          const std::map<NodeId, int>& partition,
-                          std::map<int, NodeId>* blocks,
-                          QuotientEdgeMap* block_edge_members,
-                          Transformation* transform) {
-  const LabeledGraph& graph = transform->input;
-  EdgeIterator end_it = graph.EdgeSetEnd();
-  for (EdgeIterator edge_it = graph.EdgeSetBegin(); edge_it != end_it;
+// Adds the relabeled, collapsed edges to 'output'. The edges of the input
+// graph are grouped by the pair of nodes of 'output' they connect with two
+// counting sorts, first by target and then by source, so groups are visited in
+// lexicographic order of the pairs and list their edges in iteration order.
+// As for nodes, the labels of all groups are computed before any is added.
+void AddQuotientEdges(const LabeledGraphView& input_view,
+                      const std::vector<int>& partition,
+                      const std::vector<NodeId>& block_nodes,
+                      const graph::QuotientConfig& config,
+                      LabeledGraph* output) {
+  std::vector<QuotientEdge> edges;
+  edges.reserve(input_view.NumEdges());
+  ViewEdgeIterator end_it = input_view.EdgeSetEnd();
+  for (ViewEdgeIterator edge_it = input_view.EdgeSetBegin(); edge_it != end_it;
        ++edge_it) {
-    NodeId src = graph.Source(*edge_it);
-    NodeId src_block = blocks->at(partition.at(src));
-    NodeId tgt = graph.Target(*edge_it);
-    NodeId tgt_block = blocks->at(partition.at(tgt));
+    NodeId src_block = block_nodes[partition[input_view.Source(*edge_it)]];
+    NodeId tgt_block = block_nodes[partition[input_view.Target(*edge_it)]];
     // Do not include self-edges if they are not allowed.
     if (!config.allow_self_edges && src_block == tgt_block) {
       continue;
     }
-    std::pair<NodeId, NodeId> quotient_edge(src_block, tgt_block);
-    auto member_it = block_edge_members->find(quotient_edge);
-    if (member_it == block_edge_members->end()) {
-      block_edge_members->insert({quotient_edge, {*edge_it}});
-    } else {
-      member_it->second.insert(*edge_it);
+    edges.push_back({src_block, tgt_block, *edge_it});
+  }
+  size_t num_output_nodes = output->NumNodes();
+  std::vector<QuotientEdge> by_target;
+  CountingSort(edges, num_output_nodes,
+               [](const QuotientEdge& edge) { return edge.target; },
+               &by_target);
+  CountingSort(by_target, num_output_nodes,
+               [](const QuotientEdge& edge) { return edge.source; }, &edges);
+  // The edges of the i-th group are at positions group_offsets[i] to
+  // group_offsets[i + 1] - 1 of 'edges' and 'members'.
+  std::vector<size_t> group_offsets;
+  std::vector<EdgeId> members;
+  members.reserve(edges.size());
+  for (size_t i = 0; i < edges.size(); ++i) {
+    if (i == 0 || edges[i].source != edges[i - 1].source ||
+        edges[i].target != edges[i - 1].target) {
+      group_offsets.push_back(i);
     }
+    members.push_back(edges[i].edge);
   }
-}
-
-// Add the relabeled, collapsed edges to the graph.
-void AddQuotientEdges(const QuotientEdgeMap& block_edge_members,
-                      const graph::EdgeLabelFn& edge_label_fn,
-                      Transformation* transform) {
-  auto member_end_it = block_edge_members.end();
-  for (auto member_it = block_edge_members.begin(); member_it != member_end_it;
-       ++member_it) {
-    auto edge_pair = member_it->first;
-    NodeId src = edge_pair.first;
-    NodeId tgt = edge_pair.second;
-    auto labels = edge_label_fn(transform->input, member_it->second);
-    for (auto edge_label : labels) {
-      transform->output->FindOrAddEdge(src, tgt, edge_label);
+  group_offsets.push_back(edges.size());
+  size_t num_groups = group_offsets.size() - 1;
+  std::unique_ptr<graph::AggregateColumn> column;
+  if (config.edge_aggregate != nullptr) {
+    column.reset(new graph::AggregateColumn(*config.edge_aggregate,
+                                            input_view.Graph()));
+  }
+  std::vector<std::vector<TaggedAST>> labels(num_groups);
+  util::ThreadPool pool(config.num_threads - 1);
+  util::ParallelFor(num_groups, &pool, [&](size_t begin, size_t end) {
+    std::vector<LabelId> label_ids;
+    for (size_t i = begin; i < end; ++i) {
+      util::Span<EdgeId> group_members(
+          members.data() + group_offsets[i],
+          group_offsets[i + 1] - group_offsets[i]);
+      if (column == nullptr) {
+        labels[i] = config.edge_label_fn(input_view.Graph(), group_members);
+        continue;
+      }
+      label_ids.clear();
+      for (const EdgeId& edge : group_members) {
+        label_ids.push_back(input_view.Graph().GetEdgeLabelId(edge));
+      }
+      labels[i].push_back(column->Aggregate(label_ids));
+    }
+  });
+  for (size_t i = 0; i < num_groups; ++i) {
+    const QuotientEdge& edge = edges[group_offsets[i]];
+    for (TaggedAST& label : labels[i]) {
+      output->FindOrAddEdge(edge.source, edge.target, std::move(label));
     }
   }
 }
 
-void BuildQuotientNodeMap(const std::map<NodeId, int>& partition,
-                          const Transformation& transform,
-                          std::map<int, std::set<NodeId>>* block_members) {
-  const LabeledGraph& input_graph = transform.input;
-  NodeIterator node_end_it = input_graph.NodeSetEnd();
-  for (NodeIterator node_it = input_graph.NodeSetBegin();
-       node_it != node_end_it; ++node_it) {
-    NodeId src = *node_it;
-    // Keep track of all of the nodes in each block. The set of nodes will be
-    // passed to 'node_label_fn' to properly label each block node.
-    const auto partition_it = partition.find(src);
-    CHECK(partition_it != partition.end(),
-          util::StrCat("The following node is missing from the partition: ",
-                       std::to_string(src)));
-    int block_id = partition_it->second;
-    auto block_it = block_members->find(block_id);
-    if (block_it == block_members->end()) {
-      block_members->insert({block_id, {src}});
-    } else {
-      block_it->second.insert(src);
+// A union-find structure over the node identifiers of a graph, with union by
+// size and path halving. Operations take nearly constant amortized time, and
+// the structure stores two integers per identifier instead of a set of
+// neighbors per node.
+class NodeUnionFind {
+ public:
+  explicit NodeUnionFind(size_t num_nodes)
+      : parent_(num_nodes), size_(num_nodes, 1) {
+    for (NodeId node = 0; node < num_nodes; ++node) {
+      parent_[node] = node;
     }
   }
-}
 
-void AddQuotientNodes(const graph::NodeLabelFn& node_label_fn,
-                      const std::map<int, std::set<NodeId>>& block_members,
-                      std::map<int, NodeId>* block_node_ids,
-                      Transformation* transform) {
-  auto block_end_it = block_members.end();
-  for (auto block_it = block_members.begin(); block_it != block_end_it;
-       ++block_it) {
-    int block_id = block_it->first;
-    TaggedAST block_label = node_label_fn(transform->input, block_it->second);
-    NodeId block_node_id = transform->output->FindOrAddNode(block_label);
-    block_node_ids->insert({block_id, block_node_id});
+  // Returns the representative of the set containing 'node'.
+  NodeId Find(NodeId node) {
+    while (parent_[node] != node) {
+      parent_[node] = parent_[parent_[node]];
+      node = parent_[node];
+    }
+    return node;
   }
-}
 
-// Returns a map from each node to its adjacent nodes in the 'edges' relation.
-std::map<NodeId, std::set<NodeId>> MakeAdjacencyMap(
-    const LabeledGraph& graph, const std::set<EdgeId>& edges) {
-  std::map<NodeId, std::set<NodeId>> adj_map;
-  for (const auto& edge : edges) {
-    NodeId src = graph.Source(edge);
-    NodeId tgt = graph.Target(edge);
-    auto src_it = adj_map.find(src);
-    if (src_it == adj_map.end()) {
-      adj_map[src] = {tgt};
-    } else {
-      src_it->second.insert(tgt);
+  // Merges the sets containing 'node1' and 'node2'.
+  void Union(NodeId node1, NodeId node2) {
+    NodeId root1 = Find(node1);
+    NodeId root2 = Find(node2);
+    if (root1 == root2) {
+      return;
     }
-    auto tgt_it = adj_map.find(tgt);
-    if (tgt_it == adj_map.end()) {
-      adj_map[tgt] = {src};
-    } else {
-      tgt_it->second.insert(src);
+    if (size_[root1] < size_[root2]) {
+      std::swap(root1, root2);
     }
+    parent_[root2] = root1;
+    size_[root1] += size_[root2];
   }
-  return adj_map;
-}
 
-// Returns a partition where each block is a connected component under the
-// relation 'edges'. The label of each block ranges from 0 to b-1 where b is the
-// number of blocks.
-std::map<NodeId, int> MakePartitionFromRelation(
-    const LabeledGraph& graph,
-    const std::map<NodeId, std::set<NodeId>>& adj_map) {
-  std::map <NodeId, int> partition;
-  // Go through each node in 'graph' and do a BFS to assign it to some block. A
-  // node is assigned a block by assigning it a value in the 'partition' map.
-  int current_block_id = 0;
-  auto end_it = graph.NodeSetEnd();
-  for (auto node_it = graph.NodeSetBegin(); node_it != end_it; ++node_it) {
-    auto part_it = partition.find(*node_it);
-    if (part_it != partition.end()) {
-      continue;
-    }
-    std::queue<NodeId> frontier;
-    frontier.push(*node_it);
-    while (!frontier.empty()) {
-      NodeId node = frontier.front();
-      frontier.pop();
-      // Check if the node has already been assigned a block. If so, then there
-      // is not need to process it again.
-      part_it = partition.find(node);
-      if (part_it != partition.end()) {
-        continue;
-      }
-      partition[node] = current_block_id;
-      // Check that the current node has neighbors.
-      auto adj_it = adj_map.find(node);
-      if (adj_it == adj_map.end()) {
-        continue;
-      }
-      const auto& adjacent_nodes = adj_it->second;
-      for (auto& node : adjacent_nodes) {
-        frontier.push(node);
-      }
+ private:
+  std::vector<NodeId> parent_;
+  std::vector<size_t> size_;
+};  // class NodeUnionFind
+
+// Returns a partition of the nodes of 'view' where each block is a connected
+// component under the relation 'edges'. The label of each block ranges from 0
+// to b-1 where b is the number of blocks, in increasing order of the first
+// node of the block, and nodes that are not in the view are in no block.
+std::vector<int> MakePartitionFromEdges(const LabeledGraphView& view,
+                                        const std::set<EdgeId>& edges) {
+  NodeUnionFind components(view.NumNodeIds());
+  for (const EdgeId& edge : edges) {
+    components.Union(view.Source(edge), view.Target(edge));
+  }
+  // The block of a component is assigned when its first node is visited and
+  // is stored at the representative of the component until then.
+  std::vector<int> root_blocks(view.NumNodeIds(), kNoBlock);
+  std::vector<int> partition(view.NumNodeIds(), kNoBlock);
+  int num_blocks = 0;
+  auto end_it = view.NodeSetEnd();
+  for (auto node_it = view.NodeSetBegin(); node_it != end_it; ++node_it) {
+    NodeId root = components.Find(*node_it);
+    if (root_blocks[root] == kNoBlock) {
+      root_blocks[root] = num_blocks++;
     }
-    ++current_block_id;
+    partition[*node_it] = root_blocks[root];
   }
   return partition;
 }
 
-// For each node that will be folded, the initial predecessors and successors
-// are just their predecessors and successors in the graph.
-AdjMap CreateAdjMap(const LabeledGraph& graph, const std::set<NodeId>& nodes) {
-  AdjMap adj_map;
-  for (NodeId node : nodes) {
-    std::set<NodeId> predecessors(graph.GetPredecessors(node));
-    std::set<NodeId> successors(graph.GetSuccessors(node));
-    predecessors.erase(node);
-    successors.erase(node);
-    adj_map.insert({node, {predecessors, successors}});
-  }
-  return adj_map;
-}
+// The nodes that a folded node is replaced with edges between. The
+// predecessors of a folded node v are the nodes that are not folded and have a
+// path to v whose other nodes are all folded. The successors of v are its
+// successors that are not folded. Both are sorted and have no duplicates.
+struct FoldNeighbors {
+  std::vector<NodeId> predecessors;
+  std::vector<NodeId> successors;
+};
 
-// Replaces 'node' in the output graph of 'transform' with a biparatite graph
-// between its predecessors and successors. For each of its neighbors that is
-// also going to be folded, instead of adding an edge it updates their
-// predecessor/successor set in the 'adj_map'.
-void ReplaceNodeWithBipartite(const LabeledGraph& graph,
-                              const graph::FoldLabelFn& fold_label_fn,
-                              NodeId node, AdjMap* adj_map,
-                              Transformation* transform) {
-  auto neighbors = adj_map->find(node)->second;
-  std::set<NodeId> predecessors = neighbors.first;
-  std::set<NodeId> successors = neighbors.second;
-  for (NodeId predecessor : predecessors) {
-    auto pred_map_it = adj_map->find(predecessor);
-    // Make an edge if both predecessor and successor are not being folded.
-    bool make_edge = true;
-    // The set of successors for 'predecessor' in the map. nullptr if
-    // 'predecessor' is not in 'adj_map'.
-    std::set<NodeId>* pred_succ_set = nullptr;
-    if (pred_map_it != adj_map->end()) {
-      pred_succ_set = &(pred_map_it->second.second);
-      make_edge = false;
+// Appends the predecessors of 'node' that are not folded to 'predecessors' and
+// the folded ones other than 'node' to 'folded'.
+void SplitPredecessors(const LabeledGraph& graph,
+                       const std::vector<bool>& is_folded, NodeId node,
+                       std::vector<NodeId>* predecessors,
+                       std::vector<NodeId>* folded) {
+  for (NodeId predecessor : graph.GetPredecessorRange(node)) {
+    if (!is_folded[predecessor]) {
+      predecessors->push_back(predecessor);
+    } else if (predecessor != node) {
+      folded->push_back(predecessor);
     }
-    for (NodeId successor : successors) {
-      if (pred_succ_set != nullptr) {
-        pred_succ_set->insert(successor);
-      }
-      auto succ_map_it = adj_map->find(successor);
-      if (succ_map_it != adj_map->end()) {
-        succ_map_it->second.first.insert(predecessor);
-        make_edge = false;
-      }
-      if (!make_edge) {
-        continue;
-      }
-      std::vector<TaggedAST> labels = fold_label_fn(graph, node,
-                                                    predecessor, successor);
-      NodeId new_pred = FindOrRelabelNode(predecessor,
-                                          graph.GetNodeLabel(predecessor),
-                                          transform);
-      NodeId new_succ = FindOrRelabelNode(successor,
-                                          graph.GetNodeLabel(successor),
-                                          transform);
-      for (auto label : labels) {
-        transform->output->FindOrAddEdge(new_pred, new_succ, label);
+  }
+}
+
+void SortAndRemoveDuplicates(std::vector<NodeId>* nodes) {
+  std::sort(nodes->begin(), nodes->end());
+  nodes->erase(std::unique(nodes->begin(), nodes->end()), nodes->end());
+}
+
+// Folded predecessors are searched backwards for predecessors that are not
+// folded. The search only allocates a set of visited nodes if 'node' has a
+// folded predecessor.
+FoldNeighbors GetFoldNeighbors(const LabeledGraph& graph,
+                               const std::vector<bool>& is_folded,
+                               NodeId node) {
+  FoldNeighbors neighbors;
+  std::vector<NodeId> frontier;
+  SplitPredecessors(graph, is_folded, node, &neighbors.predecessors,
+                    &frontier);
+  if (!frontier.empty()) {
+    std::unordered_set<NodeId> visited(frontier.begin(), frontier.end());
+    visited.insert(node);
+    std::vector<NodeId> folded;
+    while (!frontier.empty()) {
+      NodeId folded_node = frontier.back();
+      frontier.pop_back();
+      folded.clear();
+      SplitPredecessors(graph, is_folded, folded_node,
+                        &neighbors.predecessors, &folded);
+      for (NodeId predecessor : folded) {
+        if (visited.insert(predecessor).second) {
+          frontier.push_back(predecessor);
+        }
       }
     }
   }
+  for (NodeId successor : graph.GetSuccessorRange(node)) {
+    if (!is_folded[successor]) {
+      neighbors.successors.push_back(successor);
+    }
+  }
+  SortAndRemoveDuplicates(&neighbors.predecessors);
+  SortAndRemoveDuplicates(&neighbors.successors);
+  return neighbors;
+}
+
+// Transformations add the nodes and edges of their outputs one at a time, so
+// the adjacency lists and label indexes of a large output carry the slack left
+// by their growth, which is released once the output is complete.
+void ShrinkLargeOutput(graph::Morphism* morphism) {
+  if (!morphism->HasOutputGraph()) {
+    return;
+  }
+  const LabeledGraph& output = morphism->Output();
+  if (output.NumNodes() + output.NumEdges() >= kMinShrinkSize) {
+    morphism->MutableOutput()->ShrinkToFit();
+  }
 }
 
 }  // namespace
 
 namespace graph {
 
-// The deletion function iterates over nodes in the input graph and over the
-// outgoing edges from each node. An edge is copied to the transformed graph if
-// neither the source nor the target of the edge is a node to be deleted. This
-// function uses a helper function FindOrRelabelNode but not a helper function
-// FindOrRelabelEdge because edges in the input graph are traversed in order of
-// their source nodes. A FindOrRelabelEdge function would not know that the
-// source node of an edge in a sequence of calls is the same and would perform
-// redudnant lookups in the node map.
+// A view of the graph hides the deleted nodes, and copying the view visits the
+// remaining nodes and their outgoing edges in the order of the input graph.
 std::unique_ptr<Morphism> DeleteNodes(const LabeledGraph& graph,
                                       const std::set<NodeId>& nodes) {
-  std::unique_ptr<Morphism> morphism(new Morphism(&graph));
-  morphism->CopyInputType();
-  if (!morphism->HasOutputGraph()) {
-    return morphism;
-  }
-  NodeIterator end_it = graph.NodeSetEnd();
-  for (NodeIterator node_it = graph.NodeSetBegin(); node_it != end_it;
-       ++node_it) {
-    NodeId src = *node_it;
-    // If this node is to be deleted, skip it.
-    if (nodes.find(src) != nodes.end()) {
-      continue;
-    }
-    morphism->FindOrCopyNode(src);
-    OutEdgeIterator out_edge_end = graph.OutEdgeEnd(src);
-    for (OutEdgeIterator edge_it = graph.OutEdgeBegin(src);
-         edge_it != out_edge_end; ++edge_it) {
-      NodeId tgt = graph.Target(*edge_it);
-      // If the target node is to be deleted, skip that node and this edge.
-      if (nodes.find(tgt) != nodes.end()) {
-        continue;
-      }
-      morphism->FindOrCopyEdge(*edge_it);
-    }
-  }
-  return morphism;
+  LabeledGraphView view(graph);
+  view.HideNodes(nodes);
+  return CopyView(view);
 }
 
 // The deletion function iterates over nodes in the input graph and copies the
@@ -374,6 +400,7 @@ std::unique_ptr<Morphism> DeleteEdgesNotNodes(const LabeledGraph& graph,
       morphism->FindOrCopyEdge(*edge_it);
     }
   }
+  ShrinkLargeOutput(morphism.get());
   return morphism;
 }
 
@@ -396,80 +423,305 @@ std::unique_ptr<Morphism> DeleteEdgesAndNodes(const LabeledGraph& graph,
     }
     morphism->FindOrCopyEdge(*edge_it);
   }
+  ShrinkLargeOutput(morphism.get());
+  return morphism;
+}
+
+// The copy function iterates over the nodes of the view and over their outgoing
+// edges. It uses FindOrCopyNode but not a function that finds a copy of an
+// edge because edges are traversed in order of their source nodes, and such a
+// function would perform redundant lookups of the same source in the node map.
+std::unique_ptr<Morphism> CopyView(const LabeledGraphView& view) {
+  std::unique_ptr<Morphism> morphism(new Morphism(&view.Graph()));
+  morphism->CopyInputType();
+  if (!morphism->HasOutputGraph()) {
+    return morphism;
+  }
+  ViewNodeIterator end_it = view.NodeSetEnd();
+  for (ViewNodeIterator node_it = view.NodeSetBegin(); node_it != end_it;
+       ++node_it) {
+    NodeId src = *node_it;
+    morphism->FindOrCopyNode(src);
+    ViewOutEdgeIterator out_edge_end = view.OutEdgeEnd(src);
+    for (ViewOutEdgeIterator edge_it = view.OutEdgeBegin(src);
+         edge_it != out_edge_end; ++edge_it) {
+      morphism->FindOrCopyEdge(*edge_it);
+    }
+  }
+  ShrinkLargeOutput(morphism.get());
+  return morphism;
+}
+
+std::unique_ptr<Morphism> MergeGraphs(std::unique_ptr<LabeledGraph> graph,
+                                      const LabeledGraph& other) {
+  CHECK(graph != nullptr, kMergeGraphErr);
+  std::vector<NodeId> node_map = graph->Merge(other);
+  std::unique_ptr<Morphism> morphism(new Morphism(&other));
+  morphism->SetOutput(std::move(graph));
+  for (NodeId node_id = 0; node_id < node_map.size(); ++node_id) {
+    if (node_map[node_id] != LabeledGraph::kRemovedNode) {
+      morphism->MapNode(node_id, node_map[node_id]);
+    }
+  }
   return morphism;
 }
 
+QuotientConfig::QuotientConfig(const LabeledGraph& output_graph_type,
+                               const NodeLabelFn& node_label_fn,
+                               const EdgeLabelFn& edge_label_fn,
+                               bool allow_self_edges)
+    : output_graph_type(output_graph_type),
+      node_label_fn([node_label_fn](const LabeledGraph& graph,
+                                    util::Span<NodeId> nodes) {
+        return node_label_fn(graph, std::set<NodeId>(nodes.begin(),
+                                                     nodes.end()));
+      }),
+      edge_label_fn([edge_label_fn](const LabeledGraph& graph,
+                                    util::Span<EdgeId> edges) {
+        return edge_label_fn(graph, std::set<EdgeId>(edges.begin(),
+                                                     edges.end()));
+      }),
+      allow_self_edges(allow_self_edges),
+      num_threads(1) {}
+
+QuotientConfig::QuotientConfig(const LabeledGraph& output_graph_type,
+                               const LabelAggregate& node_aggregate,
+                               const LabelAggregate& edge_aggregate,
+                               bool allow_self_edges)
+    : output_graph_type(output_graph_type),
+      allow_self_edges(allow_self_edges),
+      num_threads(1),
+      node_aggregate(new LabelAggregate(node_aggregate)),
+      edge_aggregate(new LabelAggregate(edge_aggregate)) {
+  std::shared_ptr<const LabelAggregate> node_fn_aggregate =
+      this->node_aggregate;
+  node_label_fn = [node_fn_aggregate](const LabeledGraph& graph,
+                                      util::Span<NodeId> nodes) {
+    std::vector<LabelId> label_ids;
+    for (NodeId node : nodes) {
+      label_ids.push_back(graph.GetNodeLabelId(node));
+    }
+    return node_fn_aggregate->Aggregate(graph, label_ids);
+  };
+  std::shared_ptr<const LabelAggregate> edge_fn_aggregate =
+      this->edge_aggregate;
+  edge_label_fn = [edge_fn_aggregate](const LabeledGraph& graph,
+                                      util::Span<EdgeId> edges) {
+    std::vector<LabelId> label_ids;
+    for (const EdgeId& edge : edges) {
+      label_ids.push_back(graph.GetEdgeLabelId(edge));
+    }
+    return std::vector<TaggedAST>({edge_fn_aggregate->Aggregate(graph,
+                                                                label_ids)});
+  };
+}
+
 std::unique_ptr<LabeledGraph> QuotientGraph(
     const LabeledGraph& input_graph, const std::map<NodeId, int>& partition,
     const QuotientConfig& config) {
-  Transformation transform(input_graph);
-  transform.output = CloneGraphType(config.output_graph_type);
-  if (transform.output == nullptr) {
-    return std::move(transform.output);
-  }
-  std::map<int, std::set<NodeId>> block_members;
-  BuildQuotientNodeMap(partition, transform, &block_members);
-  // Add blocks to the output graph with the label generated by 'node_label_fn'.
-  std::map<int, NodeId> block_node_ids;
-  AddQuotientNodes(config.node_label_fn, block_members,
-                   &block_node_ids, &transform);
-
-  std::map<std::pair<NodeId, NodeId>, std::set<EdgeId>> block_edge_members;
-  BuildQuotientEdgeMap(config, partition,
-                       &block_node_ids, &block_edge_members, &transform);
-  AddQuotientEdges(block_edge_members, config.edge_label_fn, &transform);
-  return std::move(transform.output);
+  return QuotientGraph(LabeledGraphView(input_graph), partition, config);
+}
+
+std::unique_ptr<LabeledGraph> QuotientGraph(const LabeledGraph& input_graph,
+                                            const std::vector<int>& partition,
+                                            const QuotientConfig& config) {
+  return QuotientGraph(LabeledGraphView(input_graph), partition, config);
+}
+
+// Block identifiers are replaced by their rank among the distinct identifiers
+// in 'partition', which preserves their order and makes them dense.
+std::unique_ptr<LabeledGraph> QuotientGraph(
+    const LabeledGraphView& input_view, const std::map<NodeId, int>& partition,
+    const QuotientConfig& config) {
+  std::vector<int> block_ids;
+  block_ids.reserve(partition.size());
+  for (const auto& node_block : partition) {
+    block_ids.push_back(node_block.second);
+  }
+  std::sort(block_ids.begin(), block_ids.end());
+  block_ids.erase(std::unique(block_ids.begin(), block_ids.end()),
+                  block_ids.end());
+  std::vector<int> dense_partition(input_view.NumNodeIds());
+  ViewNodeIterator node_end_it = input_view.NodeSetEnd();
+  for (ViewNodeIterator node_it = input_view.NodeSetBegin();
+       node_it != node_end_it; ++node_it) {
+    const auto partition_it = partition.find(*node_it);
+    CHECK(partition_it != partition.end(),
+          util::StrCat("The following node is missing from the partition: ",
+                       *node_it));
+    dense_partition[*node_it] = static_cast<int>(
+        std::lower_bound(block_ids.begin(), block_ids.end(),
+                         partition_it->second) -
+        block_ids.begin());
+  }
+  return QuotientGraph(input_view, dense_partition, config);
+}
+
+std::unique_ptr<LabeledGraph> QuotientGraph(const LabeledGraphView& input_view,
+                                            const std::vector<int>& partition,
+                                            const QuotientConfig& config) {
+  return QuotientMorphism(input_view, partition, config)->TakeOutput();
+}
+
+std::unique_ptr<Morphism> QuotientMorphism(const LabeledGraphView& input_view,
+                                           const std::vector<int>& partition,
+                                           const QuotientConfig& config) {
+  util::ScopedSpan span("QuotientMorphism");
+  CHECK(partition.size() == static_cast<size_t>(input_view.NumNodeIds()),
+        kPartitionSizeErr);
+  CHECK(config.num_threads > 0, kThreadsErr);
+  size_t num_blocks = 0;
+  for (NodeId node = 0; node < partition.size(); ++node) {
+    if (!input_view.HasNode(node)) {
+      continue;
+    }
+    CHECK(partition[node] >= 0, kBlockErr);
+    num_blocks = std::max(num_blocks, static_cast<size_t>(partition[node]) + 1);
+  }
+  std::unique_ptr<Morphism> morphism(new Morphism(&input_view.Graph()));
+  morphism->CopyType(config.output_graph_type);
+  if (!morphism->HasOutputGraph()) {
+    return morphism;
+  }
+  LabeledGraph* output = morphism->MutableOutput();
+  std::vector<NodeId> block_nodes;
+  AddQuotientNodes(input_view, partition, num_blocks, config, &block_nodes,
+                   output);
+  AddQuotientEdges(input_view, partition, block_nodes, config, output);
+  for (NodeId node = 0; node < partition.size(); ++node) {
+    if (input_view.HasNode(node)) {
+      morphism->MapNode(node, block_nodes[partition[node]]);
+    }
+  }
+  ShrinkLargeOutput(morphism.get());
+  return morphism;
 }
 
 std::unique_ptr<LabeledGraph> ContractEdges(const LabeledGraph& graph,
                                             const std::set<EdgeId>& edges,
                                             const QuotientConfig& config) {
-  std::map<NodeId, std::set<NodeId>> adj_map = MakeAdjacencyMap(graph, edges);
-  std::map<NodeId, int> partition = MakePartitionFromRelation(graph, adj_map);
-  std::unique_ptr<Morphism> morphism = DeleteEdgesNotNodes(graph, edges);
-  return QuotientGraph(morphism->Output(), partition, config);
+  return ContractEdgesMorphism(LabeledGraphView(graph), edges, config)
+      ->TakeOutput();
+}
+
+// The components of the contracted edges are computed with a union-find
+// structure over node identifiers, and the contracted edges are hidden in a
+// view so the quotient skips them without copying the graph. The blocks are
+// numbered in the order in which the components are found, so the partition
+// is already dense.
+std::unique_ptr<Morphism> ContractEdgesMorphism(
+    const LabeledGraphView& input_view, const std::set<EdgeId>& edges,
+    const QuotientConfig& config) {
+  util::ScopedSpan span("ContractEdgesMorphism");
+  std::vector<int> partition = MakePartitionFromEdges(input_view, edges);
+  LabeledGraphView view(input_view);
+  view.HideEdges(edges);
+  return QuotientMorphism(view, partition, config);
 }
 
-// The FoldNodes function iterates over the nodeset of 'graph' and does one
-// of two things. If the node is in the set 'nodes', then
-// ReplaceNodeWithBipartite is called on the node. Otherwise we iterate over the
-// outgoing edges, adding all neighbors not in 'nodes' and edges to those
-// neighbors.
 std::unique_ptr<LabeledGraph> FoldNodes(const LabeledGraph& graph,
                                         const FoldLabelFn& fold_label_fn,
                                         const std::set<NodeId>& nodes) {
-  Transformation transform(graph);
-  transform.output = CloneGraphType(graph);
-  if (transform.output == nullptr) {
-    return std::move(transform.output);
+  return FoldNodes(graph, fold_label_fn, nodes, 1);
+}
+
+std::unique_ptr<LabeledGraph> FoldNodes(const LabeledGraph& graph,
+                                        const FoldLabelFn& fold_label_fn,
+                                        const std::set<NodeId>& nodes,
+                                        int num_threads) {
+  return FoldNodesMorphism(graph, fold_label_fn, nodes, num_threads)
+      ->TakeOutput();
+}
+
+// Folding has three phases. The neighbors of the folded nodes are computed,
+// and then the labels of the edges that replace every folded node, both in
+// parallel. Labels are computed in parallel over all (predecessor, successor)
+// pairs rather than over folded nodes, so that a folded node of high degree
+// is split across threads. Finally, the nodes of the graph are visited in
+// order: a folded node is replaced by edges between each of its predecessors
+// and each of its successors, in increasing order, and any other node is
+// copied with its edges to nodes that are not folded. The output does not
+// depend on the number of threads.
+std::unique_ptr<Morphism> FoldNodesMorphism(const LabeledGraph& graph,
+                                            const FoldLabelFn& fold_label_fn,
+                                            const std::set<NodeId>& nodes,
+                                            int num_threads) {
+  util::ScopedSpan span("FoldNodesMorphism");
+  CHECK(num_threads > 0, kThreadsErr);
+  std::unique_ptr<Morphism> morphism(new Morphism(&graph));
+  morphism->CopyInputType();
+  if (!morphism->HasOutputGraph()) {
+    return morphism;
+  }
+  std::vector<bool> is_folded(graph.NumNodeIds(), false);
+  const std::vector<NodeId> folded(nodes.begin(), nodes.end());
+  for (NodeId node : folded) {
+    CHECK(graph.HasNode(node), kFoldNodeErr);
+    is_folded[node] = true;
   }
-  AdjMap adj_map = CreateAdjMap(graph, nodes);
+  std::vector<FoldNeighbors> neighbors(folded.size());
+  util::ThreadPool pool(num_threads - 1);
+  util::ParallelFor(folded.size(), &pool, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      neighbors[i] = GetFoldNeighbors(graph, is_folded, folded[i]);
+    }
+  });
+  // The labels for the i-th folded node are at positions label_offsets[i] to
+  // label_offsets[i + 1] - 1, ordered by predecessor and then by successor.
+  std::vector<size_t> label_offsets(folded.size() + 1, 0);
+  for (size_t i = 0; i < folded.size(); ++i) {
+    label_offsets[i + 1] = label_offsets[i] +
+                           neighbors[i].predecessors.size() *
+                               neighbors[i].successors.size();
+  }
+  std::vector<std::vector<TaggedAST>> labels(label_offsets.back());
+  util::ParallelFor(labels.size(), &pool, [&](size_t begin, size_t end) {
+    for (size_t label = begin; label < end; ++label) {
+      size_t i = std::upper_bound(label_offsets.begin(), label_offsets.end(),
+                                  label) -
+                 label_offsets.begin() - 1;
+      const FoldNeighbors& fold_neighbors = neighbors[i];
+      size_t pair = label - label_offsets[i];
+      size_t num_successors = fold_neighbors.successors.size();
+      labels[label] = fold_label_fn(
+          graph, folded[i], fold_neighbors.predecessors[pair / num_successors],
+          fold_neighbors.successors[pair % num_successors]);
+    }
+  });
 
+  LabeledGraph* output = morphism->MutableOutput();
+  size_t next_folded = 0;
   NodeIterator end_it = graph.NodeSetEnd();
   for (NodeIterator node_it = graph.NodeSetBegin(); node_it != end_it;
        ++node_it) {
     NodeId src = *node_it;
-    if (nodes.find(src) != nodes.end()) {
-      ReplaceNodeWithBipartite(graph, fold_label_fn, src,
-                               &adj_map, &transform);
+    if (is_folded[src]) {
+      const FoldNeighbors& fold_neighbors = neighbors[next_folded];
+      size_t label = label_offsets[next_folded];
+      ++next_folded;
+      for (NodeId predecessor : fold_neighbors.predecessors) {
+        for (NodeId successor : fold_neighbors.successors) {
+          NodeId new_pred = morphism->FindOrCopyNode(predecessor);
+          NodeId new_succ = morphism->FindOrCopyNode(successor);
+          for (TaggedAST& edge_label : labels[label++]) {
+            output->FindOrAddEdge(new_pred, new_succ, std::move(edge_label));
+          }
+        }
+      }
       continue;
     }
-    NodeId new_src =
-        FindOrRelabelNode(src, graph.GetNodeLabel(src), &transform);
+    morphism->FindOrCopyNode(src);
     OutEdgeIterator out_edge_end = graph.OutEdgeEnd(src);
     for (OutEdgeIterator edge_it = graph.OutEdgeBegin(src);
          edge_it != out_edge_end; ++edge_it) {
-      NodeId tgt = graph.Target(*edge_it);
-      if (nodes.find(tgt) != nodes.end()) {
+      if (is_folded[graph.Target(*edge_it)]) {
         continue;
       }
-      NodeId new_tgt =
-          FindOrRelabelNode(tgt, graph.GetNodeLabel(tgt), &transform);
-      transform.output->FindOrAddEdge(new_src, new_tgt,
-                                      graph.GetEdgeLabel(*edge_it));
+      morphism->FindOrCopyEdge(*edge_it);
     }
   }
-  return std::move(transform.output);
+  ShrinkLargeOutput(morphism.get());
+  return morphism;
 }
 }  // namespace graph
 }  // namespace morphie
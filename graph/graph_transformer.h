@@ -13,15 +13,22 @@
 // the License.
 
 // A labeled graph can be transformed by deleting or collapsing nodes and edges.
-// This file contains utilities for transforming graphs.
+// This file contains utilities for transforming graphs. Large outputs are
+// shrunk to fit with LabeledGraph::ShrinkToFit once they are complete.
 #ifndef LOGLE_GRAPH_TRANSFORMER_H_
 #define LOGLE_GRAPH_TRANSFORMER_H_
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
+#include "label_aggregates.h"
 #include "labeled_graph.h"
+#include "labeled_graph_view.h"
 #include "morphism.h"
+#include "util/span.h"
 
 namespace morphie {
 // The 'graph' namespace contains functions for manipulating graphs.
@@ -37,6 +44,16 @@ using EdgeLabelFn =
     std::function<std::vector<TaggedAST>(const LabeledGraph&,
                                          const std::set<EdgeId>&)>;
 
+// A NodeSpanLabelFn is a NodeLabelFn that takes a span of distinct nodes in
+// increasing order instead of a set, and an EdgeSpanLabelFn is an EdgeLabelFn
+// that takes a span of distinct edges in the order of the edge iterator of the
+// graph. Span label functions avoid building a set for every block.
+using NodeSpanLabelFn =
+    std::function<TaggedAST(const LabeledGraph&, util::Span<NodeId>)>;
+using EdgeSpanLabelFn =
+    std::function<std::vector<TaggedAST>(const LabeledGraph&,
+                                         util::Span<EdgeId>)>;
+
 // A FoldLabelFn takes three nodes in a graph and generates a set of labels for
 // the new edges to be generated.
 // For example:
@@ -52,27 +69,51 @@ using FoldLabelFn =
 //   the output graph.
 // - The 'node_label_fn' determines how the blocks are labeled in the output.
 // - The 'edge_label_fn' determines how the edges between the blocks are
-//   labeled. This function is only applied if 'allow_multi_edges' is false.
+//   labeled.
 // - The flag 'allow_self_edges' dictates if the output graph should contain
 //    self-edges.
+// - The 'num_threads' is the number of threads on which label functions are
+//   evaluated, and is 1 by default. With more than one thread, the label
+//   functions are called concurrently and must be safe to call concurrently.
+//   The output graph does not depend on the number of threads.
+// The label functions are copied into the configuration, and label functions
+// on sets are wrapped in span label functions that construct the sets.
+// A configuration constructed from built-in aggregates (see
+// label_aggregates.h) records them in 'node_aggregate' and 'edge_aggregate',
+// and QuotientGraph computes the labels from columns of the aggregated fields
+// instead of calling the label functions, which call the aggregates directly
+// for other users of the configuration. The aggregates are null otherwise.
 //
 // Requires that:
 // - Both 'node_label_fn' and 'edge_label_fn' respect the types of
 //   'output_graph_type'.
+// - The 'output_graph_type' outlives the configuration.
 struct QuotientConfig {
  public:
   explicit QuotientConfig(const LabeledGraph& output_graph_type,
                           const NodeLabelFn& node_label_fn,
                           const EdgeLabelFn& edge_label_fn,
+                          bool allow_self_edges);
+  explicit QuotientConfig(const LabeledGraph& output_graph_type,
+                          const NodeSpanLabelFn& node_label_fn,
+                          const EdgeSpanLabelFn& edge_label_fn,
                           bool allow_self_edges)
       : output_graph_type(output_graph_type),
       node_label_fn(node_label_fn),
       edge_label_fn(edge_label_fn),
-      allow_self_edges(allow_self_edges) {}
+      allow_self_edges(allow_self_edges),
+      num_threads(1) {}
+  explicit QuotientConfig(const LabeledGraph& output_graph_type,
+                          const LabelAggregate& node_aggregate,
+                          const LabelAggregate& edge_aggregate,
+                          bool allow_self_edges);
   const LabeledGraph& output_graph_type;
-  const NodeLabelFn& node_label_fn;
-  const EdgeLabelFn& edge_label_fn;
+  NodeSpanLabelFn node_label_fn;
+  EdgeSpanLabelFn edge_label_fn;
   bool allow_self_edges;
+  int num_threads;
+  std::shared_ptr<const LabelAggregate> node_aggregate;
+  std::shared_ptr<const LabelAggregate> edge_aggregate;
 };  // struct QuotientConfig
 
 // If G = (V, E) is a graph and N is a subset of nodes of V, the result of
@@ -86,6 +127,20 @@ struct QuotientConfig {
 std::unique_ptr<Morphism> DeleteNodes(const LabeledGraph& graph,
                                       const std::set<NodeId>& nodes);
 
+// Returns a morphism from view.Graph() to a copy of the nodes and edges of
+// 'view'. Copying a view that hides 'nodes' gives the same graph as
+// DeleteNodes(view.Graph(), nodes).
+std::unique_ptr<Morphism> CopyView(const LabeledGraphView& view);
+
+// Merges 'other' into 'graph' with LabeledGraph::Merge and returns a morphism
+// from 'other' to the merged graph, which is the output of the morphism and
+// maps every node of 'other' to the node that it was merged into. The nodes
+// and edges of 'graph' keep their ids in the merged graph.
+// - Crashes if 'graph' is null or under the conditions under which
+//   LabeledGraph::Merge crashes.
+std::unique_ptr<Morphism> MergeGraphs(std::unique_ptr<LabeledGraph> graph,
+                                      const LabeledGraph& other);
+
 // If G = (V, E) is a graph and F is a subset of edges of E, the result of
 // deleting edges but not nodes in F from G is the graph with nodes V and edges
 // H = (E - F). The resulting graph has the same set of nodes as the original
@@ -130,20 +185,90 @@ std::unique_ptr<LabeledGraph> QuotientGraph(
     const LabeledGraph& input_graph, const std::map<NodeId, int>& partition,
     const QuotientConfig& config);
 
+// Returns the same graph as the QuotientGraph function above for a partition
+// with dense block identifiers, in which 'partition[node]' is the block of
+// 'node'. Block identifiers need not be contiguous, but the function takes time
+// and space linear in the largest block identifier as well as in the size of
+// the graph. Nodes are distributed to blocks and edges to pairs of blocks with
+// counting sorts instead of ordered maps.
+//
+// Requires that:
+// - The 'partition' has one non-negative entry for each node in 'graph'.
+// - 'config' meets the requirements of a QuotientConfig, given above, and has
+//   a positive number of threads.
+std::unique_ptr<LabeledGraph> QuotientGraph(const LabeledGraph& input_graph,
+                                            const std::vector<int>& partition,
+                                            const QuotientConfig& config);
+
+// Return the quotient of the nodes and edges of a view. A view that hides the
+// nodes deleted by DeleteNodes, or the edges deleted by DeleteEdgesAndNodes
+// together with the isolated nodes, has the same quotient as the graph those
+// functions construct, without copying the input graph. The label functions
+// are called with view.Graph() and with nodes and edges of the view.
+// - The map version requires that 'partition' has every node of the view as a
+//   key.
+// - The vector version requires that 'partition' has one entry for each node
+//   identifier below view.NumNodeIds(), and ignores the entries of nodes that
+//   are not in the view.
+std::unique_ptr<LabeledGraph> QuotientGraph(
+    const LabeledGraphView& input_view, const std::map<NodeId, int>& partition,
+    const QuotientConfig& config);
+std::unique_ptr<LabeledGraph> QuotientGraph(const LabeledGraphView& input_view,
+                                            const std::vector<int>& partition,
+                                            const QuotientConfig& config);
+
+// Returns a morphism from input_view.Graph() to the quotient that the vector
+// version of QuotientGraph constructs. Each node of the view maps to its block
+// and nodes that are not in the view map to nothing. The morphism has no
+// output graph if the type of the output graph cannot be copied.
+std::unique_ptr<Morphism> QuotientMorphism(const LabeledGraphView& input_view,
+                                           const std::vector<int>& partition,
+                                           const QuotientConfig& config);
+
 // Edge contraction replaces an edge (u, v) with a new node w such that for each
 // edge (x, u) or (x, v) in the input graph there is an edge (x, w) in the
 // output graph. This applies likewise for edges (u, x) and (u, v).
+// Contracting a set of edges replaces each connected component of the edges
+// with one node, and takes time and space linear in the size of the input
+// graph plus the time of the quotient. The input graph is not copied.
 std::unique_ptr<LabeledGraph> ContractEdges(const LabeledGraph& graph,
                                             const std::set<EdgeId>& edges,
                                             const QuotientConfig& config);
+// Returns a morphism from input_view.Graph() to the graph obtained by
+// contracting 'edges' in the view, which maps each node of the view to the
+// node its component is contracted to.
+// - Requires that 'edges' are edges of the view.
+std::unique_ptr<Morphism> ContractEdgesMorphism(
+    const LabeledGraphView& input_view, const std::set<EdgeId>& edges,
+    const QuotientConfig& config);
 
 // Folding node v removes v from the graph, and replacing it with a complete
 // bipartite graph between its predecessors and successors. This means that for
 // each (u, v) and (v, w) in the original graph, there is an edge (u, w) in the
-// output graph.
+// output graph. If folded nodes are adjacent, the predecessors of v are the
+// nodes that are not folded and have a path to v through folded nodes, so a
+// path u -> v_1 -> ... -> v_k -> w through folded nodes is replaced by an edge
+// (u, w) labeled by fold_label_fn(graph, v_k, u, w).
+//
+// The label function is called once for each folded node and each pair of a
+// predecessor and a successor of that node. With more than one thread, the
+// calls are distributed over 'num_threads' threads and must be safe to make
+// concurrently. The output graph does not depend on the number of threads.
+// - Requires that 'nodes' are nodes of 'graph' and that 'num_threads' is
+//   positive.
 std::unique_ptr<LabeledGraph> FoldNodes(const LabeledGraph& graph,
                                         const FoldLabelFn& fold_label_fn,
                                         const std::set<NodeId>& nodes);
+std::unique_ptr<LabeledGraph> FoldNodes(const LabeledGraph& graph,
+                                        const FoldLabelFn& fold_label_fn,
+                                        const std::set<NodeId>& nodes,
+                                        int num_threads);
+// Returns a morphism from 'graph' to the graph that FoldNodes constructs, in
+// which the folded nodes map to nothing.
+std::unique_ptr<Morphism> FoldNodesMorphism(const LabeledGraph& graph,
+                                            const FoldLabelFn& fold_label_fn,
+                                            const std::set<NodeId>& nodes,
+                                            int num_threads);
 }  // namespace graph
 
 }  // namespace morphie
@@ -0,0 +1,200 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A benchmark of the graph transformations and of partition refinement, which
+// are the steps of summarizing a graph. For every graph size 10^3, 10^4, ... up
+// to --max_nodes nodes, the benchmark generates an Erdos-Renyi graph with an
+// average out-degree of --average_degree and measures
+//  - DeleteNodes, FoldNodes of every tenth node,
+//  - DeleteEdgesNotNodes, DeleteEdgesAndNodes, ContractEdges of every tenth
+//    edge,
+//  - QuotientGraph with respect to blocks of ten consecutive nodes,
+//  - RefinePartition of the partition of the nodes by weight, and its
+//    bounded refinement for three rounds in both directions.
+// For each operation and size, the benchmark prints the size |V|+|E| of the
+// input graph, the running time, the time per node and edge, and the peak
+// resident set size of the process during the operation. The time per node
+// and edge is constant across sizes for a transformation that scales linearly.
+//
+// Example.
+//   graph_transformer_benchmark --max_nodes=1000000 --average_degree=8
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "base/string.h"
+#include "gflags/gflags.h"
+#include "graph/graph_analyzer.h"
+#include "graph/graph_transformer.h"
+#include "graph/labeled_graph.h"
+#include "graph/morphism.h"
+#include "graph/test_graphs.h"
+#include "util/memory_usage.h"
+#include "util/span.h"
+
+DEFINE_int64(max_nodes, 1000000,
+             "The number of nodes of the largest graph, at least 1000.");
+DEFINE_double(average_degree, 4.0, "The average out-degree of the graphs.");
+DEFINE_int64(seed, 1, "The seed of the graph generator.");
+
+namespace morphie {
+namespace {
+
+// The number of distinct node and edge weights of the input graphs.
+const int kNumWeights = 16;
+
+// Every tenth node or edge is transformed, and blocks have ten nodes.
+const int kStride = 10;
+
+// Labels a block of a quotient with the weight of its first node.
+TaggedAST FirstNodeLabel(const LabeledGraph& graph, util::Span<NodeId> nodes) {
+  return graph.GetNodeLabel(nodes[0]);
+}
+
+// Labels the edge that replaces a folded node with the weight of the node.
+std::vector<TaggedAST> FoldedNodeLabel(const LabeledGraph& graph, NodeId node,
+                                       NodeId predecessor, NodeId successor) {
+  return {test::EdgeWeightLabel(test::Weight(graph.GetNodeLabel(node)))};
+}
+
+// Measures the operation that is run between the construction of a
+// Measurement and the call to Finish.
+class Measurement {
+ public:
+  explicit Measurement(const string& name)
+      : name_(name), is_peak_reset_(util::ResetPeakResidentSetSize()) {
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  // Prints the measurements of the operation on 'graph'.
+  void Finish(const LabeledGraph& graph) {
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start_;
+    int64_t size = static_cast<int64_t>(graph.NumNodes()) + graph.NumEdges();
+    std::cout << std::left << std::setw(20) << name_ << std::right
+              << std::setw(10) << graph.NumNodes() << std::setw(11)
+              << graph.NumEdges() << std::setw(11) << size << std::fixed
+              << std::setprecision(3) << std::setw(10) << seconds.count()
+              << " s" << std::setprecision(1) << std::setw(10)
+              << seconds.count() * 1e9 / std::max<int64_t>(size, 1)
+              << " ns/element" << std::setw(10)
+              << util::PeakResidentSetSizeMiB() << " MiB peak RSS"
+              << (is_peak_reset_ ? "" : " since start") << std::endl;
+  }
+
+ private:
+  const string name_;
+  const bool is_peak_reset_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+void RunBenchmarks(int num_nodes) {
+  test::WeightedGraph weighted_graph;
+  test::GetErdosRenyiGraph(
+      num_nodes, FLAGS_average_degree / std::max(num_nodes - 1, 1), kNumWeights,
+      FLAGS_seed, &weighted_graph);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+
+  std::set<NodeId> nodes;
+  for (int node = 0; node < num_nodes; node += kStride) {
+    nodes.insert(node);
+  }
+  std::set<EdgeId> edges;
+  int edge_count = 0;
+  for (auto edge_it = graph.EdgeSetBegin(); edge_it != graph.EdgeSetEnd();
+       ++edge_it, ++edge_count) {
+    if (edge_count % kStride == 0) {
+      edges.insert(*edge_it);
+    }
+  }
+  graph::QuotientConfig config(graph, FirstNodeLabel, test::EdgeCountLabel,
+                               true /* allow self edges */);
+  {
+    Measurement measurement("DeleteNodes");
+    std::unique_ptr<graph::Morphism> morphism =
+        graph::DeleteNodes(graph, nodes);
+    measurement.Finish(graph);
+  }
+  {
+    Measurement measurement("DeleteEdgesNotNodes");
+    std::unique_ptr<graph::Morphism> morphism =
+        graph::DeleteEdgesNotNodes(graph, edges);
+    measurement.Finish(graph);
+  }
+  {
+    Measurement measurement("DeleteEdgesAndNodes");
+    std::unique_ptr<graph::Morphism> morphism =
+        graph::DeleteEdgesAndNodes(graph, edges);
+    measurement.Finish(graph);
+  }
+  {
+    std::vector<int> partition(num_nodes);
+    for (int node = 0; node < num_nodes; ++node) {
+      partition[node] = node / kStride;
+    }
+    Measurement measurement("QuotientGraph");
+    std::unique_ptr<LabeledGraph> quotient =
+        graph::QuotientGraph(graph, partition, config);
+    measurement.Finish(graph);
+  }
+  {
+    Measurement measurement("ContractEdges");
+    std::unique_ptr<LabeledGraph> contraction =
+        graph::ContractEdges(graph, edges, config);
+    measurement.Finish(graph);
+  }
+  {
+    Measurement measurement("FoldNodes");
+    std::unique_ptr<LabeledGraph> folded =
+        graph::FoldNodes(graph, FoldedNodeLabel, nodes);
+    measurement.Finish(graph);
+  }
+  {
+    std::vector<int> partition(num_nodes);
+    for (int node = 0; node < num_nodes; ++node) {
+      partition[node] = node % kNumWeights;
+    }
+    {
+      Measurement measurement("RefinePartition");
+      std::vector<int> refinement =
+          graph_analyzer::RefinePartition(graph, partition);
+      measurement.Finish(graph);
+    }
+    Measurement measurement("RefinePartitionBounded");
+    std::vector<int> refinement = graph_analyzer::RefinePartitionBounded(
+        graph, partition, 3, graph_analyzer::RefinementDirection::kBoth, 1);
+    measurement.Finish(graph);
+  }
+}
+
+int RunBenchmarks() {
+  int64_t max_nodes = std::max<int64_t>(FLAGS_max_nodes, 1000);
+  for (int64_t num_nodes = 1000; num_nodes <= max_nodes; num_nodes *= 10) {
+    RunBenchmarks(static_cast<int>(num_nodes));
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace morphie
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return morphie::RunBenchmarks();
+}
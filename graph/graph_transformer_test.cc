@@ -14,10 +14,15 @@
 
 #include "graph_transformer.h"
 
+#include <map>
 #include <memory>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "ast.h"
 #include "gtest.h"
+#include "labeled_graph_view.h"
 #include "morphism.h"
 #include "test_graphs.h"
 #include "type.h"
@@ -266,6 +271,23 @@ TaggedAST LowestIdWeightedGraphLabel(const LabeledGraph& graph,
   return tagged_label;
 }
 
+TaggedAST LowestIdSpanLabel(const LabeledGraph& graph,
+                            util::Span<NodeId> nodes) {
+  TaggedAST tagged_label;
+  *tagged_label.mutable_ast() =
+      ast::value::MakeInt(static_cast<int>(nodes[0]));
+  tagged_label.set_tag(kBlockTag);
+  return tagged_label;
+}
+
+std::vector<TaggedAST> EdgeCountSpanLabel(const LabeledGraph& graph,
+                                          util::Span<EdgeId> edges) {
+  TaggedAST tagged_label;
+  *tagged_label.mutable_ast() = ast::value::MakeInt(edges.size());
+  tagged_label.set_tag(kEdgeTag);
+  return {tagged_label};
+}
+
 std::vector<TaggedAST> ConstantNodeFoldingLabel(const LabeledGraph& graph,
                                                 NodeId node, NodeId predecessor,
                                                 NodeId successor) {
@@ -350,6 +372,33 @@ void SetIntTypes(LabeledGraph* graph) {
 
 // The quotient of a graph with respect to the identity equivalence relation
 // should be the same graph.
+// Merging a path into a copy of another path appends the nodes and edges of
+// the merged path, and the morphism maps them to their copies.
+TEST(GraphTransformerTest, MergePaths) {
+  test::WeightedGraph path2;
+  test::GetPathGraph(2, &path2);
+  test::WeightedGraph path3;
+  test::GetPathGraph(3, &path3);
+  std::unique_ptr<LabeledGraph> graph =
+      CopyView(LabeledGraphView(*path2.GetGraph()))->TakeOutput();
+  std::unique_ptr<Morphism> morphism =
+      MergeGraphs(std::move(graph), *path3.GetGraph());
+  ASSERT_TRUE(morphism->HasOutputGraph());
+  EXPECT_EQ(path3.GetGraph(), &morphism->Input());
+  EXPECT_EQ(5, morphism->Output().NumNodes());
+  EXPECT_EQ(3, morphism->Output().NumEdges());
+  for (NodeId node_id = 0; node_id < 3; ++node_id) {
+    std::pair<bool, NodeId> image = morphism->FindNodeImage(node_id);
+    EXPECT_TRUE(image.first);
+    EXPECT_EQ(node_id + 2, image.second);
+    EXPECT_EQ(path3.GetGraph()->GetNodeLabelId(node_id) ==
+                  path3.GetGraph()->GetNodeLabelId(0),
+              morphism->Output().GetNodeLabelId(image.second) ==
+                  morphism->Output().GetNodeLabelId(0));
+  }
+  EXPECT_EQ(0, morphism->GetNodePreimage(0).size());
+}
+
 TEST(GraphTransformerTest, IdentityPathQuotient) {
   // Create the graph { 0 -> 1 } and obtain the identifiers for the two nodes in
   // the graph.
@@ -706,6 +755,109 @@ TEST(GraphTransformerTest, SimpleNoSelfEdgeQuotient) {
   EXPECT_TRUE(test::IsPath(*graph1));
 }
 
+// The quotient with respect to a partition with dense, non-contiguous block
+// identifiers and span label functions is the quotient with respect to the
+// same partition given as a map, for any number of threads.
+TEST(GraphTransformerTest, DenseQuotientMatchesMapQuotient) {
+  test::WeightedGraph cycle;
+  test::GetCycleGraph(6, &cycle);
+  const LabeledGraph& input_graph = *cycle.GetGraph();
+  std::vector<int> partition = {4, 4, 0, 0, 4, 7};
+  std::map<NodeId, int> map_partition;
+  for (NodeId node = 0; node < partition.size(); ++node) {
+    map_partition[node] = partition[node];
+  }
+  LabeledGraph graphtype;
+  SetIntTypes(&graphtype);
+  for (int variant = 0; variant < 4; ++variant) {
+    bool allow_self_edges = variant % 2 == 0;
+    int num_threads = variant < 2 ? 1 : 4;
+    QuotientConfig map_config(graphtype, LowestIdLabel, EdgeCountLabel,
+                              allow_self_edges);
+    QuotientConfig span_config(graphtype, LowestIdSpanLabel,
+                               EdgeCountSpanLabel, allow_self_edges);
+    span_config.num_threads = num_threads;
+    std::unique_ptr<LabeledGraph> expected =
+        QuotientGraph(input_graph, map_partition, map_config);
+    std::unique_ptr<LabeledGraph> graph =
+        QuotientGraph(input_graph, partition, span_config);
+    ASSERT_TRUE(graph != nullptr);
+    ASSERT_EQ(3, graph->NumNodes());
+    EXPECT_EQ(allow_self_edges ? 6 : 4, graph->NumEdges());
+    ASSERT_EQ(expected->NumEdges(), graph->NumEdges());
+    // Blocks are added in order of their identifiers.
+    std::vector<int> lowest_ids = {2, 0, 5};
+    for (NodeId node = 0; node < 3; ++node) {
+      EXPECT_EQ(lowest_ids[node],
+                graph->GetNodeLabel(node).ast().p_ast().val().int_val());
+      EXPECT_TRUE(ast::Equal(expected->GetNodeLabel(node),
+                             graph->GetNodeLabel(node)));
+    }
+    auto expected_it = expected->EdgeSetBegin();
+    auto edge_end_it = graph->EdgeSetEnd();
+    for (auto edge_it = graph->EdgeSetBegin(); edge_it != edge_end_it;
+         ++edge_it, ++expected_it) {
+      EXPECT_EQ(expected->Source(*expected_it), graph->Source(*edge_it));
+      EXPECT_EQ(expected->Target(*expected_it), graph->Target(*edge_it));
+      EXPECT_TRUE(ast::Equal(expected->GetEdgeLabel(*expected_it),
+                             graph->GetEdgeLabel(*edge_it)));
+    }
+  }
+}
+
+// The quotient of a view with a hidden node is computed from the remaining
+// path. Entries of the partition for hidden nodes are ignored.
+TEST(GraphTransformerTest, ViewQuotient) {
+  test::WeightedGraph cycle;
+  test::GetCycleGraph(6, &cycle);
+  LabeledGraphView view(*cycle.GetGraph());
+  view.HideNode(5);
+  std::vector<int> partition = {4, 4, 0, 0, 4, -1};
+  std::map<NodeId, int> map_partition;
+  for (NodeId node = 0; node < 5; ++node) {
+    map_partition[node] = partition[node];
+  }
+  LabeledGraph graphtype;
+  SetIntTypes(&graphtype);
+  for (bool allow_self_edges : {true, false}) {
+    QuotientConfig map_config(graphtype, LowestIdLabel, EdgeCountLabel,
+                              allow_self_edges);
+    QuotientConfig span_config(graphtype, LowestIdSpanLabel,
+                               EdgeCountSpanLabel, allow_self_edges);
+    std::unique_ptr<LabeledGraph> expected =
+        QuotientGraph(view, map_partition, map_config);
+    std::unique_ptr<LabeledGraph> graph =
+        QuotientGraph(view, partition, span_config);
+    ASSERT_TRUE(expected != nullptr);
+    ASSERT_TRUE(graph != nullptr);
+    ASSERT_EQ(2, expected->NumNodes());
+    ASSERT_EQ(2, graph->NumNodes());
+    EXPECT_EQ(allow_self_edges ? 4 : 2, expected->NumEdges());
+    EXPECT_EQ(expected->NumEdges(), graph->NumEdges());
+    for (NodeId node = 0; node < 2; ++node) {
+      EXPECT_TRUE(ast::Equal(expected->GetNodeLabel(node),
+                             graph->GetNodeLabel(node)));
+    }
+  }
+}
+
+TEST(GraphTransformerDeathTest, DenseQuotientRequiresValidPartition) {
+  test::WeightedGraph path;
+  test::GetPathGraph(3, &path);
+  const LabeledGraph& input_graph = *path.GetGraph();
+  LabeledGraph graphtype;
+  SetIntTypes(&graphtype);
+  QuotientConfig config(graphtype, LowestIdSpanLabel, EdgeCountSpanLabel,
+                        true);
+  EXPECT_DEATH({ QuotientGraph(input_graph, std::vector<int>(2), config); },
+               "The partition does not have one entry for each node.");
+  EXPECT_DEATH({ QuotientGraph(input_graph, {0, -1, 0}, config); },
+               "The partition contains a negative block.");
+  config.num_threads = 0;
+  EXPECT_DEATH({ QuotientGraph(input_graph, {0, 0, 0}, config); },
+               "The number of threads must be positive.");
+}
+
 // Calls edge contraction on an empty edge-set. The graph should be unchanged
 // after the contraction.
 TEST(GraphTransformerTest, NoEdgeContraction) {
@@ -828,6 +980,37 @@ TEST(GraphTransformerTest, LongPathEdgeContraction) {
   EXPECT_TRUE(test::IsPath(*graph1));
 }
 
+// Contracts the edges 0 -> 1, 3 -> 4 and 4 -> 5 of a path with six nodes. The
+// components {0, 1}, {2} and {3, 4, 5} become the nodes of a path, in the order
+// of their lowest node.
+TEST(GraphTransformerTest, ComponentsEdgeContraction) {
+  test::WeightedGraph path;
+  test::GetPathGraph(6, &path);
+  const LabeledGraph& input_graph = *path.GetGraph();
+  std::set<EdgeId> edges;
+  for (auto edge_it = input_graph.EdgeSetBegin();
+       edge_it != input_graph.EdgeSetEnd(); ++edge_it) {
+    NodeId source = input_graph.Source(*edge_it);
+    if (source == 0 || source == 3 || source == 4) {
+      edges.insert(*edge_it);
+    }
+  }
+  LabeledGraph graphtype;
+  SetIntTypes(&graphtype);
+  QuotientConfig config(graphtype, LowestIdLabel, EdgeCountLabel, true);
+  std::unique_ptr<LabeledGraph> graph = ContractEdges(input_graph, edges,
+                                                      config);
+  ASSERT_TRUE(graph != nullptr);
+  ASSERT_EQ(3, graph->NumNodes());
+  EXPECT_EQ(2, graph->NumEdges());
+  EXPECT_TRUE(test::IsPath(*graph));
+  std::vector<int> lowest_ids = {0, 2, 3};
+  for (NodeId node = 0; node < 3; ++node) {
+    EXPECT_EQ(lowest_ids[node],
+              graph->GetNodeLabel(node).ast().p_ast().val().int_val());
+  }
+}
+
 TEST(GraphTransformerTest, NoNodeFold) {
   // Create the graph { 0 -> 1 -> 2}.
   test::WeightedGraph path;
@@ -967,6 +1150,79 @@ TEST(GraphTransformerTest, DoubleIndicatorLabelNodeFold) {
   EXPECT_EQ(2, graph1->NumEdges());
 }
 
+// Labels the edge that replaces the path u -> v -> w with 100 * v + u.
+std::vector<TaggedAST> NodeAndPredecessorFoldingLabel(const LabeledGraph& graph,
+                                                      NodeId node,
+                                                      NodeId predecessor,
+                                                      NodeId successor) {
+  TaggedAST tagged_label;
+  *tagged_label.mutable_ast() =
+      ast::value::MakeInt(static_cast<int>(100 * node + predecessor));
+  tagged_label.set_tag("Edge-Weight");
+  return {tagged_label};
+}
+
+// Folds 1 and 2 in the graph { 0 -> 2 -> 1 -> 3}. The path through the folded
+// nodes is replaced by an edge from 0 to 3 even though the later node of the
+// path has the lower identifier.
+TEST(GraphTransformerTest, FoldedPathNodeFold) {
+  test::WeightedGraph graph;
+  ASSERT_TRUE(graph.Initialize().ok());
+  for (int weight = 0; weight < 4; ++weight) {
+    graph.AddNode(weight);
+  }
+  graph.AddEdge(0, 2, 0);
+  graph.AddEdge(2, 1, 0);
+  graph.AddEdge(1, 3, 0);
+  const LabeledGraph& input_graph = *graph.GetGraph();
+
+  std::unique_ptr<LabeledGraph> graph1 = FoldNodes(
+      input_graph, NodeAndPredecessorFoldingLabel, {1, 2});
+
+  ASSERT_TRUE(graph1 != nullptr);
+  EXPECT_EQ(2, graph1->NumNodes());
+  ASSERT_EQ(1, graph1->NumEdges());
+  EdgeId edge = *graph1->EdgeSetBegin();
+  EXPECT_EQ(0, graph1->GetNodeLabel(graph1->Source(edge))
+                   .ast().p_ast().val().int_val());
+  EXPECT_EQ(3, graph1->GetNodeLabel(graph1->Target(edge))
+                   .ast().p_ast().val().int_val());
+  EXPECT_EQ(100, graph1->GetEdgeLabel(edge).ast().p_ast().val().int_val());
+}
+
+// Folding on several threads constructs the same graph as on one thread.
+TEST(GraphTransformerTest, ParallelNodeFold) {
+  test::WeightedGraph random_graph;
+  test::GetErdosRenyiGraph(60, 0.1, 7, 11, &random_graph);
+  const LabeledGraph& input_graph = *random_graph.GetGraph();
+  std::set<NodeId> nodes;
+  for (NodeId node = 0; node < 60; node += 3) {
+    nodes.insert(node);
+  }
+  std::unique_ptr<LabeledGraph> expected =
+      FoldNodes(input_graph, NodeAndPredecessorFoldingLabel, nodes);
+  std::unique_ptr<LabeledGraph> graph =
+      FoldNodes(input_graph, NodeAndPredecessorFoldingLabel, nodes, 4);
+  ASSERT_TRUE(expected != nullptr);
+  ASSERT_TRUE(graph != nullptr);
+  EXPECT_EQ(40, graph->NumNodes());
+  ASSERT_EQ(expected->NumNodes(), graph->NumNodes());
+  ASSERT_EQ(expected->NumEdges(), graph->NumEdges());
+  for (NodeId node = 0; node < 40; ++node) {
+    EXPECT_TRUE(ast::Equal(expected->GetNodeLabel(node),
+                           graph->GetNodeLabel(node)));
+  }
+  auto expected_it = expected->EdgeSetBegin();
+  auto edge_end_it = graph->EdgeSetEnd();
+  for (auto edge_it = graph->EdgeSetBegin(); edge_it != edge_end_it;
+       ++edge_it, ++expected_it) {
+    EXPECT_EQ(expected->Source(*expected_it), graph->Source(*edge_it));
+    EXPECT_EQ(expected->Target(*expected_it), graph->Target(*edge_it));
+    EXPECT_TRUE(ast::Equal(expected->GetEdgeLabel(*expected_it),
+                           graph->GetEdgeLabel(*edge_it)));
+  }
+}
+
 }  // namespace
 }  // namespace graph
 }  // namespace morphie
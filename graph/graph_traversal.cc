@@ -0,0 +1,420 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_traversal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "util/logging.h"
+#include "util/span.h"
+
+namespace morphie {
+
+namespace {
+
+const char kInvalidNodeErr[] = "Invalid node id.";
+const char kHopsErr[] = "The number of hops must not be negative.";
+const char kMaxNodesErr[] = "The number of nodes must not be negative.";
+const char kThreadsErr[] = "The number of threads must be positive.";
+
+// The constants of the direction heuristic from the paper by Beamer et al. A
+// search switches to bottom-up expansion when the frontier has more than
+// 1/kTopDownFactor of the edges of the unvisited nodes, and back to top-down
+// expansion when the frontier has fewer than 1/kBottomUpFactor of the nodes.
+const int64_t kTopDownFactor = 14;
+const int64_t kBottomUpFactor = 24;
+
+const int kUnreachable = -1;
+
+const char kCompressedGraphErr[] = "The traversal has no frozen graph.";
+
+// The neighbors of a node are in one list, or in two lists if edges are
+// followed in both directions. A list is a util::Span of a FrozenLabeledGraph
+// or a NeighborRange of a CompressedLabeledGraph.
+template <typename Range>
+struct NeighborLists {
+  size_t size() const { return lists[0].size() + lists[1].size(); }
+
+  Range lists[2];
+};
+
+template <typename GraphT>
+using NeighborListsOf = NeighborLists<decltype(
+    std::declval<const GraphT&>().GetSuccessorRange(NodeId{0}))>;
+
+// Returns the neighbors of a node in the direction of a traversal, or in the
+// opposite direction if 'reverse' is true.
+template <typename GraphT>
+NeighborListsOf<GraphT> Neighbors(const GraphT& graph, NodeId node_id,
+                                 TraversalDirection direction, bool reverse) {
+  NeighborListsOf<GraphT> neighbors;
+  if (direction == TraversalDirection::kBoth) {
+    neighbors.lists[0] = graph.GetSuccessorRange(node_id);
+    neighbors.lists[1] = graph.GetPredecessorRange(node_id);
+  } else if ((direction == TraversalDirection::kForward) != reverse) {
+    neighbors.lists[0] = graph.GetSuccessorRange(node_id);
+  } else {
+    neighbors.lists[0] = graph.GetPredecessorRange(node_id);
+  }
+  return neighbors;
+}
+
+size_t NumWords(int num_node_ids) { return (num_node_ids + 63) / 64; }
+
+uint64_t Bit(NodeId node_id) { return uint64_t{1} << (node_id % 64); }
+
+// Returns true if one of 'neighbors' is in the bitset 'bits'.
+template <typename Range>
+bool ContainsAny(const std::vector<uint64_t>& bits,
+                 const NeighborLists<Range>& neighbors) {
+  for (const Range& list : neighbors.lists) {
+    for (NodeId neighbor : list) {
+      if ((bits[neighbor / 64] & Bit(neighbor)) != 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+NodeSet::NodeSet(int num_node_ids)
+    : num_node_ids_(num_node_ids), words_(NumWords(num_node_ids), 0) {}
+
+void NodeSet::Insert(NodeId node_id) {
+  CHECK(node_id < static_cast<NodeId>(num_node_ids_), kInvalidNodeErr);
+  words_[node_id / 64] |= Bit(node_id);
+}
+
+int NodeSet::Size() const {
+  int size = 0;
+  for (uint64_t word : words_) {
+    size += static_cast<int>(std::bitset<64>(word).count());
+  }
+  return size;
+}
+
+std::vector<NodeId> NodeSet::Nodes() const {
+  std::vector<NodeId> nodes;
+  for (size_t i = 0; i < words_.size(); ++i) {
+    for (int bit = 0; bit < 64 && words_[i] >> bit != 0; ++bit) {
+      if (((words_[i] >> bit) & 1) != 0) {
+        nodes.push_back(static_cast<NodeId>(64 * i + bit));
+      }
+    }
+  }
+  return nodes;
+}
+
+GraphTraversal::GraphTraversal(const FrozenLabeledGraph& graph,
+                               int num_threads)
+    : graph_(&graph), compressed_graph_(nullptr), pool_(num_threads - 1) {
+  CHECK(num_threads > 0, kThreadsErr);
+}
+
+GraphTraversal::GraphTraversal(const LabeledGraph& graph, int num_threads)
+    : owned_graph_(new FrozenLabeledGraph(graph)),
+      graph_(owned_graph_.get()),
+      compressed_graph_(nullptr),
+      pool_(num_threads - 1) {
+  CHECK(num_threads > 0, kThreadsErr);
+}
+
+GraphTraversal::GraphTraversal(const CompressedLabeledGraph& graph,
+                               int num_threads)
+    : graph_(nullptr), compressed_graph_(&graph), pool_(num_threads - 1) {
+  CHECK(num_threads > 0, kThreadsErr);
+}
+
+const FrozenLabeledGraph& GraphTraversal::Graph() const {
+  CHECK(graph_ != nullptr, kCompressedGraphErr);
+  return *graph_;
+}
+
+NodeSet GraphTraversal::Reachable(const std::vector<NodeId>& sources,
+                                  TraversalDirection direction) {
+  return Search(sources, direction, kUnreachable, nullptr, nullptr);
+}
+
+std::vector<int> GraphTraversal::Distances(const std::vector<NodeId>& sources,
+                                           TraversalDirection direction) {
+  std::vector<int> distances;
+  Search(sources, direction, kUnreachable, nullptr, &distances);
+  return distances;
+}
+
+NodeSet GraphTraversal::ExpandHops(const std::vector<NodeId>& sources,
+                                   int max_hops, const std::set<string>& tags,
+                                   TraversalDirection direction) {
+  CHECK(max_hops >= 0, kHopsErr);
+  if (tags.empty()) {
+    return Search(sources, direction, max_hops, nullptr, nullptr);
+  }
+  std::vector<char> allowed_labels(NumDistinctLabels(), 0);
+  for (LabelId label_id = 0; label_id < allowed_labels.size(); ++label_id) {
+    allowed_labels[label_id] = tags.count(GetLabel(label_id).tag()) > 0;
+  }
+  return Search(sources, direction, max_hops, &allowed_labels, nullptr);
+}
+
+// The nodes are ranked by distance and then by degree, so that if a node is in
+// the neighborhood, every node closer to the seeds is as well.
+NodeSet GraphTraversal::Neighborhood(const std::vector<NodeId>& seeds,
+                                     int max_hops, int max_nodes,
+                                     TraversalDirection direction) {
+  CHECK(max_hops >= 0, kHopsErr);
+  CHECK(max_nodes >= 0, kMaxNodesErr);
+  std::vector<int> distances;
+  NodeSet reached = Search(seeds, direction, max_hops, nullptr, &distances);
+  if (reached.Size() <= max_nodes) {
+    return reached;
+  }
+  std::vector<NodeId> nodes = reached.Nodes();
+  auto degree = [this](NodeId node_id) { return Degree(node_id); };
+  std::nth_element(nodes.begin(), nodes.begin() + max_nodes, nodes.end(),
+                   [&distances, &degree](NodeId node1, NodeId node2) {
+                     if (distances[node1] != distances[node2]) {
+                       return distances[node1] < distances[node2];
+                     }
+                     size_t degree1 = degree(node1);
+                     size_t degree2 = degree(node2);
+                     if (degree1 != degree2) {
+                       return degree1 > degree2;
+                     }
+                     return node1 < node2;
+                   });
+  NodeSet neighborhood(NumNodes());
+  for (int i = 0; i < max_nodes; ++i) {
+    neighborhood.Insert(nodes[i]);
+  }
+  return neighborhood;
+}
+
+std::vector<NodeId> FindNodes(const LabeledGraph& graph,
+                              const std::vector<TaggedAST>& labels,
+                              const std::set<string>& tags) {
+  NodeSet nodes(graph.NumNodeIds());
+  for (const TaggedAST& label : labels) {
+    for (NodeId node_id : graph.GetNodes(label)) {
+      nodes.Insert(node_id);
+    }
+  }
+  if (!tags.empty()) {
+    std::vector<char> has_tag(graph.NumDistinctLabels(), 0);
+    for (LabelId label_id = 0; label_id < has_tag.size(); ++label_id) {
+      has_tag[label_id] = tags.count(graph.GetLabel(label_id).tag()) > 0;
+    }
+    const NodeId num_node_ids = static_cast<NodeId>(graph.NumNodeIds());
+    for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+      if (graph.HasNode(node_id) &&
+          has_tag[graph.GetNodeLabelId(node_id)] != 0) {
+        nodes.Insert(node_id);
+      }
+    }
+  }
+  return nodes.Nodes();
+}
+
+void HideNodesNotIn(const NodeSet& nodes, LabeledGraphView* view) {
+  const NodeId num_node_ids = static_cast<NodeId>(view->NumNodeIds());
+  for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+    if (!nodes.Contains(node_id) && view->HasNode(node_id)) {
+      view->HideNode(node_id);
+    }
+  }
+}
+
+NodeSet GraphTraversal::Search(const std::vector<NodeId>& sources,
+                               TraversalDirection direction, int max_hops,
+                               const std::vector<char>* allowed_labels,
+                               std::vector<int>* distances) {
+  if (compressed_graph_ != nullptr) {
+    return Search(*compressed_graph_, sources, direction, max_hops,
+                  allowed_labels, distances);
+  }
+  return Search(*graph_, sources, direction, max_hops, allowed_labels,
+                distances);
+}
+
+int GraphTraversal::NumNodes() const {
+  return compressed_graph_ != nullptr ? compressed_graph_->NumNodes()
+                                      : graph_->NumNodes();
+}
+
+int GraphTraversal::NumDistinctLabels() const {
+  return compressed_graph_ != nullptr ? compressed_graph_->NumDistinctLabels()
+                                      : graph_->NumDistinctLabels();
+}
+
+const TaggedAST& GraphTraversal::GetLabel(LabelId label_id) const {
+  return compressed_graph_ != nullptr ? compressed_graph_->GetLabel(label_id)
+                                      : graph_->GetLabel(label_id);
+}
+
+size_t GraphTraversal::Degree(NodeId node_id) const {
+  if (compressed_graph_ != nullptr) {
+    return compressed_graph_->GetSuccessorRange(node_id).size() +
+           compressed_graph_->GetPredecessorRange(node_id).size();
+  }
+  return graph_->GetSuccessorRange(node_id).size() +
+         graph_->GetPredecessorRange(node_id).size();
+}
+
+// The visited nodes are kept in a bitset of atomic words. Top-down expansion
+// splits the frontier between threads, and a thread adds a node to the next
+// frontier if it is the one that sets the bit of the node. Bottom-up expansion
+// splits the words of the bitset between threads, so that each word is only
+// written by one thread. Each thread collects the nodes it finds in a local
+// vector, which is appended to the next frontier once.
+template <typename GraphT>
+NodeSet GraphTraversal::Search(const GraphT& graph,
+                               const std::vector<NodeId>& sources,
+                               TraversalDirection direction, int max_hops,
+                               const std::vector<char>* allowed_labels,
+                               std::vector<int>* distances) {
+  using Range = decltype(graph.GetSuccessorRange(NodeId{0}));
+  const int num_nodes = graph.NumNodes();
+  const size_t num_words = NumWords(num_nodes);
+  std::unique_ptr<std::atomic<uint64_t>[]> visited(
+      new std::atomic<uint64_t>[num_words]);
+  for (size_t i = 0; i < num_words; ++i) {
+    visited[i].store(0, std::memory_order_relaxed);
+  }
+  if (distances != nullptr) {
+    distances->assign(num_nodes, kUnreachable);
+  }
+  auto is_allowed = [&graph, allowed_labels](NodeId node_id) {
+    return allowed_labels == nullptr ||
+           (*allowed_labels)[graph.GetNodeLabelId(node_id)] != 0;
+  };
+  auto degree = [&graph, direction](NodeId node_id) {
+    return static_cast<int64_t>(
+        Neighbors(graph, node_id, direction, false).size());
+  };
+
+  std::vector<NodeId> frontier;
+  int64_t unexplored_edges = graph.NumEdges();
+  for (NodeId source : sources) {
+    CHECK(graph.HasNode(source), kInvalidNodeErr);
+    uint64_t old_word =
+        visited[source / 64].fetch_or(Bit(source), std::memory_order_relaxed);
+    if ((old_word & Bit(source)) == 0) {
+      frontier.push_back(source);
+      unexplored_edges -= degree(source);
+      if (distances != nullptr) {
+        (*distances)[source] = 0;
+      }
+    }
+  }
+
+  std::mutex mutex;
+  std::vector<NodeId> next;
+  std::vector<uint64_t> frontier_bits;
+  bool bottom_up = false;
+  for (int hops = 1;
+       !frontier.empty() && (max_hops < 0 || hops <= max_hops); ++hops) {
+    int64_t frontier_edges = 0;
+    for (NodeId node_id : frontier) {
+      frontier_edges += degree(node_id);
+    }
+    if (!bottom_up) {
+      bottom_up = frontier_edges * kTopDownFactor > unexplored_edges;
+    } else {
+      bottom_up = static_cast<int64_t>(frontier.size()) * kBottomUpFactor >=
+                  num_nodes;
+    }
+    next.clear();
+    auto append = [&mutex, &next, distances, hops](
+        const std::vector<NodeId>& found) {
+      if (distances != nullptr) {
+        for (NodeId node_id : found) {
+          (*distances)[node_id] = hops;
+        }
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      next.insert(next.end(), found.begin(), found.end());
+    };
+    if (bottom_up) {
+      frontier_bits.assign(num_words, 0);
+      for (NodeId node_id : frontier) {
+        frontier_bits[node_id / 64] |= Bit(node_id);
+      }
+      util::ParallelFor(num_words, &pool_, [&](size_t begin, size_t end) {
+        std::vector<NodeId> found;
+        for (size_t i = begin; i < end; ++i) {
+          uint64_t word = visited[i].load(std::memory_order_relaxed);
+          uint64_t new_bits = 0;
+          NodeId first = static_cast<NodeId>(64 * i);
+          NodeId last = std::min<NodeId>(first + 64, num_nodes);
+          for (NodeId node_id = first; node_id < last; ++node_id) {
+            if ((word & Bit(node_id)) != 0 || !is_allowed(node_id)) {
+              continue;
+            }
+            if (ContainsAny(frontier_bits,
+                            Neighbors(graph, node_id, direction, true))) {
+              new_bits |= Bit(node_id);
+              found.push_back(node_id);
+            }
+          }
+          if (new_bits != 0) {
+            visited[i].store(word | new_bits, std::memory_order_relaxed);
+          }
+        }
+        append(found);
+      });
+    } else {
+      util::ParallelFor(frontier.size(), &pool_, [&](size_t begin,
+                                                     size_t end) {
+        std::vector<NodeId> found;
+        for (size_t i = begin; i < end; ++i) {
+          NeighborLists<Range> neighbors =
+              Neighbors(graph, frontier[i], direction, false);
+          for (const Range& list : neighbors.lists) {
+            for (NodeId neighbor : list) {
+              std::atomic<uint64_t>& word = visited[neighbor / 64];
+              if ((word.load(std::memory_order_relaxed) & Bit(neighbor)) !=
+                      0 ||
+                  !is_allowed(neighbor)) {
+                continue;
+              }
+              uint64_t old_word =
+                  word.fetch_or(Bit(neighbor), std::memory_order_relaxed);
+              if ((old_word & Bit(neighbor)) == 0) {
+                found.push_back(neighbor);
+              }
+            }
+          }
+        }
+        append(found);
+      });
+    }
+    for (NodeId node_id : next) {
+      unexplored_edges -= degree(node_id);
+    }
+    frontier.swap(next);
+  }
+
+  NodeSet result(num_nodes);
+  for (size_t i = 0; i < num_words; ++i) {
+    result.words_[i] = visited[i].load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+}  // namespace morphie
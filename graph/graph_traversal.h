@@ -0,0 +1,182 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A graph traversal answers reachability queries, such as which events are
+// downstream of a downloaded file, by breadth-first search over the compressed
+// sparse row arrays of a FrozenLabeledGraph, or over the compressed neighbor
+// lists of a CompressedLabeledGraph. The nodes found by a query are
+// returned as a NodeSet, which is a bitset with one bit per node identifier, so
+// that a query allocates no per-node containers.
+//
+// The search is level-synchronous: the nodes at distance d from the sources,
+// the frontier, are expanded in parallel to find the nodes at distance d + 1.
+// A level is expanded either top-down, by visiting the neighbors of every
+// frontier node, or bottom-up, by checking for every node that has not been
+// visited whether one of its reverse neighbors is in the frontier. Bottom-up
+// expansion stops at the first such neighbor, and is faster when the frontier
+// contains a large part of the graph. The direction is chosen for each level
+// with the heuristic of
+//   Beamer, Asanovic, Patterson (2012), "Direction-optimizing breadth-first
+//   search", SC '12.
+//
+// Example.
+//   FrozenLabeledGraph frozen(graph);
+//   GraphTraversal traversal(frozen, 4);
+//   NodeSet downstream =
+//       traversal.Reachable({file_node}, TraversalDirection::kForward);
+//   for (NodeId node_id : downstream.Nodes()) { ... }
+#ifndef LOGLE_GRAPH_TRAVERSAL_H_
+#define LOGLE_GRAPH_TRAVERSAL_H_
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "base/string.h"
+#include "graph/compressed_labeled_graph.h"
+#include "graph/frozen_labeled_graph.h"
+#include "graph/labeled_graph.h"
+#include "graph/labeled_graph_view.h"
+#include "util/thread_pool.h"
+
+namespace morphie {
+
+// A set of node identifiers below a bound, stored as a bitset.
+class NodeSet {
+ public:
+  // Constructs an empty set of identifiers below 'num_node_ids'.
+  explicit NodeSet(int num_node_ids);
+
+  int NumNodeIds() const { return num_node_ids_; }
+  bool Contains(NodeId node_id) const {
+    return node_id < static_cast<NodeId>(num_node_ids_) &&
+           ((words_[node_id / 64] >> (node_id % 64)) & 1) != 0;
+  }
+  // - Crashes unless 'node_id' is less than NumNodeIds().
+  void Insert(NodeId node_id);
+  // Returns the number of nodes in the set.
+  int Size() const;
+  // Returns the nodes in the set in increasing order.
+  std::vector<NodeId> Nodes() const;
+  // Node i is in the set if bit i % 64 of word i / 64 is set.
+  const std::vector<uint64_t>& Words() const { return words_; }
+
+ private:
+  friend class GraphTraversal;
+
+  int num_node_ids_;
+  std::vector<uint64_t> words_;
+};  // class NodeSet
+
+// The direction in which a traversal follows edges: from source to target for
+// the nodes downstream of the sources, from target to source for the nodes
+// upstream of them, or both ways for the nodes connected to them.
+enum class TraversalDirection { kForward, kBackward, kBoth };
+
+// The queries of a traversal return the sources of the query and the nodes
+// reachable from them. The results do not depend on the number of threads.
+// A traversal is not safe to query from several threads at once.
+class GraphTraversal {
+ public:
+  // Constructs a traversal that queries 'graph' on 'num_threads' threads.
+  // - Requires that 'graph' outlives the traversal.
+  // - Crashes unless 'num_threads' is positive.
+  GraphTraversal(const FrozenLabeledGraph& graph, int num_threads);
+  // Constructs a traversal of a frozen snapshot of 'graph', which is owned by
+  // the traversal and does not reflect later changes to 'graph'.
+  GraphTraversal(const LabeledGraph& graph, int num_threads);
+  // Constructs a traversal that queries 'graph', whose neighbor lists are
+  // decoded as they are visited.
+  // - Requires that 'graph' outlives the traversal.
+  // - Crashes unless 'num_threads' is positive.
+  GraphTraversal(const CompressedLabeledGraph& graph, int num_threads);
+  GraphTraversal(const GraphTraversal&) = delete;
+  GraphTraversal& operator=(const GraphTraversal&) = delete;
+
+  // - Crashes if the traversal queries a CompressedLabeledGraph.
+  const FrozenLabeledGraph& Graph() const;
+
+  // The functions below crash unless every node in 'sources' is in the graph.
+  //
+  // Returns the nodes reachable from 'sources' in 'direction'.
+  NodeSet Reachable(const std::vector<NodeId>& sources,
+                    TraversalDirection direction);
+  // Returns the length of the shortest path from 'sources' to each node in
+  // 'direction', or -1 for a node that is not reachable. The i-th entry of the
+  // result is the distance of node i.
+  std::vector<int> Distances(const std::vector<NodeId>& sources,
+                             TraversalDirection direction);
+  // Returns the nodes that are reachable from 'sources' in 'direction' by a
+  // path of at most 'max_hops' edges whose nodes, other than the first, have
+  // a label with a tag in 'tags'. If 'tags' is empty, every node may be on
+  // such a path.
+  // - Crashes if 'max_hops' is negative.
+  NodeSet ExpandHops(const std::vector<NodeId>& sources, int max_hops,
+                     const std::set<string>& tags,
+                     TraversalDirection direction);
+  // Returns at most 'max_nodes' of the nodes that are reachable from 'seeds'
+  // in 'direction' by a path of at most 'max_hops' edges, for rendering the
+  // region of a large graph around the seeds. If there are more such nodes,
+  // those closer to the seeds are preferred, then those with more edges, and
+  // then those with smaller identifiers. Every node of the result other than
+  // a seed is thus connected to a seed through nodes of the result.
+  // - Crashes if 'max_hops' or 'max_nodes' is negative.
+  NodeSet Neighborhood(const std::vector<NodeId>& seeds, int max_hops,
+                       int max_nodes, TraversalDirection direction);
+
+ private:
+  // Runs a breadth-first search of at most 'max_hops' levels, or of any number
+  // of levels if 'max_hops' is negative, that only enters nodes whose label id
+  // is marked in 'allowed_labels', or any node if it is null. If 'distances'
+  // is not null, it is set as by Distances().
+  NodeSet Search(const std::vector<NodeId>& sources,
+                 TraversalDirection direction, int max_hops,
+                 const std::vector<char>* allowed_labels,
+                 std::vector<int>* distances);
+  // Runs the search above on 'graph', which is the graph of the traversal.
+  template <typename GraphT>
+  NodeSet Search(const GraphT& graph, const std::vector<NodeId>& sources,
+                 TraversalDirection direction, int max_hops,
+                 const std::vector<char>* allowed_labels,
+                 std::vector<int>* distances);
+  // The functions below query the graph of the traversal.
+  int NumNodes() const;
+  int NumDistinctLabels() const;
+  const TaggedAST& GetLabel(LabelId label_id) const;
+  // Returns the number of edges that enter or leave 'node_id'.
+  size_t Degree(NodeId node_id) const;
+
+  // Set by the constructor that freezes a graph.
+  std::unique_ptr<FrozenLabeledGraph> owned_graph_;
+  // The graph of the traversal, of which one is null.
+  const FrozenLabeledGraph* graph_;
+  const CompressedLabeledGraph* compressed_graph_;
+  // The calling thread works alongside the workers of the pool.
+  util::ThreadPool pool_;
+};  // class GraphTraversal
+
+// Returns the nodes of 'graph' that have a label in 'labels' or a tag in
+// 'tags', in increasing order. The labels are looked up with GetNodes.
+std::vector<NodeId> FindNodes(const LabeledGraph& graph,
+                              const std::vector<TaggedAST>& labels,
+                              const std::set<string>& tags);
+
+// Hides the nodes of 'view' that are not in 'nodes', which leaves the subgraph
+// induced by 'nodes' visible.
+void HideNodesNotIn(const NodeSet& nodes, LabeledGraphView* view);
+
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_TRAVERSAL_H_
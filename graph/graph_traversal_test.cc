@@ -0,0 +1,271 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/graph_traversal.h"
+
+#include <deque>
+#include <vector>
+
+#include "graph/test_graphs.h"
+#include "graph/type.h"
+#include "graph/value.h"
+#include "graph/labeled_graph_view.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace {
+
+namespace type = ast::type;
+namespace value = ast::value;
+
+// Returns the distances from 'sources' computed by a serial breadth-first
+// search that follows edges forward, backward or both ways.
+std::vector<int> NaiveDistances(const LabeledGraph& graph,
+                                const std::vector<NodeId>& sources,
+                                TraversalDirection direction) {
+  std::vector<int> distances(graph.NumNodes(), -1);
+  std::deque<NodeId> queue;
+  for (NodeId source : sources) {
+    if (distances[source] < 0) {
+      distances[source] = 0;
+      queue.push_back(source);
+    }
+  }
+  while (!queue.empty()) {
+    NodeId node = queue.front();
+    queue.pop_front();
+    std::set<NodeId> neighbors;
+    if (direction != TraversalDirection::kBackward) {
+      neighbors = graph.GetSuccessors(node);
+    }
+    if (direction != TraversalDirection::kForward) {
+      std::set<NodeId> predecessors = graph.GetPredecessors(node);
+      neighbors.insert(predecessors.begin(), predecessors.end());
+    }
+    for (NodeId neighbor : neighbors) {
+      if (distances[neighbor] < 0) {
+        distances[neighbor] = distances[node] + 1;
+        queue.push_back(neighbor);
+      }
+    }
+  }
+  return distances;
+}
+
+TEST(NodeSetTest, StoresNodes) {
+  NodeSet nodes(130);
+  EXPECT_EQ(130, nodes.NumNodeIds());
+  EXPECT_EQ(0, nodes.Size());
+  nodes.Insert(0);
+  nodes.Insert(64);
+  nodes.Insert(129);
+  nodes.Insert(64);
+  EXPECT_EQ(3, nodes.Size());
+  EXPECT_TRUE(nodes.Contains(64));
+  EXPECT_FALSE(nodes.Contains(63));
+  EXPECT_FALSE(nodes.Contains(130));
+  EXPECT_EQ(std::vector<NodeId>({0, 64, 129}), nodes.Nodes());
+  EXPECT_EQ(3u, nodes.Words().size());
+}
+
+// Reachability and distances agree with a serial search in both directions on
+// sparse graphs, which are searched top-down, and on dense graphs, which are
+// mostly searched bottom-up, for any number of threads.
+TEST(GraphTraversalTest, MatchesNaiveSearch) {
+  for (double edge_probability : {0.002, 0.01, 0.2}) {
+    test::WeightedGraph weighted_graph;
+    test::GetErdosRenyiGraph(400, edge_probability, 5, 17, &weighted_graph);
+    const LabeledGraph& graph = *weighted_graph.GetGraph();
+    for (int num_threads : {1, 4}) {
+      GraphTraversal traversal(graph, num_threads);
+      for (TraversalDirection direction :
+           {TraversalDirection::kForward, TraversalDirection::kBackward,
+            TraversalDirection::kBoth}) {
+        for (const std::vector<NodeId>& sources :
+             std::vector<std::vector<NodeId>>({{0}, {3, 7, 3}, {}})) {
+          std::vector<int> expected =
+              NaiveDistances(graph, sources, direction);
+          EXPECT_EQ(expected, traversal.Distances(sources, direction))
+              << "probability " << edge_probability << ", threads "
+              << num_threads;
+          NodeSet reachable = traversal.Reachable(sources, direction);
+          for (NodeId node = 0; node < expected.size(); ++node) {
+            EXPECT_EQ(expected[node] >= 0, reachable.Contains(node));
+          }
+          NodeSet two_hops =
+              traversal.ExpandHops(sources, 2, {}, direction);
+          for (NodeId node = 0; node < expected.size(); ++node) {
+            EXPECT_EQ(expected[node] >= 0 && expected[node] <= 2,
+                      two_hops.Contains(node));
+          }
+        }
+      }
+    }
+  }
+}
+
+// A traversal of a compressed graph finds the same nodes as a traversal of the
+// frozen graph it was compressed from.
+TEST(GraphTraversalTest, TraversesCompressedGraphs) {
+  test::WeightedGraph weighted_graph;
+  test::GetErdosRenyiGraph(400, 0.01, 5, 17, &weighted_graph);
+  FrozenLabeledGraph frozen(*weighted_graph.GetGraph());
+  CompressedLabeledGraph compressed(frozen);
+  GraphTraversal frozen_traversal(frozen, 2);
+  GraphTraversal compressed_traversal(compressed, 2);
+  for (TraversalDirection direction :
+       {TraversalDirection::kForward, TraversalDirection::kBackward,
+        TraversalDirection::kBoth}) {
+    EXPECT_EQ(frozen_traversal.Distances({0, 5}, direction),
+              compressed_traversal.Distances({0, 5}, direction));
+    EXPECT_EQ(frozen_traversal.Neighborhood({0}, 3, 50, direction).Nodes(),
+              compressed_traversal.Neighborhood({0}, 3, 50, direction).Nodes());
+  }
+}
+
+// Construct the graph below, in which a download leads to files and events.
+//   download -> file1 -> event1 -> file2 -> event2
+//       |                                     ^
+//       +--------> event3 --------------------+
+TEST(GraphTraversalTest, ExpandsHopsThroughTags) {
+  LabeledGraph graph;
+  type::Types types = {{"Download", type::MakeInt("Download", false)},
+                       {"File", type::MakeInt("File", false)},
+                       {"Event", type::MakeInt("Event", false)}};
+  ASSERT_TRUE(graph.Initialize(types, {}, types, {}, type::MakeNull("Graph"))
+                  .ok());
+  auto add_node = [&graph](const string& tag, int id) {
+    TaggedAST label;
+    label.set_tag(tag);
+    *label.mutable_ast() = value::MakeInt(id);
+    return graph.FindOrAddNode(label);
+  };
+  NodeId download = add_node("Download", 0);
+  NodeId file1 = add_node("File", 1);
+  NodeId event1 = add_node("Event", 2);
+  NodeId file2 = add_node("File", 3);
+  NodeId event2 = add_node("Event", 4);
+  NodeId event3 = add_node("Event", 5);
+  TaggedAST edge_label;
+  edge_label.set_tag("Event");
+  *edge_label.mutable_ast() = value::MakeInt(0);
+  for (const auto& edge : std::vector<std::pair<NodeId, NodeId>>(
+           {{download, file1}, {file1, event1}, {event1, file2},
+            {file2, event2}, {download, event3}, {event3, event2}})) {
+    graph.FindOrAddEdge(edge.first, edge.second, edge_label);
+  }
+  GraphTraversal traversal(graph, 2);
+  EXPECT_EQ(6, traversal.Reachable({download}, TraversalDirection::kForward)
+                   .Size());
+  EXPECT_EQ(std::vector<NodeId>({download, file1, event3}),
+            traversal.ExpandHops({download}, 1, {},
+                                 TraversalDirection::kForward)
+                .Nodes());
+  // Only events may be entered, so the files are not reached.
+  EXPECT_EQ(std::vector<NodeId>({download, event2, event3}),
+            traversal.ExpandHops({download}, 5, {"Event"},
+                                 TraversalDirection::kForward)
+                .Nodes());
+  EXPECT_EQ(std::vector<NodeId>({download, file1, event1, file2}),
+            traversal.ExpandHops({file2}, 3, {"File", "Event", "Download"},
+                                 TraversalDirection::kBackward)
+                .Nodes());
+  EXPECT_EQ(std::vector<NodeId>({download}),
+            traversal.ExpandHops({download}, 0, {},
+                                 TraversalDirection::kForward)
+                .Nodes());
+}
+
+// Construct a star whose center 0 has the successors 1 to 4, where node 1 also
+// has the successors 5 and 6 and node 2 has the predecessor 7.
+TEST(GraphTraversalTest, FindsNeighborhoods) {
+  test::WeightedGraph star;
+  ASSERT_TRUE(star.Initialize().ok());
+  for (int i = 0; i < 8; ++i) {
+    star.AddNode(i);
+  }
+  for (const auto& edge : std::vector<std::pair<NodeId, NodeId>>(
+           {{0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 5}, {1, 6}, {7, 2}})) {
+    star.AddEdge(edge.first, edge.second, 0);
+  }
+  const LabeledGraph& graph = *star.GetGraph();
+  GraphTraversal traversal(graph, 2);
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 2, 3, 4}),
+            traversal.Neighborhood({0}, 1, 10, TraversalDirection::kForward)
+                .Nodes());
+  EXPECT_EQ(std::vector<NodeId>({0, 2, 7}),
+            traversal.Neighborhood({2}, 2, 10, TraversalDirection::kBackward)
+                .Nodes());
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 2, 3, 4, 7}),
+            traversal.Neighborhood({2}, 2, 10, TraversalDirection::kBoth)
+                .Nodes());
+  // Node 1 has the most edges and node 2 the next most, so they are kept.
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 2}),
+            traversal.Neighborhood({0}, 3, 3, TraversalDirection::kBoth)
+                .Nodes());
+  EXPECT_EQ(0, traversal.Neighborhood({0}, 3, 0, TraversalDirection::kBoth)
+                   .Size());
+}
+
+TEST(GraphTraversalTest, FindsAndShowsNodes) {
+  LabeledGraph graph;
+  type::Types types = {{"File", type::MakeInt("File", false)},
+                       {"Event", type::MakeInt("Event", false)}};
+  ASSERT_TRUE(graph.Initialize(types, {}, types, {}, type::MakeNull("Graph"))
+                  .ok());
+  std::vector<TaggedAST> labels;
+  for (const char* tag : {"File", "Event", "File", "Event"}) {
+    TaggedAST label;
+    label.set_tag(tag);
+    *label.mutable_ast() = value::MakeInt(labels.size());
+    graph.FindOrAddNode(label);
+    labels.push_back(label);
+  }
+  graph.FindOrAddEdge(0, 1, labels[1]);
+  graph.FindOrAddEdge(1, 2, labels[1]);
+  graph.FindOrAddEdge(2, 3, labels[3]);
+  EXPECT_EQ(std::vector<NodeId>({0, 2}), FindNodes(graph, {}, {"File"}));
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 3}),
+            FindNodes(graph, {labels[0]}, {"Event"}));
+  EXPECT_EQ(std::vector<NodeId>({2}),
+            FindNodes(graph, {labels[2], labels[2]}, {"Node"}));
+  NodeSet nodes(graph.NumNodes());
+  nodes.Insert(1);
+  nodes.Insert(2);
+  LabeledGraphView view(graph);
+  HideNodesNotIn(nodes, &view);
+  EXPECT_EQ(2, view.NumNodes());
+  EXPECT_EQ(1, view.NumEdges());
+  EXPECT_TRUE(view.HasNode(2));
+  EXPECT_FALSE(view.HasNode(3));
+}
+
+TEST(GraphTraversalDeathTest, RequiresValidArguments) {
+  test::WeightedGraph path;
+  test::GetPathGraph(3, &path);
+  EXPECT_DEATH({ GraphTraversal traversal(*path.GetGraph(), 0); },
+               "threads");
+  GraphTraversal traversal(*path.GetGraph(), 1);
+  EXPECT_DEATH({ traversal.Reachable({3}, TraversalDirection::kForward); },
+               "Invalid node");
+  EXPECT_DEATH(
+      { traversal.ExpandHops({0}, -1, {}, TraversalDirection::kForward); },
+      "hops");
+  EXPECT_DEATH(
+      { traversal.Neighborhood({0}, 1, -1, TraversalDirection::kBoth); },
+      "nodes");
+}
+
+}  // namespace
+}  // namespace morphie
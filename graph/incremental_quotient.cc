@@ -0,0 +1,218 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/incremental_quotient.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "graph/ast.h"
+#include "graph/labeled_graph_view.h"
+#include "util/logging.h"
+
+namespace morphie {
+namespace graph {
+
+namespace {
+
+const char kBlockErr[] = "The partition contains a negative block.";
+const char kNewNodesErr[] =
+    "The new blocks do not have one entry for each new node.";
+const char kNotInitializedErr[] = "The quotient is not initialized.";
+const char kOutputTypeErr[] = "The output graph type could not be copied.";
+const char kSharedNodeErr[] =
+    "Two blocks are labeled by the same output node.";
+
+const NodeId kNoNode = std::numeric_limits<NodeId>::max();
+
+// Returns true if the two vectors contain equal labels in the same order.
+bool EqualLabels(const std::vector<TaggedAST>& labels1,
+                 const std::vector<TaggedAST>& labels2) {
+  return labels1.size() == labels2.size() &&
+         std::equal(labels1.begin(), labels1.end(), labels2.begin(),
+                    [](const TaggedAST& label1, const TaggedAST& label2) {
+                      return ast::Equal(label1, label2);
+                    });
+}
+
+}  // namespace
+
+IncrementalQuotient::IncrementalQuotient(const LabeledGraph& input_graph,
+                                         const QuotientConfig& config,
+                                         const NodeLabelMergeFn& node_merge_fn,
+                                         const EdgeLabelMergeFn& edge_merge_fn)
+    : input_graph_(input_graph),
+      config_(config),
+      node_merge_fn_(node_merge_fn),
+      edge_merge_fn_(edge_merge_fn) {}
+
+// The quotient is constructed by QuotientMorphism, whose node map gives the
+// output node of each block. Blocks that share an output node leave fewer
+// output nodes than blocks.
+util::Status IncrementalQuotient::Initialize(
+    const std::vector<int>& partition) {
+  morphism_ = QuotientMorphism(LabeledGraphView(input_graph_), partition,
+                               config_);
+  if (!morphism_->HasOutputGraph()) {
+    morphism_.reset();
+    return util::Status(Code::INVALID_ARGUMENT, kOutputTypeErr);
+  }
+  partition_ = partition;
+  block_nodes_.clear();
+  int num_blocks = 0;
+  for (NodeId node = 0; node < partition_.size(); ++node) {
+    size_t block = partition_[node];
+    if (block >= block_nodes_.size()) {
+      block_nodes_.resize(block + 1, kNoNode);
+    }
+    if (block_nodes_[block] == kNoNode) {
+      block_nodes_[block] = morphism_->FindNodeImage(node).second;
+      ++num_blocks;
+    }
+  }
+  const LabeledGraph& output = morphism_->Output();
+  if (num_blocks != output.NumNodes()) {
+    morphism_.reset();
+    return util::Status(Code::INVALID_ARGUMENT, kSharedNodeErr);
+  }
+  edge_groups_.clear();
+  for (EdgeIterator edge_it = output.EdgeSetBegin();
+       edge_it != output.EdgeSetEnd(); ++edge_it) {
+    edge_groups_[{output.Source(*edge_it), output.Target(*edge_it)}]
+        .push_back(*edge_it);
+  }
+  return util::Status::OK;
+}
+
+// The new nodes are grouped by block with a sort of (block, node) pairs, and
+// the new edges by the pair of output nodes they connect with a map.
+util::Status IncrementalQuotient::Update(
+    const std::vector<int>& new_node_blocks,
+    const std::vector<EdgeId>& new_edges) {
+  CHECK(morphism_ != nullptr, kNotInitializedErr);
+  const size_t num_old_nodes = partition_.size();
+  CHECK(num_old_nodes + new_node_blocks.size() ==
+            static_cast<size_t>(input_graph_.NumNodeIds()),
+        kNewNodesErr);
+  std::vector<std::pair<int, NodeId>> new_nodes;
+  for (int block : new_node_blocks) {
+    CHECK(block >= 0, kBlockErr);
+    new_nodes.emplace_back(block, partition_.size());
+    partition_.push_back(block);
+  }
+  std::sort(new_nodes.begin(), new_nodes.end());
+  std::vector<NodeId> members;
+  for (size_t begin = 0; begin < new_nodes.size();) {
+    int block = new_nodes[begin].first;
+    size_t end = begin;
+    members.clear();
+    while (end < new_nodes.size() && new_nodes[end].first == block) {
+      members.push_back(new_nodes[end++].second);
+    }
+    bool is_new_block = static_cast<size_t>(block) >= block_nodes_.size() ||
+                        block_nodes_[block] == kNoNode;
+    util::Status status = is_new_block ? AddBlock(block, members)
+                                       : GrowBlock(block, members);
+    if (!status.ok()) {
+      return status;
+    }
+    begin = end;
+  }
+  for (NodeId node = num_old_nodes; node < partition_.size(); ++node) {
+    morphism_->MapNode(node, block_nodes_[partition_[node]]);
+  }
+  std::map<std::pair<NodeId, NodeId>, std::vector<EdgeId>> new_groups;
+  for (const EdgeId& edge : new_edges) {
+    NodeId source = block_nodes_[partition_[input_graph_.Source(edge)]];
+    NodeId target = block_nodes_[partition_[input_graph_.Target(edge)]];
+    if (config_.allow_self_edges || source != target) {
+      new_groups[{source, target}].push_back(edge);
+    }
+  }
+  for (const auto& group : new_groups) {
+    GrowEdges(group.first.first, group.first.second, group.second);
+  }
+  return util::Status::OK;
+}
+
+std::pair<bool, NodeId> IncrementalQuotient::FindNodeImage(
+    NodeId input_node) const {
+  CHECK(morphism_ != nullptr, kNotInitializedErr);
+  return morphism_->FindNodeImage(input_node);
+}
+
+// A label that does not change is not updated, because updating a node with
+// its own unique label is an error.
+util::Status IncrementalQuotient::GrowBlock(int block,
+                                            util::Span<NodeId> nodes) {
+  NodeId output_node = block_nodes_[block];
+  LabeledGraph* output = morphism_->MutableOutput();
+  const TaggedAST& label = output->GetNodeLabel(output_node);
+  TaggedAST new_label = node_merge_fn_(input_graph_, label, nodes);
+  if (ast::Equal(label, new_label)) {
+    return util::Status::OK;
+  }
+  return output->UpdateNodeLabel(output_node, new_label);
+}
+
+// An output node with a unique label is found rather than added if another
+// block has the same label, which leaves the number of output nodes unchanged.
+util::Status IncrementalQuotient::AddBlock(int block,
+                                           util::Span<NodeId> nodes) {
+  LabeledGraph* output = morphism_->MutableOutput();
+  int num_output_nodes = output->NumNodes();
+  NodeId output_node =
+      output->FindOrAddNode(config_.node_label_fn(input_graph_, nodes));
+  if (output->NumNodes() == num_output_nodes) {
+    return util::Status(Code::INVALID_ARGUMENT, kSharedNodeErr);
+  }
+  if (static_cast<size_t>(block) >= block_nodes_.size()) {
+    block_nodes_.resize(block + 1, kNoNode);
+  }
+  block_nodes_[block] = output_node;
+  return util::Status::OK;
+}
+
+// The existing output edges are replaced when their labels change. Equal labels
+// for the same pair of nodes give one output edge, as in QuotientGraph.
+void IncrementalQuotient::GrowEdges(NodeId source, NodeId target,
+                                    util::Span<EdgeId> edges) {
+  LabeledGraph* output = morphism_->MutableOutput();
+  std::vector<EdgeId>& output_edges = edge_groups_[{source, target}];
+  std::vector<TaggedAST> labels;
+  if (output_edges.empty()) {
+    labels = config_.edge_label_fn(input_graph_, edges);
+  } else {
+    std::vector<TaggedAST> old_labels;
+    for (const EdgeId& edge : output_edges) {
+      old_labels.push_back(output->GetEdgeLabel(edge));
+    }
+    labels = edge_merge_fn_(input_graph_, old_labels, edges);
+    if (EqualLabels(old_labels, labels)) {
+      return;
+    }
+    output->RemoveEdges(output_edges);
+    output_edges.clear();
+  }
+  for (TaggedAST& label : labels) {
+    EdgeId edge = output->FindOrAddEdge(source, target, std::move(label));
+    if (std::find(output_edges.begin(), output_edges.end(), edge) ==
+        output_edges.end()) {
+      output_edges.push_back(edge);
+    }
+  }
+}
+
+}  // namespace graph
+}  // namespace morphie
@@ -0,0 +1,137 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// An incremental quotient maintains the quotient graph of a growing input
+// graph with respect to a growing partition. QuotientGraph in
+// graph_transformer.h constructs the whole quotient and calls the label
+// functions on every block and every pair of blocks. When nodes and edges are
+// added to the input graph, an IncrementalQuotient only relabels the output
+// nodes of the blocks that the new nodes join and the output edges between the
+// blocks that the new edges connect, and adds nodes and edges for new blocks
+// and new pairs of blocks.
+//
+// Labels are updated by merge functions, which compute the label of a block
+// from its current label and its new nodes instead of from all of its nodes.
+// Aggregates such as the number of nodes of a block, the interval of their
+// timestamps or the set of their tags can be merged in this way.
+//
+// Example.
+//   IncrementalQuotient quotient(graph, config, merge_node_label,
+//                                merge_edge_labels);
+//   util::Status status = quotient.Initialize(partition);
+//   // Add nodes and edges to 'graph'.
+//   status = quotient.Update(new_node_blocks, new_edges);
+//   const LabeledGraph& summary = quotient.Output();
+#ifndef LOGLE_INCREMENTAL_QUOTIENT_H_
+#define LOGLE_INCREMENTAL_QUOTIENT_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "graph/graph_transformer.h"
+#include "graph/labeled_graph.h"
+#include "graph/morphism.h"
+#include "util/span.h"
+#include "util/status.h"
+
+namespace morphie {
+namespace graph {
+
+// A NodeLabelMergeFn takes the label of a block and the nodes that join the
+// block, in increasing order, and returns the new label of the block. An
+// EdgeLabelMergeFn takes the labels of the output edges between two blocks and
+// the new input edges between them, and returns the new labels.
+using NodeLabelMergeFn = std::function<TaggedAST(
+    const LabeledGraph&, const TaggedAST&, util::Span<NodeId>)>;
+using EdgeLabelMergeFn = std::function<std::vector<TaggedAST>(
+    const LabeledGraph&, const std::vector<TaggedAST>&, util::Span<EdgeId>)>;
+
+// The label functions of the configuration label new blocks and new pairs of
+// blocks, and the merge functions update the labels of existing ones. The
+// output graph is the graph that QuotientGraph constructs from the grown input
+// graph and partition, up to the identifiers and order of its nodes and edges,
+// if merging agrees with the label functions. That is, for disjoint sets of
+// nodes A and B, merging the label of A with B must give the label of the
+// union of A and B, and likewise for edges. Labels are merged in the order in
+// which edges are passed to Update, which need not be the order of the edge
+// iterator that QuotientGraph uses. A pair of blocks that has no output edges
+// is labeled by the edge label function.
+//
+// Every block must be labeled by its own output node, so the node labels of
+// distinct blocks must not be equal unique labels. The input graph must outlive
+// the quotient, and nodes and edges must not be removed from it.
+class IncrementalQuotient {
+ public:
+  IncrementalQuotient(const LabeledGraph& input_graph,
+                      const QuotientConfig& config,
+                      const NodeLabelMergeFn& node_merge_fn,
+                      const EdgeLabelMergeFn& edge_merge_fn);
+
+  // Constructs the quotient of the input graph with respect to 'partition',
+  // which has one non-negative block identifier for each node. Returns
+  // - Code::INVALID_ARGUMENT if the output graph type cannot be copied, or if
+  //   two blocks are labeled by the same output node.
+  // - Crashes under the conditions of the vector version of QuotientGraph.
+  util::Status Initialize(const std::vector<int>& partition);
+
+  // Updates the quotient after nodes and edges were added to the input graph.
+  // The i-th entry of 'new_node_blocks' is the block of the i-th node added
+  // since the last update, and the edges added since the last update must be
+  // in 'new_edges'. Labels are computed on the calling thread. Returns
+  // - Code::INVALID_ARGUMENT if a new block would be labeled by the output
+  //   node of another block, or if the label of a block cannot be updated.
+  //   The output graph may then reflect part of the update.
+  // - Crashes unless the quotient is initialized, 'new_node_blocks' has one
+  //   non-negative entry for each new node, and 'new_edges' are edges of the
+  //   input graph.
+  util::Status Update(const std::vector<int>& new_node_blocks,
+                      const std::vector<EdgeId>& new_edges);
+
+  // Returns the quotient graph.
+  // - Requires that the quotient is initialized.
+  const LabeledGraph& Output() const { return morphism_->Output(); }
+  // Returns (true, n) if 'input_node' is in the block of the output node n,
+  // and (false, 0) otherwise.
+  std::pair<bool, NodeId> FindNodeImage(NodeId input_node) const;
+
+ private:
+  // Relabel the output node of an existing block, or add an output node for
+  // a new block, with the nodes that join the block.
+  util::Status GrowBlock(int block, util::Span<NodeId> nodes);
+  util::Status AddBlock(int block, util::Span<NodeId> nodes);
+  // Relabels or adds the output edges from 'source' to 'target' given the
+  // input edges between their blocks that were added.
+  void GrowEdges(NodeId source, NodeId target, util::Span<EdgeId> edges);
+
+  const LabeledGraph& input_graph_;
+  const QuotientConfig config_;
+  NodeLabelMergeFn node_merge_fn_;
+  EdgeLabelMergeFn edge_merge_fn_;
+  // Maps the input graph to the output graph.
+  std::unique_ptr<Morphism> morphism_;
+  std::vector<int> partition_;
+  // The output node of each block, or kNoNode for block identifiers that are
+  // not used.
+  std::vector<NodeId> block_nodes_;
+  // The output edges between each pair of output nodes.
+  std::map<std::pair<NodeId, NodeId>, std::vector<EdgeId>> edge_groups_;
+};  // class IncrementalQuotient
+
+}  // namespace graph
+}  // namespace morphie
+
+#endif  // LOGLE_INCREMENTAL_QUOTIENT_H_
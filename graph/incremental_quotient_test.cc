@@ -0,0 +1,184 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/incremental_quotient.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "graph/labeled_graph_view.h"
+#include "graph/test_graphs.h"
+#include "graph/type.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace graph {
+namespace {
+
+using test::EdgeCountLabel;
+using test::EdgeWeightLabel;
+using test::NodeWeightLabel;
+using test::Weight;
+
+// Label and merge functions that count the nodes of a block and the edges
+// between two blocks, along with EdgeCountLabel.
+TaggedAST NodeCountLabel(const LabeledGraph& graph, util::Span<NodeId> nodes) {
+  return NodeWeightLabel(static_cast<int>(nodes.size()));
+}
+
+TaggedAST MergeNodeCount(const LabeledGraph& graph, const TaggedAST& label,
+                         util::Span<NodeId> nodes) {
+  return NodeWeightLabel(Weight(label) + static_cast<int>(nodes.size()));
+}
+
+std::vector<TaggedAST> MergeEdgeCount(const LabeledGraph& graph,
+                                      const std::vector<TaggedAST>& labels,
+                                      util::Span<EdgeId> edges) {
+  return {
+      EdgeWeightLabel(Weight(labels[0]) + static_cast<int>(edges.size()))};
+}
+
+// Describes a quotient independently of the identifiers of its nodes and
+// edges. Each output node is named by the smallest input node that maps to it.
+struct QuotientDescription {
+  std::set<std::pair<NodeId, int>> nodes;
+  std::multiset<std::tuple<NodeId, NodeId, int>> edges;
+};
+
+template <typename QuotientT>
+QuotientDescription Describe(const LabeledGraph& input,
+                             const QuotientT& quotient) {
+  const LabeledGraph& output = quotient.Output();
+  std::map<NodeId, NodeId> names;
+  for (NodeId node = 0; node < static_cast<NodeId>(input.NumNodes()); ++node) {
+    names.insert({quotient.FindNodeImage(node).second, node});
+  }
+  QuotientDescription description;
+  for (const auto& node_name : names) {
+    description.nodes.insert(
+        {node_name.second, Weight(output.GetNodeLabel(node_name.first))});
+  }
+  for (auto edge_it = output.EdgeSetBegin(); edge_it != output.EdgeSetEnd();
+       ++edge_it) {
+    description.edges.insert(std::make_tuple(
+        names[output.Source(*edge_it)], names[output.Target(*edge_it)],
+        Weight(output.GetEdgeLabel(*edge_it))));
+  }
+  return description;
+}
+
+void ExpectSameQuotient(const LabeledGraph& input,
+                        const std::vector<int>& partition,
+                        const QuotientConfig& config,
+                        const IncrementalQuotient& quotient) {
+  std::unique_ptr<Morphism> expected =
+      QuotientMorphism(LabeledGraphView(input), partition, config);
+  QuotientDescription expected_description = Describe(input, *expected);
+  QuotientDescription description = Describe(input, quotient);
+  EXPECT_EQ(expected_description.nodes, description.nodes);
+  EXPECT_EQ(expected_description.edges, description.edges);
+}
+
+// Nodes and edges are added to a random graph in rounds, joining existing and
+// new blocks, and the incremental quotient agrees with the quotient of the
+// grown graph after every round. Blocks that only grow are not labeled again.
+TEST(IncrementalQuotientTest, MatchesQuotientGraph) {
+  std::mt19937 generator(5);
+  for (bool allow_self_edges : {false, true}) {
+    test::WeightedGraph weighted_graph;
+    test::GetErdosRenyiGraph(40, 0.05, 4, 17, &weighted_graph);
+    const LabeledGraph& graph = *weighted_graph.GetGraph();
+    std::vector<int> partition;
+    for (int node = 0; node < graph.NumNodes(); ++node) {
+      partition.push_back(2 * (node % 5));
+    }
+    int num_node_labels = 0;
+    QuotientConfig config(
+        graph,
+        [&num_node_labels](const LabeledGraph& graph,
+                           util::Span<NodeId> nodes) {
+          ++num_node_labels;
+          return NodeCountLabel(graph, nodes);
+        },
+        EdgeCountLabel, allow_self_edges);
+    IncrementalQuotient quotient(graph, config, MergeNodeCount,
+                                 MergeEdgeCount);
+    ASSERT_TRUE(quotient.Initialize(partition).ok());
+    ExpectSameQuotient(graph, partition, config, quotient);
+    for (int round = 0; round < 6; ++round) {
+      // Block 2 * round + 1 is the only new block of a round.
+      std::vector<int> new_node_blocks = {2 * round % 10, round,
+                                          2 * round + 1};
+      for (int block : new_node_blocks) {
+        weighted_graph.AddNode(block);
+        partition.push_back(block);
+      }
+      std::uniform_int_distribution<int> node_dist(0, graph.NumNodes() - 1);
+      std::vector<EdgeId> new_edges;
+      for (int i = 0; i < 8; ++i) {
+        new_edges.push_back(weighted_graph.AddEdge(node_dist(generator),
+                                                   node_dist(generator), i));
+      }
+      num_node_labels = 0;
+      ASSERT_TRUE(quotient.Update(new_node_blocks, new_edges).ok());
+      EXPECT_EQ(1, num_node_labels) << "round " << round;
+      ExpectSameQuotient(graph, partition, config, quotient);
+    }
+  }
+}
+
+// A new block whose unique label is the label of an existing block cannot get
+// its own output node.
+TEST(IncrementalQuotientTest, RejectsSharedOutputNodes) {
+  test::WeightedGraph path;
+  test::GetPathGraph(3, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  LabeledGraph graph_type;
+  ast::type::Types node_types = {
+      {"Node-Weight", ast::type::MakeInt("Size", false)}};
+  ast::type::Types edge_types = {
+      {"Edge-Weight", ast::type::MakeInt("Count", false)}};
+  ASSERT_TRUE(graph_type.Initialize(node_types, {"Node-Weight"}, edge_types,
+                                    {}, ast::type::MakeNull("Sizes"))
+                  .ok());
+  QuotientConfig config(graph_type, NodeCountLabel, EdgeCountLabel, true);
+  IncrementalQuotient shared(graph, config, MergeNodeCount, MergeEdgeCount);
+  EXPECT_EQ(Code::INVALID_ARGUMENT, shared.Initialize({0, 1, 2}).code());
+  IncrementalQuotient quotient(graph, config, MergeNodeCount, MergeEdgeCount);
+  ASSERT_TRUE(quotient.Initialize({0, 1, 1}).ok());
+  EXPECT_EQ(2, quotient.Output().NumNodes());
+  path.AddNode(3);
+  EXPECT_EQ(Code::INVALID_ARGUMENT, quotient.Update({2}, {}).code());
+}
+
+TEST(IncrementalQuotientDeathTest, RequiresOneBlockPerNewNode) {
+  test::WeightedGraph path;
+  test::GetPathGraph(3, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  QuotientConfig config(graph, NodeCountLabel, EdgeCountLabel, true);
+  IncrementalQuotient quotient(graph, config, MergeNodeCount, MergeEdgeCount);
+  EXPECT_DEATH({ quotient.Update({}, {}); },
+               "The quotient is not initialized.");
+  ASSERT_TRUE(quotient.Initialize({0, 0, 1}).ok());
+  EXPECT_DEATH({ quotient.Update({0}, {}); },
+               "The new blocks do not have one entry for each new node.");
+}
+
+}  // namespace
+}  // namespace graph
+}  // namespace morphie
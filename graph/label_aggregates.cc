@@ -0,0 +1,379 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/label_aggregates.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include "graph/type.h"
+#include "graph/value.h"
+
+namespace morphie {
+namespace graph {
+
+namespace {
+
+// Marks labels without a string in a string column.
+const int kNoString = -1;
+
+// Returns the AST at the path 'field' in 'label', or null if there is none.
+const AST* FindPath(const TaggedAST& label, const std::vector<int>& field) {
+  if (!label.has_ast()) {
+    return nullptr;
+  }
+  const AST* ast = &label.ast();
+  for (int index : field) {
+    if (!ast->has_c_ast() || index < 0 || index >= ast->c_ast().arg_size()) {
+      return nullptr;
+    }
+    ast = &ast->c_ast().arg(index);
+  }
+  return ast;
+}
+
+bool IsNullValue(const AST& ast) {
+  return ast.has_p_ast() ? !ast.p_ast().has_val() : !ast.has_c_ast();
+}
+
+// Returns the value of 'field' in 'label', or null if the label has no value
+// for the field.
+const AST* FindField(const TaggedAST& label, const std::vector<int>& field) {
+  const AST* ast = FindPath(label, field);
+  return ast == nullptr || IsNullValue(*ast) ? nullptr : ast;
+}
+
+bool GetTime(const AST* field, int64_t* time) {
+  if (field == nullptr || !field->has_p_ast() ||
+      !field->p_ast().val().has_time_val()) {
+    return false;
+  }
+  *time = field->p_ast().val().time_val();
+  return true;
+}
+
+const string* GetString(const AST* field) {
+  if (field == nullptr || !field->has_p_ast() ||
+      !field->p_ast().val().has_string_val()) {
+    return nullptr;
+  }
+  return &field->p_ast().val().string_val();
+}
+
+TaggedAST MakeLabel(const string& tag, AST&& ast) {
+  TaggedAST label;
+  label.set_tag(tag);
+  label.mutable_ast()->Swap(&ast);
+  return label;
+}
+
+// The bounds of the interval are null unless 'times' is not empty. The minimum
+// and maximum are computed in one pass without branches, so the loop is
+// vectorized.
+TaggedAST MakeIntervalLabel(const string& tag,
+                            const std::vector<int64_t>& times) {
+  AST interval = ast::value::MakeMaxInterval(PrimitiveType::TIMESTAMP);
+  if (!times.empty()) {
+    int64_t min_time = times[0];
+    int64_t max_time = times[0];
+    for (int64_t time : times) {
+      min_time = std::min(min_time, time);
+      max_time = std::max(max_time, time);
+    }
+    *interval.mutable_c_ast()->mutable_arg(0) =
+        ast::value::MakeTimestampFromUnixMicros(min_time);
+    *interval.mutable_c_ast()->mutable_arg(1) =
+        ast::value::MakeTimestampFromUnixMicros(max_time);
+  }
+  return MakeLabel(tag, std::move(interval));
+}
+
+// A set builder puts the strings in canonical order, so the set does not
+// depend on the order of 'strings'.
+TaggedAST MakeStringSetLabel(const string& tag,
+                             const std::vector<const string*>& strings) {
+  ast::value::SetBuilder builder(ast::type::MakeSet(
+      "strings", false, ast::type::MakeString("string", false)));
+  for (const string* str : strings) {
+    builder.Insert(ast::value::MakeString(*str));
+  }
+  return MakeLabel(tag, builder.Build());
+}
+
+TaggedAST MakeFieldLabel(const string& tag, const AST* field) {
+  if (field == nullptr) {
+    return MakeLabel(tag, ast::value::MakeNull());
+  }
+  return MakeLabel(tag, AST(*field));
+}
+
+// Returns a bound on the node identifiers of a graph or a view.
+size_t NodeIdBound(const LabeledGraph& graph) { return graph.NumNodes(); }
+size_t NodeIdBound(const LabeledGraphView& view) { return view.NumNodeIds(); }
+
+// Returns the class of each distinct label of 'graph', where labels with the
+// same key under 'label_key' are in the same class, and sets '*num_classes'.
+template <typename KeyFn>
+std::vector<int> ClassifyLabels(const LabeledGraph& graph,
+                                const KeyFn& label_key, int* num_classes) {
+  std::unordered_map<string, int> classes;
+  std::vector<int> label_classes(graph.NumDistinctLabels());
+  for (LabelId label_id = 0; label_id < label_classes.size(); ++label_id) {
+    label_classes[label_id] =
+        classes.emplace(label_key(graph.GetLabel(label_id)), classes.size())
+            .first->second;
+  }
+  *num_classes = static_cast<int>(classes.size());
+  return label_classes;
+}
+
+// Returns the partition of the nodes of 'graph' by the classes of their
+// labels in 'label_classes', with blocks numbered in the order of their
+// smallest node and -1 for identifiers that are not nodes.
+template <typename GraphT>
+std::vector<int> PartitionByClass(const GraphT& graph,
+                                  const std::vector<int>& label_classes,
+                                  int num_classes) {
+  std::vector<int> class_blocks(num_classes, -1);
+  std::vector<int> partition(NodeIdBound(graph), -1);
+  int num_blocks = 0;
+  for (NodeId node_id = 0; node_id < partition.size(); ++node_id) {
+    if (!graph.HasNode(node_id)) {
+      continue;
+    }
+    int& block = class_blocks[label_classes[graph.GetNodeLabelId(node_id)]];
+    if (block < 0) {
+      block = num_blocks++;
+    }
+    partition[node_id] = block;
+  }
+  return partition;
+}
+
+// Every distinct label is a class of its own.
+template <typename GraphT>
+std::vector<int> PartitionByLabelId(const GraphT& graph,
+                                    const LabeledGraph& labels) {
+  std::vector<int> label_classes(labels.NumDistinctLabels());
+  for (size_t label_id = 0; label_id < label_classes.size(); ++label_id) {
+    label_classes[label_id] = static_cast<int>(label_id);
+  }
+  return PartitionByClass(graph, label_classes,
+                          static_cast<int>(label_classes.size()));
+}
+
+template <typename GraphT>
+std::vector<int> PartitionByTagKey(const GraphT& graph,
+                                   const LabeledGraph& labels) {
+  int num_classes = 0;
+  std::vector<int> label_classes = ClassifyLabels(
+      labels, [](const TaggedAST& label) { return label.tag(); },
+      &num_classes);
+  return PartitionByClass(graph, label_classes, num_classes);
+}
+
+// The key of a label is its tag, followed by the serialized value of the field
+// if the label has one. The tag is preceded by its size, so that no tag and
+// value concatenate to the key of another tag.
+template <typename GraphT>
+std::vector<int> PartitionByFieldKey(const GraphT& graph,
+                                     const LabeledGraph& labels,
+                                     const std::vector<int>& field) {
+  int num_classes = 0;
+  std::vector<int> label_classes = ClassifyLabels(
+      labels,
+      [&field](const TaggedAST& label) {
+        string key = std::to_string(label.tag().size());
+        key.push_back(':');
+        key.append(label.tag());
+        const AST* value = FindField(label, field);
+        if (value != nullptr) {
+          key.push_back(':');
+          key.append(value->SerializeAsString());
+        }
+        return key;
+      },
+      &num_classes);
+  return PartitionByClass(graph, label_classes, num_classes);
+}
+
+}  // namespace
+
+LabelAggregate LabelAggregate::Count(const string& tag) {
+  return LabelAggregate(Kind::kCount, tag, {});
+}
+
+LabelAggregate LabelAggregate::TimestampInterval(
+    const string& tag, const std::vector<int>& field) {
+  return LabelAggregate(Kind::kTimestampInterval, tag, field);
+}
+
+LabelAggregate LabelAggregate::StringSet(const string& tag,
+                                         const std::vector<int>& field) {
+  return LabelAggregate(Kind::kStringSet, tag, field);
+}
+
+LabelAggregate LabelAggregate::First(const string& tag,
+                                     const std::vector<int>& field) {
+  return LabelAggregate(Kind::kFirst, tag, field);
+}
+
+LabelAggregate LabelAggregate::Last(const string& tag,
+                                    const std::vector<int>& field) {
+  return LabelAggregate(Kind::kLast, tag, field);
+}
+
+TaggedAST LabelAggregate::Aggregate(const LabeledGraph& graph,
+                                    util::Span<LabelId> label_ids) const {
+  switch (kind_) {
+    case Kind::kCount:
+      return MakeLabel(tag_, ast::value::MakeInt(
+                                 static_cast<int>(label_ids.size())));
+    case Kind::kTimestampInterval: {
+      std::vector<int64_t> times;
+      int64_t time;
+      for (LabelId label_id : label_ids) {
+        if (GetTime(FindField(graph.GetLabel(label_id), field_), &time)) {
+          times.push_back(time);
+        }
+      }
+      return MakeIntervalLabel(tag_, times);
+    }
+    case Kind::kStringSet: {
+      std::vector<const string*> strings;
+      for (LabelId label_id : label_ids) {
+        const string* str = GetString(FindField(graph.GetLabel(label_id),
+                                                field_));
+        if (str != nullptr) {
+          strings.push_back(str);
+        }
+      }
+      return MakeStringSetLabel(tag_, strings);
+    }
+    case Kind::kFirst:
+    case Kind::kLast: {
+      // A typed null value of the field is kept in case no label has a value.
+      const AST* null_field = nullptr;
+      for (size_t i = 0; i < label_ids.size(); ++i) {
+        LabelId label_id =
+            label_ids[kind_ == Kind::kFirst ? i : label_ids.size() - 1 - i];
+        const AST* field = FindPath(graph.GetLabel(label_id), field_);
+        if (field == nullptr) {
+          continue;
+        }
+        if (!IsNullValue(*field)) {
+          return MakeFieldLabel(tag_, field);
+        }
+        if (null_field == nullptr) {
+          null_field = field;
+        }
+      }
+      return MakeFieldLabel(tag_, null_field);
+    }
+  }
+  return MakeFieldLabel(tag_, nullptr);
+}
+
+// Counts, first and last values read at most a few labels per block, so only
+// timestamps and strings are stored in columns.
+AggregateColumn::AggregateColumn(const LabelAggregate& aggregate,
+                                 const LabeledGraph& graph)
+    : aggregate_(aggregate), graph_(graph) {
+  const LabelId num_labels = graph.NumDistinctLabels();
+  const std::vector<int>& field = aggregate.GetField();
+  if (aggregate.GetKind() == LabelAggregate::Kind::kTimestampInterval) {
+    times_.assign(num_labels, 0);
+    has_time_.assign(num_labels, 0);
+    for (LabelId label_id = 0; label_id < num_labels; ++label_id) {
+      const AST* time = FindField(graph.GetLabel(label_id), field);
+      has_time_[label_id] = GetTime(time, &times_[label_id]);
+    }
+  } else if (aggregate.GetKind() == LabelAggregate::Kind::kStringSet) {
+    std::unordered_map<string, int> string_ids;
+    string_ids_.assign(num_labels, kNoString);
+    for (LabelId label_id = 0; label_id < num_labels; ++label_id) {
+      const string* str = GetString(FindField(graph.GetLabel(label_id), field));
+      if (str != nullptr) {
+        auto insert_result =
+            string_ids.insert({*str, static_cast<int>(strings_.size())});
+        if (insert_result.second) {
+          strings_.push_back(*str);
+        }
+        string_ids_[label_id] = insert_result.first->second;
+      }
+    }
+  }
+}
+
+TaggedAST AggregateColumn::Aggregate(util::Span<LabelId> label_ids) const {
+  switch (aggregate_.GetKind()) {
+    case LabelAggregate::Kind::kTimestampInterval: {
+      std::vector<int64_t> times;
+      times.reserve(label_ids.size());
+      for (LabelId label_id : label_ids) {
+        if (has_time_[label_id]) {
+          times.push_back(times_[label_id]);
+        }
+      }
+      return MakeIntervalLabel(aggregate_.GetTag(), times);
+    }
+    case LabelAggregate::Kind::kStringSet: {
+      std::vector<int> ids;
+      for (LabelId label_id : label_ids) {
+        if (string_ids_[label_id] != kNoString) {
+          ids.push_back(string_ids_[label_id]);
+        }
+      }
+      std::sort(ids.begin(), ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+      std::vector<const string*> strings;
+      for (int id : ids) {
+        strings.push_back(&strings_[id]);
+      }
+      return MakeStringSetLabel(aggregate_.GetTag(), strings);
+    }
+    default:
+      return aggregate_.Aggregate(graph_, label_ids);
+  }
+}
+
+std::vector<int> PartitionByTag(const LabeledGraph& graph) {
+  return PartitionByTagKey(graph, graph);
+}
+
+std::vector<int> PartitionByTag(const LabeledGraphView& view) {
+  return PartitionByTagKey(view, view.Graph());
+}
+
+std::vector<int> PartitionByLabel(const LabeledGraph& graph) {
+  return PartitionByLabelId(graph, graph);
+}
+
+std::vector<int> PartitionByLabel(const LabeledGraphView& view) {
+  return PartitionByLabelId(view, view.Graph());
+}
+
+std::vector<int> PartitionByField(const LabeledGraph& graph,
+                                  const std::vector<int>& field) {
+  return PartitionByFieldKey(graph, graph, field);
+}
+
+std::vector<int> PartitionByField(const LabeledGraphView& view,
+                                  const std::vector<int>& field) {
+  return PartitionByFieldKey(view, view.Graph(), field);
+}
+
+}  // namespace graph
+}  // namespace morphie
@@ -0,0 +1,146 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Built-in aggregate label functions for quotients. A label function written
+// as a NodeLabelFn or EdgeLabelFn is opaque to QuotientGraph, so it is called
+// for every block and typically reads the label of every member. A
+// LabelAggregate is a description of one of a fixed set of aggregates, which
+// QuotientGraph recognizes. It then projects the aggregated field out of each
+// distinct label of the input graph once, into an array indexed by label id,
+// and computes the label of a block from that array.
+//
+// Example.
+//   // Label each block with the interval of the timestamps in the first field
+//   // of its labels, and each pair of blocks with its number of edges.
+//   QuotientConfig config(output_type,
+//                         LabelAggregate::TimestampInterval("Time", {0}),
+//                         LabelAggregate::Count("Count"), false);
+//   std::unique_ptr<LabeledGraph> quotient =
+//       QuotientGraph(graph, partition, config);
+#ifndef LOGLE_LABEL_AGGREGATES_H_
+#define LOGLE_LABEL_AGGREGATES_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/string.h"
+#include "graph/label_store.h"
+#include "graph/labeled_graph.h"
+#include "graph/labeled_graph_view.h"
+#include "util/span.h"
+#include "ast.pb.h"
+
+namespace morphie {
+namespace graph {
+
+// A field of a label is given by a path of argument indexes. The empty path is
+// the AST of the label, and the path {i, j} is argument j of argument i of the
+// AST, as for a field of a tuple nested in a tuple. A label has no value for a
+// field if the path does not exist in its AST or leads to a null value.
+//
+// The aggregates of a sequence of labels below are labels with the tag of the
+// aggregate. Labels without a value for the field are skipped.
+// - Count: the number of labels, as an int.
+// - TimestampInterval: the interval from the smallest to the largest timestamp
+//   in the field, or the interval with two null bounds if no label has one.
+// - StringSet: the set of distinct strings in the field.
+// - First, Last: the value of the field in the first or last label that has
+//   one. If no label has one, the null value of the field in the first or
+//   last label with the path, or the null value if there is none.
+// The members of a block are in increasing order of their node ids, and the
+// edges between two blocks in the order of the edge iterator of the input
+// graph, as for span label functions.
+class LabelAggregate {
+ public:
+  enum class Kind { kCount, kTimestampInterval, kStringSet, kFirst, kLast };
+
+  static LabelAggregate Count(const string& tag);
+  static LabelAggregate TimestampInterval(const string& tag,
+                                          const std::vector<int>& field);
+  static LabelAggregate StringSet(const string& tag,
+                                  const std::vector<int>& field);
+  static LabelAggregate First(const string& tag, const std::vector<int>& field);
+  static LabelAggregate Last(const string& tag, const std::vector<int>& field);
+
+  Kind GetKind() const { return kind_; }
+  const string& GetTag() const { return tag_; }
+  const std::vector<int>& GetField() const { return field_; }
+
+  // Returns the aggregate of the labels with ids 'label_ids' in 'graph'. Each
+  // call reads the field of every label.
+  TaggedAST Aggregate(const LabeledGraph& graph,
+                      util::Span<LabelId> label_ids) const;
+
+ private:
+  LabelAggregate(Kind kind, const string& tag, const std::vector<int>& field)
+      : kind_(kind), tag_(tag), field_(field) {}
+
+  Kind kind_;
+  string tag_;
+  std::vector<int> field_;
+};  // class LabelAggregate
+
+// An AggregateColumn stores the field of an aggregate for every distinct label
+// of a graph, as an array of timestamps or of string indexes, so that
+// aggregating a block reads one array entry per member. The column is
+// constructed in time linear in the number of distinct labels of the graph.
+// The minimum and maximum of the timestamps of a block are computed by a loop
+// over a contiguous array, which the compiler vectorizes. Aggregate returns
+// the same labels as LabelAggregate::Aggregate and may be called concurrently.
+class AggregateColumn {
+ public:
+  // - Requires that 'aggregate' and 'graph' outlive the column, and that no
+  //   labels are added to 'graph' while the column is used.
+  AggregateColumn(const LabelAggregate& aggregate, const LabeledGraph& graph);
+
+  TaggedAST Aggregate(util::Span<LabelId> label_ids) const;
+
+ private:
+  const LabelAggregate& aggregate_;
+  const LabeledGraph& graph_;
+  // For timestamp intervals, the timestamp of each label and whether it has
+  // one. For string sets, the index in 'strings_' of the string of each label,
+  // or -1.
+  std::vector<int64_t> times_;
+  std::vector<char> has_time_;
+  std::vector<int> string_ids_;
+  std::vector<string> strings_;
+};  // class AggregateColumn
+
+// Initial partitions for RefinePartition and QuotientGraph, which group the
+// nodes of a graph by their tag, by their label, or by their tag and the value
+// of 'field' in their label. Nodes whose labels have no value for the field
+// are grouped by tag. The partition of the empty field is the partition by
+// label. A partition is a vector whose i-th entry is the block of node i, and
+// blocks are numbered from 0 in the order of their smallest node. Each
+// distinct label of the graph is examined once, through the label ids of the
+// nodes, so a partition takes time linear in the number of nodes and distinct
+// labels and copies no labels. The view versions return a vector with one
+// entry for each node identifier below view.NumNodeIds(), in which the entries
+// of nodes that are not in the view are -1, as for the vector versions of
+// RefinePartition for views.
+std::vector<int> PartitionByTag(const LabeledGraph& graph);
+std::vector<int> PartitionByTag(const LabeledGraphView& view);
+std::vector<int> PartitionByLabel(const LabeledGraph& graph);
+std::vector<int> PartitionByLabel(const LabeledGraphView& view);
+std::vector<int> PartitionByField(const LabeledGraph& graph,
+                                  const std::vector<int>& field);
+std::vector<int> PartitionByField(const LabeledGraphView& view,
+                                  const std::vector<int>& field);
+
+}  // namespace graph
+}  // namespace morphie
+
+#endif  // LOGLE_LABEL_AGGREGATES_H_
@@ -0,0 +1,245 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/label_aggregates.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "graph/ast.h"
+#include "graph/graph_transformer.h"
+#include "graph/type.h"
+#include "graph/value.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace graph {
+namespace {
+
+namespace type = ast::type;
+namespace value = ast::value;
+
+const char kEventTag[] = "Event";
+const char kLinkTag[] = "Link";
+
+// Events are tuples of a nullable timestamp and a nullable file name.
+AST EventType() {
+  return type::MakeTuple("Event", false, {type::MakeTimestamp("Time", true),
+                                          type::MakeString("File", true)});
+}
+
+void InitializeEventGraph(LabeledGraph* graph) {
+  ASSERT_TRUE(graph->Initialize({{kEventTag, EventType()}}, {},
+                                {{kLinkTag, EventType()}}, {},
+                                type::MakeNull("Events"))
+                  .ok());
+}
+
+// The output types have one tag for each aggregate.
+void InitializeSummaryGraph(LabeledGraph* graph) {
+  type::Types types = {
+      {"Count", type::MakeInt("Count", false)},
+      {"Span", type::MakeInterval("Span", PrimitiveType::TIMESTAMP)},
+      {"Files", type::MakeSet("Files", false, type::MakeString("File", false))},
+      {"File", type::MakeString("File", true)}};
+  ASSERT_TRUE(
+      graph->Initialize(types, {}, types, {}, type::MakeNull("Summary")).ok());
+}
+
+// Returns an event label. A negative time or an empty file is null.
+TaggedAST Event(const string& tag, int64_t time, const string& file) {
+  AST event = value::MakeNullTuple(2);
+  value::SetField(EventType(), 0,
+                  time < 0 ? value::MakePrimitiveNull(PrimitiveType::TIMESTAMP)
+                           : value::MakeTimestampFromUnixMicros(time),
+                  &event);
+  value::SetField(EventType(), 1,
+                  file.empty() ? value::MakePrimitiveNull(PrimitiveType::STRING)
+                               : value::MakeString(file),
+                  &event);
+  TaggedAST label;
+  label.set_tag(tag);
+  *label.mutable_ast() = event;
+  return label;
+}
+
+std::vector<LabelId> NodeLabelIds(const LabeledGraph& graph) {
+  std::vector<LabelId> label_ids;
+  for (NodeId node = 0; node < static_cast<NodeId>(graph.NumNodes());
+       ++node) {
+    label_ids.push_back(graph.GetNodeLabelId(node));
+  }
+  return label_ids;
+}
+
+TEST(LabelAggregateTest, AggregatesFields) {
+  LabeledGraph graph;
+  InitializeEventGraph(&graph);
+  graph.FindOrAddNode(Event(kEventTag, 30, ""));
+  graph.FindOrAddNode(Event(kEventTag, 10, "b"));
+  graph.FindOrAddNode(Event(kEventTag, -1, "a"));
+  graph.FindOrAddNode(Event(kEventTag, 20, "b"));
+  std::vector<LabelId> label_ids = NodeLabelIds(graph);
+  TaggedAST count = LabelAggregate::Count("Count").Aggregate(graph, label_ids);
+  EXPECT_EQ("Count", count.tag());
+  EXPECT_EQ(4, value::GetInt(count.ast()));
+  TaggedAST span = LabelAggregate::TimestampInterval("Span", {0})
+                       .Aggregate(graph, label_ids);
+  EXPECT_EQ(10, span.ast().c_ast().arg(0).p_ast().val().time_val());
+  EXPECT_EQ(30, span.ast().c_ast().arg(1).p_ast().val().time_val());
+  TaggedAST files =
+      LabelAggregate::StringSet("Files", {1}).Aggregate(graph, label_ids);
+  ASSERT_EQ(2, value::Size(files.ast()));
+  EXPECT_EQ("a", value::GetString(files.ast().c_ast().arg(0)));
+  EXPECT_EQ("b", value::GetString(files.ast().c_ast().arg(1)));
+  EXPECT_EQ("b", value::GetString(LabelAggregate::First("File", {1})
+                                      .Aggregate(graph, label_ids)
+                                      .ast()));
+  EXPECT_EQ("b", value::GetString(LabelAggregate::Last("File", {1})
+                                      .Aggregate(graph, label_ids)
+                                      .ast()));
+  // Labels without the field are skipped, and a path that does not exist
+  // gives no values.
+  TaggedAST no_span = LabelAggregate::TimestampInterval("Span", {1, 0})
+                          .Aggregate(graph, label_ids);
+  EXPECT_FALSE(no_span.ast().c_ast().arg(0).p_ast().has_val());
+  EXPECT_FALSE(no_span.ast().c_ast().arg(1).p_ast().has_val());
+  TaggedAST no_file =
+      LabelAggregate::First("File", {2}).Aggregate(graph, label_ids);
+  EXPECT_FALSE(no_file.ast().has_p_ast());
+}
+
+// Returns a random event graph with 'num_nodes' nodes and twice as many edges.
+void GetRandomEventGraph(int num_nodes, std::mt19937* generator,
+                         LabeledGraph* graph) {
+  InitializeEventGraph(graph);
+  std::uniform_int_distribution<int> time_dist(-5, 1000);
+  std::uniform_int_distribution<int> file_dist(0, 6);
+  for (int i = 0; i < num_nodes; ++i) {
+    int file = file_dist(*generator);
+    graph->FindOrAddNode(
+        Event(kEventTag, time_dist(*generator),
+              file == 0 ? "" : "file" + std::to_string(file)));
+  }
+  std::uniform_int_distribution<int> node_dist(0, num_nodes - 1);
+  for (int i = 0; i < 2 * num_nodes; ++i) {
+    graph->FindOrAddEdge(node_dist(*generator), node_dist(*generator),
+                         Event(kLinkTag, time_dist(*generator), ""));
+  }
+}
+
+// A column returns the same labels as the aggregate on random subsequences of
+// labels.
+TEST(LabelAggregateTest, ColumnMatchesAggregate) {
+  std::mt19937 generator(3);
+  LabeledGraph graph;
+  GetRandomEventGraph(200, &generator, &graph);
+  std::vector<LabelAggregate> aggregates = {
+      LabelAggregate::Count("Count"),
+      LabelAggregate::TimestampInterval("Span", {0}),
+      LabelAggregate::StringSet("Files", {1}),
+      LabelAggregate::First("File", {1}), LabelAggregate::Last("File", {1})};
+  std::uniform_int_distribution<int> label_dist(0,
+                                                graph.NumDistinctLabels() - 1);
+  for (const LabelAggregate& aggregate : aggregates) {
+    AggregateColumn column(aggregate, graph);
+    for (int size : {0, 1, 5, 50}) {
+      std::vector<LabelId> label_ids;
+      for (int i = 0; i < size; ++i) {
+        label_ids.push_back(label_dist(generator));
+      }
+      EXPECT_TRUE(ast::Equal(aggregate.Aggregate(graph, label_ids),
+                             column.Aggregate(label_ids)))
+          << "size " << size;
+    }
+  }
+}
+
+// The nodes are grouped by tag, by label, and by tag and field, with blocks in
+// the order of their smallest node. An event without a time is grouped by its
+// tag when partitioned by time.
+TEST(LabelAggregateTest, PartitionsByLabels) {
+  LabeledGraph graph;
+  ASSERT_TRUE(graph.Initialize({{kEventTag, EventType()},
+                                {"Alert", EventType()}},
+                               {}, {{kLinkTag, EventType()}}, {},
+                               type::MakeNull("Events"))
+                  .ok());
+  graph.FindOrAddNode(Event("Alert", 1, "a"));
+  graph.FindOrAddNode(Event(kEventTag, 1, "a"));
+  graph.FindOrAddNode(Event(kEventTag, 2, "a"));
+  graph.FindOrAddNode(Event(kEventTag, 1, "a"));
+  graph.FindOrAddNode(Event(kEventTag, -1, "b"));
+  EXPECT_EQ(std::vector<int>({0, 1, 1, 1, 1}), PartitionByTag(graph));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 1, 3}), PartitionByLabel(graph));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 1, 3}), PartitionByField(graph, {}));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 1, 3}), PartitionByField(graph, {0}));
+  EXPECT_EQ(std::vector<int>({0, 1, 1, 1, 2}), PartitionByField(graph, {1}));
+  EXPECT_EQ(std::vector<int>({0, 1, 1, 1, 1}), PartitionByField(graph, {5}));
+  LabeledGraphView view(graph);
+  view.HideNode(1);
+  EXPECT_EQ(std::vector<int>({0, -1, 1, 1, 1}), PartitionByTag(view));
+  EXPECT_EQ(std::vector<int>({0, -1, 1, 2, 3}), PartitionByLabel(view));
+  EXPECT_EQ(std::vector<int>({0, -1, 1, 1, 2}), PartitionByField(view, {1}));
+}
+
+// QuotientGraph computes aggregates from columns, and gives the same graph as
+// the label functions of the configuration. The labels have the types of the
+// output graph, which checks them when they are added.
+TEST(LabelAggregateTest, QuotientUsesAggregates) {
+  std::mt19937 generator(9);
+  LabeledGraph graph;
+  GetRandomEventGraph(300, &generator, &graph);
+  LabeledGraph summary_type;
+  InitializeSummaryGraph(&summary_type);
+  std::vector<int> partition;
+  for (int node = 0; node < graph.NumNodes(); ++node) {
+    partition.push_back(node % 7);
+  }
+  std::vector<std::pair<LabelAggregate, LabelAggregate>> aggregates = {
+      {LabelAggregate::TimestampInterval("Span", {0}),
+       LabelAggregate::Count("Count")},
+      {LabelAggregate::StringSet("Files", {1}),
+       LabelAggregate::TimestampInterval("Span", {0})},
+      {LabelAggregate::First("File", {1}), LabelAggregate::Last("File", {1})}};
+  for (const auto& node_edge_aggregate : aggregates) {
+    QuotientConfig config(summary_type, node_edge_aggregate.first,
+                          node_edge_aggregate.second, true);
+    config.num_threads = 3;
+    QuotientConfig generic_config(summary_type, config.node_label_fn,
+                                  config.edge_label_fn, true);
+    std::unique_ptr<LabeledGraph> quotient =
+        QuotientGraph(graph, partition, config);
+    std::unique_ptr<LabeledGraph> expected =
+        QuotientGraph(graph, partition, generic_config);
+    ASSERT_EQ(expected->NumNodes(), quotient->NumNodes());
+    ASSERT_EQ(expected->NumEdges(), quotient->NumEdges());
+    for (NodeId node = 0; node < static_cast<NodeId>(quotient->NumNodes());
+         ++node) {
+      EXPECT_TRUE(ast::Equal(expected->GetNodeLabel(node),
+                             quotient->GetNodeLabel(node)));
+    }
+    auto expected_it = expected->EdgeSetBegin();
+    for (auto edge_it = quotient->EdgeSetBegin();
+         edge_it != quotient->EdgeSetEnd(); ++edge_it, ++expected_it) {
+      EXPECT_TRUE(ast::Equal(expected->GetEdgeLabel(*expected_it),
+                             quotient->GetEdgeLabel(*edge_it)));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace graph
+}  // namespace morphie
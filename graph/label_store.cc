@@ -0,0 +1,80 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/label_store.h"
+
+#include <limits>
+
+#include "util/logging.h"
+#include "util/memory_usage.h"
+
+namespace morphie {
+
+namespace {
+const char kInvalidLabelErr[] = "Invalid label id.";
+const char kStoreFullErr[] = "The label store is full.";
+}  // namespace
+
+// Equality of TaggedASTs includes the tag, so labels with the same AST but
+// different tags are stored separately.
+LabelId LabelStore::Intern(const TaggedAST& label) {
+  auto id_it = ids_.find(&label);
+  if (id_it != ids_.end()) {
+    return id_it->second;
+  }
+  CHECK(labels_.size() < std::numeric_limits<LabelId>::max(), kStoreFullErr);
+  LabelId id = static_cast<LabelId>(labels_.size());
+  labels_.push_back(label);
+  ids_.insert({&labels_.back(), id});
+  return id;
+}
+
+// Swapping into a new element moves the contents of 'label' without copying,
+// even for protobuf versions without move constructors.
+LabelId LabelStore::Intern(TaggedAST&& label) {
+  auto id_it = ids_.find(&label);
+  if (id_it != ids_.end()) {
+    return id_it->second;
+  }
+  CHECK(labels_.size() < std::numeric_limits<LabelId>::max(), kStoreFullErr);
+  LabelId id = static_cast<LabelId>(labels_.size());
+  labels_.emplace_back();
+  labels_.back().Swap(&label);
+  ids_.insert({&labels_.back(), id});
+  return id;
+}
+
+std::pair<bool, LabelId> LabelStore::Find(const TaggedAST& label) const {
+  auto id_it = ids_.find(&label);
+  if (id_it == ids_.end()) {
+    return {false, 0};
+  }
+  return {true, id_it->second};
+}
+
+const TaggedAST& LabelStore::Get(LabelId id) const {
+  CHECK(id < labels_.size(), kInvalidLabelErr);
+  return labels_[id];
+}
+
+// SpaceUsedLong counts the label itself and the memory that it owns.
+size_t LabelStore::MemoryBytes() const {
+  size_t bytes = util::UnorderedMapBytes(ids_);
+  for (const TaggedAST& label : labels_) {
+    bytes += label.SpaceUsedLong();
+  }
+  return bytes;
+}
+
+}  // namespace morphie
@@ -0,0 +1,97 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A label store interns the labels of a graph. Graphs constructed from logs
+// contain many nodes and edges with identical labels. In a Plaso event graph,
+// for example, every 'Uses' and 'Precedes' edge has the same null label. A
+// label store keeps one copy of each distinct label and hands out a compact
+// identifier for it, so that nodes and edges only have to store the
+// identifier.
+#ifndef LOGLE_LABEL_STORE_H_
+#define LOGLE_LABEL_STORE_H_
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+
+#include "graph/ast.h"
+#include "ast.pb.h"
+
+namespace morphie {
+
+// Identifies a label in a LabelStore. Identifiers are assigned consecutively
+// starting from 0 in the order in which distinct labels are interned.
+using LabelId = uint32_t;
+
+// The LabelStore class maps labels to identifiers and back. Two labels receive
+// the same identifier exactly when they have the same tag and the same AST, or
+// the same tag and no AST. Labels are never removed so an identifier remains
+// valid, and a reference returned by Get() remains valid, for the lifetime of
+// the store.
+class LabelStore {
+ public:
+  LabelStore() {}
+  // Disallow copying and assignment.
+  LabelStore(const LabelStore&) = delete;
+  LabelStore& operator=(const LabelStore&) = delete;
+
+  // Returns the identifier of 'label', adding a copy of 'label' to the store if
+  // it does not already contain such a label.
+  LabelId Intern(const TaggedAST& label);
+  // Behaves like the function above but moves 'label' into the store instead
+  // of copying it. The contents of 'label' are unspecified afterwards. The
+  // labels in the store are allocated on the heap, so a label allocated on a
+  // protobuf arena is copied.
+  LabelId Intern(TaggedAST&& label);
+  // Returns
+  // - (true, id) if a label equal to 'label' has been interned with
+  //   identifier 'id'.
+  // - (false, 0) otherwise.
+  // Unlike Intern, this function does not modify the store.
+  std::pair<bool, LabelId> Find(const TaggedAST& label) const;
+  // Returns the label with identifier 'id'.
+  // - Crashes if 'id' was not returned by Intern().
+  const TaggedAST& Get(LabelId id) const;
+  // Returns the number of distinct labels in the store.
+  int Size() const { return static_cast<int>(labels_.size()); }
+  // Returns an estimate of the bytes used by the labels and by the map from
+  // labels to identifiers, as described in util/memory_usage.h. Takes time
+  // linear in the size of the labels.
+  size_t MemoryBytes() const;
+
+ private:
+  // A deque is used because references to its elements are not invalidated by
+  // inserting at the end.
+  std::deque<TaggedAST> labels_;
+  // The hash and equality functions of the map below compare the labels that
+  // keys point to, so a label can be looked up without copying it.
+  struct LabelPtrHash {
+    size_t operator()(const TaggedAST* label) const {
+      return ast::Hash(*label);
+    }
+  };
+  struct LabelPtrEqual {
+    bool operator()(const TaggedAST* label1, const TaggedAST* label2) const {
+      return ast::Equal(*label1, *label2);
+    }
+  };
+  // Maps a pointer to an element of 'labels_' to the index of that element.
+  std::unordered_map<const TaggedAST*, LabelId, LabelPtrHash, LabelPtrEqual>
+      ids_;
+};
+
+}  // namespace morphie
+
+#endif  // LOGLE_LABEL_STORE_H_
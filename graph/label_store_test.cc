@@ -0,0 +1,93 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/label_store.h"
+
+#include <utility>
+
+#include "graph/test_graphs.h"
+#include "graph/value.h"
+#include "graph/value_checker.h"
+#include "gtest.h"
+#include "ast.pb.h"
+
+namespace morphie {
+namespace {
+
+namespace value = ast::value;
+
+using test::MakeLabel;
+
+TEST(LabelStoreTest, EqualLabelsHaveEqualIds) {
+  LabelStore store;
+  EXPECT_EQ(0, store.Size());
+  LabelId foo = store.Intern(MakeLabel("File", "foo"));
+  EXPECT_EQ(foo, store.Intern(MakeLabel("File", "foo")));
+  EXPECT_EQ(1, store.Size());
+  // Labels which differ in either the tag or the AST are distinct.
+  LabelId bar = store.Intern(MakeLabel("File", "bar"));
+  LabelId url = store.Intern(MakeLabel("URL", "foo"));
+  EXPECT_NE(foo, bar);
+  EXPECT_NE(foo, url);
+  EXPECT_NE(bar, url);
+  EXPECT_EQ(3, store.Size());
+}
+
+TEST(LabelStoreTest, NullLabelsAreDistinguishedByTag) {
+  LabelStore store;
+  TaggedAST uses;
+  uses.set_tag("Uses");
+  TaggedAST precedes;
+  precedes.set_tag("Precedes");
+  EXPECT_NE(store.Intern(uses), store.Intern(precedes));
+  EXPECT_EQ(store.Intern(uses), store.Intern(uses));
+  EXPECT_EQ(2, store.Size());
+}
+
+TEST(LabelStoreTest, GetReturnsInternedLabel) {
+  LabelStore store;
+  TaggedAST label = MakeLabel("File", "foo");
+  LabelId id = store.Intern(label);
+  const TaggedAST& stored = store.Get(id);
+  EXPECT_EQ("File", stored.tag());
+  EXPECT_TRUE(value::Isomorphic(label.ast(), stored.ast()));
+  // References are not invalidated by adding labels.
+  for (int i = 0; i < 1000; ++i) {
+    store.Intern(MakeLabel("File", std::to_string(i)));
+  }
+  EXPECT_EQ(&stored, &store.Get(id));
+}
+
+TEST(LabelStoreTest, InternMovesLabels) {
+  LabelStore store;
+  TaggedAST label = MakeLabel("File", "foo");
+  LabelId id = store.Intern(MakeLabel("File", "foo"));
+  EXPECT_EQ(id, store.Intern(label));
+  TaggedAST bar = MakeLabel("File", "bar");
+  LabelId bar_id = store.Intern(std::move(bar));
+  EXPECT_NE(id, bar_id);
+  EXPECT_EQ("File", store.Get(bar_id).tag());
+  EXPECT_TRUE(value::Isomorphic(MakeLabel("File", "bar").ast(),
+                                store.Get(bar_id).ast()));
+  EXPECT_EQ(bar_id, store.Intern(MakeLabel("File", "bar")));
+  EXPECT_EQ(2, store.Size());
+}
+
+TEST(LabelStoreDeathTest, GetRequiresValidId) {
+  LabelStore store;
+  EXPECT_DEATH({ store.Get(0); }, ".*");
+}
+
+}  // namespace
+}  // namespace morphie
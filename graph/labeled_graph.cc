@@ -22,11 +22,19 @@
 // which LabeledGraph does by using indexes.
 #include "labeled_graph.h"
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
 #include <utility>
 
 #include "graph/ast.h"
 #include "util/logging.h"
+#include "util/memory_usage.h"
 #include "util/string_utils.h"
+#include "util/thread_pool.h"
 
 namespace morphie {
 
@@ -34,26 +42,61 @@ using ast::type::Types;
 namespace type = ast::type;
 
 namespace {
-const char* const kNullStr = "null";
 const char* const kInitializationErr = "The graph is not initialized.";
 const char* const kInvalidNodeErr = "Invalid node id.";
 const char* const kInvalidEdgeErr = "Invalid edge id.";
 const char* const kInvalidIndexTagErr = "There is no index for labels tagged ";
+const char* const kLoaderFinishedErr = "The bulk loader has finished.";
+const char* const kBatchSizeErr = "The arguments of a batch differ in size.";
+const char* const kSamplePeriodErr = "The sample period must be positive.";
+const char* const kUndeclaredTagErr = "The tag of the label has no type.";
+const char* const kColumnFieldErr =
+    "The field of a column must be an integer or a timestamp.";
+const char* const kInvalidColumnErr = "Invalid column index.";
+const char* const kInvalidTypeIdErr = "Invalid type id.";
+const char* const kNumThreadsErr = "The number of threads must be positive.";
+const char* const kDuplicateUpdateErr =
+    "The batch updates the label of a node more than once: ";
+const char* const kSelfMergeErr = "A graph cannot be merged with itself.";
+const char* const kEdgeIndexLabelErr =
+    "The largest label id cannot be stored in an edge index.";
+const char* const kOrderErr =
+    "The order must contain every node of the graph exactly once.";
+const char* const kNumHubsErr = "The number of hubs must not be negative.";
+const char* const kNoDegreesErr = "The degrees of the graph are not tracked.";
 
-// If a tagged AST has an AST field, return the serialization of the field.
-// Otherwise, return the string "null". TaggedAST objects with different tags
-// but with no AST field will return the same label string.
-//
-// Note: If ASTs are serialized in a loop, the MessageLite::SerializeAsString
-// documentation recommends using MessageLite::SerializeToString(..) with an
-// output string argument to reduce heap fragmentation.
-static string GetSerializationOrNull(const TaggedAST& ast) {
-  if (ast.has_ast()) {
-    return ast.ast().SerializeAsString();
+// Returns the bucket of a degree histogram that counts nodes of degree
+// 'degree', which is 0 for degree 0 and one more than the position of the
+// highest set bit of 'degree' otherwise.
+size_t DegreeBucket(size_t degree) {
+  size_t bucket = 0;
+  for (; degree > 0; degree >>= 1) {
+    ++bucket;
   }
-  return kNullStr;
+  return bucket;
 }
 
+// The number of labels by which FindOrAddNodes prefetches index entries ahead
+// of their lookup, which covers the latency of a miss to memory.
+const size_t kPrefetchDistance = 8;
+
+// The number of slots of an edge index after its first insertion.
+const size_t kMinEdgeIndexSlots = 16;
+
+// Returns the number of slots of an edge index that holds 'num_edges' entries
+// without exceeding the maximum load of 3/4.
+size_t NumEdgeIndexSlots(size_t num_edges) {
+  size_t num_slots = kMinEdgeIndexSlots;
+  while (3 * num_slots < 4 * num_edges) {
+    num_slots *= 2;
+  }
+  return num_slots;
+}
+
+// Marks a label of a merged graph that has not been interned in the graph it
+// is merged into.
+const LabelId kNoLabel = std::numeric_limits<LabelId>::max();
+
 // Retrieve the type corresponding to a tag in a Types map.
 // - Returns the pair (true, types[tag]), if 'tag' is a key in 'types' and
 //   (false, AST()) otherwise.
@@ -65,43 +108,66 @@ std::pair<bool, AST> GetTaggedType(const string& tag, const Types& types) {
   return {true, type_it->second};
 }
 
+// Returns the position of 'tag' among the keys of 'types', or kNoType if it is
+// not a key.
+TypeId GetTypeId(const string& tag, const type::CompiledTypes& types) {
+  const auto type_it = types.find(tag);
+  if (type_it == types.end()) {
+    return kNoType;
+  }
+  return static_cast<TypeId>(std::distance(types.begin(), type_it));
+}
+
 // Add a label and identifier to an index. The identifier may be either a node
 // or an edge id and the index must have the corresponding type.
 template <typename ObjectId>
-util::Status IndexObject(const TaggedAST& label, ObjectId id,
-                         Indexes<std::set<ObjectId>>* indexes) {
-  auto index_it = indexes->find(label.tag());
+util::Status IndexObject(const string& tag, LabelId label_id, ObjectId id,
+                         Indexes<std::vector<ObjectId>>* indexes) {
+  auto index_it = indexes->find(tag);
   if (index_it == indexes->end()) {
     return util::Status(Code::INVALID_ARGUMENT,
-                        util::StrCat(kInvalidIndexTagErr, label.tag(), "."));
+                        util::StrCat(kInvalidIndexTagErr, tag, "."));
   }
-  Index<std::set<ObjectId>>& index = index_it->second;
-  index[GetSerializationOrNull(label)].insert(id);
+  Index<std::vector<ObjectId>>& index = index_it->second;
+  index[label_id].push_back(id);
   return util::Status::OK;
 }
 
-// Remove the object 'id' from the index of 'label'. The object may be a node or
-// an edge and 'label' must be of non-unique type.
+// Remove the object 'id' from the index of 'label_id'. The object may be a node
+// or an edge. Takes time linear in the number of objects with the label.
 template <typename ObjectId>
-void DeIndexObject(const TaggedAST& label, ObjectId id,
-                   Indexes<std::set<ObjectId>>* indexes) {
-  auto index_it = indexes->find(label.tag());
-  Index<std::set<ObjectId>>& index = index_it->second;
-  index[GetSerializationOrNull(label)].erase(id);
+void DeIndexObject(const string& tag, LabelId label_id, ObjectId id,
+                   Indexes<std::vector<ObjectId>>* indexes) {
+  auto index_it = indexes->find(tag);
+  if (index_it == indexes->end()) {
+    return;
+  }
+  Index<std::vector<ObjectId>>& index = index_it->second;
+  auto label_it = index.find(label_id);
+  if (label_it == index.end()) {
+    return;
+  }
+  std::vector<ObjectId>& objects = label_it->second;
+  auto object_it = std::find(objects.begin(), objects.end(), id);
+  if (object_it != objects.end()) {
+    objects.erase(object_it);
+  }
+  if (objects.empty()) {
+    index.erase(label_it);
+  }
 }
 
 // The functions below extend the index of unique nodes or edges with a new
 // label, or remove a specific node or edge from a unique index. Unlike the
 // situation for non-unique indexes, separate functions are used for
 // manipulating unique node and edge indexes. This is because a unique node
-// index uses a serialized label as a key while a unique edge index uses a
-// triple of a source and target node and a serialized edge label as a key.
-util::Status IndexUniqueNode(const TaggedAST& label, NodeId node_id,
-                             Indexes<NodeId>* named_nodes) {
+// index uses a label as a key while a unique edge index uses a triple of a
+// source and target node and an edge label as a key.
+util::Status IndexUniqueNode(const TaggedAST& label, LabelId label_id,
+                             NodeId node_id, Indexes<NodeId>* named_nodes) {
   auto index_it = named_nodes->find(label.tag());
   Index<NodeId>& named_node = index_it->second;
-  string name = GetSerializationOrNull(label);
-  auto name_it = named_node.find(name);
+  auto name_it = named_node.find(label_id);
   if (name_it != named_node.end()) {
     return util::Status(
         Code::INVALID_ARGUMENT,
@@ -109,16 +175,15 @@ util::Status IndexUniqueNode(const TaggedAST& label, NodeId node_id,
                      ast::ToString(label, ast::PrintOption::kValue),
                      " already exists."));
   }
-  named_node.insert({name, node_id});
+  named_node.insert({label_id, node_id});
   return util::Status::OK;
 }
 
-void DeIndexUniqueNode(const TaggedAST& label, NodeId node_id,
+void DeIndexUniqueNode(const string& tag, LabelId label_id,
                        Indexes<NodeId>* named_nodes) {
-  auto index_it = named_nodes->find(label.tag());
+  auto index_it = named_nodes->find(tag);
   Index<NodeId>& named_node = index_it->second;
-  string name = GetSerializationOrNull(label);
-  auto name_it = named_node.find(name);
+  auto name_it = named_node.find(label_id);
   if (name_it == named_node.end()) {
     return;
   }
@@ -129,45 +194,294 @@ util::Status IndexUniqueEdge(const string& tag, const Edge& edge,
                              EdgeId edge_id, UniqueEdges* indexes) {
   auto index_it = indexes->find(tag);
   EdgeIndex& index = index_it->second;
-  auto name_it = index.find(edge);
-  if (name_it != index.end()) {
+  if (!index.Insert(edge, edge_id).second) {
     return util::Status(Code::INVALID_ARGUMENT, "Unique edge label exists.");
   }
-  Edge key(edge.source, edge.target, edge.label);
-  index.insert({key, edge_id});
   return util::Status::OK;
 }
 
 void DeIndexUniqueEdge(const string& tag, const Edge& edge,
                        UniqueEdges* indexes) {
   auto index_it = indexes->find(tag);
-  EdgeIndex& index = index_it->second;
-  auto name_it = index.find(edge);
-  if (name_it == index.end()) {
-    return;
-  }
-  index.erase(name_it);
+  index_it->second.Erase(edge);
 }
 
-// Retrieve a set of identifiers from an index given a label. Returns the empty
-// set either if no index exists for label.tag(), or if an index exists but does
-// not contain the serialization of label.ast() as a key.
+// Retrieve the identifiers in an index given a label. Returns the empty span
+// either if no index exists for label.tag(), or if an index exists but does not
+// contain the label as a key.
 template <typename ObjectId>
-std::set<ObjectId> GetLabeledObjects(
-    const TaggedAST& label, const Indexes<std::set<ObjectId>>& indexes) {
+util::Span<ObjectId> GetLabeledObjects(
+    const TaggedAST& label, const LabelStore& labels,
+    const Indexes<std::vector<ObjectId>>& indexes) {
   const auto index_it = indexes.find(label.tag());
   if (index_it == indexes.end()) {
     return {};
   }
-  const auto label_it = index_it->second.find(GetSerializationOrNull(label));
+  std::pair<bool, LabelId> label_id = labels.Find(label);
+  if (!label_id.first) {
+    return {};
+  }
+  const auto label_it = index_it->second.find(label_id.second);
   if (label_it == index_it->second.end()) {
     return {};
   }
   return label_it->second;
 }
 
+// Adds the pairs of label ids and object ids in 'pending' to 'indexes' and
+// clears 'pending'. The pairs are grouped by label with a stable sort, so each
+// index entry is looked up once and objects are appended in the order in which
+// they were added. Objects whose tag has no index are skipped, as they are by
+// FindOrAddNode.
+template <typename ObjectId>
+void IndexPendingObjects(const LabelStore& labels,
+                         std::vector<std::pair<LabelId, ObjectId>>* pending,
+                         Indexes<std::vector<ObjectId>>* indexes) {
+  std::stable_sort(pending->begin(), pending->end(),
+                   [](const std::pair<LabelId, ObjectId>& entry1,
+                      const std::pair<LabelId, ObjectId>& entry2) {
+                     return entry1.first < entry2.first;
+                   });
+  auto entry_it = pending->begin();
+  while (entry_it != pending->end()) {
+    LabelId label_id = entry_it->first;
+    auto group_end = entry_it;
+    while (group_end != pending->end() && group_end->first == label_id) {
+      ++group_end;
+    }
+    auto index_it = indexes->find(labels.Get(label_id).tag());
+    if (index_it != indexes->end()) {
+      std::vector<ObjectId>& objects = index_it->second[label_id];
+      objects.reserve(objects.size() + (group_end - entry_it));
+      for (; entry_it != group_end; ++entry_it) {
+        objects.push_back(entry_it->second);
+      }
+    }
+    entry_it = group_end;
+  }
+  pending->clear();
+  pending->shrink_to_fit();
+}
+
+// Returns true if 'field' is the path of an integer or timestamp in 'type'.
+bool IsColumnField(const AST& type, const std::vector<int>& field) {
+  const AST* ast = &type;
+  for (int index : field) {
+    if (!ast::IsTuple(*ast) || index < 0 || index >= ast->c_ast().arg_size()) {
+      return false;
+    }
+    ast = &ast->c_ast().arg(index);
+  }
+  return ast::IsInt(*ast) || ast::IsTimestamp(*ast);
+}
+
+// Sets 'value' to the field of 'label' that 'column' projects and returns true,
+// or returns false if the label has a different tag or the field is null.
+bool GetColumnValue(const NodeColumn& column, const TaggedAST& label,
+                    int64_t* value) {
+  if (label.tag() != column.tag || !label.has_ast()) {
+    return false;
+  }
+  const AST* ast = &label.ast();
+  for (int index : column.field) {
+    if (!ast->has_c_ast() || index >= ast->c_ast().arg_size()) {
+      return false;
+    }
+    ast = &ast->c_ast().arg(index);
+  }
+  if (!ast->has_p_ast()) {
+    return false;
+  }
+  const PrimitiveValue& val = ast->p_ast().val();
+  if (val.has_int_val()) {
+    *value = val.int_val();
+    return true;
+  }
+  if (val.has_time_val()) {
+    *value = val.time_val();
+    return true;
+  }
+  return false;
+}
+
+// Sets the entry of 'node_id' in 'column' to the field of 'label', extending
+// the column if it is shorter.
+void SetColumnEntry(const TaggedAST& label, NodeId node_id,
+                    NodeColumn* column) {
+  if (node_id >= column->values.size()) {
+    column->values.resize(node_id + 1, 0);
+    column->is_valid.resize(node_id / 64 + 1, 0);
+  }
+  const uint64_t bit = uint64_t{1} << (node_id % 64);
+  int64_t value = 0;
+  if (GetColumnValue(*column, label, &value)) {
+    column->is_valid[node_id / 64] |= bit;
+  } else {
+    column->is_valid[node_id / 64] &= ~bit;
+  }
+  column->values[node_id] = value;
+}
+
+// Returns the bytes owned by an entry of an index.
+size_t ObjectBytes(NodeId) { return 0; }
+template <typename ObjectId>
+size_t ObjectBytes(const std::vector<ObjectId>& objects) {
+  return util::VectorBytes(objects);
+}
+
+// Adds the bytes of the index of each tag in 'indexes' to 'usage', as the
+// component with the name of the tag prefixed by 'prefix' and a '/'.
+template <typename ObjectT>
+void AddIndexBytes(const string& prefix, const Indexes<ObjectT>& indexes,
+                   util::MemoryBreakdown* usage) {
+  for (const auto& tagged_index : indexes) {
+    const Index<ObjectT>& index = tagged_index.second;
+    size_t bytes = index.bucket_count() *
+                   (sizeof(typename Index<ObjectT>::value_type) + 1);
+    for (const auto& entry : index) {
+      bytes += ObjectBytes(entry.second);
+    }
+    (*usage)[util::StrCat(prefix, "/", tagged_index.first)] = bytes;
+  }
+}
+
+// Combines 'value' into the hash 'seed'.
+uint64_t CombineHashes(uint64_t seed, uint64_t value) {
+  return util::internal::MixHash(seed ^ (value + 0x9e3779b97f4a7c15ULL +
+                                         (seed << 6) + (seed >> 2)));
+}
+
+// Returns the hash of the serialization of 'message'.
+uint64_t MessageHash(const ::google::protobuf::Message& message) {
+  return util::internal::MixHash(
+      std::hash<string>()(message.SerializeAsString()));
+}
+
+// Returns the sum of the hashes of the types in 'types', each combined with
+// the hash of its tag and with whether it is unique. A sum does not depend on
+// the order in which the types are visited.
+uint64_t TypesHash(const type::Types& types, const std::set<string>& unique) {
+  uint64_t sum = 0;
+  for (const auto& type : types) {
+    uint64_t hash = CombineHashes(std::hash<string>()(type.first),
+                                  MessageHash(type.second));
+    sum += CombineHashes(hash, unique.count(type.first));
+  }
+  return sum;
+}
+
 }  // namespace
 
+const LabelId EdgeIndex::kEmptySlot;
+
+// The source, target and label are combined with multiplications by odd
+// constants and the result is mixed with the finalizer of MurmurHash3, so that
+// the low bits that select a slot depend on all bits of the key. Node ids of
+// an edge are often close to each other, which would cluster under the
+// identity hash that std::hash uses for integers.
+size_t EdgeIndex::HomeSlot(const Edge& edge) const {
+  uint64_t hash = static_cast<uint64_t>(edge.source);
+  hash = hash * 0x9e3779b97f4a7c15ULL + static_cast<uint64_t>(edge.target);
+  hash = hash * 0x9e3779b97f4a7c15ULL + edge.label;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return static_cast<size_t>(hash) & (slots_.size() - 1);
+}
+
+size_t EdgeIndex::FindSlot(const Edge& edge) const {
+  const size_t mask = slots_.size() - 1;
+  size_t slot = HomeSlot(edge);
+  while (slots_[slot].label != kEmptySlot &&
+         !(slots_[slot].source == edge.source &&
+           slots_[slot].target == edge.target &&
+           slots_[slot].label == edge.label)) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+const EdgeId* EdgeIndex::Find(const Edge& edge) const {
+  if (size_ == 0) {
+    return nullptr;
+  }
+  const Slot& slot = slots_[FindSlot(edge)];
+  return slot.label == kEmptySlot ? nullptr : &slot.edge_id;
+}
+
+std::pair<EdgeId, bool> EdgeIndex::Insert(const Edge& edge, EdgeId edge_id) {
+  CHECK(edge.label != kEmptySlot, kEdgeIndexLabelErr);
+  // The table is kept at most three quarters full so that probes stay short.
+  if (4 * (size_ + 1) > 3 * slots_.size()) {
+    Rehash(std::max(kMinEdgeIndexSlots, 2 * slots_.size()));
+  }
+  Slot& slot = slots_[FindSlot(edge)];
+  if (slot.label != kEmptySlot) {
+    return {slot.edge_id, false};
+  }
+  slot.source = edge.source;
+  slot.target = edge.target;
+  slot.label = edge.label;
+  slot.edge_id = edge_id;
+  ++size_;
+  return {edge_id, true};
+}
+
+// The entries after the erased one in its probe sequence are moved back into
+// the hole unless the hole is before the slot at which their probe starts, so
+// every entry stays reachable from its home slot without tombstones.
+bool EdgeIndex::Erase(const Edge& edge) {
+  if (size_ == 0) {
+    return false;
+  }
+  const size_t mask = slots_.size() - 1;
+  size_t hole = FindSlot(edge);
+  if (slots_[hole].label == kEmptySlot) {
+    return false;
+  }
+  for (size_t slot = (hole + 1) & mask; slots_[slot].label != kEmptySlot;
+       slot = (slot + 1) & mask) {
+    const Slot& entry = slots_[slot];
+    size_t home = HomeSlot(Edge(entry.source, entry.target, entry.label));
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      slots_[hole] = entry;
+      hole = slot;
+    }
+  }
+  slots_[hole].label = kEmptySlot;
+  --size_;
+  return true;
+}
+
+void EdgeIndex::Reserve(size_t num_edges) {
+  const size_t num_slots = NumEdgeIndexSlots(num_edges);
+  if (num_slots > slots_.size()) {
+    Rehash(num_slots);
+  }
+}
+
+void EdgeIndex::ShrinkToFit() {
+  const size_t num_slots = size_ == 0 ? 0 : NumEdgeIndexSlots(size_);
+  if (num_slots < slots_.size()) {
+    Rehash(num_slots);
+  }
+}
+
+void EdgeIndex::Rehash(size_t num_slots) {
+  std::vector<Slot> old_slots(num_slots);
+  for (Slot& slot : old_slots) {
+    slot.label = kEmptySlot;
+  }
+  slots_.swap(old_slots);
+  for (const Slot& slot : old_slots) {
+    if (slot.label != kEmptySlot) {
+      slots_[FindSlot(Edge(slot.source, slot.target, slot.label))] = slot;
+    }
+  }
+}
+
 // Initialization creates indexes for each type of node and edge label. First,
 // check if the contents of the maps 'node_types' and 'edge_types' are types.
 // Then, create an empty index for each key value in 'node_types' and
@@ -194,18 +508,32 @@ util::Status LabeledGraph::Initialize(Types node_types,
   }
   node_types_.swap(node_types);
   edge_types_.swap(edge_types);
+  compiled_node_types_ = type::Compile(node_types_);
+  compiled_edge_types_ = type::Compile(edge_types_);
+  node_types_by_id_.clear();
+  for (const auto& type : compiled_node_types_) {
+    node_types_by_id_.push_back(&type.second);
+  }
+  edge_types_by_id_.clear();
+  for (const auto& type : compiled_edge_types_) {
+    edge_types_by_id_.push_back(&type.second);
+  }
   graph_type_.Swap(&graph_type);
+  types_hash_ = CombineHashes(
+      CombineHashes(TypesHash(node_types_, unique_nodes),
+                    TypesHash(edge_types_, unique_edges)),
+      MessageHash(graph_type_));
   for (const string& tag : unique_nodes) {
     named_nodes_.insert({tag, Index<NodeId>()});
   }
   for (const auto& type : node_types_) {
-    node_indexes_.insert({type.first, Index<std::set<NodeId>>()});
+    node_indexes_.insert({type.first, Index<std::vector<NodeId>>()});
   }
   for (const string& tag : unique_edges) {
     named_edges_.insert({tag, EdgeIndex()});
   }
   for (const auto& type : edge_types_) {
-    edge_indexes_.insert({type.first, Index<std::set<EdgeId>>()});
+    edge_indexes_.insert({type.first, Index<std::vector<EdgeId>>()});
   }
   is_initialized_ = true;
   return util::Status::OK;
@@ -251,6 +579,28 @@ std::pair<bool, AST> LabeledGraph::GetEdgeType(const string& tag) const {
   return GetTaggedType(tag, edge_types_);
 }
 
+TypeId LabeledGraph::GetNodeTypeId(const string& tag) const {
+  CHECK(is_initialized_, kInitializationErr);
+  return GetTypeId(tag, compiled_node_types_);
+}
+
+TypeId LabeledGraph::GetEdgeTypeId(const string& tag) const {
+  CHECK(is_initialized_, kInitializationErr);
+  return GetTypeId(tag, compiled_edge_types_);
+}
+
+const AST& LabeledGraph::GetNodeTypeById(TypeId type_id) const {
+  CHECK(type_id >= 0 && type_id < static_cast<TypeId>(node_types_by_id_.size()),
+        kInvalidTypeIdErr);
+  return node_types_by_id_[type_id]->type();
+}
+
+const AST& LabeledGraph::GetEdgeTypeById(TypeId type_id) const {
+  CHECK(type_id >= 0 && type_id < static_cast<TypeId>(edge_types_by_id_.size()),
+        kInvalidTypeIdErr);
+  return edge_types_by_id_[type_id]->type();
+}
+
 AST LabeledGraph::GetGraphType() const {
   CHECK(is_initialized_, kInitializationErr);
   return graph_type_;
@@ -263,109 +613,1129 @@ void LabeledGraph::SetGraphLabel(AST graph_label) {
   graph_label_.Swap(&graph_label);
 }
 
+void LabeledGraph::SetLabelValidation(LabelValidation validation,
+                                      int sample_period) {
+  CHECK(sample_period >= 1, kSamplePeriodErr);
+  validation_ = validation;
+  sample_period_ = sample_period;
+}
+
+void LabeledGraph::CheckLabel(const type::CompiledTypes& types,
+                              const TaggedAST& label, LabelId label_id,
+                              std::vector<bool>* is_checked) {
+  if (label_id < is_checked->size() && (*is_checked)[label_id]) {
+    return;
+  }
+  // The tag is always looked up, since a label with an undeclared tag would be
+  // in no index. Only the structural check of the AST is sampled.
+  CHECK(types.count(label.tag()) > 0, kUndeclaredTagErr);
+  switch (validation_) {
+    case LabelValidation::kFull:
+      break;
+    case LabelValidation::kSampled:
+      // A label that is skipped is marked so that the labels are sampled per
+      // distinct label and not per occurrence.
+      if (num_unchecked_labels_++ % sample_period_ != 0) {
+        MarkChecked(label_id, is_checked);
+        return;
+      }
+      break;
+    case LabelValidation::kDebugOnly:
+#ifdef NDEBUG
+      return;
+#else
+      break;
+#endif
+  }
+  string tmp_err;
+  CHECK(type::IsTyped(types, label, &tmp_err), tmp_err);
+  MarkChecked(label_id, is_checked);
+}
+
+void LabeledGraph::MarkChecked(LabelId label_id,
+                               std::vector<bool>* is_checked) {
+  if (label_id >= is_checked->size()) {
+    is_checked->resize(label_id + 1, false);
+  }
+  (*is_checked)[label_id] = true;
+}
+
 NodeId LabeledGraph::FindOrAddNode(const TaggedAST& label) {
   CHECK(is_initialized_, kInitializationErr);
-  string tmp_err;
-  CHECK(type::IsTyped(node_types_, label, &tmp_err), tmp_err);
+  return FindOrAddInternedNode(labels_.Intern(label));
+}
+
+NodeId LabeledGraph::FindOrAddNode(TaggedAST&& label) {
+  CHECK(is_initialized_, kInitializationErr);
+  return FindOrAddInternedNode(labels_.Intern(std::move(label)));
+}
+
+// Marking the label as checked before adding the node skips the type check in
+// FindOrAddInternedNode.
+NodeId LabeledGraph::FindOrAddTypedNode(TaggedAST&& label) {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(compiled_node_types_.count(label.tag()) > 0, kUndeclaredTagErr);
+  LabelId label_id = labels_.Intern(std::move(label));
+  MarkChecked(label_id, &is_checked_node_label_);
+  return FindOrAddInternedNode(label_id);
+}
+
+// The interned copy of the label is used because the argument of a
+// FindOrAddNode call may have been moved into the label store.
+NodeId LabeledGraph::FindOrAddInternedNode(LabelId label_id) {
   NodeId node_id;
+  const TaggedAST& label = labels_.Get(label_id);
+  CheckLabel(compiled_node_types_, label, label_id, &is_checked_node_label_);
   auto index_it = named_nodes_.find(label.tag());
   if (index_it == named_nodes_.end()) {
-    node_id = InsertNode(label);
-    IndexObject(label, node_id, &node_indexes_);
+    node_id = InsertNode(label_id);
+    util::Status status =
+        IndexObject(label.tag(), label_id, node_id, &node_indexes_);
+    CHECK(status.ok(), status.message());
     return node_id;
   }
-  string name = GetSerializationOrNull(label);
   Index<NodeId>& named_node = index_it->second;
-  auto name_it = named_node.find(name);
+  auto name_it = named_node.find(label_id);
   if (name_it == named_node.end()) {
-    node_id = InsertNode(label);
-    name_it = named_node.insert({name, node_id}).first;
+    node_id = InsertNode(label_id);
+    name_it = named_node.insert({label_id, node_id}).first;
   }
   return name_it->second;
 }
 
+// A label is resolved as in FindOrAddInternedNode, with the index of its tag
+// found in advance. The indexes of a tag are looked up once per run of labels
+// with the same tag, and inserting into an index does not move the index.
+std::vector<NodeId> LabeledGraph::FindOrAddNodes(
+    util::Span<TaggedAST> labels) {
+  CHECK(is_initialized_, kInitializationErr);
+  struct LabelIndexes {
+    LabelId label_id;
+    Index<NodeId>* named_node;
+    Index<std::vector<NodeId>>* index;
+  };
+  std::vector<LabelIndexes> entries;
+  entries.reserve(labels.size());
+  const string* tag = nullptr;
+  Index<NodeId>* named_node = nullptr;
+  Index<std::vector<NodeId>>* index = nullptr;
+  for (const TaggedAST& label : labels) {
+    const LabelId label_id = labels_.Intern(label);
+    if (tag == nullptr || *tag != label.tag()) {
+      tag = &label.tag();
+      auto named_it = named_nodes_.find(*tag);
+      named_node = named_it == named_nodes_.end() ? nullptr : &named_it->second;
+      auto index_it = node_indexes_.find(*tag);
+      index = index_it == node_indexes_.end() ? nullptr : &index_it->second;
+    }
+    entries.push_back({label_id, named_node, index});
+  }
+  auto prefetch = [&entries](size_t i) {
+    const LabelIndexes& entry = entries[i];
+    if (entry.named_node != nullptr) {
+      entry.named_node->prefetch(entry.label_id);
+    } else if (entry.index != nullptr) {
+      entry.index->prefetch(entry.label_id);
+    }
+  };
+  for (size_t i = 0; i < std::min(kPrefetchDistance, entries.size()); ++i) {
+    prefetch(i);
+  }
+  std::vector<NodeId> node_ids;
+  node_ids.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (i + kPrefetchDistance < entries.size()) {
+      prefetch(i + kPrefetchDistance);
+    }
+    const LabelIndexes& entry = entries[i];
+    CheckLabel(compiled_node_types_, labels_.Get(entry.label_id),
+               entry.label_id, &is_checked_node_label_);
+    if (entry.named_node == nullptr) {
+      const NodeId node_id = InsertNode(entry.label_id);
+      if (entry.index != nullptr) {
+        (*entry.index)[entry.label_id].push_back(node_id);
+      }
+      node_ids.push_back(node_id);
+      continue;
+    }
+    auto name_it = entry.named_node->find(entry.label_id);
+    if (name_it == entry.named_node->end()) {
+      name_it = entry.named_node
+                    ->insert({entry.label_id, InsertNode(entry.label_id)})
+                    .first;
+    }
+    node_ids.push_back(name_it->second);
+  }
+  return node_ids;
+}
+
 util::Status LabeledGraph::UpdateNodeLabel(NodeId node_id,
                                            const TaggedAST& label) {
   CHECK(is_initialized_, kInitializationErr);
   string tmp_err;
-  if (!type::IsTyped(node_types_, label, &tmp_err)) {
+  if (!type::IsTyped(compiled_node_types_, label, &tmp_err)) {
     return util::Status(Code::INVALID_ARGUMENT, tmp_err);
   }
   if (!HasNode(node_id)) {
     return util::Status(Code::INVALID_ARGUMENT, kInvalidNodeErr);
   }
-  TaggedAST old_label = GetNodeLabel(node_id);
+  LabelId old_label_id = GetNodeLabelId(node_id);
+  const TaggedAST& old_label = labels_.Get(old_label_id);
+  LabelId label_id = labels_.Intern(label);
   // Update the label of the node and the relevant indexes.
-  graph_[node_id] = label;
+  node_hash_sum_ +=
+      NodeHash(node_id, label_id) - NodeHash(node_id, old_label_id);
+  if (is_tracking_degrees_) {
+    CountDegree(node_id, Degree(node_id), -1);
+  }
+  graph_[node_id] = label_id;
+  if (is_tracking_degrees_) {
+    CountDegree(node_id, Degree(node_id), 1);
+  }
+  SetColumnEntries(node_id);
   if (IsUniqueNodeType(old_label)) {
-    DeIndexUniqueNode(old_label, node_id, &named_nodes_);
+    DeIndexUniqueNode(old_label.tag(), old_label_id, &named_nodes_);
   } else {
-    DeIndexObject(old_label, node_id, &node_indexes_);
+    DeIndexObject(old_label.tag(), old_label_id, node_id, &node_indexes_);
   }
   if (IsUniqueNodeType(label)) {
-    return IndexUniqueNode(label, node_id, &named_nodes_);
+    return IndexUniqueNode(label, label_id, node_id, &named_nodes_);
   } else {
-    return IndexObject(label, node_id, &node_indexes_);
+    return IndexObject(label.tag(), label_id, node_id, &node_indexes_);
+  }
+}
+
+// The updates are validated completely before the graph is changed. Old
+// labels that are not unique are removed from their index entries by one scan
+// of each affected entry, and new labels are appended to their entries in the
+// order of the batch, as BulkLoader::Finish does.
+util::Status LabeledGraph::BatchUpdateNodeLabels(
+    util::Span<std::pair<NodeId, TaggedAST>> updates, int num_threads) {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(num_threads >= 1, kNumThreadsErr);
+  const size_t num_updates = updates.size();
+  std::vector<char> is_typed(num_updates);
+  auto check_types = [this, &updates, &is_typed](size_t begin, size_t end) {
+    string err;
+    for (size_t i = begin; i < end; ++i) {
+      is_typed[i] =
+          type::IsTyped(compiled_node_types_, updates[i].second, &err);
+    }
+  };
+  // The calling thread checks a share of the labels, so the pool has one
+  // worker less than 'num_threads'.
+  util::ThreadPool pool(num_threads - 1);
+  util::ParallelFor(num_updates, &pool, check_types);
+  NodeMarker batch_nodes;
+  for (size_t i = 0; i < num_updates; ++i) {
+    if (!is_typed[i]) {
+      // The check is repeated for its error message.
+      string tmp_err;
+      type::IsTyped(compiled_node_types_, updates[i].second, &tmp_err);
+      return util::Status(Code::INVALID_ARGUMENT, tmp_err);
+    }
+    const NodeId node_id = updates[i].first;
+    if (!HasNode(node_id)) {
+      return util::Status(Code::INVALID_ARGUMENT, kInvalidNodeErr);
+    }
+    if (!batch_nodes.Mark(node_id)) {
+      return util::Status(Code::INVALID_ARGUMENT,
+                          util::StrCat(kDuplicateUpdateErr, node_id));
+    }
+  }
+  std::vector<LabelId> label_ids;
+  label_ids.reserve(num_updates);
+  std::vector<LabelId> unique_label_ids;
+  for (size_t i = 0; i < num_updates; ++i) {
+    const TaggedAST& label = updates[i].second;
+    label_ids.push_back(labels_.Intern(label));
+    if (!IsUniqueNodeType(label)) {
+      continue;
+    }
+    // The node that has the label keeps it unless it is in the batch.
+    const Index<NodeId>& named_node = named_nodes_.find(label.tag())->second;
+    auto name_it = named_node.find(label_ids.back());
+    if (name_it != named_node.end() && !batch_nodes.IsMarked(name_it->second)) {
+      return util::Status(
+          Code::INVALID_ARGUMENT,
+          util::StrCat("A node with label ",
+                       ast::ToString(label, ast::PrintOption::kValue),
+                       " already exists."));
+    }
+    unique_label_ids.push_back(label_ids.back());
   }
+  std::sort(unique_label_ids.begin(), unique_label_ids.end());
+  auto clash_it =
+      std::adjacent_find(unique_label_ids.begin(), unique_label_ids.end());
+  if (clash_it != unique_label_ids.end()) {
+    return util::Status(
+        Code::INVALID_ARGUMENT,
+        util::StrCat("Two nodes of the batch have the unique label ",
+                     ast::ToString(labels_.Get(*clash_it),
+                                   ast::PrintOption::kValue),
+                     "."));
+  }
+  std::vector<std::pair<LabelId, NodeId>> removed;
+  for (size_t i = 0; i < num_updates; ++i) {
+    const NodeId node_id = updates[i].first;
+    const LabelId old_label_id = graph_[node_id];
+    const TaggedAST& old_label = labels_.Get(old_label_id);
+    if (IsUniqueNodeType(old_label)) {
+      DeIndexUniqueNode(old_label.tag(), old_label_id, &named_nodes_);
+    } else {
+      removed.emplace_back(old_label_id, node_id);
+    }
+    node_hash_sum_ +=
+        NodeHash(node_id, label_ids[i]) - NodeHash(node_id, old_label_id);
+    if (is_tracking_degrees_) {
+      CountDegree(node_id, Degree(node_id), -1);
+    }
+    graph_[node_id] = label_ids[i];
+    if (is_tracking_degrees_) {
+      CountDegree(node_id, Degree(node_id), 1);
+    }
+    SetColumnEntries(node_id);
+  }
+  std::sort(removed.begin(), removed.end());
+  for (auto entry_it = removed.begin(); entry_it != removed.end();) {
+    const LabelId label_id = entry_it->first;
+    Index<std::vector<NodeId>>& index =
+        node_indexes_.find(labels_.Get(label_id).tag())->second;
+    auto label_it = index.find(label_id);
+    if (label_it != index.end()) {
+      std::vector<NodeId>& nodes = label_it->second;
+      nodes.erase(std::remove_if(nodes.begin(), nodes.end(),
+                                 [&batch_nodes](NodeId node_id) {
+                                   return batch_nodes.IsMarked(node_id);
+                                 }),
+                  nodes.end());
+      if (nodes.empty()) {
+        index.erase(label_it);
+      }
+    }
+    while (entry_it != removed.end() && entry_it->first == label_id) {
+      ++entry_it;
+    }
+  }
+  std::vector<std::pair<LabelId, NodeId>> added;
+  for (size_t i = 0; i < num_updates; ++i) {
+    const TaggedAST& label = labels_.Get(label_ids[i]);
+    if (IsUniqueNodeType(label)) {
+      named_nodes_.find(label.tag())->second.insert(
+          {label_ids[i], updates[i].first});
+    } else {
+      added.emplace_back(label_ids[i], updates[i].first);
+    }
+  }
+  IndexPendingObjects(labels_, &added, &node_indexes_);
+  return util::Status::OK;
 }
 
 EdgeId LabeledGraph::FindOrAddEdge(NodeId source, NodeId target,
                                    const TaggedAST& label) {
   CHECK(is_initialized_, kInitializationErr);
-  string tmp_err;
-  CHECK(type::IsTyped(edge_types_, label, &tmp_err), tmp_err);
+  return FindOrAddInternedEdge(source, target, labels_.Intern(label));
+}
+
+EdgeId LabeledGraph::FindOrAddEdge(NodeId source, NodeId target,
+                                   TaggedAST&& label) {
+  CHECK(is_initialized_, kInitializationErr);
+  return FindOrAddInternedEdge(source, target,
+                               labels_.Intern(std::move(label)));
+}
+
+EdgeId LabeledGraph::FindOrAddTypedEdge(NodeId source, NodeId target,
+                                        TaggedAST&& label) {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(compiled_edge_types_.count(label.tag()) > 0, kUndeclaredTagErr);
+  LabelId label_id = labels_.Intern(std::move(label));
+  MarkChecked(label_id, &is_checked_edge_label_);
+  return FindOrAddInternedEdge(source, target, label_id);
+}
+
+EdgeId LabeledGraph::FindOrAddInternedEdge(NodeId source, NodeId target,
+                                           LabelId label_id) {
   EdgeId edge_id;
+  const TaggedAST& label = labels_.Get(label_id);
+  CheckLabel(compiled_edge_types_, label, label_id, &is_checked_edge_label_);
   auto index_it = named_edges_.find(label.tag());
   if (index_it == named_edges_.end()) {
-    edge_id = InsertEdge(source, target, label);
-    IndexObject(label, edge_id, &edge_indexes_);
+    edge_id = InsertEdge(source, target, label_id);
+    util::Status status =
+        IndexObject(label.tag(), label_id, edge_id, &edge_indexes_);
+    CHECK(status.ok(), status.message());
     return edge_id;
   }
   EdgeIndex& named_edge = index_it->second;
-  string name = GetSerializationOrNull(label);
-  Edge edge(source, target, name);
-  auto name_it = named_edge.find(edge);
-  if (name_it == named_edge.end()) {
-    edge_id = InsertEdge(source, target, label);
-    name_it = named_edge.insert({Edge(source, target, name), edge_id}).first;
+  Edge edge(source, target, label_id);
+  const EdgeId* named_edge_id = named_edge.Find(edge);
+  if (named_edge_id != nullptr) {
+    return *named_edge_id;
   }
-  return name_it->second;
+  edge_id = InsertEdge(source, target, label_id);
+  named_edge.Insert(edge, edge_id);
+  util::Status status =
+      IndexObject(label.tag(), label_id, edge_id, &edge_indexes_);
+  CHECK(status.ok(), status.message());
+  return edge_id;
 }
 
 util::Status LabeledGraph::UpdateEdgeLabel(EdgeId edge_id,
                                            const TaggedAST& label) {
   CHECK(is_initialized_, kInitializationErr);
   string tmp_err;
-  if (!type::IsTyped(edge_types_, label, &tmp_err)) {
+  if (!type::IsTyped(compiled_edge_types_, label, &tmp_err)) {
     return util::Status(Code::INVALID_ARGUMENT, tmp_err);
   }
   if (!HasEdge(edge_id)) {
     return util::Status(Code::INVALID_ARGUMENT, kInvalidEdgeErr);
   }
-  TaggedAST old_label = GetEdgeLabel(edge_id);
+  LabelId old_label_id = GetEdgeLabelId(edge_id);
+  const TaggedAST& old_label = labels_.Get(old_label_id);
+  LabelId label_id = labels_.Intern(label);
   // Update the label of the edge and the relevant indexes.
-  graph_[edge_id] = label;
+  edge_hash_sum_ += EdgeHash(Source(edge_id), Target(edge_id), label_id) -
+                    EdgeHash(Source(edge_id), Target(edge_id), old_label_id);
+  graph_[edge_id] = label_id;
+  DeIndexObject(old_label.tag(), old_label_id, edge_id, &edge_indexes_);
   if (IsUniqueEdgeType(old_label)) {
-    string name = GetSerializationOrNull(old_label);
-    Edge edge(Source(edge_id), Target(edge_id), name);
+    Edge edge(Source(edge_id), Target(edge_id), old_label_id);
     DeIndexUniqueEdge(old_label.tag(), edge, &named_edges_);
-  } else {
-    DeIndexObject(old_label, edge_id, &edge_indexes_);
   }
   if (IsUniqueEdgeType(label)) {
-    string name = GetSerializationOrNull(label);
-    Edge edge(Source(edge_id), Target(edge_id), name);
-    return IndexUniqueEdge(label.tag(), edge, edge_id, &named_edges_);
-  } else {
-    return IndexObject(label, edge_id, &edge_indexes_);
+    Edge edge(Source(edge_id), Target(edge_id), label_id);
+    util::Status status =
+        IndexUniqueEdge(label.tag(), edge, edge_id, &named_edges_);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return IndexObject(label.tag(), label_id, edge_id, &edge_indexes_);
+}
+
+const NodeId LabeledGraph::kRemovedNode = std::numeric_limits<NodeId>::max();
+
+// The incident edges of the nodes are removed before the nodes are marked,
+// because edges can only be removed between nodes that exist. The index
+// entries of each affected label are then filtered in one pass.
+void LabeledGraph::RemoveNodes(const std::vector<NodeId>& nodes) {
+  CHECK(is_initialized_, kInitializationErr);
+  std::vector<NodeId> removed(nodes);
+  std::sort(removed.begin(), removed.end());
+  removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+  std::vector<EdgeId> edges;
+  for (NodeId node_id : removed) {
+    CHECK(HasNode(node_id), kInvalidNodeErr);
+    for (auto edges_it = ::boost::out_edges(node_id, graph_);
+         edges_it.first != edges_it.second; ++edges_it.first) {
+      edges.push_back(*edges_it.first);
+    }
+    for (auto edges_it = ::boost::in_edges(node_id, graph_);
+         edges_it.first != edges_it.second; ++edges_it.first) {
+      edges.push_back(*edges_it.first);
+    }
+  }
+  std::vector<NodeId> affected;
+  std::vector<size_t> old_degrees;
+  if (is_tracking_degrees_) {
+    affected = removed;
+    for (const EdgeId& edge_id : edges) {
+      affected.push_back(::boost::source(edge_id, graph_));
+      affected.push_back(::boost::target(edge_id, graph_));
+    }
+    RecordDegrees(&affected, &old_degrees);
+  }
+  DeIndexEdges(edges);
+  if (is_removed_node_.size() < ::boost::num_vertices(graph_)) {
+    is_removed_node_.resize(::boost::num_vertices(graph_), false);
+  }
+  std::unordered_set<LabelId> indexed_labels;
+  for (NodeId node_id : removed) {
+    ::boost::clear_vertex(node_id, graph_);
+    is_removed_node_[node_id] = true;
+    for (NodeColumn& column : node_columns_) {
+      SetColumnEntry(TaggedAST(), node_id, &column);
+    }
+    ++num_removed_nodes_;
+    LabelId label_id = graph_[node_id];
+    node_hash_sum_ -= NodeHash(node_id, label_id);
+    const TaggedAST& label = labels_.Get(label_id);
+    if (IsUniqueNodeType(label)) {
+      DeIndexUniqueNode(label.tag(), label_id, &named_nodes_);
+    } else {
+      indexed_labels.insert(label_id);
+    }
+  }
+  for (LabelId label_id : indexed_labels) {
+    Index<std::vector<NodeId>>& index =
+        node_indexes_.find(labels_.Get(label_id).tag())->second;
+    auto label_it = index.find(label_id);
+    if (label_it == index.end()) {
+      continue;
+    }
+    std::vector<NodeId>& indexed_nodes = label_it->second;
+    indexed_nodes.erase(
+        std::remove_if(indexed_nodes.begin(), indexed_nodes.end(),
+                       [this](NodeId node_id) {
+                         return is_removed_node_[node_id];
+                       }),
+        indexed_nodes.end());
+    if (indexed_nodes.empty()) {
+      index.erase(label_it);
+    }
+  }
+  if (is_tracking_degrees_) {
+    DecreaseDegrees(affected, old_degrees);
+  }
+}
+
+void LabeledGraph::RemoveEdges(const std::vector<EdgeId>& edges) {
+  CHECK(is_initialized_, kInitializationErr);
+  for (const EdgeId& edge_id : edges) {
+    CHECK(HasEdge(edge_id), kInvalidEdgeErr);
+  }
+  const std::vector<EdgeId> removed = DeIndexEdges(edges);
+  std::vector<NodeId> endpoints;
+  std::vector<size_t> old_degrees;
+  if (is_tracking_degrees_) {
+    for (const EdgeId& edge_id : removed) {
+      endpoints.push_back(::boost::source(edge_id, graph_));
+      endpoints.push_back(::boost::target(edge_id, graph_));
+    }
+    RecordDegrees(&endpoints, &old_degrees);
+  }
+  for (const EdgeId& edge_id : removed) {
+    ::boost::remove_edge(edge_id, graph_);
+  }
+  if (is_tracking_degrees_) {
+    DecreaseDegrees(endpoints, old_degrees);
+  }
+}
+
+// Edge ids are compared by the address of their property, which identifies an
+// edge as long as it exists.
+std::vector<EdgeId> LabeledGraph::DeIndexEdges(
+    const std::vector<EdgeId>& edges) {
+  std::unordered_set<const void*> removed;
+  std::vector<EdgeId> distinct_edges;
+  std::unordered_set<LabelId> indexed_labels;
+  for (const EdgeId& edge_id : edges) {
+    if (!removed.insert(edge_id.get_property()).second) {
+      continue;
+    }
+    distinct_edges.push_back(edge_id);
+    LabelId label_id = graph_[edge_id];
+    const TaggedAST& label = labels_.Get(label_id);
+    NodeId source = ::boost::source(edge_id, graph_);
+    NodeId target = ::boost::target(edge_id, graph_);
+    edge_hash_sum_ -= EdgeHash(source, target, label_id);
+    if (IsUniqueEdgeType(label)) {
+      DeIndexUniqueEdge(label.tag(), Edge(source, target, label_id),
+                        &named_edges_);
+    }
+    indexed_labels.insert(label_id);
+  }
+  for (LabelId label_id : indexed_labels) {
+    Index<std::vector<EdgeId>>& index =
+        edge_indexes_.find(labels_.Get(label_id).tag())->second;
+    auto label_it = index.find(label_id);
+    if (label_it == index.end()) {
+      continue;
+    }
+    std::vector<EdgeId>& indexed_edges = label_it->second;
+    indexed_edges.erase(
+        std::remove_if(indexed_edges.begin(), indexed_edges.end(),
+                       [&removed](const EdgeId& edge_id) {
+                         return removed.count(edge_id.get_property()) > 0;
+                       }),
+        indexed_edges.end());
+    if (indexed_edges.empty()) {
+      index.erase(label_it);
+    }
+  }
+  return distinct_edges;
+}
+
+bool LabeledGraph::HasRemovedNodes() const {
+  CHECK(is_initialized_, kInitializationErr);
+  return num_removed_nodes_ > 0;
+}
+
+std::vector<NodeId> LabeledGraph::Compact() {
+  CHECK(is_initialized_, kInitializationErr);
+  if (num_removed_nodes_ == 0) {
+    std::vector<NodeId> node_map(::boost::num_vertices(graph_));
+    std::iota(node_map.begin(), node_map.end(), 0);
+    return node_map;
+  }
+  std::vector<NodeId> order;
+  order.reserve(NumNodes());
+  for (NodeId node_id = 0; node_id < ::boost::num_vertices(graph_);
+       ++node_id) {
+    if (HasNode(node_id)) {
+      order.push_back(node_id);
+    }
+  }
+  return Renumber(order);
+}
+
+std::vector<NodeId> LabeledGraph::Compact(const std::vector<NodeId>& order) {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(order.size() == static_cast<size_t>(NumNodes()), kOrderErr);
+  std::vector<bool> is_ordered(::boost::num_vertices(graph_), false);
+  for (NodeId node_id : order) {
+    CHECK(HasNode(node_id) && !is_ordered[node_id], kOrderErr);
+    is_ordered[node_id] = true;
+  }
+  std::vector<NodeId> node_map = Renumber(order);
+  ShrinkToFit();
+  return node_map;
+}
+
+// The nodes are visited in a queue that is stored in the order itself, and
+// each node enqueues its successors and then its predecessors.
+std::vector<NodeId> LabeledGraph::BreadthFirstOrder() const {
+  CHECK(is_initialized_, kInitializationErr);
+  const NodeId num_node_ids = ::boost::num_vertices(graph_);
+  std::vector<bool> is_visited(num_node_ids, false);
+  std::vector<NodeId> order;
+  order.reserve(NumNodes());
+  for (NodeId root = 0; root < num_node_ids; ++root) {
+    if (is_visited[root] || !HasNode(root)) {
+      continue;
+    }
+    is_visited[root] = true;
+    order.push_back(root);
+    for (size_t next = order.size() - 1; next < order.size(); ++next) {
+      const NodeId node_id = order[next];
+      for (NodeId successor : GetSuccessorRange(node_id)) {
+        if (!is_visited[successor]) {
+          is_visited[successor] = true;
+          order.push_back(successor);
+        }
+      }
+      for (NodeId predecessor : GetPredecessorRange(node_id)) {
+        if (!is_visited[predecessor]) {
+          is_visited[predecessor] = true;
+          order.push_back(predecessor);
+        }
+      }
+    }
+  }
+  return order;
+}
+
+std::vector<NodeId> LabeledGraph::ColumnOrder(int column) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(column >= 0 && column < NumNodeColumns(), kInvalidColumnErr);
+  const NodeColumn& node_column = node_columns_[column];
+  std::vector<NodeId> order;
+  std::vector<NodeId> invalid;
+  order.reserve(NumNodes());
+  for (NodeId node_id = 0; node_id < ::boost::num_vertices(graph_);
+       ++node_id) {
+    if (!HasNode(node_id)) {
+      continue;
+    }
+    if (node_column.IsValid(node_id)) {
+      order.push_back(node_id);
+    } else {
+      invalid.push_back(node_id);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&node_column](NodeId a, NodeId b) {
+                     return node_column.values[a] < node_column.values[b];
+                   });
+  order.insert(order.end(), invalid.begin(), invalid.end());
+  return order;
+}
+
+// Index vectors and node columns are shrunk by swapping them with copies, so
+// that a column keeps its allocator.
+void LabeledGraph::ShrinkToFit() {
+  CHECK(is_initialized_, kInitializationErr);
+  graph_.m_vertices.shrink_to_fit();
+  for (auto& vertex : graph_.m_vertices) {
+    vertex.m_out_edges.shrink_to_fit();
+    vertex.m_in_edges.shrink_to_fit();
+  }
+  for (auto& tagged_index : node_indexes_) {
+    for (auto& label_nodes : tagged_index.second) {
+      label_nodes.second.shrink_to_fit();
+    }
+    tagged_index.second.shrink_to_fit();
+  }
+  for (auto& tagged_index : edge_indexes_) {
+    for (auto& label_edges : tagged_index.second) {
+      label_edges.second.shrink_to_fit();
+    }
+    tagged_index.second.shrink_to_fit();
+  }
+  for (auto& tagged_index : named_nodes_) {
+    tagged_index.second.shrink_to_fit();
+  }
+  for (auto& tagged_index : named_edges_) {
+    tagged_index.second.ShrinkToFit();
+  }
+  for (NodeColumn& column : node_columns_) {
+    util::PageVector<int64_t>(column.values).swap(column.values);
+    util::PageVector<uint64_t>(column.is_valid).swap(column.is_valid);
+  }
+  is_checked_node_label_.shrink_to_fit();
+  is_checked_edge_label_.shrink_to_fit();
+  is_removed_node_.shrink_to_fit();
+  label_hashes_.shrink_to_fit();
+}
+
+// The nodes are copied to a new Boost graph in the order of 'order', and the
+// edges in the order of their sources in 'order' and of the out-edges of each
+// source. The adjacency lists of a node are allocated at their final size.
+// The indexes are then rewritten in place with the new ids.
+std::vector<NodeId> LabeledGraph::Renumber(const std::vector<NodeId>& order) {
+  std::vector<NodeId> node_map(::boost::num_vertices(graph_), kRemovedNode);
+  Graph compacted;
+  compacted.m_vertices.reserve(order.size());
+  for (NodeId node_id : order) {
+    const NodeId new_id = ::boost::add_vertex(graph_[node_id], compacted);
+    node_map[node_id] = new_id;
+    compacted.m_vertices[new_id].m_out_edges.reserve(
+        ::boost::out_degree(node_id, graph_));
+    compacted.m_vertices[new_id].m_in_edges.reserve(
+        ::boost::in_degree(node_id, graph_));
+  }
+  std::unordered_map<const void*, EdgeId> edge_map;
+  edge_map.reserve(::boost::num_edges(graph_));
+  for (NodeId node_id : order) {
+    for (auto edges_it = ::boost::out_edges(node_id, graph_);
+         edges_it.first != edges_it.second; ++edges_it.first) {
+      const EdgeId& edge_id = *edges_it.first;
+      edge_map[edge_id.get_property()] =
+          ::boost::add_edge(node_map[node_id],
+                            node_map[::boost::target(edge_id, graph_)],
+                            graph_[edge_id], compacted)
+              .first;
+    }
+  }
+  for (auto& tagged_index : node_indexes_) {
+    for (auto& label_nodes : tagged_index.second) {
+      for (NodeId& node_id : label_nodes.second) {
+        node_id = node_map[node_id];
+      }
+    }
+  }
+  for (auto& tagged_index : named_nodes_) {
+    for (auto& label_node : tagged_index.second) {
+      label_node.second = node_map[label_node.second];
+    }
+  }
+  for (auto& tagged_index : edge_indexes_) {
+    for (auto& label_edges : tagged_index.second) {
+      for (EdgeId& edge_id : label_edges.second) {
+        edge_id = edge_map.find(edge_id.get_property())->second;
+      }
+    }
+  }
+  for (auto& tagged_index : named_edges_) {
+    EdgeIndex index;
+    index.Reserve(tagged_index.second.Size());
+    tagged_index.second.ForEach([&](const Edge& edge, EdgeId edge_id) {
+      index.Insert(Edge(node_map[edge.source], node_map[edge.target],
+                        edge.label),
+                   edge_map.find(edge_id.get_property())->second);
+    });
+    tagged_index.second.Swap(&index);
+  }
+  for (NodeColumn& column : node_columns_) {
+    util::PageVector<int64_t> values(NumNodes(), 0,
+                                     column.values.get_allocator());
+    util::PageVector<uint64_t> is_valid((values.size() + 63) / 64, 0,
+                                        column.is_valid.get_allocator());
+    for (NodeId node_id = 0; node_id < column.values.size(); ++node_id) {
+      NodeId new_id = node_map[node_id];
+      if (new_id != kRemovedNode && column.IsValid(node_id)) {
+        values[new_id] = column.values[node_id];
+        is_valid[new_id / 64] |= uint64_t{1} << (new_id % 64);
+      }
+    }
+    column.values.swap(values);
+    column.is_valid.swap(is_valid);
+  }
+  // Graph::swap copies the graphs, which would move the edge properties that
+  // the edge ids in the indexes point to, so the storage is swapped instead.
+  graph_.m_vertices.swap(compacted.m_vertices);
+  graph_.m_edges.swap(compacted.m_edges);
+  is_removed_node_.clear();
+  num_removed_nodes_ = 0;
+  RehashGraph();
+  // The histograms do not depend on node ids, but the hubs do.
+  are_hubs_valid_ = false;
+  return node_map;
+}
+
+LabeledGraph::BulkLoader::BulkLoader(LabeledGraph* graph)
+    : graph_(graph), is_finished_(false) {
+  CHECK(graph_->is_initialized_, kInitializationErr);
+}
+
+LabeledGraph::BulkLoader::~BulkLoader() { Finish(); }
+
+// The vertex storage of a Boost adjacency list with vecS vertices is a public
+// vector member, which is the only way to reserve space for vertices.
+void LabeledGraph::BulkLoader::Reserve(int num_nodes, int num_edges) {
+  CHECK(!is_finished_, kLoaderFinishedErr);
+  graph_->graph_.m_vertices.reserve(graph_->graph_.m_vertices.size() +
+                                    num_nodes);
+  pending_nodes_.reserve(pending_nodes_.size() + num_nodes);
+  pending_edges_.reserve(pending_edges_.size() + num_edges);
+}
+
+NodeId LabeledGraph::BulkLoader::AddNode(const TaggedAST& label) {
+  CHECK(!is_finished_, kLoaderFinishedErr);
+  return AddInternedNode(graph_->labels_.Intern(label));
+}
+
+NodeId LabeledGraph::BulkLoader::AddNode(TaggedAST&& label) {
+  CHECK(!is_finished_, kLoaderFinishedErr);
+  return AddInternedNode(graph_->labels_.Intern(std::move(label)));
+}
+
+NodeId LabeledGraph::BulkLoader::AddTypedNode(TaggedAST&& label) {
+  CHECK(!is_finished_, kLoaderFinishedErr);
+  CHECK(graph_->compiled_node_types_.count(label.tag()) > 0,
+        kUndeclaredTagErr);
+  LabelId label_id = graph_->labels_.Intern(std::move(label));
+  graph_->MarkChecked(label_id, &graph_->is_checked_node_label_);
+  return AddInternedNode(label_id);
+}
+
+// As in FindOrAddInternedNode, the interned copy of the label is used.
+NodeId LabeledGraph::BulkLoader::AddInternedNode(LabelId label_id) {
+  const TaggedAST& label = graph_->labels_.Get(label_id);
+  graph_->CheckLabel(graph_->compiled_node_types_, label, label_id,
+                     &graph_->is_checked_node_label_);
+  auto index_it = graph_->named_nodes_.find(label.tag());
+  if (index_it == graph_->named_nodes_.end()) {
+    NodeId node_id = graph_->InsertNode(label_id);
+    pending_nodes_.emplace_back(label_id, node_id);
+    return node_id;
+  }
+  Index<NodeId>& named_node = index_it->second;
+  auto name_it = named_node.find(label_id);
+  if (name_it == named_node.end()) {
+    NodeId node_id = graph_->InsertNode(label_id);
+    name_it = named_node.insert({label_id, node_id}).first;
+  }
+  return name_it->second;
+}
+
+EdgeId LabeledGraph::BulkLoader::AddEdge(NodeId source, NodeId target,
+                                         const TaggedAST& label) {
+  CHECK(!is_finished_, kLoaderFinishedErr);
+  return AddInternedEdge(source, target, graph_->labels_.Intern(label));
+}
+
+EdgeId LabeledGraph::BulkLoader::AddInternedEdge(NodeId source, NodeId target,
+                                                 LabelId label_id) {
+  const TaggedAST& label = graph_->labels_.Get(label_id);
+  graph_->CheckLabel(graph_->compiled_edge_types_, label, label_id,
+                     &graph_->is_checked_edge_label_);
+  auto index_it = graph_->named_edges_.find(label.tag());
+  if (index_it == graph_->named_edges_.end()) {
+    EdgeId edge_id = graph_->InsertEdge(source, target, label_id);
+    pending_edges_.emplace_back(label_id, edge_id);
+    return edge_id;
+  }
+  EdgeIndex& named_edge = index_it->second;
+  Edge edge(source, target, label_id);
+  const EdgeId* named_edge_id = named_edge.Find(edge);
+  if (named_edge_id != nullptr) {
+    return *named_edge_id;
+  }
+  EdgeId edge_id = graph_->InsertEdge(source, target, label_id);
+  named_edge.Insert(edge, edge_id);
+  pending_edges_.emplace_back(label_id, edge_id);
+  return edge_id;
+}
+
+std::vector<NodeId> LabeledGraph::BulkLoader::AddNodes(
+    const std::vector<TaggedAST>& labels) {
+  std::vector<NodeId> node_ids;
+  node_ids.reserve(labels.size());
+  for (const TaggedAST& label : labels) {
+    node_ids.push_back(AddNode(label));
+  }
+  return node_ids;
+}
+
+std::vector<EdgeId> LabeledGraph::BulkLoader::AddEdges(
+    const std::vector<NodeId>& sources, const std::vector<NodeId>& targets,
+    const std::vector<TaggedAST>& labels) {
+  CHECK(sources.size() == targets.size() && sources.size() == labels.size(),
+        kBatchSizeErr);
+  std::vector<EdgeId> edge_ids;
+  edge_ids.reserve(labels.size());
+  for (size_t i = 0; i < labels.size(); ++i) {
+    edge_ids.push_back(AddEdge(sources[i], targets[i], labels[i]));
+  }
+  return edge_ids;
+}
+
+void LabeledGraph::BulkLoader::Finish() {
+  if (is_finished_) {
+    return;
+  }
+  is_finished_ = true;
+  IndexPendingObjects(graph_->labels_, &pending_nodes_,
+                      &graph_->node_indexes_);
+  IndexPendingObjects(graph_->labels_, &pending_edges_,
+                      &graph_->edge_indexes_);
+}
+
+// The labels of 'other' are interned when they are first used, so replaced
+// labels that remain in its label store are not copied, and the map from its
+// label ids to label ids of the graph is a vector.
+std::vector<NodeId> LabeledGraph::Merge(const LabeledGraph& other) {
+  CHECK(is_initialized_ && other.is_initialized_, kInitializationErr);
+  CHECK(&other != this, kSelfMergeErr);
+  std::vector<LabelId> label_map(other.labels_.Size(), kNoLabel);
+  auto map_label = [this, &other, &label_map](LabelId label_id) {
+    if (label_map[label_id] == kNoLabel) {
+      label_map[label_id] = labels_.Intern(other.labels_.Get(label_id));
+    }
+    return label_map[label_id];
+  };
+  std::vector<NodeId> node_map(::boost::num_vertices(other.graph_),
+                               kRemovedNode);
+  BulkLoader loader(this);
+  loader.Reserve(other.NumNodes(), other.NumEdges());
+  for (NodeId node_id = 0; node_id < node_map.size(); ++node_id) {
+    if (other.HasNode(node_id)) {
+      node_map[node_id] =
+          loader.AddInternedNode(map_label(other.graph_[node_id]));
+    }
+  }
+  for (auto edge_it = other.EdgeSetBegin(); edge_it != other.EdgeSetEnd();
+       ++edge_it) {
+    loader.AddInternedEdge(
+        node_map[::boost::source(*edge_it, other.graph_)],
+        node_map[::boost::target(*edge_it, other.graph_)],
+        map_label(other.graph_[*edge_it]));
+  }
+  loader.Finish();
+  return node_map;
+}
+
+// A column is filled by projecting each distinct label once, since many nodes
+// typically share a label.
+int LabeledGraph::AddNodeColumn(const string& tag,
+                                const std::vector<int>& field) {
+  CHECK(is_initialized_, kInitializationErr);
+  auto type_it = node_types_.find(tag);
+  CHECK(type_it != node_types_.end(), kUndeclaredTagErr);
+  CHECK(IsColumnField(type_it->second, field), kColumnFieldErr);
+  for (int column = 0; column < NumNodeColumns(); ++column) {
+    if (node_columns_[column].tag == tag &&
+        node_columns_[column].field == field) {
+      return column;
+    }
+  }
+  NodeColumn column;
+  column.tag = tag;
+  column.field = field;
+  column.values = util::PageVector<int64_t>(
+      util::PageAllocator<int64_t>(column_policy_));
+  column.is_valid = util::PageVector<uint64_t>(
+      util::PageAllocator<uint64_t>(column_policy_));
+  column.values.assign(::boost::num_vertices(graph_), 0);
+  column.is_valid.assign((column.values.size() + 63) / 64, 0);
+  std::unordered_map<LabelId, std::pair<bool, int64_t>> label_values;
+  for (NodeId node_id = 0; node_id < column.values.size(); ++node_id) {
+    if (!HasNode(node_id)) {
+      continue;
+    }
+    LabelId label_id = graph_[node_id];
+    auto value_it = label_values.find(label_id);
+    if (value_it == label_values.end()) {
+      std::pair<bool, int64_t> value(false, 0);
+      value.first =
+          GetColumnValue(column, labels_.Get(label_id), &value.second);
+      value_it = label_values.insert({label_id, value}).first;
+    }
+    if (value_it->second.first) {
+      column.values[node_id] = value_it->second.second;
+      column.is_valid[node_id / 64] |= uint64_t{1} << (node_id % 64);
+    }
+  }
+  node_columns_.push_back(std::move(column));
+  return NumNodeColumns() - 1;
+}
+
+void LabeledGraph::SetColumnAllocationPolicy(
+    const util::AllocationPolicy& policy) {
+  column_policy_ = policy;
+}
+
+int LabeledGraph::NumNodeColumns() const {
+  return static_cast<int>(node_columns_.size());
+}
+
+const NodeColumn& LabeledGraph::GetNodeColumn(int column) const {
+  CHECK(column >= 0 && column < NumNodeColumns(), kInvalidColumnErr);
+  return node_columns_[column];
+}
+
+// Nodes whose labels have a tag that is not a node type, which only occur if
+// labels are not type checked, are counted in an extra histogram at the end.
+void LabeledGraph::TrackDegrees(int num_hubs) {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(num_hubs >= 0, kNumHubsErr);
+  is_tracking_degrees_ = true;
+  num_hubs_ = num_hubs;
+  degree_histograms_.assign(node_types_by_id_.size() + 1,
+                            std::vector<int64_t>());
+  for (NodeId node_id = 0; node_id < ::boost::num_vertices(graph_);
+       ++node_id) {
+    if (HasNode(node_id)) {
+      CountDegree(node_id, Degree(node_id), 1);
+    }
   }
+  RecomputeHubs();
+}
+
+int LabeledGraph::Degree(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return ::boost::in_degree(node_id, graph_) +
+         ::boost::out_degree(node_id, graph_);
 }
+
+std::vector<int64_t> LabeledGraph::GetDegreeHistogram(
+    const string& tag) const {
+  CHECK(is_tracking_degrees_, kNoDegreesErr);
+  const TypeId type_id = GetNodeTypeId(tag);
+  CHECK(type_id != kNoType, kInvalidTypeIdErr);
+  return degree_histograms_[type_id];
+}
+
+std::vector<NodeId> LabeledGraph::GetHubs() const {
+  CHECK(is_tracking_degrees_, kNoDegreesErr);
+  if (!are_hubs_valid_) {
+    RecomputeHubs();
+  }
+  std::vector<NodeId> hubs;
+  hubs.reserve(hubs_.size());
+  for (auto hub_it = hubs_.rbegin(); hub_it != hubs_.rend(); ++hub_it) {
+    hubs.push_back(hub_it->second);
+  }
+  return hubs;
+}
+
+TypeId LabeledGraph::NodeLabelTypeId(LabelId label_id) {
+  if (label_id >= label_type_ids_.size()) {
+    label_type_ids_.resize(labels_.Size(), kNoType);
+  }
+  TypeId& type_id = label_type_ids_[label_id];
+  if (type_id == kNoType) {
+    type_id = GetTypeId(labels_.Get(label_id).tag(), compiled_node_types_);
+  }
+  return type_id;
+}
+
+void LabeledGraph::CountDegree(NodeId node_id, size_t degree,
+                               int64_t count) {
+  const TypeId type_id = NodeLabelTypeId(graph_[node_id]);
+  std::vector<int64_t>& histogram =
+      degree_histograms_[type_id == kNoType ? degree_histograms_.size() - 1
+                                            : type_id];
+  const size_t bucket = DegreeBucket(degree);
+  if (bucket >= histogram.size()) {
+    histogram.resize(bucket + 1, 0);
+  }
+  histogram[bucket] += count;
+}
+
+// The hubs are the nodes of highest degree as long as degrees only increase:
+// a node that is not a hub can only become one when its degree increases, and
+// it then replaces the least hub if it is greater in the order of hubs. Every
+// node of positive degree is a hub while there are fewer than 'num_hubs_'
+// hubs.
+void LabeledGraph::IncreaseDegree(NodeId node_id, size_t old_degree) {
+  const size_t degree = Degree(node_id);
+  if (DegreeBucket(degree) != DegreeBucket(old_degree)) {
+    CountDegree(node_id, old_degree, -1);
+    CountDegree(node_id, degree, 1);
+  }
+  if (!are_hubs_valid_ || num_hubs_ == 0) {
+    return;
+  }
+  auto hub_it = hubs_.find({old_degree, node_id});
+  if (hub_it != hubs_.end()) {
+    hubs_.erase(hub_it);
+  } else if (hubs_.size() == static_cast<size_t>(num_hubs_)) {
+    if (!HubOrder()(*hubs_.begin(), {degree, node_id})) {
+      return;
+    }
+    hubs_.erase(hubs_.begin());
+  }
+  hubs_.emplace(degree, node_id);
+}
+
+void LabeledGraph::RecordDegrees(std::vector<NodeId>* nodes,
+                                 std::vector<size_t>* degrees) const {
+  std::sort(nodes->begin(), nodes->end());
+  nodes->erase(std::unique(nodes->begin(), nodes->end()), nodes->end());
+  degrees->clear();
+  degrees->reserve(nodes->size());
+  for (NodeId node_id : *nodes) {
+    degrees->push_back(Degree(node_id));
+  }
+}
+
+// A hub whose degree decreases may no longer be among the nodes of highest
+// degree, so the hubs are recomputed when they are next requested.
+void LabeledGraph::DecreaseDegrees(const std::vector<NodeId>& nodes,
+                                   const std::vector<size_t>& old_degrees) {
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    CountDegree(nodes[i], old_degrees[i], -1);
+    if (HasNode(nodes[i])) {
+      CountDegree(nodes[i], Degree(nodes[i]), 1);
+    }
+  }
+  are_hubs_valid_ = false;
+}
+
+void LabeledGraph::RecomputeHubs() const {
+  hubs_.clear();
+  are_hubs_valid_ = true;
+  if (num_hubs_ == 0) {
+    return;
+  }
+  for (NodeId node_id = 0; node_id < ::boost::num_vertices(graph_);
+       ++node_id) {
+    if (!HasNode(node_id)) {
+      continue;
+    }
+    const std::pair<size_t, NodeId> hub(Degree(node_id), node_id);
+    if (hub.first == 0) {
+      continue;
+    }
+    if (hubs_.size() == static_cast<size_t>(num_hubs_)) {
+      if (!HubOrder()(*hubs_.begin(), hub)) {
+        continue;
+      }
+      hubs_.erase(hubs_.begin());
+    }
+    hubs_.insert(hub);
+  }
+}
+
 // In a Boost adjacency list graph that uses vectors internally (like the
 // LabeledGraph), node ids are unsigned values in the range [0, NumNodes() - 1],
 // where NumNodes() is the number of nodes in the graph.
 // http://www.boost.org/doc/libs/1_37_0/libs/graph/doc/adjacency_list.html
 bool LabeledGraph::HasNode(NodeId node_id) const {
-  return static_cast<int>(node_id) < NumNodes();
+  return static_cast<int>(node_id) < NumNodeIds() &&
+         (node_id >= is_removed_node_.size() || !is_removed_node_[node_id]);
 }
 
 // An EdgeId in Boost is implemented as a struct containing a source and a
@@ -385,18 +1755,39 @@ bool LabeledGraph::HasEdge(EdgeId edge_id) const {
 // nodes (as done here), node ids range between 0 and the number of nodes in the
 // graph.
 // http://www.boost.org/doc/libs/1_37_0/libs/graph/doc/adjacency_list.html
-TaggedAST LabeledGraph::GetNodeLabel(NodeId node_id) const {
-  CHECK(is_initialized_, kInitializationErr);
+const TaggedAST& LabeledGraph::GetNodeLabel(NodeId node_id) const {
+  return labels_.Get(GetNodeLabelId(node_id));
+}
+
+const TaggedAST& LabeledGraph::GetEdgeLabel(EdgeId edge_id) const {
+  return labels_.Get(GetEdgeLabelId(edge_id));
+}
+
+// Label lookups are on the hot path of every traversal. HasNode and HasEdge
+// also check that the graph is initialized, so that check is only repeated in
+// debug builds.
+LabelId LabeledGraph::GetNodeLabelId(NodeId node_id) const {
+  DCHECK(is_initialized_, kInitializationErr);
   CHECK(HasNode(node_id), kInvalidNodeErr);
   return graph_[node_id];
 }
 
-TaggedAST LabeledGraph::GetEdgeLabel(EdgeId edge_id) const {
-  CHECK(is_initialized_, kInitializationErr);
+LabelId LabeledGraph::GetEdgeLabelId(EdgeId edge_id) const {
+  DCHECK(is_initialized_, kInitializationErr);
   CHECK(HasEdge(edge_id), kInvalidEdgeErr);
   return graph_[edge_id];
 }
 
+int LabeledGraph::NumDistinctLabels() const {
+  CHECK(is_initialized_, kInitializationErr);
+  return labels_.Size();
+}
+
+const TaggedAST& LabeledGraph::GetLabel(LabelId label_id) const {
+  CHECK(is_initialized_, kInitializationErr);
+  return labels_.Get(label_id);
+}
+
 NodeId LabeledGraph::Source(EdgeId edge_id) const {
   CHECK(is_initialized_, kInitializationErr);
   CHECK(HasEdge(edge_id), kInvalidEdgeErr);
@@ -424,35 +1815,29 @@ bool LabeledGraph::IsUniqueEdgeType(const TaggedAST& label_type) const {
   return (named_edges_.find(label_type.tag()) != named_edges_.end());
 }
 
-std::set<NodeId> LabeledGraph::GetNodes(const TaggedAST& label) const {
+util::Span<NodeId> LabeledGraph::GetNodes(const TaggedAST& label) const {
   CHECK(is_initialized_, kInitializationErr);
   const auto index_it = named_nodes_.find(label.tag());
   if (index_it == named_nodes_.end()) {
-    return GetLabeledObjects(label, node_indexes_);
+    return GetLabeledObjects(label, labels_, node_indexes_);
+  }
+  std::pair<bool, LabelId> label_id = labels_.Find(label);
+  if (!label_id.first) {
+    return {};
   }
   const Index<NodeId>& named_node = index_it->second;
-  const auto name_it = named_node.find(GetSerializationOrNull(label));
+  const auto name_it = named_node.find(label_id.second);
   if (name_it == named_node.end()) {
     return {};
   }
-  return {name_it->second};
+  // The span refers to the slot of the node in 'named_node', and remains valid
+  // until 'named_node' is modified.
+  return util::Span<NodeId>(&name_it->second, 1);
 }
 
-std::set<EdgeId> LabeledGraph::GetEdges(const TaggedAST& label) const {
+util::Span<EdgeId> LabeledGraph::GetEdges(const TaggedAST& label) const {
   CHECK(is_initialized_, kInitializationErr);
-  const auto index_it = named_edges_.find(label.tag());
-  if (index_it == named_edges_.end()) {
-    return GetLabeledObjects(label, edge_indexes_);
-  }
-  const EdgeIndex& edge_index = index_it->second;
-  const string& name = GetSerializationOrNull(label);
-  std::set<EdgeId> edges;
-  for (const auto& key_edge : edge_index) {
-    if (key_edge.first.label == name) {
-      edges.insert(key_edge.second);
-    }
-  }
-  return edges;
+  return GetLabeledObjects(label, labels_, edge_indexes_);
 }
 
 // In a Boost graph which uses an adjacency list representation, the type NodeId
@@ -460,23 +1845,75 @@ std::set<EdgeId> LabeledGraph::GetEdges(const TaggedAST& label) const {
 std::set<NodeId> LabeledGraph::GetPredecessors(NodeId node_id) const {
   CHECK(is_initialized_, kInitializationErr);
   CHECK(HasNode(node_id), kInvalidNodeErr);
-  std::set<NodeId> predecessors;
-  for (InEdgeIterator edge_it = InEdgeBegin(node_id);
-       edge_it != InEdgeEnd(node_id); ++edge_it) {
-    predecessors.insert(Source(*edge_it));
-  }
-  return predecessors;
+  PredecessorRange predecessors = GetPredecessorRange(node_id);
+  return std::set<NodeId>(predecessors.begin(), predecessors.end());
 }
 
 std::set<NodeId> LabeledGraph::GetSuccessors(NodeId node_id) const {
   CHECK(is_initialized_, kInitializationErr);
   CHECK(HasNode(node_id), kInvalidNodeErr);
-  std::set<NodeId> successors;
-  for (OutEdgeIterator edge_it = OutEdgeBegin(node_id);
-       edge_it != OutEdgeEnd(node_id); ++edge_it) {
-    successors.insert(Target(*edge_it));
+  SuccessorRange successors = GetSuccessorRange(node_id);
+  return std::set<NodeId>(successors.begin(), successors.end());
+}
+
+PredecessorRange LabeledGraph::GetPredecessorRange(NodeId node_id) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return ::boost::make_iterator_range(
+      ::boost::inv_adjacent_vertices(node_id, graph_));
+}
+
+SuccessorRange LabeledGraph::GetSuccessorRange(NodeId node_id) const {
+  CHECK(is_initialized_, kInitializationErr);
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  return ::boost::make_iterator_range(
+      ::boost::adjacent_vertices(node_id, graph_));
+}
+
+void LabeledGraph::CollectPredecessors(NodeId node_id, NodeMarker* marker,
+                                       std::vector<NodeId>* nodes) const {
+  for (NodeId predecessor : GetPredecessorRange(node_id)) {
+    if (marker->Mark(predecessor)) {
+      nodes->push_back(predecessor);
+    }
   }
-  return successors;
+  marker->Clear();
+}
+
+void LabeledGraph::CollectSuccessors(NodeId node_id, NodeMarker* marker,
+                                     std::vector<NodeId>* nodes) const {
+  for (NodeId successor : GetSuccessorRange(node_id)) {
+    if (marker->Mark(successor)) {
+      nodes->push_back(successor);
+    }
+  }
+  marker->Clear();
+}
+
+void LabeledGraph::CollectLabelPredecessors(const TaggedAST& label,
+                                            NodeMarker* marker,
+                                            std::vector<NodeId>* nodes) const {
+  for (NodeId target_id : GetNodes(label)) {
+    for (NodeId predecessor : GetPredecessorRange(target_id)) {
+      if (marker->Mark(predecessor)) {
+        nodes->push_back(predecessor);
+      }
+    }
+  }
+  marker->Clear();
+}
+
+void LabeledGraph::CollectLabelSuccessors(const TaggedAST& label,
+                                          NodeMarker* marker,
+                                          std::vector<NodeId>* nodes) const {
+  for (NodeId source_id : GetNodes(label)) {
+    for (NodeId successor : GetSuccessorRange(source_id)) {
+      if (marker->Mark(successor)) {
+        nodes->push_back(successor);
+      }
+    }
+  }
+  marker->Clear();
 }
 
 InEdgeIterator LabeledGraph::InEdgeBegin(NodeId node_id) const {
@@ -506,11 +1943,9 @@ OutEdgeIterator LabeledGraph::OutEdgeEnd(NodeId node_id) const {
 std::set<NodeId> LabeledGraph::GetLabelPredecessors(
     const TaggedAST& label) const {
   CHECK(is_initialized_, kInitializationErr);
-  std::set<NodeId> target_nodes = GetNodes(label);
   std::set<NodeId> predecessors;
-  std::set<NodeId> sources;
-  for (NodeId target_id : target_nodes) {
-    sources = GetPredecessors(target_id);
+  for (NodeId target_id : GetNodes(label)) {
+    PredecessorRange sources = GetPredecessorRange(target_id);
     predecessors.insert(sources.begin(), sources.end());
   }
   return predecessors;
@@ -519,11 +1954,9 @@ std::set<NodeId> LabeledGraph::GetLabelPredecessors(
 std::set<NodeId> LabeledGraph::GetLabelSuccessors(
     const TaggedAST& label) const {
   CHECK(is_initialized_, kInitializationErr);
-  std::set<NodeId> source_nodes = GetNodes(label);
   std::set<NodeId> successors;
-  std::set<NodeId> targets;
-  for (NodeId source_id : source_nodes) {
-    targets = GetSuccessors(source_id);
+  for (NodeId source_id : GetNodes(label)) {
+    SuccessorRange targets = GetSuccessorRange(source_id);
     successors.insert(targets.begin(), targets.end());
   }
   return successors;
@@ -560,6 +1993,11 @@ int LabeledGraph::NumUniqueNodeTypes() const {
 }
 
 int LabeledGraph::NumNodes() const {
+  CHECK(is_initialized_, kInitializationErr);
+  return ::boost::num_vertices(graph_) - num_removed_nodes_;
+}
+
+int LabeledGraph::NumNodeIds() const {
   CHECK(is_initialized_, kInitializationErr);
   return ::boost::num_vertices(graph_);
 }
@@ -579,6 +2017,55 @@ int LabeledGraph::NumUniqueEdgeTypes() const {
   return named_edges_.size();
 }
 
+// The vertices of the Boost graph are stored in a vector. Every edge is a node
+// of a list and has an entry in the out-edges of its source and in the
+// in-edges of its target.
+util::MemoryBreakdown LabeledGraph::MemoryUsage() const {
+  CHECK(is_initialized_, kInitializationErr);
+  util::MemoryBreakdown usage;
+  usage["vertices"] =
+      boost::num_vertices(graph_) * sizeof(Graph::stored_vertex);
+  usage["edges"] =
+      boost::num_edges(graph_) *
+      (sizeof(Graph::EdgeContainer::value_type) + 2 * sizeof(void*) +
+       2 * sizeof(Graph::StoredEdge));
+  usage["labels"] = labels_.MemoryBytes();
+  AddIndexBytes("node_indexes", node_indexes_, &usage);
+  AddIndexBytes("edge_indexes", edge_indexes_, &usage);
+  AddIndexBytes("named_nodes", named_nodes_, &usage);
+  for (const auto& tagged_index : named_edges_) {
+    usage[util::StrCat("named_edges/", tagged_index.first)] =
+        tagged_index.second.MemoryBytes();
+  }
+  size_t column_bytes = 0;
+  for (const NodeColumn& column : node_columns_) {
+    column_bytes +=
+        util::VectorBytes(column.values) + util::VectorBytes(column.is_valid);
+  }
+  usage["node_columns"] = column_bytes;
+  usage["node_flags"] = util::VectorBytes(is_checked_node_label_) +
+                        util::VectorBytes(is_checked_edge_label_) +
+                        util::VectorBytes(is_removed_node_);
+  if (is_tracking_degrees_) {
+    size_t degree_bytes = util::VectorBytes(degree_histograms_) +
+                          util::VectorBytes(label_type_ids_);
+    for (const std::vector<int64_t>& histogram : degree_histograms_) {
+      degree_bytes += util::VectorBytes(histogram);
+    }
+    // A tree node holds a hub and three pointers and a color.
+    degree_bytes += hubs_.size() * (sizeof(std::pair<size_t, NodeId>) +
+                                    4 * sizeof(void*));
+    usage["degrees"] = degree_bytes;
+  }
+  return usage;
+}
+
+uint64_t LabeledGraph::Fingerprint() const {
+  CHECK(is_initialized_, kInitializationErr);
+  uint64_t hash = CombineHashes(types_hash_, MessageHash(graph_label_));
+  return CombineHashes(CombineHashes(hash, node_hash_sum_), edge_hash_sum_);
+}
+
 int LabeledGraph::NumEdges() const {
   CHECK(is_initialized_, kInitializationErr);
   return ::boost::num_edges(graph_);
@@ -589,21 +2076,81 @@ int LabeledGraph::NumLabeledEdges(const TaggedAST& label) const {
   return GetEdges(label).size();
 }
 
-NodeId LabeledGraph::InsertNode(TaggedAST label) {
-  NodeId node_id = ::boost::add_vertex(graph_);
-  graph_[node_id].Swap(&label);
+NodeId LabeledGraph::InsertNode(LabelId label_id) {
+  NodeId node_id = ::boost::add_vertex(label_id, graph_);
+  SetColumnEntries(node_id);
+  node_hash_sum_ += NodeHash(node_id, label_id);
+  if (is_tracking_degrees_) {
+    CountDegree(node_id, 0, 1);
+  }
   return node_id;
 }
 
+void LabeledGraph::SetColumnEntries(NodeId node_id) {
+  for (NodeColumn& column : node_columns_) {
+    SetColumnEntry(labels_.Get(graph_[node_id]), node_id, &column);
+  }
+}
+
 // ::boost::add_edge(..) adds an edge from a source to a target node and returns
 // a pair. The first element of the pair is an edge id and the second is a bool
 // whose value is relevant for graphs in which there can be at most one edge
 // between two vertices. Uniqueness in LabeledGraph depends on labels so the
 // bool value is ignored here.
-EdgeId LabeledGraph::InsertEdge(NodeId source, NodeId target, TaggedAST label) {
-  EdgeId edge_id = ::boost::add_edge(source, target, graph_).first;
-  graph_[edge_id].Swap(&label);
+EdgeId LabeledGraph::InsertEdge(NodeId source, NodeId target,
+                                LabelId label_id) {
+  edge_hash_sum_ += EdgeHash(source, target, label_id);
+  if (!is_tracking_degrees_) {
+    return ::boost::add_edge(source, target, label_id, graph_).first;
+  }
+  const size_t source_degree = Degree(source);
+  const size_t target_degree = Degree(target);
+  EdgeId edge_id = ::boost::add_edge(source, target, label_id, graph_).first;
+  IncreaseDegree(source, source_degree);
+  if (target != source) {
+    IncreaseDegree(target, target_degree);
+  }
   return edge_id;
 }
 
+// A label whose hash happens to be 0 is hashed again on every use, which is
+// correct but slower.
+uint64_t LabeledGraph::LabelHash(LabelId label_id) {
+  if (label_id >= label_hashes_.size()) {
+    label_hashes_.resize(labels_.Size(), 0);
+  }
+  uint64_t& hash = label_hashes_[label_id];
+  if (hash == 0) {
+    hash = MessageHash(labels_.Get(label_id));
+  }
+  return hash;
+}
+
+uint64_t LabeledGraph::NodeHash(NodeId node_id, LabelId label_id) {
+  return CombineHashes(util::internal::MixHash(node_id), LabelHash(label_id));
+}
+
+uint64_t LabeledGraph::EdgeHash(NodeId source, NodeId target,
+                                LabelId label_id) {
+  return CombineHashes(
+      CombineHashes(util::internal::MixHash(source), target),
+      LabelHash(label_id));
+}
+
+void LabeledGraph::RehashGraph() {
+  node_hash_sum_ = 0;
+  edge_hash_sum_ = 0;
+  for (NodeId node_id = 0; node_id < ::boost::num_vertices(graph_);
+       ++node_id) {
+    node_hash_sum_ += NodeHash(node_id, graph_[node_id]);
+  }
+  for (auto edges_it = ::boost::edges(graph_);
+       edges_it.first != edges_it.second; ++edges_it.first) {
+    const EdgeId& edge_id = *edges_it.first;
+    edge_hash_sum_ += EdgeHash(::boost::source(edge_id, graph_),
+                               ::boost::target(edge_id, graph_),
+                               graph_[edge_id]);
+  }
+}
+
 }  // namespace morphie
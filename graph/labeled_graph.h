@@ -48,17 +48,25 @@
 #define LOGLE_LABELED_GRAPH_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <boost/functional/hash/hash.hpp>
 #include <boost/graph/directed_graph.hpp>
+#include <boost/range/iterator_range.hpp>
 #include <set>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "base/string.h"
+#include "graph/label_store.h"
 #include "graph/type_checker.h"
 #include "ast.pb.h"
+#include "util/flat_hash_map.h"
+#include "util/memory_usage.h"
+#include "util/page_allocator.h"
+#include "util/span.h"
 #include "util/status.h"
 
 namespace morphie {
@@ -68,17 +76,18 @@ using std::unordered_map;
 
 // The declaration below defines a Graph type using the Boost Graph Library. A
 // graph is represented as an adjacency_list. The set of nodes and set of edges
-// adjacent to a node are represented as std::vectors (boost::vecS). Node labels
-// and edge labels are TaggedASTs and the graph label is an AST.
+// adjacent to a node are represented as std::vectors (boost::vecS). Nodes and
+// edges store the identifier of their label in a LabelStore, so that a label
+// shared by many nodes or edges is stored only once. The graph label is an AST.
 using Graph = ::boost::adjacency_list<::boost::vecS, ::boost::vecS,
-                                      ::boost::bidirectionalS, TaggedAST,
-                                      TaggedAST, AST>;
+                                      ::boost::bidirectionalS, LabelId,
+                                      LabelId, AST>;
 using NodeId = ::boost::graph_traits<Graph>::vertex_descriptor;
 using EdgeId = ::boost::graph_traits<Graph>::edge_descriptor;
-// An Edge consists of a source node, a target node and a string serialization
-// of the AST representing the edge label.
+// An Edge consists of a source node, a target node and the identifier of the
+// interned edge label.
 struct Edge {
-  Edge(NodeId src, NodeId tgt, const string& lbl)
+  Edge(NodeId src, NodeId tgt, LabelId lbl)
       : source(src), target(tgt), label(lbl) {}
 
   friend bool operator==(const Edge& a, const Edge& b) {
@@ -88,7 +97,7 @@ struct Edge {
 
   NodeId source;
   NodeId target;
-  string label;
+  LabelId label;
 };
 // The hash function used by indexes that have edges as keys.
 struct EdgeHash {
@@ -112,22 +121,180 @@ using InEdgeIterator = ::boost::graph_traits<Graph>::in_edge_iterator;
 using InEdgeRange = std::pair<InEdgeIterator, InEdgeIterator>;
 using OutEdgeIterator = ::boost::graph_traits<Graph>::out_edge_iterator;
 using OutEdgeRange = std::pair<OutEdgeIterator, OutEdgeIterator>;
+// Ranges over the successors and predecessors of a node, obtained by iterating
+// over the adjacency structure of the graph without copying it. A node that is
+// connected to another by several edges occurs several times in a range.
+using SuccessorIterator = ::boost::graph_traits<Graph>::adjacency_iterator;
+using SuccessorRange = ::boost::iterator_range<SuccessorIterator>;
+using PredecessorIterator = Graph::inv_adjacency_iterator;
+using PredecessorRange = ::boost::iterator_range<PredecessorIterator>;
+
+// A NodeMarker is a reusable set of nodes used as scratch space by functions
+// that collect distinct nodes. Marking and testing a node takes constant time,
+// and clearing the marker takes time linear in the number of marked nodes, so
+// the same marker can be used for many queries without reallocating memory.
+class NodeMarker {
+ public:
+  NodeMarker() {}
+  // Marks 'node_id' and returns true if it was not already marked.
+  bool Mark(NodeId node_id) {
+    if (node_id >= is_marked_.size()) {
+      is_marked_.resize(node_id + 1, false);
+    }
+    if (is_marked_[node_id]) {
+      return false;
+    }
+    is_marked_[node_id] = true;
+    marked_.push_back(node_id);
+    return true;
+  }
+  bool IsMarked(NodeId node_id) const {
+    return node_id < is_marked_.size() && is_marked_[node_id];
+  }
+  // Unmarks all marked nodes.
+  void Clear() {
+    for (NodeId node_id : marked_) {
+      is_marked_[node_id] = false;
+    }
+    marked_.clear();
+  }
+  int NumMarked() const { return static_cast<int>(marked_.size()); }
+
+ private:
+  std::vector<bool> is_marked_;
+  std::vector<NodeId> marked_;
+};
+
 // A Graph object internally contains a map from nodes and edges to labels. An
-// index is a map from labels to sets of nodes or sets of edges. For nodes with
-// unique labels, the index maps labels to nodes. The key in an index is a
-// serialization of an AST proto.
+// index is a map from labels to lists of nodes or lists of edges, stored as
+// vectors in the order in which the nodes or edges acquired the label. For nodes
+// with unique labels, the index maps labels to nodes. The key in an index is the
+// identifier of an interned label, so looking up a label requires hashing the
+// label once and no serialization. Indexes are looked up for every node or
+// edge that is added, so they are flat hash maps.
 template <typename ObjectT>
-using Index = unordered_map<string, ObjectT>;
+using Index = util::FlatHashMap<LabelId, ObjectT>;
 // There is one index for each type of node or edge label. A key in the Indexes
-// map is a string like "File" representing a tag in a TaggedAST. Importantly, a
-// key in Indexes, is not a serialization of a proto.
+// map is a string like "File" representing a tag in a TaggedAST.
 template <typename ObjectT>
 using Indexes = unordered_map<string, Index<ObjectT>>;
-// The EdgeIndex below is used for unique edge labels. It is defined separately
-// from the index types above because it uses a custom hash function.
-using EdgeIndex = unordered_map<Edge, EdgeId, EdgeHash>;
+
+// Node and edge types are interned when a graph is initialized. The id of a
+// type is the position of its tag in the sorted order of the tags of types of
+// the same kind, so ids are consecutive integers starting at 0.
+using TypeId = int;
+// The id returned for a tag that has no type.
+const TypeId kNoType = -1;
+// An EdgeIndex maps the edges with unique labels of one tag to their
+// identifiers. Unique edges are the most numerous elements of many graphs and
+// every insertion of such an edge looks it up, so the index is an open
+// addressing table with linear probing instead of an unordered_map. The key
+// of an entry is the source, target and label identifier of an edge, which is
+// stored with the edge identifier in one slot of a vector, so a lookup reads
+// a few adjacent slots instead of following pointers to heap allocated nodes.
+// Erasing an entry shifts the entries after it back instead of leaving a
+// tombstone, so lookups do not slow down as edges are relabelled or removed.
+class EdgeIndex {
+ public:
+  EdgeIndex() : size_(0) {}
+
+  // Returns a pointer to the identifier of 'edge', or nullptr if 'edge' is not
+  // in the index. The pointer is invalidated by the next insertion or erasure.
+  const EdgeId* Find(const Edge& edge) const;
+  // Inserts 'edge' with the identifier 'edge_id' unless 'edge' is in the
+  // index. Returns the identifier of 'edge' in the index, and true if the edge
+  // was inserted.
+  // - Crashes if the label identifier of 'edge' is the largest LabelId, which
+  //   marks empty slots.
+  std::pair<EdgeId, bool> Insert(const Edge& edge, EdgeId edge_id);
+  // Removes 'edge' from the index. Returns true if 'edge' was in the index.
+  bool Erase(const Edge& edge);
+  // Reserves slots for 'num_edges' entries.
+  void Reserve(size_t num_edges);
+  // Moves the entries into the fewest slots that hold them.
+  void ShrinkToFit();
+  size_t Size() const { return size_; }
+  // Returns the bytes of the slots of the index.
+  size_t MemoryBytes() const { return slots_.capacity() * sizeof(Slot); }
+  void Swap(EdgeIndex* other) {
+    slots_.swap(other->slots_);
+    std::swap(size_, other->size_);
+  }
+  // Calls fn(edge, edge_id) for each entry of the index, in no fixed order.
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    for (const Slot& slot : slots_) {
+      if (slot.label != kEmptySlot) {
+        fn(Edge(slot.source, slot.target, slot.label), slot.edge_id);
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    NodeId source;
+    NodeId target;
+    LabelId label;
+    EdgeId edge_id;
+  };
+
+  static const LabelId kEmptySlot = ~LabelId{0};
+
+  // Returns the slot at which a probe for 'edge' starts.
+  size_t HomeSlot(const Edge& edge) const;
+  // Returns the slot that holds 'edge', or the empty slot that ends the probe
+  // for 'edge'. The table must have an empty slot.
+  size_t FindSlot(const Edge& edge) const;
+  // Moves the entries into a table with 'num_slots' slots, which must be a
+  // power of two that is larger than the number of entries.
+  void Rehash(size_t num_slots);
+
+  // The number of slots is zero or a power of two.
+  std::vector<Slot> slots_;
+  size_t size_;
+};  // class EdgeIndex
 using UniqueEdges = unordered_map<string, EdgeIndex>;
 
+// A NodeColumn is a projection of one integer or timestamp field of the labels
+// of the nodes with a given tag. The field is stored in a vector indexed by
+// node id, so that scans, filters and aggregates over the field read
+// contiguous memory instead of label protos. The entry of a node is valid if
+// the node has a label with the tag in which the field is not null. Bit
+// (i % 64) of word (i / 64) of 'is_valid' is set if the entry of node i is
+// valid, and invalid entries are 0. Both vectors may be shorter than the
+// number of node ids, in which case the missing entries are invalid. The
+// vectors are allocated according to the column allocation policy of the
+// graph.
+struct NodeColumn {
+  bool IsValid(NodeId node_id) const {
+    return node_id < values.size() &&
+           ((is_valid[node_id / 64] >> (node_id % 64)) & 1) != 0;
+  }
+
+  string tag;
+  // The path to the field in a label. The i-th entry is the index of an
+  // argument of the tuple selected by the previous entries, and the empty path
+  // selects the whole label.
+  std::vector<int> field;
+  util::PageVector<int64_t> values;
+  util::PageVector<uint64_t> is_valid;
+};
+
+// The label validation mode of a graph determines which labels of new nodes and
+// edges are type checked. Analyzers that construct labels with a fixed shape
+// can trade safety for speed by checking only some labels. In every mode, a
+// label is checked at most once no matter how many nodes or edges carry it,
+// and a label whose tag has no type is rejected, so that every node and edge
+// is indexed.
+enum class LabelValidation {
+  // Every distinct label is checked.
+  kFull,
+  // One in every N distinct labels is checked, where N is the sample period.
+  kSampled,
+  // Labels are checked only if NDEBUG is not defined.
+  kDebugOnly,
+};
+
 // A LabeledGraph object stores the following data: nodes, edges, a set of node
 // label types, a set of edge label types, a graph label type, a marking of node
 // and edge label types as unique, a map from nodes and edges to their labels
@@ -162,7 +329,18 @@ using UniqueEdges = unordered_map<string, EdgeIndex>;
 class LabeledGraph {
  public:
   // Create an uninitialized labelled graph.
-  LabeledGraph() : is_initialized_(false) {}
+  LabeledGraph()
+      : is_initialized_(false),
+        validation_(LabelValidation::kFull),
+        sample_period_(1),
+        num_unchecked_labels_(0),
+        num_removed_nodes_(0),
+        types_hash_(0),
+        node_hash_sum_(0),
+        edge_hash_sum_(0),
+        is_tracking_degrees_(false),
+        num_hubs_(0),
+        are_hubs_valid_(true) {}
   // Disallow copying and assignment.
   LabeledGraph(const LabeledGraph&) = delete;
   LabeledGraph& operator=(const LabeledGraph&) = delete;
@@ -195,6 +373,17 @@ class LabeledGraph {
   set<string> GetUniqueEdgeTags() const;
   // Similar to GetNodeType(..) but for edge types.
   std::pair<bool, AST> GetEdgeType(const string& tag) const;
+  // Return the id of the node (or edge) type tagged 'tag', or kNoType if no
+  // such type was declared. Code that makes many labels of a type can look up
+  // its id once and then access the type by id, which neither copies the type
+  // nor searches for its tag.
+  TypeId GetNodeTypeId(const string& tag) const;
+  TypeId GetEdgeTypeId(const string& tag) const;
+  // Return the node (or edge) type with id 'type_id'. The reference is valid
+  // for the lifetime of the graph.
+  // - Crash unless 0 <= type_id < NumNodeTypes() (or NumEdgeTypes()).
+  const AST& GetNodeTypeById(TypeId type_id) const;
+  const AST& GetEdgeTypeById(TypeId type_id) const;
   // Returns an AST representing the graph type. Unlike node and edge types, a
   // graph type is an AST, not a TaggedAST.
   AST GetGraphType() const;
@@ -219,9 +408,27 @@ class LabeledGraph {
   // A note on complexity: Adding a node with a non-unique label updates an
   // index from labels to sets of nodes. In the worst case, if all nodes have
   // the same label, this operation takes O(h + log(n)) time, where n is the
-  // number of graph nodes and h is the complexity of serializing and hashing
-  // 'label' to generate an index key.
+  // number of graph nodes and h is the complexity of hashing and comparing
+  // 'label' to find its interned identifier.
   NodeId FindOrAddNode(const TaggedAST& label);
+  // Behaves like the function above but moves a new label into the graph
+  // instead of copying it. The contents of 'label' are unspecified afterwards.
+  // A label that is allocated on a protobuf arena is copied, and the arena can
+  // be reset once the function returns.
+  NodeId FindOrAddNode(TaggedAST&& label);
+  // Returns the ids of the nodes that calls of FindOrAddNode(labels[i]) in
+  // order would return, and adds nodes in the same way. The labels are
+  // interned first, and the index entry of each label is prefetched a few
+  // labels before it is looked up, so that the cache misses of the lookups of
+  // a batch overlap instead of following one another.
+  std::vector<NodeId> FindOrAddNodes(util::Span<TaggedAST> labels);
+  // Sets the validation mode used by FindOrAddNode, FindOrAddEdge and
+  // BulkLoader. The default mode is LabelValidation::kFull. The argument
+  // 'sample_period' is only used in the mode LabelValidation::kSampled. The
+  // functions UpdateNodeLabel and UpdateEdgeLabel always check labels because
+  // they report type errors to the caller.
+  // - Crashes if 'sample_period' is less than 1.
+  void SetLabelValidation(LabelValidation validation, int sample_period);
   // Changes the label of 'node_id' to 'label'. Returns
   // - Code::INVALID_ARGUMENT if
   //   - 'node_id' does not exist, or
@@ -233,11 +440,108 @@ class LabeledGraph {
   // merged to preserve the uniqueness constraint, which in turn would require
   // updates the the set of nodes and edges in the graph.
   util::Status UpdateNodeLabel(NodeId node_id, const TaggedAST& label);
+  // Changes the labels of a batch of nodes, where the i-th update changes the
+  // label of updates[i].first to updates[i].second. The labels are type
+  // checked on 'num_threads' threads and the index entries of the old and new
+  // labels are rebuilt in one pass over the affected labels, instead of one
+  // search of an index entry per node as in UpdateNodeLabel. Returns
+  // - Code::INVALID_ARGUMENT if
+  //   - a node does not exist or occurs in more than one update, or
+  //   - a label is not of a valid label type, or
+  //   - two updates have the same unique label, or an update has a unique label
+  //     of a node that is not in the batch.
+  // - Code::OK otherwise.
+  // The graph is not changed if an error is returned, except that the new
+  // labels may have been interned. A node of the batch may take the unique
+  // label of another node of the batch, so unique labels can be permuted.
+  // - Crashes if 'num_threads' is less than 1.
+  util::Status BatchUpdateNodeLabels(
+      util::Span<std::pair<NodeId, TaggedAST>> updates, int num_threads);
   // Retrieve the id of an edge with the given label between the source and
   // target nodes. Behaves like FindOrAddNode for edge creation.
   // - Crashes if 'label' is not of a declared edge type.
   // The note about worst case complexity of FindOrAddNode applies here.
   EdgeId FindOrAddEdge(NodeId source, NodeId target, const TaggedAST& label);
+  // Behaves like the function above but moves a new label into the graph.
+  EdgeId FindOrAddEdge(NodeId source, NodeId target, TaggedAST&& label);
+  // Behave like FindOrAddNode and FindOrAddEdge above but do not type check
+  // 'label', whatever the validation mode. These functions are meant for labels
+  // constructed by a schema (see graph/schema.h), which are typed by
+  // construction if the graph was initialized with the types of that schema.
+  // - Crash if the tag of 'label' is not a declared node/edge type.
+  NodeId FindOrAddTypedNode(TaggedAST&& label);
+  EdgeId FindOrAddTypedEdge(NodeId source, NodeId target, TaggedAST&& label);
+
+  // A BulkLoader adds many nodes and edges to a graph faster than repeated
+  // calls to FindOrAddNode and FindOrAddEdge. A loader defers the
+  // construction of label indexes for non-unique labels to a single pass in
+  // Finish(). Labels are type checked according to the validation mode of the
+  // graph. Unique labels are deduplicated as they are added, exactly as in
+  // FindOrAddNode and FindOrAddEdge, so the node and edge identifiers returned
+  // are the ones those functions would return.
+  //
+  // Example.
+  //   LabeledGraph graph;
+  //   // Initialize 'graph'.
+  //   LabeledGraph::BulkLoader loader(&graph);
+  //   loader.Reserve(events.size(), 2 * events.size());
+  //   for (const TaggedAST& event : events) {
+  //     NodeId event_id = loader.AddNode(event);
+  //     ...
+  //   }
+  //   loader.Finish();
+  //
+  // Between the construction of a loader and the call to Finish(), the label
+  // queries GetNodes, GetEdges, NumLabeledNodes, NumLabeledEdges and the
+  // GetLabel* neighbor functions of the graph do not reflect the nodes and
+  // edges added by the loader, and labels must not be updated. The destructor
+  // calls Finish() if it has not been called.
+  class BulkLoader {
+   public:
+    // - Requires that 'graph' is initialized and outlives the loader.
+    explicit BulkLoader(LabeledGraph* graph);
+    ~BulkLoader();
+    // Disallow copying and assignment.
+    BulkLoader(const BulkLoader&) = delete;
+    BulkLoader& operator=(const BulkLoader&) = delete;
+
+    // Reserves space for the given number of additional nodes and edges.
+    void Reserve(int num_nodes, int num_edges);
+    // The functions below have the same semantics as FindOrAddNode and
+    // FindOrAddEdge and crash under the same conditions.
+    NodeId AddNode(const TaggedAST& label);
+    NodeId AddNode(TaggedAST&& label);
+    EdgeId AddEdge(NodeId source, NodeId target, const TaggedAST& label);
+    // Has the same semantics as FindOrAddTypedNode.
+    NodeId AddTypedNode(TaggedAST&& label);
+    // Add a batch of nodes or edges and return their identifiers in order. The
+    // i-th edge goes from sources[i] to targets[i] and has the label labels[i].
+    // - AddEdges crashes unless its arguments have the same size.
+    std::vector<NodeId> AddNodes(const std::vector<TaggedAST>& labels);
+    std::vector<EdgeId> AddEdges(const std::vector<NodeId>& sources,
+                                 const std::vector<NodeId>& targets,
+                                 const std::vector<TaggedAST>& labels);
+    // Adds the deferred entries to the label indexes of the graph. Calling
+    // Finish() more than once has no effect, and no nodes or edges may be
+    // added after Finish().
+    void Finish();
+
+   private:
+    // Merge() adds the nodes and edges of another graph with labels that it
+    // has interned.
+    friend class LabeledGraph;
+
+    // Add a node or an edge with the interned label 'label_id'.
+    NodeId AddInternedNode(LabelId label_id);
+    EdgeId AddInternedEdge(NodeId source, NodeId target, LabelId label_id);
+
+    LabeledGraph* graph_;
+    bool is_finished_;
+    // Nodes with non-unique labels and all edges, which have yet to be added
+    // to the label indexes.
+    std::vector<std::pair<LabelId, NodeId>> pending_nodes_;
+    std::vector<std::pair<LabelId, EdgeId>> pending_edges_;
+  };  // class BulkLoader
   // Changes the label of 'edge_id' to 'label'. Returns
   // - Code::INVALID_ARGUMENT if
   //   - 'edge_id' does not exist, or
@@ -246,6 +550,140 @@ class LabeledGraph {
   // See the comments for UpdateNodeLabel for a justification of these
   // restrictions.
   util::Status UpdateEdgeLabel(EdgeId edge_id, const TaggedAST& label);
+
+  // Nodes and edges are removed in place and the label indexes are updated, so
+  // removed nodes and edges no longer occur in the results of label and
+  // neighbor queries. A removed edge is deleted from the graph. A removed node
+  // leaves a tombstone: HasNode is false of its id, which is not reused, and it
+  // is not counted by NumNodes, but the ids of the other nodes do not change,
+  // so node ids are no longer consecutive and range up to NumNodeIds(). Node
+  // iterators still visit tombstones. Compact() renumbers the nodes so that
+  // their ids are consecutive again. Functions that process a whole graph,
+  // such as the transformations in graph_transformer.h, DotPrinter and
+  // FrozenLabeledGraph, require a graph without tombstones, while a
+  // LabeledGraphView of the graph skips them.
+  // Nodes and edges must not be removed while a BulkLoader is adding to the
+  // graph.
+  //
+  // Removes the nodes in 'nodes' and every edge incident to them. Takes time
+  // linear in the number of removed nodes and edges and in the number of nodes
+  // with the same non-unique labels as the removed nodes.
+  // - Crashes unless HasNode is true of every node in 'nodes'. A node may
+  //   occur several times in 'nodes'.
+  void RemoveNodes(const std::vector<NodeId>& nodes);
+  // Removes the edges in 'edges'. Removing an edge also takes time linear in
+  // the degree of its source and target and in the number of edges with the
+  // same label. Edge ids of the other edges remain valid.
+  // - Crashes unless HasEdge is true of every edge in 'edges'. An edge may
+  //   occur several times in 'edges'.
+  void RemoveEdges(const std::vector<EdgeId>& edges);
+  // Returns true if nodes have been removed since the graph was last compacted.
+  bool HasRemovedNodes() const;
+  // Renumbers the nodes that have not been removed, in increasing order of
+  // their ids, so that their ids range from 0 to NumNodes() - 1. Returns the
+  // map from every node id before compaction to the id of the node after
+  // compaction, or to kRemovedNode if the node was removed. All node ids, edge
+  // ids, iterators and spans obtained from the graph are invalidated, except
+  // that a graph without removed nodes is not changed. Nodes and edges keep
+  // their order in the label indexes. Takes time linear in the size of the
+  // graph.
+  std::vector<NodeId> Compact();
+  // Renumbers the nodes that have not been removed so that the node at
+  // position i of 'order' has the id i, and returns the map from node ids
+  // before compaction to node ids after compaction, as Compact() does. The
+  // graph is rebuilt even if no nodes were removed, with the out-edges of the
+  // nodes stored in the new order, and its storage is then shrunk as by
+  // ShrinkToFit(). Nodes that are visited together, such as neighbors in
+  // BreadthFirstOrder() or events that are close in ColumnOrder() of their
+  // time column, are then stored together, which speeds up later passes over
+  // the graph. Invalidates the same ids, iterators and spans as Compact().
+  // Takes time linear in the size of the graph.
+  // - Crashes unless 'order' contains every node of the graph exactly once.
+  std::vector<NodeId> Compact(const std::vector<NodeId>& order);
+  // Return orders of the nodes of the graph for Compact(order).
+  // - BreadthFirstOrder visits the graph breadth-first, ignoring the direction
+  //   of edges, from each node that has not yet been visited in increasing
+  //   order of ids, so a connected component occupies a range of ids.
+  // - ColumnOrder orders the nodes with a valid entry in the node column
+  //   'column' by their entry, and then the other nodes. Nodes with equal
+  //   entries are in increasing order of ids.
+  //   - Requires that 'column' is less than NumNodeColumns().
+  std::vector<NodeId> BreadthFirstOrder() const;
+  std::vector<NodeId> ColumnOrder(int column) const;
+  // Releases the memory that the adjacency lists, the label indexes and the
+  // node columns have reserved beyond their contents, without changing any
+  // ids. Graphs that are built incrementally, such as the outputs of the
+  // transformations in graph_transformer.h, or from which nodes and edges have
+  // been removed carry such slack. Spans obtained from the graph are
+  // invalidated. Takes time linear in the size of the graph.
+  void ShrinkToFit();
+  // The image of a removed node in the map returned by Compact().
+  static const NodeId kRemovedNode;
+
+  // Adds the nodes and edges of 'other' to the graph, as FindOrAddNode and
+  // FindOrAddEdge would, and returns the map from every node id of 'other' to
+  // the id of its node in the graph, or to kRemovedNode if the node was
+  // removed from 'other'. A node or edge of 'other' with a unique label that
+  // is already in the graph is not added again, while the nodes and edges
+  // with non-unique labels are appended. Each distinct label of 'other' is
+  // interned and type checked once rather than once for each node or edge
+  // that has it, and the label indexes are updated in one pass at the end, so
+  // merging takes time linear in the size of 'other' and in the number of its
+  // distinct labels. The graphs should have the same types, since uniqueness
+  // is decided by the unique tags of the graph. graph_transformer.h has a
+  // variant that returns the map as a Morphism.
+  // - Crashes if either graph is not initialized, if 'other' is the graph, or
+  //   under the conditions under which FindOrAddNode and FindOrAddEdge crash.
+  std::vector<NodeId> Merge(const LabeledGraph& other);
+
+  // Adds a column that projects the field with path 'field' of the node labels
+  // tagged 'tag', as described for NodeColumn, and returns its index. The
+  // column is filled from the nodes in the graph and is kept up to date as
+  // nodes are added, relabelled, removed and compacted. Every column adds a
+  // constant amount of work to each of these operations. Adding a column that
+  // already exists returns the index of the existing column.
+  // - Crashes if 'tag' is not a declared node type or if 'field' is not the
+  //   path of an integer or timestamp in that type.
+  int AddNodeColumn(const string& tag, const std::vector<int>& field);
+  // Sets the policy by which the columns added afterwards allocate their
+  // vectors, such as huge pages for columns that are scanned at random. See
+  // util/page_allocator.h. The default policy allocates with operator new.
+  void SetColumnAllocationPolicy(const util::AllocationPolicy& policy);
+  int NumNodeColumns() const;
+  // Returns the column with index 'column'. The reference is valid until the
+  // next call to AddNodeColumn.
+  // - Requires that 'column' is less than NumNodeColumns().
+  const NodeColumn& GetNodeColumn(int column) const;
+
+  // Starts maintaining degree statistics, which are computed from the graph in
+  // linear time and are then kept up to date as nodes and edges are added,
+  // relabelled and removed, so that hubs are found without scanning the graph.
+  // The degree of a node is the number of its in-edges and out-edges, so a
+  // self-loop counts twice. The statistics are a histogram of the degrees of
+  // the nodes of each tag and the 'num_hubs' nodes of highest degree. Adding
+  // an edge then takes additional time logarithmic in 'num_hubs'. Removing
+  // nodes or edges, or compacting the graph, makes the next call to GetHubs()
+  // scan the nodes once. Calling this function again recomputes the
+  // statistics for the new number of hubs.
+  // - Crashes if 'num_hubs' is negative.
+  void TrackDegrees(int num_hubs);
+  bool IsTrackingDegrees() const { return is_tracking_degrees_; }
+  // Returns the number of in-edges and out-edges of 'node_id' in constant
+  // time, whether or not degrees are tracked.
+  // - Requires that HasNode(node_id) is true.
+  int Degree(NodeId node_id) const;
+  // Returns the histogram of the degrees of the nodes tagged 'tag'. Entry 0
+  // is the number of nodes of degree 0, and entry b > 0 is the number of
+  // nodes with degrees at least 2^(b-1) and less than 2^b. The histogram may
+  // end with empty entries.
+  // - Crashes if degrees are not tracked or if 'tag' is not a node type.
+  std::vector<int64_t> GetDegreeHistogram(const string& tag) const;
+  // Returns the nodes of highest degree, at most the number of hubs passed to
+  // TrackDegrees(), in decreasing order of degree and then in increasing order
+  // of id. Nodes of degree 0 are not hubs.
+  // - Crashes if degrees are not tracked.
+  std::vector<NodeId> GetHubs() const;
+
   // Returns true if there is a node with the given identifier in the graph.
   bool HasNode(NodeId node_id) const;
   // Returns true if there is an edge corresponding to a given identifier.  An
@@ -254,11 +692,23 @@ class LabeledGraph {
   bool HasEdge(EdgeId edge_id) const;
   // - Requires that HasNode(node_id) is true of the argument.
   // In the TaggedAST 't' that is returned, t.has_ast() can be false because
-  // labels can be null. An empty label is not an error.
-  TaggedAST GetNodeLabel(NodeId node_id) const;
+  // labels can be null. An empty label is not an error. The reference remains
+  // valid for the lifetime of the graph, even if the label of 'node_id' is
+  // later updated.
+  const TaggedAST& GetNodeLabel(NodeId node_id) const;
   // - Requires that HasEdge(edge_id) is true of the argument.
   // Edge ids obtained by querying this API are guaranteed to be valid.
-  TaggedAST GetEdgeLabel(EdgeId edge_id) const;
+  const TaggedAST& GetEdgeLabel(EdgeId edge_id) const;
+  // Return the identifier of the interned label of a node or an edge. Two nodes
+  // (or edges) have equal labels exactly when they have the same label id.
+  // - Require that HasNode(node_id) and HasEdge(edge_id), respectively.
+  LabelId GetNodeLabelId(NodeId node_id) const;
+  LabelId GetEdgeLabelId(EdgeId edge_id) const;
+  // Returns the number of distinct node and edge labels in the graph.
+  int NumDistinctLabels() const;
+  // Returns the interned label with identifier 'label_id'.
+  // - Requires that 'label_id' is less than NumDistinctLabels().
+  const TaggedAST& GetLabel(LabelId label_id) const;
   // An EdgeId contains a source and target NodeId and these two functions
   // retrieve those values.
   // - The functions require that HasEdge(edge_id) be true.
@@ -269,12 +719,15 @@ class LabeledGraph {
 
   bool IsUniqueNodeType(const TaggedAST& label_type) const;
   bool IsUniqueEdgeType(const TaggedAST& label_type) const;
-  // Returns the set of nodes with a given label and returns the empty set if no
-  // such nodes exist.
-  set<NodeId> GetNodes(const TaggedAST& label) const;
-  // Returns the set of edges with a given label and returns the empty set if no
-  // such nodes exist.
-  set<EdgeId> GetEdges(const TaggedAST& label) const;
+  // Returns the nodes with a given label and returns the empty span if no such
+  // nodes exist. The span refers to an index inside the graph, so no elements
+  // are copied, and is invalidated by the next call to a function that adds
+  // nodes or changes node labels. A node occurs at most once in the span.
+  util::Span<NodeId> GetNodes(const TaggedAST& label) const;
+  // Returns the edges with a given label and returns the empty span if no such
+  // edges exist. The span is invalidated by adding edges or changing edge
+  // labels.
+  util::Span<EdgeId> GetEdges(const TaggedAST& label) const;
   // In an edge (u,v), the vertex u is the predecessor and v is the successor.
   // The functions below return the predecessors and successors of a node with a
   // given id. The functions return the empty set if either the node has no
@@ -282,6 +735,27 @@ class LabeledGraph {
   //  - The functions require that HasNode(node_id) is true.
   set<NodeId> GetPredecessors(NodeId node_id) const;
   set<NodeId> GetSuccessors(NodeId node_id) const;
+  // The functions below return the predecessors and successors of a node as
+  // ranges over the adjacency structure of the graph. Unlike GetPredecessors
+  // and GetSuccessors, they do not allocate memory but may contain duplicates.
+  //  - The functions require that HasNode(node_id) is true.
+  PredecessorRange GetPredecessorRange(NodeId node_id) const;
+  SuccessorRange GetSuccessorRange(NodeId node_id) const;
+  // The functions below append the distinct predecessors (or successors) of a
+  // node, or of all nodes with a given label, to 'nodes' in the order in which
+  // they are first encountered. The 'marker' is used to detect duplicates and is
+  // cleared before the functions return. Nodes already in 'nodes' are neither
+  // removed nor taken into account. Reusing 'marker' and 'nodes' across calls
+  // avoids the allocations made by the set-returning functions.
+  //  - The node functions require that HasNode(node_id) is true.
+  void CollectPredecessors(NodeId node_id, NodeMarker* marker,
+                           std::vector<NodeId>* nodes) const;
+  void CollectSuccessors(NodeId node_id, NodeMarker* marker,
+                         std::vector<NodeId>* nodes) const;
+  void CollectLabelPredecessors(const TaggedAST& label, NodeMarker* marker,
+                                std::vector<NodeId>* nodes) const;
+  void CollectLabelSuccessors(const TaggedAST& label, NodeMarker* marker,
+                              std::vector<NodeId>* nodes) const;
   // These functions return iterators to the sets of incoming edges to a node or
   // outgoing edges from a node.
   InEdgeIterator InEdgeBegin(NodeId node_id) const;
@@ -305,31 +779,164 @@ class LabeledGraph {
   int NumNodeTypes() const;
   int NumUniqueNodeTypes() const;
   int NumNodes() const;
+  // Returns one more than the largest node id, which is NumNodes() unless
+  // nodes have been removed.
+  int NumNodeIds() const;
   int NumLabeledNodes(const TaggedAST& label) const;
   int NumEdgeTypes() const;
   int NumUniqueEdgeTypes() const;
   int NumEdges() const;
   int NumLabeledEdges(const TaggedAST& label) const;
+  // Returns an estimate of the bytes used by the graph, as described in
+  // util/memory_usage.h, with the components
+  // - "vertices" and "edges", the adjacency lists of the graph,
+  // - "labels", the label store,
+  // - "node_indexes/<tag>", "edge_indexes/<tag>", "named_nodes/<tag>" and
+  //   "named_edges/<tag>", the index of each tag,
+  // - "node_columns", the columns added by AddNodeColumn,
+  // - "node_flags", the flags of checked labels and removed nodes, and
+  // - "degrees", the degree statistics, if TrackDegrees() has been called.
+  // Takes time linear in the number of labels and index entries.
+  util::MemoryBreakdown MemoryUsage() const;
+  // Returns a 64-bit fingerprint of the types, the graph label, the ids and
+  // labels of the nodes, and the sources, targets and labels of the edges.
+  // Graphs with equal types, graph labels, nodes and edges have the same
+  // fingerprint, whatever the order in which their nodes and edges were added
+  // or removed, and distinct graphs have the same fingerprint with a
+  // probability of about 2^-64, so the fingerprint can key the results of
+  // analyses of the graph. The fingerprint is maintained as nodes and edges are
+  // added, relabelled and removed, so this function only hashes the graph
+  // label. Compact() renumbers nodes and so changes the fingerprint of a graph
+  // with removed nodes. Labels are hashed in serialized form with std::hash, so
+  // fingerprints are stable across runs of a program but may differ between
+  // builds.
+  uint64_t Fingerprint() const;
 
  private:
+  // A view iterates over the Boost graph directly, so that the edges it skips
+  // are not validated one at a time.
+  friend class LabeledGraphView;
+
   // InsertNode(..) and InsertEdge(...) always modify the graph, unlike the
   // FindOrAdd functions, which might leave the graph unchanged.
-  NodeId InsertNode(TaggedAST label);
-  EdgeId InsertEdge(NodeId source, NodeId target, TaggedAST label);
+  NodeId InsertNode(LabelId label_id);
+  EdgeId InsertEdge(NodeId source, NodeId target, LabelId label_id);
+  // Implement FindOrAddNode and FindOrAddEdge for an interned label.
+  NodeId FindOrAddInternedNode(LabelId label_id);
+  EdgeId FindOrAddInternedEdge(NodeId source, NodeId target, LabelId label_id);
+
+  // Type checks 'label', which has the id 'label_id', against 'types' unless
+  // the label has already been checked or skipped or the validation mode skips
+  // it. The tag of the label is looked up in every mode.
+  // - Crashes if the tag of the label has no type in 'types', or if the label
+  //   is checked and is not typed.
+  void CheckLabel(const ast::type::CompiledTypes& types,
+                  const TaggedAST& label, LabelId label_id,
+                  std::vector<bool>* is_checked);
+  // Records that the label with id 'label_id' need not be type checked.
+  void MarkChecked(LabelId label_id, std::vector<bool>* is_checked);
+  // Sets the entries of 'node_id' in the node columns to the fields of its
+  // label.
+  void SetColumnEntries(NodeId node_id);
+  // Removes the edges in 'edges' from the label indexes and returns them
+  // without duplicates.
+  std::vector<EdgeId> DeIndexEdges(const std::vector<EdgeId>& edges);
+  // Return the hash of the label with id 'label_id', which is computed once,
+  // and the terms that a node or an edge contributes to the fingerprint.
+  uint64_t LabelHash(LabelId label_id);
+  uint64_t NodeHash(NodeId node_id, LabelId label_id);
+  uint64_t EdgeHash(NodeId source, NodeId target, LabelId label_id);
+  // Recomputes the sums of the node and edge hashes.
+  void RehashGraph();
+  // Implements Compact for an 'order' that contains every node exactly once.
+  std::vector<NodeId> Renumber(const std::vector<NodeId>& order);
+  // Returns the type id of the node label with id 'label_id', which is looked
+  // up once for each label.
+  TypeId NodeLabelTypeId(LabelId label_id);
+  // Adds 'count' to the entry of the degree histogram of the type of
+  // 'node_id' for 'degree'.
+  void CountDegree(NodeId node_id, size_t degree, int64_t count);
+  // Updates the degree statistics after edges were added to 'node_id', which
+  // had the degree 'old_degree'.
+  void IncreaseDegree(NodeId node_id, size_t old_degree);
+  // Sorts 'nodes', removes duplicates and sets '*degrees' to their degrees.
+  void RecordDegrees(std::vector<NodeId>* nodes,
+                     std::vector<size_t>* degrees) const;
+  // Updates the degree statistics after the edges of the nodes in 'nodes' were
+  // removed, where 'old_degrees' are their degrees recorded by RecordDegrees()
+  // before the removal. The nodes may have been removed themselves.
+  void DecreaseDegrees(const std::vector<NodeId>& nodes,
+                       const std::vector<size_t>& old_degrees);
+  // Recomputes the hubs by scanning the nodes.
+  void RecomputeHubs() const;
+
+  // Orders hubs by degree and then by decreasing id, so that the first hub in
+  // the order is the first to be replaced.
+  struct HubOrder {
+    bool operator()(const std::pair<size_t, NodeId>& a,
+                    const std::pair<size_t, NodeId>& b) const {
+      return a.first < b.first || (a.first == b.first && a.second > b.second);
+    }
+  };
 
   bool is_initialized_;
   ast::type::Types node_types_;
   ast::type::Types edge_types_;
+  ast::type::CompiledTypes compiled_node_types_;
+  ast::type::CompiledTypes compiled_edge_types_;
+  // The compiled types indexed by type id.
+  std::vector<const ast::type::CompiledType*> node_types_by_id_;
+  std::vector<const ast::type::CompiledType*> edge_types_by_id_;
+  LabelValidation validation_;
+  int sample_period_;
+  // The number of distinct labels that were candidates for a sampled check.
+  int64_t num_unchecked_labels_;
+  // The entries at position 'i' are true if the label with id 'i' has been
+  // type checked, or skipped by sampled validation, as a node label or an edge
+  // label, respectively.
+  std::vector<bool> is_checked_node_label_;
+  std::vector<bool> is_checked_edge_label_;
   AST graph_type_;
   AST graph_label_;
+  // Node and edge labels. Labels that have been replaced by UpdateNodeLabel or
+  // UpdateEdgeLabel are not removed from the store.
+  LabelStore labels_;
   Graph graph_;
+  // The entry at position 'i' is true if the node with id 'i' has been removed
+  // since the last compaction. Nodes beyond the end have not been removed.
+  std::vector<bool> is_removed_node_;
+  int num_removed_nodes_;
 
-  Indexes<set<NodeId>> node_indexes_;
-  Indexes<set<EdgeId>> edge_indexes_;
+  // Indexes for nodes with non-unique labels and for all edges.
+  Indexes<std::vector<NodeId>> node_indexes_;
+  Indexes<std::vector<EdgeId>> edge_indexes_;
   // A unique label is called a name in this code. For nodes with unique labels,
-  // the index maps labels to node ids.
+  // the index maps labels to node ids. For edges with unique labels, the index
+  // maps a source, target and label to an edge id. Edges with unique labels
+  // also appear in 'edge_indexes_' so that GetEdges need not search this index.
   Indexes<NodeId> named_nodes_;
   UniqueEdges named_edges_;
+  std::vector<NodeColumn> node_columns_;
+  util::AllocationPolicy column_policy_;
+  // The fingerprint of a graph combines the hash of its types with the sums
+  // modulo 2^64 of the hashes of its nodes and edges, which do not depend on
+  // the order of the nodes and edges. The hash of the label with id 'i' is at
+  // position 'i' of 'label_hashes_', or 0 if it has not been computed.
+  uint64_t types_hash_;
+  uint64_t node_hash_sum_;
+  uint64_t edge_hash_sum_;
+  std::vector<uint64_t> label_hashes_;
+  // The degree statistics, which are maintained if 'is_tracking_degrees_' is
+  // true. The degree histograms are indexed by node type id, and the entry at
+  // position 'i' of 'label_type_ids_' is the type id of the label with id 'i',
+  // or kNoType if it has not been looked up. The hubs are (degree, node)
+  // pairs, which are recomputed by GetHubs() if 'are_hubs_valid_' is false.
+  bool is_tracking_degrees_;
+  int num_hubs_;
+  std::vector<std::vector<int64_t>> degree_histograms_;
+  std::vector<TypeId> label_type_ids_;
+  mutable std::set<std::pair<size_t, NodeId>, HubOrder> hubs_;
+  mutable bool are_hubs_valid_;
 };
 
 }  // namespace morphie
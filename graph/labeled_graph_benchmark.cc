@@ -0,0 +1,220 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Micro-benchmarks of the core operations of a LabeledGraph. For every graph
+// size 10^3, 10^4, ... up to --max_nodes, the benchmark measures
+//  - FindOrAddNode with labels of a non-unique and of a unique type,
+//  - FindOrAddEdge between consecutive nodes,
+//  - UpdateNodeLabel of every node,
+//  - GetNodes, GetSuccessors and GetPredecessors on the path graph of
+//    graph/test_graphs.h with that many nodes.
+// Each operation is run once per node and the benchmark reports the mean time
+// and the mean number of heap allocations per operation. Allocations are
+// counted by the operator new of util/alloc_hooks.cc, which the benchmark
+// links.
+//
+// Example.
+//   labeled_graph_benchmark --max_nodes=10000000
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#include "base/string.h"
+#include "gflags/gflags.h"
+#include "graph/labeled_graph.h"
+#include "graph/test_graphs.h"
+#include "graph/type.h"
+#include "graph/value.h"
+#include "util/alloc_profile.h"
+#include "util/logging.h"
+#include "util/status.h"
+
+DEFINE_int64(max_nodes, 1000000,
+             "The number of nodes of the largest graph, at least 1000.");
+
+namespace morphie {
+namespace {
+
+namespace type = ast::type;
+namespace value = ast::value;
+
+// Tags of the labels of the benchmark graph. Weights are not unique and names
+// are, so a weight is a label of an event and a name is a label of a file in
+// the analyzers.
+const char kNodeWeightTag[] = "Node-Weight";
+const char kNodeNameTag[] = "Node-Name";
+const char kEdgeWeightTag[] = "Edge-Weight";
+const char kGraphTag[] = "Benchmark-Graph";
+
+// The number of distinct weights, so that many nodes share a weight.
+const int kNumWeights = 16;
+
+// Initializes 'graph' with an int node type 'kNodeWeightTag', a unique int node
+// type 'kNodeNameTag' and an int edge type 'kEdgeWeightTag'.
+void InitializeGraph(LabeledGraph* graph) {
+  type::Types node_types;
+  node_types.emplace(kNodeWeightTag,
+                     type::MakeInt(kNodeWeightTag, /*Must not be null*/ false));
+  node_types.emplace(kNodeNameTag,
+                     type::MakeInt(kNodeNameTag, /*Must not be null*/ false));
+  type::Types edge_types;
+  edge_types.emplace(kEdgeWeightTag,
+                     type::MakeInt(kEdgeWeightTag, /*Must not be null*/ false));
+  util::Status status =
+      graph->Initialize(node_types, {kNodeNameTag}, edge_types, {},
+                        type::MakeNull(kGraphTag));
+  CHECK(status.ok(), status.message());
+}
+
+TaggedAST MakeLabel(const char* tag, int val) {
+  TaggedAST label;
+  label.set_tag(tag);
+  *label.mutable_ast() = value::MakeInt(val);
+  return label;
+}
+
+// Sets the int value of a label constructed by MakeLabel.
+void SetLabelValue(int val, TaggedAST* label) {
+  label->mutable_ast()->mutable_p_ast()->mutable_val()->set_int_val(val);
+}
+
+// Measures the operations that are run between the construction of a
+// Measurement and the call to Finish.
+class Measurement {
+ public:
+  explicit Measurement(const string& name)
+      : name_(name),
+        start_allocations_(util::ThreadAllocationCounts().allocations) {
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  // Prints the measurements of 'num_ops' operations on a graph of 'num_nodes'.
+  void Finish(int64_t num_nodes, int64_t num_ops) {
+    std::chrono::duration<double, std::nano> nanos =
+        std::chrono::steady_clock::now() - start_;
+    int64_t allocations =
+        util::ThreadAllocationCounts().allocations - start_allocations_;
+    num_ops = std::max<int64_t>(num_ops, 1);
+    std::cout << std::left << std::setw(26) << name_ << std::right
+              << std::setw(10) << num_nodes << std::fixed
+              << std::setprecision(1) << std::setw(12)
+              << nanos.count() / num_ops << " ns/op" << std::setprecision(2)
+              << std::setw(10) << static_cast<double>(allocations) / num_ops
+              << " allocs/op" << std::endl;
+  }
+
+ private:
+  const string name_;
+  const int64_t start_allocations_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+void RunMutationBenchmarks(int num_nodes) {
+  LabeledGraph graph;
+  InitializeGraph(&graph);
+  {
+    TaggedAST label = MakeLabel(kNodeWeightTag, 0);
+    Measurement measurement("FindOrAddNode/non-unique");
+    for (int i = 0; i < num_nodes; ++i) {
+      SetLabelValue(i % kNumWeights, &label);
+      graph.FindOrAddNode(label);
+    }
+    measurement.Finish(num_nodes, num_nodes);
+  }
+  {
+    TaggedAST label = MakeLabel(kNodeNameTag, 0);
+    Measurement measurement("FindOrAddNode/unique");
+    for (int i = 0; i < num_nodes; ++i) {
+      SetLabelValue(i, &label);
+      graph.FindOrAddNode(label);
+    }
+    measurement.Finish(num_nodes, num_nodes);
+  }
+  {
+    TaggedAST label = MakeLabel(kEdgeWeightTag, 0);
+    Measurement measurement("FindOrAddEdge");
+    for (int i = 0; i + 1 < num_nodes; ++i) {
+      SetLabelValue(i % kNumWeights, &label);
+      graph.FindOrAddEdge(i, i + 1, label);
+    }
+    measurement.Finish(num_nodes, num_nodes - 1);
+  }
+  {
+    TaggedAST label = MakeLabel(kNodeWeightTag, 0);
+    Measurement measurement("UpdateNodeLabel");
+    for (int i = 0; i < num_nodes; ++i) {
+      SetLabelValue((i + 1) % kNumWeights, &label);
+      util::Status status = graph.UpdateNodeLabel(i, label);
+      CHECK(status.ok(), status.message());
+    }
+    measurement.Finish(num_nodes, num_nodes);
+  }
+}
+
+void RunQueryBenchmarks(int num_nodes) {
+  test::WeightedGraph weighted_graph;
+  test::GetPathGraph(num_nodes, &weighted_graph);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+  // The nodes of a path graph have distinct weights, so every query returns one
+  // node.
+  {
+    TaggedAST label = MakeLabel(kNodeWeightTag, 0);
+    int64_t num_found = 0;
+    Measurement measurement("GetNodes");
+    for (int i = 0; i < num_nodes; ++i) {
+      SetLabelValue(i, &label);
+      num_found += graph.GetNodes(label).size();
+    }
+    measurement.Finish(num_nodes, num_nodes);
+    CHECK(num_found == num_nodes, "GetNodes returned the wrong nodes.");
+  }
+  {
+    int64_t num_found = 0;
+    Measurement measurement("GetSuccessors");
+    for (int i = 0; i < num_nodes; ++i) {
+      num_found += graph.GetSuccessors(i).size();
+    }
+    measurement.Finish(num_nodes, num_nodes);
+    CHECK(num_found == num_nodes - 1, "GetSuccessors returned wrong nodes.");
+  }
+  {
+    int64_t num_found = 0;
+    Measurement measurement("GetPredecessors");
+    for (int i = 0; i < num_nodes; ++i) {
+      num_found += graph.GetPredecessors(i).size();
+    }
+    measurement.Finish(num_nodes, num_nodes);
+    CHECK(num_found == num_nodes - 1, "GetPredecessors returned wrong nodes.");
+  }
+}
+
+int RunBenchmarks() {
+  int64_t max_nodes = std::max<int64_t>(FLAGS_max_nodes, 1000);
+  for (int64_t num_nodes = 1000; num_nodes <= max_nodes; num_nodes *= 10) {
+    RunMutationBenchmarks(static_cast<int>(num_nodes));
+    RunQueryBenchmarks(static_cast<int>(num_nodes));
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace morphie
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  morphie::util::SetAllocationProfiling(true);
+  return morphie::RunBenchmarks();
+}
@@ -16,6 +16,7 @@
 
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "base/string.h"
 #include "graph/type.h"
@@ -24,7 +25,10 @@
 #include "graph/value_checker.h"
 #include "gtest.h"
 #include "ast.pb.h"
+#include "util/memory_usage.h"
+#include "util/span.h"
 #include "util/status.h"
+#include "util/string_utils.h"
 
 namespace morphie {
 namespace {
@@ -125,14 +129,14 @@ TEST(LabeledGraphDeathTest, UninitializedGetGraphLabel) {
 // Uninitialized call to GetNodes.
 TEST(LabeledGraphDeathTest, UninitializedGetNodes) {
   LabeledGraph graph;
-  std::set<NodeId> nodes;
+  util::Span<NodeId> nodes;
   EXPECT_DEATH({ nodes = graph.GetNodes(TempLabel()); }, ".*");
 }
 
 // Uninitialized call to GetEdges.
 TEST(LabeledGraphDeathTest, UninitializedGetEdges) {
   LabeledGraph graph;
-  std::set<EdgeId> edges;
+  util::Span<EdgeId> edges;
   EXPECT_DEATH({ edges = graph.GetEdges(TempLabel()); }, ".*");
 }
 
@@ -432,6 +436,29 @@ TEST_F(LabeledGraphTest, TestGetEdgeTypes) {
   EXPECT_EQ("Frequency", *tags.begin());
 }
 
+// Test that type ids are consecutive in the order of tags and refer to the
+// declared types.
+TEST_F(LabeledGraphTest, InternsTypes) {
+  EXPECT_TRUE(Initialize(&graph_).ok());
+  Types node_types = graph_.GetNodeTypes();
+  TypeId type_id = 0;
+  for (const auto& type : node_types) {
+    EXPECT_EQ(type_id, graph_.GetNodeTypeId(type.first));
+    EXPECT_TRUE(
+        value::Isomorphic(type.second, graph_.GetNodeTypeById(type_id)));
+    ++type_id;
+  }
+  EXPECT_EQ(kNoType, graph_.GetNodeTypeId("Info"));
+  TypeId relation_id = graph_.GetEdgeTypeId("Relation");
+  ASSERT_NE(kNoType, relation_id);
+  EXPECT_EQ(&graph_.GetEdgeTypeById(relation_id),
+            &graph_.GetEdgeTypeById(graph_.GetEdgeTypeId("Relation")));
+  EXPECT_TRUE(value::Isomorphic(graph_.GetEdgeTypes().at("Relation"),
+                                graph_.GetEdgeTypeById(relation_id)));
+  EXPECT_EQ(kNoType, graph_.GetEdgeTypeId("Info"));
+  EXPECT_DEATH({ graph_.GetEdgeTypeById(graph_.NumEdgeTypes()); }, ".*");
+}
+
 // Test that the graph label is set correctly.
 TEST_F(LabeledGraphTest, GraphLabelSetCorrectly) {
   EXPECT_TRUE(Initialize(&graph_).ok());
@@ -503,7 +530,7 @@ TEST_F(LabeledGraphTest, CreateSingleNodeGraph) {
   // Graph should have one node with the given label.
   EXPECT_EQ(1, graph_.NumNodes());
   EXPECT_EQ(1, graph_.NumLabeledNodes(label));
-  std::set<NodeId> nodes = graph_.GetNodes(label);
+  util::Span<NodeId> nodes = graph_.GetNodes(label);
   EXPECT_EQ(1, nodes.size());
   EXPECT_EQ(node_id, *nodes.begin());
   TaggedAST node_label = graph_.GetNodeLabel(node_id);
@@ -526,7 +553,7 @@ TEST_F(LabeledGraphTest, QuerySingleNodeGraph) {
   NodeId node_id = graph_.FindOrAddNode(GetIntLabel("Event", 5));
   // Graph should not have nodes with other labels.
   TaggedAST non_label = GetIntLabel("Event", 4);
-  // EXPECT_TRUE(graph_.GetNodes(non_label).empty());
+  EXPECT_TRUE(graph_.GetNodes(non_label).empty());
   EXPECT_EQ(0, graph_.GetNodes(non_label).size());
   EXPECT_FALSE(
       value::Isomorphic(non_label.ast(), graph_.GetNodeLabel(node_id).ast()));
@@ -543,7 +570,7 @@ TEST_F(LabeledGraphTest, CreateSingleUniqueNodeGraph) {
   EXPECT_EQ(node1, node2);
   EXPECT_EQ(1, graph_.NumNodes());
   EXPECT_EQ(1, graph_.NumLabeledNodes(label));
-  std::set<NodeId> nodes = graph_.GetNodes(label);
+  util::Span<NodeId> nodes = graph_.GetNodes(label);
   EXPECT_EQ(1, nodes.size());
   EXPECT_EQ(*nodes.begin(), node1);
   TaggedAST node_label = graph_.GetNodeLabel(node1);
@@ -564,7 +591,7 @@ TEST_F(LabeledGraphTest, TwoNodeNoEdgeGraph) {
   // Graph should have two nodes with the given labels.
   EXPECT_EQ(2, graph_.NumNodes());
   EXPECT_EQ(1, graph_.NumLabeledNodes(event_label));
-  std::set<NodeId> nodes = graph_.GetNodes(event_label);
+  util::Span<NodeId> nodes = graph_.GetNodes(event_label);
   EXPECT_EQ(1, nodes.size());
   EXPECT_EQ(1, graph_.NumLabeledNodes(file_label));
   EXPECT_EQ(*nodes.begin(), event_id);
@@ -792,6 +819,54 @@ TEST_F(LabeledGraphTest, GetNeighbors) {
   EXPECT_EQ(graph_.GetLabelSuccessors(label[0]), node_set);
 }
 
+// Neighbor ranges contain one entry per edge, while the Collect functions
+// return each distinct neighbor once, in the order of first occurrence.
+TEST_F(LabeledGraphTest, NeighborRangesAndCollectors) {
+  // Create this graph:  0 -> 1 (twice), 0 -> 2, 1 -> 2
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  NodeId node0 = graph_.FindOrAddNode(GetIntLabel("Event", 0));
+  NodeId node1 = graph_.FindOrAddNode(GetIntLabel("Event", 1));
+  TaggedAST label2 = GetIntLabel("Event", 2);
+  NodeId node2 = graph_.FindOrAddNode(label2);
+  TaggedAST edge_label = GetStringLabel("Relation", "Less-Than");
+  graph_.FindOrAddEdge(node0, node1, edge_label);
+  graph_.FindOrAddEdge(node0, node1, edge_label);
+  graph_.FindOrAddEdge(node0, node2, edge_label);
+  graph_.FindOrAddEdge(node1, node2, edge_label);
+  EXPECT_TRUE(graph_.GetPredecessorRange(node0).empty());
+  EXPECT_TRUE(graph_.GetSuccessorRange(node2).empty());
+  EXPECT_EQ(3, graph_.GetSuccessorRange(node0).size());
+  EXPECT_EQ(2, graph_.GetPredecessorRange(node1).size());
+  NodeMarker marker;
+  std::vector<NodeId> nodes;
+  graph_.CollectSuccessors(node0, &marker, &nodes);
+  EXPECT_EQ(std::vector<NodeId>({node1, node2}), nodes);
+  EXPECT_EQ(0, marker.NumMarked());
+  nodes.clear();
+  graph_.CollectPredecessors(node1, &marker, &nodes);
+  EXPECT_EQ(std::vector<NodeId>({node0}), nodes);
+  // Results are appended to the nodes already in the vector.
+  graph_.CollectLabelPredecessors(label2, &marker, &nodes);
+  EXPECT_EQ(std::vector<NodeId>({node0, node0, node1}), nodes);
+  nodes.clear();
+  graph_.CollectLabelSuccessors(label2, &marker, &nodes);
+  EXPECT_TRUE(nodes.empty());
+}
+
+TEST(NodeMarkerTest, MarkAndClear) {
+  NodeMarker marker;
+  EXPECT_FALSE(marker.IsMarked(7));
+  EXPECT_TRUE(marker.Mark(7));
+  EXPECT_FALSE(marker.Mark(7));
+  EXPECT_TRUE(marker.Mark(2));
+  EXPECT_TRUE(marker.IsMarked(7));
+  EXPECT_EQ(2, marker.NumMarked());
+  marker.Clear();
+  EXPECT_FALSE(marker.IsMarked(7));
+  EXPECT_FALSE(marker.IsMarked(2));
+  EXPECT_EQ(0, marker.NumMarked());
+}
+
 TEST_F(LabeledGraphTest, UpdateNodeLabels) {
   ASSERT_TRUE(Initialize(&graph_).ok());
   TaggedAST event1_label = GetIntLabel("Event", 5);
@@ -812,9 +887,9 @@ TEST_F(LabeledGraphTest, UpdateNodeLabels) {
   EXPECT_EQ(0, graph_.NumEdges());
   EXPECT_EQ(0, graph_.GetNodes(event1_label).size());
   EXPECT_EQ(2, graph_.GetNodes(event2_label).size());
-  std::set<NodeId> event_nodes = graph_.GetNodes(event2_label);
-  EXPECT_TRUE(event_nodes.find(event1_id) != event_nodes.end());
-  EXPECT_TRUE(event_nodes.find(event2_id) != event_nodes.end());
+  util::Span<NodeId> event_nodes = graph_.GetNodes(event2_label);
+  EXPECT_TRUE(event_nodes.Contains(event1_id));
+  EXPECT_TRUE(event_nodes.Contains(event2_id));
   // Change the label of event1 to be a file different from foo.
   TaggedAST bar_label = GetStringLabel("File", "bar.txt");
   graph_.UpdateNodeLabel(event1_id, bar_label);
@@ -822,7 +897,7 @@ TEST_F(LabeledGraphTest, UpdateNodeLabels) {
   EXPECT_EQ(0, graph_.GetNodes(event1_label).size());
   EXPECT_EQ(1, graph_.GetNodes(event2_label).size());
   EXPECT_EQ(1, graph_.GetNodes(foo_label).size());
-  std::set<NodeId> bar_nodes = graph_.GetNodes(bar_label);
+  util::Span<NodeId> bar_nodes = graph_.GetNodes(bar_label);
   EXPECT_EQ(1, bar_nodes.size());
   EXPECT_EQ(event1_id, *bar_nodes.begin());
 }
@@ -838,6 +913,94 @@ TEST_F(LabeledGraphTest, UniqueNodeUpdateClash) {
   EXPECT_FALSE(graph_.UpdateNodeLabel(bar_id, foo_label).ok());
 }
 
+// Adding a batch of nodes returns the ids that adding the nodes one at a time
+// returns.
+TEST_F(LabeledGraphTest, FindOrAddNodes) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  ASSERT_TRUE(Initialize(&graph).ok());
+  std::vector<TaggedAST> labels;
+  for (int i = 0; i < 40; ++i) {
+    labels.push_back(GetIntLabel("Event", i % 3));
+    labels.push_back(GetStringLabel("File", std::to_string(i % 7)));
+  }
+  std::vector<NodeId> expected;
+  for (const TaggedAST& label : labels) {
+    expected.push_back(graph.FindOrAddNode(label));
+  }
+  EXPECT_EQ(expected, graph_.FindOrAddNodes(labels));
+  EXPECT_EQ(graph.Fingerprint(), graph_.Fingerprint());
+  EXPECT_EQ(14, graph_.GetNodes(GetIntLabel("Event", 0)).size());
+  // Unique labels that are already in the graph are found.
+  std::vector<TaggedAST> files = {GetStringLabel("File", "3")};
+  EXPECT_EQ(expected[7], graph_.FindOrAddNodes(files)[0]);
+  EXPECT_TRUE(graph_.FindOrAddNodes({}).empty());
+}
+
+// A batch of updates has the same effect as the updates made one at a time,
+// and unique labels can be exchanged within a batch.
+TEST_F(LabeledGraphTest, BatchUpdateNodeLabels) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST event1_label = GetIntLabel("Event", 5);
+  TaggedAST event2_label = GetIntLabel("Event", 12);
+  TaggedAST foo_label = GetStringLabel("File", "foo.txt");
+  TaggedAST bar_label = GetStringLabel("File", "bar.txt");
+  NodeId event1_id = graph_.FindOrAddNode(event1_label);
+  NodeId event2_id = graph_.FindOrAddNode(event1_label);
+  NodeId event3_id = graph_.FindOrAddNode(event1_label);
+  NodeId foo_id = graph_.FindOrAddNode(foo_label);
+  NodeId bar_id = graph_.FindOrAddNode(bar_label);
+  std::vector<std::pair<NodeId, TaggedAST>> updates = {
+      {event3_id, event2_label},
+      {event1_id, event2_label},
+      {foo_id, bar_label},
+      {bar_id, foo_label}};
+  EXPECT_TRUE(graph_.BatchUpdateNodeLabels(updates, 2).ok());
+  EXPECT_EQ(5, graph_.NumNodes());
+  std::vector<NodeId> expected = {event2_id};
+  util::Span<NodeId> nodes = graph_.GetNodes(event1_label);
+  EXPECT_EQ(expected, std::vector<NodeId>(nodes.begin(), nodes.end()));
+  expected = {event3_id, event1_id};
+  nodes = graph_.GetNodes(event2_label);
+  EXPECT_EQ(expected, std::vector<NodeId>(nodes.begin(), nodes.end()));
+  EXPECT_EQ(bar_id, graph_.FindOrAddNode(foo_label));
+  EXPECT_EQ(foo_id, graph_.FindOrAddNode(bar_label));
+  EXPECT_TRUE(value::Isomorphic(event2_label.ast(),
+                                graph_.GetNodeLabel(event1_id).ast()));
+}
+
+// A batch with an invalid update does not change the graph.
+TEST_F(LabeledGraphTest, RejectsInvalidBatchUpdates) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST event_label = GetIntLabel("Event", 5);
+  TaggedAST foo_label = GetStringLabel("File", "foo.txt");
+  TaggedAST bar_label = GetStringLabel("File", "bar.txt");
+  NodeId event_id = graph_.FindOrAddNode(event_label);
+  NodeId foo_id = graph_.FindOrAddNode(foo_label);
+  NodeId bar_id = graph_.FindOrAddNode(bar_label);
+  const uint64_t fingerprint = graph_.Fingerprint();
+  // A unique label of a node outside the batch.
+  std::vector<std::pair<NodeId, TaggedAST>> updates = {{event_id, foo_label}};
+  EXPECT_FALSE(graph_.BatchUpdateNodeLabels(updates, 1).ok());
+  // The same unique label twice.
+  updates = {{foo_id, bar_label}, {bar_id, bar_label}};
+  EXPECT_FALSE(graph_.BatchUpdateNodeLabels(updates, 1).ok());
+  // The same node twice.
+  updates = {{event_id, GetIntLabel("Event", 6)},
+             {event_id, GetIntLabel("Event", 7)}};
+  EXPECT_FALSE(graph_.BatchUpdateNodeLabels(updates, 1).ok());
+  // A label that is not typed, after a valid update.
+  updates = {{event_id, GetIntLabel("Event", 6)},
+             {foo_id, GetIntLabel("File", 6)}};
+  EXPECT_FALSE(graph_.BatchUpdateNodeLabels(updates, 2).ok());
+  // A node that does not exist.
+  updates = {{bar_id + 1, GetIntLabel("Event", 6)}};
+  EXPECT_FALSE(graph_.BatchUpdateNodeLabels(updates, 1).ok());
+  EXPECT_EQ(fingerprint, graph_.Fingerprint());
+  EXPECT_EQ(1, graph_.GetNodes(event_label).size());
+  EXPECT_TRUE(graph_.BatchUpdateNodeLabels({}, 1).ok());
+}
+
 TEST_F(LabeledGraphTest, UpdateEdgeLabels) {
   ASSERT_TRUE(Initialize(&graph_).ok());
   // Construct the graph:
@@ -864,7 +1027,7 @@ TEST_F(LabeledGraphTest, UpdateEdgeLabels) {
   graph_.UpdateEdgeLabel(fork_edge1, child_label);
   EXPECT_EQ(3, graph_.NumNodes());
   EXPECT_EQ(3, graph_.NumEdges());
-  std::set<EdgeId> edges = graph_.GetEdges(fork_label);
+  util::Span<EdgeId> edges = graph_.GetEdges(fork_label);
   EXPECT_EQ(1, edges.size());
   EXPECT_EQ(fork_edge2, *edges.begin());
   edges = graph_.GetEdges(child_label);
@@ -877,6 +1040,272 @@ TEST_F(LabeledGraphTest, UpdateEdgeLabels) {
   EXPECT_EQ(1, graph_.GetEdges(freq_two).size());
 }
 
+// Nodes and edges with equal labels share a single copy of the label.
+TEST_F(LabeledGraphTest, EqualLabelsAreInterned) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST event_label = GetIntLabel("Event", 13);
+  NodeId event1_id = graph_.FindOrAddNode(event_label);
+  NodeId event2_id = graph_.FindOrAddNode(event_label);
+  NodeId file_id = graph_.FindOrAddNode(GetStringLabel("File", "bar.txt"));
+  ASSERT_NE(event1_id, event2_id);
+  EXPECT_EQ(graph_.GetNodeLabelId(event1_id), graph_.GetNodeLabelId(event2_id));
+  EXPECT_NE(graph_.GetNodeLabelId(event1_id), graph_.GetNodeLabelId(file_id));
+  EXPECT_EQ(&graph_.GetNodeLabel(event1_id), &graph_.GetNodeLabel(event2_id));
+  TaggedAST relation = GetStringLabel("Relation", "child");
+  EdgeId edge1_id = graph_.FindOrAddEdge(event1_id, file_id, relation);
+  EdgeId edge2_id = graph_.FindOrAddEdge(event2_id, file_id, relation);
+  EXPECT_EQ(graph_.GetEdgeLabelId(edge1_id), graph_.GetEdgeLabelId(edge2_id));
+  EXPECT_EQ(3, graph_.NumDistinctLabels());
+  // A reference to a label remains valid after the label is updated.
+  const TaggedAST& old_label = graph_.GetNodeLabel(event1_id);
+  EXPECT_TRUE(graph_.UpdateNodeLabel(event1_id, GetIntLabel("Event", 7)).ok());
+  EXPECT_EQ(13, old_label.ast().p_ast().val().int_val());
+  EXPECT_EQ(7, graph_.GetNodeLabel(event1_id).ast().p_ast().val().int_val());
+  EXPECT_EQ(13, graph_.GetNodeLabel(event2_id).ast().p_ast().val().int_val());
+}
+
+// Edges with unique labels are retrieved by label like other edges.
+TEST_F(LabeledGraphTest, GetEdgesWithUniqueLabel) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  NodeId event_id = graph_.FindOrAddNode(GetIntLabel("Event", 13));
+  NodeId foo_id = graph_.FindOrAddNode(GetStringLabel("File", "foo.txt"));
+  NodeId bar_id = graph_.FindOrAddNode(GetStringLabel("File", "bar.txt"));
+  TaggedAST freq_label = GetIntLabel("Frequency", 31);
+  EdgeId foo_edge = graph_.FindOrAddEdge(event_id, foo_id, freq_label);
+  EdgeId bar_edge = graph_.FindOrAddEdge(event_id, bar_id, freq_label);
+  graph_.FindOrAddEdge(event_id, bar_id, freq_label);
+  util::Span<EdgeId> edges = graph_.GetEdges(freq_label);
+  ASSERT_EQ(2, edges.size());
+  EXPECT_TRUE(edges.Contains(foo_edge));
+  EXPECT_TRUE(edges.Contains(bar_edge));
+  TaggedAST other_label = GetIntLabel("Frequency", 5);
+  EXPECT_TRUE(graph_.UpdateEdgeLabel(bar_edge, other_label).ok());
+  EXPECT_EQ(1, graph_.NumLabeledEdges(freq_label));
+  EXPECT_EQ(1, graph_.NumLabeledEdges(other_label));
+  EXPECT_EQ(bar_edge, *graph_.GetEdges(other_label).begin());
+}
+
+// Adds nodes and edges to 'graph' with a bulk loader if 'use_loader' is true
+// and with FindOrAddNode and FindOrAddEdge otherwise. Returns the ids of the
+// added nodes and edges, in order, as strings.
+std::vector<string> PopulateGraph(bool use_loader, LabeledGraph* graph) {
+  std::vector<TaggedAST> node_labels = {
+      GetIntLabel("Event", 1), GetStringLabel("File", "foo.txt"),
+      GetIntLabel("Event", 1), GetStringLabel("File", "foo.txt"),
+      GetIntLabel("Event", 2)};
+  std::vector<string> ids;
+  std::vector<NodeId> nodes;
+  LabeledGraph::BulkLoader loader(graph);
+  if (use_loader) {
+    loader.Reserve(node_labels.size(), 4);
+    nodes = loader.AddNodes(node_labels);
+  } else {
+    for (const TaggedAST& label : node_labels) {
+      nodes.push_back(graph->FindOrAddNode(label));
+    }
+  }
+  std::vector<NodeId> sources = {nodes[0], nodes[0], nodes[2], nodes[0]};
+  std::vector<NodeId> targets = {nodes[1], nodes[1], nodes[1], nodes[4]};
+  std::vector<TaggedAST> edge_labels = {
+      GetIntLabel("Frequency", 3), GetIntLabel("Frequency", 3),
+      GetStringLabel("Relation", "Uses"), GetStringLabel("Relation", "Uses")};
+  std::vector<EdgeId> edges;
+  if (use_loader) {
+    edges = loader.AddEdges(sources, targets, edge_labels);
+  } else {
+    for (size_t i = 0; i < edge_labels.size(); ++i) {
+      edges.push_back(graph->FindOrAddEdge(sources[i], targets[i],
+                                           edge_labels[i]));
+    }
+  }
+  loader.Finish();
+  for (NodeId node_id : nodes) {
+    ids.push_back(std::to_string(node_id));
+  }
+  for (EdgeId edge_id : edges) {
+    ids.push_back(util::StrCat(std::to_string(graph->Source(edge_id)), "->",
+                               std::to_string(graph->Target(edge_id))));
+  }
+  return ids;
+}
+
+// A bulk loader returns the same ids and builds the same indexes as repeated
+// calls to FindOrAddNode and FindOrAddEdge.
+TEST_F(LabeledGraphTest, BulkLoaderMatchesFindOrAdd) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  LabeledGraph bulk_graph;
+  ASSERT_TRUE(Initialize(&bulk_graph).ok());
+  EXPECT_EQ(PopulateGraph(false, &graph_), PopulateGraph(true, &bulk_graph));
+  EXPECT_EQ(4, bulk_graph.NumNodes());
+  EXPECT_EQ(3, bulk_graph.NumEdges());
+  TaggedAST event = GetIntLabel("Event", 1);
+  EXPECT_EQ(2, bulk_graph.NumLabeledNodes(event));
+  EXPECT_EQ(std::vector<NodeId>(graph_.GetNodes(event).begin(),
+                                graph_.GetNodes(event).end()),
+            std::vector<NodeId>(bulk_graph.GetNodes(event).begin(),
+                                bulk_graph.GetNodes(event).end()));
+  EXPECT_EQ(1, bulk_graph.NumLabeledNodes(GetStringLabel("File", "foo.txt")));
+  EXPECT_EQ(1, bulk_graph.NumLabeledEdges(GetIntLabel("Frequency", 3)));
+  EXPECT_EQ(2, bulk_graph.NumLabeledEdges(GetStringLabel("Relation", "Uses")));
+}
+
+// Loading into a graph that already has nodes extends the existing indexes.
+TEST_F(LabeledGraphTest, BulkLoaderExtendsIndexes) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST event = GetIntLabel("Event", 1);
+  NodeId node_id = graph_.FindOrAddNode(event);
+  {
+    LabeledGraph::BulkLoader loader(&graph_);
+    loader.AddNode(event);
+    loader.AddNode(event);
+  }
+  util::Span<NodeId> nodes = graph_.GetNodes(event);
+  ASSERT_EQ(3, nodes.size());
+  EXPECT_EQ(node_id, nodes[0]);
+}
+
+// Moving labels into the graph finds the same nodes and edges as copying them.
+TEST_F(LabeledGraphTest, FindOrAddMovesLabels) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST file = GetStringLabel("File", "foo.txt");
+  NodeId file_id = graph_.FindOrAddNode(file);
+  EXPECT_EQ(file_id, graph_.FindOrAddNode(GetStringLabel("File", "foo.txt")));
+  TaggedAST event = GetIntLabel("Event", 1);
+  NodeId event_id = graph_.FindOrAddNode(std::move(event));
+  EXPECT_NE(event_id, graph_.FindOrAddNode(GetIntLabel("Event", 1)));
+  EXPECT_EQ(2, graph_.NumLabeledNodes(GetIntLabel("Event", 1)));
+  EXPECT_EQ("Event", graph_.GetNodeLabel(event_id).tag());
+  EdgeId edge_id = graph_.FindOrAddEdge(event_id, file_id,
+                                        GetStringLabel("Relation", "Uses"));
+  EXPECT_EQ(file_id, graph_.Target(edge_id));
+  EXPECT_EQ(1, graph_.NumLabeledEdges(GetStringLabel("Relation", "Uses")));
+}
+
+TEST(LabeledGraphDeathTest, BulkLoaderRejectsUntypedLabel) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  LabeledGraph::BulkLoader loader(&graph);
+  EXPECT_DEATH({ loader.AddNode(GetIntLabel("Relation", 1)); }, ".*");
+}
+
+// In full validation mode, a mistyped label crashes FindOrAddNode even if
+// another label was checked before it.
+TEST(LabeledGraphDeathTest, FullValidationRejectsUntypedLabel) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  graph.FindOrAddNode(GetIntLabel("Event", 1));
+  EXPECT_DEATH({ graph.FindOrAddNode(GetStringLabel("Event", "foo")); },
+               ".*");
+}
+
+// With a sample period of 2, only every other distinct label is checked, and a
+// label that has been checked is not checked again.
+TEST(LabeledGraphDeathTest, SampledValidation) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  graph.SetLabelValidation(LabelValidation::kSampled, 2);
+  graph.FindOrAddNode(GetIntLabel("Event", 1));
+  graph.FindOrAddNode(GetIntLabel("Event", 1));
+  graph.FindOrAddNode(GetStringLabel("Event", "unchecked"));
+  EXPECT_EQ(3, graph.NumNodes());
+  EXPECT_DEATH({ graph.FindOrAddNode(GetStringLabel("Event", "checked")); },
+               ".*");
+}
+
+// Labels are sampled per distinct label, so the nodes of a label that was
+// skipped do not advance the sample, and the next distinct label is checked.
+TEST(LabeledGraphDeathTest, SamplesDistinctLabels) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  graph.SetLabelValidation(LabelValidation::kSampled, 2);
+  graph.FindOrAddNode(GetIntLabel("Event", 1));
+  graph.FindOrAddNode(GetStringLabel("Event", "unchecked"));
+  graph.FindOrAddNode(GetStringLabel("Event", "unchecked"));
+  graph.FindOrAddNode(GetStringLabel("Event", "unchecked"));
+  EXPECT_EQ(4, graph.NumNodes());
+  EXPECT_DEATH({ graph.FindOrAddNode(GetStringLabel("Event", "checked")); },
+               ".*");
+}
+
+// The tag of a label is looked up even when its type check is skipped, so a
+// node with an undeclared tag is never added to the graph without an index,
+// while a skipped node with a declared tag is indexed and can be removed.
+TEST(LabeledGraphDeathTest, SampledValidationRejectsUndeclaredTag) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  graph.SetLabelValidation(LabelValidation::kSampled, 1000);
+  graph.FindOrAddNode(GetIntLabel("Event", 1));
+  NodeId skipped_id = graph.FindOrAddNode(GetIntLabel("Event", 2));
+  EXPECT_EQ(1, graph.NumLabeledNodes(GetIntLabel("Event", 2)));
+  graph.RemoveNodes({skipped_id});
+  EXPECT_EQ(1, graph.NumNodes());
+  EXPECT_EQ(0, graph.NumLabeledNodes(GetIntLabel("Event", 2)));
+  EXPECT_DEATH(
+      {
+        NodeId node_id = graph.FindOrAddNode(GetIntLabel("Relation", 1));
+        graph.RemoveNodes({node_id});
+      },
+      ".*");
+}
+
+TEST(LabeledGraphDeathTest, RejectsNonPositiveSamplePeriod) {
+  LabeledGraph graph;
+  EXPECT_DEATH({ graph.SetLabelValidation(LabelValidation::kSampled, 0); },
+               ".*");
+}
+
+// Typed labels are added like other labels but are never type checked, so even
+// an ill-typed label is added.
+TEST_F(LabeledGraphTest, TypedLabelsAreNotChecked) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  NodeId event_id = graph_.FindOrAddTypedNode(GetIntLabel("Event", 1));
+  NodeId file_id = graph_.FindOrAddTypedNode(GetStringLabel("File", "a"));
+  EXPECT_EQ(file_id, graph_.FindOrAddNode(GetStringLabel("File", "a")));
+  EdgeId edge_id = graph_.FindOrAddTypedEdge(event_id, file_id,
+                                             GetIntLabel("Frequency", 2));
+  EXPECT_EQ(edge_id, graph_.FindOrAddEdge(event_id, file_id,
+                                          GetIntLabel("Frequency", 2)));
+  graph_.FindOrAddTypedNode(GetStringLabel("Event", "unchecked"));
+  EXPECT_EQ(3, graph_.NumNodes());
+  EXPECT_EQ(1, graph_.NumEdges());
+}
+
+// A bulk loader moves labels into the graph and skips the type check of typed
+// labels, as FindOrAddNode and FindOrAddTypedNode do.
+TEST_F(LabeledGraphTest, BulkLoaderAddsMovedAndTypedLabels) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  {
+    LabeledGraph::BulkLoader loader(&graph_);
+    NodeId file_id = loader.AddTypedNode(GetStringLabel("File", "a"));
+    EXPECT_EQ(file_id, loader.AddNode(GetStringLabel("File", "a")));
+    loader.AddNode(GetIntLabel("Event", 1));
+    loader.AddTypedNode(GetStringLabel("Event", "unchecked"));
+  }
+  EXPECT_EQ(3, graph_.NumNodes());
+  EXPECT_EQ(1, graph_.NumLabeledNodes(GetIntLabel("Event", 1)));
+  EXPECT_EQ(1, graph_.NumLabeledNodes(GetStringLabel("Event", "unchecked")));
+}
+
+TEST(LabeledGraphDeathTest, TypedLabelsRequireDeclaredTags) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  EXPECT_DEATH({ graph.FindOrAddTypedNode(GetIntLabel("Relation", 1)); },
+               "The tag of the label has no type.");
+  NodeId node_id = graph.FindOrAddNode(GetIntLabel("Event", 1));
+  EXPECT_DEATH(
+      { graph.FindOrAddTypedEdge(node_id, node_id, GetIntLabel("Event", 1)); },
+      "The tag of the label has no type.");
+}
+
+// Label updates are checked in every validation mode.
+TEST_F(LabeledGraphTest, UpdatesAreAlwaysValidated) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  graph_.SetLabelValidation(LabelValidation::kSampled, 1000);
+  NodeId node_id = graph_.FindOrAddNode(GetIntLabel("Event", 1));
+  EXPECT_FALSE(
+      graph_.UpdateNodeLabel(node_id, GetStringLabel("Event", "foo")).ok());
+}
+
 TEST_F(LabeledGraphTest, UniqueEdgeUpdateClash) {
   ASSERT_TRUE(Initialize(&graph_).ok());
   TaggedAST event_label = GetIntLabel("Event", 13);
@@ -890,5 +1319,490 @@ TEST_F(LabeledGraphTest, UniqueEdgeUpdateClash) {
   EXPECT_FALSE(graph_.UpdateEdgeLabel(edge2_id, freq1_label).ok());
 }
 
+// Removing nodes removes their edges and their entries in the label indexes,
+// and leaves the ids of the other nodes unchanged.
+TEST_F(LabeledGraphTest, RemovesNodesAndEdges) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST event_label = GetIntLabel("Event", 5);
+  TaggedAST foo_label = GetStringLabel("File", "foo.txt");
+  TaggedAST bar_label = GetStringLabel("File", "bar.txt");
+  TaggedAST uses_label = GetStringLabel("Relation", "uses");
+  NodeId event1_id = graph_.FindOrAddNode(event_label);
+  NodeId event2_id = graph_.FindOrAddNode(event_label);
+  NodeId foo_id = graph_.FindOrAddNode(foo_label);
+  NodeId bar_id = graph_.FindOrAddNode(bar_label);
+  graph_.FindOrAddEdge(event1_id, foo_id, uses_label);
+  EdgeId bar_edge = graph_.FindOrAddEdge(event2_id, bar_id, uses_label);
+  graph_.FindOrAddEdge(event2_id, foo_id, GetIntLabel("Frequency", 3));
+  ASSERT_FALSE(graph_.HasRemovedNodes());
+  graph_.RemoveNodes({foo_id, event1_id, foo_id});
+  EXPECT_TRUE(graph_.HasRemovedNodes());
+  EXPECT_EQ(2, graph_.NumNodes());
+  EXPECT_EQ(4, graph_.NumNodeIds());
+  EXPECT_EQ(1, graph_.NumEdges());
+  EXPECT_FALSE(graph_.HasNode(event1_id));
+  EXPECT_FALSE(graph_.HasNode(foo_id));
+  EXPECT_TRUE(graph_.HasNode(event2_id));
+  EXPECT_TRUE(graph_.HasNode(bar_id));
+  util::Span<NodeId> events = graph_.GetNodes(event_label);
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ(event2_id, *events.begin());
+  EXPECT_EQ(0, graph_.GetNodes(foo_label).size());
+  util::Span<EdgeId> uses = graph_.GetEdges(uses_label);
+  ASSERT_EQ(1, uses.size());
+  EXPECT_EQ(bar_edge, *uses.begin());
+  EXPECT_EQ(0, graph_.GetEdges(GetIntLabel("Frequency", 3)).size());
+  // A node with a unique label can be added again after it was removed.
+  NodeId new_foo_id = graph_.FindOrAddNode(foo_label);
+  EXPECT_EQ(4, new_foo_id);
+  EXPECT_EQ(1, graph_.GetNodes(foo_label).size());
+  graph_.RemoveEdges({bar_edge});
+  EXPECT_EQ(0, graph_.NumEdges());
+  EXPECT_EQ(0, graph_.GetEdges(uses_label).size());
+  EXPECT_EQ(3, graph_.NumNodes());
+}
+
+// Compacting a graph renumbers the remaining nodes consecutively in their
+// original order and preserves their labels, edges and index entries.
+TEST_F(LabeledGraphTest, CompactRenumbersNodes) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  std::vector<NodeId> compacted = graph_.Compact();
+  EXPECT_TRUE(compacted.empty());
+  TaggedAST event_label = GetIntLabel("Event", 5);
+  TaggedAST foo_label = GetStringLabel("File", "foo.txt");
+  TaggedAST uses_label = GetStringLabel("Relation", "uses");
+  TaggedAST freq_label = GetIntLabel("Frequency", 3);
+  NodeId event1_id = graph_.FindOrAddNode(event_label);
+  NodeId event2_id = graph_.FindOrAddNode(GetIntLabel("Event", 6));
+  NodeId event3_id = graph_.FindOrAddNode(event_label);
+  NodeId foo_id = graph_.FindOrAddNode(foo_label);
+  graph_.FindOrAddEdge(event1_id, event2_id, uses_label);
+  graph_.FindOrAddEdge(event3_id, foo_id, uses_label);
+  graph_.FindOrAddEdge(event1_id, foo_id, uses_label);
+  graph_.FindOrAddEdge(event3_id, foo_id, freq_label);
+  graph_.RemoveNodes({event2_id});
+  compacted = graph_.Compact();
+  std::vector<NodeId> expected = {0, LabeledGraph::kRemovedNode, 1, 2};
+  EXPECT_EQ(expected, compacted);
+  EXPECT_FALSE(graph_.HasRemovedNodes());
+  EXPECT_EQ(3, graph_.NumNodes());
+  EXPECT_EQ(3, graph_.NumNodeIds());
+  EXPECT_EQ(3, graph_.NumEdges());
+  EXPECT_EQ(graph_.GetNodeLabelId(0), graph_.GetNodeLabelId(1));
+  EXPECT_EQ("File", graph_.GetNodeLabel(2).tag());
+  util::Span<NodeId> events = graph_.GetNodes(event_label);
+  EXPECT_EQ(std::vector<NodeId>({0, 1}),
+            std::vector<NodeId>(events.begin(), events.end()));
+  util::Span<NodeId> files = graph_.GetNodes(foo_label);
+  ASSERT_EQ(1, files.size());
+  EXPECT_EQ(2, *files.begin());
+  util::Span<EdgeId> uses = graph_.GetEdges(uses_label);
+  ASSERT_EQ(2, uses.size());
+  std::set<std::pair<NodeId, NodeId>> endpoints;
+  for (EdgeId edge_id : uses) {
+    endpoints.insert({graph_.Source(edge_id), graph_.Target(edge_id)});
+  }
+  EXPECT_EQ(1, endpoints.count({0, 2}));
+  EXPECT_EQ(1, endpoints.count({1, 2}));
+  util::Span<EdgeId> freqs = graph_.GetEdges(freq_label);
+  ASSERT_EQ(1, freqs.size());
+  EXPECT_EQ(1, graph_.Source(*freqs.begin()));
+  EXPECT_EQ(2, graph_.Target(*freqs.begin()));
+  // Unique labels are still found after compaction.
+  EXPECT_EQ(2, graph_.FindOrAddNode(foo_label));
+}
+
+// The edge ids in the label indexes refer to the compacted graph, so edges are
+// found, relabelled and removed through the indexes after compaction.
+TEST_F(LabeledGraphTest, FindsEdgesAfterCompaction) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST uses_label = GetStringLabel("Relation", "uses");
+  TaggedAST freq_label = GetIntLabel("Frequency", 3);
+  NodeId event1_id = graph_.FindOrAddNode(GetIntLabel("Event", 5));
+  NodeId event2_id = graph_.FindOrAddNode(GetIntLabel("Event", 6));
+  NodeId foo_id = graph_.FindOrAddNode(GetStringLabel("File", "foo.txt"));
+  NodeId bar_id = graph_.FindOrAddNode(GetStringLabel("File", "bar.txt"));
+  graph_.FindOrAddEdge(event1_id, event2_id, uses_label);
+  graph_.FindOrAddEdge(event2_id, foo_id, uses_label);
+  graph_.FindOrAddEdge(event2_id, bar_id, freq_label);
+  graph_.RemoveNodes({event1_id});
+  std::vector<NodeId> compacted = graph_.Compact();
+  const NodeId event_id = compacted[event2_id];
+  const NodeId new_foo_id = compacted[foo_id];
+  const NodeId new_bar_id = compacted[bar_id];
+  ASSERT_EQ(2, graph_.NumEdges());
+  // An edge with a unique label is found, not added again.
+  EdgeId freq_id = graph_.FindOrAddEdge(event_id, new_bar_id, freq_label);
+  EXPECT_EQ(2, graph_.NumEdges());
+  util::Span<EdgeId> freqs = graph_.GetEdges(freq_label);
+  ASSERT_EQ(1, freqs.size());
+  EXPECT_EQ(freq_id, *freqs.begin());
+  EXPECT_TRUE(graph_.HasEdge(freq_id));
+  EXPECT_EQ(freq_label.ast().p_ast().val().int_val(),
+            graph_.GetEdgeLabel(freq_id).ast().p_ast().val().int_val());
+  util::Span<EdgeId> uses = graph_.GetEdges(uses_label);
+  ASSERT_EQ(1, uses.size());
+  EdgeId uses_id = *uses.begin();
+  EXPECT_EQ(event_id, graph_.Source(uses_id));
+  EXPECT_EQ(new_foo_id, graph_.Target(uses_id));
+  TaggedAST reads_label = GetStringLabel("Relation", "reads");
+  ASSERT_TRUE(graph_.UpdateEdgeLabel(uses_id, reads_label).ok());
+  EXPECT_EQ(0, graph_.GetEdges(uses_label).size());
+  EXPECT_EQ(1, graph_.GetEdges(reads_label).size());
+  graph_.RemoveEdges({freq_id});
+  EXPECT_EQ(1, graph_.NumEdges());
+  EXPECT_EQ(0, graph_.GetEdges(freq_label).size());
+  EXPECT_EQ(1, graph_.GetEdges(reads_label).size());
+}
+
+// A column holds the integer of every Event node and stays consistent with the
+// labels as nodes are added, relabelled, removed and compacted.
+TEST_F(LabeledGraphTest, MaintainsNodeColumns) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  NodeId event1_id = graph_.FindOrAddNode(GetIntLabel("Event", 5));
+  NodeId foo_id = graph_.FindOrAddNode(GetStringLabel("File", "foo.txt"));
+  NodeId event2_id = graph_.FindOrAddNode(GetIntLabel("Event", 5));
+  int column_index = graph_.AddNodeColumn("Event", {});
+  EXPECT_EQ(column_index, graph_.AddNodeColumn("Event", {}));
+  EXPECT_EQ(1, graph_.NumNodeColumns());
+  const NodeColumn& column = graph_.GetNodeColumn(column_index);
+  EXPECT_TRUE(column.IsValid(event1_id));
+  EXPECT_FALSE(column.IsValid(foo_id));
+  EXPECT_TRUE(column.IsValid(event2_id));
+  EXPECT_EQ(5, column.values[event2_id]);
+  NodeId event3_id = graph_.FindOrAddNode(GetIntLabel("Event", 7));
+  EXPECT_TRUE(column.IsValid(event3_id));
+  EXPECT_EQ(7, column.values[event3_id]);
+  ASSERT_TRUE(graph_.UpdateNodeLabel(event2_id, GetIntLabel("Event", 9)).ok());
+  EXPECT_EQ(9, column.values[event2_id]);
+  ASSERT_TRUE(
+      graph_.UpdateNodeLabel(event3_id, GetStringLabel("File", "bar.txt"))
+          .ok());
+  EXPECT_FALSE(column.IsValid(event3_id));
+  graph_.RemoveNodes({event1_id});
+  EXPECT_FALSE(column.IsValid(event1_id));
+  graph_.Compact();
+  ASSERT_EQ(3, column.values.size());
+  EXPECT_FALSE(column.IsValid(0));
+  EXPECT_TRUE(column.IsValid(1));
+  EXPECT_EQ(9, column.values[1]);
+  EXPECT_FALSE(column.IsValid(2));
+}
+
+// Compacting a graph in a given order renumbers its nodes in that order, even
+// if no nodes were removed, and preserves their labels, edges, index entries
+// and column entries.
+TEST_F(LabeledGraphTest, CompactsInOrder) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST event_label = GetIntLabel("Event", 5);
+  TaggedAST foo_label = GetStringLabel("File", "foo.txt");
+  TaggedAST uses_label = GetStringLabel("Relation", "uses");
+  NodeId event1_id = graph_.FindOrAddNode(event_label);
+  NodeId event2_id = graph_.FindOrAddNode(GetIntLabel("Event", 6));
+  NodeId event3_id = graph_.FindOrAddNode(event_label);
+  NodeId foo_id = graph_.FindOrAddNode(foo_label);
+  graph_.FindOrAddEdge(event1_id, event2_id, uses_label);
+  graph_.FindOrAddEdge(event3_id, foo_id, uses_label);
+  graph_.FindOrAddEdge(event1_id, foo_id, uses_label);
+  int column_index = graph_.AddNodeColumn("Event", {});
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 3, 2}), graph_.BreadthFirstOrder());
+  EXPECT_EQ(std::vector<NodeId>({0, 2, 1, 3}),
+            graph_.ColumnOrder(column_index));
+
+  std::vector<NodeId> compacted = graph_.Compact({3, 2, 1, 0});
+  EXPECT_EQ(std::vector<NodeId>({3, 2, 1, 0}), compacted);
+  EXPECT_EQ(4, graph_.NumNodes());
+  EXPECT_EQ(3, graph_.NumEdges());
+  EXPECT_EQ("File", graph_.GetNodeLabel(0).tag());
+  util::Span<NodeId> events = graph_.GetNodes(event_label);
+  EXPECT_EQ(std::vector<NodeId>({3, 1}),
+            std::vector<NodeId>(events.begin(), events.end()));
+  std::set<std::pair<NodeId, NodeId>> endpoints;
+  for (EdgeId edge_id : graph_.GetEdges(uses_label)) {
+    endpoints.insert({graph_.Source(edge_id), graph_.Target(edge_id)});
+  }
+  std::set<std::pair<NodeId, NodeId>> expected_endpoints = {
+      {3, 2}, {1, 0}, {3, 0}};
+  EXPECT_EQ(expected_endpoints, endpoints);
+  const NodeColumn& column = graph_.GetNodeColumn(column_index);
+  EXPECT_FALSE(column.IsValid(0));
+  EXPECT_EQ(5, column.values[1]);
+  EXPECT_EQ(6, column.values[2]);
+  EXPECT_EQ(5, column.values[3]);
+  EXPECT_EQ(0, graph_.FindOrAddNode(foo_label));
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 3, 2}), graph_.BreadthFirstOrder());
+
+  // Removed nodes are not in the order.
+  graph_.RemoveNodes({2});
+  compacted = graph_.Compact(graph_.BreadthFirstOrder());
+  EXPECT_EQ(LabeledGraph::kRemovedNode, compacted[2]);
+  EXPECT_EQ(3, graph_.NumNodeIds());
+  EXPECT_FALSE(graph_.HasRemovedNodes());
+}
+
+// Shrinking a graph releases the slots of removed index entries and keeps the
+// ids and the results of queries.
+TEST_F(LabeledGraphTest, ShrinksToFit) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  std::vector<NodeId> removed;
+  for (int i = 0; i < 1000; ++i) {
+    NodeId node_id = graph_.FindOrAddNode(GetIntLabel("Event", i));
+    if (i >= 10) {
+      removed.push_back(node_id);
+    }
+  }
+  NodeId foo_id = graph_.FindOrAddNode(GetStringLabel("File", "foo.txt"));
+  graph_.FindOrAddEdge(0, foo_id, GetStringLabel("Relation", "uses"));
+  graph_.RemoveNodes(removed);
+  const uint64_t fingerprint = graph_.Fingerprint();
+  const size_t index_bytes = graph_.MemoryUsage()["node_indexes/Event"];
+  graph_.ShrinkToFit();
+  EXPECT_GT(index_bytes, graph_.MemoryUsage()["node_indexes/Event"]);
+  EXPECT_EQ(fingerprint, graph_.Fingerprint());
+  EXPECT_EQ(11, graph_.NumNodes());
+  EXPECT_EQ(1, graph_.GetNodes(GetIntLabel("Event", 9)).size());
+  EXPECT_EQ(0, graph_.GetNodes(GetIntLabel("Event", 10)).size());
+  EXPECT_EQ(foo_id, graph_.FindOrAddNode(GetStringLabel("File", "foo.txt")));
+  EXPECT_EQ(1, graph_.GetEdges(GetStringLabel("Relation", "uses")).size());
+}
+
+TEST_F(LabeledGraphTest, CompactRequiresEveryNodeOnce) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  graph_.FindOrAddNode(GetIntLabel("Event", 5));
+  graph_.FindOrAddNode(GetIntLabel("Event", 6));
+  EXPECT_DEATH({ graph_.Compact({0}); }, ".*");
+  EXPECT_DEATH({ graph_.Compact({1, 1}); }, ".*");
+}
+
+// Degree statistics are computed from the existing edges and kept up to date
+// as edges are added, nodes are relabelled and removed, and the graph is
+// compacted. A self-loop adds two to the degree of its node.
+TEST_F(LabeledGraphTest, TracksDegrees) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  for (int i = 0; i < 4; ++i) {
+    graph_.FindOrAddNode(GetIntLabel("Event", i));
+  }
+  NodeId foo_id = graph_.FindOrAddNode(GetStringLabel("File", "foo.txt"));
+  NodeId bar_id = graph_.FindOrAddNode(GetStringLabel("File", "bar.txt"));
+  TaggedAST uses_label = GetStringLabel("Relation", "uses");
+  graph_.FindOrAddEdge(0, foo_id, uses_label);
+  graph_.FindOrAddEdge(1, foo_id, uses_label);
+  graph_.TrackDegrees(2);
+  graph_.FindOrAddEdge(2, foo_id, uses_label);
+  graph_.FindOrAddEdge(3, foo_id, uses_label);
+  graph_.FindOrAddEdge(0, bar_id, uses_label);
+  EXPECT_EQ(4, graph_.Degree(foo_id));
+  EXPECT_EQ(std::vector<int64_t>({0, 3, 1}),
+            graph_.GetDegreeHistogram("Event"));
+  EXPECT_EQ(std::vector<int64_t>({0, 1, 0, 1}),
+            graph_.GetDegreeHistogram("File"));
+  EXPECT_EQ(std::vector<NodeId>({foo_id, 0}), graph_.GetHubs());
+  graph_.FindOrAddEdge(1, 1, uses_label);
+  EXPECT_EQ(3, graph_.Degree(1));
+  EXPECT_EQ(std::vector<int64_t>({0, 2, 2}),
+            graph_.GetDegreeHistogram("Event"));
+  EXPECT_EQ(std::vector<NodeId>({foo_id, 1}), graph_.GetHubs());
+  graph_.RemoveNodes({foo_id});
+  EXPECT_EQ(std::vector<int64_t>({2, 1, 1}),
+            graph_.GetDegreeHistogram("Event"));
+  EXPECT_EQ(std::vector<int64_t>({0, 1, 0, 0}),
+            graph_.GetDegreeHistogram("File"));
+  EXPECT_EQ(std::vector<NodeId>({1, 0}), graph_.GetHubs());
+  ASSERT_TRUE(graph_.UpdateNodeLabel(0, GetStringLabel("File", "baz")).ok());
+  EXPECT_EQ(std::vector<int64_t>({2, 0, 1}),
+            graph_.GetDegreeHistogram("Event"));
+  EXPECT_EQ(std::vector<int64_t>({0, 2, 0, 0}),
+            graph_.GetDegreeHistogram("File"));
+  // Compacting renumbers 'bar_id' to 4.
+  graph_.Compact();
+  graph_.FindOrAddEdge(2, 4, uses_label);
+  EXPECT_EQ(std::vector<NodeId>({1, 4}), graph_.GetHubs());
+  EXPECT_EQ(std::vector<int64_t>({1, 1, 1}),
+            graph_.GetDegreeHistogram("Event"));
+  EXPECT_EQ(std::vector<int64_t>({0, 1, 1, 0}),
+            graph_.GetDegreeHistogram("File"));
+  EXPECT_LT(0, graph_.MemoryUsage()["degrees"]);
+}
+
+// Merging shares the nodes with unique labels and the edges with unique labels
+// between them, appends the other nodes and edges, skips removed nodes and
+// indexes the merged nodes and edges by label.
+TEST_F(LabeledGraphTest, MergesGraphs) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  TaggedAST foo_label = GetStringLabel("File", "foo.txt");
+  TaggedAST uses_label = GetStringLabel("Relation", "uses");
+  TaggedAST freq_label = GetIntLabel("Frequency", 3);
+  NodeId event_id = graph_.FindOrAddNode(GetIntLabel("Event", 5));
+  NodeId foo_id = graph_.FindOrAddNode(foo_label);
+  graph_.FindOrAddEdge(event_id, foo_id, uses_label);
+  graph_.FindOrAddEdge(event_id, foo_id, freq_label);
+
+  LabeledGraph other;
+  ASSERT_TRUE(Initialize(&other).ok());
+  NodeId other_event_id = other.FindOrAddNode(GetIntLabel("Event", 5));
+  NodeId removed_id = other.FindOrAddNode(GetIntLabel("Event", 6));
+  NodeId other_foo_id = other.FindOrAddNode(foo_label);
+  NodeId bar_id = other.FindOrAddNode(GetStringLabel("File", "bar.txt"));
+  other.FindOrAddEdge(other_event_id, other_foo_id, uses_label);
+  other.FindOrAddEdge(other_event_id, bar_id, freq_label);
+  other.FindOrAddEdge(removed_id, bar_id, uses_label);
+  other.RemoveNodes({removed_id});
+
+  std::vector<NodeId> node_map = graph_.Merge(other);
+  std::vector<NodeId> expected = {2, LabeledGraph::kRemovedNode, foo_id, 3};
+  EXPECT_EQ(expected, node_map);
+  EXPECT_EQ(4, graph_.NumNodes());
+  EXPECT_EQ(4, graph_.NumEdges());
+  EXPECT_EQ(2, graph_.NumLabeledNodes(GetIntLabel("Event", 5)));
+  EXPECT_EQ(1, graph_.NumLabeledNodes(foo_label));
+  EXPECT_EQ(2, graph_.NumLabeledEdges(uses_label));
+  EXPECT_EQ(2, graph_.NumLabeledEdges(freq_label));
+  EXPECT_EQ(std::set<NodeId>({foo_id, 3}), graph_.GetSuccessors(2));
+  // Merging the graph again only adds the nodes and edges with non-unique
+  // labels.
+  graph_.Merge(other);
+  EXPECT_EQ(5, graph_.NumNodes());
+  EXPECT_EQ(6, graph_.NumEdges());
+  EXPECT_DEATH({ graph_.Merge(graph_); }, "merged with itself");
+}
+
+// Every index has a component, and the components grow as nodes and edges are
+// added.
+TEST_F(LabeledGraphTest, ReportsMemoryUsage) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  util::MemoryBreakdown empty_usage = graph_.MemoryUsage();
+  EXPECT_EQ(1, empty_usage.count("node_indexes/Event"));
+  EXPECT_EQ(1, empty_usage.count("named_nodes/File"));
+  EXPECT_EQ(1, empty_usage.count("edge_indexes/Relation"));
+  EXPECT_EQ(1, empty_usage.count("named_edges/Frequency"));
+  EXPECT_EQ(0, empty_usage["vertices"]);
+  for (int i = 0; i < 100; ++i) {
+    NodeId event_id = graph_.FindOrAddNode(GetIntLabel("Event", i));
+    NodeId file_id = graph_.FindOrAddNode(
+        GetStringLabel("File", util::StrCat("file", std::to_string(i))));
+    graph_.FindOrAddEdge(event_id, file_id, GetIntLabel("Frequency", 1));
+  }
+  util::MemoryBreakdown usage = graph_.MemoryUsage();
+  EXPECT_LT(empty_usage["vertices"], usage["vertices"]);
+  EXPECT_LT(empty_usage["edges"], usage["edges"]);
+  EXPECT_LT(empty_usage["labels"], usage["labels"]);
+  EXPECT_LT(empty_usage["node_indexes/Event"], usage["node_indexes/Event"]);
+  EXPECT_LT(empty_usage["named_nodes/File"], usage["named_nodes/File"]);
+  EXPECT_LT(empty_usage["named_edges/Frequency"],
+            usage["named_edges/Frequency"]);
+  EXPECT_LT(util::TotalBytes(empty_usage), util::TotalBytes(usage));
+}
+
+// The fingerprint depends on the nodes and edges of a graph and not on how
+// they were added, and returns to its value when a change is undone.
+TEST_F(LabeledGraphTest, FingerprintsGraphs) {
+  ASSERT_TRUE(Initialize(&graph_).ok());
+  LabeledGraph bulk_graph;
+  ASSERT_TRUE(Initialize(&bulk_graph).ok());
+  const uint64_t empty_fingerprint = graph_.Fingerprint();
+  EXPECT_EQ(empty_fingerprint, bulk_graph.Fingerprint());
+  PopulateGraph(false, &graph_);
+  PopulateGraph(true, &bulk_graph);
+  const uint64_t fingerprint = graph_.Fingerprint();
+  EXPECT_NE(empty_fingerprint, fingerprint);
+  EXPECT_EQ(fingerprint, bulk_graph.Fingerprint());
+
+  EdgeId edge_id =
+      graph_.FindOrAddEdge(3, 0, GetStringLabel("Relation", "Uses"));
+  EXPECT_NE(fingerprint, graph_.Fingerprint());
+  graph_.RemoveEdges({edge_id});
+  EXPECT_EQ(fingerprint, graph_.Fingerprint());
+  ASSERT_TRUE(graph_.UpdateNodeLabel(3, GetIntLabel("Event", 3)).ok());
+  EXPECT_NE(fingerprint, graph_.Fingerprint());
+  ASSERT_TRUE(graph_.UpdateNodeLabel(3, GetIntLabel("Event", 2)).ok());
+  EXPECT_EQ(fingerprint, graph_.Fingerprint());
+  graph_.SetGraphLabel(ast::value::MakeString("host"));
+  EXPECT_NE(fingerprint, graph_.Fingerprint());
+
+  // Removing the second event and compacting the graph yields the graph with
+  // the other nodes and edges.
+  bulk_graph.RemoveNodes({2});
+  bulk_graph.Compact();
+  LabeledGraph other_graph;
+  ASSERT_TRUE(Initialize(&other_graph).ok());
+  NodeId event = other_graph.FindOrAddNode(GetIntLabel("Event", 1));
+  NodeId file = other_graph.FindOrAddNode(GetStringLabel("File", "foo.txt"));
+  NodeId other_event = other_graph.FindOrAddNode(GetIntLabel("Event", 2));
+  other_graph.FindOrAddEdge(event, other_event,
+                            GetStringLabel("Relation", "Uses"));
+  other_graph.FindOrAddEdge(event, file, GetIntLabel("Frequency", 3));
+  EXPECT_EQ(other_graph.Fingerprint(), bulk_graph.Fingerprint());
+}
+
+// Inserts enough edges to grow the index several times, erases every other
+// edge and checks that the remaining edges are still found.
+TEST(EdgeIndexTest, InsertsFindsAndErasesEdges) {
+  const NodeId kNumNodes = 40;
+  Graph graph(kNumNodes);
+  EdgeIndex index;
+  std::vector<Edge> edges;
+  std::vector<EdgeId> edge_ids;
+  for (NodeId source = 0; source < kNumNodes; ++source) {
+    for (NodeId target = 0; target < kNumNodes; target += 3) {
+      LabelId label = static_cast<LabelId>((source + target) % 2);
+      edges.emplace_back(source, target, label);
+      edge_ids.push_back(boost::add_edge(source, target, label, graph).first);
+      EXPECT_TRUE(index.Insert(edges.back(), edge_ids.back()).second);
+    }
+  }
+  EXPECT_EQ(edges.size(), index.Size());
+  EXPECT_FALSE(index.Insert(edges[0], edge_ids[1]).second);
+  EXPECT_EQ(edge_ids[0], index.Insert(edges[0], edge_ids[1]).first);
+  EXPECT_EQ(nullptr, index.Find(Edge(0, 1, 0)));
+  for (size_t i = 0; i < edges.size(); i += 2) {
+    EXPECT_TRUE(index.Erase(edges[i]));
+    EXPECT_FALSE(index.Erase(edges[i]));
+  }
+  EXPECT_EQ(edges.size() / 2, index.Size());
+  for (size_t i = 0; i < edges.size(); ++i) {
+    const EdgeId* edge_id = index.Find(edges[i]);
+    if (i % 2 == 0) {
+      EXPECT_EQ(nullptr, edge_id);
+    } else {
+      ASSERT_NE(nullptr, edge_id);
+      EXPECT_EQ(edge_ids[i], *edge_id);
+    }
+  }
+  size_t num_entries = 0;
+  index.ForEach([&graph, &num_entries](const Edge& edge, EdgeId edge_id) {
+    EXPECT_EQ(edge.source, boost::source(edge_id, graph));
+    EXPECT_EQ(edge.target, boost::target(edge_id, graph));
+    ++num_entries;
+  });
+  EXPECT_EQ(index.Size(), num_entries);
+}
+
+TEST(LabeledGraphDeathTest, ColumnsRequireIntegerFields) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  EXPECT_DEATH({ graph.AddNodeColumn("File", {}); }, ".*");
+  EXPECT_DEATH({ graph.AddNodeColumn("Event", {0}); }, ".*");
+  EXPECT_DEATH({ graph.AddNodeColumn("Process", {}); }, ".*");
+}
+
+TEST(LabeledGraphDeathTest, RemovesOnlyExistingNodes) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  NodeId node_id = graph.FindOrAddNode(GetIntLabel("Event", 1));
+  EXPECT_DEATH({ graph.RemoveNodes({node_id + 1}); }, ".*");
+  graph.RemoveNodes({node_id});
+  EXPECT_DEATH({ graph.RemoveNodes({node_id}); }, ".*");
+}
+
+TEST(LabeledGraphDeathTest, DegreeStatisticsRequireTracking) {
+  LabeledGraph graph;
+  ASSERT_TRUE(Initialize(&graph).ok());
+  EXPECT_DEATH({ graph.GetHubs(); }, ".*");
+  EXPECT_DEATH({ graph.GetDegreeHistogram("Event"); }, ".*");
+  EXPECT_DEATH({ graph.TrackDegrees(-1); }, ".*");
+  graph.TrackDegrees(1);
+  EXPECT_DEATH({ graph.GetDegreeHistogram("Process"); }, ".*");
+}
+
 }  // namespace
 }  // namespace morphie
@@ -0,0 +1,243 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/labeled_graph_view.h"
+
+#include "util/logging.h"
+
+namespace morphie {
+
+namespace {
+const char kInvalidNodeErr[] = "Invalid node id.";
+const char kInvalidEdgeErr[] = "Invalid edge id.";
+}  // namespace
+
+bool VisibleNode::operator()(NodeId node_id) const {
+  return view->HasNode(node_id);
+}
+
+bool VisibleEdge::operator()(const EdgeId& edge_id) const {
+  return view->IsVisibleEdge(edge_id);
+}
+
+LabeledGraphView::LabeledGraphView(const LabeledGraph& graph)
+    : graph_(graph),
+      num_nodes_(graph.NumNodes()),
+      num_edges_(graph.NumEdges()) {}
+
+// The edges of a node that are still in the view are uncounted before the node
+// is hidden. A self-edge is both an in-edge and an out-edge, so it is only
+// uncounted as an out-edge.
+void LabeledGraphView::HideNode(NodeId node_id) {
+  CHECK(graph_.HasNode(node_id), kInvalidNodeErr);
+  if (IsHiddenNode(node_id)) {
+    return;
+  }
+  const ::morphie::Graph& graph = graph_.graph_;
+  for (const EdgeId& edge_id :
+       ::boost::make_iterator_range(::boost::out_edges(node_id, graph))) {
+    if (IsVisibleEdge(edge_id)) {
+      --num_edges_;
+    }
+  }
+  for (const EdgeId& edge_id :
+       ::boost::make_iterator_range(::boost::in_edges(node_id, graph))) {
+    if (::boost::source(edge_id, graph) != node_id && IsVisibleEdge(edge_id)) {
+      --num_edges_;
+    }
+  }
+  if (is_hidden_node_.empty()) {
+    is_hidden_node_.resize(NumNodeIds(), false);
+  }
+  is_hidden_node_[node_id] = true;
+  --num_nodes_;
+}
+
+void LabeledGraphView::HideNodes(const std::set<NodeId>& nodes) {
+  for (NodeId node_id : nodes) {
+    HideNode(node_id);
+  }
+}
+
+void LabeledGraphView::HideEdge(EdgeId edge_id) {
+  CHECK(graph_.HasEdge(edge_id), kInvalidEdgeErr);
+  if (IsVisibleEdge(edge_id)) {
+    --num_edges_;
+  }
+  hidden_edges_.insert(edge_id);
+}
+
+void LabeledGraphView::HideEdges(const std::set<EdgeId>& edges) {
+  for (const EdgeId& edge_id : edges) {
+    HideEdge(edge_id);
+  }
+}
+
+void LabeledGraphView::HideIsolatedNodes() {
+  const NodeId num_node_ids = static_cast<NodeId>(NumNodeIds());
+  for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+    if (HasNode(node_id) && OutEdgeBegin(node_id) == OutEdgeEnd(node_id) &&
+        InEdgeBegin(node_id) == InEdgeEnd(node_id)) {
+      HideNode(node_id);
+    }
+  }
+}
+
+bool LabeledGraphView::HasNode(NodeId node_id) const {
+  return !IsHiddenNode(node_id) && graph_.HasNode(node_id);
+}
+
+bool LabeledGraphView::HasEdge(EdgeId edge_id) const {
+  return graph_.HasEdge(edge_id) && IsVisibleEdge(edge_id);
+}
+
+bool LabeledGraphView::IsVisibleEdge(const EdgeId& edge_id) const {
+  return !IsHiddenNode(::boost::source(edge_id, graph_.graph_)) &&
+         !IsHiddenNode(::boost::target(edge_id, graph_.graph_)) &&
+         !IsHiddenEdge(edge_id);
+}
+
+const TaggedAST& LabeledGraphView::GetNodeLabel(NodeId node_id) const {
+  return graph_.GetLabel(GetNodeLabelId(node_id));
+}
+
+const TaggedAST& LabeledGraphView::GetEdgeLabel(EdgeId edge_id) const {
+  return graph_.GetLabel(GetEdgeLabelId(edge_id));
+}
+
+LabelId LabeledGraphView::GetNodeLabelId(NodeId node_id) const {
+  CHECK(!IsHiddenNode(node_id), kInvalidNodeErr);
+  return graph_.GetNodeLabelId(node_id);
+}
+
+LabelId LabeledGraphView::GetEdgeLabelId(EdgeId edge_id) const {
+  CHECK(IsVisibleEdge(edge_id), kInvalidEdgeErr);
+  return graph_.GetEdgeLabelId(edge_id);
+}
+
+std::vector<NodeId> LabeledGraphView::GetNodes(const TaggedAST& label) const {
+  std::vector<NodeId> nodes;
+  for (NodeId node_id : graph_.GetNodes(label)) {
+    if (!IsHiddenNode(node_id)) {
+      nodes.push_back(node_id);
+    }
+  }
+  return nodes;
+}
+
+std::vector<EdgeId> LabeledGraphView::GetEdges(const TaggedAST& label) const {
+  std::vector<EdgeId> edges;
+  for (const EdgeId& edge_id : graph_.GetEdges(label)) {
+    if (IsVisibleEdge(edge_id)) {
+      edges.push_back(edge_id);
+    }
+  }
+  return edges;
+}
+
+std::set<NodeId> LabeledGraphView::GetPredecessors(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  ViewPredecessorRange predecessors = GetPredecessorRange(node_id);
+  return std::set<NodeId>(predecessors.begin(), predecessors.end());
+}
+
+std::set<NodeId> LabeledGraphView::GetSuccessors(NodeId node_id) const {
+  CHECK(HasNode(node_id), kInvalidNodeErr);
+  ViewSuccessorRange successors = GetSuccessorRange(node_id);
+  return std::set<NodeId>(successors.begin(), successors.end());
+}
+
+ViewPredecessorRange LabeledGraphView::GetPredecessorRange(
+    NodeId node_id) const {
+  EdgeSource source{&graph_.graph_};
+  return ::boost::make_iterator_range(
+      ::boost::make_transform_iterator(InEdgeBegin(node_id), source),
+      ::boost::make_transform_iterator(InEdgeEnd(node_id), source));
+}
+
+ViewSuccessorRange LabeledGraphView::GetSuccessorRange(NodeId node_id) const {
+  EdgeTarget target{&graph_.graph_};
+  return ::boost::make_iterator_range(
+      ::boost::make_transform_iterator(OutEdgeBegin(node_id), target),
+      ::boost::make_transform_iterator(OutEdgeEnd(node_id), target));
+}
+
+void LabeledGraphView::CollectPredecessors(NodeId node_id, NodeMarker* marker,
+                                           std::vector<NodeId>* nodes) const {
+  for (NodeId predecessor : GetPredecessorRange(node_id)) {
+    if (marker->Mark(predecessor)) {
+      nodes->push_back(predecessor);
+    }
+  }
+  marker->Clear();
+}
+
+void LabeledGraphView::CollectSuccessors(NodeId node_id, NodeMarker* marker,
+                                         std::vector<NodeId>* nodes) const {
+  for (NodeId successor : GetSuccessorRange(node_id)) {
+    if (marker->Mark(successor)) {
+      nodes->push_back(successor);
+    }
+  }
+  marker->Clear();
+}
+
+// The edge lists of a removed node are empty, and the edges of a hidden node
+// are skipped by the filter, so the iterators are valid for every identifier
+// below NumNodeIds().
+ViewInEdgeIterator LabeledGraphView::InEdgeBegin(NodeId node_id) const {
+  CHECK(node_id < static_cast<NodeId>(NumNodeIds()), kInvalidNodeErr);
+  InEdgeRange edges = ::boost::in_edges(node_id, graph_.graph_);
+  return ViewInEdgeIterator(VisibleEdge{this}, edges.first, edges.second);
+}
+
+ViewInEdgeIterator LabeledGraphView::InEdgeEnd(NodeId node_id) const {
+  CHECK(node_id < static_cast<NodeId>(NumNodeIds()), kInvalidNodeErr);
+  InEdgeRange edges = ::boost::in_edges(node_id, graph_.graph_);
+  return ViewInEdgeIterator(VisibleEdge{this}, edges.second, edges.second);
+}
+
+ViewOutEdgeIterator LabeledGraphView::OutEdgeBegin(NodeId node_id) const {
+  CHECK(node_id < static_cast<NodeId>(NumNodeIds()), kInvalidNodeErr);
+  OutEdgeRange edges = ::boost::out_edges(node_id, graph_.graph_);
+  return ViewOutEdgeIterator(VisibleEdge{this}, edges.first, edges.second);
+}
+
+ViewOutEdgeIterator LabeledGraphView::OutEdgeEnd(NodeId node_id) const {
+  CHECK(node_id < static_cast<NodeId>(NumNodeIds()), kInvalidNodeErr);
+  OutEdgeRange edges = ::boost::out_edges(node_id, graph_.graph_);
+  return ViewOutEdgeIterator(VisibleEdge{this}, edges.second, edges.second);
+}
+
+ViewNodeIterator LabeledGraphView::NodeSetBegin() const {
+  auto nodes = ::boost::vertices(graph_.graph_);
+  return ViewNodeIterator(VisibleNode{this}, nodes.first, nodes.second);
+}
+
+ViewNodeIterator LabeledGraphView::NodeSetEnd() const {
+  auto nodes = ::boost::vertices(graph_.graph_);
+  return ViewNodeIterator(VisibleNode{this}, nodes.second, nodes.second);
+}
+
+ViewEdgeIterator LabeledGraphView::EdgeSetBegin() const {
+  auto edges = ::boost::edges(graph_.graph_);
+  return ViewEdgeIterator(VisibleEdge{this}, edges.first, edges.second);
+}
+
+ViewEdgeIterator LabeledGraphView::EdgeSetEnd() const {
+  auto edges = ::boost::edges(graph_.graph_);
+  return ViewEdgeIterator(VisibleEdge{this}, edges.second, edges.second);
+}
+
+}  // namespace morphie
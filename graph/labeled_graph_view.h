@@ -0,0 +1,204 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A labeled graph view presents a subgraph of a LabeledGraph without copying
+// the graph. The view hides nodes and edges of the graph by recording them in
+// masks, and every query of the view skips hidden nodes and edges. Hiding a
+// node hides the edges incident on it. Exploratory analyses that repeatedly
+// filter a graph and summarize the result can construct a view for each filter
+// instead of materializing a new graph with graph::DeleteNodes.
+//
+// Example.
+//   LabeledGraph graph;
+//   // Code that constructs a graph.
+//   LabeledGraphView view(graph);
+//   view.HideNodes(noisy_nodes);
+//   std::vector<int> blocks = graph_analyzer::RefinePartition(view, partition);
+//   std::unique_ptr<LabeledGraph> summary =
+//       graph::QuotientGraph(view, blocks, config);
+//
+// Nodes and edges of a view have the identifiers they have in the graph, so the
+// node identifiers of a view need not be consecutive. Functions that take a
+// vector with one entry per node of a view expect an entry for every
+// identifier below NumNodeIds(). A view refers to the graph it was constructed
+// from, which must outlive the view and must not be modified while the view is
+// in use.
+#ifndef LOGLE_LABELED_GRAPH_VIEW_H_
+#define LOGLE_LABELED_GRAPH_VIEW_H_
+
+#include <boost/functional/hash.hpp>
+#include <boost/iterator/filter_iterator.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include "graph/labeled_graph.h"
+#include "ast.pb.h"
+
+namespace morphie {
+
+class LabeledGraphView;
+
+// Predicates that select the nodes and edges of a view.
+struct VisibleNode {
+  bool operator()(NodeId node_id) const;
+  const LabeledGraphView* view;
+};
+struct VisibleEdge {
+  bool operator()(const EdgeId& edge_id) const;
+  const LabeledGraphView* view;
+};
+// Map an edge of a Graph to its source or its target.
+struct EdgeSource {
+  using result_type = NodeId;
+  NodeId operator()(const EdgeId& edge_id) const {
+    return ::boost::source(edge_id, *graph);
+  }
+  const Graph* graph;
+};
+struct EdgeTarget {
+  using result_type = NodeId;
+  NodeId operator()(const EdgeId& edge_id) const {
+    return ::boost::target(edge_id, *graph);
+  }
+  const Graph* graph;
+};
+
+// The iterators of a view wrap the iterators of LabeledGraph and skip hidden
+// nodes and edges.
+using ViewNodeIterator = ::boost::filter_iterator<VisibleNode, NodeIterator>;
+using ViewEdgeIterator = ::boost::filter_iterator<VisibleEdge, EdgeIterator>;
+using ViewInEdgeIterator =
+    ::boost::filter_iterator<VisibleEdge, InEdgeIterator>;
+using ViewOutEdgeIterator =
+    ::boost::filter_iterator<VisibleEdge, OutEdgeIterator>;
+// As in a LabeledGraph, a node that is connected to another by several visible
+// edges occurs several times in a range of predecessors or successors.
+using ViewPredecessorRange = ::boost::iterator_range<
+    ::boost::transform_iterator<EdgeSource, ViewInEdgeIterator>>;
+using ViewSuccessorRange = ::boost::iterator_range<
+    ::boost::transform_iterator<EdgeTarget, ViewOutEdgeIterator>>;
+
+// The LabeledGraphView class provides the read-only API of LabeledGraph for the
+// nodes and edges that are not hidden. Hidden nodes are stored in a bit vector
+// indexed by node identifier. Edges of a LabeledGraph have no dense
+// identifiers, so hidden edges are stored in a hash set, which is only
+// consulted if some edge has been hidden. Label queries take the same time as
+// in the graph, and iteration takes time linear in the number of nodes or
+// edges of the graph, not of the view.
+class LabeledGraphView {
+ public:
+  // Constructs a view of all nodes and edges of 'graph'.
+  // - Requires that 'graph' is initialized.
+  explicit LabeledGraphView(const LabeledGraph& graph);
+
+  const LabeledGraph& Graph() const { return graph_; }
+
+  // Hides nodes or edges of the graph. Hiding a node or edge that is already
+  // hidden has no effect.
+  // - Crashes if a node or edge is not in the graph.
+  void HideNode(NodeId node_id);
+  void HideNodes(const std::set<NodeId>& nodes);
+  void HideEdge(EdgeId edge_id);
+  void HideEdges(const std::set<EdgeId>& edges);
+  // Hides every node that has no incident edge in the view. Hiding 'edges' and
+  // then the isolated nodes gives a view of the graph that
+  // graph::DeleteEdgesAndNodes(graph, edges) constructs.
+  void HideIsolatedNodes();
+
+  // A node is in the view if it is in the graph and not hidden. An edge is in
+  // the view if it is in the graph, not hidden, and both of its endpoints are
+  // in the view.
+  bool HasNode(NodeId node_id) const;
+  bool HasEdge(EdgeId edge_id) const;
+  int NumNodes() const { return num_nodes_; }
+  int NumEdges() const { return num_edges_; }
+  // Returns the number of node identifiers of the graph, which bounds the
+  // identifiers of the nodes in the view.
+  int NumNodeIds() const { return graph_.NumNodeIds(); }
+
+  // The label functions have the same semantics as the functions of the same
+  // name in LabeledGraph.
+  // - The node functions require that HasNode(node_id) is true and the edge
+  //   functions require that HasEdge(edge_id) is true.
+  const TaggedAST& GetNodeLabel(NodeId node_id) const;
+  const TaggedAST& GetEdgeLabel(EdgeId edge_id) const;
+  LabelId GetNodeLabelId(NodeId node_id) const;
+  LabelId GetEdgeLabelId(EdgeId edge_id) const;
+  int NumDistinctLabels() const { return graph_.NumDistinctLabels(); }
+  const TaggedAST& GetLabel(LabelId label_id) const {
+    return graph_.GetLabel(label_id);
+  }
+  AST GetGraphLabel() const { return graph_.GetGraphLabel(); }
+  NodeId Source(EdgeId edge_id) const { return graph_.Source(edge_id); }
+  NodeId Target(EdgeId edge_id) const { return graph_.Target(edge_id); }
+
+  // Return the nodes or edges of the view with 'label', in the order in which
+  // LabeledGraph::GetNodes and LabeledGraph::GetEdges return them.
+  std::vector<NodeId> GetNodes(const TaggedAST& label) const;
+  std::vector<EdgeId> GetEdges(const TaggedAST& label) const;
+
+  // The neighbor functions below have the same semantics as the functions of
+  // the same name in LabeledGraph, restricted to the edges of the view.
+  // - The set functions require that HasNode(node_id) is true.
+  std::set<NodeId> GetPredecessors(NodeId node_id) const;
+  std::set<NodeId> GetSuccessors(NodeId node_id) const;
+  // The ranges and iterators are empty for a node that is not in the view, so
+  // that algorithms on consecutive node identifiers can visit every
+  // identifier below NumNodeIds().
+  // - The functions require that 'node_id' is less than NumNodeIds().
+  ViewPredecessorRange GetPredecessorRange(NodeId node_id) const;
+  ViewSuccessorRange GetSuccessorRange(NodeId node_id) const;
+  void CollectPredecessors(NodeId node_id, NodeMarker* marker,
+                           std::vector<NodeId>* nodes) const;
+  void CollectSuccessors(NodeId node_id, NodeMarker* marker,
+                         std::vector<NodeId>* nodes) const;
+  ViewInEdgeIterator InEdgeBegin(NodeId node_id) const;
+  ViewInEdgeIterator InEdgeEnd(NodeId node_id) const;
+  ViewOutEdgeIterator OutEdgeBegin(NodeId node_id) const;
+  ViewOutEdgeIterator OutEdgeEnd(NodeId node_id) const;
+
+  // Iterators over the nodes and edges of the view, in the order of the
+  // corresponding iterators of LabeledGraph.
+  ViewNodeIterator NodeSetBegin() const;
+  ViewNodeIterator NodeSetEnd() const;
+  ViewEdgeIterator EdgeSetBegin() const;
+  ViewEdgeIterator EdgeSetEnd() const;
+
+ private:
+  friend struct VisibleEdge;
+
+  bool IsHiddenNode(NodeId node_id) const {
+    return node_id < is_hidden_node_.size() && is_hidden_node_[node_id];
+  }
+  bool IsHiddenEdge(const EdgeId& edge_id) const {
+    return !hidden_edges_.empty() && hidden_edges_.count(edge_id) > 0;
+  }
+  // Returns true if 'edge_id', which is an edge of the graph, is in the view.
+  bool IsVisibleEdge(const EdgeId& edge_id) const;
+
+  const LabeledGraph& graph_;
+  // Sized on the first call to HideNode, so a view of a whole graph does not
+  // allocate a mask.
+  std::vector<bool> is_hidden_node_;
+  std::unordered_set<EdgeId, ::boost::hash<EdgeId>> hidden_edges_;
+  int num_nodes_;
+  int num_edges_;
+};  // class LabeledGraphView
+
+}  // namespace morphie
+
+#endif  // LOGLE_LABELED_GRAPH_VIEW_H_
@@ -0,0 +1,211 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/labeled_graph_view.h"
+
+#include <iterator>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "graph/dot_printer.h"
+#include "graph/graph_analyzer.h"
+#include "graph/graph_exporter.h"
+#include "graph/graph_transformer.h"
+#include "graph/test_graphs.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace {
+
+using test::EdgeWeightLabel;
+using test::NodeWeightLabel;
+
+// Creates the graph with nodes 0, 1, 2 and 3 of weights 0, 1, 2 and 1 and the
+// edges 0 -> 1, 0 -> 1, 0 -> 2, 2 -> 1, 1 -> 3 and 3 -> 3, in which the second
+// edge from 0 to 1 has weight 6 and the other edges have weight 5.
+void GetGraph(test::WeightedGraph* graph, EdgeId* heavy_edge) {
+  ASSERT_TRUE(graph->Initialize().ok());
+  NodeId node0 = graph->AddNode(0);
+  NodeId node1 = graph->AddNode(1);
+  NodeId node2 = graph->AddNode(2);
+  NodeId node3 = graph->AddNode(1);
+  graph->AddEdge(node0, node1, 5);
+  *heavy_edge = graph->AddEdge(node0, node1, 6);
+  graph->AddEdge(node0, node2, 5);
+  graph->AddEdge(node2, node1, 5);
+  graph->AddEdge(node1, node3, 5);
+  graph->AddEdge(node3, node3, 5);
+}
+
+std::vector<NodeId> ViewNodes(const LabeledGraphView& view) {
+  return std::vector<NodeId>(view.NodeSetBegin(), view.NodeSetEnd());
+}
+
+TEST(LabeledGraphViewTest, ViewOfWholeGraph) {
+  test::WeightedGraph weighted_graph;
+  EdgeId heavy_edge;
+  GetGraph(&weighted_graph, &heavy_edge);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+  LabeledGraphView view(graph);
+  EXPECT_EQ(&graph, &view.Graph());
+  EXPECT_EQ(4, view.NumNodes());
+  EXPECT_EQ(4, view.NumNodeIds());
+  EXPECT_EQ(6, view.NumEdges());
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 2, 3}), ViewNodes(view));
+  EXPECT_EQ(6, std::distance(view.EdgeSetBegin(), view.EdgeSetEnd()));
+  for (NodeId node_id = 0; node_id < 4; ++node_id) {
+    EXPECT_TRUE(view.HasNode(node_id));
+    EXPECT_EQ(graph.GetNodeLabelId(node_id), view.GetNodeLabelId(node_id));
+    EXPECT_EQ(graph.GetSuccessors(node_id), view.GetSuccessors(node_id));
+    EXPECT_EQ(graph.GetPredecessors(node_id), view.GetPredecessors(node_id));
+    EXPECT_EQ(boost::distance(graph.GetSuccessorRange(node_id)),
+              boost::distance(view.GetSuccessorRange(node_id)));
+  }
+  EXPECT_TRUE(view.HasEdge(heavy_edge));
+  EXPECT_EQ(graph.GetEdgeLabelId(heavy_edge), view.GetEdgeLabelId(heavy_edge));
+  EXPECT_EQ(std::vector<NodeId>({1, 3}),
+            view.GetNodes(NodeWeightLabel(1)));
+  EXPECT_EQ(DotPrinter().DotGraph(graph), DotPrinter().DotGraph(view));
+  EXPECT_EQ(viz::GraphExporter(graph).GraphAsString(),
+            viz::GraphExporter(view).GraphAsString());
+}
+
+// Hiding nodes and edges changes the view but not the graph.
+TEST(LabeledGraphViewTest, HidesNodesAndEdges) {
+  test::WeightedGraph weighted_graph;
+  EdgeId heavy_edge;
+  GetGraph(&weighted_graph, &heavy_edge);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+  LabeledGraphView view(graph);
+  view.HideNode(2);
+  EXPECT_EQ(3, view.NumNodes());
+  EXPECT_EQ(4, view.NumEdges());
+  EXPECT_FALSE(view.HasNode(2));
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 3}), ViewNodes(view));
+  EXPECT_EQ(std::set<NodeId>({1}), view.GetSuccessors(0));
+  EXPECT_EQ(std::set<NodeId>({0}), view.GetPredecessors(1));
+  EXPECT_EQ(2, boost::distance(view.GetSuccessorRange(0)));
+  EXPECT_TRUE(view.GetPredecessorRange(2).empty());
+  EXPECT_TRUE(view.GetNodes(NodeWeightLabel(2)).empty());
+  // A self-edge is counted once.
+  view.HideNodes({2, 3});
+  EXPECT_EQ(2, view.NumNodes());
+  EXPECT_EQ(2, view.NumEdges());
+  EXPECT_EQ(std::vector<NodeId>({1}),
+            view.GetNodes(NodeWeightLabel(1)));
+  view.HideEdge(heavy_edge);
+  view.HideEdge(heavy_edge);
+  EXPECT_EQ(1, view.NumEdges());
+  EXPECT_FALSE(view.HasEdge(heavy_edge));
+  EXPECT_TRUE(view.GetEdges(EdgeWeightLabel(6)).empty());
+  EXPECT_EQ(1, view.GetEdges(EdgeWeightLabel(5)).size());
+  NodeMarker marker;
+  std::vector<NodeId> nodes;
+  view.CollectSuccessors(0, &marker, &nodes);
+  EXPECT_EQ(std::vector<NodeId>({1}), nodes);
+  EXPECT_EQ(4, graph.NumNodes());
+  EXPECT_EQ(6, graph.NumEdges());
+  EXPECT_EQ(1, graph.GetEdges(EdgeWeightLabel(6)).size());
+}
+
+// A view that hides edges and then isolated nodes has as many nodes and edges
+// as the graph constructed by DeleteEdgesAndNodes.
+TEST(LabeledGraphViewTest, HideIsolatedNodes) {
+  test::WeightedGraph weighted_graph;
+  EdgeId heavy_edge;
+  GetGraph(&weighted_graph, &heavy_edge);
+  const LabeledGraph& graph = *weighted_graph.GetGraph();
+  std::set<EdgeId> edges(graph.InEdgeBegin(2), graph.InEdgeEnd(2));
+  edges.insert(graph.OutEdgeBegin(2), graph.OutEdgeEnd(2));
+  LabeledGraphView view(graph);
+  view.HideEdges(edges);
+  EXPECT_EQ(4, view.NumNodes());
+  view.HideIsolatedNodes();
+  std::unique_ptr<graph::Morphism> morphism =
+      graph::DeleteEdgesAndNodes(graph, edges);
+  EXPECT_EQ(morphism->Output().NumNodes(), view.NumNodes());
+  EXPECT_EQ(morphism->Output().NumEdges(), view.NumEdges());
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 3}), ViewNodes(view));
+}
+
+// Nodes of a view are printed and exported with their identifiers in the
+// graph, in the same order for any number of threads.
+TEST(LabeledGraphViewTest, PrintsAndExportsView) {
+  test::WeightedGraph weighted_graph;
+  EdgeId heavy_edge;
+  GetGraph(&weighted_graph, &heavy_edge);
+  LabeledGraphView view(*weighted_graph.GetGraph());
+  view.HideNode(0);
+  DotPrinter printer;
+  string dot_nodes = printer.AllNodesInDot(view);
+  EXPECT_EQ(string::npos, dot_nodes.find("  0 "));
+  EXPECT_NE(string::npos, dot_nodes.find("  3 "));
+  string dot_graph = printer.DotGraph(view);
+  printer.SetNumThreads(3);
+  EXPECT_EQ(dot_graph, printer.DotGraph(view));
+  viz::GraphExporter exporter(view);
+  EXPECT_EQ(3, exporter.Graph().node_size());
+}
+
+// Refining the partition of a view gives the same blocks as refining the
+// partition of the graph constructed by DeleteNodes.
+TEST(LabeledGraphViewTest, RefinePartitionMatchesDeletedNodes) {
+  test::WeightedGraph path;
+  test::GetPathGraph(7, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  LabeledGraphView view(graph);
+  view.HideNode(3);
+  std::unique_ptr<graph::Morphism> morphism = graph::DeleteNodes(graph, {3});
+  std::vector<int> copy_blocks = graph_analyzer::RefinePartition(
+      morphism->Output(), std::vector<int>(6, 0));
+  std::vector<int> view_blocks =
+      graph_analyzer::RefinePartition(view, std::vector<int>(7, 0));
+  ASSERT_EQ(7, view_blocks.size());
+  EXPECT_EQ(-1, view_blocks[3]);
+  view_blocks.erase(view_blocks.begin() + 3);
+  EXPECT_EQ(copy_blocks, view_blocks);
+  std::vector<int> parallel_blocks =
+      graph_analyzer::RefinePartitionParallel(view, std::vector<int>(7, 0), 2);
+  parallel_blocks.erase(parallel_blocks.begin() + 3);
+  EXPECT_EQ(copy_blocks, parallel_blocks);
+  std::vector<int> bounded_blocks = graph_analyzer::RefinePartitionBounded(
+      view, std::vector<int>(7, 0), 7,
+      graph_analyzer::RefinementDirection::kForward, 2);
+  EXPECT_EQ(-1, bounded_blocks[3]);
+  bounded_blocks.erase(bounded_blocks.begin() + 3);
+  EXPECT_EQ(copy_blocks, bounded_blocks);
+  std::map<NodeId, int> partition = {{0, 0}, {1, 0}, {2, 0}, {4, 0},
+                                     {5, 0}, {6, 0}};
+  std::map<NodeId, int> view_map =
+      graph_analyzer::RefinePartition(view, partition);
+  EXPECT_EQ(6, view_map.size());
+  EXPECT_EQ(view_map[2], view_map[6]);
+  EXPECT_NE(view_map[1], view_map[2]);
+}
+
+TEST(LabeledGraphViewDeathTest, HidesOnlyNodesOfGraph) {
+  test::WeightedGraph weighted_graph;
+  EdgeId heavy_edge;
+  GetGraph(&weighted_graph, &heavy_edge);
+  LabeledGraphView view(*weighted_graph.GetGraph());
+  EXPECT_DEATH({ view.HideNode(4); }, ".*");
+  view.HideNode(0);
+  EXPECT_DEATH({ view.GetNodeLabel(0); }, ".*");
+  EXPECT_DEATH({ view.GetEdgeLabel(heavy_edge); }, ".*");
+}
+
+}  // namespace
+}  // namespace morphie
@@ -1,71 +1,130 @@
 #include "morphism.h"
 
-#include "util/map_utils.h"
+#include <algorithm>
+#include <limits>
+
+#include "util/logging.h"
 #include "util/status.h"
 
 namespace morphie {
 namespace graph {
 
+namespace {
+
+// Marks input nodes that do not map to an output node.
+const NodeId kNoNode = std::numeric_limits<NodeId>::max();
+const char kOutputNodeErr[] = "The node is not in the output graph.";
+const char kNullOutputErr[] = "The output graph is null.";
+
+}  // namespace
+
 std::unique_ptr<LabeledGraph> Morphism::TakeOutput() {
   node_map_.clear();
-  node_preimage_.clear();
+  is_preimage_valid_ = false;
   return std::move(output_graph_);
 }
 
-void Morphism::CopyInputType() {
+void Morphism::CopyInputType() { CopyType(input_graph_); }
+
+void Morphism::CopyType(const LabeledGraph& graph_type) {
   output_graph_.reset(new LabeledGraph());
   util::Status status = output_graph_->Initialize(
-      input_graph_.GetNodeTypes(), input_graph_.GetUniqueNodeTags(),
-      input_graph_.GetEdgeTypes(), input_graph_.GetUniqueEdgeTags(),
-      input_graph_.GetGraphType());
+      graph_type.GetNodeTypes(), graph_type.GetUniqueNodeTags(),
+      graph_type.GetEdgeTypes(), graph_type.GetUniqueEdgeTags(),
+      graph_type.GetGraphType());
   if (!status.ok()) {
     output_graph_.reset(nullptr);
   }
 }
 
+void Morphism::SetOutput(std::unique_ptr<LabeledGraph> output) {
+  CHECK(output != nullptr, kNullOutputErr);
+  output_graph_ = std::move(output);
+  node_map_.clear();
+  is_preimage_valid_ = false;
+}
+
 NodeId Morphism::FindOrCopyNode(NodeId input_node) {
-  TaggedAST label = input_graph_.GetNodeLabel(input_node);
+  const TaggedAST& label = input_graph_.GetNodeLabel(input_node);
   return FindOrMapNode(input_node, label);
 }
 
-NodeId Morphism::FindOrMapNode(NodeId input_node, TaggedAST label) {
-  auto map_it = node_map_.find(input_node);
-  if (map_it != node_map_.end()) {
-    return map_it->second;
+NodeId Morphism::FindOrMapNode(NodeId input_node,
+                               const TaggedAST& label) {
+  if (input_node >= node_map_.size()) {
+    node_map_.resize(std::max<size_t>(input_node + 1, input_graph_.NumNodes()),
+                     kNoNode);
+  } else if (node_map_[input_node] != kNoNode) {
+    return node_map_[input_node];
   }
   NodeId output_node = output_graph_->FindOrAddNode(label);
-  node_map_.insert({input_node, output_node});
-  auto preimage_it = node_preimage_.find(output_node);
-  if (preimage_it == node_preimage_.end()) {
-    node_preimage_.insert({output_node, {input_node}});
-  } else {
-    preimage_it->second.insert(input_node);
-  }
+  node_map_[input_node] = output_node;
+  is_preimage_valid_ = false;
   return output_node;
 }
 
+void Morphism::MapNode(NodeId input_node, NodeId output_node) {
+  CHECK(output_graph_ != nullptr && output_graph_->HasNode(output_node),
+        kOutputNodeErr);
+  if (input_node >= node_map_.size()) {
+    node_map_.resize(std::max<size_t>(input_node + 1, input_graph_.NumNodes()),
+                     kNoNode);
+  }
+  node_map_[input_node] = output_node;
+  is_preimage_valid_ = false;
+}
+
 EdgeId Morphism::FindOrCopyEdge(EdgeId input_edge) {
-  TaggedAST label = input_graph_.GetEdgeLabel(input_edge);
+  const TaggedAST& label = input_graph_.GetEdgeLabel(input_edge);
   return FindOrMapEdge(input_edge, label);
 }
 
-EdgeId Morphism::FindOrMapEdge(EdgeId input_edge, TaggedAST label) {
+EdgeId Morphism::FindOrMapEdge(EdgeId input_edge,
+                               const TaggedAST& label) {
   NodeId src = FindOrCopyNode(input_graph_.Source(input_edge));
   NodeId tgt = FindOrCopyNode(input_graph_.Target(input_edge));
   EdgeId output_edge = output_graph_->FindOrAddEdge(src, tgt, label);
   return output_edge;
 }
 
+std::pair<bool, NodeId> Morphism::FindNodeImage(NodeId input_node) const {
+  if (input_node >= node_map_.size() || node_map_[input_node] == kNoNode) {
+    return {false, 0};
+  }
+  return {true, node_map_[input_node]};
+}
+
+util::Span<NodeId> Morphism::GetNodePreimage(NodeId output_node) const {
+  if (!is_preimage_valid_) {
+    util::Preimage(node_map_, kNoNode, &preimage_);
+    is_preimage_valid_ = true;
+  }
+  return preimage_.Get(output_node);
+}
+
+// An input node whose image does not map to anything in 'morphism' no longer
+// maps to anything.
 util::Status Morphism::ComposeWith(Morphism* morphism) {
   if (output_graph_.get() != &morphism->input_graph_) {
     return util::Status(Code::INVALID_ARGUMENT,
                         "Trying to compose incompatible morphisms.");
   }
-  node_map_ = util::Compose(node_map_, morphism->node_map_);
-  node_preimage_ = util::Preimage(node_map_);
+  node_map_ = util::Compose(node_map_, morphism->node_map_, kNoNode);
+  is_preimage_valid_ = false;
   output_graph_ = morphism->TakeOutput();
   return util::Status::OK;
 }
 
+util::MemoryBreakdown Morphism::MemoryUsage() const {
+  util::MemoryBreakdown usage;
+  usage["node_map"] = util::VectorBytes(node_map_);
+  usage["preimage"] = util::VectorBytes(preimage_.offsets) +
+                      util::VectorBytes(preimage_.keys);
+  if (output_graph_ != nullptr) {
+    util::AddMemoryBreakdown("output", output_graph_->MemoryUsage(), &usage);
+  }
+  return usage;
+}
+
 }  // namespace graph
 }  // namespace morphie
@@ -36,11 +36,15 @@
 #ifndef LOGLE_MORPHISM_H_
 #define LOGLE_MORPHISM_H_
 
-#include <unordered_map>
-#include <unordered_set>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include "labeled_graph.h"
 #include "ast.pb.h"
+#include "util/map_utils.h"
+#include "util/memory_usage.h"
+#include "util/span.h"
 
 namespace morphie {
 namespace graph {
@@ -51,11 +55,15 @@ namespace graph {
 // the output graph, which is why the functions are partial.
 //
 // The Morphism class provides helper functions for creating and manipulating
-// morphisms.
+// morphisms. Node identifiers of a LabeledGraph are consecutive integers, so
+// the node map is stored as a vector indexed by input node. The preimage of
+// the node map is only computed when it is queried, as a compressed array of
+// the input nodes of each output node, and is discarded when the map changes.
 class Morphism {
  public:
   // A Morphism requires a non-null pointer and will not own the input graph.
-  explicit Morphism(const LabeledGraph* graph) : input_graph_(*graph) {}
+  explicit Morphism(const LabeledGraph* graph)
+      : input_graph_(*graph), is_preimage_valid_(false) {}
 
   bool HasOutputGraph() { return output_graph_ != nullptr; }
   // Functions that return the input and output graphs.
@@ -70,27 +78,62 @@ class Morphism {
   // input graph. An output graph that already exists will no longer be
   // accessible.
   void CopyInputType();
+  // Creates a new output graph with the node and edge types of 'graph_type'.
+  // There is no output graph if the types cannot be copied.
+  void CopyType(const LabeledGraph& graph_type);
+  // Makes 'output' the output graph and clears the maps between input and
+  // output nodes. Transformations that extend an existing graph, such as
+  // merges, construct the morphism with this function.
+  // - Crashes if 'output' is null.
+  void SetOutput(std::unique_ptr<LabeledGraph> output);
 
   // Returns the id of an output node with the same label as input_node. Adds a
   // node to the output graph if no such node exists.
   NodeId FindOrCopyNode(NodeId input_node);
   // Returns the id of the output node that the input node maps to in the
   // morphism. Adds a new node to the output graph if no such node exists.
-  NodeId FindOrMapNode(NodeId input_node, TaggedAST label);
+  NodeId FindOrMapNode(NodeId input_node, const TaggedAST& label);
+
+  // Maps 'input_node' to 'output_node', which must be a node of the output
+  // graph, replacing any existing image of 'input_node'. Transformations that
+  // construct the output graph themselves, such as quotients, record the node
+  // map with this function.
+  void MapNode(NodeId input_node, NodeId output_node);
 
   // These functions are similar to the functions for adding nodes above.
   EdgeId FindOrCopyEdge(EdgeId input_edge);
-  EdgeId FindOrMapEdge(EdgeId input_edge, TaggedAST label);
+  EdgeId FindOrMapEdge(EdgeId input_edge, const TaggedAST& label);
+
+  // Returns
+  // - (true, n) if 'input_node' maps to the output node 'n', and
+  // - (false, 0) if 'input_node' does not map to an output node.
+  std::pair<bool, NodeId> FindNodeImage(NodeId input_node) const;
+  // Returns the input nodes that map to 'output_node' in increasing order. The
+  // first call after the node map changes takes time linear in the number of
+  // input nodes. The span is invalidated by any change to the morphism.
+  util::Span<NodeId> GetNodePreimage(NodeId output_node) const;
 
   // Composes this morphism with the input and takes ownership of the output
   // graph in the input morphism. The output graph that existed before
   // composition cannot be access after the composition.
   util::Status ComposeWith(Morphism* morphism);
 
+  // Returns an estimate of the bytes used by the morphism, as described in
+  // util/memory_usage.h, with the components "node_map", "preimage" and, if
+  // there is an output graph, the components of the output graph prefixed by
+  // "output/". The input graph is not owned by the morphism and is not
+  // counted.
+  util::MemoryBreakdown MemoryUsage() const;
+
  private:
   const LabeledGraph& input_graph_;
-  std::unordered_map<NodeId, NodeId> node_map_;
-  std::unordered_map<NodeId, std::unordered_set<NodeId>> node_preimage_;
+  // Maps each input node to an output node, or to kNoNode if the input node
+  // does not map to anything. Input nodes beyond the end of the vector do not
+  // map to anything either.
+  std::vector<NodeId> node_map_;
+  // The preimage of 'node_map_', which is computed when it is queried.
+  mutable bool is_preimage_valid_;
+  mutable util::DensePreimage<NodeId> preimage_;
   std::unique_ptr<LabeledGraph> output_graph_;
 };  // class Morphism
 
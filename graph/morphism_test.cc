@@ -1,7 +1,10 @@
 #include "morphism.h"
 
+#include <vector>
+
 #include "gtest.h"
 #include "test_graphs.h"
+#include "type.h"
 #include "value.h"
 
 namespace morphie {
@@ -50,6 +53,89 @@ TEST(MorphismTest, TakeOutputProperties) {
   EXPECT_FALSE(morphism.HasOutputGraph());
 }
 
+// Returns a label with the unique tag 'File' and the name 'name'.
+TaggedAST MakeFileLabel(const string& name) {
+  TaggedAST label;
+  label.set_tag("File");
+  *label.mutable_ast() = ast::value::MakeString(name);
+  return label;
+}
+
+// Initializes 'graph' with unique 'File' nodes and adds a node for each name.
+void MakeFileGraph(const std::vector<string>& names, LabeledGraph* graph) {
+  ast::type::Types node_types;
+  node_types.emplace("File", ast::type::MakeString("File", false));
+  ast::type::Types edge_types;
+  edge_types.emplace("Uses", ast::type::MakeNull("Uses"));
+  ASSERT_TRUE(graph
+                  ->Initialize(node_types, {"File"}, edge_types, {},
+                               ast::type::MakeNull("Graph"))
+                  .ok());
+  for (const string& name : names) {
+    graph->FindOrAddNode(MakeFileLabel(name));
+  }
+}
+
+TEST(MorphismTest, NodeImagesAndPreimages) {
+  LabeledGraph graph;
+  MakeFileGraph({"a", "b", "c", "d"}, &graph);
+  Morphism morphism(&graph);
+  morphism.CopyInputType();
+  NodeId x = morphism.FindOrMapNode(2, MakeFileLabel("x"));
+  NodeId y = morphism.FindOrMapNode(0, MakeFileLabel("y"));
+  EXPECT_EQ(x, morphism.FindOrMapNode(3, MakeFileLabel("x")));
+  EXPECT_EQ(std::make_pair(true, x), morphism.FindNodeImage(3));
+  EXPECT_FALSE(morphism.FindNodeImage(1).first);
+  EXPECT_FALSE(morphism.FindNodeImage(100).first);
+  EXPECT_EQ(std::vector<NodeId>({2, 3}),
+            std::vector<NodeId>(morphism.GetNodePreimage(x).begin(),
+                                morphism.GetNodePreimage(x).end()));
+  EXPECT_EQ(1, morphism.GetNodePreimage(y).size());
+  // The preimage is recomputed after the node map changes.
+  morphism.FindOrMapNode(1, MakeFileLabel("y"));
+  EXPECT_EQ(std::vector<NodeId>({0, 1}),
+            std::vector<NodeId>(morphism.GetNodePreimage(y).begin(),
+                                morphism.GetNodePreimage(y).end()));
+  EXPECT_TRUE(morphism.GetNodePreimage(100).empty());
+}
+
+// Input nodes whose image does not map to anything in the second morphism do
+// not map to anything in the composition.
+TEST(MorphismTest, ComposeNodeMaps) {
+  LabeledGraph graph;
+  MakeFileGraph({"a", "b", "c"}, &graph);
+  Morphism first(&graph);
+  first.CopyInputType();
+  NodeId x = first.FindOrMapNode(0, MakeFileLabel("x"));
+  first.FindOrMapNode(1, MakeFileLabel("y"));
+  first.FindOrMapNode(2, MakeFileLabel("x"));
+  Morphism second(&first.Output());
+  second.CopyInputType();
+  NodeId z = second.FindOrMapNode(x, MakeFileLabel("z"));
+  EXPECT_TRUE(first.ComposeWith(&second).ok());
+  EXPECT_EQ(std::make_pair(true, z), first.FindNodeImage(0));
+  EXPECT_EQ(std::make_pair(true, z), first.FindNodeImage(2));
+  EXPECT_FALSE(first.FindNodeImage(1).first);
+  EXPECT_EQ(2, first.GetNodePreimage(z).size());
+  EXPECT_EQ(1, first.Output().NumNodes());
+  EXPECT_FALSE(second.HasOutputGraph());
+  EXPECT_FALSE(first.ComposeWith(&second).ok());
+}
+
+TEST(MorphismTest, ReportsMemoryUsage) {
+  LabeledGraph graph;
+  MakeFileGraph({"a", "b", "c"}, &graph);
+  Morphism morphism(&graph);
+  util::MemoryBreakdown usage = morphism.MemoryUsage();
+  EXPECT_EQ(0, usage["node_map"]);
+  EXPECT_EQ(0, usage.count("output/vertices"));
+  morphism.CopyInputType();
+  morphism.FindOrCopyNode(0);
+  usage = morphism.MemoryUsage();
+  EXPECT_LT(0, usage["node_map"]);
+  EXPECT_LT(0, usage["output/vertices"]);
+}
+
 }  // namespace
 }  // namespace graph
 }  // namespace morphie
@@ -0,0 +1,270 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A partition file consists of a 64-bit count of blocks followed by the
+// 32-bit entries of the partition. Every file is written under a temporary
+// name and renamed, so that a process that reads the directory never sees a
+// partially written result.
+#include "graph/result_cache.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#include "graph/graph_analyzer.h"
+#include "graph/graph_file.h"
+#include "util/memory_usage.h"
+#include "util/sketches.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+
+namespace {
+
+const char kPartitionKind = 'P';
+const char kGraphKind = 'G';
+const char kTemporarySuffix[] = ".tmp";
+
+const char kWriteFileErr[] = "Could not write the result file ";
+const char kRenameFileErr[] = "Could not rename the result file ";
+
+// Returns 'value' as 16 hexadecimal digits.
+string HexString(uint64_t value) {
+  char digits[17];
+  snprintf(digits, sizeof(digits), "%016" PRIx64, value);
+  return string(digits);
+}
+
+// Returns the id of the result of kind 'kind' with 'fingerprint' and 'key'.
+string ResultId(char kind, uint64_t fingerprint, const string& key) {
+  return util::StrCat(string(1, kind), HexString(fingerprint), key);
+}
+
+// Returns a hash of the entries of 'partition'.
+uint64_t PartitionHash(const std::vector<int>& partition) {
+  return util::SketchHash(
+      string(reinterpret_cast<const char*>(partition.data()),
+             partition.size() * sizeof(int)));
+}
+
+// Reads the partition in the file 'filename' into '*partition'. Returns false
+// if the file could not be read or does not contain a partition.
+bool ReadPartitionFile(const string& filename, std::vector<int>* partition) {
+  std::ifstream in_file(filename, std::ifstream::in | std::ifstream::binary);
+  uint64_t size;
+  if (!in_file.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+    return false;
+  }
+  std::vector<int> entries(size);
+  if (!in_file.read(reinterpret_cast<char*>(entries.data()),
+                    size * sizeof(int)) ||
+      in_file.peek() != std::ifstream::traits_type::eof()) {
+    return false;
+  }
+  partition->swap(entries);
+  return true;
+}
+
+// Moves the file 'temporary' to 'filename'.
+util::Status RenameFile(const string& temporary, const string& filename) {
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return util::Status(Code::EXTERNAL,
+                        util::StrCat(kRenameFileErr, filename));
+  }
+  return util::Status::OK;
+}
+
+util::Status WritePartitionFile(const std::vector<int>& partition,
+                                const string& filename) {
+  const string temporary = util::StrCat(filename, kTemporarySuffix);
+  std::ofstream out_file(temporary,
+                         std::ofstream::out | std::ofstream::binary);
+  const uint64_t size = partition.size();
+  out_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  out_file.write(reinterpret_cast<const char*>(partition.data()),
+                 size * sizeof(int));
+  out_file.close();
+  if (!out_file) {
+    std::remove(temporary.c_str());
+    return util::Status(Code::EXTERNAL, util::StrCat(kWriteFileErr, filename));
+  }
+  return RenameFile(temporary, filename);
+}
+
+}  // namespace
+
+ResultCache::ResultCache(size_t max_bytes, const string& directory)
+    : max_bytes_(max_bytes),
+      directory_(directory),
+      bytes_(0),
+      num_hits_(0),
+      num_misses_(0) {}
+
+bool ResultCache::FindPartition(uint64_t fingerprint, const string& key,
+                                std::vector<int>* partition) {
+  const string id = ResultId(kPartitionKind, fingerprint, key);
+  const Entry* entry = FindEntry(id);
+  if (entry != nullptr) {
+    ++num_hits_;
+    *partition = entry->partition;
+    return true;
+  }
+  Entry new_entry;
+  if (directory_.empty() ||
+      !ReadPartitionFile(Filename(id), &new_entry.partition)) {
+    ++num_misses_;
+    return false;
+  }
+  ++num_hits_;
+  *partition = new_entry.partition;
+  new_entry.id = id;
+  new_entry.bytes = util::VectorBytes(new_entry.partition);
+  AddEntry(std::move(new_entry));
+  return true;
+}
+
+util::Status ResultCache::InsertPartition(uint64_t fingerprint,
+                                          const string& key,
+                                          const std::vector<int>& partition) {
+  Entry entry;
+  entry.id = ResultId(kPartitionKind, fingerprint, key);
+  entry.partition = partition;
+  entry.bytes = util::VectorBytes(entry.partition);
+  const string filename = Filename(entry.id);
+  AddEntry(std::move(entry));
+  if (directory_.empty()) {
+    return util::Status::OK;
+  }
+  return WritePartitionFile(partition, filename);
+}
+
+std::shared_ptr<const LabeledGraph> ResultCache::FindGraph(
+    uint64_t fingerprint, const string& key) {
+  const string id = ResultId(kGraphKind, fingerprint, key);
+  const Entry* entry = FindEntry(id);
+  if (entry != nullptr) {
+    ++num_hits_;
+    return entry->graph;
+  }
+  if (directory_.empty()) {
+    ++num_misses_;
+    return nullptr;
+  }
+  std::unique_ptr<LabeledGraph> graph(new LabeledGraph);
+  if (!ReadGraphFile(Filename(id), graph.get()).ok()) {
+    ++num_misses_;
+    return nullptr;
+  }
+  ++num_hits_;
+  Entry new_entry;
+  new_entry.id = id;
+  new_entry.bytes = util::TotalBytes(graph->MemoryUsage());
+  new_entry.graph = std::move(graph);
+  std::shared_ptr<const LabeledGraph> found = new_entry.graph;
+  AddEntry(std::move(new_entry));
+  return found;
+}
+
+util::Status ResultCache::InsertGraph(
+    uint64_t fingerprint, const string& key,
+    std::shared_ptr<const LabeledGraph> graph) {
+  Entry entry;
+  entry.id = ResultId(kGraphKind, fingerprint, key);
+  entry.bytes = util::TotalBytes(graph->MemoryUsage());
+  entry.graph = graph;
+  const string filename = Filename(entry.id);
+  AddEntry(std::move(entry));
+  if (directory_.empty()) {
+    return util::Status::OK;
+  }
+  const string temporary = util::StrCat(filename, kTemporarySuffix);
+  util::Status status = WriteGraphFile(*graph, temporary);
+  if (!status.ok()) {
+    std::remove(temporary.c_str());
+    return status;
+  }
+  return RenameFile(temporary, filename);
+}
+
+const ResultCache::Entry* ResultCache::FindEntry(const string& id) {
+  auto position_it = positions_.find(id);
+  if (position_it == positions_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, position_it->second);
+  return &entries_.front();
+}
+
+// An entry that exceeds the bound by itself is evicted at once, so it is only
+// kept in the directory.
+void ResultCache::AddEntry(Entry entry) {
+  auto position_it = positions_.find(entry.id);
+  if (position_it != positions_.end()) {
+    bytes_ -= position_it->second->bytes;
+    entries_.erase(position_it->second);
+    positions_.erase(position_it);
+  }
+  bytes_ += entry.bytes;
+  entries_.push_front(std::move(entry));
+  positions_[entries_.front().id] = entries_.begin();
+  while (bytes_ > max_bytes_) {
+    bytes_ -= entries_.back().bytes;
+    positions_.erase(entries_.back().id);
+    entries_.pop_back();
+  }
+}
+
+string ResultCache::Filename(const string& id) const {
+  return util::StrCat(directory_, "/", HexString(util::SketchHash(id)),
+                      id[0] == kPartitionKind ? ".partition" : ".graph");
+}
+
+// The key of a refinement is the hash of the partition, so that a partition
+// of a large graph is not copied into the key.
+std::vector<int> CachedRefinePartition(const LabeledGraph& graph,
+                                       const std::vector<int>& partition,
+                                       ResultCache* cache) {
+  const uint64_t fingerprint = graph.Fingerprint();
+  const string key =
+      util::StrCat("RefinePartition/", HexString(PartitionHash(partition)));
+  std::vector<int> refinement;
+  if (cache->FindPartition(fingerprint, key, &refinement)) {
+    return refinement;
+  }
+  refinement = graph_analyzer::RefinePartition(graph, partition);
+  cache->InsertPartition(fingerprint, key, refinement);
+  return refinement;
+}
+
+std::shared_ptr<const LabeledGraph> CachedQuotientGraph(
+    const LabeledGraph& graph, const std::vector<int>& partition,
+    const graph::QuotientConfig& config, const string& config_key,
+    ResultCache* cache) {
+  const uint64_t fingerprint = graph.Fingerprint();
+  const string key =
+      util::StrCat("QuotientGraph/", HexString(PartitionHash(partition)), "/",
+                   config_key);
+  std::shared_ptr<const LabeledGraph> quotient =
+      cache->FindGraph(fingerprint, key);
+  if (quotient != nullptr) {
+    return quotient;
+  }
+  quotient = graph::QuotientGraph(graph, partition, config);
+  cache->InsertGraph(fingerprint, key, quotient);
+  return quotient;
+}
+
+}  // namespace morphie
@@ -0,0 +1,144 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A ResultCache keeps the results of analyses of graphs, such as refined
+// partitions and quotient graphs, so that an analysis that is repeated on an
+// unchanged graph, for example by a server that answers several queries about
+// one timeline, returns the earlier result instead of computing it again. A
+// result is identified by the fingerprint of the graph it was computed from,
+// as returned by LabeledGraph::Fingerprint(), and by a key that describes the
+// analysis and its parameters. Results are kept in memory up to a bound on
+// their estimated size, and the least recently used results are evicted first.
+// A cache with a directory also stores every result in a file in the
+// directory, so that results survive the process and evicted results can be
+// read again. A file is named by a 64-bit hash of the fingerprint and the key
+// of its result, and distinct results collide with a probability of about
+// n^2 / 2^65 for n results. Fingerprints are only stable across runs of one
+// build, so a directory should not be shared by different builds.
+//
+// Example.
+//   ResultCache cache(1 << 30, "/tmp/results");
+//   // Refines the partition once, and returns the stored refinement on later
+//   // calls until 'graph' changes.
+//   std::vector<int> refinement =
+//       CachedRefinePartition(graph, partition, &cache);
+//
+// A cache is not thread-safe.
+#ifndef LOGLE_GRAPH_RESULT_CACHE_H_
+#define LOGLE_GRAPH_RESULT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "base/string.h"
+#include "graph/graph_transformer.h"
+#include "graph/labeled_graph.h"
+#include "util/status.h"
+
+namespace morphie {
+
+class ResultCache {
+ public:
+  // Constructs a cache that keeps results with an estimated size of at most
+  // 'max_bytes' bytes in memory. Results are also stored in files in
+  // 'directory', which must exist, unless 'directory' is empty.
+  ResultCache(size_t max_bytes, const string& directory);
+  // Disallow copying and assignment.
+  ResultCache(const ResultCache&) = delete;
+  ResultCache& operator=(const ResultCache&) = delete;
+
+  // Set '*partition' to the partition stored with 'fingerprint' and 'key' and
+  // return true, or return false if no such partition is in memory or in the
+  // directory. A partition read from the directory is kept in memory.
+  bool FindPartition(uint64_t fingerprint, const string& key,
+                     std::vector<int>* partition);
+  // Stores 'partition' with 'fingerprint' and 'key', replacing a result with
+  // the same fingerprint and key. Returns EXTERNAL if the file of the result
+  // could not be written, in which case the partition is only kept in memory,
+  // and OK otherwise.
+  util::Status InsertPartition(uint64_t fingerprint, const string& key,
+                               const std::vector<int>& partition);
+  // Return the graph stored with 'fingerprint' and 'key', or null if there is
+  // none, and store a graph as above. Graphs are stored in graph files, as
+  // described in graph_file.h, and InsertGraph also returns INVALID_ARGUMENT
+  // if the graph has removed nodes that were not compacted.
+  std::shared_ptr<const LabeledGraph> FindGraph(uint64_t fingerprint,
+                                                const string& key);
+  util::Status InsertGraph(uint64_t fingerprint, const string& key,
+                           std::shared_ptr<const LabeledGraph> graph);
+
+  // The number of calls to a Find function that found a result, and that did
+  // not.
+  int64_t NumHits() const { return num_hits_; }
+  int64_t NumMisses() const { return num_misses_; }
+  // Returns the estimated number of bytes of the results in memory.
+  size_t MemoryUsage() const { return bytes_; }
+
+ private:
+  // A result in memory. The 'id' of a result consists of the kind of the
+  // result, its fingerprint and its key, and only one of 'partition' and
+  // 'graph' is used.
+  struct Entry {
+    string id;
+    std::vector<int> partition;
+    std::shared_ptr<const LabeledGraph> graph;
+    size_t bytes;
+  };
+
+  // Returns the entry with 'id' and makes it the most recently used, or
+  // returns null if there is no such entry.
+  const Entry* FindEntry(const string& id);
+  // Adds 'entry' as the most recently used entry, replacing an entry with the
+  // same id, and evicts the least recently used entries while the entries
+  // exceed the bound.
+  void AddEntry(Entry entry);
+  // Returns the name of the file of the result with 'id'.
+  string Filename(const string& id) const;
+
+  const size_t max_bytes_;
+  const string directory_;
+  // The entries in order from the most to the least recently used, and the
+  // position of each entry by id.
+  std::list<Entry> entries_;
+  std::unordered_map<string, std::list<Entry>::iterator> positions_;
+  size_t bytes_;
+  int64_t num_hits_;
+  int64_t num_misses_;
+};
+
+// Returns graph_analyzer::RefinePartition(graph, partition), which is computed
+// once for each fingerprint of 'graph' and each partition and then read from
+// 'cache'. A refinement that cannot be stored in the directory of the cache is
+// still returned.
+std::vector<int> CachedRefinePartition(const LabeledGraph& graph,
+                                       const std::vector<int>& partition,
+                                       ResultCache* cache);
+
+// Returns graph::QuotientGraph(graph, partition, config), which is computed
+// once for each fingerprint of 'graph', partition and 'config_key' and then
+// read from 'cache'. A QuotientConfig holds label functions, which cannot be
+// compared, so 'config_key' names the configuration, and calls with the same
+// key must use configurations that construct the same quotient.
+std::shared_ptr<const LabeledGraph> CachedQuotientGraph(
+    const LabeledGraph& graph, const std::vector<int>& partition,
+    const graph::QuotientConfig& config, const string& config_key,
+    ResultCache* cache);
+
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_RESULT_CACHE_H_
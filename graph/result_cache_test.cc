@@ -0,0 +1,153 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/result_cache.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "graph/graph_analyzer.h"
+#include "graph/test_graphs.h"
+#include "gtest.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+namespace {
+
+// Returns the name of a new temporary directory.
+string GetTempDirectory() {
+  char directory[] = "/tmp/result_cache_test_XXXXXX";
+  EXPECT_TRUE(mkdtemp(directory) != nullptr);
+  return directory;
+}
+
+// Removes the directory 'directory' and the files in it.
+void RemoveDirectory(const string& directory) {
+  DIR* dir = opendir(directory.c_str());
+  ASSERT_TRUE(dir != nullptr);
+  while (struct dirent* entry = readdir(dir)) {
+    const string name = entry->d_name;
+    if (name != "." && name != "..") {
+      unlink(util::StrCat(directory, "/", name).c_str());
+    }
+  }
+  closedir(dir);
+  rmdir(directory.c_str());
+}
+
+// Returns a configuration in which a block and a bundle of edges have the
+// label of their first node or edge.
+graph::QuotientConfig FirstLabelConfig(const LabeledGraph& graph_type) {
+  return graph::QuotientConfig(
+      graph_type,
+      [](const LabeledGraph& graph, util::Span<NodeId> nodes) {
+        return graph.GetNodeLabel(nodes[0]);
+      },
+      [](const LabeledGraph& graph, util::Span<EdgeId> edges) {
+        return std::vector<TaggedAST>({graph.GetEdgeLabel(edges[0])});
+      },
+      false /*No self-edges*/);
+}
+
+// A refinement is computed once for a graph and a partition, and again once
+// the graph changes.
+TEST(ResultCacheTest, ReturnsStoredRefinements) {
+  test::WeightedGraph path;
+  test::GetPathGraph(6, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  const std::vector<int> partition(graph.NumNodes(), 0);
+  const std::vector<int> expected =
+      graph_analyzer::RefinePartition(graph, partition);
+  ResultCache cache(1 << 20, "");
+  EXPECT_EQ(expected, CachedRefinePartition(graph, partition, &cache));
+  EXPECT_EQ(expected, CachedRefinePartition(graph, partition, &cache));
+  EXPECT_EQ(1, cache.NumHits());
+  EXPECT_EQ(1, cache.NumMisses());
+  const std::vector<int> other_partition = {0, 0, 0, 1, 1, 1};
+  CachedRefinePartition(graph, other_partition, &cache);
+  EXPECT_EQ(2, cache.NumMisses());
+
+  path.AddEdge(5, 0, 5);
+  const std::vector<int> cycle_partition =
+      CachedRefinePartition(graph, partition, &cache);
+  EXPECT_EQ(3, cache.NumMisses());
+  EXPECT_EQ(graph_analyzer::RefinePartition(graph, partition),
+            cycle_partition);
+  EXPECT_NE(expected, cycle_partition);
+}
+
+// The least recently used results are evicted from memory first.
+TEST(ResultCacheTest, EvictsLeastRecentlyUsedResults) {
+  const std::vector<int> partition = {0, 1, 2, 3};
+  ResultCache cache(2 * partition.size() * sizeof(int), "");
+  ASSERT_TRUE(cache.InsertPartition(1, "a", partition).ok());
+  ASSERT_TRUE(cache.InsertPartition(1, "b", partition).ok());
+  std::vector<int> found;
+  EXPECT_TRUE(cache.FindPartition(1, "a", &found));
+  EXPECT_EQ(partition, found);
+  ASSERT_TRUE(cache.InsertPartition(2, "a", partition).ok());
+  EXPECT_TRUE(cache.FindPartition(1, "a", &found));
+  EXPECT_FALSE(cache.FindPartition(1, "b", &found));
+  EXPECT_TRUE(cache.FindPartition(2, "a", &found));
+  EXPECT_EQ(2 * partition.size() * sizeof(int), cache.MemoryUsage());
+
+  ResultCache empty_cache(0, "");
+  ASSERT_TRUE(empty_cache.InsertPartition(1, "a", partition).ok());
+  EXPECT_FALSE(empty_cache.FindPartition(1, "a", &found));
+  EXPECT_EQ(0, empty_cache.MemoryUsage());
+}
+
+// Results stored in a directory are found by another cache, and results that
+// do not fit in memory are read from the directory.
+TEST(ResultCacheTest, PersistsResultsInDirectory) {
+  test::WeightedGraph cycle;
+  test::GetCycleGraph(6, &cycle);
+  const LabeledGraph& graph = *cycle.GetGraph();
+  const std::vector<int> partition = {4, 4, 0, 0, 4, 7};
+  graph::QuotientConfig config = FirstLabelConfig(graph);
+  const string directory = GetTempDirectory();
+  ResultCache cache(0, directory);
+  std::shared_ptr<const LabeledGraph> quotient =
+      CachedQuotientGraph(graph, partition, config, "first", &cache);
+  ASSERT_TRUE(quotient != nullptr);
+  EXPECT_EQ(3, quotient->NumNodes());
+  EXPECT_EQ(4, quotient->NumEdges());
+  const std::vector<int> refinement =
+      CachedRefinePartition(graph, partition, &cache);
+  EXPECT_EQ(2, cache.NumMisses());
+  EXPECT_TRUE(CachedQuotientGraph(graph, partition, config, "first", &cache) !=
+              nullptr);
+  EXPECT_EQ(1, cache.NumHits());
+
+  ResultCache other_cache(1 << 20, directory);
+  std::shared_ptr<const LabeledGraph> stored =
+      other_cache.FindGraph(graph.Fingerprint(), "missing");
+  EXPECT_TRUE(stored == nullptr);
+  stored = CachedQuotientGraph(graph, partition, config, "first", &other_cache);
+  ASSERT_TRUE(stored != nullptr);
+  EXPECT_EQ(quotient->Fingerprint(), stored->Fingerprint());
+  EXPECT_EQ(refinement,
+            CachedRefinePartition(graph, partition, &other_cache));
+  EXPECT_EQ(2, other_cache.NumHits());
+  EXPECT_EQ(1, other_cache.NumMisses());
+  EXPECT_LT(0, other_cache.MemoryUsage());
+  RemoveDirectory(directory);
+}
+
+}  // namespace
+}  // namespace morphie
@@ -0,0 +1,327 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A schema declares the label types of a graph as C++ types. The types of
+// labels are usually constructed at run time with the functions in
+// graph/type.h, and every label is constructed with the functions in
+// graph/value.h and type checked when it is added to a graph. A schema derives
+// both the type ASTs and a builder for each label from a single declaration,
+// so the builders construct values that are typed by construction and can be
+// added to a graph without a type check.
+//
+// A field of a label has a name, a kind and a flag that determines if the
+// field may be null. The name of a field is a character array with static
+// storage duration, and the kinds are Null, Bool, Int, String, Timestamp,
+// List<Field> and Tuple<Field...>. A label declares a tag, the field that is
+// the type of labels with that tag, and whether labels with that tag are
+// unique.
+//
+// Example. The Plaso event label
+//   tuple(Time : timestamp?, Description : string?)
+// and the unique null Uses label are declared and used as follows.
+//   const char kEventTag[] = "Event";
+//   const char kTimeTag[] = "Time";
+//   const char kDescTag[] = "Description";
+//   const char kUsesTag[] = "Uses";
+//
+//   using EventLabel = schema::Label<
+//       kEventTag,
+//       schema::Field<kEventTag,
+//                     schema::Tuple<schema::Field<kTimeTag, schema::Timestamp,
+//                                                 true /*May be null*/>,
+//                                   schema::Field<kDescTag, schema::String,
+//                                                 true /*May be null*/>>>>;
+//   using UsesLabel =
+//       schema::Label<kUsesTag, schema::Field<kUsesTag, schema::Null>,
+//                     true /*Is unique*/>;
+//   using NodeLabels = schema::LabelSet<EventLabel>;
+//   using EdgeLabels = schema::LabelSet<UsesLabel>;
+//
+//   graph.Initialize(NodeLabels::Types(), NodeLabels::UniqueTags(),
+//                    EdgeLabels::Types(), EdgeLabels::UniqueTags(),
+//                    graph_type);
+//   TaggedAST event = EventLabel::Make(
+//       EventLabel::Value(int64_t{1449000000000000}, string("login")));
+//   NodeId event_id = graph.FindOrAddTypedNode(std::move(event));
+//
+// The value of a field that may be null is a boost::optional, and an empty
+// optional is the null value. The value of a list is a vector of the values of
+// its elements and the value of a tuple is a std::tuple of the values of its
+// fields. Sets and intervals are not supported because their values are not
+// typed by construction: the elements of a set must be distinct and the bounds
+// of an interval must be ordered.
+#ifndef LOGLE_SCHEMA_H_
+#define LOGLE_SCHEMA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "base/string.h"
+#include "graph/type.h"
+#include "graph/type_checker.h"
+#include "util/logging.h"
+#include "ast.pb.h"
+
+namespace morphie {
+namespace schema {
+
+// The kinds of fields and the C++ types of their values. A timestamp value is
+// the number of microseconds since the Unix epoch.
+struct Null {
+  using Value = std::nullptr_t;
+};
+struct Bool {
+  using Value = bool;
+};
+struct Int {
+  using Value = int;
+};
+struct String {
+  using Value = string;
+};
+struct Timestamp {
+  using Value = int64_t;
+};
+// A list whose elements are values of the field 'Element'.
+template <typename Element>
+struct List {
+  using Value = std::vector<typename Element::Value>;
+};
+// A tuple with one element for each of the fields 'Fields'.
+template <typename... Fields>
+struct Tuple {
+  static_assert(sizeof...(Fields) > 0, "A tuple must have a field.");
+  using Value = std::tuple<typename Fields::Value...>;
+};
+
+namespace internal {
+
+const char kEmptyListErr[] = "A list that may not be null must not be empty.";
+
+// KindTraits<Kind> constructs the type AST of a field of kind 'Kind' and the
+// value ASTs of such a field. The Build functions require that 'ast' points to
+// an empty AST, and move strings out of 'value'.
+template <typename Kind>
+struct KindTraits;
+
+template <PrimitiveType kType>
+struct PrimitiveTraits {
+  static AST Type(const string& name, bool is_nullable) {
+    return ast::type::MakePrimitive(name, is_nullable, kType);
+  }
+  static void BuildNull(AST* ast) { ast->mutable_p_ast()->set_type(kType); }
+};
+
+template <>
+struct KindTraits<Null> {
+  static AST Type(const string& name, bool is_nullable) {
+    return ast::type::MakeNull(name);
+  }
+  static void Build(std::nullptr_t value, bool is_nullable, AST* ast) {}
+};
+
+template <>
+struct KindTraits<Bool> : PrimitiveTraits<PrimitiveType::BOOL> {
+  static void Build(bool value, bool is_nullable, AST* ast) {
+    BuildNull(ast);
+    ast->mutable_p_ast()->mutable_val()->set_bool_val(value);
+  }
+};
+
+template <>
+struct KindTraits<Int> : PrimitiveTraits<PrimitiveType::INT> {
+  static void Build(int value, bool is_nullable, AST* ast) {
+    BuildNull(ast);
+    ast->mutable_p_ast()->mutable_val()->set_int_val(value);
+  }
+};
+
+template <>
+struct KindTraits<String> : PrimitiveTraits<PrimitiveType::STRING> {
+  static void Build(string&& value, bool is_nullable, AST* ast) {
+    BuildNull(ast);
+    ast->mutable_p_ast()->mutable_val()->set_string_val(std::move(value));
+  }
+};
+
+template <>
+struct KindTraits<Timestamp> : PrimitiveTraits<PrimitiveType::TIMESTAMP> {
+  static void Build(int64_t value, bool is_nullable, AST* ast) {
+    BuildNull(ast);
+    ast->mutable_p_ast()->mutable_val()->set_time_val(value);
+  }
+};
+
+// An empty list is the null list, so a list that may not be null must have an
+// element.
+template <typename Element>
+struct KindTraits<List<Element>> {
+  static AST Type(const string& name, bool is_nullable) {
+    return ast::type::MakeList(name, is_nullable, Element::Type());
+  }
+  static void BuildNull(AST* ast) {
+    ast->mutable_c_ast()->set_op(Operator::LIST);
+  }
+  static void Build(typename List<Element>::Value&& value, bool is_nullable,
+                    AST* ast) {
+    CHECK(is_nullable || !value.empty(), kEmptyListErr);
+    BuildNull(ast);
+    for (auto& element : value) {
+      Element::Build(std::move(element), ast->mutable_c_ast()->add_arg());
+    }
+  }
+};
+
+// TupleFields<I, Fields...> builds the fields from position I on of a tuple
+// whose remaining fields are 'Fields'.
+template <size_t I, typename... Fields>
+struct TupleFields {
+  template <typename Value>
+  static void Build(Value* value, CompositeAST* c_ast) {}
+};
+
+template <size_t I, typename Field, typename... Fields>
+struct TupleFields<I, Field, Fields...> {
+  template <typename Value>
+  static void Build(Value* value, CompositeAST* c_ast) {
+    Field::Build(std::move(std::get<I>(*value)), c_ast->add_arg());
+    TupleFields<I + 1, Fields...>::Build(value, c_ast);
+  }
+};
+
+template <typename... Fields>
+struct KindTraits<Tuple<Fields...>> {
+  static AST Type(const string& name, bool is_nullable) {
+    return ast::type::MakeTuple(name, is_nullable, {Fields::Type()...});
+  }
+  static void BuildNull(AST* ast) {
+    ast->mutable_c_ast()->set_op(Operator::TUPLE);
+  }
+  static void Build(typename Tuple<Fields...>::Value&& value, bool is_nullable,
+                    AST* ast) {
+    BuildNull(ast);
+    TupleFields<0, Fields...>::Build(&value, ast->mutable_c_ast());
+  }
+};
+
+// FieldBuilder wraps the value of a field that may be null in an optional.
+template <typename Kind, bool kIsNullable>
+struct FieldBuilder {
+  using Value = typename Kind::Value;
+  static void Build(Value&& value, AST* ast) {
+    KindTraits<Kind>::Build(std::move(value), false, ast);
+  }
+};
+
+template <typename Kind>
+struct FieldBuilder<Kind, true> {
+  using Value = boost::optional<typename Kind::Value>;
+  static void Build(Value&& value, AST* ast) {
+    if (value) {
+      KindTraits<Kind>::Build(std::move(*value), true, ast);
+    } else {
+      KindTraits<Kind>::BuildNull(ast);
+    }
+  }
+};
+
+// Inserts the tag of 'Label' into 'tags' if it is a unique label. The return
+// value allows calls to be expanded in an initializer list.
+template <typename Label>
+int InsertIfUnique(std::set<string>* tags) {
+  if (Label::IsUnique()) {
+    tags->insert(Label::Tag());
+  }
+  return 0;
+}
+
+}  // namespace internal
+
+// A field named 'kName' of kind 'Kind', which may be null if 'kIsNullable' is
+// true. A Null field has only one value and is never nullable.
+template <const char* kName, typename Kind, bool kIsNullable = false>
+struct Field {
+  static_assert(!(kIsNullable && std::is_same<Kind, Null>::value),
+                "A null field cannot be nullable.");
+  using Value = typename internal::FieldBuilder<Kind, kIsNullable>::Value;
+
+  // Returns the type AST of the field.
+  static AST Type() {
+    return internal::KindTraits<Kind>::Type(kName, kIsNullable);
+  }
+  // Stores 'value' in the empty AST '*ast'.
+  // - Crashes if a list that may not be null is empty.
+  static void Build(Value value, AST* ast) {
+    internal::FieldBuilder<Kind, kIsNullable>::Build(std::move(value), ast);
+  }
+};
+
+// The labels tagged 'kTag' have the type of the field 'LabelField', and are
+// unique if 'kIsUnique' is true.
+template <const char* kTag, typename LabelField, bool kIsUnique = false>
+struct Label {
+  using Value = typename LabelField::Value;
+
+  static const char* Tag() { return kTag; }
+  static bool IsUnique() { return kIsUnique; }
+  static AST Type() { return LabelField::Type(); }
+
+  // Replaces the contents of '*label' by the label with value 'value'. The
+  // label can be constructed on an arena by passing a label allocated on it.
+  // The strings in 'value' are moved into the label, so a value that is moved
+  // into this function is not copied.
+  static void Build(Value value, TaggedAST* label) {
+    label->Clear();
+    label->set_tag(kTag);
+    LabelField::Build(std::move(value), label->mutable_ast());
+  }
+  // Returns the label with value 'value'.
+  static TaggedAST Make(Value value) {
+    TaggedAST label;
+    Build(std::move(value), &label);
+    return label;
+  }
+};
+
+// The node or edge labels of a graph.
+template <typename... Labels>
+struct LabelSet {
+  // Returns the map from tags to types that LabeledGraph::Initialize takes.
+  static ast::type::Types Types() {
+    ast::type::Types types;
+    // Expands to one emplace call per label, in order.
+    int expand[] = {0, (types.emplace(Labels::Tag(), Labels::Type()), 0)...};
+    static_cast<void>(expand);
+    return types;
+  }
+  // Returns the tags of the unique labels.
+  static std::set<string> UniqueTags() {
+    std::set<string> tags;
+    int expand[] = {0, internal::InsertIfUnique<Labels>(&tags)...};
+    static_cast<void>(expand);
+    return tags;
+  }
+};
+
+}  // namespace schema
+}  // namespace morphie
+
+#endif  // LOGLE_SCHEMA_H_
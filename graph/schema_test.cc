@@ -0,0 +1,128 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/schema.h"
+
+#include <set>
+#include <vector>
+
+#include "graph/ast.h"
+#include "graph/type.h"
+#include "graph/type_checker.h"
+#include "graph/value.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace schema {
+namespace {
+
+const char kEventTag[] = "Event";
+const char kDescTag[] = "Description";
+const char kCountTag[] = "Count";
+const char kFlagTag[] = "Flag";
+const char kNamesTag[] = "Names";
+const char kNameTag[] = "Name";
+const char kUsesTag[] = "Uses";
+
+using EventLabel = Label<
+    kEventTag,
+    Field<kEventTag, Tuple<Field<ast::kTimeTag, Timestamp, true>,
+                           Field<kDescTag, String, true>>>>;
+using FileLabel = Label<
+    ast::kFileTag,
+    Field<ast::kFileTag,
+          Tuple<Field<ast::kDirectory,
+                      List<Field<ast::kFilePathPart, String>>, true>,
+                Field<ast::kFilename, String, true>>,
+          true>,
+    true>;
+using CountLabel = Label<kCountTag, Field<kCountTag, Int>>;
+using FlagLabel = Label<kFlagTag, Field<kFlagTag, Bool, true>>;
+using NamesLabel =
+    Label<kNamesTag, Field<kNamesTag, List<Field<kNameTag, String>>>>;
+using UsesLabel = Label<kUsesTag, Field<kUsesTag, Null>, true>;
+using Labels =
+    LabelSet<EventLabel, FileLabel, CountLabel, FlagLabel, NamesLabel,
+             UsesLabel>;
+
+// Expects 'label' to be typed by the types of 'Labels'.
+void ExpectTyped(const TaggedAST& label) {
+  string err;
+  EXPECT_TRUE(ast::type::IsTyped(Labels::Types(), label, &err)) << err;
+}
+
+// The types of a schema are the types constructed by the functions in
+// graph/type.h.
+TEST(SchemaTest, DeclaresTypes) {
+  ast::type::Types types = Labels::Types();
+  ASSERT_EQ(6, types.size());
+  std::vector<AST> args;
+  args.emplace_back(ast::type::MakeTimestamp(ast::kTimeTag, true));
+  args.emplace_back(ast::type::MakeString(kDescTag, true));
+  EXPECT_TRUE(ast::Equal(ast::type::MakeTuple(kEventTag, false, args),
+                         types[kEventTag]));
+  EXPECT_TRUE(ast::Equal(ast::type::MakeFile(), types[ast::kFileTag]));
+  EXPECT_TRUE(ast::Equal(ast::type::MakeInt(kCountTag, false),
+                         types[kCountTag]));
+  EXPECT_TRUE(ast::Equal(ast::type::MakeBool(kFlagTag, true),
+                         types[kFlagTag]));
+  EXPECT_TRUE(ast::Equal(ast::type::MakeNull(kUsesTag), types[kUsesTag]));
+  string err;
+  EXPECT_TRUE(ast::type::AreTypes(types, &err)) << err;
+  EXPECT_EQ(std::set<string>({ast::kFileTag, kUsesTag}), Labels::UniqueTags());
+}
+
+// Every label constructed by a schema has the type declared for its tag,
+// including labels with null fields.
+TEST(SchemaTest, BuildsTypedLabels) {
+  TaggedAST event = EventLabel::Make(EventLabel::Value(5, string("login")));
+  ExpectTyped(event);
+  EXPECT_EQ(kEventTag, event.tag());
+  EXPECT_EQ(5, ast::value::GetTimestamp(event.ast().c_ast().arg(0)));
+  EXPECT_EQ("login", ast::value::GetString(event.ast().c_ast().arg(1)));
+  ExpectTyped(EventLabel::Make(EventLabel::Value(boost::none, boost::none)));
+
+  std::vector<string> path = {"usr", "local"};
+  TaggedAST file = FileLabel::Make(FileLabel::Value(
+      std::make_tuple(path, boost::optional<string>("a.txt"))));
+  ExpectTyped(file);
+  EXPECT_EQ(2, ast::value::Size(file.ast().c_ast().arg(0)));
+  ExpectTyped(FileLabel::Make(FileLabel::Value(
+      std::make_tuple(std::vector<string>(), boost::optional<string>()))));
+  ExpectTyped(FileLabel::Make(boost::none));
+
+  ExpectTyped(CountLabel::Make(3));
+  ExpectTyped(FlagLabel::Make(true));
+  ExpectTyped(FlagLabel::Make(boost::none));
+  ExpectTyped(NamesLabel::Make({"a", "b"}));
+  TaggedAST uses = UsesLabel::Make(nullptr);
+  ExpectTyped(uses);
+  EXPECT_TRUE(ast::IsNull(uses.ast()));
+}
+
+// Building a label replaces the contents of the label.
+TEST(SchemaTest, BuildReplacesLabel) {
+  TaggedAST label = CountLabel::Make(1);
+  CountLabel::Build(2, &label);
+  EXPECT_TRUE(ast::Equal(CountLabel::Make(2), label));
+}
+
+TEST(SchemaDeathTest, RequiresNonEmptyListsThatMayNotBeNull) {
+  EXPECT_DEATH({ NamesLabel::Make({}); },
+               "A list that may not be null must not be empty.");
+}
+
+}  // namespace
+}  // namespace schema
+}  // namespace morphie
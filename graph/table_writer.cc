@@ -0,0 +1,186 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Rows are appended to a buffer that is written to the stream when it exceeds
+// kBufferSize bytes, so that a table is written with few stream operations and
+// without a string per field.
+#include "graph/table_writer.h"
+
+#include <vector>
+
+#include "graph/ast.h"
+#include "util/logging.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+
+namespace {
+
+const char kUndeclaredTagErr[] = "The tag has no node type: ";
+
+const size_t kBufferSize = 1 << 16;
+
+// Appends 'field' to 'line', enclosed in double quotes if it contains a
+// character that separates fields or lines.
+void AppendField(util::StringPiece field, string* line) {
+  bool needs_quotes = false;
+  for (char c : field) {
+    if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+      needs_quotes = true;
+      break;
+    }
+  }
+  if (!needs_quotes) {
+    line->append(field.data(), field.size());
+    return;
+  }
+  line->push_back('"');
+  for (char c : field) {
+    if (c == '"') {
+      line->push_back('"');
+    }
+    line->push_back(c);
+  }
+  line->push_back('"');
+}
+
+void AppendValue(const AST& value, string* line) {
+  if (value.has_c_ast()) {
+    AppendField(ast::ToString(value, ast::PrintConfig()), line);
+    return;
+  }
+  if (!value.has_p_ast() || !value.p_ast().has_val()) {
+    return;
+  }
+  const PrimitiveValue& val = value.p_ast().val();
+  switch (val.val_case()) {
+    case PrimitiveValue::kBoolVal:
+      line->append(val.bool_val() ? "true" : "false");
+      break;
+    case PrimitiveValue::kIntVal:
+      util::StrAppend(line, val.int_val());
+      break;
+    case PrimitiveValue::kStringVal:
+      AppendField(val.string_val(), line);
+      break;
+    case PrimitiveValue::kTimeVal:
+      util::StrAppend(line, val.time_val());
+      break;
+    default:
+      break;
+  }
+}
+
+// Writes 'buffer' to 'out' and clears it if it is larger than kBufferSize, or
+// if 'flush' is true.
+void WriteBuffer(bool flush, string* buffer, std::ostream* out) {
+  if (flush || buffer->size() > kBufferSize) {
+    out->write(buffer->data(), buffer->size());
+    buffer->clear();
+  }
+}
+
+}  // namespace
+
+void WriteNodeTable(const LabeledGraph& graph, const string& tag,
+                    std::ostream* out) {
+  const TypeId type_id = graph.GetNodeTypeId(tag);
+  CHECK(type_id != kNoType, util::StrCat(kUndeclaredTagErr, tag));
+  const AST& type = graph.GetNodeTypeById(type_id);
+  const bool is_tuple = ast::IsTuple(type);
+  const int num_fields = is_tuple ? type.c_ast().arg_size() : 1;
+  // The column of each field, or null if the field has no column.
+  std::vector<const NodeColumn*> columns(num_fields, nullptr);
+  for (int i = 0; i < graph.NumNodeColumns(); ++i) {
+    const NodeColumn& column = graph.GetNodeColumn(i);
+    if (column.tag != tag) {
+      continue;
+    }
+    if (!is_tuple && column.field.empty()) {
+      columns[0] = &column;
+    } else if (is_tuple && column.field.size() == 1) {
+      columns[column.field[0]] = &column;
+    }
+  }
+  string buffer = "id";
+  for (int i = 0; i < num_fields; ++i) {
+    buffer.push_back(',');
+    AppendField(is_tuple ? type.c_ast().arg(i).name() : type.name(), &buffer);
+  }
+  buffer.push_back('\n');
+  const NodeId num_node_ids = graph.NumNodeIds();
+  for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+    if (!graph.HasNode(node_id)) {
+      continue;
+    }
+    const TaggedAST& label = graph.GetNodeLabel(node_id);
+    if (label.tag() != tag) {
+      continue;
+    }
+    util::StrAppend(&buffer, node_id);
+    for (int i = 0; i < num_fields; ++i) {
+      buffer.push_back(',');
+      if (columns[i] != nullptr) {
+        if (columns[i]->IsValid(node_id)) {
+          util::StrAppend(&buffer, columns[i]->values[node_id]);
+        }
+      } else if (!is_tuple) {
+        AppendValue(label.ast(), &buffer);
+      } else if (label.ast().c_ast().arg_size() > i) {
+        AppendValue(label.ast().c_ast().arg(i), &buffer);
+      }
+    }
+    buffer.push_back('\n');
+    WriteBuffer(false, &buffer, out);
+  }
+  WriteBuffer(true, &buffer, out);
+}
+
+void WriteLabelTable(const LabeledGraph& graph,
+                     const std::set<string>& excluded_tags,
+                     std::ostream* out) {
+  string buffer = "id,tag,value\n";
+  const NodeId num_node_ids = graph.NumNodeIds();
+  for (NodeId node_id = 0; node_id < num_node_ids; ++node_id) {
+    if (!graph.HasNode(node_id)) {
+      continue;
+    }
+    const TaggedAST& label = graph.GetNodeLabel(node_id);
+    if (excluded_tags.count(label.tag()) > 0) {
+      continue;
+    }
+    util::StrAppend(&buffer, node_id, ",");
+    AppendField(label.tag(), &buffer);
+    buffer.push_back(',');
+    AppendValue(label.ast(), &buffer);
+    buffer.push_back('\n');
+    WriteBuffer(false, &buffer, out);
+  }
+  WriteBuffer(true, &buffer, out);
+}
+
+void WriteEdgeTable(const LabeledGraph& graph, std::ostream* out) {
+  string buffer = "source,target,tag\n";
+  for (auto edge_it = graph.EdgeSetBegin(); edge_it != graph.EdgeSetEnd();
+       ++edge_it) {
+    util::StrAppend(&buffer, graph.Source(*edge_it), ",",
+                    graph.Target(*edge_it), ",");
+    AppendField(graph.GetEdgeLabel(*edge_it).tag(), &buffer);
+    buffer.push_back('\n');
+    WriteBuffer(false, &buffer, out);
+  }
+  WriteBuffer(true, &buffer, out);
+}
+
+}  // namespace morphie
@@ -0,0 +1,67 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// The functions in this file write the nodes and edges of a graph as tables
+// that analytics engines load directly, instead of parsing the DOT or protobuf
+// representations meant for visualization. A table is written in the CSV
+// format of RFC 4180: a header line with the names of the columns, followed by
+// one line per node or edge with comma-separated fields. Fields that contain a
+// comma, a double quote or a line break are enclosed in double quotes, in
+// which a double quote is written twice.
+//
+// The fields of a label are written as follows.
+// - Booleans as "true" or "false", integers in decimal and timestamps as the
+//   number of microseconds since the Unix epoch in decimal.
+// - Strings as they are.
+// - Lists, sets and tuples as by ast::ToString with PrintOption::kValue.
+// - Null values as empty fields.
+//
+// Example.
+//   std::ofstream events("events.csv");
+//   WriteNodeTable(graph, "Event", &events);
+//   std::ofstream edges("edges.csv");
+//   WriteEdgeTable(graph, &edges);
+#ifndef LOGLE_GRAPH_TABLE_WRITER_H_
+#define LOGLE_GRAPH_TABLE_WRITER_H_
+
+#include <ostream>
+#include <set>
+
+#include "base/string.h"
+#include "graph/labeled_graph.h"
+
+namespace morphie {
+
+// Writes the nodes of 'graph' whose labels are tagged 'tag' to 'out' as a
+// table. The table has the column "id", with the node id, followed by one
+// column for each argument of a tuple type, named by the name of the argument,
+// or one column named by the name of any other type. The values of an integer
+// or timestamp field that has a node column in 'graph' (see
+// LabeledGraph::AddNodeColumn) are read from the column instead of the labels.
+// Nodes are written in the order of their ids.
+// - Crashes if 'tag' is not the tag of a node type of 'graph'.
+void WriteNodeTable(const LabeledGraph& graph, const string& tag,
+                    std::ostream* out);
+// Writes the nodes of 'graph' whose tags are not in 'excluded_tags' to 'out'
+// as a table with the columns "id", "tag" and "value", in the order of their
+// ids. The value is the AST of the label written as a single field.
+void WriteLabelTable(const LabeledGraph& graph,
+                     const std::set<string>& excluded_tags, std::ostream* out);
+// Writes the edges of 'graph' to 'out' as a table with the columns "source",
+// "target" and "tag", in the order of EdgeSetBegin().
+void WriteEdgeTable(const LabeledGraph& graph, std::ostream* out);
+
+}  // namespace morphie
+
+#endif  // LOGLE_GRAPH_TABLE_WRITER_H_
@@ -0,0 +1,133 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/table_writer.h"
+
+#include <set>
+#include <sstream>
+
+#include "base/string.h"
+#include "graph/type.h"
+#include "graph/value.h"
+#include "gtest.h"
+#include "ast.pb.h"
+
+namespace morphie {
+namespace {
+
+namespace type = ast::type;
+namespace value = ast::value;
+
+// An Event is a tuple of a timestamp and a nullable description, a File is a
+// string and an edge is a string.
+class TableWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    event_type_ = type::MakeTuple(
+        "Event", false, {type::MakeTimestamp("Time", false),
+                         type::MakeString("Description", true)});
+    type::Types node_types;
+    node_types.insert({"Event", event_type_});
+    node_types.insert({"File", type::MakeString("Filename", false)});
+    type::Types edge_types;
+    edge_types.insert({"Uses", type::MakeString("Info", false)});
+    ASSERT_TRUE(graph_
+                    .Initialize(node_types, {"File"}, edge_types,
+                                std::set<string>(),
+                                type::MakeString("System", false))
+                    .ok());
+  }
+
+  TaggedAST EventLabel(int64_t time, const AST& description) {
+    TaggedAST label;
+    label.set_tag("Event");
+    AST* tuple = label.mutable_ast();
+    *tuple = value::MakeNullTuple(2);
+    value::SetField(event_type_, 0, value::MakeTimestampFromUnixMicros(time),
+                    tuple);
+    value::SetField(event_type_, 1, description, tuple);
+    return label;
+  }
+
+  TaggedAST StringLabel(const string& tag, const string& val) {
+    TaggedAST label;
+    label.set_tag(tag);
+    *label.mutable_ast() = value::MakeString(val);
+    return label;
+  }
+
+  AST event_type_;
+  LabeledGraph graph_;
+};
+
+TEST_F(TableWriterTest, WritesNodeTable) {
+  graph_.FindOrAddNode(EventLabel(5, value::MakeString("Opened a file")));
+  graph_.FindOrAddNode(StringLabel("File", "/tmp/a"));
+  graph_.FindOrAddNode(
+      EventLabel(7, value::MakeString("Read \"a\", then b\nand c")));
+  graph_.FindOrAddNode(
+      EventLabel(9, value::MakePrimitiveNull(PrimitiveType::STRING)));
+  std::ostringstream out;
+  WriteNodeTable(graph_, "Event", &out);
+  EXPECT_EQ(
+      "id,Time,Description\n"
+      "0,5,Opened a file\n"
+      "2,7,\"Read \"\"a\"\", then b\nand c\"\n"
+      "3,9,\n",
+      out.str());
+}
+
+// Fields with a node column are read from the column, and removed nodes are
+// not written.
+TEST_F(TableWriterTest, WritesNodeTableFromColumns) {
+  graph_.FindOrAddNode(EventLabel(5, value::MakeString("a")));
+  NodeId node_id = graph_.FindOrAddNode(EventLabel(7, value::MakeString("b")));
+  graph_.FindOrAddNode(EventLabel(9, value::MakeString("c")));
+  graph_.AddNodeColumn("Event", {0});
+  graph_.RemoveNodes({node_id});
+  std::ostringstream out;
+  WriteNodeTable(graph_, "Event", &out);
+  EXPECT_EQ("id,Time,Description\n0,5,a\n2,9,c\n", out.str());
+}
+
+TEST_F(TableWriterTest, WritesLabelAndEdgeTables) {
+  NodeId event_id = graph_.FindOrAddNode(EventLabel(5, value::MakeString("")));
+  NodeId file1_id = graph_.FindOrAddNode(StringLabel("File", "/tmp/a,b"));
+  NodeId file2_id = graph_.FindOrAddNode(StringLabel("File", "/tmp/c"));
+  graph_.FindOrAddEdge(event_id, file1_id, StringLabel("Uses", "read"));
+  graph_.FindOrAddEdge(event_id, file2_id, StringLabel("Uses", "write"));
+  std::ostringstream labels;
+  WriteLabelTable(graph_, {"Event"}, &labels);
+  EXPECT_EQ("id,tag,value\n1,File,\"/tmp/a,b\"\n2,File,/tmp/c\n",
+            labels.str());
+  std::ostringstream edges;
+  WriteEdgeTable(graph_, &edges);
+  EXPECT_EQ("source,target,tag\n0,1,Uses\n0,2,Uses\n", edges.str());
+}
+
+TEST(TableWriterDeathTest, RequiresNodeType) {
+  LabeledGraph graph;
+  type::Types node_types;
+  node_types.insert({"File", type::MakeString("Filename", false)});
+  ASSERT_TRUE(graph
+                  .Initialize(node_types, std::set<string>(), type::Types(),
+                              std::set<string>(),
+                              type::MakeString("System", false))
+                  .ok());
+  std::ostringstream out;
+  EXPECT_DEATH({ WriteNodeTable(graph, "Event", &out); }, ".*");
+}
+
+}  // namespace
+}  // namespace morphie
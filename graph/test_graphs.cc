@@ -14,6 +14,11 @@
 
 #include "graph/test_graphs.h"
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
 #include "graph/dot_printer.h"
 #include "graph/type.h"
 #include "graph/value.h"
@@ -25,6 +30,9 @@ namespace {
 const char kInitializationErr[] = "The graph is not initialized.";
 const char kGraphNodeErr[] = "Invalid node identifier.";
 const char kGraphStatisticsErr[] = "Invalid graph statistics.";
+const char kNumWeightsErr[] = "The number of weights must be positive.";
+const char kClusterErr[] = "Cluster sizes and gaps must be positive.";
+const char kReadsGraphErr[] = "The reads graph could not be initialized.";
 
 // Tags and names for components of labels.
 const char kNodeWeightTag[] = "Node-Weight";
@@ -39,6 +47,11 @@ namespace test {
 namespace type = ast::type;
 namespace value = ast::value;
 
+const char kEventTag[] = "Event";
+const char kFileTag[] = "File";
+const char kReadsTag[] = "Reads";
+const char kCountTag[] = "Count";
+
 namespace {
 
 // If a start node is found, returns the pair {true, node} where 'node' is the
@@ -47,7 +60,7 @@ std::pair<bool, NodeId> GetStartNode(const LabeledGraph& graph) {
   auto node_end_it = graph.NodeSetEnd();
   for (auto node_it = graph.NodeSetBegin(); node_it != node_end_it;
        ++node_it) {
-    if (graph.GetPredecessors(*node_it).empty()) {
+    if (graph.GetPredecessorRange(*node_it).empty()) {
       return {true, *node_it};
     }
   }
@@ -72,6 +85,45 @@ std::pair<bool, int> TraverseGraph(const LabeledGraph& graph, NodeId start) {
   return {false, visited_nodes.size()};
 }
 
+// Adds 'num_nodes' nodes to 'graph', the node j with weight j modulo
+// 'num_weights', and returns their identifiers.
+std::vector<NodeId> AddNodes(int num_nodes, int num_weights,
+                             WeightedGraph* graph) {
+  std::vector<NodeId> nodes;
+  nodes.reserve(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    nodes.push_back(graph->AddNode(i % num_weights));
+  }
+  return nodes;
+}
+
+// Initializes 'graph' and returns true if the generators should add nodes.
+bool InitializeGeneratedGraph(int num_nodes, int num_weights,
+                              WeightedGraph* graph) {
+  CHECK(graph != nullptr, "Pointer to graph is null");
+  CHECK(num_weights >= 1, kNumWeightsErr);
+  return graph->Initialize().ok() && num_nodes >= 1;
+}
+
+// Returns up to 'num_draws' distinct nodes other than 'excluded', each drawn
+// by 'draw'. Gives up after a bounded number of repeated draws, so that the
+// function terminates if there are too few nodes to draw from.
+template <typename Draw>
+std::vector<NodeId> DrawDistinctNodes(int num_draws, NodeId excluded,
+                                      Draw draw) {
+  std::vector<NodeId> drawn;
+  for (int attempt = 0; static_cast<int>(drawn.size()) < num_draws &&
+                        attempt < 4 * num_draws;
+       ++attempt) {
+    NodeId node = draw();
+    if (node != excluded &&
+        std::find(drawn.begin(), drawn.end(), node) == drawn.end()) {
+      drawn.push_back(node);
+    }
+  }
+  return drawn;
+}
+
 }  // namespace
 
 util::Status WeightedGraph::Initialize() {
@@ -92,26 +144,18 @@ util::Status WeightedGraph::Initialize() {
 }
 
 NodeId WeightedGraph::AddNode(int node_weight) {
-  TaggedAST label;
-  label.set_tag(kNodeWeightTag);
-  *label.mutable_ast() = value::MakeInt(node_weight);
-  return graph_.FindOrAddNode(label);
+  return graph_.FindOrAddNode(NodeWeightLabel(node_weight));
 }
 
 EdgeId WeightedGraph::AddEdge(NodeId src, NodeId tgt, int edge_weight) {
   CHECK(src >= 0 && src < graph_.NumNodes(), kGraphNodeErr);
   CHECK(tgt >= 0 && tgt < graph_.NumNodes(), kGraphNodeErr);
-  TaggedAST label;
-  label.set_tag(kEdgeWeightTag);
-  *label.mutable_ast() = value::MakeInt(edge_weight);
-  return graph_.FindOrAddEdge(src, tgt, label);
+  return graph_.FindOrAddEdge(src, tgt, EdgeWeightLabel(edge_weight));
 }
 
 std::set<NodeId> WeightedGraph::GetNodes(int node_weight) const {
-  TaggedAST label;
-  label.set_tag(kNodeWeightTag);
-  *label.mutable_ast() = value::MakeInt(node_weight);
-  return graph_.GetNodes(label);
+  util::Span<NodeId> nodes = graph_.GetNodes(NodeWeightLabel(node_weight));
+  return std::set<NodeId>(nodes.begin(), nodes.end());
 }
 
 const LabeledGraph* WeightedGraph::GetGraph() const {
@@ -157,12 +201,162 @@ void GetCycleGraph(int num_nodes, WeightedGraph* graph) {
   graph->AddEdge(*last_nodes.begin(), *first_nodes.begin(), num_nodes - 1);
 }
 
+// The pairs of distinct nodes are numbered from 0 to n*(n-1)-1 and the gaps
+// between the numbers of consecutive edges are drawn from a geometric
+// distribution, so that pairs without an edge are never enumerated.
+void GetErdosRenyiGraph(int num_nodes, double edge_probability,
+                        int num_weights, uint64_t seed, WeightedGraph* graph) {
+  if (!InitializeGeneratedGraph(num_nodes, num_weights, graph)) {
+    return;
+  }
+  std::vector<NodeId> nodes = AddNodes(num_nodes, num_weights, graph);
+  if (edge_probability <= 0) {
+    return;
+  }
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<int> weight(0, num_weights - 1);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  const int64_t num_pairs = static_cast<int64_t>(num_nodes) * (num_nodes - 1);
+  const double log_q = std::log1p(-std::min(edge_probability, 1.0));
+  for (int64_t pair = 0; pair < num_pairs; ++pair) {
+    if (edge_probability < 1) {
+      double skip = std::floor(std::log(1 - uniform(generator)) / log_q);
+      if (skip >= static_cast<double>(num_pairs - pair)) {
+        return;
+      }
+      pair += static_cast<int64_t>(skip);
+    }
+    int src = static_cast<int>(pair / (num_nodes - 1));
+    int tgt = static_cast<int>(pair % (num_nodes - 1));
+    if (tgt >= src) {
+      ++tgt;
+    }
+    graph->AddEdge(nodes[src], nodes[tgt], weight(generator));
+  }
+}
+
+// Every node appears in 'endpoints' once, and once more for every edge it is
+// incident to, so a uniform draw from 'endpoints' is proportional to the
+// degree plus one.
+void GetPreferentialAttachmentGraph(int num_nodes, int edges_per_node,
+                                    int num_weights, uint64_t seed,
+                                    WeightedGraph* graph) {
+  if (!InitializeGeneratedGraph(num_nodes, num_weights, graph)) {
+    return;
+  }
+  std::vector<NodeId> nodes = AddNodes(num_nodes, num_weights, graph);
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<int> weight(0, num_weights - 1);
+  std::vector<NodeId> endpoints;
+  endpoints.push_back(nodes[0]);
+  for (int i = 1; i < num_nodes; ++i) {
+    std::uniform_int_distribution<size_t> draw(0, endpoints.size() - 1);
+    std::vector<NodeId> targets = DrawDistinctNodes(
+        std::min(edges_per_node, i), nodes[i],
+        [&]() { return endpoints[draw(generator)]; });
+    for (NodeId tgt : targets) {
+      graph->AddEdge(nodes[i], tgt, weight(generator));
+      endpoints.push_back(tgt);
+      endpoints.push_back(nodes[i]);
+    }
+    endpoints.push_back(nodes[i]);
+  }
+}
+
+void GetLayeredDag(int num_layers, int layer_width, int edges_per_node,
+                   int num_weights, uint64_t seed, WeightedGraph* graph) {
+  int num_nodes =
+      num_layers > 0 && layer_width > 0 ? num_layers * layer_width : 0;
+  if (!InitializeGeneratedGraph(num_nodes, num_weights, graph)) {
+    return;
+  }
+  std::vector<NodeId> nodes = AddNodes(num_nodes, num_weights, graph);
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<int> weight(0, num_weights - 1);
+  std::uniform_int_distribution<int> draw(0, layer_width - 1);
+  for (int layer = 1; layer < num_layers; ++layer) {
+    const NodeId* previous = &nodes[(layer - 1) * layer_width];
+    for (int i = 0; i < layer_width; ++i) {
+      NodeId tgt = nodes[layer * layer_width + i];
+      std::vector<NodeId> sources =
+          DrawDistinctNodes(std::min(edges_per_node, layer_width), tgt,
+                            [&]() { return previous[draw(generator)]; });
+      for (NodeId src : sources) {
+        graph->AddEdge(src, tgt, weight(generator));
+      }
+    }
+  }
+}
+
+void GetTemporalChain(int num_nodes, int cluster_size, int cluster_gap,
+                      uint64_t seed, WeightedGraph* graph) {
+  CHECK(cluster_size >= 1 && cluster_gap >= 1, kClusterErr);
+  if (!InitializeGeneratedGraph(num_nodes, 1, graph)) {
+    return;
+  }
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<int> event_gap(0, 2);
+  std::uniform_int_distribution<int> next_cluster_gap(
+      cluster_gap - cluster_gap / 2, cluster_gap + cluster_gap / 2);
+  int timestamp = 0;
+  NodeId src = graph->AddNode(timestamp);
+  for (int i = 1; i < num_nodes; ++i) {
+    int gap = i % cluster_size == 0 ? next_cluster_gap(generator)
+                                    : event_gap(generator);
+    timestamp += gap;
+    NodeId tgt = graph->AddNode(timestamp);
+    graph->AddEdge(src, tgt, gap);
+    src = tgt;
+  }
+}
+
 // A graph is a path if it satisfies the following:
 // - The graph has one fewer edges than nodes.
 // - There is a unique node with no predecessors (the start of the path)
 //   (guaranteed by the first condition).
 // - Starting from the start node, every node can be traversed exactly once by
 //   following the edges.
+TaggedAST NodeWeightLabel(int weight) {
+  return MakeLabel(kNodeWeightTag, value::MakeInt(weight));
+}
+
+TaggedAST EdgeWeightLabel(int weight) {
+  return MakeLabel(kEdgeWeightTag, value::MakeInt(weight));
+}
+
+int Weight(const TaggedAST& label) {
+  return label.ast().p_ast().val().int_val();
+}
+
+std::vector<TaggedAST> EdgeCountLabel(const LabeledGraph& graph,
+                                      util::Span<EdgeId> edges) {
+  return {EdgeWeightLabel(static_cast<int>(edges.size()))};
+}
+
+void InitializeReadsGraph(LabeledGraph* graph) {
+  type::Types node_types;
+  node_types.emplace(kEventTag, type::MakeInt(kEventTag, false));
+  node_types.emplace(kFileTag, type::MakeString(kFileTag, false));
+  type::Types edge_types;
+  edge_types.emplace(kReadsTag, type::MakeNull(kReadsTag));
+  edge_types.emplace(kCountTag, type::MakeInt(kCountTag, false));
+  util::Status status =
+      graph->Initialize(node_types, {kFileTag}, edge_types, {kReadsTag},
+                        type::MakeString("Graph", false));
+  CHECK(status.ok(), kReadsGraphErr);
+}
+
+TaggedAST MakeLabel(const string& tag, const AST& ast) {
+  TaggedAST label;
+  label.set_tag(tag);
+  *label.mutable_ast() = ast;
+  return label;
+}
+
+TaggedAST MakeLabel(const string& tag, const string& value) {
+  return MakeLabel(tag, value::MakeString(value));
+}
+
 bool IsPath(const LabeledGraph& graph) {
   if (graph.NumEdges() != graph.NumNodes() - 1) {
     return false;
@@ -17,7 +17,9 @@
 #ifndef LOGLE_TEST_GRAPHS_H_
 #define LOGLE_TEST_GRAPHS_H_
 
+#include <cstdint>
 #include <set>
+#include <vector>
 
 #include "base/string.h"
 #include "graph/labeled_graph.h"
@@ -64,6 +66,19 @@ class WeightedGraph {
   LabeledGraph graph_;
 };  // class IntGraph
 
+// Returns the label of a node or an edge of a WeightedGraph with the weight
+// 'weight'.
+TaggedAST NodeWeightLabel(int weight);
+TaggedAST EdgeWeightLabel(int weight);
+
+// Returns the weight in the label of a node or an edge of a WeightedGraph.
+int Weight(const TaggedAST& label);
+
+// An edge label function for quotients of weighted graphs that labels a group
+// of edges with the number of edges in it.
+std::vector<TaggedAST> EdgeCountLabel(const LabeledGraph& graph,
+                                      util::Span<EdgeId> edges);
+
 // A path graph with k+1 nodes, for k greater than or equal to 0, has
 //  - a node with weight j for every j in [0,k], and
 //  - an edge j -> j+1 with weight j for j in [0, k-1].
@@ -76,6 +91,60 @@ void GetPathGraph(int num_nodes, WeightedGraph* graph);
 // A cycle graph can be drawn as a simple cycle.
 void GetCycleGraph(int num_nodes, WeightedGraph* graph);
 
+// The generators below construct large graphs for performance tests. They
+// initialize 'graph' and do nothing else if 'num_nodes' is less than 1. The
+// node j has weight j modulo 'num_weights' unless stated otherwise, and edge
+// weights are drawn uniformly from [0, num_weights). A generator called twice
+// with the same arguments and seed constructs the same graph, node for node
+// and edge for edge, with a given standard library.
+// - Crash if 'graph' is null or if 'num_weights' is less than 1.
+
+// An Erdos-Renyi graph with n nodes has each of the n*(n-1) directed edges
+// between distinct nodes with probability 'edge_probability'. The graph is
+// constructed in time linear in the number of nodes and edges.
+void GetErdosRenyiGraph(int num_nodes, double edge_probability,
+                        int num_weights, uint64_t seed, WeightedGraph* graph);
+
+// A preferential attachment graph is constructed by adding the nodes one at a
+// time. Every node after the first has an edge to up to 'edges_per_node'
+// distinct earlier nodes, which are drawn with a probability proportional to
+// their degree plus one. The degrees of the graph follow a power law.
+void GetPreferentialAttachmentGraph(int num_nodes, int edges_per_node,
+                                    int num_weights, uint64_t seed,
+                                    WeightedGraph* graph);
+
+// A layered DAG has 'num_layers' layers of 'layer_width' nodes. Every node of
+// a layer other than the first has an edge from up to 'edges_per_node'
+// distinct nodes of the previous layer, which are drawn uniformly.
+void GetLayeredDag(int num_layers, int layer_width, int edges_per_node,
+                   int num_weights, uint64_t seed, WeightedGraph* graph);
+
+// A temporal chain is a path graph whose node weights are non-decreasing
+// timestamps. The timestamps come in clusters of 'cluster_size' events that
+// are at most a few units apart, and consecutive clusters are separated by
+// gaps of about 'cluster_gap' units. Timestamps start at 0 and the weight of
+// the edge j -> j+1 is the difference between the timestamps of j+1 and j.
+// - Crashes if 'cluster_size' or 'cluster_gap' is less than 1.
+void GetTemporalChain(int num_nodes, int cluster_size, int cluster_gap,
+                      uint64_t seed, WeightedGraph* graph);
+
+// The tags of the graph that InitializeReadsGraph() initializes.
+extern const char kEventTag[];
+extern const char kFileTag[];
+extern const char kReadsTag[];
+extern const char kCountTag[];
+
+// Initializes 'graph' with non-unique 'Event' nodes labelled with ints, unique
+// 'File' nodes labelled with strings, unique 'Reads' edges without values and
+// non-unique 'Count' edges labelled with ints, in which events read files.
+// - Crashes if 'graph' cannot be initialized.
+void InitializeReadsGraph(LabeledGraph* graph);
+
+// Returns a label with the tag 'tag' and the AST 'ast', or a string AST with
+// the value 'value'.
+TaggedAST MakeLabel(const string& tag, const AST& ast);
+TaggedAST MakeLabel(const string& tag, const string& value);
+
 // Returns true if 'graph' is a path graph.
 bool IsPath(const LabeledGraph& graph);
 
@@ -108,6 +108,89 @@ TEST(TestGraphsTest, IsCycleGraph) {
   EXPECT_FALSE(test::IsCycle(ten_path_graph));
 }
 
+TEST(TestGraphsTest, CreatesErdosRenyiGraphs) {
+  WeightedGraph empty;
+  test::GetErdosRenyiGraph(10, 0.0, 4, 1, &empty);
+  EXPECT_EQ(10, empty.NumNodes());
+  EXPECT_EQ(0, empty.NumEdges());
+  // With probability 1, every ordered pair of distinct nodes has an edge.
+  WeightedGraph complete;
+  test::GetErdosRenyiGraph(10, 1.0, 4, 1, &complete);
+  EXPECT_EQ(10, complete.NumNodes());
+  EXPECT_EQ(90, complete.NumEdges());
+  EXPECT_EQ(3, complete.GetNodes(0).size());
+  // The number of edges of a random graph is close to its expected value 9900.
+  WeightedGraph random;
+  test::GetErdosRenyiGraph(1000, 0.01, 4, 1, &random);
+  EXPECT_EQ(1000, random.NumNodes());
+  EXPECT_GT(random.NumEdges(), 9000);
+  EXPECT_LT(random.NumEdges(), 10800);
+}
+
+TEST(TestGraphsTest, CreatesPreferentialAttachmentGraphs) {
+  WeightedGraph graph;
+  test::GetPreferentialAttachmentGraph(1000, 3, 4, 1, &graph);
+  EXPECT_EQ(1000, graph.NumNodes());
+  // Every node but the first has at most three successors.
+  EXPECT_LE(graph.NumEdges(), 3 * 999);
+  EXPECT_GT(graph.NumEdges(), 2 * 999);
+  const LabeledGraph& labeled_graph = *graph.GetGraph();
+  EXPECT_TRUE(labeled_graph.GetSuccessors(0).empty());
+  // Early nodes attract more edges than late ones.
+  EXPECT_GT(labeled_graph.GetPredecessors(0).size(),
+            labeled_graph.GetPredecessors(999).size());
+}
+
+TEST(TestGraphsTest, CreatesLayeredDags) {
+  WeightedGraph graph;
+  test::GetLayeredDag(5, 10, 2, 4, 1, &graph);
+  EXPECT_EQ(50, graph.NumNodes());
+  EXPECT_EQ(4 * 10 * 2, graph.NumEdges());
+  const LabeledGraph& labeled_graph = *graph.GetGraph();
+  for (NodeId node = 0; node < 10; ++node) {
+    EXPECT_TRUE(labeled_graph.GetPredecessors(node).empty());
+  }
+  for (NodeId node = 40; node < 50; ++node) {
+    EXPECT_TRUE(labeled_graph.GetSuccessors(node).empty());
+    for (NodeId pred : labeled_graph.GetPredecessors(node)) {
+      EXPECT_GE(pred, 30);
+      EXPECT_LT(pred, 40);
+    }
+  }
+}
+
+TEST(TestGraphsTest, CreatesTemporalChains) {
+  WeightedGraph graph;
+  test::GetTemporalChain(100, 10, 1000, 1, &graph);
+  EXPECT_EQ(100, graph.NumNodes());
+  EXPECT_TRUE(test::IsPath(*graph.GetGraph()));
+  // The timestamps of the first cluster are at most 18 and those of the second
+  // cluster at least 500.
+  for (int weight = 19; weight < 500; ++weight) {
+    EXPECT_TRUE(graph.GetNodes(weight).empty());
+  }
+}
+
+// Generators with the same seed construct the same graphs.
+TEST(TestGraphsTest, GeneratesReproducibleGraphs) {
+  WeightedGraph random1, random2, random3;
+  test::GetErdosRenyiGraph(50, 0.1, 4, 7, &random1);
+  test::GetErdosRenyiGraph(50, 0.1, 4, 7, &random2);
+  test::GetErdosRenyiGraph(50, 0.1, 4, 8, &random3);
+  EXPECT_EQ(random1.ToDot(), random2.ToDot());
+  EXPECT_NE(random1.ToDot(), random3.ToDot());
+
+  WeightedGraph attachment1, attachment2;
+  test::GetPreferentialAttachmentGraph(50, 2, 4, 7, &attachment1);
+  test::GetPreferentialAttachmentGraph(50, 2, 4, 7, &attachment2);
+  EXPECT_EQ(attachment1.ToDot(), attachment2.ToDot());
+
+  WeightedGraph chain1, chain2;
+  test::GetTemporalChain(50, 5, 100, 7, &chain1);
+  test::GetTemporalChain(50, 5, 100, 7, &chain2);
+  EXPECT_EQ(chain1.ToDot(), chain2.ToDot());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace morphie
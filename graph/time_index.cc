@@ -0,0 +1,140 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/time_index.h"
+
+#include <algorithm>
+
+#include "util/logging.h"
+
+namespace morphie {
+
+namespace {
+
+const char kUnsortedErr[] = "The time index is not sorted.";
+
+// Compares entries with timestamps in binary searches.
+bool TimestampLT(const TimedNode& entry, int64_t timestamp) {
+  return entry.timestamp < timestamp;
+}
+bool LTTimestamp(int64_t timestamp, const TimedNode& entry) {
+  return timestamp < entry.timestamp;
+}
+
+}  // namespace
+
+void TimeIndex::Add(int64_t timestamp, NodeId node_id) {
+  TimedNode entry{timestamp, node_id};
+  if (IsSorted() && (entries_.empty() || !(entry < entries_.back()))) {
+    ++num_sorted_;
+  }
+  entries_.push_back(entry);
+}
+
+void TimeIndex::Insert(int64_t timestamp, NodeId node_id) {
+  CHECK(IsSorted(), kUnsortedErr);
+  TimedNode entry{timestamp, node_id};
+  entries_.insert(std::upper_bound(entries_.begin(), entries_.end(), entry),
+                  entry);
+  ++num_sorted_;
+}
+
+void TimeIndex::Sort() {
+  if (IsSorted()) {
+    return;
+  }
+  auto middle = entries_.begin() + num_sorted_;
+  std::sort(middle, entries_.end());
+  std::inplace_merge(entries_.begin(), middle, entries_.end());
+  num_sorted_ = entries_.size();
+}
+
+void TimeIndex::RemoveBefore(int64_t timestamp) {
+  CHECK(IsSorted(), kUnsortedErr);
+  entries_.erase(entries_.begin(),
+                 std::lower_bound(entries_.begin(), entries_.end(), timestamp,
+                                  TimestampLT));
+  num_sorted_ = entries_.size();
+  if (entries_.size() < entries_.capacity() / 4) {
+    entries_.shrink_to_fit();
+  }
+}
+
+void TimeIndex::Renumber(const std::vector<NodeId>& node_map) {
+  for (TimedNode& entry : entries_) {
+    entry.node_id = node_map[entry.node_id];
+  }
+}
+
+util::Span<TimedNode> TimeIndex::Entries() const {
+  CHECK(IsSorted(), kUnsortedErr);
+  return MakeSpan(entries_.begin(), entries_.end());
+}
+
+util::Span<TimedNode> TimeIndex::NodesBetween(int64_t first,
+                                              int64_t last) const {
+  CHECK(IsSorted(), kUnsortedErr);
+  if (last < first) {
+    return util::Span<TimedNode>();
+  }
+  auto begin =
+      std::lower_bound(entries_.begin(), entries_.end(), first, TimestampLT);
+  return MakeSpan(begin,
+                  std::upper_bound(begin, entries_.end(), last, LTTimestamp));
+}
+
+util::Span<TimedNode> TimeIndex::NodesAt(int64_t timestamp) const {
+  return NodesBetween(timestamp, timestamp);
+}
+
+util::Span<TimedNode> TimeIndex::EntriesBefore(int64_t timestamp) const {
+  CHECK(IsSorted(), kUnsortedErr);
+  return MakeSpan(entries_.begin(),
+                  std::lower_bound(entries_.begin(), entries_.end(), timestamp,
+                                   TimestampLT));
+}
+
+util::Span<TimedNode> TimeIndex::NodesBefore(int64_t timestamp) const {
+  CHECK(IsSorted(), kUnsortedErr);
+  auto end =
+      std::lower_bound(entries_.begin(), entries_.end(), timestamp,
+                       TimestampLT);
+  if (end == entries_.begin()) {
+    return util::Span<TimedNode>();
+  }
+  int64_t previous = (end - 1)->timestamp;
+  return MakeSpan(
+      std::lower_bound(entries_.begin(), end, previous, TimestampLT), end);
+}
+
+util::Span<TimedNode> TimeIndex::NodesAfter(int64_t timestamp) const {
+  CHECK(IsSorted(), kUnsortedErr);
+  auto begin =
+      std::upper_bound(entries_.begin(), entries_.end(), timestamp,
+                       LTTimestamp);
+  if (begin == entries_.end()) {
+    return util::Span<TimedNode>();
+  }
+  return MakeSpan(begin, std::upper_bound(begin, entries_.end(),
+                                          begin->timestamp, LTTimestamp));
+}
+
+util::Span<TimedNode> TimeIndex::MakeSpan(
+    std::vector<TimedNode>::const_iterator begin,
+    std::vector<TimedNode>::const_iterator end) const {
+  return util::Span<TimedNode>(entries_.data() + (begin - entries_.begin()),
+                               end - begin);
+}
+
+}  // namespace morphie
@@ -0,0 +1,125 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A time index maps timestamps to the nodes of a graph that represent events at
+// those timestamps. The index is a vector of (timestamp, node) pairs sorted by
+// timestamp and then by node, which uses one contiguous allocation instead of
+// the tree nodes of a std::map of std::sets, and answers range queries with two
+// binary searches.
+//
+// Entries can be appended in any order and sorted once after they have been
+// added, or inserted in order so that the index is always sorted. Appending
+// entries in chronological order keeps the index sorted without sorting it.
+// Sort() sorts only the entries appended since the index was last sorted and
+// merges them with the sorted entries.
+//
+// Example.
+//   TimeIndex index;
+//   index.Add(30, 2);
+//   index.Add(10, 0);
+//   index.Add(20, 1);
+//   index.Sort();
+//   for (const TimedNode& entry : index.NodesBetween(10, 20)) {
+//     // Visits nodes 0 and 1.
+//   }
+#ifndef LOGLE_TIME_INDEX_H_
+#define LOGLE_TIME_INDEX_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "graph/labeled_graph.h"
+#include "util/span.h"
+
+namespace morphie {
+
+// A node and the timestamp of the event it represents.
+struct TimedNode {
+  int64_t timestamp;
+  NodeId node_id;
+};
+
+// Orders entries by timestamp and then by node.
+inline bool operator<(const TimedNode& a, const TimedNode& b) {
+  return a.timestamp < b.timestamp ||
+         (a.timestamp == b.timestamp && a.node_id < b.node_id);
+}
+
+class TimeIndex {
+ public:
+  TimeIndex() : num_sorted_(0) {}
+
+  // Appends an entry in constant amortized time. The index remains sorted if
+  // it was sorted and the entry is not less than the last entry.
+  void Add(int64_t timestamp, NodeId node_id);
+  // Inserts an entry at its position in the order. Takes constant amortized
+  // time if the entry is not less than the last entry and linear time
+  // otherwise.
+  // - Requires that the index is sorted.
+  void Insert(int64_t timestamp, NodeId node_id);
+  // Sorts the index. Entries are not deduplicated.
+  void Sort();
+  // Removes the entries with timestamps less than 'timestamp' in time linear
+  // in the size of the index. The memory of the index is released when it
+  // shrinks to less than a quarter of its capacity.
+  // - Requires that the index is sorted.
+  void RemoveBefore(int64_t timestamp);
+  // Replaces the node of every entry by its image in 'node_map', such as the
+  // map returned by LabeledGraph::Compact(), in linear time.
+  // - Requires that 'node_map' maps every node in the index to a node and
+  //   preserves the order of the nodes in the index, which keeps the index
+  //   sorted.
+  void Renumber(const std::vector<NodeId>& node_map);
+
+  bool IsSorted() const { return num_sorted_ == entries_.size(); }
+  size_t Size() const { return entries_.size(); }
+  bool Empty() const { return entries_.empty(); }
+  // Returns the bytes of the entries of the index.
+  size_t MemoryBytes() const {
+    return entries_.capacity() * sizeof(TimedNode);
+  }
+
+  // The functions below return views of the index that are invalidated when
+  // the index is modified.
+  // - Require that the index is sorted.
+  //
+  // Returns every entry in order.
+  util::Span<TimedNode> Entries() const;
+  // Returns the entries with timestamps at least 'first' and at most 'last',
+  // which is empty if 'last' is less than 'first'.
+  util::Span<TimedNode> NodesBetween(int64_t first, int64_t last) const;
+  // Returns the entries with the timestamp 'timestamp'.
+  util::Span<TimedNode> NodesAt(int64_t timestamp) const;
+  // Returns the entries with timestamps less than 'timestamp'.
+  util::Span<TimedNode> EntriesBefore(int64_t timestamp) const;
+  // Returns the entries with the largest timestamp less than 'timestamp', or
+  // the entries with the smallest timestamp greater than 'timestamp'. The span
+  // is empty if there is no such timestamp.
+  util::Span<TimedNode> NodesBefore(int64_t timestamp) const;
+  util::Span<TimedNode> NodesAfter(int64_t timestamp) const;
+
+ private:
+  // Returns the entries between the positions 'begin' and 'end'.
+  util::Span<TimedNode> MakeSpan(std::vector<TimedNode>::const_iterator begin,
+                                 std::vector<TimedNode>::const_iterator end)
+      const;
+
+  std::vector<TimedNode> entries_;
+  // The entries before this position are sorted.
+  size_t num_sorted_;
+};
+
+}  // namespace morphie
+
+#endif  // LOGLE_TIME_INDEX_H_
@@ -0,0 +1,108 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/time_index.h"
+
+#include <vector>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace {
+
+// Returns the nodes in 'entries'.
+std::vector<NodeId> Nodes(util::Span<TimedNode> entries) {
+  std::vector<NodeId> nodes;
+  for (const TimedNode& entry : entries) {
+    nodes.push_back(entry.node_id);
+  }
+  return nodes;
+}
+
+// Entries appended in order keep the index sorted, and entries appended out
+// of order are merged with the sorted entries by Sort().
+TEST(TimeIndexTest, SortsAppendedEntries) {
+  TimeIndex index;
+  EXPECT_TRUE(index.IsSorted());
+  index.Add(10, 1);
+  index.Add(10, 2);
+  index.Add(20, 0);
+  EXPECT_TRUE(index.IsSorted());
+  index.Add(5, 4);
+  index.Add(20, 3);
+  index.Add(10, 0);
+  EXPECT_FALSE(index.IsSorted());
+  index.Sort();
+  EXPECT_TRUE(index.IsSorted());
+  EXPECT_EQ(6, index.Size());
+  EXPECT_EQ(std::vector<NodeId>({4, 0, 1, 2, 0, 3}), Nodes(index.Entries()));
+  index.Insert(15, 5);
+  index.Insert(1, 6);
+  EXPECT_EQ(std::vector<NodeId>({6, 4, 0, 1, 2, 5, 0, 3}),
+            Nodes(index.Entries()));
+}
+
+TEST(TimeIndexTest, AnswersRangeQueries) {
+  TimeIndex index;
+  for (NodeId node_id = 0; node_id < 10; ++node_id) {
+    index.Add(100 - (node_id / 2) * 10, node_id);
+  }
+  index.Sort();
+  EXPECT_EQ(std::vector<NodeId>({6, 7, 4, 5}),
+            Nodes(index.NodesBetween(65, 80)));
+  EXPECT_EQ(std::vector<NodeId>({8, 9, 6, 7}),
+            Nodes(index.NodesBetween(60, 70)));
+  EXPECT_TRUE(index.NodesBetween(71, 79).empty());
+  EXPECT_TRUE(index.NodesBetween(80, 70).empty());
+  EXPECT_EQ(10, index.NodesBetween(0, 200).size());
+  EXPECT_EQ(std::vector<NodeId>({2, 3}), Nodes(index.NodesAt(90)));
+  EXPECT_TRUE(index.NodesAt(95).empty());
+  EXPECT_EQ(std::vector<NodeId>({2, 3}), Nodes(index.NodesBefore(100)));
+  EXPECT_EQ(std::vector<NodeId>({2, 3}), Nodes(index.NodesBefore(95)));
+  EXPECT_TRUE(index.NodesBefore(60).empty());
+  EXPECT_EQ(std::vector<NodeId>({4, 5}), Nodes(index.NodesAfter(70)));
+  EXPECT_EQ(std::vector<NodeId>({6, 7}), Nodes(index.NodesAfter(65)));
+  EXPECT_TRUE(index.NodesAfter(100).empty());
+}
+
+TEST(TimeIndexTest, RemovesAndRenumbersEntries) {
+  TimeIndex index;
+  for (NodeId node_id = 0; node_id < 6; ++node_id) {
+    index.Add(10 * (node_id / 2), node_id);
+  }
+  EXPECT_EQ(std::vector<NodeId>({0, 1, 2, 3}), Nodes(index.EntriesBefore(15)));
+  EXPECT_TRUE(index.EntriesBefore(0).empty());
+  index.RemoveBefore(10);
+  EXPECT_EQ(std::vector<NodeId>({2, 3, 4, 5}), Nodes(index.Entries()));
+  index.RemoveBefore(5);
+  EXPECT_EQ(4, index.Size());
+  index.Renumber({LabeledGraph::kRemovedNode, LabeledGraph::kRemovedNode, 0,
+                  1, 2, 3});
+  EXPECT_EQ(std::vector<NodeId>({0, 1}), Nodes(index.NodesAt(10)));
+  EXPECT_EQ(std::vector<NodeId>({2, 3}), Nodes(index.NodesAt(20)));
+  index.RemoveBefore(30);
+  EXPECT_TRUE(index.Empty());
+  EXPECT_TRUE(index.IsSorted());
+}
+
+TEST(TimeIndexDeathTest, QueriesRequireSortedIndex) {
+  TimeIndex index;
+  index.Add(2, 0);
+  index.Add(1, 1);
+  EXPECT_DEATH({ index.NodesAt(1); }, "The time index is not sorted.");
+  EXPECT_DEATH({ index.Insert(3, 2); }, "The time index is not sorted.");
+}
+
+}  // namespace
+}  // namespace morphie
@@ -0,0 +1,188 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/transform_pipeline.h"
+
+#include <set>
+#include <utility>
+
+#include "util/logging.h"
+#include "util/status.h"
+
+namespace morphie {
+namespace graph {
+
+namespace {
+
+// Returns the nodes or edges of 'view' that 'select' holds for.
+std::set<NodeId> SelectNodes(const NodePredicate& select,
+                             const LabeledGraphView& view) {
+  std::set<NodeId> nodes;
+  ViewNodeIterator end_it = view.NodeSetEnd();
+  for (ViewNodeIterator node_it = view.NodeSetBegin(); node_it != end_it;
+       ++node_it) {
+    if (select(view.Graph(), *node_it)) {
+      nodes.insert(*node_it);
+    }
+  }
+  return nodes;
+}
+
+std::set<EdgeId> SelectEdges(const EdgePredicate& select,
+                             const LabeledGraphView& view) {
+  std::set<EdgeId> edges;
+  ViewEdgeIterator end_it = view.EdgeSetEnd();
+  for (ViewEdgeIterator edge_it = view.EdgeSetBegin(); edge_it != end_it;
+       ++edge_it) {
+    if (select(view.Graph(), *edge_it)) {
+      edges.insert(*edge_it);
+    }
+  }
+  return edges;
+}
+
+// Returns true if 'view' hides some node or edge of its graph.
+bool HidesAny(const LabeledGraphView& view) {
+  return view.NumNodes() != view.Graph().NumNodes() ||
+         view.NumEdges() != view.Graph().NumEdges();
+}
+
+// Sets 'result' to the composition of 'result' and 'next', or to 'next' if
+// 'result' is null. The input graph of 'next' must be the output graph of
+// 'result', so composition cannot fail.
+void Compose(std::unique_ptr<Morphism> next,
+             std::unique_ptr<Morphism>* result) {
+  if (*result == nullptr) {
+    *result = std::move(next);
+    return;
+  }
+  util::Status status = (*result)->ComposeWith(next.get());
+  CHECK(status.ok(), status.message());
+}
+
+// Folding requires a graph, so the nodes and edges hidden by a view are copied
+// to a new graph first, unless the view hides nothing.
+std::unique_ptr<Morphism> FoldView(const LabeledGraphView& view,
+                                   const NodePredicate& select,
+                                   const FoldLabelFn& fold_label_fn) {
+  if (!HidesAny(view)) {
+    return FoldNodesMorphism(view.Graph(), fold_label_fn,
+                             SelectNodes(select, view), 1);
+  }
+  std::unique_ptr<Morphism> morphism = CopyView(view);
+  if (!morphism->HasOutputGraph()) {
+    return morphism;
+  }
+  const LabeledGraph& copy = morphism->Output();
+  Compose(FoldNodesMorphism(copy, fold_label_fn,
+                            SelectNodes(select, LabeledGraphView(copy)), 1),
+          &morphism);
+  return morphism;
+}
+
+}  // namespace
+
+TransformPipeline& TransformPipeline::DeleteNodes(
+    const NodePredicate& select) {
+  Step step;
+  step.hide = [select](LabeledGraphView* view) {
+    view->HideNodes(SelectNodes(select, *view));
+  };
+  steps_.push_back(std::move(step));
+  return *this;
+}
+
+TransformPipeline& TransformPipeline::DeleteEdgesNotNodes(
+    const EdgePredicate& select) {
+  Step step;
+  step.hide = [select](LabeledGraphView* view) {
+    view->HideEdges(SelectEdges(select, *view));
+  };
+  steps_.push_back(std::move(step));
+  return *this;
+}
+
+TransformPipeline& TransformPipeline::DeleteEdgesAndNodes(
+    const EdgePredicate& select) {
+  Step step;
+  step.hide = [select](LabeledGraphView* view) {
+    view->HideEdges(SelectEdges(select, *view));
+    view->HideIsolatedNodes();
+  };
+  steps_.push_back(std::move(step));
+  return *this;
+}
+
+TransformPipeline& TransformPipeline::Quotient(const PartitionFn& partition_fn,
+                                               const QuotientConfig& config) {
+  Step step;
+  step.transform = [partition_fn, config](const LabeledGraphView& view) {
+    return QuotientMorphism(view, partition_fn(view), config);
+  };
+  steps_.push_back(std::move(step));
+  return *this;
+}
+
+TransformPipeline& TransformPipeline::ContractEdges(
+    const EdgePredicate& select, const QuotientConfig& config) {
+  Step step;
+  step.transform = [select, config](const LabeledGraphView& view) {
+    return ContractEdgesMorphism(view, SelectEdges(select, view), config);
+  };
+  steps_.push_back(std::move(step));
+  return *this;
+}
+
+TransformPipeline& TransformPipeline::FoldNodes(
+    const NodePredicate& select, const FoldLabelFn& fold_label_fn) {
+  Step step;
+  step.transform = [select, fold_label_fn](const LabeledGraphView& view) {
+    return FoldView(view, select, fold_label_fn);
+  };
+  steps_.push_back(std::move(step));
+  return *this;
+}
+
+// Deletions accumulate in a view of the current graph until a step transforms
+// the view into a new graph. The view is released before the morphism of that
+// step is composed with the result, because composition releases the graph the
+// view refers to. Deletions after the last transformation are copied out at
+// the end.
+std::unique_ptr<Morphism> TransformPipeline::Run(
+    const LabeledGraph& graph) const {
+  std::unique_ptr<Morphism> result;
+  std::unique_ptr<LabeledGraphView> view(new LabeledGraphView(graph));
+  for (const Step& step : steps_) {
+    if (step.hide) {
+      step.hide(view.get());
+      continue;
+    }
+    std::unique_ptr<Morphism> next = step.transform(*view);
+    view.reset();
+    Compose(std::move(next), &result);
+    if (!result->HasOutputGraph()) {
+      return result;
+    }
+    view.reset(new LabeledGraphView(result->Output()));
+  }
+  if (result == nullptr || HidesAny(*view)) {
+    std::unique_ptr<Morphism> next = CopyView(*view);
+    view.reset();
+    Compose(std::move(next), &result);
+  }
+  return result;
+}
+
+}  // namespace graph
+}  // namespace morphie
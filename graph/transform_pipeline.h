@@ -0,0 +1,107 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A transform pipeline records a sequence of graph transformations and applies
+// them to a graph in one call, returning the composition of their morphisms.
+// Applying the functions in graph_transformer.h one at a time constructs a
+// complete graph for every step. A pipeline instead applies deletions to a
+// LabeledGraphView and fuses them into the next quotient, contraction or fold,
+// so a graph is only constructed by steps that create nodes or edges, and at
+// most two graphs besides the input exist at a time.
+//
+// Example.
+//   TransformPipeline pipeline;
+//   pipeline.DeleteNodes(is_noise)
+//       .Quotient(refine_partition, config)
+//       .FoldNodes(is_intermediate, fold_label_fn);
+//   std::unique_ptr<Morphism> morphism = pipeline.Run(graph);
+//   // morphism->Output() is the summary and morphism->FindNodeImage(n) is the
+//   // node that node n of 'graph' is summarized by.
+//
+// The nodes and edges of the intermediate graphs are not known when a pipeline
+// is constructed, so steps select nodes and edges with predicates and compute
+// partitions with functions that are evaluated on the graph the step is applied
+// to.
+#ifndef LOGLE_TRANSFORM_PIPELINE_H_
+#define LOGLE_TRANSFORM_PIPELINE_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "graph/graph_transformer.h"
+#include "graph/labeled_graph.h"
+#include "graph/labeled_graph_view.h"
+#include "graph/morphism.h"
+
+namespace morphie {
+namespace graph {
+
+// Predicates that select nodes or edges of the graph a step is applied to.
+using NodePredicate = std::function<bool(const LabeledGraph&, NodeId)>;
+using EdgePredicate = std::function<bool(const LabeledGraph&, EdgeId)>;
+// A PartitionFn returns a partition of the nodes of a view as QuotientGraph
+// expects it, with one entry for each node identifier below view.NumNodeIds().
+using PartitionFn = std::function<std::vector<int>(const LabeledGraphView&)>;
+
+// The steps of a pipeline are applied in the order in which they are added.
+// Predicates and partition functions are called with the graph that the
+// previous steps produced, or with the input graph for the first step. Nodes
+// and edges deleted by earlier steps are not passed to predicates, and the
+// entries of a partition for deleted nodes are ignored. Nodes keep their
+// identifiers across deletions and are renumbered by the other steps.
+class TransformPipeline {
+ public:
+  TransformPipeline() {}
+
+  // Record a step and return the pipeline so that steps can be chained. The
+  // steps have the semantics of the functions of the same name in
+  // graph_transformer.h, with DeleteEdgesNotNodes and DeleteEdgesAndNodes
+  // deleting the selected edges, and Quotient computing the vector version of
+  // QuotientGraph. The configuration of a quotient or contraction is copied,
+  // and its output graph type must outlive the pipeline.
+  TransformPipeline& DeleteNodes(const NodePredicate& select);
+  TransformPipeline& DeleteEdgesNotNodes(const EdgePredicate& select);
+  TransformPipeline& DeleteEdgesAndNodes(const EdgePredicate& select);
+  TransformPipeline& Quotient(const PartitionFn& partition_fn,
+                              const QuotientConfig& config);
+  TransformPipeline& ContractEdges(const EdgePredicate& select,
+                                   const QuotientConfig& config);
+  TransformPipeline& FoldNodes(const NodePredicate& select,
+                               const FoldLabelFn& fold_label_fn);
+
+  int NumSteps() const { return static_cast<int>(steps_.size()); }
+
+  // Returns a morphism from 'graph' to the result of applying the steps. A
+  // pipeline without steps returns a copy of 'graph'. The pipeline can be run
+  // any number of times on different graphs. The morphism has no output graph
+  // if the output of some step could not be created.
+  std::unique_ptr<Morphism> Run(const LabeledGraph& graph) const;
+
+ private:
+  // A step either hides nodes and edges of the current view, or transforms
+  // the view into a new graph. Exactly one of the functions is set.
+  struct Step {
+    std::function<void(LabeledGraphView*)> hide;
+    std::function<std::unique_ptr<Morphism>(const LabeledGraphView&)>
+        transform;
+  };
+
+  std::vector<Step> steps_;
+};  // class TransformPipeline
+
+}  // namespace graph
+}  // namespace morphie
+
+#endif  // LOGLE_TRANSFORM_PIPELINE_H_
@@ -0,0 +1,227 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "graph/transform_pipeline.h"
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "graph/dot_printer.h"
+#include "graph/test_graphs.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace graph {
+namespace {
+
+using test::EdgeCountLabel;
+using test::EdgeWeightLabel;
+using test::NodeWeightLabel;
+using test::Weight;
+
+// Returns a predicate that holds for nodes with weight 'weight'.
+NodePredicate NodeWeightIs(int weight) {
+  return [weight](const LabeledGraph& graph, NodeId node) {
+    return Weight(graph.GetNodeLabel(node)) == weight;
+  };
+}
+
+// Returns a predicate that holds for edges with a weight in 'weights'.
+EdgePredicate EdgeWeightIn(const std::set<int>& weights) {
+  return [weights](const LabeledGraph& graph, EdgeId edge) {
+    return weights.count(Weight(graph.GetEdgeLabel(edge))) > 0;
+  };
+}
+
+// Returns the edges of 'graph' that 'select' holds for.
+std::set<EdgeId> GetEdges(const LabeledGraph& graph,
+                          const EdgePredicate& select) {
+  std::set<EdgeId> edges;
+  for (auto edge_it = graph.EdgeSetBegin(); edge_it != graph.EdgeSetEnd();
+       ++edge_it) {
+    if (select(graph, *edge_it)) {
+      edges.insert(*edge_it);
+    }
+  }
+  return edges;
+}
+
+// Label functions for quotients of weighted graphs. A block is labeled with
+// the weight of its first node and a group of edges with its size.
+TaggedAST FirstWeightLabel(const LabeledGraph& graph,
+                           util::Span<NodeId> nodes) {
+  return NodeWeightLabel(Weight(graph.GetNodeLabel(nodes[0])));
+}
+
+std::vector<TaggedAST> UnitFoldLabel(const LabeledGraph& graph, NodeId node,
+                                     NodeId predecessor, NodeId successor) {
+  return {EdgeWeightLabel(1)};
+}
+
+string ToDot(const LabeledGraph& graph) {
+  DotPrinter printer;
+  return printer.DotGraph(graph);
+}
+
+TEST(TransformPipelineTest, EmptyPipelineCopiesGraph) {
+  test::WeightedGraph cycle;
+  test::GetCycleGraph(4, &cycle);
+  const LabeledGraph& graph = *cycle.GetGraph();
+  TransformPipeline pipeline;
+  EXPECT_EQ(0, pipeline.NumSteps());
+  std::unique_ptr<Morphism> morphism = pipeline.Run(graph);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+  EXPECT_EQ(ToDot(graph), ToDot(morphism->Output()));
+  for (NodeId node = 0; node < 4; ++node) {
+    EXPECT_EQ(std::make_pair(true, node), morphism->FindNodeImage(node));
+  }
+}
+
+// Deleting node 2 and the edge 4 -> 5, and then the isolated node 5, from a
+// path with six nodes leaves the edges 0 -> 1 and 3 -> 4.
+TEST(TransformPipelineTest, DeletionsMatchTransformer) {
+  test::WeightedGraph path;
+  test::GetPathGraph(6, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  TransformPipeline pipeline;
+  pipeline.DeleteNodes(NodeWeightIs(2)).DeleteEdgesAndNodes(EdgeWeightIn({4}));
+  EXPECT_EQ(2, pipeline.NumSteps());
+  std::unique_ptr<Morphism> morphism = pipeline.Run(graph);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+
+  std::unique_ptr<Morphism> deleted = DeleteNodes(graph, {2});
+  std::unique_ptr<Morphism> expected = DeleteEdgesAndNodes(
+      deleted->Output(), GetEdges(deleted->Output(), EdgeWeightIn({4})));
+  EXPECT_EQ(4, morphism->Output().NumNodes());
+  EXPECT_EQ(2, morphism->Output().NumEdges());
+  EXPECT_EQ(ToDot(expected->Output()), ToDot(morphism->Output()));
+  EXPECT_FALSE(morphism->FindNodeImage(2).first);
+  EXPECT_FALSE(morphism->FindNodeImage(5).first);
+  EXPECT_EQ(std::make_pair(true, NodeId{2}), morphism->FindNodeImage(3));
+}
+
+// A quotient after a deletion is computed from the view without copying the
+// remaining nodes, and gives the same graph as the two transformations.
+TEST(TransformPipelineTest, DeleteAndQuotientMatchTransformer) {
+  test::WeightedGraph cycle;
+  test::GetCycleGraph(6, &cycle);
+  const LabeledGraph& graph = *cycle.GetGraph();
+  const std::vector<int> partition = {4, 4, 0, 0, 4, 7};
+  QuotientConfig config(graph, FirstWeightLabel, EdgeCountLabel, true);
+  TransformPipeline pipeline;
+  pipeline.DeleteNodes(NodeWeightIs(5))
+      .Quotient([&partition](const LabeledGraphView& view) {
+        return partition;
+      }, config);
+  std::unique_ptr<Morphism> morphism = pipeline.Run(graph);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+
+  std::unique_ptr<Morphism> deleted = DeleteNodes(graph, {5});
+  std::unique_ptr<LabeledGraph> expected =
+      QuotientGraph(deleted->Output(), {4, 4, 0, 0, 4}, config);
+  EXPECT_EQ(2, morphism->Output().NumNodes());
+  EXPECT_EQ(ToDot(*expected), ToDot(morphism->Output()));
+  EXPECT_EQ(morphism->FindNodeImage(0), morphism->FindNodeImage(1));
+  EXPECT_EQ(morphism->FindNodeImage(0), morphism->FindNodeImage(4));
+  EXPECT_EQ(morphism->FindNodeImage(2), morphism->FindNodeImage(3));
+  EXPECT_NE(morphism->FindNodeImage(0), morphism->FindNodeImage(2));
+  EXPECT_FALSE(morphism->FindNodeImage(5).first);
+}
+
+TEST(TransformPipelineTest, DeleteAndContractMatchTransformer) {
+  test::WeightedGraph cycle;
+  test::GetCycleGraph(6, &cycle);
+  const LabeledGraph& graph = *cycle.GetGraph();
+  QuotientConfig config(graph, FirstWeightLabel, EdgeCountLabel, true);
+  TransformPipeline pipeline;
+  pipeline.DeleteNodes(NodeWeightIs(5)).ContractEdges(EdgeWeightIn({0, 1}),
+                                                       config);
+  std::unique_ptr<Morphism> morphism = pipeline.Run(graph);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+
+  std::unique_ptr<Morphism> deleted = DeleteNodes(graph, {5});
+  std::unique_ptr<LabeledGraph> expected = ContractEdges(
+      deleted->Output(), GetEdges(deleted->Output(), EdgeWeightIn({0, 1})),
+      config);
+  EXPECT_EQ(3, morphism->Output().NumNodes());
+  EXPECT_EQ(ToDot(*expected), ToDot(morphism->Output()));
+  EXPECT_EQ(morphism->FindNodeImage(0), morphism->FindNodeImage(2));
+  EXPECT_FALSE(morphism->FindNodeImage(5).first);
+}
+
+// The quotient of the path 0 -> 1 -> 2 -> 3 by {{0, 1}, {2}, {3}} is a path
+// of three blocks, and folding the middle block leaves one edge.
+TEST(TransformPipelineTest, QuotientAndFoldComposeMorphisms) {
+  test::WeightedGraph path;
+  test::GetPathGraph(4, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  QuotientConfig config(graph, FirstWeightLabel, EdgeCountLabel, false);
+  TransformPipeline pipeline;
+  pipeline.Quotient([](const LabeledGraphView& view) {
+    return std::vector<int>{0, 0, 1, 2};
+  }, config).FoldNodes(NodeWeightIs(2), UnitFoldLabel);
+  std::unique_ptr<Morphism> morphism = pipeline.Run(graph);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+
+  std::unique_ptr<LabeledGraph> quotient =
+      QuotientGraph(graph, {0, 0, 1, 2}, config);
+  std::unique_ptr<LabeledGraph> expected =
+      FoldNodes(*quotient, UnitFoldLabel, {1});
+  EXPECT_EQ(2, morphism->Output().NumNodes());
+  EXPECT_EQ(1, morphism->Output().NumEdges());
+  EXPECT_EQ(ToDot(*expected), ToDot(morphism->Output()));
+  EXPECT_EQ(morphism->FindNodeImage(0), morphism->FindNodeImage(1));
+  EXPECT_FALSE(morphism->FindNodeImage(2).first);
+  EXPECT_TRUE(morphism->FindNodeImage(3).first);
+}
+
+// Folding needs a graph, so the view left by a deletion is copied first.
+TEST(TransformPipelineTest, DeleteAndFoldMatchTransformer) {
+  test::WeightedGraph path;
+  test::GetPathGraph(4, &path);
+  const LabeledGraph& graph = *path.GetGraph();
+  TransformPipeline pipeline;
+  pipeline.DeleteNodes(NodeWeightIs(0)).FoldNodes(NodeWeightIs(2),
+                                                  UnitFoldLabel);
+  std::unique_ptr<Morphism> morphism = pipeline.Run(graph);
+  ASSERT_TRUE(morphism->HasOutputGraph());
+
+  std::unique_ptr<Morphism> deleted = DeleteNodes(graph, {0});
+  std::unique_ptr<LabeledGraph> expected =
+      FoldNodes(deleted->Output(), UnitFoldLabel, {1});
+  EXPECT_EQ(ToDot(*expected), ToDot(morphism->Output()));
+  EXPECT_FALSE(morphism->FindNodeImage(0).first);
+  EXPECT_FALSE(morphism->FindNodeImage(2).first);
+  EXPECT_EQ(std::make_pair(true, NodeId{0}), morphism->FindNodeImage(1));
+  EXPECT_EQ(std::make_pair(true, NodeId{1}), morphism->FindNodeImage(3));
+}
+
+// A pipeline does not depend on the graph it is run on.
+TEST(TransformPipelineTest, RunsOnSeveralGraphs) {
+  TransformPipeline pipeline;
+  pipeline.DeleteEdgesNotNodes(EdgeWeightIn({0}));
+  for (int num_nodes = 2; num_nodes < 5; ++num_nodes) {
+    test::WeightedGraph cycle;
+    test::GetCycleGraph(num_nodes, &cycle);
+    std::unique_ptr<Morphism> morphism = pipeline.Run(*cycle.GetGraph());
+    ASSERT_TRUE(morphism->HasOutputGraph());
+    EXPECT_EQ(num_nodes, morphism->Output().NumNodes());
+    EXPECT_EQ(num_nodes - 1, morphism->Output().NumEdges());
+  }
+}
+
+}  // namespace
+}  // namespace graph
+}  // namespace morphie
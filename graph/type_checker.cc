@@ -234,8 +234,7 @@ bool IsInterval(const AST& type, const CompositeAST& cval, const string& path,
                 string* err) {
   CHECK(type.c_ast().op() == Operator::INTERVAL, "");
   if (cval.arg_size() != 2) {
-    *err = util::StrCat("The interval ", path, " has ",
-                        std::to_string(cval.arg_size()),
+    *err = util::StrCat("The interval ", path, " has ", cval.arg_size(),
                         " arguments but should have two.");
     return false;
   }
@@ -261,9 +260,8 @@ bool IsTuple(const AST& type, const CompositeAST& cval, const string& path,
              string* err) {
   CHECK(type.c_ast().op() == Operator::TUPLE, "");
   if (cval.arg_size() != type.c_ast().arg_size()) {
-    *err = util::StrCat(path, " has ", std::to_string(cval.arg_size()),
-                        " instead of ", std::to_string(type.c_ast().arg_size()),
-                        ".");
+    *err = util::StrCat(path, " has ", cval.arg_size(), " instead of ",
+                        type.c_ast().arg_size(), ".");
     return false;
   }
   bool is_typed = true;
@@ -323,6 +321,129 @@ bool IsTyped(const Types& types, const TaggedAST& val, string* err) {
   return IsTypedInternal(type_it->second, val.ast(), "", err);
 }
 
+CompiledType::CompiledType(const AST& type) : type_(type) {
+  string err;
+  CHECK(IsTypeInternal(type_, "", &err), err);
+  nodes_.resize(1);
+  Compile(type_, 0);
+}
+
+// The arguments of a node are laid out contiguously, so the positions of all
+// arguments of a node are reserved before the subtree of any argument is
+// compiled. Positions are used instead of references because reserving
+// positions may reallocate 'nodes_'.
+void CompiledType::Compile(const AST& type, int pos) {
+  Node node;
+  node.is_nullable = type.is_nullable();
+  node.node_case = type.node_case();
+  node.primitive_type = type.has_p_ast() ? type.p_ast().type()
+                                         : PrimitiveType::BOOL;
+  node.op = type.has_c_ast() ? type.c_ast().op() : Operator::TUPLE;
+  node.num_args = type.has_c_ast() ? type.c_ast().arg_size() : 0;
+  node.first_arg = static_cast<int>(nodes_.size());
+  nodes_[pos] = node;
+  nodes_.resize(nodes_.size() + node.num_args);
+  for (int i = 0; i < node.num_args; ++i) {
+    Compile(type.c_ast().arg(i), node.first_arg + i);
+  }
+}
+
+// This function mirrors IsTypedInternal and the functions it calls.
+bool CompiledType::Matches(int pos, const AST& val) const {
+  const Node& node = nodes_[pos];
+  switch (val.node_case()) {
+    case AST::NodeCase::NODE_NOT_SET:
+      return node.node_case == AST::NodeCase::NODE_NOT_SET;
+    case AST::NodeCase::kPAst: {
+      if (node.node_case != AST::NodeCase::kPAst ||
+          node.primitive_type != val.p_ast().type()) {
+        return false;
+      }
+      if (!val.p_ast().has_val()) {
+        return node.is_nullable;
+      }
+      return value::IsPrimitive(node.primitive_type, val.p_ast().val());
+    }
+    case AST::NodeCase::kCAst: {
+      const CompositeAST& cval = val.c_ast();
+      if (node.node_case != AST::NodeCase::kCAst || node.op != cval.op()) {
+        return false;
+      }
+      if (cval.arg_size() <= 0) {
+        return node.is_nullable;
+      }
+      switch (node.op) {
+        case Operator::INTERVAL:
+          return cval.arg_size() == 2 && Matches(node.first_arg, cval.arg(0)) &&
+                 Matches(node.first_arg, cval.arg(1));
+        case Operator::LIST:
+        case Operator::SET:
+          for (const AST& arg : cval.arg()) {
+            if (!Matches(node.first_arg, arg)) {
+              return false;
+            }
+          }
+          return true;
+        case Operator::TUPLE:
+          if (cval.arg_size() != node.num_args) {
+            return false;
+          }
+          for (int i = 0; i < cval.arg_size(); ++i) {
+            if (!Matches(node.first_arg + i, cval.arg(i))) {
+              return false;
+            }
+          }
+          return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool CompiledType::IsTyped(const AST& val, string* err) const {
+  CHECK(err != nullptr, "");
+  err->clear();
+  if (Matches(0, val)) {
+    return true;
+  }
+  // Compute the error message with the uncompiled type checker.
+  return IsTypedInternal(type_, val, "", err);
+}
+
+bool CompiledType::Matches(const TaggedAST& val) const {
+  if (!val.has_ast()) {
+    return nodes_[0].is_nullable;
+  }
+  return Matches(0, val.ast());
+}
+
+CompiledTypes Compile(const Types& types) {
+  CompiledTypes compiled_types;
+  for (const auto& type : types) {
+    compiled_types.insert({type.first, CompiledType(type.second)});
+  }
+  return compiled_types;
+}
+
+bool IsTyped(const CompiledTypes& compiled_types, const TaggedAST& val,
+             string* err) {
+  CHECK(err != nullptr, "");
+  err->clear();
+  auto type_it = compiled_types.find(val.tag());
+  if (type_it == compiled_types.end()) {
+    *err = util::StrCat(kNoTagErr, val.tag());
+    return false;
+  }
+  const CompiledType& compiled_type = type_it->second;
+  if (compiled_type.Matches(val)) {
+    return true;
+  }
+  if (!val.has_ast()) {
+    return IsNullable(compiled_type.type(), "", err);
+  }
+  return IsTypedInternal(compiled_type.type(), val.ast(), "", err);
+}
+
 }  // namespace type
 }  // namespace ast
 }  // namespace morphie
@@ -74,6 +74,7 @@
 #define LOGLE_TYPE_CHECKER_H_
 
 #include <map>
+#include <vector>
 
 #include "base/string.h"
 #include "ast.pb.h"
@@ -118,6 +119,59 @@ bool IsTyped(const AST& type, const AST& val, string* err);
   //   - Requires 'err' to be non-null.
 bool IsTyped(const Types& types, const TaggedAST& val, string* err);
 
+// A CompiledType is a type that has been checked once and flattened into an
+// array, so that checking whether a value is of that type does not validate the
+// type again, does not walk the type proto and does not construct error
+// messages unless the check fails. Checking a tuple of primitive values, for
+// example, is a comparison of each field against one array entry.
+class CompiledType {
+ public:
+  // Crashes if 'type' does not represent a type.
+  explicit CompiledType(const AST& type);
+
+  // Returns the same result as IsTyped(type, val, err) for the type this
+  // object was constructed from. The error message is computed only if the
+  // check fails.
+  //   - Requires 'err' to be non-null.
+  bool IsTyped(const AST& val, string* err) const;
+  // Returns true if 'val' is of this type, treating a TaggedAST without an AST
+  // like IsTyped(const Types&, ...) does, and false otherwise.
+  bool Matches(const TaggedAST& val) const;
+  const AST& type() const { return type_; }
+
+ private:
+  // A node of the flattened type. The arguments of a composite type are the
+  // nodes at positions 'first_arg' to 'first_arg + num_args - 1'.
+  struct Node {
+    bool is_nullable;
+    AST::NodeCase node_case;
+    PrimitiveType primitive_type;
+    Operator op;
+    int first_arg;
+    int num_args;
+  };
+
+  // Stores the node for 'type' at position 'pos' and appends the nodes for its
+  // arguments.
+  void Compile(const AST& type, int pos);
+  bool Matches(int pos, const AST& val) const;
+
+  AST type_;
+  std::vector<Node> nodes_;
+};
+
+// Maps tags to compiled types, in the same way that Types maps tags to types.
+using CompiledTypes = std::map<string, CompiledType>;
+
+// Returns the compiled version of every type in 'types'.
+// - Crashes if 'types' contains an AST that is not a type.
+CompiledTypes Compile(const Types& types);
+// Returns the same result as IsTyped(types, val, err), where 'types' is the map
+// that 'compiled_types' was compiled from.
+//   - Requires 'err' to be non-null.
+bool IsTyped(const CompiledTypes& compiled_types, const TaggedAST& val,
+             string* err);
+
 }  // namespace type
 }  // namespace ast
 }  // namespace morphie
@@ -672,6 +672,89 @@ TEST_F(TypeCheckerTest, TypedPair) {
   EXPECT_TRUE(IsTyped(types_, data_, &err_));
 }
 
+// Returns true if checking 'data' against the compiled version of 'types'
+// gives the same result and error message as IsTyped.
+bool CompiledCheckAgrees(const Types& types, const TaggedAST& data) {
+  string err, compiled_err;
+  bool is_typed = IsTyped(types, data, &err);
+  bool is_compiled_typed = IsTyped(Compile(types), data, &compiled_err);
+  return is_typed == is_compiled_typed && err == compiled_err;
+}
+
+TEST(TypeCheckerDeathTest, NonTypeToCompiledType) {
+  AST ast;
+  EXPECT_DEATH({ CompiledType compiled(ast); }, ".*");
+}
+
+TEST_F(TypeCheckerTest, CompiledPrimitiveTypes) {
+  tag_ = "Tag";
+  MakeNullableType(tag_, PrimitiveType::INT);
+  data_.set_tag(tag_);
+  EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+  data_.mutable_ast()->mutable_p_ast()->set_type(PrimitiveType::INT);
+  EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+  data_.mutable_ast()->mutable_p_ast()->mutable_val()->set_int_val(3);
+  EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+  data_.mutable_ast()->mutable_p_ast()->mutable_val()->set_bool_val(true);
+  EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+  types_[tag_].set_is_nullable(false);
+  data_.clear_ast();
+  EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+  data_.set_tag("Other");
+  EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+}
+
+TEST_F(TypeCheckerTest, CompiledCompositeTypes) {
+  for (Operator op : {Operator::INTERVAL, Operator::LIST, Operator::SET,
+                      Operator::TUPLE}) {
+    for (int num_args = 0; num_args < 4; ++num_args) {
+      types_.clear();
+      SetUpCompositeData(op, num_args);
+      EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+      types_[tag_].set_is_nullable(false);
+      EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+      if (num_args > 0) {
+        AST* arg = data_.mutable_ast()->mutable_c_ast()->mutable_arg(0);
+        arg->mutable_p_ast()->set_type(PrimitiveType::BOOL);
+        EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+      }
+    }
+  }
+}
+
+// A tuple containing a list and a primitive is flattened with the arguments of
+// each node stored contiguously.
+TEST_F(TypeCheckerTest, CompiledNestedTypes) {
+  SetUpCompositeData(Operator::TUPLE, 0);
+  AST& tuple_type = types_[tag_];
+  tuple_type.mutable_c_ast()->clear_arg();
+  AST* list_type = tuple_type.mutable_c_ast()->add_arg();
+  list_type->set_name("list");
+  list_type->set_is_nullable(false);
+  list_type->mutable_c_ast()->set_op(Operator::LIST);
+  AST* elem_type = list_type->mutable_c_ast()->add_arg();
+  elem_type->set_name("elem");
+  elem_type->set_is_nullable(false);
+  elem_type->mutable_p_ast()->set_type(PrimitiveType::STRING);
+  AST* int_type = tuple_type.mutable_c_ast()->add_arg();
+  int_type->set_name("count");
+  int_type->set_is_nullable(false);
+  int_type->mutable_p_ast()->set_type(PrimitiveType::INT);
+  CompositeAST* tuple = data_.mutable_ast()->mutable_c_ast();
+  CompositeAST* list = tuple->add_arg()->mutable_c_ast();
+  list->set_op(Operator::LIST);
+  list->add_arg()->mutable_p_ast()->set_type(PrimitiveType::STRING);
+  list->mutable_arg(0)->mutable_p_ast()->mutable_val()->set_string_val("a");
+  AST* count = tuple->add_arg();
+  count->mutable_p_ast()->set_type(PrimitiveType::INT);
+  count->mutable_p_ast()->mutable_val()->set_int_val(1);
+  EXPECT_TRUE(IsTyped(Compile(types_), data_, &err_));
+  EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+  list->add_arg()->mutable_p_ast()->set_type(PrimitiveType::INT);
+  EXPECT_FALSE(IsTyped(Compile(types_), data_, &err_));
+  EXPECT_TRUE(CompiledCheckAgrees(types_, data_));
+}
+
 }  // namespace
 }  // namespace type
 }  // namespace ast
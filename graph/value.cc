@@ -16,6 +16,7 @@
 #include "graph/value.h"
 
 #include <algorithm>
+#include <utility>
 
 #include "graph/ast.h"
 #include "graph/type_checker.h"
@@ -33,6 +34,7 @@ const char kContainerSizeErr[] = "A size is only defined for containers.";
 const char kListTypeErr[] = "The AST 'type' must be a list type.";
 const char kSetTypeErr[] = "The AST 'type' must be a set type.";
 const char kTupleTypeErr[] = "The AST 'type' must be a tuple type.";
+const char kArenaErr[] = "The arena must not be null.";
 
 void SetBoolIntervalBound(bool val, bool is_lower, AST* ast) {
   CHECK(ast != nullptr, "");
@@ -77,6 +79,33 @@ void AppendToContainer(const AST& type, const AST& arg, AST* container) {
   *end = arg;
 }
 
+// Checks the arguments of Append with a type that has already been checked.
+void CheckValidatedList(const AST& type, const AST& arg, const AST* list) {
+  CHECK(ast::IsList(type), kListTypeErr);
+  CHECK(list != nullptr, "");
+  string err;
+  CHECK((type::IsTyped(type.c_ast().arg(0), arg, &err)), err);
+}
+
+// Returns the field 'field_num' of '*tuple' after checking the arguments of
+// SetField, except for whether 'type' is a type.
+AST* UncheckedTypeField(const AST& type, int field_num, AST* tuple) {
+  CHECK(ast::IsTuple(type), kTupleTypeErr);
+  CHECK(tuple != nullptr, "");
+  CHECK(field_num >= 0, "");
+  CHECK(field_num < type.c_ast().arg_size(), "");
+  CHECK(tuple->c_ast().arg_size() == type.c_ast().arg_size(), "");
+  return tuple->mutable_c_ast()->mutable_arg(field_num);
+}
+
+// Returns the field 'field_num' of '*tuple' after checking the arguments of
+// SetField.
+AST* CheckedField(const AST& type, int field_num, AST* tuple) {
+  string err;
+  CHECK((type::IsType(type, &err)), err);
+  return UncheckedTypeField(type, field_num, tuple);
+}
+
 }  // namespace
 
 AST MakeNull() {
@@ -108,6 +137,12 @@ AST MakeString(const string& val) {
   return ast;
 }
 
+AST MakeString(string&& val) {
+  AST ast = MakePrimitiveNull(PrimitiveType::STRING);
+  ast.mutable_p_ast()->mutable_val()->set_string_val(std::move(val));
+  return ast;
+}
+
 AST MakeTimestampFromUnixMicros(int64_t val) {
   AST ast = MakePrimitiveNull(PrimitiveType::TIMESTAMP);
   ast.mutable_p_ast()->mutable_val()->set_time_val(val);
@@ -241,19 +276,85 @@ void Insert(const AST& type, const AST& arg, AST* set) {
   CheckContainer(Operator::SET, type, arg, set);
   AST new_arg = arg;
   Canonicalize(&new_arg);
-  string arg_str = new_arg.SerializeAsString();
-
+  // Compare hashes before comparing canonical elements so that most elements
+  // that differ from the argument are rejected without a traversal.
+  const size_t arg_hash = ast::Hash(new_arg);
   bool has_arg = std::any_of(set->mutable_c_ast()->mutable_arg()->begin(),
                              set->mutable_c_ast()->mutable_arg()->end(),
-                             [&arg_str](AST& old_arg) {
+                             [&new_arg, arg_hash](AST& old_arg) {
                                Canonicalize(&old_arg);
-                               return old_arg.SerializeAsString() == arg_str;
+                               return ast::Hash(old_arg) == arg_hash &&
+                                      ast::Equal(old_arg, new_arg);
                              });
   if (!has_arg) {
     AppendToContainer(type, new_arg, set);
   }
 }
 
+void InsertAll(const AST& type, const std::vector<AST>& args, AST* set) {
+  CHECK(set != nullptr, "");
+  string err;
+  CHECK((IsValue(*set, &err)), err);
+  SetBuilder builder(type);
+  for (const AST& arg : set->c_ast().arg()) {
+    builder.Insert(arg);
+  }
+  for (const AST& arg : args) {
+    builder.Insert(arg);
+  }
+  *set = builder.Build();
+}
+
+SetBuilder::SetBuilder(const AST& type)
+    : arg_type_(ast::IsSet(type) ? type.c_ast().arg(0) : AST()),
+      index_(0, IndexHash{this}, IndexEqual{this}) {
+  CHECK(ast::IsSet(type), kSetTypeErr);
+  string err;
+  CHECK((type::IsType(type, &err)), err);
+}
+
+bool SetBuilder::IndexEqual::operator()(int index1, int index2) const {
+  return ast::Equal(builder->elements_[index1], builder->elements_[index2]);
+}
+
+void SetBuilder::Insert(const AST& arg) {
+  string err;
+  CHECK((type::IsTyped(arg_type_, arg, &err)), err);
+  elements_.push_back(arg);
+  AddLastElement();
+}
+
+void SetBuilder::Insert(AST&& arg) {
+  string err;
+  CHECK((type::IsTyped(arg_type_, arg, &err)), err);
+  elements_.emplace_back();
+  elements_.back().Swap(&arg);
+  AddLastElement();
+}
+
+void SetBuilder::AddLastElement() {
+  Canonicalize(&elements_.back());
+  hashes_.push_back(ast::Hash(elements_.back()));
+  if (!index_.insert(static_cast<int>(elements_.size()) - 1).second) {
+    elements_.pop_back();
+    hashes_.pop_back();
+  }
+}
+
+// Canonicalizing the set sorts its elements, which are already canonical and
+// distinct.
+AST SetBuilder::Build() {
+  AST set = MakeEmptySet();
+  for (AST& element : elements_) {
+    set.mutable_c_ast()->add_arg()->Swap(&element);
+  }
+  index_.clear();
+  elements_.clear();
+  hashes_.clear();
+  Canonicalize(&set);
+  return set;
+}
+
 AST MakeNullTuple(int num_fields) {
   CHECK(num_fields >= 0, "");
   AST ast = MakeCompositeNull(Operator::TUPLE);
@@ -264,15 +365,82 @@ AST MakeNullTuple(int num_fields) {
 }
 
 void SetField(const AST& type, int field_num, const AST& arg, AST* tuple) {
-  CHECK(ast::IsTuple(type), kTupleTypeErr);
+  *CheckedField(type, field_num, tuple) = arg;
+}
+
+// Swap() exchanges pointers if both messages are on the same arena and falls
+// back to copying otherwise.
+void Append(const AST& type, AST&& arg, AST* list) {
+  CheckContainer(Operator::LIST, type, arg, list);
+  list->mutable_c_ast()->add_arg()->Swap(&arg);
+}
+
+void SetField(const AST& type, int field_num, AST&& arg, AST* tuple) {
+  CheckedField(type, field_num, tuple)->Swap(&arg);
+}
+
+ValidatedType::ValidatedType(const AST& type) : type_(type) {
   string err;
-  CHECK((type::IsType(type, &err)), err);
-  CHECK(tuple != nullptr, "");
-  CHECK(field_num >= 0, "");
-  CHECK(field_num < type.c_ast().arg_size(), "");
-  CHECK(tuple->c_ast().arg_size() == type.c_ast().arg_size(), "");
-  AST* field = tuple->mutable_c_ast()->mutable_arg(field_num);
-  *field = arg;
+  CHECK((type::IsType(type_, &err)), err);
+}
+
+void Append(const ValidatedType& type, const AST& arg, AST* list) {
+  CheckValidatedList(type.Type(), arg, list);
+  AppendToContainer(type.Type(), arg, list);
+}
+
+void Append(const ValidatedType& type, AST&& arg, AST* list) {
+  CheckValidatedList(type.Type(), arg, list);
+  list->mutable_c_ast()->add_arg()->Swap(&arg);
+}
+
+void SetField(const ValidatedType& type, int field_num, const AST& arg,
+              AST* tuple) {
+  *UncheckedTypeField(type.Type(), field_num, tuple) = arg;
+}
+
+void SetField(const ValidatedType& type, int field_num, AST&& arg,
+              AST* tuple) {
+  UncheckedTypeField(type.Type(), field_num, tuple)->Swap(&arg);
+}
+
+AST* MakeNull(google::protobuf::Arena* arena) {
+  CHECK(arena != nullptr, kArenaErr);
+  return google::protobuf::Arena::CreateMessage<AST>(arena);
+}
+
+AST* MakePrimitiveNull(PrimitiveType ptype, google::protobuf::Arena* arena) {
+  AST* ast = MakeNull(arena);
+  ast->mutable_p_ast()->set_type(ptype);
+  return ast;
+}
+
+AST* MakeString(const string& val, google::protobuf::Arena* arena) {
+  AST* ast = MakePrimitiveNull(PrimitiveType::STRING, arena);
+  ast->mutable_p_ast()->mutable_val()->set_string_val(val);
+  return ast;
+}
+
+AST* MakeTimestampFromUnixMicros(int64_t val, google::protobuf::Arena* arena) {
+  AST* ast = MakePrimitiveNull(PrimitiveType::TIMESTAMP, arena);
+  ast->mutable_p_ast()->mutable_val()->set_time_val(val);
+  return ast;
+}
+
+AST* MakeEmptyList(google::protobuf::Arena* arena) {
+  AST* ast = MakeNull(arena);
+  ast->mutable_c_ast()->set_op(Operator::LIST);
+  return ast;
+}
+
+AST* MakeNullTuple(int num_fields, google::protobuf::Arena* arena) {
+  CHECK(num_fields >= 0, "");
+  AST* ast = MakeNull(arena);
+  ast->mutable_c_ast()->set_op(Operator::TUPLE);
+  for (int i = 0; i < num_fields; ++i) {
+    ast->mutable_c_ast()->add_arg();
+  }
+  return ast;
 }
 
 }  // namespace value
@@ -32,6 +32,10 @@
 #define LOGLE_VALUE_H_
 
 #include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include <google/protobuf/arena.h>
 
 #include "base/string.h"
 #include "ast.pb.h"
@@ -55,6 +59,8 @@ AST MakePrimitiveNull(PrimitiveType ptype);
 AST MakeBool(bool val);
 AST MakeInt(int val);
 AST MakeString(const string& val);
+// Moves 'val' into the AST instead of copying it.
+AST MakeString(string&& val);
 AST MakeTimestampFromUnixMicros(int64_t val);
 
 // Constructs a timestamp AST from an RFC3339 timestamp. Returns a null
@@ -127,9 +133,70 @@ AST MakeEmptySet();
 // Complexity: linear time in the number of set elements and size of these
 // elements. This method checks if an element is already in '*set' by
 // traversing and canonicalizing set elements. Since these sets are intended
-// to be extremely small, a naive implementation is used for now.
+// to be extremely small, a naive implementation is used for now. Use InsertAll
+// or a SetBuilder to construct large sets.
 void Insert(const AST& type, const AST& arg, AST* set);
 
+// Inserts every element of 'args' into '*set'. Has the same requirements as
+// Insert for every element of 'args', and leaves '*set' in canonical form (see
+// graph/value_checker.h), so the order of its elements may change.
+// Complexity: O(n log n) comparisons of serialized elements, where n is the
+// size of the resulting set, instead of the O(n^2) of repeated calls to Insert.
+void InsertAll(const AST& type, const std::vector<AST>& args, AST* set);
+
+// A SetBuilder constructs a set value from elements that are added one at a
+// time. Duplicates are detected by hashing elements in canonical form as they
+// are added, and the set is sorted once when it is built.
+//
+// Example.
+//   AST type = type::MakeSet("files", false, type::MakeString("file", false));
+//   SetBuilder builder(type);
+//   for (const string& file : files) {
+//     builder.Insert(MakeString(file));
+//   }
+//   AST file_set = builder.Build();
+class SetBuilder {
+ public:
+  // - Crashes unless 'type' is a type of the form set(arg_type).
+  explicit SetBuilder(const AST& type);
+  SetBuilder(const SetBuilder&) = delete;
+  SetBuilder& operator=(const SetBuilder&) = delete;
+
+  // Adds 'arg' to the set unless an equal element has been added.
+  // - Crashes unless 'arg' is a value of type 'arg_type'.
+  // Complexity: linear in the size of 'arg' and constant in the size of the
+  // set, in expectation.
+  void Insert(const AST& arg);
+  // Behaves like the function above but moves 'arg' into the builder. The
+  // contents of 'arg' are unspecified afterwards.
+  void Insert(AST&& arg);
+  // Returns the number of distinct elements added since the builder was
+  // constructed or last built.
+  int Size() const { return static_cast<int>(elements_.size()); }
+  // Returns the set of the distinct elements added since the builder was
+  // constructed or last built, in canonical form, and empties the builder.
+  AST Build();
+
+ private:
+  // Hashes and compares the elements in 'elements_' with the given indexes.
+  struct IndexHash {
+    const SetBuilder* builder;
+    size_t operator()(int index) const { return builder->hashes_[index]; }
+  };
+  struct IndexEqual {
+    const SetBuilder* builder;
+    bool operator()(int index1, int index2) const;
+  };
+
+  // Adds the canonical element 'elements_.back()' unless it is a duplicate.
+  void AddLastElement();
+
+  const AST arg_type_;
+  std::vector<AST> elements_;
+  std::vector<size_t> hashes_;
+  std::unordered_set<int, IndexHash, IndexEqual> index_;
+};
+
 // Return a tuple with 'num_fields' uninitialized fields. Complexity: constant
 // time.
 AST MakeNullTuple(int num_fields);
@@ -143,6 +210,54 @@ AST MakeNullTuple(int num_fields);
 // not be initialized.
 void SetField(const AST& type, int field_num, const AST& arg, AST* tuple);
 
+// The functions below behave like the functions above but move 'arg' into the
+// container instead of copying it. Moving is constant time if 'arg' and the
+// container are allocated on the same arena, or both on the heap, and copies
+// 'arg' otherwise. The contents of 'arg' are unspecified afterwards.
+void Append(const AST& type, AST&& arg, AST* list);
+void SetField(const AST& type, int field_num, AST&& arg, AST* tuple);
+
+// A ValidatedType is a type that has been checked once, when it was
+// constructed. The functions below that accept a ValidatedType instead of a
+// type do not check the type again, so that a label constructed for every
+// record of an input only costs the writes of its fields. Construct a
+// ValidatedType when a graph is initialized and reuse it for every label.
+class ValidatedType {
+ public:
+  // - Crashes unless 'type' is a type.
+  explicit ValidatedType(const AST& type);
+
+  const AST& Type() const { return type_; }
+
+ private:
+  const AST type_;
+};
+
+// The functions below behave like the functions with the same names above, but
+// do not check that 'type' is a type or that '*list' is a value, so their
+// complexity does not depend on the size of 'type' or '*list'. Append still
+// checks that 'arg' is a value of type 'arg_type'.
+void Append(const ValidatedType& type, const AST& arg, AST* list);
+void Append(const ValidatedType& type, AST&& arg, AST* list);
+void SetField(const ValidatedType& type, int field_num, const AST& arg,
+              AST* tuple);
+void SetField(const ValidatedType& type, int field_num, AST&& arg, AST* tuple);
+
+// Arena allocation. The functions below return the same values as the
+// functions with the same names above, but construct them on 'arena'. The
+// returned AST is owned by 'arena' and is destroyed when 'arena' is reset or
+// destroyed. Constructing the labels of an event on an arena that is reset
+// after the labels have been added to a graph avoids allocating and freeing
+// memory for every part of every label, because a graph copies a label it does
+// not already contain and only looks up a label it does contain.
+// - Require that 'arena' is not null.
+AST* MakeNull(google::protobuf::Arena* arena);
+AST* MakePrimitiveNull(PrimitiveType ptype, google::protobuf::Arena* arena);
+AST* MakeString(const string& val, google::protobuf::Arena* arena);
+AST* MakeTimestampFromUnixMicros(int64_t val, google::protobuf::Arena* arena);
+AST* MakeEmptyList(google::protobuf::Arena* arena);
+AST* MakeNullTuple(int num_fields, google::protobuf::Arena* arena);
+
 }  // namespace value
 }  // namespace ast
 }  // namespace morphie
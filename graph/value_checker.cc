@@ -106,13 +106,13 @@ bool IsContainerLike(const CompositeAST& c_ast, const string& path,
   bool is_value = true;
   string new_path;
   for (int i = 0; i < c_ast.arg_size() && is_value; ++i) {
-    new_path = util::StrCat(path, "(", std::to_string(i), ")");
+    new_path = util::StrCat(path, "(", i, ")");
     is_value = (is_value && IsValueInternal(c_ast.arg(i), new_path, err));
   }
   return is_value;
 }
 
-bool IsomorphicPrimitive(PrimitiveAST val1, PrimitiveAST val2) {
+bool IsomorphicPrimitive(const PrimitiveAST& val1, const PrimitiveAST& val2) {
   if (val1.type() == val2.type()) {
     if (!val1.has_val() && !val2.has_val()) {
       return true;
@@ -133,17 +133,35 @@ bool IsomorphicPrimitive(PrimitiveAST val1, PrimitiveAST val2) {
   return false;
 }
 
-bool IsomorphicComposite(CompositeAST val1, CompositeAST val2) {
+bool IsomorphicInternal(const AST& val1, const AST& val2);
+
+bool IsomorphicComposite(const CompositeAST& val1, const CompositeAST& val2) {
   if (val1.op() != val2.op() || val1.arg_size() != val2.arg_size()) {
     return false;
   }
   bool is_isomorphic = true;
   for (int i = 0; i < val1.arg_size() && is_isomorphic; ++i) {
-    is_isomorphic = Isomorphic(val1.arg(i), val2.arg(i));
+    is_isomorphic = IsomorphicInternal(val1.arg(i), val2.arg(i));
   }
   return is_isomorphic;
 }
 
+// The recursive functions below do not check that their arguments are values
+// because the public functions check the whole AST once.
+bool IsomorphicInternal(const AST& val1, const AST& val2) {
+  if (ast::IsNull(val1) && ast::IsNull(val2)) {
+    return true;
+  } else if (val1.has_p_ast() && val2.has_p_ast()) {
+    return IsomorphicPrimitive(val1.p_ast(), val2.p_ast());
+  } else if (val1.has_c_ast() && val2.has_c_ast()) {
+    return IsomorphicComposite(val1.c_ast(), val2.c_ast());
+  } else {
+    return false;
+  }
+}
+
+void CanonicalizeInternal(AST* val);
+
 void CanonicalizeInterval(CompositeAST* val) {
   CHECK(val->op() == Operator::INTERVAL, "");
   CHECK(val->arg_size() == 2, "");
@@ -157,31 +175,45 @@ void CanonicalizeInterval(CompositeAST* val) {
 void CanonicalizeContainer(CompositeAST* val) {
   CHECK(val->op() == Operator::LIST || val->op() == Operator::TUPLE, "");
   for (AST& ast : *(val->mutable_arg())) {
-    Canonicalize(&ast);
+    CanonicalizeInternal(&ast);
   }
 }
 
-// Sort the argument list of a set and remove duplicates.
+// Sort the argument list of a set and remove duplicates. Each argument is
+// serialized once and the arguments are sorted by their serializations, which
+// also determine duplicates. Arguments are moved and not parsed back from
+// their serializations, and a set that is already sorted is not modified.
 void CanonicalizeSet(CompositeAST* val) {
   CHECK(val->op() == Operator::SET, "");
-  std::vector<string> elements;
-  elements.reserve(val->arg_size());
-  string serialized_val;
-  for (AST& arg : *(val->mutable_arg())) {
-    Canonicalize(&arg);
-    arg.SerializeToString(&serialized_val);
-    elements.push_back(serialized_val);
+  const int num_args = val->arg_size();
+  std::vector<string> keys(num_args);
+  bool is_sorted = true;
+  for (int i = 0; i < num_args; ++i) {
+    AST* arg = val->mutable_arg(i);
+    CanonicalizeInternal(arg);
+    arg->SerializeToString(&keys[i]);
+    is_sorted = is_sorted && (i == 0 || keys[i - 1] < keys[i]);
+  }
+  if (is_sorted) {
+    return;
+  }
+  std::vector<int> order(num_args);
+  for (int i = 0; i < num_args; ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            [&keys](int i, int j) { return keys[i] < keys[j]; });
+  auto end_itr =
+      std::unique(order.begin(), order.end(),
+                  [&keys](int i, int j) { return keys[i] == keys[j]; });
+  order.erase(end_itr, order.end());
+  std::vector<AST> args(order.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    args[i].Swap(val->mutable_arg(order[i]));
   }
-  std::sort(elements.begin(), elements.end());
-  auto end_itr = std::unique(elements.begin(), elements.end());
-  elements.erase(end_itr, elements.end());
   val->clear_arg();
-  AST arg;
-  AST* arg_ptr;
-  for (const auto& str_val : elements) {
-    arg.ParseFromString(str_val);
-    arg_ptr = val->add_arg();
-    *arg_ptr = arg;
+  for (AST& arg : args) {
+    val->add_arg()->Swap(&arg);
   }
 }
 
@@ -201,6 +233,12 @@ void CanonicalizeComposite(CompositeAST* val) {
   }
 }
 
+void CanonicalizeInternal(AST* val) {
+  if (val->has_c_ast()) {
+    CanonicalizeComposite(val->mutable_c_ast());
+  }
+}
+
 }  // namespace
 
 bool IsValue(const AST& ast, string* err) {
@@ -242,25 +280,14 @@ bool LT(const PrimitiveAST& val1, const PrimitiveAST& val2) {
 bool Isomorphic(const AST& val1, const AST& val2) {
   string tmp_err;
   CHECK(IsValue(val1, &tmp_err), "");
-  CHECK(IsValue(val1, &tmp_err), "");
-  if (ast::IsNull(val1) && ast::IsNull(val2)) {
-    return true;
-  } else if (val1.has_p_ast() && val2.has_p_ast()) {
-    return IsomorphicPrimitive(val1.p_ast(), val2.p_ast());
-  } else if (val1.has_c_ast() && val2.has_c_ast()) {
-    return IsomorphicComposite(val1.c_ast(), val2.c_ast());
-  } else {
-    return false;
-  }
+  return IsomorphicInternal(val1, val2);
 }
 
 void Canonicalize(AST* val) {
   CHECK(val != nullptr, "");
   string tmp_err;
   CHECK(IsValue(*val, &tmp_err), "");
-  if (val->has_c_ast()) {
-    CanonicalizeComposite(val->mutable_c_ast());
-  }
+  CanonicalizeInternal(val);
 }
 
 }  // namespace value
@@ -12,6 +12,7 @@
 // License for the specific language governing permissions and limitations under
 // the License.
 
+#include <algorithm>
 #include <map>
 
 #include "base/string.h"
@@ -596,6 +597,27 @@ TEST(CanonicalizerTest, SetCanonicalization) {
   EXPECT_TRUE(Isomorphic(set1, set2));
 }
 
+// Permutations of a set with duplicates, whose elements are sets, have the
+// same canonical form, and canonicalizing a canonical set does not change it.
+TEST(CanonicalizerTest, NestedSetCanonicalization) {
+  std::vector<AST> inner(3);
+  MakeIntContainer(Operator::SET, {2, 1}, &inner[0]);
+  MakeIntContainer(Operator::SET, {1, 2, 1}, &inner[1]);
+  MakeIntContainer(Operator::SET, {3}, &inner[2]);
+  AST set1, set2;
+  MakeCompositeContainer(Operator::SET, inner, &set1);
+  std::reverse(inner.begin(), inner.end());
+  MakeCompositeContainer(Operator::SET, inner, &set2);
+  EXPECT_FALSE(Isomorphic(set1, set2));
+  Canonicalize(&set1);
+  Canonicalize(&set2);
+  EXPECT_TRUE(Isomorphic(set1, set2));
+  EXPECT_EQ(2, set1.c_ast().arg_size());
+  AST canonical = set1;
+  Canonicalize(&canonical);
+  EXPECT_TRUE(Isomorphic(set1, canonical));
+}
+
 TEST(CanonicalizerTest, TupleCanonicalization) {
   AST itv1;
   AST one;
@@ -14,6 +14,10 @@
 
 #include "value.h"
 
+#include <utility>
+#include <vector>
+
+#include "ast.h"
 #include "gtest.h"
 #include "type.h"
 #include "type_checker.h"
@@ -320,6 +324,48 @@ TEST_F(ValueTest, ConstructsSets) {
   EXPECT_EQ(Size(val_), 2);
 }
 
+// A SetBuilder and InsertAll construct the same canonical set as repeated
+// calls to Insert, regardless of the order and multiplicity of the elements.
+TEST_F(ValueTest, BuildsSets) {
+  type_ = type::MakeSet("foo", true, type::MakeInt("Element", true));
+  AST expected = MakeEmptySet();
+  for (int i = 0; i < 100; ++i) {
+    Insert(type_, MakeInt(i), &expected);
+  }
+  Canonicalize(&expected);
+  SetBuilder builder(type_);
+  std::vector<AST> elements;
+  for (int i = 99; i >= 0; --i) {
+    builder.Insert(MakeInt(i));
+    builder.Insert(MakeInt(i % 10));
+    elements.push_back(MakeInt(i));
+  }
+  EXPECT_EQ(100, builder.Size());
+  val_ = builder.Build();
+  EXPECT_TRUE(type::IsTyped(type_, val_, &err_));
+  EXPECT_EQ(100, Size(val_));
+  EXPECT_TRUE(ast::Equal(expected, val_));
+  // Building empties the builder.
+  EXPECT_EQ(0, builder.Size());
+  EXPECT_EQ(0, Size(builder.Build()));
+  // Inserting into a set that contains some of the elements.
+  val_ = MakeEmptySet();
+  Insert(type_, MakeInt(7), &val_);
+  InsertAll(type_, elements, &val_);
+  EXPECT_TRUE(ast::Equal(expected, val_));
+}
+
+TEST(ValueDeathTest, SetBuilderRequiresASetType) {
+  AST type = type::MakeList("foo", true, type::MakeBool("Element", true));
+  EXPECT_DEATH({ SetBuilder builder(type); }, ".*");
+}
+
+TEST(ValueDeathTest, SetBuilderRequiresTypedArgument) {
+  AST type = type::MakeSet("foo", true, type::MakeBool("Element", true));
+  SetBuilder builder(type);
+  EXPECT_DEATH({ builder.Insert(MakeInt(0)); }, ".*");
+}
+
 static AST GetTupleType() {
   std::vector<AST> field_asts;
   field_asts.emplace_back(type::MakeBool("First", true));
@@ -327,6 +373,41 @@ static AST GetTupleType() {
   return type::MakeTuple("Tuple", true, field_asts);
 }
 
+// A ValidatedType constructs the same containers as the type it validates.
+TEST_F(ValueTest, ConstructsContainersWithValidatedTypes) {
+  AST list_type = type::MakeList("foo", true, type::MakeBool("Element", true));
+  ValidatedType validated_list_type(list_type);
+  AST expected = MakeEmptyList();
+  AST list = MakeEmptyList();
+  for (bool val : {true, false, true}) {
+    Append(list_type, MakeBool(val), &expected);
+    Append(validated_list_type, MakeBool(val), &list);
+  }
+  EXPECT_TRUE(ast::Equal(expected, list));
+  AST tuple_type = GetTupleType();
+  ValidatedType validated_tuple_type(tuple_type);
+  expected = MakeNullTuple(2);
+  AST tuple = MakeNullTuple(2);
+  SetField(tuple_type, 0, MakeBool(true), &expected);
+  SetField(tuple_type, 1, MakeString("bar"), &expected);
+  SetField(validated_tuple_type, 0, MakeBool(true), &tuple);
+  AST field = MakeString("bar");
+  SetField(validated_tuple_type, 1, std::move(field), &tuple);
+  EXPECT_TRUE(ast::Equal(expected, tuple));
+  EXPECT_TRUE(type::IsTyped(tuple_type, tuple, &err_));
+}
+
+TEST(ValueDeathTest, ValidatedTypeRequiresAType) {
+  EXPECT_DEATH({ ValidatedType type(MakeBool(false)); }, ".*");
+}
+
+TEST(ValueDeathTest, ValidatedAppendRequiresTypedArgument) {
+  ValidatedType type(
+      type::MakeList("foo", true, type::MakeBool("Element", true)));
+  AST list = MakeEmptyList();
+  EXPECT_DEATH({ Append(type, MakeInt(0), &list); }, ".*");
+}
+
 // Test fatal input arguments requirements of SetField.
 // Crashes if a value is passed as a type.
 TEST(ValueDeathTest, SetFieldRequiresAType) {
@@ -373,6 +454,46 @@ TEST_F(ValueTest, ConstructsTuples) {
   EXPECT_EQ(Size(val_), 2);
 }
 
+// Values constructed on an arena are equal to the values constructed on the
+// heap, including after their parts have been moved into a container.
+TEST_F(ValueTest, ConstructsValuesOnArena) {
+  google::protobuf::Arena arena;
+  EXPECT_TRUE(Equal(MakeNull(), *MakeNull(&arena)));
+  EXPECT_TRUE(Equal(MakePrimitiveNull(PrimitiveType::INT),
+                    *MakePrimitiveNull(PrimitiveType::INT, &arena)));
+  EXPECT_TRUE(Equal(MakeString("foo"), *MakeString("foo", &arena)));
+  EXPECT_TRUE(Equal(MakeTimestampFromUnixMicros(5),
+                    *MakeTimestampFromUnixMicros(5, &arena)));
+  EXPECT_TRUE(Equal(MakeEmptyList(), *MakeEmptyList(&arena)));
+
+  type_ = GetTupleType();
+  val_ = MakeNullTuple(2);
+  SetField(type_, 0, MakeBool(true), &val_);
+  SetField(type_, 1, MakeString("foo"), &val_);
+  AST* tuple = MakeNullTuple(2, &arena);
+  AST* field = MakeNull(&arena);
+  *field = MakeBool(true);
+  SetField(type_, 0, std::move(*field), tuple);
+  SetField(type_, 1, std::move(*MakeString("foo", &arena)), tuple);
+  EXPECT_TRUE(Equal(val_, *tuple));
+
+  AST list_type = type::MakeList("list", false, type::MakeString("s", false));
+  AST list = MakeEmptyList();
+  Append(list_type, MakeString("foo"), &list);
+  AST* arena_list = MakeEmptyList(&arena);
+  Append(list_type, std::move(*MakeString("foo", &arena)), arena_list);
+  EXPECT_TRUE(Equal(list, *arena_list));
+  // Moving a value from the heap into a container on an arena copies it.
+  AST heap_val = MakeString("bar");
+  Append(list_type, std::move(heap_val), arena_list);
+  EXPECT_EQ(2, Size(*arena_list));
+  EXPECT_EQ("bar", GetString(arena_list->c_ast().arg(1)));
+}
+
+TEST(ValueDeathTest, ArenaConstructionRequiresAnArena) {
+  EXPECT_DEATH({ MakeNull(nullptr); }, "The arena must not be null.");
+}
+
 }  // namespace
 }  // namespace value
 }  // namespace ast
@@ -14,17 +14,26 @@
 
 // Logle is a tool for analyzing logs using graph algorithms and graph
 // visualization techniques. It can run one of many different analyses on a log
-// file in either CSV or JSON format.
+// file in either CSV or JSON format. With --server_socket, it instead runs as a
+// server that keeps the graph of a log in memory between analyses, as
+// described in analysis_server.h, and with --batch_options, it runs a batch of
+// analyses concurrently within a memory budget, as described in
+// analysis_batch.h.
 //
 // Development is at an early stage.
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <google/protobuf/text_format.h>
 
+#include "analysis_batch.h"
 #include "analysis_options.pb.h"
+#include "analysis_server.h"
 #include "gflags/gflags.h"
 #include "frontend.h"
+#include "util/compressed_file.h"
 #include "util/status.h"
 
 namespace protobuf = google::protobuf;
@@ -34,22 +43,71 @@ using std::string;
 // Flags that determine which analyzer to use and the options with which to
 // invoke that analyzer.
 DEFINE_string(analysis_options, "", "Analysis options as a protocol buffer.");
+DEFINE_string(server_socket, "",
+              "If set, analysis requests are answered on a Unix domain socket "
+              "at this path instead of running one analysis.");
+DEFINE_string(batch_options, "",
+              "If set, the analyses of this AnalysisBatch protocol buffer are "
+              "run concurrently instead of running one analysis.");
 
-// Returns true and logs an error message if 'value' is empty. This function is
-// called by InitGoogle. More complex validation takes place separately.
-static bool CheckFlagValueNotEmpty(const char* flagname, const string& value) {
-  if (value.empty()) {
-    std::cerr << flagname << " flag must be non-empty.";
-    return false;
+// Runs the batch in 'batch_text' and writes its report. Returns 0 if every job
+// of the batch succeeds and -1 otherwise.
+int RunBatch(const string& batch_text) {
+  morphie::AnalysisBatch batch;
+  if (!protobuf::TextFormat::ParseFromString(batch_text, &batch)) {
+    std::cerr << "The 'batch_options' flag must have the format of an "
+                 "AnalysisBatch proto.";
+    return -1;
+  }
+  std::vector<morphie::frontend::JobResult> results =
+      morphie::frontend::RunBatch(batch);
+  if (batch.has_report_file()) {
+    std::unique_ptr<morphie::util::OutputFileStream> report;
+    morphie::util::Status status =
+        morphie::util::OpenOutputFile(batch.report_file(), &report);
+    if (status.ok()) {
+      morphie::frontend::WriteBatchReport(results, report.get());
+      status = report->Close();
+    }
+    if (!status.ok()) {
+      std::cerr << status.message();
+      return -1;
+    }
+  } else {
+    morphie::frontend::WriteBatchReport(results, &std::cout);
+  }
+  for (const morphie::frontend::JobResult& result : results) {
+    if (!result.status.ok()) {
+      return -1;
+    }
   }
-  return true;
+  return 0;
 }
 
-static bool is_config_empty =
-    google::RegisterFlagValidator(&FLAGS_analysis_options, &CheckFlagValueNotEmpty);
-
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
+  // Exactly one of the flags must be set. More complex validation takes place
+  // separately.
+  if (!FLAGS_analysis_options.empty() + !FLAGS_server_socket.empty() +
+          !FLAGS_batch_options.empty() !=
+      1) {
+    std::cerr << "Exactly one of the 'analysis_options', 'server_socket' and "
+                 "'batch_options' flags must be non-empty.";
+    return -1;
+  }
+  if (!FLAGS_batch_options.empty()) {
+    return RunBatch(FLAGS_batch_options);
+  }
+  if (!FLAGS_server_socket.empty()) {
+    morphie::frontend::Session session;
+    morphie::util::Status status =
+        morphie::frontend::Serve(FLAGS_server_socket, &session);
+    if (!status.ok()) {
+      std::cerr << status.message();
+      return -1;
+    }
+    return 0;
+  }
   morphie::AnalysisOptions options;
   string out;
   if (!protobuf::TextFormat::ParseFromString(FLAGS_analysis_options,
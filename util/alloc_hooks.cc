@@ -0,0 +1,78 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+// Replacements of the global allocation functions that count allocations for
+// util/alloc_profile.h. Linking this file into a binary installs them. The
+// allocations are served by malloc, as by the default functions, and the
+// aligned allocation functions are not replaced, so their allocations are not
+// counted.
+#include <stdlib.h>
+
+#include <new>
+
+#include "util/alloc_profile.h"
+
+namespace {
+
+// Set during static initialization, before main runs.
+const bool kHooksInstalled =
+    (morphie::util::internal::allocation_hooks_installed = true);
+
+void* CountedAllocate(size_t size) {
+  morphie::util::internal::CountAllocation(size);
+  // malloc(0) may return null, which operator new must not.
+  return malloc(size == 0 ? 1 : size);
+}
+
+void* CountedNew(size_t size) {
+  void* ptr = CountedAllocate(size);
+  while (ptr == nullptr) {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+    ptr = malloc(size == 0 ? 1 : size);
+  }
+  return ptr;
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return CountedNew(size); }
+
+void* operator new[](size_t size) { return CountedNew(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete[](void* ptr) noexcept { free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
@@ -0,0 +1,55 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+#include "util/alloc_profile.h"
+
+namespace morphie {
+namespace util {
+
+namespace internal {
+
+std::atomic<bool> allocation_profiling_enabled(false);
+bool allocation_hooks_installed = false;
+
+}  // namespace internal
+
+namespace {
+
+// The counts are constant-initialized, so counting does not allocate, even on
+// the first allocation of a thread.
+thread_local AllocationCounts thread_allocation_counts;
+
+}  // namespace
+
+namespace internal {
+
+void CountAllocation(size_t bytes) {
+  if (allocation_profiling_enabled.load(std::memory_order_relaxed)) {
+    ++thread_allocation_counts.allocations;
+    thread_allocation_counts.bytes += static_cast<int64_t>(bytes);
+  }
+}
+
+}  // namespace internal
+
+void SetAllocationProfiling(bool enabled) {
+  internal::allocation_profiling_enabled.store(enabled,
+                                               std::memory_order_relaxed);
+}
+
+AllocationCounts ThreadAllocationCounts() { return thread_allocation_counts; }
+
+}  // namespace util
+}  // namespace morphie
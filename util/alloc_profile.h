@@ -0,0 +1,89 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+// This file contains an opt-in profiler of heap allocations. A binary that
+// links util/alloc_hooks.cc replaces the global operator new with one that
+// counts, for the calling thread, the number of allocations and the bytes
+// requested while profiling is enabled. Other binaries count nothing, and
+// AllocationHooksInstalled() tells them apart.
+//
+// A ScopedTimer that adds the time of a phase to a Stats object also adds the
+// allocations made by its thread during the phase to the counters
+// "allocations/<phase>" and "allocated_bytes/<phase>" while profiling is
+// enabled, so the allocations of a phase are those of the threads that time
+// the phase. See util/stats.h.
+//
+// Example.
+//   util::SetAllocationProfiling(true);
+//   util::AllocationCounts before = util::ThreadAllocationCounts();
+//   BuildGraph();
+//   util::AllocationCounts counts = util::ThreadAllocationCounts() - before;
+#ifndef LOGLE_UTIL_ALLOC_PROFILE_H_
+#define LOGLE_UTIL_ALLOC_PROFILE_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace morphie {
+namespace util {
+
+// The number of allocations and of bytes requested by them.
+struct AllocationCounts {
+  int64_t allocations = 0;
+  int64_t bytes = 0;
+};
+
+inline AllocationCounts operator-(const AllocationCounts& counts1,
+                                  const AllocationCounts& counts2) {
+  AllocationCounts difference;
+  difference.allocations = counts1.allocations - counts2.allocations;
+  difference.bytes = counts1.bytes - counts2.bytes;
+  return difference;
+}
+
+namespace internal {
+
+extern std::atomic<bool> allocation_profiling_enabled;
+extern bool allocation_hooks_installed;
+
+// Counts an allocation of 'bytes' bytes by the calling thread if profiling is
+// enabled. Called by the hooks, so it must not allocate.
+void CountAllocation(size_t bytes);
+
+}  // namespace internal
+
+// Returns true if the binary links util/alloc_hooks.cc, which is required for
+// allocations to be counted.
+inline bool AllocationHooksInstalled() {
+  return internal::allocation_hooks_installed;
+}
+
+// Enables or disables the counting of allocations in all threads. Profiling
+// is disabled by default.
+void SetAllocationProfiling(bool enabled);
+inline bool IsAllocationProfilingEnabled() {
+  return internal::allocation_profiling_enabled.load(
+      std::memory_order_relaxed);
+}
+
+// Returns the allocations counted for the calling thread since it started.
+AllocationCounts ThreadAllocationCounts();
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_ALLOC_PROFILE_H_
@@ -0,0 +1,79 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+// This test must be linked with util/alloc_hooks.cc.
+#include "util/alloc_profile.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest.h"
+#include "util/stats.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+// The tests store the address of each allocation here, so that an optimizing
+// compiler cannot remove allocations whose memory is never used.
+void* volatile allocation_sink = nullptr;
+
+template <typename T>
+T* Keep(T* pointer) {
+  allocation_sink = pointer;
+  return pointer;
+}
+
+TEST(AllocProfileTest, CountsAllocationsOnlyWhileEnabled) {
+  ASSERT_TRUE(AllocationHooksInstalled());
+  AllocationCounts before = ThreadAllocationCounts();
+  std::unique_ptr<int> disabled(Keep(new int(1)));
+  EXPECT_EQ(0, (ThreadAllocationCounts() - before).allocations);
+  SetAllocationProfiling(true);
+  EXPECT_TRUE(IsAllocationProfilingEnabled());
+  before = ThreadAllocationCounts();
+  std::unique_ptr<int> single(Keep(new int(2)));
+  std::unique_ptr<char[]> array(Keep(new char[100]));
+  AllocationCounts counts = ThreadAllocationCounts() - before;
+  SetAllocationProfiling(false);
+  EXPECT_EQ(2, counts.allocations);
+  EXPECT_EQ(static_cast<int64_t>(sizeof(int)) + 100, counts.bytes);
+}
+
+TEST(AllocProfileTest, ScopedTimersCountAllocationsOfPhases) {
+  Stats stats;
+  {
+    ScopedTimer timer(&stats, "unprofiled");
+    std::vector<int> values(10);
+    Keep(values.data());
+  }
+  SetAllocationProfiling(true);
+  {
+    ScopedTimer timer(&stats, "build");
+    std::vector<int> values(10);
+    Keep(values.data());
+    std::unique_ptr<double> value(Keep(new double(1)));
+  }
+  SetAllocationProfiling(false);
+  std::map<string, int64_t> counts = stats.Counts();
+  EXPECT_EQ(2, counts.size());
+  EXPECT_EQ(2, counts["allocations/build"]);
+  EXPECT_EQ(static_cast<int64_t>(10 * sizeof(int) + sizeof(double)),
+            counts["allocated_bytes/build"]);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
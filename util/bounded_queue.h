@@ -0,0 +1,113 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A BoundedQueue passes items between the stages of a pipeline of threads.
+// Any number of threads may push and pop items concurrently. Pushing blocks
+// while the queue is full, which bounds the memory used by items that a slow
+// stage has not consumed yet, and popping blocks while the queue is empty.
+// Closing the queue tells the consumers that no more items will be pushed.
+//
+// Example.
+//   util::BoundedQueue<string> lines(1024);
+//   std::thread producer([&lines, &input] {
+//     string line;
+//     while (std::getline(input, line)) {
+//       lines.Push(std::move(line));
+//     }
+//     lines.Close();
+//   });
+//   string line;
+//   while (lines.Pop(&line)) {
+//     Process(line);
+//   }
+//   producer.join();
+#ifndef LOGLE_UTIL_BOUNDED_QUEUE_H_
+#define LOGLE_UTIL_BOUNDED_QUEUE_H_
+
+#include <condition_variable>  // NOLINT
+#include <cstddef>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "util/logging.h"
+
+namespace morphie {
+namespace util {
+
+template <typename T>
+class BoundedQueue {
+ public:
+  // - Crashes unless 'capacity' is positive.
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity), closed_(false) {
+    CHECK(capacity > 0, "The capacity of a queue must be positive.");
+  }
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  // Adds 'item' to the back of the queue, waiting while the queue is full.
+  // Returns false, without adding 'item', if the queue is closed.
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock,
+                   [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Removes the item at the front of the queue and moves it to '*item',
+  // waiting while the queue is empty and open. Returns false if the queue is
+  // closed and empty. Items pushed before the queue was closed are still
+  // popped.
+  bool Pop(T* item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // Closes the queue and wakes up every waiting thread.
+  void Close() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+ private:
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> items_;
+  bool closed_;
+};
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_BOUNDED_QUEUE_H_
@@ -0,0 +1,89 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/bounded_queue.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+TEST(BoundedQueueTest, PopsItemsInOrder) {
+  BoundedQueue<int> queue(3);
+  EXPECT_TRUE(queue.Push(1));
+  EXPECT_TRUE(queue.Push(2));
+  int item = 0;
+  EXPECT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(1, item);
+  queue.Close();
+  EXPECT_FALSE(queue.Push(3));
+  // Items pushed before the queue was closed are still popped.
+  EXPECT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(2, item);
+  EXPECT_FALSE(queue.Pop(&item));
+}
+
+// Several producers and consumers pass every item exactly once through a queue
+// that is much smaller than the number of items.
+TEST(BoundedQueueTest, PassesItemsBetweenThreads) {
+  const int kNumProducers = 3;
+  const int kNumConsumers = 3;
+  const int kItemsPerProducer = 10000;
+  BoundedQueue<int> queue(16);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; ++p) {
+    producers.emplace_back([&queue, p, kItemsPerProducer] {
+      for (int i = 0; i < kItemsPerProducer; ++i) {
+        queue.Push(p * kItemsPerProducer + i);
+      }
+    });
+  }
+  std::vector<std::vector<int>> counts(
+      kNumConsumers, std::vector<int>(kNumProducers * kItemsPerProducer, 0));
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < kNumConsumers; ++c) {
+    consumers.emplace_back([&queue, &counts, c] {
+      int item;
+      while (queue.Pop(&item)) {
+        ++counts[c][item];
+      }
+    });
+  }
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+  queue.Close();
+  for (std::thread& consumer : consumers) {
+    consumer.join();
+  }
+  for (int i = 0; i < kNumProducers * kItemsPerProducer; ++i) {
+    int count = 0;
+    for (int c = 0; c < kNumConsumers; ++c) {
+      count += counts[c][i];
+    }
+    EXPECT_EQ(1, count) << i;
+  }
+}
+
+TEST(BoundedQueueDeathTest, RequiresPositiveCapacity) {
+  EXPECT_DEATH({ BoundedQueue<int> queue(0); }, ".*");
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
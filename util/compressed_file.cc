@@ -0,0 +1,687 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/compressed_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef LOGLE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <condition_variable>  // NOLINT
+#include <cstdio>
+#include <fstream>
+#include <mutex>  // NOLINT
+#include <streambuf>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "util/logging.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+namespace util {
+
+namespace {
+
+// The size of each of the two buffers of decompressed data, and of each of the
+// two buffers of output data.
+const size_t kBufferSize = 1 << 20;
+
+// The modes in which output files are opened, which include the compression
+// levels.
+const char kGzipWriteMode[] = "wb1";
+#ifdef LOGLE_HAVE_ZSTD
+const int kZstdLevel = 3;
+#endif
+
+const char kGzipExtension[] = ".gz";
+const char kZstdExtension[] = ".zst";
+
+const char kOpenFileErr[] = "Error opening file: ";
+const char kUnsupportedErr[] =
+    "ZSTD files cannot be read because the tool was built without the ZSTD "
+    "library: ";
+const char kUnsupportedWriteErr[] =
+    "ZSTD files cannot be written because the tool was built without the ZSTD "
+    "library: ";
+const char kReadErr[] = "Error reading compressed file: ";
+const char kWriteErr[] = "Error writing to file: ";
+const char kTruncatedErr[] = "The compressed file is truncated: ";
+
+bool HasSuffix(const string& str, const string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// A Decompressor produces the decompressed contents of a file in parts.
+class Decompressor {
+ public:
+  virtual ~Decompressor() {}
+  // Stores the next part of the decompressed contents in 'buffer', which has
+  // room for 'capacity' bytes, and returns the size of that part. Returns 0 at
+  // the end of the contents.
+  // - Crashes if the file is malformed or cannot be read.
+  virtual size_t Decompress(char* buffer, size_t capacity) = 0;
+};
+
+// GZIP files may consist of several concatenated members, which zlib reads as
+// one file.
+class GzipDecompressor : public Decompressor {
+ public:
+  GzipDecompressor(gzFile file, const string& filename)
+      : file_(file), filename_(filename) {
+    gzbuffer(file_, kBufferSize);
+  }
+  ~GzipDecompressor() override { gzclose(file_); }
+
+  // At the end of a truncated file, gzread returns 0 and the error is
+  // Z_BUF_ERROR.
+  size_t Decompress(char* buffer, size_t capacity) override {
+    int size = gzread(file_, buffer, static_cast<unsigned>(capacity));
+    int code = Z_OK;
+    const char* err = gzerror(file_, &code);
+    CHECK(size >= 0, StrCat(kReadErr, filename_, ": ", err));
+    CHECK(size > 0 || code == Z_OK, StrCat(kTruncatedErr, filename_));
+    return static_cast<size_t>(size);
+  }
+
+ private:
+  gzFile file_;
+  const string filename_;
+};
+
+#ifdef LOGLE_HAVE_ZSTD
+// A ZSTD file may consist of several concatenated frames. The result of the
+// last call to ZSTD_decompressStream is 0 if and only if a frame has been
+// decoded and flushed completely, so a file that ends while the result is not
+// 0 is truncated.
+class ZstdDecompressor : public Decompressor {
+ public:
+  ZstdDecompressor(FILE* file, const string& filename)
+      : file_(file),
+        filename_(filename),
+        stream_(ZSTD_createDStream()),
+        input_(ZSTD_DStreamInSize()),
+        in_{input_.data(), 0, 0} {
+    CHECK(stream_ != nullptr, "Could not create a ZSTD stream.");
+    ZSTD_initDStream(stream_);
+  }
+  ~ZstdDecompressor() override {
+    ZSTD_freeDStream(stream_);
+    fclose(file_);
+  }
+
+  size_t Decompress(char* buffer, size_t capacity) override {
+    ZSTD_outBuffer out = {buffer, capacity, 0};
+    while (out.pos < out.size) {
+      if (in_.pos == in_.size && !is_eof_) {
+        size_t size = fread(input_.data(), 1, input_.size(), file_);
+        CHECK(!ferror(file_), StrCat(kReadErr, filename_));
+        in_.size = size;
+        in_.pos = 0;
+        is_eof_ = (size == 0);
+      }
+      if (is_eof_ && last_result_ == 0) {
+        break;
+      }
+      size_t pos = out.pos;
+      last_result_ = ZSTD_decompressStream(stream_, &out, &in_);
+      CHECK(!ZSTD_isError(last_result_),
+            StrCat(kReadErr, filename_, ": ",
+                   ZSTD_getErrorName(last_result_)));
+      // Without input, the stream can only make progress by flushing data.
+      CHECK(!is_eof_ || out.pos > pos, StrCat(kTruncatedErr, filename_));
+    }
+    return out.pos;
+  }
+
+ private:
+  FILE* file_;
+  const string filename_;
+  ZSTD_DStream* stream_;
+  std::vector<char> input_;
+  ZSTD_inBuffer in_;
+  size_t last_result_ = 0;
+  bool is_eof_ = false;
+};
+#endif
+
+// A DecompressingBuffer is a stream buffer whose contents are decompressed on
+// a separate thread into two buffers. The thread fills the buffers in turn,
+// and the reader reads them in the same order, releasing each buffer when it
+// moves on to the next one.
+class DecompressingBuffer : public std::streambuf {
+ public:
+  explicit DecompressingBuffer(std::unique_ptr<Decompressor> decompressor);
+  // Stops and joins the decompressing thread.
+  ~DecompressingBuffer() override;
+  DecompressingBuffer(const DecompressingBuffer&) = delete;
+  DecompressingBuffer& operator=(const DecompressingBuffer&) = delete;
+
+ protected:
+  int_type underflow() override;
+
+ private:
+  void Decompress();
+
+  std::unique_ptr<Decompressor> decompressor_;
+  std::vector<char> buffers_[2];
+  size_t sizes_[2];
+  // The buffer that the reader reads, or -1 before the first read.
+  int current_;
+  std::mutex mutex_;
+  std::condition_variable state_changed_;
+  // The fields below are guarded by 'mutex_'. A buffer is full from the time
+  // it has been filled until the reader has moved on to the next buffer.
+  bool is_full_[2];
+  bool is_done_;
+  bool is_cancelled_;
+  // The thread is started last in the constructor so that it sees initialized
+  // members.
+  std::thread thread_;
+};
+
+DecompressingBuffer::DecompressingBuffer(
+    std::unique_ptr<Decompressor> decompressor)
+    : decompressor_(std::move(decompressor)),
+      sizes_{0, 0},
+      current_(-1),
+      is_full_{false, false},
+      is_done_(false),
+      is_cancelled_(false) {
+  buffers_[0].resize(kBufferSize);
+  buffers_[1].resize(kBufferSize);
+  setg(nullptr, nullptr, nullptr);
+  thread_ = std::thread(&DecompressingBuffer::Decompress, this);
+}
+
+DecompressingBuffer::~DecompressingBuffer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_cancelled_ = true;
+  }
+  state_changed_.notify_all();
+  thread_.join();
+}
+
+void DecompressingBuffer::Decompress() {
+  for (int next = 0; true; next = 1 - next) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    state_changed_.wait(
+        lock, [this, next] { return is_cancelled_ || !is_full_[next]; });
+    if (is_cancelled_) {
+      return;
+    }
+    lock.unlock();
+    // The reader does not access a buffer that is not full.
+    size_t size = decompressor_->Decompress(buffers_[next].data(),
+                                            buffers_[next].size());
+    lock.lock();
+    if (size == 0) {
+      is_done_ = true;
+    } else {
+      sizes_[next] = size;
+      is_full_[next] = true;
+    }
+    lock.unlock();
+    state_changed_.notify_all();
+    if (size == 0) {
+      return;
+    }
+  }
+}
+
+DecompressingBuffer::int_type DecompressingBuffer::underflow() {
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  int next = (current_ < 0) ? 0 : 1 - current_;
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (current_ >= 0 && is_full_[current_]) {
+    is_full_[current_] = false;
+    lock.unlock();
+    state_changed_.notify_all();
+    lock.lock();
+  }
+  state_changed_.wait(lock,
+                      [this, next] { return is_done_ || is_full_[next]; });
+  if (!is_full_[next]) {
+    setg(nullptr, nullptr, nullptr);
+    return traits_type::eof();
+  }
+  current_ = next;
+  char* begin = buffers_[current_].data();
+  setg(begin, begin, begin + sizes_[current_]);
+  return traits_type::to_int_type(*gptr());
+}
+
+// The stream buffer is a member, so it is constructed after the base class and
+// installed in the constructor.
+class DecompressingStream : public std::istream {
+ public:
+  explicit DecompressingStream(std::unique_ptr<Decompressor> decompressor)
+      : std::istream(nullptr), buffer_(std::move(decompressor)) {
+    rdbuf(&buffer_);
+  }
+
+ private:
+  DecompressingBuffer buffer_;
+};
+
+// A Compressor writes the compressed contents of a file in parts.
+class Compressor {
+ public:
+  virtual ~Compressor() {}
+  // Compresses the 'size' bytes at 'data' and writes them to the file. Returns
+  // false if the file could not be written.
+  virtual bool Write(const char* data, size_t size) = 0;
+  // Writes the end of the compressed contents and closes the file. Returns
+  // false if the file could not be written or closed.
+  virtual bool Close() = 0;
+};
+
+// Uncompressed contents are written to the file as they are, directly from the
+// buffers of the stream.
+class FileWriter : public Compressor {
+ public:
+  explicit FileWriter(int fd) : fd_(fd) {}
+  ~FileWriter() override {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  bool Write(const char* data, size_t size) override {
+    while (size > 0) {
+      ssize_t num_written = write(fd_, data, size);
+      if (num_written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      data += num_written;
+      size -= num_written;
+    }
+    return true;
+  }
+
+  bool Close() override {
+    int fd = fd_;
+    fd_ = -1;
+    return close(fd) == 0;
+  }
+
+ private:
+  int fd_;
+};
+
+class GzipCompressor : public Compressor {
+ public:
+  explicit GzipCompressor(gzFile file) : file_(file) {
+    gzbuffer(file_, kBufferSize);
+  }
+  ~GzipCompressor() override {
+    if (file_ != nullptr) {
+      gzclose(file_);
+    }
+  }
+
+  bool Write(const char* data, size_t size) override {
+    return size == 0 ||
+           gzwrite(file_, data, static_cast<unsigned>(size)) ==
+               static_cast<int>(size);
+  }
+
+  bool Close() override {
+    gzFile file = file_;
+    file_ = nullptr;
+    return gzclose(file) == Z_OK;
+  }
+
+ private:
+  gzFile file_;
+};
+
+#ifdef LOGLE_HAVE_ZSTD
+// The contents are written as one ZSTD frame, which ZSTD_endStream completes.
+// A result of ZSTD_endStream that is not 0 is the size of the data that
+// remains to be flushed.
+class ZstdCompressor : public Compressor {
+ public:
+  explicit ZstdCompressor(FILE* file)
+      : file_(file),
+        stream_(ZSTD_createCStream()),
+        output_(ZSTD_CStreamOutSize()) {
+    CHECK(stream_ != nullptr, "Could not create a ZSTD stream.");
+    ZSTD_initCStream(stream_, kZstdLevel);
+  }
+  ~ZstdCompressor() override {
+    ZSTD_freeCStream(stream_);
+    if (file_ != nullptr) {
+      fclose(file_);
+    }
+  }
+
+  bool Write(const char* data, size_t size) override {
+    ZSTD_inBuffer in = {data, size, 0};
+    while (in.pos < in.size) {
+      ZSTD_outBuffer out = {output_.data(), output_.size(), 0};
+      size_t result = ZSTD_compressStream(stream_, &out, &in);
+      if (ZSTD_isError(result) || !WriteOutput(out.pos)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool Close() override {
+    bool is_written = true;
+    size_t remaining = 0;
+    do {
+      ZSTD_outBuffer out = {output_.data(), output_.size(), 0};
+      remaining = ZSTD_endStream(stream_, &out);
+      is_written = !ZSTD_isError(remaining) && WriteOutput(out.pos);
+    } while (is_written && remaining > 0);
+    FILE* file = file_;
+    file_ = nullptr;
+    return fclose(file) == 0 && is_written;
+  }
+
+ private:
+  bool WriteOutput(size_t size) {
+    return fwrite(output_.data(), 1, size, file_) == size;
+  }
+
+  FILE* file_;
+  ZSTD_CStream* stream_;
+  std::vector<char> output_;
+};
+#endif
+
+// A CompressingBuffer is a stream buffer whose contents are written by a
+// separate thread from two buffers. The writer fills the buffers in turn and
+// hands each full buffer to the thread, which compresses and writes the
+// buffers in the same order and releases each buffer once it is written.
+class CompressingBuffer : public std::streambuf {
+ public:
+  explicit CompressingBuffer(std::unique_ptr<Compressor> compressor);
+  // Closes the buffer.
+  ~CompressingBuffer() override;
+  CompressingBuffer(const CompressingBuffer&) = delete;
+  CompressingBuffer& operator=(const CompressingBuffer&) = delete;
+
+  // Writes the remaining contents, joins the writing thread and closes the
+  // file. Returns false if a part of the contents could not be written or the
+  // file could not be closed. Further calls return the same result.
+  bool Close();
+
+ protected:
+  int_type overflow(int_type c) override;
+  int sync() override;
+
+ private:
+  // Hands the contents of the current buffer, if any, to the thread and makes
+  // the other buffer current once it is released. Returns false if a part of
+  // the contents could not be written.
+  bool Submit();
+  void Write();
+
+  std::unique_ptr<Compressor> compressor_;
+  std::vector<char> buffers_[2];
+  size_t sizes_[2];
+  // The buffer that the writer fills.
+  int current_;
+  bool is_closed_;
+  bool is_written_;
+  std::mutex mutex_;
+  std::condition_variable state_changed_;
+  // The fields below are guarded by 'mutex_'. A buffer is full from the time
+  // it has been handed to the thread until it has been written.
+  bool is_full_[2];
+  bool is_closing_;
+  bool has_failed_;
+  // The thread is started last in the constructor so that it sees initialized
+  // members.
+  std::thread thread_;
+};
+
+CompressingBuffer::CompressingBuffer(std::unique_ptr<Compressor> compressor)
+    : compressor_(std::move(compressor)),
+      sizes_{0, 0},
+      current_(0),
+      is_closed_(false),
+      is_written_(false),
+      is_full_{false, false},
+      is_closing_(false),
+      has_failed_(false) {
+  buffers_[0].resize(kBufferSize);
+  buffers_[1].resize(kBufferSize);
+  setp(buffers_[0].data(), buffers_[0].data() + kBufferSize);
+  thread_ = std::thread(&CompressingBuffer::Write, this);
+}
+
+CompressingBuffer::~CompressingBuffer() { Close(); }
+
+// The buffers are written in the order in which they are handed over, so when
+// the stream is closing and the next buffer is not full, every buffer has been
+// written. After a failure, the remaining buffers are released unwritten.
+void CompressingBuffer::Write() {
+  for (int next = 0; true; next = 1 - next) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    state_changed_.wait(
+        lock, [this, next] { return is_closing_ || is_full_[next]; });
+    if (!is_full_[next]) {
+      return;
+    }
+    bool has_failed = has_failed_;
+    lock.unlock();
+    // The writer does not access a buffer that is full.
+    if (!has_failed) {
+      has_failed = !compressor_->Write(buffers_[next].data(), sizes_[next]);
+    }
+    lock.lock();
+    has_failed_ = has_failed;
+    is_full_[next] = false;
+    lock.unlock();
+    state_changed_.notify_all();
+  }
+}
+
+bool CompressingBuffer::Submit() {
+  const size_t size = pptr() - pbase();
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (size > 0) {
+    sizes_[current_] = size;
+    is_full_[current_] = true;
+    current_ = 1 - current_;
+    lock.unlock();
+    state_changed_.notify_all();
+    lock.lock();
+    state_changed_.wait(lock, [this] { return !is_full_[current_]; });
+  }
+  char* begin = buffers_[current_].data();
+  setp(begin, begin + buffers_[current_].size());
+  return !has_failed_;
+}
+
+CompressingBuffer::int_type CompressingBuffer::overflow(int_type c) {
+  if (is_closed_ || !Submit()) {
+    return traits_type::eof();
+  }
+  if (traits_type::eq_int_type(c, traits_type::eof())) {
+    return traits_type::not_eof(c);
+  }
+  *pptr() = traits_type::to_char_type(c);
+  pbump(1);
+  return c;
+}
+
+int CompressingBuffer::sync() { return !is_closed_ && Submit() ? 0 : -1; }
+
+bool CompressingBuffer::Close() {
+  if (is_closed_) {
+    return is_written_;
+  }
+  Submit();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_closing_ = true;
+  }
+  state_changed_.notify_all();
+  thread_.join();
+  // The file is closed even if writing failed.
+  const bool is_closed = compressor_->Close();
+  is_written_ = !has_failed_ && is_closed;
+  is_closed_ = true;
+  setp(nullptr, nullptr);
+  return is_written_;
+}
+
+// The stream buffer is a member, so it is constructed after the base class and
+// installed in the constructor.
+class CompressingStream : public OutputFileStream {
+ public:
+  CompressingStream(std::unique_ptr<Compressor> compressor,
+                    const string& filename)
+      : buffer_(std::move(compressor)), filename_(filename) {
+    rdbuf(&buffer_);
+  }
+
+  Status Close() override {
+    if (!buffer_.Close()) {
+      setstate(std::ios_base::badbit);
+      return Status(Code::EXTERNAL, StrCat(kWriteErr, filename_));
+    }
+    return Status::OK;
+  }
+
+ private:
+  CompressingBuffer buffer_;
+  const string filename_;
+};
+
+}  // namespace
+
+Compression GetCompression(const string& filename) {
+  if (HasSuffix(filename, kGzipExtension)) {
+    return Compression::GZIP;
+  }
+  if (HasSuffix(filename, kZstdExtension)) {
+    return Compression::ZSTD;
+  }
+  return Compression::NONE;
+}
+
+bool IsSupported(Compression compression) {
+#ifdef LOGLE_HAVE_ZSTD
+  return true;
+#else
+  return compression != Compression::ZSTD;
+#endif
+}
+
+Status OpenInputFile(const string& filename,
+                     std::unique_ptr<std::istream>* stream) {
+  CHECK(stream != nullptr, "The pointer to the stream is null.");
+  Compression compression = GetCompression(filename);
+  if (!IsSupported(compression)) {
+    return Status(Code::INVALID_ARGUMENT, StrCat(kUnsupportedErr, filename));
+  }
+  Status open_error(Code::EXTERNAL, StrCat(kOpenFileErr, filename));
+  switch (compression) {
+    case Compression::NONE: {
+      std::unique_ptr<std::ifstream> file(new std::ifstream(filename));
+      if (!file->is_open()) {
+        return open_error;
+      }
+      *stream = std::move(file);
+      break;
+    }
+    case Compression::GZIP: {
+      gzFile file = gzopen(filename.c_str(), "rb");
+      if (file == nullptr) {
+        return open_error;
+      }
+      std::unique_ptr<Decompressor> decompressor(
+          new GzipDecompressor(file, filename));
+      stream->reset(new DecompressingStream(std::move(decompressor)));
+      break;
+    }
+    case Compression::ZSTD: {
+#ifdef LOGLE_HAVE_ZSTD
+      FILE* file = fopen(filename.c_str(), "rb");
+      if (file == nullptr) {
+        return open_error;
+      }
+      std::unique_ptr<Decompressor> decompressor(
+          new ZstdDecompressor(file, filename));
+      stream->reset(new DecompressingStream(std::move(decompressor)));
+#endif
+      break;
+    }
+  }
+  return Status::OK;
+}
+
+Status OpenOutputFile(const string& filename,
+                      std::unique_ptr<OutputFileStream>* stream) {
+  CHECK(stream != nullptr, "The pointer to the stream is null.");
+  Compression compression = GetCompression(filename);
+  if (!IsSupported(compression)) {
+    return Status(Code::INVALID_ARGUMENT,
+                  StrCat(kUnsupportedWriteErr, filename));
+  }
+  Status open_error(Code::EXTERNAL, StrCat(kOpenFileErr, filename));
+  std::unique_ptr<Compressor> compressor;
+  switch (compression) {
+    case Compression::NONE: {
+      int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0666);
+      if (fd < 0) {
+        return open_error;
+      }
+      compressor.reset(new FileWriter(fd));
+      break;
+    }
+    case Compression::GZIP: {
+      gzFile file = gzopen(filename.c_str(), kGzipWriteMode);
+      if (file == nullptr) {
+        return open_error;
+      }
+      compressor.reset(new GzipCompressor(file));
+      break;
+    }
+    case Compression::ZSTD: {
+#ifdef LOGLE_HAVE_ZSTD
+      FILE* file = fopen(filename.c_str(), "wb");
+      if (file == nullptr) {
+        return open_error;
+      }
+      compressor.reset(new ZstdCompressor(file));
+#endif
+      break;
+    }
+  }
+  stream->reset(new CompressingStream(std::move(compressor), filename));
+  return Status::OK;
+}
+
+}  // namespace util
+}  // namespace morphie
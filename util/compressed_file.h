@@ -0,0 +1,110 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file provides streams over the decompressed contents of files, so that
+// compressed logs can be analyzed without decompressing them to disk first. A
+// file is read as GZIP if its name ends in ".gz", as ZSTD if its name ends in
+// ".zst", and as uncompressed otherwise. A compressed file is decompressed on a
+// separate thread into two buffers that are used in turn: while the stream is
+// read from one buffer, the next part of the file is decompressed into the
+// other, so decompression overlaps the parsing of the decompressed data.
+//
+// Example.
+//   std::unique_ptr<std::istream> stream;
+//   util::Status status = util::OpenInputFile("events.jsonl.zst", &stream);
+//   if (!status.ok()) { ... }
+//   StreamJson json_stream(stream.get());
+//
+// A compressed stream, unlike a file, cannot be memory-mapped or split into
+// byte ranges, so readers such as MappedJsonLines and ParallelCSVParser only
+// accept uncompressed files.
+//
+// Output files are written in the same way in reverse. A file whose name ends
+// in ".gz" or ".zst" is compressed, and the contents of an output stream are
+// compressed and written to the file on a separate thread from two buffers
+// that are used in turn, so writing one part of the contents overlaps the
+// rendering of the next part. GZIP files are compressed at level 1 and ZSTD
+// files at level 3, which favor speed over size.
+//
+// Example.
+//   std::unique_ptr<util::OutputFileStream> stream;
+//   util::Status status = util::OpenOutputFile("graph.dot.gz", &stream);
+//   if (!status.ok()) { ... }
+//   DotPrinter().WriteDotGraph(graph, stream.get());
+//   status = stream->Close();
+#ifndef LOGLE_UTIL_COMPRESSED_FILE_H_
+#define LOGLE_UTIL_COMPRESSED_FILE_H_
+
+#include <istream>
+#include <memory>
+#include <ostream>
+
+#include "base/string.h"
+#include "util/status.h"
+
+namespace morphie {
+namespace util {
+
+enum class Compression { NONE, GZIP, ZSTD };
+
+// Returns the compression format of the file 'filename', which is determined by
+// the extension of the name.
+Compression GetCompression(const string& filename);
+
+// Returns true if files in the 'compression' format can be read and written.
+// ZSTD files are only supported if the ZSTD library was found when the tool
+// was built.
+bool IsSupported(Compression compression);
+
+// Opens the file 'filename' and sets '*stream' to a stream of its decompressed
+// contents. Returns
+//  - EXTERNAL if the file could not be opened.
+//  - INVALID_ARGUMENT if the compression format of the file is not supported.
+//  - OK otherwise.
+// Reading from a compressed stream crashes if the file is not in the format of
+// its extension, is truncated or cannot be read.
+// - Requires that 'stream' is not null.
+Status OpenInputFile(const string& filename,
+                     std::unique_ptr<std::istream>* stream);
+
+// A stream of the contents of an output file. The contents are written to the
+// file as the buffers of the stream fill up, so the stream is in a failed
+// state once a part of the contents could not be written.
+class OutputFileStream : public std::ostream {
+ public:
+  OutputFileStream() : std::ostream(nullptr) {}
+  // Writes the remaining contents and closes the file. Returns
+  //  - EXTERNAL if a part of the contents could not be written or the file
+  //    could not be closed.
+  //  - OK otherwise.
+  // Nothing can be written to a closed stream, and further calls return the
+  // same status. A stream that is destroyed before it is closed is closed
+  // without reporting errors.
+  virtual Status Close() = 0;
+};
+
+// Creates or truncates the file 'filename' and sets '*stream' to a stream whose
+// contents are compressed in the format of the extension of 'filename' and
+// written to the file. Returns
+//  - EXTERNAL if the file could not be opened.
+//  - INVALID_ARGUMENT if the compression format of the file is not supported.
+//  - OK otherwise.
+// - Requires that 'stream' is not null.
+Status OpenOutputFile(const string& filename,
+                      std::unique_ptr<OutputFileStream>* stream);
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_COMPRESSED_FILE_H_
@@ -0,0 +1,216 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/compressed_file.h"
+
+#include <unistd.h>
+#include <zlib.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "base/string.h"
+#include "gtest.h"
+#include "util/test_files.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+using test::GetTempFile;
+
+// Writes each string in 'members' to 'filename' as a separate GZIP member.
+void WriteGzipFile(const string& filename, const std::vector<string>& members) {
+  std::ofstream(filename, std::ofstream::trunc);
+  for (const string& member : members) {
+    gzFile file = gzopen(filename.c_str(), "ab");
+    ASSERT_NE(nullptr, file);
+    ASSERT_EQ(static_cast<int>(member.size()),
+              gzwrite(file, member.data(), member.size()));
+    ASSERT_EQ(Z_OK, gzclose(file));
+  }
+}
+
+// Returns the contents of 'stream'.
+string ReadStream(std::istream* stream) {
+  std::stringstream contents;
+  contents << stream->rdbuf();
+  return contents.str();
+}
+
+// Returns JSON stream lines that span several decompression buffers.
+string GetLines() {
+  string lines;
+  for (int i = 0; i < 100000; ++i) {
+    lines += "{\"timestamp\": " + std::to_string(i) + ", \"data\": \"x\"}\n";
+  }
+  return lines;
+}
+
+TEST(CompressedFileTest, DeterminesCompressionFromExtension) {
+  EXPECT_EQ(Compression::NONE, GetCompression("events.jsonl"));
+  EXPECT_EQ(Compression::NONE, GetCompression("gz"));
+  EXPECT_EQ(Compression::GZIP, GetCompression("events.jsonl.gz"));
+  EXPECT_EQ(Compression::ZSTD, GetCompression("events.jsonl.zst"));
+  EXPECT_TRUE(IsSupported(Compression::NONE));
+  EXPECT_TRUE(IsSupported(Compression::GZIP));
+}
+
+TEST(CompressedFileTest, ReadsUncompressedFile) {
+  string filename = GetTempFile(".jsonl");
+  string lines = GetLines();
+  std::ofstream(filename) << lines;
+  std::unique_ptr<std::istream> stream;
+  ASSERT_TRUE(OpenInputFile(filename, &stream).ok());
+  EXPECT_EQ(lines, ReadStream(stream.get()));
+  unlink(filename.c_str());
+}
+
+// The contents of all members are read, and lines can be read with getline
+// across the boundaries of the decompression buffers.
+TEST(CompressedFileTest, ReadsGzipFile) {
+  string filename = GetTempFile(".gz");
+  string lines = GetLines();
+  WriteGzipFile(filename, {lines, "", lines});
+  std::unique_ptr<std::istream> stream;
+  ASSERT_TRUE(OpenInputFile(filename, &stream).ok());
+  EXPECT_EQ(lines + lines, ReadStream(stream.get()));
+
+  ASSERT_TRUE(OpenInputFile(filename, &stream).ok());
+  std::istringstream expected(lines + lines);
+  string line;
+  string expected_line;
+  int num_lines = 0;
+  while (std::getline(expected, expected_line)) {
+    ASSERT_TRUE(std::getline(*stream, line).good());
+    ASSERT_EQ(expected_line, line);
+    ++num_lines;
+  }
+  EXPECT_FALSE(std::getline(*stream, line).good());
+  EXPECT_EQ(200000, num_lines);
+  unlink(filename.c_str());
+}
+
+// A stream that is destroyed before it is read to the end stops its thread.
+TEST(CompressedFileTest, StopsPartiallyReadStream) {
+  string filename = GetTempFile(".gz");
+  WriteGzipFile(filename, {GetLines()});
+  std::unique_ptr<std::istream> stream;
+  ASSERT_TRUE(OpenInputFile(filename, &stream).ok());
+  string line;
+  ASSERT_TRUE(std::getline(*stream, line).good());
+  EXPECT_EQ("{\"timestamp\": 0, \"data\": \"x\"}", line);
+  stream.reset();
+  WriteGzipFile(filename, {""});
+  ASSERT_TRUE(OpenInputFile(filename, &stream).ok());
+  EXPECT_EQ("", ReadStream(stream.get()));
+  unlink(filename.c_str());
+}
+
+TEST(CompressedFileTest, ReportsErrors) {
+  std::unique_ptr<std::istream> stream;
+  for (const char* filename :
+       {"/nonexistent/compressed_file_test", "/nonexistent/a.gz"}) {
+    EXPECT_EQ(Code::EXTERNAL, OpenInputFile(filename, &stream).code());
+  }
+  Status status = OpenInputFile("/nonexistent/a.zst", &stream);
+  if (IsSupported(Compression::ZSTD)) {
+    EXPECT_EQ(Code::EXTERNAL, status.code());
+  } else {
+    EXPECT_EQ(Code::INVALID_ARGUMENT, status.code());
+  }
+}
+
+// Returns the contents of 'filename' as they are read by OpenInputFile.
+string ReadInputFile(const string& filename) {
+  std::unique_ptr<std::istream> stream;
+  EXPECT_TRUE(OpenInputFile(filename, &stream).ok());
+  return stream == nullptr ? "" : ReadStream(stream.get());
+}
+
+// The contents span several buffers, and flushing hands over a partial buffer
+// without changing the contents.
+TEST(CompressedFileTest, WritesFiles) {
+  string lines = GetLines();
+  for (const char* extension : {".dot", ".gz", ".zst"}) {
+    if (!IsSupported(GetCompression(extension))) {
+      continue;
+    }
+    string filename = GetTempFile(extension);
+    std::unique_ptr<OutputFileStream> stream;
+    ASSERT_TRUE(OpenOutputFile(filename, &stream).ok());
+    *stream << lines << std::flush << "x" << std::flush;
+    *stream << lines;
+    EXPECT_TRUE(stream->good());
+    EXPECT_TRUE(stream->Close().ok());
+    EXPECT_TRUE(stream->Close().ok());
+    EXPECT_EQ(lines + "x" + lines, ReadInputFile(filename)) << extension;
+
+    // An empty stream produces a file with no contents, and a stream that is
+    // destroyed without being closed writes its contents.
+    ASSERT_TRUE(OpenOutputFile(filename, &stream).ok());
+    EXPECT_TRUE(stream->Close().ok());
+    EXPECT_EQ("", ReadInputFile(filename)) << extension;
+    ASSERT_TRUE(OpenOutputFile(filename, &stream).ok());
+    *stream << "digraph {}";
+    stream.reset();
+    EXPECT_EQ("digraph {}", ReadInputFile(filename)) << extension;
+    unlink(filename.c_str());
+  }
+}
+
+TEST(CompressedFileTest, ReportsWriteErrors) {
+  std::unique_ptr<OutputFileStream> stream;
+  EXPECT_EQ(Code::EXTERNAL,
+            OpenOutputFile("/nonexistent/compressed_file_test", &stream)
+                .code());
+  EXPECT_EQ(Code::EXTERNAL,
+            OpenOutputFile("/nonexistent/a.gz", &stream).code());
+  if (!IsSupported(Compression::ZSTD)) {
+    EXPECT_EQ(Code::INVALID_ARGUMENT,
+              OpenOutputFile("/tmp/a.zst", &stream).code());
+  }
+  // Every write to /dev/full fails.
+  if (access("/dev/full", W_OK) == 0) {
+    ASSERT_TRUE(OpenOutputFile("/dev/full", &stream).ok());
+    *stream << GetLines() << GetLines();
+    EXPECT_EQ(Code::EXTERNAL, stream->Close().code());
+    EXPECT_TRUE(stream->bad());
+    EXPECT_EQ(Code::EXTERNAL, stream->Close().code());
+  }
+}
+
+TEST(CompressedFileDeathTest, CrashesOnTruncatedGzipFile) {
+  string filename = GetTempFile(".gz");
+  WriteGzipFile(filename, {GetLines()});
+  std::stringstream contents;
+  contents << std::ifstream(filename).rdbuf();
+  string compressed = contents.str();
+  std::ofstream(filename, std::ofstream::trunc)
+      << compressed.substr(0, compressed.size() / 2);
+  // The stream is opened in the death test because a forked process does not
+  // have the decompressing thread of its parent.
+  EXPECT_DEATH(
+      {
+        std::unique_ptr<std::istream> stream;
+        OpenInputFile(filename, &stream);
+        ReadStream(stream.get());
+      },
+      "The compressed file is truncated");
+  unlink(filename.c_str());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
@@ -15,8 +15,12 @@
 #include <boost/exception/exception.hpp>  // NOLINT
 #include <boost/tokenizer.hpp>  // NOLINT
 
+#include <cstdint>
+#include <cstring>
 #include <sstream>
 
+#include "util/logging.h"
+
 // The Clang compiler does not support exceptions. Boost is compiled with Clang,
 // the client is required to define this function.
 // void boost::throw_exception(std::exception const& e) {}
@@ -24,6 +28,48 @@
 namespace morphie {
 namespace util {
 
+namespace {
+
+const char kInvalidColumnErr[] = "Invalid column of a record batch.";
+const char kInvalidRowErr[] = "Invalid row of a record batch.";
+const char kRowSizeErr[] = "The row has the wrong number of fields.";
+
+// The size of the blocks in which a BlockCSVParser reads its input.
+const size_t kBlockSize = 1 << 20;
+
+const uint64_t kLowBits = 0x0101010101010101ULL;
+const uint64_t kHighBits = 0x8080808080808080ULL;
+
+// Returns true if some byte of 'word' is zero.
+inline bool HasZeroByte(uint64_t word) {
+  return ((word - kLowBits) & ~word & kHighBits) != 0;
+}
+
+// Returns a pointer to the first delimiter, quote or backslash in [begin, end),
+// or 'end' if there is none. Eight characters are compared at a time by
+// testing for a zero byte in the word obtained by xor-ing them with each
+// special character.
+char* FindSpecial(char* begin, char* end, char delim) {
+  const uint64_t delim_word = kLowBits * static_cast<unsigned char>(delim);
+  const uint64_t quote_word = kLowBits * static_cast<unsigned char>('"');
+  const uint64_t escape_word = kLowBits * static_cast<unsigned char>('\\');
+  while (end - begin >= 8) {
+    uint64_t word;
+    std::memcpy(&word, begin, sizeof(word));
+    if (HasZeroByte(word ^ delim_word) || HasZeroByte(word ^ quote_word) ||
+        HasZeroByte(word ^ escape_word)) {
+      break;
+    }
+    begin += 8;
+  }
+  while (begin != end && *begin != delim && *begin != '"' && *begin != '\\') {
+    ++begin;
+  }
+  return begin;
+}
+
+}  // namespace
+
 CSVParser::Iterator& CSVParser::Iterator::operator++() {
   parser_->Advance();
   return *this;
@@ -89,5 +135,174 @@ void CSVParser::Advance() {
   }
 }
 
+RecordBatch::RecordBatch(size_t num_columns)
+    : columns_(num_columns), num_rows_(0), num_skipped_(0) {}
+
+CSVField RecordBatch::Get(size_t row, size_t column) const {
+  CHECK(row < num_rows_, kInvalidRowErr);
+  CHECK(column < columns_.size(), kInvalidColumnErr);
+  const Column& col = columns_[column];
+  return CSVField(chars_.data() + col.begins[row],
+                  col.ends[row] - col.begins[row]);
+}
+
+void RecordBatch::Clear() {
+  chars_.clear();
+  for (Column& column : columns_) {
+    column.begins.clear();
+    column.ends.clear();
+  }
+  num_rows_ = 0;
+  num_skipped_ = 0;
+}
+
+void RecordBatch::AddRow(Span<CSVField> fields) {
+  CHECK(fields.size() == columns_.size(), kRowSizeErr);
+  for (size_t i = 0; i < fields.size(); ++i) {
+    columns_[i].begins.push_back(chars_.size());
+    chars_.insert(chars_.end(), fields[i].begin(), fields[i].end());
+    columns_[i].ends.push_back(chars_.size());
+  }
+  ++num_rows_;
+}
+
+BlockCSVParser::BlockCSVParser(std::istream* input)
+    : BlockCSVParser(input, ',') {}
+
+BlockCSVParser::BlockCSVParser(std::istream* input, char delim)
+    : input_(input),
+      delim_(delim),
+      buffer_(kBlockSize),
+      pos_(0),
+      size_(0),
+      scanned_(0) {
+  if (input_ != nullptr && !input_->good()) {
+    input_.reset(nullptr);
+  }
+}
+
+BlockCSVParser::BlockCSVParser(const char* data, size_t size, char delim)
+    : delim_(delim),
+      buffer_(data, data + size),
+      pos_(0),
+      size_(size),
+      scanned_(0) {}
+
+// A line ends at a newline or at the end of the input. The escape and quote
+// rules are those of the tokenizer used by CSVParser, and a newline always ends
+// a line, even inside quotes, as it does for CSVParser.
+bool BlockCSVParser::Next() {
+  fields_.clear();
+  status_ = util::Status::OK;
+  size_t line_end;
+  while (true) {
+    const char* data = buffer_.data();
+    const void* newline =
+        (scanned_ == size_)
+            ? nullptr
+            : std::memchr(data + scanned_, '\n', size_ - scanned_);
+    if (newline != nullptr) {
+      line_end = static_cast<const char*>(newline) - data;
+      break;
+    }
+    scanned_ = size_;
+    if (input_ == nullptr) {
+      if (pos_ == size_) {
+        return false;
+      }
+      line_end = size_;
+      break;
+    }
+    Fill();
+  }
+  Tokenize(buffer_.data() + pos_, buffer_.data() + line_end);
+  pos_ = (line_end == size_) ? size_ : line_end + 1;
+  scanned_ = pos_;
+  return true;
+}
+
+size_t BlockCSVParser::NextBatch(size_t max_lines, RecordBatch* batch) {
+  batch->Clear();
+  size_t num_lines = 0;
+  for (; num_lines < max_lines && Next(); ++num_lines) {
+    if (ok() && fields_.size() == batch->NumColumns()) {
+      batch->AddRow(fields());
+    } else {
+      ++batch->num_skipped_;
+    }
+  }
+  fields_.clear();
+  return num_lines;
+}
+
+void BlockCSVParser::Fill() {
+  size_t num_unparsed = size_ - pos_;
+  if (pos_ > 0) {
+    std::memmove(buffer_.data(), buffer_.data() + pos_, num_unparsed);
+    scanned_ -= pos_;
+    pos_ = 0;
+    size_ = num_unparsed;
+  }
+  if (size_ == buffer_.size()) {
+    buffer_.resize(2 * buffer_.size());
+  }
+  input_->read(buffer_.data() + size_, buffer_.size() - size_);
+  size_ += static_cast<size_t>(input_->gcount());
+  if (!input_->good()) {
+    input_.reset(nullptr);
+  }
+}
+
+// The characters between special characters are moved to the end of the field
+// being written, which trails the characters being read.
+void BlockCSVParser::Tokenize(char* begin, char* end) {
+  char* read = begin;
+  char* write = begin;
+  char* field_begin = begin;
+  bool in_quote = false;
+  while (true) {
+    char* special = FindSpecial(read, end, delim_);
+    if (write != read) {
+      std::memmove(write, read, special - read);
+    }
+    write += special - read;
+    read = special;
+    if (read == end) {
+      break;
+    }
+    char c = *read++;
+    if (c == '\\') {
+      // A line cannot end with an escape and only a newline, a quote, the
+      // delimiter and the escape character itself can be escaped.
+      bool is_valid = read != end;
+      char escaped = is_valid ? *read++ : '\0';
+      if (is_valid && escaped == 'n') {
+        *write++ = '\n';
+      } else if (is_valid && (escaped == '"' || escaped == '\\' ||
+                              escaped == delim_)) {
+        *write++ = escaped;
+      } else {
+        fields_.clear();
+        status_ =
+            util::Status(Code::INVALID_ARGUMENT, "Error tokenizing line.");
+        return;
+      }
+    } else if (c == '"') {
+      in_quote = !in_quote;
+    } else if (in_quote) {
+      *write++ = c;
+    } else {
+      fields_.push_back(CSVField(field_begin, write - field_begin));
+      field_begin = read;
+      write = read;
+    }
+  }
+  // An empty line has no fields and a delimiter at the end of a line is
+  // followed by an empty field.
+  if (begin != end) {
+    fields_.push_back(CSVField(field_begin, write - field_begin));
+  }
+}
+
 }  // namespace util
 }  // namespace morphie
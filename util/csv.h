@@ -58,6 +58,7 @@
 #include <vector>
 
 #include "base/string.h"
+#include "util/span.h"
 #include "util/status.h"
 
 namespace morphie {
@@ -167,6 +168,127 @@ class CSVParser {
   State state_;
 };
 
+// A field of a line parsed by a BlockCSVParser. The span points into the buffer
+// of the parser.
+using CSVField = Span<char>;
+
+// Returns a copy of the contents of 'field'.
+inline string ToString(CSVField field) {
+  return string(field.begin(), field.end());
+}
+
+// A RecordBatch stores the fields of several lines of CSV input that all have
+// the same number of fields. The characters of all fields are stored in one
+// buffer and each column has arrays of offsets into that buffer, so a batch
+// that is reused allocates no memory once it has grown to fit the largest
+// batch. A batch is filled by BlockCSVParser::NextBatch.
+//
+// Example.
+//   util::RecordBatch batch(num_columns);
+//   while (parser.NextBatch(kBatchSize, &batch) > 0) {
+//     for (size_t row = 0; row < batch.NumRows(); ++row) {
+//       util::CSVField field = batch.Get(row, 0);
+//     }
+//   }
+class RecordBatch {
+ public:
+  explicit RecordBatch(size_t num_columns);
+
+  size_t NumColumns() const { return columns_.size(); }
+  size_t NumRows() const { return num_rows_; }
+  // Returns the number of lines that were read into the batch but not stored
+  // because they could not be tokenized or did not have NumColumns() fields.
+  size_t NumSkipped() const { return num_skipped_; }
+  // Returns the field in column 'column' of row 'row'. The field is
+  // invalidated when the batch is filled again.
+  // - Requires that 'row' is less than NumRows() and 'column' is less than
+  //   NumColumns().
+  CSVField Get(size_t row, size_t column) const;
+  // Removes all rows but keeps the memory allocated for them.
+  void Clear();
+
+ private:
+  friend class BlockCSVParser;
+  // Appends a row. Requires that 'fields' has NumColumns() elements.
+  void AddRow(Span<CSVField> fields);
+
+  // The characters of field (row, column) are chars_[begins[row]] up to
+  // chars_[ends[row]] for the entry 'column' of 'columns_'.
+  struct Column {
+    std::vector<size_t> begins;
+    std::vector<size_t> ends;
+  };
+  std::vector<char> chars_;
+  std::vector<Column> columns_;
+  size_t num_rows_;
+  size_t num_skipped_;
+};
+
+// The BlockCSVParser extracts the same fields as the CSVParser and is meant for
+// inputs with a very large number of lines. The input is read in large blocks
+// and the fields of a line are returned as spans into the block, so once the
+// buffer is large enough for the longest line, no memory is allocated for a
+// line or a field. Quotes and escape sequences are removed in place, which is
+// possible because a field is never longer than the text it is parsed from.
+// Unlike the CSVParser, the empty input contains no lines, and a newline at the
+// end of the input does not produce an additional empty line.
+//
+// Example.
+//   util::BlockCSVParser parser(new std::ifstream(filename));
+//   while (parser.Next()) {
+//     if (!parser.ok()) continue;
+//     for (util::CSVField field : parser.fields()) {
+//       // Use the field.
+//     }
+//   }
+class BlockCSVParser {
+ public:
+  // The BlockCSVParser takes ownership of 'input'. A null input or an input
+  // that is not readable contains no lines.
+  explicit BlockCSVParser(std::istream* input);
+  // Creates a BlockCSVParser that uses 'delim' as the field delimiter.
+  BlockCSVParser(std::istream* input, char delim);
+  // Creates a BlockCSVParser for the 'size' characters starting at 'data', which
+  // are copied into the buffer of the parser.
+  BlockCSVParser(const char* data, size_t size, char delim);
+  // Disallow copying and assignment.
+  BlockCSVParser(const BlockCSVParser&) = delete;
+  BlockCSVParser& operator=(const BlockCSVParser&) = delete;
+
+  // Parses the next line of the input. Returns false if there are no more
+  // lines, and true otherwise.
+  bool Next();
+  // The fields of the line parsed by the last call to Next(). The fields are
+  // invalidated by the next call to Next(). If ok() is false, the line could
+  // not be tokenized and there are no fields.
+  Span<CSVField> fields() const { return Span<CSVField>(fields_); }
+  bool ok() const { return status_.ok(); }
+  // Clears 'batch' and reads up to 'max_lines' lines into it. Lines that
+  // cannot be tokenized or do not have batch->NumColumns() fields are counted
+  // in batch->NumSkipped() instead of being stored. Returns the number of
+  // lines read, which is 0 only at the end of the input. After this call,
+  // fields() is no longer valid.
+  size_t NextBatch(size_t max_lines, RecordBatch* batch);
+
+ private:
+  // Moves the unparsed input to the front of the buffer, grows the buffer if
+  // it is full and reads more input.
+  void Fill();
+  // Splits the characters in [begin, end) into fields.
+  void Tokenize(char* begin, char* end);
+
+  std::unique_ptr<std::istream> input_;
+  const char delim_;
+  // The unparsed input is buffer_[pos_] up to buffer_[size_], and no newline
+  // occurs in the unparsed input before buffer_[scanned_].
+  std::vector<char> buffer_;
+  size_t pos_;
+  size_t size_;
+  size_t scanned_;
+  std::vector<CSVField> fields_;
+  util::Status status_;
+};
+
 }  // namespace util
 }  // namespace morphie
 
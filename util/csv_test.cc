@@ -14,6 +14,8 @@
 #include "util/csv.h"
 
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "gtest.h"
 
@@ -218,6 +220,119 @@ TEST(CSVTest, EscapedInput) {
   TestParser(',', input, results);
 }
 
+// Returns the lines of 'input' as parsed by a BlockCSVParser.
+std::vector<std::vector<string>> BlockParse(char delim, const string& input) {
+  BlockCSVParser parser(new std::stringstream(input), delim);
+  std::vector<std::vector<string>> lines;
+  while (parser.Next()) {
+    EXPECT_TRUE(parser.ok());
+    lines.emplace_back();
+    for (CSVField field : parser.fields()) {
+      lines.back().push_back(ToString(field));
+    }
+  }
+  return lines;
+}
+
+// Returns the lines of 'input' as parsed by a CSVParser.
+std::vector<std::vector<string>> Parse(char delim, const string& input) {
+  CSVParser parser(new std::stringstream(input), delim);
+  std::vector<std::vector<string>> lines;
+  for (const Record& record : parser) {
+    lines.push_back(record.fields());
+  }
+  return lines;
+}
+
+TEST(BlockCSVTest, EmptyInput) {
+  BlockCSVParser null_parser(nullptr);
+  EXPECT_FALSE(null_parser.Next());
+  EXPECT_TRUE(BlockParse(',', "").empty());
+  // Empty lines have no fields.
+  std::vector<std::vector<string>> empty_lines = {{}, {}};
+  EXPECT_EQ(empty_lines, BlockParse(',', "\n\n"));
+}
+
+// The block parser produces the same fields as the CSV parser, except that it
+// does not produce an empty line after a final newline.
+TEST(BlockCSVTest, MatchesCSVParser) {
+  std::vector<string> inputs = {
+      ",", ",\n,\n,", "a,b,c\naa,bb,cc\naaa,bbb,ccc",
+      "a\naa,bb\naaa,bbb,ccc\naaaa,bbbb,cccc,dddd",
+      R"(1",")", "2,\",,\",,\",,,\"", "3,\"\",\"3\"", R"(4,"\"4\"",\"\")",
+      R"(5,",",,"\"")", R"(a\,b,c\nd,e\\f,"g,h")", "abcdefghijklmnop,qrstuvwxyz"};
+  for (const string& input : inputs) {
+    EXPECT_EQ(Parse(',', input), BlockParse(',', input)) << input;
+  }
+  EXPECT_EQ(Parse('.', "a.b\"c.d\".e\n."), BlockParse('.', "a.b\"c.d\".e\n."));
+  std::vector<std::vector<string>> lines = {{"a", "b"}};
+  EXPECT_EQ(lines, BlockParse(',', "a,b\n"));
+}
+
+TEST(BlockCSVTest, RejectsInvalidEscapes) {
+  BlockCSVParser parser(new std::stringstream("a\\x,b\nc,d\\\ne"));
+  ASSERT_TRUE(parser.Next());
+  EXPECT_FALSE(parser.ok());
+  EXPECT_TRUE(parser.fields().empty());
+  ASSERT_TRUE(parser.Next());
+  EXPECT_FALSE(parser.ok());
+  ASSERT_TRUE(parser.Next());
+  EXPECT_TRUE(parser.ok());
+  ASSERT_EQ(1, parser.fields().size());
+  EXPECT_EQ("e", ToString(parser.fields()[0]));
+  EXPECT_FALSE(parser.Next());
+}
+
+// Lines that cross block boundaries and lines longer than a block are parsed
+// correctly.
+TEST(BlockCSVTest, ParsesLargeInput) {
+  string input;
+  const int kNumLines = 200000;
+  for (int i = 0; i < kNumLines; ++i) {
+    input += "abc,\"d,e\"," + std::to_string(i) + "\n";
+  }
+  string long_field(3 << 20, 'x');
+  input += long_field + ",y";
+  BlockCSVParser parser(new std::stringstream(input));
+  for (int i = 0; i < kNumLines; ++i) {
+    ASSERT_TRUE(parser.Next());
+    ASSERT_EQ(3, parser.fields().size());
+    EXPECT_EQ("d,e", ToString(parser.fields()[1]));
+    EXPECT_EQ(std::to_string(i), ToString(parser.fields()[2]));
+  }
+  ASSERT_TRUE(parser.Next());
+  ASSERT_EQ(2, parser.fields().size());
+  EXPECT_EQ(long_field, ToString(parser.fields()[0]));
+  EXPECT_FALSE(parser.Next());
+}
+
+TEST(RecordBatchTest, FillsColumnsAndSkipsMalformedLines) {
+  BlockCSVParser parser(
+      new std::stringstream("a,b\nc\nd,\"e,f\"\ng\\x,h\ni,j\nk,l"));
+  RecordBatch batch(2);
+  EXPECT_EQ(2, batch.NumColumns());
+  // The second and fourth lines are skipped.
+  EXPECT_EQ(5, parser.NextBatch(5, &batch));
+  ASSERT_EQ(3, batch.NumRows());
+  EXPECT_EQ(2, batch.NumSkipped());
+  EXPECT_EQ("a", ToString(batch.Get(0, 0)));
+  EXPECT_EQ("e,f", ToString(batch.Get(1, 1)));
+  EXPECT_EQ("i", ToString(batch.Get(2, 0)));
+  EXPECT_EQ("j", ToString(batch.Get(2, 1)));
+  // Refilling the batch replaces its contents.
+  EXPECT_EQ(1, parser.NextBatch(5, &batch));
+  ASSERT_EQ(1, batch.NumRows());
+  EXPECT_EQ(0, batch.NumSkipped());
+  EXPECT_EQ("l", ToString(batch.Get(0, 1)));
+  EXPECT_EQ(0, parser.NextBatch(5, &batch));
+  EXPECT_EQ(0, batch.NumRows());
+}
+
+TEST(RecordBatchDeathTest, RequiresValidPosition) {
+  RecordBatch batch(2);
+  EXPECT_DEATH({ batch.Get(0, 0); }, "Invalid row");
+}
+
 }  // unnamed namespace
 }  // namespace util
 }  // namespace morphie
@@ -0,0 +1,482 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Flat hash maps and sets store their entries in one array of slots and
+// resolve collisions by linear probing, so a lookup reads a few adjacent slots
+// instead of following the bucket and node pointers of std::unordered_map and
+// std::unordered_set. They are meant for maps and sets with small keys that
+// are looked up often, such as the label indexes of a graph.
+//
+// The interface is a subset of the interface of the std containers, with two
+// differences.
+// - Any insertion or erasure invalidates all iterators, pointers and
+//   references to entries, as it may move entries to other slots.
+// - erase() returns nothing, so entries cannot be erased while iterating.
+//
+// Example.
+//   util::FlatHashMap<uint32_t, int> counts;
+//   ++counts[label_id];
+//   auto count_it = counts.find(label_id);
+//   if (count_it != counts.end()) { ... count_it->second ... }
+#ifndef LOGLE_UTIL_FLAT_HASH_MAP_H_
+#define LOGLE_UTIL_FLAT_HASH_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace morphie {
+namespace util {
+namespace internal {
+
+// Mixes the bits of a hash with the finalizer of MurmurHash3. The slot of a
+// key is selected by the low bits of its hash, and std::hash is the identity
+// on integers, so keys that are close to each other would otherwise occupy
+// consecutive slots and lengthen the probes of other keys.
+inline size_t MixHash(size_t hash) {
+  uint64_t mixed = static_cast<uint64_t>(hash);
+  mixed ^= mixed >> 33;
+  mixed *= 0xff51afd7ed558ccdULL;
+  mixed ^= mixed >> 33;
+  mixed *= 0xc4ceb9fe1a85ec53ULL;
+  mixed ^= mixed >> 33;
+  return static_cast<size_t>(mixed);
+}
+
+// The table shared by FlatHashMap and FlatHashSet. An entry of type 'Entry'
+// contains a key, which GetKey()(entry) returns. The table has zero slots or a
+// power of two slots, and is at most three quarters full, so every probe ends
+// at an empty slot. Erasing an entry moves the entries after it in its probe
+// sequence back instead of leaving a tombstone.
+template <typename Key, typename Entry, typename GetKey, typename Hash>
+class FlatHashTable {
+ private:
+  using Slot =
+      typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type;
+
+ public:
+  template <bool kIsConst>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Entry;
+    using difference_type = ptrdiff_t;
+    using pointer = typename std::conditional<kIsConst, const Entry*,
+                                              Entry*>::type;
+    using reference = typename std::conditional<kIsConst, const Entry&,
+                                                Entry&>::type;
+    using Table = typename std::conditional<kIsConst, const FlatHashTable,
+                                            FlatHashTable>::type;
+
+    Iterator() : table_(nullptr), slot_(0) {}
+    // Converts an iterator to a const iterator.
+    template <bool kOtherIsConst,
+              typename = typename std::enable_if<kIsConst &&
+                                                 !kOtherIsConst>::type>
+    Iterator(const Iterator<kOtherIsConst>& other)  // NOLINT
+        : table_(other.table_), slot_(other.slot_) {}
+
+    reference operator*() const { return table_->EntryAt(slot_); }
+    pointer operator->() const { return &table_->EntryAt(slot_); }
+    Iterator& operator++() {
+      ++slot_;
+      SkipEmptySlots();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator copy = *this;
+      ++*this;
+      return copy;
+    }
+    friend bool operator==(const Iterator& a, const Iterator& b) {
+      return a.slot_ == b.slot_;
+    }
+    friend bool operator!=(const Iterator& a, const Iterator& b) {
+      return a.slot_ != b.slot_;
+    }
+
+   private:
+    friend class FlatHashTable;
+    template <bool>
+    friend class Iterator;
+
+    Iterator(Table* table, size_t slot) : table_(table), slot_(slot) {}
+    void SkipEmptySlots() {
+      while (slot_ < table_->is_full_.size() && !table_->is_full_[slot_]) {
+        ++slot_;
+      }
+    }
+
+    Table* table_;
+    size_t slot_;
+  };  // class Iterator
+
+  using key_type = Key;
+  using value_type = Entry;
+  using size_type = size_t;
+  using hasher = Hash;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  FlatHashTable() : size_(0) {}
+  FlatHashTable(const FlatHashTable& other) : size_(0) {
+    reserve(other.size_);
+    for (const Entry& entry : other) {
+      insert(entry);
+    }
+  }
+  FlatHashTable(FlatHashTable&& other) : size_(0) { swap(other); }
+  FlatHashTable& operator=(FlatHashTable other) {
+    swap(other);
+    return *this;
+  }
+  ~FlatHashTable() { clear(); }
+
+  iterator begin() {
+    iterator it(this, 0);
+    it.SkipEmptySlots();
+    return it;
+  }
+  iterator end() { return iterator(this, is_full_.size()); }
+  const_iterator begin() const {
+    const_iterator it(this, 0);
+    it.SkipEmptySlots();
+    return it;
+  }
+  const_iterator end() const { return const_iterator(this, is_full_.size()); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  // Returns the number of slots, each of which holds at most one entry.
+  size_t bucket_count() const { return is_full_.size(); }
+
+  iterator find(const Key& key) {
+    bool is_found = false;
+    size_t slot = FindSlot(key, &is_found);
+    return is_found ? iterator(this, slot) : end();
+  }
+  const_iterator find(const Key& key) const {
+    bool is_found = false;
+    size_t slot = FindSlot(key, &is_found);
+    return is_found ? const_iterator(this, slot) : end();
+  }
+  size_t count(const Key& key) const {
+    bool is_found = false;
+    FindSlot(key, &is_found);
+    return is_found ? 1 : 0;
+  }
+  // Fetches the home slot of 'key' into the cache without waiting for it, so
+  // that a later lookup of 'key' does not stall on a cache miss. Callers that
+  // look up many keys prefetch each key a few lookups ahead of its lookup.
+  void prefetch(const Key& key) const {
+#if defined(__GNUC__)
+    if (!is_full_.empty()) {
+      const size_t slot = HomeSlot(key);
+      __builtin_prefetch(&is_full_[slot]);
+      __builtin_prefetch(&slots_[slot]);
+    }
+#endif
+  }
+
+  // Inserts 'entry' unless the table has an entry with the same key. Returns
+  // an iterator to the entry with the key and true if 'entry' was inserted.
+  std::pair<iterator, bool> insert(const Entry& entry) {
+    return Insert(Entry(entry));
+  }
+  std::pair<iterator, bool> insert(Entry&& entry) {
+    return Insert(std::move(entry));
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return Insert(Entry(std::forward<Args>(args)...));
+  }
+
+  void erase(const_iterator position) { EraseSlot(position.slot_); }
+  size_t erase(const Key& key) {
+    bool is_found = false;
+    size_t slot = FindSlot(key, &is_found);
+    if (!is_found) {
+      return 0;
+    }
+    EraseSlot(slot);
+    return 1;
+  }
+
+  void clear() {
+    for (size_t slot = 0; slot < is_full_.size(); ++slot) {
+      if (is_full_[slot]) {
+        EntryAt(slot).~Entry();
+      }
+    }
+    slots_.clear();
+    is_full_.clear();
+    size_ = 0;
+  }
+
+  // Allocates enough slots for 'num_entries' entries.
+  void reserve(size_t num_entries) {
+    const size_t num_slots = NumSlotsFor(num_entries);
+    if (num_slots > is_full_.size()) {
+      Rehash(num_slots);
+    }
+  }
+  // Moves the entries into the fewest slots that hold them, releasing the
+  // slots left by erased entries or by a larger reservation. An empty table
+  // releases all of its slots.
+  void shrink_to_fit() {
+    const size_t num_slots = empty() ? 0 : NumSlotsFor(size_);
+    if (num_slots < is_full_.size()) {
+      Rehash(num_slots);
+    }
+  }
+
+  void swap(FlatHashTable& other) {
+    slots_.swap(other.slots_);
+    is_full_.swap(other.is_full_);
+    std::swap(size_, other.size_);
+  }
+
+ protected:
+  // Returns an iterator to the entry with 'key', which is inserted with a
+  // value constructed by 'make_entry' if the table has no entry with 'key'.
+  template <typename MakeEntry>
+  iterator FindOrInsert(const Key& key, MakeEntry make_entry) {
+    bool is_found = false;
+    size_t slot = FindSlot(key, &is_found);
+    if (is_found) {
+      return iterator(this, slot);
+    }
+    if (4 * (size_ + 1) > 3 * is_full_.size()) {
+      Rehash(std::max(kMinSlots, 2 * is_full_.size()));
+      slot = FindSlot(key, &is_found);
+    }
+    new (&slots_[slot]) Entry(make_entry());
+    is_full_[slot] = 1;
+    ++size_;
+    return iterator(this, slot);
+  }
+
+ private:
+  // The number of slots of a table after its first insertion.
+  static const size_t kMinSlots = 16;
+
+  // Returns the number of slots that holds 'num_entries' entries without
+  // exceeding the maximum load of 3/4.
+  static size_t NumSlotsFor(size_t num_entries) {
+    size_t num_slots = kMinSlots;
+    while (3 * num_slots < 4 * num_entries) {
+      num_slots *= 2;
+    }
+    return num_slots;
+  }
+
+  Entry& EntryAt(size_t slot) {
+    return *reinterpret_cast<Entry*>(&slots_[slot]);
+  }
+  const Entry& EntryAt(size_t slot) const {
+    return *reinterpret_cast<const Entry*>(&slots_[slot]);
+  }
+  size_t HomeSlot(const Key& key) const {
+    return MixHash(Hash()(key)) & (is_full_.size() - 1);
+  }
+
+  // Returns the slot with 'key' and sets 'is_found' to true, or returns the
+  // empty slot at which the probe for 'key' ends and sets 'is_found' to false.
+  size_t FindSlot(const Key& key, bool* is_found) const {
+    *is_found = false;
+    if (is_full_.empty()) {
+      return 0;
+    }
+    const size_t mask = is_full_.size() - 1;
+    size_t slot = HomeSlot(key);
+    while (is_full_[slot]) {
+      if (GetKey()(EntryAt(slot)) == key) {
+        *is_found = true;
+        return slot;
+      }
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  std::pair<iterator, bool> Insert(Entry&& entry) {
+    size_t old_size = size_;
+    iterator it = FindOrInsert(GetKey()(entry),
+                               [&entry]() { return std::move(entry); });
+    return {it, size_ != old_size};
+  }
+
+  // An entry after the hole is moved into the hole unless its home slot is
+  // after the hole, in which case a probe for its key would not pass the hole.
+  void EraseSlot(size_t hole) {
+    const size_t mask = is_full_.size() - 1;
+    EntryAt(hole).~Entry();
+    for (size_t slot = (hole + 1) & mask; is_full_[slot];
+         slot = (slot + 1) & mask) {
+      size_t home = HomeSlot(GetKey()(EntryAt(slot)));
+      if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+        new (&slots_[hole]) Entry(std::move(EntryAt(slot)));
+        EntryAt(slot).~Entry();
+        hole = slot;
+      }
+    }
+    is_full_[hole] = 0;
+    --size_;
+  }
+
+  void Rehash(size_t num_slots) {
+    std::vector<Slot> old_slots(num_slots);
+    std::vector<char> old_is_full(num_slots, 0);
+    slots_.swap(old_slots);
+    is_full_.swap(old_is_full);
+    const size_t mask = num_slots - 1;
+    for (size_t old_slot = 0; old_slot < old_is_full.size(); ++old_slot) {
+      if (!old_is_full[old_slot]) {
+        continue;
+      }
+      Entry& entry = *reinterpret_cast<Entry*>(&old_slots[old_slot]);
+      size_t slot = HomeSlot(GetKey()(entry));
+      while (is_full_[slot]) {
+        slot = (slot + 1) & mask;
+      }
+      new (&slots_[slot]) Entry(std::move(entry));
+      is_full_[slot] = 1;
+      entry.~Entry();
+    }
+  }
+
+  std::vector<Slot> slots_;
+  // The slot i holds an entry if is_full_[i] is not zero.
+  std::vector<char> is_full_;
+  size_t size_;
+};  // class FlatHashTable
+
+template <typename Key, typename Entry, typename GetKey, typename Hash>
+const size_t FlatHashTable<Key, Entry, GetKey, Hash>::kMinSlots;
+
+template <typename Key, typename Value>
+struct GetMapKey {
+  const Key& operator()(const std::pair<const Key, Value>& entry) const {
+    return entry.first;
+  }
+};
+
+template <typename Key>
+struct GetSetKey {
+  const Key& operator()(const Key& key) const { return key; }
+};
+
+}  // namespace internal
+
+// A map from keys of type 'Key' to values of type 'Value'. Entries are pairs
+// of a const key and a value, as they are in std::unordered_map.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatHashMap
+    : public internal::FlatHashTable<Key, std::pair<const Key, Value>,
+                                     internal::GetMapKey<Key, Value>, Hash> {
+ public:
+  using mapped_type = Value;
+
+  FlatHashMap() {}
+  FlatHashMap(std::initializer_list<std::pair<const Key, Value>> entries) {
+    this->reserve(entries.size());
+    for (const auto& entry : entries) {
+      this->insert(entry);
+    }
+  }
+
+  // Returns the value of 'key', which is inserted with a default constructed
+  // value if the map has no entry with 'key'.
+  Value& operator[](const Key& key) {
+    return this
+        ->FindOrInsert(key,
+                       [&key]() {
+                         return std::pair<const Key, Value>(key, Value());
+                       })
+        ->second;
+  }
+
+  friend bool operator==(const FlatHashMap& a, const FlatHashMap& b) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (const auto& entry : a) {
+      auto b_it = b.find(entry.first);
+      if (b_it == b.end() || !(b_it->second == entry.second)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  friend bool operator!=(const FlatHashMap& a, const FlatHashMap& b) {
+    return !(a == b);
+  }
+};  // class FlatHashMap
+
+// A set of keys of type 'Key'. Keys are not modifiable through iterators.
+template <typename Key, typename Hash = std::hash<Key>>
+class FlatHashSet
+    : public internal::FlatHashTable<Key, Key, internal::GetSetKey<Key>,
+                                     Hash> {
+ private:
+  using Table =
+      internal::FlatHashTable<Key, Key, internal::GetSetKey<Key>, Hash>;
+
+ public:
+  using iterator = typename Table::const_iterator;
+  using const_iterator = typename Table::const_iterator;
+
+  FlatHashSet() {}
+  FlatHashSet(std::initializer_list<Key> keys) {
+    this->reserve(keys.size());
+    for (const Key& key : keys) {
+      Table::insert(key);
+    }
+  }
+
+  const_iterator begin() const { return Table::begin(); }
+  const_iterator end() const { return Table::end(); }
+  const_iterator find(const Key& key) const { return Table::find(key); }
+  std::pair<const_iterator, bool> insert(const Key& key) {
+    auto inserted = Table::insert(key);
+    return {inserted.first, inserted.second};
+  }
+
+  friend bool operator==(const FlatHashSet& a, const FlatHashSet& b) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (const Key& key : a) {
+      if (b.count(key) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+  friend bool operator!=(const FlatHashSet& a, const FlatHashSet& b) {
+    return !(a == b);
+  }
+};  // class FlatHashSet
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_FLAT_HASH_MAP_H_
@@ -0,0 +1,140 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/flat_hash_map.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "base/string.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+TEST(FlatHashMapTest, EmptyMap) {
+  FlatHashMap<int, int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.begin(), map.end());
+  EXPECT_EQ(map.end(), map.find(1));
+  EXPECT_EQ(0, map.count(1));
+  EXPECT_EQ(0, map.erase(1));
+}
+
+TEST(FlatHashMapTest, InsertsAndFindsEntries) {
+  FlatHashMap<int, string> map;
+  EXPECT_TRUE(map.insert({1, "one"}).second);
+  EXPECT_TRUE(map.emplace(2, "two").second);
+  auto inserted = map.insert({1, "uno"});
+  EXPECT_FALSE(inserted.second);
+  EXPECT_EQ("one", inserted.first->second);
+  map[3] = "three";
+  EXPECT_EQ("", map[4]);
+  EXPECT_EQ(4, map.size());
+  auto entry_it = map.find(2);
+  ASSERT_NE(map.end(), entry_it);
+  EXPECT_EQ("two", entry_it->second);
+  EXPECT_EQ(map.end(), map.find(5));
+  FlatHashMap<int, string> copy(map);
+  EXPECT_EQ(map, copy);
+  copy[4] = "four";
+  EXPECT_NE(map, copy);
+}
+
+// Inserts and erases enough keys to grow the map several times and compares it
+// with an unordered_map after every operation. Consecutive keys collide in the
+// low bits of the identity hash, which the map mixes.
+TEST(FlatHashMapTest, MatchesUnorderedMap) {
+  FlatHashMap<int, int> map;
+  std::unordered_map<int, int> expected;
+  for (int key = 0; key < 2000; ++key) {
+    map[key * 16] = key;
+    expected[key * 16] = key;
+  }
+  for (int key = 0; key < 2000; key += 3) {
+    EXPECT_EQ(1, map.erase(key * 16));
+    expected.erase(key * 16);
+  }
+  ASSERT_EQ(expected.size(), map.size());
+  for (int key = 0; key < 2000; ++key) {
+    auto entry_it = map.find(key * 16);
+    if (key % 3 == 0) {
+      EXPECT_EQ(map.end(), entry_it);
+    } else {
+      ASSERT_NE(map.end(), entry_it);
+      EXPECT_EQ(key, entry_it->second);
+    }
+  }
+  size_t num_entries = 0;
+  for (const auto& entry : map) {
+    EXPECT_EQ(expected[entry.first], entry.second);
+    ++num_entries;
+  }
+  EXPECT_EQ(expected.size(), num_entries);
+}
+
+// Entries that cannot be copied are moved when the map grows or an entry is
+// erased.
+TEST(FlatHashMapTest, MovesEntries) {
+  FlatHashMap<int, std::unique_ptr<int>> map;
+  for (int key = 0; key < 100; ++key) {
+    map[key].reset(new int(key));
+  }
+  map.erase(map.find(50));
+  EXPECT_EQ(99, map.size());
+  for (const auto& entry : map) {
+    EXPECT_EQ(entry.first, *entry.second);
+  }
+  FlatHashMap<int, std::unique_ptr<int>> moved(std::move(map));
+  EXPECT_EQ(99, moved.size());
+  moved.clear();
+  EXPECT_TRUE(moved.empty());
+}
+
+TEST(FlatHashMapTest, ShrinksToFit) {
+  FlatHashMap<int, int> map;
+  map.reserve(1000);
+  for (int key = 0; key < 100; ++key) {
+    map[key] = 2 * key;
+  }
+  map.shrink_to_fit();
+  EXPECT_EQ(256, map.bucket_count());
+  EXPECT_EQ(100, map.size());
+  for (int key = 0; key < 100; ++key) {
+    ASSERT_NE(map.end(), map.find(key));
+    EXPECT_EQ(2 * key, map.find(key)->second);
+  }
+  map.clear();
+  map.shrink_to_fit();
+  EXPECT_EQ(0, map.bucket_count());
+  map[1] = 1;
+  EXPECT_EQ(1, map.find(1)->second);
+}
+
+TEST(FlatHashSetTest, InsertsFindsAndErasesKeys) {
+  FlatHashSet<string> set = {"a", "b"};
+  EXPECT_FALSE(set.insert("a").second);
+  EXPECT_TRUE(set.insert("c").second);
+  EXPECT_EQ(3, set.size());
+  EXPECT_EQ(1, set.count("b"));
+  EXPECT_EQ(1, set.erase("b"));
+  EXPECT_EQ(set.end(), set.find("b"));
+  EXPECT_EQ(FlatHashSet<string>({"c", "a"}), set);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
@@ -1,5 +1,17 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <utility>
 
 #include "base/string.h"
 #include "json_reader.h"
@@ -7,6 +19,412 @@
 
 namespace morphie {
 
+namespace {
+
+const char kMappedEndErr[] = "Called Next at the end of a stream.";
+const char kMappedFormatErr[] = "Line is not in JSON format";
+const char kNotOpenErr[] = "The JSON stream file is not open.";
+const char kNotDictErr[] = "JSON object is not a dict.";
+const char kNotJsonErr[] = "File is not in JSON format.";
+const char kFullEndErr[] = "Called Next after last object is received.";
+
+// Appends the UTF-8 encoding of 'code_point' to 'str'.
+void AppendUtf8(uint32_t code_point, std::string* str) {
+  if (code_point < 0x80) {
+    str->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    str->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    str->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    str->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    str->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    str->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    str->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+// A pull parser for one line of JSON stream input. The parser reads the
+// characters in [begin, end) in place and only allocates memory for the values
+// it keeps. The functions return false if the input is not well-formed JSON.
+// Values that are skipped are only checked for balanced brackets and quotes.
+class JsonLineParser {
+ public:
+  JsonLineParser(const char* begin, const char* end) : pos_(begin), end_(end) {}
+
+  // Parses an object that spans the whole input and sets 'object' to contain
+  // the members whose names are in 'fields', or all members if 'fields' is
+  // empty.
+  bool ParseObject(const std::set<std::string>& fields, Json::Value* object);
+  // Parses an object that spans the whole input and, for each member whose
+  // name is in 'field_ids', sets the entries of the vectors at the id of the
+  // name as described for JsonFieldReader.
+  bool ParseFields(const std::unordered_map<std::string, int>& field_ids,
+                   std::vector<bool>* has_field, std::vector<bool>* is_string,
+                   std::vector<std::string>* texts);
+
+ private:
+  // Parses an object that spans the whole input. 'parse_member' is called with
+  // the name of each member when the value of the member is next in the input,
+  // and returns false if the value could not be parsed or skipped.
+  template <typename ParseMember>
+  bool ParseMembers(ParseMember parse_member);
+  void SkipSpace();
+  bool Consume(char c);
+  bool ParseString(std::string* str);
+  bool ParseHex4(uint32_t* code_unit);
+  bool ParseValue(Json::Value* value);
+  bool ParseNumber(Json::Value* value);
+  bool ParseLiteral(const char* literal);
+  bool SkipString();
+  bool SkipValue();
+
+  const char* pos_;
+  const char* end_;
+  // Buffers that are reused across members.
+  std::string key_;
+  std::string token_;
+};
+
+bool JsonLineParser::ParseObject(const std::set<std::string>& fields,
+                                 Json::Value* object) {
+  if (object->isObject()) {
+    object->clear();
+  } else {
+    *object = Json::Value(Json::objectValue);
+  }
+  return ParseMembers([this, &fields, object](const std::string& key) {
+    bool is_kept = fields.empty() || fields.find(key) != fields.end();
+    return is_kept ? ParseValue(&(*object)[key]) : SkipValue();
+  });
+}
+
+// The contents of a string are decoded and other values are copied as text.
+bool JsonLineParser::ParseFields(
+    const std::unordered_map<std::string, int>& field_ids,
+    std::vector<bool>* has_field, std::vector<bool>* is_string,
+    std::vector<std::string>* texts) {
+  std::fill(has_field->begin(), has_field->end(), false);
+  return ParseMembers([this, &field_ids, has_field, is_string,
+                       texts](const std::string& key) {
+    auto id_it = field_ids.find(key);
+    if (id_it == field_ids.end()) {
+      return SkipValue();
+    }
+    const int id = id_it->second;
+    (*has_field)[id] = true;
+    (*is_string)[id] = (pos_ != end_ && *pos_ == '"');
+    if ((*is_string)[id]) {
+      return ParseString(&(*texts)[id]);
+    }
+    const char* begin = pos_;
+    if (!SkipValue()) {
+      return false;
+    }
+    (*texts)[id].assign(begin, pos_);
+    return true;
+  });
+}
+
+template <typename ParseMember>
+bool JsonLineParser::ParseMembers(ParseMember parse_member) {
+  SkipSpace();
+  if (!Consume('{')) {
+    return false;
+  }
+  SkipSpace();
+  if (!Consume('}')) {
+    while (true) {
+      SkipSpace();
+      if (!ParseString(&key_)) {
+        return false;
+      }
+      SkipSpace();
+      if (!Consume(':')) {
+        return false;
+      }
+      SkipSpace();
+      if (!parse_member(key_)) {
+        return false;
+      }
+      SkipSpace();
+      if (Consume('}')) {
+        break;
+      }
+      if (!Consume(',')) {
+        return false;
+      }
+    }
+  }
+  SkipSpace();
+  return pos_ == end_;
+}
+
+void JsonLineParser::SkipSpace() {
+  while (pos_ != end_ &&
+         (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r' || *pos_ == '\n')) {
+    ++pos_;
+  }
+}
+
+bool JsonLineParser::Consume(char c) {
+  if (pos_ == end_ || *pos_ != c) {
+    return false;
+  }
+  ++pos_;
+  return true;
+}
+
+// Runs of characters without escapes are appended in one call.
+bool JsonLineParser::ParseString(std::string* str) {
+  str->clear();
+  if (!Consume('"')) {
+    return false;
+  }
+  while (pos_ != end_) {
+    const char* run = pos_;
+    while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\') {
+      ++pos_;
+    }
+    str->append(run, pos_);
+    if (pos_ == end_) {
+      return false;
+    }
+    if (*pos_ == '"') {
+      ++pos_;
+      return true;
+    }
+    ++pos_;
+    if (pos_ == end_) {
+      return false;
+    }
+    char escaped = *pos_++;
+    switch (escaped) {
+      case '"':
+      case '\\':
+      case '/':
+        str->push_back(escaped);
+        break;
+      case 'b':
+        str->push_back('\b');
+        break;
+      case 'f':
+        str->push_back('\f');
+        break;
+      case 'n':
+        str->push_back('\n');
+        break;
+      case 'r':
+        str->push_back('\r');
+        break;
+      case 't':
+        str->push_back('\t');
+        break;
+      case 'u': {
+        uint32_t code_point;
+        if (!ParseHex4(&code_point)) {
+          return false;
+        }
+        // A high surrogate must be followed by an escaped low surrogate.
+        if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+          uint32_t low;
+          if (!Consume('\\') || !Consume('u') || !ParseHex4(&low) ||
+              low < 0xDC00 || low > 0xDFFF) {
+            return false;
+          }
+          code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+        }
+        AppendUtf8(code_point, str);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return false;
+}
+
+bool JsonLineParser::ParseHex4(uint32_t* code_unit) {
+  if (end_ - pos_ < 4) {
+    return false;
+  }
+  *code_unit = 0;
+  for (int i = 0; i < 4; ++i, ++pos_) {
+    char c = *pos_;
+    uint32_t digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    *code_unit = (*code_unit << 4) | digit;
+  }
+  return true;
+}
+
+bool JsonLineParser::ParseValue(Json::Value* value) {
+  if (pos_ == end_) {
+    return false;
+  }
+  switch (*pos_) {
+    case '"':
+      if (!ParseString(&token_)) {
+        return false;
+      }
+      *value = token_;
+      return true;
+    case '{':
+    case '[': {
+      // Nested values are rare in Plaso output, so they are parsed by the
+      // general JSON reader.
+      const char* begin = pos_;
+      if (!SkipValue()) {
+        return false;
+      }
+      Json::Reader json_reader;
+      return json_reader.parse(begin, pos_, *value,
+                               false /*Do not parse comments*/);
+    }
+    case 't':
+      *value = true;
+      return ParseLiteral("true");
+    case 'f':
+      *value = false;
+      return ParseLiteral("false");
+    case 'n':
+      *value = Json::Value();
+      return ParseLiteral("null");
+    default:
+      return ParseNumber(value);
+  }
+}
+
+// Integers are stored with the same types that Json::Reader uses: a signed
+// integer for negative values and values up to INT_MAX and an unsigned integer
+// otherwise. Integers that do not fit in 64 bits and numbers with a fraction or
+// an exponent are stored as doubles.
+bool JsonLineParser::ParseNumber(Json::Value* value) {
+  const char* begin = pos_;
+  bool is_integral = true;
+  while (pos_ != end_) {
+    char c = *pos_;
+    if (c == '.' || c == 'e' || c == 'E' || c == '+') {
+      is_integral = false;
+    } else if (!(c == '-' || (c >= '0' && c <= '9'))) {
+      break;
+    }
+    ++pos_;
+  }
+  if (pos_ == begin) {
+    return false;
+  }
+  token_.assign(begin, pos_);
+  const char* str = token_.c_str();
+  char* str_end;
+  errno = 0;
+  if (is_integral) {
+    if (*str == '-') {
+      long long int_value = std::strtoll(str, &str_end, 10);
+      if (errno == 0 && *str_end == '\0') {
+        *value = static_cast<Json::Int64>(int_value);
+        return true;
+      }
+    } else {
+      unsigned long long uint_value = std::strtoull(str, &str_end, 10);
+      if (errno == 0 && *str_end == '\0') {
+        if (uint_value <= static_cast<unsigned long long>(INT_MAX)) {
+          *value = static_cast<Json::Int64>(uint_value);
+        } else {
+          *value = static_cast<Json::UInt64>(uint_value);
+        }
+        return true;
+      }
+    }
+    errno = 0;
+  }
+  double double_value = std::strtod(str, &str_end);
+  if (errno != 0 || *str_end != '\0') {
+    return false;
+  }
+  *value = double_value;
+  return true;
+}
+
+bool JsonLineParser::ParseLiteral(const char* literal) {
+  size_t length = std::strlen(literal);
+  if (static_cast<size_t>(end_ - pos_) < length ||
+      std::memcmp(pos_, literal, length) != 0) {
+    return false;
+  }
+  pos_ += length;
+  return true;
+}
+
+bool JsonLineParser::SkipString() {
+  if (!Consume('"')) {
+    return false;
+  }
+  while (pos_ != end_) {
+    char c = *pos_++;
+    if (c == '"') {
+      return true;
+    }
+    if (c == '\\') {
+      if (pos_ == end_) {
+        return false;
+      }
+      ++pos_;
+    }
+  }
+  return false;
+}
+
+bool JsonLineParser::SkipValue() {
+  if (pos_ == end_) {
+    return false;
+  }
+  if (*pos_ == '"') {
+    return SkipString();
+  }
+  if (*pos_ == '{' || *pos_ == '[') {
+    int depth = 0;
+    while (pos_ != end_) {
+      char c = *pos_;
+      if (c == '"') {
+        if (!SkipString()) {
+          return false;
+        }
+        continue;
+      }
+      ++pos_;
+      if (c == '{' || c == '[') {
+        ++depth;
+      } else if (c == '}' || c == ']') {
+        if (--depth == 0) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+  // A number or a literal extends up to the next delimiter.
+  const char* begin = pos_;
+  while (pos_ != end_ && *pos_ != ',' && *pos_ != '}' && *pos_ != ']' &&
+         *pos_ != ' ' && *pos_ != '\t' && *pos_ != '\r' && *pos_ != '\n') {
+    ++pos_;
+  }
+  return pos_ != begin;
+}
+
+}  // namespace
+
 std::unique_ptr<Json::Value> GetJsonDoc(std::istream* json_stream) {
   Json::Reader json_reader;
   std::unique_ptr<Json::Value> json_doc(new Json::Value);
@@ -38,6 +456,130 @@ const Json::Value* FullJson::Next() {
 FullJson::~FullJson() {
 }
 
+IncrementalFullJson::IncrementalFullJson(std::istream* json_stream,
+                                         const std::set<std::string>& fields)
+    : input_(json_stream->rdbuf()), fields_(fields) {
+  CHECK(PeekNonSpace() == '{', kNotDictErr);
+  input_->sbumpc();
+  ReadMemberName(true);
+}
+
+IncrementalFullJson::~IncrementalFullJson() {
+}
+
+bool IncrementalFullJson::HasNext() {
+  return has_next_;
+}
+
+// The text of a member value is copied to a buffer and parsed there, after
+// which the buffer is reused for the next member.
+const Json::Value* IncrementalFullJson::Next() {
+  CHECK(HasNext(), kFullEndErr);
+  name_.swap(next_name_);
+  value_text_.clear();
+  ReadValueText();
+  bool success;
+  if (!value_text_.empty() && value_text_[0] == '{') {
+    JsonLineParser parser(value_text_.data(),
+                          value_text_.data() + value_text_.size());
+    success = parser.ParseObject(fields_, &current_object_);
+  } else {
+    Json::Reader json_reader;
+    success = json_reader.parse(value_text_, current_object_,
+                                false /*Do not parse comments*/);
+  }
+  CHECK(success, kNotJsonErr);
+  int c = PeekNonSpace();
+  input_->sbumpc();
+  if (c == ',') {
+    ReadMemberName(false);
+  } else {
+    CHECK(c == '}', kNotJsonErr);
+    has_next_ = false;
+  }
+  return &current_object_;
+}
+
+int IncrementalFullJson::PeekNonSpace() {
+  int c = input_->sgetc();
+  while (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+    c = input_->snextc();
+  }
+  return c;
+}
+
+void IncrementalFullJson::ReadMemberName(bool is_first) {
+  int c = PeekNonSpace();
+  if (is_first && c == '}') {
+    input_->sbumpc();
+    has_next_ = false;
+    return;
+  }
+  CHECK(c == '"', kNotJsonErr);
+  input_->sbumpc();
+  next_name_.clear();
+  bool has_escape = false;
+  for (c = input_->sbumpc(); c != '"'; c = input_->sbumpc()) {
+    CHECK(c != EOF, kNotJsonErr);
+    next_name_.push_back(static_cast<char>(c));
+    if (c == '\\') {
+      has_escape = true;
+      c = input_->sbumpc();
+      CHECK(c != EOF, kNotJsonErr);
+      next_name_.push_back(static_cast<char>(c));
+    }
+  }
+  // Names with escape sequences are rare, so they are decoded by the JSON
+  // library rather than here.
+  if (has_escape) {
+    Json::Value name;
+    CHECK(Json::Reader().parse("\"" + next_name_ + "\"", name, false) &&
+              name.isString(),
+          kNotJsonErr);
+    next_name_ = name.asString();
+  }
+  CHECK(PeekNonSpace() == ':', kNotJsonErr);
+  input_->sbumpc();
+  has_next_ = true;
+}
+
+// The value ends when the brackets opened by it are closed or, for a scalar,
+// at the next delimiter. Brackets inside strings are not counted.
+void IncrementalFullJson::ReadValueText() {
+  int depth = 0;
+  bool in_string = false;
+  int c = PeekNonSpace();
+  while (c != EOF) {
+    if (in_string) {
+      if (c == '\\') {
+        value_text_.push_back(static_cast<char>(c));
+        c = input_->snextc();
+        CHECK(c != EOF, kNotJsonErr);
+      } else if (c == '"') {
+        in_string = false;
+      }
+    } else if (c == '"') {
+      in_string = true;
+    } else if (c == '{' || c == '[') {
+      ++depth;
+    } else if (c == '}' || c == ']') {
+      if (depth == 0) {
+        break;
+      }
+      --depth;
+    } else if (depth == 0 && (c == ',' || c == ' ' || c == '\t' ||
+                              c == '\r' || c == '\n')) {
+      break;
+    }
+    value_text_.push_back(static_cast<char>(c));
+    c = input_->snextc();
+    if (depth == 0 && !in_string && !value_text_.empty() &&
+        (value_text_.back() == '}' || value_text_.back() == ']')) {
+      break;
+    }
+  }
+}
+
 StreamJson::StreamJson(std::istream* json_stream) {
   input_file_ = json_stream;
 }
@@ -63,4 +605,93 @@ const Json::Value* StreamJson::Next() {
 StreamJson::~StreamJson() {
 }
 
+// The file descriptor is closed as soon as the file is mapped because the
+// mapping remains valid without it.
+MappedJsonLines::MappedJsonLines(const std::string& filename,
+                                 const std::set<std::string>& fields)
+    : fields_(fields) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return;
+  }
+  mapping_size_ = static_cast<size_t>(file_stat.st_size);
+  if (mapping_size_ > 0) {
+    void* mapping =
+        mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      return;
+    }
+    madvise(mapping, mapping_size_, MADV_SEQUENTIAL);
+    mapping_ = mapping;
+    next_ = static_cast<const char*>(mapping_);
+    end_ = next_ + mapping_size_;
+  }
+  close(fd);
+  is_open_ = true;
+}
+
+MappedJsonLines::~MappedJsonLines() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+}
+
+bool MappedJsonLines::HasNext() {
+  CHECK(is_open_, kNotOpenErr);
+  return next_ != end_ && *next_ != '\n';
+}
+
+// memchr is vectorized by the C library, so line boundaries are found without
+// examining one character at a time.
+const Json::Value* MappedJsonLines::Next() {
+  CHECK(HasNext(), kMappedEndErr);
+  const char* line_end = static_cast<const char*>(
+      std::memchr(next_, '\n', static_cast<size_t>(end_ - next_)));
+  if (line_end == nullptr) {
+    line_end = end_;
+  }
+  JsonLineParser parser(next_, line_end);
+  bool success = parser.ParseObject(fields_, &current_object_);
+  CHECK(success, kMappedFormatErr);
+  next_ = (line_end == end_) ? end_ : line_end + 1;
+  return &current_object_;
+}
+
+ChainedJson::ChainedJson(
+    std::vector<std::unique_ptr<JsonDocumentIterator>> inputs)
+    : inputs_(std::move(inputs)) {}
+
+// Iterators are skipped once they are exhausted, including empty ones.
+bool ChainedJson::HasNext() {
+  while (current_ < inputs_.size() && !inputs_[current_]->HasNext()) {
+    ++current_;
+  }
+  return current_ < inputs_.size();
+}
+
+const Json::Value* ChainedJson::Next() {
+  CHECK(HasNext(), "Called Next at the end of a stream.");
+  return inputs_[current_]->Next();
+}
+
+JsonFieldReader::JsonFieldReader(const std::vector<std::string>& fields)
+    : has_field_(fields.size(), false),
+      is_string_(fields.size(), false),
+      texts_(fields.size()) {
+  for (size_t i = 0; i < fields.size(); ++i) {
+    field_ids_[fields[i]] = static_cast<int>(i);
+  }
+}
+
+bool JsonFieldReader::Parse(const char* begin, const char* end) {
+  JsonLineParser parser(begin, end);
+  return parser.ParseFields(field_ids_, &has_field_, &is_string_, &texts_);
+}
+
 }  // namespace morphie
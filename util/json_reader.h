@@ -3,6 +3,10 @@
 
 #include <fstream>
 #include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "json/json.h"
 
@@ -54,6 +58,55 @@ class FullJson: public JsonDocumentIterator{
   int current_index_ = 0;
 };
 
+// Support for loading objects from one monolithic JSON object without holding
+// the whole document in memory. The input is scanned one member at a time, so
+// memory use is bounded by the size of the largest member. Members whose value
+// is an object are parsed as in MappedJsonLines, keeping only the fields named
+// in 'fields', or all fields if 'fields' is empty. Unlike FullJson, objects are
+// returned in the order in which they occur in the input rather than in the
+// order of their names, and a name that occurs twice yields two objects.
+class IncrementalFullJson: public JsonDocumentIterator{
+ public:
+  // Crashes if the input does not begin with a JSON object.
+  IncrementalFullJson(std::istream* json_stream,
+                      const std::set<std::string>& fields);
+  ~IncrementalFullJson();
+  // Disallow copying and assignment.
+  IncrementalFullJson(const IncrementalFullJson&) = delete;
+  IncrementalFullJson& operator=(const IncrementalFullJson&) = delete;
+
+  bool HasNext();
+  // Crashes if the input is not well-formed JSON.
+  const Json::Value* Next();
+  // Returns the name of the member whose value was returned by the last call
+  // to Next(), or the empty string if Next() has not been called. The
+  // reference is valid until the next call to Next().
+  const std::string& Name() const { return name_; }
+ private:
+  // Skips whitespace and returns the next character of the input without
+  // consuming it, or EOF at the end of the input.
+  int PeekNonSpace();
+  // Reads the name of the next member into 'next_name_' and the colon after
+  // it, or the closing brace of the document, and sets 'has_next_'
+  // accordingly.
+  void ReadMemberName(bool is_first);
+  // Appends the text of the JSON value at the current position to
+  // 'value_text_'.
+  void ReadValueText();
+
+  std::streambuf* input_;
+  bool has_next_ = false;
+  const std::set<std::string> fields_;
+  // A buffer that holds the text of the current member value.
+  std::string value_text_;
+  // The names of the member returned by the last call to Next() and of the
+  // member that the next call returns.
+  std::string name_;
+  std::string next_name_;
+  // Contains the last parsed JSON object.
+  Json::Value current_object_;
+};
+
 // Support for JSON stream format.
 // Each line of input file is one JSON encoded object
 // Example:
@@ -72,6 +125,109 @@ class StreamJson: public JsonDocumentIterator{
   Json::Value current_object_;
 };
 
+// Support for JSON stream format read from a memory-mapped file. The file is
+// mapped once and lines are located with memchr, so no line is copied. Each
+// line is scanned by a small pull parser that only builds values for the
+// top-level fields named in 'fields' and skips over all other fields. If
+// 'fields' is empty, every top-level field is kept. Scalar fields are decoded
+// directly and nested objects and arrays are handed to Json::Reader.
+// As with StreamJson, iteration stops at the end of the file or at the first
+// empty line.
+// Example:
+//   MappedJsonLines json_lines("events.jsonl", {"timestamp"});
+//   while (json_lines.IsOpen() && json_lines.HasNext()) {
+//     const Json::Value* event = json_lines.Next();
+//     ...
+//   }
+class MappedJsonLines: public JsonDocumentIterator{
+ public:
+  MappedJsonLines(const std::string& filename,
+                  const std::set<std::string>& fields);
+  ~MappedJsonLines();
+  // Disallow copying and assignment.
+  MappedJsonLines(const MappedJsonLines&) = delete;
+  MappedJsonLines& operator=(const MappedJsonLines&) = delete;
+
+  // Returns true if the file was opened and mapped successfully. The other
+  // functions require that IsOpen() is true.
+  bool IsOpen() const { return is_open_; }
+  bool HasNext();
+  // Crashes if the line is not a JSON object.
+  const Json::Value* Next();
+ private:
+  bool is_open_ = false;
+  // The mapped region, which is null if the file is empty.
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  // The unread part of the file is the range [next_, end_).
+  const char* next_ = nullptr;
+  const char* end_ = nullptr;
+  const std::set<std::string> fields_;
+  // Contains the last parsed JSON object.
+  Json::Value current_object_;
+};
+
+// Support for reading several inputs as one. The objects of each iterator are
+// returned in turn, in the order in which the iterators are given, so the
+// result only depends on that order. The iterators are owned by ChainedJson.
+// Example:
+//   std::vector<std::unique_ptr<JsonDocumentIterator>> inputs;
+//   inputs.emplace_back(new MappedJsonLines("a.jsonl", {}));
+//   inputs.emplace_back(new MappedJsonLines("b.jsonl", {}));
+//   ChainedJson json_docs(std::move(inputs));
+class ChainedJson: public JsonDocumentIterator{
+ public:
+  explicit ChainedJson(
+      std::vector<std::unique_ptr<JsonDocumentIterator>> inputs);
+  bool HasNext();
+  const Json::Value* Next();
+ private:
+  std::vector<std::unique_ptr<JsonDocumentIterator>> inputs_;
+  // The index of the iterator that returns the next object.
+  size_t current_ = 0;
+};
+
+// A JsonFieldReader extracts the top-level members with given names from JSON
+// objects without constructing Json::Value objects. Each object is scanned
+// once: string members with the given names are decoded into buffers that are
+// reused across objects, other members with the given names are kept as their
+// JSON text, and all other members are skipped. This is the fastest way to read
+// a few fields from every line of a JSON stream.
+// Example:
+//   JsonFieldReader reader({"timestamp", "url"});
+//   const char* begin = line.data();
+//   if (reader.Parse(begin, begin + line.size()) && reader.Has(1)) {
+//     const std::string& url = reader.Text(1);
+//     ...
+//   }
+class JsonFieldReader {
+ public:
+  // The field at position 'i' of 'fields' has the id 'i' in the functions
+  // below.
+  explicit JsonFieldReader(const std::vector<std::string>& fields);
+
+  // Parses the JSON object in the range [begin, end). Returns false if the
+  // input is not a JSON object. Skipped members are only checked for balanced
+  // brackets and quotes. If a name occurs more than once, the last member with
+  // that name is kept, as in Json::Reader.
+  bool Parse(const char* begin, const char* end);
+
+  int NumFields() const { return static_cast<int>(texts_.size()); }
+  // Returns true if the last parsed object has a member for the field 'id'.
+  bool Has(int id) const { return has_field_[id]; }
+  // Returns true if the member for the field 'id' is a string.
+  bool IsString(int id) const { return is_string_[id]; }
+  // Returns the decoded contents of the member for the field 'id' if it is a
+  // string, and its JSON text otherwise.
+  const std::string& Text(int id) const { return texts_[id]; }
+
+ private:
+  std::unordered_map<std::string, int> field_ids_;
+  std::vector<bool> has_field_;
+  std::vector<bool> is_string_;
+  std::vector<std::string> texts_;
+};
+
 }  // namespace morphie
 
 #endif
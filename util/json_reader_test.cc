@@ -0,0 +1,249 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/json_reader.h"
+
+#include <unistd.h>
+
+#include <memory>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "base/string.h"
+#include "gtest.h"
+#include "util/test_files.h"
+
+namespace morphie {
+namespace {
+
+using test::WriteTempFile;
+
+const char kJsonLines[] =
+    R"({"name": "a\"b\\cé😀", "count": 3, "skipped": [1, {"x": "]"}]}
+{"name": "", "count": -12, "ratio": 0.5, "flag": true, "none": null}
+{"count": 9000000000, "nested": {"list": [1, 2]}, "flag": false})";
+
+// NOLINTNEXTLINE
+const char kJsonDoc[] = R"( {"b": {"name": "x}", "count": [1, {"y": 2}]},
+  "a": {"count": 7, "skipped": "z"} , "c":{} , "d": 3, "e": "s,t"})";
+
+// Returns the values of the members of kJsonDoc in the order in which they
+// occur.
+std::vector<Json::Value> GetJsonDocMembers() {
+  std::istringstream stream(kJsonDoc);
+  FullJson full_json(&stream);
+  std::vector<Json::Value> values;
+  while (full_json.HasNext()) {
+    values.push_back(*full_json.Next());
+  }
+  // FullJson returns the members in the order a, b, c, d, e.
+  std::swap(values[0], values[1]);
+  return values;
+}
+
+TEST(IncrementalFullJsonTest, MatchesFullJsonInInputOrder) {
+  std::vector<Json::Value> expected = GetJsonDocMembers();
+  std::istringstream stream(kJsonDoc);
+  IncrementalFullJson json_doc(&stream, {});
+  for (const Json::Value& value : expected) {
+    ASSERT_TRUE(json_doc.HasNext());
+    EXPECT_EQ(value, *json_doc.Next());
+  }
+  EXPECT_FALSE(json_doc.HasNext());
+}
+
+TEST(IncrementalFullJsonTest, KeepsOnlySelectedFields) {
+  std::istringstream stream(kJsonDoc);
+  IncrementalFullJson json_doc(&stream, {"count"});
+  EXPECT_EQ(2, (*json_doc.Next())["count"].size());
+  const Json::Value* object = json_doc.Next();
+  EXPECT_EQ(1, object->size());
+  EXPECT_EQ(7, (*object)["count"].asInt());
+}
+
+TEST(IncrementalFullJsonTest, ReturnsMemberNames) {
+  std::istringstream stream(kJsonDoc);
+  IncrementalFullJson json_doc(&stream, {});
+  EXPECT_EQ("", json_doc.Name());
+  std::vector<string> names;
+  while (json_doc.HasNext()) {
+    json_doc.Next();
+    names.push_back(json_doc.Name());
+  }
+  EXPECT_EQ(std::vector<string>({"b", "a", "c", "d", "e"}), names);
+  std::istringstream escaped(R"({"a\"b\u00e9": 1})");
+  IncrementalFullJson escaped_doc(&escaped, {});
+  escaped_doc.Next();
+  EXPECT_EQ("a\"b\xc3\xa9", escaped_doc.Name());
+}
+
+TEST(IncrementalFullJsonTest, EmptyDocument) {
+  std::istringstream stream(" { } ");
+  IncrementalFullJson json_doc(&stream, {});
+  EXPECT_FALSE(json_doc.HasNext());
+}
+
+TEST(IncrementalFullJsonDeathTest, RequiresJSONDict) {
+  std::istringstream not_dict("[1, 2]");
+  EXPECT_DEATH({ IncrementalFullJson json_doc(&not_dict, {}); },
+               "JSON object is not a dict.");
+  std::istringstream truncated(R"({"a": {"b": 1}, "c": {"d")");
+  IncrementalFullJson json_doc(&truncated, {});
+  json_doc.Next();
+  EXPECT_DEATH({ json_doc.Next(); }, "File is not in JSON format.");
+}
+
+TEST(MappedJsonLinesTest, MissingFileIsNotOpen) {
+  MappedJsonLines json_lines("/nonexistent/json_reader_test", {});
+  EXPECT_FALSE(json_lines.IsOpen());
+}
+
+TEST(MappedJsonLinesTest, EmptyFileHasNoObjects) {
+  string filename = WriteTempFile("");
+  MappedJsonLines json_lines(filename, {});
+  ASSERT_TRUE(json_lines.IsOpen());
+  EXPECT_FALSE(json_lines.HasNext());
+  unlink(filename.c_str());
+}
+
+// With no field names, every line is parsed into the same value that
+// StreamJson produces.
+TEST(MappedJsonLinesTest, MatchesStreamJson) {
+  string filename = WriteTempFile(kJsonLines);
+  MappedJsonLines json_lines(filename, {});
+  std::istringstream stream(kJsonLines);
+  StreamJson stream_json(&stream);
+  ASSERT_TRUE(json_lines.IsOpen());
+  int num_objects = 0;
+  while (stream_json.HasNext()) {
+    ASSERT_TRUE(json_lines.HasNext());
+    const Json::Value* expected = stream_json.Next();
+    EXPECT_EQ(*expected, *json_lines.Next());
+    ++num_objects;
+  }
+  EXPECT_FALSE(json_lines.HasNext());
+  EXPECT_EQ(3, num_objects);
+  unlink(filename.c_str());
+}
+
+TEST(MappedJsonLinesTest, KeepsOnlySelectedFields) {
+  string filename = WriteTempFile(kJsonLines);
+  MappedJsonLines json_lines(filename, {"name", "count"});
+  ASSERT_TRUE(json_lines.IsOpen());
+  const Json::Value* object = json_lines.Next();
+  EXPECT_EQ(2, object->size());
+  EXPECT_EQ("a\"b\\c\xc3\xa9\xf0\x9f\x98\x80", (*object)["name"].asString());
+  EXPECT_EQ(3, (*object)["count"].asInt64());
+  object = json_lines.Next();
+  EXPECT_EQ(2, object->size());
+  EXPECT_EQ(-12, (*object)["count"].asInt64());
+  object = json_lines.Next();
+  EXPECT_EQ(1, object->size());
+  EXPECT_EQ(9000000000, (*object)["count"].asInt64());
+  EXPECT_FALSE(json_lines.HasNext());
+  unlink(filename.c_str());
+}
+
+// Like StreamJson, the reader stops at an empty line.
+TEST(MappedJsonLinesTest, StopsAtEmptyLine) {
+  string filename = WriteTempFile("{\"a\": 1}\n\n{\"a\": 2}\n");
+  MappedJsonLines json_lines(filename, {});
+  ASSERT_TRUE(json_lines.IsOpen());
+  ASSERT_TRUE(json_lines.HasNext());
+  EXPECT_EQ(1, (*json_lines.Next())["a"].asInt());
+  EXPECT_FALSE(json_lines.HasNext());
+  unlink(filename.c_str());
+}
+
+TEST(MappedJsonLinesDeathTest, RequiresJSONObjectLines) {
+  string filename = WriteTempFile("{\"a\": 1}\n{\"a\": }\n[1]\n");
+  MappedJsonLines json_lines(filename, {"b"});
+  ASSERT_TRUE(json_lines.IsOpen());
+  EXPECT_EQ(0, json_lines.Next()->size());
+  EXPECT_DEATH({ json_lines.Next(); }, "Line is not in JSON format");
+  unlink(filename.c_str());
+}
+
+// The objects of all inputs are returned in order, and empty inputs are
+// skipped.
+TEST(ChainedJsonTest, ReturnsObjectsOfEveryInput) {
+  std::istringstream first(kJsonLines);
+  std::istringstream empty("");
+  std::istringstream last("{\"last\": 1}\n");
+  std::vector<std::unique_ptr<JsonDocumentIterator>> inputs;
+  inputs.emplace_back(new StreamJson(&empty));
+  inputs.emplace_back(new StreamJson(&first));
+  inputs.emplace_back(new StreamJson(&empty));
+  inputs.emplace_back(new StreamJson(&last));
+  ChainedJson chained_json(std::move(inputs));
+  std::istringstream stream(kJsonLines);
+  StreamJson stream_json(&stream);
+  while (stream_json.HasNext()) {
+    ASSERT_TRUE(chained_json.HasNext());
+    EXPECT_EQ(*stream_json.Next(), *chained_json.Next());
+  }
+  ASSERT_TRUE(chained_json.HasNext());
+  EXPECT_EQ(1, (*chained_json.Next())["last"].asInt());
+  EXPECT_FALSE(chained_json.HasNext());
+  EXPECT_FALSE(ChainedJson({}).HasNext());
+}
+
+// Strings are decoded, other values are kept as text and other members are
+// skipped.
+TEST(JsonFieldReaderTest, ExtractsNamedFields) {
+  JsonFieldReader reader({"name", "count", "missing", "list"});
+  string line =
+      "{\"skip\": {\"a\": [1, \"}\"]}, \"name\": \"a\\\"b\", "
+      "\"count\": 12, \"list\": [1, 2], \"other\": null}";
+  ASSERT_TRUE(reader.Parse(line.data(), line.data() + line.size()));
+  EXPECT_EQ(4, reader.NumFields());
+  ASSERT_TRUE(reader.Has(0));
+  EXPECT_TRUE(reader.IsString(0));
+  EXPECT_EQ("a\"b", reader.Text(0));
+  ASSERT_TRUE(reader.Has(1));
+  EXPECT_FALSE(reader.IsString(1));
+  EXPECT_EQ("12", reader.Text(1));
+  EXPECT_FALSE(reader.Has(2));
+  EXPECT_EQ("[1, 2]", reader.Text(3));
+  // Fields of a previous object are not kept.
+  line = "{\"count\": \"3\"}";
+  ASSERT_TRUE(reader.Parse(line.data(), line.data() + line.size()));
+  EXPECT_FALSE(reader.Has(0));
+  ASSERT_TRUE(reader.Has(1));
+  EXPECT_TRUE(reader.IsString(1));
+  EXPECT_EQ("3", reader.Text(1));
+}
+
+TEST(JsonFieldReaderTest, KeepsLastDuplicateField) {
+  JsonFieldReader reader({"name"});
+  string line = "{\"name\": \"a\", \"name\": 2}";
+  ASSERT_TRUE(reader.Parse(line.data(), line.data() + line.size()));
+  EXPECT_FALSE(reader.IsString(0));
+  EXPECT_EQ("2", reader.Text(0));
+}
+
+TEST(JsonFieldReaderTest, RejectsMalformedObjects) {
+  JsonFieldReader reader({"name"});
+  for (const string& line : {string(""), string("[1]"), string("{\"name\"}"),
+                             string("{\"name\": \"a\""),
+                             string("{\"a\": [1}"), string("{} {}")}) {
+    EXPECT_FALSE(reader.Parse(line.data(), line.data() + line.size()))
+        << line;
+  }
+}
+
+}  // namespace
+}  // namespace morphie
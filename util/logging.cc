@@ -23,8 +23,7 @@ namespace util {
 
 void Check(bool condition, const string& location, const string& err) {
   if (!condition) {
-    std::cerr << location << ": " << err;
-    std::abort();
+    CheckFailed(location.c_str(), err);
   }
 }
 
@@ -34,5 +33,12 @@ void Check(bool condition, const string& location) {
 
 void Check(bool condition) { Check(condition, "", ""); }
 
+void CheckFailed(const char* location, const string& err) {
+  std::cerr << location << ": " << err;
+  std::abort();
+}
+
+CheckFailure::~CheckFailure() { CheckFailed(location_, stream_.str()); }
+
 }  // namespace util
 }  // namespace morphie
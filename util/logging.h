@@ -12,18 +12,48 @@
 // License for the specific language governing permissions and limitations under
 // the License.
 
-// This file defines a function for checking assertions and printing an error
-// if the assertion fails.
+// This file defines macros for checking assertions and printing an error if
+// the assertion fails. The message of a failed check is only constructed when
+// the check fails, so a message built with util::StrCat, or streamed into
+// CHECK_STREAM, costs nothing while the condition holds.
+//
+// The DCHECK macros behave like the CHECK macros in debug builds and check
+// nothing in builds that define NDEBUG. Their conditions are then not
+// evaluated, so they are for invariants of hot per-element code that other
+// checks or tests already establish, not for validating input.
+//
+// Example.
+//   CHECK(graph != nullptr, "The graph must not be null.");
+//   CHECK_STREAM(node < num_nodes) << "Node " << node << " does not exist.";
+//   DCHECK(is_initialized_, kInitializationErr);
 #ifndef LOGLE_UTIL_LOGGING_H_
 #define LOGLE_UTIL_LOGGING_H_
 
+#include <sstream>
+
 #include "base/string.h"
 
 #define MAKE_STR(x) #x
 #define TOSTRING(x) MAKE_STR(x)
 #define LOCATION_STR __FILE__ ":" TOSTRING(__LINE__)
-#define CHECK(c, err) util::Check(c, LOCATION_STR, err)
-#define FAIL(err) util::Check(false, LOCATION_STR, err)
+#define CHECK(c, err)        \
+  ((c) ? static_cast<void>(0) \
+       : ::morphie::util::CheckFailed(LOCATION_STR, err))
+#define CHECK_STREAM(c)                    \
+  (c) ? static_cast<void>(0)               \
+      : ::morphie::util::CheckVoidify() &  \
+            ::morphie::util::CheckFailure(LOCATION_STR).stream()
+#define FAIL(err) ::morphie::util::CheckFailed(LOCATION_STR, err)
+
+#ifdef NDEBUG
+#define DCHECK(c, err) \
+  while (false) CHECK(c, err)
+#define DCHECK_STREAM(c) \
+  while (false) CHECK_STREAM(c)
+#else
+#define DCHECK(c, err) CHECK(c, err)
+#define DCHECK_STREAM(c) CHECK_STREAM(c)
+#endif
 
 namespace morphie {
 namespace util {
@@ -33,6 +63,33 @@ void Check(bool condition, const string& location, const string& err);
 void Check(bool condition, const string& location);
 void Check(bool condition);
 
+// Produces an error message and aborts. Called by the macros above when a
+// check fails.
+[[noreturn]] void CheckFailed(const char* location, const string& err);
+
+// Collects the message streamed into a failed CHECK_STREAM and aborts with it
+// when it is destroyed.
+class CheckFailure {
+ public:
+  explicit CheckFailure(const char* location) : location_(location) {}
+  ~CheckFailure();
+  CheckFailure(const CheckFailure&) = delete;
+  CheckFailure& operator=(const CheckFailure&) = delete;
+
+  std::ostream& stream() { return stream_; }
+
+ private:
+  const char* const location_;
+  std::ostringstream stream_;
+};
+
+// Turns the stream of a CheckFailure into a void expression, so that both
+// branches of CHECK_STREAM have the same type. The operator & binds more
+// loosely than << and more tightly than ?:.
+struct CheckVoidify {
+  void operator&(std::ostream&) {}
+};
+
 }  // namespace util
 }  // namespace morphie
 
@@ -0,0 +1,54 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/logging.h"
+
+#include "gtest.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+namespace {
+
+// Returns a message and counts how often it was constructed.
+string CountedMessage(int* num_calls) {
+  ++*num_calls;
+  return "message";
+}
+
+// The message of a check is only constructed if the check fails.
+TEST(LoggingTest, ConstructsMessagesLazily) {
+  int num_calls = 0;
+  CHECK(num_calls == 0, CountedMessage(&num_calls));
+  CHECK_STREAM(num_calls == 0) << CountedMessage(&num_calls);
+  DCHECK(num_calls == 0, CountedMessage(&num_calls));
+  DCHECK_STREAM(num_calls == 0) << CountedMessage(&num_calls);
+  EXPECT_EQ(0, num_calls);
+}
+
+TEST(LoggingDeathTest, FailedChecksAbortWithTheirMessage) {
+  int node = 7;
+  EXPECT_DEATH({ CHECK(node < 5, util::StrCat("Node ", "7")); }, "Node 7");
+  EXPECT_DEATH({ CHECK_STREAM(node < 5) << "Node " << node; }, "Node 7");
+}
+
+#ifndef NDEBUG
+TEST(LoggingDeathTest, FailedDebugChecksAbort) {
+  int node = 7;
+  EXPECT_DEATH({ DCHECK(node < 5, "Node 7"); }, "Node 7");
+  EXPECT_DEATH({ DCHECK_STREAM(node < 5) << "Node " << node; }, "Node 7");
+}
+#endif
+
+}  // namespace
+}  // namespace morphie
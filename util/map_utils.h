@@ -16,8 +16,15 @@
 #ifndef LOGLE_UTIL_MAP_UTILS_H_
 #define LOGLE_UTIL_MAP_UTILS_H_
 
+#include <stddef.h>
+
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
+
+#include "util/span.h"
+#include "util/thread_pool.h"
 
 namespace morphie {
 namespace util {
@@ -65,6 +72,128 @@ std::unordered_map<ValType, std::unordered_set<KeyType>> Preimage(
   return preimage;
 }
 
+// A dense map is a vector 'fn' that maps each index 'a' to 'fn[a]', where the
+// value 'undefined' marks indexes that are not in the domain of the map.
+// Indexes beyond the end of the vector are not in the domain either. Dense maps
+// over the nodes of a graph take a fraction of the memory of an unordered_map
+// and are read sequentially.
+//
+// Returns the composition of the dense maps 'keys' and 'values', which maps 'a'
+// to values[keys[a]] if both are defined and to 'undefined' otherwise. The
+// result has the size of 'keys' and is computed on ranges of 'keys' by the
+// workers of '*pool' and the calling thread, or on the calling thread alone if
+// 'pool' is null.
+template <typename T>
+std::vector<T> ParallelCompose(const std::vector<T>& keys,
+                               const std::vector<T>& values, T undefined,
+                               ThreadPool* pool) {
+  std::vector<T> composition(keys.size(), undefined);
+  ParallelFor(keys.size(), pool, [&](size_t begin, size_t end) {
+    for (size_t a = begin; a < end; ++a) {
+      T b = keys[a];
+      if (b != undefined && static_cast<size_t>(b) < values.size()) {
+        composition[a] = values[b];
+      }
+    }
+  });
+  return composition;
+}
+
+// Returns the composition above, computed on the calling thread.
+template <typename T>
+std::vector<T> Compose(const std::vector<T>& keys,
+                       const std::vector<T>& values, T undefined) {
+  return ParallelCompose(keys, values, undefined, nullptr);
+}
+
+// The preimage of a dense map, stored as a compressed array. The indexes that
+// map to 'b' are keys[offsets[b]] to keys[offsets[b + 1] - 1], in increasing
+// order.
+template <typename T>
+struct DensePreimage {
+  // Returns the indexes that map to 'value'. The span is invalidated by any
+  // change to the preimage.
+  Span<T> Get(T value) const {
+    if (offsets.empty() || static_cast<size_t>(value) >= offsets.size() - 1) {
+      return Span<T>();
+    }
+    size_t begin = offsets[value];
+    return Span<T>(keys.data() + begin, offsets[value + 1] - begin);
+  }
+
+  std::vector<size_t> offsets;
+  std::vector<T> keys;
+};
+
+// Sets 'preimage' to the preimage of the dense map 'fn'. The preimage is
+// computed by a counting sort of the indexes by their value, which takes time
+// linear in the size of 'fn' and its largest value. The indexes of ranges of
+// 'fn' are counted and placed by the workers of '*pool' and the calling
+// thread, or by the calling thread alone if 'pool' is null. Each range has its
+// own count for every value, so the ranges place their indexes without
+// synchronization and the preimage does not depend on the number of threads.
+template <typename T>
+void ParallelPreimage(const std::vector<T>& fn, T undefined, ThreadPool* pool,
+                      DensePreimage<T>* preimage) {
+  size_t num_values = 0;
+  for (T value : fn) {
+    if (value != undefined) {
+      num_values = std::max(num_values, static_cast<size_t>(value) + 1);
+    }
+  }
+  // The counts of all ranges take at most the memory of 'fn' and one count
+  // for each value.
+  size_t num_ranges =
+      pool == nullptr ? 1 : static_cast<size_t>(pool->NumThreads()) + 1;
+  num_ranges = std::max<size_t>(
+      1, std::min(num_ranges, fn.size() / std::max<size_t>(num_values, 1)));
+  const size_t range_size = (fn.size() + num_ranges - 1) / num_ranges;
+  // counts[r * num_values + b] is the number of indexes in range r that map to
+  // b, and then the position of the next of these indexes in the preimage.
+  std::vector<size_t> counts(num_ranges * num_values, 0);
+  ParallelFor(num_ranges, pool, [&](size_t begin, size_t end) {
+    for (size_t range = begin; range < end; ++range) {
+      size_t* range_counts = counts.data() + range * num_values;
+      size_t last = std::min(fn.size(), (range + 1) * range_size);
+      for (size_t a = range * range_size; a < last; ++a) {
+        if (fn[a] != undefined) {
+          ++range_counts[fn[a]];
+        }
+      }
+    }
+  });
+  preimage->offsets.assign(num_values + 1, 0);
+  size_t position = 0;
+  for (size_t b = 0; b < num_values; ++b) {
+    preimage->offsets[b] = position;
+    for (size_t range = 0; range < num_ranges; ++range) {
+      size_t count = counts[range * num_values + b];
+      counts[range * num_values + b] = position;
+      position += count;
+    }
+  }
+  preimage->offsets[num_values] = position;
+  preimage->keys.resize(position);
+  ParallelFor(num_ranges, pool, [&](size_t begin, size_t end) {
+    for (size_t range = begin; range < end; ++range) {
+      size_t* next = counts.data() + range * num_values;
+      size_t last = std::min(fn.size(), (range + 1) * range_size);
+      for (size_t a = range * range_size; a < last; ++a) {
+        if (fn[a] != undefined) {
+          preimage->keys[next[fn[a]]++] = static_cast<T>(a);
+        }
+      }
+    }
+  });
+}
+
+// Sets 'preimage' as above on the calling thread.
+template <typename T>
+void Preimage(const std::vector<T>& fn, T undefined,
+              DensePreimage<T>* preimage) {
+  ParallelPreimage(fn, undefined, nullptr, preimage);
+}
+
 }  // namespace util
 }  // namespace morphie
 
@@ -1,5 +1,7 @@
 #include "util/map_utils.h"
 
+#include <vector>
+
 #include "gtest.h"
 
 namespace morphie {
@@ -62,6 +64,51 @@ TEST(MapPreimageTest, PreimageProperties) {
   EXPECT_EQ(pre_parity, Preimage(parity));
 }
 
+TEST(DenseMapTest, ComposesDenseMaps) {
+  const int kUndefined = -1;
+  std::vector<int> keys = {2, kUndefined, 0, 5};
+  std::vector<int> values = {1, 1, kUndefined};
+  EXPECT_EQ(std::vector<int>({kUndefined, kUndefined, 1, kUndefined}),
+            Compose(keys, values, kUndefined));
+  EXPECT_TRUE(Compose(std::vector<int>(), values, kUndefined).empty());
+}
+
+TEST(DenseMapTest, PreimageOfDenseMap) {
+  const int kUndefined = -1;
+  std::vector<int> parity = {0, 1, 0, kUndefined, 0, 1};
+  DensePreimage<int> preimage;
+  Preimage(parity, kUndefined, &preimage);
+  EXPECT_EQ(std::vector<int>({0, 2, 4}),
+            std::vector<int>(preimage.Get(0).begin(), preimage.Get(0).end()));
+  EXPECT_EQ(std::vector<int>({1, 5}),
+            std::vector<int>(preimage.Get(1).begin(), preimage.Get(1).end()));
+  EXPECT_TRUE(preimage.Get(2).empty());
+  Preimage(std::vector<int>(), kUndefined, &preimage);
+  EXPECT_TRUE(preimage.Get(0).empty());
+}
+
+// The parallel functions compute the same maps as the sequential ones.
+TEST(DenseMapTest, ParallelMapsMatchSequentialMaps) {
+  const int kUndefined = -1;
+  std::vector<int> keys(10000);
+  std::vector<int> values(100);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = i % 7 == 0 ? kUndefined : static_cast<int>(i * 31 % 120);
+  }
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<int>(i / 3);
+  }
+  ThreadPool pool(3);
+  std::vector<int> composition = Compose(keys, values, kUndefined);
+  EXPECT_EQ(composition, ParallelCompose(keys, values, kUndefined, &pool));
+  DensePreimage<int> preimage;
+  DensePreimage<int> parallel_preimage;
+  Preimage(composition, kUndefined, &preimage);
+  ParallelPreimage(composition, kUndefined, &pool, &parallel_preimage);
+  EXPECT_EQ(preimage.offsets, parallel_preimage.offsets);
+  EXPECT_EQ(preimage.keys, parallel_preimage.keys);
+}
+
 }  // namespace
 }  // namespace util
 }  // namespace morphie
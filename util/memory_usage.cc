@@ -0,0 +1,77 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/memory_usage.h"
+
+#include <sys/resource.h>
+
+#include <fstream>
+#include <string>
+
+namespace morphie {
+namespace util {
+
+// Writing 5 to clear_refs resets the VmHWM field of /proc/self/status.
+bool ResetPeakResidentSetSize() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  return !clear_refs.fail();
+}
+
+double PeakResidentSetSizeMiB() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stod(line.substr(6)) / 1024;
+    }
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_maxrss) / 1024;
+}
+
+// Without /proc, the current size is not available and the peak size is
+// returned instead.
+double ResidentSetSizeMiB() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      return std::stod(line.substr(6)) / 1024;
+    }
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_maxrss) / 1024;
+}
+
+void AddMemoryBreakdown(const string& prefix, const MemoryBreakdown& part,
+                        MemoryBreakdown* breakdown) {
+  for (const auto& component : part) {
+    (*breakdown)[prefix + "/" + component.first] += component.second;
+  }
+}
+
+size_t TotalBytes(const MemoryBreakdown& breakdown) {
+  size_t total = 0;
+  for (const auto& component : breakdown) {
+    total += component.second;
+  }
+  return total;
+}
+
+}  // namespace util
+}  // namespace morphie
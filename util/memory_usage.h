@@ -0,0 +1,89 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains functions for measuring the memory used by the process,
+// which are meant for benchmarks, and for estimating the memory used by the
+// components of a data structure. The process measurements read the /proc file
+// system of Linux and fall back on getrusage elsewhere. The estimates count
+// the bytes of the buffers and nodes that containers allocate, and not the
+// overhead of the allocator, so they are lower bounds that show which
+// components dominate.
+//
+// Example.
+//   util::MemoryBreakdown usage = graph.MemoryUsage();
+//   for (const auto& component : usage) {
+//     std::cout << component.first << " : " << component.second << "\n";
+//   }
+#ifndef LOGLE_UTIL_MEMORY_USAGE_H_
+#define LOGLE_UTIL_MEMORY_USAGE_H_
+
+#include <stddef.h>
+
+#include <map>
+#include <vector>
+
+#include "base/string.h"
+
+namespace morphie {
+namespace util {
+
+// Maps the names of the components of a data structure to the estimated number
+// of bytes that they use. The components of a part of the data structure are
+// named by the name of the part, a '/' and the name of the component, as in
+// "graph/labels".
+using MemoryBreakdown = std::map<string, size_t>;
+
+// Resets the peak resident set size of the process to its current size.
+// Returns false if the kernel does not support resetting the peak.
+bool ResetPeakResidentSetSize();
+
+// Returns the peak resident set size of the process in mebibytes, since the
+// last successful call to ResetPeakResidentSetSize or since the start of the
+// process.
+double PeakResidentSetSizeMiB();
+
+// Returns the current resident set size of the process in mebibytes.
+double ResidentSetSizeMiB();
+
+// Adds the components of 'part' to 'breakdown', with the name of each
+// component prefixed by 'prefix' and a '/'. A component that is already in
+// 'breakdown' is increased.
+void AddMemoryBreakdown(const string& prefix, const MemoryBreakdown& part,
+                        MemoryBreakdown* breakdown);
+// Returns the sum of the components of 'breakdown'.
+size_t TotalBytes(const MemoryBreakdown& breakdown);
+
+// Returns the bytes of the buffer of 'vec'.
+template <typename T, typename Allocator>
+size_t VectorBytes(const std::vector<T, Allocator>& vec) {
+  return vec.capacity() * sizeof(T);
+}
+inline size_t VectorBytes(const std::vector<bool>& vec) {
+  return vec.capacity() / 8;
+}
+
+// Returns the bytes of the buckets and nodes of 'map', which may be an
+// unordered map or set. A node holds an entry, the pointer to the next node
+// and the cached hash of the key. Memory owned by the entries is not counted.
+template <typename UnorderedMap>
+size_t UnorderedMapBytes(const UnorderedMap& map) {
+  return map.bucket_count() * sizeof(void*) +
+         map.size() * (sizeof(typename UnorderedMap::value_type) +
+                       sizeof(void*) + sizeof(size_t));
+}
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_MEMORY_USAGE_H_
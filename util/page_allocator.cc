@@ -0,0 +1,132 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Memory with huge pages is mapped in multiples of the huge page size and
+// aligned to it, since the kernel only backs aligned ranges of that size with
+// huge pages. NUMA placement is set with the mbind system call rather than
+// with libnuma, so that the tool does not depend on it.
+#include "util/page_allocator.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+#include "util/logging.h"
+
+namespace morphie {
+namespace util {
+
+namespace {
+
+const char kMapErr[] = "Memory could not be mapped.";
+
+// The size of a huge page on x86-64 and on most configurations of ARM64.
+const size_t kHugePageSize = size_t{1} << 21;
+
+// The memory policies of mbind, from linux/mempolicy.h.
+const int kInterleavePolicy = 3;
+const int kLocalPolicy = 4;
+
+size_t RoundUp(size_t size, size_t multiple) {
+  return (size + multiple - 1) / multiple * multiple;
+}
+
+// Returns the size of the mapping of an array of 'size' bytes.
+size_t MappingSize(size_t size, const AllocationPolicy& policy) {
+  const size_t page_size = policy.huge_pages == HugePages::kNone
+                               ? static_cast<size_t>(sysconf(_SC_PAGESIZE))
+                               : kHugePageSize;
+  return RoundUp(size, page_size);
+}
+
+// Maps 'size' bytes aligned to a huge page by mapping a larger range and
+// unmapping its ends. Returns null if the memory could not be mapped.
+void* MapAligned(size_t size) {
+  void* mapping = mmap(nullptr, size + kHugePageSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(mapping);
+  const uintptr_t aligned = RoundUp(begin, kHugePageSize);
+  if (aligned > begin) {
+    munmap(mapping, aligned - begin);
+  }
+  const size_t tail = kHugePageSize - (aligned - begin);
+  if (tail > 0) {
+    munmap(reinterpret_cast<void*>(aligned + size), tail);
+  }
+  return reinterpret_cast<void*>(aligned);
+}
+
+// Sets the memory policy of the pages of 'mapping'. Failures are ignored, and
+// leave the pages to the policy of the process.
+void SetPlacement(void* mapping, size_t size, NumaPlacement placement) {
+#ifdef SYS_mbind
+  if (placement == NumaPlacement::kInterleave) {
+    // The kernel interleaves over the nodes of the mask that have memory and
+    // that the process may use, so every node is set.
+    const unsigned long all_nodes = ~0UL;  // NOLINT
+    syscall(SYS_mbind, mapping, size, kInterleavePolicy, &all_nodes,
+            8 * sizeof(all_nodes), 0);
+  } else if (placement == NumaPlacement::kLocal) {
+    syscall(SYS_mbind, mapping, size, kLocalPolicy, nullptr, 0, 0);
+  }
+#endif
+}
+
+}  // namespace
+
+void* AllocatePages(size_t size, const AllocationPolicy& policy) {
+  const size_t mapping_size = MappingSize(size, policy);
+  void* mapping = nullptr;
+#ifdef MAP_HUGETLB
+  if (policy.huge_pages == HugePages::kExplicit) {
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mapping == MAP_FAILED) {
+      mapping = nullptr;
+    }
+  }
+#endif
+  const bool is_explicit = mapping != nullptr;
+  if (mapping == nullptr && policy.huge_pages != HugePages::kNone) {
+    mapping = MapAligned(mapping_size);
+  } else if (mapping == nullptr) {
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+      mapping = nullptr;
+    }
+  }
+  CHECK(mapping != nullptr, kMapErr);
+#ifdef MADV_HUGEPAGE
+  if (policy.huge_pages != HugePages::kNone && !is_explicit) {
+    madvise(mapping, mapping_size, MADV_HUGEPAGE);
+  }
+#endif
+  SetPlacement(mapping, mapping_size, policy.placement);
+  return mapping;
+}
+
+void FreePages(void* pages, size_t size, const AllocationPolicy& policy) {
+  if (pages != nullptr) {
+    munmap(pages, MappingSize(size, policy));
+  }
+}
+
+}  // namespace util
+}  // namespace morphie
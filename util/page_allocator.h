@@ -0,0 +1,169 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains an allocator for the large arrays of a graph, such as the
+// arrays of a FrozenLabeledGraph and the node columns of a LabeledGraph. These
+// arrays are accessed at random by traversals and partition refinement, and on
+// large hosts two costs dominate such accesses: misses in the TLB, which maps
+// only a few megabytes of 4 KiB pages, and reads from the memory of another
+// NUMA node. An AllocationPolicy chooses the pages that back an array and the
+// nodes they are placed on, and a PageAllocator maps the memory of large
+// arrays directly with mmap according to the policy. Small arrays and arrays
+// with the default policy are allocated with operator new.
+//
+// Example.
+//   util::AllocationPolicy policy;
+//   policy.huge_pages = util::HugePages::kTransparent;
+//   policy.placement = util::NumaPlacement::kInterleave;
+//   util::PageVector<uint32_t> targets{util::PageAllocator<uint32_t>(policy)};
+//
+// The policy is a hint. Huge pages and placements that the kernel does not
+// support or cannot provide are ignored, and the array is backed by pages of
+// the default size placed by the policy of the process.
+#ifndef LOGLE_UTIL_PAGE_ALLOCATOR_H_
+#define LOGLE_UTIL_PAGE_ALLOCATOR_H_
+
+#include <stddef.h>
+
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace morphie {
+namespace util {
+
+enum class HugePages {
+  // Pages of the default size.
+  kNone,
+  // Transparent huge pages, which the kernel backs with huge pages when it
+  // can, and otherwise with pages of the default size.
+  kTransparent,
+  // Huge pages from the pool reserved in /proc/sys/vm/nr_hugepages, which are
+  // never swapped or split. Transparent huge pages are used instead if the
+  // pool has too few free pages.
+  kExplicit,
+};
+
+enum class NumaPlacement {
+  // The memory policy of the process, which is to place a page on the node of
+  // the thread that first writes it unless the process runs under numactl.
+  kDefault,
+  // Pages are interleaved over the nodes, so that random accesses from threads
+  // on every node are spread evenly over the memory of all nodes.
+  kInterleave,
+  // A page is placed on the node of the thread that first writes it, even if
+  // the process runs with another memory policy, such as an interleave policy
+  // set by numactl. An array that is built by one thread is then placed on
+  // the node of that thread, which suits arrays that are mostly read by
+  // threads on the same node.
+  kLocal,
+};
+
+struct AllocationPolicy {
+  AllocationPolicy()
+      : huge_pages(HugePages::kNone),
+        placement(NumaPlacement::kDefault),
+        min_bytes(size_t{1} << 21) {}
+
+  // Returns true if arrays are allocated with operator new.
+  bool IsDefault() const {
+    return huge_pages == HugePages::kNone &&
+           placement == NumaPlacement::kDefault;
+  }
+
+  HugePages huge_pages;
+  NumaPlacement placement;
+  // Arrays smaller than 'min_bytes' are allocated with operator new, since a
+  // mapping of its own takes at least a page and a system call.
+  size_t min_bytes;
+};
+
+inline bool operator==(const AllocationPolicy& lhs,
+                       const AllocationPolicy& rhs) {
+  return lhs.huge_pages == rhs.huge_pages && lhs.placement == rhs.placement &&
+         lhs.min_bytes == rhs.min_bytes;
+}
+
+inline bool operator!=(const AllocationPolicy& lhs,
+                       const AllocationPolicy& rhs) {
+  return !(lhs == rhs);
+}
+
+// Maps 'size' bytes of zeroed, page-aligned memory according to 'policy'. The
+// memory must be released by calling FreePages with the same size and policy.
+// - Crashes if the memory cannot be mapped.
+void* AllocatePages(size_t size, const AllocationPolicy& policy);
+void FreePages(void* pages, size_t size, const AllocationPolicy& policy);
+
+// A PageAllocator allocates arrays of at least policy.min_bytes bytes with
+// AllocatePages, and smaller arrays with operator new. Containers with
+// allocators of different policies can be swapped and assigned, and the
+// policy of the source is then propagated with its memory.
+template <typename T>
+class PageAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  PageAllocator() {}
+  explicit PageAllocator(const AllocationPolicy& policy) : policy_(policy) {}
+  template <typename U>
+  PageAllocator(const PageAllocator<U>& other) : policy_(other.Policy()) {}
+
+  T* allocate(size_t n) {
+    const size_t size = n * sizeof(T);
+    if (UsesPages(size)) {
+      return static_cast<T*>(AllocatePages(size, policy_));
+    }
+    return static_cast<T*>(::operator new(size));
+  }
+
+  void deallocate(T* data, size_t n) {
+    const size_t size = n * sizeof(T);
+    if (UsesPages(size)) {
+      FreePages(data, size, policy_);
+    } else {
+      ::operator delete(data);
+    }
+  }
+
+  const AllocationPolicy& Policy() const { return policy_; }
+
+ private:
+  bool UsesPages(size_t size) const {
+    return !policy_.IsDefault() && size >= policy_.min_bytes;
+  }
+
+  AllocationPolicy policy_;
+};
+
+template <typename T, typename U>
+bool operator==(const PageAllocator<T>& lhs, const PageAllocator<U>& rhs) {
+  return lhs.Policy() == rhs.Policy();
+}
+
+template <typename T, typename U>
+bool operator!=(const PageAllocator<T>& lhs, const PageAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+template <typename T>
+using PageVector = std::vector<T, PageAllocator<T>>;
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_PAGE_ALLOCATOR_H_
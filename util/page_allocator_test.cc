@@ -0,0 +1,85 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/page_allocator.h"
+
+#include <stdint.h>
+
+#include <numeric>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+// Returns a policy that maps every array.
+AllocationPolicy MappedPolicy(HugePages huge_pages, NumaPlacement placement) {
+  AllocationPolicy policy;
+  policy.huge_pages = huge_pages;
+  policy.placement = placement;
+  policy.min_bytes = 0;
+  return policy;
+}
+
+// Every combination of pages and placement yields usable, zeroed memory, also
+// when explicit huge pages are not reserved on the host.
+TEST(PageAllocatorTest, AllocatesByPolicy) {
+  for (HugePages huge_pages :
+       {HugePages::kNone, HugePages::kTransparent, HugePages::kExplicit}) {
+    for (NumaPlacement placement :
+         {NumaPlacement::kDefault, NumaPlacement::kInterleave,
+          NumaPlacement::kLocal}) {
+      const AllocationPolicy policy = MappedPolicy(huge_pages, placement);
+      const size_t size = 3 << 20;
+      char* pages = static_cast<char*>(AllocatePages(size, policy));
+      ASSERT_TRUE(pages != nullptr);
+      EXPECT_EQ(0, pages[0]);
+      EXPECT_EQ(0, pages[size - 1]);
+      if (huge_pages != HugePages::kNone) {
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(pages) % (1 << 21));
+      }
+      pages[size - 1] = 1;
+      FreePages(pages, size, policy);
+
+      PageVector<int64_t> values{PageAllocator<int64_t>(policy)};
+      values.resize(100000);
+      std::iota(values.begin(), values.end(), 0);
+      EXPECT_EQ(99999, values.back());
+    }
+  }
+}
+
+// Containers swap and assign their allocators with their memory, so arrays
+// are released by the policy that allocated them.
+TEST(PageAllocatorTest, PropagatesPolicies) {
+  const AllocationPolicy mapped =
+      MappedPolicy(HugePages::kTransparent, NumaPlacement::kDefault);
+  PageVector<int> small;
+  PageVector<int> large{PageAllocator<int>(mapped)};
+  EXPECT_TRUE(small.get_allocator().Policy().IsDefault());
+  large.assign(1000, 7);
+  small.swap(large);
+  EXPECT_EQ(mapped, small.get_allocator().Policy());
+  EXPECT_TRUE(large.get_allocator().Policy().IsDefault());
+  large = small;
+  EXPECT_EQ(mapped, large.get_allocator().Policy());
+  EXPECT_EQ(small, large);
+  PageAllocator<char> rebound(large.get_allocator());
+  EXPECT_TRUE(rebound == large.get_allocator());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
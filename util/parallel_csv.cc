@@ -0,0 +1,217 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/parallel_csv.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "util/logging.h"
+#include "util/string_utils.h"
+
+namespace morphie {
+namespace util {
+
+namespace {
+
+// The default nominal size of the byte range parsed as one chunk.
+const size_t kChunkSize = 8 << 20;
+// The number of chunks per thread that may be parsed ahead of the client.
+const int64_t kChunksInFlightPerThread = 2;
+
+const char kAlreadyInitializedErr[] = "The parser is already initialized.";
+const char kChunkSizeErr[] = "The chunk size must be positive.";
+const char kNotInitializedErr[] = "The parser is not initialized.";
+const char kNotStartedErr[] = "The parser has not been started.";
+const char kOpenFileErr[] = "Error opening file: ";
+const char kStartedErr[] = "The parser has already been started.";
+const char kThreadsErr[] = "The number of threads must be positive.";
+
+}  // namespace
+
+ParallelCSVParser::ParallelCSVParser(char delim, int num_threads)
+    : ParallelCSVParser(delim, num_threads, kChunkSize) {}
+
+ParallelCSVParser::ParallelCSVParser(char delim, int num_threads,
+                                     size_t chunk_size)
+    : delim_(delim),
+      num_threads_(num_threads),
+      chunk_size_(chunk_size),
+      is_initialized_(false),
+      has_header_(false),
+      mapping_(nullptr),
+      data_(nullptr),
+      size_(0),
+      body_begin_(0),
+      num_columns_(0),
+      num_chunks_(0),
+      is_cancelled_(false),
+      num_chunks_started_(0),
+      num_chunks_returned_(0) {
+  CHECK(chunk_size_ > 0, kChunkSizeErr);
+}
+
+ParallelCSVParser::~ParallelCSVParser() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_cancelled_ = true;
+  }
+  state_changed_.notify_all();
+  // The pool waits for the workers to return before the file is unmapped.
+  pool_.reset();
+  if (mapping_ != nullptr) {
+    munmap(mapping_, size_);
+  }
+}
+
+util::Status ParallelCSVParser::Initialize(const string& filename) {
+  if (num_threads_ < 1) {
+    return util::Status(Code::INVALID_ARGUMENT, kThreadsErr);
+  }
+  if (is_initialized_) {
+    return util::Status(Code::INVALID_ARGUMENT, kAlreadyInitializedErr);
+  }
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return util::Status(Code::EXTERNAL, util::StrCat(kOpenFileErr, filename));
+  }
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ > 0) {
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      size_ = 0;
+      return util::Status(Code::EXTERNAL,
+                          util::StrCat(kOpenFileErr, filename));
+    }
+    madvise(mapping, size_, MADV_SEQUENTIAL);
+    mapping_ = mapping;
+    data_ = static_cast<const char*>(mapping_);
+  }
+  close(fd);
+  is_initialized_ = true;
+  if (size_ == 0) {
+    return util::Status::OK;
+  }
+  has_header_ = true;
+  const void* newline = std::memchr(data_, '\n', size_);
+  size_t header_end =
+      (newline == nullptr) ? size_ : static_cast<const char*>(newline) - data_;
+  body_begin_ = (newline == nullptr) ? size_ : header_end + 1;
+  BlockCSVParser header_parser(data_, header_end, delim_);
+  if (header_parser.Next() && header_parser.ok()) {
+    for (CSVField field : header_parser.fields()) {
+      header_.push_back(ToString(field));
+    }
+  }
+  return util::Status::OK;
+}
+
+void ParallelCSVParser::Start(size_t num_columns) {
+  CHECK(is_initialized_, kNotInitializedErr);
+  CHECK(pool_ == nullptr, kStartedErr);
+  num_columns_ = num_columns;
+  size_t body_size = size_ - body_begin_;
+  num_chunks_ =
+      static_cast<int64_t>((body_size + chunk_size_ - 1) / chunk_size_);
+  pool_.reset(new ThreadPool(num_threads_));
+  for (int i = 0; i < num_threads_; ++i) {
+    pool_->Schedule([this] { Parse(); });
+  }
+}
+
+// A chunk begins after the first newline that occurs at or after the
+// character preceding its nominal beginning. The first chunk begins with the
+// line after the header, and a chunk that contains no line boundary is empty.
+size_t ParallelCSVParser::ChunkBegin(int64_t chunk_id) const {
+  size_t offset = body_begin_ + static_cast<size_t>(chunk_id) * chunk_size_;
+  if (chunk_id == 0 || offset >= size_) {
+    return std::min(offset, size_);
+  }
+  const void* newline =
+      std::memchr(data_ + offset - 1, '\n', size_ - (offset - 1));
+  if (newline == nullptr) {
+    return size_;
+  }
+  return static_cast<const char*>(newline) - data_ + 1;
+}
+
+void ParallelCSVParser::Parse() {
+  const int64_t max_chunks_in_flight = kChunksInFlightPerThread * num_threads_;
+  while (true) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    state_changed_.wait(lock, [this, max_chunks_in_flight] {
+      return is_cancelled_ || num_chunks_started_ == num_chunks_ ||
+             num_chunks_started_ - num_chunks_returned_ < max_chunks_in_flight;
+    });
+    if (is_cancelled_ || num_chunks_started_ == num_chunks_) {
+      return;
+    }
+    int64_t chunk_id = num_chunks_started_++;
+    lock.unlock();
+    size_t begin = ChunkBegin(chunk_id);
+    size_t end = ChunkBegin(chunk_id + 1);
+    std::unique_ptr<RecordBatch> batch(new RecordBatch(num_columns_));
+    if (begin < end) {
+      BlockCSVParser parser(data_ + begin, end - begin, delim_);
+      parser.NextBatch(std::numeric_limits<size_t>::max(), batch.get());
+    }
+    lock.lock();
+    parsed_[chunk_id] = std::move(batch);
+    lock.unlock();
+    state_changed_.notify_all();
+  }
+}
+
+// Empty chunks, which contain no line boundary, are skipped.
+bool ParallelCSVParser::NextBatch(RecordBatch* batch) {
+  CHECK(pool_ != nullptr, kNotStartedErr);
+  while (true) {
+    std::unique_ptr<RecordBatch> parsed;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      state_changed_.wait(lock, [this] {
+        return num_chunks_returned_ == num_chunks_ ||
+               parsed_.count(num_chunks_returned_) > 0;
+      });
+      if (num_chunks_returned_ == num_chunks_) {
+        return false;
+      }
+      auto parsed_it = parsed_.find(num_chunks_returned_);
+      parsed = std::move(parsed_it->second);
+      parsed_.erase(parsed_it);
+      ++num_chunks_returned_;
+    }
+    state_changed_.notify_all();
+    if (parsed->NumRows() + parsed->NumSkipped() > 0) {
+      *batch = std::move(*parsed);
+      return true;
+    }
+  }
+}
+
+}  // namespace util
+}  // namespace morphie
@@ -0,0 +1,133 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file defines a parser that tokenizes a CSV file on several threads. The
+// file is memory-mapped and divided into byte ranges of a fixed size. The
+// split point between two ranges is moved forward to the next line boundary,
+// which every thread can compute without coordination because a newline
+// always ends a line, even inside quotes, as it does for the other CSV parsers
+// in util/csv.h. Each range is parsed into a RecordBatch and the batches are
+// returned in file order, so clients see the same lines in the same order as
+// with a BlockCSVParser.
+//
+// Example.
+//   util::ParallelCSVParser parser(',', 4);
+//   util::Status status = parser.Initialize(filename);
+//   if (!status.ok()) { ... }
+//   parser.Start(parser.header().size());
+//   util::RecordBatch batch(parser.header().size());
+//   while (parser.NextBatch(&batch)) {
+//     // Process the rows of the batch.
+//   }
+#ifndef LOGLE_UTIL_PARALLEL_CSV_H_
+#define LOGLE_UTIL_PARALLEL_CSV_H_
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "base/string.h"
+#include "util/csv.h"
+#include "util/status.h"
+#include "util/thread_pool.h"
+
+namespace morphie {
+namespace util {
+
+// The ParallelCSVParser splits the lines after the first line of a file, which
+// is treated as a header, into chunks that are parsed by worker threads. At
+// most a few chunks per thread are parsed ahead of the client, which bounds
+// memory use independently of the size of the file.
+class ParallelCSVParser {
+ public:
+  // Creates a parser that uses 'delim' as the field delimiter and
+  // 'num_threads' worker threads.
+  ParallelCSVParser(char delim, int num_threads);
+  // Creates a parser that divides the file into byte ranges of about
+  // 'chunk_size' bytes. Requires that 'chunk_size' is positive.
+  ParallelCSVParser(char delim, int num_threads, size_t chunk_size);
+  // Stops the worker threads, waits for them to return and unmaps the file.
+  ~ParallelCSVParser();
+  // Disallow copying and assignment.
+  ParallelCSVParser(const ParallelCSVParser&) = delete;
+  ParallelCSVParser& operator=(const ParallelCSVParser&) = delete;
+
+  // Maps 'filename' into memory and parses its first line. Returns
+  //  - INVALID_ARGUMENT if the number of threads is not positive or if the
+  //    parser has already been initialized.
+  //  - EXTERNAL if the file cannot be opened or mapped.
+  //  - OK otherwise.
+  util::Status Initialize(const string& filename);
+  // Returns false if the file is empty.
+  bool HasHeader() const { return has_header_; }
+  // Returns the fields of the first line of the file, and an empty vector if
+  // the first line could not be tokenized.
+  const std::vector<string>& header() const { return header_; }
+  // Returns true if the file contains characters after the first line.
+  bool HasMoreLines() const { return body_begin_ < size_; }
+  // Returns the number of worker threads.
+  int NumThreads() const { return num_threads_; }
+
+  // Starts the worker threads, which parse the file into batches with
+  // 'num_columns' columns. Lines with a different number of fields are
+  // counted as skipped, as in BlockCSVParser::NextBatch.
+  // - Requires that Initialize() returned OK and that Start() has not been
+  //   called.
+  void Start(size_t num_columns);
+  // Moves the next batch in file order into '*batch', replacing its contents
+  // and number of columns. Returns false if all batches have been returned.
+  // Batches are never empty, meaning that NumRows() + NumSkipped() is always
+  // positive. Several threads may call NextBatch() concurrently, in which case
+  // each batch is returned to exactly one of them.
+  // - Requires that Start() has been called.
+  bool NextBatch(RecordBatch* batch);
+
+ private:
+  // Returns the offset of the first line of chunk 'chunk_id'.
+  size_t ChunkBegin(int64_t chunk_id) const;
+  // Parses chunks until all chunks are parsed or the parser is destroyed.
+  void Parse();
+
+  const char delim_;
+  const int num_threads_;
+  const size_t chunk_size_;
+  bool is_initialized_;
+  bool has_header_;
+  std::vector<string> header_;
+  // The mapped file, which is null if the file is empty.
+  void* mapping_;
+  const char* data_;
+  size_t size_;
+  // The offset of the line after the header.
+  size_t body_begin_;
+  size_t num_columns_;
+  int64_t num_chunks_;
+  std::mutex mutex_;
+  std::condition_variable state_changed_;
+  // The fields below are guarded by 'mutex_'.
+  bool is_cancelled_;
+  int64_t num_chunks_started_;
+  int64_t num_chunks_returned_;
+  std::map<int64_t, std::unique_ptr<RecordBatch>> parsed_;
+  // Runs one Parse task per worker, and is null until Start() is called.
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_PARALLEL_CSV_H_
@@ -0,0 +1,179 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/parallel_csv.h"
+
+#include <unistd.h>
+
+#include <sstream>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/string.h"
+#include "gtest.h"
+#include "util/test_files.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+using test::WriteTempFile;
+
+// The fields of a sequence of lines.
+using Lines = std::vector<std::vector<string>>;
+
+// Returns the lines after the first line of 'content' with 'num_columns'
+// fields, as parsed by a BlockCSVParser.
+Lines BlockParse(const string& content, size_t num_columns) {
+  BlockCSVParser parser(new std::stringstream(content));
+  parser.Next();
+  RecordBatch batch(num_columns);
+  parser.NextBatch(content.size(), &batch);
+  Lines lines;
+  for (size_t row = 0; row < batch.NumRows(); ++row) {
+    lines.emplace_back();
+    for (size_t column = 0; column < num_columns; ++column) {
+      lines.back().push_back(ToString(batch.Get(row, column)));
+    }
+  }
+  return lines;
+}
+
+// Returns the lines of the file 'filename' as parsed by a ParallelCSVParser,
+// and sets 'num_skipped' to the number of lines that were skipped.
+Lines ParallelParse(const string& filename, int num_threads, size_t chunk_size,
+                    size_t* num_skipped) {
+  ParallelCSVParser parser(',', num_threads, chunk_size);
+  EXPECT_TRUE(parser.Initialize(filename).ok());
+  size_t num_columns = parser.header().size();
+  parser.Start(num_columns);
+  RecordBatch batch(num_columns);
+  Lines lines;
+  *num_skipped = 0;
+  while (parser.NextBatch(&batch)) {
+    EXPECT_LT(0, batch.NumRows() + batch.NumSkipped());
+    *num_skipped += batch.NumSkipped();
+    for (size_t row = 0; row < batch.NumRows(); ++row) {
+      lines.emplace_back();
+      for (size_t column = 0; column < num_columns; ++column) {
+        lines.back().push_back(ToString(batch.Get(row, column)));
+      }
+    }
+  }
+  return lines;
+}
+
+TEST(ParallelCSVParserTest, InitializationErrors) {
+  ParallelCSVParser no_threads(',', 0);
+  EXPECT_EQ(Code::INVALID_ARGUMENT,
+            no_threads.Initialize("/nonexistent/parallel_csv_test").code());
+  ParallelCSVParser parser(',', 2);
+  EXPECT_EQ(Code::EXTERNAL,
+            parser.Initialize("/nonexistent/parallel_csv_test").code());
+}
+
+TEST(ParallelCSVParserTest, EmptyAndHeaderOnlyFiles) {
+  string empty_file = WriteTempFile("");
+  ParallelCSVParser empty_parser(',', 2);
+  ASSERT_TRUE(empty_parser.Initialize(empty_file).ok());
+  EXPECT_FALSE(empty_parser.HasHeader());
+  unlink(empty_file.c_str());
+
+  string header_file = WriteTempFile("a,\"b,c\"\n");
+  ParallelCSVParser parser(',', 2);
+  ASSERT_TRUE(parser.Initialize(header_file).ok());
+  EXPECT_TRUE(parser.HasHeader());
+  EXPECT_EQ(std::vector<string>({"a", "b,c"}), parser.header());
+  EXPECT_FALSE(parser.HasMoreLines());
+  parser.Start(2);
+  RecordBatch batch(2);
+  EXPECT_FALSE(parser.NextBatch(&batch));
+  unlink(header_file.c_str());
+}
+
+// For every chunk size, including sizes that place split points inside quoted
+// fields and in the middle of lines, and for several thread counts, the
+// parallel parser returns the same lines in the same order as a BlockCSVParser.
+TEST(ParallelCSVParserTest, MatchesBlockCSVParser) {
+  string content = "name,value,note\n";
+  for (int i = 0; i < 200; ++i) {
+    content += "n" + std::to_string(i) + "," + std::to_string(i * i);
+    content += (i % 3 == 0) ? ",\"quoted, note\"\n" : ",plain\n";
+    if (i % 17 == 0) {
+      content += "too,few\n";
+    }
+  }
+  content += "last,line,without newline";
+  string filename = WriteTempFile(content);
+  Lines expected = BlockParse(content, 3);
+  ASSERT_EQ(201, expected.size());
+  for (size_t chunk_size : {1, 7, 64, 1000, 1 << 20}) {
+    for (int num_threads : {1, 3}) {
+      size_t num_skipped;
+      EXPECT_EQ(expected,
+                ParallelParse(filename, num_threads, chunk_size, &num_skipped))
+          << "chunk size " << chunk_size << ", " << num_threads << " threads";
+      EXPECT_EQ(12, num_skipped);
+    }
+  }
+  unlink(filename.c_str());
+}
+
+// Concurrent clients together receive every line exactly once.
+TEST(ParallelCSVParserTest, SupportsConcurrentClients) {
+  string content = "a\n";
+  for (int i = 0; i < 1000; ++i) {
+    content += std::to_string(i) + "\n";
+  }
+  string filename = WriteTempFile(content);
+  ParallelCSVParser parser(',', 2, 16);
+  ASSERT_TRUE(parser.Initialize(filename).ok());
+  parser.Start(1);
+  std::vector<size_t> num_rows(3, 0);
+  std::vector<std::thread> clients;
+  for (size_t i = 0; i < num_rows.size(); ++i) {
+    clients.emplace_back([&parser, &num_rows, i] {
+      RecordBatch batch(1);
+      while (parser.NextBatch(&batch)) {
+        num_rows[i] += batch.NumRows();
+      }
+    });
+  }
+  for (std::thread& client : clients) {
+    client.join();
+  }
+  EXPECT_EQ(1000, num_rows[0] + num_rows[1] + num_rows[2]);
+  unlink(filename.c_str());
+}
+
+// Destroying a parser whose batches have not all been read stops its threads.
+TEST(ParallelCSVParserTest, StopsWhenDestroyedEarly) {
+  string content = "a\n";
+  for (int i = 0; i < 1000; ++i) {
+    content += std::to_string(i) + "\n";
+  }
+  string filename = WriteTempFile(content);
+  {
+    ParallelCSVParser parser(',', 2, 16);
+    ASSERT_TRUE(parser.Initialize(filename).ok());
+    parser.Start(1);
+    RecordBatch batch(1);
+    EXPECT_TRUE(parser.NextBatch(&batch));
+  }
+  unlink(filename.c_str());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
@@ -0,0 +1,109 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+#include "util/progress.h"
+
+#include <iomanip>
+#include <sstream>
+
+#include "util/logging.h"
+#include "util/memory_usage.h"
+
+namespace morphie {
+namespace util {
+
+namespace {
+
+const char kIntervalErr[] = "The progress interval must be positive.";
+
+}  // namespace
+
+string FormatProgress(double elapsed_seconds, double interval_seconds,
+                      int64_t lines_read, int64_t lines_skipped,
+                      int64_t bytes_read, int64_t previous_lines,
+                      int64_t previous_bytes, int64_t nodes, int64_t edges,
+                      double rss_mib) {
+  double lines_per_second = 0;
+  double bytes_per_second = 0;
+  if (interval_seconds > 0) {
+    lines_per_second = (lines_read - previous_lines) / interval_seconds;
+    bytes_per_second = (bytes_read - previous_bytes) / interval_seconds;
+  }
+  double skip_rate = lines_read > 0
+                         ? static_cast<double>(lines_skipped) / lines_read
+                         : 0;
+  std::ostringstream line;
+  line << std::fixed << std::setprecision(1) << "progress: elapsed="
+       << elapsed_seconds << "s events=" << lines_read << std::setprecision(0)
+       << " events/s=" << lines_per_second << " bytes/s=" << bytes_per_second
+       << std::setprecision(4) << " skip_rate=" << skip_rate
+       << " nodes=" << nodes << " edges=" << edges << std::setprecision(1)
+       << " rss_mib=" << rss_mib;
+  return line.str();
+}
+
+ProgressReporter::ProgressReporter(const ProgressCounters* counters,
+                                   double interval_seconds, std::ostream* out)
+    : counters_(counters),
+      interval_(interval_seconds),
+      out_(out),
+      start_(std::chrono::steady_clock::now()),
+      previous_time_(start_),
+      previous_lines_(0),
+      previous_bytes_(0),
+      stopped_(false) {
+  CHECK(interval_seconds > 0, kIntervalErr);
+  thread_ = std::thread(&ProgressReporter::Run, this);
+}
+
+ProgressReporter::~ProgressReporter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  stop_condition_.notify_one();
+  thread_.join();
+  Report();
+}
+
+void ProgressReporter::Report() {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed = now - start_;
+  std::chrono::duration<double> interval = now - previous_time_;
+  int64_t lines_read = counters_->lines_read.load(std::memory_order_relaxed);
+  int64_t bytes_read = counters_->bytes_read.load(std::memory_order_relaxed);
+  *out_ << FormatProgress(
+               elapsed.count(), interval.count(), lines_read,
+               counters_->lines_skipped.load(std::memory_order_relaxed),
+               bytes_read, previous_lines_, previous_bytes_,
+               counters_->nodes.load(std::memory_order_relaxed),
+               counters_->edges.load(std::memory_order_relaxed),
+               ResidentSetSizeMiB())
+        << std::endl;
+  previous_time_ = now;
+  previous_lines_ = lines_read;
+  previous_bytes_ = bytes_read;
+}
+
+void ProgressReporter::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_condition_.wait_for(lock, interval_,
+                                   [this] { return stopped_; })) {
+    Report();
+  }
+}
+
+}  // namespace util
+}  // namespace morphie
@@ -0,0 +1,126 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+// This file contains utilities for reporting the progress of a long-running
+// ingest while it runs. The thread that ingests the input updates a
+// ProgressCounters object with relaxed atomic operations, which take no lock,
+// and a ProgressReporter reads the counters from a background thread at a
+// fixed interval and writes a line with the rates since the previous line.
+//
+// Example.
+//   util::ProgressCounters counters;
+//   {
+//     util::ProgressReporter reporter(&counters, 10.0, &std::cerr);
+//     for (const string& line : lines) {
+//       counters.AddLines(1, line.size());
+//     }
+//   }
+#ifndef LOGLE_UTIL_PROGRESS_H_
+#define LOGLE_UTIL_PROGRESS_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <ostream>
+#include <thread>  // NOLINT
+
+#include "base/string.h"
+
+namespace morphie {
+namespace util {
+
+// The counters of an ingest. The line and byte counters are cumulative, and
+// the node and edge counters hold the size of the graph when they were last
+// set. The counters may be updated from several threads concurrently.
+struct ProgressCounters {
+  ProgressCounters()
+      : lines_read(0), lines_skipped(0), bytes_read(0), nodes(0), edges(0) {}
+  ProgressCounters(const ProgressCounters&) = delete;
+  ProgressCounters& operator=(const ProgressCounters&) = delete;
+
+  // Adds 'num_lines' lines of 'num_bytes' bytes, of which 'num_skipped' were
+  // skipped, to the counters.
+  void AddLines(int64_t num_lines, int64_t num_bytes, int64_t num_skipped = 0) {
+    lines_read.fetch_add(num_lines, std::memory_order_relaxed);
+    bytes_read.fetch_add(num_bytes, std::memory_order_relaxed);
+    lines_skipped.fetch_add(num_skipped, std::memory_order_relaxed);
+  }
+  // Sets the size of the graph.
+  void SetGraphSize(int64_t num_nodes, int64_t num_edges) {
+    nodes.store(num_nodes, std::memory_order_relaxed);
+    edges.store(num_edges, std::memory_order_relaxed);
+  }
+
+  std::atomic<int64_t> lines_read;
+  std::atomic<int64_t> lines_skipped;
+  std::atomic<int64_t> bytes_read;
+  std::atomic<int64_t> nodes;
+  std::atomic<int64_t> edges;
+};
+
+// Returns a progress line for the counters 'lines_read', 'lines_skipped',
+// 'bytes_read', 'nodes' and 'edges', read 'elapsed_seconds' after the start of
+// an ingest and 'interval_seconds' after counters that had 'previous_lines'
+// lines and 'previous_bytes' bytes. The line has the format
+//   progress: elapsed=12.0s events=1200000 events/s=100000 bytes/s=52428800
+//   skip_rate=0.0010 nodes=3000000 edges=2900000 rss_mib=812.5
+// on a single line, where the rates are over the interval and the skip rate
+// is the fraction of all lines read that were skipped.
+string FormatProgress(double elapsed_seconds, double interval_seconds,
+                      int64_t lines_read, int64_t lines_skipped,
+                      int64_t bytes_read, int64_t previous_lines,
+                      int64_t previous_bytes, int64_t nodes, int64_t edges,
+                      double rss_mib);
+
+// A ProgressReporter writes a progress line for a ProgressCounters object to
+// an output stream every 'interval_seconds' from a background thread, and a
+// last line when it is destroyed. The counters and the stream must outlive
+// the reporter, and the stream must not be written by other threads while the
+// reporter exists.
+class ProgressReporter {
+ public:
+  ProgressReporter(const ProgressCounters* counters, double interval_seconds,
+                   std::ostream* out);
+  ~ProgressReporter();
+  ProgressReporter(const ProgressReporter&) = delete;
+  ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+ private:
+  // Writes a progress line and remembers the counters for the next line.
+  void Report();
+  // Calls Report every interval until the reporter is stopped.
+  void Run();
+
+  const ProgressCounters* const counters_;
+  const std::chrono::duration<double> interval_;
+  std::ostream* const out_;
+  const std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point previous_time_;
+  int64_t previous_lines_;
+  int64_t previous_bytes_;
+  // The mutex and condition variable only wake the thread when the reporter
+  // is stopped, so the counters are never read under a lock.
+  std::mutex mutex_;
+  std::condition_variable stop_condition_;
+  bool stopped_;
+  std::thread thread_;
+};
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_PROGRESS_H_
@@ -0,0 +1,86 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+#include "util/progress.h"
+
+#include <sstream>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+TEST(ProgressTest, FormatsRatesOverTheInterval) {
+  EXPECT_EQ(
+      "progress: elapsed=12.0s events=1200 events/s=100 bytes/s=1000 "
+      "skip_rate=0.0100 nodes=30 edges=29 rss_mib=812.5",
+      FormatProgress(12.0, 2.0, 1200, 12, 12000, 1000, 10000, 30, 29, 812.5));
+  // Rates are zero before any time has passed or any line has been read.
+  EXPECT_EQ(
+      "progress: elapsed=0.0s events=0 events/s=0 bytes/s=0 skip_rate=0.0000 "
+      "nodes=0 edges=0 rss_mib=1.0",
+      FormatProgress(0, 0, 0, 0, 0, 0, 0, 0, 0, 1.0));
+}
+
+TEST(ProgressTest, CountsFromSeveralThreads) {
+  ProgressCounters counters;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&counters] {
+      for (int j = 0; j < 1000; ++j) {
+        counters.AddLines(1, 10, j % 2);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  counters.SetGraphSize(5, 4);
+  EXPECT_EQ(4000, counters.lines_read.load());
+  EXPECT_EQ(2000, counters.lines_skipped.load());
+  EXPECT_EQ(40000, counters.bytes_read.load());
+  EXPECT_EQ(5, counters.nodes.load());
+  EXPECT_EQ(4, counters.edges.load());
+}
+
+TEST(ProgressTest, ReportsPeriodicallyAndWhenDestroyed) {
+  ProgressCounters counters;
+  std::ostringstream out;
+  {
+    ProgressReporter reporter(&counters, 0.01, &out);
+    counters.AddLines(3, 30, 1);
+    counters.SetGraphSize(2, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  string report = out.str();
+  std::vector<string> lines;
+  std::istringstream stream(report);
+  string line;
+  while (std::getline(stream, line)) {
+    lines.push_back(line);
+  }
+  ASSERT_GE(lines.size(), 2);
+  // The last line is written when the reporter is destroyed.
+  EXPECT_NE(string::npos, lines.back().find("events=3 "));
+  EXPECT_NE(string::npos, lines.back().find("skip_rate=0.3333"));
+  EXPECT_NE(string::npos, lines.back().find("nodes=2 edges=1"));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
@@ -0,0 +1,254 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/sketches.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include "util/flat_hash_map.h"
+#include "util/logging.h"
+#include "util/memory_usage.h"
+
+namespace morphie {
+namespace util {
+
+namespace {
+
+const char kPrecisionErr[] =
+    "The precision of a HyperLogLog must be at least 4 and at most 16.";
+const char kMergeErr[] = "Only HyperLogLogs of equal precision can be merged.";
+const char kSizeErr[] = "The size of a sketch must be positive.";
+const char kCountErr[] = "A count added to a sketch must be positive.";
+
+// Returns true if 'lhs' precedes 'rhs' in the order of the entries returned
+// by Top().
+bool IsMoreFrequent(const SketchEntry& lhs, const SketchEntry& rhs) {
+  return lhs.count != rhs.count ? lhs.count > rhs.count : lhs.item < rhs.item;
+}
+
+// Returns the bytes of the strings held by 'map', beyond those of its nodes.
+template <typename Map>
+size_t KeyBytes(const Map& map) {
+  size_t bytes = 0;
+  for (const auto& entry : map) {
+    bytes += entry.first.capacity();
+  }
+  return bytes;
+}
+
+}  // namespace
+
+uint64_t SketchHash(const string& item) {
+  return internal::MixHash(std::hash<string>()(item));
+}
+
+HyperLogLog::HyperLogLog(int precision) : precision_(precision) {
+  CHECK(precision >= 4 && precision <= 16, kPrecisionErr);
+  registers_.assign(size_t{1} << precision, 0);
+}
+
+// The first 'precision_' bits of the hash select a register, which keeps the
+// largest position of the first one bit in the remaining bits.
+void HyperLogLog::AddHash(uint64_t hash) {
+  const size_t index = hash >> (64 - precision_);
+  const uint64_t rest = hash << precision_;
+  const int max_rank = 64 - precision_ + 1;
+  const int rank = rest == 0 ? max_rank : __builtin_clzll(rest) + 1;
+  registers_[index] =
+      std::max(registers_[index], static_cast<uint8_t>(rank));
+}
+
+void HyperLogLog::Merge(const HyperLogLog& other) {
+  CHECK(other.precision_ == precision_, kMergeErr);
+  for (size_t i = 0; i < registers_.size(); ++i) {
+    registers_[i] = std::max(registers_[i], other.registers_[i]);
+  }
+}
+
+// The raw estimate of Flajolet et al. is replaced by linear counting of the
+// empty registers for small cardinalities, where it is biased.
+double HyperLogLog::Estimate() const {
+  const double num_registers = static_cast<double>(registers_.size());
+  double alpha;
+  switch (precision_) {
+    case 4:
+      alpha = 0.673;
+      break;
+    case 5:
+      alpha = 0.697;
+      break;
+    case 6:
+      alpha = 0.709;
+      break;
+    default:
+      alpha = 0.7213 / (1 + 1.079 / num_registers);
+      break;
+  }
+  double sum = 0;
+  int num_zeros = 0;
+  for (uint8_t rank : registers_) {
+    sum += std::ldexp(1.0, -rank);
+    if (rank == 0) {
+      ++num_zeros;
+    }
+  }
+  const double estimate = alpha * num_registers * num_registers / sum;
+  if (estimate <= 2.5 * num_registers && num_zeros > 0) {
+    return num_registers * std::log(num_registers / num_zeros);
+  }
+  return estimate;
+}
+
+size_t HyperLogLog::MemoryUsage() const { return VectorBytes(registers_); }
+
+CountMinSketch::CountMinSketch(int width, int depth)
+    : width_(width), depth_(depth), total_(0) {
+  CHECK(width > 0 && depth > 0, kSizeErr);
+  counters_.assign(static_cast<size_t>(width) * depth, 0);
+}
+
+// The rows use the hashes h1 + row * h2 of Kirsch and Mitzenmacher, which are
+// as good as independent hashes for the bounds of the sketch.
+size_t CountMinSketch::CounterIndex(uint64_t hash, int row) const {
+  const uint64_t h1 = hash & 0xffffffffULL;
+  const uint64_t h2 = (hash >> 32) | 1;
+  return static_cast<size_t>(row) * width_ + (h1 + row * h2) % width_;
+}
+
+// Counters are updated conservatively: only the counters below the new
+// estimate are raised to it, which keeps every estimate an upper bound and
+// lowers the error of the strings that share counters.
+int64_t CountMinSketch::Add(const string& item, int64_t count) {
+  CHECK(count > 0, kCountErr);
+  const uint64_t hash = SketchHash(item);
+  int64_t estimate = std::numeric_limits<int64_t>::max();
+  for (int row = 0; row < depth_; ++row) {
+    estimate = std::min(estimate, counters_[CounterIndex(hash, row)]);
+  }
+  estimate += count;
+  for (int row = 0; row < depth_; ++row) {
+    int64_t& counter = counters_[CounterIndex(hash, row)];
+    counter = std::max(counter, estimate);
+  }
+  total_ += count;
+  return estimate;
+}
+
+int64_t CountMinSketch::Estimate(const string& item) const {
+  const uint64_t hash = SketchHash(item);
+  int64_t estimate = std::numeric_limits<int64_t>::max();
+  for (int row = 0; row < depth_; ++row) {
+    estimate = std::min(estimate, counters_[CounterIndex(hash, row)]);
+  }
+  return estimate;
+}
+
+int64_t CountMinSketch::ErrorBound() const {
+  return static_cast<int64_t>(std::ceil(std::exp(1.0) * total_ / width_));
+}
+
+size_t CountMinSketch::MemoryUsage() const { return VectorBytes(counters_); }
+
+HeavyHitters::HeavyHitters(int k, int width, int depth)
+    : k_(k), sketch_(width, depth), min_count_(0) {
+  CHECK(k > 0, kSizeErr);
+}
+
+// The smallest count of the candidates is only searched for when a string
+// that is not a candidate may replace one.
+void HeavyHitters::Add(const string& item) {
+  const int64_t count = sketch_.Add(item, 1);
+  auto candidate_it = candidates_.find(item);
+  if (candidate_it != candidates_.end()) {
+    candidate_it->second = count;
+    return;
+  }
+  if (static_cast<int>(candidates_.size()) < k_) {
+    candidates_.emplace(item, count);
+    return;
+  }
+  if (count <= min_count_) {
+    return;
+  }
+  auto min_it = candidates_.begin();
+  for (auto it = candidates_.begin(); it != candidates_.end(); ++it) {
+    if (it->second < min_it->second) {
+      min_it = it;
+    }
+  }
+  min_count_ = min_it->second;
+  if (count > min_count_) {
+    candidates_.erase(min_it);
+    candidates_.emplace(item, count);
+  }
+}
+
+// A candidate was added at least once, so its error is less than its count.
+std::vector<SketchEntry> HeavyHitters::Top() const {
+  const int64_t error = sketch_.ErrorBound();
+  std::vector<SketchEntry> top;
+  for (const auto& candidate : candidates_) {
+    top.push_back({candidate.first, candidate.second,
+                   std::min(error, candidate.second - 1)});
+  }
+  std::sort(top.begin(), top.end(), IsMoreFrequent);
+  return top;
+}
+
+size_t HeavyHitters::MemoryUsage() const {
+  return sketch_.MemoryUsage() + UnorderedMapBytes(candidates_) +
+         KeyBytes(candidates_);
+}
+
+TopK::TopK(int k) : k_(k) { CHECK(k > 0, kSizeErr); }
+
+void TopK::Add(const string& item) {
+  auto counter_it = counters_.find(item);
+  if (counter_it != counters_.end()) {
+    ++counter_it->second.count;
+    return;
+  }
+  if (static_cast<int>(counters_.size()) < k_) {
+    counters_.emplace(item, Counter{1, 0});
+    return;
+  }
+  auto min_it = counters_.begin();
+  for (auto it = counters_.begin(); it != counters_.end(); ++it) {
+    if (it->second.count < min_it->second.count) {
+      min_it = it;
+    }
+  }
+  const int64_t min_count = min_it->second.count;
+  counters_.erase(min_it);
+  counters_.emplace(item, Counter{min_count + 1, min_count});
+}
+
+std::vector<SketchEntry> TopK::Top() const {
+  std::vector<SketchEntry> top;
+  for (const auto& counter : counters_) {
+    top.push_back({counter.first, counter.second.count, counter.second.error});
+  }
+  std::sort(top.begin(), top.end(), IsMoreFrequent);
+  return top;
+}
+
+size_t TopK::MemoryUsage() const {
+  return UnorderedMapBytes(counters_) + KeyBytes(counters_);
+}
+
+}  // namespace util
+}  // namespace morphie
@@ -0,0 +1,163 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains probabilistic sketches, which summarize a stream of
+// strings in memory that is fixed when the sketch is constructed, however long
+// the stream is. A sketch answers its queries approximately.
+//  - A HyperLogLog estimates the number of distinct strings in the stream.
+//  - A CountMinSketch estimates how often a string occurs in the stream, and
+//    never underestimates. A HeavyHitters sketch uses one to keep the strings
+//    that occur most often.
+//  - A TopK keeps the strings that occur most often with the Space-Saving
+//    algorithm, which bounds the error of each count.
+//
+// Example.
+//   util::HyperLogLog distinct_files(12);
+//   util::TopK busiest_directories(10);
+//   for (const File& file : files) {
+//     distinct_files.Add(file.path);
+//     busiest_directories.Add(file.directory);
+//   }
+//   double num_files = distinct_files.Estimate();
+//   std::vector<util::SketchEntry> directories = busiest_directories.Top();
+#ifndef LOGLE_UTIL_SKETCHES_H_
+#define LOGLE_UTIL_SKETCHES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "base/string.h"
+
+namespace morphie {
+namespace util {
+
+// Returns the 64-bit hash of 'item' that the sketches below use.
+uint64_t SketchHash(const string& item);
+
+// A HyperLogLog has 2^precision registers of one byte each. Its estimates
+// have a relative standard error of about 1.04 / sqrt(2^precision), so a
+// precision of 12 uses 4 KiB and errs by about 1.6%.
+class HyperLogLog {
+ public:
+  // - Crashes unless 'precision' is at least 4 and at most 16.
+  explicit HyperLogLog(int precision);
+
+  void Add(const string& item) { AddHash(SketchHash(item)); }
+  void AddHash(uint64_t hash);
+  // Adds the strings added to 'other' to this sketch, so that it estimates
+  // the number of distinct strings of both streams.
+  // - Crashes unless 'other' has the same precision.
+  void Merge(const HyperLogLog& other);
+  // Returns the estimated number of distinct strings that have been added.
+  double Estimate() const;
+  size_t MemoryUsage() const;
+
+ private:
+  int precision_;
+  std::vector<uint8_t> registers_;
+};
+
+// A CountMinSketch has 'depth' rows of 'width' counters. The estimated count
+// of a string exceeds its true count by at most e / width times the total
+// count of the stream with probability 1 - exp(-depth).
+class CountMinSketch {
+ public:
+  // - Crashes unless 'width' and 'depth' are positive.
+  CountMinSketch(int width, int depth);
+
+  // Adds 'count' occurrences of 'item' and returns its new estimated count.
+  // - Crashes unless 'count' is positive.
+  int64_t Add(const string& item, int64_t count);
+  int64_t Estimate(const string& item) const;
+  // Returns the total count of all strings that have been added.
+  int64_t Total() const { return total_; }
+  // Returns e / width times the total count, rounded up, by which an
+  // estimate exceeds the true count with probability 1 - exp(-depth).
+  int64_t ErrorBound() const;
+  size_t MemoryUsage() const;
+
+ private:
+  // Returns the index of the counter of the string with hash 'hash' in 'row'.
+  size_t CounterIndex(uint64_t hash, int row) const;
+
+  int width_;
+  int depth_;
+  int64_t total_;
+  std::vector<int64_t> counters_;
+};
+
+// An entry of the strings that a sketch reports as the most frequent. The
+// count of an entry is an estimate that exceeds the true count by at most
+// 'error'.
+struct SketchEntry {
+  string item;
+  int64_t count;
+  int64_t error;
+};
+
+// A HeavyHitters sketch keeps the 'k' strings with the highest estimated
+// counts in a CountMinSketch. A string is kept if its estimate exceeds the
+// smallest estimate of a kept string when it is added. The error of an entry
+// is the bound of the CountMinSketch, which holds with high probability.
+class HeavyHitters {
+ public:
+  // - Crashes unless 'k', 'width' and 'depth' are positive.
+  HeavyHitters(int k, int width, int depth);
+
+  void Add(const string& item);
+  // Returns the kept strings by decreasing count, and by increasing string
+  // for equal counts.
+  std::vector<SketchEntry> Top() const;
+  int64_t Total() const { return sketch_.Total(); }
+  size_t MemoryUsage() const;
+
+ private:
+  int k_;
+  CountMinSketch sketch_;
+  std::unordered_map<string, int64_t> candidates_;
+  // A lower bound of the smallest count in 'candidates_', which only grow.
+  int64_t min_count_;
+};
+
+// A TopK counts at most 'k' strings. A string that is not counted when it is
+// added replaces the string with the smallest count, whose count it inherits
+// as its error, so the count of every string that occurs more than 1/k of the
+// time is kept. Adding a string that is not counted takes time linear in 'k'.
+class TopK {
+ public:
+  // - Crashes unless 'k' is positive.
+  explicit TopK(int k);
+
+  void Add(const string& item);
+  // Returns the counted strings by decreasing count, and by increasing string
+  // for equal counts.
+  std::vector<SketchEntry> Top() const;
+  size_t MemoryUsage() const;
+
+ private:
+  struct Counter {
+    int64_t count;
+    int64_t error;
+  };
+
+  int k_;
+  std::unordered_map<string, Counter> counters_;
+};
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_SKETCHES_H_
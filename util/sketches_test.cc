@@ -0,0 +1,143 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/sketches.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+// Returns the items of 'entries'.
+std::vector<string> Items(const std::vector<SketchEntry>& entries) {
+  std::vector<string> items;
+  for (const SketchEntry& entry : entries) {
+    items.push_back(entry.item);
+  }
+  return items;
+}
+
+// Small and large cardinalities are estimated within a few standard errors,
+// which are 1.6% for a precision of 12, and repeated items are not counted
+// again.
+TEST(HyperLogLogTest, EstimatesDistinctItems) {
+  HyperLogLog sketch(12);
+  EXPECT_EQ(0, sketch.Estimate());
+  for (int repeat = 0; repeat < 3; ++repeat) {
+    for (int i = 0; i < 100; ++i) {
+      sketch.Add(std::to_string(i));
+    }
+  }
+  EXPECT_NEAR(100, sketch.Estimate(), 3);
+  for (int i = 100; i < 100000; ++i) {
+    sketch.Add(std::to_string(i));
+  }
+  EXPECT_NEAR(100000, sketch.Estimate(), 5000);
+  EXPECT_EQ(4096, sketch.MemoryUsage());
+}
+
+TEST(HyperLogLogTest, MergesSketches) {
+  HyperLogLog lhs(10);
+  HyperLogLog rhs(10);
+  for (int i = 0; i < 1000; ++i) {
+    lhs.Add(std::to_string(i));
+    rhs.Add(std::to_string(i + 500));
+  }
+  lhs.Merge(rhs);
+  EXPECT_NEAR(1500, lhs.Estimate(), 150);
+}
+
+// With few distinct items, no counters are shared and the estimates are exact.
+TEST(CountMinSketchTest, NeverUnderestimates) {
+  CountMinSketch sketch(1024, 4);
+  EXPECT_EQ(1, sketch.Add("a", 1));
+  EXPECT_EQ(3, sketch.Add("a", 2));
+  EXPECT_EQ(5, sketch.Add("b", 5));
+  EXPECT_EQ(3, sketch.Estimate("a"));
+  EXPECT_EQ(0, sketch.Estimate("c"));
+  EXPECT_EQ(8, sketch.Total());
+  CountMinSketch small_sketch(16, 2);
+  for (int i = 0; i < 1000; ++i) {
+    small_sketch.Add(std::to_string(i), i % 7 + 1);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_LE(i % 7 + 1, small_sketch.Estimate(std::to_string(i)));
+  }
+}
+
+// Frequent items are kept among many rare ones, and are ordered by their
+// counts.
+TEST(HeavyHittersTest, KeepsFrequentItems) {
+  HeavyHitters sketch(3, 256, 4);
+  for (int i = 0; i < 2000; ++i) {
+    sketch.Add(std::to_string(i));
+    if (i % 2 == 0) {
+      sketch.Add("x");
+    }
+    if (i % 4 == 0) {
+      sketch.Add("y");
+    }
+    if (i % 8 == 0) {
+      sketch.Add("z");
+    }
+  }
+  std::vector<SketchEntry> top = sketch.Top();
+  ASSERT_EQ(3, top.size());
+  EXPECT_EQ(std::vector<string>({"x", "y", "z"}), Items(top));
+  EXPECT_LE(1000, top[0].count);
+  EXPECT_GE(1000 + top[0].error, top[0].count);
+  EXPECT_EQ(3750, sketch.Total());
+}
+
+// Space-Saving keeps the counts of items that are more frequent than 1/k, and
+// an item that replaces another inherits its count as its error.
+TEST(TopKTest, KeepsFrequentItems) {
+  TopK sketch(2);
+  sketch.Add("a");
+  sketch.Add("a");
+  sketch.Add("b");
+  sketch.Add("c");
+  std::vector<SketchEntry> top = sketch.Top();
+  ASSERT_EQ(2, top.size());
+  EXPECT_EQ("a", top[0].item);
+  EXPECT_EQ(2, top[0].count);
+  EXPECT_EQ(0, top[0].error);
+  EXPECT_EQ("c", top[1].item);
+  EXPECT_EQ(2, top[1].count);
+  EXPECT_EQ(1, top[1].error);
+  TopK frequent(4);
+  for (int i = 0; i < 1000; ++i) {
+    frequent.Add(i % 3 == 0 ? "frequent" : std::to_string(i));
+  }
+  EXPECT_EQ("frequent", frequent.Top()[0].item);
+  EXPECT_LE(334, frequent.Top()[0].count);
+}
+
+TEST(SketchesDeathTest, RequirePositiveSizes) {
+  EXPECT_DEATH({ HyperLogLog sketch(3); }, "The precision of a HyperLogLog");
+  EXPECT_DEATH({ CountMinSketch sketch(0, 1); },
+               "The size of a sketch must be positive.");
+  EXPECT_DEATH({ TopK sketch(0); }, "The size of a sketch must be positive.");
+  HyperLogLog lhs(4);
+  HyperLogLog rhs(5);
+  EXPECT_DEATH({ lhs.Merge(rhs); }, "Only HyperLogLogs of equal precision");
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
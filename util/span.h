@@ -0,0 +1,72 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// A span is a non-owning view of a contiguous sequence of objects. Functions
+// can return a span instead of a container to avoid copying the contents of a
+// container they own.
+#ifndef LOGLE_UTIL_SPAN_H_
+#define LOGLE_UTIL_SPAN_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace morphie {
+namespace util {
+
+// A Span<T> provides read-only access to a range of elements of type T. A span
+// does not own the elements it refers to and is invalidated by any operation
+// that invalidates pointers to those elements, such as inserting into the
+// std::vector the span was created from.
+//
+// Example.
+//   std::vector<int> v = {1, 2, 3};
+//   util::Span<int> span(v);
+//   for (int i : span) { ... }
+template <typename T>
+class Span {
+ public:
+  using value_type = T;
+  using const_iterator = const T*;
+  using iterator = const_iterator;
+
+  // The empty span.
+  Span() : data_(nullptr), size_(0) {}
+  Span(const T* data, size_t size) : data_(data), size_(size) {}
+  template <typename Allocator>
+  Span(const std::vector<T, Allocator>& vec)
+      : data_(vec.data()), size_(vec.size()) {}
+
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const T& operator[](size_t i) const { return data_[i]; }
+
+  // Returns true if 'val' is an element of the span. Takes time linear in the
+  // size of the span.
+  bool Contains(const T& val) const {
+    return std::find(begin(), end(), val) != end();
+  }
+
+ private:
+  const T* data_;
+  size_t size_;
+};
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_SPAN_H_
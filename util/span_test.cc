@@ -0,0 +1,59 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/span.h"
+
+#include <vector>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+TEST(SpanTest, EmptySpan) {
+  Span<int> span;
+  EXPECT_TRUE(span.empty());
+  EXPECT_EQ(0, span.size());
+  EXPECT_EQ(span.begin(), span.end());
+  EXPECT_FALSE(span.Contains(0));
+}
+
+TEST(SpanTest, SpanOfVector) {
+  std::vector<int> vec = {3, 1, 2};
+  Span<int> span(vec);
+  EXPECT_FALSE(span.empty());
+  ASSERT_EQ(3, span.size());
+  EXPECT_EQ(vec.data(), span.begin());
+  EXPECT_EQ(3, span[0]);
+  EXPECT_EQ(2, span[2]);
+  EXPECT_TRUE(span.Contains(1));
+  EXPECT_FALSE(span.Contains(4));
+  int sum = 0;
+  for (int i : span) {
+    sum += i;
+  }
+  EXPECT_EQ(6, sum);
+}
+
+TEST(SpanTest, SpanOfSingleElement) {
+  int val = 5;
+  Span<int> span(&val, 1);
+  ASSERT_EQ(1, span.size());
+  EXPECT_EQ(5, *span.begin());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
@@ -0,0 +1,66 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/stats.h"
+
+#include "util/string_utils.h"
+
+namespace morphie {
+namespace util {
+
+void Stats::AddTime(const string& phase, double seconds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  times_[phase] += seconds;
+}
+
+void Stats::AddCount(const string& counter, int64_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  counts_[counter] += count;
+}
+
+std::map<string, double> Stats::Times() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return times_;
+}
+
+std::map<string, int64_t> Stats::Counts() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return counts_;
+}
+
+ScopedTimer::~ScopedTimer() {
+  if (stats_ == nullptr && seconds_ == nullptr) {
+    return;
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start_;
+  // The allocations are read before the statistics are updated, which may
+  // allocate.
+  AllocationCounts counts;
+  if (is_profiling_allocations_) {
+    counts = ThreadAllocationCounts() - start_allocations_;
+  }
+  if (stats_ != nullptr) {
+    stats_->AddTime(phase_, elapsed.count());
+    if (is_profiling_allocations_) {
+      stats_->AddCount(StrCat("allocations/", phase_), counts.allocations);
+      stats_->AddCount(StrCat("allocated_bytes/", phase_), counts.bytes);
+    }
+  } else {
+    *seconds_ += elapsed.count();
+  }
+}
+
+}  // namespace util
+}  // namespace morphie
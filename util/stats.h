@@ -0,0 +1,115 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains utilities for instrumenting the phases of an analysis. A
+// Stats object accumulates the time spent in named phases, such as reading or
+// parsing the input, and named counters, such as the number of lines read. A
+// ScopedTimer adds the time from its construction to its destruction to a
+// phase.
+//
+// Example.
+//   util::Stats stats;
+//   {
+//     util::ScopedTimer timer(&stats, "parse");
+//     // Parse the input.
+//   }
+//   stats.AddCount("lines_read", num_lines);
+#ifndef LOGLE_UTIL_STATS_H_
+#define LOGLE_UTIL_STATS_H_
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <map>
+#include <mutex>  // NOLINT
+
+#include "base/string.h"
+#include "util/alloc_profile.h"
+
+namespace morphie {
+namespace util {
+
+// Accumulates phase times and counters. A Stats object may be updated from
+// several threads concurrently.
+class Stats {
+ public:
+  Stats() {}
+  Stats(const Stats&) = delete;
+  Stats& operator=(const Stats&) = delete;
+
+  // Adds 'seconds' to the time spent in 'phase'. Time spent by several threads
+  // in a phase is summed, so the time of a phase may exceed the wall time.
+  void AddTime(const string& phase, double seconds);
+  // Adds 'count' to 'counter'.
+  void AddCount(const string& counter, int64_t count);
+  // Returns the accumulated times in seconds and counts, by name. Phases and
+  // counters that were never updated are absent.
+  std::map<string, double> Times() const;
+  std::map<string, int64_t> Counts() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<string, double> times_;
+  std::map<string, int64_t> counts_;
+};
+
+// A ScopedTimer measures the wall time between its construction and its
+// destruction. The first constructor adds the time to a phase of 'stats' and
+// the second adds it to '*seconds', which lets a loop accumulate the time of a
+// phase locally and add it to a Stats object once. A timer with a null
+// argument measures nothing, so instrumentation can be disabled by passing a
+// null pointer. While allocation profiling is enabled (see
+// util/alloc_profile.h), a timer of a phase of 'stats' also adds the
+// allocations made by its thread to the counters "allocations/<phase>" and
+// "allocated_bytes/<phase>".
+class ScopedTimer {
+ public:
+  ScopedTimer(Stats* stats, const char* phase)
+      : stats_(stats),
+        phase_(phase),
+        seconds_(nullptr),
+        is_profiling_allocations_(stats != nullptr &&
+                                  IsAllocationProfilingEnabled()) {
+    if (stats_ != nullptr) {
+      start_ = std::chrono::steady_clock::now();
+    }
+    if (is_profiling_allocations_) {
+      start_allocations_ = ThreadAllocationCounts();
+    }
+  }
+  explicit ScopedTimer(double* seconds)
+      : stats_(nullptr),
+        phase_(nullptr),
+        seconds_(seconds),
+        is_profiling_allocations_(false) {
+    if (seconds_ != nullptr) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+  ~ScopedTimer();
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  Stats* const stats_;
+  const char* const phase_;
+  double* const seconds_;
+  const bool is_profiling_allocations_;
+  std::chrono::steady_clock::time_point start_;
+  AllocationCounts start_allocations_;
+};
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_STATS_H_
@@ -0,0 +1,80 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/stats.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+TEST(StatsTest, AccumulatesTimesAndCounts) {
+  Stats stats;
+  EXPECT_TRUE(stats.Times().empty());
+  EXPECT_TRUE(stats.Counts().empty());
+  stats.AddTime("parse", 1.5);
+  stats.AddTime("parse", 0.5);
+  stats.AddTime("write", 0.25);
+  stats.AddCount("lines_read", 3);
+  stats.AddCount("lines_read", 4);
+  std::map<string, double> times = stats.Times();
+  EXPECT_EQ(2, times.size());
+  EXPECT_DOUBLE_EQ(2.0, times["parse"]);
+  EXPECT_DOUBLE_EQ(0.25, times["write"]);
+  std::map<string, int64_t> counts = stats.Counts();
+  EXPECT_EQ(1, counts.size());
+  EXPECT_EQ(7, counts["lines_read"]);
+}
+
+TEST(StatsTest, CountsFromSeveralThreads) {
+  Stats stats;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&stats] {
+      for (int j = 0; j < 1000; ++j) {
+        stats.AddCount("events", 1);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(4000, stats.Counts()["events"]);
+}
+
+TEST(StatsTest, ScopedTimersAddElapsedTime) {
+  Stats stats;
+  double seconds = 0;
+  {
+    ScopedTimer phase_timer(&stats, "build");
+    ScopedTimer local_timer(&seconds);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_GE(stats.Times()["build"], 0.005);
+  EXPECT_GE(seconds, 0.005);
+  // Timers with null arguments measure nothing.
+  {
+    ScopedTimer phase_timer(nullptr, "build");
+    ScopedTimer local_timer(nullptr);
+  }
+  EXPECT_EQ(1, stats.Times().size());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
@@ -13,90 +13,110 @@
 // the License.
 #include "util/string_utils.h"
 
+#include <algorithm>
+#include <functional>
+
 namespace morphie {
 namespace util {
 
-std::set<string> SplitToSet(const string& str, char delim) {
-  std::vector<string> vec = SplitToVector(str, delim);
-  return std::set<string>(vec.begin(), vec.end());
-}
-
-std::vector<string> SplitToVector(const string& str, char delim) {
-  if (str.empty()) {
-    return {""};
-  }
-  std::vector<string> strings;
-  std::stringstream stream(str);
-  string token;
-  while (std::getline(stream, token, delim)) {
-    strings.push_back(token);
-  }
-  if (str.back() == delim) {
-    strings.push_back("");
-  }
-  return strings;
-}
-
-string StrCat(const string& str1, const string& str2) {
-  return StrCat(str1, str2, "", "", "", "");
-}
-
-string StrCat(const string& str1, const string& str2, const string& str3) {
-  return StrCat(str1, str2, str3, "", "", "");
+bool operator==(StringPiece lhs, StringPiece rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
-string StrCat(const string& str1, const string& str2, const string& str3,
-              const string& str4) {
-  return StrCat(str1, str2, str3, str4, "", "");
+std::ostream& operator<<(std::ostream& out, StringPiece piece) {
+  return out.write(piece.data(), piece.size());
 }
 
-string StrCat(const string& str1, const string& str2, const string& str3,
-              const string& str4, const string& str5) {
-  return StrCat(str1, str2, str3, str4, str5, "");
+std::vector<StringPiece> SplitToPieces(StringPiece str, char delim) {
+  std::vector<StringPiece> pieces;
+  const char* begin = str.begin();
+  for (const char* it = str.begin(); it != str.end(); ++it) {
+    if (*it == delim) {
+      pieces.emplace_back(begin, it - begin);
+      begin = it + 1;
+    }
+  }
+  pieces.emplace_back(begin, str.end() - begin);
+  return pieces;
 }
 
-string StrCat(const string& str1, const string& str2, const string& str3,
-              const string& str4, const string& str5, const string& str6) {
-  string out;
-  StrAppend(&out, str1, str2, str3, str4, str5, str6);
-  return out;
+std::set<string> SplitToSet(StringPiece str, char delim) {
+  std::set<string> strings;
+  for (StringPiece piece : SplitToPieces(str, delim)) {
+    strings.insert(piece.ToString());
+  }
+  return strings;
 }
 
-void StrAppend(string* out, const string& str1) {
-  StrAppend(out, str1, "", "", "", "", "");
+std::vector<string> SplitToVector(StringPiece str, char delim) {
+  std::vector<StringPiece> pieces = SplitToPieces(str, delim);
+  std::vector<string> strings;
+  strings.reserve(pieces.size());
+  for (StringPiece piece : pieces) {
+    strings.push_back(piece.ToString());
+  }
+  return strings;
 }
 
-void StrAppend(string* out, const string& str1, const string& str2) {
-  StrAppend(out, str1, str2, "", "", "", "");
+// The digits are written backwards from the end of the buffer.
+AlphaNum::AlphaNum(long long value) {  // NOLINT
+  const bool is_negative = value < 0;
+  // The magnitude is computed without negating 'value', which overflows for
+  // the smallest integer.
+  unsigned long long magnitude =  // NOLINT
+      is_negative ? 0 - static_cast<unsigned long long>(value)  // NOLINT
+                  : static_cast<unsigned long long>(value);     // NOLINT
+  char* begin = digits_ + kBufferSize;
+  do {
+    *--begin = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (is_negative) {
+    *--begin = '-';
+  }
+  piece_ = StringPiece(begin, digits_ + kBufferSize - begin);
 }
 
-void StrAppend(string* out, const string& str1, const string& str2,
-               const string& str3) {
-  StrAppend(out, str1, str2, str3, "", "", "");
+AlphaNum::AlphaNum(unsigned long long value) {  // NOLINT
+  char* begin = digits_ + kBufferSize;
+  do {
+    *--begin = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  piece_ = StringPiece(begin, digits_ + kBufferSize - begin);
 }
 
-void StrAppend(string* out, const string& str1, const string& str2,
-               const string& str3, const string& str4) {
-  StrAppend(out, str1, str2, str3, str4, "", "");
-}
+namespace internal {
 
-void StrAppend(string* out, const string& str1, const string& str2,
-               const string& str3, const string& str4, const string& str5) {
-  StrAppend(out, str1, str2, str3, str4, str5, "");
+void AppendPieces(string* out, std::initializer_list<StringPiece> pieces) {
+  size_t size = out->size();
+  bool is_aliased = false;
+  const std::less<const char*> less;
+  for (StringPiece piece : pieces) {
+    size += piece.size();
+    is_aliased = is_aliased || (!piece.empty() &&
+                                !less(piece.data(), out->data()) &&
+                                less(piece.data(), out->data() + out->size()));
+  }
+  if (is_aliased) {
+    // Reserving space may move the characters that a piece refers to.
+    string result;
+    result.reserve(size);
+    result += *out;
+    for (StringPiece piece : pieces) {
+      result.append(piece.data(), piece.size());
+    }
+    out->swap(result);
+    return;
+  }
+  out->reserve(size);
+  for (StringPiece piece : pieces) {
+    out->append(piece.data(), piece.size());
+  }
 }
 
-void StrAppend(string* out, const string& str1, const string& str2,
-               const string& str3, const string& str4, const string& str5,
-               const string& str6) {
-  out->reserve(out->size() + str1.size() + str2.size() + str3.size() +
-               str4.size() + str5.size() + str6.size());
-  *out += str1;
-  *out += str2;
-  *out += str3;
-  *out += str4;
-  *out += str5;
-  *out += str6;
-}
+}  // namespace internal
 
 }  // namespace util
 }  // namespace morphie
@@ -16,6 +16,9 @@
 #ifndef LOGLE_UTIL_STRING_UTILS_H_
 #define LOGLE_UTIL_STRING_UTILS_H_
 
+#include <cstring>
+#include <initializer_list>
+#include <ostream>
 #include <set>
 #include <sstream>
 #include <vector>
@@ -25,42 +28,109 @@
 namespace morphie {
 namespace util {
 
+// A StringPiece refers to a range of characters owned by another object, such
+// as a string or a string literal, which must outlive it. Pieces let strings
+// be split and concatenated without copying them into temporary strings.
+class StringPiece {
+ public:
+  StringPiece() : data_(nullptr), size_(0) {}
+  StringPiece(const char* str) : data_(str), size_(std::strlen(str)) {}
+  StringPiece(const string& str) : data_(str.data()), size_(str.size()) {}
+  StringPiece(const char* data, size_t size) : data_(data), size_(size) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  char operator[](size_t i) const { return data_[i]; }
+  string ToString() const { return string(data_, size_); }
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+bool operator==(StringPiece lhs, StringPiece rhs);
+inline bool operator!=(StringPiece lhs, StringPiece rhs) {
+  return !(lhs == rhs);
+}
+std::ostream& operator<<(std::ostream& out, StringPiece piece);
+
+// Returns the pieces of 'str' between occurrences of 'delim', with the same
+// semantics as SplitToVector, without copying them. The pieces refer to the
+// characters of 'str'.
+std::vector<StringPiece> SplitToPieces(StringPiece str, char delim);
 // Returns a container of strings obtained by splitting 'str' using the
 // delimiter provided.
-std::set<string> SplitToSet(const string& str, char delim);
+std::set<string> SplitToSet(StringPiece str, char delim);
 // Some examples to illustrate the semantics.
 //   SplitToVector("", ',') == {""}
 //   SplitToVector("abc", ',') == {"abc"}
 //   SplitToVector("/usr/local/bin", '/') == {"", "local", "bin"}
 //   SplitToVector("/usr/local/bin/", '/') == {"", "local", "bin", ""}
-std::vector<string> SplitToVector(const string& str, char delim);
-
-// The StrCat functions return the concatenation of their arguments.
-string StrCat(const string& str1, const string& str2);
-string StrCat(const string& str1, const string& str2, const string& str3);
-string StrCat(const string& str1, const string& str2, const string& str3,
-              const string& str4);
-string StrCat(const string& str1, const string& str2, const string& str3,
-              const string& str4, const string& str5);
-string StrCat(const string& str1, const string& str2, const string& str3,
-              const string& str4, const string& str5, const string& str6);
-
-// The StrAppend functions append the second and subsequent arguments to the
-// string in the first argument. These functions should not be called with the
-// output string as one of the second or other arguments. Please avoid
-// anti-patterns like this.
-//   StrAppend(&out, str1, out);
-void StrAppend(string* out, const string& str1);
-void StrAppend(string* out, const string& str1, const string& str2);
-void StrAppend(string* out, const string& str1, const string& str2,
-               const string& str3);
-void StrAppend(string* out, const string& str1, const string& str2,
-               const string& str3, const string& str4);
-void StrAppend(string* out, const string& str1, const string& str2,
-               const string& str3, const string& str4, const string& str5);
-void StrAppend(string* out, const string& str1, const string& str2,
-               const string& str3, const string& str4, const string& str5,
-               const string& str6);
+std::vector<string> SplitToVector(StringPiece str, char delim);
+
+// An AlphaNum is an argument of StrCat and StrAppend, which can be a string, a
+// string literal, a StringPiece or an integer. Integers are formatted in
+// decimal into a buffer of the AlphaNum, so that they are not converted to
+// temporary strings. Characters are not accepted, since they would be
+// formatted as integers.
+class AlphaNum {
+ public:
+  AlphaNum(const char* str) : piece_(str) {}
+  AlphaNum(const string& str) : piece_(str) {}
+  AlphaNum(StringPiece piece) : piece_(piece) {}
+  AlphaNum(int value) : AlphaNum(static_cast<long long>(value)) {}
+  AlphaNum(unsigned value)
+      : AlphaNum(static_cast<unsigned long long>(value)) {}
+  AlphaNum(long value) : AlphaNum(static_cast<long long>(value)) {}  // NOLINT
+  AlphaNum(unsigned long value)  // NOLINT
+      : AlphaNum(static_cast<unsigned long long>(value)) {}
+  AlphaNum(long long value);                    // NOLINT
+  AlphaNum(unsigned long long value);           // NOLINT
+  AlphaNum(char value) = delete;
+  AlphaNum(const AlphaNum&) = delete;
+  AlphaNum& operator=(const AlphaNum&) = delete;
+
+  StringPiece Piece() const { return piece_; }
+
+ private:
+  // The digits of the largest 64-bit integer and a sign.
+  static const int kBufferSize = 21;
+
+  StringPiece piece_;
+  char digits_[kBufferSize];
+};
+
+namespace internal {
+
+// Appends the pieces to 'out' after reserving the space for all of them. A
+// piece may refer to the characters of 'out'.
+void AppendPieces(string* out, std::initializer_list<StringPiece> pieces);
+
+}  // namespace internal
+
+// StrCat returns the concatenation of its arguments, which are converted to
+// AlphaNums. The size of the result is computed before the arguments are
+// copied, so the result is allocated once.
+//   StrCat("Node ", node_id, " has label ", label)
+template <typename... Args>
+string StrCat(const Args&... args) {
+  string out;
+  internal::AppendPieces(&out, {AlphaNum(args).Piece()...});
+  return out;
+}
+
+// StrAppend appends its second and subsequent arguments to the string in the
+// first argument, reserving the space for all of them at once. The output
+// string may also occur as an argument, in which case the argument is its
+// value before the call.
+//   StrAppend(&out, out) doubles 'out'.
+template <typename... Args>
+void StrAppend(string* out, const Args&... args) {
+  internal::AppendPieces(out, {AlphaNum(args).Piece()...});
+}
 
 // Returns a string equivalent to the concatenation of strings in 'args' using
 // 'sep' as a separator. Assumes that stream operators can be used to obtain a
@@ -16,6 +16,8 @@
 
 #include "util/string_utils.h"
 
+#include <cstdint>
+#include <limits>
 #include <set>
 
 #include "base/string.h"
@@ -112,17 +114,43 @@ TEST(StrAppendTest, Correctness) {
   out.clear();
   StrAppend(&out, "a", "b", "c", "d", "e", "f");
   EXPECT_EQ("abcdef", out);
-  // The next few tests demonstrate anti-patterns. Where the string being
-  // appended to is passed as data as well.
-  // This will work because 'out' occurs only once as an argument.
+  // The string being appended to may be passed as data as well, and its
+  // occurrences refer to its value before the call.
   out = "ab";
   StrAppend(&out, out);
   EXPECT_EQ("abab", out);
-  // These do not work because the string is modified as it is being read for
-  // each argument.
-  out.clear();
-  StrAppend(&out, out, "ab", out);
-  EXPECT_NE("ab", out);
+  out = "a";
+  StrAppend(&out, out, "b", out);
+  EXPECT_EQ("aaba", out);
+}
+
+TEST(StrCatTest, FormatsIntegers) {
+  EXPECT_EQ("0", StrCat(0));
+  EXPECT_EQ("node 42 -> 7;", StrCat("node ", 42, " -> ", size_t{7}, ";"));
+  EXPECT_EQ("-1", StrCat(-1L));
+  EXPECT_EQ("-9223372036854775808",
+            StrCat(std::numeric_limits<int64_t>::min()));
+  EXPECT_EQ("18446744073709551615",
+            StrCat(std::numeric_limits<uint64_t>::max()));
+  string out = "x";
+  StrAppend(&out, -12, 'a' == 'a');
+  EXPECT_EQ("x-121", out);
+  // Any number of arguments.
+  EXPECT_EQ("", StrCat());
+  EXPECT_EQ("abcdefgh", StrCat("a", "b", "c", "d", "e", "f", "g", "h"));
+}
+
+TEST(SplitToPiecesTest, Correctness) {
+  const string path = "/usr//bin/";
+  std::vector<StringPiece> pieces = SplitToPieces(path, '/');
+  std::vector<StringPiece> expected = {"", "usr", "", "bin", ""};
+  EXPECT_EQ(expected, pieces);
+  // The pieces refer to the characters of the input.
+  EXPECT_EQ(path.data() + 1, pieces[1].data());
+  expected = {""};
+  EXPECT_EQ(expected, SplitToPieces("", '/'));
+  EXPECT_EQ("usr", pieces[1].ToString());
+  EXPECT_NE(StringPiece("us"), pieces[1]);
 }
 
 TEST(SetJoinTest, OutputProperties) {
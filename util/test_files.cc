@@ -0,0 +1,57 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/test_files.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "util/logging.h"
+
+namespace {
+
+const char kTempFileErr[] = "The temporary file could not be created.";
+
+}  // namespace
+
+namespace morphie {
+namespace test {
+
+string GetTempFile(const string& extension) {
+  string filename = "/tmp/morphie_test_XXXXXX" + extension;
+  int fd = mkstemps(&filename[0], static_cast<int>(extension.size()));
+  CHECK(fd >= 0, kTempFileErr);
+  close(fd);
+  return filename;
+}
+
+string WriteTempFile(const string& content) {
+  string filename = GetTempFile();
+  std::ofstream file(filename);
+  file << content;
+  return filename;
+}
+
+string ReadFile(const string& filename) {
+  std::ifstream file(filename);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+}  // namespace test
+}  // namespace morphie
@@ -0,0 +1,41 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains functions that create and read temporary files for use in
+// tests.
+#ifndef LOGLE_UTIL_TEST_FILES_H_
+#define LOGLE_UTIL_TEST_FILES_H_
+
+#include "base/string.h"
+
+namespace morphie {
+namespace test {
+
+// Returns the name of a new, empty temporary file whose name ends in
+// 'extension'.
+// - Crashes if the file cannot be created.
+string GetTempFile(const string& extension = "");
+
+// Writes 'content' to a new temporary file and returns its name.
+// - Crashes if the file cannot be created.
+string WriteTempFile(const string& content);
+
+// Returns the contents of the file 'filename', or the empty string if the file
+// cannot be read.
+string ReadFile(const string& filename);
+
+}  // namespace test
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_TEST_FILES_H_
@@ -0,0 +1,194 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "util/logging.h"
+#include "util/trace.h"
+
+namespace morphie {
+namespace util {
+
+namespace {
+
+const char kThreadsErr[] = "The number of threads must not be negative.";
+
+// The number of chunks per thread that ParallelFor splits a range into, so
+// that threads that finish early take over work from slower ones.
+const size_t kChunksPerThread = 4;
+
+// The pool whose worker is the current thread, if any, and its queue.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads)
+    : next_queue_(0), num_queued_(0), num_unfinished_(0), stopping_(false) {
+  CHECK(num_threads >= 0, kThreadsErr);
+  // A pool without workers has one queue for the tasks that callers run.
+  for (int i = 0; i < std::max(num_threads, 1); ++i) {
+    queues_.emplace_back(new TaskQueue);
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  size_t queue = CurrentQueue();
+  if (queue == queues_.size()) {
+    queue = next_queue_.fetch_add(1) % queues_.size();
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++num_unfinished_;
+  }
+  {
+    std::unique_lock<std::mutex> lock(queues_[queue]->mutex);
+    queues_[queue]->tasks.push_back(std::move(task));
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++num_queued_;
+  }
+  work_available_.notify_one();
+}
+
+bool ThreadPool::RunPendingTask() {
+  std::function<void()> task;
+  size_t queue = CurrentQueue();
+  if (!PopTask(queue == queues_.size() ? 0 : queue, &task)) {
+    return false;
+  }
+  RunTask(&task);
+  return true;
+}
+
+void ThreadPool::Wait() {
+  while (RunPendingTask()) {
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  all_finished_.wait(lock, [this] { return num_unfinished_ == 0; });
+}
+
+bool ThreadPool::PopTask(size_t queue, std::function<void()>* task) {
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    TaskQueue* task_queue = queues_[(queue + i) % queues_.size()].get();
+    std::unique_lock<std::mutex> lock(task_queue->mutex);
+    if (task_queue->tasks.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      *task = std::move(task_queue->tasks.back());
+      task_queue->tasks.pop_back();
+    } else {
+      *task = std::move(task_queue->tasks.front());
+      task_queue->tasks.pop_front();
+    }
+    lock.unlock();
+    std::unique_lock<std::mutex> count_lock(mutex_);
+    --num_queued_;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::RunTask(std::function<void()>* task) {
+  {
+    ScopedSpan span("ThreadPoolTask");
+    (*task)();
+    *task = nullptr;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (--num_unfinished_ == 0) {
+    all_finished_.notify_all();
+  }
+}
+
+// A worker sleeps while there is no queued task and exits once the pool is
+// stopping, which happens after every task has finished.
+void ThreadPool::WorkerLoop(size_t queue) {
+  current_pool = this;
+  current_queue = queue;
+  std::function<void()> task;
+  while (true) {
+    if (PopTask(queue, &task)) {
+      RunTask(&task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_available_.wait(lock,
+                         [this] { return stopping_ || num_queued_ > 0; });
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+size_t ThreadPool::CurrentQueue() const {
+  return current_pool == this ? current_queue : queues_.size();
+}
+
+// The calling thread runs the first chunk and then helps with the other chunks
+// until none is left to start, so a ParallelFor called from a task does not
+// wait for workers that are themselves waiting.
+void ParallelFor(size_t num_items, ThreadPool* pool,
+                 const std::function<void(size_t, size_t)>& fn) {
+  if (pool == nullptr || pool->NumThreads() == 0 || num_items <= 1) {
+    fn(0, num_items);
+    return;
+  }
+  size_t num_chunks = std::min(
+      num_items, kChunksPerThread * (pool->NumThreads() + 1));
+  size_t chunk_size = (num_items + num_chunks - 1) / num_chunks;
+  num_chunks = (num_items + chunk_size - 1) / chunk_size;
+  std::mutex mutex;
+  std::condition_variable done;
+  size_t num_remaining = num_chunks - 1;
+  for (size_t chunk = 1; chunk < num_chunks; ++chunk) {
+    size_t begin = chunk * chunk_size;
+    size_t end = std::min(num_items, begin + chunk_size);
+    pool->Schedule([&fn, &mutex, &done, &num_remaining, begin, end] {
+      fn(begin, end);
+      std::unique_lock<std::mutex> lock(mutex);
+      if (--num_remaining == 0) {
+        done.notify_all();
+      }
+    });
+  }
+  fn(0, chunk_size);
+  while (pool->RunPendingTask()) {
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&num_remaining] { return num_remaining == 0; });
+}
+
+}  // namespace util
+}  // namespace morphie
@@ -0,0 +1,115 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// This file contains the executor that is shared by the parallel parts of the
+// tool. A ThreadPool runs tasks on a fixed set of worker threads. Every worker
+// has its own queue of tasks: a task scheduled by a worker is added to that
+// worker's queue, other tasks are distributed over the queues in turn, and a
+// worker whose queue is empty steals tasks from the other queues. ParallelFor
+// splits a range of indexes into chunks that are run by the workers of a pool
+// and by the calling thread.
+//
+// Example.
+//   util::ThreadPool pool(3);
+//   util::ParallelFor(values.size(), &pool, [&values](size_t begin,
+//                                                     size_t end) {
+//     for (size_t i = begin; i < end; ++i) {
+//       values[i] = Compute(i);
+//     }
+//   });
+#ifndef LOGLE_UTIL_THREAD_POOL_H_
+#define LOGLE_UTIL_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace morphie {
+namespace util {
+
+class ThreadPool {
+ public:
+  // Starts 'num_threads' worker threads. A pool without workers runs its tasks
+  // only on threads that call RunPendingTask or ParallelFor.
+  // - Crashes unless 'num_threads' is at least 0.
+  explicit ThreadPool(int num_threads);
+  // Waits for the scheduled tasks to finish, as Wait does, and stops the
+  // workers.
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int NumThreads() const { return static_cast<int>(workers_.size()); }
+
+  // Schedules 'task' to run on a worker. Tasks may schedule further tasks.
+  void Schedule(std::function<void()> task);
+  // Runs one scheduled task on the calling thread, preferring the queue of the
+  // calling worker. Returns false if there was no task to run.
+  bool RunPendingTask();
+  // Runs scheduled tasks on the calling thread until none is left to start and
+  // blocks until every scheduled task has finished. Must not be called from a
+  // task of this pool.
+  void Wait();
+
+ private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  // Removes a task from the queue with index 'queue' or, failing that, from
+  // another queue. A worker takes the newest task of its own queue and the
+  // oldest task of another queue.
+  bool PopTask(size_t queue, std::function<void()>* task);
+  // Runs 'task' and records that it has finished.
+  void RunTask(std::function<void()>* task);
+  void WorkerLoop(size_t queue);
+  // Returns the index of the queue of the calling thread if it is a worker of
+  // this pool, and the number of queues otherwise.
+  size_t CurrentQueue() const;
+
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> next_queue_;
+  // Guards the counts below and 'stopping_'.
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable all_finished_;
+  // The number of tasks in the queues, which may briefly be negative while a
+  // task that is being scheduled has already been taken.
+  int64_t num_queued_;
+  // The number of tasks that have been scheduled and have not finished.
+  int64_t num_unfinished_;
+  bool stopping_;
+};
+
+// Calls fn(begin, end) on consecutive ranges that together cover
+// [0, num_items) and returns when every call has returned. The ranges are run
+// by the workers of '*pool' and by the calling thread, which may itself be a
+// worker of '*pool'. If 'pool' is null or has no workers, fn(0, num_items) is
+// called on the calling thread.
+void ParallelFor(size_t num_items, ThreadPool* pool,
+                 const std::function<void(size_t, size_t)>& fn);
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_THREAD_POOL_H_
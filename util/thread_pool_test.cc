@@ -0,0 +1,102 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "util/thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+TEST(ThreadPoolTest, RunsScheduledTasks) {
+  for (int num_threads : {0, 1, 4}) {
+    std::atomic<int> sum(0);
+    {
+      ThreadPool pool(num_threads);
+      EXPECT_EQ(num_threads, pool.NumThreads());
+      for (int i = 1; i <= 100; ++i) {
+        pool.Schedule([&sum, i] { sum += i; });
+      }
+      pool.Wait();
+      EXPECT_EQ(5050, sum.load());
+      // Tasks scheduled after Wait run before the pool is destroyed.
+      pool.Schedule([&sum] { sum += 1; });
+    }
+    EXPECT_EQ(5051, sum.load());
+  }
+}
+
+// Tasks that schedule tasks add them to the queue of their worker, from which
+// idle workers steal them.
+TEST(ThreadPoolTest, RunsTasksScheduledByTasks) {
+  ThreadPool pool(4);
+  std::atomic<int> count(0);
+  for (int i = 0; i < 10; ++i) {
+    pool.Schedule([&pool, &count] {
+      for (int j = 0; j < 100; ++j) {
+        pool.Schedule([&count] { ++count; });
+      }
+    });
+  }
+  pool.Wait();
+  EXPECT_EQ(1000, count.load());
+}
+
+TEST(ThreadPoolTest, ParallelForCoversRange) {
+  ThreadPool pool(3);
+  for (size_t num_items : {0, 1, 2, 7, 1000}) {
+    std::vector<int> visits(num_items, 0);
+    ParallelFor(num_items, &pool, [&visits](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        ++visits[i];
+      }
+    });
+    EXPECT_EQ(std::vector<int>(num_items, 1), visits) << num_items;
+  }
+  // Without a pool, the range is processed on the calling thread.
+  std::vector<int> visits(10, 0);
+  ParallelFor(10, nullptr, [&visits](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  });
+  EXPECT_EQ(std::vector<int>(10, 1), visits);
+}
+
+// A ParallelFor in a task of the same pool does not wait for itself, even if
+// every worker is running such a task.
+TEST(ThreadPoolTest, ParallelForNests) {
+  ThreadPool pool(2);
+  std::atomic<int> count(0);
+  ParallelFor(8, &pool, [&pool, &count](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      ParallelFor(100, &pool, [&count](size_t inner_begin, size_t inner_end) {
+        count += static_cast<int>(inner_end - inner_begin);
+      });
+    }
+  });
+  EXPECT_EQ(800, count.load());
+}
+
+TEST(ThreadPoolDeathTest, RequiresNonNegativeThreadCount) {
+  EXPECT_DEATH({ ThreadPool pool(-1); }, ".*");
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie
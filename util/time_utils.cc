@@ -31,31 +31,196 @@
 // inaccessible value for the local timezone when converting civil time to
 // absolute time. The code below attempts to infer the implicit timezone and
 // daylight savings information when possible.
+//
+// Timestamps in the fixed layout YYYY-MM-DDTHH:MM:SS+HH:MM, which is the only
+// layout produced by this file and by Plaso, are parsed and formatted by hand
+// using the proleptic Gregorian calendar arithmetic in DaysFromCivil() and
+// CivilFromDays(). The C time functions are only used for other inputs.
 #include "util/time_utils.h"
 
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 
 namespace morphie {
 namespace util {
 
+namespace {
+
+const int64_t kMicrosPerSecond = 1000000;
+const int64_t kSecondsPerDay = 86400;
+// The length of the string "YYYY-MM-DD".
+const size_t kDateLength = 10;
+// The length of the string "YYYY-MM-DDTHH:MM:SS+HH:MM".
+const size_t kFixedLength = 25;
+
+// A calendar date in the proleptic Gregorian calendar.
+struct CivilDate {
+  int64_t year;
+  int month;  // 1 to 12.
+  int day;    // 1 to 31.
+};
+
+// Returns the number of days from 1970-01-01 to the given date. The
+// computation works in eras of 400 years that begin on March 1st so that the
+// leap day is the last day of a year.
+int64_t DaysFromCivil(int64_t year, int month, int day) {
+  year -= (month <= 2) ? 1 : 0;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const int64_t year_of_era = year - era * 400;
+  const int64_t day_of_year =
+      (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const int64_t day_of_era =
+      year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+// Returns the date that is 'days' days after 1970-01-01. This is the inverse
+// of DaysFromCivil().
+CivilDate CivilFromDays(int64_t days) {
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const int64_t day_of_era = days - era * 146097;
+  const int64_t year_of_era = (day_of_era - day_of_era / 1460 +
+                               day_of_era / 36524 - day_of_era / 146096) /
+                              365;
+  const int64_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  const int64_t month_index = (5 * day_of_year + 2) / 153;
+  CivilDate date;
+  date.day = static_cast<int>(day_of_year - (153 * month_index + 2) / 5 + 1);
+  date.month = static_cast<int>(month_index < 10 ? month_index + 3
+                                                 : month_index - 9);
+  date.year = year_of_era + era * 400 + (date.month <= 2 ? 1 : 0);
+  return date;
+}
+
+// Writes 'value' as exactly 'width' decimal digits. Requires that 'value' is
+// non-negative and has at most 'width' digits.
+void WriteDigits(int64_t value, int width, char* out) {
+  for (int i = width - 1; i >= 0; --i) {
+    out[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+}
+
+// Stores the value of the 'width' decimal digits at 'in' in '*value'. Returns
+// false if one of the characters is not a digit.
+bool ReadDigits(const char* in, int width, int* value) {
+  *value = 0;
+  for (int i = 0; i < width; ++i) {
+    if (in[i] < '0' || in[i] > '9') {
+      return false;
+    }
+    *value = *value * 10 + (in[i] - '0');
+  }
+  return true;
+}
+
+// Consecutive timestamps usually fall on the same day, so the last date
+// formatted and the last date parsed on each thread are cached.
+struct FormatCache {
+  bool is_valid = false;
+  int64_t days = 0;
+  char date[kDateLength];
+};
+
+struct ParseCache {
+  bool is_valid = false;
+  char date[kDateLength];
+  int64_t days = 0;
+};
+
+thread_local FormatCache format_cache;
+thread_local ParseCache parse_cache;
+
+// Writes the string YYYY-MM-DD of the date 'days' days after 1970-01-01 to
+// 'out'. Returns false if the year is not between 0 and 9999.
+bool WriteDate(int64_t days, char* out) {
+  if (!format_cache.is_valid || format_cache.days != days) {
+    CivilDate date = CivilFromDays(days);
+    if (date.year < 0 || date.year > 9999) {
+      return false;
+    }
+    char* d = format_cache.date;
+    WriteDigits(date.year, 4, d);
+    d[4] = '-';
+    WriteDigits(date.month, 2, d + 5);
+    d[7] = '-';
+    WriteDigits(date.day, 2, d + 8);
+    format_cache.days = days;
+    format_cache.is_valid = true;
+  }
+  std::memcpy(out, format_cache.date, kDateLength);
+  return true;
+}
+
+// Stores the number of days after 1970-01-01 of the date YYYY-MM-DD at 'in' in
+// '*days'. Returns false if 'in' does not begin with a date.
+bool ReadDate(const char* in, int64_t* days) {
+  if (parse_cache.is_valid &&
+      std::memcmp(in, parse_cache.date, kDateLength) == 0) {
+    *days = parse_cache.days;
+    return true;
+  }
+  int year, month, day;
+  if (!ReadDigits(in, 4, &year) || in[4] != '-' ||
+      !ReadDigits(in + 5, 2, &month) || in[7] != '-' ||
+      !ReadDigits(in + 8, 2, &day)) {
+    return false;
+  }
+  if (month < 1 || month > 12 || day < 1 || day > 31) {
+    return false;
+  }
+  *days = DaysFromCivil(year, month, day);
+  std::memcpy(parse_cache.date, in, kDateLength);
+  parse_cache.days = *days;
+  parse_cache.is_valid = true;
+  return true;
+}
+
+// Parses a string in the layout YYYY-MM-DDTHH:MM:SS+HH:MM. Returns false for
+// any other string, including strings that the C time functions may accept.
+bool ParseFixedRFC3339(const string& time_str, int64_t* unix_micros) {
+  if (time_str.size() != kFixedLength) {
+    return false;
+  }
+  const char* in = time_str.data();
+  int64_t days;
+  if (!ReadDate(in, &days)) {
+    return false;
+  }
+  int hour, minute, second, offset_hour, offset_minute;
+  if (in[10] != 'T' || !ReadDigits(in + 11, 2, &hour) || in[13] != ':' ||
+      !ReadDigits(in + 14, 2, &minute) || in[16] != ':' ||
+      !ReadDigits(in + 17, 2, &second) || (in[19] != '+' && in[19] != '-') ||
+      !ReadDigits(in + 20, 2, &offset_hour) || in[22] != ':' ||
+      !ReadDigits(in + 23, 2, &offset_minute)) {
+    return false;
+  }
+  if (hour > 23 || minute > 59 || second > 60 || offset_hour > 23 ||
+      offset_minute > 59) {
+    return false;
+  }
+  int64_t offset = (offset_hour * 60 + offset_minute) * 60;
+  int64_t seconds = days * kSecondsPerDay + hour * 3600 + minute * 60 + second;
+  seconds += (in[19] == '+') ? -offset : offset;
+  *unix_micros = seconds * kMicrosPerSecond;
+  return true;
+}
+
 // Uses the function gmtime_r to convert time in seconds to civil time in UTC
 // and strftime to print this time.
-string UnixMicrosToRFC3339(int64_t unix_micros) {
+size_t FormatWithTimeLibrary(std::time_t unix_secs, char* buf) {
   std::tm tm;
-  std::time_t unix_secs = unix_micros / 1000000;
-  if (unix_micros % 1000000 < 0) {
-    unix_secs--;
-  }
   std::tm* tmp = gmtime_r(&unix_secs, &tm);
-  char buf[sizeof("9223372036854775807-12-31T23:59:59+00:00")];
-  std::strftime(buf, sizeof buf, "%Y-%m-%dT%H:%M:%S+00:00", tmp);
-  return buf;
+  return std::strftime(buf, kRFC3339BufferSize, "%Y-%m-%dT%H:%M:%S+00:00",
+                       tmp);
 }
 
 // Uses strptime to parse time_str and populate the fields in tm. Explicitly
 // extracts the timezone offset, which is not parsed by strptime.
-bool RFC3339ToUnixMicros(const string& time_str, int64_t* unix_micros) {
+bool ParseWithTimeLibrary(const string& time_str, int64_t* unix_micros) {
   std::tm tm;
   char* ap = const_cast<char*>(time_str.c_str());
   char* bp = strptime(ap, "%Y-%m-%dT%H:%M:%S", &tm);
@@ -75,10 +240,9 @@ bool RFC3339ToUnixMicros(const string& time_str, int64_t* unix_micros) {
   if (pos != 6 || bp[pos] != '\0') {
     return false;
   }
-  int sign = -1;
+  int sign = (*bp == '+') ? -1 : 1;
   if (hour < 0) {
     hour = -hour;
-    sign = 1;
   }
   if (hour > 23 || minute < 0 || minute > 59) {
     return false;
@@ -87,13 +251,61 @@ bool RFC3339ToUnixMicros(const string& time_str, int64_t* unix_micros) {
   int64_t seconds = tm.tm_sec;
   seconds += tm.tm_min * 60;
   seconds += tm.tm_hour * 3600;
-  seconds += tm.tm_yday * 86400;
-  seconds += (tm.tm_year - 70) * 31536000;
-  seconds += ((tm.tm_year - 69) / 4) * 86400;
+  seconds += DaysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday) *
+             kSecondsPerDay;
   seconds += sign * (((hour * 60) + minute) * 60);
-  *unix_micros = seconds * 1000000;
+  *unix_micros = seconds * kMicrosPerSecond;
   return true;
 }
 
+}  // namespace
+
+string UnixMicrosToRFC3339(int64_t unix_micros) {
+  char buf[kRFC3339BufferSize];
+  size_t length = UnixMicrosToRFC3339(unix_micros, buf);
+  return string(buf, length);
+}
+
+// One microsecond before a second belongs to the previous second, so the
+// division rounds towards negative infinity.
+size_t UnixMicrosToRFC3339(int64_t unix_micros, char* buf) {
+  int64_t unix_secs = unix_micros / kMicrosPerSecond;
+  if (unix_micros % kMicrosPerSecond < 0) {
+    unix_secs--;
+  }
+  int64_t days = unix_secs / kSecondsPerDay;
+  int64_t secs_of_day = unix_secs % kSecondsPerDay;
+  if (secs_of_day < 0) {
+    days--;
+    secs_of_day += kSecondsPerDay;
+  }
+  if (!WriteDate(days, buf)) {
+    return FormatWithTimeLibrary(static_cast<std::time_t>(unix_secs), buf);
+  }
+  buf[10] = 'T';
+  WriteDigits(secs_of_day / 3600, 2, buf + 11);
+  buf[13] = ':';
+  WriteDigits(secs_of_day / 60 % 60, 2, buf + 14);
+  buf[16] = ':';
+  WriteDigits(secs_of_day % 60, 2, buf + 17);
+  std::memcpy(buf + 19, "+00:00", sizeof("+00:00"));
+  return kFixedLength;
+}
+
+void UnixMicrosToRFC3339(const std::vector<int64_t>& unix_micros,
+                         std::vector<string>* rfc3339) {
+  rfc3339->resize(unix_micros.size());
+  char buf[kRFC3339BufferSize];
+  for (size_t i = 0; i < unix_micros.size(); ++i) {
+    size_t length = UnixMicrosToRFC3339(unix_micros[i], buf);
+    (*rfc3339)[i].assign(buf, length);
+  }
+}
+
+bool RFC3339ToUnixMicros(const string& time_str, int64_t* unix_micros) {
+  return ParseFixedRFC3339(time_str, unix_micros) ||
+         ParseWithTimeLibrary(time_str, unix_micros);
+}
+
 }  // namespace util
 }  // namespace morphie
@@ -24,17 +24,36 @@
 #ifndef LOGLE_UTIL_TIME_UTILS_H_
 #define LOGLE_UTIL_TIME_UTILS_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "base/string.h"
 
 namespace morphie {
 namespace util {
 
+// The size of a buffer that can hold the RFC3339 string of any timestamp,
+// including the terminating null character.
+const size_t kRFC3339BufferSize =
+    sizeof("9223372036854775807-12-31T23:59:59+00:00");
+
 // Returns an RFC3339 string in UTC corresponding to the number of microseconds
 // since the Unix epoch.
 string UnixMicrosToRFC3339(int64_t unix_micros);
 
+// Writes the null-terminated RFC3339 string of 'unix_micros' to 'buf' and
+// returns its length. Requires that 'buf' has room for kRFC3339BufferSize
+// characters. Timestamps in the years 0 to 9999 are formatted without
+// allocating memory or calling the C time library.
+size_t UnixMicrosToRFC3339(int64_t unix_micros, char* buf);
+
+// Replaces the contents of 'rfc3339' with the RFC3339 strings of the
+// timestamps in 'unix_micros', in the same order. Timestamps on the same day
+// share the formatting of the date, so a sorted vector is converted fastest.
+void UnixMicrosToRFC3339(const std::vector<int64_t>& unix_micros,
+                         std::vector<string>* rfc3339);
+
 // Returns true and stores the microseconds since the Unix epoch in *unix_micros
 // if time_str could be parsed as an RFC3339 string. Returns false otherwise.
 bool RFC3339ToUnixMicros(const string& time_str, int64_t* unix_micros);
@@ -15,6 +15,8 @@
 #include "util/time_utils.h"
 
 #include <cstdint>
+#include <ctime>
+#include <vector>
 
 #include "base/string.h"
 #include "gtest.h"
@@ -59,6 +61,79 @@ TEST(TimeUtilsTest, MicrosToRFC3339) {
   EXPECT_EQ(-1000000 * kSecsBeforeMidnight, micros);
 }
 
+// Returns the RFC3339 string of 'unix_secs' computed by the C time library.
+string FormatWithGmtime(std::time_t unix_secs) {
+  std::tm tm;
+  char buf[kRFC3339BufferSize];
+  std::strftime(buf, sizeof buf, "%Y-%m-%dT%H:%M:%S+00:00",
+                gmtime_r(&unix_secs, &tm));
+  return buf;
+}
+
+// The hand-written calendar arithmetic agrees with the C time library on days
+// around leap days and century years, and both conversions are inverses. The
+// comparison starts in the year 1000 because strftime does not pad years with
+// fewer than four digits.
+TEST(TimeUtilsTest, MatchesTimeLibrary) {
+  const int64_t kSecsPerDay = 86400;
+  std::vector<int64_t> secs;
+  for (int64_t day = -354000; day <= 2932000; day += 997) {
+    secs.push_back(day * kSecsPerDay + (day * 7919) % kSecsPerDay);
+  }
+  // 1900-03-01, 1968-03-01, 2000-02-29, 2100-03-01 and 9999-12-31T23:59:59.
+  for (int64_t s : {-2203891200LL, -57974400LL, 951782400LL, 4107542400LL,
+                    253402300799LL}) {
+    secs.push_back(s);
+    secs.push_back(s - 1);
+  }
+  for (int64_t s : secs) {
+    string expected = FormatWithGmtime(static_cast<std::time_t>(s));
+    EXPECT_EQ(expected, UnixMicrosToRFC3339(s * 1000000));
+    int64_t micros;
+    ASSERT_TRUE(RFC3339ToUnixMicros(expected, &micros)) << expected;
+    EXPECT_EQ(s * 1000000, micros) << expected;
+  }
+}
+
+TEST(TimeUtilsTest, FormatsIntoBuffer) {
+  char buf[kRFC3339BufferSize];
+  EXPECT_EQ(25, UnixMicrosToRFC3339(1455148601000000, buf));
+  EXPECT_STREQ("2016-02-10T23:56:41+00:00", buf);
+  EXPECT_EQ(25, UnixMicrosToRFC3339(-62135596800LL * 1000000, buf));
+  EXPECT_STREQ("0001-01-01T00:00:00+00:00", buf);
+  // Years after 9999 are longer than the fixed layout.
+  int64_t micros = 253402300800LL * 1000000;
+  EXPECT_EQ(26, UnixMicrosToRFC3339(micros, buf));
+  EXPECT_STREQ("10000-01-01T00:00:00+00:00", buf);
+}
+
+TEST(TimeUtilsTest, ConvertsBatches) {
+  std::vector<string> rfc3339 = {"stale"};
+  UnixMicrosToRFC3339({}, &rfc3339);
+  EXPECT_TRUE(rfc3339.empty());
+  UnixMicrosToRFC3339({1455148601000000, 0, 1455148602000000, -1}, &rfc3339);
+  EXPECT_EQ(std::vector<string>({"2016-02-10T23:56:41+00:00",
+                                 "1970-01-01T00:00:00+00:00",
+                                 "2016-02-10T23:56:42+00:00",
+                                 "1969-12-31T23:59:59+00:00"}),
+            rfc3339);
+}
+
+// The offset is subtracted from the civil time to obtain UTC, including for
+// negative offsets of less than an hour.
+TEST(TimeUtilsTest, AppliesTimezoneOffsets) {
+  int64_t micros;
+  EXPECT_TRUE(RFC3339ToUnixMicros("1970-01-01T05:30:00+05:30", &micros));
+  EXPECT_EQ(0, micros);
+  EXPECT_TRUE(RFC3339ToUnixMicros("1969-12-31T23:30:00-00:30", &micros));
+  EXPECT_EQ(0, micros);
+  EXPECT_TRUE(RFC3339ToUnixMicros("1969-12-31T16:00:00-08:00", &micros));
+  EXPECT_EQ(0, micros);
+  EXPECT_FALSE(RFC3339ToUnixMicros("1970-13-01T00:00:00+00:00", &micros));
+  EXPECT_FALSE(RFC3339ToUnixMicros("1970-01-01T00:00:00Z", &micros));
+  EXPECT_FALSE(RFC3339ToUnixMicros("1970-01-01T00:00:00+00:00 ", &micros));
+}
+
 }  // anonymous namespace
 }  // namespace util
 }  // namespace morphie
@@ -0,0 +1,190 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+#include "util/trace.h"
+
+#include <chrono>  // NOLINT
+#include <iomanip>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+namespace morphie {
+namespace util {
+
+namespace internal {
+
+std::atomic<bool> tracing_enabled(false);
+
+}  // namespace internal
+
+namespace {
+
+struct Span {
+  const char* name;
+  int64_t begin_nanos;
+  int64_t end_nanos;
+};
+
+// The spans recorded by one thread. Only the thread that holds the buffer
+// writes its spans and its counter, and the counter is atomic so that
+// StartTracing may reset it.
+struct TraceBuffer {
+  explicit TraceBuffer(int thread_number)
+      : thread_number(thread_number),
+        spans(kSpansPerThread),
+        num_recorded(0),
+        is_free(false) {}
+
+  const int thread_number;
+  std::vector<Span> spans;
+  std::atomic<uint64_t> num_recorded;
+  // Guarded by the mutex of the registry.
+  bool is_free;
+};
+
+// The buffers of all threads that have recorded spans. The registry is never
+// destroyed, so that threads that exit late can still release their buffer.
+struct TraceRegistry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<TraceBuffer>> buffers;
+  std::atomic<int64_t> start_nanos{0};
+};
+
+TraceRegistry* GetRegistry() {
+  static TraceRegistry* registry = new TraceRegistry;
+  return registry;
+}
+
+// Holds the buffer of a thread from the first span that the thread records,
+// and releases the buffer for reuse when the thread exits.
+class BufferHandle {
+ public:
+  BufferHandle() : buffer_(nullptr) {}
+  ~BufferHandle() {
+    if (buffer_ != nullptr) {
+      TraceRegistry* registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry->mutex);
+      buffer_->is_free = true;
+    }
+  }
+
+  TraceBuffer* Get() {
+    if (buffer_ == nullptr) {
+      TraceRegistry* registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry->mutex);
+      for (const auto& buffer : registry->buffers) {
+        if (buffer->is_free) {
+          buffer->is_free = false;
+          buffer_ = buffer.get();
+          return buffer_;
+        }
+      }
+      registry->buffers.emplace_back(
+          new TraceBuffer(static_cast<int>(registry->buffers.size()) + 1));
+      buffer_ = registry->buffers.back().get();
+    }
+    return buffer_;
+  }
+
+ private:
+  TraceBuffer* buffer_;
+};
+
+thread_local BufferHandle thread_buffer;
+
+// Writes 'name' as a JSON string. Span names are identifiers in code, so only
+// quotes, backslashes and control characters are escaped.
+void WriteJsonString(const char* name, std::ostream* out) {
+  *out << '"';
+  for (const char* c = name; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      *out << '\\' << *c;
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      *out << ' ';
+    } else {
+      *out << *c;
+    }
+  }
+  *out << '"';
+}
+
+}  // namespace
+
+namespace internal {
+
+int64_t TraceNowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void RecordSpan(const char* name, int64_t begin_nanos) {
+  TraceBuffer* buffer = thread_buffer.Get();
+  uint64_t index = buffer->num_recorded.load(std::memory_order_relaxed);
+  buffer->spans[index % kSpansPerThread] = {name, begin_nanos,
+                                            TraceNowNanos()};
+  buffer->num_recorded.store(index + 1, std::memory_order_release);
+}
+
+}  // namespace internal
+
+void StartTracing() {
+  TraceRegistry* registry = GetRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    for (const auto& buffer : registry->buffers) {
+      buffer->num_recorded.store(0, std::memory_order_relaxed);
+    }
+  }
+  registry->start_nanos.store(internal::TraceNowNanos(),
+                              std::memory_order_relaxed);
+  internal::tracing_enabled.store(true, std::memory_order_release);
+}
+
+void StopTracing() {
+  internal::tracing_enabled.store(false, std::memory_order_release);
+}
+
+void WriteChromeTrace(std::ostream* out) {
+  TraceRegistry* registry = GetRegistry();
+  const int64_t start_nanos =
+      registry->start_nanos.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  *out << "{\"traceEvents\":[";
+  bool is_first = true;
+  *out << std::fixed << std::setprecision(3);
+  for (const auto& buffer : registry->buffers) {
+    uint64_t num_recorded =
+        buffer->num_recorded.load(std::memory_order_acquire);
+    uint64_t begin = num_recorded > static_cast<uint64_t>(kSpansPerThread)
+                         ? num_recorded - kSpansPerThread
+                         : 0;
+    for (uint64_t i = begin; i < num_recorded; ++i) {
+      const Span& span = buffer->spans[i % kSpansPerThread];
+      *out << (is_first ? "\n" : ",\n") << "{\"name\":";
+      WriteJsonString(span.name, out);
+      *out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_number
+           << ",\"ts\":" << (span.begin_nanos - start_nanos) / 1000.0
+           << ",\"dur\":" << (span.end_nanos - span.begin_nanos) / 1000.0
+           << "}";
+      is_first = false;
+    }
+  }
+  *out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+}  // namespace util
+}  // namespace morphie
@@ -0,0 +1,103 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+// This file contains a tracer that records spans, which are named intervals of
+// wall time on a thread, and writes them in the Chrome trace event format, so
+// that a trace can be viewed in chrome://tracing or Perfetto to see where an
+// analysis spends its time, when the threads of a pipeline wait for each other
+// and how evenly work is spread over threads. A span is recorded by a
+// ScopedSpan from its construction to its destruction.
+//
+// Each thread records its spans in its own ring buffer, so recording takes no
+// lock, and a thread that records more spans than its buffer holds keeps only
+// its latest spans. While tracing is disabled, which is the default, a
+// ScopedSpan only loads one atomic flag.
+//
+// Example.
+//   util::StartTracing();
+//   {
+//     util::ScopedSpan span("parse");
+//     // Parse the input.
+//   }
+//   util::StopTracing();
+//   util::WriteChromeTrace(&out);
+#ifndef LOGLE_UTIL_TRACE_H_
+#define LOGLE_UTIL_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace morphie {
+namespace util {
+
+namespace internal {
+
+extern std::atomic<bool> tracing_enabled;
+
+// Returns the current time in nanoseconds since an arbitrary epoch.
+int64_t TraceNowNanos();
+// Adds a span named 'name' from 'begin_nanos' to now to the buffer of the
+// calling thread.
+void RecordSpan(const char* name, int64_t begin_nanos);
+
+}  // namespace internal
+
+// The number of spans that the buffer of each thread holds.
+const int kSpansPerThread = 1 << 16;
+
+// Discards all recorded spans and enables recording.
+void StartTracing();
+// Disables recording. The recorded spans are kept until the next call to
+// StartTracing.
+void StopTracing();
+// Returns true if spans are recorded.
+inline bool IsTracingEnabled() {
+  return internal::tracing_enabled.load(std::memory_order_relaxed);
+}
+
+// Writes the recorded spans to 'out' as a JSON object in the Chrome trace
+// event format, with one complete event ("ph": "X") per span and with the
+// times in microseconds. Threads are numbered from 1 in the order in which
+// they recorded their first span; the buffer of a thread that has exited is
+// reused by the next thread that records a span, so such threads share a
+// number. Must not be called while spans are recorded.
+void WriteChromeTrace(std::ostream* out);
+
+// Records a span named 'name' from its construction to its destruction if
+// tracing is enabled when it is constructed. The name must be a string that
+// outlives the trace, such as a string literal.
+class ScopedSpan {
+ public:
+  explicit ScopedSpan(const char* name)
+      : name_(IsTracingEnabled() ? name : nullptr),
+        begin_nanos_(name_ != nullptr ? internal::TraceNowNanos() : 0) {}
+  ~ScopedSpan() {
+    if (name_ != nullptr) {
+      internal::RecordSpan(name_, begin_nanos_);
+    }
+  }
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+ private:
+  const char* const name_;
+  const int64_t begin_nanos_;
+};
+
+}  // namespace util
+}  // namespace morphie
+
+#endif  // LOGLE_UTIL_TRACE_H_
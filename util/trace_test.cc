@@ -0,0 +1,95 @@
+// Copyright 2015 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+#include "util/trace.h"
+
+#include <sstream>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/string.h"
+#include "gtest.h"
+
+namespace morphie {
+namespace util {
+namespace {
+
+// Returns the number of times 'pattern' occurs in 'text'.
+int CountOccurrences(const string& text, const string& pattern) {
+  int count = 0;
+  for (size_t pos = text.find(pattern); pos != string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(TraceTest, RecordsNothingWhenDisabled) {
+  StartTracing();
+  StopTracing();
+  EXPECT_FALSE(IsTracingEnabled());
+  { ScopedSpan span("disabled"); }
+  std::ostringstream out;
+  WriteChromeTrace(&out);
+  EXPECT_EQ("{\"traceEvents\":[\n],\"displayTimeUnit\":\"ms\"}\n", out.str());
+}
+
+TEST(TraceTest, WritesSpansOfSeveralThreads) {
+  StartTracing();
+  EXPECT_TRUE(IsTracingEnabled());
+  {
+    ScopedSpan outer("outer");
+    { ScopedSpan inner("in\"ner"); }
+  }
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 3; ++i) {
+    threads.emplace_back([] { ScopedSpan span("worker"); });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  StopTracing();
+  std::ostringstream out;
+  WriteChromeTrace(&out);
+  string trace = out.str();
+  EXPECT_EQ(1, CountOccurrences(trace, "\"name\":\"outer\""));
+  EXPECT_EQ(1, CountOccurrences(trace, "\"name\":\"in\\\"ner\""));
+  EXPECT_EQ(3, CountOccurrences(trace, "\"name\":\"worker\""));
+  EXPECT_EQ(5, CountOccurrences(trace, "\"ph\":\"X\""));
+  // The inner span ends first and is recorded first.
+  EXPECT_LT(trace.find("in\\\"ner"), trace.find("outer"));
+  // Restarting discards the spans.
+  StartTracing();
+  StopTracing();
+  std::ostringstream empty;
+  WriteChromeTrace(&empty);
+  EXPECT_EQ(0, CountOccurrences(empty.str(), "\"ph\""));
+}
+
+TEST(TraceTest, KeepsTheLatestSpansOfAThread) {
+  StartTracing();
+  for (int i = 0; i < kSpansPerThread + 10; ++i) {
+    ScopedSpan span(i < 10 ? "early" : "late");
+  }
+  StopTracing();
+  std::ostringstream out;
+  WriteChromeTrace(&out);
+  EXPECT_EQ(0, CountOccurrences(out.str(), "\"early\""));
+  EXPECT_EQ(kSpansPerThread, CountOccurrences(out.str(), "\"late\""));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace morphie